@@ -6,17 +6,22 @@
  */
 
 #include <syslog.h>
+#include <algorithm>
+#include <array>
 #include <fstream>
+#include <mutex>
 #include <stdexcept>
 
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/ExceptionString.h>
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/String.h>
 #include <folly/gen/Base.h>
 #include <folly/gen/String.h>
 #include <folly/init/Init.h>
@@ -27,13 +32,19 @@
 #include <sodium.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp/concurrency/PriorityThreadManager.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <thrift/lib/cpp2/transport/rsocket/server/RSRoutingHandler.h>
 
 #include <openr/allocators/PrefixAllocator.h>
 #include <openr/common/BuildInfo.h>
 #include <openr/common/Constants.h>
+#include <openr/common/CpuProfiler.h>
+#include <openr/common/EventLogBuffer.h>
 #include <openr/common/Flags.h>
+#include <openr/common/RuntimeKnobs.h>
+#include <openr/common/StartupOrchestrator.h>
+#include <openr/common/ThreadPlacement.h>
 #include <openr/common/ThriftUtil.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
@@ -51,7 +62,10 @@
 #include <openr/plugin/Plugin.h>
 #include <openr/prefix-manager/PrefixManager.h>
 #include <openr/spark/IoProvider.h>
+#include <openr/spark/IoUringProvider.h>
 #include <openr/spark/Spark.h>
+#include <openr/spark/SparkCoordinator.h>
+#include <openr/spark/SparkFastDetector.h>
 #include <openr/watchdog/Watchdog.h>
 
 using namespace fbzmq;
@@ -68,6 +82,12 @@ namespace {
 //
 
 const std::string inet6Path = "/proc/net/if_inet6";
+
+// CPU and scheduling placement of module threads, by thread name
+ThreadPlacements threadPlacements;
+
+// Guards the lists of threads and event bases, modules start in parallel
+std::mutex moduleThreadsLock;
 } // namespace
 
 // Disable background jemalloc background thread => new jemalloc-5 feature
@@ -114,17 +134,46 @@ waitForFibService(const fbzmq::ZmqEventLoop& evl) {
   LOG(INFO) << "FibService up. Waited for " << waitMs << " ms.";
 }
 
+/**
+ * Apply the placement configured for the named thread to the calling one
+ */
+void
+placeThread(const std::string& name) {
+  auto it = threadPlacements.find(name);
+  if (it == threadPlacements.end()) {
+    return;
+  }
+  if (applyThreadPlacement(it->second, FLAGS_thread_numa_local_alloc)) {
+    LOG(INFO) << "Placed " << name << " thread on CPUs ["
+              << folly::join(",", it->second.cpus) << "], nice value "
+              << it->second.niceValue.value_or(0);
+  }
+}
+
 void
-submitCounters(const ZmqEventLoop& eventLoop, ZmqMonitorClient& monitorClient) {
+submitCounters(
+    const ZmqEventLoop& eventLoop,
+    ZmqMonitorClient& monitorClient,
+    std::unordered_map<std::string, int64_t> counters) {
   VLOG(3) << "Submitting counters...";
-  std::unordered_map<std::string, int64_t> counters{};
   counters["main.zmq_event_queue_size"] = eventLoop.getEventQueueSize();
   monitorClient.setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
+/**
+ * Keep track of a thread to join on shutdown
+ */
+void
+addThread(std::vector<std::thread>& allThreads, std::thread thread) {
+  std::lock_guard<std::mutex> lock(moduleThreadsLock);
+  allThreads.emplace_back(std::move(thread));
+}
+
 /**
  * Start an EventBase in a thread, maintain order of thread creation and
- * returns raw pointer of Derived class.
+ * returns raw pointer of Derived class. Modules get created in order of their
+ * dependencies, hence the reverse order stops dependents before the modules
+ * they depend on.
  */
 template <typename T>
 T*
@@ -140,9 +189,11 @@ startEventBase(
       reinterpret_cast<OpenrEventBase*>(evbT.release()));
 
   // Start a thread
-  allThreads.emplace_back(std::thread([evb = evb.get(), name]() noexcept {
+  addThread(allThreads, std::thread([evb = evb.get(), name]() noexcept {
     LOG(INFO) << "Starting " << name << " thread ...";
     folly::setThreadName(name);
+    placeThread(name);
+    CpuProfiler::get().registerThread(name);
     evb->run();
     LOG(INFO) << name << " thread got stopped.";
   }));
@@ -155,6 +206,7 @@ startEventBase(
 
   // Emplace evb into ordered list of evbs. So that we can destroy
   // them in revserse order of their creation.
+  std::lock_guard<std::mutex> lock(moduleThreadsLock);
   orderedEvbs.emplace_back(std::move(evb));
 
   return t;
@@ -237,6 +289,29 @@ main(int argc, char** argv) {
     maybeIpTos = FLAGS_ip_tos;
   }
 
+  // Placement of module threads on CPUs, left to the scheduler by default
+  if (FLAGS_thread_placement == "auto") {
+    threadPlacements = getDefaultThreadPlacements(getAllowedCpus());
+  } else {
+    auto placements = parseThreadPlacements(FLAGS_thread_placement);
+    CHECK(placements.hasValue()) << placements.error();
+    threadPlacements = std::move(placements).value();
+  }
+
+  // Spark shards run at the priority of Spark unless placed on their own,
+  // without sharing its CPUs
+  CHECK_GE(FLAGS_spark_num_shards, 1) << "spark_num_shards must be positive";
+  auto sparkPlacementIt = threadPlacements.find("Spark");
+  if (sparkPlacementIt != threadPlacements.end()) {
+    const auto niceValue = sparkPlacementIt->second.niceValue;
+    for (int shard = 1; shard < FLAGS_spark_num_shards; ++shard) {
+      auto const name = SparkCoordinator::getShardName(shard);
+      if (threadPlacements.count(name) == 0) {
+        threadPlacements[name].niceValue = niceValue;
+      }
+    }
+  }
+
   // Hold time for advertising Prefix/Adj keys into KvStore
   const std::chrono::seconds kvHoldTime{2 * FLAGS_spark_keepalive_time_s};
 
@@ -246,12 +321,29 @@ main(int argc, char** argv) {
   // Set main thread name
   folly::setThreadName("openr");
 
-  // Queue for inter-module communication
-  ReplicateQueue<openr::thrift::RouteDatabaseDelta> routeUpdatesQueue;
-  ReplicateQueue<openr::thrift::InterfaceDatabase> interfaceUpdatesQueue;
-  ReplicateQueue<openr::thrift::SparkNeighborEvent> neighborUpdatesQueue;
-  ReplicateQueue<openr::thrift::PrefixUpdateRequest> prefixUpdatesQueue;
-  ReplicateQueue<openr::thrift::Publication> kvStoreUpdatesQueue;
+  // Queue for inter-module communication. Names and reader names identify
+  // them in the counters
+  ReplicateQueue<openr::RouteUpdate> routeUpdatesQueue("route_updates");
+  ReplicateQueue<openr::thrift::InterfaceDatabase> interfaceUpdatesQueue(
+      "interface_updates");
+  ReplicateQueue<openr::thrift::SparkNeighborEvent> neighborUpdatesQueue(
+      "neighbor_updates");
+  ReplicateQueue<openr::thrift::PrefixUpdateRequest> prefixUpdatesQueue(
+      "prefix_updates");
+  ReplicateQueue<openr::KvStorePublicationPtr> kvStoreUpdatesQueue(
+      "kvstore_updates");
+
+  // Readers of the queues, created before any module starts so that no module
+  // misses updates of the ones started before it
+  auto prefixManagerPrefixUpdatesReader =
+      prefixUpdatesQueue.getReader("prefix_manager");
+  auto sparkInterfaceUpdatesReader = interfaceUpdatesQueue.getReader("spark");
+  auto linkMonitorNeighborUpdatesReader =
+      neighborUpdatesQueue.getReader("link_monitor");
+  auto decisionKvStoreUpdatesReader =
+      kvStoreUpdatesQueue.getReader("decision");
+  auto fibRouteUpdatesReader = routeUpdatesQueue.getReader("fib");
+  auto fibInterfaceUpdatesReader = interfaceUpdatesQueue.getReader("fib");
 
   // structures to organize our modules
   std::vector<std::thread> allThreads;
@@ -269,7 +361,11 @@ main(int argc, char** argv) {
             FLAGS_node_name,
             std::chrono::seconds(FLAGS_watchdog_interval_s),
             std::chrono::seconds(FLAGS_watchdog_threshold_s),
-            FLAGS_memory_limit_mb));
+            FLAGS_memory_limit_mb,
+            std::chrono::milliseconds(
+                FLAGS_watchdog_stall_warning_threshold_ms),
+            FLAGS_enable_module_memory_arenas,
+            std::max(0, FLAGS_memory_pressure_pct)));
   }
 
   // Create ThreadManager for thrift services
@@ -291,14 +387,14 @@ main(int argc, char** argv) {
     thriftThreadMgr->setNamePrefix("ThriftCpuPool");
     thriftThreadMgr->start();
 
-    // Create event publisher to handle event subscription
-    eventPublisher = std::make_unique<PlatformPublisher>(
-        context, PlatformPublisherUrl{FLAGS_platform_pub_url});
 
     // Create Netlink Protocol object in a new thread
     nlProtocolSocketEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
     nlProtocolSocket = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-        nlProtocolSocketEventLoop.get());
+        nlProtocolSocketEventLoop.get(),
+        FLAGS_netlink_message_window,
+        openr::fbnl::getPlatformRouteProtocols(),
+        FLAGS_enable_io_uring ? IoUringProvider::create() : nullptr);
     auto nlProtocolSocketThread = std::thread([&]() {
       LOG(INFO) << "Starting NetlinkProtolSocketEvl thread ...";
       folly::setThreadName("NetlinkProtolSocketEvl");
@@ -310,11 +406,31 @@ main(int argc, char** argv) {
     allThreads.emplace_back(std::move(nlProtocolSocketThread));
 
     nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
+
+    // Create event publisher to handle event subscription, netlink events
+    // are coalesced on the netlink event loop
+    eventPublisher = std::make_unique<PlatformPublisher>(
+        context,
+        PlatformPublisherUrl{FLAGS_platform_pub_url},
+        nlEventLoop.get(),
+        std::chrono::milliseconds(
+            std::max(0, FLAGS_platform_event_coalesce_ms)));
+
     nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
-        nlEventLoop.get(), eventPublisher.get(), std::move(nlProtocolSocket));
+        nlEventLoop.get(),
+        eventPublisher.get(),
+        std::move(nlProtocolSocket),
+        FLAGS_enable_nexthop_objects,
+        FLAGS_netlink_route_sockets > 1
+            ? std::make_unique<openr::fbnl::NetlinkRoutePool>(
+                  FLAGS_netlink_route_sockets, FLAGS_netlink_message_window)
+            : nullptr);
     // Subscribe selected network events
     nlSocket->subscribeEvent(openr::fbnl::LINK_EVENT);
     nlSocket->subscribeEvent(openr::fbnl::ADDR_EVENT);
+    if (FLAGS_fib_prune_failed_neighbors) {
+      nlSocket->subscribeEvent(openr::fbnl::NEIGH_EVENT);
+    }
     auto nlEvlThread = std::thread([&nlEventLoop]() {
       LOG(INFO) << "Starting NetlinkEvl thread ...";
       folly::setThreadName("NetlinkEvl");
@@ -392,9 +508,12 @@ main(int argc, char** argv) {
       vrf_set.push_back(VrfData("default", kAqRouteProtoId, 500));
 
       auto fibHandler = 
-      std::make_shared<IosxrslFibHandler>(&mainEventLoop, 
-                                          vrf_set,
-                                          channel);
+      std::make_shared<IosxrslFibHandler>(
+          &mainEventLoop,
+          vrf_set,
+          channel,
+          std::max(1, FLAGS_iosxr_slapi_batch_size),
+          std::max(1, FLAGS_iosxr_slapi_max_inflight));
       fibHandler->setVrfContext("default");
       iosxrslFibServer->setNWorkerThreads(1);
       iosxrslFibServer->setNPoolThreads(1);
@@ -411,12 +530,53 @@ main(int argc, char** argv) {
   const MonitorSubmitUrl monitorSubmitUrl{
       folly::sformat("tcp://[::1]:{}", FLAGS_monitor_rep_port)};
 
+  // Modules start in parallel as soon as the modules they depend on did
+  StartupOrchestrator orchestrator(FLAGS_node_name);
+
+  // Performance knobs registered by the modules, tunable through OpenrCtrl
+  RuntimeKnobs runtimeKnobs;
+
   ZmqMonitorClient monitorClient(context, monitorSubmitUrl);
   auto monitorTimer = fbzmq::ZmqTimeout::make(&mainEventLoop, [&]() noexcept {
-    submitCounters(mainEventLoop, monitorClient);
+    // Depth and latency of every reader of the inter-module queues
+    std::unordered_map<std::string, int64_t> counters;
+    for (auto const& queueCounters :
+         {routeUpdatesQueue.getCounters(),
+          interfaceUpdatesQueue.getCounters(),
+          neighborUpdatesQueue.getCounters(),
+          prefixUpdatesQueue.getCounters(),
+          kvStoreUpdatesQueue.getCounters()}) {
+      counters.insert(queueCounters.begin(), queueCounters.end());
+    }
+    // Lag and callback durations of every module's event loop
+    if (watchdog) {
+      auto watchdogCounters = watchdog->getCounters();
+      counters.insert(watchdogCounters.begin(), watchdogCounters.end());
+    }
+    // Time it took to start every module
+    auto startupCounters = orchestrator.getCounters();
+    counters.insert(startupCounters.begin(), startupCounters.end());
+    // Events logged and dropped by the modules
+    auto eventLogCounters = EventLogBuffer::get().getCounters();
+    counters.insert(eventLogCounters.begin(), eventLogCounters.end());
+    submitCounters(mainEventLoop, monitorClient, std::move(counters));
   });
   monitorTimer->scheduleTimeout(Constants::kMonitorSubmitInterval, true);
 
+  // Modules buffer their event logs, submit them to monitor in batches
+  auto eventLogTimer = fbzmq::ZmqTimeout::make(&mainEventLoop, [&]() noexcept {
+    auto samples =
+        EventLogBuffer::get().drain(Constants::kEventLogMaxBatchSize);
+    if (samples.empty()) {
+      return;
+    }
+    monitorClient.addEventLog(fbzmq::thrift::EventLog(
+        apache::thrift::FRAGILE,
+        Constants::kEventLogCategory.toString(),
+        std::move(samples)));
+  });
+  eventLogTimer->scheduleTimeout(Constants::kEventLogDrainInterval, true);
+
   // Starting main event-loop
   std::thread mainEventLoopThread([&]() noexcept {
     LOG(INFO) << "Starting main event loop...";
@@ -426,22 +586,29 @@ main(int argc, char** argv) {
   });
   mainEventLoop.waitUntilRunning();
 
-  if (FLAGS_enable_fib_service_waiting) {
-    waitForFibService(mainEventLoop);
-  }
+  // Only Fib needs the FibService, everything else starts while waiting
+  orchestrator.addStep("FibService", {}, [&]() {
+    if (FLAGS_enable_fib_service_waiting) {
+      waitForFibService(mainEventLoop);
+    }
+  });
 
   // Start config-store URL
-  auto configStore = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "ConfigStore",
-      std::make_unique<PersistentStore>(
-          FLAGS_node_name,
-          FLAGS_config_store_filepath,
-          context,
-          std::chrono::milliseconds(FLAGS_persistent_store_initial_backoff_ms),
-          std::chrono::milliseconds(FLAGS_persistent_store_max_backoff_ms)));
+  PersistentStore* configStore{nullptr};
+  orchestrator.addStep("ConfigStore", {}, [&]() {
+    configStore = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "ConfigStore",
+        std::make_unique<PersistentStore>(
+            FLAGS_node_name,
+            FLAGS_config_store_filepath,
+            context,
+            std::chrono::milliseconds(
+                FLAGS_persistent_store_initial_backoff_ms),
+            std::chrono::milliseconds(FLAGS_persistent_store_max_backoff_ms)));
+  });
 
   // Start monitor Module
   // for each log message it receives, we want to add the openr domain
@@ -454,14 +621,16 @@ main(int argc, char** argv) {
           "tcp://{}:{}", FLAGS_listen_addr, FLAGS_monitor_pub_port)},
       context,
       sampleToMerge);
-  std::thread monitorThread([&monitor]() noexcept {
-    LOG(INFO) << "Starting ZmqMonitor thread...";
-    folly::setThreadName("ZmqMonitor");
-    monitor.run();
-    LOG(INFO) << "ZmqMonitor thread got stopped.";
+  orchestrator.addStep("Monitor", {}, [&]() {
+    std::thread monitorThread([&monitor]() noexcept {
+      LOG(INFO) << "Starting ZmqMonitor thread...";
+      folly::setThreadName("ZmqMonitor");
+      monitor.run();
+      LOG(INFO) << "ZmqMonitor thread got stopped.";
+    });
+    monitor.waitUntilRunning();
+    addThread(allThreads, std::move(monitorThread));
   });
-  monitor.waitUntilRunning();
-  allThreads.emplace_back(std::move(monitorThread));
 
   std::optional<KvStoreFilters> kvFilters = std::nullopt;
   // Add key prefixes to allow if set as leaf node
@@ -489,6 +658,17 @@ main(int argc, char** argv) {
       FLAGS_kvstore_flood_msg_burst_size <= 0) {
     kvstoreRate = std::nullopt;
   }
+  std::vector<std::string> floodPriorityKeyPrefixes;
+  folly::split(
+      ",",
+      FLAGS_kvstore_flood_priority_key_prefixes,
+      floodPriorityKeyPrefixes,
+      true /* ignore empty */);
+  KvStoreQuota kvStoreQuota;
+  kvStoreQuota.maxKeysPerOriginator =
+      std::max<int64_t>(0, FLAGS_kvstore_max_keys_per_originator);
+  kvStoreQuota.maxBytesPerOriginator =
+      std::max<int64_t>(0, FLAGS_kvstore_max_bytes_per_originator);
 
   std::unordered_set<std::string> areas{
       openr::thrift::KvStore_constants::kDefaultArea()};
@@ -500,52 +680,75 @@ main(int argc, char** argv) {
   }
   const KvStoreLocalPubUrl kvStoreLocalPubUrl{"inproc://kvstore_pub_local"};
   // Start KVStore
-  auto kvStore = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "KvStore",
-      std::make_unique<KvStore>(
-          context,
-          FLAGS_node_name,
-          kvStoreUpdatesQueue,
-          kvStoreLocalPubUrl,
-          KvStoreGlobalCmdUrl{folly::sformat(
-              "tcp://{}:{}", FLAGS_listen_addr, FLAGS_kvstore_rep_port)},
-          monitorSubmitUrl,
-          maybeIpTos,
-          std::chrono::seconds(FLAGS_kvstore_sync_interval_s),
-          Constants::kMonitorSubmitInterval,
-          std::unordered_map<std::string, openr::thrift::PeerSpec>{},
-          std::move(kvFilters),
-          FLAGS_kvstore_zmq_hwm,
-          kvstoreRate,
-          std::chrono::milliseconds(FLAGS_kvstore_ttl_decrement_ms),
-          FLAGS_enable_flood_optimization,
-          FLAGS_is_flood_root,
-          FLAGS_use_flood_optimization,
-          areas));
-  const KvStoreLocalCmdUrl kvStoreLocalCmdUrl{kvStore->inprocCmdUrl};
-
-  auto prefixManager = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "PrefixManager",
-      std::make_unique<PrefixManager>(
-          FLAGS_node_name,
-          prefixUpdatesQueue.getReader(),
-          configStore,
-          kvStoreLocalCmdUrl,
-          kvStoreLocalPubUrl,
-          monitorSubmitUrl,
-          PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
-          FLAGS_per_prefix_keys,
-          FLAGS_enable_perf_measurement,
-          kvHoldTime,
-          std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
-          context,
-          areas));
+  KvStore* kvStore{nullptr};
+  orchestrator.addStep("KvStore", {}, [&]() {
+    kvStore = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "KvStore",
+        std::make_unique<KvStore>(
+            context,
+            FLAGS_node_name,
+            kvStoreUpdatesQueue,
+            kvStoreLocalPubUrl,
+            KvStoreGlobalCmdUrl{folly::sformat(
+                "tcp://{}:{}", FLAGS_listen_addr, FLAGS_kvstore_rep_port)},
+            monitorSubmitUrl,
+            maybeIpTos,
+            std::chrono::seconds(FLAGS_kvstore_sync_interval_s),
+            Constants::kMonitorSubmitInterval,
+            std::unordered_map<std::string, openr::thrift::PeerSpec>{},
+            std::move(kvFilters),
+            FLAGS_kvstore_zmq_hwm,
+            kvstoreRate,
+            std::chrono::milliseconds(FLAGS_kvstore_ttl_decrement_ms),
+            FLAGS_enable_flood_optimization,
+            FLAGS_is_flood_root,
+            FLAGS_use_flood_optimization,
+            areas,
+            std::max(1, FLAGS_kvstore_merge_threads),
+            FLAGS_kvstore_snapshot_filepath,
+            std::chrono::seconds(FLAGS_kvstore_snapshot_interval_s),
+            FLAGS_enable_kvstore_thrift_peers,
+            FLAGS_enable_kvstore_multi_root_flooding,
+            floodPriorityKeyPrefixes,
+            kvStoreQuota,
+            FLAGS_kvstore_export_path_prefix,
+            std::max<int64_t>(0, FLAGS_kvstore_lazy_value_threshold_bytes),
+            FLAGS_kvstore_partitioned_full_sync,
+            &runtimeKnobs,
+            FLAGS_kvstore_area_event_bases));
+  });
+
+  PrefixManager* prefixManager{nullptr};
+  orchestrator.addStep("PrefixManager", {"ConfigStore", "KvStore"}, [&]() {
+    prefixManager = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "PrefixManager",
+        std::make_unique<PrefixManager>(
+            FLAGS_node_name,
+            prefixManagerPrefixUpdatesReader,
+            configStore,
+            KvStoreLocalCmdUrl{kvStore->inprocCmdUrl},
+            kvStoreLocalPubUrl,
+            monitorSubmitUrl,
+            PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+            FLAGS_per_prefix_keys,
+            FLAGS_enable_perf_measurement,
+            kvHoldTime,
+            std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
+            context,
+            areas,
+            std::max(1, FLAGS_prefix_db_shards),
+            kvStore,
+            FLAGS_enable_prefix_aggregation,
+            std::min(std::max(0, FLAGS_prefix_aggregation_min_v4_length), 32),
+            std::min(
+                std::max(0, FLAGS_prefix_aggregation_min_v6_length), 128)));
+  });
 
   // Prefix Allocator to automatically allocate prefixes for nodes
   if (FLAGS_enable_prefix_alloc) {
@@ -563,39 +766,49 @@ main(int argc, char** argv) {
     } else {
       allocMode = PrefixAllocatorModeSeeded();
     }
-    startEventBase(
-        allThreads,
-        orderedEvbs,
-        watchdog,
-        "PrefixAllocator",
-        std::make_unique<PrefixAllocator>(
-            FLAGS_node_name,
-            kvStoreLocalCmdUrl,
-            kvStoreLocalPubUrl,
-            prefixUpdatesQueue,
-            monitorSubmitUrl,
-            AllocPrefixMarker{Constants::kPrefixAllocMarker.toString()},
-            allocMode,
-            FLAGS_set_loopback_address,
-            FLAGS_override_loopback_addr,
-            FLAGS_loopback_iface,
-            FLAGS_prefix_fwd_type_mpls,
-            FLAGS_prefix_algo_type_ksp2_ed_ecmp,
-            Constants::kPrefixAllocatorSyncInterval,
-            configStore,
-            context,
-            FLAGS_system_agent_port));
+    orchestrator.addStep(
+        "PrefixAllocator", {"ConfigStore", "KvStore"}, [&, allocMode]() {
+          startEventBase(
+              allThreads,
+              orderedEvbs,
+              watchdog,
+              "PrefixAllocator",
+              std::make_unique<PrefixAllocator>(
+                  FLAGS_node_name,
+                  KvStoreLocalCmdUrl{kvStore->inprocCmdUrl},
+                  kvStoreLocalPubUrl,
+                  prefixUpdatesQueue,
+                  monitorSubmitUrl,
+                  AllocPrefixMarker{Constants::kPrefixAllocMarker.toString()},
+                  allocMode,
+                  FLAGS_set_loopback_address,
+                  FLAGS_override_loopback_addr,
+                  FLAGS_loopback_iface,
+                  FLAGS_prefix_fwd_type_mpls,
+                  FLAGS_prefix_algo_type_ksp2_ed_ecmp,
+                  Constants::kPrefixAllocatorSyncInterval,
+                  configStore,
+                  context,
+                  FLAGS_system_agent_port));
+        });
+  }
+
+  // Spark2 neighbors to run fast failure detection with
+  auto fastDetectionConfigs =
+      SparkFastDetector::parseConfigs(FLAGS_spark2_fast_detection_config);
+  if (fastDetectionConfigs.hasError()) {
+    LOG(FATAL) << "Invalid spark2_fast_detection_config: "
+               << fastDetectionConfigs.error();
   }
 
   //
   // If enabled, start the spark service.
   //
-  auto spark = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "Spark",
-      std::make_unique<Spark>(
+  orchestrator.addStep("Spark", {}, [&]() {
+    auto makeSpark = [&](messaging::RQueue<thrift::InterfaceDatabase> reader,
+                         std::vector<SparkFastDetectionConfig> configs,
+                         folly::Optional<size_t> shardId) {
+      return std::make_unique<Spark>(
           FLAGS_domain, // My domain
           FLAGS_node_name, // myNodeName
           static_cast<uint16_t>(FLAGS_spark_mcast_port),
@@ -611,7 +824,7 @@ main(int argc, char** argv) {
           maybeIpTos,
           FLAGS_enable_v4,
           FLAGS_enable_subnet_validation,
-          interfaceUpdatesQueue.getReader(),
+          std::move(reader),
           neighborUpdatesQueue,
           monitorSubmitUrl,
           KvStoreCmdPort{static_cast<uint16_t>(FLAGS_kvstore_rep_port)},
@@ -619,11 +832,61 @@ main(int argc, char** argv) {
           std::make_pair(
               Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
           context,
-          std::make_shared<IoProvider>(),
+          // a provider per shard, io_uring ones are single threaded
+          FLAGS_enable_io_uring ? IoUringProvider::create()
+                                : std::make_shared<IoProvider>(),
           FLAGS_enable_flood_optimization,
           FLAGS_enable_spark2,
           FLAGS_spark2_increase_hello_interval,
-          areas));
+          areas,
+          std::move(configs),
+          static_cast<uint16_t>(FLAGS_spark2_fast_detection_port),
+          std::chrono::seconds(FLAGS_spark2_hello_max_time_s),
+          shardId,
+          &runtimeKnobs,
+          configStore);
+    };
+
+    if (FLAGS_spark_num_shards == 1) {
+      startEventBase(
+          allThreads,
+          orderedEvbs,
+          watchdog,
+          "Spark",
+          makeSpark(
+              sparkInterfaceUpdatesReader,
+              std::move(fastDetectionConfigs).value(),
+              folly::none));
+      return;
+    }
+
+    // Interfaces split across shards. The fast failure detectors of shards
+    // would contend for the same port
+    if (not fastDetectionConfigs.value().empty()) {
+      LOG(WARNING) << "Spark2 fast failure detection is disabled with "
+                   << FLAGS_spark_num_shards << " Spark shards";
+    }
+    auto coordinator = std::make_unique<SparkCoordinator>(
+        FLAGS_spark_num_shards, sparkInterfaceUpdatesReader);
+    std::vector<messaging::RQueue<thrift::InterfaceDatabase>> shardReaders;
+    for (size_t shard = 0; shard < coordinator->getNumShards(); ++shard) {
+      shardReaders.emplace_back(coordinator->getInterfaceUpdatesReader(shard));
+    }
+    startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "SparkCoord",
+        std::move(coordinator));
+    for (size_t shard = 0; shard < shardReaders.size(); ++shard) {
+      startEventBase(
+          allThreads,
+          orderedEvbs,
+          watchdog,
+          SparkCoordinator::getShardName(shard),
+          makeSpark(std::move(shardReaders[shard]), {}, shard));
+    }
+  });
 
   // Static list of prefixes to announce into the network as long as OpenR is
   // running.
@@ -709,73 +972,137 @@ main(int argc, char** argv) {
     LOG(FATAL) << "Regex compile failed";
   }
 
+  folly::Optional<FlapDampeningConfig> flapDampeningConfig;
+  if (FLAGS_enable_link_flap_dampening) {
+    flapDampeningConfig = FlapDampeningConfig{
+        static_cast<double>(FLAGS_link_flap_penalty),
+        static_cast<double>(FLAGS_link_flap_suppress_threshold),
+        static_cast<double>(FLAGS_link_flap_reuse_threshold),
+        std::chrono::seconds(FLAGS_link_flap_half_life_s),
+        std::chrono::seconds(FLAGS_link_flap_max_suppress_s)};
+  }
+
   // Create link monitor instance.
-  auto linkMonitor = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "LinkMonitor",
-      std::make_unique<LinkMonitor>(
-          context,
-          FLAGS_node_name,
-          FLAGS_system_agent_port,
-          KvStoreLocalCmdUrl{kvStoreLocalCmdUrl},
-          KvStoreLocalPubUrl{kvStoreLocalPubUrl},
-          std::move(includeRegexList),
-          std::move(excludeRegexList),
-          std::move(redistRegexList),
-          networks,
-          FLAGS_enable_rtt_metric,
-          FLAGS_enable_perf_measurement,
-          FLAGS_enable_v4,
-          FLAGS_enable_segment_routing,
-          FLAGS_prefix_fwd_type_mpls,
-          FLAGS_prefix_algo_type_ksp2_ed_ecmp,
-          AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
-          interfaceUpdatesQueue,
-          neighborUpdatesQueue.getReader(),
-          monitorSubmitUrl,
-          configStore,
-          FLAGS_assume_drained,
-          prefixUpdatesQueue,
-          PlatformPublisherUrl{FLAGS_platform_pub_url},
-          kvHoldTime,
-          std::chrono::milliseconds(FLAGS_link_flap_initial_backoff_ms),
-          std::chrono::milliseconds(FLAGS_link_flap_max_backoff_ms),
-          std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
-          areas));
-
-  // Wait for the above two threads to start and run before running
-  // SPF in Decision module.  This is to make sure the Decision module
-  // receives itself as one of the nodes before running the spf.
+  LinkMonitor* linkMonitor{nullptr};
+  orchestrator.addStep("LinkMonitor", {"ConfigStore", "KvStore"}, [&]() {
+    linkMonitor = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "LinkMonitor",
+        std::make_unique<LinkMonitor>(
+            context,
+            FLAGS_node_name,
+            FLAGS_system_agent_port,
+            KvStoreLocalCmdUrl{kvStore->inprocCmdUrl},
+            KvStoreLocalPubUrl{kvStoreLocalPubUrl},
+            std::move(includeRegexList),
+            std::move(excludeRegexList),
+            std::move(redistRegexList),
+            networks,
+            FLAGS_enable_rtt_metric,
+            FLAGS_enable_perf_measurement,
+            FLAGS_enable_v4,
+            FLAGS_enable_segment_routing,
+            FLAGS_prefix_fwd_type_mpls,
+            FLAGS_prefix_algo_type_ksp2_ed_ecmp,
+            AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
+            interfaceUpdatesQueue,
+            linkMonitorNeighborUpdatesReader,
+            monitorSubmitUrl,
+            configStore,
+            FLAGS_assume_drained,
+            prefixUpdatesQueue,
+            PlatformPublisherUrl{FLAGS_platform_pub_url},
+            kvHoldTime,
+            std::chrono::milliseconds(FLAGS_link_flap_initial_backoff_ms),
+            std::chrono::milliseconds(FLAGS_link_flap_max_backoff_ms),
+            std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
+            areas,
+            flapDampeningConfig));
+  });
 
   folly::Optional<std::chrono::seconds> decisionGRWindow{folly::none};
   if (FLAGS_decision_graceful_restart_window_s >= 0) {
     decisionGRWindow =
         std::chrono::seconds(FLAGS_decision_graceful_restart_window_s);
   }
-  // Start Decision Module
-  auto decision = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "Decision",
-      std::make_unique<Decision>(
-          FLAGS_node_name,
-          FLAGS_enable_v4,
-          FLAGS_enable_lfa,
-          FLAGS_enable_ordered_fib_programming,
-          not FLAGS_enable_bgp_route_programming,
-          FLAGS_bgp_use_igp_metric,
-          AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
-          PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
-          std::chrono::milliseconds(FLAGS_decision_debounce_min_ms),
-          std::chrono::milliseconds(FLAGS_decision_debounce_max_ms),
-          decisionGRWindow,
-          kvStoreUpdatesQueue.getReader(),
-          routeUpdatesQueue,
-          monitorSubmitUrl,
-          context));
+
+  // Limits on the prefixes decision computes routes for
+  PrefixLimits prefixLimits;
+  prefixLimits.maxPrefixesPerNode =
+      std::max(0, FLAGS_decision_max_prefixes_per_node);
+  prefixLimits.maxPrefixes = std::max(0, FLAGS_decision_max_prefixes);
+  prefixLimits.minV4Length =
+      std::min(std::max(0, FLAGS_decision_min_v4_prefix_length), 32);
+  prefixLimits.maxV4Length =
+      std::min(std::max(0, FLAGS_decision_max_v4_prefix_length), 32);
+  prefixLimits.minV6Length =
+      std::min(std::max(0, FLAGS_decision_min_v6_prefix_length), 128);
+  prefixLimits.maxV6Length =
+      std::min(std::max(0, FLAGS_decision_max_v6_prefix_length), 128);
+  auto parsePrefixTypes = [](const std::string& flag,
+                             std::vector<thrift::PrefixType>& types) {
+    std::vector<std::string> typeNames;
+    folly::split(",", flag, typeNames, true /* ignore empty */);
+    for (auto const& typeName : typeNames) {
+      thrift::PrefixType type;
+      if (not apache::thrift::TEnumTraits<thrift::PrefixType>::findValue(
+              typeName.c_str(), &type)) {
+        LOG(ERROR) << "Invalid prefix type '" << typeName << "'";
+        return false;
+      }
+      types.emplace_back(type);
+    }
+    return true;
+  };
+  std::vector<thrift::PrefixType> allowedPrefixTypes;
+  if (not parsePrefixTypes(
+          FLAGS_decision_allowed_prefix_types, allowedPrefixTypes) or
+      not parsePrefixTypes(
+          FLAGS_decision_prefix_type_priorities,
+          prefixLimits.typePriorities)) {
+    return -1;
+  }
+  prefixLimits.allowedTypes.insert(
+      allowedPrefixTypes.begin(), allowedPrefixTypes.end());
+
+  // Start Decision Module after KvStore and LinkMonitor. This is to make sure
+  // the Decision module receives itself as one of the nodes before running
+  // the spf.
+  Decision* decision{nullptr};
+  orchestrator.addStep("Decision", {"KvStore", "LinkMonitor"}, [&]() {
+    decision = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "Decision",
+        std::make_unique<Decision>(
+            FLAGS_node_name,
+            FLAGS_enable_v4,
+            FLAGS_enable_lfa,
+            FLAGS_enable_ordered_fib_programming,
+            not FLAGS_enable_bgp_route_programming,
+            FLAGS_bgp_use_igp_metric,
+            AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
+            PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+            std::chrono::milliseconds(FLAGS_decision_debounce_min_ms),
+            std::chrono::milliseconds(FLAGS_decision_debounce_max_ms),
+            decisionGRWindow,
+            decisionKvStoreUpdatesReader,
+            routeUpdatesQueue,
+            monitorSubmitUrl,
+            context,
+            std::max(1, FLAGS_decision_route_build_threads),
+            FLAGS_decision_async_route_compute,
+            std::max(0, FLAGS_route_trace_buffer_size),
+            std::min(100, std::max(0, FLAGS_decision_compute_duty_cycle_pct)) /
+                100.0,
+            prefixLimits,
+            FLAGS_decision_snapshot_filepath,
+            std::chrono::seconds(FLAGS_decision_snapshot_interval_s),
+            &runtimeKnobs));
+  });
 
   // FIB ordering works only in single area configuration
   // verify 'default area' is configured and it's the only one configured
@@ -783,33 +1110,99 @@ main(int argc, char** argv) {
     CHECK_EQ(areas.count(openr::thrift::KvStore_constants::kDefaultArea()), 1);
     CHECK_EQ(areas.size(), 1);
   }
+
+  // Routes within these prefixes are programmed first
+  std::vector<openr::thrift::IpPrefix> fibPriorityPrefixes;
+  try {
+    std::vector<std::string> prefixes;
+    folly::split(
+        ",", FLAGS_fib_priority_prefixes, prefixes, true /* ignore empty */);
+    for (auto const& prefix : prefixes) {
+      fibPriorityPrefixes.emplace_back(
+          toIpPrefix(folly::IPAddress::createNetwork(prefix)));
+    }
+  } catch (std::exception const& err) {
+    LOG(ERROR) << "Invalid Fib priority prefixes. Expected comma separated "
+               << "list of IP/CIDR format, got '"
+               << FLAGS_fib_priority_prefixes << "'";
+    return -1;
+  }
+
   // Define and start Fib Module
-  auto fib = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "Fib",
-      std::make_unique<Fib>(
-          FLAGS_node_name,
-          FLAGS_fib_handler_port,
-          FLAGS_dryrun,
-          FLAGS_enable_segment_routing,
-          FLAGS_enable_ordered_fib_programming,
-          std::chrono::seconds(3 * FLAGS_spark_keepalive_time_s),
-          decisionGRWindow.hasValue(), /* waitOnDecision */
-          routeUpdatesQueue.getReader(),
-          interfaceUpdatesQueue.getReader(),
-          monitorSubmitUrl,
-          kvStoreLocalCmdUrl,
-          kvStoreLocalPubUrl,
-          context));
+  FibBatcher::Config fibBatcherConfig;
+  fibBatcherConfig.maxBatchSize = std::max(0, FLAGS_fib_batch_max_routes);
+  fibBatcherConfig.minBatchSize = std::max(1, FLAGS_fib_batch_min_routes);
+  if (fibBatcherConfig.maxBatchSize) {
+    fibBatcherConfig.minBatchSize = std::min(
+        fibBatcherConfig.minBatchSize, fibBatcherConfig.maxBatchSize);
+  }
+  fibBatcherConfig.maxConcurrency =
+      std::max(1, FLAGS_fib_batch_max_concurrency);
+  fibBatcherConfig.targetLatency =
+      std::chrono::milliseconds(std::max(1, FLAGS_fib_batch_target_latency_ms));
+  Fib* fib{nullptr};
+  orchestrator.addStep("Fib", {"FibService", "KvStore"}, [&]() {
+    fib = startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        "Fib",
+        std::make_unique<Fib>(
+            FLAGS_node_name,
+            FLAGS_fib_handler_port,
+            FLAGS_dryrun,
+            FLAGS_enable_segment_routing,
+            FLAGS_enable_ordered_fib_programming,
+            std::chrono::seconds(3 * FLAGS_spark_keepalive_time_s),
+            decisionGRWindow.hasValue(), /* waitOnDecision */
+            fibRouteUpdatesReader,
+            fibInterfaceUpdatesReader,
+            monitorSubmitUrl,
+            KvStoreLocalCmdUrl{kvStore->inprocCmdUrl},
+            kvStoreLocalPubUrl,
+            context,
+            FLAGS_fib_prioritize_host_routes,
+            fibPriorityPrefixes,
+            std::max(0, FLAGS_route_trace_buffer_size),
+            FLAGS_fib_warm_boot,
+            std::max(0, FLAGS_convergence_trace_buffer_size),
+            std::max(1, FLAGS_convergence_trace_sample_rate),
+            FLAGS_fib_route_export_path,
+            fibBatcherConfig,
+            &runtimeKnobs,
+            FLAGS_fib_prune_failed_neighbors
+                ? folly::make_optional(
+                      PlatformPublisherUrl{FLAGS_platform_pub_url})
+                : folly::none));
+  });
+
+  // Restore the runtime knobs persisted through OpenrCtrl, once the modules
+  // registered theirs
+  orchestrator.addStep(
+      "RuntimeKnobs",
+      {"ConfigStore", "Decision", "Fib", "KvStore", "Spark"},
+      [&]() {
+        auto values =
+            configStore
+                ->loadThriftObj<openr::thrift::RuntimeKnobValues>(
+                    Constants::kRuntimeKnobsConfigKey.toString())
+                .get();
+        if (values.hasValue()) {
+          LOG(INFO) << "Restored " << runtimeKnobs.restore(values.value())
+                    << " persisted runtime knobs";
+        }
+      });
 
   // Start OpenrCtrl thrift server
   apache::thrift::ThriftServer thriftCtrlServer;
 
-  // setup the SSL policy
+  // setup the SSL policy. Loading certificates and ticket seeds doesn't depend
+  // on any module
   std::shared_ptr<wangle::SSLContextConfig> sslContext;
-  if (FLAGS_enable_secure_thrift_server) {
+  orchestrator.addStep("CtrlServerTls", {}, [&]() {
+    if (not FLAGS_enable_secure_thrift_server) {
+      return;
+    }
     CHECK(fileExists(FLAGS_x509_ca_path));
     CHECK(fileExists(FLAGS_x509_cert_path));
     auto& keyPath = FLAGS_x509_key_path;
@@ -833,7 +1226,7 @@ main(int argc, char** argv) {
         apache::thrift::SSLPolicy::PERMITTED,
         FLAGS_tls_ticket_seed_path,
         sslContext);
-  }
+  });
   // set the port and interface
   thriftCtrlServer.setPort(FLAGS_openr_ctrl_port);
 
@@ -848,43 +1241,92 @@ main(int argc, char** argv) {
     acceptableNamesSet.insert(acceptableNames.begin(), acceptableNames.end());
   }
 
-  auto ctrlHandler = std::make_shared<openr::OpenrCtrlHandler>(
-      FLAGS_node_name,
-      acceptableNamesSet,
-      decision,
-      fib,
-      kvStore,
-      linkMonitor,
-      configStore,
-      prefixManager,
-      monitorSubmitUrl,
-      kvStoreLocalPubUrl,
-      mainEventLoop,
-      context);
-
-  thriftCtrlServer.setInterface(ctrlHandler);
   thriftCtrlServer.setNumIOWorkerThreads(1);
-  // Intentionally kept this as (1). If you're changing to higher number please
-  // address thread safety for private member variables in OpenrCtrlHandler
-  thriftCtrlServer.setNumCPUWorkerThreads(1);
+  // Methods are served by a bounded pool of their priority, as annotated in
+  // OpenrCtrl.thrift, so that monitoring dumps can't starve the control plane
+  std::array<size_t, apache::thrift::concurrency::N_PRIORITIES>
+      ctrlThreadCounts;
+  ctrlThreadCounts[apache::thrift::concurrency::HIGH_IMPORTANT] = 1;
+  ctrlThreadCounts[apache::thrift::concurrency::HIGH] =
+      std::max(1, FLAGS_ctrl_server_high_priority_threads);
+  ctrlThreadCounts[apache::thrift::concurrency::IMPORTANT] =
+      std::max(1, FLAGS_ctrl_server_normal_priority_threads);
+  ctrlThreadCounts[apache::thrift::concurrency::NORMAL] =
+      std::max(1, FLAGS_ctrl_server_normal_priority_threads);
+  ctrlThreadCounts[apache::thrift::concurrency::BEST_EFFORT] =
+      std::max(1, FLAGS_ctrl_server_best_effort_threads);
+  auto ctrlThreadMgr =
+      apache::thrift::concurrency::PriorityThreadManager::
+          newPriorityThreadManager(
+              ctrlThreadCounts,
+              false /* task stats */,
+              std::max(0, FLAGS_ctrl_server_max_queued_requests));
+  ctrlThreadMgr->setNamePrefix("CtrlServerCpu");
+  ctrlThreadMgr->start();
+  if (watchdog) {
+    watchdog->addThreadPool("CtrlServer", "CtrlServerCpu");
+  }
+  thriftCtrlServer.setThreadManager(ctrlThreadMgr);
   // Enable TOS reflection on the server socket
   thriftCtrlServer.setTosReflect(true);
 
-  // serve
-  allThreads.emplace_back(std::thread([&thriftCtrlServer]() noexcept {
-    LOG(INFO) << "Starting thriftCtrlServer thread ...";
-    folly::setThreadName("thriftCtrlServer");
-    thriftCtrlServer.serve();
-    LOG(INFO) << "thriftCtrlServer thread got stopped.";
-  }));
+  // The ctrl handler exposes all modules, serve once all of them are running
+  const std::vector<std::string> ctrlServerDependencies{"CtrlServerTls",
+                                                        "ConfigStore",
+                                                        "Decision",
+                                                        "Fib",
+                                                        "KvStore",
+                                                        "LinkMonitor",
+                                                        "Monitor",
+                                                        "PrefixManager",
+                                                        "RuntimeKnobs"};
+  orchestrator.addStep("CtrlServer", ctrlServerDependencies, [&]() {
+    auto ctrlHandler = std::make_shared<openr::OpenrCtrlHandler>(
+        FLAGS_node_name,
+        acceptableNamesSet,
+        decision,
+        fib,
+        kvStore,
+        linkMonitor,
+        configStore,
+        prefixManager,
+        monitorSubmitUrl,
+        kvStoreLocalPubUrl,
+        mainEventLoop,
+        context,
+        &runtimeKnobs);
+    thriftCtrlServer.setInterface(ctrlHandler);
+
+    // serve
+    addThread(allThreads, std::thread([&thriftCtrlServer]() noexcept {
+      LOG(INFO) << "Starting thriftCtrlServer thread ...";
+      folly::setThreadName("thriftCtrlServer");
+      // Threads spawned by serve() inherit the placement
+      placeThread("CtrlServer");
+      thriftCtrlServer.serve();
+      LOG(INFO) << "thriftCtrlServer thread got stopped.";
+    }));
+  });
 
   // Call external module for platform specific implementations
   if (FLAGS_enable_plugin) {
-    pluginStart(PluginArgs{FLAGS_node_name,
-                           prefixUpdatesQueue,
-                           routeUpdatesQueue.getReader(),
-                           FLAGS_prefix_algo_type_ksp2_ed_ecmp,
-                           sslContext});
+    orchestrator.addStep("Plugin", {"CtrlServer"}, [&]() {
+      pluginStart(PluginArgs{FLAGS_node_name,
+                             prefixUpdatesQueue,
+                             routeUpdatesQueue.getReader("plugin"),
+                             FLAGS_prefix_algo_type_ksp2_ed_ecmp,
+                             sslContext});
+    });
+  }
+
+  // Start all modules
+  try {
+    orchestrator.run();
+  } catch (std::exception const& e) {
+    LOG(FATAL) << "Failed to start modules: " << folly::exceptionStr(e);
+  }
+  for (auto const& event : sprintPerfEvents(orchestrator.getPerfEvents())) {
+    LOG(INFO) << event;
   }
 
   // Wait for main-event loop to return
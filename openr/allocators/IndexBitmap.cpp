@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IndexBitmap.h"
+
+#include <folly/Bits.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+constexpr uint64_t kWordBits{64};
+
+} // namespace
+
+IndexBitmap::IndexBitmap(uint64_t size)
+    : words_((size + kWordBits - 1) / kWordBits, 0), size_(size) {}
+
+void
+IndexBitmap::set(uint64_t index) {
+  CHECK_LT(index, size_);
+  auto& word = words_[index / kWordBits];
+  const uint64_t bit = uint64_t(1) << (index % kWordBits);
+  if (not(word & bit)) {
+    word |= bit;
+    ++numUsed_;
+  }
+}
+
+bool
+IndexBitmap::test(uint64_t index) const {
+  CHECK_LT(index, size_);
+  return words_[index / kWordBits] & (uint64_t(1) << (index % kWordBits));
+}
+
+uint64_t
+IndexBitmap::getFreeBits(size_t i) const {
+  uint64_t freeBits = ~words_[i];
+  const uint64_t tail = size_ - i * kWordBits;
+  if (tail < kWordBits) {
+    freeBits &= (uint64_t(1) << tail) - 1;
+  }
+  return freeBits;
+}
+
+folly::Optional<uint64_t>
+IndexBitmap::selectFree(uint64_t rank) const {
+  if (rank >= getNumFree()) {
+    return folly::none;
+  }
+  for (size_t i = 0; i < words_.size(); ++i) {
+    uint64_t freeBits = getFreeBits(i);
+    const uint64_t numFree = folly::popcount(freeBits);
+    if (rank >= numFree) {
+      rank -= numFree;
+      continue;
+    }
+    // clear the lower free bits of the word up to the one we select
+    for (; rank > 0; --rank) {
+      freeBits &= freeBits - 1;
+    }
+    return i * kWordBits + folly::findFirstSet(freeBits) - 1;
+  }
+  return folly::none;
+}
+
+folly::Optional<uint64_t>
+IndexBitmap::findFree(uint64_t start) const {
+  if (getNumFree() == 0) {
+    return folly::none;
+  }
+  CHECK_LT(start, size_);
+  const size_t first = start / kWordBits;
+  // the word of start, ignoring free bits before start
+  uint64_t freeBits =
+      getFreeBits(first) & (~uint64_t(0) << (start % kWordBits));
+  for (size_t n = 0; n <= words_.size(); ++n) {
+    const size_t i = (first + n) % words_.size();
+    if (n > 0) {
+      freeBits = getFreeBits(i);
+    }
+    if (freeBits) {
+      return i * kWordBits + folly::findFirstSet(freeBits) - 1;
+    }
+  }
+  return folly::none;
+}
+
+} // namespace openr
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+/**
+ * Compact set of used indices in [0, size), one bit per index. Free indices
+ * are searched a word at a time, with find-first-set to find the next one and
+ * popcount to select one by rank.
+ */
+class IndexBitmap {
+ public:
+  explicit IndexBitmap(uint64_t size);
+
+  // mark index as used
+  void set(uint64_t index);
+
+  bool test(uint64_t index) const;
+
+  uint64_t
+  size() const {
+    return size_;
+  }
+
+  uint64_t
+  getNumFree() const {
+    return size_ - numUsed_;
+  }
+
+  // free index of the given rank among all free ones, in increasing order.
+  // none if there are no more free indices than rank
+  folly::Optional<uint64_t> selectFree(uint64_t rank) const;
+
+  // first free index at or after start, wrapping around. none if all
+  // indices are used
+  folly::Optional<uint64_t> findFree(uint64_t start) const;
+
+ private:
+  // bits of free indices in word i, bits past size_ are not free
+  uint64_t getFreeBits(size_t i) const;
+
+  std::vector<uint64_t> words_;
+  const uint64_t size_{0};
+  uint64_t numUsed_{0};
+};
+
+} // namespace openr
@@ -438,7 +438,7 @@ PrefixAllocator::savePrefixIndexToDisk(folly::Optional<uint32_t> prefixIndex) {
   configStore_->storeThriftObj(kConfigKey, thriftAllocPrefix).get();
 }
 
-uint32_t
+folly::Optional<uint32_t>
 PrefixAllocator::getInitPrefixIndex() {
   // initialize my prefix per the following preferrence:
   // from file > from kvstore > generate new
@@ -458,16 +458,10 @@ PrefixAllocator::getInitPrefixIndex() {
     return kvstorePrefixIndex.value();
   }
 
-  // Generate a new random prefix index
-  if (allocParams_.hasValue()) {
-    uint32_t hashPrefixIndex =
-        hasher(myNodeName_) % getPrefixCount(*allocParams_);
-    LOG(INFO) << "Generate new initial prefix index: " << hashPrefixIndex;
-    return hashPrefixIndex;
-  }
-
-  // `0` is always a valid index in valid range
-  return 0;
+  // Range allocator picks a new prefix index by hash of our node name, among
+  // the ones not allocated yet
+  LOG(INFO) << "Generate new initial prefix index";
+  return folly::none;
 }
 
 void
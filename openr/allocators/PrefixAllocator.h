@@ -133,8 +133,8 @@ class PrefixAllocator : public OpenrEventBase {
   // save newly elected prefix index to disk
   void savePrefixIndexToDisk(folly::Optional<uint32_t> prefixIndex);
 
-  // initialize my prefix
-  uint32_t getInitPrefixIndex();
+  // initialize my prefix, none to let range allocator pick a new one
+  folly::Optional<uint32_t> getInitPrefixIndex();
 
   // start allocating prefixes, can be called again with new prefix
   // or `folly::none` if seed prefix is no longer valid to withdraw
@@ -201,9 +201,6 @@ class PrefixAllocator : public OpenrEventBase {
   // Sync interval for range allocator
   const std::chrono::milliseconds syncInterval_;
 
-  // hash node ID into prefix space
-  const std::hash<std::string> hasher{};
-
   //
   // Non-const private variables
   //
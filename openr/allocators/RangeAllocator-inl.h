@@ -114,10 +114,20 @@ RangeAllocator<T>::startAllocator(
                  << ", ussing upper bound instead";
       initValue = allocRange_.second;
     }
-  } else {
-    initValue = allocRange_.first;
   }
   allocRangeSize_ = allocRange_.second - allocRange_.first + 1;
+  if (not maybeInitValue.hasValue()) {
+    // avoid values claimed already, and spread nodes starting at the same
+    // time across the free ones
+    folly::Optional<T> maybeFreeValue;
+    const auto maybeKeyMap =
+        kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
+    if (maybeKeyMap) {
+      maybeFreeValue =
+          pickFreeValue(*maybeKeyMap, std::hash<std::string>()(nodeName_));
+    }
+    initValue = maybeFreeValue.value_or(allocRange_.first);
+  }
 
   // Subscribe to changes in KvStore
   VLOG(2) << "RangeAllocator: Created. Scheduling first tryAllocate. "
@@ -254,11 +264,20 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
 
   // Use random value selection logic based on seedVal
   std::mt19937_64 gen(seedVal + folly::Random::rand64());
-  std::uniform_int_distribution<T> dist(allocRange_.first, allocRange_.second);
-  auto newVal = dist(gen);
 
   const auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
   CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
+
+  // pick a random one among the values we may own
+  const auto maybeFreeValue = pickFreeValue(*maybeKeyMap, gen());
+  if (maybeFreeValue.hasValue()) {
+    allocateValue_ = maybeFreeValue.value();
+    timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+    return;
+  }
+
+  std::uniform_int_distribution<T> dist(allocRange_.first, allocRange_.second);
+  auto newVal = dist(gen);
   const auto valOwners =
       folly::gen::from(*maybeKeyMap) |
       folly::gen::map([](std::pair<std::string, thrift::Value> const& kv) {
@@ -292,6 +311,47 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
   timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
 }
 
+template <typename T>
+folly::Optional<T>
+RangeAllocator<T>::pickFreeValue(
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    uint64_t hash) const {
+  // allocRangeSize_ is 0 if the range is all values of T
+  if (allocRangeSize_ == 0 or
+      static_cast<uint64_t>(allocRangeSize_) >
+          Constants::kRangeAllocMaxBitmapSize) {
+    return folly::none;
+  }
+
+  IndexBitmap usedValues(allocRangeSize_);
+  for (auto const& kv : keyVals) {
+    if (not kv.second.value.hasValue()) {
+      continue;
+    }
+    const auto val = details::binaryToPrimitive<T>(kv.second.value.value());
+    if (val < allocRange_.first or val > allocRange_.second) {
+      continue;
+    }
+    // owned by lower originator and override is allowed
+    if (overrideOwner_ and nodeName_ >= kv.second.originatorId) {
+      continue;
+    }
+    usedValues.set(val - allocRange_.first);
+  }
+
+  // values in use otherwise are found one at a time
+  while (usedValues.getNumFree() > 0) {
+    const auto offset =
+        usedValues.selectFree(hash % usedValues.getNumFree()).value();
+    const T val = allocRange_.first + offset;
+    if (not checkValueInUseCb_ or not checkValueInUseCb_(val)) {
+      return val;
+    }
+    usedValues.set(offset);
+  }
+  return folly::none;
+}
+
 template <typename T>
 void
 RangeAllocator<T>::keyValUpdated(
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <random>
 #include <string>
+#include <unordered_map>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <folly/Format.h>
@@ -17,6 +18,7 @@
 #include <folly/Random.h>
 #include <folly/gen/Base.h>
 
+#include <openr/allocators/IndexBitmap.h>
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
@@ -36,7 +38,8 @@ class RangeAllocator {
    * bus.
    *
    * Idea:
-   * - Generate a random value to be claimed
+   * - Generate a random value to be claimed, among the ones not claimed yet
+   *   as far as we know
    * - Try electing it via KvStore. Higher originatorId wins.
    * - If we fail we should try again with another random number
    * - To ease up re-tries we use ExponentialBackoff
@@ -64,7 +67,8 @@ class RangeAllocator {
    * user must call this to start allocation
    * range and initial value may be unknown during construction
    * allocRange: the range from which to allocate values (range is inclusive)
-   * initValue: must be in allocRange
+   * initValue: must be in allocRange. Without one, a value not claimed yet is
+   * picked by hash of the node name
    */
   void startAllocator(
       const std::pair<T /* min */, T /* max */> allocRange,
@@ -111,6 +115,15 @@ class RangeAllocator {
    */
   void scheduleAllocate(const T seedVal) noexcept;
 
+  /**
+   * Pick a value we may own, given the claimed values in keyVals. Values are
+   * picked from a bitmap of the ones we can't own, by hash among the others.
+   * none if there are none, or if the range is too large for a bitmap
+   */
+  folly::Optional<T> pickFreeValue(
+      std::unordered_map<std::string, thrift::Value> const& keyVals,
+      uint64_t hash) const;
+
   /* Invoked whenever there is an update for our currently allocated value
    */
   void keyValUpdated(
@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef RANGE_BATCH_ALLOCATOR_H_
+#error This file may only be included from RangeBatchAllocator.h
+#endif
+
+////////// Implementation details for RangeBatchAllocator.h /////////////
+
+namespace openr {
+
+template <typename T>
+RangeBatchAllocator<T>::RangeBatchAllocator(
+    const std::string& nodeName,
+    const std::string& keyPrefix,
+    KvStoreClient* const kvStoreClient,
+    std::function<void(folly::Optional<std::set<T>>)> callback,
+    const size_t numValues,
+    const std::chrono::milliseconds minBackoffDur /* = 50ms */,
+    const std::chrono::milliseconds maxBackoffDur /* = 2s */,
+    const bool overrideOwner /* = true */,
+    const std::function<bool(T)> checkValueInUseCb,
+    const std::chrono::milliseconds rangeAllocTtl,
+    const std::string& area)
+    : nodeName_(nodeName),
+      keyPrefix_(keyPrefix),
+      kvStoreClient_(kvStoreClient),
+      eventBase_(kvStoreClient->getOpenrEventBase()),
+      callback_(std::move(callback)),
+      numValues_(numValues),
+      overrideOwner_(overrideOwner),
+      backoff_(minBackoffDur, maxBackoffDur),
+      checkValueInUseCb_(std::move(checkValueInUseCb)),
+      rangeAllocTtl_(rangeAllocTtl),
+      area_(area) {
+  CHECK_LT(0, numValues_) << "Nothing to allocate";
+  timeout_ = fbzmq::ZmqTimeout::make(
+      eventBase_->getEvb(), [this]() mutable noexcept { tryAllocate(); });
+}
+
+template <typename T>
+RangeBatchAllocator<T>::~RangeBatchAllocator() {
+  VLOG(2) << "RangeBatchAllocator: Destructing " << nodeName_ << ", "
+          << keyPrefix_;
+  // We need to cancel any pending timeout
+  timeout_.reset();
+
+  // Unsubscribe from KvStoreClient for all the values we have been to
+  for (auto const* vals : {&myValues_, &myRequestedValues_}) {
+    for (auto const val : *vals) {
+      const auto key = createKey(val);
+      kvStoreClient_->unsubscribeKey(key);
+      kvStoreClient_->unsetKey(key, area_);
+    }
+  }
+}
+
+template <typename T>
+std::string
+RangeBatchAllocator<T>::createKey(const T val) const noexcept {
+  return folly::sformat("{}{}", keyPrefix_, val);
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::startAllocator(
+    const std::pair<T, T> allocRange, const std::vector<T>& initValues) {
+  CHECK(not hasStarted_) << "Already started";
+  hasStarted_ = true;
+
+  allocRange_ = allocRange;
+  CHECK_LE(allocRange_.first, allocRange_.second) << "Invalid range.";
+  // 0 if the range is all values of a 64 bits T
+  allocRangeSize_ = static_cast<uint64_t>(allocRange_.second) -
+      static_cast<uint64_t>(allocRange_.first) + 1;
+  CHECK(
+      allocRangeSize_ != 0 and
+      allocRangeSize_ <= Constants::kRangeAllocMaxBitmapSize)
+      << "Range too large for batch allocation";
+  CHECK_LE(numValues_, allocRangeSize_) << "Range too small for all values";
+  initValues_ = initValues;
+
+  VLOG(2) << "RangeBatchAllocator: Created. Scheduling first tryAllocate. "
+          << "Node: " << nodeName_ << ", Prefix: " << keyPrefix_;
+  timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+}
+
+template <typename T>
+std::set<T>
+RangeBatchAllocator<T>::getValuesFromKvStore() const {
+  const auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
+  CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
+  std::set<T> vals;
+  for (const auto& kv : *maybeKeyMap) {
+    if (kv.second.originatorId == nodeName_) {
+      const auto val = details::binaryToPrimitive<T>(kv.second.value.value());
+      CHECK_EQ(kv.first, createKey(val));
+      vals.emplace(val);
+    }
+  }
+  return vals;
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::tryAllocate() noexcept {
+  const size_t numMissing =
+      numValues_ - myValues_.size() - myRequestedValues_.size();
+  const uint64_t hash = isFirstRound_ ? std::hash<std::string>()(nodeName_)
+                                      : folly::Random::rand64();
+  isFirstRound_ = false;
+  if (numMissing == 0) {
+    return;
+  }
+
+  VLOG(1) << "RangeBatchAllocator " << nodeName_ << ": trying to allocate "
+          << numMissing << " values";
+
+  // One dump tells both which values are free and which ones we may own
+  const auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
+  CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
+
+  std::unordered_map<std::string, thrift::Value> keyVals;
+  bool hasAdopted{false};
+
+  // We own some values already: this can occur if the node reboots w/
+  // kvstore intact. We set them back so that ttl is published regularly
+  for (auto const& kv : *maybeKeyMap) {
+    if (keyVals.size() == numMissing) {
+      break;
+    }
+    if (kv.second.originatorId != nodeName_ or
+        not kv.second.value.hasValue()) {
+      continue;
+    }
+    const auto val = details::binaryToPrimitive<T>(kv.second.value.value());
+    if (val < allocRange_.first or val > allocRange_.second or
+        myValues_.count(val) or myRequestedValues_.count(val) or
+        (checkValueInUseCb_ and checkValueInUseCb_(val))) {
+      continue;
+    }
+    auto newValue = kv.second;
+    newValue.ttlVersion += 1; // bump ttl version
+    newValue.ttl = rangeAllocTtl_.count(); // reset ttl
+    keyVals.emplace(kv.first, std::move(newValue));
+    myValues_.emplace(val);
+    hasAdopted = true;
+  }
+
+  // Either no one owns the others or owner has lower originator ID
+  const auto newVals =
+      pickFreeValues(*maybeKeyMap, numMissing - keyVals.size(), hash);
+  initValues_.clear();
+  for (auto const newVal : newVals) {
+    const auto newKey = createKey(newVal);
+    const auto it = maybeKeyMap->find(newKey);
+    const auto ttlVersion =
+        it != maybeKeyMap->end() ? it->second.ttlVersion + 1 : 0;
+    keyVals.emplace(
+        newKey,
+        thrift::Value(
+            apache::thrift::FRAGILE,
+            1 /* version */,
+            nodeName_ /* originatorId */,
+            details::primitiveToBinary(newVal) /* value */,
+            rangeAllocTtl_.count() /* ttl */,
+            ttlVersion /* ttl version */,
+            0 /* hash */));
+    myRequestedValues_.emplace(newVal);
+  }
+
+  // Claim all of them at once, in a single publication
+  const auto ret = kvStoreClient_->setKeys(keyVals, area_);
+  CHECK(ret) << ret.error();
+
+  // Subscribe to updates of all new keys
+  for (auto const& kv : keyVals) {
+    kvStoreClient_->subscribeKey(
+        kv.first,
+        [this](
+            const std::string& key,
+            folly::Optional<thrift::Value> thriftVal) noexcept {
+          if (thriftVal.hasValue()) {
+            keyValUpdated(key, thriftVal.value());
+          }
+        },
+        false,
+        area_);
+  }
+
+  if (hasAdopted and myValues_.size() == numValues_) {
+    // Let the application know of newly allocated values
+    callback_(myValues_);
+    backoff_.reportSuccess();
+  }
+
+  if (keyVals.size() < numMissing) {
+    LOG(ERROR) << "RangeBatchAllocator " << nodeName_ << ": only "
+               << keyVals.size() << " of " << numMissing
+               << " missing values may be owned";
+    scheduleAllocate();
+  }
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::scheduleAllocate() noexcept {
+  // values lost meanwhile are picked again in the scheduled round
+  if (timeout_->isScheduled()) {
+    return;
+  }
+
+  // Apply exponential backoff
+  backoff_.reportError();
+  timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+}
+
+template <typename T>
+std::vector<T>
+RangeBatchAllocator<T>::pickFreeValues(
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    size_t count,
+    uint64_t hash) const {
+  const auto toOffset = [this](T val) {
+    return static_cast<uint64_t>(val) -
+        static_cast<uint64_t>(allocRange_.first);
+  };
+
+  IndexBitmap usedValues(allocRangeSize_);
+  for (auto const& kv : keyVals) {
+    if (not kv.second.value.hasValue()) {
+      continue;
+    }
+    const auto val = details::binaryToPrimitive<T>(kv.second.value.value());
+    if (val < allocRange_.first or val > allocRange_.second) {
+      continue;
+    }
+    // owned by lower originator and override is allowed
+    if (overrideOwner_ and nodeName_ >= kv.second.originatorId) {
+      continue;
+    }
+    usedValues.set(toOffset(val));
+  }
+  for (auto const* vals : {&myValues_, &myRequestedValues_}) {
+    for (auto const val : *vals) {
+      usedValues.set(toOffset(val));
+    }
+  }
+
+  std::vector<T> newVals;
+  // values in use otherwise are found one at a time
+  const auto pickValue = [&](uint64_t offset) {
+    usedValues.set(offset);
+    const T val = static_cast<T>(allocRange_.first + offset);
+    if (not checkValueInUseCb_ or not checkValueInUseCb_(val)) {
+      newVals.emplace_back(val);
+    }
+  };
+
+  for (auto const val : initValues_) {
+    if (newVals.size() == count) {
+      return newVals;
+    }
+    if (val < allocRange_.first or val > allocRange_.second or
+        usedValues.test(toOffset(val))) {
+      continue;
+    }
+    pickValue(toOffset(val));
+  }
+
+  std::mt19937_64 gen(hash);
+  while (newVals.size() < count and usedValues.getNumFree() > 0) {
+    pickValue(usedValues.selectFree(gen() % usedValues.getNumFree()).value());
+  }
+  return newVals;
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::keyValUpdated(
+    const std::string& key, const thrift::Value& thriftVal) noexcept {
+  const T val = details::binaryToPrimitive<T>(thriftVal.value.value());
+
+  // Some sanity checks
+  CHECK_EQ(1, thriftVal.version);
+  // only subscribed to requested/allocated values change
+  CHECK(myValues_.count(val) or myRequestedValues_.count(val));
+
+  // an intermediate originator overrode a lower one before ours did, wait
+  // for key update with my id or even higher id
+  if (thriftVal.originatorId < nodeName_) {
+    return;
+  }
+
+  if (nodeName_ == thriftVal.originatorId) {
+    // echo of a value we hold already
+    if (myRequestedValues_.erase(val) == 0) {
+      return;
+    }
+    VLOG(3) << "RangeBatchAllocator " << nodeName_ << ": Won " << val;
+    myValues_.emplace(val);
+    if (myValues_.size() == numValues_) {
+      // Let the application know of newly allocated values
+      callback_(myValues_);
+      // Clear backoff
+      backoff_.reportSuccess();
+    }
+    return;
+  }
+
+  // We lost the currently trying value or an allocated value
+  VLOG(3) << "RangeBatchAllocator " << nodeName_ << ": Lost " << val
+          << " with battle against " << thriftVal.originatorId;
+
+  // Let user know of withdrawal if all values have been allocated before
+  if (myValues_.count(val)) {
+    CHECK_LT(nodeName_, thriftVal.originatorId)
+        << "Lost to higher originatorId";
+    if (myValues_.size() == numValues_) {
+      callback_(folly::none);
+    }
+    myValues_.erase(val);
+  }
+  myRequestedValues_.erase(val);
+
+  // Unsubscribe to update of lost value
+  kvStoreClient_->unsubscribeKey(key);
+  kvStoreClient_->unsetKey(key, area_);
+  // Pick a new value with all the others lost meanwhile
+  scheduleAllocate();
+}
+
+} // namespace openr
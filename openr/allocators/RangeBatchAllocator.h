@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fbzmq/async/ZmqTimeout.h>
+#include <folly/Format.h>
+#include <folly/Optional.h>
+#include <folly/Random.h>
+
+#include <openr/allocators/IndexBitmap.h>
+#include <openr/allocators/RangeAllocator.h>
+#include <openr/common/ExponentialBackoff.h>
+#include <openr/common/OpenrEventBase.h>
+#include <openr/if/gen-cpp2/KvStore_constants.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/KvStoreClient.h>
+
+namespace openr {
+
+template <typename T = uint32_t>
+class RangeBatchAllocator {
+ public:
+  static_assert(std::is_integral<T>::value, "T is not an integral type");
+
+  /**
+   * RangeBatchAllocator elects numValues unique values from within the range,
+   * like as many RangeAllocators would, but contending for all of them at
+   * once.
+   *
+   * Values are claimed with the same keys as RangeAllocator, one per value,
+   * so both may share a key prefix. Each allocation round:
+   * - dumps the claimed values once and picks all the missing ones from a
+   *   bitmap of the values we can't own, by hash among the others
+   * - claims them in a single KvStore request, hence a single publication
+   * - values lost to higher originators are gathered and picked again
+   *   together in the next round, with ExponentialBackoff
+   *
+   * callback: tells you of the allocated values once all numValues of them
+   * are won, and of none when one of them is lost afterwards.
+   * The range must be small enough for a bitmap, i.e. at most
+   * Constants::kRangeAllocMaxBitmapSize values.
+   * See RangeAllocator for the other parameters.
+   */
+  RangeBatchAllocator(
+      const std::string& nodeName,
+      const std::string& keyPrefix,
+      KvStoreClient* const kvStoreClient,
+      std::function<void(folly::Optional<std::set<T>>)> callback,
+      const size_t numValues,
+      const std::chrono::milliseconds minBackoffDur =
+          std::chrono::milliseconds(50),
+      const std::chrono::milliseconds maxBackoffDur = std::chrono::seconds(2),
+      const bool overrideOwner = true,
+      const std::function<bool(T)> checkValueInUseCb = nullptr,
+      const std::chrono::milliseconds rangeAllocTtl = Constants::kRangeAllocTtl,
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
+
+  /**
+   * user must call this to start allocation
+   * allocRange: the range from which to allocate values (range is inclusive)
+   * initValues: values to try first, when they are not claimed yet. The
+   * others are picked by hash of the node name
+   */
+  void startAllocator(
+      const std::pair<T /* min */, T /* max */> allocRange,
+      const std::vector<T>& initValues = {});
+
+  /**
+   * Default destructor.
+   */
+  ~RangeBatchAllocator();
+
+  /**
+   * Allocated values stored locally, if all of them have been won
+   */
+  folly::Optional<std::set<T>>
+  getValues() const {
+    if (myValues_.size() != numValues_) {
+      return folly::none;
+    }
+    return myValues_;
+  }
+
+  // Allocated values stored in kvstore
+  std::set<T> getValuesFromKvStore() const;
+
+ private:
+  /**
+   * Non-copyable and non-movable
+   */
+  RangeBatchAllocator(RangeBatchAllocator const&) = delete;
+  RangeBatchAllocator& operator=(RangeBatchAllocator const&) = delete;
+
+  /**
+   * Invoked asynchronously to claim all the values we miss in one request.
+   * On success callback will be executed.
+   */
+  void tryAllocate() noexcept;
+
+  /**
+   * Schedule an allocation round, unless one is scheduled already
+   */
+  void scheduleAllocate() noexcept;
+
+  /**
+   * Pick up to count distinct values we may own, given the claimed values in
+   * keyVals, and besides the ones we hold or request already. Init values
+   * are picked first, the others by hash among the free ones
+   */
+  std::vector<T> pickFreeValues(
+      std::unordered_map<std::string, thrift::Value> const& keyVals,
+      size_t count,
+      uint64_t hash) const;
+
+  /* Invoked whenever there is an update for one of our requested or allocated
+   * values
+   */
+  void keyValUpdated(
+      const std::string& key, const thrift::Value& thriftVal) noexcept;
+
+  /**
+   * Utility function to create KvStore key for the value.
+   */
+  std::string createKey(const T val) const noexcept;
+
+  //
+  // Immutable state
+  //
+
+  const std::string nodeName_;
+  const std::string keyPrefix_;
+
+  // KvStoreClient instance used for communicating with KvStore
+  KvStoreClient* const kvStoreClient_{nullptr};
+
+  // EventLoop in which KvStoreClient is looping. Used for scheduling
+  // asynchronous events.
+  OpenrEventBase* const eventBase_{nullptr};
+
+  // Callback function to let user know of newly allocated values
+  const std::function<void(folly::Optional<std::set<T>>)> callback_{nullptr};
+
+  // number of values to allocate
+  const size_t numValues_{0};
+
+  // allow a higher originator ID to grab a key from an existing owner with a
+  // lower ID knowingly
+  const bool overrideOwner_{true};
+
+  //
+  // Mutable state
+  //
+
+  // Range from which values need to be allocated.
+  std::pair<T /* min */, T /* max */> allocRange_;
+
+  // Size of range
+  uint64_t allocRangeSize_{0};
+
+  // values to try first, in the first round
+  std::vector<T> initValues_;
+
+  // first round picks values by hash of the node name, later ones randomly
+  bool isFirstRound_{true};
+
+  // Currently allocated values
+  std::set<T> myValues_;
+
+  // Currently requested values
+  std::set<T> myRequestedValues_;
+
+  // Exponential backoff to avoid frequent allocation retries
+  ExponentialBackoff<std::chrono::milliseconds> backoff_;
+
+  // Scheduled allocation round
+  std::unique_ptr<fbzmq::ZmqTimeout> timeout_;
+
+  // if allocator has started
+  bool hasStarted_{false};
+
+  // callback to check if value already exists
+  const std::function<bool(T)> checkValueInUseCb_{nullptr};
+
+  // KvStore TTL for values
+  const std::chrono::milliseconds rangeAllocTtl_;
+
+  // area ID
+  const std::string area_{};
+};
+
+} // namespace openr
+
+#define RANGE_BATCH_ALLOCATOR_H_
+#include "RangeBatchAllocator-inl.h"
+#undef RANGE_BATCH_ALLOCATOR_H_
@@ -88,6 +88,9 @@ class PrefixAllocatorFixture : public ::testing::TestWithParam<bool> {
     // Erase previous configs (if any)
     configStore_->erase("prefix-allocator-config").get();
     configStore_->erase("prefix-manager-config").get();
+    for (auto const& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+      configStore_->erase(PrefixManager::getConfigKey(kv.first)).get();
+    }
 
     mockServiceHandler_ = std::make_shared<MockSystemServiceHandler>();
     server_ = std::make_shared<apache::thrift::ThriftServer>();
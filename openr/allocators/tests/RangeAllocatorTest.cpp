@@ -16,7 +16,9 @@
 #include <gtest/gtest.h>
 #include <sodium.h>
 
+#include <openr/allocators/IndexBitmap.h>
 #include <openr/allocators/RangeAllocator.h>
+#include <openr/allocators/RangeBatchAllocator.h>
 #include <openr/kvstore/KvStoreWrapper.h>
 
 using folly::make_optional;
@@ -37,6 +39,7 @@ const std::chrono::seconds kMonitorSubmitInterval(3600);
 // Count for testing purpose
 const uint32_t kNumStores = 3; // Total number of KvStore
 const uint32_t kNumClients = 99; // Total number of KvStoreClient
+const uint32_t kNumBatchValues = 8; // Values per batch allocator
 } // namespace
 
 /**
@@ -137,6 +140,37 @@ class RangeAllocatorFixture : public ::testing::TestWithParam<bool> {
     return std::move(allocators);
   }
 
+  template <typename T>
+  std::vector<std::unique_ptr<RangeBatchAllocator<T>>>
+  createBatchAllocators(
+      const std::pair<T, T>& allocRange,
+      const folly::Optional<std::vector<std::vector<T>>> maybeInitVals,
+      std::function<void(int /* client id */, folly::Optional<std::set<T>>)>
+          callback) {
+    using namespace std::chrono_literals;
+    std::vector<std::unique_ptr<RangeBatchAllocator<T>>> allocators;
+    for (size_t i = 0; i < clients.size(); i++) {
+      auto allocator = std::make_unique<RangeBatchAllocator<T>>(
+          createClientName(i),
+          "value:",
+          clients[i].get(),
+          [callback, i](folly::Optional<std::set<T>> newVals) noexcept {
+            callback(i, std::move(newVals));
+          },
+          kNumBatchValues,
+          10ms /* min backoff */,
+          100ms /* max backoff */,
+          overrideOwner /* override allowed */);
+      // start allocator
+      allocator->startAllocator(
+          allocRange,
+          maybeInitVals ? maybeInitVals->at(i) : std::vector<T>{});
+      allocators.emplace_back(std::move(allocator));
+    }
+
+    return allocators;
+  }
+
   // ZMQ Context for IO processing
   fbzmq::Context zmqContext;
 
@@ -353,6 +387,131 @@ TEST_P(RangeAllocatorFixture, InsufficentRange) {
   }
 }
 
+/**
+ * Run batch allocators with distinct seed values and make sure that they
+ * allocate all of their seed values at once.
+ */
+TEST_P(RangeAllocatorFixture, BatchDistinctSeed) {
+  const uint32_t start = 61;
+  const uint32_t end = start + kNumClients * kNumBatchValues - 1;
+  std::vector<std::vector<uint32_t>> initVals;
+  for (uint32_t i = 0; i < kNumClients; ++i) {
+    initVals.emplace_back(
+        range(start + i * kNumBatchValues, start + (i + 1) * kNumBatchValues) |
+        as<std::vector<uint32_t>>());
+  }
+
+  uint32_t rcvd{0};
+  auto allocators = createBatchAllocators<uint32_t>(
+      {start, end},
+      initVals,
+      [&](int clientId, folly::Optional<std::set<uint32_t>> newVals) {
+        ASSERT_TRUE(newVals.hasValue());
+        auto const& clientInitVals = initVals.at(clientId);
+        EXPECT_EQ(
+            std::set<uint32_t>(clientInitVals.begin(), clientInitVals.end()),
+            *newVals);
+        rcvd++;
+        if (rcvd == kNumClients) {
+          LOG(INFO) << "We got everything, stopping OpenrEventBase.";
+          evb.stop();
+        }
+      });
+
+  evb.run();
+}
+
+/**
+ * Run all batch allocators without seed values. Let them fight with each
+ * other and finally verify that every one of them got kNumBatchValues values
+ * no other one has.
+ */
+TEST_P(RangeAllocatorFixture, BatchNoSeed) {
+  const uint64_t start = 61;
+  const uint64_t end = start + kNumClients * kNumBatchValues * 2;
+
+  std::map<int /* client id */, std::set<uint64_t>> allocation;
+  auto allocators = createBatchAllocators<uint64_t>(
+      {start, end},
+      folly::none,
+      [&](int clientId, folly::Optional<std::set<uint64_t>> newVals) {
+        if (newVals) {
+          VLOG(1) << "client " << clientId << " got " << newVals->size()
+                  << " values";
+          ASSERT_EQ(kNumBatchValues, newVals->size());
+          ASSERT_GE(*newVals->begin(), start);
+          ASSERT_LE(*newVals->rbegin(), end);
+          allocation[clientId] = *newVals;
+        } else {
+          VLOG(1) << "client " << clientId << " lost one of its values";
+          allocation.erase(clientId);
+        }
+
+        // Terminate loop once every client holds distinct values
+        if (allocation.size() != kNumClients) {
+          return;
+        }
+        std::set<uint64_t> allocatedVals;
+        for (auto const& kv : allocation) {
+          allocatedVals.insert(kv.second.begin(), kv.second.end());
+        }
+        if (allocatedVals.size() == kNumClients * kNumBatchValues) {
+          LOG(INFO) << "We got everything, stopping OpenrEventBase.";
+          evb.stop();
+        }
+      });
+
+  evb.run();
+
+  for (size_t i = 0; i < allocators.size(); ++i) {
+    const auto maybeVals = allocators[i]->getValues();
+    ASSERT_TRUE(maybeVals.hasValue());
+    ASSERT_NE(allocation.end(), allocation.find(i));
+    EXPECT_EQ(allocation[i], *maybeVals);
+    EXPECT_EQ(allocation[i], allocators[i]->getValuesFromKvStore());
+  }
+}
+
+/**
+ * Free indices of a bitmap spanning multiple words, with a partial last one
+ */
+TEST(IndexBitmapTest, FreeIndices) {
+  IndexBitmap bitmap(130);
+  EXPECT_EQ(130, bitmap.getNumFree());
+  EXPECT_EQ(0, bitmap.selectFree(0).value());
+  EXPECT_EQ(129, bitmap.selectFree(129).value());
+  EXPECT_FALSE(bitmap.selectFree(130).hasValue());
+
+  // use all but 3, 64 and 129
+  for (uint64_t i = 0; i < 130; ++i) {
+    if (i != 3 and i != 64 and i != 129) {
+      bitmap.set(i);
+    }
+  }
+  bitmap.set(0);
+  EXPECT_EQ(3, bitmap.getNumFree());
+  EXPECT_TRUE(bitmap.test(0));
+  EXPECT_FALSE(bitmap.test(64));
+  EXPECT_EQ(3, bitmap.selectFree(0).value());
+  EXPECT_EQ(64, bitmap.selectFree(1).value());
+  EXPECT_EQ(129, bitmap.selectFree(2).value());
+  EXPECT_FALSE(bitmap.selectFree(3).hasValue());
+
+  EXPECT_EQ(3, bitmap.findFree(0).value());
+  EXPECT_EQ(3, bitmap.findFree(3).value());
+  EXPECT_EQ(64, bitmap.findFree(4).value());
+  EXPECT_EQ(129, bitmap.findFree(65).value());
+  // wraps around
+  bitmap.set(129);
+  EXPECT_EQ(3, bitmap.findFree(65).value());
+
+  bitmap.set(3);
+  bitmap.set(64);
+  EXPECT_EQ(0, bitmap.getNumFree());
+  EXPECT_FALSE(bitmap.findFree(0).hasValue());
+  EXPECT_FALSE(bitmap.selectFree(0).hasValue());
+}
+
 } // namespace openr
 
 int
@@ -10,14 +10,26 @@
 namespace openr {
 
 constexpr double Constants::kRttChangeThreashold;
+constexpr double Constants::kSpfIncrementalMaxAffectedRatio;
+constexpr size_t Constants::kSpfResultCacheMaxSize;
+constexpr size_t Constants::kParallelRouteBuildMinPrefixes;
+constexpr size_t Constants::kRouteBuildChunkSize;
+constexpr size_t Constants::kPhaseProfilerWindowSize;
+constexpr std::chrono::seconds Constants::kDecisionSnapshotInterval;
+constexpr std::chrono::seconds Constants::kDecisionSnapshotMaxAge;
+constexpr uint64_t Constants::kDecisionMaxDroppedComputes;
 constexpr folly::StringPiece Constants::kAdjDbMarker;
 constexpr folly::StringPiece Constants::kErrorResponse;
 constexpr folly::StringPiece Constants::kEventLogCategory;
+constexpr size_t Constants::kEventLogRingSize;
+constexpr std::chrono::milliseconds Constants::kEventLogDrainInterval;
+constexpr size_t Constants::kEventLogMaxBatchSize;
 constexpr folly::StringPiece Constants::kFibTimeMarker;
 constexpr folly::StringPiece Constants::kGlobalCmdLocalIdTemplate;
 constexpr folly::StringPiece Constants::kGlobalSubIdTemplate;
 constexpr folly::StringPiece Constants::kNodeLabelRangePrefix;
 constexpr folly::StringPiece Constants::kOpenrCtrlSessionContext;
+constexpr folly::StringPiece Constants::kRuntimeKnobsConfigKey;
 constexpr folly::StringPiece Constants::kPlatformHost;
 constexpr folly::StringPiece Constants::kPrefixAllocMarker;
 constexpr folly::StringPiece Constants::kPrefixDbMarker;
@@ -48,8 +60,14 @@ constexpr int64_t Constants::kDefaultAdjWeight;
 constexpr int64_t Constants::kTtlInfinity;
 constexpr size_t Constants::kNumTimeSeries;
 constexpr std::chrono::milliseconds Constants::kFloodPendingPublication;
+constexpr std::chrono::milliseconds Constants::kFloodPeerQueueInitialBackoff;
+constexpr std::chrono::milliseconds Constants::kFloodPeerQueueMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kInitialBackoff;
 constexpr std::chrono::milliseconds Constants::kKeepAliveCheckInterval;
+constexpr int32_t Constants::kFibSyncBuckets;
+constexpr std::chrono::milliseconds Constants::kRouteDbExportThrottle;
+constexpr size_t Constants::kFibStaleRoutesDeleteBatchSize;
+constexpr std::chrono::milliseconds Constants::kFibStaleRoutesDeleteInterval;
 constexpr std::chrono::milliseconds Constants::kKvStoreDbTtl;
 constexpr std::chrono::milliseconds Constants::kLinkImmediateTimeout;
 constexpr std::chrono::milliseconds Constants::kLinkThrottleTimeout;
@@ -63,25 +81,51 @@ constexpr std::chrono::milliseconds Constants::kPollTimeout;
 constexpr std::chrono::milliseconds Constants::kPrefixAllocatorRetryInterval;
 constexpr std::chrono::milliseconds Constants::kPrefixAllocatorSyncInterval;
 constexpr std::chrono::milliseconds Constants::kPrefixMgrKvThrottleTimeout;
+constexpr size_t Constants::kPrefixMgrMaxPendingDeltaChunks;
+constexpr std::chrono::milliseconds Constants::kPrefixMgrPersistThrottleTimeout;
 constexpr std::chrono::milliseconds Constants::kRangeAllocTtl;
+constexpr uint64_t Constants::kRangeAllocMaxBitmapSize;
 constexpr std::chrono::milliseconds Constants::kReadTimeout;
 constexpr std::chrono::milliseconds Constants::kServiceConnTimeout;
 constexpr std::chrono::milliseconds Constants::kServiceProcTimeout;
 constexpr std::chrono::milliseconds Constants::kTtlDecrement;
+constexpr std::chrono::milliseconds Constants::kEventLoopProbeInterval;
 constexpr std::chrono::milliseconds Constants::kTtlInfInterval;
+constexpr std::chrono::milliseconds Constants::kTtlUpdateBatchWindow;
 constexpr std::chrono::milliseconds Constants::kTtlThreshold;
 constexpr std::chrono::milliseconds Constants::kLongPollReqHoldTime;
 constexpr std::chrono::seconds Constants::kConvergenceMaxDuration;
+constexpr size_t Constants::kMaxPerfHistograms;
 constexpr std::chrono::seconds Constants::kKeepAliveIntvl;
 constexpr std::chrono::seconds Constants::kKeepAliveTime;
 constexpr std::chrono::seconds Constants::kMemoryThresholdTime;
 constexpr std::chrono::seconds Constants::kMonitorSubmitInterval;
+constexpr std::chrono::milliseconds Constants::kCounterCacheMaxAge;
 constexpr std::chrono::seconds Constants::kNetlinkSyncThrottleInterval;
 constexpr std::chrono::seconds Constants::kPlatformSyncInterval;
 constexpr std::chrono::seconds Constants::kPlatformThriftIdleTimeout;
 constexpr std::chrono::seconds Constants::kStoreSyncInterval;
 constexpr std::chrono::seconds Constants::kStoreFullSyncResponseTimeout;
+constexpr std::chrono::seconds Constants::kStoreFullSyncMinResponseTimeout;
+constexpr int32_t Constants::kMinFullSyncPendingCountThreshold;
 constexpr int32_t Constants::kMaxFullSyncPendingCountThreshold;
+constexpr int64_t Constants::kKvStoreSyncChunkBytes;
+constexpr int32_t Constants::kKvStoreSyncBucketBits;
+constexpr int32_t Constants::kKvStoreSyncLevels;
+constexpr size_t Constants::kKvStoreBucketSyncMinKeys;
+constexpr size_t Constants::kKvStoreShardedMergeMinKeys;
+constexpr size_t Constants::kKvStoreCompressionMinBytes;
+constexpr int32_t Constants::kKvStoreDumpPageSize;
+constexpr size_t Constants::kKvStoreMaxOutstandingDumps;
+constexpr uint8_t Constants::kKvStoreHashVersion;
+constexpr std::chrono::seconds Constants::kKvStoreSnapshotInterval;
+constexpr size_t Constants::kKvStoreChurnSampleRate;
+constexpr size_t Constants::kKvStoreChurnSketchSize;
+constexpr size_t Constants::kKvStoreChurnMaxKeyFamilies;
+constexpr size_t Constants::kKvStoreChurnTopK;
+constexpr std::chrono::milliseconds Constants::kKvStoreChurnDecayInterval;
+constexpr size_t Constants::kKvStoreLatencyWindowSize;
+constexpr size_t Constants::kFloodPeerQueueMaxKeys;
 constexpr std::pair<int32_t, int32_t> Constants::kSrGlobalRange;
 constexpr std::pair<int32_t, int32_t> Constants::kSrLocalRange;
 constexpr uint16_t Constants::kPerfBufferSize;
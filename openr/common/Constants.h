@@ -68,9 +68,21 @@ class Constants {
   // default interval to publish to monitor
   static constexpr std::chrono::seconds kMonitorSubmitInterval{5};
 
+  // max age of counters served by ctrl queries. Modules publish counters
+  // every kMonitorSubmitInterval, fresher ones would not change much
+  static constexpr std::chrono::milliseconds kCounterCacheMaxAge{2000};
+
   // event log category
   static constexpr folly::StringPiece kEventLogCategory{"perfpipe_aquaman"};
 
+  // events buffered per logging thread, more are dropped until drained
+  static constexpr size_t kEventLogRingSize{256};
+
+  // interval and max number of events of the batches of event logs submitted
+  // to monitor
+  static constexpr std::chrono::milliseconds kEventLogDrainInterval{500};
+  static constexpr size_t kEventLogMaxBatchSize{1000};
+
   // ExponentialBackoff durations
   static constexpr std::chrono::milliseconds kInitialBackoff{64};
   static constexpr std::chrono::milliseconds kMaxBackoff{8192};
@@ -86,13 +98,68 @@ class Constants {
   // default interval for kvstore to sync with peers
   static constexpr std::chrono::seconds kStoreSyncInterval{60};
 
-  // KvStore full sync response timeout
+  // KvStore full sync response timeout, and the least one waited for once
+  // full-sync durations are known
   static constexpr std::chrono::seconds kStoreFullSyncResponseTimeout{10};
+  static constexpr std::chrono::seconds kStoreFullSyncMinResponseTimeout{1};
 
   // Count of maximum pending kvstore sync response before waiting for
-  // kStoreFullSyncResponseTimeout to send the next sync request
+  // kStoreFullSyncResponseTimeout to send the next sync request, adapted
+  // between these bounds to the duration of full-syncs
+  static constexpr int32_t kMinFullSyncPendingCountThreshold{2};
   static constexpr int32_t kMaxFullSyncPendingCountThreshold{32};
 
+  // Full-sync responses and the key-values sent back to the responder are
+  // split into messages of about this size
+  static constexpr int64_t kKvStoreSyncChunkBytes{1 << 20};
+
+  // Full-sync compares digests of key buckets level by level, each level
+  // splitting a bucket into 2^kKvStoreSyncBucketBits buckets
+  static constexpr int32_t kKvStoreSyncBucketBits{8};
+  static constexpr int32_t kKvStoreSyncLevels{2};
+
+  // Below this number of keys, full-sync sends key hashes right away instead
+  // of comparing bucket digests first
+  static constexpr size_t kKvStoreBucketSyncMinKeys{1024};
+
+  // Publications with fewer keys are merged on the KvStore thread, even if
+  // merging in parallel is enabled
+  static constexpr size_t kKvStoreShardedMergeMinKeys{1000};
+
+  // Smaller payloads are sent uncompressed to peers accepting compression
+  static constexpr size_t kKvStoreCompressionMinBytes{4096};
+
+  // Number of keys per page requested by clients dumping KvStores. Servers
+  // not supporting paginated dumps respond with all keys at once
+  static constexpr int32_t kKvStoreDumpPageSize{1000};
+
+  // max Open/R instances dumped at a time by multiple instance dumps
+  static constexpr size_t kKvStoreMaxOutstandingDumps{64};
+
+  // Version of the algorithm generating value hashes, carried in their top
+  // byte. Hashes of other versions are recomputed when values are stored
+  static constexpr uint8_t kKvStoreHashVersion{1};
+
+  // Default interval of KvStore snapshots for warm restarts
+  static constexpr std::chrono::seconds kKvStoreSnapshotInterval{60};
+
+  // One in kKvStoreChurnSampleRate key updates is accounted for KvStore churn
+  // stats, which are halved every kKvStoreChurnDecayInterval. Heavy hitters
+  // are tracked with kKvStoreChurnSketchSize counters, the top ones exported
+  static constexpr size_t kKvStoreChurnSampleRate{8};
+  static constexpr size_t kKvStoreChurnSketchSize{128};
+  static constexpr size_t kKvStoreChurnMaxKeyFamilies{32};
+  static constexpr size_t kKvStoreChurnTopK{10};
+  static constexpr std::chrono::milliseconds kKvStoreChurnDecayInterval{
+      60000};
+
+  // Number of most recent runs KvStore phase latency percentiles cover
+  static constexpr size_t kKvStoreLatencyWindowSize{1000};
+
+  // Number of most recently used filters whose KvStore key and hash dumps
+  // are cached, per area
+  static constexpr size_t kKvStoreDumpCacheSize{8};
+
   //
   // PrefixAllocator specific
 
@@ -122,6 +189,51 @@ class Constants {
   // overloaded note metric value
   static constexpr uint64_t kOverloadNodeMetric{1ull << 32};
 
+  // RTT based link metrics (in units of 100us) above this are rounded to
+  // multiples of it, so that jitter on long links doesn't change them
+  static constexpr int32_t kRttMetricBucketSize{10};
+
+  // RTT based metric of an adjacency is only changed if it differs by at
+  // least this ratio from the current one, and at most once per interval.
+  // Changes within the interval are held back till its end
+  static constexpr double kRttMetricMinChangeRatio{0.1};
+  static constexpr std::chrono::milliseconds kRttMetricMinUpdateInterval{
+      10000};
+
+  //
+  // Decision specific
+  //
+
+  // Incremental SPF falls back to a full run if more than this fraction of
+  // the nodes are affected by topology changes since the previous run
+  static constexpr double kSpfIncrementalMaxAffectedRatio{0.25};
+
+  // Maximum number of SPF results cached for the current link state
+  // generation. The cache is flushed once it grows beyond this
+  static constexpr size_t kSpfResultCacheMaxSize{256};
+
+  // Unicast routes are created in parallel only if there are at least this
+  // many prefixes, below it the overhead isn't worth it
+  static constexpr size_t kParallelRouteBuildMinPrefixes{1024};
+
+  // Number of prefixes whose best announcers are selected at once before
+  // their routes are created, bounds the state kept in between
+  static constexpr size_t kRouteBuildChunkSize{1024};
+
+  // Number of most recent route computations the percentiles of route
+  // computation phase durations are reported over
+  static constexpr size_t kPhaseProfilerWindowSize{1024};
+
+  // Default interval of Decision snapshots for fast cold starts. Snapshots
+  // older than kDecisionSnapshotMaxAge aren't restored
+  static constexpr std::chrono::seconds kDecisionSnapshotInterval{60};
+  static constexpr std::chrono::seconds kDecisionSnapshotMaxAge{600};
+
+  // Maximum number of consecutive asynchronous route computations dropped
+  // as superseded by newer requests. The next one is published regardless
+  // so that routes keep reaching Fib under sustained churn
+  static constexpr uint64_t kDecisionMaxDroppedComputes{8};
+
   //
   // Spark specific
   //
@@ -158,6 +270,19 @@ class Constants {
   // time interval for keep alive check between fib and switch agent
   static constexpr std::chrono::milliseconds kKeepAliveCheckInterval{1000};
 
+  // number of buckets of the unicast route digests compared on route sync.
+  // Only routes of buckets which differ are sent to switch agent
+  static constexpr int32_t kFibSyncBuckets{1024};
+
+  // minimum interval between two exports of the route database to file
+  static constexpr std::chrono::milliseconds kRouteDbExportThrottle{100};
+
+  // stale routes found in switch agent on warm boot are deleted in batches of
+  // this size, one batch per interval
+  static constexpr size_t kFibStaleRoutesDeleteBatchSize{1000};
+  static constexpr std::chrono::milliseconds kFibStaleRoutesDeleteInterval{
+      100};
+
   // Timeout duration for which if a client connection has no activity, then it
   // will be dropped. We keep it 3 * kPlatformSyncInterval so that thrift
   // connection between OpenR and platform service remains up forever under
@@ -181,12 +306,34 @@ class Constants {
   // Kvstore timer for flooding pending publication
   static constexpr std::chrono::milliseconds kFloodPendingPublication{100};
 
+  // Backoff of the flushes of a peer flood queue, and number of queued keys
+  // at which a flush is attempted regardless of the backoff
+  static constexpr std::chrono::milliseconds kFloodPeerQueueInitialBackoff{10};
+  static constexpr std::chrono::milliseconds kFloodPeerQueueMaxBackoff{1000};
+  static constexpr size_t kFloodPeerQueueMaxKeys{1000};
+
+  // Flooded publications already received within kFloodSeenCacheTtl are
+  // dropped as duplicates, up to kFloodSeenCacheMaxSize of them remembered
+  static constexpr std::chrono::milliseconds kFloodSeenCacheTtl{5000};
+  static constexpr size_t kFloodSeenCacheMaxSize{16384};
+
+  // Values announced by peers are pulled from the next announcer if not
+  // received within kLazyValuePullTimeout
+  static constexpr std::chrono::milliseconds kLazyValuePullTimeout{1000};
+
+  // Key IDs assigned to keys flooded to peers before starting over
+  static constexpr size_t kKvStoreMaxKeyIds{1000000};
+
   // KvStore database TTLs
   static constexpr std::chrono::milliseconds kKvStoreDbTtl{5min};
 
   // RangeAllocator keys TTLs
   static constexpr std::chrono::milliseconds kRangeAllocTtl{5min};
 
+  // max size of ranges RangeAllocator picks free values of with a bitmap of
+  // used ones, 512KB of bits. Values of larger ranges are probed one by one
+  static constexpr uint64_t kRangeAllocMaxBitmapSize{1 << 22};
+
   // delimiter separating prefix and name in kvstore key
   static constexpr folly::StringPiece kPrefixNameSeparator{":"};
 
@@ -212,8 +359,15 @@ class Constants {
   static constexpr folly::StringPiece kOpenrCtrlSessionContext{"OpenrCtrl"};
   static constexpr folly::StringPiece kPluginSessionContext{"OpenrPlugin"};
 
+  // config store key of the runtime knobs values restored on restart
+  static constexpr folly::StringPiece kRuntimeKnobsConfigKey{
+      "openr-runtime-knobs"};
+
   // max interval to update TTL for each key in kvstore w/ finite TTL
   static constexpr std::chrono::milliseconds kMaxTtlUpdateInterval{2h};
+  // keys due for TTL update within this window are refreshed together by
+  // KvStoreClient in batched mode
+  static constexpr std::chrono::milliseconds kTtlUpdateBatchWindow{1s};
   // TTL infinity, never expires
   // int version
   static constexpr int64_t kTtlInfinity{INT32_MIN};
@@ -230,6 +384,9 @@ class Constants {
   // buffer size to keep latest perf log
   static constexpr uint16_t kPerfBufferSize{10};
   static constexpr std::chrono::seconds kConvergenceMaxDuration{3s};
+  // max number of convergence histograms by originating event, latencies of
+  // further events are counted together
+  static constexpr size_t kMaxPerfHistograms{32};
 
   // hold time for longPoll requests in openrCtrl thrift server
   static constexpr std::chrono::milliseconds kLongPollReqHoldTime{20000};
@@ -241,6 +398,13 @@ class Constants {
   // the time we hold on to announce to KvStore
   static constexpr std::chrono::milliseconds kPrefixMgrKvThrottleTimeout{250};
 
+  // the time we hold on to persist prefix changes to the config store
+  static constexpr std::chrono::milliseconds kPrefixMgrPersistThrottleTimeout{
+      100};
+
+  // max number of prefix delta chunks received and not applied yet
+  static constexpr size_t kPrefixMgrMaxPendingDeltaChunks{64};
+
   // OpenR ports
 
   // Openr Ctrl thrift server port
@@ -279,6 +443,10 @@ class Constants {
   // Threshold time in secs to crash after reaching critical memory
   static constexpr std::chrono::seconds kMemoryThresholdTime{600};
 
+  // Interval of the event loop probe measuring scheduling delay of every
+  // OpenrEventBase
+  static constexpr std::chrono::milliseconds kEventLoopProbeInterval{100};
+
   static const std::list<std::string>&
   getNextProtocolsForThriftServers() {
     static const std::list<std::string> result{
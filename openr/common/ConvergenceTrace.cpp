@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConvergenceTrace.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <folly/Range.h>
+
+namespace openr {
+
+namespace {
+
+// duration of a route computation phase, carried by its perf event
+int64_t
+getPhaseDurationUs(const thrift::PerfEvent& event) {
+  return std::max<int64_t>(0, event.durationUs.value_or(0));
+}
+
+} // namespace
+
+ConvergenceTrace::ConvergenceTrace(size_t capacity, uint32_t sampleRate)
+    : records_(capacity), sampleRate_(std::max<uint32_t>(1, sampleRate)) {}
+
+thrift::PerfStage
+ConvergenceTrace::getPerfStage(const std::string& eventDescr) {
+  static const std::unordered_map<std::string, thrift::PerfStage> kStages{
+      {"ADJ_DB_UPDATED", thrift::PerfStage::ADJ_DB_UPDATED},
+      {"LOADED_FROM_DISK", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"ADD_PREFIX", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"UPDATE_PREFIX", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"COVERED_BY_HIGHER_TYPE", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"UPDATE_KVSTORE_THROTTLED", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"WITHDRAW_THROTTLED", thrift::PerfStage::PREFIX_DB_UPDATED},
+      {"DECISION_RECEIVED", thrift::PerfStage::KVSTORE_FLOOD},
+      {"DECISION_DEBOUNCE", thrift::PerfStage::DECISION_DEBOUNCE},
+      {"DECISION_SPF", thrift::PerfStage::DECISION_ROUTE_UPDATE},
+      {"ROUTE_UPDATE", thrift::PerfStage::DECISION_ROUTE_UPDATE},
+      {"ORDERED_FIB_HOLDS_EXPIRED", thrift::PerfStage::DECISION_ROUTE_UPDATE},
+      {"COLD_START_UPDATE", thrift::PerfStage::DECISION_ROUTE_UPDATE},
+      {"FIB_ROUTE_DB_RECVD", thrift::PerfStage::FIB_ROUTE_DB_RECEIVED},
+      {"OPENR_FIB_ROUTES_PROGRAMMED", thrift::PerfStage::FIB_ROUTES_PROGRAMMED},
+  };
+
+  auto it = kStages.find(eventDescr);
+  if (it != kStages.end()) {
+    return it->second;
+  }
+  const folly::StringPiece descr(eventDescr);
+  if (descr.startsWith("NEIGHBOR_")) {
+    return thrift::PerfStage::NEIGHBOR_EVENT;
+  }
+  if (descr.startsWith("DECISION_PHASE_")) {
+    return thrift::PerfStage::DECISION_PHASE;
+  }
+  return thrift::PerfStage::OTHER;
+}
+
+bool
+ConvergenceTrace::record(const thrift::PerfEvents& perfEvents) {
+  if (not isEnabled() or perfEvents.events.empty()) {
+    return false;
+  }
+  if (numEvents_++ % sampleRate_) {
+    return false;
+  }
+
+  auto& record = records_[numRecorded_++ % records_.size()];
+  record.spans.clear();
+  record.names.clear();
+  const auto intern = [&record](const std::string& name) {
+    auto it = std::find(record.names.begin(), record.names.end(), name);
+    if (it == record.names.end()) {
+      it = record.names.insert(it, name);
+    }
+    return static_cast<uint16_t>(it - record.names.begin());
+  };
+  const auto addSpan = [&](const thrift::PerfEvent& event,
+                           thrift::PerfStage stage,
+                           int64_t startUs,
+                           int64_t durationUs) {
+    Span span;
+    span.startUs = startUs;
+    span.durationUs = durationUs;
+    span.stage = stage;
+    span.nodeIndex = intern(event.nodeName);
+    span.eventIndex = intern(event.eventDescr);
+    record.spans.emplace_back(span);
+  };
+
+  // the originating event marks the start, no time is spent in it
+  const auto& events = perfEvents.events;
+  const auto startUs = events.front().unixTs * 1000;
+  addSpan(
+      events.front(), getPerfStage(events.front().eventDescr), startUs, 0);
+
+  // every other event ends a span started by the previous one, except for
+  // route computation phases. These carry their duration and are nested at
+  // the end of the span of the next event, the computation they are part of
+  auto cursorUs = startUs;
+  const auto* prev = &events.front();
+  std::vector<const thrift::PerfEvent*> phases;
+  const auto addPhases = [&]() {
+    int64_t phasesUs = 0;
+    for (const auto* phase : phases) {
+      phasesUs += getPhaseDurationUs(*phase);
+    }
+    auto phaseStartUs = cursorUs - phasesUs;
+    for (const auto* phase : phases) {
+      const auto durationUs = getPhaseDurationUs(*phase);
+      addSpan(
+          *phase, thrift::PerfStage::DECISION_PHASE, phaseStartUs, durationUs);
+      phaseStartUs += durationUs;
+    }
+    phases.clear();
+  };
+  for (size_t i = 1; i < events.size(); ++i) {
+    const auto& event = events[i];
+    const auto stage = getPerfStage(event.eventDescr);
+    if (stage == thrift::PerfStage::DECISION_PHASE) {
+      phases.emplace_back(&event);
+      continue;
+    }
+
+    int64_t durationUs{0};
+    if (event.nodeName == prev->nodeName and
+        event.monotonicTsUs.hasValue() and prev->monotonicTsUs.hasValue()) {
+      durationUs = *event.monotonicTsUs - *prev->monotonicTsUs;
+    } else {
+      durationUs = event.unixTs * 1000 - cursorUs;
+    }
+    durationUs = std::max<int64_t>(0, durationUs);
+    addSpan(event, stage, cursorUs, durationUs);
+    cursorUs += durationUs;
+    prev = &event;
+    addPhases();
+  }
+  addPhases();
+
+  record.totalDurationUs = cursorUs - startUs;
+  return true;
+}
+
+std::vector<thrift::ConvergenceTraceEntry>
+ConvergenceTrace::dump() const {
+  std::vector<thrift::ConvergenceTraceEntry> entries;
+  if (not isEnabled()) {
+    return entries;
+  }
+
+  const auto numRecords = std::min<uint64_t>(numRecorded_, records_.size());
+  entries.reserve(numRecords);
+  for (auto i = numRecorded_ - numRecords; i < numRecorded_; ++i) {
+    const auto& record = records_[i % records_.size()];
+    thrift::ConvergenceTraceEntry entry;
+    entry.totalDurationUs = record.totalDurationUs;
+    entry.spans.reserve(record.spans.size());
+    for (const auto& span : record.spans) {
+      thrift::PerfSpan perfSpan;
+      perfSpan.stage = span.stage;
+      perfSpan.nodeName = record.names.at(span.nodeIndex);
+      perfSpan.eventDescr = record.names.at(span.eventIndex);
+      perfSpan.startUs = span.startUs;
+      perfSpan.durationUs = span.durationUs;
+      entry.spans.emplace_back(std::move(perfSpan));
+    }
+    entries.emplace_back(std::move(entry));
+  }
+  return entries;
+}
+
+} // namespace openr
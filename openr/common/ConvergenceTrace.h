@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+
+namespace openr {
+
+/**
+ * Bounded trace of sampled convergence events, e.g. the perf events of route
+ * updates programmed by Fib. The perf events of a sampled update are turned
+ * into spans, the time spent in every stage on every node from the
+ * originating event until routes are programmed. Spans are stored with
+ * compact stage ids and interned names and only formatted into thrift
+ * entries when dumped. Tracing is free when disabled (zero capacity) and
+ * costs a counter increment for convergence events not sampled.
+ *
+ * Time between events of the same node is measured with their monotonic
+ * timestamps if they have one, and with unix timestamps otherwise.
+ *
+ * Not thread safe, meant to be used from the event base of its owner.
+ */
+class ConvergenceTrace {
+ public:
+  // keep the latest capacity traces, tracing one of sampleRate events
+  ConvergenceTrace(size_t capacity, uint32_t sampleRate);
+
+  bool
+  isEnabled() const {
+    return not records_.empty();
+  }
+
+  // trace perf events of a convergence event if it is sampled, the oldest
+  // traces are overwritten. Returns whether it was traced
+  bool record(const thrift::PerfEvents& perfEvents);
+
+  // number of traces recorded so far, including overwritten ones
+  uint64_t
+  getNumRecorded() const {
+    return numRecorded_;
+  }
+
+  uint32_t
+  getSampleRate() const {
+    return sampleRate_;
+  }
+
+  // recorded traces, oldest first
+  std::vector<thrift::ConvergenceTraceEntry> dump() const;
+
+  // stage of convergence ending at a perf event
+  static thrift::PerfStage getPerfStage(const std::string& eventDescr);
+
+ private:
+  struct Span {
+    int64_t startUs{0};
+    int64_t durationUs{0};
+    thrift::PerfStage stage{thrift::PerfStage::OTHER};
+    // node name and event description, indices in names of the record
+    uint16_t nodeIndex{0};
+    uint16_t eventIndex{0};
+  };
+
+  struct Record {
+    std::vector<Span> spans;
+    std::vector<std::string> names;
+    int64_t totalDurationUs{0};
+  };
+
+  std::vector<Record> records_;
+  const uint32_t sampleRate_{1};
+  uint64_t numEvents_{0};
+  uint64_t numRecorded_{0};
+};
+
+} // namespace openr
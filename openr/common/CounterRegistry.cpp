@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CounterRegistry.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+bool
+haveSameNames(
+    CounterRegistry::Counters const& a, CounterRegistry::Counters const& b) {
+  return a.size() == b.size() and
+      std::equal(
+             a.begin(), a.end(), b.begin(), [](auto const& x, auto const& y) {
+               return x.first == y.first;
+             });
+}
+
+} // namespace
+
+CounterRegistry::CounterRegistry(
+    std::chrono::milliseconds maxAge, size_t maxCachedRegexes)
+    : maxAge_(maxAge), maxCachedRegexes_(maxCachedRegexes) {
+  auto snapshot = snapshot_.wlock();
+  snapshot->counters = std::make_shared<const Counters>();
+  snapshot->refreshTime = Clock::time_point::min();
+}
+
+void
+CounterRegistry::addSource(Source source) {
+  CHECK(source);
+  std::lock_guard<std::mutex> lock(refreshLock_);
+  sources_.emplace_back(std::move(source));
+  // make the next query collect from the new source too
+  snapshot_.wlock()->refreshTime = Clock::time_point::min();
+}
+
+CounterRegistry::Snapshot
+CounterRegistry::getSnapshot(bool refresh) {
+  const auto now = Clock::now();
+  if (not refresh) {
+    auto snapshot = snapshot_.copy();
+    if (snapshot.refreshTime != Clock::time_point::min() and
+        now - snapshot.refreshTime <= maxAge_) {
+      return snapshot;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(refreshLock_);
+  auto previous = snapshot_.copy();
+  // concurrent queries wait for the one collecting counters and share them
+  if (not refresh and previous.refreshTime >= now) {
+    return previous;
+  }
+
+  auto counters = std::make_shared<Counters>();
+  for (auto const& source : sources_) {
+    source(*counters);
+  }
+  ++numRefreshes_;
+
+  Snapshot snapshot;
+  snapshot.generation = haveSameNames(*counters, *previous.counters)
+      ? previous.generation
+      : previous.generation + 1;
+  snapshot.counters = std::move(counters);
+  snapshot.refreshTime = Clock::now();
+  *snapshot_.wlock() = snapshot;
+  return snapshot;
+}
+
+std::shared_ptr<const CounterRegistry::Counters>
+CounterRegistry::getCounters(bool refresh) {
+  return getSnapshot(refresh).counters;
+}
+
+CounterRegistry::Counters
+CounterRegistry::getRegexCounters(std::string const& regex) {
+  const auto snapshot = getSnapshot(false);
+
+  std::shared_ptr<const re2::RE2> compiledRegex;
+  std::shared_ptr<const std::vector<std::string>> names;
+  SYNCHRONIZED_CONST(regexes_) {
+    auto it = regexes_.find(regex);
+    if (it != regexes_.end()) {
+      compiledRegex = it->second.regex;
+      if (it->second.generation == snapshot.generation) {
+        names = it->second.names;
+      }
+    }
+  }
+
+  if (names) {
+    ++numRegexCacheHits_;
+  } else {
+    ++numRegexCacheMisses_;
+    if (not compiledRegex) {
+      compiledRegex = std::make_shared<const re2::RE2>(regex);
+    }
+    auto matches = std::make_shared<std::vector<std::string>>();
+    if (compiledRegex->ok()) {
+      for (auto const& kv : *snapshot.counters) {
+        if (RE2::PartialMatch(kv.first, *compiledRegex)) {
+          matches->emplace_back(kv.first);
+        }
+      }
+    }
+    names = matches;
+
+    SYNCHRONIZED(regexes_) {
+      if (regexes_.size() >= maxCachedRegexes_ and not regexes_.count(regex)) {
+        regexes_.clear();
+      }
+      auto& entry = regexes_[regex];
+      // keep the result of the latest generation only
+      if (entry.generation <= snapshot.generation) {
+        entry.regex = compiledRegex;
+        entry.names = names;
+        entry.generation = snapshot.generation;
+      }
+    }
+  }
+
+  // names are sorted and all of them are in snapshots of this generation
+  Counters result;
+  for (auto const& name : *names) {
+    result.emplace_hint(result.end(), name, snapshot.counters->at(name));
+  }
+  return result;
+}
+
+CounterRegistry::Counters
+CounterRegistry::getSelectedCounters(std::vector<std::string> const& keys) {
+  const auto counters = getCounters();
+  Counters result;
+  for (auto const& key : keys) {
+    auto it = counters->find(key);
+    if (it != counters->end()) {
+      result.emplace(*it);
+    }
+  }
+  return result;
+}
+
+} // namespace openr
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Synchronized.h>
+#include <re2/re2.h>
+
+namespace openr {
+
+/**
+ * Aggregates counters of multiple sources into a snapshot which is cached for
+ * up to maxAge, so that frequent and concurrent queries share the cost of
+ * collecting them.
+ *
+ * Regex queries compile a pattern once and memoize the names of the counters
+ * it matches until the set of counter names changes, values are then looked
+ * up by name only.
+ */
+class CounterRegistry {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Counters = std::map<std::string, int64_t>;
+  using Source = std::function<void(Counters&)>;
+
+  explicit CounterRegistry(
+      std::chrono::milliseconds maxAge, size_t maxCachedRegexes = 256);
+
+  /**
+   * Add a source of counters. Sources are called in the order they were added
+   * and may overwrite counters of earlier ones
+   */
+  void addSource(Source source);
+
+  /**
+   * All counters, collected at most maxAge ago. If refresh is set they are
+   * collected now
+   */
+  std::shared_ptr<const Counters> getCounters(bool refresh = false);
+
+  /**
+   * Counters whose name partially matches regex, none if regex is invalid
+   */
+  Counters getRegexCounters(std::string const& regex);
+
+  /**
+   * Counters of the given names, unknown ones are skipped
+   */
+  Counters getSelectedCounters(std::vector<std::string> const& keys);
+
+  int64_t
+  getNumRefreshes() const {
+    return numRefreshes_;
+  }
+
+  int64_t
+  getNumRegexCacheHits() const {
+    return numRegexCacheHits_;
+  }
+
+  int64_t
+  getNumRegexCacheMisses() const {
+    return numRegexCacheMisses_;
+  }
+
+ private:
+  struct Snapshot {
+    std::shared_ptr<const Counters> counters;
+    // changes along with the set of counter names
+    int64_t generation{0};
+    Clock::time_point refreshTime;
+  };
+
+  struct RegexEntry {
+    std::shared_ptr<const re2::RE2> regex;
+    // names matching regex in snapshots of generation
+    std::shared_ptr<const std::vector<std::string>> names;
+    int64_t generation{-1};
+  };
+
+  Snapshot getSnapshot(bool refresh);
+
+  const std::chrono::milliseconds maxAge_;
+  const size_t maxCachedRegexes_{0};
+
+  // serializes collection of counters, held while calling sources
+  std::mutex refreshLock_;
+  std::vector<Source> sources_;
+
+  folly::Synchronized<Snapshot> snapshot_;
+  folly::Synchronized<std::unordered_map<std::string, RegexEntry>> regexes_;
+
+  std::atomic<int64_t> numRefreshes_{0};
+  std::atomic<int64_t> numRegexCacheHits_{0};
+  std::atomic<int64_t> numRegexCacheMisses_{0};
+};
+
+} // namespace openr
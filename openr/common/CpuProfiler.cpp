@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/CpuProfiler.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <set>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <folly/Conv.h>
+#include <folly/Demangle.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+#include <glog/logging.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace openr {
+
+namespace {
+
+// frames recorded per sample, innermost first
+constexpr size_t kMaxFrames{48};
+// frames of the signal handler and trampoline, left out of samples
+constexpr size_t kSkipFrames{2};
+// samples recorded per profile, about 4MB
+constexpr size_t kMaxSamples{10000};
+constexpr int32_t kMaxSamplingHz{1000};
+constexpr int32_t kMaxDurationSec{300};
+
+struct Sample {
+  pid_t tid{0};
+  size_t numFrames{0};
+  uintptr_t frames[kMaxFrames];
+};
+
+//
+// State shared with the signal handler, which may only touch atomics and
+// the preallocated samples
+//
+std::atomic<bool> gSampling{false};
+std::atomic<size_t> gNumSamples{0};
+std::atomic<size_t> gNumDroppedSamples{0};
+std::atomic<size_t> gHandlersInFlight{0};
+std::unique_ptr<Sample[]> gSamples;
+
+void
+onProfSignal(int /* signo */, siginfo_t* /* info */, void* /* context */) {
+  gHandlersInFlight.fetch_add(1, std::memory_order_acq_rel);
+  if (gSampling.load(std::memory_order_acquire)) {
+    const int savedErrno = errno;
+    const auto index = gNumSamples.fetch_add(1, std::memory_order_relaxed);
+    if (index < kMaxSamples) {
+      auto& sample = gSamples[index];
+      sample.tid = static_cast<pid_t>(syscall(SYS_gettid));
+      const auto numFrames =
+          folly::symbolizer::getStackTraceSafe(sample.frames, kMaxFrames);
+      sample.numFrames = numFrames > 0 ? static_cast<size_t>(numFrames) : 0;
+    } else {
+      gNumDroppedSamples.fetch_add(1, std::memory_order_relaxed);
+    }
+    errno = savedErrno;
+  }
+  gHandlersInFlight.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+std::chrono::nanoseconds
+getCpuTime(clockid_t cpuClock) {
+  struct timespec ts;
+  if (clock_gettime(cpuClock, &ts) != 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
+CpuProfiler&
+CpuProfiler::get() {
+  static CpuProfiler profiler;
+  return profiler;
+}
+
+CpuProfiler::~CpuProfiler() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (sampling_) {
+    stopSampling();
+  }
+  stopRequested_ = true;
+  stopperCv_.notify_all();
+  lock.unlock();
+  if (stopper_.joinable()) {
+    stopper_.join();
+  }
+}
+
+void
+CpuProfiler::registerThread(std::string const& name) {
+  ThreadInfo info;
+  info.tid = static_cast<pid_t>(syscall(SYS_gettid));
+  const auto rc = pthread_getcpuclockid(pthread_self(), &info.cpuClock);
+  if (rc != 0) {
+    LOG(ERROR) << "Failed to get CPU clock of " << name
+               << " thread: " << folly::errnoStr(rc);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  threads_[name] = info;
+}
+
+std::vector<std::string>
+CpuProfiler::getThreadNames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> names;
+  for (auto const& kv : threads_) {
+    names.emplace_back(kv.first);
+  }
+  return names;
+}
+
+folly::Expected<folly::Unit, std::string>
+CpuProfiler::start(thrift::CpuProfileParams const& params) {
+  if (params.durationSec <= 0 or params.durationSec > kMaxDurationSec) {
+    return folly::makeUnexpected(folly::sformat(
+        "Duration must be within [1, {}] seconds", kMaxDurationSec));
+  }
+  if (params.samplingHz <= 0 or params.samplingHz > kMaxSamplingHz) {
+    return folly::makeUnexpected(folly::sformat(
+        "Sampling rate must be within [1, {}] Hz", kMaxSamplingHz));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (sampling_) {
+    return folly::makeUnexpected(std::string("A profile is running"));
+  }
+  std::vector<ProfiledThread> profiledThreads;
+  if (params.threadNames.empty()) {
+    for (auto const& kv : threads_) {
+      profiledThreads.emplace_back(ProfiledThread{kv.first, kv.second});
+    }
+  }
+  for (auto const& name : params.threadNames) {
+    auto it = threads_.find(name);
+    if (it == threads_.end()) {
+      return folly::makeUnexpected(
+          folly::sformat("Unknown thread {}", name));
+    }
+    profiledThreads.emplace_back(ProfiledThread{name, it->second});
+  }
+  if (profiledThreads.empty()) {
+    return folly::makeUnexpected(std::string("No thread to profile"));
+  }
+
+  // previous profile is dropped if not collected
+  lock.unlock();
+  if (stopper_.joinable()) {
+    stopper_.join();
+  }
+  lock.lock();
+  if (sampling_) {
+    return folly::makeUnexpected(std::string("A profile is running"));
+  }
+
+  if (not gSamples) {
+    gSamples = std::make_unique<Sample[]>(kMaxSamples);
+    // unwinds once outside of a signal handler, loading what it needs
+    uintptr_t frames[kMaxFrames];
+    folly::symbolizer::getStackTraceSafe(frames, kMaxFrames);
+
+    struct sigaction sa;
+    ::memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = onProfSignal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+      gSamples.reset();
+      return folly::makeUnexpected(folly::sformat(
+          "Failed to install SIGPROF handler: {}", folly::errnoStr(errno)));
+    }
+  }
+  gNumSamples = 0;
+  gNumDroppedSamples = 0;
+
+  const auto intervalNs = 1000000000L / params.samplingHz;
+  struct itimerspec interval;
+  interval.it_interval.tv_sec = intervalNs / 1000000000L;
+  interval.it_interval.tv_nsec = intervalNs % 1000000000L;
+  interval.it_value = interval.it_interval;
+
+  profiledThreads_ = std::move(profiledThreads);
+  gSampling.store(true, std::memory_order_release);
+  for (auto& thread : profiledThreads_) {
+    thread.cpuTimeStart = getCpuTime(thread.info.cpuClock);
+    struct sigevent sev;
+    ::memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = thread.info.tid;
+    if (timer_create(thread.info.cpuClock, &sev, &thread.timer) != 0) {
+      const auto error = folly::sformat(
+          "Failed to create timer of {} thread: {}",
+          thread.name,
+          folly::errnoStr(errno));
+      thread.timer = nullptr;
+      stopSampling();
+      started_ = false;
+      return folly::makeUnexpected(error);
+    }
+    if (timer_settime(thread.timer, 0, &interval, nullptr) != 0) {
+      const auto error = folly::sformat(
+          "Failed to arm timer of {} thread: {}",
+          thread.name,
+          folly::errnoStr(errno));
+      stopSampling();
+      started_ = false;
+      return folly::makeUnexpected(error);
+    }
+  }
+  started_ = true;
+  sampling_ = true;
+  stopRequested_ = false;
+  startTime_ = std::chrono::steady_clock::now();
+  LOG(INFO) << "Started CPU profile of " << profiledThreads_.size()
+            << " threads for " << params.durationSec << "s at "
+            << params.samplingHz << "Hz";
+
+  const auto deadline = startTime_ + std::chrono::seconds(params.durationSec);
+  stopper_ = std::thread([this, deadline]() {
+    std::unique_lock<std::mutex> stopperLock(mutex_);
+    stopperCv_.wait_until(
+        stopperLock, deadline, [this]() { return stopRequested_; });
+    if (sampling_) {
+      stopSampling();
+    }
+  });
+  return folly::unit;
+}
+
+folly::Expected<thrift::CpuProfile, std::string>
+CpuProfiler::stop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (not started_) {
+    return folly::makeUnexpected(std::string("No profile was started"));
+  }
+  stopRequested_ = true;
+  stopperCv_.notify_all();
+  lock.unlock();
+  if (stopper_.joinable()) {
+    stopper_.join();
+  }
+  lock.lock();
+  if (sampling_) {
+    stopSampling();
+  }
+  started_ = false;
+  return buildProfile();
+}
+
+void
+CpuProfiler::stopSampling() {
+  for (auto& thread : profiledThreads_) {
+    if (thread.timer) {
+      timer_delete(thread.timer);
+      thread.timer = nullptr;
+    }
+    thread.cpuTimeEnd = getCpuTime(thread.info.cpuClock);
+  }
+  gSampling.store(false, std::memory_order_release);
+  // signals pending or being handled may still record a sample
+  while (gHandlersInFlight.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  sampling_ = false;
+  stopTime_ = std::chrono::steady_clock::now();
+  LOG(INFO) << "Stopped CPU profile";
+}
+
+thrift::CpuProfile
+CpuProfiler::buildProfile() {
+  thrift::CpuProfile profile;
+  const auto numSamples = std::min(gNumSamples.load(), kMaxSamples);
+  profile.numSamples = numSamples;
+  profile.numDroppedSamples = gNumDroppedSamples.load();
+  profile.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           stopTime_ - startTime_)
+                           .count();
+
+  std::unordered_map<pid_t, std::string> threadNames;
+  for (auto const& thread : profiledThreads_) {
+    threadNames.emplace(thread.info.tid, thread.name);
+    profile.threadCpuTimeUs[thread.name] =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            thread.cpuTimeEnd - thread.cpuTimeStart)
+            .count();
+  }
+
+  // symbolize every address once
+  std::set<uintptr_t> addressSet;
+  for (size_t i = 0; i < numSamples; ++i) {
+    auto const& sample = gSamples[i];
+    for (size_t j = kSkipFrames; j < sample.numFrames; ++j) {
+      addressSet.emplace(sample.frames[j]);
+    }
+  }
+  std::vector<uintptr_t> addresses(addressSet.begin(), addressSet.end());
+  std::vector<folly::symbolizer::SymbolizedFrame> frames(addresses.size());
+  folly::symbolizer::Symbolizer symbolizer(
+      folly::symbolizer::LocationInfoMode::DISABLED);
+  symbolizer.symbolize(addresses.data(), frames.data(), addresses.size());
+  std::unordered_map<uintptr_t, std::string> names;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    names.emplace(
+        addresses[i],
+        frames[i].found and frames[i].name
+            ? folly::demangle(frames[i].name).toStdString()
+            : folly::sformat("{:#x}", addresses[i]));
+  }
+
+  // "<thread>;<outermost frame>;...;<innermost frame>"
+  for (size_t i = 0; i < numSamples; ++i) {
+    auto const& sample = gSamples[i];
+    auto it = threadNames.find(sample.tid);
+    std::string stack = it != threadNames.end()
+        ? it->second
+        : folly::to<std::string>(sample.tid);
+    for (size_t j = sample.numFrames; j > kSkipFrames; --j) {
+      stack += ';';
+      stack += names.at(sample.frames[j - 1]);
+    }
+    ++profile.foldedStacks[stack];
+  }
+  return profile;
+}
+
+} // namespace openr
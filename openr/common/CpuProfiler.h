@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <time.h>
+
+#include <folly/Expected.h>
+#include <folly/Unit.h>
+
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+//
+// Sampling CPU profiler of named threads, e.g. the module threads. Threads
+// register themselves by name, a profile then samples the stacks of some of
+// them for a bounded duration.
+//
+// Each profiled thread gets a timer on its CPU clock, signaling it (SIGPROF)
+// every 1/samplingHz seconds of CPU time it uses. The signal handler records
+// the stack of the thread in a buffer allocated once, samples past it are
+// counted as dropped. Idle threads cost nothing, and samples are symbolized
+// and folded only once the profile is collected.
+//
+// Process wide as signal handlers are, one profile may run at a time.
+//
+class CpuProfiler {
+ public:
+  static CpuProfiler& get();
+
+  // register the calling thread under name, for profiles of it
+  void registerThread(std::string const& name);
+
+  // names of the registered threads
+  std::vector<std::string> getThreadNames() const;
+
+  // start sampling the threads of params, all registered ones if none, for
+  // its duration. Fails if a profile is running or params are invalid
+  folly::Expected<folly::Unit, std::string> start(
+      thrift::CpuProfileParams const& params);
+
+  // stop sampling if still running and return the profile. Fails if no
+  // profile was started
+  folly::Expected<thrift::CpuProfile, std::string> stop();
+
+  ~CpuProfiler();
+
+ private:
+  CpuProfiler() = default;
+
+  CpuProfiler(CpuProfiler const&) = delete;
+  CpuProfiler& operator=(CpuProfiler const&) = delete;
+
+  struct ThreadInfo {
+    pid_t tid{0};
+    clockid_t cpuClock{0};
+  };
+
+  struct ProfiledThread {
+    std::string name;
+    ThreadInfo info;
+    timer_t timer{nullptr};
+    // CPU time of the thread when sampling started and stopped
+    std::chrono::nanoseconds cpuTimeStart{0};
+    std::chrono::nanoseconds cpuTimeEnd{0};
+  };
+
+  // disarm the timers and wait for handlers in flight. Called with mutex_
+  // held
+  void stopSampling();
+
+  // symbolize and fold the samples. Called with mutex_ held
+  thrift::CpuProfile buildProfile();
+
+  mutable std::mutex mutex_;
+
+  std::unordered_map<std::string, ThreadInfo> threads_;
+
+  // threads of the current profile
+  std::vector<ProfiledThread> profiledThreads_;
+  bool started_{false};
+  bool sampling_{false};
+  std::chrono::steady_clock::time_point startTime_;
+  std::chrono::steady_clock::time_point stopTime_;
+
+  // stops sampling once the duration elapsed
+  std::thread stopper_;
+  std::condition_variable stopperCv_;
+  bool stopRequested_{false};
+};
+
+} // namespace openr
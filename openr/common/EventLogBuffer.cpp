@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/EventLogBuffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <openr/common/Constants.h>
+
+namespace openr {
+
+constexpr size_t EventLogRecord::kMaxFields;
+constexpr size_t EventLogRecord::kDataSize;
+
+void
+EventLogRecord::reset() {
+  timestamp_ = std::chrono::system_clock::now();
+  numFields_ = 0;
+  dataSize_ = 0;
+  truncated_ = false;
+}
+
+EventLogRecord::Field*
+EventLogRecord::addField(const char* name, FieldType type, size_t size) {
+  if (numFields_ == kMaxFields or size > kDataSize - dataSize_) {
+    truncated_ = true;
+    return nullptr;
+  }
+  auto& field = fields_[numFields_++];
+  field.name = name;
+  field.type = type;
+  field.offset = dataSize_;
+  field.size = size;
+  field.intValue = 0;
+  dataSize_ += size;
+  return &field;
+}
+
+void
+EventLogRecord::addString(const char* name, folly::StringPiece value) {
+  auto field = addField(name, STRING, value.size());
+  if (field) {
+    std::memcpy(data_.data() + field->offset, value.data(), value.size());
+  }
+}
+
+void
+EventLogRecord::addInt(const char* name, int64_t value) {
+  auto field = addField(name, INT, 0);
+  if (field) {
+    field->intValue = value;
+  }
+}
+
+void
+EventLogRecord::addStringVector(
+    const char* name, const std::vector<std::string>& values) {
+  size_t size{0};
+  for (auto const& value : values) {
+    size += value.size() + 1;
+  }
+  auto field = addField(name, STRING_VECTOR, size);
+  if (not field) {
+    return;
+  }
+  auto out = data_.data() + field->offset;
+  for (auto const& value : values) {
+    std::memcpy(out, value.data(), value.size());
+    out[value.size()] = '\0';
+    out += value.size() + 1;
+  }
+}
+
+fbzmq::LogSample
+EventLogRecord::toLogSample() const {
+  fbzmq::LogSample sample(timestamp_);
+  for (size_t i = 0; i < numFields_; ++i) {
+    auto const& field = fields_[i];
+    folly::StringPiece data(data_.data() + field.offset, field.size);
+    switch (field.type) {
+    case STRING:
+      sample.addString(field.name, data);
+      break;
+    case INT:
+      sample.addInt(field.name, field.intValue);
+      break;
+    case STRING_VECTOR: {
+      std::vector<std::string> values;
+      while (not data.empty()) {
+        auto end = data.find('\0');
+        values.emplace_back(data.subpiece(0, end).str());
+        data.advance(end + 1);
+      }
+      sample.addStringVector(field.name, values);
+      break;
+    }
+    }
+  }
+  return sample;
+}
+
+EventLogBuffer::EventLogBuffer(size_t ringCapacity)
+    : ringCapacity_(std::max<size_t>(1, ringCapacity)) {}
+
+EventLogBuffer&
+EventLogBuffer::get() {
+  // never destroyed, modules may log until the process exits
+  static auto buffer = new EventLogBuffer(Constants::kEventLogRingSize);
+  return *buffer;
+}
+
+EventLogBuffer::Ring&
+EventLogBuffer::getThreadRing() {
+  auto& ring = *threadRing_;
+  if (not ring) {
+    ring = std::make_shared<Ring>(ringCapacity_);
+    rings_.wlock()->emplace_back(ring);
+  }
+  return *ring;
+}
+
+bool
+EventLogBuffer::log(folly::FunctionRef<void(EventLogRecord&)> fill) {
+  auto& ring = getThreadRing();
+  const auto tail = ring.tail.load(std::memory_order_relaxed);
+  if (tail - ring.head.load(std::memory_order_acquire) == ringCapacity_) {
+    ring.numDropped.store(
+        ring.numDropped.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    return false;
+  }
+
+  auto& record = ring.records[tail % ringCapacity_];
+  record.reset();
+  fill(record);
+  if (record.isTruncated()) {
+    ring.numTruncated.store(
+        ring.numTruncated.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+  }
+  ring.tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+std::vector<std::string>
+EventLogBuffer::drain(size_t maxRecords) {
+  std::vector<std::string> samples;
+  auto rings = rings_.wlock();
+  for (auto it = rings->begin(); it != rings->end();) {
+    auto& ring = **it;
+    auto head = ring.head.load(std::memory_order_relaxed);
+    const auto tail = ring.tail.load(std::memory_order_acquire);
+    for (; head != tail and samples.size() < maxRecords; ++head) {
+      samples.emplace_back(
+          ring.records[head % ringCapacity_].toLogSample().toJson());
+    }
+    ring.head.store(head, std::memory_order_release);
+
+    // release rings of exited threads once drained
+    if (head == tail and it->use_count() == 1) {
+      numLoggedReleased_ += tail;
+      numDroppedReleased_ += ring.numDropped.load(std::memory_order_relaxed);
+      numTruncatedReleased_ +=
+          ring.numTruncated.load(std::memory_order_relaxed);
+      it = rings->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  numDrained_ += samples.size();
+  return samples;
+}
+
+std::unordered_map<std::string, int64_t>
+EventLogBuffer::getCounters() const {
+  auto rings = rings_.rlock();
+  uint64_t numLogged = numLoggedReleased_;
+  uint64_t numDropped = numDroppedReleased_;
+  uint64_t numTruncated = numTruncatedReleased_;
+  for (auto const& ring : *rings) {
+    numLogged += ring->tail.load(std::memory_order_relaxed);
+    numDropped += ring->numDropped.load(std::memory_order_relaxed);
+    numTruncated += ring->numTruncated.load(std::memory_order_relaxed);
+  }
+  std::unordered_map<std::string, int64_t> counters;
+  counters["event_log.logged"] = numLogged;
+  counters["event_log.dropped"] = numDropped;
+  counters["event_log.truncated"] = numTruncated;
+  counters["event_log.drained"] = numDrained_.load();
+  counters["event_log.threads"] = rings->size();
+  return counters;
+}
+
+} // namespace openr
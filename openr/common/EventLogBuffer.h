@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fbzmq/service/logging/LogSample.h>
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+
+namespace openr {
+
+/**
+ * Event of the event log in binary form: fields refer to a fixed size data
+ * area of the record, nothing is allocated while it is filled. Field names
+ * are not copied and must outlive the record, e.g. string literals. Fields
+ * not fitting the record are dropped and the record marked truncated.
+ */
+class EventLogRecord {
+ public:
+  static constexpr size_t kMaxFields{8};
+  static constexpr size_t kDataSize{512};
+
+  void addString(const char* name, folly::StringPiece value);
+  void addInt(const char* name, int64_t value);
+  void addStringVector(
+      const char* name, const std::vector<std::string>& values);
+
+  bool
+  isTruncated() const {
+    return truncated_;
+  }
+
+  // sample of the record, timestamped when it was logged
+  fbzmq::LogSample toLogSample() const;
+
+ private:
+  friend class EventLogBuffer;
+
+  enum FieldType : uint8_t {
+    STRING = 0,
+    INT = 1,
+    // strings separated by '\0'
+    STRING_VECTOR = 2,
+  };
+
+  struct Field {
+    const char* name{nullptr};
+    FieldType type{STRING};
+    uint16_t offset{0};
+    uint16_t size{0};
+    int64_t intValue{0};
+  };
+
+  void reset();
+
+  // room for a field of size bytes of data, nullptr if it doesn't fit
+  Field* addField(const char* name, FieldType type, size_t size);
+
+  std::chrono::system_clock::time_point timestamp_;
+  std::array<Field, kMaxFields> fields_;
+  uint8_t numFields_{0};
+  uint16_t dataSize_{0};
+  bool truncated_{false};
+  std::array<char, kDataSize> data_;
+};
+
+/**
+ * Buffer of event logs, taking them off the hot threads of the modules.
+ *
+ * Every logging thread fills records in place in a ring of its own, single
+ * producer single consumer and lock-free. A single drainer takes them off
+ * all rings in batches and serializes them to LogSamples off the logging
+ * threads. Events logged while the ring of their thread is full are dropped
+ * and counted.
+ */
+class EventLogBuffer {
+ public:
+  explicit EventLogBuffer(size_t ringCapacity);
+
+  // process wide buffer the modules log their events to
+  static EventLogBuffer& get();
+
+  /**
+   * Log an event, fill fills its record in place on the calling thread.
+   * False if it was dropped as the ring of the thread is full
+   */
+  bool log(folly::FunctionRef<void(EventLogRecord&)> fill);
+
+  /**
+   * Take up to maxRecords events off the rings, oldest first within a ring,
+   * serialized to JSON samples. Not thread safe with respect to itself
+   */
+  std::vector<std::string> drain(size_t maxRecords);
+
+  // counters of logged, dropped, truncated and drained events
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
+ private:
+  // ring of a thread. Written by it, read by the drainer
+  struct Ring {
+    explicit Ring(size_t capacity) : records(capacity) {}
+
+    std::vector<EventLogRecord> records;
+    // next record to drain, advanced by the drainer
+    alignas(64) std::atomic<uint64_t> head{0};
+    // next record to fill, advanced by the thread. Also the number of events
+    // logged by it
+    alignas(64) std::atomic<uint64_t> tail{0};
+    // written by the thread only
+    std::atomic<uint64_t> numDropped{0};
+    std::atomic<uint64_t> numTruncated{0};
+  };
+
+  // ring of the calling thread, registered with the drainer on first use
+  Ring& getThreadRing();
+
+  const size_t ringCapacity_{0};
+
+  // rings of the threads, also owned by the rings_ of the drainer until
+  // they are drained after their thread exited
+  folly::ThreadLocal<std::shared_ptr<Ring>> threadRing_;
+  folly::Synchronized<std::vector<std::shared_ptr<Ring>>> rings_;
+
+  // counters of the rings released after their thread exited, and of the
+  // drainer. Written by the drainer only
+  std::atomic<uint64_t> numLoggedReleased_{0};
+  std::atomic<uint64_t> numDroppedReleased_{0};
+  std::atomic<uint64_t> numTruncatedReleased_{0};
+  std::atomic<uint64_t> numDrained_{0};
+};
+
+} // namespace openr
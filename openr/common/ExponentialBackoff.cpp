@@ -87,6 +87,12 @@ ExponentialBackoff<Duration>::getMaxBackoff() const {
   return maxBackoff_;
 }
 
+template <typename Duration>
+Duration
+ExponentialBackoff<Duration>::getCurrentBackoff() const {
+  return currentBackoff_;
+}
+
 // define template instance for some common usecases
 template class ExponentialBackoff<std::chrono::microseconds>;
 template class ExponentialBackoff<std::chrono::milliseconds>;
@@ -82,6 +82,7 @@ class ExponentialBackoff {
    */
   Duration getInitialBackoff() const;
   Duration getMaxBackoff() const;
+  Duration getCurrentBackoff() const;
 
  private:
   Duration initialBackoff_;
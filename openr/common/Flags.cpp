@@ -50,6 +50,11 @@ DEFINE_string(
     platform_pub_url,
     "ipc:///tmp/platform-pub-url",
     "Publisher URL for interface/address notifications");
+DEFINE_int32(
+    platform_event_coalesce_ms,
+    10,
+    "Window for coalescing netlink link/address events into a single "
+    "batched notification, 0 to publish every event as it arrives");
 DEFINE_string(
     domain,
     "terragraph",
@@ -85,6 +90,26 @@ DEFINE_bool(enable_prefix_alloc, false, "Enable automatic prefix allocation");
 DEFINE_int32(alloc_prefix_len, 128, "Allocated prefix length");
 DEFINE_bool(static_prefix_alloc, false, "Perform static prefix allocation");
 DEFINE_bool(per_prefix_keys, false, "Create per IP prefix keys in Kvstore");
+DEFINE_int32(
+    prefix_db_shards,
+    1,
+    "Number of Kvstore keys the prefix database is split across when "
+    "per_prefix_keys is not set. With 1 a single key is used");
+DEFINE_bool(
+    enable_prefix_aggregation,
+    false,
+    "Advertise aggregates of contiguous prefixes of the same type and "
+    "forwarding attributes instead of the prefixes themselves");
+DEFINE_int32(
+    prefix_aggregation_min_v4_length,
+    16,
+    "Shortest IPv4 aggregate advertised, shorter prefixes are advertised as "
+    "they are");
+DEFINE_int32(
+    prefix_aggregation_min_v6_length,
+    48,
+    "Shortest IPv6 aggregate advertised, shorter prefixes are advertised as "
+    "they are");
 DEFINE_bool(
     set_loopback_address,
     false,
@@ -141,6 +166,69 @@ DEFINE_bool(
     enable_ordered_fib_programming,
     false,
     "Enable ordered fib programming per RFC 6976");
+DEFINE_bool(
+    fib_prioritize_host_routes,
+    true,
+    "Program host routes, mostly loopbacks of other nodes, before other "
+    "unicast routes");
+DEFINE_string(
+    fib_priority_prefixes,
+    "",
+    "Comma separated list of prefixes. Unicast routes within them are "
+    "programmed before other routes");
+DEFINE_bool(
+    fib_warm_boot,
+    false,
+    "On start, only program the difference between computed routes and the "
+    "ones found in switch agent. Routes of agent which are no longer computed "
+    "are deleted gradually afterwards");
+DEFINE_int32(
+    route_trace_buffer_size,
+    0,
+    "Number of latest route changes traced by Decision and Fib in memory, "
+    "retrievable through getDecisionRouteTrace and getFibRouteTrace. "
+    "Route tracing is disabled with 0");
+DEFINE_int32(
+    convergence_trace_buffer_size,
+    0,
+    "Number of latest sampled convergence events traced by Fib in memory, "
+    "with the time spent in every stage, retrievable through "
+    "getConvergenceTrace. Requires enable_perf_measurement, disabled with 0");
+DEFINE_int32(
+    convergence_trace_sample_rate,
+    1,
+    "Trace one of every N convergence events logged by Fib");
+DEFINE_string(
+    fib_route_export_path,
+    "",
+    "File Fib exports its route database to, memory mapped by local readers "
+    "for lookups without RPC. Export is disabled if empty");
+DEFINE_int32(
+    fib_batch_min_routes,
+    100,
+    "Min number of routes per route programming call to the FIB agent when "
+    "batching, see fib_batch_max_routes");
+DEFINE_int32(
+    fib_batch_max_routes,
+    0,
+    "Max number of routes per route programming call to the FIB agent. The "
+    "batch size and number of concurrent calls are adapted to the agent "
+    "latency within bounds. Routes are sent in a single call if 0");
+DEFINE_int32(
+    fib_batch_max_concurrency,
+    1,
+    "Max number of concurrent route programming calls to the FIB agent when "
+    "batching");
+DEFINE_int32(
+    fib_batch_target_latency_ms,
+    1000,
+    "Latency of route programming calls to the FIB agent above which batches "
+    "are made smaller");
+DEFINE_bool(
+    fib_prune_failed_neighbors,
+    false,
+    "Prune nexthops whose neighbor fails to resolve (ARP/ND) from routes "
+    "right away, while their interface stays up. Restored once resolved");
 DEFINE_bool(
     enable_bgp_route_programming,
     true,
@@ -180,6 +268,12 @@ DEFINE_int32(
     spark2_hello_fastinit_time_ms,
     500,
     "Fast init hello msg interval (in milliseconds) to do node advertisement");
+DEFINE_int32(
+    spark2_hello_max_time_s,
+    0,
+    "If above spark2_hello_time_s, hello msg interval (in seconds) backs off "
+    "up to this on interfaces whose neighbors are all established and stable. "
+    "Requires spark2_increase_hello_interval");
 DEFINE_int32(
     spark2_heartbeat_time_s,
     1,
@@ -199,6 +293,28 @@ DEFINE_int32(
     5,
     "How long (in seconds) to keep neighbor adjacency without receiving "
     "any heartbeat packet in stable state.");
+DEFINE_string(
+    spark2_fast_detection_config,
+    "",
+    "Comma separated <ifNameRegex>:<txIntervalMs>:<multiplier> list. Spark2 "
+    "neighbors on matching interfaces get declared down after <multiplier> "
+    "missed fast detection packets. Empty disables fast failure detection");
+DEFINE_int32(
+    spark2_fast_detection_port,
+    6667,
+    "UDP port for Spark2 fast failure detection packets");
+DEFINE_int32(
+    spark_num_shards,
+    1,
+    "Number of Spark threads the interfaces are split across, each with its "
+    "own socket and neighbors. Thread of shard N > 0 is named SparkN. Fast "
+    "failure detection requires a single shard");
+DEFINE_bool(
+    enable_io_uring,
+    false,
+    "If set, Spark and the netlink socket send and receive batches of "
+    "messages through io_uring, falling back to plain syscalls if the kernel "
+    "or the build lacks it");
 DEFINE_bool(
     enable_netlink_fib_handler,
     false,
@@ -207,6 +323,20 @@ DEFINE_bool(
     enable_netlink_system_handler,
     true,
     "If set, netlink system handler will be started");
+DEFINE_bool(
+    enable_nexthop_objects,
+    false,
+    "If set, netlink fib handler programs unicast routes through kernel "
+    "nexthop groups shared by routes with the same nexthops (linux 5.3+)");
+DEFINE_int32(
+    netlink_message_window,
+    2000,
+    "Max number of netlink requests sent to the kernel but not yet acked");
+DEFINE_int32(
+    netlink_route_sockets,
+    1,
+    "Number of netlink sockets programming unicast routes in parallel, each "
+    "with its own thread. Routes are sharded between them by prefix");
 DEFINE_int32(
     ip_tos,
     openr::Constants::kIpTos,
@@ -224,6 +354,31 @@ DEFINE_int32(
     link_flap_max_backoff_ms,
     60000,
     "Max backoff to dampen link flaps (in millseconds)");
+DEFINE_bool(
+    enable_link_flap_dampening,
+    false,
+    "Suppress interfaces and adjacencies which keep flapping, based on a "
+    "penalty added per flap which decays exponentially");
+DEFINE_int32(
+    link_flap_penalty, 1000, "Penalty added to an interface/adjacency per flap");
+DEFINE_int32(
+    link_flap_suppress_threshold,
+    2000,
+    "Interface/adjacency is suppressed once its flap penalty reaches this");
+DEFINE_int32(
+    link_flap_reuse_threshold,
+    750,
+    "Suppressed interface/adjacency is reused once its flap penalty decayed "
+    "below this");
+DEFINE_int32(
+    link_flap_half_life_s,
+    15,
+    "Time for the flap penalty to decay to half of its value (in seconds)");
+DEFINE_int32(
+    link_flap_max_suppress_s,
+    60,
+    "Max time an interface/adjacency stays suppressed after its last flap "
+    "(in seconds)");
 DEFINE_bool(
     enable_perf_measurement,
     true,
@@ -238,6 +393,69 @@ DEFINE_int32(
     250,
     "Decision debounce time to update spf in frequent adj db update "
     "(in milliseconds)");
+DEFINE_int32(
+    decision_compute_duty_cycle_pct,
+    0,
+    "If set, Decision picks its debounce window between "
+    "decision_debounce_min_ms and decision_debounce_max_ms from the measured "
+    "cost of route computations and the rate of updates, aiming at spending "
+    "this share of time (in percent) computing routes");
+DEFINE_int32(
+    decision_route_build_threads,
+    1,
+    "Number of threads decision uses to create unicast routes in parallel "
+    "for large prefix tables");
+DEFINE_bool(
+    decision_async_route_compute,
+    false,
+    "Compute routes on a dedicated thread off the decision event loop. "
+    "Computations superseded by newer updates are abandoned");
+DEFINE_int32(
+    decision_max_prefixes_per_node,
+    0,
+    "Maximum number of prefixes decision accepts from a single node, the ones "
+    "of lowest priority are left out of route computation. 0 for no limit");
+DEFINE_int32(
+    decision_max_prefixes,
+    0,
+    "Maximum number of distinct prefixes decision computes routes for in an "
+    "area, the ones of lowest priority are left out. 0 for no limit");
+DEFINE_string(
+    decision_allowed_prefix_types,
+    "",
+    "Comma separated list of prefix types (e.g. LOOPBACK,BGP) decision "
+    "accepts. All types if empty");
+DEFINE_string(
+    decision_prefix_type_priorities,
+    "LOOPBACK",
+    "Comma separated list of prefix types by decreasing priority, prefixes of "
+    "higher priority are accepted first when a prefix limit is exceeded");
+DEFINE_int32(
+    decision_min_v4_prefix_length,
+    0,
+    "Shortest v4 prefix decision accepts, loopback prefixes excepted");
+DEFINE_int32(
+    decision_max_v4_prefix_length,
+    32,
+    "Longest v4 prefix decision accepts, loopback prefixes excepted");
+DEFINE_int32(
+    decision_min_v6_prefix_length,
+    0,
+    "Shortest v6 prefix decision accepts, loopback prefixes excepted");
+DEFINE_int32(
+    decision_max_v6_prefix_length,
+    128,
+    "Longest v6 prefix decision accepts, loopback prefixes excepted");
+DEFINE_string(
+    decision_snapshot_filepath,
+    "",
+    "File the link and prefix state of Decision is periodically snapshot to. "
+    "Restored on start to compute routes right away, within the graceful "
+    "restart window. Disabled if empty");
+DEFINE_int32(
+    decision_snapshot_interval_s,
+    openr::Constants::kDecisionSnapshotInterval.count(),
+    "Interval in seconds of Decision snapshots");
 DEFINE_bool(
     enable_watchdog,
     true,
@@ -245,6 +463,11 @@ DEFINE_bool(
     "openr thread, if unhealthy thread is detected, force crash openr");
 DEFINE_int32(watchdog_interval_s, 20, "Watchdog thread healthcheck interval");
 DEFINE_int32(watchdog_threshold_s, 300, "Watchdog thread aliveness threshold");
+DEFINE_int32(
+    watchdog_stall_warning_threshold_ms,
+    250,
+    "Watchdog warns about event loops which got delayed for longer than this "
+    "since the previous healthcheck");
 DEFINE_bool(
     enable_segment_routing, false, "Flag to disable/enable segment routing");
 DEFINE_bool(set_leaf_node, false, "Flag to enable/disable node as a leaf node");
@@ -259,6 +482,28 @@ DEFINE_string(
     "Only keys with originator ID matching any of the originator ID will "
     "be added to kvstore.");
 DEFINE_int32(memory_limit_mb, 300, "Memory limit in MB");
+DEFINE_int32(
+    memory_pressure_pct,
+    90,
+    "Percentage of memory_limit_mb above which the watchdog asks modules to "
+    "shed caches and compact their state, before it would crash Open/R");
+DEFINE_bool(
+    enable_module_memory_arenas,
+    false,
+    "Give every module thread a jemalloc arena of its own, exporting the "
+    "memory allocated by each one as memory.<module>.allocated_bytes");
+DEFINE_string(
+    thread_placement,
+    "",
+    "CPU pinning and nice value of module threads, as "
+    "'<module>:<cpus>[:<nice>]' separated by ';', e.g. "
+    "'Spark:0:-10;KvStore:1;Decision:node1'. cpus is a CPU list, node<N> for "
+    "the CPUs of a NUMA node or empty to not pin. 'auto' for the built-in "
+    "layout. Empty, the default, leaves placement to the scheduler");
+DEFINE_bool(
+    thread_numa_local_alloc,
+    true,
+    "Allocate memory of pinned module threads on their local NUMA node");
 DEFINE_int32(
     kvstore_zmq_hwm,
     openr::Constants::kHighWaterMark,
@@ -283,10 +528,95 @@ DEFINE_int32(
     kvstore_ttl_decrement_ms,
     openr::Constants::kTtlDecrement.count(),
     "Amount of time to decrement TTL when flooding updates");
+DEFINE_int32(
+    kvstore_merge_threads,
+    1,
+    "Number of threads kvstore uses to merge large publications in parallel. "
+    "Keys are sharded across threads by their hash");
+DEFINE_string(
+    kvstore_snapshot_filepath,
+    "",
+    "File KvStore is periodically snapshot to, and pre-populated from on "
+    "start to speed up convergence after restarts. Disabled if empty");
+DEFINE_int32(
+    kvstore_snapshot_interval_s,
+    openr::Constants::kKvStoreSnapshotInterval.count(),
+    "Interval in seconds of KvStore snapshots");
+DEFINE_bool(
+    enable_kvstore_thrift_peers,
+    false,
+    "Talk to KvStore peers advertising an OpenrCtrl thrift port over thrift "
+    "instead of ZMQ. Other peers are still reached over ZMQ");
+DEFINE_bool(
+    enable_kvstore_multi_root_flooding,
+    false,
+    "Spread keys originated by this node across the flooding trees of all "
+    "flood roots by key hash, instead of flooding along the tree of the "
+    "smallest root. Requires flood optimization");
+DEFINE_string(
+    kvstore_flood_priority_key_prefixes,
+    "adj:,prefix:",
+    "Comma separated key prefixes of KvStore flood classes in decreasing "
+    "priority, other keys are of the lowest class. With flooding rate "
+    "limited, each class gets the configured rate and keys of a class wait "
+    "for those of higher classes to be flooded");
+DEFINE_int64(
+    kvstore_max_keys_per_originator,
+    0,
+    "Max number of keys of an originator in a KvStore area, updates adding "
+    "keys past it are rejected. Unlimited if 0");
+DEFINE_int64(
+    kvstore_max_bytes_per_originator,
+    0,
+    "Max bytes of the keys and values of an originator in a KvStore area, "
+    "updates growing them past it are rejected. Unlimited if 0");
+DEFINE_string(
+    kvstore_export_path_prefix,
+    "",
+    "Mirror the key-values of every KvStore area to a memory mapped file at "
+    "<prefix>.<area>, for local readers to look keys up without going "
+    "through KvStore. Disabled if empty");
+DEFINE_int64(
+    kvstore_lazy_value_threshold_bytes,
+    0,
+    "Values of at least that many bytes are only announced to KvStore peers "
+    "supporting it, which pull each of them once from one announcer. "
+    "Disabled if 0");
+DEFINE_bool(
+    kvstore_partitioned_full_sync,
+    false,
+    "When bulk syncing with several KvStore peers at once, split the key "
+    "space among them and pull each range from one peer, then reconcile "
+    "with a regular full-sync with one of them");
+DEFINE_bool(
+    kvstore_area_event_bases,
+    false,
+    "Run the KvStore of each area on a thread of its own, so that churn in "
+    "an area doesn't delay flooding, TTL expiry and DUAL of the others");
 DEFINE_bool(
     enable_secure_thrift_server,
     false,
     "Flag to enable TLS for our thrift server");
+DEFINE_int32(
+    ctrl_server_high_priority_threads,
+    2,
+    "Threads of the OpenrCtrl server serving HIGH priority methods, the "
+    "KvStore peering and prefix injection control plane");
+DEFINE_int32(
+    ctrl_server_normal_priority_threads,
+    1,
+    "Threads of the OpenrCtrl server serving IMPORTANT and NORMAL priority "
+    "methods each");
+DEFINE_int32(
+    ctrl_server_best_effort_threads,
+    1,
+    "Threads of the OpenrCtrl server serving BEST_EFFORT methods, full dumps "
+    "meant for monitoring");
+DEFINE_int32(
+    ctrl_server_max_queued_requests,
+    1000,
+    "Requests of a priority queued for its threads, past which they are "
+    "rejected as overloaded. Unbounded if 0");
 DEFINE_string(
     x509_cert_path,
     "",
@@ -322,11 +652,11 @@ DEFINE_string(
 DEFINE_int32(
     persistent_store_initial_backoff_ms,
     openr::Constants::kPersistentStoreInitialBackoff.count(),
-    "Initial backoff to save DB to file (in milliseconds)");
+    "Initial backoff to retry saving DB to file (in milliseconds)");
 DEFINE_int32(
     persistent_store_max_backoff_ms,
     openr::Constants::kPersistentStoreMaxBackoff.count(),
-    "Max backoff to save DB to file (in millseconds)");
+    "Max backoff to retry saving DB to file (in millseconds)");
 DEFINE_bool(enable_flood_optimization, false, "Enable flooding optimization");
 DEFINE_bool(is_flood_root, false, "set myself as flooding root or not");
 // TODO this option will be deprecated in near future, this is just for safely
@@ -356,6 +686,15 @@ DEFINE_string(
     iosxr_slapi_port,
     "57777",
     "gRPC TCP port for IOS-XR SL-API");
+DEFINE_int32(
+    iosxr_slapi_batch_size,
+    1000,
+    "Max routes per IOS-XR SL-API request when programming route lists");
+DEFINE_int32(
+    iosxr_slapi_max_inflight,
+    8,
+    "Max IOS-XR SL-API route requests outstanding when programming route "
+    "lists");
 DEFINE_bool(
     enable_iosxrsl_fib_handler,
     false,
@@ -26,6 +26,7 @@ DECLARE_int32(system_agent_port);
 DECLARE_int32(fib_handler_port);
 DECLARE_int32(spark_mcast_port);
 DECLARE_string(platform_pub_url);
+DECLARE_int32(platform_event_coalesce_ms);
 DECLARE_string(domain);
 DECLARE_string(listen_addr);
 DECLARE_string(config_store_filepath);
@@ -40,6 +41,10 @@ DECLARE_bool(enable_prefix_alloc);
 DECLARE_int32(alloc_prefix_len);
 DECLARE_bool(static_prefix_alloc);
 DECLARE_bool(per_prefix_keys);
+DECLARE_int32(prefix_db_shards);
+DECLARE_bool(enable_prefix_aggregation);
+DECLARE_int32(prefix_aggregation_min_v4_length);
+DECLARE_int32(prefix_aggregation_min_v6_length);
 
 DECLARE_bool(set_loopback_address);
 DECLARE_bool(override_loopback_addr);
@@ -57,6 +62,18 @@ DECLARE_bool(enable_v4);
 DECLARE_bool(enable_subnet_validation);
 DECLARE_bool(enable_lfa);
 DECLARE_bool(enable_ordered_fib_programming);
+DECLARE_bool(fib_prioritize_host_routes);
+DECLARE_string(fib_priority_prefixes);
+DECLARE_bool(fib_warm_boot);
+DECLARE_int32(route_trace_buffer_size);
+DECLARE_int32(convergence_trace_buffer_size);
+DECLARE_int32(convergence_trace_sample_rate);
+DECLARE_string(fib_route_export_path);
+DECLARE_int32(fib_batch_min_routes);
+DECLARE_int32(fib_batch_max_routes);
+DECLARE_int32(fib_batch_max_concurrency);
+DECLARE_int32(fib_batch_target_latency_ms);
+DECLARE_bool(fib_prune_failed_neighbors);
 DECLARE_bool(enable_bgp_route_programming);
 DECLARE_bool(bgp_use_igp_metric);
 
@@ -71,21 +88,44 @@ DECLARE_string(spark_cmd_url);
 
 DECLARE_bool(enable_netlink_fib_handler);
 DECLARE_bool(enable_netlink_system_handler);
+DECLARE_bool(enable_nexthop_objects);
+DECLARE_int32(netlink_message_window);
+DECLARE_int32(netlink_route_sockets);
 
 DECLARE_int32(ip_tos);
 DECLARE_int32(zmq_context_threads);
 
 DECLARE_int32(link_flap_initial_backoff_ms);
 DECLARE_int32(link_flap_max_backoff_ms);
+DECLARE_bool(enable_link_flap_dampening);
+DECLARE_int32(link_flap_penalty);
+DECLARE_int32(link_flap_suppress_threshold);
+DECLARE_int32(link_flap_reuse_threshold);
+DECLARE_int32(link_flap_half_life_s);
+DECLARE_int32(link_flap_max_suppress_s);
 
 DECLARE_bool(enable_perf_measurement);
 
 DECLARE_int32(decision_debounce_min_ms);
 DECLARE_int32(decision_debounce_max_ms);
+DECLARE_int32(decision_compute_duty_cycle_pct);
+DECLARE_int32(decision_route_build_threads);
+DECLARE_bool(decision_async_route_compute);
+DECLARE_int32(decision_max_prefixes_per_node);
+DECLARE_int32(decision_max_prefixes);
+DECLARE_string(decision_allowed_prefix_types);
+DECLARE_string(decision_prefix_type_priorities);
+DECLARE_int32(decision_min_v4_prefix_length);
+DECLARE_int32(decision_max_v4_prefix_length);
+DECLARE_int32(decision_min_v6_prefix_length);
+DECLARE_int32(decision_max_v6_prefix_length);
+DECLARE_string(decision_snapshot_filepath);
+DECLARE_int32(decision_snapshot_interval_s);
 
 DECLARE_bool(enable_watchdog);
 DECLARE_int32(watchdog_interval_s);
 DECLARE_int32(watchdog_threshold_s);
+DECLARE_int32(watchdog_stall_warning_threshold_ms);
 
 DECLARE_bool(enable_segment_routing);
 DECLARE_bool(set_leaf_node);
@@ -94,6 +134,10 @@ DECLARE_string(key_prefix_filters);
 DECLARE_string(key_originator_id_filters);
 
 DECLARE_int32(memory_limit_mb);
+DECLARE_int32(memory_pressure_pct);
+DECLARE_bool(enable_module_memory_arenas);
+DECLARE_string(thread_placement);
+DECLARE_bool(thread_numa_local_alloc);
 
 DECLARE_int32(kvstore_zmq_hwm);
 DECLARE_int32(kvstore_flood_msg_per_sec);
@@ -101,8 +145,24 @@ DECLARE_int32(kvstore_flood_msg_burst_size);
 DECLARE_int32(kvstore_key_ttl_ms);
 DECLARE_int32(kvstore_sync_interval_s);
 DECLARE_int32(kvstore_ttl_decrement_ms);
+DECLARE_int32(kvstore_merge_threads);
+DECLARE_string(kvstore_snapshot_filepath);
+DECLARE_int32(kvstore_snapshot_interval_s);
+DECLARE_bool(enable_kvstore_thrift_peers);
+DECLARE_bool(enable_kvstore_multi_root_flooding);
+DECLARE_string(kvstore_flood_priority_key_prefixes);
+DECLARE_int64(kvstore_max_keys_per_originator);
+DECLARE_int64(kvstore_max_bytes_per_originator);
+DECLARE_string(kvstore_export_path_prefix);
+DECLARE_int64(kvstore_lazy_value_threshold_bytes);
+DECLARE_bool(kvstore_partitioned_full_sync);
+DECLARE_bool(kvstore_area_event_bases);
 
 DECLARE_bool(enable_secure_thrift_server);
+DECLARE_int32(ctrl_server_high_priority_threads);
+DECLARE_int32(ctrl_server_normal_priority_threads);
+DECLARE_int32(ctrl_server_best_effort_threads);
+DECLARE_int32(ctrl_server_max_queued_requests);
 DECLARE_string(x509_cert_path);
 DECLARE_string(x509_key_path);
 DECLARE_string(x509_ca_path);
@@ -121,14 +181,21 @@ DECLARE_bool(enable_spark2);
 DECLARE_bool(spark2_increase_hello_interval);
 DECLARE_int32(spark2_hello_time_s);
 DECLARE_int32(spark2_hello_fastinit_time_ms);
+DECLARE_int32(spark2_hello_max_time_s);
 DECLARE_int32(spark2_heartbeat_time_s);
 DECLARE_int32(spark2_handshake_time_ms);
 DECLARE_int32(spark2_negotiate_hold_time_s);
 DECLARE_int32(spark2_heartbeat_hold_time_s);
+DECLARE_string(spark2_fast_detection_config);
+DECLARE_int32(spark2_fast_detection_port);
+DECLARE_int32(spark_num_shards);
+DECLARE_bool(enable_io_uring);
 
 DECLARE_bool(prefix_fwd_type_mpls);
 DECLARE_bool(prefix_algo_type_ksp2_ed_ecmp);
 DECLARE_string(iosxr_slapi_ip);
 DECLARE_string(iosxr_slapi_port);
+DECLARE_int32(iosxr_slapi_batch_size);
+DECLARE_int32(iosxr_slapi_max_inflight);
 DECLARE_bool(enable_iosxrsl_fib_handler);
 DECLARE_bool(enable_iosxrsl_system_handler);
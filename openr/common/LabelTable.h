@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openr/common/Constants.h>
+
+namespace openr {
+
+/**
+ * Map of MPLS label to T. Labels of a dense range, by default the segment
+ * routing global and local ranges Open/R allocates node and adjacency labels
+ * from, are kept in an array indexed by label along with a bitmap of the
+ * labels set. Others fall back to a hash map.
+ *
+ * The array grows up to the highest label set in the range. Iteration visits
+ * the labels of the range in ascending order, then the others in no order.
+ * Like a std::unordered_map, insertion and erasure invalidate iterators.
+ */
+template <typename T>
+class LabelTable {
+ private:
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using Table = std::conditional_t<IsConst, const LabelTable, LabelTable>;
+    using Value = std::conditional_t<IsConst, const T, T>;
+    using SparseIterator = std::conditional_t<
+        IsConst,
+        typename std::unordered_map<int32_t, T>::const_iterator,
+        typename std::unordered_map<int32_t, T>::iterator>;
+    using reference = std::pair<const int32_t, Value&>;
+
+    // pair returned by operator->, which has to return a pointer
+    struct Arrow {
+      reference*
+      operator->() {
+        return &entry;
+      }
+      reference entry;
+    };
+
+    Iterator(Table* table, size_t index, SparseIterator sparseIt)
+        : table_(table), index_(index), sparseIt_(sparseIt) {
+      skipUnset();
+    }
+
+    // iterator to const_iterator
+    template <bool WasConst, typename = std::enable_if_t<IsConst && !WasConst>>
+    /* implicit */ Iterator(const Iterator<WasConst>& other)
+        : table_(other.table_),
+          index_(other.index_),
+          sparseIt_(other.sparseIt_) {}
+
+    reference
+    operator*() const {
+      if (index_ < table_->dense_.size()) {
+        return reference(
+            table_->minLabel_ + static_cast<int32_t>(index_),
+            table_->dense_[index_]);
+      }
+      return reference(sparseIt_->first, sparseIt_->second);
+    }
+
+    Arrow
+    operator->() const {
+      return Arrow{**this};
+    }
+
+    Iterator&
+    operator++() {
+      if (index_ < table_->dense_.size()) {
+        ++index_;
+        skipUnset();
+      } else {
+        ++sparseIt_;
+      }
+      return *this;
+    }
+
+    bool
+    operator==(const Iterator& other) const {
+      return index_ == other.index_ && sparseIt_ == other.sparseIt_;
+    }
+
+    bool
+    operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class LabelTable;
+    template <bool>
+    friend class Iterator;
+
+    void
+    skipUnset() {
+      while (index_ < table_->dense_.size() && !table_->isSet_[index_]) {
+        ++index_;
+      }
+    }
+
+    Table* table_{nullptr};
+    // index in the array, its size once past it
+    size_t index_{0};
+    // position in the hash map, its begin until past the array
+    SparseIterator sparseIt_;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  explicit LabelTable(
+      int32_t minLabel = Constants::kSrGlobalRange.first,
+      int32_t maxLabel = Constants::kSrLocalRange.second)
+      : minLabel_(minLabel), maxLabel_(maxLabel) {}
+
+  size_t
+  size() const {
+    return numDense_ + sparse_.size();
+  }
+
+  bool
+  empty() const {
+    return size() == 0;
+  }
+
+  void
+  clear() {
+    dense_.clear();
+    isSet_.clear();
+    numDense_ = 0;
+    sparse_.clear();
+  }
+
+  iterator
+  begin() {
+    return iterator(this, 0, sparse_.begin());
+  }
+
+  iterator
+  end() {
+    return iterator(this, dense_.size(), sparse_.end());
+  }
+
+  const_iterator
+  begin() const {
+    return const_iterator(this, 0, sparse_.begin());
+  }
+
+  const_iterator
+  end() const {
+    return const_iterator(this, dense_.size(), sparse_.end());
+  }
+
+  iterator
+  find(int32_t label) {
+    if (isInRange(label)) {
+      const size_t index = label - minLabel_;
+      return isSetAt(index) ? iterator(this, index, sparse_.begin()) : end();
+    }
+    return iterator(this, dense_.size(), sparse_.find(label));
+  }
+
+  const_iterator
+  find(int32_t label) const {
+    if (isInRange(label)) {
+      const size_t index = label - minLabel_;
+      return isSetAt(index) ? const_iterator(this, index, sparse_.begin())
+                            : end();
+    }
+    return const_iterator(this, dense_.size(), sparse_.find(label));
+  }
+
+  size_t
+  count(int32_t label) const {
+    if (isInRange(label)) {
+      return isSetAt(label - minLabel_) ? 1 : 0;
+    }
+    return sparse_.count(label);
+  }
+
+  T&
+  at(int32_t label) {
+    return const_cast<T&>(static_cast<const LabelTable*>(this)->at(label));
+  }
+
+  const T&
+  at(int32_t label) const {
+    if (isInRange(label)) {
+      const size_t index = label - minLabel_;
+      if (!isSetAt(index)) {
+        throw std::out_of_range("LabelTable::at");
+      }
+      return dense_[index];
+    }
+    return sparse_.at(label);
+  }
+
+  // value of label, default constructed if not set
+  T&
+  operator[](int32_t label) {
+    if (!isInRange(label)) {
+      return sparse_[label];
+    }
+    const size_t index = label - minLabel_;
+    if (index >= dense_.size()) {
+      dense_.resize(index + 1);
+      isSet_.resize(index + 1, false);
+    }
+    if (!isSet_[index]) {
+      isSet_[index] = true;
+      ++numDense_;
+    }
+    return dense_[index];
+  }
+
+  template <typename V>
+  void
+  insert_or_assign(int32_t label, V&& value) {
+    (*this)[label] = std::forward<V>(value);
+  }
+
+  // Returns the number of entries erased, 0 or 1
+  size_t
+  erase(int32_t label) {
+    if (!isInRange(label)) {
+      return sparse_.erase(label);
+    }
+    const size_t index = label - minLabel_;
+    if (!isSetAt(index)) {
+      return 0;
+    }
+    // release what the value holds
+    dense_[index] = T();
+    isSet_[index] = false;
+    --numDense_;
+    return 1;
+  }
+
+ private:
+  bool
+  isInRange(int32_t label) const {
+    return label >= minLabel_ && label <= maxLabel_;
+  }
+
+  bool
+  isSetAt(size_t index) const {
+    return index < isSet_.size() && isSet_[index];
+  }
+
+  int32_t minLabel_{0};
+  int32_t maxLabel_{0};
+
+  // values of the labels of the range by label - minLabel_, and whether
+  // they are set
+  std::vector<T> dense_;
+  std::vector<bool> isSet_;
+  size_t numDense_{0};
+
+  // values of the labels out of the range
+  std::unordered_map<int32_t, T> sparse_;
+};
+
+} // namespace openr
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/Bits.h>
+
+namespace openr {
+
+constexpr int64_t LatencyHistogram::kMaxValue;
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBucketHalf;
+constexpr size_t LatencyHistogram::kNumBuckets;
+
+size_t
+LatencyHistogram::getBucket(int64_t value) {
+  if (value < (1 << kSubBucketBits)) {
+    return value;
+  }
+  // keep kSubBucketBits most significant bits of value
+  const int shift = folly::findLastSet(static_cast<uint64_t>(value)) -
+      kSubBucketBits;
+  const auto subBucket = (value >> shift) - kSubBucketHalf;
+  return (1 << kSubBucketBits) + (shift - 1) * kSubBucketHalf + subBucket;
+}
+
+int64_t
+LatencyHistogram::getBucketUpperBound(size_t bucket) {
+  if (bucket < (1 << kSubBucketBits)) {
+    return bucket;
+  }
+  const auto index = bucket - (1 << kSubBucketBits);
+  const int shift = index / kSubBucketHalf + 1;
+  const int64_t subBucket = index % kSubBucketHalf + kSubBucketHalf;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+void
+LatencyHistogram::addValue(int64_t valueMs) {
+  valueMs = std::max<int64_t>(0, std::min(valueMs, kMaxValue));
+  min_ = count_ ? std::min(min_, valueMs) : valueMs;
+  max_ = count_ ? std::max(max_, valueMs) : valueMs;
+  sum_ += valueMs;
+  ++count_;
+  ++counts_[getBucket(valueMs)];
+}
+
+int64_t
+LatencyHistogram::getPercentile(double fraction) const {
+  if (not count_) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(
+      1,
+      std::min<uint64_t>(
+          count_, static_cast<uint64_t>(std::ceil(fraction * count_))));
+  uint64_t numValues = 0;
+  for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+    numValues += counts_[bucket];
+    if (numValues >= rank) {
+      return std::max(min_, std::min(getBucketUpperBound(bucket), max_));
+    }
+  }
+  return max_;
+}
+
+thrift::LatencyHistogram
+LatencyHistogram::toThrift() const {
+  thrift::LatencyHistogram histogram;
+  histogram.count = count_;
+  histogram.sumMs = sum_;
+  histogram.minMs = min_;
+  histogram.maxMs = max_;
+  histogram.p50Ms = getPercentile(0.5);
+  histogram.p99Ms = getPercentile(0.99);
+  histogram.p999Ms = getPercentile(0.999);
+  for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+    if (counts_[bucket]) {
+      histogram.bucketCounts.emplace(
+          getBucketUpperBound(bucket), counts_[bucket]);
+    }
+  }
+  return histogram;
+}
+
+} // namespace openr
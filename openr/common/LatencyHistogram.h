@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <openr/if/gen-cpp2/Fib_types.h>
+
+namespace openr {
+
+/**
+ * HDR style histogram of latencies in milliseconds with fixed memory.
+ *
+ * Values below 32ms are counted exactly. Larger values fall into log-linear
+ * buckets, 16 per power of two, hence percentiles are reported within ~6% of
+ * the recorded values. Values above kMaxValue (~4.6h) are clamped.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int64_t kMaxValue{(int64_t{1} << 24) - 1};
+
+  void addValue(int64_t valueMs);
+
+  uint64_t
+  getCount() const {
+    return count_;
+  }
+
+  // value below which the given fraction (e.g. 0.99) of values falls,
+  // 0 if histogram is empty
+  int64_t getPercentile(double fraction) const;
+
+  thrift::LatencyHistogram toThrift() const;
+
+ private:
+  static constexpr int kSubBucketBits{5};
+  static constexpr int kSubBucketHalf{1 << (kSubBucketBits - 1)};
+  static constexpr size_t kNumBuckets{
+      (1 << kSubBucketBits) + (24 - kSubBucketBits) * kSubBucketHalf};
+
+  static size_t getBucket(int64_t value);
+
+  // highest value counted in the bucket
+  static int64_t getBucketUpperBound(size_t bucket);
+
+  std::array<uint64_t, kNumBuckets> counts_{};
+  uint64_t count_{0};
+  int64_t sum_{0};
+  int64_t min_{0};
+  int64_t max_{0};
+};
+
+} // namespace openr
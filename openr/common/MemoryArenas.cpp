@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MemoryArenas.h"
+
+#include <folly/Format.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// MALLCTL_ARENAS_ALL of jemalloc, index addressing all arenas at once
+const unsigned kAllArenas{4096};
+
+folly::Optional<size_t>
+readSize(std::string const& cmd) {
+  if (not folly::usingJEMalloc()) {
+    return folly::none;
+  }
+  try {
+    size_t value{0};
+    folly::mallctlRead(cmd.c_str(), &value);
+    return value;
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to read " << cmd << ": " << e.what();
+    return folly::none;
+  }
+}
+
+} // namespace
+
+folly::Optional<unsigned>
+bindThreadToNewArena() {
+  if (not folly::usingJEMalloc()) {
+    return folly::none;
+  }
+  try {
+    unsigned arena{0};
+    folly::mallctlRead("arenas.create", &arena);
+    folly::mallctlWrite("thread.arena", arena);
+    // flush objects cached by the thread for its previous arena
+    folly::mallctlCall("thread.tcache.flush");
+    return arena;
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to bind thread to a new arena: " << e.what();
+    return folly::none;
+  }
+}
+
+bool
+refreshArenaStats() {
+  if (not folly::usingJEMalloc()) {
+    return false;
+  }
+  try {
+    uint64_t epoch{1};
+    folly::mallctlWrite("epoch", epoch);
+    return true;
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to refresh arena stats: " << e.what();
+    return false;
+  }
+}
+
+folly::Optional<size_t>
+getArenaAllocatedBytes(unsigned arena) {
+  const auto small =
+      readSize(folly::sformat("stats.arenas.{}.small.allocated", arena));
+  const auto large =
+      readSize(folly::sformat("stats.arenas.{}.large.allocated", arena));
+  if (not small.hasValue() or not large.hasValue()) {
+    return folly::none;
+  }
+  return *small + *large;
+}
+
+folly::Optional<size_t>
+getTotalAllocatedBytes() {
+  return readSize("stats.allocated");
+}
+
+bool
+purgeArenas() {
+  if (not folly::usingJEMalloc()) {
+    return false;
+  }
+  try {
+    folly::mallctlCall(folly::sformat("arena.{}.purge", kAllArenas).c_str());
+    return true;
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to purge arenas: " << e.what();
+    return false;
+  }
+}
+
+} // namespace openr
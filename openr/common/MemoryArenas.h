@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+//
+// Memory accounting by jemalloc arena. A module thread allocating from an
+// arena of its own gets its memory accounted separately from the other
+// modules, memory freed by another thread goes back to the arena it came
+// from. All functions return none or false if the process doesn't run on
+// jemalloc or jemalloc fails, which is logged.
+//
+
+/**
+ * Create an arena and make the calling thread allocate from it. Returns its
+ * index
+ */
+folly::Optional<unsigned> bindThreadToNewArena();
+
+/**
+ * Refresh the statistics read by the functions below, they are a snapshot
+ * of the time of the last refresh
+ */
+bool refreshArenaStats();
+
+/**
+ * Bytes allocated from an arena and in use
+ */
+folly::Optional<size_t> getArenaAllocatedBytes(unsigned arena);
+
+/**
+ * Bytes allocated from all arenas and in use
+ */
+folly::Optional<size_t> getTotalAllocatedBytes();
+
+/**
+ * Return the unused dirty pages of all arenas to the operating system
+ */
+bool purgeArenas();
+
+} // namespace openr
@@ -7,8 +7,26 @@
 
 #include "openr/common/NetworkUtil.h"
 
+#include <algorithm>
+
+#include <folly/hash/Hash.h>
+
 namespace std {
 
+/**
+ * Make PrefixKey hashable
+ */
+size_t
+hash<openr::PrefixKey>::operator()(openr::PrefixKey const& key) const {
+  uint64_t high;
+  uint64_t low;
+  std::memcpy(&high, key.addr.data(), sizeof(high));
+  std::memcpy(&low, key.addr.data() + sizeof(high), sizeof(low));
+  return folly::hash::hash_128_to_64(
+      folly::hash::hash_128_to_64(high, low),
+      (static_cast<uint64_t>(key.version) << 8) | key.prefixLength);
+}
+
 /**
  * Make IpPrefix hashable
  */
@@ -82,3 +100,33 @@ hash<openr::thrift::UnicastRoute>::operator()(
 }
 
 } // namespace std
+
+namespace openr {
+
+PrefixKey::PrefixKey(thrift::IpPrefix const& prefix)
+    : prefixLength(static_cast<uint8_t>(prefix.prefixLength)) {
+  auto const& bytes = prefix.prefixAddress.addr;
+  if (bytes.size() == folly::IPAddressV4::byteCount()) {
+    version = 4;
+  } else if (bytes.size() == folly::IPAddressV6::byteCount()) {
+    version = 6;
+  }
+  std::memcpy(addr.data(), bytes.data(), std::min(bytes.size(), addr.size()));
+}
+
+thrift::IpPrefix
+PrefixKey::toIpPrefix() const {
+  thrift::IpPrefix prefix;
+  size_t numBytes = 0;
+  if (version == 4) {
+    numBytes = folly::IPAddressV4::byteCount();
+  } else if (version == 6) {
+    numBytes = folly::IPAddressV6::byteCount();
+  }
+  prefix.prefixAddress.addr.assign(
+      reinterpret_cast<const char*>(addr.data()), numBytes);
+  prefix.prefixLength = prefixLength;
+  return prefix;
+}
+
+} // namespace openr
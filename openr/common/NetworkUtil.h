@@ -7,8 +7,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
+#include <folly/lang/Bits.h>
 #include <thrift/lib/cpp/util/EnumUtils.h>
 #include <thrift/lib/cpp2/Thrift.h>
 
@@ -17,8 +24,67 @@
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 
+namespace openr {
+
+/**
+ * Packed, trivially copyable prefix for internal maps and sets. Unlike
+ * thrift::IpPrefix it holds its address inline, keys need no allocation and
+ * compare and hash in a few instructions. Converted from and to
+ * thrift::IpPrefix at the thrift boundary, the interface name of the address
+ * is not kept.
+ */
+struct PrefixKey {
+  // 4 or 6, 0 if the address is neither v4 nor v6
+  uint8_t version{0};
+  // address bytes, v4 addresses take the first 4 bytes and zero the rest
+  std::array<uint8_t, 16> addr{};
+  uint8_t prefixLength{0};
+
+  PrefixKey() = default;
+
+  explicit PrefixKey(thrift::IpPrefix const& prefix);
+
+  thrift::IpPrefix toIpPrefix() const;
+
+  bool
+  isV4() const {
+    return version == 4;
+  }
+
+  // members are bytes without padding, comparing the memory orders by
+  // version, address and prefix length
+  bool
+  operator==(PrefixKey const& other) const {
+    return std::memcmp(this, &other, sizeof(PrefixKey)) == 0;
+  }
+
+  bool
+  operator!=(PrefixKey const& other) const {
+    return not(*this == other);
+  }
+
+  bool
+  operator<(PrefixKey const& other) const {
+    return std::memcmp(this, &other, sizeof(PrefixKey)) < 0;
+  }
+};
+
+static_assert(
+    std::is_trivially_copyable<PrefixKey>::value and sizeof(PrefixKey) == 18,
+    "PrefixKey must stay packed");
+
+} // namespace openr
+
 namespace std {
 
+/**
+ * Make PrefixKey hashable
+ */
+template <>
+struct hash<openr::PrefixKey> {
+  size_t operator()(openr::PrefixKey const&) const;
+};
+
 /**
  * Make IpPrefix hashable
  */
@@ -105,10 +171,54 @@ toIPAddress(const thrift::BinaryAddress& addr) {
       addr.addr.size()));
 }
 
+/**
+ * Allocation free primitives on raw address bytes in network order, as held
+ * by folly::IPAddress::bytes() or thrift::BinaryAddress::addr. Addresses are
+ * compared a 64-bit word at a time instead of bit by bit.
+ */
+
+// number of leading bits shared by a and b of numBytes bytes, up to maxLen
+inline uint8_t
+getCommonPrefixLength(
+    const uint8_t* a, const uint8_t* b, size_t numBytes, uint8_t maxLen) {
+  size_t len = 0;
+  for (size_t offset = 0; offset < numBytes and len < maxLen; offset += 8) {
+    const size_t wordBytes = std::min<size_t>(8, numBytes - offset);
+    uint64_t wordA = 0;
+    uint64_t wordB = 0;
+    std::memcpy(&wordA, a + offset, wordBytes);
+    std::memcpy(&wordB, b + offset, wordBytes);
+    // first byte in the most significant position
+    const uint64_t diff = folly::Endian::big(wordA ^ wordB);
+    if (diff) {
+      len += __builtin_clzll(diff);
+      break;
+    }
+    len += wordBytes * 8;
+  }
+  return static_cast<uint8_t>(std::min<size_t>(len, maxLen));
+}
+
+// whether the first len bits of a and b of numBytes bytes are equal
+inline bool
+isPrefixEqual(
+    const uint8_t* a, const uint8_t* b, size_t numBytes, uint8_t len) {
+  return getCommonPrefixLength(a, b, numBytes, len) == len;
+}
+
+// Same as folly::IPAddress::createNetwork on the printed prefix, without
+// printing and parsing the address
 inline folly::CIDRNetwork
 toIPNetwork(const thrift::IpPrefix& prefix, bool applyMask = true) {
-  return folly::IPAddress::createNetwork(
-      toIPAddress(prefix.prefixAddress).str(), prefix.prefixLength, applyMask);
+  const auto address = toIPAddress(prefix.prefixAddress);
+  if (prefix.prefixLength < 0 or prefix.prefixLength > address.bitCount()) {
+    throw folly::IPAddressFormatException(folly::sformat(
+        "CIDR value '{}' is > network bit count '{}'",
+        prefix.prefixLength,
+        address.bitCount()));
+  }
+  const uint8_t len = static_cast<uint8_t>(prefix.prefixLength);
+  return {applyMask ? address.mask(len) : address, len};
 }
 
 inline thrift::IpPrefix
@@ -7,8 +7,11 @@
 
 #include "openr/common/OpenrEventBase.h"
 
+#include <folly/Format.h>
 #include <folly/fibers/FiberManagerMap.h>
 
+#include <openr/common/Constants.h>
+
 namespace openr {
 
 namespace {
@@ -47,15 +50,17 @@ EventBaseStopSignalHandler::signalReceived(int signal) noexcept {
 }
 
 OpenrEventBase::ZmqEventHandler::ZmqEventHandler(
-    folly::EventBase* evb,
+    OpenrEventBase* parent,
     int fd,
     uintptr_t socketPtr,
     int zmqEvents,
     fbzmq::SocketCallback callback)
-    : folly::EventHandler(evb, folly::NetworkSocket::fromFd(fd)),
+    : folly::EventHandler(parent->getEvb(), folly::NetworkSocket::fromFd(fd)),
+      parent_(parent),
+      fd_(fd),
       callback_(std::move(callback)),
       ptr_(reinterpret_cast<void*>(socketPtr)) {
-  CHECK(evb);
+  auto evb = parent->getEvb();
   // Register handler
   uint16_t events{folly::EventHandler::PERSIST};
   if (zmqEvents & ZMQ_POLLIN) {
@@ -102,7 +107,9 @@ OpenrEventBase::ZmqEventHandler::handlerReady(uint16_t events) noexcept {
 
   do {
     // Invoke callback
+    const auto start = std::chrono::steady_clock::now();
     callback_(zmqEvents);
+    parent_->recordCallback("socket", fd_, start);
 
     if (ptr_ and (zmqEvents & ZMQ_POLLIN)) {
       // Get socket events after the read
@@ -115,25 +122,104 @@ OpenrEventBase::ZmqEventHandler::handlerReady(uint16_t events) noexcept {
   } while (zmqEvents & ZMQ_POLLIN);
 }
 
+void
+OpenrEventBase::FiberObserver::starting(uintptr_t /* id */) noexcept {
+  start_ = std::chrono::steady_clock::now();
+}
+
+void
+OpenrEventBase::FiberObserver::runnable(uintptr_t /* id */) noexcept {}
+
+void
+OpenrEventBase::FiberObserver::stopped(uintptr_t /* id */) noexcept {
+  parent_->recordCallback("fiber", -1, start_);
+}
+
 OpenrEventBase::OpenrEventBase()
     : fiberManager_(folly::fibers::getFiberManager(evb_, getFmOptions())) {
+  fiberManager_.setObserver(&fiberObserver_);
+
   // Periodic timer to update eventbase's timestamp. This is used by Watchdog to
-  // identify stuck threads.
+  // identify stuck threads. Its delay tells how long callbacks had to wait for
+  // the event loop.
   timestamp_ = getElapsedSeconds();
-  timeout_ = folly::AsyncTimeout::make(evb_, [this]() noexcept {
-    timestamp_ = getElapsedSeconds();
-    timeout_->scheduleTimeout(std::chrono::seconds(1));
-  });
+  nextProbeTime_ = std::chrono::steady_clock::now();
+  timeout_ =
+      folly::AsyncTimeout::make(evb_, [this]() noexcept { probeEventLoop(); });
   timeout_->scheduleTimeout(0);
 }
 
-OpenrEventBase::~OpenrEventBase() {}
+OpenrEventBase::~OpenrEventBase() {
+  // Fibers may still run while evb_ gets destroyed
+  fiberManager_.setObserver(nullptr);
+}
 
 void
 OpenrEventBase::run() {
+  // Time spent before the loop started isn't lag
+  nextProbeTime_ = std::chrono::steady_clock::now();
   evb_.loopForever();
 }
 
+void
+OpenrEventBase::probeEventLoop() {
+  const auto now = std::chrono::steady_clock::now();
+  const auto lag = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now - nextProbeTime_.load());
+  timestamp_ = getElapsedSeconds();
+  nextProbeTime_ = now + Constants::kEventLoopProbeInterval;
+  timeout_->scheduleTimeout(Constants::kEventLoopProbeInterval);
+
+  std::lock_guard<std::mutex> l(loopStatsLock_);
+  loopLagMs_.addValue(lag.count());
+  stallInfo_.maxLag = std::max(stallInfo_.maxLag, lag);
+}
+
+void
+OpenrEventBase::recordCallback(
+    char const* kind, int fd, std::chrono::steady_clock::time_point start) {
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  std::lock_guard<std::mutex> l(loopStatsLock_);
+  callbackDurationMs_.addValue(duration.count());
+  if (duration > stallInfo_.slowestCallbackDuration) {
+    stallInfo_.slowestCallbackDuration = duration;
+    stallInfo_.slowestCallback =
+        fd >= 0 ? folly::sformat("{} fd {}", kind, fd) : kind;
+  }
+}
+
+OpenrEventBase::LoopStallInfo
+OpenrEventBase::getAndResetStallInfo() {
+  LoopStallInfo stallInfo;
+  {
+    std::lock_guard<std::mutex> l(loopStatsLock_);
+    std::swap(stallInfo, stallInfo_);
+  }
+
+  // Loop may be stuck right now, in which case the probe is overdue
+  if (isRunning()) {
+    const auto overdue = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - nextProbeTime_.load());
+    stallInfo.maxLag = std::max(stallInfo.maxLag, overdue);
+  }
+  return stallInfo;
+}
+
+std::unordered_map<std::string, int64_t>
+OpenrEventBase::getEventLoopCounters() const {
+  std::lock_guard<std::mutex> l(loopStatsLock_);
+  return {
+      {"lag_ms.p50", loopLagMs_.getPercentile(0.5)},
+      {"lag_ms.p99", loopLagMs_.getPercentile(0.99)},
+      {"lag_ms.max", loopLagMs_.getPercentile(1.0)},
+      {"callback_ms.p99", callbackDurationMs_.getPercentile(0.99)},
+      {"callback_ms.max", callbackDurationMs_.getPercentile(1.0)},
+      {"num_callbacks", static_cast<int64_t>(callbackDurationMs_.getCount())},
+  };
+}
+
 void
 OpenrEventBase::stop() {
   for (auto& future : fiberTaskFutures_) {
@@ -162,15 +248,21 @@ OpenrEventBase::waitUntilStopped() {
 void
 OpenrEventBase::scheduleTimeout(
     std::chrono::milliseconds timeout, folly::EventBase::Func callback) {
-  evb_.scheduleAt(
-      std::move(callback), timeout + std::chrono::steady_clock::now());
+  scheduleTimeoutAt(
+      timeout + std::chrono::steady_clock::now(), std::move(callback));
 }
 
 void
 OpenrEventBase::scheduleTimeoutAt(
     std::chrono::steady_clock::time_point scheduleTime,
     folly::EventBase::Func callback) {
-  evb_.scheduleAt(std::move(callback), scheduleTime);
+  evb_.scheduleAt(
+      [this, callback = std::move(callback)]() mutable {
+        const auto start = std::chrono::steady_clock::now();
+        callback();
+        recordCallback("timeout", -1, start);
+      },
+      scheduleTime);
 }
 
 void
@@ -183,7 +275,7 @@ OpenrEventBase::addSocketFd(
       std::piecewise_construct,
       std::forward_as_tuple(socketFd),
       std::forward_as_tuple(
-          &evb_,
+          this,
           socketFd,
           reinterpret_cast<uintptr_t>(nullptr),
           events,
@@ -201,7 +293,7 @@ OpenrEventBase::addSocket(
       std::piecewise_construct,
       std::forward_as_tuple(socketFd),
       std::forward_as_tuple(
-          &evb_, socketFd, socketPtr, events, std::move(callback)));
+          this, socketFd, socketPtr, events, std::move(callback)));
 }
 
 void
@@ -8,13 +8,19 @@
 #pragma once
 
 #include <csignal>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/zmq/Socket.h>
+#include <folly/fibers/ExecutionObserver.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/io/async/EventHandler.h>
 
+#include <openr/common/LatencyHistogram.h>
+
 namespace openr {
 
 class EventBaseStopSignalHandler : public folly::AsyncSignalHandler {
@@ -55,7 +61,12 @@ class OpenrEventBase {
    */
   void
   runInEventBaseThread(folly::EventBase::Func callback) {
-    evb_.runInEventBaseThread(std::move(callback));
+    evb_.runInEventBaseThread(
+        [this, callback = std::move(callback)]() mutable {
+          const auto start = std::chrono::steady_clock::now();
+          callback();
+          recordCallback("event_base_thread", -1, start);
+        });
   }
 
   /**
@@ -66,6 +77,37 @@ class OpenrEventBase {
     return timestamp_.load();
   }
 
+  /**
+   * Event loop stall of the event base. Lag is the delay of a periodic probe
+   * callback, i.e. how long anything scheduled on the loop had to wait.
+   */
+  struct LoopStallInfo {
+    // longest lag, including the one of a probe which is overdue
+    std::chrono::milliseconds maxLag{0};
+    // slowest callback of sockets, timeouts and fibers, and its duration
+    std::string slowestCallback;
+    std::chrono::milliseconds slowestCallbackDuration{0};
+  };
+
+  /**
+   * Get the stall info since the previous call and reset it. Thread safe
+   */
+  LoopStallInfo getAndResetStallInfo();
+
+  /**
+   * Lag and callback duration percentiles since start, e.g. "lag_ms.p99".
+   * Thread safe
+   */
+  std::unordered_map<std::string, int64_t> getEventLoopCounters() const;
+
+  /**
+   * Called in the event base thread when the process is running short of
+   * memory, before the watchdog would crash it. Modules override it to shed
+   * caches and compact their state.
+   */
+  virtual void
+  onMemoryPressure() {}
+
   /**
    * Runnable interface APIs
    */
@@ -109,7 +151,7 @@ class OpenrEventBase {
   class ZmqEventHandler : public folly::EventHandler {
    public:
     ZmqEventHandler(
-        folly::EventBase* evb,
+        OpenrEventBase* parent,
         int fd,
         uintptr_t socketPtr,
         int zmqEvents,
@@ -121,6 +163,12 @@ class OpenrEventBase {
     // EventHandler callback. Unblocks read/write wait
     void handlerReady(uint16_t events) noexcept override;
 
+    // Event base the handler is registered with, measures callback time
+    OpenrEventBase* parent_{nullptr};
+
+    // File descriptor, identifies the callback in stall info
+    int fd_{-1};
+
     // Callback for handling event
     fbzmq::SocketCallback callback_;
 
@@ -131,6 +179,34 @@ class OpenrEventBase {
     std::unique_ptr<folly::AsyncTimeout> timeout_;
   };
 
+  /**
+   * Measures the time fiber tasks run between two suspensions
+   */
+  class FiberObserver : public folly::fibers::ExecutionObserver {
+   public:
+    explicit FiberObserver(OpenrEventBase* parent) : parent_(parent) {}
+
+    void starting(uintptr_t id) noexcept override;
+    void runnable(uintptr_t id) noexcept override;
+    void stopped(uintptr_t id) noexcept override;
+
+   private:
+    OpenrEventBase* parent_{nullptr};
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /**
+   * Periodic probe, updates timestamp and measures event loop lag
+   */
+  void probeEventLoop();
+
+  /**
+   * Record duration of a callback which started at start. fd is -1 for
+   * callbacks other than socket ones
+   */
+  void recordCallback(
+      char const* kind, int fd, std::chrono::steady_clock::time_point start);
+
   // EventBase object for async event polling/scheduling
   folly::EventBase evb_;
 
@@ -144,6 +220,17 @@ class OpenrEventBase {
   // Timestamp
   std::atomic<std::chrono::seconds> timestamp_{std::chrono::seconds(0)};
   std::unique_ptr<folly::AsyncTimeout> timeout_;
+
+  // Time the probe is expected to run at
+  std::atomic<std::chrono::steady_clock::time_point> nextProbeTime_;
+
+  FiberObserver fiberObserver_{this};
+
+  // Lock to protect below loop statistics
+  mutable std::mutex loopStatsLock_;
+  LatencyHistogram loopLagMs_;
+  LatencyHistogram callbackDurationMs_;
+  LoopStallInfo stallInfo_;
 };
 
 } // namespace openr
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RouteTrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <openr/common/Util.h>
+
+namespace openr {
+
+RouteTrace::RouteTrace(size_t capacity) : records_(capacity) {}
+
+RouteTrace::Record&
+RouteTrace::next(int64_t timestampMs, thrift::RouteTraceEvent event) {
+  auto& record = records_[numRecorded_++ % records_.size()];
+  record.timestampMs = timestampMs;
+  record.event = static_cast<uint8_t>(event);
+  record.numNextHops = 0;
+  record.addrLen = 0;
+  return record;
+}
+
+void
+RouteTrace::record(const thrift::RouteDatabaseDelta& delta) {
+  if (not isEnabled()) {
+    return;
+  }
+
+  const auto timestampMs = getUnixTimeStampMs();
+  const auto setPrefix = [](Record& record, const thrift::IpPrefix& prefix) {
+    const auto& addr = prefix.prefixAddress.addr;
+    record.addrLen = std::min(addr.size(), record.addr.size());
+    std::memcpy(record.addr.data(), addr.data(), record.addrLen);
+    record.labelOrPrefixLen = prefix.prefixLength;
+  };
+  const auto countNextHops = [](size_t numNextHops) {
+    return static_cast<uint16_t>(std::min<size_t>(
+        numNextHops, std::numeric_limits<uint16_t>::max()));
+  };
+
+  for (const auto& route : delta.unicastRoutesToUpdate) {
+    auto& record =
+        next(timestampMs, thrift::RouteTraceEvent::UNICAST_ROUTE_UPDATE);
+    setPrefix(record, route.dest);
+    record.numNextHops = countNextHops(route.nextHops.size());
+  }
+  for (const auto& prefix : delta.unicastRoutesToDelete) {
+    auto& record =
+        next(timestampMs, thrift::RouteTraceEvent::UNICAST_ROUTE_DELETE);
+    setPrefix(record, prefix);
+  }
+  for (const auto& route : delta.mplsRoutesToUpdate) {
+    auto& record =
+        next(timestampMs, thrift::RouteTraceEvent::MPLS_ROUTE_UPDATE);
+    record.labelOrPrefixLen = route.topLabel;
+    record.numNextHops = countNextHops(route.nextHops.size());
+  }
+  for (const auto& topLabel : delta.mplsRoutesToDelete) {
+    auto& record =
+        next(timestampMs, thrift::RouteTraceEvent::MPLS_ROUTE_DELETE);
+    record.labelOrPrefixLen = topLabel;
+  }
+}
+
+std::vector<thrift::RouteTraceEntry>
+RouteTrace::dump() const {
+  std::vector<thrift::RouteTraceEntry> entries;
+  if (not isEnabled()) {
+    return entries;
+  }
+
+  const auto numRecords = std::min<uint64_t>(numRecorded_, records_.size());
+  entries.reserve(numRecords);
+  for (auto i = numRecorded_ - numRecords; i < numRecorded_; ++i) {
+    const auto& record = records_[i % records_.size()];
+    thrift::RouteTraceEntry entry;
+    entry.timestampMs = record.timestampMs;
+    entry.event = static_cast<thrift::RouteTraceEvent>(record.event);
+    entry.numNextHops = record.numNextHops;
+    switch (entry.event) {
+    case thrift::RouteTraceEvent::UNICAST_ROUTE_UPDATE:
+    case thrift::RouteTraceEvent::UNICAST_ROUTE_DELETE: {
+      thrift::IpPrefix prefix;
+      prefix.prefixAddress.addr.assign(
+          reinterpret_cast<const char*>(record.addr.data()), record.addrLen);
+      prefix.prefixLength = record.labelOrPrefixLen;
+      entry.prefix = std::move(prefix);
+      break;
+    }
+    case thrift::RouteTraceEvent::MPLS_ROUTE_UPDATE:
+    case thrift::RouteTraceEvent::MPLS_ROUTE_DELETE:
+      entry.topLabel = record.labelOrPrefixLen;
+      break;
+    }
+    entries.emplace_back(std::move(entry));
+  }
+  return entries;
+}
+
+} // namespace openr
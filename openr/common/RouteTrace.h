@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <openr/if/gen-cpp2/Fib_types.h>
+
+namespace openr {
+
+/**
+ * Bounded trace of route changes kept in memory, e.g. routes received by Fib
+ * or computed by Decision. Changes are stored as compact binary records and
+ * only formatted into thrift entries when dumped, so tracing a route costs a
+ * few stores and tracing is free when disabled (zero capacity).
+ *
+ * Not thread safe, meant to be used from the event base of its owner.
+ */
+class RouteTrace {
+ public:
+  explicit RouteTrace(size_t capacity);
+
+  bool
+  isEnabled() const {
+    return not records_.empty();
+  }
+
+  // record every route change of the delta, oldest ones are overwritten
+  void record(const thrift::RouteDatabaseDelta& delta);
+
+  // number of route changes recorded so far, including overwritten ones
+  uint64_t
+  getNumRecorded() const {
+    return numRecorded_;
+  }
+
+  // recorded route changes, oldest first
+  std::vector<thrift::RouteTraceEntry> dump() const;
+
+ private:
+  struct Record {
+    int64_t timestampMs{0};
+    // MPLS label or prefix length
+    int32_t labelOrPrefixLen{0};
+    uint16_t numNextHops{0};
+    uint8_t event{0};
+    uint8_t addrLen{0};
+    std::array<uint8_t, 16> addr{};
+  };
+
+  Record& next(int64_t timestampMs, thrift::RouteTraceEvent event);
+
+  std::vector<Record> records_;
+  uint64_t numRecorded_{0};
+};
+
+} // namespace openr
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/RuntimeKnobs.h>
+
+#include <algorithm>
+
+#include <folly/Format.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+RuntimeKnobs::Knob
+RuntimeKnobs::addKnob(
+    std::string const& name,
+    std::string const& description,
+    int64_t value,
+    int64_t minValue,
+    int64_t maxValue) {
+  auto knobs = knobs_.wlock();
+  auto it = knobs->find(name);
+  if (it != knobs->end()) {
+    return it->second.knob;
+  }
+
+  KnobInfo info;
+  info.description = description;
+  info.defaultValue = value;
+  info.minValue = std::min(minValue, value);
+  info.maxValue = std::max(maxValue, value);
+  info.knob = Knob(value);
+  VLOG(1) << "Registered runtime knob " << name << " = " << value << " ["
+          << info.minValue << ", " << info.maxValue << "]";
+  return knobs->emplace(name, std::move(info)).first->second.knob;
+}
+
+folly::Expected<folly::Unit, std::string>
+RuntimeKnobs::setKnob(std::string const& name, int64_t value, bool persist) {
+  auto knobs = knobs_.wlock();
+  auto it = knobs->find(name);
+  if (it == knobs->end()) {
+    return folly::makeUnexpected(
+        folly::sformat("Unknown runtime knob {}", name));
+  }
+  auto& info = it->second;
+  if (value < info.minValue or value > info.maxValue) {
+    return folly::makeUnexpected(folly::sformat(
+        "Value {} of runtime knob {} out of [{}, {}]",
+        value,
+        name,
+        info.minValue,
+        info.maxValue));
+  }
+
+  LOG(INFO) << "Setting runtime knob " << name << " from "
+            << info.knob.get() << " to " << value
+            << (persist ? " (persisted)" : "");
+  info.knob.value_->store(value, std::memory_order_relaxed);
+  info.persisted = persist;
+  return folly::unit;
+}
+
+folly::Expected<folly::Unit, std::string>
+RuntimeKnobs::resetKnob(std::string const& name) {
+  auto knobs = knobs_.wlock();
+  auto it = knobs->find(name);
+  if (it == knobs->end()) {
+    return folly::makeUnexpected(
+        folly::sformat("Unknown runtime knob {}", name));
+  }
+  auto& info = it->second;
+  LOG(INFO) << "Resetting runtime knob " << name << " to "
+            << info.defaultValue;
+  info.knob.value_->store(info.defaultValue, std::memory_order_relaxed);
+  info.persisted = false;
+  return folly::unit;
+}
+
+std::vector<thrift::RuntimeKnob>
+RuntimeKnobs::getKnobs() const {
+  std::vector<thrift::RuntimeKnob> ret;
+  auto knobs = knobs_.rlock();
+  for (auto const& kv : *knobs) {
+    auto const& info = kv.second;
+    thrift::RuntimeKnob knob;
+    knob.name = kv.first;
+    knob.description = info.description;
+    knob.value = info.knob.get();
+    knob.defaultValue = info.defaultValue;
+    knob.minValue = info.minValue;
+    knob.maxValue = info.maxValue;
+    knob.persisted = info.persisted;
+    ret.emplace_back(std::move(knob));
+  }
+  return ret;
+}
+
+thrift::RuntimeKnobValues
+RuntimeKnobs::getPersistedValues() const {
+  thrift::RuntimeKnobValues ret;
+  auto knobs = knobs_.rlock();
+  for (auto const& kv : *knobs) {
+    if (kv.second.persisted) {
+      ret.values.emplace(kv.first, kv.second.knob.get());
+    }
+  }
+  return ret;
+}
+
+size_t
+RuntimeKnobs::restore(thrift::RuntimeKnobValues const& values) {
+  size_t numRestored{0};
+  for (auto const& kv : values.values) {
+    auto ret = setKnob(kv.first, kv.second, true /* persist */);
+    if (ret.hasError()) {
+      LOG(ERROR) << "Not restoring runtime knob: " << ret.error();
+      continue;
+    }
+    ++numRestored;
+  }
+  return numRestored;
+}
+
+} // namespace openr
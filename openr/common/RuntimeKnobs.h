@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Expected.h>
+#include <folly/Synchronized.h>
+#include <folly/Unit.h>
+
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+//
+// Performance knobs of the modules tunable at runtime, e.g. debounce timers
+// and flood rates, which are otherwise fixed by flags at startup.
+//
+// Modules register their knobs when constructed, initialized to their
+// configured values, and read them on use through lock-free handles. Knobs
+// are set through OpenrCtrl within the bounds given at registration, a
+// module picks the new value up the next time it reads it. Knobs registered
+// again under the same name, e.g. by shards of a module, share the value of
+// the first registration.
+//
+class RuntimeKnobs {
+ public:
+  // handle of a knob, cheap to copy
+  class Knob {
+   public:
+    // knob fixed at value, e.g. of modules constructed without knobs
+    explicit Knob(int64_t value = 0)
+        : value_(std::make_shared<std::atomic<int64_t>>(value)) {}
+
+    int64_t
+    get() const {
+      return value_->load(std::memory_order_relaxed);
+    }
+
+   private:
+    friend class RuntimeKnobs;
+
+    std::shared_ptr<std::atomic<int64_t>> value_;
+  };
+
+  RuntimeKnobs() = default;
+
+  // non-copyable, modules hold handles of it
+  RuntimeKnobs(RuntimeKnobs const&) = delete;
+  RuntimeKnobs& operator=(RuntimeKnobs const&) = delete;
+
+  /**
+   * Register knob name set to value, and settable within [minValue,
+   * maxValue]. Bounds are widened to the value if it is out of them. Thread
+   * safe
+   */
+  Knob addKnob(
+      std::string const& name,
+      std::string const& description,
+      int64_t value,
+      int64_t minValue,
+      int64_t maxValue);
+
+  /**
+   * Set knob name to value, marking it persisted or not. Fails if the knob is
+   * unknown or value out of its bounds
+   */
+  folly::Expected<folly::Unit, std::string> setKnob(
+      std::string const& name, int64_t value, bool persist = false);
+
+  /**
+   * Set knob name back to its registered value, no longer persisted
+   */
+  folly::Expected<folly::Unit, std::string> resetKnob(std::string const& name);
+
+  // all knobs, ordered by name
+  std::vector<thrift::RuntimeKnob> getKnobs() const;
+
+  // values of the persisted knobs, to be kept in the config store
+  thrift::RuntimeKnobValues getPersistedValues() const;
+
+  /**
+   * Set the knobs of values, e.g. loaded from the config store, as
+   * persisted. Unknown or invalid ones are skipped. Returns the number of
+   * knobs set
+   */
+  size_t restore(thrift::RuntimeKnobValues const& values);
+
+ private:
+  struct KnobInfo {
+    std::string description;
+    int64_t defaultValue{0};
+    int64_t minValue{0};
+    int64_t maxValue{0};
+    bool persisted{false};
+    Knob knob;
+  };
+
+  folly::Synchronized<std::map<std::string, KnobInfo>> knobs_;
+};
+
+} // namespace openr
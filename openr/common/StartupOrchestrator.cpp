@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "StartupOrchestrator.h"
+
+#include <cctype>
+#include <thread>
+
+#include <folly/Format.h>
+#include <folly/system/ThreadName.h>
+#include <glog/logging.h>
+
+#include <openr/common/Util.h>
+
+namespace openr {
+
+namespace {
+
+// CamelCase step name to snake_case, e.g. "ConfigStore" => "config_store"
+std::string
+toSnakeCase(std::string const& name) {
+  std::string result;
+  for (size_t i = 0; i < name.size(); ++i) {
+    const auto c = static_cast<unsigned char>(name[i]);
+    if (std::isupper(c) and i > 0 and
+        std::islower(static_cast<unsigned char>(name[i - 1]))) {
+      result.push_back('_');
+    }
+    result.push_back(static_cast<char>(std::tolower(c)));
+  }
+  return result;
+}
+
+std::string
+toEventName(std::string const& name, std::string const& suffix) {
+  auto eventName = toSnakeCase(name);
+  for (auto& c : eventName) {
+    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+  }
+  return folly::sformat("{}_{}", eventName, suffix);
+}
+
+} // namespace
+
+StartupOrchestrator::StartupOrchestrator(std::string const& nodeName)
+    : nodeName_(nodeName) {}
+
+void
+StartupOrchestrator::addStep(
+    std::string const& name,
+    std::vector<std::string> const& dependencies,
+    std::function<void()> fn) {
+  CHECK(fn) << "No function for startup step " << name;
+  CHECK(stepIndex_.emplace(name, steps_.size()).second)
+      << "Duplicate startup step " << name;
+  Step step;
+  step.name = name;
+  step.dependencies = dependencies;
+  step.fn = std::move(fn);
+  steps_.emplace_back(std::move(step));
+}
+
+void
+StartupOrchestrator::checkDependencies() const {
+  // Kahn's algorithm, all steps get visited only if there is no cycle
+  std::vector<size_t> numPendingDeps(steps_.size(), 0);
+  std::vector<std::vector<size_t>> dependents(steps_.size());
+  for (size_t i = 0; i < steps_.size(); ++i) {
+    for (auto const& dependency : steps_[i].dependencies) {
+      auto it = stepIndex_.find(dependency);
+      CHECK(it != stepIndex_.end()) << "Startup step " << steps_[i].name
+                                    << " depends on unknown " << dependency;
+      dependents[it->second].emplace_back(i);
+      ++numPendingDeps[i];
+    }
+  }
+
+  std::vector<size_t> ready;
+  for (size_t i = 0; i < steps_.size(); ++i) {
+    if (numPendingDeps[i] == 0) {
+      ready.emplace_back(i);
+    }
+  }
+  size_t numVisited{0};
+  while (not ready.empty()) {
+    const auto i = ready.back();
+    ready.pop_back();
+    ++numVisited;
+    for (auto dependent : dependents[i]) {
+      if (--numPendingDeps[dependent] == 0) {
+        ready.emplace_back(dependent);
+      }
+    }
+  }
+  CHECK_EQ(steps_.size(), numVisited) << "Cyclic startup step dependencies";
+}
+
+void
+StartupOrchestrator::runStep(Step& step) {
+  folly::setThreadName(folly::sformat("Start{}", step.name));
+  const auto startTime = Clock::now();
+  std::exception_ptr error;
+  try {
+    step.fn();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Clock::now() - startTime);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  step.duration = duration;
+  if (error) {
+    LOG(ERROR) << "Startup step " << step.name << " failed after "
+               << duration.count() << "ms";
+    step.state = State::FAILED;
+    if (not firstError_) {
+      firstError_ = error;
+    }
+    addPerfEvent(perfEvents_, nodeName_, toEventName(step.name, "FAILED"));
+  } else {
+    LOG(INFO) << "Startup step " << step.name << " done in "
+              << duration.count() << "ms";
+    step.state = State::DONE;
+    addPerfEvent(perfEvents_, nodeName_, toEventName(step.name, "DONE"));
+  }
+  stepCompleted_.notify_all();
+}
+
+void
+StartupOrchestrator::run() {
+  checkDependencies();
+
+  const auto startTime = Clock::now();
+  std::vector<std::thread> threads;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // Start all steps whose dependencies completed, skip the ones whose
+    // dependencies won't complete. Repeat as skipping propagates.
+    size_t numRunning{0};
+    bool changed{true};
+    while (changed) {
+      changed = false;
+      numRunning = 0;
+      for (auto& step : steps_) {
+        if (step.state == State::RUNNING) {
+          ++numRunning;
+        }
+        if (step.state != State::PENDING) {
+          continue;
+        }
+        bool ready{true};
+        bool failed{false};
+        for (auto const& dependency : step.dependencies) {
+          const auto state = steps_.at(stepIndex_.at(dependency)).state;
+          ready &= state == State::DONE;
+          failed |= state == State::FAILED or state == State::SKIPPED;
+        }
+        if (failed) {
+          LOG(ERROR) << "Skipping startup step " << step.name;
+          step.state = State::SKIPPED;
+          changed = true;
+        } else if (ready) {
+          step.state = State::RUNNING;
+          ++numRunning;
+          addPerfEvent(
+              perfEvents_, nodeName_, toEventName(step.name, "STARTED"));
+          threads.emplace_back([this, &step]() { runStep(step); });
+        }
+      }
+    }
+    if (numRunning == 0) {
+      break;
+    }
+    stepCompleted_.wait(lock);
+  }
+  totalDuration_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Clock::now() - startTime);
+  lock.unlock();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG(INFO) << "Startup of " << steps_.size() << " steps took "
+            << totalDuration_.count() << "ms";
+
+  if (firstError_) {
+    std::rethrow_exception(firstError_);
+  }
+}
+
+std::unordered_map<std::string, int64_t>
+StartupOrchestrator::getCounters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<std::string, int64_t> counters;
+  for (auto const& step : steps_) {
+    if (step.state == State::DONE) {
+      counters[folly::sformat("startup.{}_ms", toSnakeCase(step.name))] =
+          step.duration.count();
+    }
+  }
+  counters["startup.total_ms"] = totalDuration_.count();
+  return counters;
+}
+
+thrift::PerfEvents
+StartupOrchestrator::getPerfEvents() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return perfEvents_;
+}
+
+} // namespace openr
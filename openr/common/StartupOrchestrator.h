@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+
+namespace openr {
+
+/**
+ * Starts modules in the order given by their dependencies. Every step runs in
+ * its own thread as soon as all of its dependencies have completed, so that
+ * independent modules start in parallel and the slowest chain of dependencies
+ * bounds the startup time.
+ *
+ * Start and completion of every step are recorded as PerfEvents and the
+ * durations are exported as counters.
+ */
+class StartupOrchestrator {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit StartupOrchestrator(std::string const& nodeName);
+
+  /**
+   * Add a step run after all the named dependencies have completed. Steps
+   * must be added before run() and names must be unique.
+   */
+  void addStep(
+      std::string const& name,
+      std::vector<std::string> const& dependencies,
+      std::function<void()> fn);
+
+  /**
+   * Run all steps and return once all of them completed. Steps depending on a
+   * failed one are skipped and the first failure is rethrown. Unknown or
+   * cyclic dependencies are fatal.
+   */
+  void run();
+
+  /**
+   * Duration of every completed step and of the entire startup, e.g.
+   * `startup.config_store_ms` and `startup.total_ms`
+   */
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
+  /**
+   * `<STEP>_STARTED` and `<STEP>_DONE` events in the order they happened,
+   * e.g. `CONFIG_STORE_DONE`
+   */
+  thrift::PerfEvents getPerfEvents() const;
+
+ private:
+  enum class State { PENDING, RUNNING, DONE, FAILED, SKIPPED };
+
+  struct Step {
+    std::string name;
+    std::vector<std::string> dependencies;
+    std::function<void()> fn;
+    State state{State::PENDING};
+    std::chrono::milliseconds duration{0};
+  };
+
+  // Abort if a dependency is unknown or dependencies form a cycle
+  void checkDependencies() const;
+
+  // Body of a step's thread
+  void runStep(Step& step);
+
+  const std::string nodeName_;
+
+  std::vector<Step> steps_;
+  std::unordered_map<std::string, size_t> stepIndex_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable stepCompleted_;
+  std::exception_ptr firstError_;
+  thrift::PerfEvents perfEvents_;
+  std::chrono::milliseconds totalDuration_{0};
+};
+
+} // namespace openr
@@ -7,14 +7,139 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
 
-#include <folly/stats/BucketedTimeSeries.h>
+#include <glog/logging.h>
 
 namespace openr {
 
+/*
+ * Fixed-capacity sliding window over a time series, keeping the sum and count
+ * of the values of its last numBuckets buckets of (duration / numBuckets)
+ * each. Mirrors the addValue()/avg()/count() subset of folly's
+ * BucketedTimeSeries, with the window statistics maintained as running sums.
+ * Adding a value takes constant time and never allocates, buckets being
+ * stored contiguously in a ring buffer sized on construction.
+ * Floating point running sums are recomputed from the buckets periodically,
+ * so that rounding errors of the additions and removals don't pile up.
+ */
+template <typename ValueType, typename TimeType>
+class RingBufferWindow {
+ public:
+  // number of additions between recalibrations of floating point sums
+  static constexpr uint64_t kRecalibrationPeriod = 1024;
+
+  RingBufferWindow(size_t numBuckets, TimeType duration)
+      : bucketDuration_(duration / numBuckets), buckets_(numBuckets) {
+    CHECK_LT(0, numBuckets);
+    CHECK_LT(0, bucketDuration_.count());
+  }
+
+  // add the value 'val' at time 'now'. Returns false if 'now' is older than
+  // the window
+  bool
+  addValue(TimeType now, const ValueType& val) {
+    CHECK_LE(0, now.count());
+    const int64_t bucketNum = now / bucketDuration_;
+    const int64_t numBuckets = buckets_.size();
+    if (latestBucketNum_ < 0) {
+      latestBucketNum_ = bucketNum;
+    } else if (bucketNum > latestBucketNum_) {
+      advance(bucketNum);
+    } else if (bucketNum <= latestBucketNum_ - numBuckets) {
+      return false;
+    }
+
+    auto& bucket = buckets_[bucketNum % numBuckets];
+    bucket.sum += val;
+    ++bucket.count;
+    sum_ += val;
+    ++count_;
+
+    if (std::is_floating_point<ValueType>::value and
+        ++numAddsSinceRecalibration_ >= kRecalibrationPeriod) {
+      recalibrate();
+    }
+    return true;
+  }
+
+  template <typename ReturnType = double>
+  ReturnType
+  avg() const {
+    if (count_ == 0) {
+      return ReturnType(0);
+    }
+    return static_cast<ReturnType>(sum_) / static_cast<ReturnType>(count_);
+  }
+
+  uint64_t
+  count() const {
+    return count_;
+  }
+
+  ValueType
+  sum() const {
+    return sum_;
+  }
+
+ private:
+  struct Bucket {
+    ValueType sum{0};
+    uint64_t count{0};
+  };
+
+  // move the window forward so that bucketNum is its latest bucket, dropping
+  // the buckets falling out of it
+  void
+  advance(int64_t bucketNum) {
+    const int64_t numBuckets = buckets_.size();
+    const int64_t numExpired =
+        std::min(bucketNum - latestBucketNum_, numBuckets);
+    for (int64_t i = 1; i <= numExpired; ++i) {
+      auto& bucket = buckets_[(latestBucketNum_ + i) % numBuckets];
+      sum_ -= bucket.sum;
+      count_ -= bucket.count;
+      bucket = Bucket();
+    }
+    latestBucketNum_ = bucketNum;
+
+    // empty window, start over from an exact sum
+    if (count_ == 0) {
+      sum_ = ValueType(0);
+      numAddsSinceRecalibration_ = 0;
+    }
+  }
+
+  void
+  recalibrate() {
+    sum_ = ValueType(0);
+    for (auto const& bucket : buckets_) {
+      sum_ += bucket.sum;
+    }
+    numAddsSinceRecalibration_ = 0;
+  }
+
+  const TimeType bucketDuration_;
+
+  // buckets of the window, bucket number n living at n % numBuckets
+  std::vector<Bucket> buckets_;
+
+  // number of the latest bucket, -1 until the first value is added
+  int64_t latestBucketNum_{-1};
+
+  // running sum and count of all buckets
+  ValueType sum_{0};
+  uint64_t count_{0};
+
+  uint64_t numAddsSinceRecalibration_{0};
+};
+
 /*
  * This class detects abrupt changes, i.e., steps, in the mean level of a time
  * series or signal. Often, the step is small and the time series is corrupted
@@ -32,8 +157,13 @@ namespace openr {
  * to catch this case.
  * Notes: we assume the underlying time series is stable for longer than slow
  * sliding window between steps.
+ * WindowType can be any sliding window with the addValue()/avg()/count()
+ * interface of folly's BucketedTimeSeries.
  */
-template <typename ValueType, typename TimeType>
+template <
+    typename ValueType,
+    typename TimeType,
+    typename WindowType = RingBufferWindow<ValueType, TimeType>>
 class StepDetector {
  public:
   StepDetector(
@@ -129,12 +259,10 @@ class StepDetector {
   size_t slowWndSize_{0};
 
   // fast sliding window
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      fastSlideWindow_;
+  WindowType fastSlideWindow_;
 
-  // slow sliding window size
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      slowSlideWindow_;
+  // slow sliding window
+  WindowType slowSlideWindow_;
 
   // lower threshold, in percentage
   const uint8_t loThreshold_{0};
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "StringInterner.h"
+
+#include <deque>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+#include <folly/Indestructible.h>
+#include <folly/SharedMutex.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+struct InternTable {
+  InternTable() {
+    // id 0 is the empty string, used by default constructed handles
+    entries.emplace_back();
+    ids.emplace(std::string_view(entries.front().str), &entries.front());
+  }
+
+  folly::SharedMutex lock;
+  // deque never moves its elements, handles keep pointing to them
+  std::deque<InternedString::Entry> entries;
+  // keys refer to the strings owned by entries
+  std::unordered_map<std::string_view, const InternedString::Entry*> ids;
+};
+
+InternTable&
+getInternTable() {
+  static folly::Indestructible<InternTable> table;
+  return *table;
+}
+
+} // anonymous namespace
+
+InternedString::InternedString() {
+  static const Entry* const kEmpty =
+      StringInterner::getOrCreateEntry(folly::StringPiece());
+  entry_ = kEmpty;
+}
+
+InternedString::InternedString(folly::StringPiece str)
+    : entry_(StringInterner::getOrCreateEntry(str)) {}
+
+InternedString
+StringInterner::intern(folly::StringPiece str) {
+  return InternedString(getOrCreateEntry(str));
+}
+
+size_t
+StringInterner::size() {
+  auto& table = getInternTable();
+  folly::SharedMutex::ReadHolder guard(table.lock);
+  return table.entries.size();
+}
+
+const InternedString::Entry*
+StringInterner::getOrCreateEntry(folly::StringPiece piece) {
+  const std::string_view str(piece.data(), piece.size());
+  auto& table = getInternTable();
+  {
+    folly::SharedMutex::ReadHolder guard(table.lock);
+    auto it = table.ids.find(str);
+    if (it != table.ids.end()) {
+      return it->second;
+    }
+  }
+
+  folly::SharedMutex::WriteHolder guard(table.lock);
+  // someone else may have interned it meanwhile
+  auto it = table.ids.find(str);
+  if (it != table.ids.end()) {
+    return it->second;
+  }
+  CHECK_LT(table.entries.size(), std::numeric_limits<uint32_t>::max());
+  table.entries.emplace_back();
+  auto& entry = table.entries.back();
+  entry.str = std::string(str);
+  entry.id = static_cast<uint32_t>(table.entries.size() - 1);
+  table.ids.emplace(std::string_view(entry.str), &entry);
+  return &entry;
+}
+
+std::ostream&
+operator<<(std::ostream& out, const InternedString& str) {
+  return out << str.str();
+}
+
+} // namespace openr
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include <folly/Range.h>
+
+namespace openr {
+
+/**
+ * Handle to a string stored once in the process wide StringInterner, e.g. a
+ * node or an interface name.
+ *
+ * An InternedString is the size of a pointer and cheap to copy. Equality and
+ * hashing operate on the interned entry only, never on string contents, while
+ * ordering follows the string contents so that ordered containers iterate in
+ * the same order as they would with plain strings. The default constructed
+ * value refers to the empty string.
+ */
+class InternedString {
+ public:
+  // storage of an interned string, owned by the StringInterner
+  struct Entry {
+    std::string str;
+    uint32_t id{0};
+  };
+
+  InternedString();
+
+  // interns the given string if not known yet
+  explicit InternedString(folly::StringPiece str);
+
+  // dense id of the string, unique for the lifetime of the process
+  uint32_t
+  id() const {
+    return entry_->id;
+  }
+
+  const std::string&
+  str() const {
+    return entry_->str;
+  }
+
+  bool
+  empty() const {
+    return entry_->str.empty();
+  }
+
+  bool
+  operator==(const InternedString& other) const {
+    return entry_ == other.entry_;
+  }
+
+  bool
+  operator!=(const InternedString& other) const {
+    return entry_ != other.entry_;
+  }
+
+  bool
+  operator<(const InternedString& other) const {
+    return entry_ != other.entry_ and entry_->str < other.entry_->str;
+  }
+
+  // Compare with a plain string. Strings handed out by str() are recognized
+  // by address without comparing contents.
+  bool
+  operator==(const std::string& other) const {
+    return &entry_->str == &other or entry_->str == other;
+  }
+
+  bool
+  operator!=(const std::string& other) const {
+    return not(*this == other);
+  }
+
+ private:
+  friend class StringInterner;
+
+  explicit InternedString(const Entry* entry) : entry_(entry) {}
+
+  const Entry* entry_{nullptr};
+};
+
+/**
+ * Process wide, thread safe table of interned strings. Strings are never
+ * removed, hence it is meant for identifiers of bounded cardinality such as
+ * node and interface names. Lookups of known strings only take a shared lock.
+ */
+class StringInterner {
+ public:
+  static InternedString intern(folly::StringPiece str);
+
+  // number of strings interned so far
+  static size_t size();
+
+ private:
+  static const InternedString::Entry* getOrCreateEntry(folly::StringPiece str);
+
+  friend class InternedString;
+};
+
+std::ostream& operator<<(std::ostream& out, const InternedString& str);
+
+} // namespace openr
+
+namespace std {
+
+template <>
+struct hash<openr::InternedString> {
+  size_t
+  operator()(const openr::InternedString& str) const {
+    return std::hash<uint32_t>()(str.id());
+  }
+};
+
+} // namespace std
@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/ThreadLocalStats.h>
+
+#include <cmath>
+
+#include <folly/Conv.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// timeseries of fbzmq::ThreadData
+constexpr size_t kNumTimeseriesBuckets{60};
+
+// window of the values histogram percentiles are computed of, along with the
+// values of the previous one
+constexpr std::chrono::seconds kHistogramWindow{60};
+
+const std::vector<std::pair<std::string, double>> kPercentiles{
+    {"p50", 0.50}, {"p90", 0.90}, {"p99", 0.99}};
+
+// slots of a stat: count and sum of values, then histogram buckets
+constexpr size_t kCountSlot{0};
+constexpr size_t kSumSlot{1};
+constexpr size_t kBucketSlot{2};
+
+std::string
+getExportTypeName(fbzmq::ExportType exportType) {
+  switch (exportType) {
+  case fbzmq::SUM:
+    return "sum";
+  case fbzmq::COUNT:
+    return "count";
+  case fbzmq::AVG:
+    return "avg";
+  case fbzmq::RATE:
+    return "rate";
+  default:
+    return "";
+  }
+}
+
+} // namespace
+
+constexpr size_t ThreadLocalStats::kNumHistogramBuckets;
+
+ThreadLocalStats::StatInfo::StatInfo(
+    std::string const& key,
+    std::vector<fbzmq::ExportType> const& exportTypes,
+    size_t slot,
+    bool isHistogram)
+    : key(key),
+      exportTypes(exportTypes),
+      slot(slot),
+      isHistogram(isHistogram),
+      timeseries(
+          kNumTimeseriesBuckets,
+          {std::chrono::seconds(60),
+           std::chrono::seconds(600),
+           std::chrono::seconds(3600),
+           std::chrono::seconds(0) /* all time */}) {
+  for (auto const exportType : exportTypes) {
+    CHECK(not getExportTypeName(exportType).empty())
+        << "Unsupported export type of " << key;
+  }
+}
+
+ThreadLocalStats::Stat
+ThreadLocalStats::addStat(
+    std::string const& key,
+    std::vector<fbzmq::ExportType> const& exportTypes) {
+  std::lock_guard<std::mutex> lock(aggregateLock_);
+  const auto slot = addSlots(kBucketSlot);
+  stats_.emplace_back(
+      std::make_unique<StatInfo>(key, exportTypes, slot, false));
+  return Stat(this, slot);
+}
+
+ThreadLocalStats::Histogram
+ThreadLocalStats::addHistogram(
+    std::string const& key,
+    std::vector<fbzmq::ExportType> const& exportTypes) {
+  std::lock_guard<std::mutex> lock(aggregateLock_);
+  const auto slot = addSlots(kBucketSlot + kNumHistogramBuckets);
+  stats_.emplace_back(std::make_unique<StatInfo>(key, exportTypes, slot, true));
+  return Histogram(this, slot);
+}
+
+size_t
+ThreadLocalStats::addSlots(size_t numSlots) {
+  // slots of threads are sized once
+  CHECK(allSlots_.rlock()->empty())
+      << "Stats must be registered before values are added";
+  const auto slot = numSlots_;
+  numSlots_ += numSlots;
+  releasedTotals_.resize(numSlots_, 0);
+  lastTotals_.resize(numSlots_, 0);
+  return slot;
+}
+
+ThreadLocalStats::Slots&
+ThreadLocalStats::addThreadSlots(std::shared_ptr<Slots>& slots) {
+  slots = std::make_shared<Slots>(numSlots_);
+  allSlots_.wlock()->emplace_back(slots);
+  return *slots;
+}
+
+void
+ThreadLocalStats::aggregate() {
+  std::lock_guard<std::mutex> lock(aggregateLock_);
+  std::vector<int64_t> totals(releasedTotals_);
+  {
+    auto allSlots = allSlots_.wlock();
+    for (auto it = allSlots->begin(); it != allSlots->end();) {
+      auto const& slots = **it;
+      // release slots of exited threads
+      const bool released = it->use_count() == 1;
+      for (size_t i = 0; i < numSlots_; ++i) {
+        const auto value = slots[i].load(std::memory_order_relaxed);
+        totals[i] += value;
+        if (released) {
+          releasedTotals_[i] += value;
+        }
+      }
+      it = released ? allSlots->erase(it) : std::next(it);
+    }
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const bool newWindow = now - windowStart_ >= kHistogramWindow;
+  if (newWindow) {
+    windowStart_ = now;
+  }
+  for (auto& stat : stats_) {
+    const auto count = totals[stat->slot + kCountSlot] -
+        lastTotals_[stat->slot + kCountSlot];
+    const auto sum =
+        totals[stat->slot + kSumSlot] - lastTotals_[stat->slot + kSumSlot];
+    stat->timeseries.update(now);
+    if (count > 0) {
+      stat->timeseries.addValueAggregated(now, sum, count);
+    }
+    if (not stat->isHistogram) {
+      continue;
+    }
+    if (newWindow) {
+      stat->prevWindowBuckets = stat->windowBuckets;
+      stat->windowBuckets.fill(0);
+    }
+    for (size_t i = 0; i < kNumHistogramBuckets; ++i) {
+      const auto slot = stat->slot + kBucketSlot + i;
+      stat->windowBuckets[i] += totals[slot] - lastTotals_[slot];
+    }
+  }
+  lastTotals_.swap(totals);
+}
+
+std::unordered_map<std::string, int64_t>
+ThreadLocalStats::getCounters() {
+  aggregate();
+
+  std::lock_guard<std::mutex> lock(aggregateLock_);
+  std::unordered_map<std::string, int64_t> counters;
+  for (auto const& stat : stats_) {
+    auto& timeseries = stat->timeseries;
+    for (size_t level = 0; level < timeseries.numLevels(); ++level) {
+      const auto suffix = folly::to<std::string>(
+          std::chrono::duration_cast<std::chrono::seconds>(
+              timeseries.getLevel(level).duration())
+              .count());
+      for (auto const exportType : stat->exportTypes) {
+        const auto name =
+            stat->key + "." + getExportTypeName(exportType) + "." + suffix;
+        switch (exportType) {
+        case fbzmq::SUM:
+          counters[name] = timeseries.sum(level);
+          break;
+        case fbzmq::COUNT:
+          counters[name] = timeseries.count(level);
+          break;
+        case fbzmq::AVG:
+          counters[name] = timeseries.avg<int64_t>(level);
+          break;
+        case fbzmq::RATE:
+          counters[name] = timeseries.rate<int64_t>(level);
+          break;
+        default:
+          break;
+        }
+      }
+    }
+
+    if (not stat->isHistogram) {
+      continue;
+    }
+    std::array<int64_t, kNumHistogramBuckets> buckets;
+    int64_t numValues{0};
+    for (size_t i = 0; i < kNumHistogramBuckets; ++i) {
+      buckets[i] = stat->windowBuckets[i] + stat->prevWindowBuckets[i];
+      numValues += buckets[i];
+    }
+    const auto suffix = folly::to<std::string>(kHistogramWindow.count());
+    for (auto const& percentile : kPercentiles) {
+      // upper bound of the bucket holding the percentile
+      int64_t value{0};
+      int64_t rank = std::ceil(percentile.second * numValues);
+      for (size_t i = 0; i < kNumHistogramBuckets and rank > 0; ++i) {
+        rank -= buckets[i];
+        if (rank <= 0) {
+          value = i == 0 ? 0 : ((int64_t{1} << (i - 1)) - 1) * 2 + 1;
+        }
+      }
+      counters[stat->key + "." + percentile.first + "." + suffix] = value;
+    }
+  }
+  return counters;
+}
+
+} // namespace openr
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fbzmq/service/stats/ThreadData.h>
+#include <folly/Likely.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/stats/MultiLevelTimeSeries.h>
+
+namespace openr {
+
+/**
+ * Stats of hot code paths, a replacement of fbzmq::ThreadData exporting the
+ * same counters without a string keyed lookup and timeseries update on
+ * every value.
+ *
+ * Stats are registered upfront, e.g. when their module is constructed, and
+ * return a handle to a slot. Every thread adding values accumulates them in
+ * slots of its own, a value is a relaxed add to a slot of the calling
+ * thread, lock-free and without sharing cache lines with other threads.
+ * Slots of all threads are folded into timeseries when counters are read,
+ * values count as added at that time.
+ *
+ * Stats export "<key>.<type>.<level>" counters for the levels of
+ * fbzmq::ThreadData, 60, 600, 3600 seconds and 0 for all time, e.g.
+ * "decision.spf_ms.avg.60". Histograms also export percentiles of the values
+ * of the last one to two minutes, e.g. "decision.spf_ms.p99.60", within a
+ * factor of two: values are counted in power of two buckets.
+ */
+class ThreadLocalStats {
+ public:
+  // values of a stat and of its buckets if it is a histogram. Written by a
+  // single thread
+  using Slots = std::vector<std::atomic<int64_t>>;
+
+  static constexpr size_t kNumHistogramBuckets{64};
+
+  // handle of a stat, cheap to copy
+  class Stat {
+   public:
+    Stat() = default;
+
+    void
+    addValue(int64_t value) const {
+      auto& slots = stats_->getThreadSlots();
+      add(slots[slot_], 1);
+      add(slots[slot_ + 1], value);
+    }
+
+   private:
+    friend class ThreadLocalStats;
+
+    Stat(ThreadLocalStats* stats, size_t slot) : stats_(stats), slot_(slot) {}
+
+    ThreadLocalStats* stats_{nullptr};
+    size_t slot_{0};
+  };
+
+  // handle of a histogram, which is also a stat
+  class Histogram {
+   public:
+    Histogram() = default;
+
+    void
+    addValue(int64_t value) const {
+      auto& slots = stats_->getThreadSlots();
+      add(slots[slot_], 1);
+      add(slots[slot_ + 1], value);
+      add(slots[slot_ + 2 + getBucket(value)], 1);
+    }
+
+   private:
+    friend class ThreadLocalStats;
+
+    Histogram(ThreadLocalStats* stats, size_t slot)
+        : stats_(stats), slot_(slot) {}
+
+    ThreadLocalStats* stats_{nullptr};
+    size_t slot_{0};
+  };
+
+  ThreadLocalStats() = default;
+
+  // non-copyable, handles refer to it
+  ThreadLocalStats(ThreadLocalStats const&) = delete;
+  ThreadLocalStats& operator=(ThreadLocalStats const&) = delete;
+
+  /**
+   * Register a stat exported as exportTypes, any of SUM, COUNT, AVG and
+   * RATE. Stats must be registered before values are added to any of them
+   */
+  Stat addStat(
+      std::string const& key,
+      std::vector<fbzmq::ExportType> const& exportTypes);
+
+  /**
+   * Register a histogram, also exported as exportTypes
+   */
+  Histogram addHistogram(
+      std::string const& key,
+      std::vector<fbzmq::ExportType> const& exportTypes = {});
+
+  /**
+   * Fold the values added by all threads since the last call into the
+   * timeseries. Thread safe
+   */
+  void aggregate();
+
+  /**
+   * Counters of all stats, aggregated first. Thread safe
+   */
+  std::unordered_map<std::string, int64_t> getCounters();
+
+  // bucket of value, holding values of up to 2^bucket - 1
+  static size_t
+  getBucket(int64_t value) {
+    return value <= 0 ? 0 : 64 - __builtin_clzll(value);
+  }
+
+ private:
+  struct StatInfo {
+    StatInfo(
+        std::string const& key,
+        std::vector<fbzmq::ExportType> const& exportTypes,
+        size_t slot,
+        bool isHistogram);
+
+    const std::string key;
+    const std::vector<fbzmq::ExportType> exportTypes;
+    const size_t slot{0};
+    const bool isHistogram{false};
+
+    folly::MultiLevelTimeSeries<int64_t> timeseries;
+
+    // buckets of the values added in the current and previous windows
+    std::array<int64_t, kNumHistogramBuckets> windowBuckets{};
+    std::array<int64_t, kNumHistogramBuckets> prevWindowBuckets{};
+  };
+
+  static void
+  add(std::atomic<int64_t>& slot, int64_t value) {
+    slot.store(
+        slot.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+  }
+
+  Slots&
+  getThreadSlots() {
+    auto& slots = *threadSlots_;
+    if (FOLLY_UNLIKELY(not slots)) {
+      return addThreadSlots(slots);
+    }
+    return *slots;
+  }
+
+  // allocate the slots of the calling thread
+  Slots& addThreadSlots(std::shared_ptr<Slots>& slots);
+
+  // reserve numSlots slots for a stat
+  size_t addSlots(size_t numSlots);
+
+  // slots of the threads, also owned by allSlots_ until they are folded
+  // after their thread exited
+  folly::ThreadLocal<std::shared_ptr<Slots>> threadSlots_;
+  folly::Synchronized<std::vector<std::shared_ptr<Slots>>> allSlots_;
+  size_t numSlots_{0};
+
+  // aggregation state, guarded by aggregateLock_
+  std::mutex aggregateLock_;
+  std::vector<std::unique_ptr<StatInfo>> stats_;
+  // totals of the slots of exited threads
+  std::vector<int64_t> releasedTotals_;
+  // totals of all slots as of the last aggregation
+  std::vector<int64_t> lastTotals_;
+  std::chrono::steady_clock::time_point windowStart_{
+      std::chrono::steady_clock::now()};
+};
+
+} // namespace openr
@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ThreadPlacement.h"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+folly::Optional<std::vector<int>>
+parseCpuList(std::string const& cpuList) {
+  std::vector<int> cpus;
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(cpuList), ranges, true);
+  for (auto const& range : ranges) {
+    folly::StringPiece first, last;
+    if (not folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto from = folly::tryTo<int>(first);
+    auto to = folly::tryTo<int>(last);
+    if (from.hasError() or to.hasError() or from.value() < 0 or
+        from.value() > to.value() or to.value() >= CPU_SETSIZE) {
+      return folly::none;
+    }
+    for (int cpu = from.value(); cpu <= to.value(); ++cpu) {
+      cpus.emplace_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<int>
+getNumaNodeCpus(int node) {
+  std::string cpuList;
+  const auto path =
+      folly::sformat("/sys/devices/system/node/node{}/cpulist", node);
+  if (not folly::readFile(path.c_str(), cpuList)) {
+    return {};
+  }
+  return parseCpuList(cpuList).value_or(std::vector<int>{});
+}
+
+std::vector<int>
+getAllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+    return cpus;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpuSet)) {
+      cpus.emplace_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+folly::Expected<ThreadPlacements, std::string>
+parseThreadPlacements(std::string const& spec) {
+  ThreadPlacements placements;
+  std::vector<std::string> entries;
+  folly::split(';', spec, entries, true);
+  for (auto const& entry : entries) {
+    std::vector<std::string> fields;
+    folly::split(':', entry, fields);
+    if (fields.size() < 2 or fields.size() > 3 or fields[0].empty()) {
+      return folly::makeUnexpected(
+          folly::sformat("Malformed thread placement '{}'", entry));
+    }
+
+    ThreadPlacement placement;
+    folly::StringPiece cpus(fields[1]);
+    if (cpus.removePrefix("node")) {
+      auto node = folly::tryTo<int>(cpus);
+      if (node.hasError()) {
+        return folly::makeUnexpected(
+            folly::sformat("Malformed NUMA node in '{}'", entry));
+      }
+      placement.cpus = getNumaNodeCpus(node.value());
+      if (placement.cpus.empty()) {
+        return folly::makeUnexpected(
+            folly::sformat("No CPUs found for NUMA node in '{}'", entry));
+      }
+    } else {
+      auto cpuList = parseCpuList(fields[1]);
+      if (not cpuList.hasValue()) {
+        return folly::makeUnexpected(
+            folly::sformat("Malformed CPU list in '{}'", entry));
+      }
+      placement.cpus = std::move(cpuList).value();
+    }
+
+    if (fields.size() == 3) {
+      auto niceValue = folly::tryTo<int>(fields[2]);
+      if (niceValue.hasError() or niceValue.value() < -20 or
+          niceValue.value() > 19) {
+        return folly::makeUnexpected(
+            folly::sformat("Malformed nice value in '{}'", entry));
+      }
+      placement.niceValue = niceValue.value();
+    }
+    placements[fields[0]] = std::move(placement);
+  }
+  return placements;
+}
+
+ThreadPlacements
+getDefaultThreadPlacements(std::vector<int> const& cpus) {
+  ThreadPlacements placements;
+
+  // Spark hellos and heartbeats must not wait behind route computation
+  placements["Spark"].niceValue = -10;
+  if (cpus.size() < 4) {
+    return placements;
+  }
+
+  // Keep neighbor discovery and flooding off the CPUs computing routes, and
+  // stop them from migrating
+  placements["Spark"].cpus = {cpus.at(0)};
+  placements["LinkMonitor"].cpus = {cpus.at(0)};
+  placements["KvStore"].cpus = {cpus.at(1)};
+  const std::vector<int> otherCpus(cpus.begin() + 2, cpus.end());
+  for (auto const& name : {"Decision",
+                           "Fib",
+                           "PrefixManager",
+                           "PrefixAllocator",
+                           "ConfigStore",
+                           "CtrlServer"}) {
+    placements[name].cpus = otherCpus;
+  }
+  return placements;
+}
+
+bool
+applyThreadPlacement(ThreadPlacement const& placement, bool numaLocalAlloc) {
+  bool success{true};
+
+  if (placement.cpus.size()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : placement.cpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    const auto rc =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (rc != 0) {
+      LOG(ERROR) << "Failed to pin thread to CPUs "
+                 << folly::join(",", placement.cpus) << ": "
+                 << folly::errnoStr(rc);
+      success = false;
+    } else if (numaLocalAlloc) {
+      // Allocate on the node of the CPU the thread runs on, regardless of
+      // the process wide policy (e.g. interleaving set up by numactl)
+      if (syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) != 0) {
+        PLOG(ERROR) << "Failed to set NUMA local memory policy";
+        success = false;
+      }
+    }
+  }
+
+  if (placement.niceValue.hasValue()) {
+    // Nice value applies to the calling thread only on Linux
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, placement.niceValue.value()) != 0) {
+      PLOG(ERROR) << "Failed to set nice value "
+                  << placement.niceValue.value();
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+} // namespace openr
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+
+namespace openr {
+
+//
+// CPU and scheduling placement of a module thread
+//
+struct ThreadPlacement {
+  // CPUs the thread may run on, any if empty
+  std::vector<int> cpus;
+  // nice value of the thread, lower runs at higher priority. Negative values
+  // require CAP_SYS_NICE
+  folly::Optional<int> niceValue;
+};
+
+using ThreadPlacements = std::unordered_map<std::string, ThreadPlacement>;
+
+/**
+ * Parse a CPU list as used by the kernel, e.g. "0-3,8". Returns none if
+ * malformed.
+ */
+folly::Optional<std::vector<int>> parseCpuList(std::string const& cpuList);
+
+/**
+ * CPUs of a NUMA node as reported by sysfs, empty if there is no such node
+ */
+std::vector<int> getNumaNodeCpus(int node);
+
+/**
+ * CPUs the calling thread is allowed to run on
+ */
+std::vector<int> getAllowedCpus();
+
+/**
+ * Parse placements of threads by name, separated by ';'. Each one is
+ * "<name>:<cpus>[:<nice>]" where cpus is a CPU list, "node<N>" for all CPUs of
+ * a NUMA node, or empty for no pinning, e.g. "Spark:0:-10;Decision:node1"
+ */
+folly::Expected<ThreadPlacements, std::string> parseThreadPlacements(
+    std::string const& spec);
+
+/**
+ * Layout over the given CPUs, opted into with thread_placement "auto".
+ * Spark runs at elevated priority. With enough CPUs Spark and LinkMonitor
+ * share the first CPU, KvStore gets the second one and the remaining
+ * modules, Decision in particular, run on the other ones.
+ */
+ThreadPlacements getDefaultThreadPlacements(std::vector<int> const& cpus);
+
+/**
+ * Apply placement to the calling thread. If the thread is pinned and
+ * numaLocalAlloc is set, its memory gets allocated on the NUMA node it runs
+ * on. Failures are logged and return false, the thread keeps running where
+ * it could be placed.
+ */
+bool applyThreadPlacement(
+    ThreadPlacement const& placement, bool numaLocalAlloc);
+
+} // namespace openr
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ThreadStats.h"
+
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+
+namespace openr {
+
+namespace {
+
+folly::Optional<int64_t>
+getStatusField(folly::StringPiece status, folly::StringPiece field) {
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', status, lines, true);
+  for (auto const& line : lines) {
+    folly::StringPiece name, value;
+    if (not folly::split(':', line, name, value) or name != field) {
+      continue;
+    }
+    auto parsed = folly::tryTo<int64_t>(folly::trimWhitespace(value));
+    if (parsed.hasError()) {
+      return folly::none;
+    }
+    return parsed.value();
+  }
+  return folly::none;
+}
+
+} // namespace
+
+ThreadStats&
+ThreadStats::operator+=(ThreadStats const& other) {
+  cpuTime += other.cpuTime;
+  runQueueWait += other.runQueueWait;
+  voluntaryCtxSwitches += other.voluntaryCtxSwitches;
+  involuntaryCtxSwitches += other.involuntaryCtxSwitches;
+  return *this;
+}
+
+pid_t
+getThreadId() {
+  return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+folly::Optional<ThreadStats>
+getThreadStats(pid_t tid) {
+  std::string schedstat, status;
+  const auto taskPath = folly::sformat("/proc/self/task/{}", tid);
+  if (not folly::readFile((taskPath + "/schedstat").c_str(), schedstat) or
+      not folly::readFile((taskPath + "/status").c_str(), status)) {
+    return folly::none;
+  }
+  return parseThreadStats(schedstat, status);
+}
+
+folly::Optional<ThreadStats>
+parseThreadStats(folly::StringPiece schedstat, folly::StringPiece status) {
+  // "<cpu time ns> <run queue wait ns> <timeslices>"
+  std::vector<folly::StringPiece> fields;
+  folly::split(' ', folly::trimWhitespace(schedstat), fields, true);
+  if (fields.size() < 2) {
+    return folly::none;
+  }
+  auto cpuTimeNs = folly::tryTo<int64_t>(fields[0]);
+  auto runQueueWaitNs = folly::tryTo<int64_t>(fields[1]);
+  auto nvcsw = getStatusField(status, "voluntary_ctxt_switches");
+  auto nivcsw = getStatusField(status, "nonvoluntary_ctxt_switches");
+  if (cpuTimeNs.hasError() or runQueueWaitNs.hasError() or
+      not nvcsw.hasValue() or not nivcsw.hasValue()) {
+    return folly::none;
+  }
+
+  ThreadStats stats;
+  stats.cpuTime = std::chrono::nanoseconds(cpuTimeNs.value());
+  stats.runQueueWait = std::chrono::nanoseconds(runQueueWaitNs.value());
+  stats.voluntaryCtxSwitches = *nvcsw;
+  stats.involuntaryCtxSwitches = *nivcsw;
+  return stats;
+}
+
+std::vector<pid_t>
+getThreadIdsByName(std::string const& prefix) {
+  std::vector<pid_t> tids;
+  auto dir = ::opendir("/proc/self/task");
+  if (not dir) {
+    return tids;
+  }
+  while (auto entry = ::readdir(dir)) {
+    auto tid = folly::tryTo<pid_t>(entry->d_name);
+    if (tid.hasError()) {
+      // "." and ".."
+      continue;
+    }
+    std::string name;
+    const auto path = folly::sformat("/proc/self/task/{}/comm", tid.value());
+    if (not folly::readFile(path.c_str(), name)) {
+      // thread exited
+      continue;
+    }
+    if (folly::StringPiece(name).startsWith(prefix)) {
+      tids.emplace_back(tid.value());
+    }
+  }
+  ::closedir(dir);
+  return tids;
+}
+
+} // namespace openr
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+
+namespace openr {
+
+//
+// Scheduling statistics of a thread of the process, cumulative since it
+// started. They are read from procfs rather than with getrusage(), which
+// only reports on the calling thread, so that a thread can be looked at
+// without running anything on it.
+//
+struct ThreadStats {
+  // time spent running on a CPU
+  std::chrono::nanoseconds cpuTime{0};
+  // time spent runnable, waiting for a CPU
+  std::chrono::nanoseconds runQueueWait{0};
+  // context switches by blocking, e.g. on IO or a lock
+  int64_t voluntaryCtxSwitches{0};
+  // context switches by preemption
+  int64_t involuntaryCtxSwitches{0};
+
+  ThreadStats& operator+=(ThreadStats const& other);
+};
+
+/**
+ * Kernel id of the calling thread
+ */
+pid_t getThreadId();
+
+/**
+ * Statistics of a thread of the process, none if it is gone or procfs
+ * can't be read
+ */
+folly::Optional<ThreadStats> getThreadStats(pid_t tid);
+
+/**
+ * Parse /proc/<pid>/task/<tid>/schedstat and /proc/<pid>/task/<tid>/status
+ * contents. Returns none if malformed.
+ */
+folly::Optional<ThreadStats> parseThreadStats(
+    folly::StringPiece schedstat, folly::StringPiece status);
+
+/**
+ * Ids of the threads of the process whose name starts with prefix, e.g. the
+ * workers of a pool. Thread names are truncated to 15 characters by the
+ * kernel.
+ */
+std::vector<pid_t> getThreadIdsByName(std::string const& prefix);
+
+} // namespace openr
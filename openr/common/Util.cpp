@@ -7,6 +7,8 @@
 
 #include "Util.h"
 
+#include <algorithm>
+
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netinet/in.h>
@@ -14,6 +16,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <folly/hash/Hash.h>
+
 namespace openr {
 
 // create RE2 set for the list of key prefixes
@@ -21,6 +25,12 @@ KeyPrefix::KeyPrefix(std::vector<std::string> const& keyPrefixList) {
   if (keyPrefixList.empty()) {
     return;
   }
+  if (std::all_of(keyPrefixList.begin(), keyPrefixList.end(), isLiteral)) {
+    for (auto const& keyPrefix : keyPrefixList) {
+      literalPrefixes_[keyPrefix.size()].emplace(keyPrefix);
+    }
+    return;
+  }
   re2::RE2::Options re2Options;
   re2Options.set_case_sensitive(true);
   keyPrefix_ =
@@ -43,6 +53,17 @@ KeyPrefix::KeyPrefix(std::vector<std::string> const& keyPrefixList) {
 // match the key with the list of prefixes
 bool
 KeyPrefix::keyMatch(std::string const& key) const {
+  if (not literalPrefixes_.empty()) {
+    for (auto const& kv : literalPrefixes_) {
+      if (kv.first > key.size()) {
+        break;
+      }
+      if (kv.second.count(folly::StringPiece(key.data(), kv.first))) {
+        return true;
+      }
+    }
+    return false;
+  }
   if (!keyPrefix_) {
     return true;
   }
@@ -50,6 +71,11 @@ KeyPrefix::keyMatch(std::string const& key) const {
   return keyPrefix_->Match(key, &matches);
 }
 
+bool
+KeyPrefix::isLiteral(std::string const& keyPrefix) {
+  return keyPrefix.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
 PrefixKey::PrefixKey(
     std::string const& node,
     folly::CIDRNetwork const& prefix,
@@ -374,13 +400,27 @@ prepareSubmitCounters(
   return thriftCounters;
 }
 
+thrift::PerfEvent
+createPerfEvent(
+    const std::string& nodeName,
+    const std::string& eventDescr,
+    int64_t unixTs) {
+  thrift::PerfEvent event;
+  event.nodeName = nodeName;
+  event.eventDescr = eventDescr;
+  event.unixTs = unixTs;
+  return event;
+}
+
 void
 addPerfEvent(
     thrift::PerfEvents& perfEvents,
     const std::string& nodeName,
     const std::string& eventDescr) noexcept {
-  thrift::PerfEvent event(
-      apache::thrift::FRAGILE, nodeName, eventDescr, getUnixTimeStampMs());
+  auto event = createPerfEvent(nodeName, eventDescr, getUnixTimeStampMs());
+  event.monotonicTsUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
   perfEvents.events.emplace_back(std::move(event));
 }
 
@@ -451,18 +491,34 @@ getDurationBetweenPerfEvents(
   return std::chrono::milliseconds(second - first);
 }
 
+namespace {
+
+// hashes keep their version in the top byte
+constexpr int kHashVersionShift{56};
+
+} // namespace
+
 int64_t
 generateHash(
     const int64_t version,
     const std::string& originatorId,
     const folly::Optional<std::string>& value) {
-  size_t seed = 0;
-  boost::hash_combine(seed, version);
-  boost::hash_combine(seed, originatorId);
+  // value bytes dominate, hash them in one pass seeded by the rest
+  uint64_t seed = folly::hash::hash_128_to_64(
+      static_cast<uint64_t>(version), folly::hash::fnv64(originatorId));
   if (value.hasValue()) {
-    boost::hash_combine(seed, value.value());
+    seed = folly::hash::SpookyHashV2::Hash64(
+        value->data(), value->size(), seed);
   }
-  return static_cast<int64_t>(seed);
+  return static_cast<int64_t>(
+      (static_cast<uint64_t>(Constants::kKvStoreHashVersion)
+       << kHashVersionShift) |
+      (seed & ((uint64_t(1) << kHashVersionShift) - 1)));
+}
+
+uint8_t
+getHashVersion(int64_t hash) {
+  return static_cast<uint8_t>(static_cast<uint64_t>(hash) >> kHashVersionShift);
 }
 
 std::string
@@ -601,6 +657,129 @@ findDeltaRoutes(
   return routeDbDelta;
 }
 
+namespace {
+
+uint64_t
+hashPrefix(const thrift::IpPrefix& prefix) {
+  const auto& addr = prefix.prefixAddress.addr;
+  return folly::hash::SpookyHashV2::Hash64(
+      addr.data(), addr.size(), static_cast<uint64_t>(prefix.prefixLength));
+}
+
+uint64_t
+hashNextHop(const thrift::NextHopThrift& nextHop) {
+  const auto& addr = nextHop.address.addr;
+  auto hash = folly::hash::SpookyHashV2::Hash64(addr.data(), addr.size(), 0);
+  if (nextHop.address.ifName.hasValue()) {
+    const auto& ifName = nextHop.address.ifName.value();
+    hash =
+        folly::hash::SpookyHashV2::Hash64(ifName.data(), ifName.size(), hash);
+  }
+  if (nextHop.mplsAction.hasValue()) {
+    const auto& mplsAction = nextHop.mplsAction.value();
+    hash = folly::hash::hash_128_to_64(
+        hash, static_cast<uint64_t>(mplsAction.action));
+    if (mplsAction.swapLabel.hasValue()) {
+      hash = folly::hash::hash_128_to_64(
+          hash, static_cast<uint32_t>(mplsAction.swapLabel.value()));
+    }
+    if (mplsAction.pushLabels.hasValue()) {
+      for (const auto label : mplsAction.pushLabels.value()) {
+        hash = folly::hash::hash_128_to_64(hash, static_cast<uint32_t>(label));
+      }
+    }
+  }
+  return hash;
+}
+
+uint64_t
+fingerprintNextHop(const thrift::NextHopThrift& nextHop) {
+  auto hash = folly::hash::hash_128_to_64(
+      hashNextHop(nextHop), static_cast<uint32_t>(nextHop.weight));
+  hash =
+      folly::hash::hash_128_to_64(hash, static_cast<uint32_t>(nextHop.metric));
+  return folly::hash::hash_128_to_64(hash, nextHop.useNonShortestRoute);
+}
+
+// sum of mixed fingerprints, so that order of nexthops doesn't matter
+uint64_t
+fingerprintNextHops(const std::vector<thrift::NextHopThrift>& nextHops) {
+  uint64_t hash = nextHops.size();
+  for (const auto& nextHop : nextHops) {
+    hash += folly::hash::twang_mix64(fingerprintNextHop(nextHop));
+  }
+  return hash;
+}
+
+// optional fields hash to 0 when not set and to 1 + value otherwise
+uint64_t
+fingerprintAdminDistance(
+    const folly::Optional<thrift::AdminDistance>& adminDistance) {
+  return adminDistance.hasValue()
+      ? 1 + static_cast<uint64_t>(adminDistance.value())
+      : 0;
+}
+
+} // anonymous namespace
+
+uint64_t
+getRouteFingerprint(const thrift::UnicastRoute& route) {
+  auto hash = folly::hash::hash_128_to_64(
+      hashPrefix(route.dest), fingerprintNextHops(route.nextHops));
+  hash = folly::hash::hash_128_to_64(
+      hash, fingerprintAdminDistance(route.adminDistance));
+  hash = folly::hash::hash_128_to_64(
+      hash,
+      route.prefixType.hasValue()
+          ? 1 + static_cast<uint64_t>(route.prefixType.value())
+          : 0);
+  if (route.data.hasValue()) {
+    const auto& data = route.data.value();
+    hash = folly::hash::SpookyHashV2::Hash64(data.data(), data.size(), hash);
+  }
+  hash = folly::hash::hash_128_to_64(
+      hash, route.data.hasValue() + (route.doNotInstall << 1));
+  return folly::hash::hash_128_to_64(
+      hash,
+      route.bestNexthop.hasValue()
+          ? 1 + fingerprintNextHop(route.bestNexthop.value())
+          : 0);
+}
+
+uint64_t
+getRouteFingerprint(const thrift::MplsRoute& route) {
+  auto hash = folly::hash::hash_128_to_64(
+      static_cast<uint32_t>(route.topLabel),
+      fingerprintNextHops(route.nextHops));
+  return folly::hash::hash_128_to_64(
+      hash, fingerprintAdminDistance(route.adminDistance));
+}
+
+int32_t
+getRouteBucket(const thrift::IpPrefix& prefix, int32_t numBuckets) {
+  CHECK_LT(0, numBuckets);
+  return static_cast<int32_t>(
+      hashPrefix(prefix) % static_cast<uint64_t>(numBuckets));
+}
+
+std::vector<int64_t>
+getRouteBucketDigests(
+    const std::vector<thrift::UnicastRoute>& routes, int32_t numBuckets) {
+  CHECK_LT(0, numBuckets);
+  // sums of mixed hashes, so that neither routes nor nexthops order matters
+  std::vector<uint64_t> digests(numBuckets, 0);
+  for (const auto& route : routes) {
+    const auto prefixHash = hashPrefix(route.dest);
+    uint64_t nextHopsHash = route.nextHops.size();
+    for (const auto& nextHop : route.nextHops) {
+      nextHopsHash += folly::hash::twang_mix64(hashNextHop(nextHop));
+    }
+    digests[prefixHash % static_cast<uint64_t>(numBuckets)] +=
+        folly::hash::hash_128_to_64(prefixHash, nextHopsHash);
+  }
+  return {digests.begin(), digests.end()};
+}
+
 thrift::BuildInfo
 getBuildInfoThrift() noexcept {
   return thrift::BuildInfo(
@@ -964,6 +1143,82 @@ createMplsRoutesWithBestNextHops(const std::vector<thrift::MplsRoute>& routes) {
   return newRoutes;
 }
 
+void
+filterUnicastRoutesWithBestNextHops(std::vector<thrift::UnicastRoute>& routes) {
+  for (auto& route : routes) {
+    auto& nextHops = route.nextHops;
+    if (nextHops.size() > 1) {
+      int32_t minCost = std::numeric_limits<int32_t>::max();
+      for (auto const& nextHop : nextHops) {
+        minCost = std::min(minCost, nextHop.metric);
+      }
+      nextHops.erase(
+          std::remove_if(
+              nextHops.begin(),
+              nextHops.end(),
+              [minCost](const thrift::NextHopThrift& nextHop) {
+                return nextHop.metric != minCost and
+                    not nextHop.useNonShortestRoute;
+              }),
+          nextHops.end());
+      if (not std::is_sorted(nextHops.begin(), nextHops.end())) {
+        std::sort(nextHops.begin(), nextHops.end());
+      }
+    }
+    // Keep destination and nexthops only, as createUnicastRoute
+    if (route.adminDistance.hasValue() or route.prefixType.hasValue() or
+        route.data.hasValue() or route.doNotInstall or
+        route.bestNexthop.hasValue()) {
+      route = createUnicastRoute(std::move(route.dest), std::move(nextHops));
+    }
+  }
+}
+
+void
+filterMplsRoutesWithBestNextHops(std::vector<thrift::MplsRoute>& routes) {
+  for (auto& route : routes) {
+    CHECK(isMplsLabelValid(route.topLabel));
+    // Keep label and nexthops only, as createMplsRoute
+    route.adminDistance.clear();
+    auto& nextHops = route.nextHops;
+    if (nextHops.size() <= 1) {
+      for (auto const& nextHop : nextHops) {
+        CHECK(nextHop.mplsAction.hasValue());
+      }
+      continue;
+    }
+
+    // Same selection as getBestNextHopsMpls
+    int32_t minCost = std::numeric_limits<int32_t>::max();
+    thrift::MplsActionCode mplsActionCode{thrift::MplsActionCode::SWAP};
+    for (auto const& nextHop : nextHops) {
+      CHECK(nextHop.mplsAction.hasValue());
+      CHECK(thrift::MplsActionCode::PUSH != nextHop.mplsAction->action);
+      CHECK(
+          thrift::MplsActionCode::POP_AND_LOOKUP != nextHop.mplsAction->action);
+
+      if (nextHop.metric <= minCost) {
+        minCost = nextHop.metric;
+        if (nextHop.mplsAction->action == thrift::MplsActionCode::PHP) {
+          mplsActionCode = thrift::MplsActionCode::PHP;
+        }
+      }
+    }
+    nextHops.erase(
+        std::remove_if(
+            nextHops.begin(),
+            nextHops.end(),
+            [minCost, mplsActionCode](const thrift::NextHopThrift& nextHop) {
+              return nextHop.metric != minCost or
+                  nextHop.mplsAction->action != mplsActionCode;
+            }),
+        nextHops.end());
+    if (not std::is_sorted(nextHops.begin(), nextHops.end())) {
+      std::sort(nextHops.begin(), nextHops.end());
+    }
+  }
+}
+
 std::vector<thrift::UnicastRoute>
 createUnicastRoutesWithBestNextHopsMap(
     const std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute>&
@@ -982,9 +1237,10 @@ createUnicastRoutesWithBestNextHopsMap(
 
 std::vector<thrift::MplsRoute>
 createMplsRoutesWithBestNextHopsMap(
-    const std::unordered_map<uint32_t, thrift::MplsRoute>& mplsRoutes) {
+    const LabelTable<thrift::MplsRoute>& mplsRoutes) {
   // Build routes to be programmed
   std::vector<thrift::MplsRoute> newRoutes;
+  newRoutes.reserve(mplsRoutes.size());
 
   for (auto const& route : mplsRoutes) {
     newRoutes.emplace_back(createMplsRoute(
@@ -1186,6 +1442,109 @@ compareMetricVectors(
   return result;
 }
 
+CompiledMetricVector
+compileMetricVector(thrift::MetricVector const& mv) {
+  CompiledMetricVector cmv;
+  cmv.version = mv.version;
+  cmv.entities.reserve(mv.metrics.size());
+  size_t numMetrics = 0;
+  for (auto const& entity : mv.metrics) {
+    numMetrics += entity.metric.size();
+  }
+  cmv.metrics.reserve(numMetrics);
+  for (auto const& entity : mv.metrics) {
+    addMetricEntity(cmv, entity);
+  }
+  return cmv;
+}
+
+void
+addMetricEntity(CompiledMetricVector& cmv, thrift::MetricEntity const& entity) {
+  CompiledMetricVector::Entity compiled;
+  compiled.type = entity.type;
+  compiled.priority = entity.priority;
+  compiled.isBestPathTieBreaker = entity.isBestPathTieBreaker;
+  compiled.lonerResult = resultForLoner(entity);
+  compiled.offset = static_cast<uint32_t>(cmv.metrics.size());
+  compiled.size = static_cast<uint32_t>(entity.metric.size());
+  cmv.metrics.insert(
+      cmv.metrics.end(), entity.metric.begin(), entity.metric.end());
+
+  // vectors are almost always sorted already, search from the back
+  auto it = cmv.entities.end();
+  while (it != cmv.entities.begin() and (it - 1)->priority < entity.priority) {
+    --it;
+  }
+  cmv.entities.insert(it, compiled);
+}
+
+namespace {
+
+CompareResult
+compareCompiledMetrics(
+    int64_t const* l, int64_t const* r, uint32_t size, bool tieBreaker) {
+  for (uint32_t i = 0; i < size; ++i) {
+    if (l[i] > r[i]) {
+      return tieBreaker ? CompareResult::TIE_WINNER : CompareResult::WINNER;
+    } else if (l[i] < r[i]) {
+      return tieBreaker ? CompareResult::TIE_LOOSER : CompareResult::LOOSER;
+    }
+  }
+  return CompareResult::TIE;
+}
+
+} // namespace
+
+CompareResult
+compareMetricVectors(
+    CompiledMetricVector const& l, CompiledMetricVector const& r) {
+  CompareResult result = CompareResult::TIE;
+
+  if (l.version != r.version) {
+    return CompareResult::ERROR;
+  }
+
+  auto lIter = l.entities.begin();
+  auto rIter = r.entities.begin();
+  while (!isDecisive(result) &&
+         (lIter != l.entities.end() && rIter != r.entities.end())) {
+    if (lIter->type == rIter->type) {
+      if (lIter->isBestPathTieBreaker != rIter->isBestPathTieBreaker or
+          lIter->size != rIter->size) {
+        maybeUpdate(result, CompareResult::ERROR);
+      } else {
+        maybeUpdate(
+            result,
+            compareCompiledMetrics(
+                l.metrics.data() + lIter->offset,
+                r.metrics.data() + rIter->offset,
+                lIter->size,
+                lIter->isBestPathTieBreaker));
+      }
+      ++lIter;
+      ++rIter;
+    } else if (lIter->priority > rIter->priority) {
+      maybeUpdate(result, lIter->lonerResult);
+      ++lIter;
+    } else if (lIter->priority < rIter->priority) {
+      maybeUpdate(result, !rIter->lonerResult);
+      ++rIter;
+    } else {
+      // priorities are the same but types are different
+      maybeUpdate(result, CompareResult::ERROR);
+    }
+  }
+  while (!isDecisive(result) && lIter != l.entities.end()) {
+    maybeUpdate(result, lIter->lonerResult);
+    ++lIter;
+  }
+  while (!isDecisive(result) && rIter != r.entities.end()) {
+    maybeUpdate(result, !rIter->lonerResult);
+    ++rIter;
+  }
+  return result;
+}
+
 } // namespace MetricVectorUtils
 
 } // namespace openr
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -18,12 +19,14 @@
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/String.h>
+#include <folly/container/F14Set.h>
 #include <re2/re2.h>
 #include <re2/set.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/BuildInfo.h>
 #include <openr/common/Constants.h>
+#include <openr/common/LabelTable.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Types.h>
 #include <openr/if/gen-cpp2/AllocPrefix_types.h>
@@ -44,7 +47,15 @@ class KeyPrefix {
   explicit KeyPrefix(std::vector<std::string> const& keyPrefixList);
   bool keyMatch(std::string const& key) const;
 
+  // true if prefix has no regex special characters
+  static bool isLiteral(std::string const& keyPrefix);
+
  private:
+  // If all prefixes are literal they are indexed by length instead of
+  // compiled into a RE2 set. A key is then matched with one hash lookup per
+  // distinct prefix length
+  std::map<size_t, folly::F14FastSet<std::string>> literalPrefixes_;
+
   std::unique_ptr<re2::RE2::Set> keyPrefix_;
 };
 
@@ -180,6 +191,12 @@ getUnixTimeStampMs() noexcept {
       .count();
 }
 
+/**
+ * Create a perf event with its unix timestamp, without monotonic one
+ */
+thrift::PerfEvent createPerfEvent(
+    const std::string& nodeName, const std::string& eventDescr, int64_t unixTs);
+
 /**
  * Add a perf event
  */
@@ -208,13 +225,17 @@ getDurationBetweenPerfEvents(
 
 /**
  * Generate hash for each keyval pair
- * as a abstract of version number, originator and values
+ * as a abstract of version number, originator and values. The top byte holds
+ * Constants::kKvStoreHashVersion, hashes are only comparable within a version
  */
 int64_t generateHash(
     const int64_t version,
     const std::string& originatorId,
     const folly::Optional<std::string>& value);
 
+// version of the algorithm which generated the hash
+uint8_t getHashVersion(int64_t hash);
+
 /**
  * TO BE DEPRECATED SOON: Backward compatible with empty remoteIfName
  * Translate remote interface name from local interface name
@@ -245,6 +266,27 @@ thrift::RouteDatabaseDelta findDeltaRoutes(
     const thrift::RouteDatabase& newRouteDb,
     const thrift::RouteDatabase& oldRouteDb);
 
+/**
+ * 64 bit fingerprint of a route covering all of its fields, independent of
+ * the order of its nexthops. Routes with equal fingerprints are programmed
+ * the same way.
+ */
+uint64_t getRouteFingerprint(const thrift::UnicastRoute& route);
+uint64_t getRouteFingerprint(const thrift::MplsRoute& route);
+
+/**
+ * Bucket of prefix among numBuckets, used to compare route tables bucket by
+ * bucket. Hashes are stable across processes and builds
+ */
+int32_t getRouteBucket(const thrift::IpPrefix& prefix, int32_t numBuckets);
+
+/**
+ * Digest of the routes of each bucket, independent of the order of routes
+ * and of nexthops. Weight and metric of nexthops are not part of it.
+ */
+std::vector<int64_t> getRouteBucketDigests(
+    const std::vector<thrift::UnicastRoute>& routes, int32_t numBuckets);
+
 thrift::BuildInfo getBuildInfoThrift() noexcept;
 
 /**
@@ -392,12 +434,21 @@ std::vector<thrift::UnicastRoute> createUnicastRoutesWithBestNexthops(
 std::vector<thrift::MplsRoute> createMplsRoutesWithBestNextHops(
     const std::vector<thrift::MplsRoute>& routes);
 
+/**
+ * Same as above, but on owned routes: best nexthops are selected in place,
+ * without copying routes nor their nexthops
+ */
+void filterUnicastRoutesWithBestNextHops(
+    std::vector<thrift::UnicastRoute>& routes);
+
+void filterMplsRoutesWithBestNextHops(std::vector<thrift::MplsRoute>& routes);
+
 std::vector<thrift::UnicastRoute> createUnicastRoutesWithBestNextHopsMap(
     const std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute>&
         unicastRoutes);
 
 std::vector<thrift::MplsRoute> createMplsRoutesWithBestNextHopsMap(
-    const std::unordered_map<uint32_t, thrift::MplsRoute>& mplsRoutes);
+    const LabelTable<thrift::MplsRoute>& mplsRoutes);
 
 std::string getNodeNameFromKey(const std::string& key);
 
@@ -437,6 +488,38 @@ void maybeUpdate(CompareResult& target, CompareResult update);
 
 CompareResult compareMetricVectors(
     thrift::MetricVector const& l, thrift::MetricVector const& r);
+
+/**
+ * Metric vector flattened for repeated comparisons. Entities are sorted in
+ * decreasing order of priority with their result as a loner precomputed, and
+ * all metrics are packed in one contiguous array.
+ */
+struct CompiledMetricVector {
+  struct Entity {
+    int64_t type{0};
+    int64_t priority{0};
+    bool isBestPathTieBreaker{false};
+    // result if only present in this vector
+    CompareResult lonerResult{CompareResult::TIE};
+    // range of this entity's metric in metrics
+    uint32_t offset{0};
+    uint32_t size{0};
+  };
+
+  int64_t version{0};
+  std::vector<Entity> entities;
+  std::vector<int64_t> metrics;
+};
+
+CompiledMetricVector compileMetricVector(thrift::MetricVector const& mv);
+
+// add an entity keeping entities sorted, after those of the same priority
+void addMetricEntity(
+    CompiledMetricVector& cmv, thrift::MetricEntity const& entity);
+
+// same result as comparing the thrift metric vectors they were compiled from
+CompareResult compareMetricVectors(
+    CompiledMetricVector const& l, CompiledMetricVector const& r);
 } // namespace MetricVectorUtils
 
 } // namespace openr
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "WindowedHistogram.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// value at the given percentile of samples, reorders samples
+int64_t
+getPercentile(std::vector<int64_t>& samples, size_t percentile) {
+  DCHECK(not samples.empty());
+  const size_t rank = (samples.size() - 1) * percentile / 100;
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+} // anonymous namespace
+
+WindowedHistogram::WindowedHistogram(size_t windowSize)
+    : windowSize_(windowSize) {
+  CHECK_LT(0, windowSize_);
+}
+
+void
+WindowedHistogram::addValue(int64_t value) {
+  if (samples_.size() < windowSize_) {
+    samples_.emplace_back(value);
+  } else {
+    samples_[next_] = value;
+  }
+  next_ = (next_ + 1) % windowSize_;
+}
+
+void
+WindowedHistogram::addCounters(
+    std::string const& prefix,
+    std::unordered_map<std::string, int64_t>& counters) const {
+  if (samples_.empty()) {
+    return;
+  }
+  auto samples = samples_;
+  counters[prefix + ".p50"] = getPercentile(samples, 50);
+  counters[prefix + ".p99"] = getPercentile(samples, 99);
+  counters[prefix + ".max"] = *std::max_element(samples.begin(), samples.end());
+}
+
+} // namespace openr
@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openr {
+
+/**
+ * Histogram of the most recent values, e.g. durations of the last runs of a
+ * processing phase. Values are kept in a ring buffer of windowSize entries,
+ * percentiles are exact over them.
+ *
+ * Unlike LatencyHistogram, which counts all values ever added in fixed
+ * buckets, old values age out and small ones aren't rounded.
+ */
+class WindowedHistogram {
+ public:
+  explicit WindowedHistogram(size_t windowSize);
+
+  void addValue(int64_t value);
+
+  bool
+  empty() const {
+    return samples_.empty();
+  }
+
+  // Adds p50, p99 and max of the window as "<prefix>.p50", "<prefix>.p99"
+  // and "<prefix>.max" to counters. Nothing if empty
+  void addCounters(
+      std::string const& prefix,
+      std::unordered_map<std::string, int64_t>& counters) const;
+
+ private:
+  size_t windowSize_{0};
+  std::vector<int64_t> samples_;
+  // slot of the next value once the window is full
+  size_t next_{0};
+};
+
+} // namespace openr
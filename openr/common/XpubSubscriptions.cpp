@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/XpubSubscriptions.h>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+void
+XpubSubscriptions::update(fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER>& sock) {
+  while (true) {
+    auto maybeMsg = sock.recvOne();
+    if (maybeMsg.hasError()) {
+      if (maybeMsg.error().errNum != EAGAIN) {
+        LOG(ERROR) << "Error reading subscription: " << maybeMsg.error();
+      }
+      return;
+    }
+    processMessage(maybeMsg->data());
+  }
+}
+
+void
+XpubSubscriptions::processMessage(folly::ByteRange msg) {
+  if (msg.empty() or msg.front() > 1) {
+    // not a subscription, e.g. a message sent by a subscriber
+    return;
+  }
+  const std::string topic(
+      reinterpret_cast<const char*>(msg.data() + 1), msg.size() - 1);
+  if (msg.front() == 1) {
+    VLOG(2) << "Subscription to topic of " << topic.size() << " bytes";
+    topics_.emplace(topic);
+  } else {
+    VLOG(2) << "Unsubscription from topic of " << topic.size() << " bytes";
+    topics_.erase(topic);
+  }
+}
+
+bool
+XpubSubscriptions::hasSubscribers(folly::ByteRange topic) const {
+  for (auto const& subscribed : topics_) {
+    if (topic.startsWith(folly::ByteRange(folly::StringPiece(subscribed)))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace openr
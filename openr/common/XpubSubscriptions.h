@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Range.h>
+
+namespace openr {
+
+/**
+ * Topics subscribed to on an XPUB socket, as told by the subscription
+ * messages the socket receives. Publishers check for subscribers before
+ * encoding a message, and skip it while nobody listens.
+ *
+ * XPUB only passes the first subscription and the last unsubscription of a
+ * topic up, including the ones of disconnecting subscribers, so a set of the
+ * subscribed topics is all we need.
+ */
+class XpubSubscriptions {
+ public:
+  // read all the subscription messages pending on the non-blocking sock
+  void update(fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER>& sock);
+
+  // apply one subscription message: 1 to subscribe or 0 to unsubscribe,
+  // followed by the topic
+  void processMessage(folly::ByteRange msg);
+
+  // whether anyone subscribed to any topic
+  bool
+  hasSubscribers() const {
+    return not topics_.empty();
+  }
+
+  // whether a message starting with topic reaches a subscriber
+  bool hasSubscribers(folly::ByteRange topic) const;
+
+  size_t
+  getNumTopics() const {
+    return topics_.size();
+  }
+
+ private:
+  std::set<std::string> topics_;
+};
+
+} // namespace openr
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <tuple>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ConvergenceTrace.h>
+#include <openr/common/Util.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::PerfEvent
+createEvent(
+    const std::string& nodeName,
+    const std::string& eventDescr,
+    int64_t unixTs,
+    folly::Optional<int64_t> monotonicTsUs = folly::none,
+    folly::Optional<int64_t> durationUs = folly::none) {
+  auto event = createPerfEvent(nodeName, eventDescr, unixTs);
+  event.monotonicTsUs = monotonicTsUs;
+  event.durationUs = durationUs;
+  return event;
+}
+
+// neighbor of node1 going up, until routes of node2 are programmed
+thrift::PerfEvents
+createPerfEvents() {
+  thrift::PerfEvents perfEvents;
+  perfEvents.events = {
+      createEvent("node1", "NEIGHBOR_UP", 100, 1000),
+      createEvent("node1", "ADJ_DB_UPDATED", 102, 3500),
+      createEvent("node2", "DECISION_RECEIVED", 110),
+      createEvent("node2", "DECISION_DEBOUNCE", 120),
+      createEvent("node2", "DECISION_PHASE_SPF", 125, folly::none, 3000),
+      createEvent("node2", "DECISION_PHASE_ROUTES", 125, folly::none, 1000),
+      createEvent("node2", "DECISION_SPF", 125),
+      createEvent("node2", "FIB_ROUTE_DB_RECVD", 126),
+      createEvent("node2", "OPENR_FIB_ROUTES_PROGRAMMED", 130),
+  };
+  return perfEvents;
+}
+
+} // anonymous namespace
+
+TEST(ConvergenceTraceTest, Disabled) {
+  ConvergenceTrace trace(0, 1);
+  EXPECT_FALSE(trace.isEnabled());
+  EXPECT_FALSE(trace.record(createPerfEvents()));
+  EXPECT_EQ(0, trace.getNumRecorded());
+  EXPECT_TRUE(trace.dump().empty());
+}
+
+TEST(ConvergenceTraceTest, PerfStages) {
+  EXPECT_EQ(
+      thrift::PerfStage::NEIGHBOR_EVENT,
+      ConvergenceTrace::getPerfStage("NEIGHBOR_DOWN"));
+  EXPECT_EQ(
+      thrift::PerfStage::PREFIX_DB_UPDATED,
+      ConvergenceTrace::getPerfStage("ADD_PREFIX"));
+  EXPECT_EQ(
+      thrift::PerfStage::KVSTORE_FLOOD,
+      ConvergenceTrace::getPerfStage("DECISION_RECEIVED"));
+  EXPECT_EQ(
+      thrift::PerfStage::DECISION_PHASE,
+      ConvergenceTrace::getPerfStage("DECISION_PHASE_SPF"));
+  EXPECT_EQ(
+      thrift::PerfStage::DECISION_ROUTE_UPDATE,
+      ConvergenceTrace::getPerfStage("ROUTE_UPDATE"));
+  EXPECT_EQ(
+      thrift::PerfStage::OTHER, ConvergenceTrace::getPerfStage("UNKNOWN"));
+}
+
+TEST(ConvergenceTraceTest, Spans) {
+  ConvergenceTrace trace(4, 1);
+  EXPECT_TRUE(trace.record(createPerfEvents()));
+  EXPECT_FALSE(trace.record(thrift::PerfEvents()));
+  EXPECT_EQ(1, trace.getNumRecorded());
+
+  const auto entries = trace.dump();
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ(30000, entries[0].totalDurationUs);
+
+  const auto& spans = entries[0].spans;
+  ASSERT_EQ(9, spans.size());
+  // stage, node, start and duration of spans
+  using Span = std::tuple<thrift::PerfStage, std::string, int64_t, int64_t>;
+  const std::vector<Span> expected = {
+      {thrift::PerfStage::NEIGHBOR_EVENT, "node1", 100000, 0},
+      // monotonic timestamps of node1
+      {thrift::PerfStage::ADJ_DB_UPDATED, "node1", 100000, 2500},
+      {thrift::PerfStage::KVSTORE_FLOOD, "node2", 102500, 7500},
+      {thrift::PerfStage::DECISION_DEBOUNCE, "node2", 110000, 10000},
+      {thrift::PerfStage::DECISION_ROUTE_UPDATE, "node2", 120000, 5000},
+      // phases at the end of the computation
+      {thrift::PerfStage::DECISION_PHASE, "node2", 121000, 3000},
+      {thrift::PerfStage::DECISION_PHASE, "node2", 124000, 1000},
+      {thrift::PerfStage::FIB_ROUTE_DB_RECEIVED, "node2", 125000, 1000},
+      {thrift::PerfStage::FIB_ROUTES_PROGRAMMED, "node2", 126000, 4000},
+  };
+  for (size_t i = 0; i < spans.size(); ++i) {
+    EXPECT_EQ(std::get<0>(expected[i]), spans[i].stage) << i;
+    EXPECT_EQ(std::get<1>(expected[i]), spans[i].nodeName) << i;
+    EXPECT_EQ(std::get<2>(expected[i]), spans[i].startUs) << i;
+    EXPECT_EQ(std::get<3>(expected[i]), spans[i].durationUs) << i;
+  }
+  EXPECT_EQ("DECISION_PHASE_SPF", spans[5].eventDescr);
+  EXPECT_EQ("OPENR_FIB_ROUTES_PROGRAMMED", spans[8].eventDescr);
+}
+
+TEST(ConvergenceTraceTest, ClockSkew) {
+  ConvergenceTrace trace(1, 1);
+  thrift::PerfEvents perfEvents;
+  perfEvents.events = {
+      createEvent("node1", "ADJ_DB_UPDATED", 100),
+      // clock of node2 behind
+      createEvent("node2", "DECISION_RECEIVED", 90),
+      createEvent("node2", "DECISION_DEBOUNCE", 95),
+  };
+  EXPECT_TRUE(trace.record(perfEvents));
+
+  const auto entries = trace.dump();
+  ASSERT_EQ(1, entries.size());
+  ASSERT_EQ(3, entries[0].spans.size());
+  EXPECT_EQ(0, entries[0].spans[1].durationUs);
+  EXPECT_EQ(0, entries[0].spans[2].durationUs);
+  EXPECT_EQ(0, entries[0].totalDurationUs);
+}
+
+TEST(ConvergenceTraceTest, SamplingAndWrapAround) {
+  ConvergenceTrace trace(2, 3);
+  EXPECT_EQ(3, trace.getSampleRate());
+
+  // first of every three events is traced
+  for (int i = 0; i < 9; ++i) {
+    auto perfEvents = createPerfEvents();
+    perfEvents.events.front().unixTs = i;
+    EXPECT_EQ(i % 3 == 0, trace.record(perfEvents));
+  }
+  EXPECT_EQ(3, trace.getNumRecorded());
+
+  // latest traces, oldest first
+  const auto entries = trace.dump();
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ(3000, entries[0].spans.front().startUs);
+  EXPECT_EQ(6000, entries[1].spans.front().startUs);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/CounterRegistry.h>
+
+using namespace openr;
+
+namespace {
+
+const std::chrono::hours kLongMaxAge{1};
+
+} // namespace
+
+TEST(CounterRegistryTest, CachedSnapshot) {
+  CounterRegistry registry(kLongMaxAge);
+  int numCalls{0};
+  int64_t value{1};
+  registry.addSource([&](CounterRegistry::Counters& counters) {
+    ++numCalls;
+    counters["decision.runs"] = value;
+  });
+  registry.addSource([&](CounterRegistry::Counters& counters) {
+    counters["fib.routes"] = 10;
+  });
+
+  EXPECT_EQ(1, registry.getCounters()->at("decision.runs"));
+  EXPECT_EQ(10, registry.getCounters()->at("fib.routes"));
+  EXPECT_EQ(1, numCalls);
+
+  // cached until refreshed
+  value = 2;
+  EXPECT_EQ(
+      1, registry.getSelectedCounters({"decision.runs"}).at("decision.runs"));
+  EXPECT_EQ(2, registry.getCounters(true)->at("decision.runs"));
+  EXPECT_EQ(2, numCalls);
+  EXPECT_EQ(2, registry.getNumRefreshes());
+
+  // expires after max age
+  CounterRegistry expiring(std::chrono::milliseconds(0));
+  expiring.addSource(
+      [&](CounterRegistry::Counters& counters) { counters["a"] = value++; });
+  const auto first = expiring.getCounters()->at("a");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_LT(first, expiring.getCounters()->at("a"));
+}
+
+TEST(CounterRegistryTest, RegexCounters) {
+  CounterRegistry registry(std::chrono::milliseconds(0));
+  CounterRegistry::Counters source{
+      {"decision.runs", 1}, {"decision.spf_ms", 2}, {"fib.routes", 3}};
+  registry.addSource([&](CounterRegistry::Counters& counters) {
+    counters.insert(source.begin(), source.end());
+  });
+
+  const CounterRegistry::Counters expected{
+      {"decision.runs", 1}, {"decision.spf_ms", 2}};
+  EXPECT_EQ(expected, registry.getRegexCounters("^decision\\."));
+  EXPECT_EQ(0, registry.getNumRegexCacheHits());
+  EXPECT_EQ(1, registry.getNumRegexCacheMisses());
+
+  // same counter names, matches are memoized and values are current
+  source["decision.runs"] = 5;
+  const CounterRegistry::Counters updated{
+      {"decision.runs", 5}, {"decision.spf_ms", 2}};
+  EXPECT_EQ(updated, registry.getRegexCounters("^decision\\."));
+  EXPECT_EQ(1, registry.getNumRegexCacheHits());
+
+  // new counter names invalidate memoized matches
+  source["decision.adj_dbs"] = 7;
+  EXPECT_EQ(3, registry.getRegexCounters("^decision\\.").size());
+  EXPECT_EQ(2, registry.getNumRegexCacheMisses());
+
+  // invalid regex matches nothing
+  EXPECT_EQ(0, registry.getRegexCounters("(decision").size());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/CpuProfiler.h>
+
+using namespace openr;
+
+namespace {
+
+// keep the calling thread busy for duration
+void
+burnCpu(std::chrono::milliseconds duration) {
+  const auto deadline = std::chrono::steady_clock::now() + duration;
+  volatile uint64_t value{0};
+  while (std::chrono::steady_clock::now() < deadline) {
+    for (int i = 0; i < 1000; ++i) {
+      value = value * 31 + i;
+    }
+  }
+}
+
+bool
+isRegistered(std::string const& name) {
+  auto const names = CpuProfiler::get().getThreadNames();
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+thrift::CpuProfileParams
+createParams(std::vector<std::string> threadNames) {
+  thrift::CpuProfileParams params;
+  params.threadNames = std::move(threadNames);
+  params.durationSec = 10;
+  params.samplingHz = 1000;
+  return params;
+}
+
+} // namespace
+
+TEST(CpuProfilerTest, Errors) {
+  auto& profiler = CpuProfiler::get();
+  profiler.registerThread("Errors");
+
+  // nothing to collect
+  EXPECT_TRUE(profiler.stop().hasError());
+
+  // invalid params
+  EXPECT_TRUE(profiler.start(createParams({"Unknown"})).hasError());
+  auto params = createParams({"Errors"});
+  params.durationSec = 0;
+  EXPECT_TRUE(profiler.start(params).hasError());
+  params = createParams({"Errors"});
+  params.samplingHz = 100000;
+  EXPECT_TRUE(profiler.start(params).hasError());
+
+  // one profile at a time
+  EXPECT_TRUE(profiler.start(createParams({"Errors"})).hasValue());
+  EXPECT_TRUE(profiler.start(createParams({"Errors"})).hasError());
+  EXPECT_TRUE(profiler.stop().hasValue());
+  EXPECT_TRUE(profiler.stop().hasError());
+}
+
+TEST(CpuProfilerTest, Profile) {
+  auto& profiler = CpuProfiler::get();
+  profiler.registerThread("Busy");
+
+  // idle threads are not sampled
+  std::atomic<bool> done{false};
+  std::thread idleThread([&]() {
+    CpuProfiler::get().registerThread("Idle");
+    while (not done) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+  while (not isRegistered("Idle")) {
+    std::this_thread::yield();
+  }
+
+  ASSERT_TRUE(profiler.start(createParams({"Busy", "Idle"})).hasValue());
+  burnCpu(std::chrono::milliseconds(300));
+  auto profile = profiler.stop();
+  done = true;
+  idleThread.join();
+  ASSERT_TRUE(profile.hasValue());
+
+  EXPECT_LT(0, profile->numSamples);
+  EXPECT_EQ(0, profile->numDroppedSamples);
+  EXPECT_LE(300, profile->durationMs);
+  ASSERT_EQ(2, profile->threadCpuTimeUs.size());
+  EXPECT_LE(200000, profile->threadCpuTimeUs.at("Busy"));
+  EXPECT_GT(100000, profile->threadCpuTimeUs.at("Idle"));
+
+  // stacks start with the thread name
+  int64_t numSamples{0};
+  int64_t numBusySamples{0};
+  for (auto const& kv : profile->foldedStacks) {
+    if (kv.first.find("Busy;") == 0) {
+      numBusySamples += kv.second;
+    } else {
+      EXPECT_EQ(0, kv.first.find("Idle;")) << kv.first;
+    }
+    numSamples += kv.second;
+  }
+  EXPECT_EQ(profile->numSamples, numSamples);
+  EXPECT_LT(numSamples / 2, numBusySamples);
+}
+
+TEST(CpuProfilerTest, Duration) {
+  auto& profiler = CpuProfiler::get();
+  profiler.registerThread("Duration");
+
+  // sampling stops once the duration elapsed
+  auto params = createParams({"Duration"});
+  params.durationSec = 1;
+  ASSERT_TRUE(profiler.start(params).hasValue());
+  burnCpu(std::chrono::milliseconds(1500));
+  auto profile = profiler.stop();
+  ASSERT_TRUE(profile.hasValue());
+  EXPECT_LT(0, profile->numSamples);
+  EXPECT_GE(1100, profile->threadCpuTimeUs.at("Duration") / 1000);
+  EXPECT_GE(1100, profile->durationMs);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/EventLogBuffer.h>
+
+using namespace openr;
+
+TEST(EventLogBufferTest, LogAndDrain) {
+  EventLogBuffer buffer(16);
+  EXPECT_TRUE(buffer.log([](EventLogRecord& record) {
+    record.addString("event", "IFACE_UP");
+    record.addString("interface", std::string("po1"));
+    record.addInt("backoff_ms", 64);
+    record.addStringVector("perf_events", {"a", "", "bc"});
+  }));
+
+  auto samples = buffer.drain(100);
+  ASSERT_EQ(1, samples.size());
+  auto sample = fbzmq::LogSample::fromJson(samples.at(0));
+  EXPECT_EQ("IFACE_UP", sample.getString("event"));
+  EXPECT_EQ("po1", sample.getString("interface"));
+  EXPECT_EQ(64, sample.getInt("backoff_ms"));
+  EXPECT_EQ(
+      std::vector<std::string>({"a", "", "bc"}),
+      sample.getStringVector("perf_events"));
+  EXPECT_TRUE(buffer.drain(100).empty());
+
+  auto counters = buffer.getCounters();
+  EXPECT_EQ(1, counters.at("event_log.logged"));
+  EXPECT_EQ(1, counters.at("event_log.drained"));
+  EXPECT_EQ(0, counters.at("event_log.dropped"));
+}
+
+TEST(EventLogBufferTest, DropAndTruncate) {
+  EventLogBuffer buffer(4);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(i < 4, buffer.log([i](EventLogRecord& record) {
+      record.addInt("index", i);
+    }));
+  }
+  // batches are bounded, oldest events first
+  auto samples = buffer.drain(3);
+  ASSERT_EQ(3, samples.size());
+  EXPECT_EQ(0, fbzmq::LogSample::fromJson(samples.at(0)).getInt("index"));
+  EXPECT_EQ(1, buffer.drain(100).size());
+
+  // fields past the size of the record are dropped
+  EXPECT_TRUE(buffer.log([](EventLogRecord& record) {
+    record.addString("event", "LARGE");
+    record.addString(
+        "value", std::string(EventLogRecord::kDataSize + 1, 'x'));
+    EXPECT_TRUE(record.isTruncated());
+  }));
+  samples = buffer.drain(100);
+  ASSERT_EQ(1, samples.size());
+  EXPECT_EQ(
+      "LARGE", fbzmq::LogSample::fromJson(samples.at(0)).getString("event"));
+
+  auto counters = buffer.getCounters();
+  EXPECT_EQ(5, counters.at("event_log.logged"));
+  EXPECT_EQ(2, counters.at("event_log.dropped"));
+  EXPECT_EQ(1, counters.at("event_log.truncated"));
+  EXPECT_EQ(5, counters.at("event_log.drained"));
+}
+
+//
+// Every thread logs to a ring of its own, drained while they log. Rings of
+// exited threads are released once drained
+//
+TEST(EventLogBufferTest, ConcurrentThreads) {
+  const int kNumThreads{4};
+  const int kNumEvents{1000};
+  EventLogBuffer buffer(64);
+
+  std::atomic<int> numRunning{kNumThreads};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumEvents; ++i) {
+        // retry dropped events for all of them to be drained
+        while (not buffer.log([&](EventLogRecord& record) {
+          record.addInt("thread", t);
+          record.addInt("index", i);
+        })) {
+          std::this_thread::yield();
+        }
+      }
+      --numRunning;
+    });
+  }
+
+  std::set<std::pair<int64_t, int64_t>> events;
+  std::vector<int64_t> lastIndex(kNumThreads, -1);
+  while (numRunning or events.size() < kNumThreads * kNumEvents) {
+    for (auto const& json : buffer.drain(100)) {
+      auto sample = fbzmq::LogSample::fromJson(json);
+      auto thread = sample.getInt("thread");
+      auto index = sample.getInt("index");
+      // in order within a thread
+      EXPECT_EQ(lastIndex.at(thread) + 1, index);
+      lastIndex.at(thread) = index;
+      events.emplace(thread, index);
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kNumThreads * kNumEvents, events.size());
+  EXPECT_TRUE(buffer.drain(100).empty());
+
+  auto counters = buffer.getCounters();
+  EXPECT_EQ(0, counters.at("event_log.threads"));
+  EXPECT_EQ(kNumThreads * kNumEvents, counters.at("event_log.logged"));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
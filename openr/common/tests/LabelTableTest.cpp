@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/LabelTable.h>
+
+using namespace openr;
+
+namespace {
+
+std::map<int32_t, std::string>
+toMap(const LabelTable<std::string>& table) {
+  std::map<int32_t, std::string> entries;
+  for (auto const& kv : table) {
+    EXPECT_TRUE(entries.emplace(kv.first, kv.second).second);
+  }
+  return entries;
+}
+
+} // namespace
+
+TEST(LabelTableTest, DenseAndSparse) {
+  LabelTable<std::string> table(100, 199);
+  EXPECT_TRUE(table.empty());
+  EXPECT_EQ(table.end(), table.find(150));
+
+  table[150] = "dense";
+  table.insert_or_assign(100, "first");
+  table.insert_or_assign(199, "last");
+  // out of the range
+  table.insert_or_assign(99, "below");
+  table.insert_or_assign(200, "above");
+  EXPECT_EQ(5, table.size());
+
+  EXPECT_EQ(1, table.count(150));
+  EXPECT_EQ(0, table.count(151));
+  EXPECT_EQ(1, table.count(200));
+  EXPECT_EQ("dense", table.at(150));
+  EXPECT_EQ("above", table.at(200));
+  EXPECT_THROW(table.at(151), std::out_of_range);
+  EXPECT_THROW(table.at(201), std::out_of_range);
+
+  auto it = table.find(199);
+  ASSERT_NE(table.end(), it);
+  EXPECT_EQ(199, it->first);
+  it->second = "updated";
+  EXPECT_EQ("updated", table.at(199));
+
+  EXPECT_EQ(
+      (std::map<int32_t, std::string>{{99, "below"},
+                                      {100, "first"},
+                                      {150, "dense"},
+                                      {199, "updated"},
+                                      {200, "above"}}),
+      toMap(table));
+}
+
+TEST(LabelTableTest, Erase) {
+  LabelTable<std::string> table(100, 199);
+  table[100] = "first";
+  table[101] = "second";
+  table[300] = "sparse";
+
+  EXPECT_EQ(1, table.erase(100));
+  EXPECT_EQ(0, table.erase(100));
+  EXPECT_EQ(0, table.erase(150));
+  EXPECT_EQ(1, table.erase(300));
+  EXPECT_EQ(1, table.size());
+  EXPECT_EQ(table.end(), table.find(100));
+  EXPECT_EQ((std::map<int32_t, std::string>{{101, "second"}}), toMap(table));
+
+  // an erased label reads back default constructed
+  EXPECT_EQ("", table[100]);
+  EXPECT_EQ(2, table.size());
+
+  table.clear();
+  EXPECT_TRUE(table.empty());
+  EXPECT_EQ(table.begin(), table.end());
+}
+
+TEST(LabelTableTest, Copy) {
+  LabelTable<std::string> table;
+  table[Constants::kSrGlobalRange.first] = "node";
+  table[Constants::kSrLocalRange.second] = "adj";
+  table[1] = "sparse";
+
+  auto copy = table;
+  copy.erase(1);
+  copy[Constants::kSrGlobalRange.first] = "changed";
+  EXPECT_EQ(3, table.size());
+  EXPECT_EQ("node", table.at(Constants::kSrGlobalRange.first));
+  EXPECT_EQ(2, copy.size());
+  EXPECT_EQ("changed", copy.at(Constants::kSrGlobalRange.first));
+  EXPECT_EQ("adj", copy.at(Constants::kSrLocalRange.second));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/LatencyHistogram.h>
+
+using namespace openr;
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.getCount());
+  EXPECT_EQ(0, histogram.getPercentile(0.5));
+  EXPECT_EQ(0, histogram.getPercentile(0.99));
+
+  const auto thriftHistogram = histogram.toThrift();
+  EXPECT_EQ(0, thriftHistogram.count);
+  EXPECT_TRUE(thriftHistogram.bucketCounts.empty());
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  // small values are counted exactly
+  LatencyHistogram small;
+  for (auto value : {5, 10, 20}) {
+    small.addValue(value);
+  }
+  EXPECT_EQ(5, small.getPercentile(0));
+  EXPECT_EQ(10, small.getPercentile(0.5));
+  EXPECT_EQ(20, small.getPercentile(0.99));
+
+  LatencyHistogram histogram;
+  for (int64_t value = 1; value <= 1000; ++value) {
+    histogram.addValue(value);
+  }
+  EXPECT_EQ(1000, histogram.getCount());
+  EXPECT_NEAR(500, histogram.getPercentile(0.5), 500 / 16);
+  EXPECT_NEAR(990, histogram.getPercentile(0.99), 990 / 16);
+  EXPECT_EQ(1000, histogram.getPercentile(0.999));
+  EXPECT_EQ(1000, histogram.getPercentile(1));
+
+  const auto thriftHistogram = histogram.toThrift();
+  EXPECT_EQ(1000, thriftHistogram.count);
+  EXPECT_EQ(500500, thriftHistogram.sumMs);
+  EXPECT_EQ(1, thriftHistogram.minMs);
+  EXPECT_EQ(1000, thriftHistogram.maxMs);
+  EXPECT_EQ(histogram.getPercentile(0.5), thriftHistogram.p50Ms);
+  EXPECT_EQ(histogram.getPercentile(0.99), thriftHistogram.p99Ms);
+  int64_t numValues = 0;
+  for (auto const& kv : thriftHistogram.bucketCounts) {
+    numValues += kv.second;
+  }
+  EXPECT_EQ(1000, numValues);
+}
+
+TEST(LatencyHistogramTest, Precision) {
+  // median of {0, value, max} reports value within the bucket precision
+  for (int64_t value = 0; value < LatencyHistogram::kMaxValue;
+       value = value * 5 / 4 + 1) {
+    LatencyHistogram histogram;
+    histogram.addValue(0);
+    histogram.addValue(value);
+    histogram.addValue(LatencyHistogram::kMaxValue);
+    const auto median = histogram.getPercentile(0.5);
+    EXPECT_LE(value, median);
+    EXPECT_GE(value + value / 16, median);
+  }
+}
+
+TEST(LatencyHistogramTest, Clamping) {
+  LatencyHistogram histogram;
+  histogram.addValue(-10);
+  histogram.addValue(LatencyHistogram::kMaxValue * 2);
+  EXPECT_EQ(0, histogram.getPercentile(0));
+  EXPECT_EQ(LatencyHistogram::kMaxValue, histogram.getPercentile(1));
+  EXPECT_EQ(LatencyHistogram::kMaxValue, histogram.toThrift().maxMs);
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
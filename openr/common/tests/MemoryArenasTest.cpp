@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <folly/memory/Malloc.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/MemoryArenas.h>
+
+using namespace openr;
+
+TEST(MemoryArenasTest, WithoutJemalloc) {
+  if (folly::usingJEMalloc()) {
+    LOG(INFO) << "Running on jemalloc, skipping";
+    return;
+  }
+  EXPECT_FALSE(bindThreadToNewArena().hasValue());
+  EXPECT_FALSE(refreshArenaStats());
+  EXPECT_FALSE(getArenaAllocatedBytes(0).hasValue());
+  EXPECT_FALSE(getTotalAllocatedBytes().hasValue());
+  EXPECT_FALSE(purgeArenas());
+}
+
+//
+// Memory allocated by a thread bound to an arena is accounted in it until
+// freed, even if another thread frees it
+//
+TEST(MemoryArenasTest, ThreadArena) {
+  if (not folly::usingJEMalloc()) {
+    LOG(INFO) << "Not running on jemalloc, skipping";
+    return;
+  }
+  const size_t kBytes{16 << 20};
+
+  folly::Optional<unsigned> arena;
+  std::vector<char> buffer;
+  std::thread([&]() {
+    arena = bindThreadToNewArena();
+    buffer.resize(kBytes, 1);
+  }).join();
+  ASSERT_TRUE(arena.hasValue());
+
+  ASSERT_TRUE(refreshArenaStats());
+  auto bytes = getArenaAllocatedBytes(*arena);
+  ASSERT_TRUE(bytes.hasValue());
+  EXPECT_GE(*bytes, kBytes);
+  EXPECT_GE(getTotalAllocatedBytes().value(), *bytes);
+
+  // freed from this thread
+  buffer = std::vector<char>();
+  ASSERT_TRUE(refreshArenaStats());
+  EXPECT_LT(getArenaAllocatedBytes(*arena).value(), kBytes);
+  EXPECT_TRUE(purgeArenas());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
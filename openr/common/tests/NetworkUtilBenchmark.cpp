@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/NetworkUtil.h>
+
+namespace {
+
+// prefixes converted or compared per iteration
+const size_t kNumPrefixes{1000};
+
+std::vector<openr::thrift::IpPrefix>
+createPrefixes(bool isV4) {
+  std::mt19937_64 generator(1);
+  std::vector<openr::thrift::IpPrefix> prefixes;
+  prefixes.reserve(kNumPrefixes);
+  for (size_t i = 0; i < kNumPrefixes; ++i) {
+    std::string bytes(isV4 ? 4 : 16, 0);
+    for (auto& byte : bytes) {
+      byte = static_cast<char>(generator());
+    }
+    openr::thrift::IpPrefix prefix;
+    prefix.prefixAddress.addr = std::move(bytes);
+    prefix.prefixLength = isV4 ? 24 : 64;
+    prefixes.emplace_back(std::move(prefix));
+  }
+  return prefixes;
+}
+
+} // namespace
+
+namespace openr {
+
+// thrift prefix to folly network, printing and parsing the address as
+// toIPNetwork used to
+void
+BM_ToIPNetworkString(uint32_t iters, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(isV4);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& prefix : prefixes) {
+      folly::doNotOptimizeAway(folly::IPAddress::createNetwork(
+          toIPAddress(prefix.prefixAddress).str(), prefix.prefixLength));
+    }
+  }
+}
+
+void
+BM_ToIPNetwork(uint32_t iters, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(isV4);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& prefix : prefixes) {
+      folly::doNotOptimizeAway(toIPNetwork(prefix));
+    }
+  }
+}
+
+// common prefix length of an address with itself, i.e. walking all bits as
+// for a prefix matching down to a leaf, bit by bit as PrefixTrie used to
+void
+BM_CommonLengthBitwise(uint32_t iters, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<folly::IPAddress> addresses;
+  for (auto const& prefix : createPrefixes(isV4)) {
+    addresses.emplace_back(toIPAddress(prefix.prefixAddress));
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& address : addresses) {
+      uint8_t len = 0;
+      while (len < address.bitCount() and
+             address.getNthMSBit(len) == address.getNthMSBit(len)) {
+        ++len;
+      }
+      folly::doNotOptimizeAway(len);
+    }
+  }
+}
+
+void
+BM_CommonLengthWords(uint32_t iters, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<folly::IPAddress> addresses;
+  for (auto const& prefix : createPrefixes(isV4)) {
+    addresses.emplace_back(toIPAddress(prefix.prefixAddress));
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& address : addresses) {
+      folly::doNotOptimizeAway(getCommonPrefixLength(
+          address.bytes(),
+          address.bytes(),
+          address.byteCount(),
+          address.bitCount()));
+    }
+  }
+}
+
+// subnet check of a neighbor address, formatting and parsing the network as
+// Spark used to
+void
+BM_InSubnetString(uint32_t iters, bool /* isV4 */) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(true /* isV4 */);
+  const auto myAddr = toIPAddress(prefixes.front().prefixAddress);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& prefix : prefixes) {
+      folly::doNotOptimizeAway(myAddr.inSubnet(
+          folly::sformat("{}/{}", toString(prefix.prefixAddress), 24)));
+    }
+  }
+}
+
+void
+BM_InSubnetBytes(uint32_t iters, bool /* isV4 */) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(true /* isV4 */);
+  const auto myAddr = toIPAddress(prefixes.front().prefixAddress);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& prefix : prefixes) {
+      folly::doNotOptimizeAway(isPrefixEqual(
+          reinterpret_cast<const uint8_t*>(prefix.prefixAddress.addr.data()),
+          myAddr.bytes(),
+          myAddr.byteCount(),
+          24));
+    }
+  }
+}
+
+// The parameter is whether addresses are v4
+BENCHMARK_PARAM(BM_ToIPNetworkString, true);
+BENCHMARK_RELATIVE_PARAM(BM_ToIPNetwork, true);
+BENCHMARK_PARAM(BM_ToIPNetworkString, false);
+BENCHMARK_RELATIVE_PARAM(BM_ToIPNetwork, false);
+BENCHMARK_PARAM(BM_CommonLengthBitwise, true);
+BENCHMARK_RELATIVE_PARAM(BM_CommonLengthWords, true);
+BENCHMARK_PARAM(BM_CommonLengthBitwise, false);
+BENCHMARK_RELATIVE_PARAM(BM_CommonLengthWords, false);
+BENCHMARK_PARAM(BM_InSubnetString, true);
+BENCHMARK_RELATIVE_PARAM(BM_InSubnetBytes, true);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
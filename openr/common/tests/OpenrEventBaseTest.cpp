@@ -229,6 +229,44 @@ TEST_F(OpenrEventBaseTestFixture, SocketFdPollTest) {
   EXPECT_TRUE(true);
 }
 
+TEST_F(OpenrEventBaseTestFixture, StallInfoTest) {
+  folly::Baton waitBaton;
+
+  // Idle loop doesn't stall
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  auto stallInfo = evb.getAndResetStallInfo();
+  EXPECT_GT(std::chrono::milliseconds(100), stallInfo.maxLag);
+
+  // Block the loop
+  evb.runInEventBaseThread([&]() {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    waitBaton.post();
+  });
+  waitBaton.wait();
+
+  // Give the probe a chance to run again
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  stallInfo = evb.getAndResetStallInfo();
+  EXPECT_LE(std::chrono::milliseconds(200), stallInfo.maxLag);
+  EXPECT_EQ("event_base_thread", stallInfo.slowestCallback);
+  EXPECT_LE(
+      std::chrono::milliseconds(300), stallInfo.slowestCallbackDuration);
+
+  auto counters = evb.getEventLoopCounters();
+  EXPECT_LE(200, counters.at("lag_ms.max"));
+  EXPECT_LE(300, counters.at("callback_ms.max"));
+  EXPECT_LE(1, counters.at("num_callbacks"));
+
+  // Stall info is reset, counters aren't
+  stallInfo = evb.getAndResetStallInfo();
+  EXPECT_GT(std::chrono::milliseconds(100), stallInfo.maxLag);
+  EXPECT_TRUE(stallInfo.slowestCallback.empty());
+  EXPECT_LE(200, evb.getEventLoopCounters().at("lag_ms.max"));
+}
+
 int
 main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
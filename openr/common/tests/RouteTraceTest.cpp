@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/RouteTrace.h>
+#include <openr/common/Util.h>
+
+using namespace openr;
+
+namespace {
+
+const auto prefixV4 = toIpPrefix("10.1.0.0/16");
+const auto prefixV6 = toIpPrefix("fc00:1::/64");
+
+const auto nextHop1 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::1")), std::string("iface1"), 1);
+const auto nextHop2 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::2")), std::string("iface2"), 1);
+
+} // anonymous namespace
+
+TEST(RouteTraceTest, Disabled) {
+  RouteTrace trace(0);
+  EXPECT_FALSE(trace.isEnabled());
+
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToDelete.emplace_back(prefixV4);
+  trace.record(delta);
+  EXPECT_EQ(0, trace.getNumRecorded());
+  EXPECT_TRUE(trace.dump().empty());
+}
+
+TEST(RouteTraceTest, RecordAndDump) {
+  RouteTrace trace(8);
+  EXPECT_TRUE(trace.isEnabled());
+
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefixV6, {nextHop1, nextHop2}));
+  delta.unicastRoutesToDelete.emplace_back(prefixV4);
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(100, {nextHop1}));
+  delta.mplsRoutesToDelete.emplace_back(200);
+  trace.record(delta);
+  EXPECT_EQ(4, trace.getNumRecorded());
+
+  const auto entries = trace.dump();
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ(thrift::RouteTraceEvent::UNICAST_ROUTE_UPDATE, entries[0].event);
+  EXPECT_EQ(prefixV6, entries[0].prefix.value());
+  EXPECT_EQ(2, entries[0].numNextHops);
+  EXPECT_FALSE(entries[0].topLabel.hasValue());
+
+  EXPECT_EQ(thrift::RouteTraceEvent::UNICAST_ROUTE_DELETE, entries[1].event);
+  EXPECT_EQ(prefixV4, entries[1].prefix.value());
+  EXPECT_EQ(0, entries[1].numNextHops);
+
+  EXPECT_EQ(thrift::RouteTraceEvent::MPLS_ROUTE_UPDATE, entries[2].event);
+  EXPECT_EQ(100, entries[2].topLabel.value());
+  EXPECT_EQ(1, entries[2].numNextHops);
+  EXPECT_FALSE(entries[2].prefix.hasValue());
+
+  EXPECT_EQ(thrift::RouteTraceEvent::MPLS_ROUTE_DELETE, entries[3].event);
+  EXPECT_EQ(200, entries[3].topLabel.value());
+
+  for (const auto& entry : entries) {
+    EXPECT_EQ(entries[0].timestampMs, entry.timestampMs);
+  }
+}
+
+TEST(RouteTraceTest, Wraparound) {
+  RouteTrace trace(3);
+
+  for (int32_t label = 1; label <= 5; ++label) {
+    thrift::RouteDatabaseDelta delta;
+    delta.mplsRoutesToDelete.emplace_back(label);
+    trace.record(delta);
+  }
+  EXPECT_EQ(5, trace.getNumRecorded());
+
+  // only the latest entries are kept, oldest first
+  const auto entries = trace.dump();
+  ASSERT_EQ(3, entries.size());
+  EXPECT_EQ(3, entries[0].topLabel.value());
+  EXPECT_EQ(4, entries[1].topLabel.value());
+  EXPECT_EQ(5, entries[2].topLabel.value());
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
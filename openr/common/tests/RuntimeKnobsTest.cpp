@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/RuntimeKnobs.h>
+
+using namespace openr;
+
+TEST(RuntimeKnobsTest, SetAndReset) {
+  RuntimeKnobs knobs;
+  auto knob = knobs.addKnob("test.knob", "test knob", 10, 1, 100);
+  EXPECT_EQ(10, knob.get());
+
+  // handles share the value
+  auto copy = knob;
+  EXPECT_TRUE(knobs.setKnob("test.knob", 50).hasValue());
+  EXPECT_EQ(50, knob.get());
+  EXPECT_EQ(50, copy.get());
+
+  // bounds are inclusive
+  EXPECT_TRUE(knobs.setKnob("test.knob", 1).hasValue());
+  EXPECT_TRUE(knobs.setKnob("test.knob", 100).hasValue());
+  EXPECT_TRUE(knobs.setKnob("test.knob", 0).hasError());
+  EXPECT_TRUE(knobs.setKnob("test.knob", 101).hasError());
+  EXPECT_EQ(100, knob.get());
+  EXPECT_TRUE(knobs.setKnob("test.unknown", 1).hasError());
+
+  EXPECT_TRUE(knobs.resetKnob("test.knob").hasValue());
+  EXPECT_EQ(10, knob.get());
+  EXPECT_TRUE(knobs.resetKnob("test.unknown").hasError());
+}
+
+TEST(RuntimeKnobsTest, Registration) {
+  RuntimeKnobs knobs;
+  // bounds are widened to the configured value
+  auto knob = knobs.addKnob("test.b", "", 200, 1, 100);
+  // knobs registered again share the first one
+  auto other = knobs.addKnob("test.b", "", 5, 1, 10);
+  knobs.addKnob("test.a", "first", 1, 0, 1);
+  EXPECT_EQ(200, other.get());
+
+  auto all = knobs.getKnobs();
+  ASSERT_EQ(2, all.size());
+  EXPECT_EQ("test.a", all.at(0).name);
+  EXPECT_EQ("first", all.at(0).description);
+  EXPECT_EQ("test.b", all.at(1).name);
+  EXPECT_EQ(200, all.at(1).defaultValue);
+  EXPECT_EQ(1, all.at(1).minValue);
+  EXPECT_EQ(200, all.at(1).maxValue);
+
+  // fixed knobs aren't registered
+  RuntimeKnobs::Knob fixed(7);
+  EXPECT_EQ(7, fixed.get());
+  EXPECT_EQ(200, knob.get());
+}
+
+TEST(RuntimeKnobsTest, Persistence) {
+  RuntimeKnobs knobs;
+  auto a = knobs.addKnob("test.a", "", 1, 0, 10);
+  auto b = knobs.addKnob("test.b", "", 1, 0, 10);
+  EXPECT_TRUE(knobs.setKnob("test.a", 2, true).hasValue());
+  EXPECT_TRUE(knobs.setKnob("test.b", 3).hasValue());
+
+  auto persisted = knobs.getPersistedValues();
+  ASSERT_EQ(1, persisted.values.size());
+  EXPECT_EQ(2, persisted.values.at("test.a"));
+
+  // restore into a new instance, skipping unknown and invalid knobs
+  RuntimeKnobs restored;
+  auto restoredA = restored.addKnob("test.a", "", 1, 0, 10);
+  auto restoredB = restored.addKnob("test.b", "", 1, 0, 10);
+  persisted.values.emplace("test.b", 20);
+  persisted.values.emplace("test.unknown", 1);
+  EXPECT_EQ(1, restored.restore(persisted));
+  EXPECT_EQ(2, restoredA.get());
+  EXPECT_EQ(1, restoredB.get());
+  EXPECT_EQ(1, restored.getPersistedValues().values.size());
+
+  // reset knobs are no longer persisted
+  EXPECT_TRUE(knobs.resetKnob("test.a").hasValue());
+  EXPECT_EQ(1, a.get());
+  EXPECT_EQ(3, b.get());
+  EXPECT_TRUE(knobs.getPersistedValues().values.empty());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <folly/synchronization/Baton.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/StartupOrchestrator.h>
+
+using namespace openr;
+
+namespace {
+
+std::vector<std::string>
+getEventNames(StartupOrchestrator const& orchestrator) {
+  std::vector<std::string> names;
+  for (auto const& event : orchestrator.getPerfEvents().events) {
+    names.emplace_back(event.eventDescr);
+  }
+  return names;
+}
+
+} // namespace
+
+TEST(StartupOrchestratorTest, DependencyOrder) {
+  StartupOrchestrator orchestrator("node1");
+  std::vector<std::string> order;
+  std::mutex orderLock;
+  auto record = [&](std::string const& name) {
+    return [&, name]() {
+      std::lock_guard<std::mutex> lock(orderLock);
+      order.emplace_back(name);
+    };
+  };
+  orchestrator.addStep("Decision", {"KvStore", "LinkMonitor"}, record("D"));
+  orchestrator.addStep("LinkMonitor", {"KvStore"}, record("L"));
+  orchestrator.addStep("KvStore", {}, record("K"));
+  orchestrator.run();
+
+  EXPECT_EQ(std::vector<std::string>({"K", "L", "D"}), order);
+  EXPECT_EQ(
+      std::vector<std::string>({"KV_STORE_STARTED",
+                                "KV_STORE_DONE",
+                                "LINK_MONITOR_STARTED",
+                                "LINK_MONITOR_DONE",
+                                "DECISION_STARTED",
+                                "DECISION_DONE"}),
+      getEventNames(orchestrator));
+
+  auto counters = orchestrator.getCounters();
+  EXPECT_EQ(4, counters.size());
+  EXPECT_EQ(1, counters.count("startup.kv_store_ms"));
+  EXPECT_EQ(1, counters.count("startup.link_monitor_ms"));
+  EXPECT_EQ(1, counters.count("startup.decision_ms"));
+  EXPECT_EQ(1, counters.count("startup.total_ms"));
+}
+
+TEST(StartupOrchestratorTest, IndependentStepsInParallel) {
+  // Each step waits for the other one to start, which completes only if both
+  // run at the same time
+  StartupOrchestrator orchestrator("node1");
+  folly::Baton<> sparkStarted;
+  folly::Baton<> kvStoreStarted;
+  std::atomic<bool> bothDone{false};
+  orchestrator.addStep("Spark", {}, [&]() {
+    sparkStarted.post();
+    kvStoreStarted.wait();
+  });
+  orchestrator.addStep("KvStore", {}, [&]() {
+    kvStoreStarted.post();
+    sparkStarted.wait();
+  });
+  orchestrator.addStep(
+      "Decision", {"Spark", "KvStore"}, [&]() { bothDone = true; });
+  orchestrator.run();
+  EXPECT_TRUE(bothDone);
+}
+
+TEST(StartupOrchestratorTest, FailedStep) {
+  StartupOrchestrator orchestrator("node1");
+  std::atomic<bool> otherRan{false};
+  std::atomic<bool> dependentRan{false};
+  orchestrator.addStep(
+      "KvStore", {}, []() { throw std::runtime_error("bind failed"); });
+  orchestrator.addStep("Spark", {}, [&]() { otherRan = true; });
+  orchestrator.addStep("LinkMonitor", {"KvStore"}, [&]() {
+    dependentRan = true;
+  });
+  orchestrator.addStep("Decision", {"LinkMonitor"}, [&]() {
+    dependentRan = true;
+  });
+  EXPECT_THROW(orchestrator.run(), std::runtime_error);
+
+  // Independent steps still run, dependents of the failed one don't
+  EXPECT_TRUE(otherRan);
+  EXPECT_FALSE(dependentRan);
+  auto counters = orchestrator.getCounters();
+  EXPECT_EQ(1, counters.count("startup.spark_ms"));
+  EXPECT_EQ(0, counters.count("startup.kv_store_ms"));
+  EXPECT_EQ(0, counters.count("startup.link_monitor_ms"));
+}
+
+TEST(StartupOrchestratorTest, InvalidDependencies) {
+  {
+    StartupOrchestrator orchestrator("node1");
+    orchestrator.addStep("Fib", {"Decision"}, []() {});
+    EXPECT_DEATH(orchestrator.run(), "unknown Decision");
+  }
+  {
+    StartupOrchestrator orchestrator("node1");
+    orchestrator.addStep("Fib", {"Decision"}, []() {});
+    orchestrator.addStep("Decision", {"Fib"}, []() {});
+    EXPECT_DEATH(orchestrator.run(), "Cyclic");
+  }
+  {
+    StartupOrchestrator orchestrator("node1");
+    orchestrator.addStep("Fib", {}, []() {});
+    EXPECT_DEATH(orchestrator.addStep("Fib", {}, []() {}), "Duplicate");
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/stats/BucketedTimeSeries.h>
+
+#include <openr/common/StepDetector.h>
+
+namespace {
+
+// StepDetector parameters as used by Spark for RTT samples
+const std::chrono::milliseconds kSamplePeriod{1000};
+const size_t kFastWndSize{10};
+const size_t kSlowWndSize{60};
+const uint8_t kLoThreshold{2};
+const uint8_t kHiThreshold{5};
+const int64_t kAbsThreshold{500};
+
+// samples added to each detector per iteration
+const size_t kNumSamples{100};
+
+using RingBufferStepDetector =
+    openr::StepDetector<int64_t, std::chrono::milliseconds>;
+
+using BucketedTimeSeriesStepDetector = openr::StepDetector<
+    int64_t,
+    std::chrono::milliseconds,
+    folly::BucketedTimeSeries<
+        int64_t,
+        folly::LegacyStatsClock<std::chrono::milliseconds>>>;
+
+} // namespace
+
+namespace openr {
+
+// Feed RTT-like samples to numDetectors detectors, one per neighbor, in the
+// order Spark would, i.e. every neighbor once per sample period
+template <typename StepDetectorType>
+void
+BM_StepDetectorAddValue(uint32_t iters, size_t numDetectors) {
+  auto suspender = folly::BenchmarkSuspender();
+
+  std::default_random_engine generator;
+  std::normal_distribution<double> distribution(1000, 50);
+  std::vector<int64_t> samples(kNumSamples);
+  for (auto& sample : samples) {
+    sample = static_cast<int64_t>(distribution(generator));
+  }
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    std::vector<std::unique_ptr<StepDetectorType>> detectors;
+    for (size_t j = 0; j < numDetectors; ++j) {
+      detectors.emplace_back(std::make_unique<StepDetectorType>(
+          kSamplePeriod,
+          kFastWndSize,
+          kSlowWndSize,
+          kLoThreshold,
+          kHiThreshold,
+          kAbsThreshold,
+          [](const int64_t& avg) { folly::doNotOptimizeAway(avg); }));
+    }
+
+    suspender.dismiss();
+    for (size_t k = 0; k < samples.size(); ++k) {
+      const auto now = kSamplePeriod * k;
+      for (auto& detector : detectors) {
+        folly::doNotOptimizeAway(detector->addValue(now, samples[k]));
+      }
+    }
+    suspender.rehire();
+  }
+}
+
+void
+BM_BucketedTimeSeriesStepDetector(uint32_t iters, size_t numDetectors) {
+  BM_StepDetectorAddValue<BucketedTimeSeriesStepDetector>(iters, numDetectors);
+}
+
+void
+BM_RingBufferStepDetector(uint32_t iters, size_t numDetectors) {
+  BM_StepDetectorAddValue<RingBufferStepDetector>(iters, numDetectors);
+}
+
+// The parameter is the number of detectors, i.e. neighbors
+BENCHMARK_PARAM(BM_BucketedTimeSeriesStepDetector, 10);
+BENCHMARK_RELATIVE_PARAM(BM_RingBufferStepDetector, 10);
+BENCHMARK_PARAM(BM_BucketedTimeSeriesStepDetector, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_RingBufferStepDetector, 1000);
+BENCHMARK_PARAM(BM_BucketedTimeSeriesStepDetector, 10000);
+BENCHMARK_RELATIVE_PARAM(BM_RingBufferStepDetector, 10000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <random>
 
+#include <folly/stats/BucketedTimeSeries.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -161,6 +162,68 @@ TEST(StepDetectorTest, SlowBoiling) {
   }
 }
 
+TEST(RingBufferWindowTest, AddValueExpire) {
+  // 4 buckets of 10s
+  openr::RingBufferWindow<int64_t, std::chrono::seconds> window(
+      4, std::chrono::seconds(40));
+  EXPECT_EQ(0, window.count());
+  EXPECT_EQ(0, window.avg());
+
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(100), 10));
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(105), 20));
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(110), 30));
+  EXPECT_EQ(3, window.count());
+  EXPECT_EQ(60, window.sum());
+  EXPECT_DOUBLE_EQ(20.0, window.avg());
+
+  // latest bucket is 13, buckets 10 and 11 are still in
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(139), 40));
+  EXPECT_EQ(4, window.count());
+  EXPECT_EQ(100, window.sum());
+
+  // late values are accepted as long as their bucket is in the window
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(101), 0));
+  EXPECT_EQ(5, window.count());
+
+  // latest bucket is 14, bucket 10 drops out and can't take values anymore
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(140), 50));
+  EXPECT_EQ(3, window.count());
+  EXPECT_EQ(120, window.sum());
+  EXPECT_FALSE(window.addValue(std::chrono::seconds(109), 1));
+  EXPECT_EQ(3, window.count());
+
+  // gap longer than the window empties it
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(1000), 7));
+  EXPECT_EQ(1, window.count());
+  EXPECT_EQ(7, window.sum());
+}
+
+// same statistics as BucketedTimeSeries, including over gaps in the samples
+TEST(RingBufferWindowTest, MatchBucketedTimeSeries) {
+  const size_t numBuckets = 30;
+  const std::chrono::seconds duration(30);
+  openr::RingBufferWindow<double, std::chrono::seconds> window(
+      numBuckets, duration);
+  folly::BucketedTimeSeries<
+      double,
+      folly::LegacyStatsClock<std::chrono::seconds>>
+      timeSeries(numBuckets, duration);
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> gapDistribution(0, 20);
+  auto samples = genGaussianSamples(100, 10, 10000);
+  int64_t timeStamp = 0;
+  for (auto sample : samples) {
+    // mostly regular samples, with the occasional gap
+    auto gap = gapDistribution(generator);
+    timeStamp += gap < 18 ? 1 : gap;
+    EXPECT_TRUE(window.addValue(std::chrono::seconds(timeStamp), sample));
+    EXPECT_TRUE(timeSeries.addValue(std::chrono::seconds(timeStamp), sample));
+    ASSERT_EQ(timeSeries.count(), window.count());
+    ASSERT_NEAR(timeSeries.avg(), window.avg(), 1e-6);
+  }
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
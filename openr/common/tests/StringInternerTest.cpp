@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/StringInterner.h>
+
+using namespace openr;
+
+TEST(StringInternerTest, BasicOperation) {
+  const InternedString empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(0, empty.id());
+  EXPECT_EQ(empty, StringInterner::intern(""));
+
+  const std::string name{"node-1"};
+  const InternedString a1(name);
+  const auto a2 = StringInterner::intern("node-1");
+  const InternedString b("node-2");
+
+  EXPECT_EQ(a1, a2);
+  EXPECT_EQ(a1.id(), a2.id());
+  EXPECT_EQ(&a1.str(), &a2.str());
+  EXPECT_NE(a1, b);
+  EXPECT_NE(a1.id(), b.id());
+  EXPECT_EQ("node-1", a1.str());
+
+  // comparison with plain strings
+  EXPECT_TRUE(a1 == name);
+  EXPECT_TRUE(a1 == a2.str());
+  EXPECT_TRUE(b != name);
+
+  // ordering follows string contents
+  EXPECT_TRUE(a1 < b);
+  EXPECT_FALSE(b < a1);
+  EXPECT_FALSE(a1 < a2);
+  const InternedString c("node-0");
+  std::set<InternedString> ordered{b, a1, c};
+  EXPECT_EQ(
+      (std::vector<InternedString>{c, a1, b}),
+      std::vector<InternedString>(ordered.begin(), ordered.end()));
+
+  std::unordered_set<InternedString> hashed{a1, a2, b};
+  EXPECT_EQ(2, hashed.size());
+}
+
+TEST(StringInternerTest, ConcurrentIntern) {
+  const size_t kNumThreads = 8;
+  const size_t kNumNames = 1000;
+  std::vector<std::vector<uint32_t>> ids(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&ids, t, kNumNames]() {
+      for (size_t i = 0; i < kNumNames; ++i) {
+        ids[t].emplace_back(
+            StringInterner::intern("concurrent-" + std::to_string(i)).id());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // every thread observed the same id for the same name
+  for (size_t t = 1; t < kNumThreads; ++t) {
+    EXPECT_EQ(ids[0], ids[t]);
+  }
+  std::unordered_set<uint32_t> uniqueIds(ids[0].begin(), ids[0].end());
+  EXPECT_EQ(kNumNames, uniqueIds.size());
+  EXPECT_LE(kNumNames + 1, StringInterner::size());
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ThreadLocalStats.h>
+
+using namespace openr;
+
+TEST(ThreadLocalStatsTest, GetBucket) {
+  EXPECT_EQ(0, ThreadLocalStats::getBucket(-5));
+  EXPECT_EQ(0, ThreadLocalStats::getBucket(0));
+  EXPECT_EQ(1, ThreadLocalStats::getBucket(1));
+  EXPECT_EQ(2, ThreadLocalStats::getBucket(2));
+  EXPECT_EQ(2, ThreadLocalStats::getBucket(3));
+  EXPECT_EQ(11, ThreadLocalStats::getBucket(1024));
+  EXPECT_EQ(63, ThreadLocalStats::getBucket(INT64_MAX));
+}
+
+TEST(ThreadLocalStatsTest, ExportTypes) {
+  ThreadLocalStats stats;
+  auto count = stats.addStat("test.count", {fbzmq::COUNT});
+  auto all = stats.addStat("test.all", {fbzmq::SUM, fbzmq::COUNT, fbzmq::AVG});
+
+  // registered stats are exported before values are added
+  auto counters = stats.getCounters();
+  for (auto const level : {"60", "600", "3600", "0"}) {
+    EXPECT_EQ(0, counters.at(folly::sformat("test.count.count.{}", level)));
+    EXPECT_EQ(0, counters.at(folly::sformat("test.all.sum.{}", level)));
+  }
+  EXPECT_EQ(0, counters.count("test.count.sum.0"));
+
+  count.addValue(1);
+  count.addValue(1);
+  all.addValue(10);
+  all.addValue(20);
+  counters = stats.getCounters();
+  EXPECT_EQ(2, counters.at("test.count.count.60"));
+  EXPECT_EQ(2, counters.at("test.count.count.0"));
+  EXPECT_EQ(30, counters.at("test.all.sum.60"));
+  EXPECT_EQ(2, counters.at("test.all.count.600"));
+  EXPECT_EQ(15, counters.at("test.all.avg.3600"));
+
+  // values are aggregated once
+  counters = stats.getCounters();
+  EXPECT_EQ(2, counters.at("test.count.count.0"));
+  EXPECT_EQ(30, counters.at("test.all.sum.0"));
+}
+
+TEST(ThreadLocalStatsTest, Threads) {
+  ThreadLocalStats stats;
+  auto stat = stats.addStat("test.values", {fbzmq::SUM, fbzmq::COUNT});
+
+  const int kNumThreads{8};
+  const int kNumValues{10000};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&stat]() {
+      for (int j = 0; j < kNumValues; ++j) {
+        stat.addValue(2);
+      }
+    });
+  }
+  // aggregate while values are added
+  stats.aggregate();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  stat.addValue(1);
+
+  // values of exited threads are kept
+  auto counters = stats.getCounters();
+  EXPECT_EQ(kNumThreads * kNumValues + 1, counters.at("test.values.count.0"));
+  EXPECT_EQ(
+      kNumThreads * kNumValues * 2 + 1, counters.at("test.values.sum.0"));
+  counters = stats.getCounters();
+  EXPECT_EQ(kNumThreads * kNumValues + 1, counters.at("test.values.count.0"));
+}
+
+TEST(ThreadLocalStatsTest, Histogram) {
+  ThreadLocalStats stats;
+  auto histogram = stats.addHistogram("test.latency_ms", {fbzmq::AVG});
+
+  auto counters = stats.getCounters();
+  EXPECT_EQ(0, counters.at("test.latency_ms.p50.60"));
+  EXPECT_EQ(0, counters.at("test.latency_ms.p99.60"));
+
+  // 90 values of 10, 10 of 1000
+  for (int i = 0; i < 90; ++i) {
+    histogram.addValue(10);
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.addValue(1000);
+  }
+  counters = stats.getCounters();
+  EXPECT_EQ(109, counters.at("test.latency_ms.avg.60"));
+  // upper bounds of the power of two buckets of the values
+  EXPECT_EQ(15, counters.at("test.latency_ms.p50.60"));
+  EXPECT_EQ(15, counters.at("test.latency_ms.p90.60"));
+  EXPECT_EQ(1023, counters.at("test.latency_ms.p99.60"));
+}
+
+TEST(ThreadLocalStatsTest, LateRegistration) {
+  ThreadLocalStats stats;
+  auto stat = stats.addStat("test.early", {fbzmq::COUNT});
+  stat.addValue(1);
+  EXPECT_DEATH(stats.addStat("test.late", {fbzmq::COUNT}), "registered");
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ThreadPlacement.h>
+
+using namespace openr;
+
+TEST(ThreadPlacementTest, ParseCpuList) {
+  EXPECT_EQ(std::vector<int>({}), parseCpuList("").value());
+  EXPECT_EQ(std::vector<int>({3}), parseCpuList("3").value());
+  EXPECT_EQ(
+      std::vector<int>({0, 1, 2, 3, 8}), parseCpuList("0-3,8\n").value());
+
+  EXPECT_FALSE(parseCpuList("a").hasValue());
+  EXPECT_FALSE(parseCpuList("3-1").hasValue());
+  EXPECT_FALSE(parseCpuList("-1").hasValue());
+  EXPECT_FALSE(parseCpuList("0-100000").hasValue());
+}
+
+TEST(ThreadPlacementTest, ParseThreadPlacements) {
+  auto placements = parseThreadPlacements("Spark:0:-10;KvStore:1-2;Fib::5");
+  ASSERT_TRUE(placements.hasValue());
+  ASSERT_EQ(3, placements->size());
+
+  EXPECT_EQ(std::vector<int>({0}), placements->at("Spark").cpus);
+  EXPECT_EQ(-10, placements->at("Spark").niceValue.value());
+  EXPECT_EQ(std::vector<int>({1, 2}), placements->at("KvStore").cpus);
+  EXPECT_FALSE(placements->at("KvStore").niceValue.hasValue());
+  EXPECT_TRUE(placements->at("Fib").cpus.empty());
+  EXPECT_EQ(5, placements->at("Fib").niceValue.value());
+
+  // no placement at all
+  placements = parseThreadPlacements("");
+  ASSERT_TRUE(placements.hasValue());
+  EXPECT_TRUE(placements->empty());
+
+  // malformed
+  EXPECT_TRUE(parseThreadPlacements("Spark").hasError());
+  EXPECT_TRUE(parseThreadPlacements(":0").hasError());
+  EXPECT_TRUE(parseThreadPlacements("Spark:x").hasError());
+  EXPECT_TRUE(parseThreadPlacements("Spark:0:-30").hasError());
+  EXPECT_TRUE(parseThreadPlacements("Spark:0:1:2").hasError());
+  EXPECT_TRUE(parseThreadPlacements("Spark:nodex").hasError());
+  EXPECT_TRUE(parseThreadPlacements("Spark:node100000").hasError());
+}
+
+TEST(ThreadPlacementTest, DefaultThreadPlacements) {
+  // Only priority on small systems
+  auto placements = getDefaultThreadPlacements({0, 1});
+  ASSERT_EQ(1, placements.size());
+  EXPECT_TRUE(placements.at("Spark").cpus.empty());
+  EXPECT_EQ(-10, placements.at("Spark").niceValue.value());
+
+  // Neighbor discovery and flooding apart from route computation
+  placements = getDefaultThreadPlacements({2, 3, 4, 5, 6, 8});
+  EXPECT_EQ(std::vector<int>({2}), placements.at("Spark").cpus);
+  EXPECT_EQ(std::vector<int>({2}), placements.at("LinkMonitor").cpus);
+  EXPECT_EQ(std::vector<int>({3}), placements.at("KvStore").cpus);
+  EXPECT_EQ(std::vector<int>({4, 5, 6, 8}), placements.at("Decision").cpus);
+  EXPECT_EQ(placements.at("Decision").cpus, placements.at("Fib").cpus);
+}
+
+TEST(ThreadPlacementTest, AllowedCpus) {
+  // Pinning to CPUs we may run on anyway succeeds
+  ThreadPlacement placement;
+  placement.cpus = getAllowedCpus();
+  ASSERT_FALSE(placement.cpus.empty());
+  EXPECT_TRUE(applyThreadPlacement(placement, false));
+  EXPECT_EQ(placement.cpus, getAllowedCpus());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
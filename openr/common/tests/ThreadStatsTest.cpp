@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <folly/synchronization/Baton.h>
+#include <folly/system/ThreadName.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ThreadStats.h>
+
+using namespace openr;
+
+TEST(ThreadStatsTest, ParseThreadStats) {
+  const std::string status =
+      "Name:\tDecision\n"
+      "State:\tS (sleeping)\n"
+      "voluntary_ctxt_switches:\t1234\n"
+      "nonvoluntary_ctxt_switches:\t56\n";
+  auto stats = parseThreadStats("2000000 300000 42\n", status);
+  ASSERT_TRUE(stats.hasValue());
+  EXPECT_EQ(std::chrono::milliseconds(2), stats->cpuTime);
+  EXPECT_EQ(std::chrono::microseconds(300), stats->runQueueWait);
+  EXPECT_EQ(1234, stats->voluntaryCtxSwitches);
+  EXPECT_EQ(56, stats->involuntaryCtxSwitches);
+
+  // malformed schedstat or missing context switches
+  EXPECT_FALSE(parseThreadStats("2000000\n", status).hasValue());
+  EXPECT_FALSE(parseThreadStats("a b c\n", status).hasValue());
+  EXPECT_FALSE(
+      parseThreadStats("1 2 3\n", "voluntary_ctxt_switches:\t1\n").hasValue());
+}
+
+TEST(ThreadStatsTest, Sum) {
+  ThreadStats stats;
+  stats.cpuTime = std::chrono::nanoseconds(10);
+  stats.voluntaryCtxSwitches = 1;
+  ThreadStats other;
+  other.cpuTime = std::chrono::nanoseconds(5);
+  other.runQueueWait = std::chrono::nanoseconds(3);
+  other.involuntaryCtxSwitches = 2;
+  stats += other;
+  EXPECT_EQ(std::chrono::nanoseconds(15), stats.cpuTime);
+  EXPECT_EQ(std::chrono::nanoseconds(3), stats.runQueueWait);
+  EXPECT_EQ(1, stats.voluntaryCtxSwitches);
+  EXPECT_EQ(2, stats.involuntaryCtxSwitches);
+}
+
+TEST(ThreadStatsTest, GetThreadStats) {
+  auto before = getThreadStats(getThreadId());
+  if (not before.hasValue()) {
+    // kernel without schedstat
+    LOG(INFO) << "Skipping test, no scheduling stats";
+    return;
+  }
+
+  // spin for a while
+  volatile uint64_t sum{0};
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start <
+         std::chrono::milliseconds(50)) {
+    sum = sum + 1;
+  }
+
+  auto after = getThreadStats(getThreadId());
+  ASSERT_TRUE(after.hasValue());
+  EXPECT_GT(after->cpuTime, before->cpuTime);
+  EXPECT_GE(after->runQueueWait, before->runQueueWait);
+  EXPECT_GE(after->voluntaryCtxSwitches, before->voluntaryCtxSwitches);
+  EXPECT_GE(after->involuntaryCtxSwitches, before->involuntaryCtxSwitches);
+
+  EXPECT_FALSE(getThreadStats(-1).hasValue());
+}
+
+TEST(ThreadStatsTest, GetThreadIdsByName) {
+  folly::Baton<> named;
+  folly::Baton<> done;
+  std::atomic<pid_t> workerTid{0};
+  std::thread worker([&]() {
+    folly::setThreadName("StatsWorker-1");
+    workerTid = getThreadId();
+    named.post();
+    done.wait();
+  });
+  named.wait();
+
+  auto tids = getThreadIdsByName("StatsWorker");
+  EXPECT_EQ(std::vector<pid_t>({workerTid.load()}), tids);
+  EXPECT_TRUE(getThreadIdsByName("NoSuchThread").empty());
+
+  done.post();
+  worker.join();
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
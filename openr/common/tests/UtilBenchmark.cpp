@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+
+namespace {
+
+// nexthop sets or metric vector pairs handled per iteration
+const size_t kNumSets{1000};
+
+// fraction of routes changed between route databases of findDeltaRoutes
+const size_t kDeltaPerMille{10};
+
+} // namespace
+
+namespace openr {
+
+/**
+ * numNextHops nexthops on distinct interfaces, every other one with a higher
+ * metric. MPLS ones swap to a label of their own
+ */
+std::vector<thrift::NextHopThrift>
+createNextHops(size_t numNextHops, bool isMpls, size_t seed = 0) {
+  std::vector<thrift::NextHopThrift> nextHops;
+  nextHops.reserve(numNextHops);
+  for (size_t i = 0; i < numNextHops; ++i) {
+    folly::Optional<thrift::MplsAction> mplsAction;
+    if (isMpls) {
+      mplsAction = createMplsAction(
+          thrift::MplsActionCode::SWAP,
+          static_cast<int32_t>(100000 + i + seed));
+    }
+    nextHops.emplace_back(createNextHop(
+        toBinaryAddress(folly::IPAddress(folly::sformat("fe80::{:x}", i + 1))),
+        folly::sformat("eth{}", i),
+        i % 2 ? 20 : 10 + seed % 2 /* metric */,
+        std::move(mplsAction)));
+  }
+  return nextHops;
+}
+
+/**
+ * numRoutes routes to distinct /64 prefixes with numNextHops nexthops each,
+ * sorted as route databases are
+ */
+std::vector<thrift::UnicastRoute>
+createRoutes(size_t numRoutes, size_t numNextHops) {
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(numRoutes);
+  const auto nextHops = createNextHops(numNextHops, false /* isMpls */);
+  for (size_t i = 0; i < numRoutes; ++i) {
+    routes.emplace_back(createUnicastRoute(
+        toIpPrefix(folly::sformat(
+            "fc00:{:x}:{:x}::/64", (i >> 16) & 0xffff, i & 0xffff)),
+        nextHops));
+  }
+  std::sort(routes.begin(), routes.end());
+  return routes;
+}
+
+/**
+ * Pairs of metric vectors of numEntities entities of increasing priority,
+ * tying on all but the lowest priority one, hence compared entirely
+ */
+std::vector<std::pair<thrift::MetricVector, thrift::MetricVector>>
+createMetricVectorPairs(size_t numEntities) {
+  std::mt19937_64 generator(1);
+  std::vector<std::pair<thrift::MetricVector, thrift::MetricVector>> pairs;
+  pairs.reserve(kNumSets);
+  for (size_t i = 0; i < kNumSets; ++i) {
+    thrift::MetricVector l;
+    thrift::MetricVector r;
+    for (size_t type = 0; type < numEntities; ++type) {
+      const int64_t metric = generator() % 1000;
+      const bool isLast = (type == 0);
+      l.metrics.emplace_back(createMetricEntity(
+          type,
+          type /* priority */,
+          thrift::CompareType::WIN_IF_PRESENT,
+          false /* isBestPathTieBreaker */,
+          {metric}));
+      r.metrics.emplace_back(createMetricEntity(
+          type,
+          type /* priority */,
+          thrift::CompareType::WIN_IF_PRESENT,
+          false /* isBestPathTieBreaker */,
+          {isLast ? metric + 1 : metric}));
+    }
+    // entities are kept in decreasing order of priority
+    std::reverse(l.metrics.begin(), l.metrics.end());
+    std::reverse(r.metrics.begin(), r.metrics.end());
+    pairs.emplace_back(std::move(l), std::move(r));
+  }
+  return pairs;
+}
+
+/**
+ * Delta between route databases of numRoutes routes with numNextHops
+ * nexthops, kDeltaPerMille of the routes having different nexthops
+ */
+void
+BM_FindDeltaRoutes(uint32_t iters, size_t numRoutes, size_t numNextHops) {
+  auto suspender = folly::BenchmarkSuspender();
+  thrift::RouteDatabase oldRouteDb;
+  oldRouteDb.thisNodeName = "node-1";
+  oldRouteDb.unicastRoutes = createRoutes(numRoutes, numNextHops);
+  thrift::RouteDatabase newRouteDb = oldRouteDb;
+  const auto changedNextHops =
+      createNextHops(numNextHops, false /* isMpls */, 1 /* seed */);
+  for (size_t i = 0; i < numRoutes; i += 1000 / kDeltaPerMille) {
+    newRouteDb.unicastRoutes[i].nextHops = changedNextHops;
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(findDeltaRoutes(newRouteDb, oldRouteDb));
+  }
+}
+
+void
+BM_GetBestNextHopsUnicast(uint32_t iters, size_t numNextHops) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::vector<thrift::NextHopThrift>> nextHopSets;
+  for (size_t i = 0; i < kNumSets; ++i) {
+    nextHopSets.emplace_back(
+        createNextHops(numNextHops, false /* isMpls */, i));
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& nextHops : nextHopSets) {
+      folly::doNotOptimizeAway(getBestNextHopsUnicast(nextHops));
+    }
+  }
+}
+
+void
+BM_GetBestNextHopsMpls(uint32_t iters, size_t numNextHops) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::vector<thrift::NextHopThrift>> nextHopSets;
+  for (size_t i = 0; i < kNumSets; ++i) {
+    nextHopSets.emplace_back(createNextHops(numNextHops, true /* isMpls */, i));
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& nextHops : nextHopSets) {
+      folly::doNotOptimizeAway(getBestNextHopsMpls(nextHops));
+    }
+  }
+}
+
+void
+BM_CreateUnicastRoutesWithBestNexthops(
+    uint32_t iters, size_t numRoutes, size_t numNextHops) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto routes = createRoutes(numRoutes, numNextHops);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(createUnicastRoutesWithBestNexthops(routes));
+  }
+}
+
+void
+BM_CompareMetricVectors(uint32_t iters, size_t numEntities) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto pairs = createMetricVectorPairs(numEntities);
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& pair : pairs) {
+      folly::doNotOptimizeAway(
+          MetricVectorUtils::compareMetricVectors(pair.first, pair.second));
+    }
+  }
+}
+
+void
+BM_CompareCompiledMetricVectors(uint32_t iters, size_t numEntities) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::pair<
+      MetricVectorUtils::CompiledMetricVector,
+      MetricVectorUtils::CompiledMetricVector>>
+      pairs;
+  for (auto const& pair : createMetricVectorPairs(numEntities)) {
+    pairs.emplace_back(
+        MetricVectorUtils::compileMetricVector(pair.first),
+        MetricVectorUtils::compileMetricVector(pair.second));
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& pair : pairs) {
+      folly::doNotOptimizeAway(
+          MetricVectorUtils::compareMetricVectors(pair.first, pair.second));
+    }
+  }
+}
+
+void
+BM_GenerateHash(uint32_t iters, size_t valueSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string originatorId{"node-1"};
+  const folly::Optional<std::string> value(std::string(valueSize, 'v'));
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(generateHash(i, originatorId, value));
+  }
+}
+
+void
+BM_CreateThriftPublication(uint32_t iters, size_t numKeys) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::unordered_map<std::string, thrift::Value> keyVals;
+  std::vector<std::string> expiredKeys;
+  for (size_t i = 0; i < numKeys; ++i) {
+    keyVals.emplace(
+        folly::sformat("prefix:node-{}", i),
+        createThriftValue(1, "node-1", std::string(100, 'v')));
+    if (i % 10 == 0) {
+      expiredKeys.emplace_back(folly::sformat("adj:node-{}", i));
+    }
+  }
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(createThriftPublication(keyVals, expiredKeys));
+  }
+}
+
+// The parameters are the number of routes and of nexthops per route
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 1000_8, 1000, 8);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 100000_8, 100000, 8);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 500000_1, 500000, 1);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 500000_4, 500000, 4);
+BENCHMARK_NAMED_PARAM(
+    BM_CreateUnicastRoutesWithBestNexthops, 1000_1, 1000, 1);
+BENCHMARK_NAMED_PARAM(
+    BM_CreateUnicastRoutesWithBestNexthops, 1000_16, 1000, 16);
+BENCHMARK_NAMED_PARAM(
+    BM_CreateUnicastRoutesWithBestNexthops, 1000_128, 1000, 128);
+BENCHMARK_NAMED_PARAM(
+    BM_CreateUnicastRoutesWithBestNexthops, 100000_8, 100000, 8);
+BENCHMARK_NAMED_PARAM(
+    BM_CreateUnicastRoutesWithBestNexthops, 500000_1, 500000, 1);
+
+// The parameter is the number of nexthops, kNumSets sets per iteration
+BENCHMARK_PARAM(BM_GetBestNextHopsUnicast, 1);
+BENCHMARK_PARAM(BM_GetBestNextHopsUnicast, 8);
+BENCHMARK_PARAM(BM_GetBestNextHopsUnicast, 32);
+BENCHMARK_PARAM(BM_GetBestNextHopsUnicast, 128);
+BENCHMARK_PARAM(BM_GetBestNextHopsMpls, 1);
+BENCHMARK_PARAM(BM_GetBestNextHopsMpls, 8);
+BENCHMARK_PARAM(BM_GetBestNextHopsMpls, 32);
+BENCHMARK_PARAM(BM_GetBestNextHopsMpls, 128);
+
+// The parameter is the number of entities of metric vectors, kNumSets pairs
+// per iteration
+BENCHMARK_PARAM(BM_CompareMetricVectors, 1);
+BENCHMARK_RELATIVE_PARAM(BM_CompareCompiledMetricVectors, 1);
+BENCHMARK_PARAM(BM_CompareMetricVectors, 5);
+BENCHMARK_RELATIVE_PARAM(BM_CompareCompiledMetricVectors, 5);
+BENCHMARK_PARAM(BM_CompareMetricVectors, 10);
+BENCHMARK_RELATIVE_PARAM(BM_CompareCompiledMetricVectors, 10);
+
+// The parameter is the byte size of the value
+BENCHMARK_PARAM(BM_GenerateHash, 100);
+BENCHMARK_PARAM(BM_GenerateHash, 1000);
+BENCHMARK_PARAM(BM_GenerateHash, 10000);
+
+// The parameter is the number of keys
+BENCHMARK_PARAM(BM_CreateThriftPublication, 1000);
+BENCHMARK_PARAM(BM_CreateThriftPublication, 10000);
+BENCHMARK_PARAM(BM_CreateThriftPublication, 100000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
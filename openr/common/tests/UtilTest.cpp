@@ -6,6 +6,7 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
 
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Random.h>
@@ -530,13 +531,11 @@ TEST(UtilTest, getTotalPerfEventsDurationTest) {
 
   {
     thrift::PerfEvents perfEvents;
-    thrift::PerfEvent event1{apache::thrift::FRAGILE, "node1", "LINK_UP", 100};
+    auto event1 = createPerfEvent("node1", "LINK_UP", 100);
     perfEvents.events.emplace_back(std::move(event1));
-    thrift::PerfEvent event2{
-        apache::thrift::FRAGILE, "node1", "DECISION_RECVD", 200};
+    auto event2 = createPerfEvent("node1", "DECISION_RECVD", 200);
     perfEvents.events.emplace_back(std::move(event2));
-    thrift::PerfEvent event3{
-        apache::thrift::FRAGILE, "node1", "SPF_CALCULATE", 300};
+    auto event3 = createPerfEvent("node1", "SPF_CALCULATE", 300);
     perfEvents.events.emplace_back(std::move(event3));
     auto duration = getTotalPerfEventsDuration(perfEvents);
     EXPECT_EQ(duration.count(), 200);
@@ -553,13 +552,11 @@ TEST(UtilTest, getDurationBetweenPerfEventsTest) {
 
   {
     thrift::PerfEvents perfEvents;
-    thrift::PerfEvent event1{apache::thrift::FRAGILE, "node1", "LINK_UP", 100};
+    auto event1 = createPerfEvent("node1", "LINK_UP", 100);
     perfEvents.events.emplace_back(std::move(event1));
-    thrift::PerfEvent event2{
-        apache::thrift::FRAGILE, "node1", "DECISION_RECVD", 200};
+    auto event2 = createPerfEvent("node1", "DECISION_RECVD", 200);
     perfEvents.events.emplace_back(std::move(event2));
-    thrift::PerfEvent event3{
-        apache::thrift::FRAGILE, "node1", "SPF_CALCULATE", 300};
+    auto event3 = createPerfEvent("node1", "SPF_CALCULATE", 300);
     perfEvents.events.emplace_back(std::move(event3));
     auto maybeDuration =
         getDurationBetweenPerfEvents(perfEvents, "LINK_UP", "SPF_CALCULATE");
@@ -651,6 +648,35 @@ TEST(UtilTest, getBestNextHopsMpls) {
   EXPECT_EQ(bestNextHops, std::vector<thrift::NextHopThrift>({path1_3_1_php}));
 }
 
+TEST(UtilTest, filterRoutesWithBestNextHops) {
+  // Same routes as copied with their best nexthops
+  auto bgpRoute =
+      createUnicastRoute(prefix2, {path1_3_2, path1_2_1, path1_3_1});
+  bgpRoute.prefixType = thrift::PrefixType::BGP;
+  std::vector<thrift::UnicastRoute> unicastRoutes{
+      createUnicastRoute(prefix1, {path1_2_3, path1_2_1, path1_2_2}),
+      bgpRoute,
+      createUnicastRoute(prefix3, {path1_2_2})};
+  const auto bestUnicastRoutes =
+      createUnicastRoutesWithBestNexthops(unicastRoutes);
+  filterUnicastRoutesWithBestNextHops(unicastRoutes);
+  EXPECT_EQ(bestUnicastRoutes, unicastRoutes);
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>({path1_2_1, path1_3_1}),
+      unicastRoutes.at(1).nextHops);
+
+  std::vector<thrift::MplsRoute> mplsRoutes{
+      createMplsRoute(1, {path1_2_2_swap, path1_2_1_swap, path1_3_1_swap}),
+      createMplsRoute(2, {path1_2_1_swap, path1_3_1_php}),
+      createMplsRoute(3, {path1_2_2_pop})};
+  const auto bestMplsRoutes = createMplsRoutesWithBestNextHops(mplsRoutes);
+  filterMplsRoutesWithBestNextHops(mplsRoutes);
+  EXPECT_EQ(bestMplsRoutes, mplsRoutes);
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>({path1_3_1_php}),
+      mplsRoutes.at(1).nextHops);
+}
+
 TEST(UtilTest, findDeltaRoutes) {
   thrift::RouteDatabase oldRouteDb;
   oldRouteDb.thisNodeName = "node-1";
@@ -704,6 +730,97 @@ TEST(UtilTest, findDeltaRoutes) {
   EXPECT_EQ(res3.mplsRoutesToDelete.at(0), 2);
 }
 
+TEST(UtilTest, getRouteBucketDigests) {
+  const int32_t numBuckets = 16;
+  for (const auto& prefix : {prefix1, prefix2, prefix3}) {
+    const auto bucket = getRouteBucket(prefix, numBuckets);
+    EXPECT_LE(0, bucket);
+    EXPECT_GT(numBuckets, bucket);
+    EXPECT_EQ(bucket, getRouteBucket(prefix, numBuckets));
+  }
+
+  const auto route1 = createUnicastRoute(prefix1, {path1_2_1, path1_2_2});
+  const auto route2 = createUnicastRoute(prefix2, {path1_3_1});
+  const auto digests = getRouteBucketDigests({route1, route2}, numBuckets);
+  ASSERT_EQ(numBuckets, digests.size());
+  EXPECT_EQ(
+      std::vector<int64_t>(numBuckets, 0),
+      getRouteBucketDigests({}, numBuckets));
+
+  // order of routes and of nexthops doesn't matter
+  EXPECT_EQ(
+      digests,
+      getRouteBucketDigests(
+          {route2, createUnicastRoute(prefix1, {path1_2_2, path1_2_1})},
+          numBuckets));
+
+  // a changed route changes the digest of its bucket only
+  const auto bucket1 = getRouteBucket(prefix1, numBuckets);
+  const auto newDigests = getRouteBucketDigests(
+      {createUnicastRoute(prefix1, {path1_2_1}), route2}, numBuckets);
+  for (int32_t bucket = 0; bucket < numBuckets; ++bucket) {
+    if (bucket == bucket1) {
+      EXPECT_NE(digests.at(bucket), newDigests.at(bucket));
+    } else {
+      EXPECT_EQ(digests.at(bucket), newDigests.at(bucket));
+    }
+  }
+
+  // mpls action is part of the digest
+  EXPECT_NE(
+      digests,
+      getRouteBucketDigests(
+          {createUnicastRoute(prefix1, {path1_2_1_swap, path1_2_2}), route2},
+          numBuckets));
+}
+
+TEST(UtilTest, getRouteFingerprint) {
+  const auto route = createUnicastRoute(prefix1, {path1_2_1, path1_2_2});
+  const auto fingerprint = getRouteFingerprint(route);
+
+  // order of nexthops doesn't matter
+  EXPECT_EQ(
+      fingerprint,
+      getRouteFingerprint(createUnicastRoute(prefix1, {path1_2_2, path1_2_1})));
+
+  // destination, nexthops and their attributes do
+  EXPECT_NE(
+      fingerprint,
+      getRouteFingerprint(createUnicastRoute(prefix2, {path1_2_1, path1_2_2})));
+  EXPECT_NE(
+      fingerprint,
+      getRouteFingerprint(createUnicastRoute(prefix1, {path1_2_1})));
+  EXPECT_NE(
+      fingerprint,
+      getRouteFingerprint(
+          createUnicastRoute(prefix1, {path1_2_1_swap, path1_2_2})));
+  auto changedRoute = route;
+  changedRoute.nextHops.at(0).weight += 1;
+  EXPECT_NE(fingerprint, getRouteFingerprint(changedRoute));
+  changedRoute = route;
+  changedRoute.nextHops.at(0).metric += 1;
+  EXPECT_NE(fingerprint, getRouteFingerprint(changedRoute));
+
+  // so do the other fields of the route
+  changedRoute = route;
+  changedRoute.doNotInstall = true;
+  EXPECT_NE(fingerprint, getRouteFingerprint(changedRoute));
+  changedRoute = route;
+  changedRoute.data = "";
+  EXPECT_NE(fingerprint, getRouteFingerprint(changedRoute));
+  changedRoute = route;
+  changedRoute.bestNexthop = path1_2_1;
+  EXPECT_NE(fingerprint, getRouteFingerprint(changedRoute));
+
+  const auto mplsRoute = createMplsRoute(1, {path1_2_1_swap, path1_3_1_php});
+  EXPECT_EQ(
+      getRouteFingerprint(mplsRoute),
+      getRouteFingerprint(createMplsRoute(1, {path1_3_1_php, path1_2_1_swap})));
+  EXPECT_NE(
+      getRouteFingerprint(mplsRoute),
+      getRouteFingerprint(createMplsRoute(2, {path1_2_1_swap, path1_3_1_php})));
+}
+
 TEST(UtilTest, MplsLabelValidate) {
   EXPECT_TRUE(isMplsLabelValid(0));
   EXPECT_TRUE(isMplsLabelValid(1132));
@@ -805,6 +922,73 @@ TEST(UtilTest, getPrefixForwardingType) {
       thrift::PrefixForwardingType::SR_MPLS, getPrefixForwardingType(prefixes));
 }
 
+TEST(UtilTest, PrefixKeyTest) {
+  const auto v4Prefix = toIpPrefix("10.1.0.0/16");
+  const auto v6Prefix = toIpPrefix("fc00:1::/64");
+
+  // round trip through the packed key
+  const PrefixKey v4Key(v4Prefix);
+  const PrefixKey v6Key(v6Prefix);
+  EXPECT_TRUE(v4Key.isV4());
+  EXPECT_FALSE(v6Key.isV4());
+  EXPECT_EQ(v4Prefix, v4Key.toIpPrefix());
+  EXPECT_EQ(v6Prefix, v6Key.toIpPrefix());
+
+  // keys differing in address or length only are different
+  const PrefixKey v4KeyLonger(toIpPrefix("10.1.0.0/24"));
+  const PrefixKey v4KeyOther(toIpPrefix("10.2.0.0/16"));
+  EXPECT_EQ(v4Key, PrefixKey(v4Prefix));
+  EXPECT_NE(v4Key, v4KeyLonger);
+  EXPECT_NE(v4Key, v4KeyOther);
+  EXPECT_NE(
+      std::hash<PrefixKey>()(v4Key), std::hash<PrefixKey>()(v4KeyLonger));
+
+  // ordered by version, address and length
+  EXPECT_LT(v4Key, v6Key);
+  EXPECT_LT(v4Key, v4KeyLonger);
+  EXPECT_LT(v4KeyLonger, v4KeyOther);
+
+  std::unordered_set<PrefixKey> keys{v4Key, v6Key, v4KeyLonger, v4Key};
+  EXPECT_EQ(3, keys.size());
+}
+
+TEST(UtilTest, CommonPrefixLengthTest) {
+  auto getLength = [](std::string const& a, std::string const& b) {
+    auto const addrA = folly::IPAddress(a);
+    auto const addrB = folly::IPAddress(b);
+    return getCommonPrefixLength(
+        addrA.bytes(), addrB.bytes(), addrA.byteCount(), addrA.bitCount());
+  };
+  EXPECT_EQ(32, getLength("10.1.2.3", "10.1.2.3"));
+  EXPECT_EQ(23, getLength("10.1.2.3", "10.1.3.3"));
+  EXPECT_EQ(0, getLength("10.1.2.3", "138.1.2.3"));
+  EXPECT_EQ(128, getLength("fc00::1", "fc00::1"));
+  EXPECT_EQ(126, getLength("fc00::1", "fc00::2"));
+  // difference in the second word
+  EXPECT_EQ(64, getLength("fc00::8000:0:0:0", "fc00::"));
+
+  auto const addr = folly::IPAddress("10.1.2.3");
+  auto const other = folly::IPAddress("10.1.3.3");
+  EXPECT_TRUE(isPrefixEqual(addr.bytes(), other.bytes(), 4, 23));
+  EXPECT_FALSE(isPrefixEqual(addr.bytes(), other.bytes(), 4, 24));
+  EXPECT_TRUE(isPrefixEqual(addr.bytes(), other.bytes(), 4, 0));
+}
+
+TEST(UtilTest, ToIPNetworkTest) {
+  for (auto const& network : {"10.1.2.3/24", "fc00::1/64", "::/0"}) {
+    auto const prefix = toIpPrefix(
+        folly::IPAddress::createNetwork(network, -1, false /* mask */));
+    EXPECT_EQ(
+        folly::IPAddress::createNetwork(network), toIPNetwork(prefix));
+    EXPECT_EQ(
+        folly::IPAddress::createNetwork(network, -1, false),
+        toIPNetwork(prefix, false));
+  }
+  auto prefix = toIpPrefix("10.0.0.0/8");
+  prefix.prefixLength = 33;
+  EXPECT_THROW(toIPNetwork(prefix), folly::IPAddressFormatException);
+}
+
 using namespace openr::MetricVectorUtils;
 TEST(MetricVectorUtilsTest, CompareResultInverseOperator) {
   EXPECT_EQ(CompareResult::WINNER, !CompareResult::LOOSER);
@@ -828,6 +1012,52 @@ TEST(MetricVectorUtilsTest, isDecisive) {
   EXPECT_FALSE(isDecisive(CompareResult::TIE));
 }
 
+TEST(UtilTest, KeyPrefixTest) {
+  // literal prefixes, matched by length
+  {
+    KeyPrefix keyPrefix({"prefix:", "adj:", "prefix:node1:"});
+    EXPECT_TRUE(keyPrefix.keyMatch("prefix:node2:[::/0]"));
+    EXPECT_TRUE(keyPrefix.keyMatch("adj:node1"));
+    EXPECT_TRUE(keyPrefix.keyMatch("adj:"));
+    EXPECT_FALSE(keyPrefix.keyMatch("adj"));
+    EXPECT_FALSE(keyPrefix.keyMatch("allocprefix:1"));
+    EXPECT_FALSE(keyPrefix.keyMatch(""));
+  }
+
+  // regex prefixes
+  {
+    KeyPrefix keyPrefix({"prefix:.*:1", "adj:"});
+    EXPECT_TRUE(keyPrefix.keyMatch("prefix:node1:1"));
+    EXPECT_FALSE(keyPrefix.keyMatch("prefix:node1:2"));
+    EXPECT_TRUE(keyPrefix.keyMatch("adj:node1"));
+    EXPECT_FALSE(keyPrefix.keyMatch("xadj:node1"));
+  }
+
+  // empty prefix list matches all
+  EXPECT_TRUE(KeyPrefix({}).keyMatch("anything"));
+
+  EXPECT_TRUE(KeyPrefix::isLiteral("prefix:node-1"));
+  EXPECT_FALSE(KeyPrefix::isLiteral("prefix:.*"));
+}
+
+TEST(UtilTest, GenerateHashTest) {
+  const std::string value(10000, 'a');
+  const auto hash = generateHash(1, "node1", value);
+  EXPECT_EQ(hash, generateHash(1, "node1", value));
+  EXPECT_EQ(Constants::kKvStoreHashVersion, getHashVersion(hash));
+
+  // version, originator and every value byte are covered
+  EXPECT_NE(hash, generateHash(2, "node1", value));
+  EXPECT_NE(hash, generateHash(1, "node2", value));
+  auto otherValue = value;
+  otherValue.back() = 'b';
+  EXPECT_NE(hash, generateHash(1, "node1", otherValue));
+  EXPECT_NE(hash, generateHash(1, "node1", folly::none));
+  EXPECT_EQ(
+      Constants::kKvStoreHashVersion,
+      getHashVersion(generateHash(1, "node1", folly::none)));
+}
+
 TEST(MetricVectorUtilsTest, sortMetricVector) {
   thrift::MetricVector mv;
 
@@ -955,6 +1185,74 @@ TEST(MetricVectorUtilsTest, compareMetricVectors) {
   EXPECT_EQ(CompareResult::TIE_LOOSER, compareMetricVectors(r, l));
 }
 
+TEST(MetricVectorUtilsTest, compareCompiledMetricVectors) {
+  // compiled vectors compare the same as the thrift ones, regardless of the
+  // order entities were given in
+  auto expectSameResults = [](thrift::MetricVector const& l,
+                              thrift::MetricVector const& r) {
+    auto const cl = compileMetricVector(l);
+    auto const cr = compileMetricVector(r);
+    EXPECT_EQ(compareMetricVectors(l, r), compareMetricVectors(cl, cr));
+    EXPECT_EQ(compareMetricVectors(r, l), compareMetricVectors(cr, cl));
+  };
+
+  thrift::MetricVector l, r;
+  expectSameResults(l, r);
+  l.version = 1;
+  expectSameResults(l, r);
+  r.version = 1;
+
+  int64_t numMetrics = 5;
+  for (int64_t i = 0; i < numMetrics; ++i) {
+    l.metrics.emplace_back(createMetricEntity(
+        i, i, thrift::CompareType::WIN_IF_PRESENT, false, {i, 2 * i}));
+  }
+  r.metrics = l.metrics;
+  std::reverse(r.metrics.begin(), r.metrics.end());
+  expectSameResults(l, r);
+
+  auto const cl = compileMetricVector(l);
+  ASSERT_EQ(5, cl.entities.size());
+  EXPECT_EQ(4, cl.entities.front().priority);
+  EXPECT_EQ(10, cl.metrics.size());
+
+  r.metrics[1].metric.back()--;
+  expectSameResults(l, r);
+  r.metrics[1].isBestPathTieBreaker = true;
+  expectSameResults(l, r);
+  l.metrics[numMetrics - 2].isBestPathTieBreaker = true;
+  expectSameResults(l, r);
+  r.metrics[1].metric.pop_back();
+  expectSameResults(l, r);
+  r.metrics[1].metric.push_back(0);
+
+  r.metrics.erase(r.metrics.begin());
+  for (auto op :
+       {thrift::CompareType::WIN_IF_PRESENT,
+        thrift::CompareType::WIN_IF_NOT_PRESENT,
+        thrift::CompareType::IGNORE_IF_NOT_PRESENT}) {
+    l.metrics[numMetrics - 1].op = op;
+    expectSameResults(l, r);
+  }
+
+  l.metrics[0].type--;
+  expectSameResults(l, r);
+  l.metrics[0].type++;
+
+  // added entities are placed by priority
+  auto cr = compileMetricVector(r);
+  addMetricEntity(
+      cr,
+      createMetricEntity(
+          numMetrics,
+          numMetrics,
+          thrift::CompareType::WIN_IF_NOT_PRESENT,
+          false,
+          {1}));
+  EXPECT_EQ(numMetrics, cr.entities.front().type);
+  EXPECT_EQ(CompareResult::WINNER, compareMetricVectors(cl, cr));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/WindowedHistogram.h>
+
+using namespace openr;
+
+TEST(WindowedHistogramTest, Empty) {
+  WindowedHistogram histogram(4);
+  EXPECT_TRUE(histogram.empty());
+  std::unordered_map<std::string, int64_t> counters;
+  histogram.addCounters("phase", counters);
+  EXPECT_TRUE(counters.empty());
+}
+
+TEST(WindowedHistogramTest, Percentiles) {
+  WindowedHistogram histogram(100);
+  for (int64_t value = 100; value > 0; --value) {
+    histogram.addValue(value);
+  }
+  EXPECT_FALSE(histogram.empty());
+  std::unordered_map<std::string, int64_t> counters;
+  histogram.addCounters("phase", counters);
+  EXPECT_EQ(3, counters.size());
+  EXPECT_EQ(50, counters.at("phase.p50"));
+  EXPECT_EQ(99, counters.at("phase.p99"));
+  EXPECT_EQ(100, counters.at("phase.max"));
+}
+
+TEST(WindowedHistogramTest, Window) {
+  // only the most recent values count
+  WindowedHistogram histogram(3);
+  for (int64_t value : {1000, 1000, 1, 2, 3}) {
+    histogram.addValue(value);
+  }
+  std::unordered_map<std::string, int64_t> counters;
+  histogram.addCounters("phase", counters);
+  EXPECT_EQ(2, counters.at("phase.p50"));
+  EXPECT_EQ(3, counters.at("phase.max"));
+
+  histogram.addValue(7);
+  histogram.addCounters("phase", counters);
+  EXPECT_EQ(7, counters.at("phase.max"));
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
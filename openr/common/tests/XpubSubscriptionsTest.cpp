@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/XpubSubscriptions.h>
+
+using namespace openr;
+
+namespace {
+
+folly::ByteRange
+toByteRange(std::string const& str) {
+  return folly::ByteRange(folly::StringPiece(str));
+}
+
+// poll sock until the number of subscribed topics is numTopics
+bool
+waitForNumTopics(
+    XpubSubscriptions& subscriptions,
+    fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER>& sock,
+    size_t numTopics) {
+  for (int i = 0; i < 100; ++i) {
+    subscriptions.update(sock);
+    if (subscriptions.getNumTopics() == numTopics) {
+      return true;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+} // namespace
+
+TEST(XpubSubscriptionsTest, Messages) {
+  XpubSubscriptions subscriptions;
+  EXPECT_FALSE(subscriptions.hasSubscribers());
+  EXPECT_FALSE(subscriptions.hasSubscribers(toByteRange("ab")));
+
+  subscriptions.processMessage(toByteRange(std::string("\x01" "ab")));
+  EXPECT_TRUE(subscriptions.hasSubscribers());
+  EXPECT_TRUE(subscriptions.hasSubscribers(toByteRange("ab")));
+  EXPECT_TRUE(subscriptions.hasSubscribers(toByteRange("abc")));
+  EXPECT_FALSE(subscriptions.hasSubscribers(toByteRange("a")));
+  EXPECT_FALSE(subscriptions.hasSubscribers(toByteRange("b")));
+
+  // empty topic matches everything
+  subscriptions.processMessage(toByteRange(std::string("\x01", 1)));
+  EXPECT_EQ(2, subscriptions.getNumTopics());
+  EXPECT_TRUE(subscriptions.hasSubscribers(toByteRange("b")));
+
+  // other messages are ignored
+  subscriptions.processMessage(toByteRange(""));
+  subscriptions.processMessage(toByteRange("\x02" "ab"));
+  EXPECT_EQ(2, subscriptions.getNumTopics());
+
+  subscriptions.processMessage(toByteRange(std::string("\x00", 1)));
+  EXPECT_FALSE(subscriptions.hasSubscribers(toByteRange("b")));
+  subscriptions.processMessage(toByteRange(std::string("\x00" "ab", 3)));
+  EXPECT_FALSE(subscriptions.hasSubscribers());
+}
+
+TEST(XpubSubscriptionsTest, Socket) {
+  fbzmq::Context context;
+  fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER> pubSock{
+      context, folly::none, folly::none, fbzmq::NonblockingFlag{true}};
+  ASSERT_TRUE(pubSock.bind(fbzmq::SocketUrl{"inproc://xpub"}).hasValue());
+
+  XpubSubscriptions subscriptions;
+  subscriptions.update(pubSock);
+  EXPECT_FALSE(subscriptions.hasSubscribers());
+
+  {
+    fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT> subSock{context};
+    ASSERT_TRUE(subSock.connect(fbzmq::SocketUrl{"inproc://xpub"}).hasValue());
+    ASSERT_TRUE(subSock.setSockOpt(ZMQ_SUBSCRIBE, "", 0).hasValue());
+    ASSERT_TRUE(waitForNumTopics(subscriptions, pubSock, 1));
+    EXPECT_TRUE(subscriptions.hasSubscribers());
+  }
+
+  // subscriptions of closed subscribers go away
+  ASSERT_TRUE(waitForNumTopics(subscriptions, pubSock, 0));
+  EXPECT_FALSE(subscriptions.hasSubscribers());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -7,10 +7,21 @@
 
 #include "PersistentStore.h"
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
+#include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/hash/Checksum.h>
 #include <folly/io/IOBuf.h>
+#include <folly/system/MemoryMapping.h>
+#include <folly/system/ThreadName.h>
 
 #include <openr/common/Util.h>
 
@@ -18,12 +29,133 @@ using std::exception;
 
 namespace {
 
-static const long kDbFlushRatio = 10000;
+// Size after which appends continue in a new segment
+const uint64_t kSegmentMaxBytes = 4 * 1024 * 1024;
+
+// Log is compacted once it is larger than the snapshot and at least this big
+const uint64_t kCompactionMinLogBytes = 1024 * 1024;
+
+// Size of snapshot and log from which they get decoded on multiple threads
+const uint64_t kParallelLoadMinBytes = 1024 * 1024;
+
+// Log record header, length and crc32c of the encoded PersistentObject
+const size_t kLogRecordHeaderSize = 2 * sizeof(uint32_t);
+
+// Make creation of a file durable
+void
+syncParentDirectory(const std::string& path) {
+  const auto pos = path.rfind('/');
+  const auto dirPath = pos == std::string::npos ? "." : path.substr(0, pos + 1);
+  const int fd = folly::openNoInt(dirPath.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    PLOG(WARNING) << "Failed to open directory " << dirPath;
+    return;
+  }
+  if (::fsync(fd) != 0) {
+    PLOG(WARNING) << "Failed to sync directory " << dirPath;
+  }
+  folly::closeNoInt(fd);
+}
 
 } // anonymous namespace
 
 namespace openr {
 
+namespace {
+
+// Split TLV records into up to numChunks ranges of whole records
+folly::Expected<std::vector<folly::ByteRange>, std::string>
+splitTlvRecords(folly::ByteRange records, size_t numChunks) {
+  std::vector<folly::ByteRange> chunks;
+  const size_t chunkBytes = records.size() / numChunks + 1;
+  auto buf = folly::IOBuf::wrapBufferAsValue(records);
+  folly::io::Cursor cursor(&buf);
+  size_t chunkStart{0};
+  try {
+    while (not cursor.isAtEnd()) {
+      // Skip type, key and data
+      cursor.skip(sizeof(uint8_t));
+      cursor.skip(cursor.readBE<uint32_t>());
+      cursor.skip(cursor.readBE<uint32_t>());
+      const auto pos = cursor.getCurrentPosition();
+      if (pos - chunkStart >= chunkBytes) {
+        chunks.emplace_back(records.subpiece(chunkStart, pos - chunkStart));
+        chunkStart = pos;
+      }
+    }
+  } catch (std::out_of_range const& e) {
+    return folly::makeUnexpected<std::string>(
+        folly::exceptionStr(e).toStdString());
+  }
+  if (chunkStart < records.size()) {
+    chunks.emplace_back(records.subpiece(chunkStart));
+  }
+  return chunks;
+}
+
+// Decode TLV records, all of them must be complete
+folly::Expected<std::vector<PersistentObject>, std::string>
+decodeTlvRecords(folly::ByteRange records) {
+  std::vector<PersistentObject> pObjects;
+  auto buf = folly::IOBuf::wrapBufferAsValue(records);
+  folly::io::Cursor cursor(&buf);
+  while (true) {
+    auto optionalObject = PersistentStore::decodePersistentObject(cursor);
+    if (optionalObject.hasError()) {
+      return folly::makeUnexpected(optionalObject.error());
+    }
+    // Read finish
+    if (not optionalObject->hasValue()) {
+      break;
+    }
+    pObjects.emplace_back(std::move(optionalObject->value()));
+  }
+  return pObjects;
+}
+
+// Decode the records of a log segment. Decoding stops at the first incomplete
+// or corrupted record, i.e. one torn by a crash while being appended.
+folly::Expected<std::vector<PersistentObject>, std::string>
+decodeLogSegment(folly::ByteRange segment) {
+  std::vector<PersistentObject> pObjects;
+  // Segment may have been created without getting any record
+  if (not segment.startsWith(folly::ByteRange(kLogSegmentMarker))) {
+    return pObjects;
+  }
+  segment.advance(kLogSegmentMarker.size());
+
+  while (not segment.empty()) {
+    auto buf = folly::IOBuf::wrapBufferAsValue(segment);
+    folly::io::Cursor cursor(&buf);
+    if (not cursor.canAdvance(kLogRecordHeaderSize)) {
+      LOG(WARNING) << "Ignoring incomplete log record header";
+      break;
+    }
+    const auto length = cursor.readBE<uint32_t>();
+    const auto checksum = cursor.readBE<uint32_t>();
+    if (not cursor.canAdvance(length)) {
+      LOG(WARNING) << "Ignoring incomplete log record";
+      break;
+    }
+    const auto payload = segment.subpiece(kLogRecordHeaderSize, length);
+    if (folly::crc32c(payload.data(), payload.size()) != checksum) {
+      LOG(WARNING) << "Ignoring log record with checksum mismatch";
+      break;
+    }
+    auto records = decodeTlvRecords(payload);
+    if (records.hasError() or records->size() != 1) {
+      LOG(WARNING) << "Ignoring malformed log record";
+      break;
+    }
+    pObjects.emplace_back(std::move(records->front()));
+    segment.advance(kLogRecordHeaderSize + length);
+  }
+  return pObjects;
+}
+
+} // namespace
+
+
 PersistentStore::PersistentStore(
     const std::string& nodeName,
     const std::string& storageFilePath,
@@ -31,23 +163,14 @@ PersistentStore::PersistentStore(
     std::chrono::milliseconds saveInitialBackoff,
     std::chrono::milliseconds saveMaxBackoff,
     bool dryrun)
-    : storageFilePath_(storageFilePath), dryrun_(dryrun) {
+    : storageFilePath_(storageFilePath),
+      dryrun_(dryrun),
+      compactionExecutor_(std::make_unique<folly::CPUThreadPoolExecutor>(1)) {
   if (saveInitialBackoff != 0ms or saveMaxBackoff != 0ms) {
-    // Create timer and backoff mechanism only if backoff is requested
-    saveDbTimerBackoff_ =
+    // Create backoff mechanism only if backoff is requested
+    saveDbBackoff_ =
         std::make_unique<ExponentialBackoff<std::chrono::milliseconds>>(
             saveInitialBackoff, saveMaxBackoff);
-
-    saveDbTimer_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
-      if (savePersistentObjectToDisk()) {
-        saveDbTimerBackoff_->reportSuccess();
-      } else {
-        // Report error and schedule next-try
-        saveDbTimerBackoff_->reportError();
-        saveDbTimer_->scheduleTimeout(
-            saveDbTimerBackoff_->getTimeRemainingUntilRetry());
-      }
-    });
   }
 
   // Load initial database. On failure we will just report error and continue
@@ -56,10 +179,33 @@ PersistentStore::PersistentStore(
     LOG(ERROR) << "Failed to load config-database from file: "
                << storageFilePath_;
   }
+
+  logWriterThread_ = std::thread([this]() noexcept { runLogWriter(); });
 }
 
 PersistentStore::~PersistentStore() {
-  saveDatabaseToDisk();
+  // Let the log writer commit what is queued, then wait for a compaction in
+  // progress
+  {
+    std::lock_guard<std::mutex> lock(pendingWritesLock_);
+    stopLogWriter_ = true;
+  }
+  pendingWritesCv_.notify_all();
+  logWriterThread_.join();
+  compactionExecutor_->join();
+
+  // Leave a single snapshot to load on restart. It covers the writes the log
+  // writer failed to commit as well.
+  const auto success = saveDatabaseToDisk();
+  for (auto& write : pendingWrites_) {
+    if (success) {
+      write.onCommit(folly::Try<folly::Unit>(folly::Unit()));
+    } else {
+      write.onCommit(folly::Try<folly::Unit>(
+          folly::make_exception_wrapper<std::runtime_error>(
+              "Failed to save config-database to disk")));
+    }
+  }
 }
 
 folly::SemiFuture<folly::Unit>
@@ -74,12 +220,14 @@ PersistentStore::store(std::string key, std::string value) {
   ]() mutable noexcept {
     SYSLOG(INFO) << "Store key: " << key << ", value: " << value
                  << " to config-store";
-    // Override previous value if any
+    // Override previous value if any. Loads see it right away, the promise
+    // is fulfilled once it is durable.
     database_.keyVals[key] = value;
-    auto pObject = toPersistentObject(ActionType::ADD, key, value);
-    pObjects_.emplace_back(std::move(pObject));
-    maybeSaveObjectToDisk();
-    p.setValue();
+    queueWrite(
+        toPersistentObject(ActionType::ADD, key, value),
+        [p = std::move(p)](folly::Try<folly::Unit>&& result) mutable {
+          p.setTry(std::move(result));
+        });
   });
   return sf;
 }
@@ -92,10 +240,15 @@ PersistentStore::erase(std::string key) {
       [this, p = std::move(p), key = std::move(key)]() mutable noexcept {
         SYSLOG(INFO) << "Erase key: " << key << " from config-store";
         if (database_.keyVals.erase(key) > 0) {
-          auto pObject = toPersistentObject(ActionType::DEL, key, "");
-          pObjects_.emplace_back(std::move(pObject));
-          maybeSaveObjectToDisk();
-          p.setValue(true);
+          queueWrite(
+              toPersistentObject(ActionType::DEL, key, ""),
+              [p = std::move(p)](folly::Try<folly::Unit>&& result) mutable {
+                if (result.hasException()) {
+                  p.setException(std::move(result.exception()));
+                } else {
+                  p.setValue(true);
+                }
+              });
         } else {
           LOG(WARNING) << "Key: " << key << " doesn't exist";
           p.setValue(false);
@@ -121,148 +274,367 @@ PersistentStore::load(std::string key) {
 }
 
 void
-PersistentStore::maybeSaveObjectToDisk() noexcept {
-  if (not saveDbTimerBackoff_) {
-    // This is primarily used for unit testing to save DB immediately
-    // Block the response till file is saved
-    savePersistentObjectToDisk();
-  } else if (not saveDbTimer_->isScheduled()) {
-    saveDbTimer_->scheduleTimeout(
-        saveDbTimerBackoff_->getTimeRemainingUntilRetry());
+PersistentStore::queueWrite(
+    PersistentObject pObject,
+    folly::Function<void(folly::Try<folly::Unit>&&)> onCommit) noexcept {
+  PendingWrite write;
+  write.pObject = std::move(pObject);
+  write.onCommit = std::move(onCommit);
+
+  // Log outgrew the snapshot, compact it once this write is committed. The
+  // snapshot is taken here as `database_` is only accessed in this thread.
+  if (not dryrun_ and not compactionInProgress_ and
+      logBytes_ >= std::max(kCompactionMinLogBytes, snapshotBytes_.load())) {
+    compactionInProgress_ = true;
+    write.snapshot = database_;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pendingWritesLock_);
+    pendingWrites_.emplace_back(std::move(write));
   }
+  pendingWritesCv_.notify_one();
 }
 
-bool
-PersistentStore::savePersistentObjectToDisk() noexcept {
-  if (not dryrun_) {
-    // Write PersistentObject to ioBuf
-    std::vector<PersistentObject> newObjects;
-    newObjects = std::move(pObjects_);
+void
+PersistentStore::runLogWriter() noexcept {
+  folly::setThreadName("PersistentLog");
 
-    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+  std::unique_lock<std::mutex> lock(pendingWritesLock_);
+  // Writes at the front of the queue which failed to commit. Without backoff
+  // they are retried along with the next write.
+  size_t numFailed{0};
+  while (true) {
+    pendingWritesCv_.wait(lock, [this, &numFailed]() {
+      return stopLogWriter_ or pendingWrites_.size() > numFailed;
+    });
+    if (pendingWrites_.size() == numFailed) {
+      // Stopped. Writes left are covered by the snapshot on destruction.
+      break;
+    }
+
+    // Group commit of everything queued while the previous one was running
+    auto writes = std::move(pendingWrites_);
+    pendingWrites_.clear();
+    lock.unlock();
+    commitWrites(writes);
+    lock.lock();
+
+    if (writes.empty()) {
+      numFailed = 0;
+      if (saveDbBackoff_) {
+        saveDbBackoff_->reportSuccess();
+      }
+      continue;
+    }
+
+    // Failed writes go before the ones queued meanwhile
+    numFailed = writes.size();
+    pendingWrites_.insert(
+        pendingWrites_.begin(),
+        std::make_move_iterator(writes.begin()),
+        std::make_move_iterator(writes.end()));
+    if (saveDbBackoff_) {
+      saveDbBackoff_->reportError();
+      pendingWritesCv_.wait_for(
+          lock, saveDbBackoff_->getTimeRemainingUntilRetry(), [this]() {
+            return stopLogWriter_;
+          });
+      if (not stopLogWriter_) {
+        numFailed = 0;
+      }
+    }
+  }
+}
 
-    for (auto& pObject : newObjects) {
-      auto buf = encodePersistentObject(pObject);
+void
+PersistentStore::commitWrites(std::vector<PendingWrite>& writes) noexcept {
+  size_t numCommitted{0};
+  while (numCommitted < writes.size()) {
+    // Writes up to the next snapshot share one append and sync
+    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+    size_t end = numCommitted;
+    bool encoded{true};
+    while (end < writes.size()) {
+      auto buf = encodeLogRecord(writes[end].pObject);
       if (buf.hasError()) {
         LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error: "
                    << folly::exceptionStr(buf.error());
-        return false;
+        encoded = false;
+        break;
+      }
+      queue.append(std::move(*buf));
+      if (writes[end++].snapshot.hasValue()) {
+        break;
       }
-      queue.append(std::move(**buf));
     }
-
-    // Append IoBuf to disk
-    auto ioBuf = queue.move();
-    auto success = writeIoBufToDisk(ioBuf, WriteType::APPEND);
-    if (success.hasError()) {
-      LOG(ERROR) << "Failed to write PersistentObject to file '"
-                 << storageFilePath_
-                 << "'. Error: " << folly::exceptionStr(success.error());
-      return false;
+    if (not encoded) {
+      break;
     }
 
-    numOfNewWritesToDisk_++;
+    if (not dryrun_) {
+      auto success = appendToLog(queue.move());
+      if (success.hasError()) {
+        LOG(ERROR) << "Failed to append PersistentObject to log of '"
+                   << storageFilePath_ << "'. Error: " << success.error();
+        break;
+      }
+    } else {
+      VLOG(1) << "Skipping writing to disk in dryrun mode";
+    }
+    numOfWritesToDisk_++;
 
-    // Write the whole database to disk periodically
-    if (numOfNewWritesToDisk_ >= kDbFlushRatio) {
-      numOfNewWritesToDisk_ = 0;
-      const auto startTs = std::chrono::steady_clock::now();
-      if (not saveDatabaseToDisk()) {
-        return false;
+    for (; numCommitted < end; ++numCommitted) {
+      auto& write = writes[numCommitted];
+      write.onCommit(folly::Try<folly::Unit>(folly::Unit()));
+      if (write.snapshot.hasValue()) {
+        compactLog(std::move(write.snapshot).value());
       }
-      LOG(INFO) << "Updated database on disk. Took "
-                << std::chrono::duration_cast<std::chrono::milliseconds>(
-                       std::chrono::steady_clock::now() - startTs)
-                       .count()
-                << "ms";
     }
-  } else {
-    VLOG(1) << "Skipping writing to disk in dryrun mode";
   }
-  numOfWritesToDisk_++;
-
-  return true;
+  writes.erase(writes.begin(), writes.begin() + numCommitted);
 }
 
 bool
 PersistentStore::saveDatabaseToDisk() noexcept {
-  std::unique_ptr<folly::IOBuf> ioBuf;
-  // If database is empty, write 'kTlvFormatMarker' to disk and return
-  if (database_.keyVals.size() == 0) {
-    ioBuf = folly::IOBuf::copyBuffer(
-        kTlvFormatMarker.data(), kTlvFormatMarker.size());
-  } else {
-    // Append kTlvFormatMarker to queue
-    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
-    queue.append(kTlvFormatMarker.data(), kTlvFormatMarker.size());
-
-    // Encode database_ and append to queue
-    for (auto& keyPair : database_.keyVals) {
-      PersistentObject pObject;
-      pObject =
-          toPersistentObject(ActionType::ADD, keyPair.first, keyPair.second);
+  // Appends continue in a new segment which the snapshot doesn't cover
+  sealSegment();
+  return writeSnapshot(database_, segmentSeq_);
+}
 
-      auto buf = encodePersistentObject(pObject);
-      if (buf.hasError()) {
-        LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error:  "
-                   << folly::exceptionStr(buf.error());
-        return false;
-      }
-      queue.append(std::move(*buf));
+bool
+PersistentStore::writeSnapshot(
+    thrift::StoreDatabase const& database, uint64_t lastSeq) noexcept {
+  const auto startTs = std::chrono::steady_clock::now();
+
+  // Append kTlvFormatMarker to queue
+  auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+  queue.append(kTlvFormatMarker.data(), kTlvFormatMarker.size());
+
+  // Encode database and append to queue
+  for (auto& keyPair : database.keyVals) {
+    PersistentObject pObject;
+    pObject =
+        toPersistentObject(ActionType::ADD, keyPair.first, keyPair.second);
+
+    auto buf = encodePersistentObject(pObject);
+    if (buf.hasError()) {
+      LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error:  "
+                 << folly::exceptionStr(buf.error());
+      return false;
     }
-    // Write queue to disk
-    ioBuf = queue.move();
+    queue.append(std::move(*buf));
   }
+  const auto snapshotBytes = queue.chainLength();
 
-  auto success = writeIoBufToDisk(ioBuf, WriteType::WRITE);
+  // Write queue to disk
+  auto success = writeIoBufToDisk(queue.move());
   if (success.hasError()) {
     LOG(ERROR) << "Failed to write database to file '" << storageFilePath_
                << "'. Error: " << folly::exceptionStr(success.error());
     return false;
   }
+
+  // Segments covered by the snapshot aren't needed anymore
+  for (auto seq : listSegments()) {
+    if (seq > lastSeq) {
+      break;
+    }
+    const auto path = getSegmentFilePath(seq);
+    if (::unlink(path.c_str()) != 0) {
+      PLOG(WARNING) << "Failed to remove log segment " << path;
+    }
+  }
+
+  snapshotBytes_ = snapshotBytes;
+  numOfCompactions_++;
+  LOG(INFO) << "Updated database on disk. Wrote " << snapshotBytes
+            << " bytes, took "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - startTs)
+                   .count()
+            << "ms";
   return true;
 }
 
+void
+PersistentStore::compactLog(thrift::StoreDatabase database) noexcept {
+  // Snapshot covers the active segment and all before it. Encoding and
+  // writing it happens in the background while appends continue in a new
+  // segment.
+  sealSegment();
+  logBytes_ = 0;
+  compactionExecutor_->add([
+    this,
+    database = std::move(database),
+    lastSeq = segmentSeq_
+  ]() noexcept {
+    writeSnapshot(database, lastSeq);
+    compactionInProgress_ = false;
+  });
+}
+
+std::string
+PersistentStore::getSegmentFilePath(uint64_t seq) const {
+  return folly::sformat("{}.log.{}", storageFilePath_, seq);
+}
+
+std::vector<uint64_t>
+PersistentStore::listSegments() const noexcept {
+  std::vector<uint64_t> seqs;
+  const auto pos = storageFilePath_.rfind('/');
+  const auto dirPath =
+      pos == std::string::npos ? "." : storageFilePath_.substr(0, pos + 1);
+  const auto prefix = folly::sformat(
+      "{}.log.",
+      pos == std::string::npos ? storageFilePath_
+                               : storageFilePath_.substr(pos + 1));
+
+  auto dir = ::opendir(dirPath.c_str());
+  if (not dir) {
+    return seqs;
+  }
+  while (auto entry = ::readdir(dir)) {
+    folly::StringPiece name(entry->d_name);
+    if (not name.removePrefix(prefix)) {
+      continue;
+    }
+    auto seq = folly::tryTo<uint64_t>(name);
+    if (seq.hasValue()) {
+      seqs.emplace_back(seq.value());
+    }
+  }
+  ::closedir(dir);
+
+  std::sort(seqs.begin(), seqs.end());
+  return seqs;
+}
+
+folly::Expected<folly::Unit, std::string>
+PersistentStore::appendToLog(std::unique_ptr<folly::IOBuf> records) noexcept {
+  if (segmentFd_ >= 0 and segmentBytes_ >= kSegmentMaxBytes) {
+    sealSegment();
+  }
+
+  if (segmentFd_ < 0) {
+    // Always start a new segment, the last one may end in a torn record
+    const auto path = getSegmentFilePath(segmentSeq_ + 1);
+    const int fd = folly::openNoInt(
+        path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      return folly::makeUnexpected(folly::sformat(
+          "Failed to create log segment '{}': {}",
+          path,
+          folly::errnoStr(errno)));
+    }
+    segmentFd_ = fd;
+    segmentSeq_++;
+    segmentBytes_ = 0;
+    syncParentDirectory(path);
+
+    auto marker = folly::IOBuf::copyBuffer(
+        kLogSegmentMarker.data(), kLogSegmentMarker.size());
+    marker->prependChain(std::move(records));
+    records = std::move(marker);
+  }
+
+  auto iov = records->getIov();
+  size_t written{0};
+  for (size_t i = 0; i < iov.size(); i += IOV_MAX) {
+    const auto count = std::min<size_t>(IOV_MAX, iov.size() - i);
+    const auto rc = folly::writevFull(
+        segmentFd_, iov.data() + i, static_cast<int>(count));
+    if (rc < 0) {
+      const auto error = folly::errnoStr(errno);
+      // Segment may end in a partial record now, don't append to it anymore
+      sealSegment();
+      return folly::makeUnexpected(
+          folly::sformat("Failed to append to log segment: {}", error));
+    }
+    written += rc;
+  }
+
+  // One sync for all records of the batch
+  if (::fdatasync(segmentFd_) != 0) {
+    const auto error = folly::errnoStr(errno);
+    sealSegment();
+    return folly::makeUnexpected(
+        folly::sformat("Failed to sync log segment: {}", error));
+  }
+  segmentBytes_ += written;
+  logBytes_ += written;
+  return folly::Unit();
+}
+
+void
+PersistentStore::sealSegment() noexcept {
+  if (segmentFd_ < 0) {
+    return;
+  }
+  folly::closeNoInt(segmentFd_);
+  segmentFd_ = -1;
+}
+
 bool
 PersistentStore::loadDatabaseFromDisk() noexcept {
+  const auto seqs = listSegments();
+  if (not seqs.empty()) {
+    segmentSeq_ = seqs.back();
+  }
+
   // Check if file exists
-  if (not fileExists(storageFilePath_)) {
+  const bool snapshotExists = fileExists(storageFilePath_);
+  if (not snapshotExists and seqs.empty()) {
     LOG(INFO) << "Storage file " << storageFilePath_ << " doesn't exists. "
               << "Starting with empty database";
     return true;
   }
 
-  // Read data from file
-  std::string fileData{""};
-  if (not folly::readFile(storageFilePath_.c_str(), fileData)) {
-    LOG(ERROR) << "Failed to read file contents from '" << storageFilePath_
-               << "'. Error (" << errno << "): " << folly::errnoStr(errno);
-    return false;
-  }
-
-  // Create IoBuf and cursor for loading data from disk
-  auto ioBuf = folly::IOBuf::wrapBuffer(fileData.c_str(), fileData.size());
-  folly::io::Cursor cursor(ioBuf.get());
+  try {
+    // Map snapshot and segments instead of reading them. Mappings only live
+    // while loading.
+    folly::Optional<folly::MemoryMapping> snapshotMapping;
+    folly::ByteRange snapshot;
+    if (snapshotExists) {
+      snapshotMapping.emplace(storageFilePath_.c_str());
+      snapshot = snapshotMapping->range();
+    }
+    std::vector<folly::MemoryMapping> segmentMappings;
+    std::vector<folly::ByteRange> segments;
+    segmentMappings.reserve(seqs.size());
+    for (auto seq : seqs) {
+      segmentMappings.emplace_back(getSegmentFilePath(seq).c_str());
+      segments.emplace_back(segmentMappings.back().range());
+      logBytes_ += segments.back().size();
+    }
+    snapshotBytes_ = snapshot.size();
+
+    // Read 'kTlvFormatMarker' from snapshot
+    if (not snapshot.empty() and
+        not snapshot.startsWith(folly::ByteRange(kTlvFormatMarker))) {
+      // Load old Format and write TlvFormat
+      auto ioBuf = folly::IOBuf::wrapBuffer(snapshot);
+      auto oldSuccess = loadDatabaseOldFormat(ioBuf);
+      if (oldSuccess.hasError()) {
+        LOG(ERROR) << "Failed to read old-format file contents from '"
+                   << storageFilePath_
+                   << "'. Error: " << folly::exceptionStr(oldSuccess.error());
+        return false;
+      }
+      return true;
+    }
 
-  // Read 'kTlvFormatMarker' from ioBuf
-  if (not cursor.canAdvance(kTlvFormatMarker.size()) or
-      cursor.readFixedString(kTlvFormatMarker.size()) != kTlvFormatMarker) {
-    // Load old Format and write TlvFormat
-    auto oldSuccess = loadDatabaseOldFormat(ioBuf);
-    if (oldSuccess.hasError()) {
-      LOG(ERROR) << "Failed to read old-format file contents from '"
+    // Load TlvFormat
+    auto tlvSuccess = loadDatabaseTlvFormat(snapshot, segments);
+    if (tlvSuccess.hasError()) {
+      LOG(ERROR) << "Failed to read Tlv-format file contents from '"
                  << storageFilePath_
-                 << "'. Error: " << folly::exceptionStr(oldSuccess.error());
+                 << "'. Error: " << folly::exceptionStr(tlvSuccess.error());
       return false;
     }
-    return true;
-  }
-  // Load TlvFormat
-  auto tlvSuccess = loadDatabaseTlvFormat(ioBuf);
-  if (tlvSuccess.hasError()) {
-    LOG(ERROR) << "Failed to read Tlv-format file contents from '"
-               << storageFilePath_
-               << "'. Error: " << folly::exceptionStr(tlvSuccess.error());
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to map file contents of '" << storageFilePath_
+               << "'. Error: " << folly::exceptionStr(e);
     return false;
   }
   return true;
@@ -287,63 +659,79 @@ PersistentStore::loadDatabaseOldFormat(
 
 folly::Expected<folly::Unit, std::string>
 PersistentStore::loadDatabaseTlvFormat(
-    const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept {
-  // Parse ioBuf to persistentObject and then to `database_`
-  folly::io::Cursor cursor(ioBuf.get());
-  thrift::StoreDatabase newDatabase;
-  // Read 'kTlvFormatMarker'
-  try {
-    cursor.readFixedString(kTlvFormatMarker.size());
-  } catch (std::out_of_range& e) {
-    return folly::makeUnexpected<std::string>(
-        folly::exceptionStr(e).toStdString());
+    folly::ByteRange snapshot,
+    std::vector<folly::ByteRange> const& segments) noexcept {
+  // Skip 'kTlvFormatMarker'
+  snapshot.advance(std::min(snapshot.size(), kTlvFormatMarker.size()));
+
+  // Decode on multiple threads only if there is enough to decode
+  size_t numBytes = snapshot.size();
+  for (auto const& segment : segments) {
+    numBytes += segment.size();
   }
-  // Iteratively read persistentObject from disk
-  while (true) {
-    // Read and decode into persistentObject
-    auto optionalObject = decodePersistentObject(cursor);
-    if (optionalObject.hasError()) {
-      return folly::makeUnexpected(optionalObject.error());
-    }
+  const size_t numThreads = numBytes >= kParallelLoadMinBytes
+      ? std::max(1u, std::thread::hardware_concurrency())
+      : 1;
 
-    // Read finish
-    if (not optionalObject->hasValue()) {
-      break;
+  auto chunks = splitTlvRecords(snapshot, numThreads);
+  if (chunks.hasError()) {
+    return folly::makeUnexpected(chunks.error());
+  }
+
+  // Every chunk of the snapshot and every segment is decoded independently,
+  // the results are applied in order
+  const auto numChunks = chunks->size();
+  std::vector<folly::Expected<std::vector<PersistentObject>, std::string>>
+      decoded(numChunks + segments.size());
+  auto decode = [&](size_t i) {
+    decoded[i] = i < numChunks ? decodeTlvRecords(chunks->at(i))
+                               : decodeLogSegment(segments.at(i - numChunks));
+  };
+  if (numThreads > 1 and decoded.size() > 1) {
+    folly::CPUThreadPoolExecutor executor(
+        std::min(numThreads, decoded.size()));
+    for (size_t i = 0; i < decoded.size(); ++i) {
+      executor.add([&decode, i]() { decode(i); });
+    }
+    executor.join();
+  } else {
+    for (size_t i = 0; i < decoded.size(); ++i) {
+      decode(i);
     }
-    auto pObject = std::move(optionalObject->value());
+  }
 
-    // Add/Delete persistentObject to/from 'newDatabase'
-    if (pObject.type == ActionType::ADD) {
-      newDatabase.keyVals[pObject.key] =
-          pObject.data.has_value() ? pObject.data.value() : "";
-    } else if (pObject.type == ActionType::DEL) {
-      newDatabase.keyVals.erase(pObject.key);
+  // Add/Delete persistentObject to/from 'newDatabase'
+  thrift::StoreDatabase newDatabase;
+  for (auto& objects : decoded) {
+    if (objects.hasError()) {
+      return folly::makeUnexpected(objects.error());
+    }
+    for (auto& pObject : objects.value()) {
+      if (pObject.type == ActionType::ADD) {
+        newDatabase.keyVals[pObject.key] =
+            pObject.data.has_value() ? std::move(pObject.data.value()) : "";
+      } else if (pObject.type == ActionType::DEL) {
+        newDatabase.keyVals.erase(pObject.key);
+      }
     }
   }
   database_ = std::move(newDatabase);
   return folly::Unit();
 }
 
-// Write over or append IoBuf to disk atomically
+// Write over IoBuf to disk atomically
 folly::Expected<folly::Unit, std::string>
 PersistentStore::writeIoBufToDisk(
-    const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept {
-  std::string fileData("");
+    std::unique_ptr<folly::IOBuf> ioBuf) noexcept {
   try {
     ioBuf->coalesce();
-    fileData = ioBuf->moveToFbString().toStdString();
-
-    if (writeType == WriteType::WRITE) {
-      // Write over
-      folly::writeFileAtomic(storageFilePath_, fileData, 0666);
-    } else {
-      // Append to file
-      folly::writeFile(
-          fileData,
-          storageFilePath_.c_str(),
-          O_WRONLY | O_APPEND | O_CREAT,
-          0666);
-    }
+    // Synced before replacing the file, the log segments it replaces get
+    // removed afterwards
+    folly::writeFileAtomic(
+        storageFilePath_,
+        folly::ByteRange(ioBuf->data(), ioBuf->length()),
+        0666,
+        folly::SyncType::WITH_SYNC);
   } catch (std::exception const& e) {
     return folly::makeUnexpected<std::string>(
         folly::exceptionStr(e).toStdString());
@@ -384,6 +772,21 @@ PersistentStore::encodePersistentObject(
   }
 }
 
+folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+PersistentStore::encodeLogRecord(const PersistentObject& pObject) noexcept {
+  auto payload = encodePersistentObject(pObject);
+  if (payload.hasError()) {
+    return payload;
+  }
+  auto record = folly::IOBuf::create(kLogRecordHeaderSize);
+  folly::io::Appender appender(record.get(), 0);
+  appender.writeBE<uint32_t>((*payload)->length());
+  appender.writeBE<uint32_t>(
+      folly::crc32c((*payload)->data(), (*payload)->length()));
+  record->prependChain(std::move(*payload));
+  return record;
+}
+
 // A made up decoding of a PersistentObject.
 folly::Expected<folly::Optional<PersistentObject>, std::string>
 PersistentStore::decodePersistentObject(folly::io::Cursor& cursor) noexcept {
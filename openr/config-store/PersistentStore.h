@@ -7,11 +7,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Function.h>
+#include <folly/Try.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
@@ -23,7 +30,9 @@
 
 namespace {
 constexpr folly::StringPiece kTlvFormatMarker{"TlvFormatMarker"};
-enum WriteType { APPEND = 1, WRITE = 2 };
+
+// Marker at the start of every log segment
+constexpr folly::StringPiece kLogSegmentMarker{"OpenrLogSegmentV1"};
 
 } // anonymous namespace
 
@@ -46,6 +55,17 @@ struct PersistentObject {
  * `storageFilePath`: Describe the path of file in file system where data will
  * be stored/retrieved from (in binary format).
  *
+ * Updates are appended as checksummed records to a log of segment files next
+ * to the storage file, `<storageFilePath>.log.<seq>`. Reads are served from
+ * memory. Writes are committed by a dedicated log writer thread and complete
+ * once they are durable. All writes queued while a commit is in progress go
+ * into the next one, with a single `writev` and `fdatasync` for all of them.
+ * Failed commits are retried with the given backoffs, or with the next write
+ * if there are none. Once the log outgrows the storage file, a background
+ * thread compacts it by writing a snapshot of the database to the storage file
+ * and removing the segments covered by it. On startup the snapshot and
+ * segments are memory mapped and decoded in parallel.
+ *
  * You can interact with this module via ZMQ-Socket APIs described in
  * PersistentStore.thrift file via `REP` socket.
  *
@@ -56,7 +76,7 @@ class PersistentStore : public OpenrEventBase {
       const std::string& nodeName,
       const std::string& storageFilePath,
       fbzmq::Context& context,
-      // persistent store DB saving backoffs
+      // backoffs to retry failed commits to disk
       std::chrono::milliseconds saveInitialBackoff =
           Constants::kPersistentStoreInitialBackoff,
       std::chrono::milliseconds saveMaxBackoff =
@@ -66,11 +86,17 @@ class PersistentStore : public OpenrEventBase {
   // Destructor will try to save DB to disk before destroying the object
   ~PersistentStore() override;
 
+  // Number of commits to disk, each one covering one or more writes
   uint64_t
   getNumOfDbWritesToDisk() const {
     return numOfWritesToDisk_;
   }
 
+  uint64_t
+  getNumOfCompactions() const {
+    return numOfCompactions_;
+  }
+
   /**
    * Encode/Decode a PersistentObject, this can be private method, but for unit
    * test, we make it public
@@ -80,17 +106,26 @@ class PersistentStore : public OpenrEventBase {
   static folly::Expected<folly::Optional<PersistentObject>, std::string>
   decodePersistentObject(folly::io::Cursor& cursor) noexcept;
 
+  /**
+   * Encode a PersistentObject as record of a log segment, framed by its
+   * length and checksum. Public for building logs in benchmarks.
+   */
+  static folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+  encodeLogRecord(const PersistentObject& pObject) noexcept;
+
   //
   // Public API
   //
 
-  // Store key-value
+  // Store key-value. Completes once the value is durable.
   folly::SemiFuture<folly::Unit> store(std::string key, std::string value);
 
-  // Get value for a key. `nullptr` will be returned if key doesn't exists
+  // Get value for a key. `nullptr` will be returned if key doesn't exists.
+  // Sees all stored values, also the ones not durable yet.
   folly::SemiFuture<std::optional<std::string>> load(std::string key);
 
-  // Erase config
+  // Erase config. Completes once the erasure is durable, or right away with
+  // false if the key doesn't exist.
   folly::SemiFuture<bool> erase(std::string key);
 
   // Utility function to store thrift objects
@@ -131,19 +166,66 @@ class PersistentStore : public OpenrEventBase {
   folly::Expected<folly::Unit, std::string> loadDatabaseOldFormat(
       const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept;
 
-  // Load TlvFormat from disk
+  // Load TlvFormat snapshot and the log segments following it from disk
   folly::Expected<folly::Unit, std::string> loadDatabaseTlvFormat(
-      const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept;
+      folly::ByteRange snapshot,
+      std::vector<folly::ByteRange> const& segments) noexcept;
+
+  // Write of a PersistentObject waiting to be committed to the log
+  struct PendingWrite {
+    PersistentObject pObject;
+    // Called once the write is durable, or with the error if it isn't
+    folly::Function<void(folly::Try<folly::Unit>&&)> onCommit;
+    // Database as of this write. Once the write is committed, the log up to it
+    // gets compacted into a snapshot of it.
+    folly::Optional<thrift::StoreDatabase> snapshot;
+  };
+
+  // Hand a write over to the log writer. Called in the event base thread
+  // after applying it to `database_`.
+  void queueWrite(
+      PersistentObject pObject,
+      folly::Function<void(folly::Try<folly::Unit>&&)> onCommit) noexcept;
+
+  // Body of the log writer thread. Commits everything queued while the
+  // previous commit was in progress at once, until stopped.
+  void runLogWriter() noexcept;
+
+  // Append writes to the log in order, with a single sync for all writes
+  // up to and between snapshots. Committed writes are removed from `writes`,
+  // the ones left failed.
+  void commitWrites(std::vector<PendingWrite>& writes) noexcept;
+
+  // Write over storage file with IoBuf atomically
+  folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
+      std::unique_ptr<folly::IOBuf> ioBuf) noexcept;
 
-  // Wrapper function to save persistent object to disk immediately or later
-  void maybeSaveObjectToDisk() noexcept;
+  //
+  // Append-only log
+  //
 
-  // Function to save Persistent Object to local disk.
-  bool savePersistentObjectToDisk() noexcept;
+  // Path of the log segment with the given sequence number
+  std::string getSegmentFilePath(uint64_t seq) const;
 
-  // Write IoBuf ro local disk
-  folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
-      const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept;
+  // Sequence numbers of the log segments on disk, in ascending order
+  std::vector<uint64_t> listSegments() const noexcept;
+
+  // Append records to the active segment, creating one if needed, and sync
+  // them to disk
+  folly::Expected<folly::Unit, std::string> appendToLog(
+      std::unique_ptr<folly::IOBuf> records) noexcept;
+
+  // Close the active segment, the next append starts a new one
+  void sealSegment() noexcept;
+
+  // Seal the active segment and write a snapshot covering it on the
+  // background thread
+  void compactLog(thrift::StoreDatabase database) noexcept;
+
+  // Write a snapshot of `database` and remove the segments up to `lastSeq`
+  // which it covers
+  bool writeSnapshot(
+      thrift::StoreDatabase const& database, uint64_t lastSeq) noexcept;
 
   // Function to create a PersistentObject.
   PersistentObject toPersistentObject(
@@ -152,8 +234,8 @@ class PersistentStore : public OpenrEventBase {
   // Keeps track of number of writes of Database to disk
   std::atomic<std::uint64_t> numOfWritesToDisk_{0};
 
-  // Keeps track of number of writes of PersistentObject to disk
-  std::atomic<std::uint64_t> numOfNewWritesToDisk_{0};
+  // Keeps track of number of snapshots written by compaction
+  std::atomic<std::uint64_t> numOfCompactions_{0};
 
   // Location on disk where data will be synced up. A file will be created
   // if doesn't exists.
@@ -162,10 +244,9 @@ class PersistentStore : public OpenrEventBase {
   // Dryrun to avoid disk writes in UTs
   bool dryrun_{false};
 
-  // Timer for saving database to disk
-  std::unique_ptr<fbzmq::ZmqTimeout> saveDbTimer_;
+  // Backoff for retrying failed commits, only used by the log writer
   std::unique_ptr<ExponentialBackoff<std::chrono::milliseconds>>
-      saveDbTimerBackoff_;
+      saveDbBackoff_;
 
   // Database to store config data. It is synced up on a persistent storage
   // layer (disk) in a file.
@@ -174,8 +255,28 @@ class PersistentStore : public OpenrEventBase {
   // Serializer for encoding/decoding of thrift objects
   apache::thrift::CompactSerializer serializer_;
 
-  // Define a persistent object
-  std::vector<PersistentObject> pObjects_;
+  // Writes waiting for the log writer, in the order they were applied
+  std::mutex pendingWritesLock_;
+  std::condition_variable pendingWritesCv_;
+  std::vector<PendingWrite> pendingWrites_;
+  bool stopLogWriter_{false};
+  std::thread logWriterThread_;
+
+  // Active log segment, -1 if none is open. Owned by the log writer.
+  int segmentFd_{-1};
+  uint64_t segmentSeq_{0};
+  uint64_t segmentBytes_{0};
+
+  // Bytes appended to the log since the last compaction
+  std::atomic<uint64_t> logBytes_{0};
+
+  // Size of the last snapshot written
+  std::atomic<uint64_t> snapshotBytes_{0};
+
+  // Compaction runs on a single background thread, one at a time. Set once a
+  // snapshot is queued with a write.
+  std::atomic<bool> compactionInProgress_{false};
+  std::unique_ptr<folly::CPUThreadPoolExecutor> compactionExecutor_;
 };
 
 } // namespace openr
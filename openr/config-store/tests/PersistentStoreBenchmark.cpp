@@ -5,10 +5,24 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include <folly/Benchmark.h>
+#include <folly/FileUtil.h>
+#include <folly/IPAddress.h>
 #include <folly/Random.h>
 #include <folly/init/Init.h>
+#include <openr/common/LatencyHistogram.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
 #include <openr/config-store/PersistentStoreWrapper.h>
+#include <openr/tests/BenchmarkUtils.h>
 
 namespace {
 // kIterations <= n: change this to 10 singce n starts from 10,
@@ -159,6 +173,291 @@ BM_PersistentStoreCreateDestroy(uint32_t iters, size_t numOfStringKeys) {
   }
 }
 
+//
+// Durability and contention scenarios. Latencies are recorded in
+// microseconds and reported as percentiles.
+//
+
+// Microseconds taken by fn
+template <typename Fn>
+int64_t
+measureUs(Fn&& fn) {
+  const auto startTime = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+void
+insertLatencyCounters(
+    folly::UserCounters& counters,
+    const std::string& name,
+    const std::vector<int64_t>& latenciesUs) {
+  LatencyHistogram histogram;
+  for (auto latencyUs : latenciesUs) {
+    histogram.addValue(latencyUs);
+  }
+  counters[name + "_p50_us"] = histogram.getPercentile(0.5);
+  counters[name + "_p99_us"] = histogram.getPercentile(0.99);
+  counters[name + "_p999_us"] = histogram.getPercentile(0.999);
+}
+
+// Remove storage file and log segments of a store
+void
+removeStoreFiles(const std::string& filePath) {
+  ::unlink(filePath.c_str());
+  for (int seq = 1; seq <= 1000; ++seq) {
+    ::unlink(folly::sformat("{}.log.{}", filePath, seq).c_str());
+  }
+}
+
+// Serialized PrefixDatabase as persisted by PrefixManager
+std::string
+createPrefixDbBlob(uint32_t numOfPrefixes) {
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = "node-1";
+  for (uint32_t i = 0; i < numOfPrefixes; ++i) {
+    prefixDb.prefixEntries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{:x}:{:x}::/64", i >> 16, i & 0xffff)),
+        thrift::PrefixType::BREEZE));
+  }
+  apache::thrift::CompactSerializer serializer;
+  std::string blob;
+  serializer.serialize(prefixDb, &blob);
+  return blob;
+}
+
+/**
+ * Mixed workload, each client loads a random key or, one time out of five,
+ * stores one. Loads are served from memory while stores wait for the disk.
+ */
+void
+BM_PersistentStoreMixed(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfClients) {
+  auto suspender = folly::BenchmarkSuspender();
+  const uint32_t kNumOfKeys{1000};
+  const uint32_t kOpsPerClient{100};
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid));
+  PersistentStoreWrapper store(context, tid);
+  store.run();
+  const auto stringKeys = constructRandomVector(kNumOfKeys);
+  writeKeyValueToStore(stringKeys, store, 1);
+
+  std::vector<std::vector<int64_t>> loadLatencies(numOfClients);
+  std::vector<std::vector<int64_t>> storeLatencies(numOfClients);
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::thread> clients;
+    for (uint32_t client = 0; client < numOfClients; ++client) {
+      clients.emplace_back([&, client]() {
+        for (uint32_t op = 0; op < kOpsPerClient; ++op) {
+          const auto& key = stringKeys[folly::Random::rand32(kNumOfKeys)];
+          if (folly::Random::oneIn(5)) {
+            storeLatencies[client].emplace_back(measureUs([&]() {
+              store->store(key, folly::sformat("val-{}", op)).get();
+            }));
+          } else {
+            loadLatencies[client].emplace_back(
+                measureUs([&]() { store->load(key).get(); }));
+          }
+        }
+      });
+    }
+    for (auto& client : clients) {
+      client.join();
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  std::vector<int64_t> allLoadLatencies;
+  std::vector<int64_t> allStoreLatencies;
+  for (uint32_t client = 0; client < numOfClients; ++client) {
+    allLoadLatencies.insert(
+        allLoadLatencies.end(),
+        loadLatencies[client].begin(),
+        loadLatencies[client].end());
+    allStoreLatencies.insert(
+        allStoreLatencies.end(),
+        storeLatencies[client].begin(),
+        storeLatencies[client].end());
+  }
+  insertLatencyCounters(counters, "load", allLoadLatencies);
+  insertLatencyCounters(counters, "store", allStoreLatencies);
+}
+
+/**
+ * Store PrefixDatabase sized values, of the given number of prefixes, under
+ * a few keys
+ */
+void
+BM_PersistentStoreLargeValue(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid));
+  PersistentStoreWrapper store(context, tid);
+  store.run();
+  const auto blob = createPrefixDbBlob(numOfPrefixes);
+  counters["value_bytes"] = blob.size();
+
+  std::vector<int64_t> storeLatencies;
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    storeLatencies.emplace_back(measureUs([&]() {
+      store->store(folly::sformat("prefix-db-{}", i % 4), blob).get();
+    }));
+  }
+  suspender.rehire(); // Stop measuring time again
+  insertLatencyCounters(counters, "store", storeLatencies);
+}
+
+/**
+ * Startup of a store whose log of the given size wasn't compacted, as found
+ * after a crash. Keys are overwritten multiple times within the log.
+ */
+void
+BM_PersistentStoreStartupLoad(
+    folly::UserCounters& counters, uint32_t iters, uint32_t logMBytes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const uint32_t kNumOfKeys{1000};
+  const size_t kSegmentBytes{4 * 1024 * 1024};
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const auto filePath = folly::sformat("/tmp/aq_persistent_store_test_{}", tid);
+  const std::string value(16 * 1024, 'v');
+
+  // Encode log segments once, written again before every load as the store
+  // compacts them on destruction
+  std::vector<std::string> segments;
+  std::string segment;
+  for (size_t bytes = 0, i = 0; bytes < logMBytes * 1024 * 1024; ++i) {
+    PersistentObject pObject;
+    pObject.type = ActionType::ADD;
+    pObject.key = folly::sformat("key-{}", i % kNumOfKeys);
+    pObject.data = value;
+    auto record = PersistentStore::encodeLogRecord(pObject);
+    CHECK(record.hasValue());
+    if (segment.empty()) {
+      segment = kLogSegmentMarker.str();
+    }
+    segment.append((*record)->moveToFbString().toStdString());
+    if (segment.size() >= kSegmentBytes) {
+      bytes += segment.size();
+      segments.emplace_back(std::move(segment));
+      segment.clear();
+    }
+  }
+
+  for (uint32_t i = 0; i < iters; i++) {
+    removeStoreFiles(filePath);
+    for (size_t seq = 0; seq < segments.size(); ++seq) {
+      const auto path = folly::sformat("{}.log.{}", filePath, seq + 1);
+      CHECK(folly::writeFile(segments[seq], path.c_str()));
+    }
+
+    suspender.dismiss(); // Start measuring benchmark time
+    auto store = std::make_unique<PersistentStore>(
+        folly::sformat("1-{}", tid), filePath, context);
+    suspender.rehire(); // Stop measuring time again
+
+    store.reset();
+  }
+  removeStoreFiles(filePath);
+  counters["log_segments"] = segments.size();
+}
+
+/**
+ * Overwrite values until the log outgrew a database of the given number of
+ * MBs and got compacted. Time per iteration covers writing the log and the
+ * compaction, store latencies show the impact of compactions in the
+ * background on writes.
+ */
+void
+BM_PersistentStoreCompaction(
+    folly::UserCounters& counters, uint32_t iters, uint32_t databaseMBytes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const size_t kValueBytes{64 * 1024};
+  const uint32_t numOfKeys = databaseMBytes * 1024 * 1024 / kValueBytes;
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid));
+  PersistentStoreWrapper store(context, tid);
+  store.run();
+  const std::string value(kValueBytes, 'v');
+
+  // Initial database, its snapshot sets the log size compacted at
+  for (uint32_t key = 0; key < numOfKeys; ++key) {
+    store->store(folly::sformat("key-{}", key), value).get();
+  }
+
+  std::vector<int64_t> storeLatencies;
+  uint64_t numOfWrites{0};
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto numOfCompactions = store->getNumOfCompactions();
+    while (store->getNumOfCompactions() == numOfCompactions) {
+      storeLatencies.emplace_back(measureUs([&]() {
+        store->store(folly::sformat("key-{}", numOfWrites % numOfKeys), value)
+            .get();
+      }));
+      ++numOfWrites;
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+  insertLatencyCounters(counters, "store", storeLatencies);
+  counters["writes_per_compaction"] = iters ? numOfWrites / iters : 0;
+}
+
+/**
+ * Latency until stores of small values are durable, with the given number
+ * of concurrent clients. Stores of all clients share syncs.
+ */
+void
+BM_PersistentStoreSyncLatency(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfClients) {
+  auto suspender = folly::BenchmarkSuspender();
+  const uint32_t kStoresPerClient{100};
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid));
+  PersistentStoreWrapper store(context, tid);
+  store.run();
+
+  std::vector<std::vector<int64_t>> storeLatencies(numOfClients);
+  const auto numOfSyncs = store->getNumOfDbWritesToDisk();
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::thread> clients;
+    for (uint32_t client = 0; client < numOfClients; ++client) {
+      clients.emplace_back([&, client]() {
+        const auto key = folly::sformat("client-{}", client);
+        for (uint32_t op = 0; op < kStoresPerClient; ++op) {
+          storeLatencies[client].emplace_back(measureUs([&]() {
+            store->store(key, folly::sformat("val-{}", op)).get();
+          }));
+        }
+      });
+    }
+    for (auto& client : clients) {
+      client.join();
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  std::vector<int64_t> allStoreLatencies;
+  for (auto const& latencies : storeLatencies) {
+    allStoreLatencies.insert(
+        allStoreLatencies.end(), latencies.begin(), latencies.end());
+  }
+  insertLatencyCounters(counters, "sync", allStoreLatencies);
+  const auto syncs = store->getNumOfDbWritesToDisk() - numOfSyncs;
+  counters["stores_per_sync"] = syncs ? allStoreLatencies.size() / syncs : 0;
+}
+
 // The parameter is the number of keys already written to store
 // before benchmarking the time.
 BENCHMARK_PARAM(BM_PersistentStoreWrite, 10);
@@ -176,6 +475,29 @@ BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 100);
 BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 1000);
 BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 10000);
 
+// The parameter is the number of concurrent clients
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreMixed, counters, 1);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreMixed, counters, 4);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreMixed, counters, 16);
+
+// The parameter is the number of prefixes in the PrefixDatabase
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreLargeValue, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreLargeValue, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreLargeValue, counters, 10000);
+
+// The parameter is the size of the log in MB
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreStartupLoad, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreStartupLoad, counters, 100);
+
+// The parameter is the size of the database in MB
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreCompaction, counters, 4);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreCompaction, counters, 32);
+
+// The parameter is the number of concurrent clients
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreSyncLatency, counters, 1);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreSyncLatency, counters, 4);
+BENCHMARK_COUNTERS_PARAM(BM_PersistentStoreSyncLatency, counters, 16);
+
 } // namespace openr
 
 int
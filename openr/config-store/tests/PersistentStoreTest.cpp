@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <unistd.h>
+
 #include <thread>
 #include <utility>
 
@@ -16,10 +18,20 @@
 #include <gtest/gtest.h>
 
 #include <openr/config-store/PersistentStore.h>
+#include <openr/common/Util.h>
 #include <openr/config-store/PersistentStoreWrapper.h>
 
 namespace openr {
 
+// Remove storage file and log segments left behind by earlier runs
+void
+removeStoreFiles(const std::string& filePath) {
+  ::unlink(filePath.c_str());
+  for (int seq = 1; seq <= 100; ++seq) {
+    ::unlink(folly::sformat("{}.log.{}", filePath, seq).c_str());
+  }
+}
+
 // Load database from disk
 thrift::StoreDatabase
 loadDatabaseFromDisk(const std::string& filePath) {
@@ -218,6 +230,127 @@ TEST(PersistentStoreTest, BulkStoreLoad) {
   }
 }
 
+TEST(PersistentStoreTest, LogReplayTest) {
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const auto filePath =
+      folly::sformat("/tmp/aq_persistent_store_test_{}", tid + 1);
+  const auto crashFilePath = filePath + "_crash";
+  removeStoreFiles(filePath);
+  removeStoreFiles(crashFilePath);
+
+  {
+    // Without backoff every update gets appended to the log right away
+    PersistentStoreWrapper store(context, tid + 1, 0ms, 0ms);
+    store.run();
+    store->store("key1", "val1").get();
+    store->store("key2", "val2").get();
+    store->erase("key1").get();
+    store->store("key3", "val3").get();
+
+    // Copy the log as it would be found after a crash, with a torn record
+    // at its end
+    std::string segment;
+    ASSERT_TRUE(folly::readFile((filePath + ".log.1").c_str(), segment));
+    segment.append(std::string("\x00\x00\x00\x20torn", 8));
+    ASSERT_TRUE(folly::writeFile(segment, (crashFilePath + ".log.1").c_str()));
+  }
+
+  {
+    PersistentStore crashStore("node1", crashFilePath, context);
+    std::thread storeThread([&crashStore]() { crashStore.run(); });
+    crashStore.waitUntilRunning();
+
+    // Replayed all complete records
+    EXPECT_FALSE(crashStore.load("key1").get());
+    EXPECT_EQ("val2", crashStore.load("key2").get().value());
+    EXPECT_EQ("val3", crashStore.load("key3").get().value());
+
+    crashStore.stop();
+    storeThread.join();
+  }
+
+  // Clean shutdown replaced the log with a snapshot
+  EXPECT_FALSE(fileExists(crashFilePath + ".log.1"));
+  auto database = loadDatabaseFromDisk(crashFilePath);
+  EXPECT_EQ(2, database.keyVals.size());
+  EXPECT_EQ("val2", database.keyVals.at("key2"));
+  EXPECT_EQ("val3", database.keyVals.at("key3"));
+}
+
+TEST(PersistentStoreTest, CompactionTest) {
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid + 2));
+
+  PersistentStoreWrapper store(context, tid + 2, 0ms, 0ms);
+  store.run();
+
+  // Overwriting a few keys grows the log way beyond the database
+  const std::string value(64 * 1024, 'v');
+  for (int i = 0; i < 40; ++i) {
+    store->store(folly::sformat("key-{}", i % 4), value).get();
+  }
+
+  // Compaction runs in the background
+  for (int i = 0; i < 500 and store->getNumOfCompactions() == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_LE(1, store->getNumOfCompactions());
+  EXPECT_EQ(4, loadDatabaseFromDisk(store.filePath).keyVals.size());
+
+  // Updates after the compaction are still there after restart
+  store->store("key-0", "val").get();
+  store.stop();
+  PersistentStoreWrapper restartedStore(context, tid + 2);
+  restartedStore.run();
+  EXPECT_EQ("val", restartedStore->load("key-0").get().value());
+  EXPECT_EQ(value, restartedStore->load("key-3").get().value());
+}
+
+TEST(PersistentStoreTest, GroupCommitTest) {
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  removeStoreFiles(folly::sformat("/tmp/aq_persistent_store_test_{}", tid + 3));
+
+  const int numWrites{200};
+  {
+    PersistentStoreWrapper store(context, tid + 3, 0ms, 0ms);
+    store.run();
+
+    // Issue all writes without waiting for them to be durable
+    std::vector<folly::SemiFuture<folly::Unit>> futures;
+    for (int i = 0; i < numWrites; ++i) {
+      futures.emplace_back(store->store(
+          folly::sformat("key-{}", i), folly::sformat("val-{}", i)));
+    }
+
+    // Reads see the writes regardless of them being durable
+    EXPECT_EQ(
+        folly::sformat("val-{}", numWrites - 1),
+        store->load(folly::sformat("key-{}", numWrites - 1)).get().value());
+
+    // Writes queued during a commit share the next one, how many depends on
+    // the time a sync takes
+    for (auto& future : folly::collectAllSemiFuture(futures).get()) {
+      EXPECT_FALSE(future.hasException());
+    }
+    EXPECT_GE(numWrites, store->getNumOfDbWritesToDisk());
+    EXPECT_LE(1, store->getNumOfDbWritesToDisk());
+
+    // Durable before shutdown, i.e. in the log
+    EXPECT_TRUE(fileExists(store.filePath + ".log.1"));
+  }
+
+  PersistentStoreWrapper restartedStore(context, tid + 3);
+  restartedStore.run();
+  for (int i = 0; i < numWrites; ++i) {
+    EXPECT_EQ(
+        folly::sformat("val-{}", i),
+        restartedStore->load(folly::sformat("key-{}", i)).get().value());
+  }
+}
+
 } // namespace openr
 
 int
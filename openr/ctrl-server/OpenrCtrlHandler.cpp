@@ -7,14 +7,16 @@
 
 #include <openr/ctrl-server/OpenrCtrlHandler.h>
 
-#include <re2/re2.h>
 
 #include <folly/ExceptionString.h>
+#include <folly/String.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ssl/OpenSSLUtils.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/CpuProfiler.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/decision/Decision.h>
@@ -26,6 +28,48 @@
 
 namespace openr {
 
+namespace {
+
+// Value as kept in the adj key index, without the value itself but its hash
+thrift::Value
+toAdjKeyIndexEntry(thrift::Value const& value) {
+  thrift::Value entry;
+  entry.version = value.version;
+  entry.originatorId = value.originatorId;
+  entry.ttl = value.ttl;
+  entry.ttlVersion = value.ttlVersion;
+  entry.hash = value.hash.hasValue()
+      ? value.hash
+      : generateHash(value.version, value.originatorId, value.value);
+  return entry;
+}
+
+// Key-vals and expired keys of the publication matching the filters. Expired
+// keys only match by key prefix as their values are gone. None if nothing
+// matched.
+folly::Optional<thrift::Publication>
+filterPublication(
+    thrift::Publication const& publication, KvStoreFilters const& filters) {
+  thrift::Publication filtered;
+  filtered.area = publication.area;
+  for (auto const& kv : publication.keyVals) {
+    if (filters.keyMatch(kv.first, kv.second)) {
+      filtered.keyVals.emplace(kv);
+    }
+  }
+  for (auto const& key : publication.expiredKeys) {
+    if (filters.keyMatch(key, thrift::Value())) {
+      filtered.expiredKeys.emplace_back(key);
+    }
+  }
+  if (filtered.keyVals.empty() and filtered.expiredKeys.empty()) {
+    return folly::none;
+  }
+  return filtered;
+}
+
+} // namespace
+
 OpenrCtrlHandler::OpenrCtrlHandler(
     const std::string& nodeName,
     const std::unordered_set<std::string>& acceptablePeerCommonNames,
@@ -38,7 +82,8 @@ OpenrCtrlHandler::OpenrCtrlHandler(
     MonitorSubmitUrl const& monitorSubmitUrl,
     KvStoreLocalPubUrl const& kvStoreLocalPubUrl,
     fbzmq::ZmqEventLoop& evl,
-    fbzmq::Context& context)
+    fbzmq::Context& context,
+    RuntimeKnobs* runtimeKnobs)
     : facebook::fb303::FacebookBase2("openr"),
       nodeName_(nodeName),
       acceptablePeerCommonNames_(acceptablePeerCommonNames),
@@ -48,12 +93,26 @@ OpenrCtrlHandler::OpenrCtrlHandler(
       linkMonitor_(linkMonitor),
       configStore_(configStore),
       prefixManager_(prefixManager),
+      runtimeKnobs_(runtimeKnobs),
       evl_(evl),
       kvStoreSubSock_(context) {
   // Create monitor client
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(context, monitorSubmitUrl);
 
+  counterRegistry_.addSource([this](std::map<std::string, int64_t>& counters) {
+    FacebookBase2::getCounters(counters);
+  });
+  counterRegistry_.addSource([this](std::map<std::string, int64_t>& counters) {
+    std::lock_guard<std::mutex> lock(zmqMonitorClientLock_);
+    for (auto const& kv : zmqMonitorClient_->dumpCounters()) {
+      counters.emplace(kv.first, static_cast<int64_t>(kv.second.value));
+    }
+  });
+  counterRegistry_.addSource([this](std::map<std::string, int64_t>& counters) {
+    getCtrlCounters(counters);
+  });
+
   // Connect to KvStore
   const auto kvStoreSub =
       kvStoreSubSock_.connect(fbzmq::SocketUrl{kvStoreLocalPubUrl});
@@ -70,6 +129,20 @@ OpenrCtrlHandler::OpenrCtrlHandler(
                << kvStoreSubOpt.error();
   }
 
+  // Seed index of adj keys, publications from now on are queued on the
+  // subscription and keep it up to date
+  if (kvStore_) {
+    thrift::KeyDumpParams params;
+    params.prefix = Constants::kAdjDbMarker;
+    try {
+      auto adjPub = kvStore_->dumpKvStoreKeys(std::move(params)).get();
+      updateAdjKeyIndex(*adjPub);
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "Failed to dump adj keys from KvStore. Exception: "
+                 << folly::exceptionStr(ex);
+    }
+  }
+
   evl_.runInEventLoop([this]() noexcept {
     evl_.addSocket(
         fbzmq::RawZmqSocketPtr{*kvStoreSubSock_},
@@ -85,32 +158,9 @@ OpenrCtrlHandler::OpenrCtrlHandler(
             return;
           }
 
-          SYNCHRONIZED(kvStorePublishers_) {
-            for (auto& kv : kvStorePublishers_) {
-              kv.second.next(maybePublication.value());
-            }
-          }
-
-          bool isAdjChanged = false;
-          // check if any of KeyVal has 'adj' update
-          for (auto& kv : maybePublication.value().keyVals) {
-            auto& key = kv.first;
-            auto& val = kv.second;
-            // check if we have any value update.
-            // Ttl refreshing won't update any value.
-            if (!val.value.hasValue()) {
-              continue;
-            }
-
-            // "adj:*" key has changed. Update local collection
-            if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
-              VLOG(3) << "Adj key: " << key << " change received";
-              isAdjChanged = true;
-              break;
-            }
-          }
+          publishToKvStoreSubscribers(maybePublication.value());
 
-          if (isAdjChanged) {
+          if (updateAdjKeyIndex(maybePublication.value())) {
             // thrift::Publication contains "adj:*" key change.
             // Clean ALL pending promises
             longPollReqs_.withWLock([&](auto& longPollReqs) {
@@ -122,27 +172,22 @@ OpenrCtrlHandler::OpenrCtrlHandler(
             });
           } else {
             longPollReqs_.withWLock([&](auto& longPollReqs) {
+              // Requests are ordered by arrival, only the expired ones at
+              // the front need to be visited
               auto now = getUnixTimeStampMs();
-              std::vector<int64_t> reqsToClean;
-              for (auto& kv : longPollReqs) {
-                auto& clientId = kv.first;
-                auto& req = kv.second;
-
+              while (not longPollReqs.empty()) {
+                auto& req = longPollReqs.begin()->second;
                 auto& p = req.first;
                 auto& timeStamp = req.second;
-                if (now - timeStamp >=
-                    Constants::kLongPollReqHoldTime.count()) {
-                  LOG(INFO) << "Elapsed time: " << now - timeStamp
-                            << " is over hold limit: "
-                            << Constants::kLongPollReqHoldTime.count();
-                  reqsToClean.emplace_back(clientId);
-                  p.setValue(false);
+                if (now - timeStamp < Constants::kLongPollReqHoldTime.count()) {
+                  break;
                 }
-              }
-
-              // cleanup expired requests since no ADJ change observed
-              for (auto& clientId : reqsToClean) {
-                longPollReqs.erase(clientId);
+                LOG(INFO) << "Elapsed time: " << now - timeStamp
+                          << " is over hold limit: "
+                          << Constants::kLongPollReqHoldTime.count();
+                // cleanup expired requests since no ADJ change observed
+                p.setValue(false);
+                longPollReqs.erase(longPollReqs.begin());
               }
             });
           }
@@ -164,7 +209,7 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
   // SYNCHRONIZED block
   SYNCHRONIZED(kvStorePublishers_) {
     for (auto& kv : kvStorePublishers_) {
-      publishers.emplace_back(std::move(kv.second));
+      publishers.emplace_back(std::move(kv.second.publisher));
     }
   }
   LOG(INFO) << "Terminating " << publishers.size()
@@ -177,6 +222,84 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
   longPollReqs_.withWLock([&](auto& longPollReqs) { longPollReqs.clear(); });
 }
 
+void
+OpenrCtrlHandler::publishToKvStoreSubscribers(
+    thrift::Publication const& publication) {
+  SYNCHRONIZED(kvStorePublishers_) {
+    // Filter once per distinct filter, the result is shared by all its
+    // subscribers
+    std::unordered_map<std::string, folly::Optional<thrift::Publication>>
+        filteredPublications;
+    for (auto& kv : kvStorePublishers_) {
+      auto& subscriber = kv.second;
+      if (not subscriber.filters) {
+        subscriber.publisher.next(publication);
+        numKvStoreStreamed_++;
+        continue;
+      }
+      auto it = filteredPublications.find(subscriber.filterKey);
+      if (it == filteredPublications.end()) {
+        it = filteredPublications
+                 .emplace(
+                     subscriber.filterKey,
+                     filterPublication(publication, *subscriber.filters))
+                 .first;
+      }
+      if (it->second.hasValue()) {
+        subscriber.publisher.next(it->second.value());
+        numKvStoreStreamed_++;
+      } else {
+        numKvStoreFiltered_++;
+      }
+    }
+  }
+}
+
+bool
+OpenrCtrlHandler::updateAdjKeyIndex(thrift::Publication const& publication) {
+  // Index covers the area clients' snapshots are compared against, changes
+  // in any area complete long polls
+  const bool isIndexedArea = not publication.area.hasValue() or
+      *publication.area == thrift::KvStore_constants::kDefaultArea();
+  bool isAdjChanged{false};
+  adjKeyIndex_.withWLock([&](auto& adjKeyIndex) {
+    for (auto const& kv : publication.keyVals) {
+      // Ttl refreshing won't update any value.
+      if (not kv.second.value.hasValue() or
+          kv.first.find(Constants::kAdjDbMarker.toString()) != 0) {
+        continue;
+      }
+      VLOG(3) << "Adj key: " << kv.first << " change received";
+      isAdjChanged = true;
+      if (not isIndexedArea) {
+        continue;
+      }
+      auto entry = toAdjKeyIndexEntry(kv.second);
+      auto it = adjKeyIndex.find(kv.first);
+      // Publications queued before the seeding dump may be older than it
+      if (it == adjKeyIndex.end()) {
+        adjKeyIndex.emplace(kv.first, std::move(entry));
+      } else if (KvStore::compareValues(entry, it->second) != -1) {
+        it->second = std::move(entry);
+      }
+    }
+    for (auto const& key : publication.expiredKeys) {
+      if (key.find(Constants::kAdjDbMarker.toString()) != 0) {
+        continue;
+      }
+      VLOG(3) << "Adj key: " << key << " expired";
+      isAdjChanged = true;
+      if (isIndexedArea) {
+        adjKeyIndex.erase(key);
+      }
+    }
+    if (isAdjChanged) {
+      adjKeyIndexVersion_++;
+    }
+  });
+  return isAdjChanged;
+}
+
 void
 OpenrCtrlHandler::authorizeConnection() {
   auto connContext = getConnectionContext()->getConnectionContext();
@@ -202,10 +325,13 @@ OpenrCtrlHandler::authorizeConnection() {
         "peer_address", connContext->getPeerAddress()->getAddressStr());
     sample.addString("peer_common_name", peerCommonName);
 
-    zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-        apache::thrift::FRAGILE,
-        Constants::kEventLogCategory.toString(),
-        {sample.toJson()}));
+    {
+      std::lock_guard<std::mutex> lock(zmqMonitorClientLock_);
+      zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
+          apache::thrift::FRAGILE,
+          Constants::kEventLogCategory.toString(),
+          {sample.toJson()}));
+    }
 
     LOG(INFO) << "Authorizing request with issues: " << sample.toJson();
     return;
@@ -226,7 +352,11 @@ folly::SemiFuture<std::unique_ptr<std::vector<fbzmq::thrift::EventLog>>>
 OpenrCtrlHandler::semifuture_getEventLogs() {
   folly::Promise<std::unique_ptr<std::vector<fbzmq::thrift::EventLog>>> p;
 
-  auto eventLogs = zmqMonitorClient_->getLastEventLogs();
+  folly::Optional<std::vector<fbzmq::thrift::EventLog>> eventLogs;
+  {
+    std::lock_guard<std::mutex> lock(zmqMonitorClientLock_);
+    eventLogs = zmqMonitorClient_->getLastEventLogs();
+  }
   if (eventLogs.hasValue()) {
     p.setValue(std::make_unique<std::vector<fbzmq::thrift::EventLog>>(
         eventLogs.value()));
@@ -240,54 +370,53 @@ OpenrCtrlHandler::semifuture_getEventLogs() {
 
 void
 OpenrCtrlHandler::getCounters(std::map<std::string, int64_t>& _return) {
-  FacebookBase2::getCounters(_return);
-  for (auto const& kv : zmqMonitorClient_->dumpCounters()) {
-    _return.emplace(kv.first, static_cast<int64_t>(kv.second.value));
+  _return = *counterRegistry_.getCounters(true /* refresh */);
+}
+
+void
+OpenrCtrlHandler::getCtrlCounters(std::map<std::string, int64_t>& counters) {
+  SYNCHRONIZED(kvStorePublishers_) {
+    std::unordered_set<std::string> filterKeys;
+    for (auto const& kv : kvStorePublishers_) {
+      filterKeys.emplace(kv.second.filterKey);
+    }
+    counters["ctrl.kvstore_subscribers"] = kvStorePublishers_.size();
+    counters["ctrl.kvstore_subscriber_filters"] = filterKeys.size();
   }
+  counters["ctrl.kvstore_publications_streamed"] = numKvStoreStreamed_;
+  counters["ctrl.kvstore_publications_filtered"] = numKvStoreFiltered_;
+  counters["ctrl.long_poll_pending"] = longPollReqs_->size();
+  counters["ctrl.long_poll_index_hits"] = longPollIndexHits_;
+  counters["ctrl.long_poll_index_misses"] = longPollIndexMisses_;
+  counters["ctrl.counter_cache_refreshes"] =
+      counterRegistry_.getNumRefreshes();
+  counters["ctrl.counter_regex_cache_hits"] =
+      counterRegistry_.getNumRegexCacheHits();
+  counters["ctrl.counter_regex_cache_misses"] =
+      counterRegistry_.getNumRegexCacheMisses();
 }
 
 void
 OpenrCtrlHandler::getRegexCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::string> regex) {
-  // Compile regex
-  re2::RE2 compiledRegex(*regex);
-  if (not compiledRegex.ok()) {
-    return;
-  }
-
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
-
-  // Filter counters
-  for (auto const& kv : counters) {
-    if (RE2::PartialMatch(kv.first, compiledRegex)) {
-      _return.emplace(kv);
-    }
-  }
+  _return = counterRegistry_.getRegexCounters(*regex);
 }
 
 void
 OpenrCtrlHandler::getSelectedCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::vector<std::string>> keys) {
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
-
-  // Filter counters
-  for (auto const& key : *keys) {
-    auto it = counters.find(key);
-    if (it != counters.end()) {
-      _return.emplace(*it);
-    }
-  }
+  _return = counterRegistry_.getSelectedCounters(*keys);
 }
 
 int64_t
 OpenrCtrlHandler::getCounter(std::unique_ptr<std::string> key) {
-  auto counter = zmqMonitorClient_->getCounter(*key);
+  folly::Optional<fbzmq::thrift::Counter> counter;
+  {
+    std::lock_guard<std::mutex> lock(zmqMonitorClientLock_);
+    counter = zmqMonitorClient_->getCounter(*key);
+  }
   if (counter.hasValue()) {
     return static_cast<int64_t>(counter->value);
   }
@@ -299,6 +428,61 @@ OpenrCtrlHandler::getMyNodeName(std::string& _return) {
   _return = std::string(nodeName_);
 }
 
+void
+OpenrCtrlHandler::startCpuProfile(
+    std::unique_ptr<thrift::CpuProfileParams> params) {
+  auto res = CpuProfiler::get().start(*params);
+  if (res.hasError()) {
+    throw thrift::OpenrError(res.error());
+  }
+}
+
+void
+OpenrCtrlHandler::stopCpuProfile(thrift::CpuProfile& _return) {
+  auto res = CpuProfiler::get().stop();
+  if (res.hasError()) {
+    throw thrift::OpenrError(res.error());
+  }
+  _return = std::move(res.value());
+}
+
+void
+OpenrCtrlHandler::getRuntimeKnobs(std::vector<thrift::RuntimeKnob>& _return) {
+  CHECK(runtimeKnobs_);
+  _return = runtimeKnobs_->getKnobs();
+}
+
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_setRuntimeKnob(
+    std::unique_ptr<std::string> name, int64_t value, bool persist) {
+  CHECK(runtimeKnobs_);
+  auto res = runtimeKnobs_->setKnob(*name, value, persist);
+  if (res.hasError()) {
+    return folly::makeSemiFuture<folly::Unit>(thrift::OpenrError(res.error()));
+  }
+  return storeRuntimeKnobs();
+}
+
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_resetRuntimeKnob(
+    std::unique_ptr<std::string> name) {
+  CHECK(runtimeKnobs_);
+  auto res = runtimeKnobs_->resetKnob(*name);
+  if (res.hasError()) {
+    return folly::makeSemiFuture<folly::Unit>(thrift::OpenrError(res.error()));
+  }
+  return storeRuntimeKnobs();
+}
+
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::storeRuntimeKnobs() {
+  // knobs set or reset may have been persisted, always rewrite them
+  CHECK(configStore_);
+  return configStore_->storeThriftObj(
+      Constants::kRuntimeKnobsConfigKey.toString(),
+      runtimeKnobs_->getPersistedValues());
+}
+
 void
 OpenrCtrlHandler::getOpenrVersion(thrift::OpenrVersions& _openrVersion) {
   _openrVersion.version = Constants::kOpenrVersion;
@@ -346,6 +530,20 @@ OpenrCtrlHandler::semifuture_syncPrefixesByType(
       .defer([](folly::Try<bool>&&) { return folly::Unit(); });
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::PrefixDeltaAck>>
+OpenrCtrlHandler::semifuture_applyPrefixDeltaChunk(
+    std::unique_ptr<thrift::PrefixDeltaChunk> chunk) {
+  CHECK(prefixManager_);
+  return prefixManager_->applyPrefixDeltaChunk(std::move(*chunk))
+      .defer([](folly::Try<thrift::PrefixDeltaAck>&& ack) {
+        if (ack.hasException()) {
+          throw thrift::OpenrError(ack.exception().what().toStdString());
+        }
+        return std::make_unique<thrift::PrefixDeltaAck>(
+            std::move(ack).value());
+      });
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 OpenrCtrlHandler::semifuture_getPrefixes() {
   CHECK(prefixManager_);
@@ -394,12 +592,57 @@ OpenrCtrlHandler::semifuture_getMplsRoutesFiltered(
   return fib_->getMplsRoutes(std::move(*labels));
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabasePage>>
+OpenrCtrlHandler::semifuture_getRouteDbPage(
+    int64_t version, int64_t offset, int32_t limit) {
+  CHECK(fib_);
+  if (offset < 0 or limit <= 0) {
+    return folly::makeSemiFuture<std::unique_ptr<thrift::RouteDatabasePage>>(
+        thrift::OpenrError(
+            folly::sformat("Invalid offset {} or limit {}", offset, limit)));
+  }
+  auto snapshot = version == 0 ? fib_->getRouteDbSnapshots().get()
+                               : fib_->getRouteDbSnapshots().get(version);
+  if (not snapshot) {
+    return folly::makeSemiFuture<std::unique_ptr<thrift::RouteDatabasePage>>(
+        thrift::OpenrError(folly::sformat(
+            "Route database version {} isn't retained anymore", version)));
+  }
+  return folly::makeSemiFuture(std::make_unique<thrift::RouteDatabasePage>(
+      snapshot->getPage(offset, limit)));
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseChanges>>
+OpenrCtrlHandler::semifuture_getRouteDbChangedSince(int64_t version) {
+  CHECK(fib_);
+  return folly::makeSemiFuture(std::make_unique<thrift::RouteDatabaseChanges>(
+      fib_->getRouteDbSnapshots().getChangesSince(version)));
+}
+
 folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>>
 OpenrCtrlHandler::semifuture_getPerfDb() {
   CHECK(fib_);
   return fib_->getPerfDb();
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::PerfHistograms>>
+OpenrCtrlHandler::semifuture_getPerfHistograms() {
+  CHECK(fib_);
+  return fib_->getPerfHistograms();
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+OpenrCtrlHandler::semifuture_getFibRouteTrace() {
+  CHECK(fib_);
+  return fib_->getRouteTrace();
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::ConvergenceTraceDatabase>>
+OpenrCtrlHandler::semifuture_getConvergenceTrace() {
+  CHECK(fib_);
+  return fib_->getConvergenceTrace();
+}
+
 //
 // Decision APIs
 //
@@ -407,6 +650,14 @@ folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDbComputed(
     std::unique_ptr<std::string> nodeName) {
   CHECK(decision_);
+  // Routes of this node are served from the ones last published to Fib
+  if (nodeName->empty() or *nodeName == nodeName_) {
+    auto snapshot = decision_->getRouteDbSnapshots().get();
+    if (snapshot->getVersion() > 0) {
+      return folly::makeSemiFuture(
+          std::make_unique<thrift::RouteDatabase>(snapshot->toRouteDatabase()));
+    }
+  }
   return decision_->getDecisionRouteDb(*nodeName);
 }
 
@@ -422,6 +673,26 @@ OpenrCtrlHandler::semifuture_getDecisionPrefixDbs() {
   return decision_->getDecisionPrefixDbs();
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDelta>>
+OpenrCtrlHandler::semifuture_getDecisionRouteDbWhatIf(
+    std::unique_ptr<thrift::WhatIfRequest> request) {
+  CHECK(decision_);
+  auto sf = decision_->getDecisionRouteDbWhatIf(std::move(*request));
+  return std::move(sf).defer(
+      [](folly::Try<std::unique_ptr<thrift::RouteDatabaseDelta>>&& delta) {
+        if (delta.hasException()) {
+          throw thrift::OpenrError(delta.exception().what().toStdString());
+        }
+        return std::move(delta).value();
+      });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+OpenrCtrlHandler::semifuture_getDecisionRouteTrace() {
+  CHECK(decision_);
+  return decision_->getDecisionRouteTrace();
+}
+
 //
 // KvStore APIs
 //
@@ -499,10 +770,7 @@ OpenrCtrlHandler::semifuture_longPollKvStoreAdj(
   auto timeStamp = getUnixTimeStampMs();
   auto requestId = pendingRequestId_++;
 
-  thrift::KeyDumpParams params;
-
   // build thrift::KeyVals with "adj:" key ONLY
-  // to ensure KvStore ONLY compare "adj:" key
   thrift::KeyVals adjKeyVals;
   for (auto& kv : *snapshot) {
     if (kv.first.find(Constants::kAdjDbMarker.toString()) == 0) {
@@ -510,39 +778,75 @@ OpenrCtrlHandler::semifuture_longPollKvStoreAdj(
     }
   }
 
-  // Only care about "adj:" key
-  params.prefix = Constants::kAdjDbMarker;
-  // Only dump difference between KvStore and client snapshot
-  params.keyValHashes = std::move(adjKeyVals);
-
-  // Explicitly do SYNC call to get HASH_DUMP from KvStore
-  std::unique_ptr<thrift::Publication> thriftPub{nullptr};
-  try {
-    thriftPub = semifuture_getKvStoreKeyValsFiltered(
-                    std::make_unique<thrift::KeyDumpParams>(params))
-                    .get();
-  } catch (std::exception const& ex) {
-    p.setException(thrift::OpenrError(ex.what()));
-    return sf;
-  }
+  // Compare against the index of adj keys, pending requests registered
+  // after it got updated again complete right away
+  bool isConsistent{true};
+  int64_t indexVersion{0};
+  adjKeyIndex_.withRLock([&](auto const& adjKeyIndex) {
+    indexVersion = adjKeyIndexVersion_;
+    if (adjKeyIndex.size() != adjKeyVals.size()) {
+      isConsistent = false;
+      return;
+    }
+    for (auto const& kv : adjKeyVals) {
+      auto it = adjKeyIndex.find(kv.first);
+      if (it == adjKeyIndex.end() or
+          KvStore::compareValues(toAdjKeyIndexEntry(kv.second), it->second) !=
+              0) {
+        isConsistent = false;
+        return;
+      }
+    }
+  });
 
-  if (thriftPub->keyVals.size() > 0) {
-    VLOG(3) << "AdjKey has been added/modified. Notify immediately";
-    p.setValue(true);
-  } else if (
-      thriftPub->tobeUpdatedKeys.hasValue() &&
-      thriftPub->tobeUpdatedKeys.value().size() > 0) {
-    VLOG(3) << "AdjKey has been deleted/expired. Notify immediately";
-    p.setValue(true);
+  // Index may lag behind KvStore by publications not processed yet, confirm
+  // differences with KvStore itself
+  if (not isConsistent) {
+    longPollIndexMisses_++;
+    thrift::KeyDumpParams params;
+    // Only care about "adj:" key
+    params.prefix = Constants::kAdjDbMarker;
+    // Only dump difference between KvStore and client snapshot
+    params.keyValHashes = std::move(adjKeyVals);
+
+    // Explicitly do SYNC call to get HASH_DUMP from KvStore
+    std::unique_ptr<thrift::Publication> thriftPub{nullptr};
+    try {
+      thriftPub = semifuture_getKvStoreKeyValsFiltered(
+                      std::make_unique<thrift::KeyDumpParams>(params))
+                      .get();
+    } catch (std::exception const& ex) {
+      p.setException(thrift::OpenrError(ex.what()));
+      return sf;
+    }
+
+    if (thriftPub->keyVals.size() > 0) {
+      VLOG(3) << "AdjKey has been added/modified. Notify immediately";
+      p.setValue(true);
+      return sf;
+    } else if (
+        thriftPub->tobeUpdatedKeys.hasValue() &&
+        thriftPub->tobeUpdatedKeys.value().size() > 0) {
+      VLOG(3) << "AdjKey has been deleted/expired. Notify immediately";
+      p.setValue(true);
+      return sf;
+    }
   } else {
-    // Client provided data is consistent with KvStore.
-    // Store req for future processing when there is publication
-    // from KvStore.
-    VLOG(3) << "No adj change detected. Store req as pending request";
-    longPollReqs_.withWLock([&](auto& longPollReq) {
-      longPollReq.emplace(requestId, std::make_pair(std::move(p), timeStamp));
-    });
+    longPollIndexHits_++;
   }
+
+  // Client provided data is consistent with KvStore.
+  // Store req for future processing when there is publication
+  // from KvStore.
+  longPollReqs_.withWLock([&](auto& longPollReq) {
+    if (adjKeyIndexVersion_ != indexVersion) {
+      VLOG(3) << "Adj change received meanwhile. Notify immediately";
+      p.setValue(true);
+      return;
+    }
+    VLOG(3) << "No adj change detected. Store req as pending request";
+    longPollReq.emplace(requestId, std::make_pair(std::move(p), timeStamp));
+  });
   return sf;
 }
 
@@ -571,6 +875,13 @@ OpenrCtrlHandler::semifuture_getSpanningTreeInfos(
   return kvStore_->getSpanningTreeInfos(std::move(*area));
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::KvStoreChurnStats>>
+OpenrCtrlHandler::semifuture_getKvStoreChurnStats(
+    std::unique_ptr<std::string> area) {
+  CHECK(kvStore_);
+  return kvStore_->getKvStoreChurnStats(std::move(*area));
+}
+
 folly::SemiFuture<folly::Unit>
 OpenrCtrlHandler::semifuture_addUpdateKvStorePeers(
     std::unique_ptr<thrift::PeersMap> peers,
@@ -608,6 +919,20 @@ OpenrCtrlHandler::semifuture_getKvStorePeersArea(
 
 apache::thrift::ServerStream<thrift::Publication>
 OpenrCtrlHandler::subscribeKvStore() {
+  return subscribeKvStoreFilter(std::make_unique<thrift::KeyDumpParams>());
+}
+
+folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+    thrift::Publication,
+    thrift::Publication>>
+OpenrCtrlHandler::semifuture_subscribeAndGetKvStore() {
+  return semifuture_subscribeAndGetKvStoreFiltered(
+      std::make_unique<thrift::KeyDumpParams>());
+}
+
+apache::thrift::ServerStream<thrift::Publication>
+OpenrCtrlHandler::subscribeKvStoreFilter(
+    std::unique_ptr<thrift::KeyDumpParams> filter) {
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
@@ -625,23 +950,66 @@ OpenrCtrlHandler::subscribeKvStore() {
             }
           });
 
+  KvStoreSubscriber subscriber{std::move(streamAndPublisher.second), "", {}};
+  if (not filter->prefix.empty() or not filter->originatorIds.empty()) {
+    std::vector<std::string> keyPrefixList;
+    folly::split(",", filter->prefix, keyPrefixList, true);
+    subscriber.filterKey = folly::sformat(
+        "{}|{}", filter->prefix, folly::join(",", filter->originatorIds));
+    subscriber.filters = std::make_shared<const KvStoreFilters>(
+        keyPrefixList, filter->originatorIds);
+  }
+
   SYNCHRONIZED(kvStorePublishers_) {
     assert(kvStorePublishers_.count(clientToken) == 0);
-    LOG(INFO) << "KvStore snoop stream-" << clientToken << " started.";
-    kvStorePublishers_.emplace(
-        clientToken, std::move(streamAndPublisher.second));
+    LOG(INFO) << "KvStore snoop stream-" << clientToken << " started with "
+              << (subscriber.filters ? subscriber.filterKey : "no filter");
+    kvStorePublishers_.emplace(clientToken, std::move(subscriber));
   }
   return std::move(streamAndPublisher.first);
 }
 
+apache::thrift::ServerStream<thrift::RouteDatabase>
+OpenrCtrlHandler::getDecisionRouteDbs(
+    std::unique_ptr<std::vector<std::string>> nodeNames) {
+  CHECK(decision_);
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<thrift::RouteDatabase>::createPublisher(
+          []() { VLOG(2) << "Decision route databases stream ended."; });
+  auto publisher = std::make_shared<
+      apache::thrift::ServerStreamPublisher<thrift::RouteDatabase>>(
+      std::move(streamAndPublisher.second));
+
+  decision_
+      ->getDecisionRouteDbs(
+          std::move(*nodeNames),
+          [publisher](thrift::RouteDatabase&& routeDb) {
+            publisher->next(std::move(routeDb));
+          })
+      .via(&folly::InlineExecutor::instance())
+      .thenTry([publisher](folly::Try<folly::Unit>&& result) {
+        if (result.hasException()) {
+          std::move(*publisher).complete(
+              folly::make_exception_wrapper<thrift::OpenrError>(
+                  result.exception().what().toStdString()));
+        } else {
+          std::move(*publisher).complete();
+        }
+      });
+  return std::move(streamAndPublisher.first);
+}
+
 folly::SemiFuture<apache::thrift::ResponseAndServerStream<
     thrift::Publication,
     thrift::Publication>>
-OpenrCtrlHandler::semifuture_subscribeAndGetKvStore() {
-  return semifuture_getKvStoreKeyValsFiltered(
-             std::make_unique<thrift::KeyDumpParams>())
+OpenrCtrlHandler::semifuture_subscribeAndGetKvStoreFiltered(
+    std::unique_ptr<thrift::KeyDumpParams> filter) {
+  // Subscribe before taking the snapshot so no update is missed
+  auto stream = subscribeKvStoreFilter(
+      std::make_unique<thrift::KeyDumpParams>(*filter));
+  return semifuture_getKvStoreKeyValsFiltered(std::move(filter))
       .defer(
-          [stream = subscribeKvStore()](
+          [stream = std::move(stream)](
               folly::Try<std::unique_ptr<thrift::Publication>>&& pub) mutable {
             pub.throwIfFailed();
             return apache::thrift::ResponseAndServerStream<
@@ -7,9 +7,13 @@
 
 #pragma once
 
+#include <mutex>
+
 #include <common/fb303/cpp/FacebookBase2.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <openr/common/CounterRegistry.h>
+#include <openr/common/RuntimeKnobs.h>
 #include <openr/common/Types.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/decision/Decision.h>
@@ -39,7 +43,8 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       MonitorSubmitUrl const& monitorSubmitUrl,
       KvStoreLocalPubUrl const& kvStoreLocalPubUrl,
       fbzmq::ZmqEventLoop& evl,
-      fbzmq::Context& context);
+      fbzmq::Context& context,
+      RuntimeKnobs* runtimeKnobs = nullptr);
 
   ~OpenrCtrlHandler() override;
 
@@ -69,6 +74,27 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<std::vector<fbzmq::thrift::EventLog>>>
   semifuture_getEventLogs() override;
 
+  //
+  // Profiling APIs
+  //
+
+  void startCpuProfile(
+      std::unique_ptr<thrift::CpuProfileParams> params) override;
+
+  void stopCpuProfile(thrift::CpuProfile& _return) override;
+
+  //
+  // Runtime knobs APIs
+  //
+
+  void getRuntimeKnobs(std::vector<thrift::RuntimeKnob>& _return) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_setRuntimeKnob(
+      std::unique_ptr<std::string> name, int64_t value, bool persist) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_resetRuntimeKnob(
+      std::unique_ptr<std::string> name) override;
+
   //
   // PrefixManager APIs
   //
@@ -86,6 +112,10 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       thrift::PrefixType prefixType,
       std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::PrefixDeltaAck>>
+  semifuture_applyPrefixDeltaChunk(
+      std::unique_ptr<thrift::PrefixDeltaChunk> chunk) override;
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   semifuture_getPrefixes() override;
 
@@ -113,6 +143,13 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<std::vector<openr::thrift::MplsRoute>>>
   semifuture_getMplsRoutes() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabasePage>>
+  semifuture_getRouteDbPage(
+      int64_t version, int64_t offset, int32_t limit) override;
+
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseChanges>>
+  semifuture_getRouteDbChangedSince(int64_t version) override;
+
   //
   // Performance stats APIs
   //
@@ -120,6 +157,15 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>>
   semifuture_getPerfDb() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::PerfHistograms>>
+  semifuture_getPerfHistograms() override;
+
+  folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+  semifuture_getFibRouteTrace() override;
+
+  folly::SemiFuture<std::unique_ptr<thrift::ConvergenceTraceDatabase>>
+  semifuture_getConvergenceTrace() override;
+
   //
   // Decision APIs
   //
@@ -130,6 +176,13 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
   semifuture_getDecisionPrefixDbs() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDelta>>
+  semifuture_getDecisionRouteDbWhatIf(
+      std::unique_ptr<thrift::WhatIfRequest> request) override;
+
+  folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+  semifuture_getDecisionRouteTrace() override;
+
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
   semifuture_getRouteDbComputed(std::unique_ptr<std::string> nodeName) override;
 
@@ -181,6 +234,9 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::SptInfos>>
   semifuture_getSpanningTreeInfos(std::unique_ptr<std::string> area) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::KvStoreChurnStats>>
+  semifuture_getKvStoreChurnStats(std::unique_ptr<std::string> area) override;
+
   folly::SemiFuture<folly::Unit> semifuture_addUpdateKvStorePeers(
       std::unique_ptr<thrift::PeersMap> peers,
       std::unique_ptr<std::string> area) override;
@@ -199,11 +255,25 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // immediately create and return the stream handler
   apache::thrift::ServerStream<thrift::Publication> subscribeKvStore() override;
 
+  // Route databases of many nodes, streamed as they are computed
+  apache::thrift::ServerStream<thrift::RouteDatabase> getDecisionRouteDbs(
+      std::unique_ptr<std::vector<std::string>> nodeNames) override;
+
   folly::SemiFuture<apache::thrift::ResponseAndServerStream<
       thrift::Publication,
       thrift::Publication>>
   semifuture_subscribeAndGetKvStore() override;
 
+  // Subscriptions filtered by key prefixes and originator ids
+  apache::thrift::ServerStream<thrift::Publication> subscribeKvStoreFilter(
+      std::unique_ptr<thrift::KeyDumpParams> filter) override;
+
+  folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+      thrift::Publication,
+      thrift::Publication>>
+  semifuture_subscribeAndGetKvStoreFiltered(
+      std::unique_ptr<thrift::KeyDumpParams> filter) override;
+
   // Long poll support
   folly::SemiFuture<bool> semifuture_longPollKvStoreAdj(
       std::unique_ptr<thrift::KeyVals> snapshot) override;
@@ -282,6 +352,28 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
  private:
   void authorizeConnection();
 
+  // Counters of the ctrl server itself
+  void getCtrlCounters(std::map<std::string, int64_t>& counters);
+
+  // write the values of the persisted runtime knobs to the config store
+  folly::SemiFuture<folly::Unit> storeRuntimeKnobs();
+
+  // Apply "adj:" key changes of a publication to the index of adj keys.
+  // Returns true if any adj key changed.
+  bool updateAdjKeyIndex(thrift::Publication const& publication);
+
+  // Stream publications to the subscribers matching them
+  void publishToKvStoreSubscribers(thrift::Publication const& publication);
+
+  // Active kvstore snoop stream and the filter it subscribed with
+  struct KvStoreSubscriber {
+    apache::thrift::ServerStreamPublisher<thrift::Publication> publisher;
+    // Subscribers with the same key share filtered publications, empty if
+    // unfiltered
+    std::string filterKey;
+    std::shared_ptr<const KvStoreFilters> filters;
+  };
+
   const std::string nodeName_;
   const std::unordered_set<std::string> acceptablePeerCommonNames_;
 
@@ -292,28 +384,50 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   LinkMonitor* linkMonitor_{nullptr};
   PersistentStore* configStore_{nullptr};
   PrefixManager* prefixManager_{nullptr};
+  RuntimeKnobs* runtimeKnobs_{nullptr};
 
   // Reference to event-loop
   fbzmq::ZmqEventLoop& evl_;
 
-  // client to interact with monitor
+  // client to interact with monitor. Its socket is used under the lock as
+  // methods are served by several threads
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
+  std::mutex zmqMonitorClientLock_;
 
   // KvStore sub socket
   fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT> kvStoreSubSock_;
 
   // Active kvstore snoop publishers
   std::atomic<int64_t> publisherToken_{0};
-  folly::Synchronized<std::unordered_map<
-      int64_t,
-      apache::thrift::ServerStreamPublisher<thrift::Publication>>>
+  folly::Synchronized<std::unordered_map<int64_t, KvStoreSubscriber>>
       kvStorePublishers_;
 
-  // pending longPoll requests from clients, which consists of
-  // 1). promise; 2). timestamp when req received on server
+  // Publications streamed, summed over subscribers, and skipped as nothing
+  // in them matched a subscriber's filter
+  std::atomic<int64_t> numKvStoreStreamed_{0};
+  std::atomic<int64_t> numKvStoreFiltered_{0};
+
+  // "adj:" keys of KvStore with their version, originator and hash, kept up
+  // to date from publications. Long polls get compared against it instead of
+  // KvStore. The version is bumped on every adj change.
+  folly::Synchronized<std::unordered_map<std::string, thrift::Value>>
+      adjKeyIndex_;
+  std::atomic<int64_t> adjKeyIndexVersion_{0};
+
+  // Long polls answered from the index, and the ones which had to be
+  // confirmed with KvStore
+  std::atomic<int64_t> longPollIndexHits_{0};
+  std::atomic<int64_t> longPollIndexMisses_{0};
+
+  // Counters of fb303, the monitor and ours, cached for regex and selected
+  // counter queries
+  CounterRegistry counterRegistry_{Constants::kCounterCacheMaxAge};
+
+  // pending longPoll requests from clients in order of arrival, which
+  // consists of 1). promise; 2). timestamp when req received on server
   std::atomic<int64_t> pendingRequestId_{0};
   folly::Synchronized<
-      std::unordered_map<int64_t, std::pair<folly::Promise<bool>, int64_t>>>
+      std::map<int64_t, std::pair<folly::Promise<bool>, int64_t>>>
       longPollReqs_;
 
 }; // class OpenrCtrlHandler
@@ -245,7 +245,7 @@ class OpenrCtrlFixture : public ::testing::Test {
   const MonitorSubmitUrl monitorSubmitUrl_{"inproc://monitor-submit-url"};
   const PlatformPublisherUrl platformPubUrl_{"inproc://platform-pub-url"};
 
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue_;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue_;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue_;
   messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue_;
@@ -331,6 +331,26 @@ TEST_F(OpenrCtrlFixture, PrefixManagerApis) {
         res, thrift::PrefixType::LOOPBACK);
     EXPECT_EQ(0, res.size());
   }
+
+  {
+    thrift::PrefixDeltaChunk chunk;
+    chunk.seqNum = 1;
+    chunk.prefixesToAdvertise = {
+        createPrefixEntry("30.0.0.0/8", thrift::PrefixType::BGP)};
+    chunk.prefixesToWithdraw = {
+        createPrefixEntry("23.0.0.0/8", thrift::PrefixType::BGP),
+        createPrefixEntry("24.0.0.0/8", thrift::PrefixType::BGP)};
+    thrift::PrefixDeltaAck ack;
+    openrCtrlThriftClient_->sync_applyPrefixDeltaChunk(ack, chunk);
+    EXPECT_EQ(1, ack.seqNum);
+    EXPECT_EQ(1, ack.numAdvertised);
+    EXPECT_EQ(1, ack.numWithdrawn);
+    EXPECT_EQ(Constants::kPrefixMgrMaxPendingDeltaChunks, ack.maxPendingChunks);
+
+    std::vector<thrift::PrefixEntry> res;
+    openrCtrlThriftClient_->sync_getPrefixes(res);
+    EXPECT_EQ(chunk.prefixesToAdvertise, res);
+  }
 }
 
 TEST_F(OpenrCtrlFixture, RouteApis) {
@@ -741,6 +761,81 @@ TEST_F(OpenrCtrlFixture, KvStoreApis) {
       std::this_thread::yield();
     }
   }
+
+  //
+  // Filtered subscribe API
+  //
+
+  {
+    std::atomic<int> receivedByPrefix{0};
+    std::atomic<int> receivedByOriginator{0};
+    auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+
+    // Only "filter-key" updates, streamed to two subscribers sharing the
+    // filter, and updates originated by node2
+    thrift::KeyDumpParams prefixFilter;
+    prefixFilter.prefix = "filter-";
+    thrift::KeyDumpParams originatorFilter;
+    originatorFilter.originatorIds = {"node2"};
+    auto onPublication = [](std::atomic<int>& received) {
+      return [&received](auto&& t) {
+        if (!t.hasValue()) {
+          return;
+        }
+        for (auto const& kv : t->keyVals) {
+          EXPECT_TRUE(
+              kv.first == "filter-key" or kv.second.originatorId == "node2");
+        }
+        received += t->keyVals.size();
+      };
+    };
+    std::vector<apache::thrift::ClientStreamSubscription> subscriptions;
+    for (int i = 0; i < 2; ++i) {
+      subscriptions.emplace_back(
+          handler
+              ->subscribeKvStoreFilter(
+                  std::make_unique<thrift::KeyDumpParams>(prefixFilter))
+              .toClientStream()
+              .subscribeExTry(
+                  folly::getEventBase(), onPublication(receivedByPrefix)));
+    }
+    subscriptions.emplace_back(
+        handler
+            ->subscribeKvStoreFilter(
+                std::make_unique<thrift::KeyDumpParams>(originatorFilter))
+            .toClientStream()
+            .subscribeExTry(
+                folly::getEventBase(), onPublication(receivedByOriginator)));
+    EXPECT_EQ(3, handler->getNumKvStorePublishers());
+
+    kvStoreWrapper->setKey(
+        "other-key", createThriftValue(1, "node1", std::string("value1")));
+    kvStoreWrapper->setKey(
+        "filter-key", createThriftValue(1, "node1", std::string("value1")));
+    kvStoreWrapper->setKey(
+        "node2-key", createThriftValue(1, "node2", std::string("value1")));
+
+    // Both subscribers of the shared filter got "filter-key"
+    while (receivedByPrefix < 2 or receivedByOriginator < 1) {
+      std::this_thread::yield();
+    }
+
+    std::map<std::string, int64_t> counters;
+    handler->getCounters(counters);
+    EXPECT_EQ(3, counters.at("ctrl.kvstore_subscribers"));
+    EXPECT_EQ(2, counters.at("ctrl.kvstore_subscriber_filters"));
+    EXPECT_LE(1, counters.at("ctrl.kvstore_publications_filtered"));
+
+    for (auto& subscription : subscriptions) {
+      subscription.cancel();
+      std::move(subscription).detach();
+    }
+    while (handler->getNumKvStorePublishers() != 0) {
+      std::this_thread::yield();
+    }
+    EXPECT_EQ(2, receivedByPrefix);
+    EXPECT_EQ(1, receivedByOriginator);
+  }
 }
 
 TEST_F(OpenrCtrlFixture, LinkMonitorApis) {
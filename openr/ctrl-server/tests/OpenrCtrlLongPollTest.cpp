@@ -304,6 +304,43 @@ TEST_F(LongPollFixture, LongPollAdjExpired) {
   ASSERT_TRUE(isAdjChanged);
 }
 
+TEST_F(LongPollFixture, LongPollManyPending) {
+  //
+  // Many clients holding the current adj keys wait on the index of adj keys,
+  // a single adj key change completes all of them
+  //
+  auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+  const auto value = createThriftValue(1, nodeName_, std::string("value1"));
+  kvStoreWrapper_->setKey(adjKey_, value);
+
+  const int numPolls{1000};
+  std::vector<folly::SemiFuture<bool>> polls;
+  for (int i = 0; i < numPolls; ++i) {
+    thrift::KeyVals snapshot;
+    snapshot.emplace(adjKey_, value);
+    snapshot.emplace(prefixKey_, value);
+    polls.emplace_back(handler->semifuture_longPollKvStoreAdj(
+        std::make_unique<thrift::KeyVals>(std::move(snapshot))));
+  }
+  EXPECT_EQ(numPolls, handler->getNumPendingLongPollReqs());
+
+  // Every poll got checked against the index, KvStore is only asked while the
+  // index is catching up with the adj key
+  std::map<std::string, int64_t> counters;
+  handler->getCounters(counters);
+  EXPECT_EQ(
+      numPolls,
+      counters.at("ctrl.long_poll_index_hits") +
+          counters.at("ctrl.long_poll_index_misses"));
+
+  kvStoreWrapper_->setKey(
+      adjKey_, createThriftValue(2, nodeName_, std::string("value2")));
+  for (auto& poll : polls) {
+    EXPECT_TRUE(std::move(poll).get());
+  }
+  EXPECT_EQ(0, handler->getNumPendingLongPollReqs());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/decision/AdaptiveDebounce.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// weight of the newest sample in the moving averages
+constexpr double kSampleWeight{0.25};
+
+void
+addSample(double& average, double sample, bool isFirst) {
+  average = isFirst ? sample : average + kSampleWeight * (sample - average);
+}
+
+} // namespace
+
+AdaptiveDebounce::AdaptiveDebounce(
+    std::chrono::milliseconds minWindow,
+    std::chrono::milliseconds maxWindow,
+    double targetDutyCycle)
+    : minWindow_(minWindow),
+      maxWindow_(std::max(minWindow, maxWindow)),
+      targetDutyCycle_(std::min(1.0, targetDutyCycle)) {
+  CHECK_GT(targetDutyCycle, 0);
+}
+
+std::chrono::milliseconds
+AdaptiveDebounce::reportUpdate(Clock::time_point now) {
+  const double maxWindow = maxWindow_.count();
+  // idle gap following a computation and the full computation cycle
+  const double gap =
+      computeDuration_ * (1 - targetDutyCycle_) / targetDutyCycle_;
+  const double cycle = computeDuration_ + gap;
+
+  double sinceLastUpdate = maxWindow;
+  if (lastUpdate_.hasValue()) {
+    sinceLastUpdate = std::chrono::duration_cast<std::chrono::microseconds>(
+                          now - *lastUpdate_)
+                          .count();
+    // intervals longer than maxWindow say nothing about churn
+    const bool isFirst = numUpdates_ == 1;
+    addSample(updateInterval_, std::min(sinceLastUpdate, maxWindow), isFirst);
+  }
+  lastUpdate_ = now;
+  ++numUpdates_;
+
+  double gapRemaining = 0;
+  if (lastComputeEnd_.hasValue()) {
+    const double sinceLastCompute =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - *lastComputeEnd_)
+            .count();
+    gapRemaining = std::max(0.0, gap - sinceLastCompute);
+  }
+
+  double window = 0;
+  if (sinceLastUpdate >= std::max<double>(cycle, minWindow_.count()) and
+      gapRemaining == 0) {
+    ++numImmediate_;
+  } else {
+    if (numUpdates_ > 1 and updateInterval_ < cycle) {
+      // updates arrive faster than they can be computed
+      ++numWidened_;
+      window = std::max(
+          gap * cycle / std::max(updateInterval_, 1.0), gapRemaining);
+    } else {
+      window = gapRemaining;
+    }
+    window = std::max<double>(window, minWindow_.count());
+  }
+  window_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::microseconds(static_cast<int64_t>(
+          std::min(window, maxWindow))));
+  return window_;
+}
+
+void
+AdaptiveDebounce::reportCompute(
+    std::chrono::microseconds duration, Clock::time_point now) {
+  addSample(computeDuration_, duration.count(), not lastComputeEnd_.hasValue());
+  lastComputeEnd_ = now;
+}
+
+std::unordered_map<std::string, int64_t>
+AdaptiveDebounce::getCounters() const {
+  return {
+      {"decision.debounce.window_ms", window_.count()},
+      {"decision.debounce.compute_duration_us",
+       static_cast<int64_t>(computeDuration_)},
+      {"decision.debounce.update_interval_us",
+       static_cast<int64_t>(updateInterval_)},
+      {"decision.debounce.updates", numUpdates_},
+      {"decision.debounce.immediate", numImmediate_},
+      {"decision.debounce.widened", numWidened_},
+  };
+}
+
+} // namespace openr
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+//
+// Picks the debounce window of route computations from moving averages of
+// their duration and of the interval between updates, aiming at a target
+// share of time spent computing routes (duty cycle).
+//
+// A computation taking d is followed by an idle gap of d * (1 - t) / t for a
+// duty cycle t. Updates arriving when idle, i.e. after a full computation
+// cycle without updates and past the gap, are computed right away. Updates
+// arriving faster than computations can keep up with widen the window in
+// proportion, up to maxWindow. Otherwise updates wait for the gap, and for
+// at least minWindow to batch them.
+//
+class AdaptiveDebounce {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  AdaptiveDebounce(
+      std::chrono::milliseconds minWindow,
+      std::chrono::milliseconds maxWindow,
+      double targetDutyCycle);
+
+  // an update requiring route computation arrived, returns the delay after
+  // which routes are to be computed
+  std::chrono::milliseconds reportUpdate(Clock::time_point now = Clock::now());
+
+  // a route computation took duration and finished at now
+  void reportCompute(
+      std::chrono::microseconds duration, Clock::time_point now = Clock::now());
+
+  // window chosen for the last update
+  std::chrono::milliseconds
+  getWindow() const {
+    return window_;
+  }
+
+  // chosen window and the moving averages it's based on, e.g.
+  // "decision.debounce.window_ms"
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
+ private:
+  const std::chrono::microseconds minWindow_;
+  const std::chrono::microseconds maxWindow_;
+  const double targetDutyCycle_{1};
+
+  // moving averages, in microseconds
+  double computeDuration_{0};
+  double updateInterval_{0};
+
+  folly::Optional<Clock::time_point> lastUpdate_;
+  folly::Optional<Clock::time_point> lastComputeEnd_;
+  std::chrono::milliseconds window_{0};
+
+  int64_t numUpdates_{0};
+  int64_t numImmediate_{0};
+  int64_t numWidened_{0};
+};
+
+} // namespace openr
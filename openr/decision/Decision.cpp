@@ -7,20 +7,31 @@
 
 #include "Decision.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <iterator>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_set>
 
 #include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
 #if FOLLY_USE_SYMBOLIZER
 #include <folly/experimental/exception_tracer/ExceptionTracer.h>
 #endif
@@ -28,7 +39,10 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/StringInterner.h>
+#include <openr/common/ThreadLocalStats.h>
 #include <openr/common/Util.h>
+#include <openr/decision/IndexedHeap.h>
 #include <openr/decision/LinkState.h>
 #include <openr/decision/PrefixState.h>
 
@@ -39,21 +53,60 @@ using apache::thrift::TEnumTraits;
 
 using Metric = openr::LinkStateMetric;
 
-using SpfResult = unordered_map<
-    string /* otherNodeName */,
-    pair<Metric, unordered_set<string /* nextHopNodeName */>>>;
-
 // Path starts from neighbor node and ends at destination. It's size must be
 // atleast one. Second attribute describe the link that is followed from
-// associated node (first attribute)
+// associated node (first attribute), it points into the LinkState and is valid
+// as long as the link state isn't modified.
 // Path is described in reverse. Last index is the next immediate node.
-using Path = std::vector<std::pair<std::string, std::shared_ptr<openr::Link>>>;
+using Path = std::vector<std::pair<std::string, const openr::Link*>>;
 
 namespace {
 
 // Default HWM is 1k. We set it to 0 to buffer all received messages.
 const int kStoreSubReceiveHwm{0};
 
+// upper bound of the debounce runtime knobs
+const int64_t kMaxDebounceMs{60000};
+
+// shards of the BGP best path cache, locked on their own as routes are
+// created in parallel
+const size_t kNumBgpBestPathCacheShards{16};
+
+// shards of the next-hop groups of a route build, same as above
+const size_t kNumNextHopGroupShards{16};
+
+// v4 and v6 host loopback addresses advertised by the node, if any
+std::pair<
+    folly::Optional<openr::thrift::BinaryAddress>,
+    folly::Optional<openr::thrift::BinaryAddress>>
+getNodeHostLoopbacks(
+    const openr::PrefixState& prefixState, const std::string& nodeName) {
+  return std::make_pair(
+      folly::get_optional(prefixState.getNodeHostLoopbacksV4(), nodeName),
+      folly::get_optional(prefixState.getNodeHostLoopbacksV6(), nodeName));
+}
+
+// Add a perf event for each phase of a route computation, carrying its
+// duration. Updates with empty perf events are not timed and left untouched.
+void
+addComputePhasePerfEvents(
+    openr::thrift::PerfEvents& perfEvents,
+    const std::string& nodeName,
+    const std::vector<openr::PhaseProfiler::PhaseDuration>& phases) {
+  if (perfEvents.events.empty()) {
+    return;
+  }
+  for (auto const& phase : phases) {
+    openr::addPerfEvent(
+        perfEvents,
+        nodeName,
+        folly::sformat(
+            "DECISION_PHASE_{}",
+            openr::PhaseProfiler::getPhaseEventName(phase.first)));
+    perfEvents.events.back().durationUs = phase.second.count();
+  }
+}
+
 // check if path A is part of path B.
 // Example:
 // path A: a->b->c
@@ -82,74 +135,379 @@ pathAInPathB(const Path& a, const Path& b) {
   return false;
 }
 
-// Classes needed for running Dijkstra
-class DijkstraQNode {
+//
+// Working memory for a single SPF run. It is kept alive across runs so that
+// steady state runs perform no heap allocations. All vectors are indexed by
+// LinkState::NodeId.
+//
+// Next-hops of a node are stored as a bitset over the direct neighbors of the
+// source node, bits of node `id` occupy nextHopBits_[id * numWords_] onwards
+//
+class SpfScratch {
  public:
-  DijkstraQNode(const std::string& n, Metric d) : nodeName(n), distance(d) {}
-  const std::string nodeName;
-  Metric distance{0};
-  std::unordered_set<std::string> nextHops;
-};
+  using NodeId = openr::LinkState::NodeId;
 
-class DijkstraQ {
- private:
-  std::vector<std::shared_ptr<DijkstraQNode>> heap_;
-  std::unordered_map<std::string, std::shared_ptr<DijkstraQNode>> nameToNode_;
+  friend class SpfResult;
+
+  void
+  reset(const openr::LinkState::Graph& graph, NodeId srcId) {
+    const size_t numNodes = graph.numNodes();
+    heap.reset(numNodes);
+    distances.assign(numNodes, std::numeric_limits<Metric>::max());
+    settled.assign(numNodes, false);
+    settledOrder.clear();
+    resetNextHops(graph, srcId);
+  }
 
-  struct {
-    bool
-    operator()(
-        std::shared_ptr<DijkstraQNode> a,
-        std::shared_ptr<DijkstraQNode> b) const {
-      if (a->distance != b->distance) {
-        return a->distance > b->distance;
+  // clear next-hops of all nodes and re-index direct neighbors of the source
+  void
+  resetNextHops(const openr::LinkState::Graph& graph, NodeId srcId) {
+    const size_t numNodes = graph.numNodes();
+
+    // enumerate direct neighbors of the source
+    neighborIndex_.assign(numNodes, kNotNeighbor);
+    neighbors_.clear();
+    for (size_t e = graph.offsets[srcId]; e < graph.offsets[srcId + 1]; ++e) {
+      const auto dst = graph.dsts[e];
+      if (neighborIndex_[dst] == kNotNeighbor) {
+        neighborIndex_[dst] = static_cast<uint32_t>(neighbors_.size());
+        neighbors_.emplace_back(dst);
       }
-      return a->nodeName > b->nodeName;
     }
-  } DijkstraQNodeGreater;
+    numWords_ = std::max<size_t>(1, (neighbors_.size() + 63) / 64);
+    nextHopBits_.assign(numNodes * numWords_, 0);
+  }
 
- public:
   void
-  insertNode(const std::string& nodeName, Metric d) {
-    heap_.push_back(std::make_shared<DijkstraQNode>(nodeName, d));
-    nameToNode_[nodeName] = heap_.back();
-    std::push_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+  clearNextHops(NodeId id) {
+    std::fill_n(nextHopBits_.begin() + id * numWords_, numWords_, 0);
   }
 
-  std::shared_ptr<DijkstraQNode>
-  get(const std::string& nodeName) {
-    if (nameToNode_.count(nodeName)) {
-      return nameToNode_.at(nodeName);
+  void
+  mergeNextHops(NodeId dst, NodeId src) {
+    auto dstBits = nextHopBits_.begin() + dst * numWords_;
+    auto srcBits = nextHopBits_.begin() + src * numWords_;
+    for (size_t i = 0; i < numWords_; ++i) {
+      dstBits[i] |= srcBits[i];
     }
-    return nullptr;
   }
 
-  std::shared_ptr<DijkstraQNode>
-  extractMin() {
-    if (heap_.empty()) {
-      return nullptr;
+  bool
+  hasNoNextHops(NodeId id) const {
+    auto bits = nextHopBits_.begin() + id * numWords_;
+    return std::all_of(bits, bits + numWords_, [](uint64_t w) { return !w; });
+  }
+
+  // mark neighbor `id` of the source as its own next-hop
+  void
+  addNeighborNextHop(NodeId id) {
+    const auto index = neighborIndex_[id];
+    DCHECK_NE(kNotNeighbor, index);
+    nextHopBits_[id * numWords_ + index / 64] |= (1ULL << (index % 64));
+  }
+
+  openr::IndexedHeap<Metric> heap;
+  std::vector<Metric> distances;
+  std::vector<bool> settled;
+  std::vector<NodeId> settledOrder;
+
+ private:
+  static constexpr uint32_t kNotNeighbor = std::numeric_limits<uint32_t>::max();
+
+  // index of each node among the neighbors of source or kNotNeighbor
+  std::vector<uint32_t> neighborIndex_;
+  // neighbor node ids of source by their index
+  std::vector<NodeId> neighbors_;
+  std::vector<uint64_t> nextHopBits_;
+  size_t numWords_{1};
+};
+
+//
+// Result of an SPF run from a source node. Distances and next-hops of all
+// nodes are kept in dense arrays indexed by LinkState::NodeId, next-hops as a
+// bitset over the direct neighbors of the source. A single word per node
+// covers sources with up to 64 neighbors, sources of higher degree use as
+// many words per node as needed.
+//
+// Names are resolved through the link state the result was computed on,
+// which never reuses node ids.
+//
+class SpfResult {
+ public:
+  using NodeId = openr::LinkState::NodeId;
+
+  // result of a source unknown to the link state, no node is reachable
+  explicit SpfResult(const openr::LinkState& linkState)
+      : linkState_(&linkState) {}
+
+  // result of the run in scratch, reachable nodes are the settled ones
+  SpfResult(const openr::LinkState& linkState, const SpfScratch& scratch)
+      : linkState_(&linkState),
+        metrics_(scratch.distances.size(), kUnreachable),
+        neighbors_(scratch.neighbors_),
+        nextHopBits_(scratch.nextHopBits_.size(), 0),
+        numWords_(scratch.numWords_) {
+    for (const auto id : scratch.settledOrder) {
+      metrics_[id] = scratch.distances[id];
+      std::copy_n(
+          scratch.nextHopBits_.begin() + id * numWords_,
+          numWords_,
+          nextHopBits_.begin() + id * numWords_);
+    }
+  }
+
+  bool
+  reaches(NodeId id) const {
+    return id < metrics_.size() and metrics_[id] != kUnreachable;
+  }
+
+  // distance to a reachable node
+  Metric
+  getMetric(NodeId id) const {
+    DCHECK(reaches(id));
+    return metrics_[id];
+  }
+
+  // distance to nodeName, none if it is not reachable
+  folly::Optional<Metric>
+  getMetric(const std::string& nodeName) const {
+    const auto id = linkState_->getNodeId(nodeName);
+    if (not id.hasValue() or not reaches(id.value())) {
+      return folly::none;
     }
-    auto min = heap_.at(0);
-    CHECK(nameToNode_.erase(min->nodeName));
-    std::pop_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
-    heap_.pop_back();
-    return min;
+    return metrics_[id.value()];
   }
 
+  // calls f(id, metric) for every reachable node
+  template <typename F>
   void
-  decreaseKey(const std::string& nodeName, Metric d) {
-    if (nameToNode_.count(nodeName)) {
-      if (nameToNode_.at(nodeName)->distance < d) {
-        throw std::invalid_argument(std::to_string(d));
-      }
-      nameToNode_.at(nodeName)->distance = d;
-      // this is a bit slow but is rarely called in our application. In fact,
-      // in networks where the metric is hop count, this will never be called
-      // and the Dijkstra run is no different than BFS
-      std::make_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
-    } else {
-      throw std::invalid_argument(nodeName);
+  forEachNode(F&& f) const {
+    for (NodeId id = 0; id < metrics_.size(); ++id) {
+      if (metrics_[id] != kUnreachable) {
+        f(id, metrics_[id]);
+      }
+    }
+  }
+
+  // calls f(id) for every next-hop, i.e. neighbor of the source, on the
+  // shortest paths towards a reachable node
+  template <typename F>
+  void
+  forEachNextHop(NodeId id, F&& f) const {
+    DCHECK(reaches(id));
+    for (size_t i = 0; i < numWords_; ++i) {
+      uint64_t word = nextHopBits_[id * numWords_ + i];
+      while (word) {
+        const auto bit = __builtin_ctzll(word);
+        f(neighbors_[i * 64 + bit]);
+        word &= word - 1;
+      }
+    }
+  }
+
+  std::vector<NodeId>
+  getNextHops(NodeId id) const {
+    std::vector<NodeId> nextHops;
+    forEachNextHop(id, [&nextHops](NodeId nhId) { nextHops.push_back(nhId); });
+    return nextHops;
+  }
+
+  const openr::LinkState&
+  getLinkState() const {
+    return *linkState_;
+  }
+
+ private:
+  static constexpr Metric kUnreachable = std::numeric_limits<Metric>::max();
+
+  const openr::LinkState* linkState_{nullptr};
+  std::vector<Metric> metrics_;
+  // neighbor node ids of the source by their bit index
+  std::vector<NodeId> neighbors_;
+  std::vector<uint64_t> nextHopBits_;
+  size_t numWords_{1};
+};
+
+//
+// Result of a previous SPF run retained for incremental SPF. distances are
+// indexed by node id and were computed over graph
+//
+struct SpfState {
+  std::shared_ptr<const openr::LinkState::Graph> graph;
+  std::vector<Metric> distances;
+};
+
+//
+// Effective metric of all edges from each node to each of its neighbors. Edges
+// from overloaded nodes (other than the source) do not carry transit traffic
+// and are hence treated as absent. Parallel edges collapse to the minimum
+// metric as only that matters for shortest path distances.
+//
+struct EdgeChange {
+  openr::LinkState::NodeId src;
+  openr::LinkState::NodeId dst;
+  Metric oldMetric;
+  Metric newMetric;
+};
+
+// Find all node pairs whose effective edge metric differs across two graphs
+std::vector<EdgeChange>
+diffGraphs(
+    const openr::LinkState::Graph& oldGraph,
+    const openr::LinkState::Graph& newGraph,
+    openr::LinkState::NodeId srcId) {
+  using NodeId = openr::LinkState::NodeId;
+  constexpr Metric kInf = std::numeric_limits<Metric>::max();
+
+  std::vector<EdgeChange> changes;
+  const size_t numNodes = std::max(oldGraph.numNodes(), newGraph.numNodes());
+  std::vector<Metric> oldMetrics(numNodes, kInf);
+  std::vector<Metric> newMetrics(numNodes, kInf);
+  std::vector<NodeId> touched;
+
+  auto edgeRange = [srcId](const openr::LinkState::Graph& graph, NodeId id)
+      -> std::pair<size_t, size_t> {
+    if (id >= graph.numNodes() or (graph.overloaded[id] and id != srcId)) {
+      return {0, 0};
+    }
+    return {graph.offsets[id], graph.offsets[id + 1]};
+  };
+
+  for (NodeId id = 0; id < numNodes; ++id) {
+    const auto oldRange = edgeRange(oldGraph, id);
+    const auto newRange = edgeRange(newGraph, id);
+
+    // fast path, edges are laid out deterministically hence identical
+    // adjacencies produce identical ranges
+    const size_t numEdges = oldRange.second - oldRange.first;
+    if (numEdges == newRange.second - newRange.first and
+        std::equal(
+            oldGraph.dsts.begin() + oldRange.first,
+            oldGraph.dsts.begin() + oldRange.second,
+            newGraph.dsts.begin() + newRange.first) and
+        std::equal(
+            oldGraph.metrics.begin() + oldRange.first,
+            oldGraph.metrics.begin() + oldRange.second,
+            newGraph.metrics.begin() + newRange.first)) {
+      continue;
+    }
+
+    for (size_t e = oldRange.first; e < oldRange.second; ++e) {
+      const auto dst = oldGraph.dsts[e];
+      if (oldMetrics[dst] == kInf and newMetrics[dst] == kInf) {
+        touched.emplace_back(dst);
+      }
+      oldMetrics[dst] = std::min(oldMetrics[dst], oldGraph.metrics[e]);
+    }
+    for (size_t e = newRange.first; e < newRange.second; ++e) {
+      const auto dst = newGraph.dsts[e];
+      if (oldMetrics[dst] == kInf and newMetrics[dst] == kInf) {
+        touched.emplace_back(dst);
+      }
+      newMetrics[dst] = std::min(newMetrics[dst], newGraph.metrics[e]);
+    }
+    for (const auto dst : touched) {
+      if (oldMetrics[dst] != newMetrics[dst]) {
+        changes.emplace_back(
+            EdgeChange{id, dst, oldMetrics[dst], newMetrics[dst]});
+      }
+      oldMetrics[dst] = kInf;
+      newMetrics[dst] = kInf;
     }
+    touched.clear();
+  }
+  return changes;
+}
+
+//
+// Identifies an SPF run over a given link state generation. Ignored links are
+// part of the key, their hash is precomputed as an order independent
+// combination of link hashes.
+//
+struct SpfCacheKey {
+  SpfCacheKey(
+      const std::string& srcNodeName,
+      bool useLinkMetric,
+      const openr::LinkState::LinkSet& linksToIgnore)
+      : srcNodeName(srcNodeName),
+        useLinkMetric(useLinkMetric),
+        linksToIgnore(linksToIgnore) {
+    size_t linksHash{0};
+    for (auto const& link : linksToIgnore) {
+      linksHash += openr::LinkState::LinkPtrHash{}(link);
+    }
+    hash = folly::hash::hash_combine(srcNodeName, useLinkMetric, linksHash);
+  }
+
+  bool
+  operator==(const SpfCacheKey& other) const {
+    return hash == other.hash and useLinkMetric == other.useLinkMetric and
+        srcNodeName == other.srcNodeName and
+        linksToIgnore == other.linksToIgnore;
+  }
+
+  std::string srcNodeName;
+  bool useLinkMetric{true};
+  openr::LinkState::LinkSet linksToIgnore;
+  size_t hash{0};
+};
+
+struct SpfCacheKeyHash {
+  size_t
+  operator()(const SpfCacheKey& key) const {
+    return key.hash;
+  }
+};
+
+// Neighbor of the source node offering a loop-free alternate path towards a
+// destination node. Neighbors are referred to by their index in
+// LfaTable::neighbors to keep entries small.
+struct LfaCandidate {
+  uint32_t neighbor{0};
+  Metric distanceFromNeighbor{0};
+  Metric neighborToHere{0};
+};
+
+// LFA candidates of every destination node, computed once per source node
+// and link state generation and shared by all prefixes of a destination
+struct LfaTable {
+  // link state generation and source node the table was computed for
+  uint64_t generation{0};
+  std::string source;
+  bool valid{false};
+
+  std::vector<openr::InternedString> neighbors;
+  std::unordered_map<std::string /* dstNode */, std::vector<LfaCandidate>>
+      candidates;
+};
+
+// Equivalence class of Open/R prefixes, which get the same next hops in a
+// route build. Drained announcers are filtered from nodes beforehand
+struct NextHopGroupKey {
+  NextHopGroupKey(std::set<std::string> nodes, bool isV4, bool perDestination)
+      : nodes(std::move(nodes)), isV4(isV4), perDestination(perDestination) {
+    hash = folly::hash::hash_combine(
+        folly::hash::hash_range(this->nodes.begin(), this->nodes.end()),
+        isV4,
+        perDestination);
+  }
+
+  bool
+  operator==(const NextHopGroupKey& other) const {
+    return hash == other.hash and isV4 == other.isV4 and
+        perDestination == other.perDestination and nodes == other.nodes;
+  }
+
+  std::set<std::string> nodes;
+  bool isV4{false};
+  bool perDestination{false};
+  size_t hash{0};
+};
+
+struct NextHopGroupKeyHash {
+  size_t
+  operator()(const NextHopGroupKey& key) const {
+    return key.hash;
   }
 };
 
@@ -168,29 +526,75 @@ class SpfSolver::SpfSolverImpl {
       bool computeLfaPaths,
       bool enableOrderedFib,
       bool bgpDryRun,
-      bool bgpUseIgpMetric)
+      bool bgpUseIgpMetric,
+      size_t numRouteBuildThreads,
+      PhaseProfiler* phaseProfiler = nullptr)
       : myNodeName_(myNodeName),
         enableV4_(enableV4),
         computeLfaPaths_(computeLfaPaths),
         enableOrderedFib_(enableOrderedFib),
         bgpDryRun_(bgpDryRun),
-        bgpUseIgpMetric_(bgpUseIgpMetric) {
-    // Initialize stat keys
-    tData_.addStatExportType("decision.adj_db_update", fbzmq::COUNT);
-    tData_.addStatExportType(
-        "decision.incompatible_forwarding_type", fbzmq::COUNT);
-    tData_.addStatExportType("decision.missing_loopback_addr", fbzmq::SUM);
-    tData_.addStatExportType("decision.no_route_to_label", fbzmq::COUNT);
-    tData_.addStatExportType("decision.no_route_to_prefix", fbzmq::COUNT);
-    tData_.addStatExportType("decision.path_build_ms", fbzmq::AVG);
-    tData_.addStatExportType("decision.path_build_runs", fbzmq::COUNT);
-    tData_.addStatExportType("decision.prefix_db_update", fbzmq::COUNT);
-    tData_.addStatExportType("decision.route_build_ms", fbzmq::AVG);
-    tData_.addStatExportType("decision.route_build_runs", fbzmq::COUNT);
-    tData_.addStatExportType("decision.skipped_mpls_route", fbzmq::COUNT);
-    tData_.addStatExportType("decision.skipped_unicast_route", fbzmq::COUNT);
-    tData_.addStatExportType("decision.spf_ms", fbzmq::AVG);
-    tData_.addStatExportType("decision.spf_runs", fbzmq::COUNT);
+        bgpUseIgpMetric_(bgpUseIgpMetric),
+        numRouteBuildThreads_(std::max<size_t>(1, numRouteBuildThreads)),
+        phaseProfiler_(phaseProfiler) {
+    if (numRouteBuildThreads_ > 1) {
+      routeBuildExecutor_ =
+          std::make_unique<folly::CPUThreadPoolExecutor>(numRouteBuildThreads_);
+    }
+
+    // Register stats, values are added from route build workers too
+    adjDbUpdateStat_ = stats_.addStat("decision.adj_db_update", {fbzmq::COUNT});
+    bgpBestPathCacheHitsStat_ =
+        stats_.addStat("decision.bgp_best_path_cache_hits", {fbzmq::COUNT});
+    bgpBestPathCacheMissesStat_ =
+        stats_.addStat("decision.bgp_best_path_cache_misses", {fbzmq::COUNT});
+    incompatibleForwardingTypeStat_ =
+        stats_.addStat("decision.incompatible_forwarding_type", {fbzmq::COUNT});
+    ksp2PathCacheHitsStat_ =
+        stats_.addStat("decision.ksp2_path_cache_hits", {fbzmq::COUNT});
+    ksp2PathCacheMissesStat_ =
+        stats_.addStat("decision.ksp2_path_cache_misses", {fbzmq::COUNT});
+    lfaTableBuildMsStat_ =
+        stats_.addHistogram("decision.lfa_table_build_ms", {fbzmq::AVG});
+    missingLoopbackAddrStat_ =
+        stats_.addStat("decision.missing_loopback_addr", {fbzmq::SUM});
+    nextHopGroupHitsStat_ =
+        stats_.addStat("decision.next_hop_group_hits", {fbzmq::COUNT});
+    nextHopGroupMissesStat_ =
+        stats_.addStat("decision.next_hop_group_misses", {fbzmq::COUNT});
+    noRouteToLabelStat_ =
+        stats_.addStat("decision.no_route_to_label", {fbzmq::COUNT});
+    noRouteToPrefixStat_ =
+        stats_.addStat("decision.no_route_to_prefix", {fbzmq::COUNT});
+    pathBuildMsStat_ =
+        stats_.addHistogram("decision.path_build_ms", {fbzmq::AVG});
+    pathBuildRunsStat_ =
+        stats_.addStat("decision.path_build_runs", {fbzmq::COUNT});
+    partialRouteBuildMsStat_ =
+        stats_.addHistogram("decision.partial_route_build_ms", {fbzmq::AVG});
+    partialRouteBuildRunsStat_ =
+        stats_.addStat("decision.partial_route_build_runs", {fbzmq::COUNT});
+    prefixDbUpdateStat_ =
+        stats_.addStat("decision.prefix_db_update", {fbzmq::COUNT});
+    routeBuildMsStat_ =
+        stats_.addHistogram("decision.route_build_ms", {fbzmq::AVG});
+    routeBuildRunsStat_ =
+        stats_.addStat("decision.route_build_runs", {fbzmq::COUNT});
+    reusedNodeLabelRoutesStat_ =
+        stats_.addStat("decision.reused_node_label_routes", {fbzmq::COUNT});
+    skippedMplsRouteStat_ =
+        stats_.addStat("decision.skipped_mpls_route", {fbzmq::COUNT});
+    skippedUnicastRouteStat_ =
+        stats_.addStat("decision.skipped_unicast_route", {fbzmq::COUNT});
+    spfCacheHitsStat_ =
+        stats_.addStat("decision.spf_cache_hits", {fbzmq::COUNT});
+    spfCacheMissesStat_ =
+        stats_.addStat("decision.spf_cache_misses", {fbzmq::COUNT});
+    spfFullRunsStat_ = stats_.addStat("decision.spf_full_runs", {fbzmq::COUNT});
+    spfIncrementalRunsStat_ =
+        stats_.addStat("decision.spf_incremental_runs", {fbzmq::COUNT});
+    spfMsStat_ = stats_.addHistogram("decision.spf_ms", {fbzmq::AVG});
+    spfRunsStat_ = stats_.addStat("decision.spf_runs", {fbzmq::COUNT});
   }
 
   ~SpfSolverImpl() = default;
@@ -198,7 +602,7 @@ class SpfSolver::SpfSolverImpl {
   std::pair<
       bool /* topology has changed*/,
       bool /* route attributes has changed (nexthop addr, node/adj label */>
-  updateAdjacencyDatabase(thrift::AdjacencyDatabase const& newAdjacencyDb);
+  updateAdjacencyDatabase(thrift::AdjacencyDatabase newAdjacencyDb);
 
   bool hasHolds() const;
 
@@ -210,7 +614,9 @@ class SpfSolver::SpfSolverImpl {
       thrift::AdjacencyDatabase> const&
   getAdjacencyDatabases();
   // returns true if the prefixDb changed
-  bool updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb);
+  bool updatePrefixDatabase(
+      const thrift::PrefixDatabase& prefixDb,
+      std::unordered_set<thrift::IpPrefix>* changedPrefixes);
 
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
   getPrefixDatabases();
@@ -219,14 +625,33 @@ class SpfSolver::SpfSolverImpl {
       const std::string& myNodeName);
   folly::Optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
+  folly::Optional<thrift::RouteDatabaseDelta> buildRouteDbDelta(
+      const std::string& myNodeName,
+      const std::unordered_set<thrift::IpPrefix>& prefixes);
 
   bool decrementHolds();
 
+  bool
+  hasNode(const std::string& nodeName) const {
+    return linkState_.hasNode(nodeName);
+  }
+
+  PrefixState::PrefixEntries const&
+  getPrefixes() const {
+    return prefixState_.prefixes();
+  }
+
   std::unordered_map<std::string, int64_t> getCounters();
 
-  fbzmq::ThreadData&
-  getThreadData() noexcept {
-    return tData_;
+  void
+  shedCaches() {
+    spfCache_.clear();
+    spfScratch_ = SpfScratch();
+    for (auto& shard : bgpBestPathCache_) {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      shard.entries.clear();
+    }
+    clearNextHopGroups();
   }
 
   static std::pair<Metric, std::unordered_set<std::string>> getMinCostNodes(
@@ -237,6 +662,21 @@ class SpfSolver::SpfSolverImpl {
   SpfSolverImpl(SpfSolverImpl const&) = delete;
   SpfSolverImpl& operator=(SpfSolverImpl const&) = delete;
 
+  // Populate spfResults_ with SPF runs from myNodeName and, if LFA is
+  // enabled, from each of its neighbors
+  void computeSpfResults(const std::string& myNodeName);
+
+  // Populate lfaTable_ from the neighbor SPF results in spfResults_, unless
+  // it is already up to date
+  void computeLfaTable(const std::string& myNodeName);
+
+  // Return SPF result from the cache if the same run was already done on the
+  // current link state generation, else run SPF and cache its result
+  std::shared_ptr<const SpfResult> getSpfResult(
+      const std::string& nodeName,
+      bool useLinkMetric,
+      const LinkState::LinkSet& linksToIgnore = {});
+
   // run SPF and produce map from node name to next-hops that have shortest
   // paths to it
   SpfResult runSpf(
@@ -244,6 +684,32 @@ class SpfSolver::SpfSolverImpl {
       bool useLinkMetric,
       const LinkState::LinkSet& linksToIgnore = {});
 
+  // full Dijkstra run from srcId over graph, fills spfScratch_
+  void runFullSpf(
+      const LinkState::Graph& graph,
+      LinkState::NodeId srcId,
+      bool useLinkMetric,
+      const LinkState::LinkSet& linksToIgnore);
+
+  // Incremental SPF run from srcId. Starts from the distances computed over
+  // prevState.graph and only recomputes nodes whose shortest paths were
+  // affected by the changes since then. Fills spfScratch_ and returns false,
+  // leaving results undefined, if too much of the tree has changed in which
+  // case caller must fall back to runFullSpf()
+  bool runIncrementalSpf(
+      const LinkState::Graph& graph,
+      LinkState::NodeId srcId,
+      const SpfState& prevState);
+
+  // recompute next-hops of all reachable nodes in spfScratch_ from their
+  // distances
+  void computeNextHops(const LinkState::Graph& graph, LinkState::NodeId srcId);
+
+  // returns true if SPF state from srcId should be retained for incremental
+  // runs. We only keep state for ourselves and our direct neighbors
+  bool shouldRetainSpfState(
+      const LinkState::Graph& graph, LinkState::NodeId srcId) const;
+
   // Trace all edge disjoint paths from source to destination node.
   // srcNodeDistances => map indicating distances of each node from source
   // Returns list of paths.
@@ -255,16 +721,96 @@ class SpfSolver::SpfSolverImpl {
       const SpfResult& srcNodeDistances,
       const LinkState::LinkSet& linksToIgnore = {});
 
+  using PrefixIterator = PrefixState::PrefixEntries::const_iterator;
+
+  // A prefix of a route build along with the announcers selected for it
+  struct PrefixAnnouncers {
+    thrift::IpPrefix const* prefix{nullptr};
+    std::unordered_map<std::string, thrift::PrefixEntry> const* nodePrefixes{
+        nullptr};
+    // no route is created for the prefix unless set
+    bool valid{false};
+    bool isV4{false};
+    bool hasBgp{false};
+    bool useKsp2EdAlgo{false};
+    BestPathCalResult dstNodes;
+  };
+
+  // Create unicast routes for prefixes [begin, end) from the cached SPF
+  // results. Prefixes are taken in chunks, the announcers of all prefixes of
+  // a chunk are selected before their routes are created. Each step is timed
+  // once per chunk: BEST_ANNOUNCER, BGP_METRIC_COMPARE for the announcers of
+  // BGP prefixes and routePhase for the routes.
+  // Prefixes using KSP2_ED_ECMP are not computed here but recorded in
+  // prefixToPerformKsp and nodesForKsp, and their routes must be created
+  // afterwards with createKsp2Routes()
+  void createUnicastRoutes(
+      std::string const& myNodeName,
+      std::vector<PrefixIterator> const& prefixes,
+      size_t begin,
+      size_t end,
+      RouteComputePhase routePhase,
+      std::vector<thrift::UnicastRoute>& unicastRoutes,
+      std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+          prefixToPerformKsp,
+      std::unordered_set<std::string>& nodesForKsp);
+
+  // Whether a route is to be created for the prefix of announcers, sets the
+  // attributes of its announcements if so
+  bool checkPrefixAnnouncers(
+      std::string const& myNodeName, PrefixAnnouncers& announcers);
+
+  // Create unicast routes for prefixes on routeBuildExecutor_. Prefixes
+  // are split into contiguous partitions which work on the read-only SPF
+  // results and link state, and are merged back in order so that the output
+  // is identical to a serial run over prefixes
+  void createUnicastRoutesParallel(
+      std::string const& myNodeName,
+      std::vector<PrefixIterator> const& prefixes,
+      std::vector<thrift::UnicastRoute>& unicastRoutes,
+      std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+          prefixToPerformKsp,
+      std::unordered_set<std::string>& nodesForKsp);
+
+  // Create MPLS routes towards node labels of all nodes and for adjacency
+  // labels of myNodeName. Routes of the last build are reused for nodes
+  // whose distance and next hop nodes didn't change, and for adjacencies
+  // as long as links from myNodeName didn't change
+  void createMplsRoutes(
+      std::string const& myNodeName,
+      std::vector<thrift::MplsRoute>& mplsRoutes);
+
+  // order independent fingerprint of the attributes of links from
+  // myNodeName which MPLS routes depend on
+  uint64_t getLocalLinksFingerprint(std::string const& myNodeName) const;
+
+  // Create unicast routes for prefixes recorded by createUnicastRoutes()
+  void createKsp2Routes(
+      std::string const& myNodeName,
+      std::unordered_map<thrift::IpPrefix, BestPathCalResult> const&
+          prefixToPerformKsp,
+      std::unordered_set<std::string> const& nodesForKsp,
+      std::vector<thrift::UnicastRoute>& unicastRoutes);
+
   folly::Optional<thrift::UnicastRoute> createOpenRRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
       std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
-      bool const isV4);
+      bool const isV4,
+      BestPathCalResult const& dstNodes);
+  // next hops of the equivalence class key, computed once per route build.
+  // none if none of the nodes are reachable
+  folly::Optional<std::vector<thrift::NextHopThrift>> getNextHopGroup(
+      std::string const& myNodeName, NextHopGroupKey const& key);
+
+  // forget the next-hop groups of the last route build
+  void clearNextHopGroups();
+
   folly::Optional<thrift::UnicastRoute> createBGPRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
-      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
-      bool const isV4);
+      bool const isV4,
+      BestPathCalResult const& dstInfo);
 
   // helper function to find the nodes for the nexthop for bgp route
   BestPathCalResult findDstNodesForBgpRoute(
@@ -273,6 +819,24 @@ class SpfSolver::SpfSolverImpl {
       std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
       bool const isV4);
 
+  // findDstNodesForBgpRoute, selected again only if the announcements of the
+  // prefix or the reachability of its announcers changed since last time
+  BestPathCalResult findDstNodesForBgpRouteCached(
+      std::string const& myNodeName,
+      thrift::IpPrefix const& prefix,
+      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      bool const isV4);
+
+  // order independent fingerprint of the reachability of the announcers of
+  // a prefix from myNodeName, along with their IGP metric if compared
+  uint64_t getAnnouncersFingerprint(
+      std::string const& myNodeName,
+      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes)
+      const;
+
+  // drop the cached best paths of prefixes
+  void invalidateBgpBestPaths(std::vector<thrift::IpPrefix> const& prefixes);
+
   BestPathCalResult getBestAnnouncingNodes(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
@@ -289,8 +853,9 @@ class SpfSolver::SpfSolverImpl {
   BestPathCalResult maybeFilterDrainedNodes(BestPathCalResult&& result) const;
 
   // given curNode and the dst nodes, find 2spf paths from curNode to each
-  // dstNode
-  std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
+  // dstNode. Paths are cached per link state generation, the returned map
+  // holds the ones of any dstNode computed so far
+  std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>> const&
   createOpenRKsp2EdRouteForNodes(
       std::string const& myNodeName,
       std::unordered_set<std::string> const& nodes);
@@ -344,17 +909,116 @@ class SpfSolver::SpfSolverImpl {
 
   PrefixState prefixState_;
 
+  // set when any node loopback changed since the last full route build
+  bool loopbacksChanged_{false};
+
   // Save all direct next-hop distance from a given source node to a destination
   // node. We update it as we compute all LFA routes from perspective of source
   std::unordered_map<
       std::string /* source nodeName */,
-      unordered_map<
-          string /* otherNodeName */,
-          pair<Metric, unordered_set<string /* nextHopNodeName */>>>>
+      std::shared_ptr<const SpfResult>>
       spfResults_;
 
+  // backup next-hop candidates towards each node, requires computeLfaPaths_
+  LfaTable lfaTable_;
+
+  // source node of spfResults_. SPF results of any other node can't be used
+  // to build routes of this node
+  std::string spfResultsSource_;
+
+  // MPLS routes of the last route build for mplsRoutesSource_, valid while
+  // links from it hash to localLinksFingerprint_
+  struct NodeLabelRoute {
+    int32_t nodeLabel{0};
+    Metric metric{0};
+    std::vector<LinkState::NodeId> nextHopNodes;
+    thrift::MplsRoute route;
+  };
+  std::unordered_map<std::string /* nodeName */, NodeLabelRoute>
+      nodeLabelRoutes_;
+  folly::Optional<std::vector<thrift::MplsRoute>> adjLabelRoutes_;
+  std::string mplsRoutesSource_;
+  uint64_t localLinksFingerprint_{0};
+
+  // KSP2 paths towards destination nodes, computed on link state generation
+  // ksp2PathsGeneration_ from the shortest paths ksp2PathsSpf_
+  std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
+      ksp2Paths_;
+  uint64_t ksp2PathsGeneration_{0};
+  std::shared_ptr<const SpfResult> ksp2PathsSpf_;
+
+  // SPF results computed on link state generation spfCacheGeneration_
+  std::unordered_map<
+      SpfCacheKey,
+      std::shared_ptr<const SpfResult>,
+      SpfCacheKeyHash>
+      spfCache_;
+  uint64_t spfCacheGeneration_{0};
+
+  // reusable working memory for runSpf
+  SpfScratch spfScratch_;
+
+  // SPF state of the previous runs for incremental SPF, keyed by source
+  std::unordered_map<LinkState::NodeId, SpfState> spfStates_;
+
+  // best path selections of BGP prefixes, dropped when the announcements of
+  // their prefix change. Hit only while the announcers' reachability hashes
+  // to fingerprint
+  struct BgpBestPathCacheEntry {
+    uint64_t fingerprint{0};
+    // without bestData, which points into the prefix entries
+    BestPathCalResult result;
+  };
+  struct BgpBestPathCacheShard {
+    std::mutex lock;
+    std::unordered_map<PrefixKey, BgpBestPathCacheEntry> entries;
+  };
+  std::array<BgpBestPathCacheShard, kNumBgpBestPathCacheShards>
+      bgpBestPathCache_;
+
+  // next hops of each equivalence class of Open/R prefixes in the current
+  // route build, shared by all prefixes of the class. Valid as long as link
+  // state and SPF results don't change, i.e. within a route build
+  struct NextHopGroupShard {
+    std::mutex lock;
+    std::unordered_map<
+        NextHopGroupKey,
+        folly::Optional<std::vector<thrift::NextHopThrift>>,
+        NextHopGroupKeyHash>
+        groups;
+  };
+  std::array<NextHopGroupShard, kNumNextHopGroupShards> nextHopGroups_;
+
   // track some stats
-  fbzmq::ThreadData tData_;
+  ThreadLocalStats stats_;
+  ThreadLocalStats::Stat adjDbUpdateStat_;
+  ThreadLocalStats::Stat bgpBestPathCacheHitsStat_;
+  ThreadLocalStats::Stat bgpBestPathCacheMissesStat_;
+  ThreadLocalStats::Stat incompatibleForwardingTypeStat_;
+  ThreadLocalStats::Stat ksp2PathCacheHitsStat_;
+  ThreadLocalStats::Stat ksp2PathCacheMissesStat_;
+  ThreadLocalStats::Histogram lfaTableBuildMsStat_;
+  ThreadLocalStats::Stat missingLoopbackAddrStat_;
+  ThreadLocalStats::Stat nextHopGroupHitsStat_;
+  ThreadLocalStats::Stat nextHopGroupMissesStat_;
+  ThreadLocalStats::Stat noRouteToLabelStat_;
+  ThreadLocalStats::Stat noRouteToPrefixStat_;
+  ThreadLocalStats::Histogram pathBuildMsStat_;
+  ThreadLocalStats::Stat pathBuildRunsStat_;
+  ThreadLocalStats::Histogram partialRouteBuildMsStat_;
+  ThreadLocalStats::Stat partialRouteBuildRunsStat_;
+  ThreadLocalStats::Stat prefixDbUpdateStat_;
+  ThreadLocalStats::Histogram routeBuildMsStat_;
+  ThreadLocalStats::Stat routeBuildRunsStat_;
+  ThreadLocalStats::Stat reusedNodeLabelRoutesStat_;
+  ThreadLocalStats::Stat skippedMplsRouteStat_;
+  ThreadLocalStats::Stat skippedUnicastRouteStat_;
+  ThreadLocalStats::Stat spfCacheHitsStat_;
+  ThreadLocalStats::Stat spfCacheMissesStat_;
+  ThreadLocalStats::Stat spfFullRunsStat_;
+  ThreadLocalStats::Stat spfIncrementalRunsStat_;
+  ThreadLocalStats::Histogram spfMsStat_;
+  ThreadLocalStats::Stat spfRunsStat_;
 
   const std::string myNodeName_;
 
@@ -370,23 +1034,33 @@ class SpfSolver::SpfSolverImpl {
 
   // Use IGP metric in metric vector comparision
   const bool bgpUseIgpMetric_{false};
+
+  // number of threads to create unicast routes with
+  const size_t numRouteBuildThreads_{1};
+
+  // worker pool for route creation, only set if numRouteBuildThreads_ > 1
+  std::unique_ptr<folly::CPUThreadPoolExecutor> routeBuildExecutor_;
+
+  // records durations of route computation phases if set, owned by SpfSolver
+  PhaseProfiler* const phaseProfiler_{nullptr};
 };
 
 std::pair<
     bool /* topology has changed*/,
     bool /* route attributes has changed (nexthop addr, node/adj label */>
 SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
-    thrift::AdjacencyDatabase const& newAdjacencyDb) {
+    thrift::AdjacencyDatabase newAdjacencyDb) {
   LinkStateMetric holdUpTtl = 0, holdDownTtl = 0;
   if (enableOrderedFib_) {
     holdUpTtl = getMyHopsToNode(newAdjacencyDb.thisNodeName);
     holdDownTtl = getMaxHopsToNode(newAdjacencyDb.thisNodeName) - holdUpTtl;
   }
-  tData_.addStatValue("decision.adj_db_update", 1, fbzmq::COUNT);
+  adjDbUpdateStat_.addValue(1);
+  const bool isMyNode = myNodeName_ == newAdjacencyDb.thisNodeName;
   auto rc = linkState_.updateAdjacencyDatabase(
-      newAdjacencyDb, holdUpTtl, holdDownTtl);
+      std::move(newAdjacencyDb), holdUpTtl, holdDownTtl);
   // temporary hack needed to keep UTs happy
-  rc.second = rc.second && myNodeName_ == newAdjacencyDb.thisNodeName;
+  rc.second = rc.second && isMyNode;
   return rc;
 }
 
@@ -400,9 +1074,9 @@ SpfSolver::SpfSolverImpl::getMyHopsToNode(const std::string& nodeName) {
   if (myNodeName_ == nodeName) {
     return 0;
   }
-  auto spfResult = runSpf(myNodeName_, false);
-  if (spfResult.count(nodeName)) {
-    return spfResult.at(nodeName).first;
+  auto metric = getSpfResult(myNodeName_, false)->getMetric(nodeName);
+  if (metric.hasValue()) {
+    return metric.value();
   }
   return getMaxHopsToNode(nodeName);
 }
@@ -410,9 +1084,10 @@ SpfSolver::SpfSolverImpl::getMyHopsToNode(const std::string& nodeName) {
 Metric
 SpfSolver::SpfSolverImpl::getMaxHopsToNode(const std::string& nodeName) {
   Metric max = 0;
-  for (auto const& pathsFromNode : runSpf(nodeName, false)) {
-    max = std::max(max, pathsFromNode.second.first);
-  }
+  getSpfResult(nodeName, false)
+      ->forEachNode([&max](LinkState::NodeId, Metric metric) {
+        max = std::max(max, metric);
+      });
   return max;
 }
 
@@ -433,11 +1108,28 @@ SpfSolver::SpfSolverImpl::getAdjacencyDatabases() {
 
 bool
 SpfSolver::SpfSolverImpl::updatePrefixDatabase(
-    thrift::PrefixDatabase const& prefixDb) {
+    thrift::PrefixDatabase const& prefixDb,
+    std::unordered_set<thrift::IpPrefix>* changedPrefixes) {
   auto const& nodeName = prefixDb.thisNodeName;
   VLOG(1) << "Updating prefix database for node " << nodeName;
-  tData_.addStatValue("decision.prefix_db_update", 1, fbzmq::COUNT);
-  return prefixState_.updatePrefixDatabase(prefixDb);
+  prefixDbUpdateStat_.addValue(1);
+  const auto oldLoopbacks = getNodeHostLoopbacks(prefixState_, nodeName);
+  auto const changes = prefixState_.updatePrefixDatabase(prefixDb);
+  if (changes.empty()) {
+    return false;
+  }
+  if (getNodeHostLoopbacks(prefixState_, nodeName) != oldLoopbacks) {
+    loopbacksChanged_ = true;
+  }
+  invalidateBgpBestPaths(changes.added);
+  invalidateBgpBestPaths(changes.updated);
+  invalidateBgpBestPaths(changes.removed);
+  if (changedPrefixes) {
+    changedPrefixes->insert(changes.added.begin(), changes.added.end());
+    changedPrefixes->insert(changes.updated.begin(), changes.updated.end());
+    changedPrefixes->insert(changes.removed.begin(), changes.removed.end());
+  }
+  return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
@@ -445,128 +1137,408 @@ SpfSolver::SpfSolverImpl::getPrefixDatabases() {
   return prefixState_.getPrefixDatabases();
 }
 
+std::shared_ptr<const SpfResult>
+SpfSolver::SpfSolverImpl::getSpfResult(
+    const std::string& nodeName,
+    bool useLinkMetric,
+    const LinkState::LinkSet& linksToIgnore) {
+  // results of older generations can't be reused
+  if (spfCacheGeneration_ != linkState_.getGeneration()) {
+    spfCache_.clear();
+    spfCacheGeneration_ = linkState_.getGeneration();
+  }
+
+  SpfCacheKey key(nodeName, useLinkMetric, linksToIgnore);
+  auto it = spfCache_.find(key);
+  if (it != spfCache_.end()) {
+    spfCacheHitsStat_.addValue(1);
+    return it->second;
+  }
+  spfCacheMissesStat_.addValue(1);
+
+  if (spfCache_.size() >= Constants::kSpfResultCacheMaxSize) {
+    spfCache_.clear();
+  }
+  auto spfResult = std::make_shared<const SpfResult>(
+      runSpf(nodeName, useLinkMetric, linksToIgnore));
+  spfCache_.emplace(std::move(key), spfResult);
+  return spfResult;
+}
+
 /**
  * Compute shortest-path routes from perspective of nodeName;
+ * Dijkstra runs over the integer indexed CSR view of the link state and
+ * results are kept indexed by node id, see SpfResult.
+ *
+ * Runs using link metrics without any ignored links are incremental whenever
+ * SPF state from a previous run over an older graph is available.
  */
-unordered_map<
-    string /* otherNodeName */,
-    pair<Metric, unordered_set<string /* nextHopNodeName */>>>
+SpfResult
 SpfSolver::SpfSolverImpl::runSpf(
     const std::string& thisNodeName,
     bool useLinkMetric,
     const LinkState::LinkSet& linksToIgnore) {
-  unordered_map<string, pair<Metric, unordered_set<string>>> result;
+  using NodeId = LinkState::NodeId;
 
-  tData_.addStatValue("decision.spf_runs", 1, fbzmq::COUNT);
+  spfRunsStat_.addValue(1);
+  PhaseProfiler::ScopedPhase phase(phaseProfiler_, RouteComputePhase::SPF);
   const auto startTime = std::chrono::steady_clock::now();
 
-  DijkstraQ q;
-  q.insertNode(thisNodeName, 0);
+  const auto maybeSrcId = linkState_.getNodeId(thisNodeName);
+  if (not maybeSrcId.hasValue()) {
+    // unknown node, it doesn't reach any node of the link state
+    return SpfResult(linkState_);
+  }
+  const NodeId srcId = maybeSrcId.value();
+
+  const auto graphPtr = linkState_.getGraphPtr();
+  auto const& graph = *graphPtr;
+  auto& scratch = spfScratch_;
+
+  const bool canBeIncremental = useLinkMetric and linksToIgnore.empty();
+  auto prevStateIt = canBeIncremental ? spfStates_.find(srcId)
+                                      : spfStates_.end();
+  if (prevStateIt != spfStates_.end() and
+      runIncrementalSpf(graph, srcId, prevStateIt->second)) {
+    spfIncrementalRunsStat_.addValue(1);
+  } else {
+    spfFullRunsStat_.addValue(1);
+    runFullSpf(graph, srcId, useLinkMetric, linksToIgnore);
+  }
+
+  // retain state for the next incremental run
+  if (canBeIncremental) {
+    if (shouldRetainSpfState(graph, srcId)) {
+      auto& state = spfStates_[srcId];
+      state.graph = graphPtr;
+      state.distances.assign(
+          scratch.distances.begin(), scratch.distances.end());
+    } else {
+      spfStates_.erase(srcId);
+    }
+  }
+
+  SpfResult result(linkState_, scratch);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
+  spfMsStat_.addValue(deltaTime.count());
+  return result;
+}
+
+/**
+ * Full Dijkstra run.
+ *
+ * Next-hops of every node are kept as a bitset over the direct neighbors of
+ * the source, and all working memory lives in spfScratch_ so that repeated
+ * runs over a topology of similar size do not allocate.
+ */
+void
+SpfSolver::SpfSolverImpl::runFullSpf(
+    const LinkState::Graph& graph,
+    LinkState::NodeId srcId,
+    bool useLinkMetric,
+    const LinkState::LinkSet& linksToIgnore) {
+  using NodeId = LinkState::NodeId;
+  auto& scratch = spfScratch_;
+  scratch.reset(graph, srcId);
+
+  auto& heap = scratch.heap;
+  auto& distances = scratch.distances;
+  auto& settled = scratch.settled;
+  distances[srcId] = 0;
+  heap.push(srcId, 0);
+
   uint64_t loop = 0;
-  for (auto node = q.extractMin(); node; node = q.extractMin()) {
+  while (not heap.empty()) {
+    const NodeId nodeId = heap.pop();
     ++loop;
     // we've found this node's shortest paths. record it
-    auto emplaceRc = result.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(node->nodeName),
-        std::forward_as_tuple(node->distance, std::move(node->nextHops)));
-    CHECK(emplaceRc.second);
-
-    auto& recordedNodeName = emplaceRc.first->first;
-    auto& recordedNodeMetric = emplaceRc.first->second.first;
-    auto& recordedNodeNextHops = emplaceRc.first->second.second;
-
-    if (linkState_.isNodeOverloaded(recordedNodeName) &&
-        recordedNodeName != thisNodeName) {
+    settled[nodeId] = true;
+    scratch.settledOrder.emplace_back(nodeId);
+
+    if (graph.overloaded[nodeId] and nodeId != srcId) {
       // no transit traffic through this node. we've recorded the nexthops to
       // this node, but will not consider any of it's adjancecies as offering
       // lower cost paths towards further away nodes. This effectively drains
       // traffic away from this node
       continue;
     }
-    // we have the shortest path nexthops for recordedNodeName. Use these
-    // nextHops for any node that is connected to recordedNodeName that doesn't
-    // already have a lower cost path from thisNodeName
+    // we have the shortest path nexthops for nodeId. Use these nextHops for
+    // any node that is connected to nodeId that doesn't already have a lower
+    // cost path from thisNodeName
     //
     // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
-    for (const auto& link : linkState_.linksFromNode(recordedNodeName)) {
-      auto otherNodeName = link->getOtherNodeName(recordedNodeName);
-      if (!link->isUp() or result.count(otherNodeName) or
-          linksToIgnore.count(link)) {
+    const Metric nodeMetric = distances[nodeId];
+    for (size_t e = graph.offsets[nodeId]; e < graph.offsets[nodeId + 1]; ++e) {
+      const NodeId otherId = graph.dsts[e];
+      if (settled[otherId] or
+          (not linksToIgnore.empty() and linksToIgnore.count(graph.links[e]))) {
         continue;
       }
-      auto metric =
-          useLinkMetric ? link->getMetricFromNode(recordedNodeName) : 1;
-      auto otherNode = q.get(otherNodeName);
-      if (!otherNode) {
-        q.insertNode(otherNodeName, recordedNodeMetric + metric);
-        otherNode = q.get(otherNodeName);
-      }
-      if (otherNode->distance >= recordedNodeMetric + metric) {
-        // recordedNodeName is either along an alternate shortest path towards
-        // otherNodeName or is along a new shorter path. In either case,
-        // otherNodeName should use recordedNodeName's nextHops until it finds
-        // some shorter path
-        if (otherNode->distance > recordedNodeMetric + metric) {
+      const Metric metric = nodeMetric + (useLinkMetric ? graph.metrics[e] : 1);
+      if (distances[otherId] >= metric) {
+        // nodeId is either along an alternate shortest path towards otherId
+        // or is along a new shorter path. In either case, otherId should use
+        // nodeId's nextHops until it finds some shorter path
+        if (distances[otherId] > metric) {
           // if this is strictly better, forget about any other nexthops
-          otherNode->nextHops.clear();
-          q.decreaseKey(otherNode->nodeName, recordedNodeMetric + metric);
+          scratch.clearNextHops(otherId);
+          distances[otherId] = metric;
+          heap.push(otherId, metric);
         }
-        otherNode->nextHops.insert(
-            recordedNodeNextHops.begin(), recordedNodeNextHops.end());
+        scratch.mergeNextHops(otherId, nodeId);
       }
-      if (otherNode->nextHops.empty()) {
+      if (nodeId == srcId and scratch.hasNoNextHops(otherId)) {
         // this node is directly connected to the source
-        otherNode->nextHops.emplace(otherNode->nodeName);
+        scratch.addNeighborNextHop(otherId);
       }
     }
   }
   VLOG(3) << "Dijkstra loop count: " << loop;
-  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
-  tData_.addStatValue("decision.spf_ms", deltaTime.count(), fbzmq::AVG);
-  return result;
 }
 
-std::vector<Path>
-SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
-    const std::string& srcNodeName,
-    const std::string& dstNodeName,
-    const SpfResult& spfResult,
-    const LinkState::LinkSet& linksToIgnore) {
-  std::vector<Path> paths;
-
-  // Return immediately if destination node is not reachable
-  if (not spfResult.count(dstNodeName)) {
-    return paths;
+/**
+ * Incremental SPF run (in the spirit of Ramalingam-Reps dynamic SSSP)
+ *
+ * 1. Diff the previous graph against the current one to find node pairs whose
+ *    effective edge metric changed
+ * 2. Any node whose old shortest path DAG entry depended on an edge that got
+ *    worse, and all of its DAG descendants, are affected. Their distances are
+ *    reset and re-seeded from unaffected neighbors
+ * 3. Edges that got better are relaxed from their (unaffected) tail
+ * 4. A Dijkstra pass restricted to improved nodes settles new distances
+ * 5. Next-hops are recomputed for all nodes from their distances, which is a
+ *    single linear pass over the edges
+ *
+ * Unaffected nodes keep their previous distance which is still valid since
+ * none of their shortest paths went over a worsened edge.
+ */
+bool
+SpfSolver::SpfSolverImpl::runIncrementalSpf(
+    const LinkState::Graph& graph,
+    LinkState::NodeId srcId,
+    const SpfState& prevState) {
+  using NodeId = LinkState::NodeId;
+  constexpr Metric kInf = std::numeric_limits<Metric>::max();
+
+  auto const& oldGraph = *prevState.graph;
+  const size_t numNodes = graph.numNodes();
+  auto& scratch = spfScratch_;
+  auto& distances = scratch.distances;
+  auto& heap = scratch.heap;
+
+  // node ids are never released hence graphs only ever grow
+  if (numNodes < oldGraph.numNodes() or
+      prevState.distances.size() != oldGraph.numNodes()) {
+    return false;
+  }
+  const size_t maxAffectedNodes = std::max<size_t>(
+      1, numNodes * Constants::kSpfIncrementalMaxAffectedRatio);
+
+  std::vector<EdgeChange> changes;
+  if (&oldGraph != &graph) {
+    changes = diffGraphs(oldGraph, graph, srcId);
+    if (changes.size() > maxAffectedNodes) {
+      VLOG(2) << "Too many topology changes (" << changes.size()
+              << ") for incremental SPF";
+      return false;
+    }
   }
 
-  //
-  // Here we're tracing paths in reverse from destination node. We first pick
-  // neighbors of destination node which are on the shortest paths
-  //
-  std::unordered_set<std::pair<std::string, std::string>> visitedLinks;
-  // Starting with dummy entry for expanding paths
-  std::vector<Path> partialPaths = {{{dstNodeName, nullptr}}};
+  distances.assign(prevState.distances.begin(), prevState.distances.end());
+  distances.resize(numNodes, kInf);
+
+  // Step 2: find affected nodes, by walking the old shortest path DAG from
+  // the head of every tight edge which got worse
+  std::vector<bool> affected(numNodes, false);
+  std::vector<NodeId> affectedNodes;
+  for (auto const& change : changes) {
+    if (change.newMetric <= change.oldMetric or
+        distances[change.src] == kInf or
+        distances[change.src] + change.oldMetric != distances[change.dst] or
+        affected[change.dst]) {
+      continue;
+    }
+    affected[change.dst] = true;
+    affectedNodes.emplace_back(change.dst);
+  }
+  for (size_t i = 0; i < affectedNodes.size(); ++i) {
+    if (affectedNodes.size() > maxAffectedNodes) {
+      VLOG(2) << "Too many affected nodes for incremental SPF";
+      return false;
+    }
+    const NodeId id = affectedNodes[i];
+    if (oldGraph.overloaded[id] and id != srcId) {
+      continue;
+    }
+    for (size_t e = oldGraph.offsets[id]; e < oldGraph.offsets[id + 1]; ++e) {
+      const NodeId dst = oldGraph.dsts[e];
+      if (not affected[dst] and
+          distances[id] + oldGraph.metrics[e] == distances[dst]) {
+        affected[dst] = true;
+        affectedNodes.emplace_back(dst);
+      }
+    }
+  }
+  if (affected[srcId]) {
+    // can only happen with zero metric edges towards the source
+    return false;
+  }
 
-  //
-  // Now recursively trace all the partial paths to the source
-  //
-  while (partialPaths.size()) {
-    auto spurPath = std::move(partialPaths.back());
-    partialPaths.pop_back();
+  heap.reset(numNodes);
+  auto relaxFrom = [&](NodeId id) {
+    if (distances[id] == kInf or (graph.overloaded[id] and id != srcId)) {
+      return;
+    }
+    for (size_t e = graph.offsets[id]; e < graph.offsets[id + 1]; ++e) {
+      const NodeId dst = graph.dsts[e];
+      const Metric metric = distances[id] + graph.metrics[e];
+      if (metric < distances[dst]) {
+        distances[dst] = metric;
+        heap.push(dst, metric);
+      }
+    }
+  };
 
-    const auto spurNode = folly::copy(spurPath.back().first);
+  // re-seed affected nodes from their unaffected neighbors. Links are always
+  // bidirectional hence neighbors of a node are also its predecessors
+  for (const auto id : affectedNodes) {
+    distances[id] = kInf;
+  }
+  for (const auto id : affectedNodes) {
+    for (size_t e = graph.offsets[id]; e < graph.offsets[id + 1]; ++e) {
+      const NodeId nbr = graph.dsts[e];
+      if (not affected[nbr]) {
+        relaxFrom(nbr);
+      }
+    }
+  }
 
-    // Clear dummy entry in the path
-    if (spurNode == dstNodeName) {
-      spurPath.clear();
+  // Step 3: relax edges which got better. overload removal and new links
+  // show up here as well
+  for (auto const& change : changes) {
+    if (change.newMetric < change.oldMetric and not affected[change.src]) {
+      relaxFrom(change.src);
     }
+  }
 
-    // If we have encountered source-node then include this path in
-    // the return value
-    if (spurNode == srcNodeName) {
+  // Step 4: settle improved nodes
+  while (not heap.empty()) {
+    relaxFrom(heap.pop());
+  }
+
+  // Step 5: rebuild settled order and next-hops
+  computeNextHops(graph, srcId);
+
+  VLOG(2) << "Incremental SPF from " << linkState_.getNodeName(srcId)
+          << " processed " << changes.size() << " edge changes, "
+          << affectedNodes.size() << " affected nodes";
+  return true;
+}
+
+void
+SpfSolver::SpfSolverImpl::computeNextHops(
+    const LinkState::Graph& graph, LinkState::NodeId srcId) {
+  using NodeId = LinkState::NodeId;
+  constexpr Metric kInf = std::numeric_limits<Metric>::max();
+  auto& scratch = spfScratch_;
+  auto const& distances = scratch.distances;
+  const size_t numNodes = graph.numNodes();
+
+  scratch.settledOrder.clear();
+  scratch.settled.assign(numNodes, false);
+  for (NodeId id = 0; id < numNodes; ++id) {
+    if (distances[id] != kInf) {
+      scratch.settled[id] = true;
+      scratch.settledOrder.emplace_back(id);
+    }
+  }
+  // same order as the heap would have extracted nodes in
+  std::sort(
+      scratch.settledOrder.begin(),
+      scratch.settledOrder.end(),
+      [&distances](NodeId a, NodeId b) {
+        return std::tie(distances[a], a) < std::tie(distances[b], b);
+      });
+
+  scratch.resetNextHops(graph, srcId);
+  for (const auto id : scratch.settledOrder) {
+    if (graph.overloaded[id] and id != srcId) {
+      continue;
+    }
+    for (size_t e = graph.offsets[id]; e < graph.offsets[id + 1]; ++e) {
+      const NodeId dst = graph.dsts[e];
+      if (dst == srcId or distances[id] + graph.metrics[e] != distances[dst]) {
+        continue;
+      }
+      if (id == srcId) {
+        // this node is directly connected to the source
+        scratch.addNeighborNextHop(dst);
+      } else {
+        scratch.mergeNextHops(dst, id);
+      }
+    }
+  }
+}
+
+bool
+SpfSolver::SpfSolverImpl::shouldRetainSpfState(
+    const LinkState::Graph& graph, LinkState::NodeId srcId) const {
+  const auto myId = linkState_.getNodeId(myNodeName_);
+  if (not myId.hasValue()) {
+    return false;
+  }
+  if (*myId == srcId) {
+    return true;
+  }
+  for (size_t e = graph.offsets[*myId]; e < graph.offsets[*myId + 1]; ++e) {
+    if (graph.dsts[e] == srcId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<Path>
+SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
+    const std::string& srcNodeName,
+    const std::string& dstNodeName,
+    const SpfResult& spfResult,
+    const LinkState::LinkSet& linksToIgnore) {
+  std::vector<Path> paths;
+
+  // Return immediately if destination node is not reachable
+  if (not spfResult.getMetric(dstNodeName).hasValue()) {
+    return paths;
+  }
+
+  //
+  // Here we're tracing paths in reverse from destination node. We first pick
+  // neighbors of destination node which are on the shortest paths
+  //
+  std::unordered_set<std::pair<std::string, std::string>> visitedLinks;
+  // Starting with dummy entry for expanding paths
+  std::vector<Path> partialPaths = {{{dstNodeName, nullptr}}};
+
+  //
+  // Now recursively trace all the partial paths to the source
+  //
+  while (partialPaths.size()) {
+    auto spurPath = std::move(partialPaths.back());
+    partialPaths.pop_back();
+
+    const auto spurNode = folly::copy(spurPath.back().first);
+
+    // Clear dummy entry in the path
+    if (spurNode == dstNodeName) {
+      spurPath.clear();
+    }
+
+    // If we have encountered source-node then include this path in
+    // the return value
+    if (spurNode == srcNodeName) {
       paths.emplace_back(std::move(spurPath));
       continue;
     }
@@ -582,13 +1554,16 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
       // if neighbor node is over loaded skip it.
       auto& nbrName = link->getOtherNodeName(spurNode);
       if (!link->isUp() or linksToIgnore.count(link) or
-          spfResult.find(nbrName) == spfResult.end() or
           linkState_.isNodeOverloaded(nbrName)) {
         continue;
       }
+      const auto maybeNbrMetric = spfResult.getMetric(nbrName);
+      if (not maybeNbrMetric.hasValue()) {
+        continue;
+      }
       auto& nbrIface = link->getIfaceFromNode(nbrName);
-      auto nbrMetric = spfResult.at(nbrName).first;
-      auto spurMetric = spfResult.at(spurNode).first;
+      auto nbrMetric = maybeNbrMetric.value();
+      auto spurMetric = spfResult.getMetric(spurNode).value();
 
       // Ignore already seen neighbor (except source-node)
       if (visitedLinks.count({nbrName, nbrIface})) {
@@ -623,10 +1598,23 @@ SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
   }
 
   auto const& startTime = std::chrono::steady_clock::now();
-  tData_.addStatValue("decision.path_build_runs", 1, fbzmq::COUNT);
+  pathBuildRunsStat_.addValue(1);
+
+  computeSpfResults(myNodeName);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "Decision::buildPaths took " << deltaTime.count() << "ms.";
+  pathBuildMsStat_.addValue(deltaTime.count());
+
+  return buildRouteDb(myNodeName);
+} // buildPaths
 
+void
+SpfSolver::SpfSolverImpl::computeSpfResults(const std::string& myNodeName) {
   spfResults_.clear();
-  spfResults_[myNodeName] = runSpf(myNodeName, true);
+  spfResultsSource_ = myNodeName;
+  spfResults_[myNodeName] = getSpfResult(myNodeName, true);
   if (computeLfaPaths_) {
     // avoid duplicate iterations over a neighbor which can happen due to
     // multiple adjacencies to it
@@ -637,27 +1625,84 @@ SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
       if (!visitedAdjNodes.insert(otherNodeName).second || !link->isUp()) {
         continue;
       }
-      spfResults_[otherNodeName] = runSpf(otherNodeName, true);
+      spfResults_[otherNodeName] = getSpfResult(otherNodeName, true);
+    }
+    computeLfaTable(myNodeName);
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::computeLfaTable(const std::string& myNodeName) {
+  if (lfaTable_.valid and lfaTable_.source == myNodeName and
+      lfaTable_.generation == linkState_.getGeneration()) {
+    return;
+  }
+
+  PhaseProfiler::ScopedPhase phase(phaseProfiler_, RouteComputePhase::LFA);
+  const auto startTime = std::chrono::steady_clock::now();
+  lfaTable_.generation = linkState_.getGeneration();
+  lfaTable_.source = myNodeName;
+  lfaTable_.valid = true;
+  lfaTable_.neighbors.clear();
+  lfaTable_.candidates.clear();
+
+  auto const& shortestPathsFromHere = *spfResults_.at(myNodeName);
+  for (auto const& kv : spfResults_) {
+    auto const& neighborName = kv.first;
+    auto const& shortestPathsFromNeighbor = *kv.second;
+    if (neighborName == myNodeName) {
+      continue;
+    }
+    const auto maybeNeighborToHere =
+        shortestPathsFromNeighbor.getMetric(myNodeName);
+    if (not maybeNeighborToHere.hasValue()) {
+      continue;
     }
+    const auto neighborToHere = maybeNeighborToHere.value();
+    const auto neighborIdx =
+        static_cast<uint32_t>(lfaTable_.neighbors.size());
+    lfaTable_.neighbors.emplace_back(StringInterner::intern(neighborName));
+
+    shortestPathsFromNeighbor.forEachNode(
+        [&](LinkState::NodeId dstId, Metric distanceFromNeighbor) {
+          // Pre-filter with the LFA condition per RFC 5286 against the
+          // shortest distance to dstNode itself. Anycast prefixes check it
+          // again against the shortest distance to any of their nodes, which
+          // can only be lower.
+          if (shortestPathsFromHere.reaches(dstId) and
+              distanceFromNeighbor >=
+                  shortestPathsFromHere.getMetric(dstId) + neighborToHere) {
+            return;
+          }
+          lfaTable_.candidates[linkState_.getNodeName(dstId)].push_back(
+              LfaCandidate{neighborIdx, distanceFromNeighbor, neighborToHere});
+        });
   }
 
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "Decision::buildPaths took " << deltaTime.count() << "ms.";
-  tData_.addStatValue("decision.path_build_ms", deltaTime.count(), fbzmq::AVG);
-
-  return buildRouteDb(myNodeName);
-} // buildPaths
+  lfaTableBuildMsStat_.addValue(deltaTime.count());
+}
 
 folly::Optional<thrift::RouteDatabase>
 SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
-  if (not linkState_.hasNode(myNodeName) or
-      spfResults_.count(myNodeName) == 0) {
+  if (not linkState_.hasNode(myNodeName)) {
+    return folly::none;
+  }
+
+  // spfResults_ were last computed for another node e.g. via
+  // getDecisionRouteDb, compute them again for this one
+  if (not spfResults_.empty() and spfResultsSource_ != myNodeName) {
+    computeSpfResults(myNodeName);
+  }
+  if (spfResults_.count(myNodeName) == 0) {
     return folly::none;
   }
 
   const auto startTime = std::chrono::steady_clock::now();
-  tData_.addStatValue("decision.route_build_runs", 1, fbzmq::COUNT);
+  routeBuildRunsStat_.addValue(1);
+  loopbacksChanged_ = false;
+  clearNextHopGroups();
 
   thrift::RouteDatabase routeDb;
   routeDb.thisNodeName = myNodeName;
@@ -669,98 +1714,94 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
 
   std::unordered_set<std::string> nodesForKsp;
 
-  for (const auto& kv : prefixState_.prefixes()) {
-    const auto& prefix = kv.first;
-    const auto& nodePrefixes = kv.second;
-
-    bool hasBGP = false, hasNonBGP = false, missingMv = false;
-    bool hasSpEcmp = false, hasKsp2EdEcmp = false;
-    for (auto const& npKv : nodePrefixes) {
-      bool isBGP = npKv.second.type == thrift::PrefixType::BGP;
-      hasBGP |= isBGP;
-      hasNonBGP |= !isBGP;
-      if (isBGP and not npKv.second.mv.hasValue()) {
-        missingMv = true;
-        LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second.prefix)
-                   << " advertised by " << npKv.first
-                   << " is of type BGP but does not contain a metric vector.";
-      }
-      hasSpEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      hasKsp2EdEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
-    }
-
-    // skip adding route for BGP prefixes that have issues
-    if (hasBGP) {
-      if (hasNonBGP) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " which is advertised with BGP and non-BGP type.";
-        tData_.addStatValue("decision.skipped_unicast_route", 1, fbzmq::COUNT);
-        continue;
-      }
-      if (missingMv) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " at least one advertiser is missing its metric vector.";
-        tData_.addStatValue("decision.skipped_unicast_route", 1, fbzmq::COUNT);
-        continue;
-      }
-    }
-
-    // skip adding route for prefixes advertised by this node
-    if (nodePrefixes.count(myNodeName) and not hasBGP) {
-      continue;
-    }
+  auto const& prefixes = prefixState_.prefixes();
+  std::vector<PrefixIterator> prefixIters;
+  prefixIters.reserve(prefixes.size());
+  for (auto it = prefixes.cbegin(); it != prefixes.cend(); ++it) {
+    prefixIters.emplace_back(it);
+  }
+  if (routeBuildExecutor_ and
+      prefixIters.size() >= Constants::kParallelRouteBuildMinPrefixes) {
+    createUnicastRoutesParallel(
+        myNodeName,
+        prefixIters,
+        routeDb.unicastRoutes,
+        prefixToPerformKsp,
+        nodesForKsp);
+  } else {
+    createUnicastRoutes(
+        myNodeName,
+        prefixIters,
+        0,
+        prefixIters.size(),
+        RouteComputePhase::UNICAST_ROUTES,
+        routeDb.unicastRoutes,
+        prefixToPerformKsp,
+        nodesForKsp);
+  }
 
-    // Check for enabledV4_
-    auto prefixStr = prefix.prefixAddress.addr;
-    bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
-    if (isV4Prefix && !enableV4_) {
-      LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
-      tData_.addStatValue("decision.skipped_unicast_route", 1, fbzmq::COUNT);
-      continue;
-    }
+  createKsp2Routes(
+      myNodeName, prefixToPerformKsp, nodesForKsp, routeDb.unicastRoutes);
 
-    const auto forwardingAlgorithm = hasKsp2EdEcmp and not hasSpEcmp
-        ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
-        : thrift::PrefixForwardingAlgorithm::SP_ECMP;
+  //
+  // Create MPLS routes for all nodeLabel and for all of our adjacencies
+  //
+  {
+    PhaseProfiler::ScopedPhase mplsPhase(
+        phaseProfiler_, RouteComputePhase::MPLS_ROUTES);
+    createMplsRoutes(myNodeName, routeDb.mplsRoutes);
+  }
 
-    if (forwardingAlgorithm == thrift::PrefixForwardingAlgorithm::SP_ECMP) {
-      auto route = hasBGP
-          ? createBGPRoute(myNodeName, prefix, nodePrefixes, isV4Prefix)
-          : createOpenRRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
-      if (route.hasValue()) {
-        routeDb.unicastRoutes.emplace_back(std::move(route.value()));
-      }
-    } else {
-      const auto nodes = getBestAnnouncingNodes(
-          myNodeName, prefix, nodePrefixes, isV4Prefix, hasBGP, true);
-      if (nodes.success && nodes.nodes.size() != 0) {
-        prefixToPerformKsp[prefix] = nodes;
-        for (const auto& node : nodes.nodes) {
-          nodesForKsp.insert(node);
-        }
-      }
-    }
-  } // for prefixState_.prefixes()
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  routeBuildMsStat_.addValue(deltaTime.count());
+  return routeDb;
+} // buildRouteDb
 
-  auto routeToNodes = createOpenRKsp2EdRouteForNodes(myNodeName, nodesForKsp);
+uint64_t
+SpfSolver::SpfSolverImpl::getLocalLinksFingerprint(
+    const std::string& myNodeName) const {
+  // sum of mixed hashes, so that order of links doesn't matter
+  uint64_t fingerprint = 0;
+  for (const auto& link : linkState_.linksFromNode(myNodeName)) {
+    const auto& otherNodeName = link->getOtherNodeName(myNodeName);
+    const auto& ifName = link->getIfaceFromNode(myNodeName);
+    const auto& nhV6 = link->getNhV6FromNode(myNodeName).addr;
+    auto hash = folly::hash::SpookyHashV2::Hash64(
+        otherNodeName.data(), otherNodeName.size(), 0);
+    hash =
+        folly::hash::SpookyHashV2::Hash64(ifName.data(), ifName.size(), hash);
+    hash = folly::hash::SpookyHashV2::Hash64(nhV6.data(), nhV6.size(), hash);
+    hash = folly::hash::hash_128_to_64(
+        hash, static_cast<uint64_t>(link->getMetricFromNode(myNodeName)));
+    hash = folly::hash::hash_128_to_64(
+        hash, static_cast<uint32_t>(link->getAdjLabelFromNode(myNodeName)));
+    hash = folly::hash::hash_128_to_64(hash, link->isUp());
+    fingerprint += folly::hash::twang_mix64(hash);
+  }
+  return fingerprint;
+}
 
-  for (const auto& kv : prefixToPerformKsp) {
-    auto unicastRoute = selectKsp2Routes(
-        kv.first,
-        myNodeName,
-        kv.second,
-        routeToNodes,
-        prefixState_.prefixes().at(kv.first));
-    if (unicastRoute.hasValue()) {
-      routeDb.unicastRoutes.emplace_back(std::move(unicastRoute.value()));
-    }
+void
+SpfSolver::SpfSolverImpl::createMplsRoutes(
+    const std::string& myNodeName, std::vector<thrift::MplsRoute>& mplsRoutes) {
+  // Label routes only depend on links from myNodeName besides the SPF
+  // results. Start over if they changed, or if LFA paths are computed as
+  // those depend on the SPF results of neighbors as well
+  const auto localLinksFingerprint = getLocalLinksFingerprint(myNodeName);
+  const bool reuseRoutes = not computeLfaPaths_ and
+      mplsRoutesSource_ == myNodeName and
+      localLinksFingerprint_ == localLinksFingerprint;
+  if (not reuseRoutes) {
+    nodeLabelRoutes_.clear();
+    adjLabelRoutes_.clear();
+    mplsRoutesSource_ = myNodeName;
+    localLinksFingerprint_ = localLinksFingerprint;
   }
 
-  //
-  // Create MPLS routes for all nodeLabel
-  //
+  auto const& shortestPathsFromHere = *spfResults_.at(myNodeName);
+  std::unordered_map<std::string, NodeLabelRoute> nodeLabelRoutes;
   for (const auto& kv : linkState_.getAdjacencyDatabases()) {
     const auto& adjDb = kv.second;
     const auto topLabel = adjDb.nodeLabel;
@@ -772,7 +1813,7 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
     if (not isMplsLabelValid(topLabel)) {
       LOG(ERROR) << "Ignoring invalid node label " << topLabel << " of node "
                  << adjDb.thisNodeName;
-      tData_.addStatValue("decision.skipped_mpls_route", 1, fbzmq::COUNT);
+      skippedMplsRouteStat_.addValue(1);
       continue;
     }
 
@@ -781,18 +1822,39 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
       thrift::NextHopThrift nh;
       nh.address = toBinaryAddress(folly::IPAddressV6("::"));
       nh.mplsAction = createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
-      routeDb.mplsRoutes.emplace_back(
-          createMplsRoute(topLabel, {std::move(nh)}));
+      mplsRoutes.emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
       continue;
     }
 
+    // Reuse the route of the last build if the distance and next hop nodes
+    // towards the node are the same
+    const auto dstId = linkState_.getNodeId(adjDb.thisNodeName);
+    const bool isReachable =
+        dstId.hasValue() and shortestPathsFromHere.reaches(dstId.value());
+    std::vector<LinkState::NodeId> nextHopNodes;
+    if (isReachable) {
+      nextHopNodes = shortestPathsFromHere.getNextHops(dstId.value());
+      auto routeIt = nodeLabelRoutes_.find(adjDb.thisNodeName);
+      if (routeIt != nodeLabelRoutes_.end() and
+          routeIt->second.nodeLabel == topLabel and
+          routeIt->second.metric ==
+              shortestPathsFromHere.getMetric(dstId.value()) and
+          routeIt->second.nextHopNodes == nextHopNodes) {
+        reusedNodeLabelRoutesStat_.addValue(1);
+        mplsRoutes.emplace_back(routeIt->second.route);
+        nodeLabelRoutes.emplace(
+            adjDb.thisNodeName, std::move(routeIt->second));
+        continue;
+      }
+    }
+
     // Get best nexthop towards the node
     auto metricNhs =
         getNextHopsWithMetric(myNodeName, {adjDb.thisNodeName}, false);
     if (metricNhs.second.empty()) {
       LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
                    << " of node " << adjDb.thisNodeName;
-      tData_.addStatValue("decision.no_route_to_label", 1, fbzmq::COUNT);
+      noRouteToLabelStat_.addValue(1);
       continue;
     }
 
@@ -808,13 +1870,29 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
         metricNhs.first,
         metricNhs.second,
         topLabel);
-    routeDb.mplsRoutes.emplace_back(
+    mplsRoutes.emplace_back(
         createMplsRoute(topLabel, std::move(nextHopsThrift)));
+    if (isReachable) {
+      nodeLabelRoutes.emplace(
+          adjDb.thisNodeName,
+          NodeLabelRoute{topLabel,
+                         shortestPathsFromHere.getMetric(dstId.value()),
+                         std::move(nextHopNodes),
+                         mplsRoutes.back()});
+    }
   }
+  // drops routes of nodes which are gone or lost their label
+  nodeLabelRoutes_ = std::move(nodeLabelRoutes);
 
   //
   // Create MPLS routes for all of our adjacencies
   //
+  if (adjLabelRoutes_.hasValue()) {
+    mplsRoutes.insert(
+        mplsRoutes.end(), adjLabelRoutes_->begin(), adjLabelRoutes_->end());
+    return;
+  }
+  adjLabelRoutes_.emplace();
   for (const auto& link : linkState_.linksFromNode(myNodeName)) {
     const auto topLabel = link->getAdjLabelFromNode(myNodeName);
     // Top label is not set => Non-SR mode
@@ -825,7 +1903,7 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
     if (not isMplsLabelValid(topLabel)) {
       LOG(ERROR) << "Ignoring invalid adjacency label " << topLabel
                  << " of link " << link->directionalToString(myNodeName);
-      tData_.addStatValue("decision.skipped_mpls_route", 1, fbzmq::COUNT);
+      skippedMplsRouteStat_.addValue(1);
       continue;
     }
 
@@ -834,15 +1912,306 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
         link->getIfaceFromNode(myNodeName),
         link->getMetricFromNode(myNodeName),
         createMplsAction(thrift::MplsActionCode::PHP));
-    routeDb.mplsRoutes.emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
+    adjLabelRoutes_->emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
+  }
+  mplsRoutes.insert(
+      mplsRoutes.end(), adjLabelRoutes_->begin(), adjLabelRoutes_->end());
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::SpfSolverImpl::buildRouteDbDelta(
+    const std::string& myNodeName,
+    const std::unordered_set<thrift::IpPrefix>& prefixes) {
+  if (not linkState_.hasNode(myNodeName) or
+      spfResults_.count(myNodeName) == 0 or
+      spfResultsSource_ != myNodeName) {
+    return folly::none;
+  }
+
+  // Node loopbacks are used as next-hops of BGP and KSP2 routes towards any
+  // prefix. Changes to them need a full route build.
+  if (loopbacksChanged_) {
+    return folly::none;
   }
 
+  const auto startTime = std::chrono::steady_clock::now();
+  partialRouteBuildRunsStat_.addValue(1);
+  clearNextHopGroups();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = myNodeName;
+
+  std::unordered_map<thrift::IpPrefix, BestPathCalResult> prefixToPerformKsp;
+  std::unordered_set<std::string> nodesForKsp;
+
+  std::vector<PrefixIterator> prefixIters;
+  prefixIters.reserve(prefixes.size());
+  for (const auto& prefix : prefixes) {
+    auto it = prefixState_.prefixes().find(PrefixKey(prefix));
+    if (it != prefixState_.prefixes().end()) {
+      prefixIters.emplace_back(it);
+    }
+  }
+  createUnicastRoutes(
+      myNodeName,
+      prefixIters,
+      0,
+      prefixIters.size(),
+      RouteComputePhase::ROUTE_DELTA,
+      routeDbDelta.unicastRoutesToUpdate,
+      prefixToPerformKsp,
+      nodesForKsp);
+
+  createKsp2Routes(
+      myNodeName,
+      prefixToPerformKsp,
+      nodesForKsp,
+      routeDbDelta.unicastRoutesToUpdate);
+
+  // Changed prefixes without a route are either withdrawn or unreachable
+  std::unordered_set<thrift::IpPrefix> prefixesToDelete(prefixes);
+  for (const auto& route : routeDbDelta.unicastRoutesToUpdate) {
+    prefixesToDelete.erase(route.dest);
+  }
+  routeDbDelta.unicastRoutesToDelete.assign(
+      prefixesToDelete.begin(), prefixesToDelete.end());
+
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
-  tData_.addStatValue("decision.route_build_ms", deltaTime.count(), fbzmq::AVG);
-  return routeDb;
-} // buildRouteDb
+  VLOG(1) << "Decision::buildRouteDbDelta for " << prefixes.size()
+          << " prefixes took " << deltaTime.count() << "ms.";
+  partialRouteBuildMsStat_.addValue(deltaTime.count());
+  return routeDbDelta;
+} // buildRouteDbDelta
+
+bool
+SpfSolver::SpfSolverImpl::checkPrefixAnnouncers(
+    std::string const& myNodeName, PrefixAnnouncers& announcers) {
+  auto const& prefix = *announcers.prefix;
+  auto const& nodePrefixes = *announcers.nodePrefixes;
+  bool hasBGP = false, hasNonBGP = false, missingMv = false;
+  bool hasSpEcmp = false, hasKsp2EdEcmp = false;
+  for (auto const& npKv : nodePrefixes) {
+    bool isBGP = npKv.second.type == thrift::PrefixType::BGP;
+    hasBGP |= isBGP;
+    hasNonBGP |= !isBGP;
+    if (isBGP and not npKv.second.mv.hasValue()) {
+      missingMv = true;
+      LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second.prefix)
+                 << " advertised by " << npKv.first
+                 << " is of type BGP but does not contain a metric vector.";
+    }
+    hasSpEcmp |= npKv.second.forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::SP_ECMP;
+    hasKsp2EdEcmp |= npKv.second.forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
+  }
+
+  // skip adding route for BGP prefixes that have issues
+  if (hasBGP) {
+    if (hasNonBGP) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " which is advertised with BGP and non-BGP type.";
+      skippedUnicastRouteStat_.addValue(1);
+      return false;
+    }
+    if (missingMv) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " at least one advertiser is missing its metric vector.";
+      skippedUnicastRouteStat_.addValue(1);
+      return false;
+    }
+  }
+
+  // skip adding route for prefixes advertised by this node
+  if (nodePrefixes.count(myNodeName) and not hasBGP) {
+    return false;
+  }
+
+  // Check for enabledV4_
+  auto prefixStr = prefix.prefixAddress.addr;
+  bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
+  if (isV4Prefix && !enableV4_) {
+    LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
+    skippedUnicastRouteStat_.addValue(1);
+    return false;
+  }
+
+  announcers.valid = true;
+  announcers.isV4 = isV4Prefix;
+  announcers.hasBgp = hasBGP;
+  announcers.useKsp2EdAlgo = hasKsp2EdEcmp and not hasSpEcmp;
+  return true;
+}
+
+void
+SpfSolver::SpfSolverImpl::createUnicastRoutes(
+    std::string const& myNodeName,
+    std::vector<PrefixIterator> const& prefixes,
+    size_t begin,
+    size_t end,
+    RouteComputePhase routePhase,
+    std::vector<thrift::UnicastRoute>& unicastRoutes,
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+        prefixToPerformKsp,
+    std::unordered_set<std::string>& nodesForKsp) {
+  const size_t chunkSize = Constants::kRouteBuildChunkSize;
+  std::vector<PrefixAnnouncers> chunk;
+  chunk.reserve(std::min(end - begin, chunkSize));
+  for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+    const size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+    chunk.clear();
+
+    // announcers of Open/R prefixes, BGP ones are compared separately
+    bool hasBgp = false;
+    {
+      PhaseProfiler::ScopedPhase phase(
+          phaseProfiler_, RouteComputePhase::BEST_ANNOUNCER);
+      for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+        chunk.emplace_back();
+        auto& announcers = chunk.back();
+        announcers.prefix = &prefixes[i]->second.begin()->second.prefix;
+        announcers.nodePrefixes = &prefixes[i]->second;
+        if (not checkPrefixAnnouncers(myNodeName, announcers)) {
+          continue;
+        }
+        if (announcers.hasBgp) {
+          hasBgp = true;
+          continue;
+        }
+        announcers.dstNodes = getBestAnnouncingNodes(
+            myNodeName,
+            *announcers.prefix,
+            *announcers.nodePrefixes,
+            announcers.isV4,
+            false,
+            announcers.useKsp2EdAlgo);
+      }
+    }
+
+    if (hasBgp) {
+      PhaseProfiler::ScopedPhase phase(
+          phaseProfiler_, RouteComputePhase::BGP_METRIC_COMPARE);
+      for (auto& announcers : chunk) {
+        if (not announcers.valid or not announcers.hasBgp) {
+          continue;
+        }
+        announcers.dstNodes = getBestAnnouncingNodes(
+            myNodeName,
+            *announcers.prefix,
+            *announcers.nodePrefixes,
+            announcers.isV4,
+            true,
+            announcers.useKsp2EdAlgo);
+      }
+    }
+
+    PhaseProfiler::ScopedPhase phase(phaseProfiler_, routePhase);
+    for (auto& announcers : chunk) {
+      if (not announcers.valid) {
+        continue;
+      }
+      auto const& prefix = *announcers.prefix;
+      auto& nodes = announcers.dstNodes;
+      if (announcers.useKsp2EdAlgo) {
+        if (nodes.success && nodes.nodes.size() != 0) {
+          nodesForKsp.insert(nodes.nodes.begin(), nodes.nodes.end());
+          prefixToPerformKsp[prefix] = std::move(nodes);
+        }
+        continue;
+      }
+      auto route = announcers.hasBgp
+          ? createBGPRoute(myNodeName, prefix, announcers.isV4, nodes)
+          : createOpenRRoute(
+                myNodeName,
+                prefix,
+                *announcers.nodePrefixes,
+                announcers.isV4,
+                nodes);
+      if (route.hasValue()) {
+        unicastRoutes.emplace_back(std::move(route.value()));
+      }
+    }
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::createUnicastRoutesParallel(
+    std::string const& myNodeName,
+    std::vector<PrefixIterator> const& prefixIters,
+    std::vector<thrift::UnicastRoute>& unicastRoutes,
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+        prefixToPerformKsp,
+    std::unordered_set<std::string>& nodesForKsp) {
+  struct Partition {
+    std::vector<thrift::UnicastRoute> unicastRoutes;
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult> prefixToPerformKsp;
+    std::unordered_set<std::string> nodesForKsp;
+  };
+
+  // few partitions per thread to even out the cost of different prefixes
+  const size_t numPartitions =
+      std::min(prefixIters.size(), numRouteBuildThreads_ * 4);
+  std::vector<Partition> partitions(numPartitions);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numPartitions);
+  for (size_t i = 0; i < numPartitions; ++i) {
+    futures.emplace_back(folly::via(routeBuildExecutor_.get(), [&, i]() {
+      auto& partition = partitions[i];
+      createUnicastRoutes(
+          myNodeName,
+          prefixIters,
+          i * prefixIters.size() / numPartitions,
+          (i + 1) * prefixIters.size() / numPartitions,
+          RouteComputePhase::UNICAST_ROUTES,
+          partition.unicastRoutes,
+          partition.prefixToPerformKsp,
+          partition.nodesForKsp);
+    }));
+  }
+  folly::collect(futures).get();
+
+  // merge partitions in order
+  unicastRoutes.reserve(unicastRoutes.size() + prefixIters.size());
+  for (auto& partition : partitions) {
+    std::move(
+        partition.unicastRoutes.begin(),
+        partition.unicastRoutes.end(),
+        std::back_inserter(unicastRoutes));
+    prefixToPerformKsp.insert(
+        partition.prefixToPerformKsp.begin(),
+        partition.prefixToPerformKsp.end());
+    nodesForKsp.insert(
+        partition.nodesForKsp.begin(), partition.nodesForKsp.end());
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::createKsp2Routes(
+    std::string const& myNodeName,
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult> const&
+        prefixToPerformKsp,
+    std::unordered_set<std::string> const& nodesForKsp,
+    std::vector<thrift::UnicastRoute>& unicastRoutes) {
+  if (prefixToPerformKsp.empty()) {
+    return;
+  }
+  PhaseProfiler::ScopedPhase phase(phaseProfiler_, RouteComputePhase::KSP2);
+  auto const& routeToNodes =
+      createOpenRKsp2EdRouteForNodes(myNodeName, nodesForKsp);
+
+  for (const auto& kv : prefixToPerformKsp) {
+    auto unicastRoute = selectKsp2Routes(
+        kv.first,
+        myNodeName,
+        kv.second,
+        routeToNodes,
+        prefixState_.prefixes().at(PrefixKey(kv.first)));
+    if (unicastRoute.hasValue()) {
+      unicastRoutes.emplace_back(std::move(unicastRoute.value()));
+    }
+  }
+}
 
 BestPathCalResult
 SpfSolver::SpfSolverImpl::getBestAnnouncingNodes(
@@ -861,8 +2230,7 @@ SpfSolver::SpfSolverImpl::getBestAnnouncingNodes(
                    << TEnumTraits<thrift::PrefixForwardingType>::findName(
                           nodePrefix.second.forwardingType)
                    << " for algorithm KSP2_ED_ECMP;";
-        tData_.addStatValue(
-            "decision.incompatible_forwarding_type", 1, fbzmq::COUNT);
+        incompatibleForwardingTypeStat_.addValue(1);
         return dstNodes;
       }
     }
@@ -884,12 +2252,12 @@ SpfSolver::SpfSolverImpl::getBestAnnouncingNodes(
   // for bgp route, we need to run best path calculation algorithm to get
   // the nodes
   auto bestPathCalRes =
-      findDstNodesForBgpRoute(myNodeName, prefix, nodePrefixes, isV4);
+      findDstNodesForBgpRouteCached(myNodeName, prefix, nodePrefixes, isV4);
   if (bestPathCalRes.success && (not bestPathCalRes.nodes.count(myNodeName))) {
     return maybeFilterDrainedNodes(std::move(bestPathCalRes));
   } else if (not bestPathCalRes.success) {
     LOG(WARNING) << "No route to BGP prefix " << toString(prefix);
-    tData_.addStatValue("decision.no_route_to_prefix", 1, fbzmq::COUNT);
+    noRouteToPrefixStat_.addValue(1);
   } else {
     VLOG(2) << "Ignoring route to BGP prefix " << toString(prefix)
             << ". Best path originated by self.";
@@ -935,103 +2303,151 @@ SpfSolver::SpfSolverImpl::createOpenRRoute(
     std::string const& myNodeName,
     thrift::IpPrefix const& prefix,
     std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
-    bool const isV4) {
-  // Prepare list of nodes announcing the prefix
-  const auto dstNodes = getBestAnnouncingNodes(
-      myNodeName, prefix, nodePrefixes, isV4, false, false);
+    bool const isV4,
+    BestPathCalResult const& dstNodes) {
   if (not dstNodes.success) {
     return folly::none;
   }
 
-  std::set<std::string> prefixNodes = dstNodes.nodes;
-
   const bool perDestination = getPrefixForwardingType(nodePrefixes) ==
       thrift::PrefixForwardingType::SR_MPLS;
 
-  const auto metricNhs =
-      getNextHopsWithMetric(myNodeName, prefixNodes, perDestination);
-  if (metricNhs.second.empty()) {
+  // Prefixes announced by the same nodes share their next hops
+  const NextHopGroupKey key(dstNodes.nodes, isV4, perDestination);
+  auto nextHops = getNextHopGroup(myNodeName, key);
+  if (not nextHops.hasValue()) {
     LOG(WARNING) << "No route to prefix " << toString(prefix)
-                 << ", advertised by: " << folly::join(", ", prefixNodes);
-    tData_.addStatValue("decision.no_route_to_prefix", 1, fbzmq::COUNT);
+                 << ", advertised by: " << folly::join(", ", key.nodes);
+    noRouteToPrefixStat_.addValue(1);
     return folly::none;
   }
 
-  // Convert list of neighbor nodes to nexthops (considering adjacencies)
-  return createUnicastRoute(
-      prefix,
-      getNextHopsThrift(
-          myNodeName,
-          prefixNodes,
-          isV4,
-          perDestination,
-          metricNhs.first,
-          metricNhs.second,
-          folly::none));
+  return createUnicastRoute(prefix, std::move(nextHops.value()));
 }
 
-BestPathCalResult
-SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
-    std::string const& myNodeName,
-    thrift::IpPrefix const& prefix,
-    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
-    bool const isV4) {
-  BestPathCalResult ret;
-  const auto& mySpfResult = spfResults_.at(myNodeName);
-  for (auto const& kv : nodePrefixes) {
-    auto const& nodeName = kv.first;
-    auto const& prefixEntry = kv.second;
+folly::Optional<std::vector<thrift::NextHopThrift>>
+SpfSolver::SpfSolverImpl::getNextHopGroup(
+    std::string const& myNodeName, NextHopGroupKey const& key) {
+  auto& shard = nextHopGroups_[key.hash % nextHopGroups_.size()];
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.groups.find(key);
+    if (it != shard.groups.end()) {
+      nextHopGroupHitsStat_.addValue(1);
+      return it->second;
+    }
+  }
 
-    // Skip unreachable nodes
-    auto it = mySpfResult.find(nodeName);
-    if (it == mySpfResult.end()) {
-      LOG(ERROR) << "No route to " << nodeName
+  nextHopGroupMissesStat_.addValue(1);
+  folly::Optional<std::vector<thrift::NextHopThrift>> nextHops;
+  const auto metricNhs =
+      getNextHopsWithMetric(myNodeName, key.nodes, key.perDestination);
+  if (not metricNhs.second.empty()) {
+    // Convert list of neighbor nodes to nexthops (considering adjacencies)
+    nextHops = getNextHopsThrift(
+        myNodeName,
+        key.nodes,
+        key.isV4,
+        key.perDestination,
+        metricNhs.first,
+        metricNhs.second,
+        folly::none);
+  }
+  std::lock_guard<std::mutex> lock(shard.lock);
+  shard.groups.emplace(key, nextHops);
+  return nextHops;
+}
+
+void
+SpfSolver::SpfSolverImpl::clearNextHopGroups() {
+  for (auto& shard : nextHopGroups_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.groups.clear();
+  }
+}
+
+BestPathCalResult
+SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
+    std::string const& myNodeName,
+    thrift::IpPrefix const& prefix,
+    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    bool const isV4) {
+  constexpr auto kIgpCostType =
+      static_cast<int64_t>(thrift::MetricEntityType::OPENR_IGP_COST);
+  BestPathCalResult ret;
+  const auto& mySpfResult = *spfResults_.at(myNodeName);
+  // scratch copy of the metric vector being compared, reused across nodes
+  MetricVectorUtils::CompiledMetricVector augmented;
+  for (auto const& kv : nodePrefixes) {
+    auto const& nodeName = kv.first;
+    auto const& prefixEntry = kv.second;
+
+    // Skip unreachable nodes
+    const auto nodeMetric = mySpfResult.getMetric(nodeName);
+    if (not nodeMetric.hasValue()) {
+      LOG(ERROR) << "No route to " << nodeName
                  << ". Skipping considering this.";
       // skip if no route to node
       continue;
     }
 
+    // Metric vectors are compiled when received, only copied if we need to
+    // augment them with IGP_COST
+    auto const* metricVector =
+        prefixState_.getCompiledMetricVector(prefixEntry);
+    if (not metricVector) {
+      augmented =
+          MetricVectorUtils::compileMetricVector(prefixEntry.mv.value());
+      metricVector = &augmented;
+    }
+
     // Sanity check that OPENR_IGP_COST shouldn't exist
-    if (MetricVectorUtils::getMetricEntityByType(
-            prefixEntry.mv.value(),
-            static_cast<int64_t>(thrift::MetricEntityType::OPENR_IGP_COST))) {
+    if (std::any_of(
+            metricVector->entities.begin(),
+            metricVector->entities.end(),
+            [](MetricVectorUtils::CompiledMetricVector::Entity const& e) {
+              return kIgpCostType == e.type;
+            })) {
       LOG(ERROR) << "Received unexpected metric entity OPENR_IGP_COST in metric"
                  << " vector for prefix " << toString(prefix) << " from node "
                  << nodeName << ". Ignoring";
       continue;
     }
 
-    // Copy is intentional - As we will need to augment metric vector with
-    // IGP_COST
-    thrift::MetricVector metricVector = prefixEntry.mv.value();
-
     // Associate IGP_COST to prefixEntry
     if (bgpUseIgpMetric_) {
-      const auto igpMetric = static_cast<int64_t>(it->second.first);
+      const auto igpMetric = static_cast<int64_t>(nodeMetric.value());
       if (not ret.bestIgpMetric.hasValue() or
           *(ret.bestIgpMetric) > igpMetric) {
         ret.bestIgpMetric = igpMetric;
       }
-      metricVector.metrics.emplace_back(MetricVectorUtils::createMetricEntity(
-          static_cast<int64_t>(thrift::MetricEntityType::OPENR_IGP_COST),
-          static_cast<int64_t>(thrift::MetricEntityPriority::OPENR_IGP_COST),
-          thrift::CompareType::WIN_IF_NOT_PRESENT,
-          false, /* isBestPathTieBreaker */
-          /* lowest metric wins */
-          {-1 * igpMetric}));
+      if (metricVector != &augmented) {
+        augmented = *metricVector;
+        metricVector = &augmented;
+      }
+      MetricVectorUtils::addMetricEntity(
+          augmented,
+          MetricVectorUtils::createMetricEntity(
+              kIgpCostType,
+              static_cast<int64_t>(
+                  thrift::MetricEntityPriority::OPENR_IGP_COST),
+              thrift::CompareType::WIN_IF_NOT_PRESENT,
+              false, /* isBestPathTieBreaker */
+              /* lowest metric wins */
+              {-1 * igpMetric}));
       VLOG(2) << "Attaching IGP metric of " << igpMetric << " to prefix "
               << toString(prefix) << " for node " << nodeName;
     }
 
     switch (ret.bestVector.hasValue()
                 ? MetricVectorUtils::compareMetricVectors(
-                      metricVector, *(ret.bestVector))
+                      *metricVector, *(ret.bestVector))
                 : MetricVectorUtils::CompareResult::WINNER) {
     case MetricVectorUtils::CompareResult::WINNER:
       ret.nodes.clear();
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_WINNER:
-      ret.bestVector = std::move(metricVector);
+      ret.bestVector = *metricVector;
       ret.bestData = &(prefixEntry.data);
       ret.bestNode = nodeName;
       FOLLY_FALLTHROUGH;
@@ -1054,19 +2470,83 @@ SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
   return ret;
 }
 
-folly::Optional<thrift::UnicastRoute>
-SpfSolver::SpfSolverImpl::createBGPRoute(
+BestPathCalResult
+SpfSolver::SpfSolverImpl::findDstNodesForBgpRouteCached(
     std::string const& myNodeName,
     thrift::IpPrefix const& prefix,
     std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
     bool const isV4) {
-  std::string bestNode;
-  // order is intended to comply with API used later.
-  std::set<std::string> nodes;
-  folly::Optional<thrift::MetricVector> bestVector{folly::none};
+  const PrefixKey key(prefix);
+  const auto fingerprint = getAnnouncersFingerprint(myNodeName, nodePrefixes);
+  auto& shard =
+      bgpBestPathCache_[std::hash<PrefixKey>()(key) % bgpBestPathCache_.size()];
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end() and it->second.fingerprint == fingerprint) {
+      bgpBestPathCacheHitsStat_.addValue(1);
+      auto result = it->second.result;
+      auto bestIt = nodePrefixes.find(result.bestNode);
+      if (bestIt != nodePrefixes.end()) {
+        result.bestData = &bestIt->second.data;
+      }
+      return result;
+    }
+  }
+
+  bgpBestPathCacheMissesStat_.addValue(1);
+  auto result = findDstNodesForBgpRoute(myNodeName, prefix, nodePrefixes, isV4);
+  BgpBestPathCacheEntry entry;
+  entry.fingerprint = fingerprint;
+  entry.result = result;
+  entry.result.bestData = nullptr;
+  std::lock_guard<std::mutex> lock(shard.lock);
+  shard.entries[key] = std::move(entry);
+  return result;
+}
+
+uint64_t
+SpfSolver::SpfSolverImpl::getAnnouncersFingerprint(
+    std::string const& myNodeName,
+    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes)
+    const {
+  const auto& mySpfResult = *spfResults_.at(myNodeName);
+  // sum of mixed hashes, so that order of announcers doesn't matter
+  uint64_t fingerprint = folly::hash::SpookyHashV2::Hash64(
+      myNodeName.data(), myNodeName.size(), 0);
+  for (auto const& kv : nodePrefixes) {
+    const auto metric = mySpfResult.getMetric(kv.first);
+    // -1 if unreachable, the metric only matters if it is compared
+    int64_t value = -1;
+    if (metric.hasValue()) {
+      value = bgpUseIgpMetric_ ? static_cast<int64_t>(metric.value()) : 0;
+    }
+    const auto hash =
+        folly::hash::SpookyHashV2::Hash64(kv.first.data(), kv.first.size(), 0);
+    fingerprint += folly::hash::twang_mix64(
+        folly::hash::hash_128_to_64(hash, static_cast<uint64_t>(value)));
+  }
+  return fingerprint;
+}
 
-  const auto dstInfo = getBestAnnouncingNodes(
-      myNodeName, prefix, nodePrefixes, isV4, true, false);
+void
+SpfSolver::SpfSolverImpl::invalidateBgpBestPaths(
+    std::vector<thrift::IpPrefix> const& prefixes) {
+  for (auto const& prefix : prefixes) {
+    const PrefixKey key(prefix);
+    auto& shard = bgpBestPathCache_
+        [std::hash<PrefixKey>()(key) % bgpBestPathCache_.size()];
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.entries.erase(key);
+  }
+}
+
+folly::Optional<thrift::UnicastRoute>
+SpfSolver::SpfSolverImpl::createBGPRoute(
+    std::string const& myNodeName,
+    thrift::IpPrefix const& prefix,
+    bool const isV4,
+    BestPathCalResult const& dstInfo) {
   if (not dstInfo.success) {
     return folly::none;
   }
@@ -1076,7 +2556,7 @@ SpfSolver::SpfSolverImpl::createBGPRoute(
     // is no path to it
     if (not dstInfo.nodes.count(myNodeName)) {
       LOG(WARNING) << "No route to BGP prefix " << toString(prefix);
-      tData_.addStatValue("decision.no_route_to_prefix", 1, fbzmq::COUNT);
+      noRouteToPrefixStat_.addValue(1);
     }
     return folly::none;
   }
@@ -1085,7 +2565,7 @@ SpfSolver::SpfSolverImpl::createBGPRoute(
   auto bestNextHop = prefixState_.getLoopbackVias(
       {dstInfo.bestNode}, isV4, dstInfo.bestIgpMetric);
   if (bestNextHop.size() != 1) {
-    tData_.addStatValue("decision.missing_loopback_addr", 1, fbzmq::SUM);
+    missingLoopbackAddrStat_.addValue(1);
     LOG(ERROR) << "Cannot find the best paths loopback address. "
                << "Skipping route for prefix: " << toString(prefix);
     return folly::none;
@@ -1239,21 +2719,37 @@ SpfSolver::SpfSolverImpl::selectKsp2Routes(
   return std::move(route);
 }
 
-std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
+std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>> const&
 SpfSolver::SpfSolverImpl::createOpenRKsp2EdRouteForNodes(
     std::string const& myNodeName,
     std::unordered_set<std::string> const& nodes) {
-  std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
-      pathsToNodes;
+  // paths of older generations or of other shortest paths, e.g. of another
+  // source, can't be reused
+  auto const& spf1Ptr = spfResults_.at(myNodeName);
+  if (ksp2PathsGeneration_ != linkState_.getGeneration() or
+      ksp2PathsSpf_ != spf1Ptr) {
+    ksp2Paths_.clear();
+    ksp2PathsGeneration_ = linkState_.getGeneration();
+    ksp2PathsSpf_ = spf1Ptr;
+  }
+  auto& pathsToNodes = ksp2Paths_;
 
   // Prepare list of possible destination nodes
   for (const auto& node : nodes) {
+    if (pathsToNodes.count(node)) {
+      ksp2PathCacheHitsStat_.addValue(1);
+      continue;
+    }
+    ksp2PathCacheMissesStat_.addValue(1);
+    // destinations without any path are recorded as well
+    pathsToNodes[node];
+
     std::set<std::string> dstNodeNames;
     dstNodeNames.emplace(node);
 
     // Step-1 Get all shortest paths and min-cost nodes to whom we will be
     // forwarding
-    auto const& spf1 = spfResults_.at(myNodeName);
+    auto const& spf1 = *spf1Ptr;
     auto const& minMetricNodes1 = getMinCostNodes(spf1, dstNodeNames);
     auto const& minCost1 = minMetricNodes1.first;
     auto const& minCostNodes1 = minMetricNodes1.second;
@@ -1272,7 +2768,9 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRouteForNodes(
       }
     }
 
-    // Step-3 Collect all second shortest paths
+    // Step-3 Collect all second shortest paths. The SPF run is specific to
+    // this destination, it is not kept in spfCache_ which would only see
+    // other entries evicted by it
     if (linksToIgnore.size()) {
       auto const spf2 = runSpf(myNodeName, true, linksToIgnore);
       auto const& minMetricNodes2 = getMinCostNodes(spf2, dstNodeNames);
@@ -1299,11 +2797,11 @@ SpfSolver::SpfSolverImpl::getMinCostNodes(
   // find the set of the closest nodes in our destination
   std::unordered_set<std::string> minCostNodes;
   for (const auto& dstNode : dstNodeNames) {
-    auto it = spfResult.find(dstNode);
-    if (it == spfResult.end()) {
+    const auto maybeDistance = spfResult.getMetric(dstNode);
+    if (not maybeDistance.hasValue()) {
       continue;
     }
-    const auto nodeDistance = it->second.first;
+    const auto nodeDistance = maybeDistance.value();
     if (shortestMetric >= nodeDistance) {
       if (shortestMetric > nodeDistance) {
         shortestMetric = nodeDistance;
@@ -1325,7 +2823,7 @@ SpfSolver::SpfSolverImpl::getNextHopsWithMetric(
     const std::string& myNodeName,
     const std::set<std::string>& dstNodeNames,
     bool perDestination) const {
-  auto& shortestPathsFromHere = spfResults_.at(myNodeName);
+  auto& shortestPathsFromHere = *spfResults_.at(myNodeName);
   auto const& minMetricNodes =
       getMinCostNodes(shortestPathsFromHere, dstNodeNames);
   auto const& shortestMetric = minMetricNodes.first;
@@ -1346,43 +2844,38 @@ SpfSolver::SpfSolverImpl::getNextHopsWithMetric(
   // Add neighbors with shortest path to the prefix
   for (const auto& dstNode : minCostNodes) {
     const auto dstNodeRef = perDestination ? dstNode : "";
-    for (const auto& nhName : shortestPathsFromHere.at(dstNode).second) {
-      nextHopNodes[std::make_pair(nhName, dstNodeRef)] =
-          shortestMetric - findMinDistToNeighbor(myNodeName, nhName);
-    }
+    shortestPathsFromHere.forEachNextHop(
+        linkState_.getNodeId(dstNode).value(), [&](LinkState::NodeId nhId) {
+          const auto& nhName = linkState_.getNodeName(nhId);
+          nextHopNodes[std::make_pair(nhName, dstNodeRef)] =
+              shortestMetric - findMinDistToNeighbor(myNodeName, nhName);
+        });
   }
 
   // add any other neighbors that have LFA paths to the prefix
   if (computeLfaPaths_) {
-    for (const auto& kv2 : spfResults_) {
-      const auto& neighborName = kv2.first;
-      const auto& shortestPathsFromNeighbor = kv2.second;
-      if (neighborName == myNodeName) {
+    DCHECK(lfaTable_.valid and lfaTable_.source == myNodeName);
+    for (const auto& dstNode : dstNodeNames) {
+      auto candidatesItr = lfaTable_.candidates.find(dstNode);
+      if (candidatesItr == lfaTable_.candidates.end()) {
         continue;
       }
-
-      const auto neighborToHere =
-          shortestPathsFromNeighbor.at(myNodeName).first;
-      for (const auto& dstNode : dstNodeNames) {
-        auto shortestPathItr = shortestPathsFromNeighbor.find(dstNode);
-        if (shortestPathItr == shortestPathsFromNeighbor.end()) {
+      for (const auto& lfa : candidatesItr->second) {
+        // This is the LFA condition per RFC 5286
+        if (lfa.distanceFromNeighbor >= shortestMetric + lfa.neighborToHere) {
           continue;
         }
-        const auto distanceFromNeighbor = shortestPathItr->second.first;
-
-        // This is the LFA condition per RFC 5286
-        if (distanceFromNeighbor < shortestMetric + neighborToHere) {
-          const auto nextHopKey =
-              std::make_pair(neighborName, perDestination ? dstNode : "");
-          auto nextHopItr = nextHopNodes.find(nextHopKey);
-          if (nextHopItr == nextHopNodes.end()) {
-            nextHopNodes.emplace(nextHopKey, distanceFromNeighbor);
-          } else if (nextHopItr->second > distanceFromNeighbor) {
-            nextHopItr->second = distanceFromNeighbor;
-          }
-        } // end if
-      } // end for dstNodeNames
-    } // end spfResults_
+        const auto nextHopKey = std::make_pair(
+            lfaTable_.neighbors[lfa.neighbor].str(),
+            perDestination ? dstNode : "");
+        auto nextHopItr = nextHopNodes.find(nextHopKey);
+        if (nextHopItr == nextHopNodes.end()) {
+          nextHopNodes.emplace(nextHopKey, lfa.distanceFromNeighbor);
+        } else if (nextHopItr->second > lfa.distanceFromNeighbor) {
+          nextHopItr->second = lfa.distanceFromNeighbor;
+        }
+      } // end for candidates
+    } // end for dstNodeNames
   }
 
   return std::make_pair(shortestMetric, nextHopNodes);
@@ -1497,12 +2990,13 @@ SpfSolver::SpfSolverImpl::getCounters() {
     }
   }
 
-  // Get stats from tData_
-  auto counters = tData_.getCounters();
+  auto counters = stats_.getCounters();
 
   // Add custom counters
   counters["decision.num_partial_adjacencies"] = numPartialAdjacencies;
   counters["decision.num_complete_adjacencies"] = linkState_.numLinks();
+  counters["decision.unchanged_adj_db_updates"] =
+      linkState_.numUnchangedAdjDbUpdates();
   // When node has no adjacencies then linkState reports 0
   counters["decision.num_nodes"] =
       std::max(linkState_.numNodes(), static_cast<size_t>(1ul));
@@ -1519,78 +3013,560 @@ SpfSolver::SpfSolverImpl::getCounters() {
 // Public SpfSolver
 //
 
+namespace {
+
+// Cost of the cheapest next-hop of a route, used to pick the preferred route
+// across areas. Routes without next-hops are least preferred.
+int64_t
+getRouteCost(const std::vector<thrift::NextHopThrift>& nextHops) {
+  int64_t cost = std::numeric_limits<int64_t>::max();
+  for (auto const& nextHop : nextHops) {
+    cost = std::min<int64_t>(cost, nextHop.metric);
+  }
+  return cost;
+}
+
+} // anonymous namespace
+
 SpfSolver::SpfSolver(
     const std::string& myNodeName,
     bool enableV4,
     bool computeLfaPaths,
     bool enableOrderedFib,
     bool bgpDryRun,
-    bool bgpUseIgpMetric)
-    : impl_(new SpfSolver::SpfSolverImpl(
-          myNodeName,
-          enableV4,
-          computeLfaPaths,
-          enableOrderedFib,
-          bgpDryRun,
-          bgpUseIgpMetric)) {}
+    bool bgpUseIgpMetric,
+    size_t numRouteBuildThreads)
+    : myNodeName_(myNodeName),
+      enableV4_(enableV4),
+      computeLfaPaths_(computeLfaPaths),
+      enableOrderedFib_(enableOrderedFib),
+      bgpDryRun_(bgpDryRun),
+      bgpUseIgpMetric_(bgpUseIgpMetric),
+      numRouteBuildThreads_(numRouteBuildThreads) {
+  getOrCreateArea(thrift::KvStore_constants::kDefaultArea());
+}
 
 SpfSolver::~SpfSolver() {}
 
+SpfSolver::SpfSolverImpl&
+SpfSolver::getOrCreateArea(const std::string& area) {
+  auto it = areas_.find(area);
+  if (it != areas_.end()) {
+    return *it->second;
+  }
+  VLOG(1) << "Decision: tracking link state of area " << area;
+  // drop areas without any state, e.g. the default area when it is not
+  // configured, so that single area deployments avoid merging routes
+  for (auto areaIt = areas_.begin(); areaIt != areas_.end();) {
+    if (areaIt->second->getAdjacencyDatabases().empty() and
+        areaIt->second->getPrefixes().empty()) {
+      areaRoutes_.erase(areaIt->first);
+      dirtyAreas_.erase(areaIt->first);
+      areaIt = areas_.erase(areaIt);
+    } else {
+      ++areaIt;
+    }
+  }
+  auto& impl = areas_[area];
+  impl = std::make_unique<SpfSolverImpl>(
+      myNodeName_,
+      enableV4_,
+      computeLfaPaths_,
+      enableOrderedFib_,
+      bgpDryRun_,
+      bgpUseIgpMetric_,
+      numRouteBuildThreads_,
+      &phaseProfiler_);
+  dirtyAreas_.emplace(area);
+  return *impl;
+}
+
 // update adjacencies for the given router; everything is replaced
 std::pair<
     bool /* topology has changed*/,
     bool /* route attributes has changed (nexthop addr, node/adj label */>
 SpfSolver::updateAdjacencyDatabase(
-    thrift::AdjacencyDatabase const& newAdjacencyDb) {
-  return impl_->updateAdjacencyDatabase(newAdjacencyDb);
+    thrift::AdjacencyDatabase newAdjacencyDb, const std::string& area) {
+  auto rc =
+      getOrCreateArea(area).updateAdjacencyDatabase(std::move(newAdjacencyDb));
+  if (rc.first or rc.second) {
+    dirtyAreas_.emplace(area);
+  }
+  return rc;
 }
 
 bool
 SpfSolver::hasHolds() const {
-  return impl_->hasHolds();
+  for (auto const& kv : areas_) {
+    if (kv.second->hasHolds()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool
-SpfSolver::deleteAdjacencyDatabase(const std::string& nodeName) {
-  return impl_->deleteAdjacencyDatabase(nodeName);
+SpfSolver::deleteAdjacencyDatabase(
+    const std::string& nodeName, const std::string& area) {
+  auto it = areas_.find(area);
+  if (it == areas_.end() or
+      not it->second->deleteAdjacencyDatabase(nodeName)) {
+    return false;
+  }
+  dirtyAreas_.emplace(area);
+  return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::AdjacencyDatabase> const&
-SpfSolver::getAdjacencyDatabases() {
-  return impl_->getAdjacencyDatabases();
+SpfSolver::getAdjacencyDatabases(const std::string& area) {
+  static const std::unordered_map<std::string, thrift::AdjacencyDatabase>
+      kEmptyAdjacencyDbs;
+  auto it = areas_.find(area);
+  if (it == areas_.end()) {
+    return kEmptyAdjacencyDbs;
+  }
+  return it->second->getAdjacencyDatabases();
 }
 
 // update prefixes for a given router
 bool
-SpfSolver::updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb) {
-  return impl_->updatePrefixDatabase(prefixDb);
+SpfSolver::updatePrefixDatabase(
+    const thrift::PrefixDatabase& prefixDb,
+    std::unordered_set<thrift::IpPrefix>* changedPrefixes,
+    const std::string& area) {
+  if (not getOrCreateArea(area).updatePrefixDatabase(
+          prefixDb, changedPrefixes)) {
+    return false;
+  }
+  dirtyAreas_.emplace(area);
+  return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
-SpfSolver::getPrefixDatabases() {
-  return impl_->getPrefixDatabases();
+SpfSolver::getPrefixDatabases(const std::string& area) {
+  auto it = areas_.find(area);
+  if (it == areas_.end()) {
+    return {};
+  }
+  return it->second->getPrefixDatabases();
+}
+
+std::vector<std::string>
+SpfSolver::getAreas() const {
+  std::vector<std::string> areas;
+  areas.reserve(areas_.size());
+  for (auto const& kv : areas_) {
+    areas.emplace_back(kv.first);
+  }
+  return areas;
 }
 
 folly::Optional<thrift::RouteDatabase>
 SpfSolver::buildPaths(const std::string& myNodeName) {
-  return impl_->buildPaths(myNodeName);
+  auto routeDb = buildAreaRoutes(myNodeName, true /* runSpf */);
+  lastComputePhases_ = phaseProfiler_.finishRun();
+  return routeDb;
 }
 
 folly::Optional<thrift::RouteDatabase>
 SpfSolver::buildRouteDb(const std::string& myNodeName) {
-  return impl_->buildRouteDb(myNodeName);
+  auto routeDb = buildAreaRoutes(myNodeName, false /* runSpf */);
+  lastComputePhases_ = phaseProfiler_.finishRun();
+  return routeDb;
+}
+
+folly::Optional<thrift::RouteDatabase>
+SpfSolver::buildAreaRoutes(const std::string& myNodeName, bool runSpf) {
+  auto build = [myNodeName, runSpf](SpfSolverImpl& impl) {
+    return runSpf ? impl.buildPaths(myNodeName) : impl.buildRouteDb(myNodeName);
+  };
+
+  // none of the areas knows this node
+  if (std::none_of(areas_.begin(), areas_.end(), [&myNodeName](auto const& kv) {
+        return kv.second->hasNode(myNodeName);
+      })) {
+    return folly::none;
+  }
+
+  // single area, nothing to merge
+  if (areas_.size() == 1) {
+    areaRoutes_.clear();
+    if (myNodeName == myNodeName_) {
+      dirtyAreas_.clear();
+    }
+    return build(*areas_.begin()->second);
+  }
+
+  // Routes towards other nodes are only ever requested for inspection, compute
+  // them from scratch without touching the routes of this node
+  const bool reuseRoutes = myNodeName == myNodeName_;
+  std::vector<std::string> areasToBuild;
+  for (auto const& kv : areas_) {
+    if (not reuseRoutes or dirtyAreas_.count(kv.first) or
+        not areaRoutes_.count(kv.first)) {
+      areasToBuild.emplace_back(kv.first);
+    }
+  }
+
+  std::vector<folly::Optional<thrift::RouteDatabase>> routeDbs;
+  if (areasToBuild.size() > 1) {
+    if (not areaExecutor_) {
+      areaExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+          std::max(1u, std::thread::hardware_concurrency()));
+    }
+    std::vector<folly::Future<folly::Optional<thrift::RouteDatabase>>> futures;
+    for (auto const& area : areasToBuild) {
+      auto impl = areas_.at(area).get();
+      futures.emplace_back(folly::via(
+          areaExecutor_.get(), [impl, &build]() { return build(*impl); }));
+    }
+    routeDbs = folly::collect(futures).get();
+  } else {
+    for (auto const& area : areasToBuild) {
+      routeDbs.emplace_back(build(*areas_.at(area)));
+    }
+  }
+
+  PhaseProfiler::ScopedPhase phase(
+      &phaseProfiler_, RouteComputePhase::AREA_MERGE);
+  std::unordered_map<std::string, AreaRoutes> builtRoutes;
+  for (size_t i = 0; i < areasToBuild.size(); ++i) {
+    auto& areaRoutes = builtRoutes[areasToBuild[i]];
+    if (not routeDbs[i].hasValue()) {
+      continue;
+    }
+    for (auto& route : routeDbs[i]->unicastRoutes) {
+      auto dest = route.dest;
+      areaRoutes.unicastRoutes.emplace(std::move(dest), std::move(route));
+    }
+    areaRoutes.mplsRoutes = std::move(routeDbs[i]->mplsRoutes);
+  }
+
+  if (not reuseRoutes) {
+    auto routeDb = mergeAreaRoutes(builtRoutes);
+    routeDb.thisNodeName = myNodeName;
+    return routeDb;
+  }
+
+  for (auto& kv : builtRoutes) {
+    areaRoutes_[kv.first] = std::move(kv.second);
+    dirtyAreas_.erase(kv.first);
+  }
+
+  auto routeDb = mergeAreaRoutes(areaRoutes_);
+  routeDb.thisNodeName = myNodeName;
+  return routeDb;
+}
+
+thrift::RouteDatabase
+SpfSolver::mergeAreaRoutes(
+    const std::unordered_map<std::string, AreaRoutes>& areaRoutes) const {
+  std::unordered_map<thrift::IpPrefix, const thrift::UnicastRoute*> unicast;
+  std::map<int32_t, const thrift::MplsRoute*> mpls;
+  // areas_ is ordered by name, only replace on a strictly cheaper route
+  for (auto const& kv : areas_) {
+    auto it = areaRoutes.find(kv.first);
+    if (it == areaRoutes.end()) {
+      continue;
+    }
+    for (auto const& routeKv : it->second.unicastRoutes) {
+      auto& best = unicast[routeKv.first];
+      if (best == nullptr or
+          getRouteCost(routeKv.second.nextHops) <
+              getRouteCost(best->nextHops)) {
+        best = &routeKv.second;
+      }
+    }
+    for (auto const& route : it->second.mplsRoutes) {
+      auto& best = mpls[route.topLabel];
+      if (best == nullptr or
+          getRouteCost(route.nextHops) < getRouteCost(best->nextHops)) {
+        best = &route;
+      }
+    }
+  }
+
+  thrift::RouteDatabase routeDb;
+  routeDb.unicastRoutes.reserve(unicast.size());
+  for (auto const& kv : unicast) {
+    routeDb.unicastRoutes.emplace_back(*kv.second);
+  }
+  routeDb.mplsRoutes.reserve(mpls.size());
+  for (auto const& kv : mpls) {
+    routeDb.mplsRoutes.emplace_back(*kv.second);
+  }
+  return routeDb;
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::buildRouteDbDelta(
+    const std::string& myNodeName,
+    const std::unordered_set<thrift::IpPrefix>& prefixes) {
+  auto routeDbDelta = buildAreaRouteDbDelta(myNodeName, prefixes);
+  lastComputePhases_ = phaseProfiler_.finishRun();
+  return routeDbDelta;
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::buildAreaRouteDbDelta(
+    const std::string& myNodeName,
+    const std::unordered_set<thrift::IpPrefix>& prefixes) {
+  if (areas_.size() == 1) {
+    auto routeDbDelta =
+        areas_.begin()->second->buildRouteDbDelta(myNodeName, prefixes);
+    if (routeDbDelta.hasValue() and myNodeName == myNodeName_) {
+      dirtyAreas_.clear();
+    }
+    return routeDbDelta;
+  }
+
+  // Merged routes of this node are only maintained with full route builds
+  if (myNodeName != myNodeName_) {
+    return folly::none;
+  }
+
+  // Recompute changed prefixes in areas which know about them
+  std::unordered_map<std::string, thrift::RouteDatabaseDelta> areaDeltas;
+  for (auto const& kv : areas_) {
+    auto routesIt = areaRoutes_.find(kv.first);
+    if (routesIt == areaRoutes_.end()) {
+      return folly::none;
+    }
+    auto const& knownPrefixes = kv.second->getPrefixes();
+    std::unordered_set<thrift::IpPrefix> areaPrefixes;
+    for (auto const& prefix : prefixes) {
+      if (knownPrefixes.count(PrefixKey(prefix)) or
+          routesIt->second.unicastRoutes.count(prefix)) {
+        areaPrefixes.emplace(prefix);
+      }
+    }
+    if (areaPrefixes.empty()) {
+      // area changed outside of these prefixes
+      if (dirtyAreas_.count(kv.first)) {
+        return folly::none;
+      }
+      continue;
+    }
+    auto routeDbDelta = kv.second->buildRouteDbDelta(myNodeName, areaPrefixes);
+    if (not routeDbDelta.hasValue()) {
+      return folly::none;
+    }
+    areaDeltas.emplace(kv.first, std::move(routeDbDelta.value()));
+  }
+
+  // Apply on routes of each area and find the new preferred routes
+  PhaseProfiler::ScopedPhase phase(
+      &phaseProfiler_, RouteComputePhase::AREA_MERGE);
+  for (auto& kv : areaDeltas) {
+    auto& areaRoutes = areaRoutes_.at(kv.first);
+    for (auto& route : kv.second.unicastRoutesToUpdate) {
+      auto dest = route.dest;
+      areaRoutes.unicastRoutes[std::move(dest)] = std::move(route);
+    }
+    for (auto const& prefix : kv.second.unicastRoutesToDelete) {
+      areaRoutes.unicastRoutes.erase(prefix);
+    }
+    dirtyAreas_.erase(kv.first);
+  }
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = myNodeName;
+  for (auto const& prefix : prefixes) {
+    const thrift::UnicastRoute* best{nullptr};
+    for (auto const& kv : areas_) {
+      auto const& unicastRoutes = areaRoutes_.at(kv.first).unicastRoutes;
+      auto it = unicastRoutes.find(prefix);
+      if (it != unicastRoutes.end() and
+          (best == nullptr or
+           getRouteCost(it->second.nextHops) < getRouteCost(best->nextHops))) {
+        best = &it->second;
+      }
+    }
+    if (best) {
+      routeDbDelta.unicastRoutesToUpdate.emplace_back(*best);
+    } else {
+      routeDbDelta.unicastRoutesToDelete.emplace_back(prefix);
+    }
+  }
+  return routeDbDelta;
 }
 
 bool
 SpfSolver::decrementHolds() {
-  return impl_->decrementHolds();
+  bool changed = false;
+  for (auto const& kv : areas_) {
+    if (kv.second->decrementHolds()) {
+      dirtyAreas_.emplace(kv.first);
+      changed = true;
+    }
+  }
+  return changed;
 }
 
 std::unordered_map<std::string, int64_t>
 SpfSolver::getCounters() {
-  return impl_->getCounters();
+  // counters of all areas are added up, averages take the worst area
+  std::unordered_map<std::string, int64_t> counters;
+  for (auto const& kv : areas_) {
+    for (auto const& counter : kv.second->getCounters()) {
+      auto it = counters.find(counter.first);
+      if (it == counters.end()) {
+        counters.emplace(counter);
+      } else if (counter.first.find(".avg") != std::string::npos) {
+        it->second = std::max(it->second, counter.second);
+      } else {
+        it->second += counter.second;
+      }
+    }
+  }
+  for (auto const& counter : phaseProfiler_.getCounters()) {
+    counters[counter.first] = counter.second;
+  }
+  return counters;
+}
+
+void
+SpfSolver::shedCaches() {
+  for (auto const& kv : areas_) {
+    kv.second->shedCaches();
+  }
+}
+
+namespace {
+
+// findDeltaRoutes() expects routes in sorted order
+void
+sortRouteDb(thrift::RouteDatabase& routeDb) {
+  std::sort(routeDb.unicastRoutes.begin(), routeDb.unicastRoutes.end());
+  std::sort(routeDb.mplsRoutes.begin(), routeDb.mplsRoutes.end());
+}
+
+// forget a node restored from the Decision snapshot once advertised live
+void
+eraseSnapshotNode(
+    std::unordered_map<std::string, std::unordered_set<std::string>>& nodes,
+    const std::string& area,
+    const std::string& nodeName) {
+  if (nodes.empty()) {
+    return;
+  }
+  auto it = nodes.find(area);
+  if (it != nodes.end()) {
+    it->second.erase(nodeName);
+  }
+}
+
+} // anonymous namespace
+
+namespace detail {
+
+std::map<std::string, thrift::AdjDbs>
+applyWhatIfMutations(
+    DecisionLsdbSnapshot const& snapshot,
+    thrift::WhatIfRequest const& request) {
+  std::map<std::string, thrift::AdjDbs> mutatedDbs;
+  // mutable copy of the adjacency database of nodeName in each area
+  auto getAreaAdjDbs = [&](std::string const& nodeName) {
+    std::vector<thrift::AdjacencyDatabase*> adjDbs;
+    for (auto const& kv : snapshot.adjDbs) {
+      auto it = kv.second.find(nodeName);
+      if (it == kv.second.end()) {
+        continue;
+      }
+      auto& areaDbs = mutatedDbs[kv.first];
+      auto mutatedIt = areaDbs.emplace(nodeName, *it->second).first;
+      adjDbs.emplace_back(&mutatedIt->second);
+    }
+    if (adjDbs.empty()) {
+      throw std::invalid_argument(
+          folly::sformat("Unknown node {}", nodeName));
+    }
+    return adjDbs;
+  };
+
+  for (auto const& kv : request.nodeOverloads) {
+    for (auto adjDb : getAreaAdjDbs(kv.first)) {
+      adjDb->isOverloaded = kv.second;
+    }
+  }
+  for (auto const& mutation : request.adjacencyMutations) {
+    bool found = false;
+    for (auto adjDb : getAreaAdjDbs(mutation.nodeName)) {
+      for (auto& adj : adjDb->adjacencies) {
+        if (adj.ifName != mutation.ifName) {
+          continue;
+        }
+        found = true;
+        if (mutation.metric.hasValue()) {
+          adj.metric = mutation.metric.value();
+        }
+        if (mutation.isOverloaded.hasValue()) {
+          adj.isOverloaded = mutation.isOverloaded.value();
+        }
+      }
+    }
+    if (not found) {
+      throw std::invalid_argument(folly::sformat(
+          "Unknown interface {} of node {}",
+          mutation.ifName,
+          mutation.nodeName));
+    }
+  }
+  return mutatedDbs;
 }
 
+std::vector<thrift::Publication>
+mergePublications(std::vector<KvStorePublicationPtr> const& publications) {
+  std::vector<thrift::Publication> merged;
+  std::unordered_map<std::string /* area */, size_t> areaIndices;
+  std::vector<std::unordered_set<std::string>> expiredKeys;
+  for (auto const& publication : publications) {
+    const auto area =
+        publication->area.value_or(thrift::KvStore_constants::kDefaultArea());
+    auto it = areaIndices.find(area);
+    if (it == areaIndices.end()) {
+      it = areaIndices.emplace(area, merged.size()).first;
+      merged.emplace_back();
+      merged.back().area = publication->area;
+      expiredKeys.emplace_back();
+    }
+    auto& mergedPub = merged.at(it->second);
+    auto& areaExpiredKeys = expiredKeys.at(it->second);
+
+    for (auto const& kv : publication->keyVals) {
+      // TTL refreshes don't supersede the update of the key taken so far
+      if (not kv.second.value.hasValue() and
+          (mergedPub.keyVals.count(kv.first) or
+           areaExpiredKeys.count(kv.first))) {
+        continue;
+      }
+      mergedPub.keyVals[kv.first] = kv.second;
+      areaExpiredKeys.erase(kv.first);
+    }
+    for (auto const& key : publication->expiredKeys) {
+      mergedPub.keyVals.erase(key);
+      areaExpiredKeys.emplace(key);
+    }
+  }
+
+  for (size_t i = 0; i < merged.size(); ++i) {
+    merged[i].expiredKeys.assign(expiredKeys[i].begin(), expiredKeys[i].end());
+  }
+  return merged;
+}
+
+bool
+isComputeSuperseded(
+    uint64_t generation,
+    uint64_t latestGeneration,
+    uint64_t lastPublishedGeneration) {
+  return generation != latestGeneration and
+      generation - lastPublishedGeneration <=
+      Constants::kDecisionMaxDroppedComputes;
+}
+
+} // namespace detail
+
 //
 // Decision class implementation
 //
@@ -1607,25 +3583,72 @@ Decision::Decision(
     std::chrono::milliseconds debounceMinDur,
     std::chrono::milliseconds debounceMaxDur,
     folly::Optional<std::chrono::seconds> gracefulRestartDuration,
-    messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
-    messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue,
+    messaging::RQueue<KvStorePublicationPtr> kvStoreUpdatesQueue,
+    messaging::ReplicateQueue<RouteUpdate>& routeUpdatesQueue,
     const MonitorSubmitUrl& monitorSubmitUrl,
-    fbzmq::Context& zmqContext)
+    fbzmq::Context& zmqContext,
+    size_t numRouteBuildThreads,
+    bool enableAsyncCompute,
+    size_t routeTraceBufferSize,
+    double debounceDutyCycle,
+    PrefixLimits prefixLimits,
+    std::string snapshotFilePath,
+    std::chrono::seconds snapshotInterval,
+    RuntimeKnobs* runtimeKnobs)
     : processUpdatesBackoff_(debounceMinDur, debounceMaxDur),
       myNodeName_(myNodeName),
       adjacencyDbMarker_(adjacencyDbMarker),
       prefixDbMarker_(prefixDbMarker),
-      routeUpdatesQueue_(routeUpdatesQueue) {
-  routeDb_.thisNodeName = myNodeName_;
+      routeDbSnapshots_(myNodeName),
+      routeTrace_(routeTraceBufferSize),
+      routeUpdatesQueue_(routeUpdatesQueue),
+      enableV4_(enableV4),
+      computeLfaPaths_(computeLfaPaths),
+      bgpDryRun_(bgpDryRun),
+      bgpUseIgpMetric_(bgpUseIgpMetric),
+      prefixLimits_(std::move(prefixLimits)),
+      snapshotFilePath_(std::move(snapshotFilePath)) {
   processUpdatesTimer_ = fbzmq::ZmqTimeout::make(
       getEvb(), [this]() noexcept { processPendingUpdates(); });
+  if (debounceDutyCycle > 0) {
+    adaptiveDebounce_ = std::make_unique<AdaptiveDebounce>(
+        debounceMinDur, debounceMaxDur, debounceDutyCycle);
+  }
+  debounceMinMs_ = RuntimeKnobs::Knob(debounceMinDur.count());
+  debounceMaxMs_ = RuntimeKnobs::Knob(debounceMaxDur.count());
+  if (runtimeKnobs and not adaptiveDebounce_) {
+    debounceMinMs_ = runtimeKnobs->addKnob(
+        "decision.debounce_min_ms",
+        "Initial debounce of route computations",
+        debounceMinDur.count(),
+        1,
+        kMaxDebounceMs);
+    debounceMaxMs_ = runtimeKnobs->addKnob(
+        "decision.debounce_max_ms",
+        "Max debounce of route computations, doubling with updates",
+        debounceMaxDur.count(),
+        1,
+        kMaxDebounceMs);
+  }
   spfSolver_ = std::make_unique<SpfSolver>(
       myNodeName,
       enableV4,
       computeLfaPaths,
       enableOrderedFib,
       bgpDryRun,
-      bgpUseIgpMetric);
+      bgpUseIgpMetric,
+      numRouteBuildThreads);
+  if (enableAsyncCompute) {
+    computeSolver_ = std::make_unique<SpfSolver>(
+        myNodeName,
+        enableV4,
+        computeLfaPaths,
+        enableOrderedFib,
+        bgpDryRun,
+        bgpUseIgpMetric,
+        numRouteBuildThreads);
+    computeExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+  }
 
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
@@ -1656,21 +3679,42 @@ Decision::Decision(
     });
   }
 
+  // Restore the last snapshot ahead of any publication and snapshot
+  // periodically
+  if (not snapshotFilePath_.empty()) {
+    runInEventBaseThread([this]() noexcept { loadSnapshot(); });
+    snapshotTimer_ = fbzmq::ZmqTimeout::make(
+        getEvb(), [this]() noexcept { saveSnapshot(); });
+    snapshotTimer_->scheduleTimeout(snapshotInterval, isPeriodic);
+  }
+
   // Add reader to process publication from KvStore
   addFiberTask([q = std::move(kvStoreUpdatesQueue), this]() mutable noexcept {
     LOG(INFO) << "Starting KvStore updates processing fiber";
     while (true) {
-      auto maybeThriftPub = q.get(); // perform read
+      // publications queued up meanwhile are merged and applied at once
+      auto maybeThriftPubs = q.getAllAvailable(); // perform read
       VLOG(2) << "Received KvStore update";
-      if (maybeThriftPub.hasError()) {
+      if (maybeThriftPubs.hasError()) {
         LOG(INFO) << "Terminating KvStore updates processing fiber";
         break;
       }
 
-      // Apply publication and update stored update status
+      // Apply publications and update stored update status
       ProcessPublicationResult res; // default initialized to false
       try {
-        res = processPublication(maybeThriftPub.value());
+        auto const& thriftPubs = maybeThriftPubs.value();
+        if (thriftPubs.size() == 1) {
+          res = processPublication(*thriftPubs.front());
+        } else {
+          auto mergedPubs = detail::mergePublications(thriftPubs);
+          numMergedPublications_ += thriftPubs.size() - mergedPubs.size();
+          for (auto const& thriftPub : mergedPubs) {
+            auto pubRes = processPublication(thriftPub);
+            res.adjChanged |= pubRes.adjChanged;
+            res.prefixesChanged |= pubRes.prefixesChanged;
+          }
+        }
       } catch (const std::exception& e) {
 #if FOLLY_USE_SYMBOLIZER
         // collect stack strace then fail the process
@@ -1686,7 +3730,15 @@ Decision::Decision(
       processUpdatesStatus_.prefixesChanged |= res.prefixesChanged;
       // compute routes with exponential backoff timer if needed
       if (res.adjChanged || res.prefixesChanged) {
-        if (!processUpdatesBackoff_.atMaxBackoff()) {
+        updateDebounce();
+        if (adaptiveDebounce_) {
+          // the window is picked when the computation is scheduled, later
+          // updates are batched into it
+          auto window = adaptiveDebounce_->reportUpdate();
+          if (not processUpdatesTimer_->isScheduled()) {
+            processUpdatesTimer_->scheduleTimeout(window);
+          }
+        } else if (!processUpdatesBackoff_.atMaxBackoff()) {
           processUpdatesBackoff_.reportError();
           processUpdatesTimer_->scheduleTimeout(
               processUpdatesBackoff_.getTimeRemainingUntilRetry());
@@ -1695,49 +3747,304 @@ Decision::Decision(
         }
       }
     }
-  });
-}
+  });
+}
+
+Decision::~Decision() {
+  // outstanding computations may still post their results to the event loop
+  if (computeExecutor_) {
+    computeExecutor_->join();
+  }
+  if (whatIfExecutor_) {
+    whatIfExecutor_->join();
+  }
+  if (not snapshotFilePath_.empty()) {
+    saveSnapshot();
+  }
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+Decision::getDecisionRouteDb(std::string nodeName) {
+  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), nodeName, this]() mutable {
+    if (nodeName.empty()) {
+      nodeName = myNodeName_;
+    }
+    if (computeExecutor_) {
+      // build paths on computeSolver_ once all updates so far are applied
+      computeExecutor_->add([p = std::move(p),
+                             nodeName = std::move(nodeName),
+                             updates = std::move(pendingComputeUpdates_),
+                             this]() mutable {
+        for (auto& update : updates) {
+          update(*computeSolver_);
+        }
+        thrift::RouteDatabase routeDb;
+        auto maybeRouteDb = computeSolver_->buildPaths(nodeName);
+        if (maybeRouteDb.hasValue()) {
+          routeDb = std::move(maybeRouteDb.value());
+        } else {
+          routeDb.thisNodeName = nodeName;
+        }
+        p.setValue(
+            std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
+      });
+      pendingComputeUpdates_.clear();
+      return;
+    }
+
+    thrift::RouteDatabase routeDb;
+    auto maybeRouteDb = spfSolver_->buildPaths(nodeName);
+    if (maybeRouteDb.hasValue()) {
+      routeDb = std::move(maybeRouteDb.value());
+    } else {
+      routeDb.thisNodeName = nodeName;
+    }
+    p.setValue(std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
+Decision::getDecisionAdjacencyDbs() {
+  folly::Promise<std::unique_ptr<thrift::AdjDbs>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    // a node present in multiple areas is reported with its first area
+    thrift::AdjDbs adjDbs;
+    for (auto const& area : spfSolver_->getAreas()) {
+      auto const& areaAdjDbs = spfSolver_->getAdjacencyDatabases(area);
+      adjDbs.insert(areaAdjDbs.begin(), areaAdjDbs.end());
+    }
+    p.setValue(std::make_unique<thrift::AdjDbs>(std::move(adjDbs)));
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
+Decision::getDecisionPrefixDbs() {
+  folly::Promise<std::unique_ptr<thrift::PrefixDbs>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    thrift::PrefixDbs prefixDbs;
+    for (auto const& area : spfSolver_->getAreas()) {
+      auto areaPrefixDbs = spfSolver_->getPrefixDatabases(area);
+      prefixDbs.insert(areaPrefixDbs.begin(), areaPrefixDbs.end());
+    }
+    p.setValue(std::make_unique<thrift::PrefixDbs>(std::move(prefixDbs)));
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+Decision::getDecisionRouteTrace() {
+  folly::Promise<std::unique_ptr<thrift::RouteTraceDatabase>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    auto routeTraceDb = std::make_unique<thrift::RouteTraceDatabase>();
+    routeTraceDb->thisNodeName = myNodeName_;
+    routeTraceDb->entries = routeTrace_.dump();
+    routeTraceDb->numRecorded = routeTrace_.getNumRecorded();
+    p.setValue(std::move(routeTraceDb));
+  });
+  return sf;
+}
+
+std::shared_ptr<const detail::DecisionLsdbSnapshot>
+Decision::getWhatIfSnapshot() {
+  if (not whatIfSnapshot_) {
+    // copied once, kept up to date as databases are applied afterwards
+    whatIfSnapshot_ = std::make_shared<detail::DecisionLsdbSnapshot>();
+    for (auto const& area : spfSolver_->getAreas()) {
+      auto& adjDbs = whatIfSnapshot_->adjDbs[area];
+      for (auto& kv : spfSolver_->getAdjacencyDatabases(area)) {
+        adjDbs.emplace(
+            kv.first,
+            std::make_shared<const thrift::AdjacencyDatabase>(
+                std::move(kv.second)));
+      }
+      auto& prefixDbs = whatIfSnapshot_->prefixDbs[area];
+      for (auto& kv : spfSolver_->getPrefixDatabases(area)) {
+        prefixDbs.emplace(
+            kv.first,
+            std::make_shared<const thrift::PrefixDatabase>(
+                std::move(kv.second)));
+      }
+    }
+    whatIfSnapshot_->version = lsdbVersion_;
+  } else if (whatIfSnapshot_->version != lsdbVersion_) {
+    getMutableWhatIfSnapshot()->version = lsdbVersion_;
+  }
+  if (not whatIfExecutor_) {
+    whatIfExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+  }
+  return whatIfSnapshot_;
+}
+
+detail::DecisionLsdbSnapshot*
+Decision::getMutableWhatIfSnapshot() {
+  if (not whatIfSnapshot_) {
+    return nullptr;
+  }
+  // only the event loop takes new references, a unique snapshot stays so
+  if (whatIfSnapshot_.use_count() > 1) {
+    whatIfSnapshot_ =
+        std::make_shared<detail::DecisionLsdbSnapshot>(*whatIfSnapshot_);
+  }
+  return whatIfSnapshot_.get();
+}
+
+folly::SemiFuture<folly::Unit>
+Decision::getDecisionRouteDbs(
+    std::vector<std::string> nodeNames,
+    folly::Function<void(thrift::RouteDatabase&&)> onRouteDb) {
+  folly::Promise<folly::Unit> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p),
+                        nodeNames = std::move(nodeNames),
+                        onRouteDb = std::move(onRouteDb),
+                        this]() mutable {
+    whatIfExecutor_->add([p = std::move(p),
+                          nodeNames = std::move(nodeNames),
+                          onRouteDb = std::move(onRouteDb),
+                          snapshot = getWhatIfSnapshot(),
+                          this]() mutable {
+      try {
+        computeRouteDbs(*snapshot, std::move(nodeNames), onRouteDb);
+        p.setValue();
+      } catch (std::exception const& e) {
+        p.setException(folly::exception_wrapper(std::current_exception(), e));
+      }
+    });
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDelta>>
+Decision::getDecisionRouteDbWhatIf(thrift::WhatIfRequest request) {
+  folly::Promise<std::unique_ptr<thrift::RouteDatabaseDelta>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p),
+                        request = std::move(request),
+                        this]() mutable {
+    whatIfExecutor_->add([p = std::move(p),
+                          request = std::move(request),
+                          snapshot = getWhatIfSnapshot(),
+                          this]() mutable {
+      try {
+        p.setValue(std::make_unique<thrift::RouteDatabaseDelta>(
+            computeWhatIf(*snapshot, request)));
+      } catch (std::exception const& e) {
+        p.setException(folly::exception_wrapper(std::current_exception(), e));
+      }
+    });
+  });
+  return sf;
+}
+
+void
+Decision::computeRouteDbs(
+    detail::DecisionLsdbSnapshot const& snapshot,
+    std::vector<std::string> nodeNames,
+    folly::FunctionRef<void(thrift::RouteDatabase&&)> onRouteDb) {
+  updateWhatIfSolver(snapshot);
+  if (nodeNames.empty()) {
+    std::set<std::string> allNodeNames;
+    for (auto const& kv : snapshot.adjDbs) {
+      for (auto const& adjDb : kv.second) {
+        allNodeNames.emplace(adjDb.first);
+      }
+    }
+    nodeNames.assign(allNodeNames.begin(), allNodeNames.end());
+  }
 
-folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
-Decision::getDecisionRouteDb(std::string nodeName) {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), nodeName, this]() mutable {
+  // SPF results are cached by the solver for the link state of the snapshot,
+  // runs from neighbors for LFA are shared with the ones of the same nodes as
+  // sources
+  for (auto& nodeName : nodeNames) {
     thrift::RouteDatabase routeDb;
-    if (nodeName.empty()) {
-      nodeName = myNodeName_;
-    }
-    auto maybeRouteDb = spfSolver_->buildPaths(nodeName);
+    auto maybeRouteDb = whatIfSolver_->buildPaths(nodeName);
     if (maybeRouteDb.hasValue()) {
       routeDb = std::move(maybeRouteDb.value());
-    } else {
-      routeDb.thisNodeName = nodeName;
     }
-    p.setValue(std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
-  });
-  return sf;
+    routeDb.thisNodeName = std::move(nodeName);
+    onRouteDb(std::move(routeDb));
+  }
 }
 
-folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
-Decision::getDecisionAdjacencyDbs() {
-  folly::Promise<std::unique_ptr<thrift::AdjDbs>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), this]() mutable {
-    auto adjDbs = spfSolver_->getAdjacencyDatabases();
-    p.setValue(std::make_unique<thrift::AdjDbs>(std::move(adjDbs)));
-  });
-  return sf;
+void
+Decision::updateWhatIfSolver(detail::DecisionLsdbSnapshot const& snapshot) {
+  if (whatIfSolver_ and whatIfSolverVersion_ == snapshot.version) {
+    return;
+  }
+  // ordered fib holds and parallel route build don't matter for what-if
+  // computations, keep them from adding threads or state
+  whatIfSolver_ = std::make_unique<SpfSolver>(
+      myNodeName_,
+      enableV4_,
+      computeLfaPaths_,
+      false /* enableOrderedFib */,
+      bgpDryRun_,
+      bgpUseIgpMetric_);
+  for (auto const& kv : snapshot.adjDbs) {
+    for (auto const& adjDb : kv.second) {
+      whatIfSolver_->updateAdjacencyDatabase(*adjDb.second, kv.first);
+    }
+  }
+  for (auto const& kv : snapshot.prefixDbs) {
+    for (auto const& prefixDb : kv.second) {
+      whatIfSolver_->updatePrefixDatabase(*prefixDb.second, nullptr, kv.first);
+    }
+  }
+  auto maybeRouteDb = whatIfSolver_->buildPaths(myNodeName_);
+  whatIfBaseRouteDb_ = maybeRouteDb.hasValue() ? std::move(*maybeRouteDb)
+                                               : thrift::RouteDatabase();
+  whatIfBaseRouteDb_.thisNodeName = myNodeName_;
+  sortRouteDb(whatIfBaseRouteDb_);
+  whatIfSolverVersion_ = snapshot.version;
 }
 
-folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
-Decision::getDecisionPrefixDbs() {
-  folly::Promise<std::unique_ptr<thrift::PrefixDbs>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), this]() mutable {
-    auto prefixDbs = spfSolver_->getPrefixDatabases();
-    p.setValue(std::make_unique<thrift::PrefixDbs>(std::move(prefixDbs)));
-  });
-  return sf;
+thrift::RouteDatabaseDelta
+Decision::computeWhatIf(
+    detail::DecisionLsdbSnapshot const& snapshot,
+    thrift::WhatIfRequest const& request) {
+  auto mutatedDbs = detail::applyWhatIfMutations(snapshot, request);
+  updateWhatIfSolver(snapshot);
+
+  // compute on the mutated link state and revert it afterwards, even if the
+  // computation throws. Prefix state and everything else of the snapshot is
+  // kept for subsequent queries
+  SCOPE_EXIT {
+    for (auto const& kv : mutatedDbs) {
+      for (auto const& adjDb : kv.second) {
+        whatIfSolver_->updateAdjacencyDatabase(
+            *snapshot.adjDbs.at(kv.first).at(adjDb.first), kv.first);
+      }
+    }
+  };
+  for (auto const& kv : mutatedDbs) {
+    for (auto const& adjDb : kv.second) {
+      whatIfSolver_->updateAdjacencyDatabase(adjDb.second, kv.first);
+    }
+  }
+  auto maybeRouteDb = whatIfSolver_->buildPaths(myNodeName_);
+
+  thrift::RouteDatabase routeDb;
+  if (maybeRouteDb.hasValue()) {
+    routeDb = std::move(maybeRouteDb.value());
+  }
+  routeDb.thisNodeName = myNodeName_;
+  sortRouteDb(routeDb);
+  return findDeltaRoutes(routeDb, whatIfBaseRouteDb_);
+}
+
+void
+Decision::onMemoryPressure() {
+  LOG(WARNING) << "Shedding SPF caches under memory pressure";
+  spfSolver_->shedCaches();
+  // the solver of asynchronous computations sheds them in turn
+  queueComputeUpdate([](SpfSolver& solver) { solver.shedCaches(); });
 }
 
 std::unordered_map<std::string, int64_t>
@@ -1746,48 +4053,138 @@ Decision::getCounters() {
   auto future = promise.getFuture();
   getEvb()->runInEventBaseThread(
       [this, p = std::move(promise)]() mutable noexcept {
-        p.setValue(spfSolver_->getCounters());
+        p.setValue(getSolverCounters());
       });
   return std::move(future).get();
 }
 
+std::unordered_map<std::string, int64_t>
+Decision::getSolverCounters() {
+  auto counters = spfSolver_->getCounters();
+  if (adaptiveDebounce_) {
+    for (auto const& kv : adaptiveDebounce_->getCounters()) {
+      counters[kv.first] = kv.second;
+    }
+  }
+  counters["decision.skipped_adj_db_decodes"] = numSkippedAdjDbDecodes_;
+  counters["decision.skipped_prefix_db_decodes"] = numSkippedPrefixDbDecodes_;
+  counters["decision.merged_publications"] = numMergedPublications_;
+  counters["decision.unchanged_route_dbs"] = numUnchangedRouteDbs_;
+  if (not snapshotFilePath_.empty()) {
+    counters["decision.snapshot.failures"] = numSnapshotFailures_;
+    counters["decision.snapshot.restored_nodes"] = numSnapshotRestoredNodes_;
+    counters["decision.snapshot.stale_dbs"] = numSnapshotStaleDbs_;
+    counters["decision.snapshot.time_ms"] = lastSnapshotTimeMs_;
+  }
+  if (prefixLimits_.isEnabled()) {
+    int64_t numRejected{0}, numOverNodeLimit{0}, numOverLimit{0};
+    int64_t numNodesOverLimit{0};
+    for (auto const& kv : prefixLimiters_) {
+      numRejected += kv.second.getNumRejected();
+      numOverNodeLimit += kv.second.getNumOverNodeLimit();
+      numOverLimit += kv.second.getNumOverLimit();
+      numNodesOverLimit += kv.second.getNodesOverLimit().size();
+    }
+    counters["decision.prefix_limits.rejected"] = numRejected;
+    counters["decision.prefix_limits.over_node_limit"] = numOverNodeLimit;
+    counters["decision.prefix_limits.over_limit"] = numOverLimit;
+    counters["decision.prefix_limits.nodes_over_limit"] = numNodesOverLimit;
+  }
+  if (computeExecutor_) {
+    // route computation counters are maintained by computeSolver_
+    for (auto const& kv : *computeCounters_.rlock()) {
+      counters[kv.first] = kv.second;
+    }
+    counters["decision.compute_jobs"] = numComputeRuns_.load();
+    counters["decision.compute_jobs_cancelled"] = numComputeCancelled_.load();
+  }
+  return counters;
+}
+
+std::vector<thrift::PrefixDatabase>
+Decision::applyPrefixLimits(
+    thrift::PrefixDatabase nodePrefixDb, const std::string& area) {
+  if (not prefixLimits_.isEnabled()) {
+    std::vector<thrift::PrefixDatabase> prefixDbs;
+    prefixDbs.emplace_back(std::move(nodePrefixDb));
+    return prefixDbs;
+  }
+  auto it = prefixLimiters_.find(area);
+  if (it == prefixLimiters_.end()) {
+    it = prefixLimiters_.emplace(area, PrefixLimiter(prefixLimits_)).first;
+  }
+  return it->second.updatePrefixDatabase(nodePrefixDb);
+}
+
+bool
+Decision::updatePrefixDatabase(
+    const thrift::PrefixDatabase& prefixDb,
+    std::unordered_set<thrift::IpPrefix>& changedPrefixes,
+    const std::string& area) {
+  queueComputeUpdate([prefixDb, area](SpfSolver& solver) {
+    solver.updatePrefixDatabase(prefixDb, nullptr, area);
+  });
+  if (auto snapshot = getMutableWhatIfSnapshot()) {
+    auto& prefixDbs = snapshot->prefixDbs[area];
+    if (prefixDb.prefixEntries.empty()) {
+      prefixDbs.erase(prefixDb.thisNodeName);
+    } else {
+      prefixDbs[prefixDb.thisNodeName] =
+          std::make_shared<const thrift::PrefixDatabase>(prefixDb);
+    }
+  }
+  return spfSolver_->updatePrefixDatabase(prefixDb, &changedPrefixes, area);
+}
+
 thrift::PrefixDatabase
 Decision::updateNodePrefixDatabase(
-    const std::string& key, const thrift::PrefixDatabase& prefixDb) {
+    const std::string& key,
+    const thrift::PrefixDatabase& prefixDb,
+    const std::string& area) {
   auto const& nodeName = prefixDb.thisNodeName;
+  auto& perPrefixPrefixEntries = perPrefixPrefixEntries_[area];
+  auto& fullDbPrefixEntries = fullDbPrefixEntries_[area];
 
   auto prefixKey = PrefixKey::fromStr(key);
   if (prefixKey.hasValue()) {
     // per prefix key
     if (prefixDb.deletePrefix) {
-      perPrefixPrefixEntries_[nodeName].erase(prefixKey.value().getIpPrefix());
+      perPrefixPrefixEntries[nodeName].erase(prefixKey.value().getIpPrefix());
     } else {
       if (prefixDb.prefixEntries.empty()) {
         LOG(ERROR) << "Received no entries for prefix db";
       } else {
         LOG_IF(ERROR, prefixDb.prefixEntries.size() > 1)
             << "Received more than one prefix, only the first prefix is processed";
-        perPrefixPrefixEntries_[nodeName][prefixKey.value().getIpPrefix()] =
+        perPrefixPrefixEntries[nodeName][prefixKey.value().getIpPrefix()] =
             prefixDb.prefixEntries[0];
       }
     }
   } else {
-    fullDbPrefixEntries_[nodeName].clear();
+    auto& keyEntries = fullDbPrefixEntries[nodeName][key];
+    keyEntries.clear();
     for (auto const& entry : prefixDb.prefixEntries) {
-      fullDbPrefixEntries_[nodeName][entry.prefix] = entry;
+      keyEntries[entry.prefix] = entry;
+    }
+    if (keyEntries.empty()) {
+      fullDbPrefixEntries[nodeName].erase(key);
     }
   }
 
   thrift::PrefixDatabase nodePrefixDb;
   nodePrefixDb.thisNodeName = nodeName;
   nodePrefixDb.perfEvents = prefixDb.perfEvents;
-  nodePrefixDb.prefixEntries.reserve(perPrefixPrefixEntries_[nodeName].size());
-  for (auto& kv : perPrefixPrefixEntries_[nodeName]) {
+  nodePrefixDb.prefixEntries.reserve(perPrefixPrefixEntries[nodeName].size());
+  for (auto& kv : perPrefixPrefixEntries[nodeName]) {
     nodePrefixDb.prefixEntries.emplace_back(kv.second);
   }
-  for (auto& kv : fullDbPrefixEntries_[nodeName]) {
-    if (not perPrefixPrefixEntries_[nodeName].count(kv.first)) {
-      nodePrefixDb.prefixEntries.emplace_back(kv.second);
+  std::unordered_set<thrift::IpPrefix> fullDbPrefixes;
+  for (auto& keyEntries : fullDbPrefixEntries[nodeName]) {
+    for (auto& kv : keyEntries.second) {
+      if (not perPrefixPrefixEntries[nodeName].count(kv.first) and
+          fullDbPrefixes.emplace(kv.first).second) {
+        nodePrefixDb.prefixEntries.emplace_back(kv.second);
+      }
     }
   }
   return nodePrefixDb;
@@ -1805,6 +4202,10 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
     return res;
   }
 
+  const auto area =
+      thriftPub.area.value_or(thrift::KvStore_constants::kDefaultArea());
+  auto& areaAppliedValues = appliedValues_[area];
+
   for (const auto& kv : thriftPub.keyVals) {
     const auto& key = kv.first;
     const auto& rawVal = kv.second;
@@ -1816,40 +4217,97 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
       continue;
     }
 
+    // re-floods of the value applied last change nothing, skip decoding them
+    const bool isAdjDb = key.find(adjacencyDbMarker_) == 0;
+    const bool isPrefixDb = not isAdjDb and key.find(prefixDbMarker_) == 0;
+    std::pair<uint64_t, uint64_t> fingerprint{0, 0};
+    if (isAdjDb or isPrefixDb) {
+      auto const& value = rawVal.value.value();
+      folly::hash::SpookyHashV2::Hash128(
+          value.data(), value.size(), &fingerprint.first, &fingerprint.second);
+      auto it = areaAppliedValues.find(key);
+      if (it != areaAppliedValues.end() and
+          it->second.fingerprint == fingerprint and
+          it->second.version == rawVal.version and
+          it->second.originatorId == rawVal.originatorId) {
+        ++(isAdjDb ? numSkippedAdjDbDecodes_ : numSkippedPrefixDbDecodes_);
+        continue;
+      }
+      // forget the value applied last until this one is applied
+      if (it != areaAppliedValues.end()) {
+        areaAppliedValues.erase(it);
+      }
+    }
+    auto setAppliedValue = [&]() {
+      areaAppliedValues[key] =
+          AppliedValue{rawVal.version, rawVal.originatorId, fingerprint};
+    };
+
     try {
-      if (key.find(adjacencyDbMarker_) == 0) {
+      if (isAdjDb) {
         // update adjacencyDb
         auto adjacencyDb =
             fbzmq::util::readThriftObjStr<thrift::AdjacencyDatabase>(
                 rawVal.value.value(), serializer_);
         CHECK_EQ(nodeName, adjacencyDb.thisNodeName);
-        auto rc = spfSolver_->updateAdjacencyDatabase(adjacencyDb);
+        eraseSnapshotNode(snapshotAdjNodes_, area, nodeName);
+        // the decoded database is moved into the solver, only copied for the
+        // compute solver and the what-if snapshot if there are any
+        if (computeExecutor_) {
+          queueComputeUpdate([adjacencyDb, area](SpfSolver& solver) mutable {
+            solver.updateAdjacencyDatabase(std::move(adjacencyDb), area);
+          });
+        }
+        if (auto snapshot = getMutableWhatIfSnapshot()) {
+          snapshot->adjDbs[area][nodeName] =
+              std::make_shared<const thrift::AdjacencyDatabase>(adjacencyDb);
+        }
+        const auto perfEvents = adjacencyDb.perfEvents;
+        auto rc =
+            spfSolver_->updateAdjacencyDatabase(std::move(adjacencyDb), area);
+        if (rc.first or rc.second) {
+          ++lsdbVersion_;
+        }
         if (rc.first) {
           res.adjChanged = true;
-          pendingAdjUpdates_.addUpdate(myNodeName_, adjacencyDb.perfEvents);
+          pendingAdjUpdates_.addUpdate(myNodeName_, perfEvents);
         }
         if (rc.second && nodeName == myNodeName_) {
           // route attribute chanegs only matter for the local node
           res.prefixesChanged = true;
-          pendingPrefixUpdates_.addUpdate(myNodeName_, adjacencyDb.perfEvents);
+          pendingPrefixUpdates_.addUpdate(myNodeName_, perfEvents);
+          pendingPrefixUpdates_.setNeedsFullRebuild();
         }
         if (spfSolver_->hasHolds() && orderedFibTimer_ != nullptr &&
             !orderedFibTimer_->isScheduled()) {
           orderedFibTimer_->scheduleTimeout(getMaxFib());
         }
+        setAppliedValue();
         continue;
       }
 
-      if (key.find(prefixDbMarker_) == 0) {
+      if (isPrefixDb) {
         // update prefixDb
         auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
             rawVal.value.value(), serializer_);
         CHECK_EQ(nodeName, prefixDb.thisNodeName);
-        auto nodePrefixDb = updateNodePrefixDatabase(key, prefixDb);
-        if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
+        eraseSnapshotNode(snapshotPrefixNodes_, area, nodeName);
+        auto nodePrefixDb = updateNodePrefixDatabase(key, prefixDb, area);
+        auto const perfEvents = nodePrefixDb.perfEvents;
+        std::unordered_set<thrift::IpPrefix> changedPrefixes;
+        bool prefixesChanged{false};
+        for (auto const& limitedPrefixDb :
+             applyPrefixLimits(std::move(nodePrefixDb), area)) {
+          prefixesChanged |=
+              updatePrefixDatabase(limitedPrefixDb, changedPrefixes, area);
+        }
+        if (prefixesChanged) {
+          ++lsdbVersion_;
           res.prefixesChanged = true;
-          pendingPrefixUpdates_.addUpdate(myNodeName_, nodePrefixDb.perfEvents);
+          pendingPrefixUpdates_.addUpdate(myNodeName_, perfEvents);
+          pendingPrefixUpdates_.addChangedPrefixes(changedPrefixes);
         }
+        setAppliedValue();
         continue;
       }
 
@@ -1873,9 +4331,18 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
   // LSDB deletion
   for (const auto& key : thriftPub.expiredKeys) {
     std::string nodeName = getNodeNameFromKey(key);
+    areaAppliedValues.erase(key);
 
     if (key.find(adjacencyDbMarker_) == 0) {
-      if (spfSolver_->deleteAdjacencyDatabase(nodeName)) {
+      eraseSnapshotNode(snapshotAdjNodes_, area, nodeName);
+      queueComputeUpdate([nodeName, area](SpfSolver& solver) {
+        solver.deleteAdjacencyDatabase(nodeName, area);
+      });
+      if (auto snapshot = getMutableWhatIfSnapshot()) {
+        snapshot->adjDbs[area].erase(nodeName);
+      }
+      if (spfSolver_->deleteAdjacencyDatabase(nodeName, area)) {
+        ++lsdbVersion_;
         res.adjChanged = true;
         pendingAdjUpdates_.addUpdate(myNodeName_, folly::none);
       }
@@ -1883,13 +4350,23 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
     }
 
     if (key.find(prefixDbMarker_) == 0) {
+      eraseSnapshotNode(snapshotPrefixNodes_, area, nodeName);
       // manually build delete prefix db to signal delete just as a client would
       thrift::PrefixDatabase deletePrefixDb;
       deletePrefixDb.thisNodeName = nodeName;
       deletePrefixDb.deletePrefix = true;
-      auto nodePrefixDb = updateNodePrefixDatabase(key, deletePrefixDb);
-      if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
+      auto nodePrefixDb = updateNodePrefixDatabase(key, deletePrefixDb, area);
+      std::unordered_set<thrift::IpPrefix> changedPrefixes;
+      bool prefixesChanged{false};
+      for (auto const& limitedPrefixDb :
+           applyPrefixLimits(std::move(nodePrefixDb), area)) {
+        prefixesChanged |=
+            updatePrefixDatabase(limitedPrefixDb, changedPrefixes, area);
+      }
+      if (prefixesChanged) {
+        ++lsdbVersion_;
         res.prefixesChanged = true;
+        pendingPrefixUpdates_.addChangedPrefixes(changedPrefixes);
       }
       continue;
     }
@@ -1904,20 +4381,44 @@ Decision::submitCounters() {
   VLOG(3) << "Submitting counters...";
 
   // Prepare for submitting counters
-  auto counters = spfSolver_->getCounters();
+  auto counters = getSolverCounters();
   counters["decision.zmq_event_queue_size"] =
       getEvb()->getNotificationQueueSize();
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
+void
+Decision::updateDebounce() {
+  const std::chrono::milliseconds minDur(debounceMinMs_.get());
+  const std::chrono::milliseconds maxDur(
+      std::max(debounceMinMs_.get(), debounceMaxMs_.get()));
+  if (minDur == processUpdatesBackoff_.getInitialBackoff() and
+      maxDur == processUpdatesBackoff_.getMaxBackoff()) {
+    return;
+  }
+  LOG(INFO) << "Decision debounce changed to [" << minDur.count() << "ms, "
+            << maxDur.count() << "ms]";
+  processUpdatesBackoff_ =
+      ExponentialBackoff<std::chrono::milliseconds>(minDur, maxDur);
+}
+
 void
 Decision::processPendingUpdates() {
+  const auto startTime = std::chrono::steady_clock::now();
   if (processUpdatesStatus_.adjChanged) {
     processPendingAdjUpdates();
   } else if (processUpdatesStatus_.prefixesChanged) {
     processPendingPrefixUpdates();
   }
+  // asynchronous computations are reported once done
+  if (adaptiveDebounce_ and not computeExecutor_) {
+    const auto endTime = std::chrono::steady_clock::now();
+    adaptiveDebounce_->reportCompute(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            endTime - startTime),
+        endTime);
+  }
 
   // reset update status
   processUpdatesStatus_.adjChanged = false;
@@ -1956,6 +4457,15 @@ Decision::processPendingAdjUpdates() {
     return;
   }
 
+  if (computeExecutor_) {
+    detail::DecisionComputeRequest request;
+    request.type = detail::DecisionComputeRequest::Type::FULL;
+    request.perfEvents = std::move(maybePerfEvents);
+    request.eventDescription = "DECISION_SPF";
+    requestCompute(std::move(request));
+    return;
+  }
+
   // run SPF once for all updates received
   LOG(INFO) << "Decision: computing new paths.";
   auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
@@ -1965,12 +4475,20 @@ Decision::processPendingAdjUpdates() {
   }
 
   maybeRouteDb.value().perfEvents = maybePerfEvents;
+  if (maybePerfEvents) {
+    addComputePhasePerfEvents(
+        *maybeRouteDb->perfEvents,
+        myNodeName_,
+        spfSolver_->getLastComputePhases());
+  }
   sendRouteUpdate(maybeRouteDb.value(), "DECISION_SPF");
 }
 
 void
 Decision::processPendingPrefixUpdates() {
   auto maybePerfEvents = pendingPrefixUpdates_.getPerfEvents();
+  const auto needsFullRebuild = pendingPrefixUpdates_.needsFullRebuild();
+  const auto changedPrefixes = pendingPrefixUpdates_.getChangedPrefixes();
   pendingPrefixUpdates_.clear();
   if (coldStartTimer_->isScheduled()) {
     return;
@@ -1979,6 +4497,37 @@ Decision::processPendingPrefixUpdates() {
   if (maybePerfEvents) {
     addPerfEvent(*maybePerfEvents, myNodeName_, "DECISION_DEBOUNCE");
   }
+
+  if (computeExecutor_) {
+    detail::DecisionComputeRequest request;
+    if (needsFullRebuild or changedPrefixes.empty()) {
+      request.type = detail::DecisionComputeRequest::Type::ROUTE_DB;
+    } else {
+      request.changedPrefixes = changedPrefixes;
+    }
+    request.perfEvents = std::move(maybePerfEvents);
+    request.eventDescription = "ROUTE_UPDATE";
+    requestCompute(std::move(request));
+    return;
+  }
+
+  // SPF results are still valid, recompute routes only for changed prefixes
+  if (not needsFullRebuild and not changedPrefixes.empty()) {
+    auto maybeRouteDbDelta =
+        spfSolver_->buildRouteDbDelta(myNodeName_, changedPrefixes);
+    if (maybeRouteDbDelta.hasValue()) {
+      maybeRouteDbDelta.value().perfEvents = maybePerfEvents;
+      if (maybePerfEvents) {
+        addComputePhasePerfEvents(
+            *maybeRouteDbDelta->perfEvents,
+            myNodeName_,
+            spfSolver_->getLastComputePhases());
+      }
+      sendRouteDelta(maybeRouteDbDelta.value(), "ROUTE_UPDATE");
+      return;
+    }
+  }
+
   // update routeDb once for all updates received
   LOG(INFO) << "Decision: updating new routeDb.";
   auto maybeRouteDb = spfSolver_->buildRouteDb(myNodeName_);
@@ -1988,15 +4537,32 @@ Decision::processPendingPrefixUpdates() {
   }
 
   maybeRouteDb.value().perfEvents = maybePerfEvents;
+  if (maybePerfEvents) {
+    addComputePhasePerfEvents(
+        *maybeRouteDb->perfEvents,
+        myNodeName_,
+        spfSolver_->getLastComputePhases());
+  }
   sendRouteUpdate(maybeRouteDb.value(), "ROUTE_UPDATE");
 }
 
 void
 Decision::decrementOrderedFibHolds() {
+  queueComputeUpdate([](SpfSolver& solver) { solver.decrementHolds(); });
   if (spfSolver_->decrementHolds()) {
     if (coldStartTimer_->isScheduled()) {
       return;
     }
+    if (computeExecutor_) {
+      detail::DecisionComputeRequest request;
+      request.type = detail::DecisionComputeRequest::Type::FULL;
+      // Create empty perfEvents list. In this case we don't this route update
+      // to be inculded in the Fib time
+      request.perfEvents = thrift::PerfEvents{};
+      request.eventDescription = "ORDERED_FIB_HOLDS_EXPIRED";
+      requestCompute(std::move(request));
+      return;
+    }
     auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
     if (not maybeRouteDb.hasValue()) {
       LOG(INFO) << "decrementOrderedFibHolds incurred no route updates";
@@ -2012,6 +4578,17 @@ Decision::decrementOrderedFibHolds() {
 
 void
 Decision::coldStartUpdate() {
+  reconcileSnapshot();
+  if (computeExecutor_) {
+    detail::DecisionComputeRequest request;
+    request.type = detail::DecisionComputeRequest::Type::FULL;
+    request.perfEvents = thrift::PerfEvents{};
+    request.eventDescription = "COLD_START_UPDATE";
+    request.coldStart = true;
+    requestCompute(std::move(request));
+    return;
+  }
+
   auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
   if (not maybeRouteDb.hasValue()) {
     LOG(ERROR) << "SEVERE: No routes to program after cold start duration. "
@@ -2026,6 +4603,326 @@ Decision::coldStartUpdate() {
   sendRouteUpdate(maybeRouteDb.value(), "COLD_START_UPDATE");
 }
 
+bool
+Decision::saveSnapshot() noexcept {
+  // the link state is incomplete until the graceful restart window ends, and
+  // saving it would also renew the age of restored databases
+  if (coldStartTimer_->isScheduled()) {
+    return false;
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  thrift::DecisionSnapshot snapshot;
+  snapshot.timestampMs = getUnixTimeStampMs();
+  size_t numNodes = 0;
+  for (auto const& area : spfSolver_->getAreas()) {
+    auto adjDbs = spfSolver_->getAdjacencyDatabases(area);
+    numNodes += adjDbs.size();
+    snapshot.areaAdjDbs.emplace(area, std::move(adjDbs));
+    snapshot.areaPrefixDbs.emplace(
+        area, spfSolver_->getPrefixDatabases(area));
+  }
+
+  try {
+    std::string fileData;
+    serializer_.serialize(snapshot, &fileData);
+    folly::writeFileAtomic(snapshotFilePath_, fileData, 0666);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to write Decision snapshot to '" << snapshotFilePath_
+               << "'. Error: " << folly::exceptionStr(e);
+    ++numSnapshotFailures_;
+    return false;
+  }
+
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  VLOG(1) << "Saved Decision snapshot of " << numNodes << " nodes in "
+          << duration.count() << "ms";
+  lastSnapshotTimeMs_ = duration.count();
+  return true;
+}
+
+void
+Decision::loadSnapshot() noexcept {
+  // without a graceful restart window, routes of partially received live
+  // databases replace the restored ones right away
+  if (not coldStartTimer_->isScheduled()) {
+    LOG(INFO) << "Not restoring Decision snapshot without graceful restart";
+    return;
+  }
+  if (not fileExists(snapshotFilePath_)) {
+    LOG(INFO) << "Decision snapshot " << snapshotFilePath_ << " doesn't exist";
+    return;
+  }
+
+  thrift::DecisionSnapshot snapshot;
+  try {
+    std::string fileData;
+    if (not folly::readFile(snapshotFilePath_.c_str(), fileData)) {
+      LOG(ERROR) << "Failed to read Decision snapshot from '"
+                 << snapshotFilePath_ << "'. Error (" << errno
+                 << "): " << folly::errnoStr(errno);
+      ++numSnapshotFailures_;
+      return;
+    }
+    serializer_.deserialize(fileData, snapshot);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to decode Decision snapshot from '"
+               << snapshotFilePath_ << "'. Error: " << folly::exceptionStr(e);
+    ++numSnapshotFailures_;
+    return;
+  }
+
+  const auto age = std::chrono::milliseconds(
+      std::max<int64_t>(0, getUnixTimeStampMs() - snapshot.timestampMs));
+  if (age > Constants::kDecisionSnapshotMaxAge) {
+    LOG(INFO) << "Not restoring Decision snapshot taken " << age.count()
+              << "ms ago";
+    return;
+  }
+
+  // databases received live meanwhile are more recent
+  for (auto& kv : snapshot.areaAdjDbs) {
+    auto const& area = kv.first;
+    auto const liveAdjDbs = spfSolver_->getAdjacencyDatabases(area);
+    for (auto& nodeAdjDb : kv.second) {
+      auto const& adjDb = nodeAdjDb.second;
+      if (liveAdjDbs.count(adjDb.thisNodeName)) {
+        continue;
+      }
+      spfSolver_->updateAdjacencyDatabase(adjDb, area);
+      queueComputeUpdate([adjDb, area](SpfSolver& solver) {
+        solver.updateAdjacencyDatabase(adjDb, area);
+      });
+      if (auto whatIfSnapshot = getMutableWhatIfSnapshot()) {
+        whatIfSnapshot->adjDbs[area][adjDb.thisNodeName] =
+            std::make_shared<const thrift::AdjacencyDatabase>(adjDb);
+      }
+      snapshotAdjNodes_[area].emplace(adjDb.thisNodeName);
+    }
+  }
+  for (auto& kv : snapshot.areaPrefixDbs) {
+    auto const& area = kv.first;
+    auto const livePrefixDbs = spfSolver_->getPrefixDatabases(area);
+    std::unordered_set<thrift::IpPrefix> changedPrefixes;
+    for (auto& nodePrefixDb : kv.second) {
+      auto const& prefixDb = nodePrefixDb.second;
+      if (livePrefixDbs.count(prefixDb.thisNodeName)) {
+        continue;
+      }
+      updatePrefixDatabase(prefixDb, changedPrefixes, area);
+      snapshotPrefixNodes_[area].emplace(prefixDb.thisNodeName);
+    }
+  }
+
+  std::unordered_set<std::string> restoredNodes;
+  for (auto const& nodes : {&snapshotAdjNodes_, &snapshotPrefixNodes_}) {
+    for (auto const& kv : *nodes) {
+      restoredNodes.insert(kv.second.begin(), kv.second.end());
+    }
+  }
+  numSnapshotRestoredNodes_ = restoredNodes.size();
+  if (restoredNodes.empty()) {
+    return;
+  }
+  ++lsdbVersion_;
+  LOG(INFO) << "Restored databases of " << restoredNodes.size()
+            << " nodes from Decision snapshot taken " << age.count()
+            << "ms ago. Computing provisional routes";
+
+  if (computeExecutor_) {
+    detail::DecisionComputeRequest request;
+    request.type = detail::DecisionComputeRequest::Type::FULL;
+    request.perfEvents = thrift::PerfEvents{};
+    request.eventDescription = "DECISION_SNAPSHOT_RESTORE";
+    requestCompute(std::move(request));
+    return;
+  }
+  auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
+  if (maybeRouteDb.hasValue()) {
+    maybeRouteDb.value().perfEvents = thrift::PerfEvents{};
+    sendRouteUpdate(maybeRouteDb.value(), "DECISION_SNAPSHOT_RESTORE");
+  }
+}
+
+void
+Decision::reconcileSnapshot() {
+  if (snapshotAdjNodes_.empty() and snapshotPrefixNodes_.empty()) {
+    return;
+  }
+
+  int64_t numStaleDbs{0};
+  for (auto const& kv : snapshotAdjNodes_) {
+    auto const& area = kv.first;
+    for (auto const& nodeName : kv.second) {
+      VLOG(1) << "Removing restored adjacency database of " << nodeName
+              << " in area " << area;
+      queueComputeUpdate([nodeName, area](SpfSolver& solver) {
+        solver.deleteAdjacencyDatabase(nodeName, area);
+      });
+      if (auto snapshot = getMutableWhatIfSnapshot()) {
+        snapshot->adjDbs[area].erase(nodeName);
+      }
+      spfSolver_->deleteAdjacencyDatabase(nodeName, area);
+      ++numStaleDbs;
+    }
+  }
+  for (auto const& kv : snapshotPrefixNodes_) {
+    auto const& area = kv.first;
+    std::unordered_set<thrift::IpPrefix> changedPrefixes;
+    for (auto const& nodeName : kv.second) {
+      VLOG(1) << "Removing restored prefix database of " << nodeName
+              << " in area " << area;
+      thrift::PrefixDatabase emptyPrefixDb;
+      emptyPrefixDb.thisNodeName = nodeName;
+      updatePrefixDatabase(emptyPrefixDb, changedPrefixes, area);
+      ++numStaleDbs;
+    }
+  }
+  snapshotAdjNodes_.clear();
+  snapshotPrefixNodes_.clear();
+  ++lsdbVersion_;
+  numSnapshotStaleDbs_ += numStaleDbs;
+  LOG(INFO) << "Removed " << numStaleDbs << " restored databases of nodes "
+            << "not advertised since the restart";
+}
+
+void
+Decision::queueComputeUpdate(folly::Function<void(SpfSolver&)> update) {
+  if (computeExecutor_) {
+    pendingComputeUpdates_.emplace_back(std::move(update));
+  }
+}
+
+void
+Decision::requestCompute(detail::DecisionComputeRequest request) {
+  // Supersede any outstanding computation. The merged request is a superset
+  // of everything not yet published, so older results can be dropped.
+  const auto generation = ++computeGeneration_;
+  outstandingRequests_.emplace(generation, std::move(request));
+  auto it = outstandingRequests_.begin();
+  auto mergedRequest = it->second;
+  while (++it != outstandingRequests_.end()) {
+    mergedRequest.merge(it->second);
+  }
+  computeExecutor_->add([this,
+                         generation,
+                         updates = std::move(pendingComputeUpdates_),
+                         request = std::move(mergedRequest)]() mutable {
+    runCompute(generation, std::move(updates), std::move(request));
+  });
+  pendingComputeUpdates_.clear();
+}
+
+void
+Decision::runCompute(
+    uint64_t generation,
+    std::vector<folly::Function<void(SpfSolver&)>> updates,
+    detail::DecisionComputeRequest request) {
+  // updates must be applied regardless, next computations build on them
+  for (auto& update : updates) {
+    update(*computeSolver_);
+  }
+  if (detail::isComputeSuperseded(
+          generation,
+          computeGeneration_.load(),
+          lastPublishedComputeGeneration_)) {
+    ++numComputeCancelled_;
+    return;
+  }
+  ++numComputeRuns_;
+
+  const auto startTime = std::chrono::steady_clock::now();
+  folly::Optional<thrift::RouteDatabase> maybeRouteDb;
+  folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDbDelta;
+  switch (request.type) {
+  case detail::DecisionComputeRequest::Type::PREFIX_DELTA:
+    maybeRouteDbDelta =
+        computeSolver_->buildRouteDbDelta(myNodeName_, request.changedPrefixes);
+    if (not maybeRouteDbDelta.hasValue()) {
+      maybeRouteDb = computeSolver_->buildRouteDb(myNodeName_);
+    }
+    break;
+  case detail::DecisionComputeRequest::Type::ROUTE_DB:
+    maybeRouteDb = computeSolver_->buildRouteDb(myNodeName_);
+    break;
+  case detail::DecisionComputeRequest::Type::FULL:
+    maybeRouteDb = computeSolver_->buildPaths(myNodeName_);
+    break;
+  }
+  *computeCounters_.wlock() = computeSolver_->getCounters();
+  if (request.perfEvents) {
+    addComputePhasePerfEvents(
+        *request.perfEvents,
+        myNodeName_,
+        computeSolver_->getLastComputePhases());
+  }
+
+  // a newer request came in meanwhile and will cover this one
+  if (detail::isComputeSuperseded(
+          generation,
+          computeGeneration_.load(),
+          lastPublishedComputeGeneration_)) {
+    ++numComputeCancelled_;
+    return;
+  }
+  lastPublishedComputeGeneration_ = generation;
+
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  runInEventBaseThread([this,
+                        generation,
+                        duration,
+                        request = std::move(request),
+                        maybeRouteDb = std::move(maybeRouteDb),
+                        maybeRouteDbDelta =
+                            std::move(maybeRouteDbDelta)]() mutable {
+    if (adaptiveDebounce_) {
+      adaptiveDebounce_->reportCompute(duration);
+    }
+    applyComputeResult(
+        generation,
+        std::move(request),
+        std::move(maybeRouteDb),
+        std::move(maybeRouteDbDelta));
+  });
+}
+
+void
+Decision::applyComputeResult(
+    uint64_t generation,
+    detail::DecisionComputeRequest request,
+    folly::Optional<thrift::RouteDatabase> maybeRouteDb,
+    folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDbDelta) {
+  // Results are computed in order, so even one superseded meanwhile covers
+  // everything published before. Only requests of later generations stay
+  // outstanding
+  outstandingRequests_.erase(
+      outstandingRequests_.begin(),
+      outstandingRequests_.upper_bound(generation));
+
+  if (maybeRouteDbDelta.hasValue()) {
+    maybeRouteDbDelta->perfEvents = std::move(request.perfEvents);
+    sendRouteDelta(maybeRouteDbDelta.value(), request.eventDescription);
+    return;
+  }
+
+  if (not maybeRouteDb.hasValue()) {
+    if (request.coldStart) {
+      LOG(ERROR) << "SEVERE: No routes to program after cold start duration. "
+                 << "Sending empty route db to FIB";
+      thrift::RouteDatabase db;
+      sendRouteUpdate(db, request.eventDescription);
+      return;
+    }
+    LOG(WARNING) << request.eventDescription << " incurred no route updates";
+    return;
+  }
+
+  maybeRouteDb->perfEvents = std::move(request.perfEvents);
+  sendRouteUpdate(maybeRouteDb.value(), request.eventDescription);
+}
+
 void
 Decision::sendRouteUpdate(
     thrift::RouteDatabase& db, std::string const& eventDescription) {
@@ -2033,13 +4930,142 @@ Decision::sendRouteUpdate(
     addPerfEvent(db.perfEvents.value(), myNodeName_, eventDescription);
   }
 
-  // Find out delta to be sent to Fib
-  auto routeDelta = findDeltaRoutes(db, routeDb_);
-  routeDelta.perfEvents = db.perfEvents;
-  routeDb_ = std::move(db);
+  // Fingerprint the new routes, and the whole database with them
+  std::vector<uint64_t> unicastFingerprints;
+  unicastFingerprints.reserve(db.unicastRoutes.size());
+  uint64_t dbFingerprint = 0;
+  for (auto const& route : db.unicastRoutes) {
+    unicastFingerprints.emplace_back(getRouteFingerprint(route));
+    dbFingerprint += folly::hash::twang_mix64(unicastFingerprints.back());
+  }
+  std::vector<uint64_t> mplsFingerprints;
+  mplsFingerprints.reserve(db.mplsRoutes.size());
+  for (auto const& route : db.mplsRoutes) {
+    mplsFingerprints.emplace_back(getRouteFingerprint(route));
+    dbFingerprint += folly::hash::twang_mix64(mplsFingerprints.back());
+  }
+
+  RouteUpdate routeUpdate;
+  routeUpdate.thisNodeName = myNodeName_;
+  routeUpdate.perfEvents = db.perfEvents;
+
+  // Nothing changed. Fib still gets an empty update to account for the
+  // computation (perf events, convergence) but routes are left as is
+  if (dbFingerprint == routeDbFingerprint_) {
+    ++numUnchangedRouteDbs_;
+    routeUpdatesQueue_.push(std::move(routeUpdate));
+    return;
+  }
+
+  // Find out delta to be sent to Fib by comparing fingerprints of routes.
+  // Changed routes are moved into records shared with snapshots and Fib
+  std::unordered_map<thrift::IpPrefix, uint64_t> unicastRouteFingerprints;
+  unicastRouteFingerprints.reserve(db.unicastRoutes.size());
+  for (size_t i = 0; i < db.unicastRoutes.size(); ++i) {
+    auto& route = db.unicastRoutes[i];
+    unicastRouteFingerprints[route.dest] = unicastFingerprints[i];
+    auto it = unicastRouteFingerprints_.find(route.dest);
+    if (it == unicastRouteFingerprints_.end() or
+        it->second != unicastFingerprints[i]) {
+      routeUpdate.unicastRoutesToUpdate.emplace_back(
+          std::make_shared<const thrift::UnicastRoute>(std::move(route)));
+    }
+  }
+  for (auto const& kv : unicastRouteFingerprints_) {
+    if (not unicastRouteFingerprints.count(kv.first)) {
+      routeUpdate.unicastRoutesToDelete.emplace_back(kv.first);
+    }
+  }
+  std::sort(
+      routeUpdate.unicastRoutesToDelete.begin(),
+      routeUpdate.unicastRoutesToDelete.end());
+
+  std::unordered_map<int32_t, uint64_t> mplsRouteFingerprints;
+  mplsRouteFingerprints.reserve(db.mplsRoutes.size());
+  for (size_t i = 0; i < db.mplsRoutes.size(); ++i) {
+    auto& route = db.mplsRoutes[i];
+    mplsRouteFingerprints[route.topLabel] = mplsFingerprints[i];
+    auto it = mplsRouteFingerprints_.find(route.topLabel);
+    if (it == mplsRouteFingerprints_.end() or
+        it->second != mplsFingerprints[i]) {
+      routeUpdate.mplsRoutesToUpdate.emplace_back(
+          std::make_shared<const thrift::MplsRoute>(std::move(route)));
+    }
+  }
+  for (auto const& kv : mplsRouteFingerprints_) {
+    if (not mplsRouteFingerprints.count(kv.first)) {
+      routeUpdate.mplsRoutesToDelete.emplace_back(kv.first);
+    }
+  }
+  std::sort(
+      routeUpdate.mplsRoutesToDelete.begin(),
+      routeUpdate.mplsRoutesToDelete.end());
+
+  unicastRouteFingerprints_ = std::move(unicastRouteFingerprints);
+  mplsRouteFingerprints_ = std::move(mplsRouteFingerprints);
+  routeDbFingerprint_ = dbFingerprint;
+
+  publishRouteUpdate(std::move(routeUpdate));
+}
+
+void
+Decision::sendRouteDelta(
+    thrift::RouteDatabaseDelta& routeDelta,
+    std::string const& eventDescription) {
+  if (routeDelta.perfEvents.hasValue()) {
+    addPerfEvent(routeDelta.perfEvents.value(), myNodeName_, eventDescription);
+  }
+
+  RouteUpdate routeUpdate;
+  routeUpdate.thisNodeName = myNodeName_;
+  routeUpdate.perfEvents = std::move(routeDelta.perfEvents);
+
+  // Apply updates on top of the published routes and only keep the ones
+  // which changed
+  for (auto& route : routeDelta.unicastRoutesToUpdate) {
+    const auto fingerprint = getRouteFingerprint(route);
+    auto it = unicastRouteFingerprints_.find(route.dest);
+    if (it == unicastRouteFingerprints_.end()) {
+      unicastRouteFingerprints_.emplace(route.dest, fingerprint);
+    } else if (it->second != fingerprint) {
+      routeDbFingerprint_ -= folly::hash::twang_mix64(it->second);
+      it->second = fingerprint;
+    } else {
+      continue;
+    }
+    routeDbFingerprint_ += folly::hash::twang_mix64(fingerprint);
+    routeUpdate.unicastRoutesToUpdate.emplace_back(
+        std::make_shared<const thrift::UnicastRoute>(std::move(route)));
+  }
+
+  for (auto& prefix : routeDelta.unicastRoutesToDelete) {
+    auto it = unicastRouteFingerprints_.find(prefix);
+    if (it == unicastRouteFingerprints_.end()) {
+      continue;
+    }
+    routeDbFingerprint_ -= folly::hash::twang_mix64(it->second);
+    unicastRouteFingerprints_.erase(it);
+    routeUpdate.unicastRoutesToDelete.emplace_back(std::move(prefix));
+  }
+
+  // mpls routes are passed on as they are
+  for (auto& route : routeDelta.mplsRoutesToUpdate) {
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        std::make_shared<const thrift::MplsRoute>(std::move(route)));
+  }
+  routeUpdate.mplsRoutesToDelete = std::move(routeDelta.mplsRoutesToDelete);
+
+  publishRouteUpdate(std::move(routeUpdate));
+}
 
-  // publish the new route state
-  routeUpdatesQueue_.push(std::move(routeDelta));
+void
+Decision::publishRouteUpdate(RouteUpdate&& routeUpdate) {
+  if (routeTrace_.isEnabled()) {
+    routeTrace_.record(routeUpdate.toThrift());
+  }
+  routeDbSnapshots_.publish(routeUpdate);
+  // readers get pointers to the routes, not copies
+  routeUpdatesQueue_.push(std::move(routeUpdate));
 }
 
 std::chrono::milliseconds
@@ -7,9 +7,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqThrottle.h>
@@ -17,19 +22,31 @@
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Format.h>
+#include <folly/Function.h>
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/Constants.h>
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/RouteTrace.h>
+#include <openr/common/RuntimeKnobs.h>
 #include <openr/common/Util.h>
+#include <openr/decision/AdaptiveDebounce.h>
+#include <openr/decision/PhaseProfiler.h>
+#include <openr/decision/PrefixLimiter.h>
+#include <openr/fib/RouteDbSnapshot.h>
+#include <openr/fib/RouteUpdate.h>
 #include <openr/if/gen-cpp2/Decision_types.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/KvStore_constants.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/kvstore/KvStore.h>
@@ -47,7 +64,8 @@ struct BestPathCalResult {
   std::set<std::string> nodes;
   folly::Optional<int64_t> bestIgpMetric{folly::none};
   std::string const* bestData{nullptr};
-  folly::Optional<thrift::MetricVector> bestVector{folly::none};
+  folly::Optional<MetricVectorUtils::CompiledMetricVector> bestVector{
+      folly::none};
 };
 
 namespace detail {
@@ -63,6 +81,8 @@ struct DecisionPendingUpdates {
     count_ = 0;
     minTs_ = folly::none;
     perfEvents_ = folly::none;
+    changedPrefixes_.clear();
+    needsFullRebuild_ = false;
   }
 
   void
@@ -102,14 +122,129 @@ struct DecisionPendingUpdates {
     return perfEvents_;
   }
 
+  // Keep track of prefixes affected by pending updates so that routes can be
+  // recomputed only for them
+  void
+  addChangedPrefixes(std::unordered_set<thrift::IpPrefix> const& prefixes) {
+    changedPrefixes_.insert(prefixes.begin(), prefixes.end());
+  }
+
+  std::unordered_set<thrift::IpPrefix> const&
+  getChangedPrefixes() const {
+    return changedPrefixes_;
+  }
+
+  // Mark that pending updates affect all routes, e.g. local route attribute
+  // changes, and can't be applied by recomputing changed prefixes only
+  void
+  setNeedsFullRebuild() {
+    needsFullRebuild_ = true;
+  }
+
+  bool
+  needsFullRebuild() const {
+    return needsFullRebuild_;
+  }
+
  private:
   uint32_t count_{0};
   folly::Optional<int64_t> minTs_;
   folly::Optional<thrift::PerfEvents> perfEvents_;
+  std::unordered_set<thrift::IpPrefix> changedPrefixes_;
+  bool needsFullRebuild_{false};
+};
+
+/**
+ * Route computation requested from the asynchronous compute executor.
+ * Requests issued while earlier ones are still outstanding are merged so that
+ * a newer request always covers all the work of the ones it supersedes.
+ */
+struct DecisionComputeRequest {
+  // ordered by the amount of work, larger types subsume smaller ones
+  enum class Type {
+    PREFIX_DELTA = 0, // recompute routes for changedPrefixes only
+    ROUTE_DB = 1, // rebuild route db from the last SPF results
+    FULL = 2, // run SPF and rebuild route db
+  };
+
+  void
+  merge(DecisionComputeRequest const& other) {
+    type = std::max(type, other.type);
+    changedPrefixes.insert(
+        other.changedPrefixes.begin(), other.changedPrefixes.end());
+    // keep perf events of the oldest request
+    if (not perfEvents.hasValue()) {
+      perfEvents = other.perfEvents;
+    }
+    eventDescription = other.eventDescription;
+    coldStart |= other.coldStart;
+  }
+
+  Type type{Type::PREFIX_DELTA};
+  std::unordered_set<thrift::IpPrefix> changedPrefixes;
+  folly::Optional<thrift::PerfEvents> perfEvents;
+  std::string eventDescription;
+  // publish empty route db if there are no routes to compute
+  bool coldStart{false};
+};
+
+/**
+ * Adjacency and prefix databases of all areas as of a version of the link
+ * state. Shared by all what-if route computations against that version.
+ * Databases are immutable and shared with later snapshots, which only copy
+ * the maps holding them.
+ */
+struct DecisionLsdbSnapshot {
+  using AdjDbPtr = std::shared_ptr<const thrift::AdjacencyDatabase>;
+  using PrefixDbPtr = std::shared_ptr<const thrift::PrefixDatabase>;
+
+  uint64_t version{0};
+  std::map<
+      std::string /* area */,
+      std::unordered_map<std::string /* nodeName */, AdjDbPtr>>
+      adjDbs;
+  std::map<
+      std::string /* area */,
+      std::unordered_map<std::string /* nodeName */, PrefixDbPtr>>
+      prefixDbs;
 };
+
+/**
+ * Apply what-if mutations to the adjacency databases of snapshot and return
+ * the mutated databases only, keyed by area. Throws std::invalid_argument if
+ * a mutation refers to an unknown node or interface.
+ */
+std::map<std::string /* area */, thrift::AdjDbs> applyWhatIfMutations(
+    DecisionLsdbSnapshot const& snapshot, thrift::WhatIfRequest const& request);
+
+/**
+ * Merge publications, given in queue order, into one per area holding only
+ * the latest update of every key, either a value or its expiry. TTL
+ * refreshes don't supersede an earlier value of their key. Merged
+ * publications are ordered by the first publication of their area.
+ */
+std::vector<thrift::Publication> mergePublications(
+    std::vector<KvStorePublicationPtr> const& publications);
+
+/**
+ * Whether the computation of generation can be dropped in favor of the one
+ * of latestGeneration. It can't once Constants::kDecisionMaxDroppedComputes
+ * computations were dropped since lastPublishedGeneration.
+ */
+bool isComputeSuperseded(
+    uint64_t generation,
+    uint64_t latestGeneration,
+    uint64_t lastPublishedGeneration);
 } // namespace detail
 
-// The class to compute shortest-paths using Dijkstra algorithm
+// The class to compute shortest-paths using Dijkstra algorithm.
+//
+// Link and prefix state is maintained separately for each area. Routes are
+// computed per area, concurrently if multiple areas changed, and merged into
+// a single route database. A route computed in multiple areas is taken from
+// the area with the lowest cost next-hop towards it, ties going to the area
+// with the smallest name. Routes of areas without any change since their last
+// computation are reused as is.
 class SpfSolver {
  public:
   // these need to be defined in the .cpp so they can refer
@@ -120,7 +255,8 @@ class SpfSolver {
       bool computeLfaPaths,
       bool enableOrderedFib = false,
       bool bgpDryRun = false,
-      bool bgpUseIgpMetric = false);
+      bool bgpUseIgpMetric = false,
+      size_t numRouteBuildThreads = 1);
   ~SpfSolver();
 
   //
@@ -132,27 +268,40 @@ class SpfSolver {
   std::pair<
       bool /* topology has changed */,
       bool /* route attributes has changed (nexthop addr, node/adj label */>
-  updateAdjacencyDatabase(thrift::AdjacencyDatabase const& adjacencyDb);
+  updateAdjacencyDatabase(
+      thrift::AdjacencyDatabase adjacencyDb,
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
 
   bool hasHolds() const;
 
   // delete a node's adjacency database
   // return true if this has caused any change in graph
-  bool deleteAdjacencyDatabase(const std::string& nodeName);
+  bool deleteAdjacencyDatabase(
+      const std::string& nodeName,
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
 
-  // get adjacency databases
+  // get adjacency databases of an area
   std::unordered_map<
       std::string /* nodeName */,
       thrift::AdjacencyDatabase> const&
-  getAdjacencyDatabases();
+  getAdjacencyDatabases(
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
 
   // update prefixes for a given router. Returns true if this has caused any
-  // routeDb change
-  bool updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb);
-
-  // get prefix databases
+  // routeDb change. Prefixes whose advertisements changed are added to
+  // changedPrefixes if provided
+  bool updatePrefixDatabase(
+      thrift::PrefixDatabase const& prefixDb,
+      std::unordered_set<thrift::IpPrefix>* changedPrefixes = nullptr,
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
+
+  // get prefix databases of an area
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
-  getPrefixDatabases();
+  getPrefixDatabases(
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
+
+  // areas with any link or prefix state, ordered by name
+  std::vector<std::string> getAreas() const;
 
   // Compute all routes from perspective of a given router.
   // Returns folly::none if myNodeName doesn't have any prefix database
@@ -165,18 +314,82 @@ class SpfSolver {
   folly::Optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
 
+  // Build unicast routes only for the given prefixes using cached SPF
+  // computation. Prefixes without a route are reported for deletion and MPLS
+  // routes are left untouched.
+  // Returns folly::none if cached SPF computation is missing or a full route
+  // build is required for these prefixes
+  folly::Optional<thrift::RouteDatabaseDelta> buildRouteDbDelta(
+      const std::string& myNodeName,
+      const std::unordered_set<thrift::IpPrefix>& prefixes);
+
   bool decrementHolds();
 
   std::unordered_map<std::string, int64_t> getCounters();
 
+  // drop cached SPF results and working memory, they are rebuilt on demand
+  void shedCaches();
+
+  // phases of the last buildPaths, buildRouteDb or buildRouteDbDelta call
+  // along with their durations summed over all areas
+  const std::vector<PhaseProfiler::PhaseDuration>&
+  getLastComputePhases() const {
+    return lastComputePhases_;
+  }
+
  private:
   // no-copy
   SpfSolver(SpfSolver const&) = delete;
   SpfSolver& operator=(SpfSolver const&) = delete;
 
-  // pointer to implementation class
+  // implementation class, one instance per area
   class SpfSolverImpl;
-  std::unique_ptr<SpfSolverImpl> impl_;
+
+  // routes of an area as of its last route build for myNodeName_
+  struct AreaRoutes {
+    std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> unicastRoutes;
+    std::vector<thrift::MplsRoute> mplsRoutes;
+  };
+
+  SpfSolverImpl& getOrCreateArea(const std::string& area);
+
+  // build routes of every area with the given method, reusing routes of
+  // unchanged areas if building for myNodeName_, and merge them
+  folly::Optional<thrift::RouteDatabase> buildAreaRoutes(
+      const std::string& myNodeName, bool runSpf);
+
+  // see buildRouteDbDelta()
+  folly::Optional<thrift::RouteDatabaseDelta> buildAreaRouteDbDelta(
+      const std::string& myNodeName,
+      const std::unordered_set<thrift::IpPrefix>& prefixes);
+
+  // find the preferred route towards each prefix and label across areas
+  thrift::RouteDatabase mergeAreaRoutes(
+      const std::unordered_map<std::string, AreaRoutes>& areaRoutes) const;
+
+  const std::string myNodeName_;
+  const bool enableV4_{false};
+  const bool computeLfaPaths_{false};
+  const bool enableOrderedFib_{false};
+  const bool bgpDryRun_{false};
+  const bool bgpUseIgpMetric_{false};
+  const size_t numRouteBuildThreads_{1};
+
+  // time spent in each route computation phase, shared by all areas
+  PhaseProfiler phaseProfiler_{Constants::kPhaseProfilerWindowSize};
+  std::vector<PhaseProfiler::PhaseDuration> lastComputePhases_;
+
+  // solver of each area, ordered by area name
+  std::map<std::string /* area */, std::unique_ptr<SpfSolverImpl>> areas_;
+
+  // routes of each area, only maintained with multiple areas
+  std::unordered_map<std::string /* area */, AreaRoutes> areaRoutes_;
+
+  // areas with state changes since their routes were last built
+  std::unordered_set<std::string> dirtyAreas_;
+
+  // runs per area computations concurrently, created with the second area
+  std::unique_ptr<folly::CPUThreadPoolExecutor> areaExecutor_;
 };
 
 //
@@ -210,15 +423,32 @@ class Decision : public OpenrEventBase {
       std::chrono::milliseconds debounceMinDur,
       std::chrono::milliseconds debounceMaxDur,
       folly::Optional<std::chrono::seconds> gracefulRestartDuration,
-      messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
-      messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue,
+      messaging::RQueue<KvStorePublicationPtr> kvStoreUpdatesQueue,
+      messaging::ReplicateQueue<RouteUpdate>& routeUpdatesQueue,
       const MonitorSubmitUrl& monitorSubmitUrl,
-      fbzmq::Context& zmqContext);
-
-  virtual ~Decision() = default;
+      fbzmq::Context& zmqContext,
+      size_t numRouteBuildThreads = 1,
+      bool enableAsyncCompute = false,
+      size_t routeTraceBufferSize = 0,
+      double debounceDutyCycle = 0,
+      // limits on the prefixes routes are computed for, per area
+      PrefixLimits prefixLimits = {},
+      // file to snapshot the link and prefix state to, periodically and on
+      // destruction, and to restore it from on start. None if empty
+      std::string snapshotFilePath = "",
+      std::chrono::seconds snapshotInterval =
+          Constants::kDecisionSnapshotInterval,
+      // registry of the debounce bounds tunable at runtime. Fixed if null
+      RuntimeKnobs* runtimeKnobs = nullptr);
+
+  // Destructor will try to snapshot the link and prefix state to disk
+  virtual ~Decision();
 
   std::unordered_map<std::string, int64_t> getCounters();
 
+  // shed caches of the SpfSolver(s)
+  void onMemoryPressure() override;
+
   /*
    * Retrieve routeDb from specified node.
    * If empty nodename specified, will return routeDb of its own
@@ -226,6 +456,15 @@ class Decision : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getDecisionRouteDb(
       std::string nodeName);
 
+  /*
+   * Versioned snapshots of the routes of this node published to Fib.
+   * Readable from any thread
+   */
+  const RouteDbSnapshots&
+  getRouteDbSnapshots() const {
+    return routeDbSnapshots_;
+  }
+
   /*
    * Retrieve AdjacencyDatabase as map.
    */
@@ -236,6 +475,33 @@ class Decision : public OpenrEventBase {
    */
   folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>> getDecisionPrefixDbs();
 
+  /*
+   * Compute routes of this node as if the mutations of request were applied
+   * to the current link state and return their delta against the routes of
+   * the current link state. Computation happens on a dedicated executor and
+   * never touches the solvers used for programming routes. Queries against
+   * the same link state reuse its snapshot and baseline routes.
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDelta>>
+  getDecisionRouteDbWhatIf(thrift::WhatIfRequest request);
+
+  /*
+   * Compute routes of each of nodeNames, of all nodes if empty, on a snapshot
+   * of the current link state and hand them to onRouteDb one at a time, in
+   * order, as they are computed. Unknown nodes get an empty route database.
+   * Computation happens on the what-if executor and shares SPF results across
+   * nodes. The returned future completes once all routes are handed over.
+   */
+  folly::SemiFuture<folly::Unit> getDecisionRouteDbs(
+      std::vector<std::string> nodeNames,
+      folly::Function<void(thrift::RouteDatabase&&)> onRouteDb);
+
+  /*
+   * Retrieve trace of route changes published to Fib.
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+  getDecisionRouteTrace();
+
  private:
   Decision(Decision const&) = delete;
   Decision& operator=(Decision const&) = delete;
@@ -269,6 +535,14 @@ class Decision : public OpenrEventBase {
   std::unique_ptr<fbzmq::ZmqTimeout> processUpdatesTimer_;
   ExponentialBackoff<std::chrono::milliseconds> processUpdatesBackoff_;
 
+  // debounce window picked from the measured cost of route computations and
+  // the rate of updates instead of processUpdatesBackoff_, if enabled
+  std::unique_ptr<AdaptiveDebounce> adaptiveDebounce_;
+
+  // bounds of processUpdatesBackoff_, tunable at runtime
+  RuntimeKnobs::Knob debounceMinMs_;
+  RuntimeKnobs::Knob debounceMaxMs_;
+
   // store update to-do status
   ProcessPublicationResult processUpdatesStatus_;
 
@@ -280,6 +554,9 @@ class Decision : public OpenrEventBase {
    */
   void processPendingUpdates();
 
+  // rebuild processUpdatesBackoff_ if its bounds were tuned
+  void updateDebounce();
+
   /**
    * Function to process pending adjacency publications.
    */
@@ -294,9 +571,61 @@ class Decision : public OpenrEventBase {
 
   void coldStartUpdate();
 
+  // write the adjacency and prefix databases of all areas to
+  // snapshotFilePath_. Returns true on success. Doesn't throw exception.
+  bool saveSnapshot() noexcept;
+
+  // restore the adjacency and prefix databases of snapshotFilePath_ and
+  // compute provisional routes from them right away. Only done within the
+  // graceful restart window, live databases received until it ends replace
+  // the restored ones. Doesn't throw exception.
+  void loadSnapshot() noexcept;
+
+  // remove the restored databases of nodes not advertised live since, once
+  // the graceful restart window ends
+  void reconcileSnapshot();
+
   void sendRouteUpdate(
       thrift::RouteDatabase& db, std::string const& eventDescription);
 
+  // apply partial route update on top of the published routes and publish
+  // what changed
+  void sendRouteDelta(
+      thrift::RouteDatabaseDelta& routeDelta,
+      std::string const& eventDescription);
+
+  // record, snapshot and send route changes to Fib
+  void publishRouteUpdate(RouteUpdate&& routeUpdate);
+
+  /**
+   * Asynchronous route computation. SpfSolver updates applied on the event
+   * loop are queued up and replayed, in order, on computeSolver_ which is
+   * only ever touched from computeExecutor_. Each request hands the updates
+   * queued so far to the executor, hence computeSolver_ always computes on a
+   * consistent snapshot of the link and prefix state, while the event loop
+   * keeps processing publications.
+   */
+  void queueComputeUpdate(folly::Function<void(SpfSolver&)> update);
+
+  // counters of the SpfSolver(s) along with async compute counters
+  std::unordered_map<std::string, int64_t> getSolverCounters();
+
+  void requestCompute(detail::DecisionComputeRequest request);
+
+  // runs on computeExecutor_
+  void runCompute(
+      uint64_t generation,
+      std::vector<folly::Function<void(SpfSolver&)>> updates,
+      detail::DecisionComputeRequest request);
+
+  // runs on the event loop once a computation started at generation is done,
+  // publishes its result
+  void applyComputeResult(
+      uint64_t generation,
+      detail::DecisionComputeRequest request,
+      folly::Optional<thrift::RouteDatabase> maybeRouteDb,
+      folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDbDelta);
+
   std::chrono::milliseconds getMaxFib();
 
   // periodically submit counters to monitor thread
@@ -304,7 +633,39 @@ class Decision : public OpenrEventBase {
 
   // node to prefix entries database for nodes advertising per prefix keys
   thrift::PrefixDatabase updateNodePrefixDatabase(
-      const std::string& key, const thrift::PrefixDatabase& prefixDb);
+      const std::string& key,
+      const thrift::PrefixDatabase& prefixDb,
+      const std::string& area);
+
+  // apply the prefix limits of area to the prefix database of a node.
+  // Returns the prefix databases to update the solvers with, of the node and
+  // of the nodes whose prefixes the limits accept changed with it
+  std::vector<thrift::PrefixDatabase> applyPrefixLimits(
+      thrift::PrefixDatabase nodePrefixDb, const std::string& area);
+
+  // update the solvers with a prefix database, true if it changed
+  bool updatePrefixDatabase(
+      const thrift::PrefixDatabase& prefixDb,
+      std::unordered_set<thrift::IpPrefix>& changedPrefixes,
+      const std::string& area);
+
+  // version, originator and fingerprint of the last adj/prefix value applied
+  // per area and key. Values matching all of them are skipped without
+  // decoding. The fingerprint is a 128 bit hash of the serialized value, the
+  // hash of publications is optional and not verified against the value
+  struct AppliedValue {
+    int64_t version{0};
+    std::string originatorId;
+    std::pair<uint64_t, uint64_t> fingerprint{0, 0};
+  };
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<std::string /* key */, AppliedValue>>
+      appliedValues_;
+  int64_t numSkippedAdjDbDecodes_{0};
+  int64_t numSkippedPrefixDbDecodes_{0};
+  // publications merged into others queued along with them
+  int64_t numMergedPublications_{0};
 
   // this node's name and the key markers
   const std::string myNodeName_;
@@ -313,14 +674,109 @@ class Decision : public OpenrEventBase {
   // the prefix we use to find the prefix db key announcements
   const std::string prefixDbMarker_;
 
-  thrift::RouteDatabase routeDb_;
+  // Routes published to Fib are held by routeDbSnapshots_ only, shared with
+  // the route updates and Fib. Deltas are found by the fingerprints of the
+  // routes, of unicast routes by their destination
+  std::unordered_map<thrift::IpPrefix, uint64_t> unicastRouteFingerprints_;
+
+  // fingerprint of mpls routes by their top label
+  std::unordered_map<int32_t, uint64_t> mplsRouteFingerprints_;
+
+  // sum of mixed fingerprints of all published routes, independent of
+  // their order. Computations yielding the same one are not diffed
+  uint64_t routeDbFingerprint_{0};
+  int64_t numUnchangedRouteDbs_{0};
+
+  // snapshots of the published routes for readers on other threads
+  RouteDbSnapshots routeDbSnapshots_;
+
+  // trace of route changes published to Fib, empty if disabled
+  RouteTrace routeTrace_;
 
   // Queue to publish route changes
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue_;
+  messaging::ReplicateQueue<RouteUpdate>& routeUpdatesQueue_;
 
   // the pointer to the SPF path calculator
   std::unique_ptr<SpfSolver> spfSolver_;
 
+  // Asynchronous compute mode, only set if enabled. computeSolver_ mirrors
+  // spfSolver_ and is only accessed from computeExecutor_
+  std::unique_ptr<SpfSolver> computeSolver_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> computeExecutor_;
+
+  // solver updates not yet handed over to computeExecutor_
+  std::vector<folly::Function<void(SpfSolver&)>> pendingComputeUpdates_;
+
+  // requests not yet covered by a published computation, by generation
+  std::map<uint64_t, detail::DecisionComputeRequest> outstandingRequests_;
+
+  // generation of the latest request. Computations of older generations are
+  // out of date and are abandoned as soon as they notice it, unless too many
+  // were abandoned since lastPublishedComputeGeneration_. The latter is only
+  // accessed from computeExecutor_
+  std::atomic<uint64_t> computeGeneration_{0};
+  uint64_t lastPublishedComputeGeneration_{0};
+  std::atomic<int64_t> numComputeRuns_{0};
+  std::atomic<int64_t> numComputeCancelled_{0};
+
+  // counters of computeSolver_ as of its last computation
+  folly::Synchronized<std::unordered_map<std::string, int64_t>>
+      computeCounters_;
+
+  // What-if and bulk route computations. lsdbVersion_ is bumped with every
+  // change of spfSolver_ state. whatIfSnapshot_ is taken on first use and
+  // from then on kept up to date with every database applied to spfSolver_,
+  // copying its maps only if still shared with a computation. whatIfSolver_
+  // holds the snapshot of whatIfSolverVersion_ and is only accessed from
+  // whatIfExecutor_, which is created on first use
+  const bool enableV4_{false};
+  const bool computeLfaPaths_{false};
+  const bool bgpDryRun_{false};
+  const bool bgpUseIgpMetric_{false};
+  uint64_t lsdbVersion_{0};
+  std::shared_ptr<detail::DecisionLsdbSnapshot> whatIfSnapshot_;
+  std::unique_ptr<SpfSolver> whatIfSolver_;
+  uint64_t whatIfSolverVersion_{0};
+  thrift::RouteDatabase whatIfBaseRouteDb_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> whatIfExecutor_;
+
+  // snapshot of the current link state, creates whatIfExecutor_ if needed
+  std::shared_ptr<const detail::DecisionLsdbSnapshot> getWhatIfSnapshot();
+
+  // whatIfSnapshot_ to apply a database update to, nullptr if none taken yet
+  detail::DecisionLsdbSnapshot* getMutableWhatIfSnapshot();
+
+  // run on whatIfExecutor_
+  void updateWhatIfSolver(detail::DecisionLsdbSnapshot const& snapshot);
+  thrift::RouteDatabaseDelta computeWhatIf(
+      detail::DecisionLsdbSnapshot const& snapshot,
+      thrift::WhatIfRequest const& request);
+  void computeRouteDbs(
+      detail::DecisionLsdbSnapshot const& snapshot,
+      std::vector<std::string> nodeNames,
+      folly::FunctionRef<void(thrift::RouteDatabase&&)> onRouteDb);
+
+  // Location on disk of the Decision snapshot, none taken if empty
+  const std::string snapshotFilePath_;
+
+  // Timer for snapshotting the link and prefix state periodically
+  std::unique_ptr<fbzmq::ZmqTimeout> snapshotTimer_;
+
+  // nodes of the restored adjacency/prefix databases per area, until they
+  // are advertised live
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_set<std::string /* node */>>
+      snapshotAdjNodes_;
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_set<std::string /* node */>>
+      snapshotPrefixNodes_;
+  int64_t numSnapshotFailures_{0};
+  int64_t numSnapshotRestoredNodes_{0};
+  int64_t numSnapshotStaleDbs_{0};
+  int64_t lastSnapshotTimeMs_{0};
+
   // For orderedFib prgramming, we keep track of the fib programming times
   // across the network
   std::unordered_map<std::string, std::chrono::milliseconds> fibTimes_;
@@ -341,10 +797,28 @@ class Decision : public OpenrEventBase {
 
   // need to store all this for backward compatibility, otherwise a key update
   // can lead to mistakenly withdrawing some prefixes
+  // keyed by area and then node name
+  std::unordered_map<
+      std::string,
+      std::unordered_map<
+          std::string,
+          std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>>
+      perPrefixPrefixEntries_;
+
+  // a node may split its prefix database across multiple keys, these are
+  // keyed by area, node name and then key
   std::unordered_map<
       std::string,
-      std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
-      perPrefixPrefixEntries_, fullDbPrefixEntries_;
+      std::unordered_map<
+          std::string,
+          std::unordered_map<
+              std::string,
+              std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>>>
+      fullDbPrefixEntries_;
+
+  // prefix limits and their state per area, if enabled
+  const PrefixLimits prefixLimits_;
+  std::unordered_map<std::string /* area */, PrefixLimiter> prefixLimiters_;
 };
 
 } // namespace openr
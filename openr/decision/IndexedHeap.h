@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+//
+// Indexed d-ary min-heap over dense integer ids in [0, capacity).
+//
+// Each id can be present at most once. A position table maps id to its slot
+// in the heap so that decrease-key is O(log_d(n)) without any lookups by
+// value. Ties on priority are broken by the smaller id which keeps extraction
+// order deterministic.
+//
+// All storage is retained across reset() calls, hence a heap that is kept
+// alive and reused for runs over graphs of similar size does not allocate.
+//
+template <typename Priority, size_t D = 4>
+class IndexedHeap {
+ public:
+  using Index = uint32_t;
+
+  static_assert(D >= 2, "IndexedHeap arity must be at least 2");
+
+  // Clear the heap and make room for ids in [0, capacity)
+  void
+  reset(size_t capacity) {
+    for (auto id : heap_) {
+      pos_[id] = kNotInHeap;
+    }
+    heap_.clear();
+    if (pos_.size() < capacity) {
+      pos_.resize(capacity, kNotInHeap);
+      priorities_.resize(capacity);
+    }
+  }
+
+  bool
+  empty() const {
+    return heap_.empty();
+  }
+
+  size_t
+  size() const {
+    return heap_.size();
+  }
+
+  bool
+  contains(Index id) const {
+    return id < pos_.size() && pos_[id] != kNotInHeap;
+  }
+
+  // Insert id with given priority, or decrease its priority if it is already
+  // present. Increasing the priority of an existing id is not supported.
+  void
+  push(Index id, Priority priority) {
+    DCHECK_LT(id, pos_.size());
+    if (pos_[id] == kNotInHeap) {
+      pos_[id] = static_cast<uint32_t>(heap_.size());
+      heap_.push_back(id);
+    } else {
+      DCHECK(not(priorities_[id] < priority));
+    }
+    priorities_[id] = std::move(priority);
+    siftUp(pos_[id]);
+  }
+
+  const Priority&
+  priority(Index id) const {
+    DCHECK(contains(id));
+    return priorities_[id];
+  }
+
+  const Index&
+  top() const {
+    DCHECK(not empty());
+    return heap_.front();
+  }
+
+  // Remove and return id with minimum priority
+  Index
+  pop() {
+    DCHECK(not empty());
+    const Index minId = heap_.front();
+    const Index lastId = heap_.back();
+    heap_.pop_back();
+    pos_[minId] = kNotInHeap;
+    if (not heap_.empty()) {
+      heap_[0] = lastId;
+      pos_[lastId] = 0;
+      siftDown(0);
+    }
+    return minId;
+  }
+
+ private:
+  static constexpr uint32_t kNotInHeap = std::numeric_limits<uint32_t>::max();
+
+  bool
+  less(Index a, Index b) const {
+    if (priorities_[a] < priorities_[b]) {
+      return true;
+    }
+    if (priorities_[b] < priorities_[a]) {
+      return false;
+    }
+    return a < b;
+  }
+
+  void
+  siftUp(uint32_t slot) {
+    const Index id = heap_[slot];
+    while (slot > 0) {
+      const uint32_t parent = (slot - 1) / D;
+      if (not less(id, heap_[parent])) {
+        break;
+      }
+      heap_[slot] = heap_[parent];
+      pos_[heap_[slot]] = slot;
+      slot = parent;
+    }
+    heap_[slot] = id;
+    pos_[id] = slot;
+  }
+
+  void
+  siftDown(uint32_t slot) {
+    const Index id = heap_[slot];
+    const uint32_t n = static_cast<uint32_t>(heap_.size());
+    while (true) {
+      const uint64_t firstChild = static_cast<uint64_t>(slot) * D + 1;
+      if (firstChild >= n) {
+        break;
+      }
+      uint32_t best = static_cast<uint32_t>(firstChild);
+      const uint32_t lastChild =
+          static_cast<uint32_t>(std::min<uint64_t>(firstChild + D, n));
+      for (uint32_t child = best + 1; child < lastChild; ++child) {
+        if (less(heap_[child], heap_[best])) {
+          best = child;
+        }
+      }
+      if (not less(heap_[best], id)) {
+        break;
+      }
+      heap_[slot] = heap_[best];
+      pos_[heap_[slot]] = slot;
+      slot = best;
+    }
+    heap_[slot] = id;
+    pos_[id] = slot;
+  }
+
+  // heap ordered ids
+  std::vector<Index> heap_;
+
+  // position of each id in heap_ or kNotInHeap
+  std::vector<uint32_t> pos_;
+
+  // priority of each id, valid only while the id is in the heap
+  std::vector<Priority> priorities_;
+};
+
+} // namespace openr
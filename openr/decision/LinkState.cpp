@@ -38,11 +38,16 @@ HoldableValue<T>::hasHold() const {
 
 template <class T>
 bool
-HoldableValue<T>::decrementTtl() {
-  if (heldVal_ && 0 == --holdTtl_) {
+HoldableValue<T>::decrementTtl(LinkStateMetric ticks) {
+  if (not heldVal_) {
+    return false;
+  }
+  if (ticks >= holdTtl_) {
     heldVal_.reset();
+    holdTtl_ = 0;
     return true;
   }
+  holdTtl_ -= ticks;
   return false;
 }
 
@@ -86,6 +91,22 @@ HoldableValue<LinkStateMetric>::isChangeBringingUp(LinkStateMetric val) {
 template class HoldableValue<LinkStateMetric>;
 template class HoldableValue<bool>;
 
+namespace {
+
+// hash of the node and interface names, independent of interning order
+size_t
+hashOrderedNames(const std::pair<
+                 std::pair<InternedString, InternedString>,
+                 std::pair<InternedString, InternedString>>& names) {
+  return std::hash<std::pair<
+      std::pair<std::string, std::string>,
+      std::pair<std::string, std::string>>>()(std::make_pair(
+      std::make_pair(names.first.first.str(), names.first.second.str()),
+      std::make_pair(names.second.first.str(), names.second.second.str())));
+}
+
+} // anonymous namespace
+
 Link::Link(
     const std::string& nodeName1,
     const openr::thrift::Adjacency& adj1,
@@ -107,38 +128,36 @@ Link::Link(
       nhV62_(adj2.nextHopV6),
       orderedNames(
           std::minmax(std::make_pair(n1_, if1_), std::make_pair(n2_, if2_))),
-      hash(std::hash<std::pair<
-               std::pair<std::string, std::string>,
-               std::pair<std::string, std::string>>>()(orderedNames)) {}
+      hash(hashOrderedNames(orderedNames)) {}
 
 const std::string&
 Link::getOtherNodeName(const std::string& nodeName) const {
   if (n1_ == nodeName) {
-    return n2_;
+    return n2_.str();
   }
   if (n2_ == nodeName) {
-    return n1_;
+    return n1_.str();
   }
   throw std::invalid_argument(nodeName);
 }
 
 const std::string&
 Link::firstNodeName() const {
-  return orderedNames.first.first;
+  return orderedNames.first.first.str();
 }
 
 const std::string&
 Link::secondNodeName() const {
-  return orderedNames.second.first;
+  return orderedNames.second.first.str();
 }
 
 const std::string&
 Link::getIfaceFromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
-    return if1_;
+    return if1_.str();
   }
   if (n2_ == nodeName) {
-    return if2_;
+    return if2_.str();
   }
   throw std::invalid_argument(nodeName);
 }
@@ -187,15 +206,16 @@ Link::isUp() const {
 }
 
 bool
-Link::decrementHolds() {
+Link::decrementHolds(LinkStateMetric ticks) {
   bool holdExpired = false;
   if (0 != holdUpTtl_) {
-    holdExpired |= (0 == --holdUpTtl_);
+    holdUpTtl_ = ticks >= holdUpTtl_ ? 0 : holdUpTtl_ - ticks;
+    holdExpired |= (0 == holdUpTtl_);
   }
-  holdExpired |= metric1_.decrementTtl();
-  holdExpired |= metric2_.decrementTtl();
-  holdExpired |= overload1_.decrementTtl();
-  holdExpired |= overload2_.decrementTtl();
+  holdExpired |= metric1_.decrementTtl(ticks);
+  holdExpired |= metric2_.decrementTtl(ticks);
+  holdExpired |= overload1_.decrementTtl(ticks);
+  holdExpired |= overload2_.decrementTtl(ticks);
   return holdExpired;
 }
 
@@ -205,6 +225,22 @@ Link::hasHolds() const {
       overload1_.hasHold() || overload2_.hasHold();
 }
 
+LinkStateMetric
+Link::getHoldTtl() const {
+  LinkStateMetric ttl = 0;
+  for (auto holdTtl :
+       {holdUpTtl_,
+        metric1_.getHoldTtl(),
+        metric2_.getHoldTtl(),
+        overload1_.getHoldTtl(),
+        overload2_.getHoldTtl()}) {
+    if (holdTtl != 0 and (ttl == 0 or holdTtl < ttl)) {
+      ttl = holdTtl;
+    }
+  }
+  return ttl;
+}
+
 const thrift::BinaryAddress&
 Link::getNhV4FromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
@@ -313,7 +349,8 @@ Link::operator==(const Link& other) const {
 
 std::string
 Link::toString() const {
-  return folly::sformat("{}%{} <---> {}%{}", n1_, if1_, n2_, if2_);
+  return folly::sformat(
+      "{}%{} <---> {}%{}", n1_.str(), if1_.str(), n2_.str(), if2_.str());
 }
 
 std::string
@@ -326,36 +363,178 @@ Link::directionalToString(const std::string& fromNode) const {
       getIfaceFromNode(getOtherNodeName(fromNode)));
 }
 
-bool
-LinkState::LinkPtrHash::operator()(const std::shared_ptr<Link>& l) const {
+size_t
+LinkState::LinkPtrHash::operator()(const Link* l) const {
   return l->hash;
 }
 
 bool
-LinkState::LinkPtrLess::operator()(
-    const std::shared_ptr<Link>& lhs, const std::shared_ptr<Link>& rhs) const {
+LinkState::LinkPtrLess::operator()(const Link* lhs, const Link* rhs) const {
   return *lhs < *rhs;
 }
 
 bool
-LinkState::LinkPtrEqual::operator()(
-    const std::shared_ptr<Link>& lhs, const std::shared_ptr<Link>& rhs) const {
+LinkState::LinkPtrEqual::operator()(const Link* lhs, const Link* rhs) const {
   return *lhs == *rhs;
 }
 
+namespace {
+
+void
+insertOrdered(LinkState::LinkList& links, Link* link) {
+  auto it = std::lower_bound(
+      links.begin(), links.end(), link, LinkState::LinkPtrLess{});
+  CHECK(it == links.end() or LinkState::LinkPtrLess{}(link, *it));
+  links.insert(it, link);
+}
+
+// throws std::out_of_range if link is not in links
+void
+eraseOrdered(LinkState::LinkList& links, const Link* link) {
+  auto it = std::lower_bound(
+      links.begin(), links.end(), link, LinkState::LinkPtrLess{});
+  if (it == links.end() or not(**it == *link)) {
+    throw std::out_of_range(link->toString());
+  }
+  links.erase(it);
+}
+
+// true if adj1 and adj2 make up the same link, i.e. differ at most in fields
+// links don't keep such as rtt
+bool
+sameLinkAttributes(
+    const thrift::Adjacency& adj1, const thrift::Adjacency& adj2) {
+  return adj1.otherNodeName == adj2.otherNodeName and
+      adj1.ifName == adj2.ifName and adj1.otherIfName == adj2.otherIfName and
+      adj1.metric == adj2.metric and adj1.isOverloaded == adj2.isOverloaded and
+      adj1.adjLabel == adj2.adjLabel and adj1.nextHopV4 == adj2.nextHopV4 and
+      adj1.nextHopV6 == adj2.nextHopV6;
+}
+
+// true if adjDb1 and adjDb2 make up the same links and node attributes, e.g.
+// re-advertisements carrying new perf events only
+bool
+sameLinkAttributes(
+    const thrift::AdjacencyDatabase& adjDb1,
+    const thrift::AdjacencyDatabase& adjDb2) {
+  if (adjDb1.isOverloaded != adjDb2.isOverloaded or
+      adjDb1.nodeLabel != adjDb2.nodeLabel or
+      adjDb1.adjacencies.size() != adjDb2.adjacencies.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < adjDb1.adjacencies.size(); ++i) {
+    if (not sameLinkAttributes(
+            adjDb1.adjacencies[i], adjDb2.adjacencies[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+Link&
+LinkState::addLink(const Link& link) {
+  getOrCreateNodeId(link.firstNodeName());
+  getOrCreateNodeId(link.secondNodeName());
+  invalidateGraph();
+  CHECK(not linkSlots_.count(&link));
+
+  uint32_t slot;
+  if (freeLinkSlots_.empty()) {
+    slot = static_cast<uint32_t>(linkArena_.size());
+    linkArena_.emplace_back();
+  } else {
+    slot = freeLinkSlots_.back();
+    freeLinkSlots_.pop_back();
+  }
+  linkArena_[slot].emplace(link);
+  auto& storedLink = linkArena_[slot].value();
+  linkSlots_.emplace(&storedLink, slot);
+  insertOrdered(linkMap_[storedLink.firstNodeName()], &storedLink);
+  insertOrdered(linkMap_[storedLink.secondNodeName()], &storedLink);
+  return storedLink;
+}
+
+void
+LinkState::freeLink(const Link* link) {
+  auto search = linkSlots_.find(link);
+  CHECK(search != linkSlots_.end());
+  const auto slot = search->second;
+  linkSlots_.erase(search);
+  // link may refer to the arena slot itself, don't touch it past this point
+  linkArena_[slot].reset();
+  freeLinkSlots_.emplace_back(slot);
+  // index entries of the slot are stale from now on
+  linkHolds_.erase(slot);
+}
+
+bool
+LinkState::syncLinkHolds(uint32_t slot) {
+  auto search = linkHolds_.find(slot);
+  if (search == linkHolds_.end()) {
+    return false;
+  }
+  const auto ticks = holdTick_ - search->second.synced;
+  search->second.synced = holdTick_;
+  return linkArena_.at(slot)->decrementHolds(ticks);
+}
+
+bool
+LinkState::syncNodeHolds(const std::string& nodeName) {
+  auto search = nodeHolds_.find(nodeName);
+  if (search == nodeHolds_.end()) {
+    return false;
+  }
+  const auto ticks = holdTick_ - search->second.synced;
+  search->second.synced = holdTick_;
+  return nodeOverloads_.at(nodeName).decrementTtl(ticks);
+}
+
+void
+LinkState::scheduleLinkHolds(uint32_t slot) {
+  const auto ttl = linkArena_.at(slot)->getHoldTtl();
+  if (ttl == 0) {
+    linkHolds_.erase(slot);
+    return;
+  }
+  auto& holdTicks = linkHolds_[slot];
+  holdTicks.synced = holdTick_;
+  if (holdTicks.expiry != holdTick_ + ttl) {
+    holdTicks.expiry = holdTick_ + ttl;
+    linkHoldExpiries_[holdTicks.expiry].emplace_back(slot);
+  }
+}
+
 void
-LinkState::addLink(std::shared_ptr<Link> link) {
-  CHECK(linkMap_[link->firstNodeName()].insert(link).second);
-  CHECK(linkMap_[link->secondNodeName()].insert(link).second);
-  CHECK(allLinks_.insert(link).second);
+LinkState::scheduleNodeHolds(const std::string& nodeName) {
+  auto search = nodeOverloads_.find(nodeName);
+  const auto ttl =
+      search == nodeOverloads_.end() ? 0 : search->second.getHoldTtl();
+  if (ttl == 0) {
+    nodeHolds_.erase(nodeName);
+    return;
+  }
+  auto& holdTicks = nodeHolds_[nodeName];
+  holdTicks.synced = holdTick_;
+  if (holdTicks.expiry != holdTick_ + ttl) {
+    holdTicks.expiry = holdTick_ + ttl;
+    nodeHoldExpiries_[holdTicks.expiry].emplace_back(nodeName);
+  }
 }
 
 // throws std::out_of_range if links are not present
 void
-LinkState::removeLink(std::shared_ptr<Link> link) {
-  CHECK(linkMap_.at(link->firstNodeName()).erase(link));
-  CHECK(linkMap_.at(link->secondNodeName()).erase(link));
-  CHECK(allLinks_.erase(link));
+LinkState::removeLink(const Link& link) {
+  auto search = linkSlots_.find(&link);
+  if (search == linkSlots_.end()) {
+    throw std::out_of_range(link.toString());
+  }
+  const Link* storedLink = search->first;
+  invalidateGraph();
+  eraseOrdered(linkMap_.at(storedLink->firstNodeName()), storedLink);
+  eraseOrdered(linkMap_.at(storedLink->secondNodeName()), storedLink);
+  freeLink(storedLink);
 }
 
 void
@@ -365,41 +544,30 @@ LinkState::removeNode(const std::string& nodeName) {
     // No links were added (addition of empty adjacency db can cause this)
     return;
   }
+  invalidateGraph();
 
   // erase ptrs to these links from other nodes
-  for (auto const& link : search->second) {
+  for (auto const* link : search->second) {
     try {
-      CHECK(linkMap_.at(link->getOtherNodeName(nodeName)).erase(link));
-      CHECK(allLinks_.erase(link));
+      eraseOrdered(linkMap_.at(link->getOtherNodeName(nodeName)), link);
     } catch (std::out_of_range const& e) {
       LOG(FATAL) << "std::out_of_range for " << nodeName;
     }
+    freeLink(link);
   }
   linkMap_.erase(search);
   nodeOverloads_.erase(nodeName);
+  nodeHolds_.erase(nodeName);
 }
 
-const LinkState::LinkSet&
+const LinkState::LinkList&
 LinkState::linksFromNode(const std::string& nodeName) const {
-  static const LinkState::LinkSet defaultEmptySet;
+  static const LinkState::LinkList defaultEmptyList;
   auto search = linkMap_.find(nodeName);
   if (search != linkMap_.end()) {
     return search->second;
   }
-  return defaultEmptySet;
-}
-
-std::vector<std::shared_ptr<Link>>
-LinkState::orderedLinksFromNode(const std::string& nodeName) {
-  std::vector<std::shared_ptr<Link>> links;
-  if (linkMap_.count(nodeName)) {
-    links.insert(
-        links.begin(),
-        linkMap_.at(nodeName).begin(),
-        linkMap_.at(nodeName).end());
-    std::sort(links.begin(), links.end(), LinkPtrLess{});
-  }
-  return links;
+  return defaultEmptyList;
 }
 
 bool
@@ -408,9 +576,13 @@ LinkState::updateNodeOverloaded(
     bool isOverloaded,
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
+  invalidateGraph();
   if (nodeOverloads_.count(nodeName)) {
-    return nodeOverloads_.at(nodeName).updateValue(
+    syncNodeHolds(nodeName);
+    const bool changed = nodeOverloads_.at(nodeName).updateValue(
         isOverloaded, holdUpTtl, holdDownTtl);
+    scheduleNodeHolds(nodeName);
+    return changed;
   }
   nodeOverloads_.emplace(nodeName, HoldableValue<bool>{isOverloaded});
   // don't indicate LinkState changed if this is a new node
@@ -424,32 +596,43 @@ LinkState::isNodeOverloaded(const std::string& nodeName) const {
 
 bool
 LinkState::decrementHolds() {
+  ++holdTick_;
   bool holdChange = false;
-  for (auto& link : allLinks_) {
-    holdChange |= link->decrementHolds();
-  }
-  for (auto& kv : nodeOverloads_) {
-    holdChange |= kv.second.decrementTtl();
-  }
-  return holdChange;
-}
-
-bool
-LinkState::hasHolds() const {
-  for (auto& link : allLinks_) {
-    if (link->hasHolds()) {
-      return true;
+  // entries are stale if the link or node was rescheduled or lost its holds
+  // since they were added
+  auto linkIt = linkHoldExpiries_.begin();
+  while (linkIt != linkHoldExpiries_.end() and linkIt->first <= holdTick_) {
+    for (auto slot : linkIt->second) {
+      auto search = linkHolds_.find(slot);
+      if (search == linkHolds_.end() or
+          search->second.expiry != linkIt->first) {
+        continue;
+      }
+      holdChange |= syncLinkHolds(slot);
+      scheduleLinkHolds(slot);
     }
-  }
-  for (auto& kv : nodeOverloads_) {
-    if (kv.second.hasHold()) {
-      return true;
+    linkIt = linkHoldExpiries_.erase(linkIt);
+  }
+  auto nodeIt = nodeHoldExpiries_.begin();
+  while (nodeIt != nodeHoldExpiries_.end() and nodeIt->first <= holdTick_) {
+    for (auto const& nodeName : nodeIt->second) {
+      auto search = nodeHolds_.find(nodeName);
+      if (search == nodeHolds_.end() or
+          search->second.expiry != nodeIt->first) {
+        continue;
+      }
+      holdChange |= syncNodeHolds(nodeName);
+      scheduleNodeHolds(nodeName);
     }
+    nodeIt = nodeHoldExpiries_.erase(nodeIt);
   }
-  return false;
+  if (holdChange) {
+    invalidateGraph();
+  }
+  return holdChange;
 }
 
-std::shared_ptr<Link>
+folly::Optional<Link>
 LinkState::maybeMakeLink(
     const std::string& nodeName, const thrift::Adjacency& adj) const {
   // only return Link if it is bidirectional.
@@ -459,25 +642,30 @@ LinkState::maybeMakeLink(
       if (nodeName == otherAdj.otherNodeName &&
           adj.otherIfName == otherAdj.ifName &&
           adj.ifName == otherAdj.otherIfName) {
-        return std::make_shared<Link>(
-            nodeName, adj, adj.otherNodeName, otherAdj);
+        return Link(nodeName, adj, adj.otherNodeName, otherAdj);
       }
     }
   }
-  return nullptr;
+  return folly::none;
 }
 
-std::vector<std::shared_ptr<Link>>
-LinkState::getOrderedLinkSet(const thrift::AdjacencyDatabase& adjDb) const {
-  std::vector<std::shared_ptr<Link>> links;
-  links.reserve(adjDb.adjacencies.size());
+std::vector<const Link*>
+LinkState::getOrderedLinkSet(
+    const thrift::AdjacencyDatabase& adjDb, std::vector<Link>& storage) const {
+  storage.clear();
+  storage.reserve(adjDb.adjacencies.size());
   for (const auto& adj : adjDb.adjacencies) {
-    auto linkPtr = maybeMakeLink(adjDb.thisNodeName, adj);
-    if (nullptr != linkPtr) {
-      links.emplace_back(linkPtr);
+    auto link = maybeMakeLink(adjDb.thisNodeName, adj);
+    if (link.hasValue()) {
+      storage.emplace_back(std::move(link).value());
     }
   }
-  links.shrink_to_fit();
+  // Link is not assignable, sort pointers instead
+  std::vector<const Link*> links;
+  links.reserve(storage.size());
+  for (auto const& link : storage) {
+    links.emplace_back(&link);
+  }
   std::sort(links.begin(), links.end(), LinkState::LinkPtrLess{});
   return links;
 }
@@ -486,10 +674,10 @@ std::pair<
     bool /* topology has changed*/,
     bool /* route attributes has changed (nexthop addr, node/adj label */>
 LinkState::updateAdjacencyDatabase(
-    thrift::AdjacencyDatabase const& newAdjacencyDb,
+    thrift::AdjacencyDatabase newAdjacencyDb,
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
-  auto const& nodeName = newAdjacencyDb.thisNodeName;
+  const auto nodeName = newAdjacencyDb.thisNodeName;
   VLOG(1) << "Updating adjacency database for node " << nodeName;
 
   for (auto const& adj : newAdjacencyDb.adjacencies) {
@@ -499,29 +687,50 @@ LinkState::updateAdjacencyDatabase(
             << ", overloaded: " << adj.isOverloaded << ", rtt: " << adj.rtt;
   }
 
+  // same links as before, keep the new database without diffing its links or
+  // invalidating the graph view and the results derived from it
+  auto search = adjacencyDatabases_.find(nodeName);
+  if (search != adjacencyDatabases_.end() and
+      sameLinkAttributes(search->second, newAdjacencyDb)) {
+    search->second = std::move(newAdjacencyDb);
+    ++numUnchangedAdjDbUpdates_;
+    return std::make_pair(false, false);
+  }
+
+  // metric, overload or hold changes below all affect the graph view
+  invalidateGraph();
+  getOrCreateNodeId(nodeName);
+
   // Default construct if it did not exist
   thrift::AdjacencyDatabase priorAdjacencyDb(
       std::move(adjacencyDatabases_[nodeName]));
   // replace
-  adjacencyDatabases_[nodeName] = newAdjacencyDb;
+  adjacencyDatabases_[nodeName] = std::move(newAdjacencyDb);
+  auto const& adjacencyDb = adjacencyDatabases_.at(nodeName);
 
   // for comparing old and new state, we order the links based on the tuple
   // <nodeName1, iface1, nodeName2, iface2>, this allows us to easily discern
   // topology changes in the single loop below
-  auto oldLinks = orderedLinksFromNode(nodeName);
-  auto newLinks = getOrderedLinkSet(newAdjacencyDb);
+  // NOTE explicit copy, links of the node get modified below
+  const LinkList oldLinks = orderedLinksFromNode(nodeName);
+  // holds set below count from now on
+  for (auto const* link : oldLinks) {
+    syncLinkHolds(linkSlots_.at(link));
+  }
+  std::vector<Link> newLinkStorage;
+  const auto newLinks = getOrderedLinkSet(adjacencyDb, newLinkStorage);
 
   // fill these sets with the appropriate links
   std::unordered_set<Link> linksUp;
   std::unordered_set<Link> linksDown;
 
   bool topoChanged = updateNodeOverloaded(
-      nodeName, newAdjacencyDb.isOverloaded, holdUpTtl, holdDownTtl);
+      nodeName, adjacencyDb.isOverloaded, holdUpTtl, holdDownTtl);
 
   bool routeAttrChanged = false;
 
   // If changed locally we will need to update POP route for local node
-  routeAttrChanged |= priorAdjacencyDb.nodeLabel != newAdjacencyDb.nodeLabel;
+  routeAttrChanged |= priorAdjacencyDb.nodeLabel != adjacencyDb.nodeLabel;
 
   auto newIter = newLinks.begin();
   auto oldIter = oldLinks.begin();
@@ -530,13 +739,13 @@ LinkState::updateAdjacencyDatabase(
         (oldIter == oldLinks.end() || **newIter < **oldIter)) {
       // newIter is pointing at a Link not currently present, record this as a
       // link to add and advance newIter
-      (*newIter)->setHoldUpTtl(holdUpTtl);
-      topoChanged |= (*newIter)->isUp();
       // even if we are holding a change, we apply the change to our link state
       // and check for holds when running spf. this ensures we don't add the
       // same hold twice
-      addLink(*newIter);
-      VLOG(1) << "addLink " << (*newIter)->toString();
+      auto& link = addLink(**newIter);
+      link.setHoldUpTtl(holdUpTtl);
+      topoChanged |= link.isUp();
+      VLOG(1) << "addLink " << link.toString();
       ++newIter;
       continue;
     }
@@ -547,15 +756,15 @@ LinkState::updateAdjacencyDatabase(
       // If this link was previously overloaded or had a hold up, this does not
       // change the topology.
       topoChanged |= (*oldIter)->isUp();
-      removeLink(*oldIter);
       VLOG(1) << "removeLink " << (*oldIter)->toString();
+      removeLink(**oldIter);
       ++oldIter;
       continue;
     }
     // The newIter and oldIter point to the same link. This link did not go up
     // or down. The topology may still have changed though if the link overlaod
     // or metric changed
-    auto& newLink = **newIter;
+    auto const& newLink = **newIter;
     auto& oldLink = **oldIter;
 
     // change the metric on the link object we already have
@@ -631,6 +840,9 @@ LinkState::updateAdjacencyDatabase(
     ++oldIter;
   }
 
+  for (auto const* link : linksFromNode(nodeName)) {
+    scheduleLinkHolds(linkSlots_.at(link));
+  }
   return std::make_pair(topoChanged, routeAttrChanged);
 }
 
@@ -649,4 +861,78 @@ LinkState::deleteAdjacencyDatabase(const std::string& nodeName) {
   return true;
 }
 
+LinkState::NodeId
+LinkState::getOrCreateNodeId(const std::string& nodeName) {
+  auto rc = nodeIds_.emplace(nodeName, static_cast<NodeId>(nodeNames_.size()));
+  if (rc.second) {
+    nodeNames_.emplace_back(nodeName);
+    invalidateGraph();
+  }
+  return rc.first->second;
+}
+
+folly::Optional<LinkState::NodeId>
+LinkState::getNodeId(const std::string& nodeName) const {
+  auto search = nodeIds_.find(nodeName);
+  if (search == nodeIds_.end()) {
+    return folly::none;
+  }
+  return search->second;
+}
+
+std::shared_ptr<const LinkState::Graph>
+LinkState::getGraphPtr() const {
+  if (not graphValid_ or not graph_) {
+    graph_ = rebuildGraph();
+    graphValid_ = true;
+  }
+  return graph_;
+}
+
+std::shared_ptr<const LinkState::Graph>
+LinkState::rebuildGraph() const {
+  const size_t numNodes = nodeNames_.size();
+  auto graphPtr = std::make_shared<Graph>();
+  auto& graph = *graphPtr;
+
+  graph.offsets.assign(numNodes + 1, 0);
+  graph.overloaded.assign(numNodes, false);
+
+  // count up edges per node, offsets[id + 1] temporarily holds the count
+  for (auto const& kv : linkMap_) {
+    const auto id = nodeIds_.at(kv.first);
+    graph.overloaded[id] = isNodeOverloaded(kv.first);
+    for (auto const* link : kv.second) {
+      if (link->isUp()) {
+        ++graph.offsets[id + 1];
+      }
+    }
+  }
+  for (size_t id = 0; id < numNodes; ++id) {
+    graph.offsets[id + 1] += graph.offsets[id];
+  }
+
+  const size_t numEdges = graph.offsets[numNodes];
+  graph.dsts.resize(numEdges);
+  graph.metrics.resize(numEdges);
+  graph.links.resize(numEdges);
+
+  // fill edges in the order of their ordered link set for determinism
+  for (auto const& kv : linkMap_) {
+    const auto id = nodeIds_.at(kv.first);
+    size_t pos = graph.offsets[id];
+    for (auto const* link : kv.second) {
+      if (not link->isUp()) {
+        continue;
+      }
+      graph.dsts[pos] = nodeIds_.at(link->getOtherNodeName(kv.first));
+      graph.metrics[pos] = link->getMetricFromNode(kv.first);
+      graph.links[pos] = link;
+      ++pos;
+    }
+    DCHECK_EQ(pos, graph.offsets[id + 1]);
+  }
+  return graphPtr;
+}
+
 } // namespace openr
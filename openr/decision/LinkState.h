@@ -7,12 +7,17 @@
 
 #pragma once
 
+#include <deque>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <folly/Optional.h>
+
+#include <openr/common/StringInterner.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 
@@ -30,7 +35,8 @@ using LinkStateMetric = uint64_t;
 // being clearted, thus changeing value().
 //
 // value() will return the held value until decrementTtl() returns true and the
-// held value is cleared.
+// held value is cleared. Ttls are counted in ticks of
+// LinkState::decrementHolds().
 
 template <class T>
 class HoldableValue {
@@ -41,8 +47,14 @@ class HoldableValue {
 
   bool hasHold() const;
 
+  // ticks until the hold expires, 0 if there is none
+  LinkStateMetric
+  getHoldTtl() const {
+    return heldVal_.hasValue() ? holdTtl_ : 0;
+  }
+
   // these methods return true if the call results in the value changing
-  bool decrementTtl();
+  bool decrementTtl(LinkStateMetric ticks = 1);
   bool updateValue(
       T val, LinkStateMetric holdUpTtl, LinkStateMetric holdDownTtl);
 
@@ -82,7 +94,9 @@ class Link {
       const openr::thrift::Adjacency& adj2);
 
  private:
-  const std::string n1_, n2_, if1_, if2_;
+  // node and interface names are interned, links of a node share the same
+  // copy of its name and comparing names of two links is a pointer compare
+  const InternedString n1_, n2_, if1_, if2_;
   HoldableValue<LinkStateMetric> metric1_{1}, metric2_{1};
   HoldableValue<bool> overload1_{false}, overload2_{false};
   int32_t adjLabel1_{0}, adjLabel2_{0};
@@ -90,8 +104,8 @@ class Link {
   LinkStateMetric holdUpTtl_{0};
 
   const std::pair<
-      std::pair<std::string, std::string>,
-      std::pair<std::string, std::string>>
+      std::pair<InternedString, InternedString>,
+      std::pair<InternedString, InternedString>>
       orderedNames;
 
  public:
@@ -101,10 +115,15 @@ class Link {
 
   bool isUp() const;
 
-  bool decrementHolds();
+  // advances all holds of the link by the given number of ticks, returns true
+  // if any expired
+  bool decrementHolds(LinkStateMetric ticks = 1);
 
   bool hasHolds() const;
 
+  // ticks until the next hold of the link expires, 0 if there is none
+  LinkStateMetric getHoldTtl() const;
+
   const std::string& getOtherNodeName(const std::string& nodeName) const;
 
   const std::string& firstNodeName() const;
@@ -156,28 +175,60 @@ class Link {
 
 class LinkState {
  public:
+  LinkState() = default;
+
+  // links are handed out as pointers into the arena owned by this object
+  LinkState(const LinkState&) = delete;
+  LinkState& operator=(const LinkState&) = delete;
+
   struct LinkPtrHash {
-    bool operator()(const std::shared_ptr<Link>& l) const;
+    size_t operator()(const Link* l) const;
   };
 
   struct LinkPtrLess {
-    bool operator()(
-        const std::shared_ptr<Link>& lhs,
-        const std::shared_ptr<Link>& rhs) const;
+    bool operator()(const Link* lhs, const Link* rhs) const;
   };
 
   struct LinkPtrEqual {
-    bool operator()(
-        const std::shared_ptr<Link>& lhs,
-        const std::shared_ptr<Link>& rhs) const;
+    bool operator()(const Link* lhs, const Link* rhs) const;
   };
 
-  using LinkSet =
-      std::unordered_set<std::shared_ptr<Link>, LinkPtrHash, LinkPtrEqual>;
+  using LinkSet = std::unordered_set<const Link*, LinkPtrHash, LinkPtrEqual>;
+
+  // links of a node, ordered by LinkPtrLess
+  using LinkList = std::vector<Link*>;
+
+  // Dense integer id assigned to every node name seen by this LinkState.
+  // Ids are stable for the lifetime of the LinkState object.
+  using NodeId = uint32_t;
+
+  //
+  // Compact view of the links which are currently up, in compressed sparse
+  // row (CSR) form. Outgoing edges of node `id` are stored in the contiguous
+  // range [offsets[id], offsets[id + 1]) of the per-edge arrays, and metric
+  // holds the metric as advertised from the source side of that edge. This
+  // lets SPF relax edges over contiguous arrays instead of hashing node names
+  // on every step.
+  //
+  struct Graph {
+    std::vector<size_t> offsets;
+    std::vector<NodeId> dsts;
+    std::vector<LinkStateMetric> metrics;
+    // valid as long as the link state isn't modified
+    std::vector<const Link*> links;
+    std::vector<bool> overloaded;
+
+    size_t
+    numNodes() const {
+      return overloaded.size();
+    }
+  };
 
-  void addLink(std::shared_ptr<Link> link);
+  // stores a copy of the link, returns the stored link
+  Link& addLink(const Link& link);
 
-  void removeLink(std::shared_ptr<Link> link);
+  // throws std::out_of_range if the link is not present
+  void removeLink(const Link& link);
 
   void removeNode(const std::string& nodeName);
 
@@ -186,10 +237,14 @@ class LinkState {
     return 0 != adjacencyDatabases_.count(nodeName);
   }
 
-  const LinkSet& linksFromNode(const std::string& nodeName) const;
+  // links are kept ordered on insert, hence both of these are the same
+  // allocation free lookup
+  const LinkList& linksFromNode(const std::string& nodeName) const;
 
-  std::vector<std::shared_ptr<Link>> orderedLinksFromNode(
-      const std::string& nodeName);
+  const LinkList&
+  orderedLinksFromNode(const std::string& nodeName) const {
+    return linksFromNode(nodeName);
+  }
 
   bool updateNodeOverloaded(
       const std::string& nodeName,
@@ -199,13 +254,18 @@ class LinkState {
 
   bool isNodeOverloaded(const std::string& nodeName) const;
 
+  // advances holds by one tick, returns true if any expired. Only links and
+  // nodes with holds expiring on this tick are touched
   bool decrementHolds();
 
-  bool hasHolds() const;
+  bool
+  hasHolds() const {
+    return not linkHolds_.empty() or not nodeHolds_.empty();
+  }
 
   size_t
   numLinks() const {
-    return allLinks_.size();
+    return linkSlots_.size();
   }
 
   size_t
@@ -213,12 +273,47 @@ class LinkState {
     return linkMap_.size();
   }
 
-  // update adjacencies for the given router
+  // adjacency database updates applied without diffing their links, see
+  // updateAdjacencyDatabase()
+  size_t
+  numUnchangedAdjDbUpdates() const {
+    return numUnchangedAdjDbUpdates_;
+  }
+
+  // returns the CSR view of the current link state. The view is rebuilt
+  // lazily on first access after any change. Each rebuild produces a new
+  // immutable snapshot, hence holders of getGraphPtr() can keep using the
+  // graph they were handed and compare snapshots by pointer.
+  const Graph&
+  getGraph() const {
+    return *getGraphPtr();
+  }
+
+  std::shared_ptr<const Graph> getGraphPtr() const;
+
+  // monotonically increasing generation of the link state, bumped on every
+  // update which may change the graph. Results derived from the graph can be
+  // cached as long as the generation stays the same
+  uint64_t
+  getGeneration() const {
+    return generation_;
+  }
+
+  folly::Optional<NodeId> getNodeId(const std::string& nodeName) const;
+
+  const std::string&
+  getNodeName(NodeId id) const {
+    return nodeNames_.at(id).str();
+  }
+
+  // update adjacencies for the given router. Updates with the same links and
+  // node attributes as before, e.g. new perf events or rtt only, are stored
+  // without touching the graph
   std::pair<
       bool /* topology has changed */,
       bool /* route attributes has changed (nexthop addr, node/adj label */>
   updateAdjacencyDatabase(
-      thrift::AdjacencyDatabase const& adjacencyDb,
+      thrift::AdjacencyDatabase adjacencyDb,
       LinkStateMetric holdUpTtl,
       LinkStateMetric holdDownTtl);
 
@@ -236,26 +331,91 @@ class LinkState {
 
  private:
   // returns Link object if the reverse adjancency is present in
-  // adjacencyDatabases_.at(adj.otherNodeName), else returns nullptr
-  std::shared_ptr<Link> maybeMakeLink(
+  // adjacencyDatabases_.at(adj.otherNodeName), else returns none
+  folly::Optional<Link> maybeMakeLink(
       const std::string& nodeName, const thrift::Adjacency& adj) const;
 
-  std::vector<std::shared_ptr<Link>> getOrderedLinkSet(
-      const thrift::AdjacencyDatabase& adjDb) const;
+  // bidirectional links of adjDb ordered by LinkPtrLess, the links are stored
+  // in storage
+  std::vector<const Link*> getOrderedLinkSet(
+      const thrift::AdjacencyDatabase& adjDb, std::vector<Link>& storage) const;
 
-  // this stores the same link object accessible from either nodeName
-  std::unordered_map<std::string /* nodeName */, LinkSet> linkMap_;
+  // release the arena slot of a link no longer referenced by any node
+  void freeLink(const Link* link);
+
+  // brings the ttls of holds of the link in slot, or of the overload of
+  // nodeName, up to date with holdTick_. Returns true if any expired
+  bool syncLinkHolds(uint32_t slot);
+  bool syncNodeHolds(const std::string& nodeName);
+
+  // indexes the next hold expiry of the link in slot, or of the overload of
+  // nodeName. Must be in sync with holdTick_
+  void scheduleLinkHolds(uint32_t slot);
+  void scheduleNodeHolds(const std::string& nodeName);
+
+  NodeId getOrCreateNodeId(const std::string& nodeName);
+
+  std::shared_ptr<const Graph> rebuildGraph() const;
+
+  // mark the graph view stale and bump the generation
+  void
+  invalidateGraph() {
+    graphValid_ = false;
+    ++generation_;
+  }
 
-  // useful for iterating over all the links
-  LinkSet allLinks_;
+  // Arena of all links. Slots of removed links are reused, and since a deque
+  // never moves its elements, pointers to a link stay valid until it is
+  // removed.
+  std::deque<folly::Optional<Link>> linkArena_;
+  std::vector<uint32_t> freeLinkSlots_;
+
+  // arena slot of each link, keys point into the arena
+  std::unordered_map<const Link*, uint32_t, LinkPtrHash, LinkPtrEqual>
+      linkSlots_;
+
+  // this stores the same link object accessible from either nodeName
+  std::unordered_map<std::string /* nodeName */, LinkList> linkMap_;
 
   std::unordered_map<std::string /* nodeName */, HoldableValue<bool>>
       nodeOverloads_;
 
+  // Ordered FIB holds. Links and nodes with holds are indexed by the tick
+  // their next hold expires on, stale index entries are skipped. The ttls of
+  // their holds are only brought up to date, i.e. decremented by the ticks
+  // passed since the last time, when touched
+  struct HoldTicks {
+    // tick the ttls were last brought up to date on
+    LinkStateMetric synced{0};
+    // tick the next hold expires on
+    LinkStateMetric expiry{0};
+  };
+  LinkStateMetric holdTick_{0};
+  std::unordered_map<uint32_t /* link slot */, HoldTicks> linkHolds_;
+  std::unordered_map<std::string /* nodeName */, HoldTicks> nodeHolds_;
+  std::map<LinkStateMetric /* tick */, std::vector<uint32_t /* link slot */>>
+      linkHoldExpiries_;
+  std::map<LinkStateMetric /* tick */, std::vector<std::string /* nodeName */>>
+      nodeHoldExpiries_;
+
   // the latest AdjacencyDatabase we've received from each node
   std::unordered_map<std::string, thrift::AdjacencyDatabase>
       adjacencyDatabases_;
 
+  // interned node names, nodeNames_[id] is the name of node with that id
+  std::unordered_map<std::string, NodeId> nodeIds_;
+  std::vector<InternedString> nodeNames_;
+
+  // lazily rebuilt CSR view of the link state, see getGraph()
+  mutable std::shared_ptr<const Graph> graph_;
+  mutable bool graphValid_{false};
+
+  // see getGeneration()
+  uint64_t generation_{0};
+
+  // see numUnchangedAdjDbUpdates()
+  size_t numUnchangedAdjDbUpdates_{0};
+
 }; // class LinkState
 } // namespace openr
 
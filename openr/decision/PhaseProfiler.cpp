@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/decision/PhaseProfiler.h"
+
+#include <folly/Format.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+struct PhaseNames {
+  const char* name;
+  const char* eventName;
+};
+
+// indexed by RouteComputePhase
+const std::array<PhaseNames, PhaseProfiler::kNumPhases> kPhaseNames{{
+    {"spf", "SPF"},
+    {"lfa", "LFA"},
+    {"unicast_routes", "UNICAST_ROUTES"},
+    {"best_announcer", "BEST_ANNOUNCER"},
+    {"bgp_metric_compare", "BGP_METRIC_COMPARE"},
+    {"ksp2", "KSP2"},
+    {"mpls_routes", "MPLS_ROUTES"},
+    {"route_delta", "ROUTE_DELTA"},
+    {"area_merge", "AREA_MERGE"},
+}};
+
+} // anonymous namespace
+
+PhaseProfiler::ScopedPhase::ScopedPhase(PhaseProfiler* profiler, Phase phase)
+    : profiler_(profiler),
+      phase_(phase),
+      startTime_(
+          profiler ? std::chrono::steady_clock::now()
+                   : std::chrono::steady_clock::time_point()) {}
+
+PhaseProfiler::ScopedPhase::~ScopedPhase() {
+  if (profiler_) {
+    profiler_->addDuration(
+        phase_, std::chrono::steady_clock::now() - startTime_);
+  }
+}
+
+PhaseProfiler::PhaseProfiler(size_t windowSize)
+    : histograms_(kNumPhases, WindowedHistogram(windowSize)) {
+}
+
+const char*
+PhaseProfiler::getPhaseName(Phase phase) {
+  return kPhaseNames.at(static_cast<size_t>(phase)).name;
+}
+
+const char*
+PhaseProfiler::getPhaseEventName(Phase phase) {
+  return kPhaseNames.at(static_cast<size_t>(phase)).eventName;
+}
+
+void
+PhaseProfiler::addDuration(Phase phase, std::chrono::nanoseconds duration) {
+  const auto index = static_cast<size_t>(phase);
+  DCHECK_LT(index, kNumPhases);
+  runDurations_[index].fetch_add(duration.count(), std::memory_order_relaxed);
+  runSamples_[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<PhaseProfiler::PhaseDuration>
+PhaseProfiler::finishRun() {
+  std::vector<PhaseDuration> phases;
+  for (size_t i = 0; i < kNumPhases; ++i) {
+    if (0 == runSamples_[i].exchange(0, std::memory_order_relaxed)) {
+      continue;
+    }
+    const auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::nanoseconds(
+                runDurations_[i].exchange(0, std::memory_order_relaxed)));
+    phases.emplace_back(static_cast<Phase>(i), duration);
+    histograms_[i].addValue(duration.count());
+  }
+  return phases;
+}
+
+std::unordered_map<std::string, int64_t>
+PhaseProfiler::getCounters() const {
+  std::unordered_map<std::string, int64_t> counters;
+  for (size_t i = 0; i < kNumPhases; ++i) {
+    histograms_[i].addCounters(
+        folly::sformat(
+            "decision.phase.{}_us", getPhaseName(static_cast<Phase>(i))),
+        counters);
+  }
+  return counters;
+}
+
+} // namespace openr
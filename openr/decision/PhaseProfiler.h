@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openr/common/WindowedHistogram.h>
+
+namespace openr {
+
+//
+// Phases of a route computation. Phases may nest, e.g. SPF runs issued by
+// KSP2 count towards both SPF and KSP2. Unicast routes are created in chunks
+// of prefixes by disjoint phases, each timed once per chunk: selection of the
+// best announcers of Open/R prefixes (BEST_ANNOUNCER), of BGP prefixes by
+// their metric vectors (BGP_METRIC_COMPARE), and creation of the routes
+// (UNICAST_ROUTES, or ROUTE_DELTA for partial route builds).
+//
+enum class RouteComputePhase : uint8_t {
+  SPF = 0,
+  LFA,
+  UNICAST_ROUTES,
+  BEST_ANNOUNCER,
+  BGP_METRIC_COMPARE,
+  KSP2,
+  MPLS_ROUTES,
+  ROUTE_DELTA,
+  AREA_MERGE,
+  // must be last
+  NUM_PHASES,
+};
+
+//
+// Accumulates the time spent in each phase of a route computation and keeps
+// per phase duration histograms over the most recent computations.
+//
+// Durations can be added from multiple threads concurrently, e.g. by parallel
+// route build workers or areas computed concurrently, in which case the
+// duration of a phase is the sum over all threads. finishRun() and
+// getCounters() must not be called concurrently with each other.
+//
+class PhaseProfiler {
+ public:
+  using Phase = RouteComputePhase;
+  using PhaseDuration = std::pair<Phase, std::chrono::microseconds>;
+
+  static constexpr size_t kNumPhases = static_cast<size_t>(Phase::NUM_PHASES);
+
+  // Adds the lifetime of this object to the given phase. A null profiler
+  // makes it a no-op.
+  class ScopedPhase {
+   public:
+    ScopedPhase(PhaseProfiler* profiler, Phase phase);
+    ~ScopedPhase();
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+   private:
+    PhaseProfiler* const profiler_{nullptr};
+    const Phase phase_;
+    const std::chrono::steady_clock::time_point startTime_;
+  };
+
+  // windowSize is the number of most recent durations per phase the
+  // percentiles are computed over
+  explicit PhaseProfiler(size_t windowSize);
+
+  // lower case name used in counters, e.g. "best_announcer"
+  static const char* getPhaseName(Phase phase);
+
+  // upper case name used in perf events, e.g. "BEST_ANNOUNCER"
+  static const char* getPhaseEventName(Phase phase);
+
+  void addDuration(Phase phase, std::chrono::nanoseconds duration);
+
+  // Ends the current route computation. Returns the phases which ran since
+  // the last call, in the order of Phase, along with their total duration and
+  // adds these to the histograms.
+  std::vector<PhaseDuration> finishRun();
+
+  // p50, p99 and max duration in microseconds of each phase that ran so far,
+  // e.g. "decision.phase.spf_us.p99"
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
+ private:
+  // durations (in nanoseconds) and number of samples of the current run
+  std::array<std::atomic<int64_t>, kNumPhases> runDurations_{};
+  std::array<std::atomic<uint32_t>, kNumPhases> runSamples_{};
+
+  // most recent durations of each phase in microseconds, indexed by Phase
+  std::vector<WindowedHistogram> histograms_;
+};
+
+} // namespace openr
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/decision/PrefixLimiter.h>
+
+#include <algorithm>
+
+#include <folly/Optional.h>
+#include <glog/logging.h>
+
+#include <openr/common/EventLogBuffer.h>
+
+namespace openr {
+
+PrefixLimiter::PrefixLimiter(PrefixLimits limits) : limits_(std::move(limits)) {
+  for (size_t i = 0; i < limits_.typePriorities.size(); ++i) {
+    typeRanks_.emplace(limits_.typePriorities[i], i);
+  }
+}
+
+size_t
+PrefixLimiter::getRank(thrift::PrefixType type) const {
+  auto it = typeRanks_.find(type);
+  return it != typeRanks_.end() ? it->second : typeRanks_.size();
+}
+
+bool
+PrefixLimiter::isAccepted(const thrift::PrefixEntry& entry) const {
+  if (not limits_.allowedTypes.empty() and
+      not limits_.allowedTypes.count(entry.type)) {
+    return false;
+  }
+  if (entry.type == thrift::PrefixType::LOOPBACK) {
+    return true;
+  }
+  const auto len = entry.prefix.prefixLength;
+  if (entry.prefix.prefixAddress.addr.size() ==
+      folly::IPAddressV4::byteCount()) {
+    return len >= limits_.minV4Length and len <= limits_.maxV4Length;
+  }
+  return len >= limits_.minV6Length and len <= limits_.maxV6Length;
+}
+
+bool
+PrefixLimiter::isAdmitted(const thrift::IpPrefix& prefix) const {
+  auto it = candidateRanks_.find(prefix);
+  return it != candidateRanks_.end() and
+      admitted_.count(Candidate(it->second, prefix));
+}
+
+void
+PrefixLimiter::insertCandidate(
+    const Candidate& candidate,
+    std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted) {
+  wasAdmitted.emplace(candidate.second, false);
+  if (admitted_.size() < limits_.maxPrefixes) {
+    admitted_.emplace(candidate);
+    return;
+  }
+  auto last = std::prev(admitted_.end());
+  if (not(candidate < *last)) {
+    waiting_.emplace(candidate);
+    return;
+  }
+  // takes the room of the last one admitted
+  wasAdmitted.emplace(last->second, true);
+  waiting_.emplace(*last);
+  admitted_.erase(last);
+  admitted_.emplace(candidate);
+}
+
+void
+PrefixLimiter::eraseCandidate(
+    const Candidate& candidate,
+    std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted) {
+  if (not admitted_.erase(candidate)) {
+    wasAdmitted.emplace(candidate.second, false);
+    waiting_.erase(candidate);
+    return;
+  }
+  wasAdmitted.emplace(candidate.second, true);
+  // make room for the first one waiting
+  if (not waiting_.empty()) {
+    auto first = waiting_.begin();
+    wasAdmitted.emplace(first->second, false);
+    admitted_.emplace(*first);
+    waiting_.erase(first);
+  }
+}
+
+void
+PrefixLimiter::updateCandidate(
+    const thrift::IpPrefix& prefix,
+    std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted) {
+  // best rank of the entries of the prefix
+  folly::Optional<size_t> rank;
+  auto advertisersIt = advertisers_.find(prefix);
+  if (advertisersIt != advertisers_.end()) {
+    for (auto const& kv : advertisersIt->second) {
+      rank = std::min(rank.value_or(kv.second), kv.second);
+    }
+    if (not rank.hasValue()) {
+      advertisers_.erase(advertisersIt);
+    }
+  }
+
+  auto rankIt = candidateRanks_.find(prefix);
+  if (rankIt != candidateRanks_.end()) {
+    if (rank.hasValue() and *rank == rankIt->second) {
+      return;
+    }
+    eraseCandidate(Candidate(rankIt->second, prefix), wasAdmitted);
+    candidateRanks_.erase(rankIt);
+  }
+  if (rank.hasValue()) {
+    candidateRanks_.emplace(prefix, *rank);
+    insertCandidate(Candidate(*rank, prefix), wasAdmitted);
+  }
+}
+
+thrift::PrefixDatabase
+PrefixLimiter::getPrefixDatabase(const std::string& nodeName) const {
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = nodeName;
+  auto it = nodePrefixes_.find(nodeName);
+  if (it == nodePrefixes_.end()) {
+    return prefixDb;
+  }
+  prefixDb.prefixEntries.reserve(it->second.size());
+  for (auto const& kv : it->second) {
+    if (limits_.maxPrefixes == 0 or isAdmitted(kv.first)) {
+      prefixDb.prefixEntries.emplace_back(kv.second);
+    }
+  }
+  return prefixDb;
+}
+
+std::vector<thrift::PrefixDatabase>
+PrefixLimiter::updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb) {
+  auto const& nodeName = prefixDb.thisNodeName;
+
+  // type and length filters
+  std::vector<const thrift::PrefixEntry*> entries;
+  entries.reserve(prefixDb.prefixEntries.size());
+  size_t numRejected{0};
+  for (auto const& entry : prefixDb.prefixEntries) {
+    if (isAccepted(entry)) {
+      entries.emplace_back(&entry);
+    } else {
+      ++numRejected;
+    }
+  }
+
+  // per node limit, keeping the entries of highest priority
+  size_t numOverLimit{0};
+  const auto maxPerNode = limits_.maxPrefixesPerNode;
+  if (maxPerNode and entries.size() > maxPerNode) {
+    numOverLimit = entries.size() - maxPerNode;
+    std::nth_element(
+        entries.begin(),
+        entries.begin() + maxPerNode,
+        entries.end(),
+        [this](const thrift::PrefixEntry* a, const thrift::PrefixEntry* b) {
+          const auto rankA = getRank(a->type);
+          const auto rankB = getRank(b->type);
+          return rankA < rankB or (rankA == rankB and a->prefix < b->prefix);
+        });
+    entries.resize(maxPerNode);
+    if (nodesOverLimit_.emplace(nodeName).second) {
+      LOG(WARNING) << "Node " << nodeName << " advertises "
+                   << numOverLimit + maxPerNode << " prefixes, over the limit "
+                   << "of " << maxPerNode << ". Ignoring " << numOverLimit
+                   << " of lowest priority";
+      EventLogBuffer::get().log([&](EventLogRecord& record) {
+        record.addString("event", "PREFIX_LIMIT_EXCEEDED");
+        record.addString("node_name", nodeName);
+        record.addInt("num_prefixes", numOverLimit + maxPerNode);
+        record.addInt("max_prefixes", maxPerNode);
+      });
+    }
+  } else if (nodesOverLimit_.erase(nodeName)) {
+    LOG(INFO) << "Node " << nodeName << " is back within the prefix limit";
+  }
+
+  auto& numDropped = nodeNumDropped_[nodeName];
+  if (numRejected > numDropped.first) {
+    LOG(WARNING) << "Rejected " << numRejected << " prefixes of node "
+                 << nodeName << " by type or length";
+    EventLogBuffer::get().log([&](EventLogRecord& record) {
+      record.addString("event", "PREFIXES_REJECTED");
+      record.addString("node_name", nodeName);
+      record.addInt("num_prefixes", numRejected);
+    });
+  }
+  numRejected_ += numRejected - numDropped.first;
+  numOverNodeLimit_ += numOverLimit - numDropped.second;
+  numDropped = {numRejected, numOverLimit};
+  if (numRejected == 0 and numOverLimit == 0) {
+    nodeNumDropped_.erase(nodeName);
+  }
+
+  std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry> newPrefixes;
+  newPrefixes.reserve(entries.size());
+  for (auto const* entry : entries) {
+    newPrefixes.emplace(entry->prefix, *entry);
+  }
+
+  // global limit, tracking prefixes whose admission changed
+  std::unordered_set<std::string> otherNodes;
+  if (limits_.maxPrefixes) {
+    const bool wasOverLimit = not waiting_.empty();
+    std::unordered_map<thrift::IpPrefix, bool> wasAdmitted;
+    auto const& oldPrefixes = nodePrefixes_[nodeName];
+    for (auto const& kv : oldPrefixes) {
+      if (not newPrefixes.count(kv.first)) {
+        advertisers_[kv.first].erase(nodeName);
+        updateCandidate(kv.first, wasAdmitted);
+      }
+    }
+    for (auto const& kv : newPrefixes) {
+      const auto rank = getRank(kv.second.type);
+      auto& ranks = advertisers_[kv.first];
+      auto it = ranks.find(nodeName);
+      if (it == ranks.end() or it->second != rank) {
+        ranks[nodeName] = rank;
+        updateCandidate(kv.first, wasAdmitted);
+      }
+    }
+    for (auto const& kv : wasAdmitted) {
+      if (kv.second == isAdmitted(kv.first)) {
+        continue;
+      }
+      auto it = advertisers_.find(kv.first);
+      if (it == advertisers_.end()) {
+        continue;
+      }
+      for (auto const& advertiser : it->second) {
+        if (advertiser.first != nodeName) {
+          otherNodes.emplace(advertiser.first);
+        }
+      }
+    }
+    const bool isOverLimit = not waiting_.empty();
+    if (wasOverLimit != isOverLimit) {
+      LOG(WARNING) << "Network wide prefix limit of " << limits_.maxPrefixes
+                   << (isOverLimit ? " exceeded" : " no longer exceeded");
+      EventLogBuffer::get().log([&](EventLogRecord& record) {
+        record.addString(
+            "event",
+            isOverLimit ? "PREFIX_BUDGET_EXCEEDED" : "PREFIX_BUDGET_RESTORED");
+        record.addInt("num_prefixes", admitted_.size() + waiting_.size());
+        record.addInt("max_prefixes", limits_.maxPrefixes);
+      });
+    }
+  }
+  if (newPrefixes.empty()) {
+    nodePrefixes_.erase(nodeName);
+  } else {
+    nodePrefixes_[nodeName] = std::move(newPrefixes);
+  }
+
+  std::vector<thrift::PrefixDatabase> prefixDbs;
+  prefixDbs.reserve(otherNodes.size() + 1);
+  prefixDbs.emplace_back(getPrefixDatabase(nodeName));
+  prefixDbs.back().perfEvents = prefixDb.perfEvents;
+  for (auto const& otherNode : otherNodes) {
+    prefixDbs.emplace_back(getPrefixDatabase(otherNode));
+  }
+  return prefixDbs;
+}
+
+} // namespace openr
@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+// Limits on the prefixes Decision computes routes for
+struct PrefixLimits {
+  // prefixes accepted from a single node, 0 for no limit
+  size_t maxPrefixesPerNode{0};
+
+  // distinct prefixes accepted from all nodes of an area, 0 for no limit
+  size_t maxPrefixes{0};
+
+  // types of prefixes accepted, all if empty
+  std::unordered_set<thrift::PrefixType> allowedTypes;
+
+  // lengths of prefixes accepted, by address family. Not applied to
+  // LOOPBACK prefixes, next-hops are resolved through them
+  uint8_t minV4Length{0};
+  uint8_t maxV4Length{32};
+  uint8_t minV6Length{0};
+  uint8_t maxV6Length{128};
+
+  // types by decreasing priority, others come last. Prefixes of higher
+  // priority are accepted first when a limit is exceeded, ties are broken by
+  // prefix for every node to accept the same ones
+  std::vector<thrift::PrefixType> typePriorities;
+
+  bool
+  isEnabled() const {
+    return maxPrefixesPerNode or maxPrefixes or not allowedTypes.empty() or
+        minV4Length > 0 or maxV4Length < 32 or minV6Length > 0 or
+        maxV6Length < 128;
+  }
+};
+
+/**
+ * Applies PrefixLimits to the prefix databases of the nodes of an area,
+ * before they reach PrefixState. A node exceeding a limit only loses its own
+ * prefixes of lowest priority, the global limit only the prefixes of lowest
+ * priority network wide, and only these are left out of route computation.
+ */
+class PrefixLimiter {
+ public:
+  explicit PrefixLimiter(PrefixLimits limits);
+
+  // Apply the limits to the prefix database of a node and return the
+  // accepted prefix database of every node whose accepted prefixes changed.
+  // The one of the node itself is always returned first, with its perf
+  // events
+  std::vector<thrift::PrefixDatabase> updatePrefixDatabase(
+      const thrift::PrefixDatabase& prefixDb);
+
+  // nodes advertising more prefixes than maxPrefixesPerNode
+  const std::unordered_set<std::string>&
+  getNodesOverLimit() const {
+    return nodesOverLimit_;
+  }
+
+  size_t
+  getNumRejected() const {
+    return numRejected_;
+  }
+
+  size_t
+  getNumOverNodeLimit() const {
+    return numOverNodeLimit_;
+  }
+
+  // distinct prefixes left out by the global limit
+  size_t
+  getNumOverLimit() const {
+    return waiting_.size();
+  }
+
+ private:
+  // priority rank of type, lower first
+  size_t getRank(thrift::PrefixType type) const;
+
+  // whether entry passes the type and length filters
+  bool isAccepted(const thrift::PrefixEntry& entry) const;
+
+  // accepted prefix database of node
+  thrift::PrefixDatabase getPrefixDatabase(const std::string& nodeName) const;
+
+  // candidates of the global limit, by rank and prefix
+  using Candidate = std::pair<size_t, thrift::IpPrefix>;
+
+  // re-rank prefix after its advertisers changed, recording the admission of
+  // prefixes moved before their first move in wasAdmitted
+  void updateCandidate(
+      const thrift::IpPrefix& prefix,
+      std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted);
+  void insertCandidate(
+      const Candidate& candidate,
+      std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted);
+  void eraseCandidate(
+      const Candidate& candidate,
+      std::unordered_map<thrift::IpPrefix, bool>& wasAdmitted);
+
+  bool isAdmitted(const thrift::IpPrefix& prefix) const;
+
+  const PrefixLimits limits_;
+  std::unordered_map<thrift::PrefixType, size_t> typeRanks_;
+
+  // prefixes of each node passing the filters and the per node limit
+  std::unordered_map<
+      std::string,
+      std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
+      nodePrefixes_;
+  std::unordered_set<std::string> nodesOverLimit_;
+
+  // entries rejected by the filters and the per node limit, by node
+  std::unordered_map<std::string, std::pair<size_t, size_t>> nodeNumDropped_;
+  size_t numRejected_{0};
+  size_t numOverNodeLimit_{0};
+
+  // global limit only: nodes advertising each prefix with the rank of their
+  // entry, and the rank each prefix is a candidate with
+  std::unordered_map<thrift::IpPrefix, std::map<std::string, size_t>>
+      advertisers_;
+  std::unordered_map<thrift::IpPrefix, size_t> candidateRanks_;
+
+  // global limit only: the first maxPrefixes candidates are admitted, others
+  // wait for room
+  std::set<Candidate> admitted_;
+  std::set<Candidate> waiting_;
+};
+
+} // namespace openr
@@ -7,6 +7,8 @@
 
 #include "openr/decision/PrefixState.h"
 
+#include <algorithm>
+
 #include <openr/common/Util.h>
 
 namespace openr {
@@ -29,77 +31,148 @@ PrefixState::deleteLoopbackPrefix(
   }
 }
 
-bool
+std::unordered_set<thrift::IpPrefix>
+PrefixState::PrefixChanges::all() const {
+  std::unordered_set<thrift::IpPrefix> prefixes;
+  prefixes.reserve(added.size() + updated.size() + removed.size());
+  prefixes.insert(added.begin(), added.end());
+  prefixes.insert(updated.begin(), updated.end());
+  prefixes.insert(removed.begin(), removed.end());
+  return prefixes;
+}
+
+PrefixState::PrefixChanges
 PrefixState::updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb) {
   auto const& nodeName = prefixDb.thisNodeName;
+  const InternedString internedNodeName(nodeName);
 
-  // Get old and new set of prefixes - NOTE explicit copy
-  const std::set<thrift::IpPrefix> oldPrefixSet = nodeToPrefixes_[nodeName];
-
-  // update the entry
-  auto& newPrefixSet = nodeToPrefixes_[nodeName];
-  newPrefixSet.clear();
-  for (const auto& prefixEntry : prefixDb.prefixEntries) {
-    newPrefixSet.emplace(prefixEntry.prefix);
-  }
-
-  // Boolean to indicate update in prefix entry
-  bool isUpdated{false};
-
-  // Remove old prefixes first
-  for (const auto& prefix : oldPrefixSet) {
-    if (newPrefixSet.count(prefix)) {
-      continue;
-    }
-    VLOG(1) << "Prefix " << toString(prefix) << " has been withdrawn by "
-            << nodeName;
-    auto& nodeList = prefixes_.at(prefix);
-    nodeList.erase(nodeName);
-    isUpdated = true;
-    if (nodeList.empty()) {
-      prefixes_.erase(prefix);
+  PrefixChanges changes;
+  auto nodeIt = nodeToPrefixes_.find(internedNodeName);
+  if (nodeIt == nodeToPrefixes_.end()) {
+    if (prefixDb.prefixEntries.empty()) {
+      return changes;
     }
-    deleteLoopbackPrefix(prefix, nodeName);
+    nodeIt = nodeToPrefixes_.emplace(internedNodeName, NodePrefixes()).first;
   }
+  auto& node = nodeIt->second;
+  const size_t numKnownSlots = node.entries.size();
+  node.seen.assign(numKnownSlots, false);
+  node.updated.assign(numKnownSlots, false);
+  // number of previously known slots which are part of this update
+  size_t numSeen = 0;
+
   for (const auto& prefixEntry : prefixDb.prefixEntries) {
-    auto& nodeList = prefixes_[prefixEntry.prefix];
-    auto nodePrefixIt = nodeList.find(nodeName);
+    auto const& prefix = prefixEntry.prefix;
+    const PrefixKey prefixKey(prefix);
+    auto slotIt = node.slots.find(prefixKey);
 
-    // Add or Update prefix
-    if (nodePrefixIt == nodeList.end()) {
-      VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
+    // Add prefix
+    if (slotIt == node.slots.end()) {
+      VLOG(1) << "Prefix " << toString(prefix)
               << " has been advertised by node " << nodeName;
-      nodeList.emplace(nodeName, prefixEntry);
-      isUpdated = true;
-    } else if (nodePrefixIt->second != prefixEntry) {
-      VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
-              << " has been updated by node " << nodeName;
-      nodeList[nodeName] = prefixEntry;
-      isUpdated = true;
+      auto& entry =
+          prefixes_[prefixKey].emplace(nodeName, prefixEntry).first->second;
+      node.slots.emplace(
+          prefixKey, static_cast<uint32_t>(node.entries.size()));
+      node.entries.emplace_back(&entry);
+      node.seen.push_back(true);
+      changes.added.emplace_back(prefix);
+      updateCompiledMetricVector(entry);
     } else {
-      // This prefix has no change. Skip rest of code!
-      continue;
+      const auto slot = slotIt->second;
+      if (not node.seen[slot]) {
+        node.seen[slot] = true;
+        ++numSeen;
+      }
+      auto& entry = *node.entries[slot];
+      if (entry == prefixEntry) {
+        // This prefix has no change. Skip rest of code!
+        continue;
+      }
+      // Update prefix
+      VLOG(1) << "Prefix " << toString(prefix) << " has been updated by node "
+              << nodeName;
+      entry = prefixEntry;
+      updateCompiledMetricVector(entry);
+      // duplicate entries within one prefixDb are reported once, slots
+      // beyond the known ones were reported as added
+      if (slot < numKnownSlots and not node.updated[slot]) {
+        node.updated[slot] = true;
+        changes.updated.emplace_back(prefix);
+      }
     }
 
     // Keep track of loopback addresses (v4 / v6) for each node
     if (thrift::PrefixType::LOOPBACK == prefixEntry.type) {
-      auto addrSize = prefixEntry.prefix.prefixAddress.addr.size();
+      auto addrSize = prefix.prefixAddress.addr.size();
       if (addrSize == folly::IPAddressV4::byteCount() &&
-          folly::IPAddressV4::bitCount() == prefixEntry.prefix.prefixLength) {
-        nodeHostLoopbacksV4_[nodeName] = prefixEntry.prefix.prefixAddress;
+          folly::IPAddressV4::bitCount() == prefix.prefixLength) {
+        nodeHostLoopbacksV4_[nodeName] = prefix.prefixAddress;
       }
       if (addrSize == folly::IPAddressV6::byteCount() &&
-          folly::IPAddressV6::bitCount() == prefixEntry.prefix.prefixLength) {
-        nodeHostLoopbacksV6_[nodeName] = prefixEntry.prefix.prefixAddress;
+          folly::IPAddressV6::bitCount() == prefix.prefixLength) {
+        nodeHostLoopbacksV6_[nodeName] = prefix.prefixAddress;
       }
     }
   }
 
-  if (newPrefixSet.empty()) {
-    nodeToPrefixes_.erase(nodeName);
+  node.updated.clear();
+
+  // Remove withdrawn prefixes. Only needed if some of the previously known
+  // slots were not part of this update, which is the rare case.
+  if (numSeen < numKnownSlots) {
+    for (size_t slot = node.entries.size(); slot-- > 0;) {
+      if (node.seen[slot]) {
+        continue;
+      }
+      // NOTE explicit copy, entry gets destroyed below
+      const auto prefix = node.entries[slot]->prefix;
+      VLOG(1) << "Prefix " << toString(prefix) << " has been withdrawn by "
+              << nodeName;
+      const PrefixKey prefixKey(prefix);
+      compiledMetricVectors_.erase(node.entries[slot]);
+      auto& nodeList = prefixes_.at(prefixKey);
+      nodeList.erase(nodeName);
+      if (nodeList.empty()) {
+        prefixes_.erase(prefixKey);
+      }
+      deleteLoopbackPrefix(prefix, nodeName);
+
+      // slots after this one have been visited already, move the last one
+      // into the free slot
+      node.slots.erase(prefixKey);
+      if (slot + 1 != node.entries.size()) {
+        node.entries[slot] = node.entries.back();
+        node.seen[slot] = node.seen.back();
+        node.slots.at(PrefixKey(node.entries[slot]->prefix)) = slot;
+      }
+      node.entries.pop_back();
+      node.seen.pop_back();
+      changes.removed.emplace_back(prefix);
+    }
+  }
+
+  if (node.entries.empty()) {
+    nodeToPrefixes_.erase(nodeIt);
   }
 
-  return isUpdated;
+  return changes;
+}
+
+void
+PrefixState::updateCompiledMetricVector(thrift::PrefixEntry const& entry) {
+  if (entry.mv.hasValue()) {
+    compiledMetricVectors_[&entry] =
+        MetricVectorUtils::compileMetricVector(entry.mv.value());
+  } else {
+    compiledMetricVectors_.erase(&entry);
+  }
+}
+
+MetricVectorUtils::CompiledMetricVector const*
+PrefixState::getCompiledMetricVector(thrift::PrefixEntry const& entry) const {
+  auto it = compiledMetricVectors_.find(&entry);
+  return it == compiledMetricVectors_.end() ? nullptr : &it->second;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
@@ -107,11 +180,19 @@ PrefixState::getPrefixDatabases() const {
   std::unordered_map<std::string, thrift::PrefixDatabase> prefixDatabases;
   for (auto const& kv : nodeToPrefixes_) {
     thrift::PrefixDatabase prefixDb;
-    prefixDb.thisNodeName = kv.first;
-    for (auto const& prefix : kv.second) {
-      prefixDb.prefixEntries.emplace_back(prefixes_.at(prefix).at(kv.first));
+    prefixDb.thisNodeName = kv.first.str();
+    prefixDb.prefixEntries.reserve(kv.second.entries.size());
+    for (auto const* entry : kv.second.entries) {
+      prefixDb.prefixEntries.emplace_back(*entry);
     }
-    prefixDatabases.emplace(kv.first, std::move(prefixDb));
+    // slots are unordered, report entries ordered by prefix
+    std::sort(
+        prefixDb.prefixEntries.begin(),
+        prefixDb.prefixEntries.end(),
+        [](thrift::PrefixEntry const& a, thrift::PrefixEntry const& b) {
+          return a.prefix < b.prefix;
+        });
+    prefixDatabases.emplace(kv.first.str(), std::move(prefixDb));
   }
   return prefixDatabases;
 }
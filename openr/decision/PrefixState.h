@@ -7,20 +7,26 @@
 
 #pragma once
 
-#include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/StringInterner.h>
+#include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 
 namespace openr {
 class PrefixState {
  public:
-  std::unordered_map<
-      thrift::IpPrefix,
-      std::unordered_map<std::string, thrift::PrefixEntry>> const&
+  // Nodes advertising a prefix, keyed by packed prefix. The thrift prefix is
+  // the one of any of the entries, prefixes have at least one
+  using PrefixEntries = std::unordered_map<
+      PrefixKey,
+      std::unordered_map<std::string, thrift::PrefixEntry>>;
+
+  PrefixEntries const&
   prefixes() const {
     return prefixes_;
   }
@@ -29,8 +35,24 @@ class PrefixState {
   void deleteLoopbackPrefix(
       thrift::IpPrefix const& prefix, const std::string& nodename);
 
-  // returns true if the prefixDb changed
-  bool updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb);
+  // Prefixes whose advertisement by a node changed with an update
+  struct PrefixChanges {
+    std::vector<thrift::IpPrefix> added;
+    std::vector<thrift::IpPrefix> updated;
+    std::vector<thrift::IpPrefix> removed;
+
+    bool
+    empty() const {
+      return added.empty() and updated.empty() and removed.empty();
+    }
+
+    // all changed prefixes regardless of the kind of change
+    std::unordered_set<thrift::IpPrefix> all() const;
+  };
+
+  // Diffs the prefixDb against what is known for its node and returns the
+  // prefixes whose advertisements changed, empty if the prefixDb didn't change
+  PrefixChanges updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb);
 
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
   getPrefixDatabases() const;
@@ -40,6 +62,11 @@ class PrefixState {
       bool const isV4,
       folly::Optional<int64_t> const& igpMetric) const;
 
+  // Metric vector of an entry of prefixes(), compiled when it was received.
+  // nullptr if the entry has no metric vector
+  MetricVectorUtils::CompiledMetricVector const* getCompiledMetricVector(
+      thrift::PrefixEntry const& entry) const;
+
   std::unordered_map<std::string, thrift::BinaryAddress> const&
   getNodeHostLoopbacksV4() const {
     return nodeHostLoopbacksV4_;
@@ -51,12 +78,30 @@ class PrefixState {
   }
 
  private:
+  // compile the metric vector of an added or updated entry of prefixes_
+  void updateCompiledMetricVector(thrift::PrefixEntry const& entry);
+
   // For each prefix in the network, stores a set of nodes that advertise it
+  PrefixEntries prefixes_;
+
+  // Prefixes advertised by a single node. Each prefix owns a dense slot which
+  // points at the node's entry in prefixes_ (references into unordered_map
+  // stay valid on rehash). Slots are compacted with swap and pop on removal.
+  struct NodePrefixes {
+    std::unordered_map<PrefixKey, uint32_t> slots;
+    std::vector<thrift::PrefixEntry*> entries;
+    // per slot mark of prefixes seen in the update being applied
+    std::vector<bool> seen;
+    // per slot mark of previously known prefixes reported as updated by the
+    // update being applied, empty otherwise
+    std::vector<bool> updated;
+  };
+  std::unordered_map<InternedString, NodePrefixes> nodeToPrefixes_;
+  // Compiled metric vectors of entries in prefixes_, by entry address
   std::unordered_map<
-      thrift::IpPrefix,
-      std::unordered_map<std::string, thrift::PrefixEntry>>
-      prefixes_;
-  std::unordered_map<std::string, std::set<thrift::IpPrefix>> nodeToPrefixes_;
+      thrift::PrefixEntry const*,
+      MetricVectorUtils::CompiledMetricVector>
+      compiledMetricVectors_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV4_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV6_;
 }; // class PrefixState
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/decision/AdaptiveDebounce.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+TEST(AdaptiveDebounceTest, Window) {
+  AdaptiveDebounce debounce(10ms, 1000ms, 0.5);
+  const auto start = AdaptiveDebounce::Clock::now();
+
+  // idle, computed right away
+  EXPECT_EQ(0ms, debounce.reportUpdate(start));
+  debounce.reportCompute(100ms, start + 100ms);
+
+  // updates faster than the computation cycle of 200ms widen the window in
+  // proportion: 100ms gap * 200ms cycle / 150ms interval
+  EXPECT_EQ(133ms, debounce.reportUpdate(start + 150ms));
+  debounce.reportCompute(100ms, start + 400ms);
+
+  // storms are capped by the max window
+  auto now = start + 400ms;
+  for (int i = 0; i < 20; ++i) {
+    now += 1ms;
+    debounce.reportUpdate(now);
+  }
+  EXPECT_EQ(1000ms, debounce.getWindow());
+
+  // idle again once updates and the gap after the last computation are over
+  now += 2s;
+  EXPECT_EQ(0ms, debounce.reportUpdate(now));
+
+  auto counters = debounce.getCounters();
+  EXPECT_EQ(0, counters.at("decision.debounce.window_ms"));
+  EXPECT_EQ(100000, counters.at("decision.debounce.compute_duration_us"));
+  EXPECT_EQ(23, counters.at("decision.debounce.updates"));
+  EXPECT_EQ(2, counters.at("decision.debounce.immediate"));
+  EXPECT_EQ(21, counters.at("decision.debounce.widened"));
+}
+
+TEST(AdaptiveDebounceTest, CheapComputations) {
+  AdaptiveDebounce debounce(10ms, 1000ms, 0.5);
+  const auto start = AdaptiveDebounce::Clock::now();
+
+  EXPECT_EQ(0ms, debounce.reportUpdate(start));
+  debounce.reportCompute(1ms, start + 1ms);
+
+  // updates in quick succession are batched for the min window
+  EXPECT_EQ(10ms, debounce.reportUpdate(start + 5ms));
+  debounce.reportCompute(1ms, start + 16ms);
+
+  // well past the computation cycle of 2ms and the min window
+  EXPECT_EQ(0ms, debounce.reportUpdate(start + 30ms));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
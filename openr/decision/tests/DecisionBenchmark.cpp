@@ -5,44 +5,38 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <thread>
+
 #include <folly/Benchmark.h>
+#include <folly/Conv.h>
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include <folly/Random.h>
+#include <folly/String.h>
 #include <folly/futures/Promise.h>
 #include <folly/init/Init.h>
-#include <memory>
 
 #include <openr/common/Constants.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/Util.h>
 #include <openr/decision/Decision.h>
+#include <openr/fib/Fib.h>
+#include <openr/fib/tests/MockNetlinkFibHandler.h>
+#include <openr/tests/BenchmarkUtils.h>
 #include <openr/tests/OpenrThriftServerWrapper.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
-
-/**
- * Defines a benchmark that allows users to record customized counter during
- * benchmarking and passes a parameter to another one. This is common for
- * benchmarks that need a "problem size" in addition to "number of iterations".
- */
-#define BENCHMARK_COUNTERS_PARAM(name, counters, param) \
-  BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param, param)
-
-/*
- * Like BENCHMARK_COUNTERS_PARAM(), but allows a custom name to be specified for
- * each parameter, rather than using the parameter value.
- */
-#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
-  BENCHMARK_IMPL_COUNTERS(                                             \
-      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
-      FOLLY_PP_STRINGIZE(name) "(" FOLLY_PP_STRINGIZE(param_name) ")", \
-      counters,                                                        \
-      iters,                                                           \
-      unsigned,                                                        \
-      iters) {                                                         \
-    name(counters, iters, ##__VA_ARGS__);                              \
-  }
+#include <thrift/lib/cpp2/server/ThriftServer.h>
+#include <thrift/lib/cpp2/util/ScopedServerThread.h>
 
 using namespace folly;
 namespace {
@@ -54,12 +48,61 @@ const uint8_t kSswMarker = 1;
 const uint8_t kFswMarker = 2;
 const uint8_t kRswMarker = 3;
 
+// Number of nodes announcing the same BGP prefixes in BGP benchmarks
+const int kNumOfBgpAnnouncers = 8;
+// Number of metric entities in metric vectors of BGP prefixes
+const int kNumOfBgpMetrics = 5;
+// Fabric size of the prefix storm pipeline benchmark
+const int kNumOfPrefixStormSws = 1000;
+
+// Number of heap allocations of the whole process so far
+std::atomic<uint64_t> numAllocations{0};
+
 } // namespace
 
+//
+// Count heap allocations to report them along with benchmark times
+//
+void*
+operator new(std::size_t size) {
+  numAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void*
+operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t /* size */) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr, std::size_t /* size */) noexcept {
+  std::free(ptr);
+}
+
 namespace openr {
 
 using apache::thrift::CompactSerializer;
 using apache::thrift::FRAGILE;
+using apache::thrift::ThriftServer;
+using apache::thrift::util::ScopedServerThread;
 
 //
 // Start the decision thread and simulate KvStore communications
@@ -67,7 +110,10 @@ using apache::thrift::FRAGILE;
 //
 class DecisionWrapper {
  public:
-  explicit DecisionWrapper(const std::string& nodeName) {
+  explicit DecisionWrapper(
+      const std::string& nodeName,
+      size_t numRouteBuildThreads = 1,
+      bool enableAsyncCompute = false) {
     decision = std::make_shared<Decision>(
         nodeName, /* node name */
         true, /* enable v4 */
@@ -83,7 +129,9 @@ class DecisionWrapper {
         kvStoreUpdatesQueue.getReader(),
         routeUpdatesQueue,
         MonitorSubmitUrl{"inproc://monitor-rep"},
-        zeromqContext);
+        zeromqContext,
+        numRouteBuildThreads,
+        enableAsyncCompute);
 
     decisionThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Decision thread starting";
@@ -105,11 +153,16 @@ class DecisionWrapper {
   // member methods
   //
 
+  // queue of the route updates, e.g. for Fib to read
+  messaging::ReplicateQueue<RouteUpdate>&
+  getRouteUpdatesQueue() {
+    return routeUpdatesQueue;
+  }
+
   thrift::RouteDatabaseDelta
   recvMyRouteDb() {
     auto maybeRouteDb = routeUpdatesQueueReader.get();
-    auto routeDb = maybeRouteDb.value();
-    return routeDb;
+    return maybeRouteDb.value().toThrift();
   }
 
   // helper function
@@ -143,12 +196,16 @@ class DecisionWrapper {
     for (const auto& prefix : prefixes) {
       prefixEntries.emplace_back(createPrefixEntry(prefix));
     }
+    return createPrefixDbValue(version, createPrefixDb(nodeId, prefixEntries));
+  }
+
+  thrift::Value
+  createPrefixDbValue(int64_t version, const thrift::PrefixDatabase& prefixDb) {
     return thrift::Value(
         FRAGILE,
         version,
         "originator-1",
-        fbzmq::util::writeThriftObjStr(
-            createPrefixDb(nodeId, prefixEntries), serializer),
+        fbzmq::util::writeThriftObjStr(prefixDb, serializer),
         Constants::kTtlInfinity /* ttl */,
         0 /* ttl version */,
         0 /* hash */);
@@ -157,7 +214,8 @@ class DecisionWrapper {
   // publish routeDb
   void
   sendKvPublication(const thrift::Publication& publication) {
-    kvStoreUpdatesQueue.push(publication);
+    kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(publication));
   }
 
  private:
@@ -188,9 +246,9 @@ class DecisionWrapper {
   // ZMQ context for IO processing
   fbzmq::Context zeromqContext{};
 
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
-  messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueueReader{
+  messaging::ReplicateQueue<KvStorePublicationPtr> kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue;
+  messaging::RQueue<RouteUpdate> routeUpdatesQueueReader{
       routeUpdatesQueue.getReader()};
 
   // KvStore owned by this wrapper.
@@ -227,17 +285,67 @@ getNodeName(const uint8_t swMarker, const int podId, const int swId) {
   return folly::sformat("{}-{}-{}", swMarker, podId, swId);
 }
 
+//
+// Measurements of a benchmark, reported per iteration by insertUserCounters()
+//
+struct ChurnStats {
+  //
+  // Customized time counters
+  // processTimes[0] is the time of sending the update from KvStore
+  // (simulated) to Decision, processTimes[1] is the time of debounce, and
+  // processTimes[2] is the time of route computation
+  //
+  std::vector<uint64_t> processTimes{0, 0, 0};
+
+  // time of each route computation phase in us, keyed by phase name
+  std::map<std::string, uint64_t> phaseTimes;
+
+  // process wide allocations when the measurement started
+  const uint64_t startAllocations{numAllocations.load()};
+};
+
 // Accumulate the time extracted from perfevent
 void
-accumulatePerfTimes(
-    const thrift::PerfEvents& perfEvents, std::vector<uint64_t>& processTimes) {
-  // The size of perfEvents.events should = processTimes.size() + 1
-  CHECK_EQ(perfEvents.events.size(), processTimes.size() + 1);
+accumulatePerfTimes(const thrift::PerfEvents& perfEvents, ChurnStats& stats) {
+  // Decision adds an event carrying the duration of each route computation
+  // phase, e.g. "DECISION_PHASE_SPF"
+  std::vector<int64_t> timestamps;
+  for (auto const& event : perfEvents.events) {
+    folly::StringPiece descr(event.eventDescr);
+    if (not descr.removePrefix("DECISION_PHASE_")) {
+      timestamps.emplace_back(event.unixTs);
+      continue;
+    }
+    CHECK(event.durationUs.hasValue());
+    auto phase = descr.str();
+    folly::toLowerAscii(phase);
+    stats.phaseTimes[phase] += event.durationUs.value();
+  }
+
+  // The number of other events should = processTimes.size() + 1
+  CHECK_EQ(timestamps.size(), stats.processTimes.size() + 1);
 
   // Accumulate time into processTimes
-  for (size_t index = 1; index < perfEvents.events.size(); index++) {
-    processTimes[index - 1] +=
-        (perfEvents.events[index].unixTs - perfEvents.events[index - 1].unixTs);
+  for (size_t index = 1; index < timestamps.size(); index++) {
+    stats.processTimes[index - 1] +=
+        (timestamps[index] - timestamps[index - 1]);
+  }
+}
+
+// Send publication to decision, receive routes and record their perf events
+void
+sendRecvPublication(
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    const thrift::Publication& newPub,
+    ChurnStats& stats) {
+  decisionWrapper->sendKvPublication(newPub);
+
+  // Receive route update from Decision
+  auto routes2 = decisionWrapper->recvMyRouteDb();
+
+  // Extract time from perfevent and accumulate processing time
+  if (routes2.perfEvents.hasValue()) {
+    accumulatePerfTimes(routes2.perfEvents.value(), stats);
   }
 }
 
@@ -248,7 +356,7 @@ sendRecvUpdate(
     thrift::Publication& newPub,
     const std::string& nodeName,
     const std::vector<thrift::Adjacency>& adjs,
-    std::vector<uint64_t>& processTimes,
+    ChurnStats& stats,
     bool overloadBit = false) {
   // Add perfevent
   thrift::PerfEvents perfEvents;
@@ -260,15 +368,7 @@ sendRecvUpdate(
           nodeName, 2, adjs, std::move(perfEvents), overloadBit);
 
   LOG(INFO) << "Advertising adj update";
-  decisionWrapper->sendKvPublication(newPub);
-
-  // Receive route update from Decision
-  auto routes2 = decisionWrapper->recvMyRouteDb();
-
-  // Extract time from perfevent and accumulate processing time
-  if (routes2.perfEvents.hasValue()) {
-    accumulatePerfTimes(routes2.perfEvents.value(), processTimes);
-  }
+  sendRecvPublication(decisionWrapper, newPub, stats);
 }
 
 // Add an adjacency to node
@@ -395,10 +495,13 @@ createGridAdjacencys(const int row, const int col, const uint32_t n) {
   return adjs;
 }
 
-// Create a grid topology
+// Create a grid topology, every node announces its loopback prefix along with
+// numOfPrefixesPerNode additional prefixes
 thrift::Publication
 createGrid(
-    const std::shared_ptr<DecisionWrapper>& decisionWrapper, const int n) {
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    const int n,
+    const int numOfPrefixesPerNode = 0) {
   LOG(INFO) << "grid: " << n << " by " << n;
   thrift::Publication initialPub;
 
@@ -414,10 +517,15 @@ createGrid(
           decisionWrapper->createAdjValue(nodeName, 1, adjs, folly::none));
 
       // prefix
-      auto addrV6 = toIpPrefix(nodeToPrefixV6(nodeId));
+      std::vector<thrift::IpPrefix> prefixes{
+          toIpPrefix(nodeToPrefixV6(nodeId))};
+      for (int i = 0; i < numOfPrefixesPerNode; ++i) {
+        prefixes.emplace_back(toIpPrefix(
+            folly::sformat("fc01:{}:{}::/64", toHex(nodeId), toHex(i))));
+      }
       initialPub.keyVals.emplace(
           folly::sformat("prefix:{}", nodeName),
-          decisionWrapper->createPrefixValue(nodeName, 1, {addrV6}));
+          decisionWrapper->createPrefixValue(nodeName, 1, prefixes));
     }
   }
   return initialPub;
@@ -579,6 +687,81 @@ createFabric(
   return initialPub;
 }
 
+//
+// Every rsw announces its loopback prefix with the given forwarding type and
+// algorithm
+//
+void
+createRswsPrefixes(
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    thrift::Publication& initialPub,
+    const int numOfPods,
+    const int numOfRswsPerPod,
+    const thrift::PrefixForwardingType forwardingType,
+    const thrift::PrefixForwardingAlgorithm forwardingAlgorithm) {
+  for (int podId = 0; podId < numOfPods; podId++) {
+    for (int swIdInPod = 0; swIdInPod < numOfRswsPerPod; swIdInPod++) {
+      auto nodeName = getNodeName(kRswMarker, podId, swIdInPod);
+      auto prefix =
+          toIpPrefix(nodeToPrefixV6(getId(kRswMarker, podId, swIdInPod)));
+      initialPub.keyVals.emplace(
+          folly::sformat("prefix:{}", nodeName),
+          decisionWrapper->createPrefixDbValue(
+              1,
+              createPrefixDb(
+                  nodeName,
+                  {createPrefixEntry(
+                      prefix,
+                      thrift::PrefixType::LOOPBACK,
+                      "",
+                      forwardingType,
+                      forwardingAlgorithm)})));
+    }
+  }
+}
+
+//
+// The first kNumOfBgpAnnouncers rsws of pod 0 announce the same BGP prefixes.
+// Their metric vectors only differ in the last metric, hence best announcer
+// selection has to compare all of them.
+//
+void
+createBgpPrefixes(
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    thrift::Publication& initialPub,
+    const int numOfPrefixes) {
+  for (int announcer = 0; announcer < kNumOfBgpAnnouncers; announcer++) {
+    auto nodeName = getNodeName(kRswMarker, 0, announcer);
+    thrift::MetricVector mv;
+    for (int i = 0; i < kNumOfBgpMetrics; i++) {
+      const bool isLast = (i + 1 == kNumOfBgpMetrics);
+      mv.metrics.emplace_back(createMetricEntity(
+          i /* type */,
+          kNumOfBgpMetrics - i /* priority */,
+          thrift::CompareType::WIN_IF_PRESENT,
+          false /* isBestPathTieBreaker */,
+          {isLast ? announcer : 0}));
+    }
+
+    std::vector<thrift::PrefixEntry> prefixEntries;
+    for (int i = 0; i < numOfPrefixes; i++) {
+      prefixEntries.emplace_back(createPrefixEntry(
+          toIpPrefix(folly::sformat(
+              "fd00:{}:{}::/64", toHex(i >> 16), toHex(i & 0xffff))),
+          thrift::PrefixType::BGP,
+          nodeName /* data */,
+          thrift::PrefixForwardingType::IP,
+          thrift::PrefixForwardingAlgorithm::SP_ECMP,
+          false /* ephemeral */,
+          mv));
+    }
+    initialPub.keyVals.emplace(
+        folly::sformat("prefix:{}", nodeName),
+        decisionWrapper->createPrefixDbValue(
+            1, createPrefixDb(nodeName, prefixEntries)));
+  }
+}
+
 //
 // Randomly choose one rsw from a random pod,
 // toggle it's overload bit in AdjacencyDb
@@ -590,7 +773,7 @@ updateRandomFabricAdjs(
     const int numOfPods,
     const int numOfFswsPerPod,
     const int numOfRswsPerPod,
-    std::vector<uint64_t>& processTimes) {
+    ChurnStats& stats) {
   thrift::Publication newPub;
 
   // Choose a random pod
@@ -623,19 +806,29 @@ updateRandomFabricAdjs(
 
   // Send the update to decision and receive the routes
   sendRecvUpdate(
-      decisionWrapper, newPub, rwsNodeName, adjsRsw, processTimes, overloadBit);
+      decisionWrapper, newPub, rwsNodeName, adjsRsw, stats, overloadBit);
 }
 
+// Kinds of adjacency churn applied to a grid topology
+enum class GridUpdate {
+  // toggle the overload bit of a node
+  NODE_OVERLOAD,
+  // take down and restore one adjacency of a node
+  LINK_FLAP,
+  // change the metric of one adjacency of a node and restore it
+  METRIC_CHANGE,
+};
+
 //
-// Choose a random nodeId for update or revert the last updated nodeId:
-// toggle it's overload bit in AdjacencyDb
+// Choose a random nodeId for update or revert the last updated nodeId
 //
 void
 updateRandomGridAdjs(
     const std::shared_ptr<DecisionWrapper>& decisionWrapper,
     folly::Optional<std::pair<int, int>>& selectedNode,
     const int n,
-    std::vector<uint64_t>& processTimes) {
+    const GridUpdate update,
+    ChurnStats& stats) {
   thrift::Publication newPub;
 
   // If there has been an update, revert the update,
@@ -647,41 +840,109 @@ updateRandomGridAdjs(
 
   auto nodeName = folly::sformat("{}", row * n + col);
   auto adjs = createGridAdjacencys(row, col, n);
-  auto overloadBit = selectedNode.hasValue() ? false : true;
+  const bool isRevert = selectedNode.hasValue();
+  bool overloadBit = false;
+  if (not isRevert) {
+    switch (update) {
+    case GridUpdate::NODE_OVERLOAD:
+      overloadBit = true;
+      break;
+    case GridUpdate::LINK_FLAP:
+      adjs.erase(adjs.begin());
+      break;
+    case GridUpdate::METRIC_CHANGE:
+      adjs.front().metric += 10;
+      break;
+    }
+  }
   // Record the updated nodeId
-  selectedNode = selectedNode.hasValue()
+  selectedNode = isRevert
       ? folly::none
       : folly::Optional<std::pair<int, int>>(std::make_pair(row, col));
 
   // Send the update to decision and receive the routes
-  sendRecvUpdate(
-      decisionWrapper, newPub, nodeName, adjs, processTimes, overloadBit);
+  sendRecvUpdate(decisionWrapper, newPub, nodeName, adjs, stats, overloadBit);
 }
 
 //
-// Get average processTimes and insert as user counters.
+// Choose a random node to announce an additional prefix with a per prefix key
+// or withdraw the one announced by the last update
+//
+void
+updateRandomGridPrefix(
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    folly::Optional<int>& selectedNode,
+    const int numOfNodes,
+    ChurnStats& stats) {
+  const int nodeId = selectedNode.hasValue()
+      ? selectedNode.value()
+      : folly::Random::rand32() % numOfNodes;
+  auto nodeName = folly::sformat("{}", nodeId);
+  auto prefix = toIpPrefix(folly::sformat("fc02:{}::/64", toHex(nodeId)));
+
+  auto prefixDb = createPrefixDb(nodeName, {createPrefixEntry(prefix)});
+  prefixDb.deletePrefix = selectedNode.hasValue();
+  thrift::PerfEvents perfEvents;
+  addPerfEvent(perfEvents, nodeName, "DECISION_INIT_UPDATE");
+  prefixDb.perfEvents = std::move(perfEvents);
+
+  const auto prefixKey =
+      PrefixKey(nodeName, folly::IPAddress::createNetwork(toString(prefix)));
+  thrift::Publication newPub;
+  newPub.keyVals.emplace(
+      prefixKey.getPrefixKey(),
+      decisionWrapper->createPrefixDbValue(2, prefixDb));
+
+  // Record the updated nodeId
+  selectedNode =
+      selectedNode.hasValue() ? folly::none : folly::Optional<int>(nodeId);
+
+  LOG(INFO) << "Advertising prefix update";
+  sendRecvPublication(decisionWrapper, newPub, stats);
+}
+
+//
+// Insert averages of stats per iteration as user counters: processing times,
+// the time of each route computation phase (e.g. "spf_us"), heap allocations
+// of the whole process and its peak RSS. As benchmarks run in the same
+// process, peak RSS is only meaningful for the largest benchmark run, use
+// --bm_regex to run them individually.
 //
 void
 insertUserCounters(
-    folly::UserCounters& counters,
-    uint32_t iters,
-    std::vector<uint64_t>& processTimes) {
+    folly::UserCounters& counters, uint32_t iters, ChurnStats& stats) {
+  const uint64_t numOfIters = iters == 0 ? 1 : iters;
+  const auto numOfAllocations =
+      numAllocations.load() - stats.startAllocations;
+
   // Get average time of each itaration
+  auto& processTimes = stats.processTimes;
   for (auto& processTime : processTimes) {
-    processTime /= iters == 0 ? 1 : iters;
+    processTime /= numOfIters;
   }
 
   // Add customized counters to state.
   counters["adj_receive"] = processTimes[0];
   counters["spf"] = processTimes[2];
+  for (auto const& kv : stats.phaseTimes) {
+    counters[kv.first + "_us"] = kv.second / numOfIters;
+  }
+  counters["allocs"] = numOfAllocations / numOfIters;
+
+  struct rusage usage;
+  CHECK_EQ(0, getrusage(RUSAGE_SELF, &usage));
+  counters["peak_rss_kb"] = usage.ru_maxrss;
 }
 
 //
-// Benchmark test for grid topology
+// Benchmark test for grid topology with the given kind of churn
 //
 static void
-BM_DecisionGrid(
-    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+runGridChurn(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    GridUpdate update) {
   auto suspender = folly::BenchmarkSuspender();
   const std::string nodeName{"1"};
   auto decisionWrapper = std::make_shared<DecisionWrapper>(nodeName);
@@ -699,31 +960,89 @@ BM_DecisionGrid(
 
   // Record the updated nodeId
   folly::Optional<std::pair<int, int>> selectedNode = folly::none;
-  //
-  // Customized time counter
-  // processTimes[0] is the time of sending adjDB from Kvstore (simulated) to
-  // Decision, processTimes[1] is the time of debounce, and processTimes[2] is
-  // the time of spf solver
-  //
-  std::vector<uint64_t> processTimes{0, 0, 0};
+  ChurnStats stats;
   suspender.dismiss(); // Start measuring benchmark time
 
   for (uint32_t i = 0; i < iters; i++) {
     // Advertise adj update. This should trigger the SPF run.
-    updateRandomGridAdjs(decisionWrapper, selectedNode, n, processTimes);
+    updateRandomGridAdjs(decisionWrapper, selectedNode, n, update, stats);
   }
 
   suspender.rehire(); // Stop measuring time again
   // Insert processTimes as user counters
-  insertUserCounters(counters, iters, processTimes);
+  insertUserCounters(counters, iters, stats);
 }
 
+static void
+BM_DecisionGrid(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  runGridChurn(counters, iters, numOfSws, GridUpdate::NODE_OVERLOAD);
+}
+
+static void
+BM_DecisionGridLinkFlap(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  runGridChurn(counters, iters, numOfSws, GridUpdate::LINK_FLAP);
+}
+
+static void
+BM_DecisionGridMetricChange(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  runGridChurn(counters, iters, numOfSws, GridUpdate::METRIC_CHANGE);
+}
+
+//
+// Benchmark test for prefix updates on a 10 by 10 grid topology announcing
+// numOfPrefixes prefixes in total
+//
+static void
+BM_DecisionPrefixChurn(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPrefixes,
+    size_t numRouteBuildThreads) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string nodeName{"1"};
+  auto decisionWrapper =
+      std::make_shared<DecisionWrapper>(nodeName, numRouteBuildThreads);
+  const int n = 10;
+  auto initialPub = createGrid(decisionWrapper, n, numOfPrefixes / (n * n));
+
+  decisionWrapper->sendKvPublication(initialPub);
+  decisionWrapper->recvMyRouteDb();
+
+  folly::Optional<int> selectedNode = folly::none;
+  ChurnStats stats;
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; i++) {
+    // Advertise prefix update. This should only rebuild routes for it.
+    updateRandomGridPrefix(decisionWrapper, selectedNode, n * n, stats);
+  }
+
+  suspender.rehire(); // Stop measuring time again
+  insertUserCounters(counters, iters, stats);
+}
+
+// Prefixes announced by the fabric in addition to its topology
+enum class FabricPrefixes {
+  NONE,
+  // rsw loopbacks using KSP2_ED_ECMP
+  KSP2,
+  // BGP prefixes with metric vectors, see createBgpPrefixes()
+  BGP,
+};
+
 //
 // Benchmark test for fabric topology.
 //
 static void
-BM_DecisionFabric(
-    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+runFabricChurn(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    FabricPrefixes fabricPrefixes,
+    int numOfBgpPrefixes = 0) {
   auto suspender = folly::BenchmarkSuspender();
   const std::string nodeName = folly::sformat("{}-{}", kFswMarker, "0-0");
   auto decisionWrapper = std::make_shared<DecisionWrapper>(nodeName);
@@ -748,6 +1067,22 @@ BM_DecisionFabric(
       numOfSswsPerPlane,
       numOfFswsPerPod,
       numOfRswsPerPod);
+  switch (fabricPrefixes) {
+  case FabricPrefixes::NONE:
+    break;
+  case FabricPrefixes::KSP2:
+    createRswsPrefixes(
+        decisionWrapper,
+        initialPub,
+        numOfPods,
+        numOfRswsPerPod,
+        thrift::PrefixForwardingType::SR_MPLS,
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP);
+    break;
+  case FabricPrefixes::BGP:
+    createBgpPrefixes(decisionWrapper, initialPub, numOfBgpPrefixes);
+    break;
+  }
 
   //
   // Publish initial link state info to KvStore, This should trigger the
@@ -760,14 +1095,7 @@ BM_DecisionFabric(
 
   // Record the updated node
   folly::Optional<std::pair<int, int>> selectedNode = folly::none;
-
-  //
-  // Customized time counters
-  // processTimes[0] is the time of sending adjDB from Kvstore (simulated) to
-  // Decision, processTimes[1] is the time of debounce, and processTimes[2] is
-  // the time of spf solver
-  //
-  std::vector<uint64_t> processTimes{0, 0, 0};
+  ChurnStats stats;
   suspender.dismiss(); // Start measuring benchmark time
 
   for (uint32_t i = 0; i < iters; i++) {
@@ -778,12 +1106,321 @@ BM_DecisionFabric(
         numOfPods,
         numOfFswsPerPod,
         numOfRswsPerPod,
-        processTimes);
+        stats);
   }
 
   suspender.rehire(); // Stop measuring time again
   // Insert processTimes as user counters
-  insertUserCounters(counters, iters, processTimes);
+  insertUserCounters(counters, iters, stats);
+}
+
+static void
+BM_DecisionFabric(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  runFabricChurn(counters, iters, numOfSws, FabricPrefixes::NONE);
+}
+
+static void
+BM_DecisionFabricKsp2(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  runFabricChurn(counters, iters, numOfSws, FabricPrefixes::KSP2);
+}
+
+// The minimum fabric of 344 switches, see BM_DecisionFabric
+static void
+BM_DecisionFabricBgp(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfPrefixes) {
+  runFabricChurn(counters, iters, 344, FabricPrefixes::BGP, numOfPrefixes);
+}
+
+//
+// Decision to Fib pipeline: publications go into Decision, whose route
+// updates cross its routeUpdatesQueue into Fib, which programs them into a
+// mock FibService taking programmingLatency per call
+//
+class PipelineWrapper {
+ public:
+  PipelineWrapper(
+      const std::string& nodeName,
+      std::chrono::microseconds programmingLatency)
+      : decisionWrapper(std::make_shared<DecisionWrapper>(nodeName)) {
+    folly::SingletonVault::singleton()->registrationComplete();
+    mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
+    mockFibHandler->setProgrammingLatency(programmingLatency);
+
+    server = std::make_shared<ThriftServer>();
+    server->setNumIOWorkerThreads(1);
+    server->setNumAcceptThreads(1);
+    server->setPort(0);
+    server->setInterface(mockFibHandler);
+    fibThriftThread.start(server);
+
+    // Fib syncs its routes as soon as the first ones come from Decision
+    fib = std::make_shared<Fib>(
+        nodeName,
+        fibThriftThread.getAddress()->getPort(),
+        false, // dryrun
+        false, // segment route
+        false, // orderedFib
+        std::chrono::seconds(0), // coldStartDuration
+        true, // waitOnDecision
+        decisionWrapper->getRouteUpdatesQueue().getReader(),
+        interfaceUpdatesQueue.getReader(),
+        MonitorSubmitUrl{"inproc://monitor-rep"},
+        KvStoreLocalCmdUrl{"inproc://kvstore-cmd"},
+        KvStoreLocalPubUrl{"inproc://kvstore-sub"},
+        zeromqContext);
+
+    fibThread = std::make_unique<std::thread>([this]() {
+      LOG(INFO) << "Fib thread starting";
+      fib->run();
+      LOG(INFO) << "Fib thread finishing";
+    });
+    fib->waitUntilRunning();
+  }
+
+  ~PipelineWrapper() {
+    decisionWrapper->getRouteUpdatesQueue().close();
+    interfaceUpdatesQueue.close();
+    fib->stop();
+    fibThread->join();
+    mockFibHandler->stop();
+    fibThriftThread.stop();
+  }
+
+  //
+  // Send publication to Decision and block until the unicast routes it
+  // changes are programmed. Returns the end to end latency
+  //
+  std::chrono::microseconds
+  sendRecvPublication(const thrift::Publication& publication) {
+    const auto numOfSyncs = mockFibHandler->getFibSyncCount();
+    const auto numOfAdded = mockFibHandler->getAddRoutesCount();
+    const auto numOfDeleted = mockFibHandler->getDelRoutesCount();
+    const auto startTime = std::chrono::steady_clock::now();
+
+    decisionWrapper->sendKvPublication(publication);
+    // a copy of the route update Fib receives
+    const auto routeDbDelta = decisionWrapper->recvMyRouteDb();
+
+    // the first update is synced as a whole
+    while (numOfSyncs == 0 and mockFibHandler->getFibSyncCount() == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    while (numOfSyncs > 0 and
+           (mockFibHandler->getAddRoutesCount() <
+                numOfAdded + routeDbDelta.unicastRoutesToUpdate.size() or
+            mockFibHandler->getDelRoutesCount() <
+                numOfDeleted + routeDbDelta.unicastRoutesToDelete.size())) {
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime);
+  }
+
+  std::shared_ptr<DecisionWrapper> decisionWrapper;
+
+ private:
+  std::shared_ptr<MockNetlinkFibHandler> mockFibHandler;
+  std::shared_ptr<ThriftServer> server;
+  ScopedServerThread fibThriftThread;
+
+  fbzmq::Context zeromqContext{};
+  messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
+
+  std::shared_ptr<Fib> fib;
+  std::unique_ptr<std::thread> fibThread;
+};
+
+// Insert percentiles of latencies as user counters, e.g. "e2e_p99_us"
+void
+insertLatencyCounters(
+    folly::UserCounters& counters,
+    const std::string& name,
+    const std::vector<std::chrono::microseconds>& latencies) {
+  LatencyHistogram histogram;
+  for (auto latency : latencies) {
+    histogram.addValue(latency.count());
+  }
+  counters[name + "_p50_us"] = histogram.getPercentile(0.5);
+  counters[name + "_p99_us"] = histogram.getPercentile(0.99);
+  counters[name + "_p999_us"] = histogram.getPercentile(0.999);
+}
+
+//
+// Fabric of numOfSws switches, as of runFabricChurn(), whose rsws announce
+// their loopbacks. Sets numOfPods to its number of pods
+//
+thrift::Publication
+createPipelineFabric(
+    const std::shared_ptr<DecisionWrapper>& decisionWrapper,
+    const int numOfSws,
+    int& numOfPods) {
+  const int numOfSsws = kNumOfFswsPerPod * kNumOfSswsPerPlane;
+  CHECK_LE(numOfSsws + kNumOfFswsPerPod + kNumOfRswsPerPod, numOfSws);
+  numOfPods = (numOfSws - numOfSsws) / (kNumOfFswsPerPod + kNumOfRswsPerPod);
+
+  auto initialPub = createFabric(
+      decisionWrapper,
+      numOfPods,
+      kNumOfSswsPerPlane,
+      kNumOfFswsPerPod,
+      kNumOfRswsPerPod);
+  createRswsPrefixes(
+      decisionWrapper,
+      initialPub,
+      numOfPods,
+      kNumOfRswsPerPod,
+      thrift::PrefixForwardingType::IP,
+      thrift::PrefixForwardingAlgorithm::SP_ECMP);
+  return initialPub;
+}
+
+// Name of the local node of pipeline benchmarks, a fsw of pod 0
+std::string
+getPipelineNodeName() {
+  return getNodeName(kFswMarker, 0, 0);
+}
+
+//
+// Benchmark for end to end latency of link flaps: a random rsw loses its
+// link to the first fsw of its pod and the next iteration restores it
+//
+static void
+BM_PipelineLinkFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    uint32_t programmingLatencyMs) {
+  auto suspender = folly::BenchmarkSuspender();
+  PipelineWrapper pipeline(
+      getPipelineNodeName(), std::chrono::milliseconds(programmingLatencyMs));
+  auto& decisionWrapper = pipeline.decisionWrapper;
+  int numOfPods{0};
+  pipeline.sendRecvPublication(
+      createPipelineFabric(decisionWrapper, numOfSws, numOfPods));
+
+  folly::Optional<std::pair<int, int>> selectedNode = folly::none;
+  std::vector<std::chrono::microseconds> latencies;
+  for (uint32_t i = 0; i < iters; i++) {
+    const bool isRevert = selectedNode.hasValue();
+    if (not isRevert) {
+      const int podId = folly::Random::rand32() % numOfPods;
+      const int swId = folly::Random::rand32() % kNumOfRswsPerPod;
+      selectedNode = std::make_pair(podId, swId);
+    }
+    const int podId = selectedNode->first;
+    const auto nodeName = getNodeName(kRswMarker, podId, selectedNode->second);
+    std::vector<thrift::Adjacency> adjs;
+    for (int otherId = isRevert ? 0 : 1; otherId < kNumOfFswsPerPod;
+         otherId++) {
+      createFabricAdjacency(nodeName, kFswMarker, podId, otherId, adjs);
+    }
+    if (isRevert) {
+      selectedNode = folly::none;
+    }
+
+    thrift::Publication newPub;
+    newPub.keyVals.emplace(
+        folly::sformat("adj:{}", nodeName),
+        decisionWrapper->createAdjValue(nodeName, 2, adjs, folly::none));
+
+    suspender.dismiss();
+    latencies.emplace_back(pipeline.sendRecvPublication(newPub));
+    suspender.rehire();
+  }
+
+  insertLatencyCounters(counters, "e2e", latencies);
+}
+
+//
+// Benchmark for end to end latency of prefix storms: a random rsw announces
+// numOfPrefixes prefixes along with its loopback and the next iteration
+// withdraws them
+//
+static void
+BM_PipelinePrefixStorm(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPrefixes,
+    uint32_t programmingLatencyMs) {
+  auto suspender = folly::BenchmarkSuspender();
+  PipelineWrapper pipeline(
+      getPipelineNodeName(), std::chrono::milliseconds(programmingLatencyMs));
+  auto& decisionWrapper = pipeline.decisionWrapper;
+  int numOfPods{0};
+  pipeline.sendRecvPublication(
+      createPipelineFabric(decisionWrapper, kNumOfPrefixStormSws, numOfPods));
+
+  folly::Optional<std::pair<int, int>> selectedNode = folly::none;
+  std::vector<std::chrono::microseconds> latencies;
+  for (uint32_t i = 0; i < iters; i++) {
+    const bool isRevert = selectedNode.hasValue();
+    if (not isRevert) {
+      const int podId = folly::Random::rand32() % numOfPods;
+      const int swId = folly::Random::rand32() % kNumOfRswsPerPod;
+      selectedNode = std::make_pair(podId, swId);
+    }
+    const int podId = selectedNode->first;
+    const int swId = selectedNode->second;
+    const auto nodeName = getNodeName(kRswMarker, podId, swId);
+    std::vector<thrift::PrefixEntry> prefixEntries{createPrefixEntry(
+        toIpPrefix(nodeToPrefixV6(getId(kRswMarker, podId, swId))),
+        thrift::PrefixType::LOOPBACK,
+        "",
+        thrift::PrefixForwardingType::IP,
+        thrift::PrefixForwardingAlgorithm::SP_ECMP)};
+    for (uint32_t prefixId = 0; not isRevert and prefixId < numOfPrefixes;
+         prefixId++) {
+      prefixEntries.emplace_back(createPrefixEntry(toIpPrefix(folly::sformat(
+          "fd01:{}:{}::/64",
+          toHex(prefixId >> 16),
+          toHex(prefixId & 0xffff)))));
+    }
+    if (isRevert) {
+      selectedNode = folly::none;
+    }
+
+    thrift::Publication newPub;
+    newPub.keyVals.emplace(
+        folly::sformat("prefix:{}", nodeName),
+        decisionWrapper->createPrefixDbValue(
+            2, createPrefixDb(nodeName, prefixEntries)));
+
+    suspender.dismiss();
+    latencies.emplace_back(pipeline.sendRecvPublication(newPub));
+    suspender.rehire();
+  }
+
+  insertLatencyCounters(counters, "e2e", latencies);
+}
+
+//
+// Benchmark for end to end latency of cold starts: a new pipeline receives
+// the whole fabric and syncs its routes
+//
+static void
+BM_PipelineColdStart(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    uint32_t programmingLatencyMs) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::chrono::microseconds> latencies;
+  for (uint32_t i = 0; i < iters; i++) {
+    PipelineWrapper pipeline(
+        getPipelineNodeName(),
+        std::chrono::milliseconds(programmingLatencyMs));
+    int numOfPods{0};
+    auto initialPub =
+        createPipelineFabric(pipeline.decisionWrapper, numOfSws, numOfPods);
+
+    suspender.dismiss();
+    latencies.emplace_back(pipeline.sendRecvPublication(initialPub));
+    suspender.rehire();
+  }
+
+  insertLatencyCounters(counters, "e2e", latencies);
 }
 
 // The integer parameter is the number of nodes in grid topology
@@ -791,6 +1428,23 @@ BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 100);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridLinkFlap, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridLinkFlap, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridLinkFlap, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridMetricChange, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridMetricChange, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionGridMetricChange, counters, 10000);
+
+// The parameters are the total number of prefixes and the number of route
+// build threads
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionPrefixChurn, counters, 10000_threads_1, 10000, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionPrefixChurn, counters, 100000_threads_1, 100000, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionPrefixChurn, counters, 100000_threads_4, 100000, 4);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionPrefixChurn, counters, 200000_threads_4, 200000, 4);
 
 // The integer parameter is numOfGivenNodes in topology,
 // which >= numOfActualNodesInTopo.
@@ -801,6 +1455,33 @@ BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 344);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 5000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionFabricKsp2, counters, 344);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionFabricKsp2, counters, 1000);
+
+// The integer parameter is the number of BGP prefixes, each announced by
+// kNumOfBgpAnnouncers nodes
+BENCHMARK_COUNTERS_PARAM(BM_DecisionFabricBgp, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_DecisionFabricBgp, counters, 10000);
+
+// The parameters are the number of switches of the fabric, as of
+// BM_DecisionFabric, and the latency of the FibService in ms
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelineLinkFlap, counters, 1000_latency_0ms, 1000, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelineLinkFlap, counters, 1000_latency_10ms, 1000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelineLinkFlap, counters, 5000_latency_10ms, 5000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelineColdStart, counters, 1000_latency_10ms, 1000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelineColdStart, counters, 5000_latency_10ms, 5000, 10);
+
+// The parameters are the number of prefixes of the storm, on a fabric of
+// kNumOfPrefixStormSws switches, and the latency of the FibService in ms
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelinePrefixStorm, counters, 1000_latency_10ms, 1000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PipelinePrefixStorm, counters, 10000_latency_10ms, 10000, 10);
 
 } // namespace openr
 
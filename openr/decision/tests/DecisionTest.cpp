@@ -5,8 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstdio>
 #include <memory>
+#include <thread>
 
+#include <folly/Format.h>
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
@@ -404,6 +407,468 @@ TEST(SpfSolver, Counters) {
   EXPECT_EQ(spfSolver.getCounters().at("decision.num_partial_adjacencies"), 0);
 }
 
+//
+// Verify that incremental SPF runs after single link metric and state changes
+// produce the same routes as a solver which computes them from scratch
+//
+TEST(SpfSolver, IncrementalSpf) {
+  // normalize route db for comparison irrespective of ordering
+  auto normalize = [](thrift::RouteDatabase routeDb) {
+    for (auto& route : routeDb.unicastRoutes) {
+      std::sort(route.nextHops.begin(), route.nextHops.end());
+    }
+    for (auto& route : routeDb.mplsRoutes) {
+      std::sort(route.nextHops.begin(), route.nextHops.end());
+    }
+    std::sort(routeDb.unicastRoutes.begin(), routeDb.unicastRoutes.end());
+    std::sort(routeDb.mplsRoutes.begin(), routeDb.mplsRoutes.end());
+    return routeDb;
+  };
+
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::unordered_map<std::string, thrift::AdjacencyDatabase> adjDbs = {
+      {"1", createAdjDb("1", {adj12, adj13}, 1)},
+      {"2", createAdjDb("2", {adj21, adj24}, 2)},
+      {"3", createAdjDb("3", {adj31, adj34}, 3)},
+      {"4", createAdjDb("4", {adj42, adj43}, 4)},
+  };
+  const std::vector<thrift::PrefixDatabase> prefixDbs = {
+      prefixDb1, prefixDb2, prefixDb3, prefixDb4};
+
+  SpfSolver spfSolver("1", false /* disable v4 */, true /* enable LFA */);
+  for (auto const& kv : adjDbs) {
+    spfSolver.updateAdjacencyDatabase(kv.second);
+  }
+  for (auto const& prefixDb : prefixDbs) {
+    spfSolver.updatePrefixDatabase(prefixDb);
+  }
+  ASSERT_TRUE(spfSolver.buildPaths("1").hasValue());
+
+  auto verifyAgainstFullSpf = [&]() {
+    SpfSolver fullSolver("1", false /* disable v4 */, true /* enable LFA */);
+    for (auto const& kv : adjDbs) {
+      fullSolver.updateAdjacencyDatabase(kv.second);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      fullSolver.updatePrefixDatabase(prefixDb);
+    }
+    auto routeDb = spfSolver.buildPaths("1");
+    auto expectedRouteDb = fullSolver.buildPaths("1");
+    ASSERT_TRUE(routeDb.hasValue());
+    ASSERT_TRUE(expectedRouteDb.hasValue());
+    EXPECT_EQ(normalize(*expectedRouteDb), normalize(*routeDb));
+  };
+
+  // increase metric of a remote link on the shortest path tree
+  adjDbs["2"].adjacencies[1].metric = 100;
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjDbs["2"]).first);
+  verifyAgainstFullSpf();
+
+  // decrease it back
+  adjDbs["2"].adjacencies[1].metric = 5;
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjDbs["2"]).first);
+  verifyAgainstFullSpf();
+
+  // overload a remote node
+  adjDbs["4"].isOverloaded = true;
+  spfSolver.updateAdjacencyDatabase(adjDbs["4"]);
+  verifyAgainstFullSpf();
+
+  // remote link down
+  adjDbs["3"] = createAdjDb("3", {adj31}, 3);
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjDbs["3"]).first);
+  verifyAgainstFullSpf();
+
+  const auto counters = spfSolver.getCounters();
+  EXPECT_LT(0, counters.at("decision.spf_incremental_runs.count.0"));
+  EXPECT_LT(0, counters.at("decision.spf_full_runs.count.0"));
+}
+
+//
+// Verify that SPF results are shared across runs on the same topology and
+// recomputed once it changes
+//
+TEST(SpfSolver, SpfResultCache) {
+  SpfSolver spfSolver("1", false /* disable v4 */, true /* enable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34}, 3));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+  for (auto const& prefixDb : {prefixDb1, prefixDb2, prefixDb3, prefixDb4}) {
+    EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb));
+  }
+
+  // SPF from node-1 and both of its neighbors for LFA
+  const auto routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters.at("decision.spf_runs.count.0"));
+  EXPECT_EQ(3, counters.at("decision.spf_cache_misses.count.0"));
+  EXPECT_EQ(0, counters.at("decision.spf_cache_hits.count.0"));
+
+  // same topology, all results come from the cache
+  EXPECT_EQ(routeDb, spfSolver.buildPaths("1"));
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters.at("decision.spf_runs.count.0"));
+  EXPECT_EQ(3, counters.at("decision.spf_cache_hits.count.0"));
+
+  // topology change invalidates cached results
+  auto adj24Updated = adj24;
+  adj24Updated.metric = 100;
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24Updated}, 2));
+  EXPECT_TRUE(spfSolver.buildPaths("1").hasValue());
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(6, counters.at("decision.spf_runs.count.0"));
+  EXPECT_EQ(6, counters.at("decision.spf_cache_misses.count.0"));
+  EXPECT_EQ(3, counters.at("decision.spf_cache_hits.count.0"));
+}
+
+//
+// Verify that MPLS routes are only recreated for nodes whose distance or next
+// hops changed, and entirely once links of this node change
+//
+TEST(SpfSolver, IncrementalMplsRoutes) {
+  // normalize route db for comparison irrespective of ordering
+  auto normalize = [](thrift::RouteDatabase routeDb) {
+    for (auto& route : routeDb.mplsRoutes) {
+      std::sort(route.nextHops.begin(), route.nextHops.end());
+    }
+    std::sort(routeDb.mplsRoutes.begin(), routeDb.mplsRoutes.end());
+    return routeDb;
+  };
+
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::unordered_map<std::string, thrift::AdjacencyDatabase> adjDbs{
+      {"1", createAdjDb("1", {adj12, adj13}, 1)},
+      {"2", createAdjDb("2", {adj21, adj24}, 2)},
+      {"3", createAdjDb("3", {adj31, adj34}, 3)},
+      {"4", createAdjDb("4", {adj42, adj43}, 4)},
+  };
+  SpfSolver spfSolver("1", false /* disable v4 */, false /* disable LFA */);
+  for (auto const& kv : adjDbs) {
+    spfSolver.updateAdjacencyDatabase(kv.second);
+  }
+
+  auto verifyAgainstFullBuild = [&]() {
+    SpfSolver fullSolver("1", false /* disable v4 */, false /* disable LFA */);
+    for (auto const& kv : adjDbs) {
+      fullSolver.updateAdjacencyDatabase(kv.second);
+    }
+    auto routeDb = spfSolver.buildPaths("1");
+    auto expectedRouteDb = fullSolver.buildPaths("1");
+    ASSERT_TRUE(routeDb.hasValue());
+    ASSERT_TRUE(expectedRouteDb.hasValue());
+    EXPECT_EQ(normalize(*expectedRouteDb), normalize(*routeDb));
+  };
+  verifyAgainstFullBuild();
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(0, counters.at("decision.reused_node_label_routes.count.0"));
+
+  // only the next hops towards node-4 change
+  adjDbs["2"].adjacencies[1].metric = 100;
+  spfSolver.updateAdjacencyDatabase(adjDbs["2"]);
+  verifyAgainstFullBuild();
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters.at("decision.reused_node_label_routes.count.0"));
+
+  // change of a link of node-1 affects all routes
+  adjDbs["1"].adjacencies[0].metric = 20;
+  spfSolver.updateAdjacencyDatabase(adjDbs["1"]);
+  verifyAgainstFullBuild();
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters.at("decision.reused_node_label_routes.count.0"));
+}
+
+//
+// Verify that routes created on multiple threads are identical to the ones
+// created serially
+//
+TEST(SpfSolver, ParallelRouteBuild) {
+  const size_t numPrefixes = 2 * Constants::kParallelRouteBuildMinPrefixes;
+  std::vector<thrift::PrefixDatabase> prefixDbs;
+  for (auto const& nodeName : {"2", "3", "4"}) {
+    prefixDbs.emplace_back(createPrefixDb(nodeName, {}));
+  }
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    // every prefix is advertised by one or two nodes
+    auto entry = createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{}::/64", i)),
+        thrift::PrefixType::DEFAULT);
+    prefixDbs.at(i % 3).prefixEntries.emplace_back(entry);
+    if (i % 2) {
+      prefixDbs.at((i + 1) % 3).prefixEntries.emplace_back(entry);
+    }
+  }
+
+  auto buildRouteDb = [&](size_t numRouteBuildThreads) {
+    SpfSolver spfSolver(
+        "1",
+        false /* enableV4 */,
+        true /* computeLfaPaths */,
+        false /* enableOrderedFib */,
+        false /* bgpDryRun */,
+        false /* bgpUseIgpMetric */,
+        numRouteBuildThreads);
+    spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+    spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2));
+    spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34}, 3));
+    spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver.updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver.buildPaths("1");
+  };
+
+  const auto serialRouteDb = buildRouteDb(1);
+  const auto parallelRouteDb = buildRouteDb(4);
+  ASSERT_TRUE(serialRouteDb.hasValue());
+  ASSERT_TRUE(parallelRouteDb.hasValue());
+  EXPECT_EQ(numPrefixes, serialRouteDb->unicastRoutes.size());
+  EXPECT_EQ(*serialRouteDb, *parallelRouteDb);
+}
+
+//
+// Verify that prefixes announced by the same nodes share their next hops,
+// computed once per route build
+//
+TEST(SpfSolver, NextHopGroups) {
+  const size_t numPrefixes = 10;
+  auto prefixDb23 = createPrefixDb("2", {});
+  auto prefixDb3 = createPrefixDb("3", {});
+  auto prefixDb4 = createPrefixDb("4", {});
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    // anycast prefixes of node-2 and node-3, and prefixes of node-4 only
+    auto entry = createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{}::/64", i)),
+        thrift::PrefixType::DEFAULT);
+    prefixDb23.prefixEntries.emplace_back(entry);
+    prefixDb3.prefixEntries.emplace_back(entry);
+    prefixDb4.prefixEntries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc01:{}::/64", i)),
+        thrift::PrefixType::DEFAULT));
+  }
+
+  SpfSolver spfSolver("1", false /* disable v4 */, false /* disable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34}, 3));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+  for (auto const& prefixDb : {prefixDb23, prefixDb3, prefixDb4}) {
+    EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb));
+  }
+
+  const auto routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  ASSERT_EQ(2 * numPrefixes, routeDb->unicastRoutes.size());
+  // ECMP towards both classes
+  for (auto const& route : routeDb->unicastRoutes) {
+    EXPECT_EQ(2, route.nextHops.size()) << toString(route.dest);
+  }
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters.at("decision.next_hop_group_misses.count.0"));
+  EXPECT_EQ(
+      2 * numPrefixes - 2, counters.at("decision.next_hop_group_hits.count.0"));
+
+  // groups don't outlive a route build
+  EXPECT_EQ(routeDb, spfSolver.buildRouteDb("1"));
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(4, counters.at("decision.next_hop_group_misses.count.0"));
+}
+
+//
+// Verify partial route computation for changed prefixes, reusing the SPF
+// result of the last full route computation
+//
+TEST(SpfSolver, BuildRouteDbDelta) {
+  SpfSolver spfSolver("1", false /* disable v4 */, false /* disable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34}, 3));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+  for (auto const& prefixDb : {prefixDb1, prefixDb2, prefixDb3, prefixDb4}) {
+    EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb));
+  }
+
+  // no cached SPF result yet
+  EXPECT_FALSE(spfSolver.buildRouteDbDelta("1", {addr4}).hasValue());
+  ASSERT_TRUE(spfSolver.buildPaths("1").hasValue());
+
+  auto getRoute = [&](thrift::IpPrefix const& prefix) {
+    auto routeDb = spfSolver.buildRouteDb("1");
+    for (auto const& route : routeDb->unicastRoutes) {
+      if (route.dest == prefix) {
+        return route;
+      }
+    }
+    ADD_FAILURE() << "No route for " << toString(prefix);
+    return thrift::UnicastRoute{};
+  };
+
+  // node-4 advertises a new non-loopback prefix
+  auto prefixDb4Updated = prefixDb4;
+  prefixDb4Updated.prefixEntries.emplace_back(
+      createPrefixEntry(addr5, thrift::PrefixType::DEFAULT));
+  std::unordered_set<thrift::IpPrefix> changedPrefixes;
+  EXPECT_TRUE(
+      spfSolver.updatePrefixDatabase(prefixDb4Updated, &changedPrefixes));
+  EXPECT_EQ(std::unordered_set<thrift::IpPrefix>{addr5}, changedPrefixes);
+  {
+    auto routeDbDelta = spfSolver.buildRouteDbDelta("1", changedPrefixes);
+    ASSERT_TRUE(routeDbDelta.hasValue());
+    ASSERT_EQ(1, routeDbDelta->unicastRoutesToUpdate.size());
+    EXPECT_EQ(getRoute(addr5), routeDbDelta->unicastRoutesToUpdate.at(0));
+    EXPECT_EQ(0, routeDbDelta->unicastRoutesToDelete.size());
+    EXPECT_EQ(0, routeDbDelta->mplsRoutesToUpdate.size());
+    EXPECT_EQ(0, routeDbDelta->mplsRoutesToDelete.size());
+  }
+
+  // node-4 withdraws it again
+  changedPrefixes.clear();
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb4, &changedPrefixes));
+  EXPECT_EQ(std::unordered_set<thrift::IpPrefix>{addr5}, changedPrefixes);
+  {
+    auto routeDbDelta = spfSolver.buildRouteDbDelta("1", changedPrefixes);
+    ASSERT_TRUE(routeDbDelta.hasValue());
+    EXPECT_EQ(0, routeDbDelta->unicastRoutesToUpdate.size());
+    EXPECT_EQ(
+        std::vector<thrift::IpPrefix>{addr5},
+        routeDbDelta->unicastRoutesToDelete);
+  }
+
+  // loopback change of node-4 requires full route computation
+  changedPrefixes.clear();
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(
+      createPrefixDb("4", {createPrefixEntry(addr6)}), &changedPrefixes));
+  EXPECT_FALSE(spfSolver.buildRouteDbDelta("1", changedPrefixes).hasValue());
+  EXPECT_TRUE(spfSolver.buildRouteDb("1").hasValue());
+  EXPECT_TRUE(spfSolver.buildRouteDbDelta("1", {addr6}).hasValue());
+
+  const auto counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters.at("decision.partial_route_build_runs.count.0"));
+}
+
+//
+// Node-1 is part of two areas
+//
+//  area A: 1---2---4      area B: 1---3
+//
+// addr4 is advertised by node-4 in area A and by node-3 in area B, the route
+// of area B is cheaper and must be preferred
+//
+TEST(SpfSolver, MultiArea) {
+  SpfSolver spfSolver("1", false /* disable v4 */, false /* disable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12}, 1), "A");
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2), "A");
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42}, 4), "A");
+  spfSolver.updatePrefixDatabase(prefixDb2, nullptr, "A");
+  spfSolver.updatePrefixDatabase(prefixDb4, nullptr, "A");
+
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj13}, 1), "B");
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31}, 3), "B");
+  const auto prefixDb3B = createPrefixDb(
+      "3",
+      {createPrefixEntry(addr3),
+       createPrefixEntry(addr4, thrift::PrefixType::DEFAULT)});
+  spfSolver.updatePrefixDatabase(prefixDb3B, nullptr, "B");
+
+  // empty default area is not tracked anymore
+  EXPECT_EQ((std::vector<std::string>{"A", "B"}), spfSolver.getAreas());
+  EXPECT_EQ(3, spfSolver.getAdjacencyDatabases("A").size());
+  EXPECT_EQ(2, spfSolver.getAdjacencyDatabases("B").size());
+
+  auto routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ(3, routeDb->unicastRoutes.size());
+  RouteMap routeMap;
+  fillRouteMap("1", routeMap, routeDb.value());
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12, false, 10)}));
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr3))],
+      NextHops({createNextHopFromAdj(adj13, false, 10)}));
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr4))],
+      NextHops({createNextHopFromAdj(adj13, false, 10)}));
+  EXPECT_EQ(2, spfSolver.getCounters().at("decision.path_build_runs.count.0"));
+
+  // topology change in area A only recomputes area A
+  EXPECT_TRUE(
+      spfSolver.updateAdjacencyDatabase(createAdjDb("4", {}, 4), "A").first);
+  routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ(3, routeDb->unicastRoutes.size());
+  EXPECT_EQ(3, spfSolver.getCounters().at("decision.path_build_runs.count.0"));
+
+  // withdraw addr4 in area B, area A can't reach node-4 anymore
+  std::unordered_set<thrift::IpPrefix> changedPrefixes;
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(
+      createPrefixDb("3", {createPrefixEntry(addr3)}), &changedPrefixes, "B"));
+  EXPECT_EQ(std::unordered_set<thrift::IpPrefix>{addr4}, changedPrefixes);
+  auto routeDbDelta = spfSolver.buildRouteDbDelta("1", changedPrefixes);
+  ASSERT_TRUE(routeDbDelta.hasValue());
+  EXPECT_EQ(0, routeDbDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>{addr4},
+      routeDbDelta->unicastRoutesToDelete);
+
+  // node-4 is reachable in area A again, addr4 is routed via area A
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42}, 4), "A");
+  routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  routeMap.clear();
+  fillRouteMap("1", routeMap, routeDb.value());
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr4))],
+      NextHops({createNextHopFromAdj(adj12, false, 20)}));
+}
+
+TEST(SpfSolver, ComputePhases) {
+  SpfSolver spfSolver("1", false /* disable v4 */, true /* enable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21}, 2));
+  spfSolver.updatePrefixDatabase(prefixDb1);
+  spfSolver.updatePrefixDatabase(prefixDb2);
+  EXPECT_TRUE(spfSolver.getLastComputePhases().empty());
+
+  auto phaseNames = [&spfSolver]() {
+    std::vector<std::string> names;
+    for (auto const& phase : spfSolver.getLastComputePhases()) {
+      names.emplace_back(PhaseProfiler::getPhaseName(phase.first));
+    }
+    return names;
+  };
+
+  ASSERT_TRUE(spfSolver.buildPaths("1").hasValue());
+  EXPECT_EQ(
+      (std::vector<std::string>{
+          "spf", "lfa", "unicast_routes", "best_announcer", "mpls_routes"}),
+      phaseNames());
+
+  // no SPF for a route build from cached SPF results
+  ASSERT_TRUE(spfSolver.buildRouteDb("1").hasValue());
+  EXPECT_EQ(
+      (std::vector<std::string>{
+          "unicast_routes", "best_announcer", "mpls_routes"}),
+      phaseNames());
+
+  ASSERT_TRUE(spfSolver.buildRouteDbDelta("1", {addr2}).hasValue());
+  EXPECT_EQ(
+      (std::vector<std::string>{"best_announcer", "route_delta"}),
+      phaseNames());
+
+  const auto counters = spfSolver.getCounters();
+  EXPECT_EQ(1, counters.count("decision.phase.spf_us.p50"));
+  EXPECT_EQ(1, counters.count("decision.phase.spf_us.p99"));
+  EXPECT_EQ(1, counters.count("decision.phase.spf_us.max"));
+  EXPECT_LE(
+      counters.at("decision.phase.unicast_routes_us.p50"),
+      counters.at("decision.phase.unicast_routes_us.max"));
+  EXPECT_EQ(0, counters.count("decision.phase.ksp2_us.p50"));
+  // no BGP prefixes to compare
+  EXPECT_EQ(0, counters.count("decision.phase.bgp_metric_compare_us.p50"));
+}
+
 //
 // Create a broken topology where R1 and R2 connect no one
 // Expect no routes coming out of the spfSolver
@@ -1012,6 +1477,104 @@ TEST(BGPRedistribution, IgpMetric) {
                   createNextHop(adj13.nextHopV6, adj13.ifName, 20))))));
 }
 
+//
+// Verify that BGP best paths are reused until announcements or reachability
+// of the announcers change
+//
+TEST(BGPRedistribution, BestPathCache) {
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName,
+      false /* enableV4 */,
+      false /* computeLfaPaths */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      true /* bgpUseIgpMetric */);
+
+  thrift::MetricVector metricVector;
+  metricVector.metrics.resize(1);
+  metricVector.metrics[0].type = 0;
+  metricVector.metrics[0].priority = 0;
+  metricVector.metrics[0].op = thrift::CompareType::WIN_IF_PRESENT;
+  metricVector.metrics[0].isBestPathTieBreaker = true;
+  metricVector.metrics[0].metric = {1};
+  const std::string data1{"data1"};
+  const auto bgpPrefix2 = createPrefixEntry(
+      addr1,
+      thrift::PrefixType::BGP,
+      data1,
+      thrift::PrefixForwardingType::IP,
+      thrift::PrefixForwardingAlgorithm::SP_ECMP,
+      false,
+      metricVector);
+  // differ in the tie breaking metric only
+  metricVector.metrics[0].metric = {100};
+  const auto bgpPrefix3 = createPrefixEntry(
+      addr1,
+      thrift::PrefixType::BGP,
+      data1,
+      thrift::PrefixForwardingType::IP,
+      thrift::PrefixForwardingAlgorithm::SP_ECMP,
+      false,
+      metricVector);
+
+  auto adjacencyDb1 = createAdjDb("1", {adj12, adj13}, 0);
+  auto adjacencyDb2 = createAdjDb("2", {adj21}, 0);
+  auto adjacencyDb3 = createAdjDb("3", {adj31}, 0);
+  EXPECT_FALSE(spfSolver.updateAdjacencyDatabase(adjacencyDb1).first);
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjacencyDb2).first);
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjacencyDb3).first);
+  EXPECT_TRUE(
+      spfSolver.updatePrefixDatabase(createPrefixDb("2", {bgpPrefix2})));
+  EXPECT_TRUE(
+      spfSolver.updatePrefixDatabase(createPrefixDb("3", {bgpPrefix3})));
+
+  const auto routeDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(1, counters.at("decision.bgp_best_path_cache_misses.count.0"));
+  EXPECT_EQ(0, counters.at("decision.bgp_best_path_cache_hits.count.0"));
+
+  // same announcements and reachability, same routes
+  EXPECT_EQ(routeDb, spfSolver.buildPaths("1"));
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(1, counters.at("decision.bgp_best_path_cache_misses.count.0"));
+  EXPECT_EQ(1, counters.at("decision.bgp_best_path_cache_hits.count.0"));
+
+  // IGP metric towards an announcer changes, selected again
+  adjacencyDb1.adjacencies[1].metric = 20;
+  EXPECT_TRUE(spfSolver.updateAdjacencyDatabase(adjacencyDb1).first);
+  auto newRouteDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(newRouteDb.hasValue());
+  EXPECT_THAT(
+      newRouteDb.value().unicastRoutes,
+      testing::Contains(AllOf(
+          Field(&thrift::UnicastRoute::dest, addr1),
+          Field(&thrift::UnicastRoute::data, data1),
+          Field(
+              &thrift::UnicastRoute::nextHops,
+              testing::UnorderedElementsAre(
+                  createNextHop(adj12.nextHopV6, adj12.ifName, 10))))));
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters.at("decision.bgp_best_path_cache_misses.count.0"));
+
+  // announcement withdrawn, selected again
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(createPrefixDb("2", {})));
+  newRouteDb = spfSolver.buildPaths("1");
+  ASSERT_TRUE(newRouteDb.hasValue());
+  EXPECT_THAT(
+      newRouteDb.value().unicastRoutes,
+      testing::Contains(AllOf(
+          Field(&thrift::UnicastRoute::dest, addr1),
+          Field(
+              &thrift::UnicastRoute::nextHops,
+              testing::UnorderedElementsAre(
+                  createNextHop(adj13.nextHopV6, adj13.ifName, 20))))));
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters.at("decision.bgp_best_path_cache_misses.count.0"));
+  EXPECT_EQ(1, counters.at("decision.bgp_best_path_cache_hits.count.0"));
+}
+
 //
 // Test topology:
 // connected bidirectionally
@@ -1810,6 +2373,30 @@ TEST_P(SimpleRingTopologyFixture, MultiPathTest) {
   validateAdjLabelRoutes(routeMap, "4", adjacencyDb4.adjacencies);
 }
 
+//
+// Verify that KSP2 paths are reused on the same topology
+//
+TEST_P(SimpleRingTopologyFixture, Ksp2PathCache) {
+  CustomSetUp(
+      true /* multipath - ignored */,
+      true /* useKsp2Ed */,
+      std::get<1>(GetParam()));
+  const auto routeDb = spfSolver->buildPaths("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  auto counters = spfSolver->getCounters();
+  const auto spfRuns = counters.at("decision.spf_runs.count.0");
+  const auto misses = counters.at("decision.ksp2_path_cache_misses.count.0");
+  EXPECT_LT(0, misses);
+  EXPECT_EQ(0, counters.at("decision.ksp2_path_cache_hits.count.0"));
+
+  // no second SPF runs, same routes
+  EXPECT_EQ(routeDb, spfSolver->buildPaths("1"));
+  counters = spfSolver->getCounters();
+  EXPECT_EQ(spfRuns, counters.at("decision.spf_runs.count.0"));
+  EXPECT_EQ(misses, counters.at("decision.ksp2_path_cache_misses.count.0"));
+  EXPECT_EQ(misses, counters.at("decision.ksp2_path_cache_hits.count.0"));
+}
+
 //
 // Validate KSP2_ED_ECMP routes on SimpleRingTopology
 //
@@ -3702,7 +4289,9 @@ class DecisionTestFixture : public ::testing::Test {
         kvStoreUpdatesQueue.getReader(),
         routeUpdatesQueue,
         MonitorSubmitUrl{"inproc://monitor-rep"},
-        zeromqContext);
+        zeromqContext,
+        1, /* numRouteBuildThreads */
+        enableAsyncCompute());
 
     decisionThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Decision thread starting";
@@ -3722,6 +4311,11 @@ class DecisionTestFixture : public ::testing::Test {
     LOG(INFO) << "Decision thread got stopped";
   }
 
+  virtual bool
+  enableAsyncCompute() const {
+    return false;
+  }
+
   //
   // member methods
   //
@@ -3746,14 +4340,14 @@ class DecisionTestFixture : public ::testing::Test {
       const apache::thrift::CompactSerializer& serializer) {
     auto maybeRouteDb = routeUpdatesQueueReader.get();
     EXPECT_FALSE(maybeRouteDb.hasError());
-    auto routeDbDelta = maybeRouteDb.value();
-    return routeDbDelta;
+    return maybeRouteDb.value().toThrift();
   }
 
   // publish routeDb
   void
   sendKvPublication(const thrift::Publication& publication) {
-    kvStoreUpdatesQueue.push(publication);
+    kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(publication));
   }
 
   // helper function
@@ -3848,9 +4442,9 @@ class DecisionTestFixture : public ::testing::Test {
   // ZMQ context for IO processing
   fbzmq::Context zeromqContext{};
 
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
-  messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueueReader{
+  messaging::ReplicateQueue<KvStorePublicationPtr> kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue;
+  messaging::RQueue<RouteUpdate> routeUpdatesQueueReader{
       routeUpdatesQueue.getReader()};
 
   // Decision owned by this wrapper.
@@ -3982,6 +4576,132 @@ TEST_F(DecisionTestFixture, BasicOperations) {
       NextHops({createNextHopFromAdj(adj12, false, 10)}));
 }
 
+//
+// Same as DecisionTestFixture with routes computed off the event loop
+//
+class DecisionAsyncComputeTestFixture : public DecisionTestFixture {
+ protected:
+  bool
+  enableAsyncCompute() const override {
+    return true;
+  }
+};
+
+//
+// 1---2---3
+//
+// Adjacency and prefix updates are computed on the compute executor. Route
+// dumps must reflect every update published before them.
+//
+TEST_F(DecisionAsyncComputeTestFixture, BasicOperations) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21, adj23})},
+       {"adj:3", createAdjValue("3", 1, {adj32})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  auto routeDbBefore = dumpRouteDb({"1"})["1"];
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  auto routeDelta = findDeltaRoutes(routeDb, routeDbBefore);
+  EXPECT_TRUE(checkEqualRoutesDelta(routeDbDelta, routeDelta));
+
+  // prefix only update is applied as a partial route build
+  publication = createThriftPublication(
+      {{"prefix:3", createPrefixValue("3", 1, {addr3})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+
+  // dumping routes of other nodes doesn't affect routes of this node
+  auto routeDbMap = dumpRouteDb({"2", "3"});
+  EXPECT_EQ(2, routeDbMap["2"].unicastRoutes.size());
+  EXPECT_EQ(2, routeDbMap["3"].unicastRoutes.size());
+
+  RouteMap routeMap;
+  routeDb = dumpRouteDb({"1"})["1"];
+  EXPECT_EQ(2, routeDb.unicastRoutes.size());
+  fillRouteMap("1", routeMap, routeDb);
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12, false, 10)}));
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr3))],
+      NextHops({createNextHopFromAdj(adj12, false, 20)}));
+
+  // remove 3
+  publication = createThriftPublication(
+      thrift::KeyVals{},
+      {"adj:3", "prefix:3"} /* expired keys */,
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToDelete.at(0));
+
+  auto counters = decision->getCounters();
+  EXPECT_LE(3, counters.at("decision.compute_jobs"));
+  EXPECT_LE(1, counters.at("decision.spf_runs.count.0"));
+}
+
+//
+// 1---2
+//
+// Routes keep being published while prefixes of 2 churn without a break,
+// although every computation is superseded by a newer request meanwhile.
+//
+TEST_F(DecisionAsyncComputeTestFixture, SustainedChurn) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+
+  // flap prefixes of 2, each flap changes routes, until routes get published.
+  // Gives up way beyond the maximum debounce
+  const int kMaxFlaps{1000};
+  int numFlaps{0};
+  while (routeUpdatesQueueReader.size() == 0 and numFlaps < kMaxFlaps) {
+    ++numFlaps;
+    auto prefixes = numFlaps % 2 ? std::vector<thrift::IpPrefix>{addr2, addr3}
+                                 : std::vector<thrift::IpPrefix>{addr2, addr4};
+    publication = createThriftPublication(
+        {{"prefix:2", createPrefixValue("2", numFlaps + 1, prefixes)}},
+        {},
+        {},
+        {},
+        std::string(""));
+    sendKvPublication(publication);
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_LT(numFlaps, kMaxFlaps);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_FALSE(
+      routeDbDelta.unicastRoutesToUpdate.empty() and
+      routeDbDelta.unicastRoutesToDelete.empty());
+}
+
 // The following topology is used:
 //
 //         100
@@ -4096,6 +4816,292 @@ TEST_F(DecisionTestFixture, ParallelLinks) {
       NextHops({createNextHopFromAdj(adj12_2, false, 800)}));
 }
 
+TEST_F(DecisionTestFixture, WhatIf) {
+  auto adj12_1 =
+      createAdjacency("2", "1/2-1", "2/1-1", "fe80::2", "192.168.0.2", 100, 0);
+  auto adj12_2 =
+      createAdjacency("2", "1/2-2", "2/1-2", "fe80::2", "192.168.0.2", 800, 0);
+  auto adj21_1 =
+      createAdjacency("1", "2/1-1", "1/2-1", "fe80::1", "192.168.0.1", 100, 0);
+  auto adj21_2 =
+      createAdjacency("1", "2/1-2", "1/2-2", "fe80::1", "192.168.0.1", 800, 0);
+
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12_1, adj12_2})},
+       {"adj:2", createAdjValue("2", 1, {adj21_1, adj21_2})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+  const auto routeDbBefore = dumpRouteDb({"1"})["1"];
+
+  // no mutations, no changes
+  auto delta = decision->getDecisionRouteDbWhatIf({}).get();
+  EXPECT_TRUE(delta->unicastRoutesToUpdate.empty());
+  EXPECT_TRUE(delta->unicastRoutesToDelete.empty());
+
+  // overload the least cost link
+  thrift::AdjacencyMutation mutation;
+  mutation.nodeName = "2";
+  mutation.ifName = "2/1-1";
+  mutation.isOverloaded = true;
+  thrift::WhatIfRequest request;
+  request.adjacencyMutations.emplace_back(mutation);
+  delta = decision->getDecisionRouteDbWhatIf(request).get();
+  ASSERT_EQ(1, delta->unicastRoutesToUpdate.size());
+  EXPECT_TRUE(delta->unicastRoutesToDelete.empty());
+  EXPECT_EQ(addr2, delta->unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>(
+          {createNextHopFromAdj(adj12_2, false, 800)}),
+      delta->unicastRoutesToUpdate.at(0).nextHops);
+
+  // same query against the same link state yields the same result
+  auto delta2 = decision->getDecisionRouteDbWhatIf(request).get();
+  EXPECT_EQ(*delta, *delta2);
+
+  // unknown nodes and interfaces are rejected
+  mutation.ifName = "2/1-3";
+  request.adjacencyMutations = {mutation};
+  EXPECT_THROW(
+      decision->getDecisionRouteDbWhatIf(request).get(),
+      std::invalid_argument);
+  request.adjacencyMutations.clear();
+  request.nodeOverloads["3"] = true;
+  EXPECT_THROW(
+      decision->getDecisionRouteDbWhatIf(request).get(),
+      std::invalid_argument);
+
+  // live routes are not affected
+  EXPECT_EQ(routeDbBefore, dumpRouteDb({"1"})["1"]);
+
+  // queries after link state changes are computed on the new link state
+  auto adj21_1_overloaded = adj21_1;
+  adj21_1_overloaded.isOverloaded = true;
+  publication = createThriftPublication(
+      {{"adj:2", createAdjValue("2", 2, {adj21_1_overloaded, adj21_2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+  request.nodeOverloads.clear();
+  request.adjacencyMutations = {mutation};
+  request.adjacencyMutations.at(0).ifName = "2/1-1";
+  delta = decision->getDecisionRouteDbWhatIf(request).get();
+  EXPECT_TRUE(delta->unicastRoutesToUpdate.empty());
+  EXPECT_TRUE(delta->unicastRoutesToDelete.empty());
+
+  // as well as after databases expire
+  publication = createThriftPublication(
+      thrift::KeyVals{},
+      {"adj:2"} /* expired keys */,
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+  EXPECT_THROW(
+      decision->getDecisionRouteDbWhatIf(request).get(),
+      std::invalid_argument);
+}
+
+TEST_F(DecisionTestFixture, SkipUnchangedValues) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+
+  // re-flooded values are not decoded again, values of the same version and
+  // originator with different contents are
+  sendKvPublication(publication);
+  const auto changedPrefixDb2 = createPrefixValue("2", 1, {addr2, addr3});
+  sendKvPublication(createThriftPublication(
+      {{"prefix:2", changedPrefixDb2}}, {}, {}, {}, std::string("")));
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  auto counters = decision->getCounters();
+  EXPECT_EQ(2, counters.at("decision.skipped_adj_db_decodes"));
+  // prefix:2 of the re-flood is either skipped or merged into the change
+  const auto skippedPrefixDbDecodes =
+      counters.at("decision.skipped_prefix_db_decodes");
+  EXPECT_EQ(
+      2, skippedPrefixDbDecodes + counters.at("decision.merged_publications"));
+
+  // values are applied again once expired
+  sendKvPublication(createThriftPublication(
+      {}, {"prefix:2"}, {}, {}, std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToDelete.size());
+  sendKvPublication(createThriftPublication(
+      {{"prefix:2", changedPrefixDb2}}, {}, {}, {}, std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+  counters = decision->getCounters();
+  EXPECT_EQ(
+      skippedPrefixDbDecodes,
+      counters.at("decision.skipped_prefix_db_decodes"));
+}
+
+TEST(DecisionTest, MergePublications) {
+  const std::string area{"area"};
+  auto makePub = [](std::unordered_map<std::string, thrift::Value> keyVals,
+                    std::vector<std::string> expiredKeys,
+                    std::string const& area) {
+    return std::make_shared<const thrift::Publication>(createThriftPublication(
+        keyVals, expiredKeys, folly::none, folly::none, folly::none, area));
+  };
+  const auto value1 = createThriftValue(1, "1", std::string("v1"));
+  const auto value2 = createThriftValue(2, "1", std::string("v2"));
+  const auto ttlRefresh = createThriftValue(2, "1", folly::none, 1000, 1);
+
+  const auto merged = openr::detail::mergePublications({
+      makePub({{"a", value1}, {"b", value1}}, {"c"}, area),
+      makePub({{"x", value1}}, {}, "other"),
+      // latest value of a, TTL refresh doesn't supersede it
+      makePub({{"a", value2}}, {}, area),
+      makePub({{"a", ttlRefresh}, {"d", ttlRefresh}}, {}, area),
+      // b expires, c is set again
+      makePub({{"c", value2}}, {"b"}, area),
+  });
+  ASSERT_EQ(2, merged.size());
+  EXPECT_EQ(area, merged.at(0).area);
+  EXPECT_EQ(
+      (std::map<std::string, thrift::Value>{
+          {"a", value2}, {"c", value2}, {"d", ttlRefresh}}),
+      merged.at(0).keyVals);
+  EXPECT_EQ(std::vector<std::string>{"b"}, merged.at(0).expiredKeys);
+  EXPECT_EQ("other", merged.at(1).area);
+  EXPECT_EQ(1, merged.at(1).keyVals.size());
+  EXPECT_TRUE(merged.at(1).expiredKeys.empty());
+}
+
+TEST(DecisionTest, ComputeSuperseded) {
+  constexpr auto kMax = Constants::kDecisionMaxDroppedComputes;
+  // the latest computation is never superseded
+  EXPECT_FALSE(openr::detail::isComputeSuperseded(5, 5, 0));
+  // older ones are, up to kMax in a row since the last published one
+  EXPECT_TRUE(openr::detail::isComputeSuperseded(1, 5, 0));
+  EXPECT_TRUE(openr::detail::isComputeSuperseded(kMax, kMax + 5, 0));
+  EXPECT_FALSE(openr::detail::isComputeSuperseded(kMax + 1, kMax + 5, 0));
+  EXPECT_TRUE(openr::detail::isComputeSuperseded(kMax + 2, kMax + 5, kMax + 1));
+}
+
+TEST_F(DecisionTestFixture, UnchangedRouteDb) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  const auto routeDbBefore = dumpRouteDb({"1"})["1"];
+
+  // metric of the reverse link doesn't affect routes of node 1, Fib gets an
+  // empty delta without routes being diffed
+  auto adj21Metric = adj21;
+  adj21Metric.metric = 20;
+  sendKvPublication(createThriftPublication(
+      {{"adj:2", createAdjValue("2", 2, {adj21Metric})}},
+      {},
+      {},
+      {},
+      std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_TRUE(routeDbDelta.unicastRoutesToUpdate.empty());
+  EXPECT_TRUE(routeDbDelta.unicastRoutesToDelete.empty());
+  EXPECT_TRUE(routeDbDelta.mplsRoutesToUpdate.empty());
+  EXPECT_TRUE(routeDbDelta.mplsRoutesToDelete.empty());
+  EXPECT_EQ(1, decision->getCounters().at("decision.unchanged_route_dbs"));
+  EXPECT_EQ(routeDbBefore, dumpRouteDb({"1"})["1"]);
+
+  // changes are still found route by route
+  auto adj12Metric = adj12;
+  adj12Metric.metric = 20;
+  sendKvPublication(createThriftPublication(
+      {{"adj:1", createAdjValue("1", 2, {adj12Metric})}},
+      {},
+      {},
+      {},
+      std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_TRUE(routeDbDelta.unicastRoutesToDelete.empty());
+  EXPECT_EQ(1, decision->getCounters().at("decision.unchanged_route_dbs"));
+}
+
+TEST_F(DecisionTestFixture, BulkRouteDbs) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21, adj23})},
+       {"adj:3", createAdjValue("3", 1, {adj32})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})},
+       {"prefix:3", createPrefixValue("3", 1, {addr3})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+
+  auto getRouteDbs = [&](std::vector<std::string> nodeNames) {
+    std::vector<thrift::RouteDatabase> routeDbs;
+    decision
+        ->getDecisionRouteDbs(
+            std::move(nodeNames),
+            [&routeDbs](thrift::RouteDatabase&& routeDb) {
+              routeDbs.emplace_back(std::move(routeDb));
+            })
+        .get();
+    return routeDbs;
+  };
+  // routes and their nexthops are computed in no particular order
+  auto sorted = [](thrift::RouteDatabase routeDb) {
+    for (auto& route : routeDb.unicastRoutes) {
+      std::sort(route.nextHops.begin(), route.nextHops.end());
+    }
+    std::sort(routeDb.unicastRoutes.begin(), routeDb.unicastRoutes.end());
+    std::sort(routeDb.mplsRoutes.begin(), routeDb.mplsRoutes.end());
+    return routeDb;
+  };
+
+  // same routes as computed one node at a time, in the requested order
+  auto expected = dumpRouteDb({"1", "2", "3"});
+  auto routeDbs = getRouteDbs({"3", "1", "4"});
+  ASSERT_EQ(3, routeDbs.size());
+  EXPECT_EQ(sorted(expected.at("3")), sorted(routeDbs.at(0)));
+  EXPECT_EQ(sorted(expected.at("1")), sorted(routeDbs.at(1)));
+  EXPECT_EQ("4", routeDbs.at(2).thisNodeName);
+  EXPECT_TRUE(routeDbs.at(2).unicastRoutes.empty());
+
+  // all nodes if none are given
+  routeDbs = getRouteDbs({});
+  ASSERT_EQ(3, routeDbs.size());
+  for (auto const& routeDb : routeDbs) {
+    EXPECT_EQ(sorted(expected.at(routeDb.thisNodeName)), sorted(routeDb));
+  }
+}
+
 // The following topology is used:
 //
 // 1---2---3---4
@@ -4889,6 +5895,111 @@ TEST_F(DecisionTestFixture, PerPrefixKeyExpiry) {
   EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToDelete.at(0));
 }
 
+// Routes are computed from the restored link state right away within the
+// graceful restart window, and reconciled with the live one once it ends
+TEST(DecisionSnapshotTest, RestoreAndReconcile) {
+  const auto snapshotFilePath = folly::sformat(
+      "/tmp/openr_decision_snapshot_test_{}",
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::remove(snapshotFilePath.c_str());
+
+  CompactSerializer serializer;
+  fbzmq::Context context;
+  auto createValue = [&](auto const& db) {
+    return createThriftValue(
+        1,
+        db.thisNodeName,
+        fbzmq::util::writeThriftObjStr(db, serializer),
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+  };
+  auto runDecision = [&](folly::Optional<std::chrono::seconds> grWindow,
+                         thrift::Publication const& publication,
+                         auto checkRoutes) {
+    messaging::ReplicateQueue<KvStorePublicationPtr> kvStoreUpdatesQueue;
+    messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue;
+    auto routeUpdatesReader = routeUpdatesQueue.getReader();
+    auto decision = std::make_shared<Decision>(
+        "1", /* node name */
+        true, /* enable v4 */
+        false, /* computeLfaPaths */
+        false, /* enableOrderedFib */
+        false, /* bgpDryRun */
+        false, /* bgpUseIgpMetric */
+        AdjacencyDbMarker{"adj:"},
+        PrefixDbMarker{"prefix:"},
+        std::chrono::milliseconds(10),
+        std::chrono::milliseconds(500),
+        grWindow,
+        kvStoreUpdatesQueue.getReader(),
+        routeUpdatesQueue,
+        MonitorSubmitUrl{"inproc://monitor-rep"},
+        context,
+        1, /* numRouteBuildThreads */
+        false, /* enableAsyncCompute */
+        0, /* routeTraceBufferSize */
+        0, /* debounceDutyCycle */
+        PrefixLimits{},
+        snapshotFilePath);
+    std::thread decisionThread([&]() { decision->run(); });
+    decision->waitUntilRunning();
+
+    kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(publication));
+    checkRoutes(routeUpdatesReader);
+
+    kvStoreUpdatesQueue.close();
+    decision->stop();
+    decisionThread.join();
+    // snapshot is taken on destruction
+    decision.reset();
+  };
+
+  {
+    // nothing to restore from at first
+    auto publication = createThriftPublication(
+        {{"adj:1", createValue(createAdjDb("1", {adj12}, 1))},
+         {"adj:2", createValue(createAdjDb("2", {adj21}, 2))},
+         {"prefix:2",
+          createValue(createPrefixDb("2", {createPrefixEntry(addr2)}))}},
+        {});
+    runDecision(folly::none, publication, [](auto& reader) {
+      auto routeDbDelta = reader.get().value().toThrift();
+      ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+      EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+    });
+  }
+  EXPECT_TRUE(fileExists(snapshotFilePath));
+
+  {
+    // node 2 advertises another prefix after the restart
+    auto publication = createThriftPublication(
+        {{"adj:1", createValue(createAdjDb("1", {adj12}, 1))},
+         {"adj:2", createValue(createAdjDb("2", {adj21}, 2))},
+         {"prefix:2",
+          createValue(createPrefixDb("2", {createPrefixEntry(addr5)}))}},
+        {});
+    runDecision(std::chrono::seconds(1), publication, [](auto& reader) {
+      // provisional routes of the restored link state
+      auto routeDbDelta = reader.get().value().toThrift();
+      ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+      EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+      EXPECT_EQ(0, routeDbDelta.unicastRoutesToDelete.size());
+
+      // live prefixes replace the restored ones after the restart window
+      routeDbDelta = reader.get().value().toThrift();
+      ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+      EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+      EXPECT_EQ(
+          std::vector<thrift::IpPrefix>{addr2},
+          routeDbDelta.unicastRoutesToDelete);
+    });
+  }
+
+  std::remove(snapshotFilePath.c_str());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <random>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/decision/IndexedHeap.h>
+
+using namespace openr;
+
+TEST(IndexedHeapTest, BasicOperation) {
+  IndexedHeap<uint64_t> heap;
+  heap.reset(5);
+  EXPECT_TRUE(heap.empty());
+
+  heap.push(3, 30);
+  heap.push(1, 10);
+  heap.push(4, 40);
+  heap.push(0, 20);
+  EXPECT_EQ(4, heap.size());
+  EXPECT_TRUE(heap.contains(3));
+  EXPECT_FALSE(heap.contains(2));
+  EXPECT_EQ(1, heap.top());
+
+  // decrease key
+  heap.push(4, 5);
+  EXPECT_EQ(5, heap.priority(4));
+  EXPECT_EQ(4, heap.pop());
+  EXPECT_FALSE(heap.contains(4));
+  EXPECT_EQ(1, heap.pop());
+  EXPECT_EQ(0, heap.pop());
+  EXPECT_EQ(3, heap.pop());
+  EXPECT_TRUE(heap.empty());
+}
+
+TEST(IndexedHeapTest, TieBreakById) {
+  IndexedHeap<uint64_t> heap;
+  heap.reset(4);
+  heap.push(2, 1);
+  heap.push(3, 1);
+  heap.push(0, 1);
+  heap.push(1, 1);
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, heap.pop());
+  }
+}
+
+TEST(IndexedHeapTest, ResetAndReuse) {
+  IndexedHeap<uint64_t> heap;
+  heap.reset(3);
+  heap.push(0, 3);
+  heap.push(2, 1);
+  heap.reset(10);
+  EXPECT_TRUE(heap.empty());
+  EXPECT_FALSE(heap.contains(0));
+  EXPECT_FALSE(heap.contains(2));
+  heap.push(9, 1);
+  heap.push(0, 0);
+  EXPECT_EQ(0, heap.pop());
+  EXPECT_EQ(9, heap.pop());
+}
+
+TEST(IndexedHeapTest, RandomizedAgainstSort) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<uint64_t> dist(0, 1000);
+  const uint32_t kNumIds = 500;
+
+  IndexedHeap<uint64_t> heap;
+  for (int round = 0; round < 3; ++round) {
+    heap.reset(kNumIds);
+    std::vector<uint64_t> priorities(kNumIds);
+    for (uint32_t id = 0; id < kNumIds; ++id) {
+      priorities[id] = dist(gen);
+      heap.push(id, priorities[id]);
+    }
+    // decrease keys for some random ids
+    for (uint32_t i = 0; i < kNumIds / 2; ++i) {
+      auto id = static_cast<uint32_t>(gen() % kNumIds);
+      priorities[id] /= 2;
+      heap.push(id, priorities[id]);
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> expected;
+    for (uint32_t id = 0; id < kNumIds; ++id) {
+      expected.emplace_back(priorities[id], id);
+    }
+    std::sort(expected.begin(), expected.end());
+    for (auto const& kv : expected) {
+      ASSERT_FALSE(heap.empty());
+      EXPECT_EQ(kv.second, heap.pop());
+    }
+    EXPECT_TRUE(heap.empty());
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
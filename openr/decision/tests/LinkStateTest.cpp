@@ -5,6 +5,9 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <map>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -145,23 +148,41 @@ TEST(LinkStateTest, BasicOperation) {
   auto adj32 =
       openr::createAdjacency(n3, "if3", "if3", "fe80::2", "10.0.0.2", 1, 1, 1);
 
-  auto l1 = std::make_shared<openr::Link>(n1, adj12, n2, adj21);
-  auto l2 = std::make_shared<openr::Link>(n2, adj23, n3, adj32);
-  auto l3 = std::make_shared<openr::Link>(n3, adj31, n1, adj13);
+  openr::Link l1(n1, adj12, n2, adj21);
+  openr::Link l2(n2, adj23, n3, adj32);
+  openr::Link l3(n3, adj31, n1, adj13);
 
   openr::LinkState state;
 
-  state.addLink(l1);
+  // addLink stores a copy of the link
+  auto& storedL1 = state.addLink(l1);
+  EXPECT_EQ(l1, storedL1);
+  EXPECT_NE(&l1, &storedL1);
   state.addLink(l2);
   state.addLink(l3);
+  EXPECT_EQ(3, state.numLinks());
+  EXPECT_THAT(state.linksFromNode("node1"), testing::Contains(&storedL1));
   EXPECT_THAT(
-      state.linksFromNode("node1"), testing::UnorderedElementsAre(l1, l3));
+      state.linksFromNode("node1"),
+      testing::UnorderedElementsAre(
+          testing::Pointee(l1), testing::Pointee(l3)));
   EXPECT_THAT(
-      state.linksFromNode("node2"), testing::UnorderedElementsAre(l1, l2));
+      state.linksFromNode("node2"),
+      testing::UnorderedElementsAre(
+          testing::Pointee(l1), testing::Pointee(l2)));
   EXPECT_THAT(
-      state.linksFromNode("node3"), testing::UnorderedElementsAre(l2, l3));
+      state.linksFromNode("node3"),
+      testing::UnorderedElementsAre(
+          testing::Pointee(l2), testing::Pointee(l3)));
   EXPECT_THAT(state.linksFromNode("node4"), testing::IsEmpty());
 
+  // links of a node are kept ordered
+  for (auto const& node : {"node1", "node2", "node3"}) {
+    auto const& links = state.orderedLinksFromNode(node);
+    EXPECT_TRUE(std::is_sorted(
+        links.begin(), links.end(), openr::LinkState::LinkPtrLess{}));
+  }
+
   EXPECT_FALSE(state.isNodeOverloaded("node1"));
   EXPECT_FALSE(state.updateNodeOverloaded("node1", true, 0, 0));
   EXPECT_TRUE(state.isNodeOverloaded("node1"));
@@ -170,16 +191,208 @@ TEST(LinkStateTest, BasicOperation) {
   EXPECT_FALSE(state.isNodeOverloaded("node1"));
 
   state.removeLink(l1);
-  EXPECT_THAT(state.linksFromNode("node1"), testing::UnorderedElementsAre(l3));
-  EXPECT_THAT(state.linksFromNode("node2"), testing::UnorderedElementsAre(l2));
   EXPECT_THAT(
-      state.linksFromNode("node3"), testing::UnorderedElementsAre(l2, l3));
+      state.linksFromNode("node1"),
+      testing::UnorderedElementsAre(testing::Pointee(l3)));
+  EXPECT_THAT(
+      state.linksFromNode("node2"),
+      testing::UnorderedElementsAre(testing::Pointee(l2)));
+  EXPECT_THAT(
+      state.linksFromNode("node3"),
+      testing::UnorderedElementsAre(
+          testing::Pointee(l2), testing::Pointee(l3)));
 
   state.removeNode("node1");
   EXPECT_THAT(state.linksFromNode("node1"), testing::IsEmpty());
-  EXPECT_THAT(state.linksFromNode("node2"), testing::UnorderedElementsAre(l2));
-  EXPECT_THAT(state.linksFromNode("node3"), testing::UnorderedElementsAre(l2));
+  EXPECT_THAT(
+      state.linksFromNode("node2"),
+      testing::UnorderedElementsAre(testing::Pointee(l2)));
+  EXPECT_THAT(
+      state.linksFromNode("node3"),
+      testing::UnorderedElementsAre(testing::Pointee(l2)));
   EXPECT_THROW(state.removeLink(l1), std::out_of_range);
+  EXPECT_EQ(1, state.numLinks());
+
+  // arena slots of removed links are reused, remaining links stay in place
+  auto const* storedL2 = state.linksFromNode("node2").front();
+  state.addLink(l1);
+  state.addLink(l3);
+  EXPECT_EQ(3, state.numLinks());
+  EXPECT_THAT(state.linksFromNode("node3"), testing::Contains(storedL2));
+  EXPECT_THAT(
+      state.linksFromNode("node2"),
+      testing::UnorderedElementsAre(
+          testing::Pointee(l1), testing::Pointee(l2)));
+}
+
+TEST(LinkStateTest, GraphView) {
+  std::string n1 = "node1";
+  auto adj12 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj13 =
+      openr::createAdjacency(n1, "if3", "if1", "fe80::3", "10.0.0.3", 5, 1, 1);
+  std::string n2 = "node2";
+  auto adj21 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::1", "10.0.0.1", 2, 1, 1);
+  std::string n3 = "node3";
+  auto adj31 =
+      openr::createAdjacency(n3, "if1", "if3", "fe80::1", "10.0.0.1", 3, 1, 1);
+
+  openr::Link l1(n1, adj12, n2, adj21);
+  openr::Link l2(n3, adj31, n1, adj13);
+
+  openr::LinkState state;
+  state.addLink(l1);
+  state.addLink(l2);
+
+  auto id1 = state.getNodeId(n1);
+  auto id2 = state.getNodeId(n2);
+  auto id3 = state.getNodeId(n3);
+  ASSERT_TRUE(id1.hasValue());
+  ASSERT_TRUE(id2.hasValue());
+  ASSERT_TRUE(id3.hasValue());
+  EXPECT_FALSE(state.getNodeId("node4").hasValue());
+  EXPECT_EQ(n1, state.getNodeName(*id1));
+  EXPECT_EQ(n2, state.getNodeName(*id2));
+  EXPECT_EQ(n3, state.getNodeName(*id3));
+
+  auto edgesFrom = [&state](openr::LinkState::NodeId id) {
+    auto const& graph = state.getGraph();
+    std::map<openr::LinkState::NodeId, openr::LinkStateMetric> edges;
+    for (size_t e = graph.offsets[id]; e < graph.offsets[id + 1]; ++e) {
+      edges.emplace(graph.dsts[e], graph.metrics[e]);
+    }
+    return edges;
+  };
+
+  EXPECT_EQ(3, state.getGraph().numNodes());
+  EXPECT_EQ(4, state.getGraph().dsts.size());
+  EXPECT_THAT(
+      edgesFrom(*id1),
+      testing::UnorderedElementsAre(
+          testing::Pair(*id2, 1), testing::Pair(*id3, 5)));
+  EXPECT_THAT(
+      edgesFrom(*id2), testing::UnorderedElementsAre(testing::Pair(*id1, 2)));
+  EXPECT_THAT(
+      edgesFrom(*id3), testing::UnorderedElementsAre(testing::Pair(*id1, 3)));
+
+  // reading the graph view doesn't bump the generation
+  const auto generation = state.getGeneration();
+  state.getGraph();
+  EXPECT_EQ(generation, state.getGeneration());
+
+  // node overload is reflected in the graph view
+  EXPECT_FALSE(state.getGraph().overloaded[*id2]);
+  state.updateNodeOverloaded(n2, true, 0, 0);
+  EXPECT_TRUE(state.getGraph().overloaded[*id2]);
+  EXPECT_LT(generation, state.getGeneration());
+
+  // removing a node drops its edges but keeps ids stable
+  const auto overloadGeneration = state.getGeneration();
+  state.removeNode(n3);
+  EXPECT_LT(overloadGeneration, state.getGeneration());
+  EXPECT_EQ(3, state.getGraph().numNodes());
+  EXPECT_EQ(2, state.getGraph().dsts.size());
+  EXPECT_THAT(edgesFrom(*id3), testing::IsEmpty());
+  EXPECT_EQ(id3, state.getNodeId(n3));
+}
+
+TEST(LinkStateTest, Holds) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  std::string n3 = "node3";
+  // adjacencies of node1 towards node2 and node3, and back
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj13 =
+      openr::createAdjacency(n3, "if3", "if1", "fe80::3", "10.0.0.3", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto adj31 =
+      openr::createAdjacency(n1, "if1", "if3", "fe80::1", "10.0.0.1", 1, 1, 1);
+
+  openr::LinkState state;
+  const openr::LinkStateMetric holdUpTtl = 2, holdDownTtl = 3;
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n1, {adj12, adj13}, 1), holdUpTtl, holdDownTtl);
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n2, {adj21}, 2), holdUpTtl, holdDownTtl);
+  EXPECT_TRUE(state.hasHolds());
+  auto const* link12 = state.linksFromNode(n2).front();
+  EXPECT_FALSE(link12->isUp());
+
+  // a tick later, hold of link 1-3 starts and metric 1-2 goes up
+  EXPECT_FALSE(state.decrementHolds());
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n3, {adj31}, 3), holdUpTtl, holdDownTtl);
+  adj12.metric = 5;
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n1, {adj12, adj13}, 1), holdUpTtl, holdDownTtl);
+  auto const* link13 = state.linksFromNode(n3).front();
+  EXPECT_FALSE(link13->isUp());
+  EXPECT_EQ(1, link12->getMetricFromNode(n1));
+
+  // each hold expires the given number of ticks after it started
+  const auto generation = state.getGeneration();
+  EXPECT_TRUE(state.decrementHolds());
+  EXPECT_LT(generation, state.getGeneration());
+  EXPECT_TRUE(link12->isUp());
+  EXPECT_FALSE(link13->isUp());
+  EXPECT_TRUE(state.decrementHolds());
+  EXPECT_TRUE(link13->isUp());
+  EXPECT_EQ(1, link12->getMetricFromNode(n1));
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_TRUE(state.decrementHolds());
+  EXPECT_EQ(5, link12->getMetricFromNode(n1));
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_FALSE(state.decrementHolds());
+
+  // holds of removed links are gone with them
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n2, {}, 2), holdUpTtl, holdDownTtl);
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n2, {adj21}, 2), holdUpTtl, holdDownTtl);
+  EXPECT_TRUE(state.hasHolds());
+  state.deleteAdjacencyDatabase(n2);
+  EXPECT_FALSE(state.hasHolds());
+}
+
+TEST(LinkStateTest, UnchangedAdjacencyDatabase) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  // adjacencies of node1 towards node2 and back
+  auto adj12 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::1", "10.0.0.1", 1, 1, 1);
+
+  openr::LinkState state;
+  state.updateAdjacencyDatabase(openr::createAdjDb(n1, {adj12}, 1), 0, 0);
+  state.updateAdjacencyDatabase(openr::createAdjDb(n2, {adj21}, 2), 0, 0);
+  EXPECT_EQ(1, state.numLinks());
+  auto const* link = state.linksFromNode(n1).front();
+
+  // new rtt and perf events only, stored without touching the graph
+  const auto generation = state.getGeneration();
+  adj12.rtt = 100;
+  auto adjDb1 = openr::createAdjDb(n1, {adj12}, 1);
+  adjDb1.perfEvents = openr::thrift::PerfEvents();
+  EXPECT_EQ(
+      std::make_pair(false, false),
+      state.updateAdjacencyDatabase(adjDb1, 0, 0));
+  EXPECT_EQ(generation, state.getGeneration());
+  EXPECT_EQ(1, state.numUnchangedAdjDbUpdates());
+  EXPECT_EQ(adjDb1, state.getAdjacencyDatabases().at(n1));
+  EXPECT_EQ(link, state.linksFromNode(n1).front());
+
+  // metric changes are applied to the link
+  adj12.metric = 5;
+  EXPECT_TRUE(
+      state.updateAdjacencyDatabase(openr::createAdjDb(n1, {adj12}, 1), 0, 0)
+          .first);
+  EXPECT_LT(generation, state.getGeneration());
+  EXPECT_EQ(1, state.numUnchangedAdjDbUpdates());
+  EXPECT_EQ(5, link->getMetricFromNode(n1));
 }
 
 int
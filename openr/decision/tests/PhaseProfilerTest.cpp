@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/decision/PhaseProfiler.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+TEST(PhaseProfilerTest, BasicOperation) {
+  PhaseProfiler profiler(10);
+  EXPECT_TRUE(profiler.finishRun().empty());
+  EXPECT_TRUE(profiler.getCounters().empty());
+
+  profiler.addDuration(RouteComputePhase::KSP2, 3us);
+  profiler.addDuration(RouteComputePhase::SPF, 5us);
+  profiler.addDuration(RouteComputePhase::SPF, 7us);
+  {
+    PhaseProfiler::ScopedPhase phase(&profiler, RouteComputePhase::LFA);
+  }
+  {
+    // null profiler is a no-op
+    PhaseProfiler::ScopedPhase phase(nullptr, RouteComputePhase::AREA_MERGE);
+  }
+
+  // phases are reported in order of their enum values
+  auto phases = profiler.finishRun();
+  ASSERT_EQ(3, phases.size());
+  EXPECT_EQ(RouteComputePhase::SPF, phases[0].first);
+  EXPECT_EQ(12us, phases[0].second);
+  EXPECT_EQ(RouteComputePhase::LFA, phases[1].first);
+  EXPECT_EQ(RouteComputePhase::KSP2, phases[2].first);
+  EXPECT_EQ(3us, phases[2].second);
+
+  // durations are reset with each run
+  profiler.addDuration(RouteComputePhase::SPF, 20us);
+  phases = profiler.finishRun();
+  ASSERT_EQ(1, phases.size());
+  EXPECT_EQ(20us, phases[0].second);
+
+  auto counters = profiler.getCounters();
+  EXPECT_EQ(12, counters.at("decision.phase.spf_us.p50"));
+  EXPECT_EQ(12, counters.at("decision.phase.spf_us.p99"));
+  EXPECT_EQ(20, counters.at("decision.phase.spf_us.max"));
+  EXPECT_EQ(3, counters.at("decision.phase.ksp2_us.max"));
+  EXPECT_EQ(1, counters.count("decision.phase.lfa_us.p50"));
+  EXPECT_EQ(0, counters.count("decision.phase.area_merge_us.p50"));
+}
+
+TEST(PhaseProfilerTest, Window) {
+  const size_t kWindowSize = 100;
+  PhaseProfiler profiler(kWindowSize);
+  for (int64_t i = 1; i <= 300; ++i) {
+    profiler.addDuration(
+        RouteComputePhase::MPLS_ROUTES, std::chrono::microseconds(i));
+    profiler.finishRun();
+  }
+
+  // only the last kWindowSize runs are taken into account
+  auto counters = profiler.getCounters();
+  EXPECT_EQ(250, counters.at("decision.phase.mpls_routes_us.p50"));
+  EXPECT_EQ(299, counters.at("decision.phase.mpls_routes_us.p99"));
+  EXPECT_EQ(300, counters.at("decision.phase.mpls_routes_us.max"));
+}
+
+TEST(PhaseProfilerTest, ConcurrentAdd) {
+  const size_t kNumThreads = 8;
+  const size_t kNumDurations = 1000;
+  PhaseProfiler profiler(10);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&profiler, kNumDurations]() {
+      for (size_t i = 0; i < kNumDurations; ++i) {
+        profiler.addDuration(RouteComputePhase::UNICAST_ROUTES, 1us);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto phases = profiler.finishRun();
+  ASSERT_EQ(1, phases.size());
+  EXPECT_EQ(
+      std::chrono::microseconds(kNumThreads * kNumDurations),
+      phases[0].second);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
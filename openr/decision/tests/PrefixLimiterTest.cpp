@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/decision/PrefixLimiter.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::PrefixDatabase
+createDb(
+    const std::string& nodeName,
+    const std::vector<std::pair<std::string, thrift::PrefixType>>& prefixes) {
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = nodeName;
+  for (auto const& kv : prefixes) {
+    prefixDb.prefixEntries.emplace_back(
+        createPrefixEntry(toIpPrefix(kv.first), kv.second));
+  }
+  return prefixDb;
+}
+
+std::set<std::string>
+getPrefixes(const thrift::PrefixDatabase& prefixDb) {
+  std::set<std::string> prefixes;
+  for (auto const& entry : prefixDb.prefixEntries) {
+    prefixes.emplace(toString(entry.prefix));
+  }
+  return prefixes;
+}
+
+const auto kLoopback = thrift::PrefixType::LOOPBACK;
+const auto kBgp = thrift::PrefixType::BGP;
+const auto kDefault = thrift::PrefixType::DEFAULT;
+
+} // namespace
+
+TEST(PrefixLimiterTest, Filters) {
+  PrefixLimits limits;
+  limits.allowedTypes = {kLoopback, kBgp};
+  limits.maxV4Length = 24;
+  EXPECT_TRUE(limits.isEnabled());
+  PrefixLimiter limiter(limits);
+
+  const auto prefixDb = createDb(
+      "node1",
+      {{"10.255.0.1/32", kLoopback},
+       {"10.0.0.0/24", kBgp},
+       {"10.1.0.0/25", kBgp},
+       {"10.2.0.0/16", kDefault}});
+  auto prefixDbs = limiter.updatePrefixDatabase(prefixDb);
+  ASSERT_EQ(1, prefixDbs.size());
+  EXPECT_EQ("node1", prefixDbs.at(0).thisNodeName);
+  EXPECT_EQ(
+      std::set<std::string>({"10.255.0.1/32", "10.0.0.0/24"}),
+      getPrefixes(prefixDbs.at(0)));
+  EXPECT_EQ(2, limiter.getNumRejected());
+
+  // rejected prefixes are counted once per node
+  limiter.updatePrefixDatabase(prefixDb);
+  EXPECT_EQ(2, limiter.getNumRejected());
+  limiter.updatePrefixDatabase(createDb("node1", {}));
+  EXPECT_EQ(0, limiter.getNumRejected());
+}
+
+TEST(PrefixLimiterTest, NodeLimit) {
+  PrefixLimits limits;
+  limits.maxPrefixesPerNode = 2;
+  limits.typePriorities = {kLoopback};
+  PrefixLimiter limiter(limits);
+
+  auto prefixDbs = limiter.updatePrefixDatabase(createDb(
+      "node1",
+      {{"10.0.2.0/24", kBgp},
+       {"10.0.1.0/24", kBgp},
+       {"10.255.0.1/32", kLoopback},
+       {"10.0.0.0/24", kBgp}}));
+  ASSERT_EQ(1, prefixDbs.size());
+  // loopback first, then the lowest prefix
+  EXPECT_EQ(
+      std::set<std::string>({"10.255.0.1/32", "10.0.0.0/24"}),
+      getPrefixes(prefixDbs.at(0)));
+  EXPECT_EQ(2, limiter.getNumOverNodeLimit());
+  EXPECT_EQ(1, limiter.getNodesOverLimit().count("node1"));
+
+  // other nodes are not affected
+  prefixDbs = limiter.updatePrefixDatabase(
+      createDb("node2", {{"10.0.1.0/24", kBgp}}));
+  ASSERT_EQ(1, prefixDbs.size());
+  EXPECT_EQ(1, prefixDbs.at(0).prefixEntries.size());
+
+  // back within the limit
+  prefixDbs = limiter.updatePrefixDatabase(createDb(
+      "node1", {{"10.255.0.1/32", kLoopback}, {"10.0.2.0/24", kBgp}}));
+  EXPECT_EQ(
+      std::set<std::string>({"10.255.0.1/32", "10.0.2.0/24"}),
+      getPrefixes(prefixDbs.at(0)));
+  EXPECT_EQ(0, limiter.getNumOverNodeLimit());
+  EXPECT_TRUE(limiter.getNodesOverLimit().empty());
+}
+
+TEST(PrefixLimiterTest, GlobalLimit) {
+  PrefixLimits limits;
+  limits.maxPrefixes = 2;
+  limits.typePriorities = {kLoopback};
+  PrefixLimiter limiter(limits);
+
+  auto prefixDbs = limiter.updatePrefixDatabase(createDb(
+      "node1", {{"10.0.0.0/24", kBgp}, {"10.0.1.0/24", kBgp}}));
+  ASSERT_EQ(1, prefixDbs.size());
+  EXPECT_EQ(2, prefixDbs.at(0).prefixEntries.size());
+  EXPECT_EQ(0, limiter.getNumOverLimit());
+
+  // the same prefix from another node takes no room
+  prefixDbs = limiter.updatePrefixDatabase(
+      createDb("node3", {{"10.0.0.0/24", kBgp}}));
+  ASSERT_EQ(1, prefixDbs.size());
+  EXPECT_EQ(1, prefixDbs.at(0).prefixEntries.size());
+
+  // a loopback of higher priority displaces the highest prefix of node1
+  prefixDbs = limiter.updatePrefixDatabase(
+      createDb("node2", {{"10.255.0.2/32", kLoopback}}));
+  ASSERT_EQ(2, prefixDbs.size());
+  EXPECT_EQ("node2", prefixDbs.at(0).thisNodeName);
+  EXPECT_EQ(1, prefixDbs.at(0).prefixEntries.size());
+  EXPECT_EQ("node1", prefixDbs.at(1).thisNodeName);
+  EXPECT_EQ(
+      std::set<std::string>({"10.0.0.0/24"}), getPrefixes(prefixDbs.at(1)));
+  EXPECT_EQ(1, limiter.getNumOverLimit());
+
+  // a prefix of lower priority waits for room
+  prefixDbs = limiter.updatePrefixDatabase(
+      createDb("node3", {{"10.0.0.0/24", kBgp}, {"10.0.2.0/24", kBgp}}));
+  ASSERT_EQ(1, prefixDbs.size());
+  EXPECT_EQ(
+      std::set<std::string>({"10.0.0.0/24"}), getPrefixes(prefixDbs.at(0)));
+  EXPECT_EQ(2, limiter.getNumOverLimit());
+
+  // withdrawing the loopback makes room for the first one waiting
+  prefixDbs = limiter.updatePrefixDatabase(createDb("node2", {}));
+  ASSERT_EQ(2, prefixDbs.size());
+  EXPECT_TRUE(prefixDbs.at(0).prefixEntries.empty());
+  EXPECT_EQ("node1", prefixDbs.at(1).thisNodeName);
+  EXPECT_EQ(2, prefixDbs.at(1).prefixEntries.size());
+  EXPECT_EQ(1, limiter.getNumOverLimit());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -32,7 +32,7 @@ class PrefixStateTestFixture : public ::testing::Test {
     for (size_t i = 0; i < numNodes; ++i) {
       std::string nodeName = std::to_string(i);
       prefixDbs_[nodeName] = createPrefixDbForNode(nodeName, i);
-      EXPECT_TRUE(state_.updatePrefixDatabase(prefixDbs_[nodeName]));
+      EXPECT_FALSE(state_.updatePrefixDatabase(prefixDbs_[nodeName]).empty());
     }
   }
 
@@ -53,30 +53,96 @@ class PrefixStateTestFixture : public ::testing::Test {
 TEST_F(PrefixStateTestFixture, basicOperation) {
   EXPECT_EQ(state_.getPrefixDatabases(), prefixDbs_);
   auto const dbEntry = *prefixDbs_.begin();
-  EXPECT_FALSE(state_.updatePrefixDatabase(dbEntry.second));
+  EXPECT_TRUE(state_.updatePrefixDatabase(dbEntry.second).empty());
 
   auto prefixDb1Updated = dbEntry.second;
   prefixDb1Updated.prefixEntries.at(0).type = thrift::PrefixType::BREEZE;
-  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated));
-  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated));
+  EXPECT_THAT(
+      state_.updatePrefixDatabase(prefixDb1Updated).all(),
+      testing::UnorderedElementsAre(
+          prefixDb1Updated.prefixEntries.at(0).prefix));
+  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
   EXPECT_EQ(prefixDb1Updated, state_.getPrefixDatabases().at(dbEntry.first));
 
   prefixDb1Updated.prefixEntries.at(0).forwardingType =
       thrift::PrefixForwardingType::SR_MPLS;
-  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated));
-  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated));
+  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
+  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
   EXPECT_EQ(prefixDb1Updated, state_.getPrefixDatabases().at(dbEntry.first));
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = dbEntry.first;
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_THAT(
+      state_.updatePrefixDatabase(emptyPrefixDb).all(),
+      testing::UnorderedElementsAre(
+          prefixDb1Updated.prefixEntries.at(0).prefix,
+          prefixDb1Updated.prefixEntries.at(1).prefix));
   auto modifiedPrefixDbs = prefixDbs_;
   modifiedPrefixDbs.erase(dbEntry.first);
   EXPECT_NE(prefixDbs_, modifiedPrefixDbs);
   EXPECT_EQ(state_.getPrefixDatabases(), modifiedPrefixDbs);
   emptyPrefixDb.thisNodeName = dbEntry.first;
-  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb));
-  EXPECT_TRUE(state_.updatePrefixDatabase(dbEntry.second));
+  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
+  EXPECT_FALSE(state_.updatePrefixDatabase(dbEntry.second).empty());
+}
+
+TEST_F(PrefixStateTestFixture, changeTracking) {
+  auto prefixDb = prefixDbs_.at("0");
+  auto const prefix1 = prefixDb.prefixEntries.at(0).prefix;
+  auto const prefix2 = prefixDb.prefixEntries.at(1).prefix;
+  auto const prefix3 = getAddrFromSeed(100, true);
+  auto const prefix4 = getAddrFromSeed(101, true);
+
+  // add two prefixes
+  prefixDb.prefixEntries.emplace_back(createPrefixEntry(prefix3));
+  prefixDb.prefixEntries.emplace_back(createPrefixEntry(prefix4));
+  auto changes = state_.updatePrefixDatabase(prefixDb);
+  EXPECT_THAT(changes.added, testing::UnorderedElementsAre(prefix3, prefix4));
+  EXPECT_TRUE(changes.updated.empty());
+  EXPECT_TRUE(changes.removed.empty());
+
+  // withdraw one prefix from the middle and update another one
+  prefixDb.prefixEntries.erase(prefixDb.prefixEntries.begin());
+  prefixDb.prefixEntries.at(1).type = thrift::PrefixType::BGP;
+  changes = state_.updatePrefixDatabase(prefixDb);
+  EXPECT_TRUE(changes.added.empty());
+  EXPECT_THAT(changes.updated, testing::UnorderedElementsAre(prefix3));
+  EXPECT_THAT(changes.removed, testing::UnorderedElementsAre(prefix1));
+  EXPECT_EQ(0, state_.prefixes().count(PrefixKey(prefix1)));
+  EXPECT_EQ(
+      thrift::PrefixType::BGP,
+      state_.prefixes().at(PrefixKey(prefix3)).at("0").type);
+
+  // remaining prefixes are still reported and can be withdrawn one by one
+  auto const dbs = state_.getPrefixDatabases();
+  EXPECT_EQ(3, dbs.at("0").prefixEntries.size());
+  prefixDb.prefixEntries.erase(prefixDb.prefixEntries.begin() + 2);
+  changes = state_.updatePrefixDatabase(prefixDb);
+  EXPECT_THAT(changes.removed, testing::UnorderedElementsAre(prefix4));
+  std::unordered_set<thrift::IpPrefix> remaining;
+  for (auto const& entry : state_.getPrefixDatabases().at("0").prefixEntries) {
+    remaining.emplace(entry.prefix);
+  }
+  EXPECT_EQ(
+      (std::unordered_set<thrift::IpPrefix>{prefix2, prefix3}), remaining);
+
+  // duplicate entries of known and new prefixes are reported once
+  auto const prefix5 = getAddrFromSeed(102, true);
+  prefixDb.prefixEntries.at(0).type = thrift::PrefixType::BREEZE;
+  prefixDb.prefixEntries.emplace_back(prefixDb.prefixEntries.at(0));
+  prefixDb.prefixEntries.back().type = thrift::PrefixType::BGP;
+  prefixDb.prefixEntries.emplace_back(createPrefixEntry(prefix5));
+  prefixDb.prefixEntries.emplace_back(prefixDb.prefixEntries.back());
+  prefixDb.prefixEntries.back().type = thrift::PrefixType::BGP;
+  changes = state_.updatePrefixDatabase(prefixDb);
+  EXPECT_THAT(changes.added, testing::ElementsAre(prefix5));
+  EXPECT_THAT(
+      changes.updated,
+      testing::ElementsAre(prefixDb.prefixEntries.at(0).prefix));
+  EXPECT_TRUE(changes.removed.empty());
+
+  // node "1" is not affected
+  EXPECT_EQ(prefixDbs_.at("1"), state_.getPrefixDatabases().at("1"));
 }
 
 class GetLoopbackViasTest : public PrefixStateTestFixture,
@@ -139,7 +205,7 @@ TEST_F(PrefixStateTestFixture, getNodeHostLoopbacksV4) {
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = "0";
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
   EXPECT_THAT(
       state_.getNodeHostLoopbacksV4(), testing::UnorderedElementsAre(pair2));
 }
@@ -155,7 +221,7 @@ TEST_F(PrefixStateTestFixture, getNodeHostLoopbacksV6) {
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = "0";
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
   EXPECT_THAT(
       state_.getNodeHostLoopbacksV6(), testing::UnorderedElementsAre(pair2));
 }
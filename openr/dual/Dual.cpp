@@ -7,6 +7,9 @@
 
 #include "openr/dual/Dual.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace openr {
 
 void
@@ -59,18 +62,49 @@ DualStateMachine::processEvent(DualEvent event, bool fc) {
   }
 }
 
+// class DualNeighbors methods
+
+size_t
+DualNeighbors::getOrAddIndex(const std::string& neighbor) {
+  auto res = indices_.emplace(neighbor, names_.size());
+  if (res.second) {
+    names_.emplace_back(neighbor);
+    localDistances_.emplace_back(std::numeric_limits<int64_t>::max());
+    hasLocalDistance_.emplace_back(false);
+  }
+  return res.first->second;
+}
+
+std::optional<size_t>
+DualNeighbors::getIndex(const std::string& neighbor) const noexcept {
+  auto it = indices_.find(neighbor);
+  if (it == indices_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void
+DualNeighbors::setLocalDistance(size_t index, int64_t distance) {
+  localDistances_.at(index) = distance;
+  if (not hasLocalDistance_[index]) {
+    hasLocalDistance_[index] = true;
+    ++numWithLocalDistance_;
+  }
+}
+
 // class Dual methods
 
 Dual::Dual(
     const std::string& nodeId,
     const std::string& rootId,
-    const std::unordered_map<std::string, int64_t>& localDistance,
+    const DualNeighbors& neighbors,
     std::function<void(
         const std::optional<std::string>& oldNh,
         const std::optional<std::string>& newNh)> nexthopChangeCb)
     : nodeId(nodeId),
       rootId(rootId),
-      localDistances_(localDistance),
+      neighbors_(neighbors),
       nexthopCb_(std::move(nexthopChangeCb)) {
   // set distance to 0 if I'm the root, otherwise default to inf
   if (rootId == nodeId) {
@@ -79,6 +113,26 @@ Dual::Dual(
     info_.feasibleDistance = 0;
     info_.nexthop = nodeId;
   }
+  syncNeighbors();
+}
+
+size_t
+Dual::getIndex(const std::string& neighbor) const {
+  auto index = neighbors_.getIndex(neighbor);
+  CHECK(index.has_value()) << rootId << "::" << nodeId
+                           << ": unknown neighbor " << neighbor;
+  return *index;
+}
+
+void
+Dual::syncNeighbors() {
+  const auto numNeighbors = neighbors_.size();
+  if (reportDistances_.size() == numNeighbors) {
+    return;
+  }
+  reportDistances_.resize(numNeighbors, std::numeric_limits<int64_t>::max());
+  expectReply_.resize(numNeighbors, false);
+  needToReply_.resize(numNeighbors, false);
 }
 
 int64_t
@@ -87,18 +141,17 @@ Dual::getMinDistance() {
     // I'm the root
     return 0;
   }
+  const auto& lds = neighbors_.getLocalDistances();
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  for (const auto& kv : localDistances_) {
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[kv.first].reportDistance;
-    dmin = std::min(dmin, addDistances(ld, rd));
+  for (size_t i = 0; i < lds.size(); ++i) {
+    dmin = std::min(dmin, addDistances(lds[i], reportDistances_[i]));
   }
   return dmin;
 }
 
 bool
 Dual::routeAffected() {
-  if (localDistances_.size() == 0) {
+  if (neighbors_.getNumWithLocalDistance() == 0) {
     // no neighbor
     return false;
   }
@@ -121,25 +174,16 @@ Dual::routeAffected() {
     return false;
   }
 
-  std::unordered_set<std::string> nexthops;
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
-    int64_t d = addDistances(ld, rd);
-    if (d == dmin) {
-      nexthops.emplace(neighbor);
-    }
-  }
-
   // nexthop MUST has value, if it's none, it will be handled in
   // above "distance changed" or "no valid route found" cases
   CHECK(info_.nexthop.has_value());
-  if (nexthops.count(*info_.nexthop) == 0) {
+  const auto nexthop = getIndex(*info_.nexthop);
+  if (addDistances(
+          neighbors_.getLocalDistances()[nexthop],
+          reportDistances_[nexthop]) != dmin) {
     // nextHop changed
-    auto oldnh = info_.nexthop.has_value() ? *info_.nexthop : "none";
-    VLOG(2) << rootId << "::" << nodeId << ": nexthop changed " << oldnh
-            << " -> " << folly::join(",", nexthops);
+    VLOG(2) << rootId << "::" << nodeId << ": nexthop changed "
+            << *info_.nexthop;
     return true;
   }
   return false;
@@ -149,15 +193,16 @@ bool
 Dual::meetFeasibleCondition(std::string& nexthop, int64_t& distance) {
   int64_t dmin = getMinDistance();
   // find feasible nexthop according to SNC(source node condition)
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
+  const auto& lds = neighbors_.getLocalDistances();
+  for (size_t i = 0; i < lds.size(); ++i) {
+    const auto ld = lds[i];
     if (ld == std::numeric_limits<int64_t>::max()) {
       // skip down neighbor
       continue;
     }
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
+    const auto rd = reportDistances_[i];
     if (rd < info_.feasibleDistance and addDistances(ld, rd) == dmin) {
+      const auto& neighbor = neighbors_.getName(i);
       VLOG(2) << rootId << "::" << nodeId << ": meet FC: " << neighbor << ", "
               << rd << ", " << dmin;
       nexthop = neighbor;
@@ -176,12 +221,13 @@ Dual::floodUpdates(
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::UPDATE;
 
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+  const auto& lds = neighbors_.getLocalDistances();
+  for (size_t i = 0; i < lds.size(); ++i) {
+    if (lds[i] == std::numeric_limits<int64_t>::max()) {
       // skip down neighbor
       continue;
     }
+    const auto& neighbor = neighbors_.getName(i);
     msgsToSend[neighbor].messages.emplace_back(msg);
     counters_[neighbor].updateSent++;
     counters_[neighbor].totalSent++;
@@ -214,9 +260,9 @@ bool
 Dual::diffusingComputation(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   // maintain current nexthop, update other fields
-  auto ld = localDistances_[*info_.nexthop];
-  auto rd = info_.neighborInfos[*info_.nexthop].reportDistance;
-  int64_t newDistance = addDistances(ld, rd);
+  const auto& lds = neighbors_.getLocalDistances();
+  const auto nexthop = getIndex(*info_.nexthop);
+  int64_t newDistance = addDistances(lds[nexthop], reportDistances_[nexthop]);
   info_.distance = newDistance;
   info_.reportDistance = newDistance;
   info_.feasibleDistance = newDistance;
@@ -229,17 +275,17 @@ Dual::diffusingComputation(
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::QUERY;
 
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+  for (size_t i = 0; i < lds.size(); ++i) {
+    if (lds[i] == std::numeric_limits<int64_t>::max()) {
       // skip down neighbor
       continue;
     }
 
+    const auto& neighbor = neighbors_.getName(i);
     msgsToSend[neighbor].messages.emplace_back(msg);
     counters_[neighbor].querySent++;
     counters_[neighbor].totalSent++;
-    info_.neighborInfos[neighbor].expectReply = true;
+    expectReply_[i] = true;
     success = true;
   }
   return success;
@@ -358,10 +404,12 @@ Dual::children() const noexcept {
 
 bool
 Dual::neighborUp(const std::string& neighbor) {
-  if (localDistances_.count(neighbor) == 0) {
+  auto index = neighbors_.getIndex(neighbor);
+  if (not index.has_value()) {
     return false;
   }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+  return neighbors_.getLocalDistances()[*index] !=
+      std::numeric_limits<int64_t>::max();
 }
 
 const Dual::RouteInfo&
@@ -405,6 +453,8 @@ Dual::peerUp(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   LOG(INFO) << rootId << "::" << nodeId << ": LINK UP event from (" << neighbor
             << ", " << cost << ")";
+  syncNeighbors();
+  const auto index = getIndex(neighbor);
 
   // reset parent, if I chose this neighbor as parent before, but I didn't
   // receive peer-down event(non-graceful shutdown), reset nexthop and distance
@@ -417,22 +467,20 @@ Dual::peerUp(
     info_.distance = std::numeric_limits<int64_t>::max();
   }
 
-  // update local-distance
-  localDistances_[neighbor] = cost;
-  info_.neighborInfos.emplace(neighbor, NeighborInfo());
+  // local-distance is updated by our node already
 
   if (info_.sm.state == DualState::PASSIVE) {
     // passive
     tryLocalOrDiffusing(DualEvent::OTHERS, false, msgsToSend);
   } else {
     // active
-    if (info_.neighborInfos[neighbor].expectReply) {
+    if (expectReply_[index]) {
       // I expected a reply from this neighbor before and it just came up
       // this is equivlent to receiving a reply
 
       thrift::DualMessage msg;
       msg.dstId = rootId;
-      msg.distance = info_.neighborInfos[neighbor].reportDistance;
+      msg.distance = reportDistances_[index];
       msg.type = thrift::DualMessageType::REPLY;
       processReply(neighbor, msg, msgsToSend);
     }
@@ -450,8 +498,8 @@ Dual::peerUp(
   counters_[neighbor].updateSent++;
   counters_[neighbor].totalSent++;
 
-  if (info_.neighborInfos[neighbor].needToReply) {
-    info_.neighborInfos.at(neighbor).needToReply = false;
+  if (needToReply_[index]) {
+    needToReply_[index] = false;
 
     thrift::DualMessage reply;
     reply.dstId = rootId;
@@ -469,16 +517,16 @@ Dual::peerDown(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   LOG(INFO) << rootId << "::" << nodeId << ": LINK DOWN event from "
             << neighbor;
+  syncNeighbors();
+  const auto index = getIndex(neighbor);
   // clear counters
   clearCounters(neighbor);
 
   // remove child
   removeChild(neighbor);
 
-  // update local-distance and report-distance
-  localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
-  info_.neighborInfos[neighbor].reportDistance =
-      std::numeric_limits<int64_t>::max();
+  // update report-distance, local-distance is updated by our node already
+  reportDistances_[index] = std::numeric_limits<int64_t>::max();
   DualEvent event = DualEvent::INCREASE_D;
 
   if (info_.sm.state == DualState::PASSIVE) {
@@ -487,7 +535,7 @@ Dual::peerDown(
   } else {
     // active
     info_.sm.processEvent(event);
-    if (info_.neighborInfos[neighbor].expectReply) {
+    if (expectReply_[index]) {
       // expecting a reply from this neighbor, but it goes down
       // equivlent to receing a reply from this guy with max-distance.
 
@@ -503,14 +551,15 @@ Dual::peerDown(
 void
 Dual::peerCostChange(
     const std::string& neighbor,
+    int64_t oldCost,
     int64_t cost,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   LOG(INFO) << rootId << "::" << nodeId << ": LINK COST event from ("
             << neighbor << ", " << cost << ")";
-  DualEvent event = cost > localDistances_[neighbor] ? DualEvent::INCREASE_D
-                                                     : DualEvent::OTHERS;
-  // update local-distance
-  localDistances_[neighbor] = cost;
+  syncNeighbors();
+  DualEvent event =
+      cost > oldCost ? DualEvent::INCREASE_D : DualEvent::OTHERS;
+  // local-distance is updated by our node already
 
   if (info_.sm.state == DualState::PASSIVE) {
     // passive
@@ -519,8 +568,8 @@ Dual::peerCostChange(
     // active
     // only update d while leaving rd, fd as-is
     if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(
-          cost, info_.neighborInfos[*info_.nexthop].reportDistance);
+      info_.distance =
+          addDistances(cost, reportDistances_[getIndex(*info_.nexthop)]);
     }
     info_.sm.processEvent(event);
   }
@@ -540,11 +589,13 @@ Dual::processUpdate(
           << ", " << rd << ")";
   counters_[neighbor].updateRecv++;
   counters_[neighbor].totalRecv++;
+  syncNeighbors();
+  const auto index = getIndex(neighbor);
 
   // update report-distance
-  info_.neighborInfos[neighbor].reportDistance = rd;
+  reportDistances_[index] = rd;
 
-  if (localDistances_.count(neighbor) == 0) {
+  if (not neighbors_.hasLocalDistance(index)) {
     // received UPDATE before having local info_ (LINK-UP), done here
     return;
   }
@@ -556,7 +607,8 @@ Dual::processUpdate(
     // active
     // only update d while leaving rd, fd as-is
     if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(localDistances_[*info_.nexthop], rd);
+      info_.distance =
+          addDistances(neighbors_.getLocalDistances()[index], rd);
     }
     info_.sm.processEvent(DualEvent::OTHERS);
   }
@@ -578,7 +630,7 @@ Dual::sendReply(
     // 2. link is up on the other end, I received a query, but I haven't
     //    received a neighbor-up event yet. set pending-reply = true so when
     //    link is up on my end, I can send out reply.
-    info_.neighborInfos[dstNode].needToReply = true;
+    needToReply_[getIndex(dstNode)] = true;
     return;
   }
 
@@ -606,9 +658,11 @@ Dual::processQuery(
           << ", " << rd << ")";
   counters_[neighbor].queryRecv++;
   counters_[neighbor].totalRecv++;
+  syncNeighbors();
+  const auto index = getIndex(neighbor);
 
   // update report-distance
-  info_.neighborInfos[neighbor].reportDistance = rd;
+  reportDistances_[index] = rd;
   info_.cornet.emplace(neighbor);
   DualEvent event = DualEvent::OTHERS;
   if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
@@ -622,8 +676,7 @@ Dual::processQuery(
     // active
     if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
       info_.distance = addDistances(
-          localDistances_[*info_.nexthop],
-          info_.neighborInfos[*info_.nexthop].reportDistance);
+          neighbors_.getLocalDistances()[index], reportDistances_[index]);
     }
     info_.sm.processEvent(event);
     sendReply(msgsToSend);
@@ -644,8 +697,10 @@ Dual::processReply(
           << ", " << reportDistance << ")";
   counters_[neighbor].replyRecv++;
   counters_[neighbor].totalRecv++;
+  syncNeighbors();
+  const auto index = getIndex(neighbor);
 
-  if (not info_.neighborInfos[neighbor].expectReply) {
+  if (not expectReply_[index]) {
     // received a reply when I don't expect to receive a reply from it
     // this is OK, this can happen when I detect link-down event before I
     // receive the reply, just ignore it.
@@ -656,17 +711,12 @@ Dual::processReply(
 
   // active
   // update report-distance and expect-reply flag
-  info_.neighborInfos[neighbor].reportDistance = reportDistance;
-  info_.neighborInfos[neighbor].expectReply = false;
+  reportDistances_[index] = reportDistance;
+  expectReply_[index] = false;
 
-  bool lastReply = true;
-  for (const auto& kv : info_.neighborInfos) {
-    if (kv.second.expectReply) {
-      lastReply = false;
-      break;
-    }
-  }
-  if (not lastReply) {
+  if (std::find(expectReply_.begin(), expectReply_.end(), true) !=
+      expectReply_.end()) {
+    // not the last reply
     return;
   }
 
@@ -675,19 +725,20 @@ Dual::processReply(
   // Therefore, I'm free to pick the optimal solution
   info_.sm.processEvent(DualEvent::LAST_REPLY, true);
 
-  int64_t d;
+  const auto& lds = neighbors_.getLocalDistances();
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  std::optional<std::string> newNh{std::nullopt};
-  for (const auto& kv : localDistances_) {
-    const auto& nb = kv.first;
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[nb].reportDistance;
-    d = addDistances(ld, rd);
+  std::optional<size_t> newNhIndex{std::nullopt};
+  for (size_t i = 0; i < lds.size(); ++i) {
+    int64_t d = addDistances(lds[i], reportDistances_[i]);
     if (d < dmin) {
       dmin = d;
-      newNh = nb;
+      newNhIndex = i;
     }
   }
+  std::optional<std::string> newNh{std::nullopt};
+  if (newNhIndex.has_value()) {
+    newNh = neighbors_.getName(*newNhIndex);
+  }
   bool sameRd = dmin == info_.reportDistance;
   info_.distance = dmin;
   info_.reportDistance = dmin;
@@ -723,7 +774,7 @@ DualNode::DualNode(const std::string& nodeId, bool isRoot)
 void
 DualNode::peerUp(const std::string& neighbor, int64_t cost) {
   // update local-distance
-  localDistances_[neighbor] = cost;
+  neighbors_.setLocalDistance(neighbors_.getOrAddIndex(neighbor), cost);
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
@@ -737,9 +788,12 @@ DualNode::peerUp(const std::string& neighbor, int64_t cost) {
 void
 DualNode::peerDown(const std::string& neighbor) {
   // update local-distance
-  localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
+  neighbors_.setLocalDistance(
+      neighbors_.getOrAddIndex(neighbor), std::numeric_limits<int64_t>::max());
   // clear counters
   clearCounters(neighbor);
+  // drop messages held back for it
+  pendingMsgs_.erase(neighbor);
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
@@ -752,13 +806,17 @@ DualNode::peerDown(const std::string& neighbor) {
 
 void
 DualNode::peerCostChange(const std::string& neighbor, int64_t cost) {
-  // update local-distance
-  localDistances_[neighbor] = cost;
+  // update local-distance, an unknown neighbor had a cost of 0
+  const auto index = neighbors_.getOrAddIndex(neighbor);
+  const int64_t oldCost = neighbors_.hasLocalDistance(index)
+      ? neighbors_.getLocalDistances()[index]
+      : 0;
+  neighbors_.setLocalDistance(index, cost);
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
   for (auto& kv : duals_) {
-    kv.second.peerCostChange(neighbor, cost, msgsToSend);
+    kv.second.peerCostChange(neighbor, oldCost, cost, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -799,6 +857,17 @@ DualNode::getSptRootId() const noexcept {
   return folly::none;
 }
 
+std::vector<std::string>
+DualNode::getSptRootIds() const noexcept {
+  std::vector<std::string> rootIds;
+  for (const auto& kv : duals_) {
+    if (kv.second.hasValidRoute()) {
+      rootIds.emplace_back(kv.first);
+    }
+  }
+  return rootIds;
+}
+
 std::unordered_set<std::string>
 DualNode::getSptPeers(const std::optional<std::string>& rootId) const noexcept {
   if (not rootId.has_value()) {
@@ -819,6 +888,7 @@ void
 DualNode::processDualMessages(const thrift::DualMessages& messages) {
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
   const auto& neighbor = messages.srcId;
+  neighbors_.getOrAddIndex(neighbor);
 
   counters_[neighbor].pktRecv++;
   counters_[neighbor].msgRecv += messages.messages.size();
@@ -902,10 +972,12 @@ DualNode::getStatusStrings() const noexcept {
 
 bool
 DualNode::neighborUp(const std::string& neighbor) const noexcept {
-  if (localDistances_.count(neighbor) == 0) {
+  auto index = neighbors_.getIndex(neighbor);
+  if (not index.has_value()) {
     return false;
   }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+  return neighbors_.getLocalDistances()[*index] !=
+      std::numeric_limits<int64_t>::max();
 }
 
 thrift::DualCounters
@@ -931,13 +1003,36 @@ DualNode::clearCounters(const std::string& neighbor) noexcept {
 void
 DualNode::sendAllDualMessages(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  const bool flushScheduled = not pendingMsgs_.empty();
   for (auto& kv : msgsToSend) {
-    const auto& neighbor = kv.first;
-    auto& msgs = kv.second;
-    if (msgs.messages.empty()) {
+    auto& msgs = kv.second.messages;
+    if (msgs.empty()) {
       // ignore empty messages
       continue;
     }
+    auto& pendingMsgs = pendingMsgs_[kv.first].messages;
+    pendingMsgs.insert(
+        pendingMsgs.end(),
+        std::make_move_iterator(msgs.begin()),
+        std::make_move_iterator(msgs.end()));
+  }
+
+  if (pendingMsgs_.empty() or flushScheduled) {
+    return;
+  }
+  if (not scheduleDualMessagesFlush()) {
+    flushDualMessages();
+  }
+}
+
+void
+DualNode::flushDualMessages() {
+  auto msgsToSend = std::move(pendingMsgs_);
+  pendingMsgs_.clear();
+
+  for (auto& kv : msgsToSend) {
+    const auto& neighbor = kv.first;
+    auto& msgs = kv.second;
 
     // set srcId = myNodeId
     msgs.srcId = nodeId;
@@ -961,7 +1056,7 @@ DualNode::addDual(const std::string& rootId) {
                        const std::optional<std::string>& newNh) {
     processNexthopChange(rootId, oldNh, newNh);
   };
-  duals_.emplace(rootId, Dual(nodeId, rootId, localDistances_, nexthopCb));
+  duals_.emplace(rootId, Dual(nodeId, rootId, neighbors_, nexthopCb));
 }
 
 } // namespace openr
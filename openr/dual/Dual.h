@@ -9,8 +9,10 @@
 
 #include <functional>
 #include <limits>
+#include <optional>
 #include <stack>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/Format.h>
 
@@ -57,6 +59,59 @@ struct DualStateMachine {
   void processEvent(DualEvent event, bool fc = true);
 };
 
+/**
+ * Neighbors of a DualNode by dense index, shared by the Duals of all of its
+ * roots so that per neighbor state of a Dual is kept in plain arrays indexed
+ * the same way. Neighbors get an index once they are heard of and keep it,
+ * a neighbor whose link is down keeps an infinite local distance.
+ */
+class DualNeighbors {
+ public:
+  // index of neighbor, added if not known yet
+  size_t getOrAddIndex(const std::string& neighbor);
+
+  // index of neighbor, none if not known
+  std::optional<size_t> getIndex(const std::string& neighbor) const noexcept;
+
+  const std::string&
+  getName(size_t index) const {
+    return names_.at(index);
+  }
+
+  // number of neighbors ever heard of
+  size_t
+  size() const noexcept {
+    return names_.size();
+  }
+
+  // local distances by index, infinite if the link is down or was never up
+  const std::vector<int64_t>&
+  getLocalDistances() const noexcept {
+    return localDistances_;
+  }
+
+  // if a link event was received for the neighbor at index
+  bool
+  hasLocalDistance(size_t index) const {
+    return hasLocalDistance_.at(index);
+  }
+
+  // number of neighbors for which a link event was received
+  size_t
+  getNumWithLocalDistance() const noexcept {
+    return numWithLocalDistance_;
+  }
+
+  void setLocalDistance(size_t index, int64_t distance);
+
+ private:
+  std::unordered_map<std::string, size_t> indices_;
+  std::vector<std::string> names_;
+  std::vector<int64_t> localDistances_;
+  std::vector<bool> hasLocalDistance_;
+  size_t numWithLocalDistance_{0};
+};
+
 /**
  * DUAL (Diffusing Update Algorithm) Node
  * details refer to: https://www.cs.cornell.edu/people/egs/615/lunes93.pdf
@@ -67,11 +122,13 @@ struct DualStateMachine {
 class Dual {
  public:
   // constructor
-  // takes nodeId, rootId, current local-distances
+  // takes nodeId, rootId, neighbors of the node along with their current
+  // local-distances. Neighbors must outlive the Dual, and all neighbors passed
+  // to its methods must be known to them
   Dual(
       const std::string& nodeId,
       const std::string& rootId,
-      const std::unordered_map<std::string, int64_t>& localDistance,
+      const DualNeighbors& neighbors,
       std::function<void(
           const std::optional<std::string>& oldNh,
           const std::optional<std::string>& newNh)> nexthopChangeCb);
@@ -92,10 +149,11 @@ class Dual {
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
   // peer cost change event
-  // input: (neighbor-id, new-link-metric)
+  // input: (neighbor-id, old-link-metric, new-link-metric)
   // output: map<neighbor-id: dual-messages-to-send>
   void peerCostChange(
       const std::string& neighbor,
+      int64_t oldCost,
       int64_t cost,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -123,16 +181,6 @@ class Dual {
       const thrift::DualMessage& reply,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
-  // Neighbor information per destination
-  struct NeighborInfo {
-    // neighbor reported distance towards destination
-    int64_t reportDistance{std::numeric_limits<int64_t>::max()};
-    // diffusing: expect receiving a reply from this neighbor or not
-    bool expectReply{false};
-    // diffusing: do I need to send a reply back to neighbor
-    bool needToReply{false};
-  };
-
   // route information per destination
   struct RouteInfo {
     // my current distance towards destination
@@ -148,8 +196,6 @@ class Dual {
     std::optional<std::string> nexthop{std::nullopt};
     // state machine
     DualStateMachine sm;
-    // neighbor exchanged information <report-distance, expect-reply-flag>
-    std::unordered_map<std::string, NeighborInfo> neighborInfos;
     // diffusing: track received query
     std::stack<std::string> cornet{};
 
@@ -274,11 +320,25 @@ class Dual {
   // clear counters to zero for a given neighbor
   void clearCounters(const std::string& neighbor) noexcept;
 
+  // index of a known neighbor
+  size_t getIndex(const std::string& neighbor) const;
+
+  // grow per neighbor state to all neighbors known by now
+  void syncNeighbors();
+
   // route-info towards root
   RouteInfo info_;
 
-  // local neighbor distances
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // neighbors of the node with their local distances
+  const DualNeighbors& neighbors_;
+
+  // neighbor exchanged information per destination, by neighbor index
+  // neighbor reported distance towards destination
+  std::vector<int64_t> reportDistances_;
+  // diffusing: expect receiving a reply from this neighbor or not
+  std::vector<bool> expectReply_;
+  // diffusing: do I need to send a reply back to neighbor
+  std::vector<bool> needToReply_;
 
   // dual messages counters map<neighbor: dual-counters>
   std::map<std::string, thrift::DualPerRootCounters> counters_;
@@ -319,6 +379,10 @@ class DualNode {
 
   virtual ~DualNode() = default;
 
+  // duals refer to our neighbors
+  DualNode(const DualNode&) = delete;
+  DualNode& operator=(const DualNode&) = delete;
+
   // subclass needs to implement this method to perform actual I/O operation
   // return true on success, otherwise false
   virtual bool sendDualMessages(
@@ -357,6 +421,9 @@ class DualNode {
   // return none if no ready SPT found
   folly::Optional<std::string> getSptRootId() const noexcept;
 
+  // all root-ids who have a valid-route, smallest first
+  std::vector<std::string> getSptRootIds() const noexcept;
+
   // get SPT-peers for a given root-id
   // return empty-set if dual for root-id is not ready
   std::unordered_set<std::string> getSptPeers(
@@ -384,14 +451,29 @@ class DualNode {
   // get dual related counters
   thrift::DualCounters getCounters() const noexcept;
 
+  // send out messages held back since scheduleDualMessagesFlush() returned
+  // true, as one batch per neighbor
+  void flushDualMessages();
+
   // myRootId
   const std::string nodeId;
 
   // I'm a root or not
   const bool isRoot{false};
 
+ protected:
+  // subclass may override this to batch outgoing messages of all roots across
+  // events, e.g. within an event loop turn. Called once messages are held
+  // back while none were pending. Return true to hold them back until
+  // flushDualMessages() is called, false to send them right away
+  virtual bool
+  scheduleDualMessagesFlush() noexcept {
+    return false;
+  }
+
  private:
-  // send out dual messages for a given <neighbor: dual-messages>
+  // send out dual messages for a given <neighbor: dual-messages>, or hold them
+  // back to be sent along with later ones
   void sendAllDualMessages(
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -401,14 +483,17 @@ class DualNode {
   // clear counters to zero for a given neighbor
   void clearCounters(const std::string& neighbor) noexcept;
 
-  // local distances map<neighbor: distance>
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // neighbors with their local distances, shared by all duals
+  DualNeighbors neighbors_;
 
   // map<root-id: Dual-object>
   std::map<std::string, Dual> duals_;
 
   // map<neighbor-id: counters>
   std::unordered_map<std::string, thrift::DualPerNeighborCounters> counters_;
+
+  // messages held back until flushDualMessages(), map<neighbor: messages>
+  std::unordered_map<std::string, thrift::DualMessages> pendingMsgs_;
 };
 
 } // namespace openr
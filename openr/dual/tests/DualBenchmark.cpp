@@ -0,0 +1,425 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+
+#include <openr/dual/Dual.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace openr {
+
+namespace {
+
+// link metric, and the metric a link is changed to by cost change events
+const int64_t kLinkCost{10};
+const int64_t kChangedLinkCost{25};
+
+class Network;
+
+// DualNode exchanging messages through the in-memory queue of a Network.
+// Like KvStoreDb it tells its SPT parent about being its child, directly
+// rather than by a FLOOD_TOPO_SET request
+class BenchmarkDualNode final : public DualNode {
+ public:
+  BenchmarkDualNode(const std::string& nodeId, bool isRoot, Network& network)
+      : DualNode(nodeId, isRoot), network_(network) {}
+
+  bool sendDualMessages(
+      const std::string& neighbor,
+      const thrift::DualMessages& msgs) noexcept override;
+
+  void processNexthopChange(
+      const std::string& rootId,
+      const std::optional<std::string>& oldNh,
+      const std::optional<std::string>& newNh) noexcept override;
+
+ private:
+  Network& network_;
+};
+
+/**
+ * Grid of gridSize x gridSize DualNodes, each linked to its horizontal and
+ * vertical neighbors. Flood roots are the first and the last node of the
+ * grid, i.e. opposite corners. Messages are delivered in the order they were
+ * sent, by converge(), in the calling thread.
+ */
+class Network {
+ public:
+  explicit Network(size_t gridSize) {
+    const auto numNodes = gridSize * gridSize;
+    for (size_t i = 0; i < numNodes; ++i) {
+      const bool isRoot = i == 0 or i == numNodes - 1;
+      nodes_.emplace_back(
+          std::make_unique<BenchmarkDualNode>(getName(i), isRoot, *this));
+      indices_.emplace(getName(i), i);
+    }
+    neighbors_.resize(numNodes);
+    for (size_t row = 0; row < gridSize; ++row) {
+      for (size_t col = 0; col < gridSize; ++col) {
+        const auto i = row * gridSize + col;
+        if (col + 1 < gridSize) {
+          addLink(i, i + 1);
+        }
+        if (row + 1 < gridSize) {
+          addLink(i, i + gridSize);
+        }
+      }
+    }
+  }
+
+  static std::string
+  getName(size_t index) {
+    return folly::sformat("node-{}", index);
+  }
+
+  size_t
+  getNumNodes() const {
+    return nodes_.size();
+  }
+
+  // first link of the first root, part of its SPT
+  size_t
+  getRootLink() const {
+    return 0;
+  }
+
+  void
+  allPeersUp() {
+    for (size_t link = 0; link < links_.size(); ++link) {
+      peerUp(link);
+    }
+  }
+
+  // link events are received by both ends at once
+  void
+  peerUp(size_t link) {
+    const auto& ends = links_.at(link);
+    nodes_[ends.first]->peerUp(getName(ends.second), kLinkCost);
+    nodes_[ends.second]->peerUp(getName(ends.first), kLinkCost);
+  }
+
+  void
+  peerDown(size_t link) {
+    const auto& ends = links_.at(link);
+    nodes_[ends.first]->peerDown(getName(ends.second));
+    nodes_[ends.second]->peerDown(getName(ends.first));
+  }
+
+  void
+  peerCostChange(size_t link, int64_t cost) {
+    const auto& ends = links_.at(link);
+    nodes_[ends.first]->peerCostChange(getName(ends.second), cost);
+    nodes_[ends.second]->peerCostChange(getName(ends.first), cost);
+  }
+
+  void
+  send(const std::string& neighbor, const thrift::DualMessages& msgs) {
+    ++numPackets;
+    numMessages += msgs.messages.size();
+    inFlight_.emplace_back(indices_.at(neighbor), msgs);
+  }
+
+  // deliver messages until none are in flight
+  void
+  converge() {
+    while (not inFlight_.empty()) {
+      auto next = std::move(inFlight_.front());
+      inFlight_.pop_front();
+      nodes_[next.first]->processDualMessages(next.second);
+    }
+  }
+
+  void
+  setChild(
+      const std::string& rootId,
+      const std::string& parent,
+      const std::string& child,
+      bool isChild) {
+    ++numTopoSetRequests;
+    auto& node = *nodes_.at(indices_.at(parent));
+    if (not node.hasDual(rootId)) {
+      return;
+    }
+    auto& dual = node.getDual(rootId);
+    const bool wasChild = dual.children().count(child) != 0;
+    if (isChild and not wasChild) {
+      dual.addChild(child);
+    } else if (not isChild and wasChild) {
+      dual.removeChild(child);
+    }
+  }
+
+  /**
+   * Number of publications sent when originator floods a key update, and the
+   * number of nodes which received it. Nodes forward a publication the first
+   * time they receive it to their flood peers except the sender, as KvStore
+   * does. With SPT flooding, flood peers are the SPT peers towards the flood
+   * root chosen by the originator, or all peers if there are none
+   */
+  std::pair<size_t, size_t>
+  flood(size_t originator, bool useSpt) const {
+    std::optional<std::string> floodRootId;
+    if (useSpt) {
+      auto rootId = nodes_.at(originator)->getSptRootId();
+      if (rootId.hasValue()) {
+        floodRootId = rootId.value();
+      }
+    }
+
+    size_t numSent{0};
+    std::vector<bool> reached(nodes_.size(), false);
+    // <node, sender>
+    std::deque<std::pair<size_t, std::optional<size_t>>> queue;
+    queue.emplace_back(originator, std::nullopt);
+    reached[originator] = true;
+    while (not queue.empty()) {
+      const auto node = queue.front().first;
+      const auto sender = queue.front().second;
+      queue.pop_front();
+      for (const auto peer : getFloodPeers(node, floodRootId)) {
+        if (sender.has_value() and *sender == peer) {
+          continue;
+        }
+        ++numSent;
+        if (not reached[peer]) {
+          reached[peer] = true;
+          queue.emplace_back(peer, node);
+        }
+      }
+    }
+    return std::make_pair(
+        numSent, std::count(reached.begin(), reached.end(), true));
+  }
+
+  // dual messages and packets sent, topology set requests made
+  size_t numMessages{0};
+  size_t numPackets{0};
+  size_t numTopoSetRequests{0};
+
+ private:
+  void
+  addLink(size_t i, size_t j) {
+    links_.emplace_back(i, j);
+    neighbors_[i].emplace_back(j);
+    neighbors_[j].emplace_back(i);
+  }
+
+  // up peers, or SPT peers of floodRootId as KvStoreDb::getFloodPeers()
+  std::vector<size_t>
+  getFloodPeers(
+      size_t node, const std::optional<std::string>& floodRootId) const {
+    const auto& dualNode = *nodes_.at(node);
+    const auto sptPeers = dualNode.getSptPeers(floodRootId);
+    std::vector<size_t> peers;
+    for (const auto peer : neighbors_.at(node)) {
+      const auto& name = getName(peer);
+      if (not dualNode.neighborUp(name)) {
+        continue;
+      }
+      if (sptPeers.empty() or sptPeers.count(name)) {
+        peers.emplace_back(peer);
+      }
+    }
+    return peers;
+  }
+
+  std::vector<std::unique_ptr<BenchmarkDualNode>> nodes_;
+  std::unordered_map<std::string, size_t> indices_;
+  std::vector<std::pair<size_t, size_t>> links_;
+  std::vector<std::vector<size_t>> neighbors_;
+  std::deque<std::pair<size_t, thrift::DualMessages>> inFlight_;
+};
+
+bool
+BenchmarkDualNode::sendDualMessages(
+    const std::string& neighbor, const thrift::DualMessages& msgs) noexcept {
+  network_.send(neighbor, msgs);
+  return true;
+}
+
+void
+BenchmarkDualNode::processNexthopChange(
+    const std::string& rootId,
+    const std::optional<std::string>& oldNh,
+    const std::optional<std::string>& newNh) noexcept {
+  if (newNh.has_value()) {
+    network_.setChild(rootId, *newNh, nodeId, true);
+  }
+  if (oldNh.has_value() and neighborUp(*oldNh)) {
+    network_.setChild(rootId, *oldNh, nodeId, false);
+  }
+}
+
+// dual messages sent by network during a measured event, per event
+struct ConvergenceStats {
+  size_t numEvents{0};
+  size_t numMessages{0};
+  size_t numPackets{0};
+  size_t numTopoSetRequests{0};
+
+  template <typename Event>
+  void
+  measure(Network& network, Event&& event) {
+    const auto numMessagesBefore = network.numMessages;
+    const auto numPacketsBefore = network.numPackets;
+    const auto numTopoSetRequestsBefore = network.numTopoSetRequests;
+    event();
+    network.converge();
+    ++numEvents;
+    numMessages += network.numMessages - numMessagesBefore;
+    numPackets += network.numPackets - numPacketsBefore;
+    numTopoSetRequests += network.numTopoSetRequests - numTopoSetRequestsBefore;
+  }
+
+  void
+  insertUserCounters(folly::UserCounters& counters) const {
+    if (numEvents == 0) {
+      return;
+    }
+    counters["dual_msgs"] = numMessages / numEvents;
+    counters["dual_pkts"] = numPackets / numEvents;
+    counters["topo_sets"] = numTopoSetRequests / numEvents;
+  }
+};
+
+std::unique_ptr<Network>
+createConvergedNetwork(size_t gridSize) {
+  auto network = std::make_unique<Network>(gridSize);
+  network->allPeersUp();
+  network->converge();
+  return network;
+}
+
+} // namespace
+
+/**
+ * SPT convergence of all nodes after all links came up
+ */
+void
+BM_DualPeerUp(folly::UserCounters& counters, uint32_t iters, size_t gridSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  ConvergenceStats stats;
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto network = std::make_unique<Network>(gridSize);
+    suspender.dismiss();
+    stats.measure(*network, [&]() { network->allPeersUp(); });
+    suspender.rehire();
+  }
+  stats.insertUserCounters(counters);
+}
+
+/**
+ * SPT convergence after a link of the SPT of a root went down. The link is
+ * brought back up between iterations, unmeasured
+ */
+void
+BM_DualPeerDown(
+    folly::UserCounters& counters, uint32_t iters, size_t gridSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto network = createConvergedNetwork(gridSize);
+  const auto link = network->getRootLink();
+  ConvergenceStats stats;
+  for (uint32_t i = 0; i < iters; ++i) {
+    suspender.dismiss();
+    stats.measure(*network, [&]() { network->peerDown(link); });
+    suspender.rehire();
+    network->peerUp(link);
+    network->converge();
+  }
+  stats.insertUserCounters(counters);
+}
+
+/**
+ * SPT convergence after the cost of a link of the SPT of a root increased.
+ * The cost is restored between iterations, unmeasured
+ */
+void
+BM_DualPeerCostChange(
+    folly::UserCounters& counters, uint32_t iters, size_t gridSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto network = createConvergedNetwork(gridSize);
+  const auto link = network->getRootLink();
+  ConvergenceStats stats;
+  for (uint32_t i = 0; i < iters; ++i) {
+    suspender.dismiss();
+    stats.measure(
+        *network, [&]() { network->peerCostChange(link, kChangedLinkCost); });
+    suspender.rehire();
+    network->peerCostChange(link, kLinkCost);
+    network->converge();
+  }
+  stats.insertUserCounters(counters);
+}
+
+/**
+ * KvStore flood fan-out of a key update originated by each node in turn, on
+ * a converged network. Reports publications sent per update, and that all
+ * nodes got it
+ */
+void
+BM_FloodFanout(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t gridSize,
+    bool useSpt) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto network = createConvergedNetwork(gridSize);
+  size_t numUpdates{0};
+  size_t numSent{0};
+  size_t numReached{0};
+  suspender.dismiss();
+  for (uint32_t i = 0; i < iters; ++i) {
+    const auto res = network->flood(i % network->getNumNodes(), useSpt);
+    ++numUpdates;
+    numSent += res.first;
+    numReached += res.second;
+  }
+  suspender.rehire();
+  CHECK_EQ(numUpdates * network->getNumNodes(), numReached)
+      << "flooding did not reach all nodes";
+  counters["publications"] = numSent / numUpdates;
+  counters["nodes"] = network->getNumNodes();
+}
+
+// The parameter is the width of the grid, e.g. 32 for 1024 nodes
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerUp, counters, 8);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerUp, counters, 16);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerUp, counters, 32);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerDown, counters, 8);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerDown, counters, 16);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerDown, counters, 32);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerCostChange, counters, 8);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerCostChange, counters, 16);
+BENCHMARK_COUNTERS_PARAM(BM_DualPeerCostChange, counters, 32);
+// flooding to all peers vs. to SPT peers only
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 8_all, 8, false);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 8_spt, 8, true);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 16_all, 16, false);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 16_spt, 16, true);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 32_all, 32, false);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FloodFanout, counters, 32_spt, 32, true);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
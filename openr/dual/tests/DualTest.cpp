@@ -15,6 +15,7 @@
 #include <folly/io/async/EventBase.h>
 #include <openr/dual/Dual.h>
 
+#include <algorithm>
 #include <vector>
 
 using namespace openr;
@@ -229,8 +230,12 @@ class DualTestNode final : public DualNode {
       const std::string& nodeId,
       bool isRoot,
       std::shared_ptr<folly::EventBase> evb,
-      std::map<std::string, std::shared_ptr<DualTestNode>>& nodes)
-      : DualNode(nodeId, isRoot), evb_(std::move(evb)), nodes_(nodes) {}
+      std::map<std::string, std::shared_ptr<DualTestNode>>& nodes,
+      bool batchMessages = false)
+      : DualNode(nodeId, isRoot),
+        evb_(std::move(evb)),
+        nodes_(nodes),
+        batchMessages_(batchMessages) {}
 
   bool
   sendDualMessages(
@@ -259,10 +264,22 @@ class DualTestNode final : public DualNode {
     return;
   }
 
+  // batch messages within an event loop turn
+  bool
+  scheduleDualMessagesFlush() noexcept override {
+    if (not batchMessages_) {
+      return false;
+    }
+    evb_->runInLoop([this]() { flushDualMessages(); });
+    return true;
+  }
+
   // event base loop
   std::shared_ptr<folly::EventBase> evb_;
   // reference to map<node-id: DualTestNode*>
   std::map<std::string, std::shared_ptr<DualTestNode>>& nodes_;
+  // hold messages back until the end of the event loop turn
+  const bool batchMessages_{false};
 };
 
 // Dual test fixture
@@ -286,8 +303,9 @@ class DualBaseFixture : public ::testing::Test {
   }
 
   void
-  addNode(const std::string& nodeId, bool isRoot) {
-    auto node = std::make_shared<DualTestNode>(nodeId, isRoot, evb, nodes);
+  addNode(const std::string& nodeId, bool isRoot, bool batchMessages = false) {
+    auto node = std::make_shared<DualTestNode>(
+        nodeId, isRoot, evb, nodes, batchMessages);
     nodes.emplace(nodeId, node);
     vertices.emplace_back(Vertex{nodeId, true});
     if (isRoot) {
@@ -653,6 +671,26 @@ class DualBaseFixture : public ::testing::Test {
     return true;
   }
 
+  // validate all nodes have a valid route towards all roots, to be used
+  // while the topology is connected
+  bool
+  validateSptRootIds() {
+    auto expectedRootIds = rootIds;
+    std::sort(expectedRootIds.begin(), expectedRootIds.end());
+    for (const auto& kv : nodes) {
+      auto& node = kv.second;
+      std::vector<std::string> sptRootIds;
+      evb->runInEventBaseThreadAndWait(
+          [&, node]() { sptRootIds = node->getSptRootIds(); });
+      if (sptRootIds != expectedRootIds) {
+        LOG(ERROR) << kv.first << " spt root-ids: "
+                   << folly::join(",", sptRootIds);
+        return false;
+      }
+    }
+    return true;
+  }
+
   // Single Link Failure Test
   // if not flap:
   // for EACH link: bring it down, wait-and-validate, bring it up,
@@ -853,7 +891,9 @@ class DualBaseFixture : public ::testing::Test {
 struct TestParam {
   int totalRoots; // number of roots
   bool flap; // flap link/node or not
-  TestParam(int totalRoots, bool flap) : totalRoots(totalRoots), flap(flap) {}
+  bool batchMessages; // batch messages within an event loop turn or not
+  TestParam(int totalRoots, bool flap, bool batchMessages = false)
+      : totalRoots(totalRoots), flap(flap), batchMessages(batchMessages) {}
 };
 
 class DualFixture : public DualBaseFixture,
@@ -869,7 +909,9 @@ INSTANTIATE_TEST_CASE_P(
         TestParam(1, false),
         TestParam(1, true),
         TestParam(2, false),
-        TestParam(2, true)));
+        TestParam(2, true),
+        TestParam(2, false, true),
+        TestParam(2, true, true)));
 
 /**
  *  Circular Topology
@@ -890,7 +932,7 @@ TEST_P(DualFixture, CircularTest) {
   // add nodes
   for (int i = 0; i < numNodes; ++i) {
     bool isRoot = i < totalRoots;
-    addNode(folly::sformat("n{}", i), isRoot);
+    addNode(folly::sformat("n{}", i), isRoot, param.batchMessages);
   }
   // add links
   for (int i = 0; i < numNodes; ++i) {
@@ -901,6 +943,7 @@ TEST_P(DualFixture, CircularTest) {
   /* sleep override */
   std::this_thread::sleep_for(syncms);
   EXPECT_TRUE(validate());
+  EXPECT_TRUE(validateSptRootIds());
 
   EXPECT_TRUE(singleLinkFailureTest(flap));
   EXPECT_TRUE(singleNodeFailureTest(flap));
@@ -926,7 +969,7 @@ TEST_P(DualFixture, FabricTest) {
 
   for (int i = 0; i < m + n; ++i) {
     bool isRoot = i < totalRoots;
-    addNode(folly::sformat("n{}", i), isRoot);
+    addNode(folly::sformat("n{}", i), isRoot, param.batchMessages);
   }
 
   for (int i = 0; i < m; ++i) {
@@ -957,7 +1000,7 @@ TEST_P(DualFixture, FullMeshTest) {
   // add nodes
   for (int i = 0; i < numNodes; ++i) {
     bool isRoot = i < totalRoots;
-    addNode(folly::sformat("n{}", i), isRoot);
+    addNode(folly::sformat("n{}", i), isRoot, param.batchMessages);
   }
 
   // add links
@@ -993,7 +1036,7 @@ TEST_P(DualFixture, GridTest) {
   // add nodes
   for (int i = 0; i < m * n; ++i) {
     bool isRoot = i < totalRoots;
-    addNode(folly::sformat("n{}", i), isRoot);
+    addNode(folly::sformat("n{}", i), isRoot, param.batchMessages);
   }
 
   // add links
@@ -7,20 +7,72 @@
 
 #include "Fib.h"
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
-#include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/MapUtil.h>
+#include <folly/futures/Future.h>
 #include <thrift/lib/cpp/protocol/TProtocolTypes.h>
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/EventLogBuffer.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
 
 namespace openr {
 
+namespace {
+
+// event name used for convergence latencies of further originating events
+const std::string kOtherPerfEvents{"OTHER"};
+
+// upper bounds of the batcher runtime knobs
+const int64_t kMaxBatchRoutes{1000000};
+const int64_t kMaxBatchConcurrency{64};
+const int64_t kMaxBatchTargetLatencyMs{60000};
+
+// unix timestamp (ms) of reception of the update by our Decision, 0 if unknown
+int64_t
+getDecisionReceivedTs(
+    const thrift::PerfEvents& perfEvents, const std::string& nodeName) {
+  for (auto const& event : perfEvents.events) {
+    if (event.eventDescr == "DECISION_RECEIVED" and
+        event.nodeName == nodeName) {
+      return event.unixTs;
+    }
+  }
+  return 0;
+}
+
+// whether nexthops forward alike. Agents may not report attributes which
+// don't affect forwarding, such as metrics
+bool
+isSameForwarding(
+    const std::vector<thrift::NextHopThrift>& lhs,
+    const std::vector<thrift::NextHopThrift>& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (auto const& nextHop : lhs) {
+    auto it = std::find_if(
+        rhs.begin(), rhs.end(), [&nextHop](const thrift::NextHopThrift& nh) {
+          return nh.address == nextHop.address and
+              nh.mplsAction == nextHop.mplsAction;
+        });
+    if (it == rhs.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
 Fib::Fib(
     std::string myNodeName,
     int32_t thriftPort,
@@ -29,20 +81,72 @@ Fib::Fib(
     bool enableOrderedFib,
     std::chrono::seconds coldStartDuration,
     bool waitOnDecision,
-    messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue,
+    messaging::RQueue<RouteUpdate> routeUpdatesQueue,
     messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
     const MonitorSubmitUrl& monitorSubmitUrl,
     const KvStoreLocalCmdUrl& storeCmdUrl,
     const KvStoreLocalPubUrl& storePubUrl,
-    fbzmq::Context& zmqContext)
-    : myNodeName_(std::move(myNodeName)),
+    fbzmq::Context& zmqContext,
+    bool prioritizeHostRoutes,
+    const std::vector<thrift::IpPrefix>& priorityPrefixes,
+    size_t routeTraceBufferSize,
+    bool enableWarmBoot,
+    size_t convergenceTraceBufferSize,
+    uint32_t convergenceTraceSampleRate,
+    const std::string& routeExportPath,
+    FibBatcher::Config const& batcherConfig,
+    RuntimeKnobs* runtimeKnobs,
+    folly::Optional<PlatformPublisherUrl> const& platformPubUrl)
+    : routeDbSnapshots_(myNodeName),
+      routeTrace_(routeTraceBufferSize),
+      convergenceTrace_(convergenceTraceBufferSize, convergenceTraceSampleRate),
+      myNodeName_(std::move(myNodeName)),
       thriftPort_(thriftPort),
       dryrun_(dryrun),
       enableSegmentRouting_(enableSegmentRouting),
       enableOrderedFib_(enableOrderedFib),
       coldStartDuration_(coldStartDuration),
+      prioritizeHostRoutes_(prioritizeHostRoutes),
+      enableWarmBoot_(enableWarmBoot),
       expBackoff_(
-          std::chrono::milliseconds(8), std::chrono::milliseconds(4096)) {
+          std::chrono::milliseconds(8), std::chrono::milliseconds(4096)),
+      batcher_(batcherConfig) {
+  for (auto const& prefix : priorityPrefixes) {
+    priorityPrefixes_.emplace_back(toIPNetwork(prefix));
+  }
+
+  batchMinRoutes_ = RuntimeKnobs::Knob(batcherConfig.minBatchSize);
+  batchMaxRoutes_ = RuntimeKnobs::Knob(batcherConfig.maxBatchSize);
+  batchMaxConcurrency_ = RuntimeKnobs::Knob(batcherConfig.maxConcurrency);
+  batchTargetLatencyMs_ =
+      RuntimeKnobs::Knob(batcherConfig.targetLatency.count());
+  if (runtimeKnobs) {
+    batchMinRoutes_ = runtimeKnobs->addKnob(
+        "fib.batch_min_routes",
+        "Min routes per FIB agent call when batching",
+        batcherConfig.minBatchSize,
+        1,
+        kMaxBatchRoutes);
+    batchMaxRoutes_ = runtimeKnobs->addKnob(
+        "fib.batch_max_routes",
+        "Max routes per FIB agent call, unbounded if 0",
+        batcherConfig.maxBatchSize,
+        0,
+        kMaxBatchRoutes);
+    batchMaxConcurrency_ = runtimeKnobs->addKnob(
+        "fib.batch_max_concurrency",
+        "Max concurrent FIB agent calls when batching",
+        batcherConfig.maxConcurrency,
+        1,
+        kMaxBatchConcurrency);
+    batchTargetLatencyMs_ = runtimeKnobs->addKnob(
+        "fib.batch_target_latency_ms",
+        "FIB agent call latency above which batches shrink",
+        batcherConfig.targetLatency.count(),
+        1,
+        kMaxBatchTargetLatencyMs);
+  }
+
   syncRoutesTimer_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
     if (routeState_.hasRoutesFromDecision) {
       if (syncRouteDb()) {
@@ -57,6 +161,24 @@ Fib::Fib(
     }
   });
 
+  staleRoutesTimer_ = fbzmq::ZmqTimeout::make(
+      getEvb(), [this]() noexcept { deleteStaleRoutes(); });
+
+  if (not routeExportPath.empty()) {
+    try {
+      routeDbExporter_ = std::make_unique<RouteDbExporter>(routeExportPath);
+      routeDbExportThrottle_ = std::make_unique<fbzmq::ZmqThrottle>(
+          getEvb(), Constants::kRouteDbExportThrottle, [this]() noexcept {
+            exportRouteDb();
+          });
+      exportRouteDb();
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Route database export disabled: "
+                 << folly::exceptionStr(e);
+      routeDbExporter_.reset();
+    }
+  }
+
   if (enableOrderedFib_) {
     kvStoreClient_ = std::make_unique<KvStoreClient>(
         zmqContext, this, myNodeName_, storeCmdUrl, storePubUrl);
@@ -115,6 +237,12 @@ Fib::Fib(
     }
   });
 
+  // Neighbor events from NetlinkAgent, to prune nexthops whose neighbor
+  // can't be resolved anymore while their interface is up
+  if (platformPubUrl) {
+    subscribeNeighborEvents(zmqContext, *platformPubUrl);
+  }
+
   // Schedule periodic timer for submission to monitor
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
@@ -123,62 +251,48 @@ Fib::Fib(
       getEvb(), [this]() noexcept { submitCounters(); });
   monitorTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval, isPeriodic);
 
-  // Initialize stats keys
+  // Initialize stats keys, those of route programming without the string
+  // keyed lookups of tData_
+  coalescedRouteUpdatesStat_ =
+      stats_.addStat("fib.coalesced_route_updates", {fbzmq::COUNT});
+  numOfRouteUpdatesStat_ =
+      stats_.addStat("fib.num_of_route_updates", {fbzmq::SUM});
+  processRouteDbStat_ = stats_.addStat("fib.process_route_db", {fbzmq::COUNT});
+  addDelRouteFailuresStat_ =
+      stats_.addStat("fib.thrift.failure.add_del_route", {fbzmq::COUNT});
   tData_.addStatExportType("fib.convergence_time_ms", fbzmq::AVG);
   tData_.addStatExportType("fib.local_route_program_time_ms", fbzmq::AVG);
-  tData_.addStatExportType("fib.num_of_route_updates", fbzmq::SUM);
+  tData_.addStatExportType("fib.num_stale_routes_deleted", fbzmq::SUM);
   tData_.addStatExportType("fib.process_interface_db", fbzmq::COUNT);
-  tData_.addStatExportType("fib.process_route_db", fbzmq::COUNT);
+  tData_.addStatExportType("fib.route_db_export_failure", fbzmq::COUNT);
+  tData_.addStatExportType("fib.route_db_export_ms", fbzmq::AVG);
   tData_.addStatExportType("fib.sync_fib_calls", fbzmq::COUNT);
-  tData_.addStatExportType("fib.thrift.failure.add_del_route", fbzmq::COUNT);
+  tData_.addStatExportType(
+      "fib.thrift.failure.delete_stale_routes", fbzmq::COUNT);
   tData_.addStatExportType("fib.thrift.failure.keepalive", fbzmq::COUNT);
   tData_.addStatExportType("fib.thrift.failure.sync_fib", fbzmq::COUNT);
+  tData_.addStatExportType("fib.warm_boot_programmed_routes", fbzmq::SUM);
 }
 
 std::optional<thrift::IpPrefix>
 Fib::longestPrefixMatch(
-    const folly::CIDRNetwork& inputPrefix,
-    const std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute>&
-        unicastRoutes) {
-  std::optional<thrift::IpPrefix> matchedPrefix;
-  uint8_t maxMask = 0;
-  const auto& inputIP = inputPrefix.first;
-  const auto& inputMask = inputPrefix.second;
-
-  // longest prefix matching
-  for (const auto& route : unicastRoutes) {
-    const auto& dbIP = toIPAddress(route.first.prefixAddress);
-    const auto& dbMask = route.first.prefixLength;
-
-    if (maxMask < dbMask && inputMask >= dbMask &&
-        inputIP.mask(dbMask) == dbIP) {
-      maxMask = dbMask;
-      matchedPrefix = route.first;
-    }
-  }
-  return matchedPrefix;
+    const folly::CIDRNetwork& inputPrefix, const PrefixTrie& unicastPrefixes) {
+  return unicastPrefixes.longestPrefixMatch(inputPrefix);
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 Fib::getRouteDb() {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), this]() mutable {
-    thrift::RouteDatabase routeDb;
-    routeDb.thisNodeName = myNodeName_;
-    for (const auto& route : routeState_.unicastRoutes) {
-      routeDb.unicastRoutes.emplace_back(route.second);
-    }
-    for (const auto& route : routeState_.mplsRoutes) {
-      routeDb.mplsRoutes.emplace_back(route.second);
-    }
-    p.setValue(std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
-  });
-  return sf;
+  return folly::makeSemiFuture(std::make_unique<thrift::RouteDatabase>(
+      routeDbSnapshots_.get()->toRouteDatabase()));
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
 Fib::getUnicastRoutes(std::vector<std::string> prefixes) {
+  if (prefixes.empty()) {
+    return folly::makeSemiFuture(
+        std::make_unique<std::vector<thrift::UnicastRoute>>(
+            routeDbSnapshots_.get()->getUnicastRoutes()));
+  }
   folly::Promise<std::unique_ptr<std::vector<thrift::UnicastRoute>>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread(
@@ -191,6 +305,11 @@ Fib::getUnicastRoutes(std::vector<std::string> prefixes) {
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::MplsRoute>>>
 Fib::getMplsRoutes(std::vector<int32_t> labels) {
+  if (labels.empty()) {
+    return folly::makeSemiFuture(
+        std::make_unique<std::vector<thrift::MplsRoute>>(
+            routeDbSnapshots_.get()->getMplsRoutes()));
+  }
   folly::Promise<std::unique_ptr<std::vector<thrift::MplsRoute>>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread(
@@ -211,6 +330,45 @@ Fib::getPerfDb() {
   return sf;
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::PerfHistograms>>
+Fib::getPerfHistograms() {
+  folly::Promise<std::unique_ptr<thrift::PerfHistograms>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    p.setValue(std::make_unique<thrift::PerfHistograms>(dumpPerfHistograms()));
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+Fib::getRouteTrace() {
+  folly::Promise<std::unique_ptr<thrift::RouteTraceDatabase>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    auto routeTraceDb = std::make_unique<thrift::RouteTraceDatabase>();
+    routeTraceDb->thisNodeName = myNodeName_;
+    routeTraceDb->entries = routeTrace_.dump();
+    routeTraceDb->numRecorded = routeTrace_.getNumRecorded();
+    p.setValue(std::move(routeTraceDb));
+  });
+  return sf;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::ConvergenceTraceDatabase>>
+Fib::getConvergenceTrace() {
+  folly::Promise<std::unique_ptr<thrift::ConvergenceTraceDatabase>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), this]() mutable {
+    auto traceDb = std::make_unique<thrift::ConvergenceTraceDatabase>();
+    traceDb->thisNodeName = myNodeName_;
+    traceDb->entries = convergenceTrace_.dump();
+    traceDb->numRecorded = convergenceTrace_.getNumRecorded();
+    traceDb->sampleRate = convergenceTrace_.getSampleRate();
+    p.setValue(std::move(traceDb));
+  });
+  return sf;
+}
+
 std::vector<thrift::UnicastRoute>
 Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
   // return and send the vector<thrift::UnicastRoute>
@@ -221,7 +379,7 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
   // if the params is empty, return all routes
   if (prefixes.empty()) {
     for (const auto& routes : routeState_.unicastRoutes) {
-      retRouteVec.emplace_back(routes.second);
+      retRouteVec.emplace_back(*routes.second);
     }
     return retRouteVec;
   }
@@ -239,7 +397,7 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
 
     // do longest prefix match, add the matched prefix to the result set
     const auto& matchedPrefix =
-        Fib::longestPrefixMatch(inputPrefix, routeState_.unicastRoutes);
+        Fib::longestPrefixMatch(inputPrefix, routeState_.unicastPrefixes);
     if (matchedPrefix.has_value()) {
       matchPrefixSet.insert(matchedPrefix.value());
     }
@@ -247,7 +405,7 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
 
   // get the routes from the prefix set
   for (const auto& prefix : matchPrefixSet) {
-    retRouteVec.emplace_back(routeState_.unicastRoutes.at(prefix));
+    retRouteVec.emplace_back(*routeState_.unicastRoutes.at(PrefixKey(prefix)));
   }
 
   return retRouteVec;
@@ -283,53 +441,99 @@ Fib::getMplsRoutesFiltered(std::vector<int32_t> labels) {
 }
 
 void
-Fib::processRouteUpdates(thrift::RouteDatabaseDelta&& routeDelta) {
+Fib::processRouteUpdates(RouteUpdate&& routeUpdate) {
   routeState_.hasRoutesFromDecision = true;
   // Update perfEvents_ .. We replace existing perf events with new one as
   // convergence is going to be based on new data, not the old.
-  if (routeDelta.perfEvents) {
-    addPerfEvent(*routeDelta.perfEvents, myNodeName_, "FIB_ROUTE_DB_RECVD");
+  if (routeUpdate.perfEvents) {
+    addPerfEvent(*routeUpdate.perfEvents, myNodeName_, "FIB_ROUTE_DB_RECVD");
   }
 
   // Before anything, get rid of doNotInstall routes
-  auto i = routeDelta.unicastRoutesToUpdate.begin();
-  while (i != routeDelta.unicastRoutesToUpdate.end()) {
-    if (i->doNotInstall) {
-      LOG(INFO) << "Not installing route for prefix " << toString(i->dest);
-      i = routeDelta.unicastRoutesToUpdate.erase(i);
+  auto i = routeUpdate.unicastRoutesToUpdate.begin();
+  while (i != routeUpdate.unicastRoutesToUpdate.end()) {
+    if ((*i)->doNotInstall) {
+      LOG(INFO) << "Not installing route for prefix " << toString((*i)->dest);
+      i = routeUpdate.unicastRoutesToUpdate.erase(i);
     } else {
       ++i;
     }
   }
 
-  // Add/Update unicast routes to update
-  for (const auto& route : routeDelta.unicastRoutesToUpdate) {
-    routeState_.unicastRoutes[route.dest] = route;
-    routeState_.dirtyPrefixes.erase(route.dest);
+  // Add/Update unicast routes to update. Route records are shared with
+  // Decision, not copied
+  for (const auto& route : routeUpdate.unicastRoutesToUpdate) {
+    const PrefixKey destKey(route->dest);
+    routeState_.unicastRoutes[destKey] = route;
+    routeState_.unicastPrefixes.insert(route->dest);
+    routeState_.unicastNextHopGroups.updateRoute(route->dest, route->nextHops);
+    routeState_.dirtyPrefixes.erase(destKey);
+    routeState_.staleUnicastPrefixes.erase(route->dest);
   }
 
   // Add mpls routes to update
-  for (const auto& route : routeDelta.mplsRoutesToUpdate) {
+  for (const auto& routePtr : routeUpdate.mplsRoutesToUpdate) {
+    const auto& route = *routePtr;
+    auto mplsIt = routeState_.mplsRoutes.find(route.topLabel);
+    if (mplsIt != routeState_.mplsRoutes.end()) {
+      updateMplsInterfaceIndex(mplsIt->second, false /* add */);
+    }
+    updateMplsInterfaceIndex(route, true /* add */);
     routeState_.mplsRoutes[route.topLabel] = route;
     routeState_.dirtyLabels.erase(route.topLabel);
+    routeState_.staleLabels.erase(route.topLabel);
   }
 
   // Delete unicast routes
-  for (const auto& dest : routeDelta.unicastRoutesToDelete) {
-    routeState_.unicastRoutes.erase(dest);
-    routeState_.dirtyPrefixes.erase(dest);
+  for (const auto& dest : routeUpdate.unicastRoutesToDelete) {
+    const PrefixKey destKey(dest);
+    routeState_.unicastRoutes.erase(destKey);
+    routeState_.unicastPrefixes.erase(dest);
+    routeState_.unicastNextHopGroups.deleteRoute(dest);
+    routeState_.dirtyPrefixes.erase(destKey);
   }
 
   // Delete mpls routes
-  for (const auto& topLabel : routeDelta.mplsRoutesToDelete) {
-    routeState_.mplsRoutes.erase(topLabel);
+  for (const auto& topLabel : routeUpdate.mplsRoutesToDelete) {
+    auto mplsIt = routeState_.mplsRoutes.find(topLabel);
+    if (mplsIt != routeState_.mplsRoutes.end()) {
+      updateMplsInterfaceIndex(mplsIt->second, false /* add */);
+      routeState_.mplsRoutes.erase(topLabel);
+    }
     routeState_.dirtyLabels.erase(topLabel);
   }
 
+  // Publish routes for readers on other threads
+  routeDbSnapshots_.publish(routeUpdate);
+  if (routeDbExportThrottle_) {
+    (*routeDbExportThrottle_)();
+  }
+
   // Add some counters
-  tData_.addStatValue("fib.process_route_db", 1, fbzmq::COUNT);
-  // Send request to agent
-  updateRoutes(routeDelta);
+  processRouteDbStat_.addValue(1);
+  // Send request to agent, which takes copies of the routes
+  updateRoutes(routeUpdate.toThrift());
+}
+
+void
+Fib::exportRouteDb() noexcept {
+  if (not routeDbExporter_) {
+    return;
+  }
+  try {
+    const auto startTime = std::chrono::steady_clock::now();
+    routeDbExporter_->publish(*routeDbSnapshots_.get());
+    tData_.addStatValue(
+        "fib.route_db_export_ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count(),
+        fbzmq::AVG);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to export route database to "
+               << routeDbExporter_->getPath() << ": " << folly::exceptionStr(e);
+    tData_.addStatValue("fib.route_db_export_failure", 1, fbzmq::COUNT);
+  }
 }
 
 void
@@ -341,8 +545,27 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
   }
 
   //
-  // Update interface states
+  // Update interface states. Deltas only carry changed interfaces, removed
+  // ones are considered down
   //
+  if (interfaceDb.isDelta and interfaceDb.seqNum != interfaceDbSeqNum_ + 1) {
+    LOG(WARNING) << "Interface update " << interfaceDb.seqNum
+                 << " doesn't follow " << interfaceDbSeqNum_
+                 << ", applying it regardless";
+    tData_.addStatValue("fib.interface_db.seq_gap", 1, fbzmq::SUM);
+  }
+  interfaceDbSeqNum_ = interfaceDb.seqNum;
+
+  // interfaces which went up or down, only routes through them are affected
+  std::unordered_set<std::string> changedIfNames;
+  for (auto const& ifName : interfaceDb.deletedInterfaces) {
+    if (folly::get_default(interfaceStatusDb_, ifName, false)) {
+      LOG(INFO) << "Interface " << ifName << " removed while UP";
+      changedIfNames.emplace(ifName);
+    }
+    interfaceStatusDb_.erase(ifName);
+  }
+
   for (auto const& kv : interfaceDb.interfaces) {
     const auto& ifName = kv.first;
     const auto isUp = kv.second.isUp;
@@ -357,74 +580,192 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
       LOG(INFO) << "Interface " << ifName << " transitioned from DOWN -> UP";
     }
 
+    if (wasUp != isUp) {
+      changedIfNames.emplace(ifName);
+    }
+
     // Update new status
     interfaceStatusDb_[ifName] = isUp;
   }
 
+  // neighbors are resolved again once interface is back
+  for (auto const& ifName : changedIfNames) {
+    failedNeighbors_.erase(ifName);
+  }
+
   thrift::RouteDatabaseDelta routeDbDelta;
   routeDbDelta.perfEvents = std::move(interfaceDb.perfEvents);
+  updateRoutesOfInterfaces(changedIfNames, routeDbDelta);
 
-  //
-  // Compute unicast route changes
-  //
-  for (auto const& kv : routeState_.unicastRoutes) {
-    auto const& route = kv.second;
-
-    // Find valid nexthops for route
-    std::vector<thrift::NextHopThrift> validNextHops;
-    for (auto const& nextHop : route.nextHops) {
-      const auto& ifName = nextHop.address.ifName;
-      CHECK(ifName.hasValue());
-      if (folly::get_default(interfaceStatusDb_, *ifName, false)) {
-        validNextHops.emplace_back(nextHop);
-      }
-    } // end for ... kv.second
+  // Routes are swapped to their remaining nexthops in one batch, programmed
+  // ahead of pending updates from Decision
+  updateRoutes(routeDbDelta, true /* isLocalRepair */);
+}
 
-    // Find previous best nexthops
-    auto prevBestNextHops = getBestNextHopsUnicast(route.nextHops);
+void
+Fib::subscribeNeighborEvents(
+    fbzmq::Context& zmqContext, std::string const& platformPubUrl) {
+  VLOG(2) << "Connect to PlatformPublisher to subscribe NeighborEvent on "
+          << platformPubUrl;
+  nlEventSub_ = std::make_unique<fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT>>(
+      zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true});
+  const auto neighborEventType =
+      static_cast<uint16_t>(thrift::PlatformEventType::NEIGHBOR_EVENT);
+  const auto subOpt = nlEventSub_->setSockOpt(
+      ZMQ_SUBSCRIBE, &neighborEventType, sizeof(uint16_t));
+  if (subOpt.hasError()) {
+    LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << neighborEventType
+               << " " << subOpt.error();
+  }
+  const auto nlSub = nlEventSub_->connect(fbzmq::SocketUrl{platformPubUrl});
+  if (nlSub.hasError()) {
+    LOG(FATAL) << "Error connecting to URL '" << platformPubUrl << "' "
+               << nlSub.error();
+  }
 
-    // Find new valid best nexthops
-    auto validBestNextHops = getBestNextHopsUnicast(validNextHops);
+  addSocket(
+      fbzmq::RawZmqSocketPtr{**nlEventSub_}, ZMQ_POLLIN, [this](int) noexcept {
+        fbzmq::Message eventHeader, eventData;
+        const auto ret = nlEventSub_->recvMultiple(eventHeader, eventData);
+        if (ret.hasError()) {
+          LOG(ERROR) << "Error processing PlatformPublisher event "
+                     << "publication, exception: " << ret.error();
+          return;
+        }
+
+        auto eventMsg =
+            eventData.readThriftObj<thrift::PlatformEvent>(serializer_);
+        if (eventMsg.hasError() or
+            eventMsg->eventType != thrift::PlatformEventType::NEIGHBOR_EVENT) {
+          LOG(ERROR) << "Error in reading publication eventData";
+          return;
+        }
+
+        try {
+          processNeighborEvent(
+              fbzmq::util::readThriftObjStr<thrift::NeighborEntry>(
+                  eventMsg->eventData, serializer_));
+        } catch (std::exception const& e) {
+          LOG(ERROR) << "Error parsing neighborEvt. Reason: "
+                     << folly::exceptionStr(e);
+        }
+      });
+}
 
-    // Remove route if no valid nexthops
-    if (not validBestNextHops.size()) {
-      VLOG(1) << "Removing prefix " << toString(route.dest)
-              << " because of no valid nextHops.";
-      routeDbDelta.unicastRoutesToDelete.emplace_back(route.dest);
-      routeState_.dirtyPrefixes.emplace(route.dest); // Mark prefix as dirty
-      continue; // Skip rest
+void
+Fib::processNeighborEvent(thrift::NeighborEntry const& neighbor) {
+  const auto& ifName = neighbor.ifName;
+  const auto address = toIPAddress(neighbor.destination);
+
+  // Track failed resolution of neighbors on interfaces we have routes through
+  bool changed{false};
+  if (neighbor.isFailed) {
+    if (not folly::get_default(interfaceStatusDb_, ifName, false)) {
+      return;
+    }
+    changed = failedNeighbors_[ifName].emplace(address).second;
+  } else {
+    auto it = failedNeighbors_.find(ifName);
+    if (it != failedNeighbors_.end()) {
+      changed = it->second.erase(address);
+      if (it->second.empty()) {
+        failedNeighbors_.erase(it);
+      }
     }
+  }
+  if (not changed) {
+    return;
+  }
 
-    if (validBestNextHops != prevBestNextHops) {
-      // Nexthop group shrink
-      VLOG(1) << "bestPaths group resize for prefix: " << toString(route.dest)
-              << ", old: " << prevBestNextHops.size()
-              << ", new: " << validBestNextHops.size();
-      thrift::UnicastRoute newRoute;
-      newRoute.dest = route.dest;
-      newRoute.nextHops = std::move(validBestNextHops);
-      routeDbDelta.unicastRoutesToUpdate.emplace_back(std::move(newRoute));
-      routeState_.dirtyPrefixes.emplace(route.dest); // Mark prefix as dirty
-    } else if (routeState_.dirtyPrefixes.count(route.dest)) {
-      // Nexthop group restore - previously best
-      routeDbDelta.unicastRoutesToUpdate.emplace_back(route);
-      routeState_.dirtyPrefixes.erase(route.dest); // Remove from dirty list
+  VLOG(1) << "Neighbor " << address.str() << " on " << ifName << " is "
+          << (neighbor.isFailed ? "unreachable" : "reachable again");
+
+  // Only routes through the interface of neighbor are looked at
+  thrift::RouteDatabaseDelta routeDbDelta;
+  updateRoutesOfInterfaces({ifName}, routeDbDelta);
+  const auto numRoutes = routeDbDelta.unicastRoutesToUpdate.size() +
+      routeDbDelta.unicastRoutesToDelete.size() +
+      routeDbDelta.mplsRoutesToUpdate.size() +
+      routeDbDelta.mplsRoutesToDelete.size();
+  if (numRoutes == 0) {
+    // not a best nexthop of any route, forget it right away
+    if (neighbor.isFailed) {
+      auto it = failedNeighbors_.find(ifName);
+      it->second.erase(address);
+      if (it->second.empty()) {
+        failedNeighbors_.erase(it);
+      }
     }
-  } // end for ... routeDb_.unicastRoutes
+    return;
+  }
+
+  LOG(INFO) << (neighbor.isFailed ? "Pruning" : "Restoring") << " nexthop "
+            << address.str() << " on " << ifName << " in " << numRoutes
+            << " routes";
+  tData_.addStatValue(
+      neighbor.isFailed ? "fib.neighbor_down_repairs"
+                        : "fib.neighbor_up_restores",
+      1,
+      fbzmq::SUM);
+  tData_.addStatValue("fib.neighbor_repair_routes", numRoutes, fbzmq::SUM);
+
+  // Same as interface going down, ahead of pending updates from Decision
+  updateRoutes(routeDbDelta, true /* isLocalRepair */);
+}
+
+void
+Fib::updateRoutesOfInterfaces(
+    std::unordered_set<std::string> const& ifNames,
+    thrift::RouteDatabaseDelta& routeDbDelta) {
+  //
+  // Compute unicast route changes. Routes of a next-hop group share their
+  // valid nexthops, which are found once per group. Only groups with a
+  // nexthop on one of the interfaces are looked at
+  //
+  routeState_.unicastNextHopGroups.forEachGroupOfInterfaces(
+      ifNames,
+      [&](std::vector<thrift::NextHopThrift> const& nextHops,
+          NextHopGroups::Group const& group) {
+        // Find valid nexthops for group
+        std::vector<thrift::NextHopThrift> validNextHops;
+        for (auto const& nextHop : nextHops) {
+          CHECK(nextHop.address.ifName.hasValue());
+          if (isNextHopValid(nextHop)) {
+            validNextHops.emplace_back(nextHop);
+          }
+        } // end for ... nextHops
+
+        // Previous and new valid best nexthops
+        auto const& prevBestNextHops = group.bestNextHops;
+        const auto validBestNextHops = getBestNextHopsUnicast(validNextHops);
+
+        for (auto const& prefix : group.prefixes) {
+          updateUnicastRouteNextHops(
+              *routeState_.unicastRoutes.at(PrefixKey(prefix)),
+              prevBestNextHops,
+              validBestNextHops,
+              routeDbDelta);
+        }
+      });
 
   //
   // Compute MPLS route changes
   //
-  for (const auto& kv : routeState_.mplsRoutes) {
-    const auto& route = kv.second;
+  std::unordered_set<uint32_t> affectedLabels;
+  for (auto const& ifName : ifNames) {
+    auto it = routeState_.mplsLabelsByInterface.find(ifName);
+    if (it != routeState_.mplsLabelsByInterface.end()) {
+      affectedLabels.insert(it->second.begin(), it->second.end());
+    }
+  }
+  for (const auto topLabel : affectedLabels) {
+    const auto& route = routeState_.mplsRoutes.at(topLabel);
 
     // Find valid nexthops for route
     std::vector<thrift::NextHopThrift> validNextHops;
     for (auto const& nextHop : route.nextHops) {
       // We don't have ifName for `POP_AND_LOOKUP` mpls action
-      auto const& ifName = nextHop.address.ifName;
-      if (not ifName.hasValue() or
-          folly::get_default(interfaceStatusDb_, *ifName, false)) {
+      if (not nextHop.address.ifName.hasValue() or isNextHopValid(nextHop)) {
         validNextHops.emplace_back(nextHop);
       }
     }
@@ -459,9 +800,72 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
       routeDbDelta.mplsRoutesToUpdate.emplace_back(route);
       routeState_.dirtyLabels.erase(route.topLabel); // Remove from dirty list
     }
-  } // end for ... routeDb_.mplsRoutes
+  } // end for ... affectedLabels
+}
 
-  updateRoutes(routeDbDelta);
+bool
+Fib::isNextHopValid(thrift::NextHopThrift const& nextHop) const {
+  const auto& ifName = nextHop.address.ifName.value();
+  if (not folly::get_default(interfaceStatusDb_, ifName, false)) {
+    return false;
+  }
+  auto it = failedNeighbors_.find(ifName);
+  return it == failedNeighbors_.end() or
+      not it->second.count(toIPAddress(nextHop.address));
+}
+
+void
+Fib::updateUnicastRouteNextHops(
+    thrift::UnicastRoute const& route,
+    std::vector<thrift::NextHopThrift> const& prevBestNextHops,
+    std::vector<thrift::NextHopThrift> const& validBestNextHops,
+    thrift::RouteDatabaseDelta& routeDbDelta) {
+  // Remove route if no valid nexthops
+  if (not validBestNextHops.size()) {
+    VLOG(1) << "Removing prefix " << toString(route.dest)
+            << " because of no valid nextHops.";
+    routeDbDelta.unicastRoutesToDelete.emplace_back(route.dest);
+    // Mark prefix as dirty
+    routeState_.dirtyPrefixes.emplace(PrefixKey(route.dest));
+    return;
+  }
+
+  if (validBestNextHops != prevBestNextHops) {
+    // Nexthop group shrink
+    VLOG(1) << "bestPaths group resize for prefix: " << toString(route.dest)
+            << ", old: " << prevBestNextHops.size()
+            << ", new: " << validBestNextHops.size();
+    thrift::UnicastRoute newRoute;
+    newRoute.dest = route.dest;
+    newRoute.nextHops = validBestNextHops;
+    routeDbDelta.unicastRoutesToUpdate.emplace_back(std::move(newRoute));
+    // Mark prefix as dirty
+    routeState_.dirtyPrefixes.emplace(PrefixKey(route.dest));
+  } else if (routeState_.dirtyPrefixes.erase(PrefixKey(route.dest))) {
+    // Nexthop group restore - previously best, removed from dirty list
+    routeDbDelta.unicastRoutesToUpdate.emplace_back(route);
+  }
+}
+
+void
+Fib::updateMplsInterfaceIndex(thrift::MplsRoute const& route, bool add) {
+  for (auto const& nextHop : route.nextHops) {
+    auto const& ifName = nextHop.address.ifName;
+    if (not ifName.hasValue()) {
+      continue;
+    }
+    if (add) {
+      routeState_.mplsLabelsByInterface[*ifName].emplace(route.topLabel);
+      continue;
+    }
+    auto it = routeState_.mplsLabelsByInterface.find(*ifName);
+    if (it != routeState_.mplsLabelsByInterface.end()) {
+      it->second.erase(route.topLabel);
+      if (it->second.empty()) {
+        routeState_.mplsLabelsByInterface.erase(it);
+      }
+    }
+  }
 }
 
 thrift::PerfDatabase
@@ -474,24 +878,24 @@ Fib::dumpPerfDb() const {
   return perfDb;
 }
 
-void
-Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
-  LOG(INFO) << "Processing route add/update for "
-            << routeDbDelta.unicastRoutesToUpdate.size() << " unicast, "
-            << routeDbDelta.mplsRoutesToUpdate.size() << " mpls, "
-            << "and route delete for "
-            << routeDbDelta.unicastRoutesToDelete.size() << "-unicast, "
-            << routeDbDelta.mplsRoutesToDelete.size() << "-mpls, ";
-
-  // Only for backward compatibility
-  auto const& patchedUnicastRoutesToUpdate =
-      createUnicastRoutesWithBestNexthops(routeDbDelta.unicastRoutesToUpdate);
-
-  auto const& mplsRoutesToUpdate =
-      createMplsRoutesWithBestNextHops(routeDbDelta.mplsRoutesToUpdate);
+thrift::PerfHistograms
+Fib::dumpPerfHistograms() const {
+  thrift::PerfHistograms perfHistograms;
+  perfHistograms.thisNodeName = myNodeName_;
+  for (auto const& kv : routeClassHistograms_) {
+    perfHistograms.routeClassHistograms.emplace(
+        getRoutePriorityName(kv.first), kv.second.toThrift());
+  }
+  for (auto const& kv : eventHistograms_) {
+    perfHistograms.eventHistograms.emplace(kv.first, kv.second.toThrift());
+  }
+  return perfHistograms;
+}
 
+void
+Fib::logRouteUpdates(const thrift::RouteDatabaseDelta& routeDbDelta) {
   VLOG(2) << "Unicast routes to add/update";
-  for (auto const& route : patchedUnicastRoutesToUpdate) {
+  for (auto const& route : routeDbDelta.unicastRoutesToUpdate) {
     VLOG(2) << "> " << toString(route.dest) << ", " << route.nextHops.size();
     for (auto const& nh : route.nextHops) {
       VLOG(2) << "  " << toString(nh);
@@ -506,7 +910,7 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
 
   VLOG(2) << "";
   VLOG(2) << "Mpls routes to add/update";
-  for (auto const& route : mplsRoutesToUpdate) {
+  for (auto const& route : routeDbDelta.mplsRoutesToUpdate) {
     VLOG(2) << "> " << std::to_string(route.topLabel) << ", "
             << route.nextHops.size();
     for (auto const& nh : route.nextHops) {
@@ -519,6 +923,24 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
   for (auto const& topLabel : routeDbDelta.mplsRoutesToDelete) {
     VLOG(2) << "> " << std::to_string(topLabel);
   }
+}
+
+void
+Fib::updateRoutes(
+    const thrift::RouteDatabaseDelta& routeDbDelta, bool isLocalRepair) {
+  LOG(INFO) << "Processing route add/update for "
+            << routeDbDelta.unicastRoutesToUpdate.size() << " unicast, "
+            << routeDbDelta.mplsRoutesToUpdate.size() << " mpls, "
+            << "and route delete for "
+            << routeDbDelta.unicastRoutesToDelete.size() << "-unicast, "
+            << routeDbDelta.mplsRoutesToDelete.size() << "-mpls, ";
+
+  // Per route details are traced in binary form, they are only formatted
+  // when dumped or when verbose logging is on
+  routeTrace_.record(routeDbDelta);
+  if (VLOG_IS_ON(2)) {
+    logRouteUpdates(routeDbDelta);
+  }
 
   if (dryrun_) {
     // Do not program routes in case of dryrun
@@ -543,71 +965,416 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
     return;
   }
 
-  // Make thrift calls to do real programming
-  try {
-    uint32_t numOfRouteUpdates = 0;
-    createFibClient(evb_, socket_, client_, thriftPort_);
-    if (routeDbDelta.unicastRoutesToDelete.size()) {
-      numOfRouteUpdates += routeDbDelta.unicastRoutesToDelete.size();
-      client_->sync_deleteUnicastRoutes(
-          kFibId_, routeDbDelta.unicastRoutesToDelete);
+  mergeRouteUpdates(routeDbDelta, isLocalRepair);
+  if (routeUpdatesInFlight_) {
+    LOG(INFO) << "Route programming in progress, updates will be merged and "
+              << "sent once it completes";
+    coalescedRouteUpdatesStat_.addValue(1);
+    return;
+  }
+  programPendingRouteUpdates();
+}
+
+Fib::RoutePriority
+Fib::getRoutePriority(const thrift::UnicastRoute& route) const {
+  const auto prefix = toIPNetwork(route.dest, false /* applyMask */);
+  for (auto const& priorityPrefix : priorityPrefixes_) {
+    if (prefix.first.family() == priorityPrefix.first.family() and
+        prefix.second >= priorityPrefix.second and
+        prefix.first.inSubnet(priorityPrefix.first, priorityPrefix.second)) {
+      return RoutePriority::INFRA;
     }
-    if (patchedUnicastRoutesToUpdate.size()) {
-      numOfRouteUpdates += patchedUnicastRoutesToUpdate.size();
-      client_->sync_addUnicastRoutes(kFibId_, patchedUnicastRoutesToUpdate);
+  }
+  if (route.prefixType.hasValue()) {
+    switch (route.prefixType.value()) {
+    case thrift::PrefixType::LOOPBACK:
+      return RoutePriority::INFRA;
+    case thrift::PrefixType::BGP:
+      return RoutePriority::BGP;
+    default:
+      break;
     }
-    if (enableSegmentRouting_ && routeDbDelta.mplsRoutesToDelete.size()) {
-      numOfRouteUpdates += routeDbDelta.mplsRoutesToDelete.size();
-      client_->sync_deleteMplsRoutes(kFibId_, routeDbDelta.mplsRoutesToDelete);
+  }
+  if (prioritizeHostRoutes_ and prefix.second == prefix.first.bitCount()) {
+    return RoutePriority::INFRA;
+  }
+  return RoutePriority::DEFAULT;
+}
+
+std::string
+Fib::getRoutePriorityName(RoutePriority priority) {
+  switch (priority) {
+  case RoutePriority::LOCAL_REPAIR:
+    return "local_repair";
+  case RoutePriority::INFRA:
+    return "infra";
+  case RoutePriority::DEFAULT:
+    return "default";
+  case RoutePriority::BGP:
+    return "bgp";
+  }
+  return "unknown";
+}
+
+void
+Fib::mergeRouteUpdates(
+    const thrift::RouteDatabaseDelta& routeDbDelta, bool isLocalRepair) {
+  auto& pending = pendingRouteUpdates_;
+
+  // An add followed by a delete becomes a delete, agent may have programmed
+  // the route before
+  auto eraseUnicastRouteToUpdate = [&pending](const thrift::IpPrefix& prefix) {
+    auto& routesByPriority = pending.unicastRoutesToUpdate;
+    for (auto it = routesByPriority.begin(); it != routesByPriority.end();) {
+      if (it->second.routes.erase(prefix) and it->second.routes.empty()) {
+        it = routesByPriority.erase(it);
+      } else {
+        ++it;
+      }
     }
-    if (enableSegmentRouting_ && mplsRoutesToUpdate.size()) {
-      numOfRouteUpdates += mplsRoutesToUpdate.size();
-      client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+  };
+  const auto now = std::chrono::steady_clock::now();
+  const auto decisionReceivedTs = routeDbDelta.perfEvents.hasValue()
+      ? getDecisionReceivedTs(routeDbDelta.perfEvents.value(), myNodeName_)
+      : 0;
+  for (auto const& route : routeDbDelta.unicastRoutesToUpdate) {
+    pending.unicastRoutesToDelete.erase(route.dest);
+    eraseUnicastRouteToUpdate(route.dest);
+    auto res = pending.unicastRoutesToUpdate.emplace(
+        isLocalRepair ? RoutePriority::LOCAL_REPAIR : getRoutePriority(route),
+        PendingRouteUpdates::UnicastRoutes{});
+    auto& routes = res.first->second;
+    if (res.second) {
+      routes.since = now;
+    }
+    if (decisionReceivedTs and
+        (not routes.decisionReceivedTs or
+         decisionReceivedTs < routes.decisionReceivedTs)) {
+      routes.decisionReceivedTs = decisionReceivedTs;
+    }
+    routes.routes.emplace(route.dest, route);
+  }
+  for (auto const& prefix : routeDbDelta.unicastRoutesToDelete) {
+    eraseUnicastRouteToUpdate(prefix);
+    pending.unicastRoutesToDelete.emplace(prefix);
+  }
+  for (auto const& route : routeDbDelta.mplsRoutesToUpdate) {
+    pending.mplsRoutesToDelete.erase(route.topLabel);
+    pending.mplsRoutesToUpdate[route.topLabel] = route;
+  }
+  for (auto const& topLabel : routeDbDelta.mplsRoutesToDelete) {
+    pending.mplsRoutesToUpdate.erase(topLabel);
+    pending.mplsRoutesToDelete.emplace(topLabel);
+  }
+  if (routeDbDelta.perfEvents.hasValue()) {
+    pending.perfEvents.emplace_back(routeDbDelta.perfEvents.value());
+  }
+}
+
+void
+Fib::updateBatcherConfig() {
+  FibBatcher::Config config;
+  config.maxBatchSize = batchMaxRoutes_.get();
+  config.minBatchSize = batchMinRoutes_.get();
+  if (config.maxBatchSize) {
+    config.minBatchSize = std::min(config.minBatchSize, config.maxBatchSize);
+  }
+  config.maxConcurrency = batchMaxConcurrency_.get();
+  config.targetLatency = std::chrono::milliseconds(batchTargetLatencyMs_.get());
+
+  auto const& current = batcher_.getConfig();
+  if (config.minBatchSize == current.minBatchSize and
+      config.maxBatchSize == current.maxBatchSize and
+      config.maxConcurrency == current.maxConcurrency and
+      config.targetLatency == current.targetLatency) {
+    return;
+  }
+  LOG(INFO) << "Fib batcher config changed to " << config.minBatchSize
+            << "-" << config.maxBatchSize << " routes, "
+            << config.maxConcurrency << " concurrent calls, target latency "
+            << config.targetLatency.count() << "ms";
+  batcher_.setConfig(config);
+}
+
+template <typename T, typename Call>
+folly::Future<folly::Unit>
+Fib::programInBatches(
+    std::shared_ptr<std::vector<T>> items, size_t offset, Call call) {
+  updateBatcherConfig();
+  const size_t batchSize =
+      batcher_.getBatchSize() ? batcher_.getBatchSize() : items->size();
+  std::vector<folly::Future<folly::Unit>> calls;
+  for (size_t i = 0;
+       i < batcher_.getConcurrency() and offset < items->size();
+       ++i) {
+    const auto end = std::min(items->size(), offset + batchSize);
+    std::vector<T> batch(
+        std::make_move_iterator(items->begin() + offset),
+        std::make_move_iterator(items->begin() + end));
+    offset = end;
+    const auto numRoutes = batch.size();
+    const auto start = std::chrono::steady_clock::now();
+    calls.emplace_back(call(std::move(batch)).via(getEvb()).thenValue(
+        [this,
+         guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_),
+         numRoutes,
+         start](folly::Unit) {
+          if (guard.lock()) {
+            batcher_.addSample(
+                numRoutes,
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start));
+          }
+        }));
+  }
+  return folly::collectAll(calls).via(getEvb()).thenValue(
+      [this,
+       guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_),
+       items = std::move(items),
+       offset,
+       call = std::move(call)](
+          std::vector<folly::Try<folly::Unit>>&& results) mutable
+      -> folly::Future<folly::Unit> {
+        // fail the wave if any of its calls failed
+        for (auto& result : results) {
+          result.throwIfFailed();
+        }
+        if (offset >= items->size()) {
+          return folly::makeFuture();
+        }
+        if (not guard.lock()) {
+          return folly::makeFuture<folly::Unit>(
+              std::runtime_error("Fib is stopped"));
+        }
+        return programInBatches(std::move(items), offset, std::move(call));
+      });
+}
+
+void
+Fib::programPendingRouteUpdates() {
+  auto const& pendingUpdates = pendingRouteUpdates_;
+  if (routeUpdatesInFlight_ or
+      (pendingUpdates.unicastRoutesToUpdate.empty() and
+       pendingUpdates.unicastRoutesToDelete.empty() and
+       pendingUpdates.mplsRoutesToUpdate.empty() and
+       pendingUpdates.mplsRoutesToDelete.empty() and
+       pendingUpdates.perfEvents.empty())) {
+    return;
+  }
+  if (syncRoutesTimer_->isScheduled() or routeState_.dirtyRouteDb) {
+    // full sync will program latest routes
+    pendingRouteUpdates_ = PendingRouteUpdates{};
+    return;
+  }
+
+  // Take unicast routes of the highest class, others stay pending
+  auto pending = std::exchange(pendingRouteUpdates_, PendingRouteUpdates{});
+  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
+  folly::Optional<RoutePriority> priority;
+  std::chrono::steady_clock::time_point prioritySince;
+  int64_t priorityDecisionReceivedTs{0};
+  if (not pending.unicastRoutesToUpdate.empty()) {
+    auto it = pending.unicastRoutesToUpdate.begin();
+    priority = it->first;
+    prioritySince = it->second.since;
+    priorityDecisionReceivedTs = it->second.decisionReceivedTs;
+    unicastRoutesToUpdate.reserve(it->second.routes.size());
+    for (auto& kv : it->second.routes) {
+      unicastRoutesToUpdate.emplace_back(std::move(kv.second));
+    }
+    pending.unicastRoutesToUpdate.erase(it);
+    pendingRouteUpdates_.unicastRoutesToUpdate =
+        std::move(pending.unicastRoutesToUpdate);
+  }
+  if (not pendingRouteUpdates_.unicastRoutesToUpdate.empty()) {
+    // perf events are logged with the last batch
+    pendingRouteUpdates_.perfEvents = std::move(pending.perfEvents);
+    pending.perfEvents.clear();
+  }
+  std::vector<thrift::MplsRoute> mplsRoutesToUpdate;
+  mplsRoutesToUpdate.reserve(pending.mplsRoutesToUpdate.size());
+  for (auto& kv : pending.mplsRoutesToUpdate) {
+    mplsRoutesToUpdate.emplace_back(std::move(kv.second));
+  }
+
+  std::vector<thrift::IpPrefix> unicastRoutesToDelete(
+      pending.unicastRoutesToDelete.begin(),
+      pending.unicastRoutesToDelete.end());
+  std::vector<int32_t> mplsRoutesToDelete(
+      pending.mplsRoutesToDelete.begin(), pending.mplsRoutesToDelete.end());
+  if (not enableSegmentRouting_) {
+    mplsRoutesToUpdate.clear();
+    mplsRoutesToDelete.clear();
+  }
+
+  // Only for backward compatibility, routes are owned so filter in place
+  filterUnicastRoutesWithBestNextHops(unicastRoutesToUpdate);
+  filterMplsRoutesWithBestNextHops(mplsRoutesToUpdate);
+
+  const uint32_t numOfRouteUpdates = unicastRoutesToUpdate.size() +
+      unicastRoutesToDelete.size() + mplsRoutesToUpdate.size() +
+      mplsRoutesToDelete.size();
+  const uint32_t numOfPriorityRouteUpdates = unicastRoutesToUpdate.size();
+  auto onDone = [this,
+                 guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_),
+                 numOfRouteUpdates,
+                 priority,
+                 prioritySince,
+                 priorityDecisionReceivedTs,
+                 numOfPriorityRouteUpdates,
+                 perfEvents = std::move(pending.perfEvents)](
+                    folly::Try<folly::Unit>&& t) mutable {
+    if (not guard.lock()) {
+      return;
+    }
+    routeUpdatesInFlight_ = false;
+    if (t.hasException()) {
+      addDelRouteFailuresStat_.addValue(1);
+      asyncClient_.reset();
+      asyncSocket_.reset();
+      routeState_.dirtyRouteDb = true;
+      syncRouteDbDebounced(); // Schedule future full sync of route DB
+      LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
+                 << folly::exceptionStr(t.exception());
+      return;
+    }
+    numOfRouteUpdatesStat_.addValue(numOfRouteUpdates);
+    if (priority.hasValue()) {
+      // convergence of the class, since its oldest update was received
+      const auto name = getRoutePriorityName(priority.value());
+      const auto duration =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - prioritySince);
+      tData_.addStatValue(
+          folly::sformat("fib.route_program_time_ms.{}", name),
+          duration.count(),
+          fbzmq::AVG);
+      tData_.addStatValue(
+          folly::sformat("fib.num_of_route_updates.{}", name),
+          numOfPriorityRouteUpdates,
+          fbzmq::SUM);
+      // convergence of the class, since Decision received its oldest update
+      if (priorityDecisionReceivedTs) {
+        const auto convergenceTime =
+            getUnixTimeStampMs() - priorityDecisionReceivedTs;
+        if (convergenceTime >= 0 and
+            convergenceTime <= std::chrono::milliseconds(
+                                   Constants::kConvergenceMaxDuration)
+                                   .count()) {
+          routeClassHistograms_[priority.value()].addValue(convergenceTime);
+        }
+      }
+    }
+    for (auto& perfEvent : perfEvents) {
+      logPerfEvents(std::move(perfEvent));
     }
-    tData_.addStatValue(
-        "fib.num_of_route_updates", numOfRouteUpdates, fbzmq::SUM);
-    routeState_.dirtyRouteDb = false;
-    logPerfEvents(routeDbDelta.perfEvents);
     LOG(INFO) << "Done processing route add/update";
+    // Send updates of lower classes and the ones received meanwhile
+    programPendingRouteUpdates();
+  };
+
+  if (not numOfRouteUpdates) {
+    onDone(folly::Try<folly::Unit>(folly::unit));
+    return;
+  }
+
+  // Make thrift calls to do real programming, deletes first. Each call is
+  // made once the previous one completes
+  try {
+    createFibClient(*getEvb(), asyncSocket_, asyncClient_, thriftPort_);
   } catch (const std::exception& e) {
-    tData_.addStatValue("fib.thrift.failure.add_del_route", 1, fbzmq::COUNT);
-    client_.reset();
-    routeState_.dirtyRouteDb = true;
-    syncRouteDbDebounced(); // Schedule future full sync of route DB
-    LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
-               << folly::exceptionStr(e);
+    onDone(folly::Try<folly::Unit>(folly::exception_wrapper(
+        std::current_exception(), e)));
+    return;
   }
+  routeUpdatesInFlight_ = true;
+  auto future = folly::makeSemiFuture().via(getEvb());
+  auto addCall = [&future,
+                  guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_)](
+                     auto call) {
+    future = std::move(future).thenValue(
+        [guard, call = std::move(call)](
+            folly::Unit) mutable -> folly::SemiFuture<folly::Unit> {
+          if (not guard.lock()) {
+            return folly::makeSemiFuture<folly::Unit>(
+                std::runtime_error("Fib is stopped"));
+          }
+          return call();
+        });
+  };
+  auto addBatchedCalls = [this, &addCall](auto items, auto call) {
+    if (items.empty()) {
+      return;
+    }
+    addCall([this,
+             items = std::make_shared<decltype(items)>(std::move(items)),
+             call = std::move(call)]() mutable {
+      return programInBatches(std::move(items), 0, std::move(call)).semi();
+    });
+  };
+  addBatchedCalls(
+      std::move(unicastRoutesToDelete),
+      [this](std::vector<thrift::IpPrefix> prefixes) {
+        return asyncClient_->semifuture_deleteUnicastRoutes(kFibId_, prefixes);
+      });
+  addBatchedCalls(
+      std::move(unicastRoutesToUpdate),
+      [this](std::vector<thrift::UnicastRoute> routes) {
+        return asyncClient_->semifuture_addUnicastRoutes(kFibId_, routes);
+      });
+  addBatchedCalls(
+      std::move(mplsRoutesToDelete), [this](std::vector<int32_t> labels) {
+        return asyncClient_->semifuture_deleteMplsRoutes(kFibId_, labels);
+      });
+  addBatchedCalls(
+      std::move(mplsRoutesToUpdate),
+      [this](std::vector<thrift::MplsRoute> routes) {
+        return asyncClient_->semifuture_addMplsRoutes(kFibId_, routes);
+      });
+  std::move(future).thenTry(std::move(onDone));
 }
 
 bool
 Fib::syncRouteDb() {
+  if (routeUpdatesInFlight_) {
+    // routes of the batch in flight could land after the full sync
+    LOG(INFO) << "Route programming in progress, deferring routeDb sync";
+    return false;
+  }
+
   LOG(INFO) << "Syncing latest routeDb with fib-agent with "
             << routeState_.unicastRoutes.size() << " routes";
 
-  const auto& unicastRoutes =
-      createUnicastRoutesWithBestNextHopsMap(routeState_.unicastRoutes);
+  // best nexthops are known per next-hop group. Routes of higher classes
+  // go first, for agents programming routes in order
+  std::map<RoutePriority, std::vector<thrift::UnicastRoute>> routesByPriority;
+  for (auto const& kv : routeState_.unicastRoutes) {
+    auto const* group =
+        routeState_.unicastNextHopGroups.getGroup(kv.second->dest);
+    CHECK(group);
+    thrift::UnicastRoute route;
+    route.dest = kv.second->dest;
+    route.nextHops = group->bestNextHops; // already sorted
+    routesByPriority[getRoutePriority(*kv.second)].emplace_back(
+        std::move(route));
+  }
+  std::vector<thrift::UnicastRoute> unicastRoutes;
+  unicastRoutes.reserve(routeState_.unicastRoutes.size());
+  for (auto& kv : routesByPriority) {
+    std::move(
+        kv.second.begin(), kv.second.end(), std::back_inserter(unicastRoutes));
+  }
   const auto& mplsRoutes =
       createMplsRoutesWithBestNextHopsMap(routeState_.mplsRoutes);
 
   // In dry run we just print the routes. No real action
   if (dryrun_) {
     LOG(INFO) << "Skipping programing of routes in dryrun ... ";
-    VLOG(2) << "Unicast routes to add/update";
-    for (auto const& route : unicastRoutes) {
-      VLOG(2) << "> " << toString(route.dest) << ", " << route.nextHops.size();
-      for (auto const& nh : route.nextHops) {
-        VLOG(2) << "  " << toString(nh);
-      }
-    }
-
-    VLOG(2) << "";
-    VLOG(2) << "Mpls routes to add/update";
-    for (auto const& route : mplsRoutes) {
-      VLOG(2) << "> " << std::to_string(route.topLabel) << ", "
-              << route.nextHops.size();
-      for (auto const& nh : route.nextHops) {
-        VLOG(2) << "  " << toString(nh);
-      }
+    if (VLOG_IS_ON(2)) {
+      thrift::RouteDatabaseDelta routeDbDelta;
+      routeDbDelta.unicastRoutesToUpdate = std::move(unicastRoutes);
+      routeDbDelta.mplsRoutesToUpdate = mplsRoutes;
+      logRouteUpdates(routeDbDelta);
     }
 
     return true;
@@ -617,17 +1384,30 @@ Fib::syncRouteDb() {
     createFibClient(evb_, socket_, client_, thriftPort_);
     tData_.addStatValue("fib.sync_fib_calls", 1, fbzmq::COUNT);
 
-    // Sync unicast routes
-    client_->sync_syncFib(kFibId_, unicastRoutes);
-    routeState_.dirtyPrefixes.clear();
+    if (enableWarmBoot_ and not hasSyncedFib_) {
+      // Keep routes of agent, only program what changed
+      syncWarmBootRoutes(unicastRoutes, mplsRoutes);
+    } else {
+      // Sync unicast routes, fully if agent can't compare route digests
+      if (not syncUnicastRouteBuckets(unicastRoutes)) {
+        client_->sync_syncFib(kFibId_, unicastRoutes);
+      }
 
-    // Sync mpls routes
-    if (enableSegmentRouting_) {
-      client_->sync_syncMplsFib(kFibId_, mplsRoutes);
+      // Sync mpls routes
+      if (enableSegmentRouting_) {
+        client_->sync_syncMplsFib(kFibId_, mplsRoutes);
+      }
+
+      // full sync removed stale routes as well
+      routeState_.staleUnicastPrefixes.clear();
+      routeState_.staleLabels.clear();
     }
+    routeState_.dirtyPrefixes.clear();
     routeState_.dirtyLabels.clear();
 
     routeState_.dirtyRouteDb = false;
+    // synced routeDb includes route updates not sent yet
+    pendingRouteUpdates_ = PendingRouteUpdates{};
     LOG(INFO) << "Done syncing latest routeDb with fib-agent";
     return true;
   } catch (std::exception const& e) {
@@ -648,6 +1428,191 @@ Fib::syncRouteDbDebounced() {
   }
 }
 
+void
+Fib::syncWarmBootRoutes(
+    const std::vector<thrift::UnicastRoute>& unicastRoutes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes) {
+  // routes read below are as of this incarnation of the agent. Later
+  // restarts of the agent require a full sync
+  latestAliveSince_ = client_->sync_aliveSince();
+
+  std::vector<thrift::UnicastRoute> agentUnicastRoutes;
+  client_->sync_getRouteTableByClient(agentUnicastRoutes, kFibId_);
+  std::unordered_map<thrift::IpPrefix, std::vector<thrift::NextHopThrift>>
+      agentNextHops;
+  for (auto& route : agentUnicastRoutes) {
+    agentNextHops.emplace(std::move(route.dest), std::move(route.nextHops));
+  }
+  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
+  for (auto const& route : unicastRoutes) {
+    auto it = agentNextHops.find(route.dest);
+    if (it == agentNextHops.end()) {
+      unicastRoutesToUpdate.emplace_back(route);
+      continue;
+    }
+    if (not isSameForwarding(route.nextHops, it->second)) {
+      unicastRoutesToUpdate.emplace_back(route);
+    }
+    agentNextHops.erase(it);
+  }
+
+  std::unordered_map<int32_t, std::vector<thrift::NextHopThrift>>
+      agentMplsNextHops;
+  std::vector<thrift::MplsRoute> mplsRoutesToUpdate;
+  if (enableSegmentRouting_) {
+    std::vector<thrift::MplsRoute> agentMplsRoutes;
+    client_->sync_getMplsRouteTableByClient(agentMplsRoutes, kFibId_);
+    for (auto& route : agentMplsRoutes) {
+      agentMplsNextHops.emplace(route.topLabel, std::move(route.nextHops));
+    }
+    for (auto const& route : mplsRoutes) {
+      auto it = agentMplsNextHops.find(route.topLabel);
+      if (it == agentMplsNextHops.end()) {
+        mplsRoutesToUpdate.emplace_back(route);
+        continue;
+      }
+      if (not isSameForwarding(route.nextHops, it->second)) {
+        mplsRoutesToUpdate.emplace_back(route);
+      }
+      agentMplsNextHops.erase(it);
+    }
+  }
+
+  if (unicastRoutesToUpdate.size()) {
+    client_->sync_addUnicastRoutes(kFibId_, unicastRoutesToUpdate);
+  }
+  if (mplsRoutesToUpdate.size()) {
+    client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+  }
+
+  // Remaining routes of agent are no longer computed, they are deleted in
+  // the background to bound the churn on the agent
+  for (auto const& kv : agentNextHops) {
+    routeState_.staleUnicastPrefixes.emplace(kv.first);
+  }
+  for (auto const& kv : agentMplsNextHops) {
+    routeState_.staleLabels.emplace(kv.first);
+  }
+  const auto numOfStaleRoutes = routeState_.staleUnicastPrefixes.size() +
+      routeState_.staleLabels.size();
+  LOG(INFO) << "Warm boot: programmed "
+            << unicastRoutesToUpdate.size() + mplsRoutesToUpdate.size()
+            << " changed routes out of "
+            << unicastRoutes.size() + mplsRoutes.size() << ", "
+            << numOfStaleRoutes << " stale routes to delete";
+  tData_.addStatValue(
+      "fib.warm_boot_programmed_routes",
+      unicastRoutesToUpdate.size() + mplsRoutesToUpdate.size(),
+      fbzmq::SUM);
+  if (numOfStaleRoutes and not staleRoutesTimer_->isScheduled()) {
+    staleRoutesTimer_->scheduleTimeout(
+        Constants::kFibStaleRoutesDeleteInterval);
+  }
+}
+
+void
+Fib::deleteStaleRoutes() {
+  auto& stalePrefixes = routeState_.staleUnicastPrefixes;
+  auto& staleLabels = routeState_.staleLabels;
+  const auto batchSize = Constants::kFibStaleRoutesDeleteBatchSize;
+  std::vector<thrift::IpPrefix> prefixes;
+  for (auto it = stalePrefixes.begin();
+       it != stalePrefixes.end() and prefixes.size() < batchSize;
+       ++it) {
+    prefixes.emplace_back(*it);
+  }
+  std::vector<int32_t> labels;
+  for (auto it = staleLabels.begin();
+       it != staleLabels.end() and prefixes.size() + labels.size() < batchSize;
+       ++it) {
+    labels.emplace_back(*it);
+  }
+  if (prefixes.empty() and labels.empty()) {
+    return;
+  }
+
+  try {
+    createFibClient(evb_, socket_, client_, thriftPort_);
+    if (prefixes.size()) {
+      client_->sync_deleteUnicastRoutes(kFibId_, prefixes);
+    }
+    if (labels.size()) {
+      client_->sync_deleteMplsRoutes(kFibId_, labels);
+    }
+  } catch (std::exception const& e) {
+    tData_.addStatValue(
+        "fib.thrift.failure.delete_stale_routes", 1, fbzmq::COUNT);
+    client_.reset();
+    LOG(ERROR) << "Failed to delete stale routes from switch agent. Error: "
+               << folly::exceptionStr(e);
+    staleRoutesTimer_->scheduleTimeout(Constants::kKeepAliveCheckInterval);
+    return;
+  }
+
+  for (auto const& prefix : prefixes) {
+    stalePrefixes.erase(prefix);
+  }
+  for (auto const& label : labels) {
+    staleLabels.erase(label);
+  }
+  tData_.addStatValue(
+      "fib.num_stale_routes_deleted",
+      prefixes.size() + labels.size(),
+      fbzmq::SUM);
+  if (stalePrefixes.size() or staleLabels.size()) {
+    staleRoutesTimer_->scheduleTimeout(
+        Constants::kFibStaleRoutesDeleteInterval);
+  } else {
+    LOG(INFO) << "Done deleting stale routes of warm boot";
+  }
+}
+
+bool
+Fib::syncUnicastRouteBuckets(
+    const std::vector<thrift::UnicastRoute>& unicastRoutes) {
+  const auto numBuckets = Constants::kFibSyncBuckets;
+  std::vector<int64_t> agentDigests;
+  try {
+    client_->sync_getRouteTableDigests(agentDigests, kFibId_, numBuckets);
+  } catch (std::exception const& e) {
+    LOG(INFO) << "Failed to get route digests from switch agent, syncing "
+              << "all routes. Error: " << folly::exceptionStr(e);
+    return false;
+  }
+  if (agentDigests.size() != static_cast<size_t>(numBuckets)) {
+    LOG(WARNING) << "Unexpected number of route digests from switch agent: "
+                 << agentDigests.size() << ", syncing all routes";
+    return false;
+  }
+
+  const auto digests = getRouteBucketDigests(unicastRoutes, numBuckets);
+  std::vector<int32_t> buckets;
+  std::vector<bool> isStale(numBuckets, false);
+  for (int32_t bucket = 0; bucket < numBuckets; ++bucket) {
+    if (digests[bucket] != agentDigests[bucket]) {
+      buckets.emplace_back(bucket);
+      isStale[bucket] = true;
+    }
+  }
+  tData_.addStatValue(
+      "fib.sync_fib_stale_buckets", buckets.size(), fbzmq::SUM);
+  if (buckets.empty()) {
+    LOG(INFO) << "Routes of switch agent are already in sync";
+    return true;
+  }
+
+  std::vector<thrift::UnicastRoute> staleRoutes;
+  for (auto const& route : unicastRoutes) {
+    if (isStale[getRouteBucket(route.dest, numBuckets)]) {
+      staleRoutes.emplace_back(route);
+    }
+  }
+  LOG(INFO) << "Syncing " << staleRoutes.size() << " routes of "
+            << buckets.size() << " stale buckets with switch agent";
+  client_->sync_syncFibBuckets(kFibId_, numBuckets, buckets, staleRoutes);
+  return true;
+}
+
 void
 Fib::keepAliveCheck() {
   createFibClient(evb_, socket_, client_, thriftPort_);
@@ -706,23 +1671,58 @@ Fib::submitCounters() {
 
   // Extract/build counters from thread-data
   auto counters = tData_.getCounters();
+  for (auto const& kv : stats_.getCounters()) {
+    counters[kv.first] = kv.second;
+  }
 
   // Add some more flat counters
   counters["fib.num_routes"] = routeState_.unicastRoutes.size();
+  counters["fib.num_nexthop_groups"] =
+      routeState_.unicastNextHopGroups.size();
   counters["fib.num_dirty_prefixes"] = routeState_.dirtyPrefixes.size();
   counters["fib.num_dirty_labels"] = routeState_.dirtyLabels.size();
+  counters["fib.num_stale_routes"] = routeState_.staleUnicastPrefixes.size() +
+      routeState_.staleLabels.size();
   counters["fib.require_routedb_sync"] = syncRoutesTimer_->isScheduled();
   counters["fib.zmq_event_queue_size"] = getEvb()->getNotificationQueueSize();
 
   // Count the number of bgp routes
   int64_t bgpCounter = 0;
   for (const auto& route : routeState_.unicastRoutes) {
-    if (route.second.bestNexthop.hasValue()) {
+    if (route.second->bestNexthop.hasValue()) {
       bgpCounter++;
     }
   }
   counters["fib.num_routes.BGP"] = bgpCounter;
 
+  // Convergence percentiles
+  auto addHistogramCounters = [&counters](
+                                  const std::string& name,
+                                  const LatencyHistogram& histogram) {
+    const auto key = "fib.convergence_time_ms." + name;
+    counters[key + ".count"] = histogram.getCount();
+    counters[key + ".p50"] = histogram.getPercentile(0.5);
+    counters[key + ".p99"] = histogram.getPercentile(0.99);
+    counters[key + ".p999"] = histogram.getPercentile(0.999);
+  };
+  for (auto const& kv : routeClassHistograms_) {
+    addHistogramCounters(
+        "class." + getRoutePriorityName(kv.first), kv.second);
+  }
+  for (auto const& kv : eventHistograms_) {
+    addHistogramCounters("event." + kv.first, kv.second);
+  }
+
+  // Route programming calls to the agent
+  counters["fib.batcher.batch_size"] = batcher_.getBatchSize();
+  counters["fib.batcher.concurrency"] = batcher_.getConcurrency();
+  counters["fib.batcher.throughput_routes_per_s"] = batcher_.getThroughput();
+  auto const& agentLatency = batcher_.getLatencyHistogram();
+  counters["fib.agent_latency_ms.count"] = agentLatency.getCount();
+  counters["fib.agent_latency_ms.p50"] = agentLatency.getPercentile(0.5);
+  counters["fib.agent_latency_ms.p99"] = agentLatency.getPercentile(0.99);
+  counters["fib.agent_latency_ms.p999"] = agentLatency.getPercentile(0.999);
+
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
@@ -747,12 +1747,26 @@ Fib::logPerfEvents(folly::Optional<thrift::PerfEvents> perfEvents) {
   // routeDb has synced)
   addPerfEvent(*perfEvents, myNodeName_, "OPENR_FIB_ROUTES_PROGRAMMED");
 
+  // this is the local time it takes to program a route after an event
+  auto localDuration = getDurationBetweenPerfEvents(
+      *perfEvents, "DECISION_RECEIVED", "OPENR_FIB_ROUTES_PROGRAMMED");
+  if (localDuration.hasValue() and localDuration->count() >= 0 and
+      *localDuration <= Constants::kConvergenceMaxDuration) {
+    // histograms by originating event, bounded in number
+    const auto& eventName = perfEvents->events[0].eventDescr;
+    auto it = eventHistograms_.find(eventName);
+    if (it == eventHistograms_.end()) {
+      it = eventHistograms_.size() + 1 < Constants::kMaxPerfHistograms
+          ? eventHistograms_.emplace(eventName, LatencyHistogram()).first
+          : eventHistograms_.emplace(kOtherPerfEvents, LatencyHistogram())
+                .first;
+    }
+    it->second.addValue(localDuration->count());
+  }
+
   if (enableOrderedFib_) {
     // Export convergence duration counter
-    // this is the local time it takes to program a route after an event
     // we are using this for ordered fib programing
-    auto localDuration = getDurationBetweenPerfEvents(
-        *perfEvents, "DECISION_RECEIVED", "OPENR_FIB_ROUTES_PROGRAMMED");
     if (localDuration.hasError()) {
       LOG(WARNING) << "Ignoring perf event with bad local duration "
                    << localDuration.error();
@@ -787,6 +1801,8 @@ Fib::logPerfEvents(folly::Optional<thrift::PerfEvents> perfEvents) {
     VLOG(2) << "  " << str;
   }
 
+  convergenceTrace_.record(*perfEvents);
+
   // Add new entry to perf DB and purge extra entries
   perfDb_.push_back(std::move(perfEvents).value());
   while (perfDb_.size() >= Constants::kPerfBufferSize) {
@@ -798,15 +1814,12 @@ Fib::logPerfEvents(folly::Optional<thrift::PerfEvents> perfEvents) {
       "fib.convergence_time_ms", totalDuration.count(), fbzmq::AVG);
 
   // Log via zmq monitor
-  fbzmq::LogSample sample{};
-  sample.addString("event", "ROUTE_CONVERGENCE");
-  sample.addString("node_name", myNodeName_);
-  sample.addStringVector("perf_events", eventStrs);
-  sample.addInt("duration_ms", totalDuration.count());
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString("event", "ROUTE_CONVERGENCE");
+    record.addString("node_name", myNodeName_);
+    record.addStringVector("perf_events", eventStrs);
+    record.addInt("duration_ms", totalDuration.count());
+  });
 }
 
 } // namespace openr
@@ -7,7 +7,13 @@
 
 #pragma once
 
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
 #include <boost/serialization/strong_typedef.hpp>
+#include <fbzmq/async/ZmqThrottle.h>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/service/stats/ThreadData.h>
@@ -16,9 +22,21 @@
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/ConvergenceTrace.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/LabelTable.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/RouteTrace.h>
+#include <openr/common/RuntimeKnobs.h>
+#include <openr/common/ThreadLocalStats.h>
 #include <openr/common/Util.h>
+#include <openr/fib/FibBatcher.h>
+#include <openr/fib/NextHopGroups.h>
+#include <openr/fib/PrefixTrie.h>
+#include <openr/fib/RouteDbExport.h>
+#include <openr/fib/RouteDbSnapshot.h>
+#include <openr/fib/RouteUpdate.h>
 #include <openr/if/gen-cpp2/FibService.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
@@ -57,12 +75,26 @@ class Fib final : public OpenrEventBase {
       bool enableOrderedFib,
       std::chrono::seconds coldStartDuration,
       bool waitOnDecision,
-      messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue,
+      messaging::RQueue<RouteUpdate> routeUpdatesQueue,
       messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
       const MonitorSubmitUrl& monitorSubmitUrl,
       const KvStoreLocalCmdUrl& storeCmdUrl,
       const KvStoreLocalPubUrl& storePubUrl,
-      fbzmq::Context& zmqContext);
+      fbzmq::Context& zmqContext,
+      bool prioritizeHostRoutes = false,
+      const std::vector<thrift::IpPrefix>& priorityPrefixes = {},
+      size_t routeTraceBufferSize = 0,
+      bool enableWarmBoot = false,
+      size_t convergenceTraceBufferSize = 0,
+      uint32_t convergenceTraceSampleRate = 1,
+      const std::string& routeExportPath = "",
+      FibBatcher::Config const& batcherConfig = {},
+      // registry of the batcher config tunable at runtime. Fixed if null
+      RuntimeKnobs* runtimeKnobs = nullptr,
+      // neighbor events of NetlinkAgent, to prune nexthops whose neighbor
+      // failed to resolve. Not subscribed if none
+      folly::Optional<PlatformPublisherUrl> const& platformPubUrl =
+          folly::none);
 
   /**
    * Utility function to create thrift client connection to SwitchAgent. Can
@@ -78,30 +110,39 @@ class Fib final : public OpenrEventBase {
   /**
    * Perform longest prefix match among all prefixes in route database.
    * @param inputPrefix - a prefix that need to be matched
-   * @param unicastRoutes - current unicast routes in RouteDatabase
+   * @param unicastPrefixes - trie of current unicast route prefixes
    *
    * @return the matched IpPrefix if prefix matching succeed.
    */
   static std::optional<thrift::IpPrefix> longestPrefixMatch(
       const folly::CIDRNetwork& inputPrefix,
-      const std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute>&
-          unicastRoutes);
+      const PrefixTrie& unicastPrefixes);
 
   /**
    * NOTE: DEPRECATED! Use getUnicastRoutes or getMplsRoutes.
    */
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getRouteDb();
 
+  /**
+   * Versioned snapshots of the route database, published after every route
+   * update. Readable from any thread
+   */
+  const RouteDbSnapshots&
+  getRouteDbSnapshots() const {
+    return routeDbSnapshots_;
+  }
+
   /**
    * Retrieve unicast routes for specified prefixes or IP. Returns all if
-   * no prefix is specified in filter list.
+   * no prefix is specified in filter list. All routes are served from the
+   * latest route database snapshot without going through our event loop
    */
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
   getUnicastRoutes(std::vector<std::string> prefixes);
 
   /**
    * Retrieve mpls routes for specified labels. Returns all if no label is
-   * specified in filter list.
+   * specified in filter list, from the latest route database snapshot
    */
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::MplsRoute>>>
   getMplsRoutes(std::vector<int32_t> labels);
@@ -111,6 +152,25 @@ class Fib final : public OpenrEventBase {
    */
   folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>> getPerfDb();
 
+  /**
+   * Retrieve histograms of route convergence latencies
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::PerfHistograms>>
+  getPerfHistograms();
+
+  /**
+   * Retrieve trace of route changes received from Decision module
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::RouteTraceDatabase>>
+  getRouteTrace();
+
+  /**
+   * Retrieve sampled traces of convergence events, ending with routes
+   * programmed by this node
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::ConvergenceTraceDatabase>>
+  getConvergenceTrace();
+
  private:
   // No-copy
   Fib(const Fib&) = delete;
@@ -119,7 +179,20 @@ class Fib final : public OpenrEventBase {
   /**
    * Process new route updates received from Decision module
    */
-  void processRouteUpdates(thrift::RouteDatabaseDelta&& routeDelta);
+  void processRouteUpdates(RouteUpdate&& routeUpdate);
+
+  /**
+   * Subscribe to neighbor events published by NetlinkAgent
+   */
+  void subscribeNeighborEvents(
+      fbzmq::Context& zmqContext, std::string const& platformPubUrl);
+
+  /**
+   * Process neighbor reachability change from NetlinkAgent. Nexthops to a
+   * neighbor which failed to resolve are pruned as if their interface went
+   * down, and restored once it is reachable again
+   */
+  void processNeighborEvent(thrift::NeighborEntry const& neighbor);
 
   /**
    * Process interface status information from LinkMonitor. We remove all
@@ -127,11 +200,21 @@ class Fib final : public OpenrEventBase {
    */
   void processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb);
 
+  /**
+   * Export latest route database snapshot to file, for local readers
+   */
+  void exportRouteDb() noexcept;
+
   /**
    * Convert local perfDb_ into PerfDataBase
    */
   thrift::PerfDatabase dumpPerfDb() const;
 
+  /**
+   * Convert local convergence histograms into PerfHistograms
+   */
+  thrift::PerfHistograms dumpPerfHistograms() const;
+
   /**
    * Retrieve unicast routes with specified filters
    */
@@ -145,11 +228,64 @@ class Fib final : public OpenrEventBase {
       std::vector<int32_t> labels);
 
   /**
-   * Trigger add/del routes thrift calls
+   * Trigger add/del routes thrift calls. Calls are asynchronous and at most
+   * one batch is in flight, updates received meanwhile are merged and sent
+   * once it completes
    * on success no action needed
    * on failure invokes syncRouteDbDebounced
+   * Unicast routes of a local repair are sent ahead of all other pending
+   * route updates
    */
-  void updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta);
+  void updateRoutes(
+      const thrift::RouteDatabaseDelta& routeDbDelta,
+      bool isLocalRepair = false);
+
+  /**
+   * Log every route of the delta, only meant to be called when verbose
+   * logging is enabled as formatting routes is expensive
+   */
+  void logRouteUpdates(const thrift::RouteDatabaseDelta& routeDbDelta);
+
+  // Classes of unicast routes, route updates of higher classes are
+  // programmed first and in separate batches
+  enum class RoutePriority {
+    // routes swapped to their remaining (LFA) nexthops on interface changes
+    LOCAL_REPAIR = 0,
+    // loopbacks, host routes if prioritized and configured priority prefixes
+    INFRA = 1,
+    DEFAULT = 2,
+    BGP = 3,
+  };
+
+  RoutePriority getRoutePriority(const thrift::UnicastRoute& route) const;
+
+  static std::string getRoutePriorityName(RoutePriority priority);
+
+  /**
+   * Merge route changes into pendingRouteUpdates_, latest change of each
+   * prefix and label wins
+   */
+  void mergeRouteUpdates(
+      const thrift::RouteDatabaseDelta& routeDbDelta, bool isLocalRepair);
+
+  /**
+   * Send pendingRouteUpdates_ to switch agent, unless a batch is in flight
+   * already or a full sync is due. A batch has the unicast route updates of
+   * the highest pending class only, along with all deletes and MPLS routes
+   */
+  void programPendingRouteUpdates();
+
+  /**
+   * Program items, from offset on, with call in batches sized by batcher_.
+   * Waves of concurrent batches are sent once the previous one completes,
+   * sized as adapted by then
+   */
+  template <typename T, typename Call>
+  folly::Future<folly::Unit> programInBatches(
+      std::shared_ptr<std::vector<T>> items, size_t offset, Call call);
+
+  // update the config of batcher_ if it was tuned
+  void updateBatcherConfig();
 
   /**
    * Sync the current routeDb_ with the switch agent.
@@ -158,6 +294,30 @@ class Fib final : public OpenrEventBase {
    */
   bool syncRouteDb();
 
+  /**
+   * Sync unicast routes with the switch agent by comparing per bucket
+   * digests first and sending the routes of the buckets which differ only.
+   * Returns false if the agent doesn't support it and a full sync is needed
+   */
+  bool syncUnicastRouteBuckets(
+      const std::vector<thrift::UnicastRoute>& unicastRoutes);
+
+  /**
+   * Initial sync on warm boot. Reads routes of switch agent and programs the
+   * routes which differ from them only. Routes of agent which are missing
+   * from the given ones are marked stale, and deleted by deleteStaleRoutes.
+   * Throws on thrift errors
+   */
+  void syncWarmBootRoutes(
+      const std::vector<thrift::UnicastRoute>& unicastRoutes,
+      const std::vector<thrift::MplsRoute>& mplsRoutes);
+
+  /**
+   * Delete a batch of stale routes from switch agent, and schedule the next
+   * batch if any
+   */
+  void deleteStaleRoutes();
+
   /**
    * Asynchrounsly schedules the syncRouteDb call and returns immediately. All
    * APIs should call this function to sync-routes.
@@ -170,6 +330,26 @@ class Fib final : public OpenrEventBase {
    */
   void keepAliveCheck();
 
+  // Add the updates of routes with a nexthop on one of ifNames, whose valid
+  // best nexthops changed
+  void updateRoutesOfInterfaces(
+      std::unordered_set<std::string> const& ifNames,
+      thrift::RouteDatabaseDelta& routeDbDelta);
+
+  // nexthop's interface is up and its neighbor didn't fail to resolve
+  bool isNextHopValid(thrift::NextHopThrift const& nextHop) const;
+
+  // Add the update of a unicast route whose best nexthops changed from
+  // prevBestNextHops to validBestNextHops because of interface changes
+  void updateUnicastRouteNextHops(
+      thrift::UnicastRoute const& route,
+      std::vector<thrift::NextHopThrift> const& prevBestNextHops,
+      std::vector<thrift::NextHopThrift> const& validBestNextHops,
+      thrift::RouteDatabaseDelta& routeDbDelta);
+
+  // add/remove the labels of route to/from mplsLabelsByInterface
+  void updateMplsInterfaceIndex(thrift::MplsRoute const& route, bool add);
+
   // Submit internal state counters to monitor
   void submitCounters();
 
@@ -179,9 +359,24 @@ class Fib final : public OpenrEventBase {
   // Prefix to available nexthop information. Also store perf information of
   // received route-db if provided.
   struct RouteState {
-    // Non modified copy of Unicast and MPLS routes received from Decision
-    std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> unicastRoutes;
-    std::unordered_map<uint32_t, thrift::MplsRoute> mplsRoutes;
+    // Non modified Unicast and MPLS routes received from Decision, unicast
+    // ones shared with Decision.
+    // Along with their best nexthops, which are programmed, routes carry the
+    // LFA backup nexthops computed by Decision (with higher metrics). Those
+    // are swapped in right away when all best nexthops go down
+    std::unordered_map<PrefixKey, UnicastRoutePtr> unicastRoutes;
+    LabelTable<thrift::MplsRoute> mplsRoutes;
+
+    // Labels of mplsRoutes with a nexthop on the interface, to find the
+    // routes affected by an interface going up or down
+    std::unordered_map<std::string, std::unordered_set<uint32_t>>
+        mplsLabelsByInterface;
+
+    // Prefixes of unicastRoutes, for longest prefix matching
+    PrefixTrie unicastPrefixes;
+
+    // Next-hop groups of unicastRoutes, along with their best next-hops
+    NextHopGroups unicastNextHopGroups;
 
     // indicates we've received a decision route publication and therefore have
     // routes to sync. will not synce routes with system until this is set
@@ -194,7 +389,7 @@ class Fib final : public OpenrEventBase {
     // - receiving new route for prefix or label
     // - full route sync happens
     // - interface up event happens for disabled nexthop
-    std::unordered_set<thrift::IpPrefix> dirtyPrefixes;
+    std::unordered_set<PrefixKey> dirtyPrefixes;
     std::unordered_set<uint32_t> dirtyLabels;
 
     // Flag to indicate the result of previous route programming attempt.
@@ -202,12 +397,60 @@ class Fib final : public OpenrEventBase {
     // successfully synced with agent, we have to trigger an enforced full fib
     // sync with agent again
     bool dirtyRouteDb{false};
+
+    // Routes found in switch agent on warm boot which Decision did not
+    // compute. Deleted gradually in the background, unless Decision
+    // computes them again meanwhile
+    std::unordered_set<thrift::IpPrefix> staleUnicastPrefixes;
+    std::unordered_set<int32_t> staleLabels;
   };
   RouteState routeState_;
 
+  // Snapshots of routeState_ routes for readers on other threads
+  RouteDbSnapshots routeDbSnapshots_;
+
+  // Route changes not sent to switch agent yet, merged by prefix and label
+  struct PendingRouteUpdates {
+    struct UnicastRoutes {
+      std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> routes;
+      // when the oldest of routes was received
+      std::chrono::steady_clock::time_point since;
+      // unix timestamp (ms) at which Decision received the oldest update of
+      // routes carrying perf events, 0 if unknown
+      int64_t decisionReceivedTs{0};
+    };
+    // unicast routes to add or update by class, non empty
+    std::map<RoutePriority, UnicastRoutes> unicastRoutesToUpdate;
+    std::unordered_set<thrift::IpPrefix> unicastRoutesToDelete;
+    std::unordered_map<int32_t, thrift::MplsRoute> mplsRoutesToUpdate;
+    std::unordered_set<int32_t> mplsRoutesToDelete;
+    // perf events of the merged updates, logged once they are programmed
+    std::vector<thrift::PerfEvents> perfEvents;
+  };
+  PendingRouteUpdates pendingRouteUpdates_;
+
+  // set while a batch of route updates is being programmed
+  bool routeUpdatesInFlight_{false};
+
   // Events to capture and indicate performance of protocol convergence.
   std::deque<thrift::PerfEvents> perfDb_;
 
+  // Convergence latencies since Decision received the triggering update, by
+  // unicast route class and by originating event (bounded)
+  std::map<RoutePriority, LatencyHistogram> routeClassHistograms_;
+  std::map<std::string, LatencyHistogram> eventHistograms_;
+
+  // Trace of route changes received from Decision, empty if disabled
+  RouteTrace routeTrace_;
+
+  // Sampled traces of logged perf events, empty if disabled
+  ConvergenceTrace convergenceTrace_;
+
+  // Export of routes to a memory mapped file, null if disabled. Exports are
+  // throttled, readers may lag a little behind routeDbSnapshots_
+  std::unique_ptr<RouteDbExporter> routeDbExporter_;
+  std::unique_ptr<fbzmq::ZmqThrottle> routeDbExportThrottle_;
+
   // Create timestamp of recently logged perf event
   int64_t recentPerfEventCreateTs_{0};
 
@@ -215,6 +458,19 @@ class Fib final : public OpenrEventBase {
   std::unordered_map<std::string /* ifName*/, bool /* isUp */>
       interfaceStatusDb_;
 
+  // Sequence number of the last interface update applied
+  int64_t interfaceDbSeqNum_{0};
+
+  // Addresses of neighbors which failed to resolve on up interfaces, among
+  // best nexthops of routes. Forgotten once resolved or interface changes
+  std::unordered_map<
+      std::string /* ifName */,
+      std::unordered_set<folly::IPAddress>>
+      failedNeighbors_;
+
+  // Subscription to neighbor events from NetlinkAgent, null if not enabled
+  std::unique_ptr<fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT>> nlEventSub_;
+
   // Name of node on which OpenR is running
   const std::string myNodeName_;
 
@@ -234,6 +490,15 @@ class Fib final : public OpenrEventBase {
   // starts or the agent we are talking with restarts
   const std::chrono::seconds coldStartDuration_;
 
+  // host routes, mostly loopbacks of other nodes, are programmed first
+  const bool prioritizeHostRoutes_{false};
+
+  // unicast routes within these prefixes are programmed first
+  std::vector<folly::CIDRNetwork> priorityPrefixes_;
+
+  // initial sync only programs the difference against switch agent routes
+  const bool enableWarmBoot_{false};
+
   apache::thrift::CompactSerializer serializer_;
 
   // Thrift client connection to switch FIB Agent using which we actually
@@ -242,20 +507,44 @@ class Fib final : public OpenrEventBase {
   std::shared_ptr<apache::thrift::async::TAsyncSocket> socket_{nullptr};
   std::unique_ptr<thrift::FibServiceAsyncClient> client_{nullptr};
 
+  // Thrift client connection to switch FIB Agent on our event base, for
+  // asynchronous programming of route updates
+  std::shared_ptr<apache::thrift::async::TAsyncSocket> asyncSocket_{nullptr};
+  std::unique_ptr<thrift::FibServiceAsyncClient> asyncClient_{nullptr};
+
   // Callback timer to sync routes to switch agent and scheduled on route-sync
   // failure. ExponentialBackoff timer to ease up things if they go wrong
   std::unique_ptr<fbzmq::ZmqTimeout> syncRoutesTimer_{nullptr};
   ExponentialBackoff<std::chrono::milliseconds> expBackoff_;
 
+  // size and concurrency of route programming calls, adapted to the agent
+  FibBatcher batcher_;
+
+  // config of batcher_ tunable at runtime
+  RuntimeKnobs::Knob batchMinRoutes_;
+  RuntimeKnobs::Knob batchMaxRoutes_;
+  RuntimeKnobs::Knob batchMaxConcurrency_;
+  RuntimeKnobs::Knob batchTargetLatencyMs_;
+
   // periodically send alive msg to switch agent
   std::unique_ptr<fbzmq::ZmqTimeout> keepAliveTimer_{nullptr};
 
+  // rate-limits deletion of stale routes after warm boot
+  std::unique_ptr<fbzmq::ZmqTimeout> staleRoutesTimer_{nullptr};
+
   // Timer for submitting to monitor periodically
   std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_{nullptr};
 
   // DS to keep track of stats
   fbzmq::ThreadData tData_;
 
+  // stats of route programming
+  ThreadLocalStats stats_;
+  ThreadLocalStats::Stat coalescedRouteUpdatesStat_;
+  ThreadLocalStats::Stat numOfRouteUpdatesStat_;
+  ThreadLocalStats::Stat processRouteDbStat_;
+  ThreadLocalStats::Stat addDelRouteFailuresStat_;
+
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
@@ -269,6 +558,11 @@ class Fib final : public OpenrEventBase {
   bool hasSyncedFib_{false};
 
   const int16_t kFibId_{static_cast<int16_t>(thrift::FibClient::OPENR)};
+
+  // route programming callbacks are skipped once the guard is destroyed,
+  // they may complete after us. Keep last
+  std::shared_ptr<folly::Unit> thriftRequestGuard_{
+      std::make_shared<folly::Unit>()};
 };
 
 } // namespace openr
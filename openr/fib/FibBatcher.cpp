@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/fib/FibBatcher.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// weight of the latest call in the throughput average
+constexpr double kThroughputWeight{0.2};
+
+void
+checkConfig(FibBatcher::Config const& config) {
+  CHECK_GT(config.minBatchSize, 0);
+  CHECK(config.maxBatchSize == 0 or config.minBatchSize <= config.maxBatchSize);
+  CHECK_GT(config.maxConcurrency, 0);
+  CHECK_GT(config.targetLatency.count(), 0);
+}
+
+} // namespace
+
+FibBatcher::FibBatcher(Config const& config)
+    : config_(config), batchSize_(config.maxBatchSize) {
+  checkConfig(config_);
+}
+
+void
+FibBatcher::setConfig(Config const& config) {
+  checkConfig(config);
+  const bool wasUnbounded = config_.maxBatchSize == 0;
+  config_ = config;
+  if (wasUnbounded or config_.maxBatchSize == 0) {
+    batchSize_ = config_.maxBatchSize;
+  } else {
+    batchSize_ = std::min(
+        config_.maxBatchSize, std::max(config_.minBatchSize, batchSize_));
+  }
+  concurrency_ = std::min(config_.maxConcurrency, concurrency_);
+}
+
+void
+FibBatcher::addSample(size_t numRoutes, std::chrono::milliseconds latency) {
+  latencyHistogram_.addValue(latency.count());
+  const double routesPerSecond =
+      numRoutes * 1000.0 / std::max<int64_t>(1, latency.count());
+  throughput_ = throughput_ == 0
+      ? routesPerSecond
+      : throughput_ + kThroughputWeight * (routesPerSecond - throughput_);
+
+  if (config_.maxBatchSize == 0) {
+    return;
+  }
+  if (latency > config_.targetLatency) {
+    // agent is overwhelmed, back off
+    batchSize_ = std::max(config_.minBatchSize, batchSize_ / 2);
+    concurrency_ = std::max<size_t>(1, concurrency_ - 1);
+    VLOG(2) << "Fib agent call of " << numRoutes << " routes took "
+            << latency.count() << "ms, batch size " << batchSize_
+            << ", concurrency " << concurrency_;
+    return;
+  }
+  if (numRoutes < batchSize_ or latency > config_.targetLatency / 2) {
+    // not telling whether the agent could take more
+    return;
+  }
+  if (batchSize_ < config_.maxBatchSize) {
+    batchSize_ = std::min(
+        config_.maxBatchSize, batchSize_ + std::max<size_t>(1, batchSize_ / 4));
+  } else {
+    concurrency_ = std::min(config_.maxConcurrency, concurrency_ + 1);
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include <openr/common/LatencyHistogram.h>
+
+namespace openr {
+
+//
+// Size and number of concurrent route programming calls made to the FIB
+// agent, adapted to its latency within configured bounds.
+//
+// Calls taking more than the target latency halve the batch size and drop a
+// concurrent call. Full batches taking less than half of it grow the batch
+// size by a quarter, and once it is at the max add a concurrent call. Batches
+// start at the max size, agents which can't take them are backed off from in
+// a few calls. Batching is disabled, routes being sent in a single call, if
+// maxBatchSize is 0.
+//
+class FibBatcher {
+ public:
+  struct Config {
+    size_t minBatchSize{1};
+    // unbounded if 0
+    size_t maxBatchSize{0};
+    size_t maxConcurrency{1};
+    std::chrono::milliseconds targetLatency{1000};
+  };
+
+  explicit FibBatcher(Config const& config);
+
+  // replace the config, e.g. tuned at runtime. The batch size and
+  // concurrency are brought within its bounds
+  void setConfig(Config const& config);
+
+  Config const&
+  getConfig() const {
+    return config_;
+  }
+
+  // record a call programming numRoutes routes which took latency, and adapt
+  // the batch size and concurrency to it
+  void addSample(size_t numRoutes, std::chrono::milliseconds latency);
+
+  // max number of routes per call, 0 if unbounded
+  size_t
+  getBatchSize() const {
+    return batchSize_;
+  }
+
+  // max number of calls in flight
+  size_t
+  getConcurrency() const {
+    return concurrency_;
+  }
+
+  // moving average of the routes programmed per second by a call
+  double
+  getThroughput() const {
+    return throughput_;
+  }
+
+  // latencies of the calls
+  LatencyHistogram const&
+  getLatencyHistogram() const {
+    return latencyHistogram_;
+  }
+
+ private:
+  Config config_;
+
+  size_t batchSize_{0};
+  size_t concurrency_{1};
+  double throughput_{0};
+  LatencyHistogram latencyHistogram_;
+};
+
+} // namespace openr
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/fib/NextHopGroups.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <openr/common/Util.h>
+
+namespace openr {
+
+const NextHopGroups::Group&
+NextHopGroups::updateRoute(
+    const thrift::IpPrefix& prefix,
+    std::vector<thrift::NextHopThrift> nextHops) {
+  std::sort(nextHops.begin(), nextHops.end());
+  auto routeIt = routes_.find(prefix);
+  if (routeIt != routes_.end()) {
+    if (routeIt->second->first == nextHops) {
+      return routeIt->second->second;
+    }
+    release(routeIt->second, prefix);
+  }
+
+  auto groupIt = groups_.find(nextHops);
+  if (groupIt == groups_.end()) {
+    Group group;
+    group.id = nextGroupId_++;
+    // selection keeps the order of next-hops
+    group.bestNextHops = getBestNextHopsUnicast(nextHops);
+    groupIt = groups_.emplace(std::move(nextHops), std::move(group)).first;
+    for (auto const& nextHop : groupIt->first) {
+      if (nextHop.address.ifName.hasValue()) {
+        interfaceGroups_[*nextHop.address.ifName].emplace(
+            groupIt->second.id, groupIt);
+      }
+    }
+  }
+  ++groupIt->second.numRoutes;
+  groupIt->second.prefixes.emplace(prefix);
+  if (routeIt != routes_.end()) {
+    routeIt->second = groupIt;
+  } else {
+    routes_.emplace(prefix, groupIt);
+  }
+  return groupIt->second;
+}
+
+bool
+NextHopGroups::deleteRoute(const thrift::IpPrefix& prefix) {
+  auto routeIt = routes_.find(prefix);
+  if (routeIt == routes_.end()) {
+    return false;
+  }
+  release(routeIt->second, prefix);
+  routes_.erase(routeIt);
+  return true;
+}
+
+const NextHopGroups::Group*
+NextHopGroups::getGroup(const thrift::IpPrefix& prefix) const {
+  auto routeIt = routes_.find(prefix);
+  if (routeIt == routes_.end()) {
+    return nullptr;
+  }
+  return &routeIt->second->second;
+}
+
+const std::vector<thrift::NextHopThrift>&
+NextHopGroups::getNextHops(const thrift::IpPrefix& prefix) const {
+  return routes_.at(prefix)->first;
+}
+
+void
+NextHopGroups::forEachGroupOfInterfaces(
+    const std::unordered_set<std::string>& ifNames,
+    folly::FunctionRef<void(
+        const std::vector<thrift::NextHopThrift>& nextHops,
+        const Group& group)> visitor) const {
+  // groups with next-hops on several of the interfaces are visited once
+  std::unordered_set<uint64_t> visited;
+  for (auto const& ifName : ifNames) {
+    auto it = interfaceGroups_.find(ifName);
+    if (it == interfaceGroups_.end()) {
+      continue;
+    }
+    for (auto const& kv : it->second) {
+      if (ifNames.size() == 1 or visited.emplace(kv.first).second) {
+        visitor(kv.second->first, kv.second->second);
+      }
+    }
+  }
+}
+
+void
+NextHopGroups::release(Groups::iterator it, const thrift::IpPrefix& prefix) {
+  DCHECK_LT(0, it->second.numRoutes);
+  it->second.prefixes.erase(prefix);
+  if (--it->second.numRoutes == 0) {
+    for (auto const& nextHop : it->first) {
+      if (not nextHop.address.ifName.hasValue()) {
+        continue;
+      }
+      auto ifIt = interfaceGroups_.find(*nextHop.address.ifName);
+      if (ifIt == interfaceGroups_.end()) {
+        continue;
+      }
+      ifIt->second.erase(it->second.id);
+      if (ifIt->second.empty()) {
+        interfaceGroups_.erase(ifIt);
+      }
+    }
+    groups_.erase(it);
+  }
+}
+
+} // namespace openr
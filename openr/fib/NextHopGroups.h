@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Function.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+//
+// Distinct next-hop sets of unicast routes. Prefixes announced by the same
+// nodes share the same next-hops, each set is stored once as a group along
+// with its best next-hops and referenced by all routes using it. Groups are
+// reference counted and removed along with their last route. Groups are
+// indexed by the interfaces of their next-hops, so that the routes affected by
+// an interface going up or down are found without scanning all routes.
+//
+class NextHopGroups {
+ public:
+  struct Group {
+    // unique among the groups ever created by this instance
+    uint64_t id{0};
+    // best next-hops of the group, sorted
+    std::vector<thrift::NextHopThrift> bestNextHops;
+    // number of routes using the group
+    size_t numRoutes{0};
+    // prefixes of the routes using the group
+    std::unordered_set<thrift::IpPrefix> prefixes;
+  };
+
+  NextHopGroups() = default;
+
+  // groups are referenced by address
+  NextHopGroups(const NextHopGroups&) = delete;
+  NextHopGroups& operator=(const NextHopGroups&) = delete;
+
+  // point the route of prefix at the group of nextHops, creating the group if
+  // needed. Returns the group
+  const Group& updateRoute(
+      const thrift::IpPrefix& prefix,
+      std::vector<thrift::NextHopThrift> nextHops);
+
+  // remove the route of prefix. Returns false if there was none
+  bool deleteRoute(const thrift::IpPrefix& prefix);
+
+  // group of the route of prefix, nullptr if there is no such route
+  const Group* getGroup(const thrift::IpPrefix& prefix) const;
+
+  // next-hops of the route of prefix, sorted. The route must exist
+  const std::vector<thrift::NextHopThrift>& getNextHops(
+      const thrift::IpPrefix& prefix) const;
+
+  // calls visitor once for each group with a next-hop on one of ifNames,
+  // along with the group's next-hops
+  void forEachGroupOfInterfaces(
+      const std::unordered_set<std::string>& ifNames,
+      folly::FunctionRef<void(
+          const std::vector<thrift::NextHopThrift>& nextHops,
+          const Group& group)> visitor) const;
+
+  // number of groups
+  size_t
+  size() const {
+    return groups_.size();
+  }
+
+ private:
+  // groups by their sorted next-hops
+  using Groups = std::map<std::vector<thrift::NextHopThrift>, Group>;
+
+  void release(Groups::iterator it, const thrift::IpPrefix& prefix);
+
+  Groups groups_;
+
+  std::unordered_map<thrift::IpPrefix, Groups::iterator> routes_;
+
+  // groups by id, for each interface of their next-hops
+  std::unordered_map<
+      std::string,
+      std::unordered_map<uint64_t /* id */, Groups::const_iterator>>
+      interfaceGroups_;
+
+  uint64_t nextGroupId_{1};
+};
+
+} // namespace openr
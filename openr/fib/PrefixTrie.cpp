@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/fib/PrefixTrie.h"
+
+#include <algorithm>
+
+#include <openr/common/NetworkUtil.h>
+
+namespace openr {
+
+namespace {
+
+// number of leading bits shared by a and b of the same family, up to maxLen
+uint8_t
+getCommonLength(
+    const folly::IPAddress& a, const folly::IPAddress& b, uint8_t maxLen) {
+  return getCommonPrefixLength(a.bytes(), b.bytes(), a.byteCount(), maxLen);
+}
+
+} // anonymous namespace
+
+void
+PrefixTrie::insert(const thrift::IpPrefix& prefix) {
+  const uint8_t len = prefix.prefixLength;
+  const auto address = toIPAddress(prefix.prefixAddress).mask(len);
+
+  auto* link = &getRoot(address);
+  while (true) {
+    auto* node = link->get();
+    if (not node) {
+      *link = std::make_unique<Node>();
+      (*link)->network = {address, len};
+      (*link)->prefix = prefix;
+      ++size_;
+      return;
+    }
+
+    const auto& nodeAddress = node->network.first;
+    const uint8_t nodeLen = node->network.second;
+    const auto commonLen =
+        getCommonLength(address, nodeAddress, std::min(len, nodeLen));
+    if (commonLen == nodeLen) {
+      if (len == nodeLen) {
+        if (not node->prefix.has_value()) {
+          node->prefix = prefix;
+          ++size_;
+        }
+        return;
+      }
+      // prefix is below node
+      link = &node->children[address.getNthMSBit(nodeLen)];
+      continue;
+    }
+
+    // prefix and node diverge, or prefix is above node: insert the network
+    // they share above node
+    auto parent = std::make_unique<Node>();
+    parent->network = {address.mask(commonLen), commonLen};
+    const bool nodeBit = nodeAddress.getNthMSBit(commonLen);
+    parent->children[nodeBit] = std::move(*link);
+    if (commonLen == len) {
+      parent->prefix = prefix;
+    } else {
+      auto leaf = std::make_unique<Node>();
+      leaf->network = {address, len};
+      leaf->prefix = prefix;
+      parent->children[not nodeBit] = std::move(leaf);
+    }
+    *link = std::move(parent);
+    ++size_;
+    return;
+  }
+}
+
+bool
+PrefixTrie::erase(const thrift::IpPrefix& prefix) {
+  const uint8_t len = prefix.prefixLength;
+  const auto address = toIPAddress(prefix.prefixAddress).mask(len);
+
+  std::unique_ptr<Node>* parentLink = nullptr;
+  auto* link = &getRoot(address);
+  while (*link) {
+    auto* node = link->get();
+    const uint8_t nodeLen = node->network.second;
+    if (nodeLen > len or
+        getCommonLength(address, node->network.first, nodeLen) < nodeLen) {
+      return false;
+    }
+    if (nodeLen < len) {
+      parentLink = link;
+      link = &node->children[address.getNthMSBit(nodeLen)];
+      continue;
+    }
+
+    if (not (node->prefix == prefix)) {
+      return false;
+    }
+    node->prefix.reset();
+    --size_;
+
+    // restore path compression: drop the node if it has no children, or
+    // replace it with its only child
+    if (node->children[0] and node->children[1]) {
+      return true;
+    }
+    auto& child = node->children[0] ? node->children[0] : node->children[1];
+    *link = std::move(child);
+    if (*link or not parentLink) {
+      return true;
+    }
+
+    // the parent may be left with a single child and no prefix
+    auto* parent = parentLink->get();
+    if (not parent->prefix.has_value()) {
+      auto& sibling =
+          parent->children[0] ? parent->children[0] : parent->children[1];
+      *parentLink = std::move(sibling);
+    }
+    return true;
+  }
+  return false;
+}
+
+std::optional<thrift::IpPrefix>
+PrefixTrie::longestPrefixMatch(const folly::CIDRNetwork& network) const {
+  const auto& address = network.first;
+  const uint8_t len = network.second;
+
+  std::optional<thrift::IpPrefix> matchedPrefix;
+  const auto* node = getRoot(address).get();
+  while (node) {
+    const uint8_t nodeLen = node->network.second;
+    if (nodeLen > len or
+        getCommonLength(address, node->network.first, nodeLen) < nodeLen) {
+      break;
+    }
+    if (node->prefix.has_value()) {
+      matchedPrefix = node->prefix;
+    }
+    if (nodeLen == len) {
+      break;
+    }
+    node = node->children[address.getNthMSBit(nodeLen)].get();
+  }
+  return matchedPrefix;
+}
+
+void
+PrefixTrie::clear() {
+  rootV4_.reset();
+  rootV6_.reset();
+  size_ = 0;
+}
+
+std::unique_ptr<PrefixTrie::Node>&
+PrefixTrie::getRoot(const folly::IPAddress& address) {
+  return address.isV4() ? rootV4_ : rootV6_;
+}
+
+const std::unique_ptr<PrefixTrie::Node>&
+PrefixTrie::getRoot(const folly::IPAddress& address) const {
+  return address.isV4() ? rootV4_ : rootV6_;
+}
+
+} // namespace openr
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <folly/IPAddress.h>
+
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+//
+// Path-compressed binary tries of IP prefixes, one per address family, for
+// longest prefix matching in O(prefix length) time. Every node holds the
+// network shared by the prefixes below it, nodes holding no prefix have two
+// children.
+//
+class PrefixTrie {
+ public:
+  PrefixTrie() = default;
+
+  // owns its nodes
+  PrefixTrie(const PrefixTrie&) = delete;
+  PrefixTrie& operator=(const PrefixTrie&) = delete;
+
+  // add prefix, a no-op if already present
+  void insert(const thrift::IpPrefix& prefix);
+
+  // remove prefix. Returns false if it wasn't present
+  bool erase(const thrift::IpPrefix& prefix);
+
+  // longest prefix covering network, if any
+  std::optional<thrift::IpPrefix> longestPrefixMatch(
+      const folly::CIDRNetwork& network) const;
+
+  size_t
+  size() const {
+    return size_;
+  }
+
+  void clear();
+
+ private:
+  struct Node {
+    // masked network of the node
+    folly::CIDRNetwork network;
+    // prefix of the route ending on this node, if any
+    std::optional<thrift::IpPrefix> prefix;
+    // indexed by the bit following the network
+    std::array<std::unique_ptr<Node>, 2> children;
+  };
+
+  // root of the trie of the family of address
+  std::unique_ptr<Node>& getRoot(const folly::IPAddress& address);
+  const std::unique_ptr<Node>& getRoot(const folly::IPAddress& address) const;
+
+  std::unique_ptr<Node> rootV4_;
+  std::unique_ptr<Node> rootV6_;
+  size_t size_{0};
+};
+
+} // namespace openr
@@ -0,0 +1,595 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RouteDbExport.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Exception.h>
+#include <folly/Format.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+using namespace route_export;
+
+static_assert(
+    std::atomic<uint64_t>::is_always_lock_free and
+        std::atomic<uint32_t>::is_always_lock_free,
+    "sequence lock must be lock free to be shared between processes");
+static_assert(sizeof(Header) % 8 == 0, "sections must be 8 bytes aligned");
+
+namespace {
+
+const size_t kMinFileSize{4096};
+
+void
+encodeAddress(
+    const thrift::BinaryAddress& address, uint8_t* addr, uint8_t& addrLen) {
+  addrLen = std::min<size_t>(address.addr.size(), 16);
+  std::memcpy(addr, address.addr.data(), addrLen);
+}
+
+thrift::BinaryAddress
+decodeAddress(const uint8_t* addr, uint8_t addrLen) {
+  thrift::BinaryAddress address;
+  address.addr.assign(
+      reinterpret_cast<const char*>(addr), std::min<uint8_t>(addrLen, 16));
+  return address;
+}
+
+bool
+lessByPrefix(const UnicastEntry& a, const UnicastEntry& b) {
+  if (a.addrLen != b.addrLen) {
+    return a.addrLen < b.addrLen;
+  }
+  const auto cmp = std::memcmp(a.addr, b.addr, sizeof(a.addr));
+  if (cmp != 0) {
+    return cmp < 0;
+  }
+  return a.prefixLength < b.prefixLength;
+}
+
+UnicastEntry
+toUnicastKey(const thrift::IpPrefix& prefix) {
+  UnicastEntry entry{};
+  encodeAddress(prefix.prefixAddress, entry.addr, entry.addrLen);
+  entry.prefixLength = prefix.prefixLength;
+  return entry;
+}
+
+// append section to buffer at 8 bytes alignment, returns its file offset
+template <typename T>
+uint64_t
+appendSection(std::string& buffer, const T* data, size_t count) {
+  buffer.resize((buffer.size() + 7) & ~size_t{7}, '\0');
+  const uint64_t offset = sizeof(Header) + buffer.size();
+  buffer.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+  return offset;
+}
+
+} // namespace
+
+//
+// RouteDbExportView
+//
+
+RouteDbExportView::RouteDbExportView(const char* base, size_t size)
+    : base_(base), size_(size) {
+  if (size_ < sizeof(Header)) {
+    return;
+  }
+  const auto* header = reinterpret_cast<const Header*>(base_);
+  version_ = header->routeDbVersion;
+  numUnicastRoutes_ = header->numUnicastRoutes;
+  numMplsRoutes_ = header->numMplsRoutes;
+  numNextHops_ = header->numNextHops;
+  numLabels_ = header->numLabels;
+  namesSize_ = header->namesSize;
+  unicastOffset_ = header->unicastOffset;
+  mplsOffset_ = header->mplsOffset;
+  nextHopsOffset_ = header->nextHopsOffset;
+  labelsOffset_ = header->labelsOffset;
+  namesOffset_ = header->namesOffset;
+  nodeNameOffset_ = header->nodeNameOffset;
+
+  // every section aligned and within the mapping
+  const auto fits = [this](uint64_t offset, uint64_t count, size_t entrySize) {
+    return offset % 8 == 0 and offset <= size_ and
+        count <= (size_ - offset) / entrySize;
+  };
+  valid_ = fits(unicastOffset_, numUnicastRoutes_, sizeof(UnicastEntry)) and
+      fits(mplsOffset_, numMplsRoutes_, sizeof(MplsEntry)) and
+      fits(nextHopsOffset_, numNextHops_, sizeof(NextHopEntry)) and
+      fits(labelsOffset_, numLabels_, sizeof(int32_t)) and
+      fits(namesOffset_, namesSize_, 1);
+}
+
+bool
+RouteDbExportView::isValid() const {
+  return valid_;
+}
+
+int64_t
+RouteDbExportView::getVersion() const {
+  return version_;
+}
+
+folly::StringPiece
+RouteDbExportView::getNodeName() const {
+  return getName(nodeNameOffset_);
+}
+
+template <typename T>
+folly::Range<const T*>
+RouteDbExportView::getSection(
+    uint64_t offset, uint64_t count, uint64_t first, uint64_t num) const {
+  if (not valid_ or first > count or num > count - first) {
+    return {};
+  }
+  const auto* begin = reinterpret_cast<const T*>(base_ + offset) + first;
+  return folly::Range<const T*>(begin, num);
+}
+
+folly::Range<const UnicastEntry*>
+RouteDbExportView::getUnicastEntries() const {
+  return getSection<UnicastEntry>(
+      unicastOffset_, numUnicastRoutes_, 0, numUnicastRoutes_);
+}
+
+folly::Range<const MplsEntry*>
+RouteDbExportView::getMplsEntries() const {
+  return getSection<MplsEntry>(mplsOffset_, numMplsRoutes_, 0, numMplsRoutes_);
+}
+
+folly::Range<const NextHopEntry*>
+RouteDbExportView::getNextHops(const UnicastEntry& entry) const {
+  return getSection<NextHopEntry>(
+      nextHopsOffset_, numNextHops_, entry.firstNextHop, entry.numNextHops);
+}
+
+folly::Range<const NextHopEntry*>
+RouteDbExportView::getNextHops(const MplsEntry& entry) const {
+  return getSection<NextHopEntry>(
+      nextHopsOffset_, numNextHops_, entry.firstNextHop, entry.numNextHops);
+}
+
+folly::Range<const int32_t*>
+RouteDbExportView::getLabels(const NextHopEntry& nextHop) const {
+  return getSection<int32_t>(
+      labelsOffset_, numLabels_, nextHop.firstLabel, nextHop.numLabels);
+}
+
+folly::StringPiece
+RouteDbExportView::getIfName(const NextHopEntry& nextHop) const {
+  return getName(nextHop.ifNameOffset);
+}
+
+folly::StringPiece
+RouteDbExportView::getName(uint64_t offset) const {
+  if (not valid_ or offset >= namesSize_) {
+    return {};
+  }
+  const auto* name = base_ + namesOffset_ + offset;
+  return folly::StringPiece(name, strnlen(name, namesSize_ - offset));
+}
+
+const UnicastEntry*
+RouteDbExportView::findUnicastEntry(const thrift::IpPrefix& prefix) const {
+  const auto entries = getUnicastEntries();
+  const auto key = toUnicastKey(prefix);
+  auto it = std::lower_bound(entries.begin(), entries.end(), key, lessByPrefix);
+  if (it == entries.end() or lessByPrefix(key, *it)) {
+    return nullptr;
+  }
+  return it;
+}
+
+const MplsEntry*
+RouteDbExportView::findMplsEntry(int32_t label) const {
+  const auto entries = getMplsEntries();
+  auto it = std::lower_bound(
+      entries.begin(),
+      entries.end(),
+      label,
+      [](const MplsEntry& entry, int32_t label) {
+        return entry.topLabel < label;
+      });
+  if (it == entries.end() or it->topLabel != label) {
+    return nullptr;
+  }
+  return it;
+}
+
+thrift::NextHopThrift
+RouteDbExportView::toNextHop(const NextHopEntry& entry) const {
+  thrift::NextHopThrift nextHop;
+  nextHop.address = decodeAddress(entry.addr, entry.addrLen);
+  const auto ifName = getIfName(entry);
+  if (not ifName.empty()) {
+    nextHop.address.ifName = ifName.str();
+  }
+  nextHop.weight = entry.weight;
+  nextHop.metric = entry.metric;
+  nextHop.useNonShortestRoute = entry.useNonShortestRoute;
+  if (entry.mplsAction) {
+    thrift::MplsAction mplsAction;
+    mplsAction.action =
+        static_cast<thrift::MplsActionCode>(entry.mplsAction - 1);
+    if (mplsAction.action == thrift::MplsActionCode::SWAP) {
+      mplsAction.swapLabel = entry.swapLabel;
+    }
+    if (mplsAction.action == thrift::MplsActionCode::PUSH) {
+      const auto labels = getLabels(entry);
+      mplsAction.pushLabels =
+          std::vector<int32_t>(labels.begin(), labels.end());
+    }
+    nextHop.mplsAction = std::move(mplsAction);
+  }
+  return nextHop;
+}
+
+thrift::UnicastRoute
+RouteDbExportView::toUnicastRoute(const UnicastEntry& entry) const {
+  thrift::UnicastRoute route;
+  route.dest.prefixAddress = decodeAddress(entry.addr, entry.addrLen);
+  route.dest.prefixLength = entry.prefixLength;
+  for (const auto& nextHop : getNextHops(entry)) {
+    route.nextHops.emplace_back(toNextHop(nextHop));
+  }
+  return route;
+}
+
+thrift::MplsRoute
+RouteDbExportView::toMplsRoute(const MplsEntry& entry) const {
+  thrift::MplsRoute route;
+  route.topLabel = entry.topLabel;
+  for (const auto& nextHop : getNextHops(entry)) {
+    route.nextHops.emplace_back(toNextHop(nextHop));
+  }
+  return route;
+}
+
+//
+// RouteDbExporter
+//
+
+RouteDbExporter::RouteDbExporter(std::string path) : path_(std::move(path)) {
+  // initialized aside and renamed into place, readers opening the path never
+  // see a partial header
+  const auto tmpPath = path_ + ".tmp";
+  fd_ = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  folly::checkUnixError(fd_, "Failed to create ", tmpPath);
+  try {
+    ensureSize(kMinFileSize);
+    auto* header = getHeader();
+    header->magic = kMagic;
+    header->formatVersion = kFormatVersion;
+    header->headerSize = sizeof(Header);
+    folly::checkUnixError(
+        ::rename(tmpPath.c_str(), path_.c_str()),
+        "Failed to rename ",
+        tmpPath,
+        " to ",
+        path_);
+  } catch (std::exception const&) {
+    if (base_) {
+      ::munmap(base_, size_);
+    }
+    ::close(fd_);
+    ::unlink(tmpPath.c_str());
+    throw;
+  }
+  LOG(INFO) << "Exporting route database to " << path_;
+}
+
+RouteDbExporter::~RouteDbExporter() {
+  getHeader()->flags.fetch_or(kFlagClosed, std::memory_order_release);
+  ::munmap(base_, size_);
+  ::close(fd_);
+}
+
+Header*
+RouteDbExporter::getHeader() const {
+  return reinterpret_cast<Header*>(base_);
+}
+
+void
+RouteDbExporter::ensureSize(size_t size) {
+  if (size <= size_) {
+    return;
+  }
+  // grow geometrically, in pages
+  size = std::max(size, size_ * 2);
+  size = (size + kMinFileSize - 1) & ~(kMinFileSize - 1);
+  folly::checkUnixError(
+      ::ftruncate(fd_, size), "Failed to grow ", path_, " to ", size);
+
+  auto* base = static_cast<char*>(
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0));
+  if (base == MAP_FAILED) {
+    folly::throwSystemError("Failed to map ", path_);
+  }
+  if (base_) {
+    ::munmap(base_, size_);
+  } else {
+    new (base) Header();
+  }
+  base_ = base;
+  size_ = size;
+  // the file is already grown, readers may remap before the next write
+  getHeader()->fileSize = size_;
+}
+
+void
+RouteDbExporter::publish(const RouteDbSnapshot& snapshot) {
+  std::vector<UnicastEntry> unicastEntries;
+  std::vector<MplsEntry> mplsEntries;
+  std::vector<NextHopEntry> nextHops;
+  std::vector<int32_t> labels;
+  unicastEntries.reserve(snapshot.getNumUnicastRoutes());
+  mplsEntries.reserve(snapshot.getNumMplsRoutes());
+
+  // names interned, offset 0 is the empty name
+  std::string names(1, '\0');
+  std::unordered_map<std::string, uint64_t> nameOffsets;
+  const auto intern = [&](const std::string& name) -> uint64_t {
+    if (name.empty()) {
+      return 0;
+    }
+    auto it = nameOffsets.emplace(name, names.size());
+    if (it.second) {
+      names.append(name);
+      names.push_back('\0');
+    }
+    return it.first->second;
+  };
+
+  const auto addNextHops =
+      [&](const std::vector<thrift::NextHopThrift>& routeNextHops) {
+        for (const auto& nextHop : routeNextHops) {
+          NextHopEntry entry{};
+          encodeAddress(nextHop.address, entry.addr, entry.addrLen);
+          entry.weight = nextHop.weight;
+          entry.metric = nextHop.metric;
+          entry.useNonShortestRoute = nextHop.useNonShortestRoute;
+          entry.ifNameOffset = intern(nextHop.address.ifName.value_or(""));
+          entry.firstLabel = labels.size();
+          if (nextHop.mplsAction.hasValue()) {
+            const auto& mplsAction = *nextHop.mplsAction;
+            entry.mplsAction = static_cast<uint8_t>(mplsAction.action) + 1;
+            entry.swapLabel = mplsAction.swapLabel.value_or(0);
+            if (mplsAction.pushLabels.hasValue()) {
+              labels.insert(
+                  labels.end(),
+                  mplsAction.pushLabels->begin(),
+                  mplsAction.pushLabels->end());
+              entry.numLabels = mplsAction.pushLabels->size();
+            }
+          }
+          nextHops.emplace_back(entry);
+        }
+      };
+
+  snapshot.forEachUnicastRoute([&](const thrift::UnicastRoute& route) {
+    auto entry = toUnicastKey(route.dest);
+    entry.firstNextHop = nextHops.size();
+    entry.numNextHops = route.nextHops.size();
+    addNextHops(route.nextHops);
+    unicastEntries.emplace_back(entry);
+  });
+  snapshot.forEachMplsRoute([&](const thrift::MplsRoute& route) {
+    MplsEntry entry{};
+    entry.topLabel = route.topLabel;
+    entry.firstNextHop = nextHops.size();
+    entry.numNextHops = route.nextHops.size();
+    addNextHops(route.nextHops);
+    mplsEntries.emplace_back(entry);
+  });
+  std::sort(unicastEntries.begin(), unicastEntries.end(), lessByPrefix);
+  std::sort(
+      mplsEntries.begin(),
+      mplsEntries.end(),
+      [](const MplsEntry& a, const MplsEntry& b) {
+        return a.topLabel < b.topLabel;
+      });
+  const auto nodeNameOffset = intern(snapshot.getNodeName());
+
+  buffer_.clear();
+  const auto unicastOffset = appendSection(
+      buffer_, unicastEntries.data(), unicastEntries.size());
+  const auto mplsOffset =
+      appendSection(buffer_, mplsEntries.data(), mplsEntries.size());
+  const auto nextHopsOffset =
+      appendSection(buffer_, nextHops.data(), nextHops.size());
+  const auto labelsOffset =
+      appendSection(buffer_, labels.data(), labels.size());
+  const auto namesOffset = appendSection(buffer_, names.data(), names.size());
+
+  // grow before locking, readers keep reading the previous routes meanwhile
+  ensureSize(sizeof(Header) + buffer_.size());
+
+  auto* header = getHeader();
+  const auto seq = header->seq.load(std::memory_order_relaxed);
+  header->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(base_ + sizeof(Header), buffer_.data(), buffer_.size());
+  header->routeDbVersion = snapshot.getVersion();
+  header->numUnicastRoutes = unicastEntries.size();
+  header->numMplsRoutes = mplsEntries.size();
+  header->numNextHops = nextHops.size();
+  header->numLabels = labels.size();
+  header->namesSize = names.size();
+  header->unicastOffset = unicastOffset;
+  header->mplsOffset = mplsOffset;
+  header->nextHopsOffset = nextHopsOffset;
+  header->labelsOffset = labelsOffset;
+  header->namesOffset = namesOffset;
+  header->nodeNameOffset = nodeNameOffset;
+
+  header->seq.store(seq + 2, std::memory_order_release);
+}
+
+//
+// RouteDbExportReader
+//
+
+RouteDbExportReader::RouteDbExportReader(const std::string& path) {
+  fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  folly::checkUnixError(fd_, "Failed to open ", path);
+  try {
+    refreshMapping();
+    const auto* header = getHeader();
+    if (header->magic != kMagic or header->formatVersion != kFormatVersion or
+        header->headerSize != sizeof(Header)) {
+      throw std::runtime_error(folly::sformat(
+          "{} is not a route database export of format {}",
+          path,
+          kFormatVersion));
+    }
+  } catch (std::exception const&) {
+    if (base_) {
+      ::munmap(const_cast<char*>(base_), size_);
+    }
+    ::close(fd_);
+    throw;
+  }
+}
+
+RouteDbExportReader::~RouteDbExportReader() {
+  ::munmap(const_cast<char*>(base_), size_);
+  ::close(fd_);
+}
+
+const Header*
+RouteDbExportReader::getHeader() const {
+  return reinterpret_cast<const Header*>(base_);
+}
+
+void
+RouteDbExportReader::refreshMapping() {
+  if (base_ and getHeader()->fileSize <= size_) {
+    return;
+  }
+  struct stat st;
+  folly::checkUnixError(::fstat(fd_, &st), "Failed to stat export");
+  const auto size = static_cast<size_t>(st.st_size);
+  if (base_ and size <= size_) {
+    return;
+  }
+  if (size < sizeof(Header)) {
+    throw std::runtime_error("Export is too small to hold a header");
+  }
+  auto* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    folly::throwSystemError("Failed to map export");
+  }
+  if (base_) {
+    ::munmap(const_cast<char*>(base_), size_);
+  }
+  base_ = static_cast<const char*>(base);
+  size_ = size;
+}
+
+bool
+RouteDbExportReader::read(
+    folly::FunctionRef<void(const RouteDbExportView&)> fn, size_t maxRetries) {
+  for (size_t i = 0; i <= maxRetries; ++i) {
+    refreshMapping();
+    const auto* header = getHeader();
+    const auto seq = header->seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    RouteDbExportView view(base_, size_);
+    if (view.isValid()) {
+      fn(view);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (view.isValid() and
+        header->seq.load(std::memory_order_relaxed) == seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+RouteDbExportReader::isClosed() const {
+  return getHeader()->flags.load(std::memory_order_acquire) & kFlagClosed;
+}
+
+folly::Optional<int64_t>
+RouteDbExportReader::getVersion() {
+  int64_t version{0};
+  if (not read([&](const RouteDbExportView& view) {
+        version = view.getVersion();
+      })) {
+    return folly::none;
+  }
+  return version;
+}
+
+folly::Optional<thrift::RouteDatabase>
+RouteDbExportReader::getRouteDatabase() {
+  thrift::RouteDatabase routeDb;
+  if (not read([&](const RouteDbExportView& view) {
+        // may run again on a newer version, start over
+        routeDb = thrift::RouteDatabase();
+        routeDb.thisNodeName = view.getNodeName().str();
+        for (const auto& entry : view.getUnicastEntries()) {
+          routeDb.unicastRoutes.emplace_back(view.toUnicastRoute(entry));
+        }
+        for (const auto& entry : view.getMplsEntries()) {
+          routeDb.mplsRoutes.emplace_back(view.toMplsRoute(entry));
+        }
+      })) {
+    return folly::none;
+  }
+  return routeDb;
+}
+
+folly::Optional<folly::Optional<thrift::UnicastRoute>>
+RouteDbExportReader::findUnicastRoute(const thrift::IpPrefix& prefix) {
+  folly::Optional<thrift::UnicastRoute> route;
+  if (not read([&](const RouteDbExportView& view) {
+        route.clear();
+        if (const auto* entry = view.findUnicastEntry(prefix)) {
+          route = view.toUnicastRoute(*entry);
+        }
+      })) {
+    return folly::none;
+  }
+  return route;
+}
+
+folly::Optional<folly::Optional<thrift::MplsRoute>>
+RouteDbExportReader::findMplsRoute(int32_t label) {
+  folly::Optional<thrift::MplsRoute> route;
+  if (not read([&](const RouteDbExportView& view) {
+        route.clear();
+        if (const auto* entry = view.findMplsEntry(label)) {
+          route = view.toMplsRoute(*entry);
+        }
+      })) {
+    return folly::none;
+  }
+  return route;
+}
+
+} // namespace openr
@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+
+#include <openr/fib/RouteDbSnapshot.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+//
+// Route database of Fib exported to a memory mapped file, for local readers
+// to look routes up without any RPC.
+//
+// The file holds a header followed by sections of fixed size entries, in
+// native byte order. Unicast routes are sorted by (address length, address,
+// prefix length) and MPLS routes by label so readers binary search them in
+// place. Every route refers to a range of next-hops, every next-hop to a
+// range of push labels and to its interface name in the names section.
+//
+// The writer rewrites the sections under a sequence lock: the sequence number
+// is odd while writing. Readers run their lookup on the mapping and retry it
+// if the sequence number changed meanwhile, so lookups must only rely on the
+// bounds checked accessors of RouteDbExportView. The file only ever grows,
+// readers remap it when it did. A new writer replaces the file, the previous
+// one is marked closed for readers to reopen it.
+//
+namespace route_export {
+
+constexpr uint32_t kMagic{0x4f524442}; // "ORDB"
+constexpr uint32_t kFormatVersion{1};
+
+// header flags
+constexpr uint32_t kFlagClosed{1};
+
+struct Header {
+  uint32_t magic;
+  uint32_t formatVersion;
+  uint32_t headerSize;
+  std::atomic<uint32_t> flags;
+  // sequence lock, odd while the sections are rewritten
+  std::atomic<uint64_t> seq;
+  // version of the exported route database snapshot
+  int64_t routeDbVersion;
+  // size of the file, readers remap when it grows
+  uint64_t fileSize;
+  uint64_t numUnicastRoutes;
+  uint64_t numMplsRoutes;
+  uint64_t numNextHops;
+  uint64_t numLabels;
+  uint64_t namesSize;
+  uint64_t unicastOffset;
+  uint64_t mplsOffset;
+  uint64_t nextHopsOffset;
+  uint64_t labelsOffset;
+  uint64_t namesOffset;
+  // node name of the route database in the names section
+  uint64_t nodeNameOffset;
+};
+
+struct UnicastEntry {
+  uint8_t addr[16];
+  uint8_t addrLen;
+  uint8_t reserved;
+  int16_t prefixLength;
+  uint32_t numNextHops;
+  uint64_t firstNextHop;
+};
+
+struct MplsEntry {
+  int32_t topLabel;
+  uint32_t numNextHops;
+  uint64_t firstNextHop;
+};
+
+struct NextHopEntry {
+  uint8_t addr[16];
+  uint8_t addrLen;
+  // MplsActionCode + 1, 0 without MPLS action
+  uint8_t mplsAction;
+  uint8_t useNonShortestRoute;
+  uint8_t reserved;
+  int32_t weight;
+  int32_t metric;
+  int32_t swapLabel;
+  uint32_t numLabels;
+  uint32_t ifNameOffset;
+  uint64_t firstLabel;
+};
+
+} // namespace route_export
+
+//
+// Sections of an export as of one sequence number. Accessors check bounds
+// against the mapping, data read may be torn until the sequence number is
+// checked again
+//
+class RouteDbExportView {
+ public:
+  RouteDbExportView(const char* base, size_t size);
+
+  // header sections fit in the mapping
+  bool isValid() const;
+
+  int64_t getVersion() const;
+  folly::StringPiece getNodeName() const;
+
+  folly::Range<const route_export::UnicastEntry*> getUnicastEntries() const;
+  folly::Range<const route_export::MplsEntry*> getMplsEntries() const;
+  folly::Range<const route_export::NextHopEntry*> getNextHops(
+      const route_export::UnicastEntry& entry) const;
+  folly::Range<const route_export::NextHopEntry*> getNextHops(
+      const route_export::MplsEntry& entry) const;
+  folly::Range<const int32_t*> getLabels(
+      const route_export::NextHopEntry& nextHop) const;
+  folly::StringPiece getIfName(const route_export::NextHopEntry& nextHop) const;
+
+  // binary search of an exact prefix or label
+  const route_export::UnicastEntry* findUnicastEntry(
+      const thrift::IpPrefix& prefix) const;
+  const route_export::MplsEntry* findMplsEntry(int32_t label) const;
+
+  // decode entries
+  thrift::UnicastRoute toUnicastRoute(
+      const route_export::UnicastEntry& entry) const;
+  thrift::MplsRoute toMplsRoute(const route_export::MplsEntry& entry) const;
+
+ private:
+  template <typename T>
+  folly::Range<const T*> getSection(
+      uint64_t offset, uint64_t count, uint64_t first, uint64_t num) const;
+
+  thrift::NextHopThrift toNextHop(
+      const route_export::NextHopEntry& nextHop) const;
+
+  // NUL terminated string at offset of the names section, empty if invalid
+  folly::StringPiece getName(uint64_t offset) const;
+
+  const char* base_{nullptr};
+  size_t size_{0};
+
+  // header fields, read once
+  int64_t version_{0};
+  uint64_t numUnicastRoutes_{0};
+  uint64_t numMplsRoutes_{0};
+  uint64_t numNextHops_{0};
+  uint64_t numLabels_{0};
+  uint64_t namesSize_{0};
+  uint64_t unicastOffset_{0};
+  uint64_t mplsOffset_{0};
+  uint64_t nextHopsOffset_{0};
+  uint64_t labelsOffset_{0};
+  uint64_t namesOffset_{0};
+  uint64_t nodeNameOffset_{0};
+  bool valid_{false};
+};
+
+//
+// Writer of the export, owned by Fib
+//
+class RouteDbExporter {
+ public:
+  // creates or replaces the file at path, throws std::system_error on failure
+  explicit RouteDbExporter(std::string path);
+  ~RouteDbExporter();
+
+  RouteDbExporter(const RouteDbExporter&) = delete;
+  RouteDbExporter& operator=(const RouteDbExporter&) = delete;
+
+  // replace exported routes with the ones of snapshot, throws
+  // std::system_error if the file can't grow
+  void publish(const RouteDbSnapshot& snapshot);
+
+  const std::string&
+  getPath() const {
+    return path_;
+  }
+
+ private:
+  // grow file and mapping to at least size
+  void ensureSize(size_t size);
+
+  route_export::Header* getHeader() const;
+
+  const std::string path_;
+  int fd_{-1};
+  char* base_{nullptr};
+  size_t size_{0};
+  // sections built off the mapping, kept to reuse their allocation
+  std::string buffer_;
+};
+
+//
+// Reader of the export, not thread safe
+//
+class RouteDbExportReader {
+ public:
+  // throws std::runtime_error if the file isn't a valid export
+  explicit RouteDbExportReader(const std::string& path);
+  ~RouteDbExportReader();
+
+  RouteDbExportReader(const RouteDbExportReader&) = delete;
+  RouteDbExportReader& operator=(const RouteDbExportReader&) = delete;
+
+  // run fn on a view of the export until it ran on a consistent one, fn must
+  // start over on each run. Returns false if no consistent view was seen
+  // after maxRetries
+  bool read(
+      folly::FunctionRef<void(const RouteDbExportView&)> fn,
+      size_t maxRetries = 1000);
+
+  // writer of the file went away, a new one may have replaced it
+  bool isClosed() const;
+
+  // helpers on top of read, none if no consistent view was seen
+  folly::Optional<int64_t> getVersion();
+  folly::Optional<thrift::RouteDatabase> getRouteDatabase();
+  folly::Optional<folly::Optional<thrift::UnicastRoute>> findUnicastRoute(
+      const thrift::IpPrefix& prefix);
+  folly::Optional<folly::Optional<thrift::MplsRoute>> findMplsRoute(
+      int32_t label);
+
+ private:
+  // remap if the file grew
+  void refreshMapping();
+
+  const route_export::Header* getHeader() const;
+
+  int fd_{-1};
+  const char* base_{nullptr};
+  size_t size_{0};
+};
+
+} // namespace openr
@@ -0,0 +1,326 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/fib/RouteDbSnapshot.h"
+
+#include <functional>
+#include <unordered_map>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+RouteDbSnapshot::RouteDbSnapshot(std::string nodeName, size_t numBuckets)
+    : nodeName_(std::move(nodeName)),
+      unicastBuckets_(numBuckets),
+      mplsBuckets_(numBuckets) {
+  CHECK_LT(0, numBuckets);
+}
+
+size_t
+RouteDbSnapshot::getBucket(const thrift::IpPrefix& prefix) const {
+  return std::hash<thrift::IpPrefix>()(prefix) % unicastBuckets_.size();
+}
+
+size_t
+RouteDbSnapshot::getBucket(int32_t label) const {
+  return static_cast<uint32_t>(label) % mplsBuckets_.size();
+}
+
+thrift::RouteDatabase
+RouteDbSnapshot::toRouteDatabase() const {
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = nodeName_;
+  routeDb.unicastRoutes = getUnicastRoutes();
+  routeDb.mplsRoutes = getMplsRoutes();
+  return routeDb;
+}
+
+std::vector<thrift::UnicastRoute>
+RouteDbSnapshot::getUnicastRoutes() const {
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(numUnicastRoutes_);
+  forEachUnicastRoute(
+      [&routes](const thrift::UnicastRoute& route) {
+        routes.emplace_back(route);
+      });
+  return routes;
+}
+
+std::vector<thrift::MplsRoute>
+RouteDbSnapshot::getMplsRoutes() const {
+  std::vector<thrift::MplsRoute> routes;
+  routes.reserve(numMplsRoutes_);
+  forEachMplsRoute(
+      [&routes](const thrift::MplsRoute& route) { routes.emplace_back(route); });
+  return routes;
+}
+
+void
+RouteDbSnapshot::forEachUnicastRoute(
+    folly::FunctionRef<void(const thrift::UnicastRoute&)> fn) const {
+  for (auto const& bucket : unicastBuckets_) {
+    if (not bucket) {
+      continue;
+    }
+    for (auto const& kv : *bucket) {
+      fn(*kv.second);
+    }
+  }
+}
+
+void
+RouteDbSnapshot::forEachMplsRoute(
+    folly::FunctionRef<void(const thrift::MplsRoute&)> fn) const {
+  for (auto const& bucket : mplsBuckets_) {
+    if (not bucket) {
+      continue;
+    }
+    for (auto const& kv : *bucket) {
+      fn(*kv.second);
+    }
+  }
+}
+
+const thrift::UnicastRoute*
+RouteDbSnapshot::findUnicastRoute(const thrift::IpPrefix& prefix) const {
+  auto const& bucket = unicastBuckets_.at(getBucket(prefix));
+  if (not bucket) {
+    return nullptr;
+  }
+  auto it = bucket->find(prefix);
+  return it == bucket->end() ? nullptr : it->second.get();
+}
+
+const thrift::MplsRoute*
+RouteDbSnapshot::findMplsRoute(int32_t label) const {
+  auto const& bucket = mplsBuckets_.at(getBucket(label));
+  if (not bucket) {
+    return nullptr;
+  }
+  auto it = bucket->find(label);
+  return it == bucket->end() ? nullptr : it->second.get();
+}
+
+namespace {
+
+// append up to limit routes of buckets to routes, skipping the first offset
+// ones. offset and limit are updated by the routes skipped and appended
+template <typename Bucket, typename Route>
+void
+appendPage(
+    const std::vector<std::shared_ptr<const Bucket>>& buckets,
+    size_t& offset,
+    size_t& limit,
+    std::vector<Route>& routes) {
+  for (auto const& bucket : buckets) {
+    if (limit == 0) {
+      return;
+    }
+    if (not bucket) {
+      continue;
+    }
+    if (offset >= bucket->size()) {
+      offset -= bucket->size();
+      continue;
+    }
+    auto it = std::next(bucket->begin(), offset);
+    offset = 0;
+    for (; it != bucket->end() and limit > 0; ++it, --limit) {
+      routes.emplace_back(*it->second);
+    }
+  }
+}
+
+} // namespace
+
+thrift::RouteDatabasePage
+RouteDbSnapshot::getPage(size_t offset, size_t limit) const {
+  thrift::RouteDatabasePage page;
+  page.thisNodeName = nodeName_;
+  page.version = version_;
+
+  const size_t numRoutes = numUnicastRoutes_ + numMplsRoutes_;
+  if (offset + limit < numRoutes) {
+    page.nextOffset = static_cast<int64_t>(offset + limit);
+  }
+  if (offset < numUnicastRoutes_) {
+    appendPage(unicastBuckets_, offset, limit, page.unicastRoutes);
+  } else {
+    offset -= numUnicastRoutes_;
+  }
+  appendPage(mplsBuckets_, offset, limit, page.mplsRoutes);
+  return page;
+}
+
+RouteDbSnapshots::RouteDbSnapshots(
+    std::string nodeName,
+    size_t numBuckets,
+    size_t numRetainedSnapshots,
+    size_t maxRetainedChanges)
+    : numRetainedSnapshots_(numRetainedSnapshots),
+      maxRetainedChanges_(maxRetainedChanges) {
+  CHECK_LT(0, numRetainedSnapshots_);
+  state_.wlock()->snapshots.emplace_back(
+      std::make_shared<RouteDbSnapshot>(std::move(nodeName), numBuckets));
+}
+
+void
+RouteDbSnapshots::publish(const RouteUpdate& routeUpdate) {
+  // Only we replace the latest snapshot, build the next one without holding
+  // the lock. Copying the snapshot copies pointers to its buckets
+  auto next = std::make_shared<RouteDbSnapshot>(*get());
+  ++next->version_;
+  Changes changes;
+  changes.version = next->version_;
+
+  // buckets copied for this version, they are ours to modify
+  std::unordered_map<size_t, RouteDbSnapshot::UnicastBucket*> unicastCopies;
+  auto getUnicastCopy = [&](size_t index) -> RouteDbSnapshot::UnicastBucket& {
+    auto it = unicastCopies.find(index);
+    if (it == unicastCopies.end()) {
+      auto& bucket = next->unicastBuckets_.at(index);
+      auto copy = bucket
+          ? std::make_shared<RouteDbSnapshot::UnicastBucket>(*bucket)
+          : std::make_shared<RouteDbSnapshot::UnicastBucket>();
+      it = unicastCopies.emplace(index, copy.get()).first;
+      bucket = std::move(copy);
+    }
+    return *it->second;
+  };
+  std::unordered_map<size_t, RouteDbSnapshot::MplsBucket*> mplsCopies;
+  auto getMplsCopy = [&](size_t index) -> RouteDbSnapshot::MplsBucket& {
+    auto it = mplsCopies.find(index);
+    if (it == mplsCopies.end()) {
+      auto& bucket = next->mplsBuckets_.at(index);
+      auto copy = bucket
+          ? std::make_shared<RouteDbSnapshot::MplsBucket>(*bucket)
+          : std::make_shared<RouteDbSnapshot::MplsBucket>();
+      it = mplsCopies.emplace(index, copy.get()).first;
+      bucket = std::move(copy);
+    }
+    return *it->second;
+  };
+
+  for (auto const& route : routeUpdate.unicastRoutesToUpdate) {
+    auto& bucket = getUnicastCopy(next->getBucket(route->dest));
+    auto res = bucket.emplace(route->dest, route);
+    if (res.second) {
+      ++next->numUnicastRoutes_;
+    } else {
+      res.first->second = route;
+    }
+    changes.prefixes.emplace(route->dest);
+  }
+  for (auto const& prefix : routeUpdate.unicastRoutesToDelete) {
+    if (not next->findUnicastRoute(prefix)) {
+      continue;
+    }
+    getUnicastCopy(next->getBucket(prefix)).erase(prefix);
+    --next->numUnicastRoutes_;
+    changes.prefixes.emplace(prefix);
+  }
+  for (auto const& route : routeUpdate.mplsRoutesToUpdate) {
+    auto& bucket = getMplsCopy(next->getBucket(route->topLabel));
+    auto res = bucket.emplace(route->topLabel, route);
+    if (res.second) {
+      ++next->numMplsRoutes_;
+    } else {
+      res.first->second = route;
+    }
+    changes.labels.emplace(route->topLabel);
+  }
+  for (auto const label : routeUpdate.mplsRoutesToDelete) {
+    if (not next->findMplsRoute(label)) {
+      continue;
+    }
+    getMplsCopy(next->getBucket(label)).erase(label);
+    --next->numMplsRoutes_;
+    changes.labels.emplace(label);
+  }
+
+  auto state = state_.wlock();
+  state->snapshots.emplace_front(std::move(next));
+  while (state->snapshots.size() > numRetainedSnapshots_) {
+    state->snapshots.pop_back();
+  }
+  state->numChanges += changes.prefixes.size() + changes.labels.size();
+  state->changes.emplace_back(std::move(changes));
+  while (state->numChanges > maxRetainedChanges_) {
+    auto const& oldest = state->changes.front();
+    state->numChanges -= oldest.prefixes.size() + oldest.labels.size();
+    state->baseVersion = oldest.version;
+    state->changes.pop_front();
+  }
+}
+
+std::shared_ptr<const RouteDbSnapshot>
+RouteDbSnapshots::get() const {
+  return state_.rlock()->snapshots.front();
+}
+
+std::shared_ptr<const RouteDbSnapshot>
+RouteDbSnapshots::get(int64_t version) const {
+  auto state = state_.rlock();
+  for (auto const& snapshot : state->snapshots) {
+    if (snapshot->getVersion() == version) {
+      return snapshot;
+    }
+  }
+  return nullptr;
+}
+
+thrift::RouteDatabaseChanges
+RouteDbSnapshots::getChangesSince(int64_t version) const {
+  thrift::RouteDatabaseChanges result;
+  std::shared_ptr<const RouteDbSnapshot> snapshot;
+  std::unordered_set<thrift::IpPrefix> prefixes;
+  std::unordered_set<int32_t> labels;
+  {
+    auto state = state_.rlock();
+    snapshot = state->snapshots.front();
+    result.fullDump =
+        version < state->baseVersion or version > snapshot->getVersion();
+    if (not result.fullDump) {
+      // changes are in version order, collect the ones after version
+      for (auto it = state->changes.rbegin();
+           it != state->changes.rend() and it->version > version;
+           ++it) {
+        prefixes.insert(it->prefixes.begin(), it->prefixes.end());
+        labels.insert(it->labels.begin(), it->labels.end());
+      }
+    }
+  }
+
+  result.version = snapshot->getVersion();
+  auto& delta = result.delta;
+  delta.thisNodeName = snapshot->getNodeName();
+  if (result.fullDump) {
+    delta.unicastRoutesToUpdate = snapshot->getUnicastRoutes();
+    delta.mplsRoutesToUpdate = snapshot->getMplsRoutes();
+    return result;
+  }
+
+  // routes changed since version are either updated or deleted by now
+  for (auto const& prefix : prefixes) {
+    if (auto route = snapshot->findUnicastRoute(prefix)) {
+      delta.unicastRoutesToUpdate.emplace_back(*route);
+    } else {
+      delta.unicastRoutesToDelete.emplace_back(prefix);
+    }
+  }
+  for (auto const label : labels) {
+    if (auto route = snapshot->findMplsRoute(label)) {
+      delta.mplsRoutesToUpdate.emplace_back(*route);
+    } else {
+      delta.mplsRoutesToDelete.emplace_back(label);
+    }
+  }
+  return result;
+}
+
+} // namespace openr
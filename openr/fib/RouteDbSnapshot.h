@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/fib/RouteUpdate.h>
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+//
+// Immutable copy of a route database at a version. Routes are kept in buckets
+// by hash of their prefix or label. Buckets are shared between versions, the
+// next version copies the buckets its changes touch only. Routes are shared
+// with the route updates they were published by.
+//
+class RouteDbSnapshot {
+ public:
+  using UnicastBucket = std::map<thrift::IpPrefix, UnicastRoutePtr>;
+  using MplsBucket = std::map<int32_t, MplsRoutePtr>;
+
+  // empty route database at version 0
+  RouteDbSnapshot(std::string nodeName, size_t numBuckets);
+
+  int64_t
+  getVersion() const {
+    return version_;
+  }
+
+  const std::string&
+  getNodeName() const {
+    return nodeName_;
+  }
+
+  size_t
+  getNumUnicastRoutes() const {
+    return numUnicastRoutes_;
+  }
+
+  size_t
+  getNumMplsRoutes() const {
+    return numMplsRoutes_;
+  }
+
+  // all routes, in snapshot order
+  thrift::RouteDatabase toRouteDatabase() const;
+  std::vector<thrift::UnicastRoute> getUnicastRoutes() const;
+  std::vector<thrift::MplsRoute> getMplsRoutes() const;
+
+  // visit all routes in snapshot order without copying them
+  void forEachUnicastRoute(
+      folly::FunctionRef<void(const thrift::UnicastRoute&)> fn) const;
+  void forEachMplsRoute(
+      folly::FunctionRef<void(const thrift::MplsRoute&)> fn) const;
+
+  // route of prefix or label, nullptr if there is none
+  const thrift::UnicastRoute* findUnicastRoute(
+      const thrift::IpPrefix& prefix) const;
+  const thrift::MplsRoute* findMplsRoute(int32_t label) const;
+
+  // up to limit routes starting at offset, counting unicast routes followed by
+  // MPLS routes in snapshot order. Snapshot order is stable for a version only
+  thrift::RouteDatabasePage getPage(size_t offset, size_t limit) const;
+
+ private:
+  friend class RouteDbSnapshots;
+
+  size_t getBucket(const thrift::IpPrefix& prefix) const;
+  size_t getBucket(int32_t label) const;
+
+  const std::string nodeName_;
+  int64_t version_{0};
+
+  // null buckets are empty
+  std::vector<std::shared_ptr<const UnicastBucket>> unicastBuckets_;
+  std::vector<std::shared_ptr<const MplsBucket>> mplsBuckets_;
+  size_t numUnicastRoutes_{0};
+  size_t numMplsRoutes_{0};
+};
+
+//
+// Route database of a module published as versioned snapshots. The owning
+// module publishes its route changes from its own thread, any other thread
+// reads the latest snapshot, one of the recent ones or the changes since a
+// recent version without synchronizing with the owner.
+//
+class RouteDbSnapshots {
+ public:
+  explicit RouteDbSnapshots(
+      std::string nodeName,
+      size_t numBuckets = 1024,
+      size_t numRetainedSnapshots = 16,
+      size_t maxRetainedChanges = 200000);
+
+  // not thread safe, meant to be called by the owner of the routes only
+  void publish(const RouteUpdate& routeUpdate);
+
+  // latest snapshot, never null
+  std::shared_ptr<const RouteDbSnapshot> get() const;
+
+  // snapshot of version if it is still retained, null otherwise
+  std::shared_ptr<const RouteDbSnapshot> get(int64_t version) const;
+
+  // changes between version and the latest snapshot. Has all routes as
+  // updates with fullDump set if changes since version are no longer retained
+  thrift::RouteDatabaseChanges getChangesSince(int64_t version) const;
+
+ private:
+  // routes changed by a version
+  struct Changes {
+    int64_t version{0};
+    std::unordered_set<thrift::IpPrefix> prefixes;
+    std::unordered_set<int32_t> labels;
+  };
+
+  struct State {
+    // latest first
+    std::deque<std::shared_ptr<const RouteDbSnapshot>> snapshots;
+    // oldest first, cover the versions after baseVersion
+    std::deque<Changes> changes;
+    int64_t baseVersion{0};
+    size_t numChanges{0};
+  };
+
+  const size_t numRetainedSnapshots_{0};
+  const size_t maxRetainedChanges_{0};
+
+  folly::Synchronized<State> state_;
+};
+
+} // namespace openr
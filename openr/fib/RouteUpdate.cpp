@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/fib/RouteUpdate.h"
+
+namespace openr {
+
+RouteUpdate::RouteUpdate(const thrift::RouteDatabaseDelta& routeDelta)
+    : thisNodeName(routeDelta.thisNodeName),
+      unicastRoutesToDelete(routeDelta.unicastRoutesToDelete),
+      mplsRoutesToDelete(routeDelta.mplsRoutesToDelete),
+      perfEvents(routeDelta.perfEvents) {
+  unicastRoutesToUpdate.reserve(routeDelta.unicastRoutesToUpdate.size());
+  for (auto const& route : routeDelta.unicastRoutesToUpdate) {
+    unicastRoutesToUpdate.emplace_back(
+        std::make_shared<const thrift::UnicastRoute>(route));
+  }
+  mplsRoutesToUpdate.reserve(routeDelta.mplsRoutesToUpdate.size());
+  for (auto const& route : routeDelta.mplsRoutesToUpdate) {
+    mplsRoutesToUpdate.emplace_back(
+        std::make_shared<const thrift::MplsRoute>(route));
+  }
+}
+
+thrift::RouteDatabaseDelta
+RouteUpdate::toThrift() const {
+  thrift::RouteDatabaseDelta routeDelta;
+  routeDelta.thisNodeName = thisNodeName;
+  routeDelta.unicastRoutesToUpdate.reserve(unicastRoutesToUpdate.size());
+  for (auto const& route : unicastRoutesToUpdate) {
+    routeDelta.unicastRoutesToUpdate.emplace_back(*route);
+  }
+  routeDelta.unicastRoutesToDelete = unicastRoutesToDelete;
+  routeDelta.mplsRoutesToUpdate.reserve(mplsRoutesToUpdate.size());
+  for (auto const& route : mplsRoutesToUpdate) {
+    routeDelta.mplsRoutesToUpdate.emplace_back(*route);
+  }
+  routeDelta.mplsRoutesToDelete = mplsRoutesToDelete;
+  routeDelta.perfEvents = perfEvents;
+  return routeDelta;
+}
+
+} // namespace openr
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Optional.h>
+
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+//
+// Route records are immutable once created and shared, by reference count,
+// between the route updates carrying them and the route databases of the
+// modules holding them, e.g. route snapshots of Decision and Fib along with
+// the route state of Fib.
+//
+using UnicastRoutePtr = std::shared_ptr<const thrift::UnicastRoute>;
+using MplsRoutePtr = std::shared_ptr<const thrift::MplsRoute>;
+
+//
+// Route changes published by Decision on the route updates queue, the
+// in-memory counterpart of thrift::RouteDatabaseDelta. Copying it copies
+// pointers to its routes only.
+//
+struct RouteUpdate {
+  RouteUpdate() = default;
+
+  // copies the routes of routeDelta into new records
+  explicit RouteUpdate(const thrift::RouteDatabaseDelta& routeDelta);
+
+  // copy of the routes as thrift delta, e.g. to program or expose them
+  thrift::RouteDatabaseDelta toThrift() const;
+
+  bool
+  empty() const {
+    return unicastRoutesToUpdate.empty() and unicastRoutesToDelete.empty() and
+        mplsRoutesToUpdate.empty() and mplsRoutesToDelete.empty();
+  }
+
+  std::string thisNodeName;
+  std::vector<UnicastRoutePtr> unicastRoutesToUpdate;
+  std::vector<thrift::IpPrefix> unicastRoutesToDelete;
+  std::vector<MplsRoutePtr> mplsRoutesToUpdate;
+  std::vector<int32_t> mplsRoutesToDelete;
+  folly::Optional<thrift::PerfEvents> perfEvents;
+};
+
+} // namespace openr
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/fib/FibBatcher.h>
+
+using namespace openr;
+
+namespace {
+
+FibBatcher::Config
+createConfig() {
+  FibBatcher::Config config;
+  config.minBatchSize = 10;
+  config.maxBatchSize = 100;
+  config.maxConcurrency = 3;
+  config.targetLatency = std::chrono::milliseconds(100);
+  return config;
+}
+
+} // namespace
+
+TEST(FibBatcherTest, Disabled) {
+  FibBatcher batcher(FibBatcher::Config{});
+  EXPECT_EQ(0, batcher.getBatchSize());
+  EXPECT_EQ(1, batcher.getConcurrency());
+
+  // latency is recorded, batches stay unbounded
+  batcher.addSample(1000, std::chrono::milliseconds(5000));
+  EXPECT_EQ(0, batcher.getBatchSize());
+  EXPECT_EQ(1, batcher.getConcurrency());
+  EXPECT_EQ(1, batcher.getLatencyHistogram().getCount());
+  EXPECT_DOUBLE_EQ(200, batcher.getThroughput());
+}
+
+TEST(FibBatcherTest, BackOff) {
+  FibBatcher batcher(createConfig());
+  EXPECT_EQ(100, batcher.getBatchSize());
+
+  // slow calls halve the batch size, down to the min
+  batcher.addSample(100, std::chrono::milliseconds(200));
+  EXPECT_EQ(50, batcher.getBatchSize());
+  batcher.addSample(50, std::chrono::milliseconds(200));
+  batcher.addSample(25, std::chrono::milliseconds(200));
+  batcher.addSample(12, std::chrono::milliseconds(200));
+  EXPECT_EQ(10, batcher.getBatchSize());
+  EXPECT_EQ(1, batcher.getConcurrency());
+
+  // calls within target but not fast enough leave it as is
+  batcher.addSample(10, std::chrono::milliseconds(80));
+  EXPECT_EQ(10, batcher.getBatchSize());
+}
+
+TEST(FibBatcherTest, Growth) {
+  FibBatcher batcher(createConfig());
+  batcher.addSample(100, std::chrono::milliseconds(200));
+  batcher.addSample(50, std::chrono::milliseconds(200));
+  EXPECT_EQ(25, batcher.getBatchSize());
+
+  // partial batches don't tell
+  batcher.addSample(5, std::chrono::milliseconds(1));
+  EXPECT_EQ(25, batcher.getBatchSize());
+
+  // fast full batches grow by a quarter, up to the max
+  batcher.addSample(25, std::chrono::milliseconds(10));
+  EXPECT_EQ(31, batcher.getBatchSize());
+  while (batcher.getBatchSize() < 100) {
+    batcher.addSample(batcher.getBatchSize(), std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(100, batcher.getBatchSize());
+  EXPECT_EQ(1, batcher.getConcurrency());
+
+  // then add concurrent calls, up to the max
+  batcher.addSample(100, std::chrono::milliseconds(10));
+  EXPECT_EQ(2, batcher.getConcurrency());
+  batcher.addSample(100, std::chrono::milliseconds(10));
+  batcher.addSample(100, std::chrono::milliseconds(10));
+  EXPECT_EQ(3, batcher.getConcurrency());
+
+  // slow calls drop one
+  batcher.addSample(100, std::chrono::milliseconds(200));
+  EXPECT_EQ(50, batcher.getBatchSize());
+  EXPECT_EQ(2, batcher.getConcurrency());
+}
+
+TEST(FibBatcherTest, SetConfig) {
+  FibBatcher batcher(createConfig());
+  batcher.addSample(100, std::chrono::milliseconds(200));
+  EXPECT_EQ(50, batcher.getBatchSize());
+
+  // batch size is brought within the new bounds
+  auto config = createConfig();
+  config.minBatchSize = 60;
+  config.maxBatchSize = 200;
+  config.maxConcurrency = 1;
+  batcher.setConfig(config);
+  EXPECT_EQ(60, batcher.getBatchSize());
+  EXPECT_EQ(1, batcher.getConcurrency());
+  batcher.addSample(60, std::chrono::milliseconds(200));
+  EXPECT_EQ(60, batcher.getBatchSize());
+
+  // disabling batching and enabling it again starts from the max
+  config.maxBatchSize = 0;
+  batcher.setConfig(config);
+  EXPECT_EQ(0, batcher.getBatchSize());
+  config.maxBatchSize = 200;
+  batcher.setConfig(config);
+  EXPECT_EQ(200, batcher.getBatchSize());
+  EXPECT_EQ(200, batcher.getConfig().maxBatchSize);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
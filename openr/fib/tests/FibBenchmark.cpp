@@ -53,6 +53,8 @@ static const long kBitMaskLen = 128;
 static const uint32_t kDeltaSize = 10;
 // Number of nexthops
 const uint8_t kNumOfNexthops = 128;
+// Number of interfaces routes of the local repair benchmark are spread over
+const uint32_t kNumOfRepairInterfaces = 64;
 
 } // anonymous namespace
 
@@ -171,7 +173,7 @@ class FibWrapper {
   std::shared_ptr<ThriftServer> server;
   ScopedServerThread fibThriftThread;
 
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
 
   fbzmq::Context context{};
@@ -214,7 +216,7 @@ BM_Fib(folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
             kNumOfNexthops, kVethNameY)));
   }
   // Send routeDB to Fib and wait for updating completing
-  fibWrapper->routeUpdatesQueue.push(routeDbDelta);
+  fibWrapper->routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
   fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
 
   // Customized time counter
@@ -241,7 +243,7 @@ BM_Fib(folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
     routeDbDelta.perfEvents = perfEvents;
 
     // Send routeDB to Fib for updates
-    fibWrapper->routeUpdatesQueue.push(routeDbDelta);
+    fibWrapper->routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
     fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
 
     // Get time information from perf event
@@ -265,6 +267,147 @@ BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 100);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 9000);
 
+/**
+ * Routes with random nexthops, half of which have a higher metric
+ */
+static std::vector<thrift::UnicastRoute>
+getRoutesWithLfaNextHops(unsigned numOfRoutes) {
+  std::vector<thrift::UnicastRoute> routes;
+  for (auto& prefix :
+       PrefixGenerator::ipv6PrefixGenerator(numOfRoutes, kBitMaskLen)) {
+    auto nextHops =
+        PrefixGenerator::getRandomNextHopsUnicast(kNumOfNexthops, kVethNameY);
+    for (size_t i = 0; i < nextHops.size(); ++i) {
+      nextHops[i].metric = i % 2 ? 20 : 10;
+    }
+    routes.emplace_back(createUnicastRoute(prefix, std::move(nextHops)));
+  }
+  return routes;
+}
+
+/**
+ * Benchmark for best nexthops selection of route updates in Fib
+ * 1. Copy routes with their best nexthops
+ * 2. Select best nexthops in place, on routes owned by Fib
+ */
+static void
+BM_CreateRoutesWithBestNextHops(uint32_t iters, unsigned numOfRoutes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto routes = getRoutesWithLfaNextHops(numOfRoutes);
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss();
+    auto bestRoutes = createUnicastRoutesWithBestNexthops(routes);
+    folly::doNotOptimizeAway(bestRoutes);
+    suspender.rehire();
+  }
+}
+
+static void
+BM_FilterRoutesWithBestNextHops(uint32_t iters, unsigned numOfRoutes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto routes = getRoutesWithLfaNextHops(numOfRoutes);
+  for (uint32_t i = 0; i < iters; i++) {
+    auto bestRoutes = routes;
+    suspender.dismiss();
+    filterUnicastRoutesWithBestNextHops(bestRoutes);
+    folly::doNotOptimizeAway(bestRoutes);
+    suspender.rehire();
+  }
+}
+
+/**
+ * Interface database of the local repair benchmark. All interfaces are up but
+ * the first one, as given. Deltas only carry the first one
+ */
+static thrift::InterfaceDatabase
+getRepairInterfaceDb(bool firstIsUp, bool isDelta, int64_t seqNum) {
+  thrift::InterfaceDatabase intfDb;
+  intfDb.thisNodeName = "node-1";
+  intfDb.isDelta = isDelta;
+  intfDb.seqNum = seqNum;
+  for (uint32_t i = 0; i < kNumOfRepairInterfaces; ++i) {
+    if (isDelta and i > 0) {
+      break;
+    }
+    thrift::InterfaceInfo info;
+    info.isUp = i > 0 or firstIsUp;
+    info.ifIndex = i + 1;
+    intfDb.interfaces.emplace(folly::sformat("vethRepair{}", i), info);
+  }
+  return intfDb;
+}
+
+/**
+ * Benchmark for local repair in Fib
+ * 1. Install routes with a nexthop on one of kNumOfRepairInterfaces
+ *    interfaces and on a common one
+ * 2. Bring the first interface down and wait for its routes to shrink
+ * 3. Bring it up again and wait for its routes to be restored
+ */
+static void
+BM_FibLocalRepair(
+    folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fibWrapper = std::make_unique<FibWrapper>();
+  fibWrapper->mockFibHandler->waitForSyncFib();
+
+  int64_t seqNum{0};
+  auto intfDb = getRepairInterfaceDb(true, false, seqNum++);
+  thrift::InterfaceInfo commonInfo;
+  commonInfo.isUp = true;
+  commonInfo.ifIndex = kNumOfRepairInterfaces + 1;
+  intfDb.interfaces.emplace(kVethNameY, commonInfo);
+  fibWrapper->interfaceUpdatesQueue.push(std::move(intfDb));
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  uint32_t index{0};
+  for (auto& prefix :
+       PrefixGenerator::ipv6PrefixGenerator(numOfPrefixes, kBitMaskLen)) {
+    auto nextHops = PrefixGenerator::getRandomNextHopsUnicast(1, kVethNameY);
+    auto repairNextHops = PrefixGenerator::getRandomNextHopsUnicast(
+        1,
+        folly::sformat("vethRepair{}", index++ % kNumOfRepairInterfaces));
+    nextHops.insert(
+        nextHops.end(), repairNextHops.begin(), repairNextHops.end());
+    routeDbDelta.unicastRoutesToUpdate.emplace_back(
+        createUnicastRoute(prefix, std::move(nextHops)));
+  }
+  fibWrapper->routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
+  fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+
+  uint64_t repairUs{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss();
+    const auto start = std::chrono::steady_clock::now();
+    fibWrapper->interfaceUpdatesQueue.push(
+        getRepairInterfaceDb(false, true, seqNum++));
+    fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+    repairUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    fibWrapper->interfaceUpdatesQueue.push(
+        getRepairInterfaceDb(true, true, seqNum++));
+    fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+    suspender.rehire();
+  }
+
+  // average time from interface down to routes shrunk
+  counters["local_repair_us"] = repairUs / (iters == 0 ? 1 : iters);
+}
+
+// The parameter is the number of prefixes sent to fib
+BENCHMARK_COUNTERS_PARAM(BM_FibLocalRepair, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_FibLocalRepair, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_FibLocalRepair, counters, 100000);
+
+// The parameter is the number of routes
+BENCHMARK_PARAM(BM_CreateRoutesWithBestNextHops, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_FilterRoutesWithBestNextHops, 1000);
+BENCHMARK_PARAM(BM_CreateRoutesWithBestNextHops, 10000);
+BENCHMARK_RELATIVE_PARAM(BM_FilterRoutesWithBestNextHops, 10000);
+
 } // namespace openr
 
 int
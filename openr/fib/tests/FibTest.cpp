@@ -8,6 +8,7 @@
 #include "MockNetlinkFibHandler.h"
 
 #include <chrono>
+#include <functional>
 #include <thread>
 
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
@@ -29,12 +30,14 @@
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <thrift/lib/cpp2/util/ScopedServerThread.h>
 
+#include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/fib/Fib.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/messaging/ReplicateQueue.h>
+#include <openr/platform/PlatformPublisher.h>
 #include <openr/tests/OpenrThriftServerWrapper.h>
 
 using namespace std;
@@ -188,16 +191,51 @@ checkEqualMplsRoutes(thrift::RouteDatabase lhs, thrift::RouteDatabase rhs) {
   return true;
 }
 
+thrift::RouteDatabaseDelta
+createRouteDelta(
+    std::vector<thrift::UnicastRoute> unicastRoutesToUpdate,
+    std::vector<thrift::IpPrefix> unicastRoutesToDelete) {
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = std::move(unicastRoutesToUpdate);
+  routeDbDelta.unicastRoutesToDelete = std::move(unicastRoutesToDelete);
+  return routeDbDelta;
+}
+
+// Wait until condition holds, false if it doesn't within timeout
+bool
+waitUntil(
+    std::function<bool()> condition,
+    std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
 class FibTestFixture : public ::testing::Test {
  public:
-  explicit FibTestFixture(bool waitOnDecision = false)
-      : waitOnDecision_(waitOnDecision) {}
+  explicit FibTestFixture(
+      bool waitOnDecision = false,
+      bool enableWarmBoot = false,
+      folly::Optional<PlatformPublisherUrl> platformPubUrl = folly::none)
+      : waitOnDecision_(waitOnDecision),
+        enableWarmBoot_(enableWarmBoot),
+        platformPubUrl_(std::move(platformPubUrl)) {}
   void
   SetUp() override {
     mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
 
     server = make_shared<ThriftServer>();
     server->setNumIOWorkerThreads(1);
+    // route programming calls blocked by tests mustn't hold up keep alive
+    // checks of Fib
+    server->setNumCPUWorkerThreads(4);
     server->setNumAcceptThreads(1);
     server->setPort(0);
     server->setInterface(mockFibHandler);
@@ -218,7 +256,17 @@ class FibTestFixture : public ::testing::Test {
         MonitorSubmitUrl{"inproc://monitor-sub"},
         KvStoreLocalCmdUrl{"inproc://kvstore-cmd"},
         KvStoreLocalPubUrl{"inproc://kvstore-pub"},
-        context);
+        context,
+        false, /* prioritizeHostRoutes */
+        {}, /* priorityPrefixes */
+        0, /* routeTraceBufferSize */
+        enableWarmBoot_,
+        0, /* convergenceTraceBufferSize */
+        1, /* convergenceTraceSampleRate */
+        "", /* routeExportPath */
+        {}, /* batcherConfig */
+        nullptr, /* runtimeKnobs */
+        platformPubUrl_);
 
     fibThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Fib thread starting";
@@ -308,11 +356,35 @@ class FibTestFixture : public ::testing::Test {
     return *resp;
   }
 
+  // Fib processed the route updates adding prefix. They may not be
+  // programmed yet
+  bool
+  hasUnicastRoute(thrift::IpPrefix const& prefix) {
+    for (auto const& route : getRouteDb().unicastRoutes) {
+      if (route.dest == prefix) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Push a route update and wait until the agent received the call adding
+  // its routes, which is held there while programming is blocked
+  void
+  pushBlockedRouteUpdate(thrift::RouteDatabaseDelta const& routeDbDelta) {
+    mockFibHandler->blockProgramming();
+    const auto numCalls = mockFibHandler->getProgrammingCallCount();
+    routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
+    EXPECT_TRUE(waitUntil([this, numCalls]() {
+      return mockFibHandler->getProgrammingCallCount() > numCalls;
+    }));
+  }
+
   int port{0};
   std::shared_ptr<ThriftServer> server;
   ScopedServerThread fibThriftThread;
 
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
 
   fbzmq::Context context{};
@@ -330,6 +402,8 @@ class FibTestFixture : public ::testing::Test {
   std::shared_ptr<OpenrThriftServerWrapper> openrThriftServerWrapper_{nullptr};
 
   bool waitOnDecision_{false};
+  bool enableWarmBoot_{false};
+  folly::Optional<PlatformPublisherUrl> platformPubUrl_;
 };
 
 TEST_F(FibTestFixture, processRouteDb) {
@@ -354,7 +428,7 @@ TEST_F(FibTestFixture, processRouteDb) {
   routeDbDelta.thisNodeName = "node-1";
   routeDbDelta.unicastRoutesToUpdate.emplace_back(
       createUnicastRoute(prefix2, {path1_2_1, path1_2_2}));
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   int64_t countAdd = mockFibHandler->getAddRoutesCount();
   // add routes
@@ -375,7 +449,7 @@ TEST_F(FibTestFixture, processRouteDb) {
       createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
   routeDbDelta.unicastRoutesToUpdate.emplace_back(
       createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   // syncFib debounce
   mockFibHandler->waitForUpdateUnicastRoutes();
@@ -397,7 +471,7 @@ TEST_F(FibTestFixture, processRouteDb) {
       createUnicastRoute(prefix2, {path1_2_2, path1_2_3}));
   routeDbDelta.unicastRoutesToUpdate.emplace_back(
       createUnicastRoute(prefix3, {path1_3_2}));
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
   // syncFib debounce
   mockFibHandler->waitForUpdateUnicastRoutes();
   EXPECT_GT(mockFibHandler->getAddRoutesCount(), countAdd);
@@ -448,7 +522,10 @@ TEST_F(FibTestFixture, processInterfaceDb) {
                   ),
           },
       },
-      thrift::PerfEvents());
+      thrift::PerfEvents(),
+      false, // isDelta
+      {}, // deletedInterfaces
+      0); // seqNum
   intfDb.perfEvents = folly::none;
   LOG(INFO) << "Pushing interface update";
   interfaceUpdatesQueue.push(intfDb);
@@ -462,7 +539,7 @@ TEST_F(FibTestFixture, processInterfaceDb) {
   routeDbDelta.mplsRoutesToUpdate = {
       createMplsRoute(label2, {mpls_path1_2_1, mpls_path1_2_2}),
       createMplsRoute(label1, {mpls_path1_2_1})};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   mockFibHandler->waitForUpdateUnicastRoutes();
   mockFibHandler->waitForUpdateMplsRoutes();
@@ -491,7 +568,10 @@ TEST_F(FibTestFixture, processInterfaceDb) {
                   ),
           },
       },
-      thrift::PerfEvents());
+      thrift::PerfEvents(),
+      false, // isDelta
+      {}, // deletedInterfaces
+      0); // seqNum
   intfChange_1.perfEvents = folly::none;
   LOG(INFO) << "Pushing interface update";
   interfaceUpdatesQueue.push(intfChange_1);
@@ -515,7 +595,7 @@ TEST_F(FibTestFixture, processInterfaceDb) {
   routeDbDelta.unicastRoutesToUpdate = {
       createUnicastRoute(prefix1, {path1_2_2})};
   routeDbDelta.mplsRoutesToUpdate = {createMplsRoute(label1, {mpls_path1_2_2})};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   mockFibHandler->waitForUpdateUnicastRoutes();
   mockFibHandler->waitForUpdateMplsRoutes();
@@ -546,7 +626,10 @@ TEST_F(FibTestFixture, processInterfaceDb) {
                   ),
           },
       },
-      thrift::PerfEvents());
+      thrift::PerfEvents(),
+      false, // isDelta
+      {}, // deletedInterfaces
+      0); // seqNum
   intfChange_2.perfEvents = folly::none;
   LOG(INFO) << "Pushing interface update";
   interfaceUpdatesQueue.push(intfChange_2);
@@ -603,7 +686,7 @@ TEST_F(FibTestFixture, basicAddAndDelete) {
       createMplsRoute(label1, {mpls_path1_2_1, mpls_path1_2_2}),
       createMplsRoute(label2, {mpls_path1_2_2}),
       createMplsRoute(label3, {mpls_path1_2_1})};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   // wait
   mockFibHandler->waitForUpdateUnicastRoutes();
@@ -625,7 +708,7 @@ TEST_F(FibTestFixture, basicAddAndDelete) {
   routeDbDelta.mplsRoutesToUpdate.clear();
   routeDbDelta.unicastRoutesToDelete = {prefix3};
   routeDbDelta.mplsRoutesToDelete = {label1, label3};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   mockFibHandler->waitForDeleteUnicastRoutes();
   mockFibHandler->waitForDeleteMplsRoutes();
@@ -649,7 +732,7 @@ TEST_F(FibTestFixture, basicAddAndDelete) {
       createUnicastRoute(prefix3, {path1_3_1, path1_3_2})};
   routeDbDelta.mplsRoutesToUpdate = {
       createMplsRoute(label1, {mpls_path1_2_1, mpls_path1_2_2})};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   mockFibHandler->waitForUpdateUnicastRoutes();
   mockFibHandler->waitForUpdateMplsRoutes();
@@ -683,7 +766,7 @@ TEST_F(FibTestFixture, fibRestart) {
       createMplsRoute(label1, {mpls_path1_2_1, mpls_path1_2_2}),
       createMplsRoute(label2, {mpls_path1_2_2})};
 
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   // initial syncFib debounce
   mockFibHandler->waitForSyncFib();
@@ -712,6 +795,159 @@ TEST_F(FibTestFixture, fibRestart) {
   EXPECT_EQ(mplsRoutes.size(), 2);
 }
 
+/**
+ * Route updates received while a batch is programmed are merged and sent
+ * in a single batch once it completes.
+ */
+TEST_F(FibTestFixture, coalesceRouteUpdatesInFlight) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  const auto numCalls = mockFibHandler->getProgrammingCallCount();
+  pushBlockedRouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix1, {path1_2_1})}, {}));
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix2, {path1_2_1})}, {})));
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix3, {path1_3_1})}, {})));
+  EXPECT_TRUE(waitUntil([this]() { return hasUnicastRoute(prefix3); }));
+  EXPECT_EQ(numCalls + 1, mockFibHandler->getProgrammingCallCount());
+  mockFibHandler->unblockProgramming();
+
+  EXPECT_TRUE(
+      waitUntil([this]() { return mockFibHandler->getAddRoutesCount() == 3; }));
+  EXPECT_EQ(numCalls + 2, mockFibHandler->getProgrammingCallCount());
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+}
+
+/**
+ * Route added and deleted while a batch is programmed is only deleted, the
+ * agent may have programmed it before.
+ */
+TEST_F(FibTestFixture, coalesceAddThenDelete) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  pushBlockedRouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix1, {path1_2_1})}, {}));
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix2, {path1_2_1})}, {})));
+  routeUpdatesQueue.push(RouteUpdate(createRouteDelta({}, {prefix2})));
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix3, {path1_3_1})}, {})));
+  EXPECT_TRUE(waitUntil([this]() { return hasUnicastRoute(prefix3); }));
+  mockFibHandler->unblockProgramming();
+
+  // deletes go first
+  EXPECT_TRUE(
+      waitUntil([this]() { return mockFibHandler->getAddRoutesCount() == 2; }));
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+  for (auto const& route : routes) {
+    EXPECT_NE(route.dest, prefix2);
+  }
+}
+
+/**
+ * Route deleted and added back while a batch is programmed is only added,
+ * with its latest nexthops.
+ */
+TEST_F(FibTestFixture, coalesceDeleteThenAdd) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix2, {path1_2_1})}, {})));
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  pushBlockedRouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix1, {path1_2_1})}, {}));
+  routeUpdatesQueue.push(RouteUpdate(createRouteDelta({}, {prefix2})));
+  routeUpdatesQueue.push(RouteUpdate(createRouteDelta(
+      {createUnicastRoute(prefix2, {path1_3_1}),
+       createUnicastRoute(prefix3, {path1_3_1})},
+      {})));
+  EXPECT_TRUE(waitUntil([this]() { return hasUnicastRoute(prefix3); }));
+  mockFibHandler->unblockProgramming();
+
+  EXPECT_TRUE(
+      waitUntil([this]() { return mockFibHandler->getAddRoutesCount() == 4; }));
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 0);
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+  for (auto const& route : routes) {
+    if (route.dest == prefix2) {
+      ASSERT_EQ(route.nextHops.size(), 1);
+      EXPECT_EQ(route.nextHops.at(0).address.ifName.value(), "iface_1_3_1");
+    }
+  }
+}
+
+/**
+ * Full sync of the route DB waits for the batch being programmed, whose
+ * routes could otherwise land after it.
+ */
+TEST_F(FibTestFixture, syncRouteDbDeferredInFlight) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  pushBlockedRouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix1, {path1_2_1})}, {}));
+
+  // agent restart is noticed by keep alive checks, which schedule a full
+  // sync of the route DB
+  mockFibHandler->restart();
+  /* sleep override */
+  std::this_thread::sleep_for(3 * Constants::kKeepAliveCheckInterval);
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+
+  mockFibHandler->unblockProgramming();
+  mockFibHandler->waitForSyncFib();
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 1);
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes.at(0).dest, prefix1);
+}
+
+/**
+ * Failure of a call in the middle of a batch marks the route DB dirty and
+ * schedules a full sync, which programs the routes of the failed call.
+ */
+TEST_F(FibTestFixture, failureInFlightSyncsRouteDb) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  routeUpdatesQueue.push(RouteUpdate(
+      createRouteDelta({createUnicastRoute(prefix2, {path1_2_1})}, {})));
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 1);
+
+  // deletes succeed, adds which follow fail
+  mockFibHandler->setFailAddUnicastRoutes(true);
+  routeUpdatesQueue.push(RouteUpdate(createRouteDelta(
+      {createUnicastRoute(prefix1, {path1_2_1})}, {prefix2})));
+
+  mockFibHandler->waitForSyncFib();
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 2);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 1);
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes.at(0).dest, prefix1);
+}
+
 class FibTestFixtureWaitOnDecision : public FibTestFixture {
  public:
   FibTestFixtureWaitOnDecision() : FibTestFixture(true) {}
@@ -735,7 +971,7 @@ TEST_F(FibTestFixtureWaitOnDecision, WaitOnDecision) {
       createMplsRoute(label1, {mpls_path1_2_1, mpls_path1_2_2}),
       createMplsRoute(label2, {mpls_path1_2_2})};
 
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   // initial syncFib debounce
   mockFibHandler->waitForSyncFib();
@@ -751,6 +987,47 @@ TEST_F(FibTestFixtureWaitOnDecision, WaitOnDecision) {
   EXPECT_EQ(mockFibHandler->getDelMplsRoutesCount(), 0);
 }
 
+class FibTestFixtureWarmBoot : public FibTestFixture {
+ public:
+  FibTestFixtureWarmBoot() : FibTestFixture(false, true) {}
+};
+
+TEST_F(FibTestFixtureWarmBoot, WarmBoot) {
+  // Routes left in agent by the previous run. Fib reads them on its initial
+  // sync, after the cold start duration
+  mockFibHandler->addUnicastRoutes(
+      kFibId,
+      std::make_unique<std::vector<thrift::UnicastRoute>>(
+          std::vector<thrift::UnicastRoute>{
+              createUnicastRoute(prefix1, {path1_2_1, path1_2_3}),
+              createUnicastRoute(prefix3, {path1_2_1})}));
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  // prefix1 is unchanged, prefix2 is new and prefix3 is no longer computed
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_3}),
+      createUnicastRoute(prefix2, {path1_2_2})};
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
+
+  // only prefix2 is programmed, then stale prefix3 is deleted
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForDeleteUnicastRoutes();
+
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 3);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  std::set<thrift::IpPrefix> prefixes;
+  for (auto const& route : routes) {
+    prefixes.emplace(route.dest);
+  }
+  EXPECT_EQ(prefixes, std::set<thrift::IpPrefix>({prefix1, prefix2}));
+}
+
 TEST_F(FibTestFixture, getMslpRoutesFilteredTest) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -772,7 +1049,7 @@ TEST_F(FibTestFixture, getMslpRoutesFilteredTest) {
   const auto& route2 = createMplsRoute(label2, {mpls_path1_2_2});
   const auto& route3 = createMplsRoute(label3, {mpls_path1_2_1});
   routeDbDelta.mplsRoutesToUpdate = {route1, route2, route3};
-  routeUpdatesQueue.push(routeDbDelta);
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
 
   // wait for mpls
   mockFibHandler->waitForUpdateMplsRoutes();
@@ -819,6 +1096,99 @@ TEST_F(FibTestFixture, getMslpRoutesFilteredTest) {
   EXPECT_EQ(notFoundResp.size(), 0);
 }
 
+class FibTestFixtureNeighborEvents : public FibTestFixture {
+ public:
+  FibTestFixtureNeighborEvents()
+      : FibTestFixture(false, false, kPlatformPubUrl) {}
+
+  void
+  SetUp() override {
+    platformPublisher =
+        std::make_unique<PlatformPublisher>(context, kPlatformPubUrl);
+    FibTestFixture::SetUp();
+  }
+
+  void
+  TearDown() override {
+    FibTestFixture::TearDown();
+    platformPublisher->stop();
+  }
+
+  void
+  publishNeighbor(
+      thrift::NextHopThrift const& nextHop, bool isReachable, bool isFailed) {
+    platformPublisher->publishNeighborEvent(thrift::NeighborEntry(
+        FRAGILE,
+        nextHop.address.ifName.value(),
+        nextHop.address,
+        "", // linkAddr
+        isReachable,
+        isFailed));
+  }
+
+  const PlatformPublisherUrl kPlatformPubUrl{"inproc://platform-pub-url"};
+  std::unique_ptr<PlatformPublisher> platformPublisher;
+};
+
+TEST_F(FibTestFixtureNeighborEvents, PruneFailedNeighbors) {
+  std::vector<thrift::UnicastRoute> routes;
+
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  // Mimic interfaces coming up
+  thrift::InterfaceDatabase intfDb(
+      FRAGILE,
+      "node-1",
+      {
+          {
+              path1_2_1.address.ifName.value(),
+              thrift::InterfaceInfo(FRAGILE, true, 121, {}, {}, {}),
+          },
+          {
+              path1_2_2.address.ifName.value(),
+              thrift::InterfaceInfo(FRAGILE, true, 122, {}, {}, {}),
+          },
+      },
+      thrift::PerfEvents(),
+      false, // isDelta
+      {}, // deletedInterfaces
+      0); // seqNum
+  intfDb.perfEvents = folly::none;
+  interfaceUpdatesQueue.push(intfDb);
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix2, {path1_2_1, path1_2_2}),
+      createUnicastRoute(prefix1, {path1_2_1})};
+  routeUpdatesQueue.push(RouteUpdate(routeDbDelta));
+
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 2);
+
+  // Neighbor of path1_2_1 fails to resolve, its nexthops are pruned while
+  // the interface stays up
+  publishNeighbor(path1_2_1, false /* isReachable */, true /* isFailed */);
+  mockFibHandler->waitForDeleteUnicastRoutes();
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 3);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes.at(0).dest, prefix2);
+  EXPECT_EQ(routes.at(0).nextHops.size(), 1);
+
+  // Neighbor is reachable again, routes are restored
+  publishNeighbor(path1_2_1, true /* isReachable */, false /* isFailed */);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 5);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+}
+
 TEST_F(FibTestFixture, getUnicastRoutesFilteredTest) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -845,7 +1215,7 @@ TEST_F(FibTestFixture, getUnicastRoutesFilteredTest) {
   routeDb.unicastRoutesToUpdate.emplace_back(route2);
   routeDb.unicastRoutesToUpdate.emplace_back(route3);
   routeDb.unicastRoutesToUpdate.emplace_back(route4);
-  routeUpdatesQueue.push(routeDb);
+  routeUpdatesQueue.push(RouteUpdate(routeDb));
   mockFibHandler->waitForUpdateUnicastRoutes();
   mockFibHandler->getRouteTableByClient(routes, kFibId);
   EXPECT_EQ(routes.size(), 4);
@@ -902,15 +1272,15 @@ TEST_F(FibTestFixture, getUnicastRoutesFilteredTest) {
 }
 
 TEST_F(FibTestFixture, longestPrefixMatchTest) {
-  std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> unicastRoutes;
+  PrefixTrie unicastPrefixes;
   const auto& dbPrefix1 = toIpPrefix("192.168.0.0/16");
   const auto& dbPrefix2 = toIpPrefix("192.168.0.0/20");
   const auto& dbPrefix3 = toIpPrefix("192.168.0.0/24");
   const auto& dbPrefix4 = toIpPrefix("192.168.20.16/28");
-  unicastRoutes[dbPrefix1] = createUnicastRoute(dbPrefix1, {});
-  unicastRoutes[dbPrefix2] = createUnicastRoute(dbPrefix2, {});
-  unicastRoutes[dbPrefix3] = createUnicastRoute(dbPrefix3, {});
-  unicastRoutes[dbPrefix4] = createUnicastRoute(dbPrefix4, {});
+  unicastPrefixes.insert(dbPrefix1);
+  unicastPrefixes.insert(dbPrefix2);
+  unicastPrefixes.insert(dbPrefix3);
+  unicastPrefixes.insert(dbPrefix4);
 
   const auto inputPrefix1 =
       folly::IPAddress::tryCreateNetwork("192.168.20.19").value();
@@ -928,36 +1298,43 @@ TEST_F(FibTestFixture, longestPrefixMatchTest) {
       folly::IPAddress::tryCreateNetwork("192.168.0.0/26").value();
 
   // input 192.168.20.19 matched 192.168.20.16/28
-  const auto& result1 = Fib::longestPrefixMatch(inputPrefix1, unicastRoutes);
+  const auto& result1 =
+      Fib::longestPrefixMatch(inputPrefix1, unicastPrefixes);
   EXPECT_TRUE(result1.has_value());
   EXPECT_EQ(result1.value(), dbPrefix4);
 
   // input 192.168.20.16/28 matched 192.168.20.16/28
-  const auto& result2 = Fib::longestPrefixMatch(inputPrefix2, unicastRoutes);
+  const auto& result2 =
+      Fib::longestPrefixMatch(inputPrefix2, unicastPrefixes);
   EXPECT_TRUE(result2.has_value());
   EXPECT_EQ(result2.value(), dbPrefix4);
 
   // input 192.168.0.0 matched 192.168.0.0/24
-  const auto& result3 = Fib::longestPrefixMatch(inputPrefix3, unicastRoutes);
+  const auto& result3 =
+      Fib::longestPrefixMatch(inputPrefix3, unicastPrefixes);
   EXPECT_TRUE(result3.has_value());
   EXPECT_EQ(result3.value(), dbPrefix3);
   //
   // input 192.168.0.0/14 has no match
-  const auto& result4 = Fib::longestPrefixMatch(inputPrefix4, unicastRoutes);
+  const auto& result4 =
+      Fib::longestPrefixMatch(inputPrefix4, unicastPrefixes);
   EXPECT_TRUE(not result4.has_value());
 
   // input 192.168.0.0/18 matched 192.168.0.0/16
-  const auto& result5 = Fib::longestPrefixMatch(inputPrefix5, unicastRoutes);
+  const auto& result5 =
+      Fib::longestPrefixMatch(inputPrefix5, unicastPrefixes);
   EXPECT_TRUE(result5.has_value());
   EXPECT_EQ(result5.value(), dbPrefix1);
 
   // input 192.168.0.0/22 matched 192.168.0.0/20
-  const auto& result6 = Fib::longestPrefixMatch(inputPrefix6, unicastRoutes);
+  const auto& result6 =
+      Fib::longestPrefixMatch(inputPrefix6, unicastPrefixes);
   EXPECT_TRUE(result6.has_value());
   EXPECT_EQ(result6.value(), dbPrefix2);
 
   // input 192.168.0.0/26 matched 192.168.0.0/24
-  const auto& result7 = Fib::longestPrefixMatch(inputPrefix7, unicastRoutes);
+  const auto& result7 =
+      Fib::longestPrefixMatch(inputPrefix7, unicastPrefixes);
   EXPECT_TRUE(result7.has_value());
   EXPECT_EQ(result7.value(), dbPrefix3);
 }
@@ -987,7 +1364,7 @@ TEST_F(FibTestFixture, doNotInstall) {
     routeDb.thisNodeName = "node-1";
     routeDb.unicastRoutesToUpdate.emplace_back(route1);
     routeDb.unicastRoutesToUpdate.emplace_back(route2);
-    routeUpdatesQueue.push(routeDb);
+    routeUpdatesQueue.push(RouteUpdate(routeDb));
   }
   mockFibHandler->waitForSyncFib();
   mockFibHandler->getRouteTableByClient(routes, kFibId);
@@ -1001,7 +1378,7 @@ TEST_F(FibTestFixture, doNotInstall) {
     routeDb.thisNodeName = "node-1";
     routeDb.unicastRoutesToUpdate.emplace_back(route3);
     routeDb.unicastRoutesToUpdate.emplace_back(route4);
-    routeUpdatesQueue.push(routeDb);
+    routeUpdatesQueue.push(RouteUpdate(routeDb));
   }
 
   mockFibHandler->waitForUpdateUnicastRoutes();
@@ -24,6 +24,7 @@
 
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
+#include <openr/if/gen-cpp2/Platform_types.h>
 
 using folly::gen::as;
 using folly::gen::from;
@@ -70,6 +71,12 @@ MockNetlinkFibHandler::deleteUnicastRoute(
 void
 MockNetlinkFibHandler::addUnicastRoutes(
     int16_t, std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes) {
+  emulateProgrammingLatency();
+  if (failAddUnicastRoutes_) {
+    thrift::PlatformError error;
+    error.message = "Failed to add unicast routes";
+    throw error;
+  }
   SYNCHRONIZED(unicastRouteDb_) {
     for (auto const& route : *routes) {
       auto prefix = std::make_pair(
@@ -92,6 +99,7 @@ MockNetlinkFibHandler::addUnicastRoutes(
 void
 MockNetlinkFibHandler::deleteUnicastRoutes(
     int16_t, std::unique_ptr<std::vector<openr::thrift::IpPrefix>> prefixes) {
+  emulateProgrammingLatency();
   SYNCHRONIZED(unicastRouteDb_) {
     for (auto const& prefix : *prefixes) {
       auto myPrefix = std::make_pair(
@@ -107,6 +115,7 @@ MockNetlinkFibHandler::deleteUnicastRoutes(
 void
 MockNetlinkFibHandler::syncFib(
     int16_t, std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes) {
+  emulateProgrammingLatency();
   SYNCHRONIZED(unicastRouteDb_) {
     VLOG(3) << "MockNetlinkFibHandler: Sync Fib.... " << (*routes).size()
             << " entries";
@@ -132,6 +141,7 @@ MockNetlinkFibHandler::syncFib(
 void
 MockNetlinkFibHandler::addMplsRoutes(
     int16_t, std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) {
+  emulateProgrammingLatency();
   SYNCHRONIZED(mplsRouteDb_) {
     for (auto& route : *routes) {
       mplsRouteDb_[route.topLabel] = std::move(route.nextHops);
@@ -144,6 +154,7 @@ MockNetlinkFibHandler::addMplsRoutes(
 void
 MockNetlinkFibHandler::deleteMplsRoutes(
     int16_t, std::unique_ptr<std::vector<int32_t>> labels) {
+  emulateProgrammingLatency();
   SYNCHRONIZED(mplsRouteDb_) {
     for (auto& label : *labels) {
       mplsRouteDb_.erase(label);
@@ -156,6 +167,7 @@ MockNetlinkFibHandler::deleteMplsRoutes(
 void
 MockNetlinkFibHandler::syncMplsFib(
     int16_t, std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) {
+  emulateProgrammingLatency();
   SYNCHRONIZED(mplsRouteDb_) {
     mplsRouteDb_.clear();
     for (auto& route : *routes) {
@@ -166,6 +178,34 @@ MockNetlinkFibHandler::syncMplsFib(
   syncMplsFibBaton_.post();
 }
 
+void
+MockNetlinkFibHandler::blockProgramming() {
+  std::lock_guard<std::mutex> l(programmingMutex_);
+  programmingBlocked_ = true;
+}
+
+void
+MockNetlinkFibHandler::unblockProgramming() {
+  {
+    std::lock_guard<std::mutex> l(programmingMutex_);
+    programmingBlocked_ = false;
+  }
+  programmingCv_.notify_all();
+}
+
+void
+MockNetlinkFibHandler::emulateProgrammingLatency() {
+  ++programmingCallCount_;
+  {
+    std::unique_lock<std::mutex> l(programmingMutex_);
+    programmingCv_.wait(l, [this]() { return not programmingBlocked_; });
+  }
+  const auto latencyUs = programmingLatencyUs_.load();
+  if (latencyUs > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+  }
+}
+
 int64_t
 MockNetlinkFibHandler::aliveSince() {
   int64_t res = 0;
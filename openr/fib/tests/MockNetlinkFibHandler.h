@@ -8,9 +8,12 @@
 #pragma once
 
 #include <syslog.h>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -120,11 +123,36 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
     return delMplsRoutesCount_;
   }
 
+  // Delay every route programming call by latency, emulating a slow agent
+  void
+  setProgrammingLatency(std::chrono::microseconds latency) {
+    programmingLatencyUs_ = latency.count();
+  }
+
+  // Hold route programming calls received from now on until unblocked,
+  // emulating an agent stuck on a slow call
+  void blockProgramming();
+  void unblockProgramming();
+
+  // Number of route programming calls received, including blocked ones
+  size_t
+  getProgrammingCallCount() {
+    return programmingCallCount_;
+  }
+
+  // Fail addUnicastRoutes calls with a PlatformError, routes aren't added
+  void
+  setFailAddUnicastRoutes(bool fail) {
+    failAddUnicastRoutes_ = fail;
+  }
+
   void stop();
 
   void restart();
 
  private:
+  void emulateProgrammingLatency();
+
   // Time when service started, in number of seconds, since epoch
   folly::Synchronized<int64_t> startTime_{0};
 
@@ -144,6 +172,16 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   std::atomic<size_t> addMplsRoutesCount_{0};
   std::atomic<size_t> delMplsRoutesCount_{0};
 
+  // Latency of route programming calls
+  std::atomic<int64_t> programmingLatencyUs_{0};
+
+  // Route programming calls wait while blocked
+  std::mutex programmingMutex_;
+  std::condition_variable programmingCv_;
+  bool programmingBlocked_{false};
+  std::atomic<size_t> programmingCallCount_{0};
+  std::atomic<bool> failAddUnicastRoutes_{false};
+
   // A baton for synchronization
   folly::Baton<> updateUnicastRoutesBaton_;
   folly::Baton<> deleteUnicastRoutesBaton_;
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/NextHopGroups.h>
+
+using namespace openr;
+
+namespace {
+
+const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1", 10);
+const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2", 10);
+const auto nh3 = createNextHop(toBinaryAddress("fe80::3"), "iface3", 20);
+
+} // anonymous namespace
+
+TEST(NextHopGroupsTest, SharedGroups) {
+  NextHopGroups groups;
+  const auto prefix1 = toIpPrefix("10.1.0.0/16");
+  const auto prefix2 = toIpPrefix("10.2.0.0/16");
+  const auto prefix3 = toIpPrefix("10.3.0.0/16");
+  EXPECT_EQ(nullptr, groups.getGroup(prefix1));
+
+  // routes with the same next-hops in any order share a group
+  const auto& group1 = groups.updateRoute(prefix1, {nh3, nh2, nh1});
+  const auto& group2 = groups.updateRoute(prefix2, {nh1, nh2, nh3});
+  EXPECT_EQ(&group1, &group2);
+  EXPECT_EQ(2, group1.numRoutes);
+  EXPECT_EQ(1, groups.size());
+  EXPECT_EQ(
+      (std::vector<thrift::NextHopThrift>{nh1, nh2}), group1.bestNextHops);
+  EXPECT_EQ(
+      (std::vector<thrift::NextHopThrift>{nh1, nh2, nh3}),
+      groups.getNextHops(prefix2));
+
+  const auto& group3 = groups.updateRoute(prefix3, {nh3});
+  EXPECT_NE(group1.id, group3.id);
+  EXPECT_EQ(2, groups.size());
+
+  // moving a route releases its previous group
+  groups.updateRoute(prefix3, {nh1, nh2, nh3});
+  EXPECT_EQ(1, groups.size());
+  EXPECT_EQ(3, groups.getGroup(prefix3)->numRoutes);
+
+  EXPECT_TRUE(groups.deleteRoute(prefix1));
+  EXPECT_FALSE(groups.deleteRoute(prefix1));
+  EXPECT_TRUE(groups.deleteRoute(prefix2));
+  EXPECT_EQ(1, groups.getGroup(prefix3)->numRoutes);
+  EXPECT_TRUE(groups.deleteRoute(prefix3));
+  EXPECT_EQ(0, groups.size());
+}
+
+TEST(NextHopGroupsTest, InterfaceIndex) {
+  NextHopGroups groups;
+  const auto prefix1 = toIpPrefix("10.1.0.0/16");
+  const auto prefix2 = toIpPrefix("10.2.0.0/16");
+  const auto prefix3 = toIpPrefix("10.3.0.0/16");
+  groups.updateRoute(prefix1, {nh1, nh2});
+  groups.updateRoute(prefix2, {nh2, nh1});
+  groups.updateRoute(prefix3, {nh3});
+
+  auto getPrefixes = [&](std::unordered_set<std::string> const& ifNames) {
+    std::unordered_set<thrift::IpPrefix> prefixes;
+    groups.forEachGroupOfInterfaces(
+        ifNames,
+        [&](std::vector<thrift::NextHopThrift> const& nextHops,
+            NextHopGroups::Group const& group) {
+          EXPECT_EQ(group.numRoutes, group.prefixes.size());
+          EXPECT_FALSE(nextHops.empty());
+          prefixes.insert(group.prefixes.begin(), group.prefixes.end());
+        });
+    return prefixes;
+  };
+
+  EXPECT_EQ(
+      (std::unordered_set<thrift::IpPrefix>{prefix1, prefix2}),
+      getPrefixes({"iface1", "iface2"}));
+  EXPECT_EQ(
+      (std::unordered_set<thrift::IpPrefix>{prefix3}), getPrefixes({"iface3"}));
+  EXPECT_TRUE(getPrefixes({"iface4"}).empty());
+
+  // routes moving between groups are reindexed
+  groups.updateRoute(prefix3, {nh1, nh2});
+  EXPECT_EQ(
+      (std::unordered_set<thrift::IpPrefix>{prefix1, prefix2, prefix3}),
+      getPrefixes({"iface1"}));
+  EXPECT_TRUE(getPrefixes({"iface3"}).empty());
+
+  groups.deleteRoute(prefix1);
+  groups.deleteRoute(prefix2);
+  groups.deleteRoute(prefix3);
+  EXPECT_TRUE(getPrefixes({"iface1", "iface2"}).empty());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <set>
+#include <string>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/fib/PrefixTrie.h>
+
+using namespace openr;
+
+namespace {
+
+// longest prefix match by scanning all prefixes
+std::optional<thrift::IpPrefix>
+longestPrefixMatchLinear(
+    const folly::CIDRNetwork& network,
+    const std::set<thrift::IpPrefix>& prefixes) {
+  std::optional<thrift::IpPrefix> matchedPrefix;
+  for (const auto& prefix : prefixes) {
+    const auto address = toIPAddress(prefix.prefixAddress);
+    if (address.family() != network.first.family() or
+        prefix.prefixLength > network.second) {
+      continue;
+    }
+    if (network.first.mask(prefix.prefixLength) == address and
+        (not matchedPrefix.has_value() or
+         matchedPrefix->prefixLength < prefix.prefixLength)) {
+      matchedPrefix = prefix;
+    }
+  }
+  return matchedPrefix;
+}
+
+// random prefix of 10.0.0.0/8 or fc00::/8 with few distinct bits so that
+// prefixes nest
+thrift::IpPrefix
+createRandomPrefix(bool isV4) {
+  const uint8_t len = isV4 ? 8 + folly::Random::rand32(25)
+                           : 8 + folly::Random::rand32(121);
+  const auto address = isV4
+      ? folly::sformat("10.{}.0.0", folly::Random::rand32(4) * 64)
+      : folly::sformat("fc00:{:x}::", folly::Random::rand32(4) << 14);
+  return toIpPrefix(
+      folly::IPAddress::createNetwork(folly::sformat("{}/{}", address, len)));
+}
+
+} // anonymous namespace
+
+TEST(PrefixTrieTest, InsertEraseMatch) {
+  PrefixTrie trie;
+  EXPECT_EQ(0, trie.size());
+  EXPECT_FALSE(trie.longestPrefixMatch(
+                       folly::IPAddress::createNetwork("10.0.0.1/32"))
+                   .has_value());
+
+  const auto prefix1 = toIpPrefix("10.0.0.0/8");
+  const auto prefix2 = toIpPrefix("10.1.0.0/16");
+  const auto prefix3 = toIpPrefix("10.1.2.0/24");
+  const auto prefix4 = toIpPrefix("10.2.0.0/16");
+  const auto prefix5 = toIpPrefix("::/0");
+  for (const auto& prefix : {prefix3, prefix4, prefix1, prefix2, prefix5}) {
+    trie.insert(prefix);
+  }
+  trie.insert(prefix2);
+  EXPECT_EQ(5, trie.size());
+
+  auto match = [&trie](const std::string& network) {
+    return trie.longestPrefixMatch(folly::IPAddress::createNetwork(network));
+  };
+  EXPECT_EQ(prefix3, match("10.1.2.3/32"));
+  EXPECT_EQ(prefix2, match("10.1.3.0/24"));
+  EXPECT_EQ(prefix2, match("10.1.0.0/16"));
+  EXPECT_EQ(prefix4, match("10.2.2.2/32"));
+  EXPECT_EQ(prefix1, match("10.3.0.0/16"));
+  EXPECT_FALSE(match("10.0.0.0/7").has_value());
+  // ::/0 only covers IPv6 networks
+  EXPECT_FALSE(match("11.0.0.1/32").has_value());
+  EXPECT_EQ(prefix5, match("fc00::1/128"));
+
+  // erasing restores the less specific matches
+  EXPECT_TRUE(trie.erase(prefix2));
+  EXPECT_FALSE(trie.erase(prefix2));
+  EXPECT_FALSE(trie.erase(toIpPrefix("10.1.0.0/17")));
+  EXPECT_EQ(prefix3, match("10.1.2.3/32"));
+  EXPECT_EQ(prefix1, match("10.1.3.0/24"));
+  EXPECT_TRUE(trie.erase(prefix1));
+  EXPECT_FALSE(match("10.1.3.0/24").has_value());
+  EXPECT_EQ(prefix4, match("10.2.2.2/32"));
+  EXPECT_EQ(3, trie.size());
+
+  trie.clear();
+  EXPECT_EQ(0, trie.size());
+  EXPECT_FALSE(match("10.1.2.3/32").has_value());
+}
+
+TEST(PrefixTrieTest, RandomPrefixes) {
+  PrefixTrie trie;
+  std::set<thrift::IpPrefix> prefixes;
+
+  for (int i = 0; i < 20000; ++i) {
+    const bool isV4 = folly::Random::oneIn(2);
+    const auto prefix = createRandomPrefix(isV4);
+    switch (folly::Random::rand32(3)) {
+    case 0: {
+      trie.insert(prefix);
+      prefixes.emplace(prefix);
+      break;
+    }
+    case 1: {
+      EXPECT_EQ(prefixes.erase(prefix) == 1, trie.erase(prefix));
+      break;
+    }
+    default: {
+      const auto network = toIPNetwork(createRandomPrefix(isV4));
+      EXPECT_EQ(
+          longestPrefixMatchLinear(network, prefixes),
+          trie.longestPrefixMatch(network))
+          << folly::IPAddress::networkToString(network);
+    }
+    }
+    ASSERT_EQ(prefixes.size(), trie.size());
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/RouteDbExport.h>
+#include <openr/fib/RouteDbSnapshot.h>
+
+using namespace openr;
+
+namespace {
+
+const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1", 10);
+const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2", 20);
+const auto nhPush = createNextHop(
+    toBinaryAddress("fe80::3"),
+    "iface3",
+    30,
+    createMplsAction(
+        thrift::MplsActionCode::PUSH, folly::none, std::vector<int32_t>{1, 2}));
+const auto nhSwap = createNextHop(
+    toBinaryAddress("fe80::4"),
+    "iface4",
+    0,
+    createMplsAction(thrift::MplsActionCode::SWAP, 200));
+
+thrift::UnicastRoute
+createRoute(int i, thrift::NextHopThrift const& nextHop) {
+  return createUnicastRoute(
+      toIpPrefix(folly::sformat("10.{}.{}.0/24", i / 256, i % 256)),
+      {nextHop});
+}
+
+thrift::RouteDatabaseDelta
+createDelta(int from, int to, thrift::NextHopThrift const& nextHop) {
+  thrift::RouteDatabaseDelta delta;
+  for (int i = from; i < to; ++i) {
+    delta.unicastRoutesToUpdate.emplace_back(createRoute(i, nextHop));
+  }
+  return delta;
+}
+
+std::string
+getExportPath() {
+  return folly::sformat(
+      "/tmp/openr_route_db_export_test_{}",
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+} // anonymous namespace
+
+TEST(RouteDbExportTest, RoundTrip) {
+  const auto path = getExportPath();
+  RouteDbSnapshots snapshots("node1", 16 /* numBuckets */);
+  RouteDbExporter exporter(path);
+  RouteDbExportReader reader(path);
+  EXPECT_EQ(0, reader.getVersion().value());
+  EXPECT_FALSE(reader.isClosed());
+
+  auto delta = createDelta(0, 100, nh1);
+  delta.unicastRoutesToUpdate.emplace_back(createUnicastRoute(
+      toIpPrefix("fc00::/64"), {nh1, nh2, nhPush}));
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(100, {nhSwap}));
+  snapshots.publish(delta);
+  exporter.publish(*snapshots.get());
+
+  auto routeDb = reader.getRouteDatabase();
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ("node1", routeDb->thisNodeName);
+  EXPECT_EQ(101, routeDb->unicastRoutes.size());
+  EXPECT_EQ(1, routeDb->mplsRoutes.size());
+  EXPECT_EQ(snapshots.get()->getMplsRoutes(), routeDb->mplsRoutes);
+  for (auto const& route : routeDb->unicastRoutes) {
+    EXPECT_EQ(route, *snapshots.get()->findUnicastRoute(route.dest));
+  }
+
+  // lookups in place
+  EXPECT_EQ(
+      createRoute(42, nh1),
+      reader.findUnicastRoute(createRoute(42, nh1).dest).value());
+  EXPECT_FALSE(
+      reader.findUnicastRoute(toIpPrefix("10.0.42.0/25")).value().hasValue());
+  EXPECT_EQ(
+      createMplsRoute(100, {nhSwap}), reader.findMplsRoute(100).value());
+  EXPECT_FALSE(reader.findMplsRoute(101).value().hasValue());
+  EXPECT_TRUE(reader.read([](const RouteDbExportView& view) {
+    const auto* entry = view.findUnicastEntry(toIpPrefix("fc00::/64"));
+    ASSERT_NE(nullptr, entry);
+    const auto nextHops = view.getNextHops(*entry);
+    ASSERT_EQ(3, nextHops.size());
+    EXPECT_EQ("iface3", view.getIfName(nextHops[2]));
+    EXPECT_EQ(2, view.getLabels(nextHops[2]).size());
+  }));
+
+  // deletions are exported as well
+  thrift::RouteDatabaseDelta deletes;
+  deletes.unicastRoutesToDelete.emplace_back(createRoute(42, nh1).dest);
+  deletes.mplsRoutesToDelete.emplace_back(100);
+  snapshots.publish(deletes);
+  exporter.publish(*snapshots.get());
+  EXPECT_EQ(2, reader.getVersion().value());
+  EXPECT_FALSE(
+      reader.findUnicastRoute(createRoute(42, nh1).dest).value().hasValue());
+  EXPECT_FALSE(reader.findMplsRoute(100).value().hasValue());
+  std::remove(path.c_str());
+}
+
+//
+// Readers follow the file as it grows and see the export closed when its
+// writer goes away
+//
+TEST(RouteDbExportTest, GrowAndClose) {
+  const auto path = getExportPath();
+  RouteDbSnapshots snapshots("node1", 256 /* numBuckets */);
+  auto exporter = std::make_unique<RouteDbExporter>(path);
+  RouteDbExportReader reader(path);
+
+  snapshots.publish(createDelta(0, 10000, nh1));
+  exporter->publish(*snapshots.get());
+  EXPECT_EQ(10000, reader.getRouteDatabase()->unicastRoutes.size());
+  EXPECT_EQ(
+      createRoute(9999, nh1),
+      reader.findUnicastRoute(createRoute(9999, nh1).dest).value());
+
+  exporter.reset();
+  EXPECT_TRUE(reader.isClosed());
+  // still readable
+  EXPECT_EQ(1, reader.getVersion().value());
+  std::remove(path.c_str());
+}
+
+TEST(RouteDbExportTest, InvalidFile) {
+  const auto path = getExportPath();
+  FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  std::fputs("not an export", file);
+  std::fclose(file);
+  EXPECT_THROW(RouteDbExportReader{path}, std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(RouteDbExportReader{path}, std::system_error);
+}
+
+//
+// Reader sees consistent versions while the writer keeps publishing
+//
+TEST(RouteDbExportTest, ConcurrentReader) {
+  const auto path = getExportPath();
+  RouteDbSnapshots snapshots("node1", 16 /* numBuckets */);
+  RouteDbExporter exporter(path);
+
+  std::atomic<bool> done{false};
+  std::thread readerThread([&]() {
+    RouteDbExportReader reader(path);
+    while (not done) {
+      // version i holds routes [0, 10 * i) through the next-hop of parity i.
+      // Checked after read returned, runs on torn data are retried
+      int64_t version{0};
+      size_t numRoutes{0};
+      std::vector<int32_t> metrics;
+      ASSERT_TRUE(reader.read([&](const RouteDbExportView& view) {
+        version = view.getVersion();
+        numRoutes = view.getUnicastEntries().size();
+        metrics.clear();
+        for (const auto& entry : view.getUnicastEntries()) {
+          for (const auto& nextHop : view.getNextHops(entry)) {
+            metrics.emplace_back(nextHop.metric);
+          }
+        }
+      }));
+      EXPECT_EQ(10 * version, numRoutes);
+      EXPECT_EQ(numRoutes, metrics.size());
+      const auto metric = version % 2 ? nh1.metric : nh2.metric;
+      for (auto const m : metrics) {
+        EXPECT_EQ(metric, m);
+      }
+    }
+  });
+
+  for (int i = 1; i <= 200; ++i) {
+    snapshots.publish(createDelta(0, 10 * i, i % 2 ? nh1 : nh2));
+    exporter.publish(*snapshots.get());
+  }
+  done = true;
+  readerThread.join();
+  std::remove(path.c_str());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
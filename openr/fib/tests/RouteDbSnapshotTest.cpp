@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/RouteDbSnapshot.h>
+
+using namespace openr;
+
+namespace {
+
+const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1", 10);
+const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2", 10);
+
+thrift::UnicastRoute
+createRoute(int i, thrift::NextHopThrift const& nextHop) {
+  return createUnicastRoute(
+      toIpPrefix(folly::sformat("10.{}.{}.0/24", i / 256, i % 256)),
+      {nextHop});
+}
+
+thrift::RouteDatabaseDelta
+createDelta(int from, int to, thrift::NextHopThrift const& nextHop) {
+  thrift::RouteDatabaseDelta delta;
+  for (int i = from; i < to; ++i) {
+    delta.unicastRoutesToUpdate.emplace_back(createRoute(i, nextHop));
+  }
+  return delta;
+}
+
+std::vector<thrift::UnicastRoute>
+sorted(std::vector<thrift::UnicastRoute> routes) {
+  std::sort(
+      routes.begin(),
+      routes.end(),
+      [](thrift::UnicastRoute const& a, thrift::UnicastRoute const& b) {
+        return a.dest < b.dest;
+      });
+  return routes;
+}
+
+} // anonymous namespace
+
+TEST(RouteDbSnapshotTest, VersionsAreImmutable) {
+  RouteDbSnapshots snapshots("node1", 16 /* numBuckets */);
+  auto v0 = snapshots.get();
+  EXPECT_EQ(0, v0->getVersion());
+  EXPECT_EQ("node1", v0->getNodeName());
+  EXPECT_EQ(0, v0->getNumUnicastRoutes());
+
+  snapshots.publish(RouteUpdate(createDelta(0, 100, nh1)));
+  auto v1 = snapshots.get();
+  EXPECT_EQ(1, v1->getVersion());
+  EXPECT_EQ(100, v1->getNumUnicastRoutes());
+
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToUpdate.emplace_back(createRoute(0, nh2));
+  delta.unicastRoutesToDelete.emplace_back(createRoute(1, nh1).dest);
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(100, {nh1}));
+  snapshots.publish(RouteUpdate(delta));
+  auto v2 = snapshots.get();
+  EXPECT_EQ(2, v2->getVersion());
+  EXPECT_EQ(99, v2->getNumUnicastRoutes());
+  EXPECT_EQ(1, v2->getNumMplsRoutes());
+  const auto prefix0 = createRoute(0, nh1).dest;
+  EXPECT_EQ(createRoute(0, nh2), *v2->findUnicastRoute(prefix0));
+  EXPECT_EQ(nullptr, v2->findUnicastRoute(createRoute(1, nh1).dest));
+  EXPECT_NE(nullptr, v2->findMplsRoute(100));
+
+  // earlier versions are unchanged
+  EXPECT_EQ(0, v0->getNumUnicastRoutes());
+  EXPECT_EQ(100, v1->getNumUnicastRoutes());
+  EXPECT_EQ(0, v1->getNumMplsRoutes());
+  EXPECT_EQ(createRoute(0, nh1), *v1->findUnicastRoute(prefix0));
+  EXPECT_EQ(
+      sorted(createDelta(0, 100, nh1).unicastRoutesToUpdate),
+      sorted(v1->getUnicastRoutes()));
+
+  // recent versions are retained
+  EXPECT_EQ(v1, snapshots.get(1));
+  EXPECT_EQ(nullptr, snapshots.get(3));
+}
+
+TEST(RouteDbSnapshotTest, Pages) {
+  RouteDbSnapshots snapshots("node1", 16 /* numBuckets */);
+  auto delta = createDelta(0, 250, nh1);
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(100, {nh1}));
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(200, {nh1}));
+  snapshots.publish(RouteUpdate(delta));
+  auto snapshot = snapshots.get();
+
+  // pages cover all routes of the version exactly once
+  std::vector<thrift::UnicastRoute> unicastRoutes;
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  int64_t offset{0};
+  int numPages{0};
+  while (true) {
+    auto page = snapshot->getPage(offset, 100);
+    EXPECT_EQ(1, page.version);
+    ++numPages;
+    unicastRoutes.insert(
+        unicastRoutes.end(),
+        page.unicastRoutes.begin(),
+        page.unicastRoutes.end());
+    mplsRoutes.insert(
+        mplsRoutes.end(), page.mplsRoutes.begin(), page.mplsRoutes.end());
+    if (not page.nextOffset.hasValue()) {
+      break;
+    }
+    offset = page.nextOffset.value();
+  }
+  EXPECT_EQ(3, numPages);
+  EXPECT_EQ(
+      sorted(delta.unicastRoutesToUpdate), sorted(std::move(unicastRoutes)));
+  EXPECT_EQ(2, mplsRoutes.size());
+
+  // past the end
+  auto page = snapshot->getPage(1000, 100);
+  EXPECT_EQ(0, page.unicastRoutes.size());
+  EXPECT_EQ(0, page.mplsRoutes.size());
+  EXPECT_FALSE(page.nextOffset.hasValue());
+}
+
+TEST(RouteDbSnapshotTest, ChangesSince) {
+  RouteDbSnapshots snapshots(
+      "node1",
+      16 /* numBuckets */,
+      4 /* numRetainedSnapshots */,
+      150 /* maxRetainedChanges */);
+  snapshots.publish(RouteUpdate(createDelta(0, 100, nh1)));
+
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToUpdate.emplace_back(createRoute(0, nh2));
+  delta.unicastRoutesToDelete.emplace_back(createRoute(1, nh1).dest);
+  snapshots.publish(RouteUpdate(delta));
+
+  // changes since the previous version
+  auto changes = snapshots.getChangesSince(1);
+  EXPECT_EQ(2, changes.version);
+  EXPECT_FALSE(changes.fullDump);
+  EXPECT_EQ(
+      std::vector<thrift::UnicastRoute>{createRoute(0, nh2)},
+      changes.delta.unicastRoutesToUpdate);
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>{createRoute(1, nh1).dest},
+      changes.delta.unicastRoutesToDelete);
+
+  // nothing changed since the latest version
+  changes = snapshots.getChangesSince(2);
+  EXPECT_FALSE(changes.fullDump);
+  EXPECT_EQ(0, changes.delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, changes.delta.unicastRoutesToDelete.size());
+
+  // changes since the start are all routes, the deleted one included
+  changes = snapshots.getChangesSince(0);
+  EXPECT_FALSE(changes.fullDump);
+  EXPECT_EQ(99, changes.delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(1, changes.delta.unicastRoutesToDelete.size());
+
+  // changes of the first version get evicted, a full dump is returned
+  snapshots.publish(RouteUpdate(createDelta(100, 160, nh1)));
+  changes = snapshots.getChangesSince(0);
+  EXPECT_EQ(3, changes.version);
+  EXPECT_TRUE(changes.fullDump);
+  EXPECT_EQ(159, changes.delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, changes.delta.unicastRoutesToDelete.size());
+  changes = snapshots.getChangesSince(1);
+  EXPECT_FALSE(changes.fullDump);
+  EXPECT_EQ(61, changes.delta.unicastRoutesToUpdate.size());
+
+  // unknown future versions get a full dump too
+  EXPECT_TRUE(snapshots.getChangesSince(10).fullDump);
+}
+
+TEST(RouteDbSnapshotTest, RoutesAreShared) {
+  auto delta = createDelta(0, 10, nh1);
+  delta.thisNodeName = "node1";
+  delta.mplsRoutesToUpdate.emplace_back(createMplsRoute(100, {nh1}));
+  delta.unicastRoutesToDelete.emplace_back(createRoute(20, nh1).dest);
+  delta.mplsRoutesToDelete.emplace_back(200);
+  const RouteUpdate routeUpdate(delta);
+  EXPECT_EQ(delta, routeUpdate.toThrift());
+
+  // snapshots refer to the routes of the update instead of copies
+  RouteDbSnapshots snapshots("node1", 16 /* numBuckets */);
+  snapshots.publish(routeUpdate);
+  auto snapshot = snapshots.get();
+  for (auto const& route : routeUpdate.unicastRoutesToUpdate) {
+    EXPECT_EQ(route.get(), snapshot->findUnicastRoute(route->dest));
+  }
+  EXPECT_EQ(
+      routeUpdate.mplsRoutesToUpdate.at(0).get(),
+      snapshot->findMplsRoute(100));
+  EXPECT_EQ(2, routeUpdate.unicastRoutesToUpdate.at(0).use_count());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
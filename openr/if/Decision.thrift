@@ -21,3 +21,31 @@ typedef map<string, Lsdb.AdjacencyDatabase>
 typedef map<string, Lsdb.PrefixDatabase>
   (cpp.type = "std::unordered_map<std::string, openr::thrift::PrefixDatabase>")
   PrefixDbs
+
+// Hypothetical change of an adjacency of a node. Attributes which are not set
+// are left as they are
+struct AdjacencyMutation {
+  1: string nodeName
+  2: string ifName
+  3: optional i32 metric
+  4: optional bool isOverloaded
+}
+
+// Hypothetical changes of the link state to compute routes for, e.g. to
+// simulate the drain of a node or a link. Mutations of a node are applied to
+// its adjacency databases in all areas
+struct WhatIfRequest {
+  // node name -> overload bit
+  1: map<string, bool> nodeOverloads
+  2: list<AdjacencyMutation> adjacencyMutations
+}
+
+// Link and prefix state of Decision persisted to disk, to compute routes
+// right after restarts
+struct DecisionSnapshot {
+  // wall clock time the snapshot was taken at, in ms since epoch
+  1: i64 timestampMs
+  // area -> adjacency/prefix databases
+  2: map<string, AdjDbs> areaAdjDbs
+  3: map<string, PrefixDbs> areaPrefixDbs
+}
@@ -30,8 +30,106 @@ struct RouteDatabaseDelta {
   6: optional Lsdb.PerfEvents perfEvents;
 }
 
+// Page of the routes of a route database version
+struct RouteDatabasePage {
+  1: string thisNodeName
+  2: i64 version
+  3: list<Network.UnicastRoute> unicastRoutes
+  4: list<Network.MplsRoute> mplsRoutes
+  // offset of the next page of the same version, unset on the last page
+  5: optional i64 nextOffset
+}
+
+// Changes of a route database since a version
+struct RouteDatabaseChanges {
+  // version the changes lead to
+  1: i64 version
+  // changes since the requested version are not retained anymore, delta has
+  // all routes as updates instead
+  2: bool fullDump
+  3: RouteDatabaseDelta delta
+}
+
 // Perf log buffer maintained by Fib
 struct PerfDatabase {
   1: string thisNodeName
   2: list<Lsdb.PerfEvents> eventInfo
 }
+
+// Histogram of latencies, with fixed relative precision
+struct LatencyHistogram {
+  1: i64 count
+  2: i64 sumMs
+  3: i64 minMs
+  4: i64 maxMs
+  5: i64 p50Ms
+  6: i64 p99Ms
+  7: i64 p999Ms
+  // count of values of non empty buckets, by highest value of the bucket
+  8: map<i64, i64> bucketCounts
+}
+
+// Route convergence latencies maintained by Fib, from reception of the
+// triggering update by Decision until the switch agent acknowledged routes
+struct PerfHistograms {
+  1: string thisNodeName
+  // by class of programmed unicast routes, e.g. `infra`
+  2: map<string, LatencyHistogram> routeClassHistograms
+  // by first event of the originating update, e.g. `ADJ_DB_UPDATED`
+  3: map<string, LatencyHistogram> eventHistograms
+}
+
+enum RouteTraceEvent {
+  UNICAST_ROUTE_UPDATE = 1,
+  UNICAST_ROUTE_DELETE = 2,
+  MPLS_ROUTE_UPDATE = 3,
+  MPLS_ROUTE_DELETE = 4,
+}
+
+// Route change recorded in a route trace
+struct RouteTraceEntry {
+  1: i64 timestampMs
+  2: RouteTraceEvent event
+  // set for unicast route changes
+  3: optional Network.IpPrefix prefix
+  // set for MPLS route changes
+  4: optional i32 topLabel
+  // number of nexthops of updated routes
+  5: i32 numNextHops
+}
+
+// Bounded trace of route changes maintained by Fib and Decision
+struct RouteTraceDatabase {
+  1: string thisNodeName
+  2: list<RouteTraceEntry> entries
+  // number of route changes recorded, including the ones no longer kept
+  3: i64 numRecorded
+}
+
+// Time spent in a stage of convergence on a node
+struct PerfSpan {
+  1: Lsdb.PerfStage stage
+  2: string nodeName
+  // event ending the span
+  3: string eventDescr
+  // unix time in microseconds
+  4: i64 startUs
+  5: i64 durationUs
+}
+
+// Spans of a convergence event, from the originating event until routes were
+// programmed by this node
+struct ConvergenceTraceEntry {
+  1: list<PerfSpan> spans
+  2: i64 totalDurationUs
+}
+
+// Sampled traces of convergence events maintained by Fib
+struct ConvergenceTraceDatabase {
+  1: string thisNodeName
+  2: list<ConvergenceTraceEntry> entries
+  // number of traces recorded, including the ones no longer kept
+  3: i64 numRecorded
+  // one of sampleRate convergence events is traced
+  4: i32 sampleRate
+}
@@ -41,6 +41,19 @@ struct Value {
 typedef map<string, Value>
   (cpp.type = "std::unordered_map<std::string, openr::thrift::Value>") KeyVals
 
+// TTL refreshes of keys of an originator, i.e. Values without value, in
+// parallel lists with an entry per key. Far smaller than the Values on the
+// wire, refreshes making up most of the flooding in steady state
+struct KeyTtlUpdates {
+  1: string originatorId
+  2: list<string> keys
+  3: list<i64> versions
+  4: list<i64> ttlVersions
+  5: list<i64> ttls
+  // keys by ID instead of keys, see KeySetParams.keyIdSession
+  6: optional list<i32> keyIds
+}
+
 
 enum Command {
   // NOTE: key-10 has been used in past
@@ -90,6 +103,33 @@ struct KeySetParams {
   // optional attribute to indicate timestamp when request is sent. This is
   // system timestamp in milliseconds since epoch
   7: optional i64 timestamp_ms
+
+  // TTL refreshes, in addition to keyVals. Only sent to peers accepting
+  // them, see Publication.acceptTtlUpdates
+  8: optional list<KeyTtlUpdates> ttlUpdates
+
+  // Announced key-vals whose values are left out, only carrying version,
+  // originatorId, hash, ttl and ttlVersion. Receivers lacking them pull the
+  // values with pullKeys. Only sent to peers accepting them, see
+  // Publication.acceptValueAnnouncements
+  9: optional KeyVals announcements
+
+  // keys whose values the receiver is asked to send back with a KEY_SET,
+  // nodeIds holding the requester
+  10: optional list<string> pullKeys
+
+  // Keys referred to by IDs of the sender's session, only sent to peers
+  // accepting them, see Publication.acceptKeyIds. Key-vals are in keyIdVals
+  // instead of keyVals, and TTL refreshes have keyIds instead of keys. IDs
+  // are defined in keyIdDefinitions the first time they are sent to a peer,
+  // definitions of other sessions are dropped
+  11: optional i64 keyIdSession
+  12: optional map<i32, string> keyIdDefinitions
+  13: optional map<i32, Value> keyIdVals
+
+  // the requester got IDs it doesn't know, define them again. nodeIds holds
+  // the requester
+  14: optional bool resetKeyIds
 }
 
 // parameters for the KEY_GET command
@@ -97,15 +137,59 @@ struct KeyGetParams {
   1: list<string> keys
 }
 
+// Digests of key buckets, exchanged level by level during full-sync to find
+// the keys in which two KvStores differ. Buckets of level n are identified by
+// the leading n * 8 bits of the 64-bit FNV hash of the key, the digest of a
+// bucket is the sum of the digests of its key-values.
+struct KeyBucketDigests {
+  1: i32 level
+  // bucket -> digest, buckets without keys are left out
+  2: map<i64, i64> digests
+  // buckets of level - 1 whose children are covered by digests. All buckets
+  // of level are covered if not set
+  3: optional list<i64> parentBuckets
+}
+
+// position in the change sequence of a KvStore area: keys get the next
+// sequence number whenever their value changes. The epoch identifies the
+// sequence, which starts over when the KvStore restarts
+struct KvStoreWatermark {
+  1: i64 epoch
+  2: i64 seqNum
+}
+
 // parameters for the KEY_DUMP command
 // if request includes keyValHashes information from peer, only respsond with
 // keyVals on which hash differs
 // if keyValHashes is not specified, respond with flooding element to signal of
 // DB change
+// if keyBucketDigests is specified without keyValHashes, respond with the
+// digests of the next level of the buckets on which digests differ. Along with
+// keyValHashes the response is restricted to keys in the covered buckets. Only
+// sent to peers accepting it, see Publication.acceptBucketDigests
 struct KeyDumpParams {
   1: string prefix
   3: set<string> originatorIds
   2: optional KeyVals keyValHashes
+  4: optional KeyBucketDigests keyBucketDigests
+  // requester accepts a compressed response, see Publication
+  5: optional bool acceptCompressed
+  // paginated dumps: respond with at most maxKeys keys, in key order and
+  // greater than cursor if set. The response carries the cursor of the next
+  // page if more keys match. Ignored along with keyValHashes
+  6: optional string cursor
+  7: optional i32 maxKeys
+  // delta full-sync on reconnect: respond with the keys changed since the
+  // watermark of a previous full-sync response, or with all keys if the
+  // watermark isn't of the current epoch. Not sent along with keyValHashes
+  // or keyBucketDigests, peers not supporting it respond with all keys
+  8: optional KvStoreWatermark sinceWatermark
+  // full-sync requests: requester merges responses split into chunks of
+  // about maxChunkBytes, see Publication.hasMoreChunks
+  9: optional i64 maxChunkBytes
+  // partitioned full-sync: only keys of these level 1 buckets, see
+  // KeyBucketDigests, are synced. keyValHashes only cover them
+  10: optional list<i64> syncBuckets
 }
 
 // Peer's publication and command socket URLs
@@ -116,6 +200,11 @@ struct PeerSpec {
   2: string cmdUrl
   // support flood optimization or not
   3: bool supportFloodOptimization = 0
+  // address and port of the peer's OpenrCtrl thrift server. KvStore talks
+  // to the peer over thrift instead of cmdUrl if ctrlPort is set and thrift
+  // peers are enabled
+  4: string peerAddr = ""
+  5: i32 ctrlPort = 0
 }
 
 typedef map<string, PeerSpec>
@@ -168,6 +257,27 @@ typedef map<string, SptInfo>
   (cpp.type = "std::unordered_map<std::string, openr::thrift::SptInfo>")
   SptInfoMap
 
+// estimated number of recent updates of keys of a key family, of keys
+// originated by a node or of a key. Estimates are over-counted by at most
+// error
+struct KvStoreChurnEntry {
+  1: string name
+  2: i64 count
+  3: i64 error = 0
+}
+
+// KvStore churn, estimated from sampled key updates. Counts are halved
+// periodically and hence reflect recent updates
+struct KvStoreChurnStats {
+  // all key families (key up to its first ':'), heaviest first
+  1: list<KvStoreChurnEntry> keyFamilies
+  // heaviest originators and keys, heaviest first
+  2: list<KvStoreChurnEntry> topOriginators
+  3: list<KvStoreChurnEntry> topKeys
+  // one in sampleRate key updates is sampled
+  4: i32 sampleRate
+}
+
 // all spanning tree(s) information
 struct SptInfos {
   // map<root-id: SptInfo>
@@ -203,6 +313,9 @@ struct KvStoreRequest {
   10: optional FloodTopoSetParams floodTopoSetParams
   // area identifier to identify the KvStoreDb instance
   11: optional string area
+  // zstd compressed KvStoreRequest, in which case cmd and area are the ones of
+  // the compressed request. Only sent to peers accepting compressed payloads
+  12: optional binary compressedRequest
 }
 
 //
@@ -230,6 +343,44 @@ struct Publication {
 
   // area to which this publication belogs
   7: optional string area;
+
+  // response to a bucket digest full-sync request, digests of the children
+  // of the buckets on which digests differ
+  8: optional KeyBucketDigests keyBucketDigests;
+
+  // zstd compressed Publication, in which case other attributes are left out
+  // except area. Only sent in response to requests accepting it
+  9: optional binary compressedPublication;
+
+  // sender of a full-sync response accepts compressed requests
+  10: optional bool acceptCompressed;
+
+  // response to a paginated dump: cursor to request the next page with, not
+  // set on the last page
+  11: optional string cursor;
+
+  // full-sync responses: watermark of the responder's store when dumped
+  12: optional KvStoreWatermark syncWatermark;
+
+  // response to a delta full-sync, keyVals only hold the keys changed since
+  // the requested watermark
+  13: optional bool deltaSync;
+
+  // leading chunk of a full-sync response, only holding keyVals. The last
+  // chunk carries the remaining keyVals, tobeUpdatedKeys and syncWatermark
+  14: optional bool hasMoreChunks;
+
+  // sender of a full-sync response accepts KeySetParams.ttlUpdates
+  15: optional bool acceptTtlUpdates;
+
+  // sender of a full-sync response accepts KeySetParams.announcements
+  16: optional bool acceptValueAnnouncements;
+
+  // sender of a full-sync response accepts KeySetParams.keyIdSession
+  17: optional bool acceptKeyIds;
+
+  // sender of a full-sync response accepts KeyDumpParams.keyBucketDigests
+  18: optional bool acceptBucketDigests;
 }
 
 // Dump of the current peers: sent in
@@ -238,3 +389,11 @@ struct Publication {
 struct PeerCmdReply {
   1: PeersMap peers
 }
+
+// On-disk snapshot of the KvStore, pre-populating it on warm restarts
+struct KvStoreSnapshot {
+  // wall clock time at which the snapshot was taken, in ms since epoch
+  1: i64 timestampMs
+  // key-values of each area, with their TTLs remaining at timestampMs
+  2: map<string, KeyVals> areaKeyVals
+}
@@ -21,12 +21,38 @@ struct PerfEvent {
   1: string nodeName;
   2: string eventDescr;
   3: i64 unixTs = 0;
+  // steady clock time in microseconds, only comparable between events of
+  // the same node
+  4: optional i64 monotonicTsUs;
+  // time spent in the event in microseconds, for events ending a span of
+  // their own, e.g. route computation phases
+  5: optional i64 durationUs;
 }
 
 struct PerfEvents {
   1: list<PerfEvent> events;
 }
 
+// Compact identifiers of the stages of convergence perf events mark, each
+// stage ending at its event
+enum PerfStage {
+  OTHER = 0,
+  // neighbor event from Spark received by LinkMonitor
+  NEIGHBOR_EVENT = 1,
+  // adjacencies advertised by LinkMonitor
+  ADJ_DB_UPDATED = 2,
+  // prefixes advertised by PrefixManager
+  PREFIX_DB_UPDATED = 3,
+  // flooding by KvStore until Decision of a node received the update
+  KVSTORE_FLOOD = 4,
+  DECISION_DEBOUNCE = 5,
+  // phase of a route computation, nested in the computation
+  DECISION_PHASE = 6,
+  DECISION_ROUTE_UPDATE = 7,
+  FIB_ROUTE_DB_RECEIVED = 8,
+  FIB_ROUTES_PROGRAMMED = 9,
+}
+
 //
 // Interfaces
 //
@@ -61,6 +87,13 @@ struct InterfaceDatabase {
 
   // Optional attribute to measure convergence performance
   3: optional PerfEvents perfEvents;
+
+  // Incremental updates. When isDelta is set, interfaces only holds the
+  // interfaces added or changed since the update numbered seqNum - 1, and
+  // deletedInterfaces the ones removed. Otherwise this is a full snapshot
+  4: bool isDelta = false
+  5: list<string> deletedInterfaces
+  6: i64 seqNum = 0
 }
 
 //
@@ -20,17 +20,97 @@ include "KvStore.thrift"
 include "LinkMonitor.thrift"
 include "Lsdb.thrift"
 include "Network.thrift"
+include "PrefixManager.thrift"
 
 exception OpenrError {
   1: string message
 } ( message = "message" )
 
+/**
+ * CPU profile of module threads, see startCpuProfile
+ */
+struct CpuProfileParams {
+  /**
+   * Threads to profile, named as the module event bases e.g. "Decision". All
+   * registered threads if empty
+   */
+  1: list<string> threadNames
+
+  /**
+   * Sampling stops after this duration, up to 300 seconds
+   */
+  2: i32 durationSec = 10
+
+  /**
+   * Samples per second of CPU time used by each thread, up to 1000
+   */
+  3: i32 samplingHz = 99
+}
+
+struct CpuProfile {
+  /**
+   * Number of samples of each stack, as
+   * "<thread>;<outermost frame>;...;<innermost frame>"
+   */
+  1: map<string, i64> foldedStacks
+
+  /**
+   * CPU time used by each profiled thread while sampled
+   */
+  2: map<string, i64> threadCpuTimeUs
+
+  3: i64 numSamples
+
+  /**
+   * Samples lost once the sample buffer was full
+   */
+  4: i64 numDroppedSamples
+
+  5: i64 durationMs
+}
+
+/**
+ * Performance knob of a module tunable at runtime, see setRuntimeKnob
+ */
+struct RuntimeKnob {
+  1: string name
+  2: string description
+  3: i64 value
+
+  /**
+   * Value configured at startup, restored by resetRuntimeKnob
+   */
+  4: i64 defaultValue
+
+  5: i64 minValue
+  6: i64 maxValue
+
+  /**
+   * Value is kept in the config store and restored on restart
+   */
+  7: bool persisted
+}
+
+/**
+ * Values of the persisted runtime knobs, by name
+ */
+struct RuntimeKnobValues {
+  1: map<string, i64> values
+}
+
 /**
  * Thrift service - exposes RPC APIs for interaction with all of Open/R's
  * modules.
  */
 service OpenrCtrl extends fb303.FacebookService {
 
+  //
+  // Methods are served by the thread pool of their priority, see the
+  // ctrl_server_*_threads flags. HIGH for the KvStore peering and prefix
+  // injection control plane, IMPORTANT for full-syncs of KvStore peers and
+  // BEST_EFFORT for full dumps meant for monitoring. Others are NORMAL
+  //
+
   //
   // PrefixManager APIs
   //
@@ -39,20 +119,20 @@ service OpenrCtrl extends fb303.FacebookService {
    * Advertise or Update prefixes
    */
   void advertisePrefixes(1: list<Lsdb.PrefixEntry> prefixes)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Withdraw previously advertised prefixes. Only relevant attributes for this
    * operation are `prefix` and `type`
    */
   void withdrawPrefixes(1: list<Lsdb.PrefixEntry> prefixes)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Withdraw prefixes in bulk by type (aka client-id)
    */
   void withdrawPrefixesByType(1: Network.PrefixType prefixType)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Sync prefixes by type. This operation set the new state for given type.
@@ -62,6 +142,18 @@ service OpenrCtrl extends fb303.FacebookService {
   void syncPrefixesByType(
     1: Network.PrefixType prefixType,
     2: list<Lsdb.PrefixEntry> prefixes) throws (1: OpenrError error)
+    (priority = 'HIGH')
+
+  /**
+   * Apply a chunk of prefix changes. Meant for streaming large numbers of
+   * prefixes with a window of chunks in flight, each acknowledged once
+   * applied. All chunks received within an event loop run of PrefixManager
+   * are persisted and advertised together. Fails if too many chunks are
+   * pending, see PrefixDeltaAck.maxPendingChunks
+   */
+  PrefixManager.PrefixDeltaAck applyPrefixDeltaChunk(
+    1: PrefixManager.PrefixDeltaChunk chunk) throws (1: OpenrError error)
+    (priority = 'HIGH')
 
   /**
    * Get all prefixes being advertised
@@ -82,16 +174,37 @@ service OpenrCtrl extends fb303.FacebookService {
    * Get route database of the current node. It is retrieved from FIB module.
    */
   Fib.RouteDatabase getRouteDb()
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
+
+  /**
+   * Get a page of the route database of the current node, retrieved from FIB
+   * module. All pages are taken from the same `version` of the route
+   * database, 0 for the latest one, starting at `offset`. Fails once the
+   * version isn't retained anymore, start over from offset 0 then.
+   */
+  Fib.RouteDatabasePage getRouteDbPage(
+    1: i64 version,
+    2: i64 offset,
+    3: i32 limit) throws (1: OpenrError error)
+
+  /**
+   * Get the changes of the route database of the current node since
+   * `version` of a previous getRouteDbPage or getRouteDbChangedSince call,
+   * retrieved from FIB module. Has all routes if the changes since `version`
+   * aren't retained anymore.
+   */
+  Fib.RouteDatabaseChanges getRouteDbChangedSince(1: i64 version)
     throws (1: OpenrError error)
 
   /**
    * Get route database from decision module. Since Decision has global
    * topology information, any node can be retrieved.
    *
-   * NOTE: Current node's routes are returned if `nodeName` is empty.
+   * NOTE: Current node's routes are returned if `nodeName` is empty. They
+   * are the routes last published to FIB, once there are any.
    */
   Fib.RouteDatabase getRouteDbComputed(1: string nodeName)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * Get unicast routes after applying a list of prefix filter.
@@ -106,7 +219,7 @@ service OpenrCtrl extends fb303.FacebookService {
    * Get all unicast routes of the current node, retrieved from FIB module.
    */
   list<Network.UnicastRoute> getUnicastRoutes()
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * Get Mpls routes after applying a list of prefix filter.
@@ -119,7 +232,7 @@ service OpenrCtrl extends fb303.FacebookService {
    * Get all Mpls routes of the current node, retrieved from FIB module.
    */
   list<Network.MplsRoute> getMplsRoutes()
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
 
   //
@@ -132,6 +245,28 @@ service OpenrCtrl extends fb303.FacebookService {
    */
 
   Fib.PerfDatabase getPerfDb()
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
+
+  /**
+   * Get histograms of route convergence latencies since start of Open/R,
+   * by class of routes and by originating event.
+   */
+  Fib.PerfHistograms getPerfHistograms()
+    throws (1: OpenrError error)
+
+  /**
+   * Get latest route changes received by Fib module, oldest first. Empty
+   * unless route tracing is enabled with `route_trace_buffer_size`.
+   */
+  Fib.RouteTraceDatabase getFibRouteTrace()
+    throws (1: OpenrError error)
+
+  /**
+   * Get latest sampled convergence traces of Fib module, oldest first, with
+   * the time spent in every stage from the originating event until routes
+   * were programmed. Empty unless enabled with `convergence_trace_buffer_size`
+   */
+  Fib.ConvergenceTraceDatabase getConvergenceTrace()
     throws (1: OpenrError error)
 
   //
@@ -143,14 +278,33 @@ service OpenrCtrl extends fb303.FacebookService {
    * module. This represents currently active nodes (includes bi-directional
    * check)
    */
-  Decision.AdjDbs getDecisionAdjacencyDbs() throws (1: OpenrError error)
+  Decision.AdjDbs getDecisionAdjacencyDbs()
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * Get global prefix databases. This represents prefixes of actives nodes
    * only. While KvStore can represent dead node's information until their keys
    * expires
    */
-  Decision.PrefixDbs getDecisionPrefixDbs() throws (1: OpenrError error)
+  Decision.PrefixDbs getDecisionPrefixDbs()
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
+
+  /**
+   * Compute routes of the current node as if the given mutations were applied
+   * to the link state. Returns the change against the routes computed on the
+   * current link state. Does not affect actual route computation and
+   * programming of routes in any way.
+   */
+  Fib.RouteDatabaseDelta getDecisionRouteDbWhatIf(
+    1: Decision.WhatIfRequest request
+  ) throws (1: OpenrError error) (priority = 'BEST_EFFORT')
+
+  /**
+   * Get latest route changes published by Decision module, oldest first.
+   * Empty unless route tracing is enabled with `route_trace_buffer_size`.
+   */
+  Fib.RouteTraceDatabase getDecisionRouteTrace()
+    throws (1: OpenrError error)
 
   //
   // Get area feature configuration
@@ -167,7 +321,7 @@ service OpenrCtrl extends fb303.FacebookService {
    * keys will be returned
    */
   KvStore.Publication getKvStoreKeyVals(1: list<string> filterKeys)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * with area option
@@ -175,13 +329,13 @@ service OpenrCtrl extends fb303.FacebookService {
   KvStore.Publication getKvStoreKeyValsArea(
     1: list<string> filterKeys,
     2: string area =  KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * Get raw key-values from KvStore with more control over filter
    */
   KvStore.Publication getKvStoreKeyValsFiltered(1: KvStore.KeyDumpParams filter)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * Get raw key-values from KvStore with more control over filter with 'area'
@@ -190,13 +344,13 @@ service OpenrCtrl extends fb303.FacebookService {
   KvStore.Publication getKvStoreKeyValsFilteredArea(
     1: KvStore.KeyDumpParams filter,
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'IMPORTANT')
 
   /**
    * Get kvstore metadata (no values) with filter
    */
   KvStore.Publication getKvStoreHashFiltered(1: KvStore.KeyDumpParams filter)
-    throws (1: OpenrError error)
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   /**
    * with area
@@ -204,7 +358,7 @@ service OpenrCtrl extends fb303.FacebookService {
   KvStore.Publication getKvStoreHashFilteredArea(
     1: KvStore.KeyDumpParams filter,
     2: string area =  KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'IMPORTANT')
 
   /**
    * Set/Update key-values in KvStore.
@@ -212,7 +366,7 @@ service OpenrCtrl extends fb303.FacebookService {
   void setKvStoreKeyVals(
     1: KvStore.KeySetParams setParams,
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Long poll API to get KvStore
@@ -227,7 +381,7 @@ service OpenrCtrl extends fb303.FacebookService {
   void processKvStoreDualMessage(
     1: Dual.DualMessages messages
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Set flood-topology parameters. Called by neighbors
@@ -235,7 +389,7 @@ service OpenrCtrl extends fb303.FacebookService {
   void updateFloodTopologyChild(
     1: KvStore.FloodTopoSetParams params,
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Get spanning tree information
@@ -244,6 +398,13 @@ service OpenrCtrl extends fb303.FacebookService {
     1: string area
   ) throws (1: OpenrError error);
 
+  /**
+   * Get the heaviest key families, originators and keys updated recently
+   */
+  KvStore.KvStoreChurnStats getKvStoreChurnStats(
+    1: string area = KvStore.kDefaultArea
+  ) throws (1: OpenrError error);
+
   /**
    * Add/Update KvStore peer - usually not to be used by external peers unless
    * you know what you're doing.
@@ -251,7 +412,7 @@ service OpenrCtrl extends fb303.FacebookService {
   void addUpdateKvStorePeers(
     1: KvStore.PeersMap peers,
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Delete KvStore peers
@@ -259,7 +420,7 @@ service OpenrCtrl extends fb303.FacebookService {
   void deleteKvStorePeers(
     1: list<string> peerNames,
     2: string area = KvStore.kDefaultArea
-  ) throws (1: OpenrError error)
+  ) throws (1: OpenrError error) (priority = 'HIGH')
 
   /**
    * Get KvStore peers
@@ -366,8 +527,49 @@ service OpenrCtrl extends fb303.FacebookService {
   /**
    * Get ZMQ log events
    */
-  list<Monitor.EventLog> getEventLogs() throws (1: OpenrError error)
+  list<Monitor.EventLog> getEventLogs()
+    throws (1: OpenrError error) (priority = 'BEST_EFFORT')
 
   // Get Openr Node Name
   string getMyNodeName()
+
+  //
+  // Profiling APIs
+  //
+
+  /**
+   * Start sampling the stacks of module threads, see CpuProfileParams. One
+   * profile may run at a time
+   */
+  void startCpuProfile(1: CpuProfileParams params)
+    throws (1: OpenrError error)
+
+  /**
+   * Stop the profile if still running and return it
+   */
+  CpuProfile stopCpuProfile() throws (1: OpenrError error)
+
+  //
+  // Runtime knobs APIs
+  //
+
+  /**
+   * Performance knobs of the modules, tunable without restart
+   */
+  list<RuntimeKnob> getRuntimeKnobs()
+
+  /**
+   * Set a knob to a value within its bounds, picked up by its module on next
+   * use. Persisted values are restored on restart
+   * NOTE: This API should only be accessible from local node
+   */
+  void setRuntimeKnob(1: string name, 2: i64 value, 3: bool persist = false)
+    throws (1: OpenrError error)
+
+  /**
+   * Set a knob back to its value configured at startup, and drop it from the
+   * config store if persisted
+   * NOTE: This API should only be accessible from local node
+   */
+  void resetRuntimeKnob(1: string name) throws (1: OpenrError error)
 }
@@ -8,6 +8,7 @@
 namespace cpp2 openr.thrift
 namespace py3 openr.thrift
 
+include "openr/if/Fib.thrift"
 include "openr/if/KvStore.thrift"
 include "openr/if/OpenrCtrl.thrift"
 
@@ -29,4 +30,29 @@ service OpenrCtrlCpp extends OpenrCtrl.OpenrCtrl {
    * There may be some replicated entries in stream that are also in snapshot.
    */
   KvStore.Publication, stream<KvStore.Publication> subscribeAndGetKvStore()
+
+  /**
+   * Subscribe KvStore updates matching the filter, i.e. key-vals with one of
+   * the comma separated key prefixes or originator ids of KeyDumpParams.
+   * Expired keys are matched by key prefixes only. Publications without any
+   * match are skipped. Filtering happens before publications are streamed,
+   * once for all subscribers with the same filter.
+   */
+  stream<KvStore.Publication> subscribeKvStoreFilter(
+    1: KvStore.KeyDumpParams filter
+  )
+
+  /**
+   * Same as subscribeAndGetKvStore, with snapshot and stream filtered
+   */
+  KvStore.Publication, stream<KvStore.Publication>
+  subscribeAndGetKvStoreFiltered(1: KvStore.KeyDumpParams filter)
+
+  /**
+   * Compute routes of the given nodes, of all nodes if empty, on a snapshot of
+   * the current link state and stream them one route database per node, in
+   * the given order. Computation happens in the background and doesn't delay
+   * route computation and programming of the current node.
+   */
+  stream<Fib.RouteDatabase> getDecisionRouteDbs(1: list<string> nodeNames)
 }
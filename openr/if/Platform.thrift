@@ -35,6 +35,8 @@ struct NeighborEntry {
   2: Network.BinaryAddress destination;
   3: string linkAddr;
   4: bool isReachable;
+  // resolution of the neighbor failed (NUD_FAILED)
+  5: bool isFailed = 0;
 }
 
 struct Link {
@@ -87,6 +89,10 @@ enum SwitchRunState {
    LINK_EVENT = 1,
    ADDRESS_EVENT = 2,
    NEIGHBOR_EVENT = 3,
+   /*
+    * Coalesced link/address events, eventData is a PlatformEventBatch
+    */
+   EVENT_BATCH = 4,
  }
 
 struct PlatformEvent {
@@ -94,6 +100,15 @@ struct PlatformEvent {
   2: binary eventData;
 }
 
+/**
+ * Latest states of a burst of netlink events, at most one link entry per
+ * ifIndex and one address entry per interface prefix
+ */
+struct PlatformEventBatch {
+  1: list<LinkEntry> linkEntries;
+  2: list<AddrEntry> addrEntries;
+}
+
 exception PlatformError {
   1: string message
 } ( message = "message" )
@@ -206,6 +221,22 @@ service FibService extends fb303.FacebookService {
     1: i16 clientId
   ) throws (1: PlatformError error)
 
+  // Digests of the unicast routes of client, with prefixes hashed into
+  // numBuckets buckets. Lets client resync only the buckets which differ
+  list<i64> getRouteTableDigests(
+    1: i16 clientId,
+    2: i32 numBuckets,
+  ) throws (1: PlatformError error)
+
+  // Replace the unicast routes of the listed buckets with routes, which
+  // must all belong to one of them. Routes of other buckets are untouched
+  void syncFibBuckets(
+    1: i16 clientId,
+    2: i32 numBuckets,
+    3: list<i32> buckets,
+    4: list<Network.UnicastRoute> routes,
+  ) throws (1: PlatformError error)
+
   //
   // MPLS routes API
   //
@@ -24,3 +24,29 @@ struct PrefixUpdateRequest {
   2: optional Network.PrefixType type
   3: list<Lsdb.PrefixEntry> prefixes
 }
+
+/**
+ * A chunk of a stream of prefix changes, e.g. of a BGP speaker. Chunks
+ * arriving together are applied in order of seqNum, withdrawals of a chunk
+ * after its additions. Withdrawing unknown prefixes is not an error.
+ */
+struct PrefixDeltaChunk {
+  1: i64 seqNum
+  2: list<Lsdb.PrefixEntry> prefixesToAdvertise
+  3: list<Lsdb.PrefixEntry> prefixesToWithdraw
+}
+
+/**
+ * Acknowledges a chunk once it's applied. It's going to be persisted and
+ * advertised with the next (throttled) config store and KvStore updates.
+ */
+struct PrefixDeltaAck {
+  1: i64 seqNum
+  // number of prefixes changed by the chunk
+  2: i32 numAdvertised
+  3: i32 numWithdrawn
+  // chunks received but not applied yet, and the limit of those above which
+  // chunks are rejected. Clients keep fewer chunks than that in flight
+  4: i32 numPendingChunks
+  5: i32 maxPendingChunks
+}
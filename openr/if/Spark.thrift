@@ -46,6 +46,9 @@ struct SparkNeighbor {
 
   // the interface name of the node sending hello packets over
   9: string ifName = ""
+
+  // neighbor's OpenrCtrl thrift server port, 0 if not known
+  10: i32 openrCtrlThriftPort = 0
 }
 
 //
@@ -210,6 +213,29 @@ struct SparkNeighborEvent {
   7: string area = KvStore.kDefaultArea
 }
 
+//
+// Spark2 neighbor ESTABLISHED at shutdown, persisted for quick adjacency
+// with it on restart
+//
+struct SparkCachedNeighbor {
+  1: string nodeName
+  2: string remoteIfName
+  // label we assigned to the adjacency
+  3: i32 label
+  4: Network.BinaryAddress transportAddressV6
+  5: Network.BinaryAddress transportAddressV4
+  6: i32 openrCtrlThriftPort
+  7: i32 kvStoreCmdPort
+  8: string area
+}
+
+//
+// Spark2 neighbors persisted at shutdown, keyed by local interface name
+//
+struct SparkNeighborCache {
+  1: map<string, list<SparkCachedNeighbor>> neighbors
+}
+
 //
 // Spark result status
 //
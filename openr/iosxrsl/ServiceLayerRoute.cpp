@@ -1,4 +1,5 @@
 #include "ServiceLayerRoute.h"
+#include <algorithm>
 #include <google/protobuf/text_format.h>
 
 using grpc::ClientContext;
@@ -17,6 +18,17 @@ namespace openr {
 IosxrslRoute::IosxrslRoute(std::shared_ptr<grpc::Channel> Channel)
     : channel(Channel) {}
 
+IosxrslRoute::~IosxrslRoute()
+{
+    // The completion queue must be drained before it goes away
+    drainRouteOps();
+    routeOpCq_.Shutdown();
+    void* tag;
+    bool ok;
+    while (routeOpCq_.Next(&tag, &ok)) {
+    }
+}
+
 
 /*IosxrslRoute::IosxrslRoute(fbzmq::ZmqEventLoop* zmqEventLoop,
                                  uint8_t routeProtocolId,
@@ -670,6 +682,169 @@ IosxrslRoute::deletePrefixPathV4(std::string prefix,
 }
 
 
+namespace {
+
+// Routes of a batch which the RIB failed to program. All of them if the RPC
+// failed or the whole batch was rejected, else the ones with an error in
+// the per route results
+template <typename RouteMsg, typename RouteMsgRsp, typename PrefixToString>
+void
+collectFailedRoutes(const RouteMsg& msg,
+                    const RouteMsgRsp& resp,
+                    bool rpcOk,
+                    PrefixToString prefixToString,
+                    std::vector<std::string>& failedRoutes)
+{
+    if (rpcOk && resp.statussummary().status() ==
+            service_layer::SLErrorStatus_SLErrno_SL_SUCCESS) {
+        return;
+    }
+
+    if (rpcOk && resp.statussummary().status() ==
+            service_layer::SLErrorStatus_SLErrno_SL_SOME_ERR) {
+        for (int i = 0; i < resp.results_size(); i++) {
+            auto const& result = resp.results(i);
+            if (result.errstatus().status() !=
+                    service_layer::SLErrorStatus_SLErrno_SL_SUCCESS) {
+                LOG(ERROR) << "Error code for prefix: "
+                           << prefixToString(result.prefix())
+                           << " prefixlen: " << result.prefixlen()
+                           << " is 0x" << std::hex
+                           << result.errstatus().status() << std::dec;
+                failedRoutes.emplace_back(
+                    prefixToString(result.prefix()) + "/" +
+                    std::to_string(result.prefixlen()));
+            }
+        }
+        return;
+    }
+
+    LOG(ERROR) << "Route batch of " << msg.routes_size()
+               << " routes failed, error code is 0x" << std::hex
+               << resp.statussummary().status() << std::dec;
+    for (int i = 0; i < msg.routes_size(); i++) {
+        failedRoutes.emplace_back(
+            prefixToString(msg.routes(i).prefix()) + "/" +
+            std::to_string(msg.routes(i).prefixlen()));
+    }
+}
+
+} // namespace
+
+void
+IosxrslRoute::setMaxInFlight(unsigned int maxInFlight)
+{
+    maxInFlight_ = std::max(1u, maxInFlight);
+}
+
+void
+IosxrslRoute::routev4OpAsync(service_layer::SLObjectOp routeOp,
+                             unsigned int timeout)
+{
+    if (routev4_msg.routes_size() == 0) {
+        return;
+    }
+    while (pendingRouteOps_.size() >= maxInFlight_) {
+        completeRouteOp();
+    }
+    if (!routev4Stub_) {
+        routev4Stub_ = service_layer::SLRoutev4Oper::NewStub(channel);
+    }
+
+    auto op = std::make_unique<PendingRouteOp>();
+    routev4_msg.set_oper(routeOp);
+    // Hand the batch over to the request, keeping the vrf for the next one
+    op->v4Msg.Swap(&routev4_msg);
+    routev4_msg.set_vrfname(op->v4Msg.vrfname());
+    prefix_map_v4.clear();
+
+    op->context.set_deadline(
+        std::chrono::system_clock::now() + std::chrono::seconds(timeout));
+    op->v4Reader = routev4Stub_->AsyncSLRoutev4Op(
+        &op->context, op->v4Msg, &routeOpCq_);
+    void* tag = op.get();
+    op->v4Reader->Finish(&op->v4Resp, &op->status, tag);
+    pendingRouteOps_.emplace(tag, std::move(op));
+}
+
+void
+IosxrslRoute::routev6OpAsync(service_layer::SLObjectOp routeOp,
+                             unsigned int timeout)
+{
+    if (routev6_msg.routes_size() == 0) {
+        return;
+    }
+    while (pendingRouteOps_.size() >= maxInFlight_) {
+        completeRouteOp();
+    }
+    if (!routev6Stub_) {
+        routev6Stub_ = service_layer::SLRoutev6Oper::NewStub(channel);
+    }
+
+    auto op = std::make_unique<PendingRouteOp>();
+    op->isV6 = true;
+    routev6_msg.set_oper(routeOp);
+    // Hand the batch over to the request, keeping the vrf for the next one
+    op->v6Msg.Swap(&routev6_msg);
+    routev6_msg.set_vrfname(op->v6Msg.vrfname());
+    prefix_map_v6.clear();
+
+    op->context.set_deadline(
+        std::chrono::system_clock::now() + std::chrono::seconds(timeout));
+    op->v6Reader = routev6Stub_->AsyncSLRoutev6Op(
+        &op->context, op->v6Msg, &routeOpCq_);
+    void* tag = op.get();
+    op->v6Reader->Finish(&op->v6Resp, &op->status, tag);
+    pendingRouteOps_.emplace(tag, std::move(op));
+}
+
+void
+IosxrslRoute::completeRouteOp()
+{
+    void* tag = nullptr;
+    bool ok = false;
+    if (!routeOpCq_.Next(&tag, &ok)) {
+        LOG(ERROR) << "Route operation completion queue shut down";
+        pendingRouteOps_.clear();
+        return;
+    }
+
+    auto it = pendingRouteOps_.find(tag);
+    CHECK(it != pendingRouteOps_.end());
+    auto op = std::move(it->second);
+    pendingRouteOps_.erase(it);
+
+    const bool rpcOk = ok && op->status.ok();
+    if (!rpcOk) {
+        LOG(ERROR) << "RPC failed, error code is " << op->status.error_code();
+    }
+    if (op->isV6) {
+        collectFailedRoutes(op->v6Msg, op->v6Resp, rpcOk,
+                            [this](const std::string& prefix) {
+                                return ByteArrayStringtoIpv6(prefix);
+                            },
+                            failedRoutes_);
+    } else {
+        collectFailedRoutes(op->v4Msg, op->v4Resp, rpcOk,
+                            [this](uint32_t prefix) {
+                                return longToIpv4(prefix);
+                            },
+                            failedRoutes_);
+    }
+}
+
+std::vector<std::string>
+IosxrslRoute::drainRouteOps()
+{
+    while (!pendingRouteOps_.empty()) {
+        completeRouteOp();
+    }
+    std::vector<std::string> failedRoutes;
+    failedRoutes.swap(failedRoutes_);
+    return failedRoutes;
+}
+
+
 // V6 methods
 
 void
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ServiceLayerAsyncInit.h"
+#include <unordered_map>
+#include <vector>
 #include <iosxrsl/sl_route_common.pb.h>
 #include <iosxrsl/sl_route_ipv4.grpc.pb.h>
 #include <iosxrsl/sl_route_ipv6.grpc.pb.h>
@@ -13,6 +15,7 @@ namespace openr {
 class IosxrslRoute {
 public:
     explicit IosxrslRoute(std::shared_ptr<grpc::Channel> Channel);
+    ~IosxrslRoute();
 
     enum PathUpdateAction
     {
@@ -186,6 +189,51 @@ public:
                             uint8_t prefixLen,
                             std::string nextHopAddress,
                             std::string nextHopIf);
+
+    // Pipelined route operations. The current batch is sent without waiting
+    // for the response and cleared for the next one. At most maxInFlight
+    // batches are outstanding, beyond that we wait for the oldest to
+    // complete. Routes the RIB failed to program are collected from the
+    // responses and returned by drainRouteOps().
+
+    void setMaxInFlight(unsigned int maxInFlight);
+
+    void routev4OpAsync(service_layer::SLObjectOp routeOp,
+                        unsigned int timeout=10);
+
+    void routev6OpAsync(service_layer::SLObjectOp routeOp,
+                        unsigned int timeout=10);
+
+    // Wait for all outstanding batches. Returns routes (prefix/len) which
+    // failed, all routes of a batch count as failed if its RPC failed
+    std::vector<std::string> drainRouteOps();
+
+private:
+    // State of one batch sent with routev4OpAsync or routev6OpAsync
+    struct PendingRouteOp {
+        bool isV6{false};
+        grpc::ClientContext context;
+        grpc::Status status;
+        service_layer::SLRoutev4Msg v4Msg;
+        service_layer::SLRoutev4MsgRsp v4Resp;
+        service_layer::SLRoutev6Msg v6Msg;
+        service_layer::SLRoutev6MsgRsp v6Resp;
+        std::unique_ptr<grpc::ClientAsyncResponseReader<
+            service_layer::SLRoutev4MsgRsp>> v4Reader;
+        std::unique_ptr<grpc::ClientAsyncResponseReader<
+            service_layer::SLRoutev6MsgRsp>> v6Reader;
+    };
+
+    // Wait for the next outstanding batch and collect its failed routes
+    void completeRouteOp();
+
+    unsigned int maxInFlight_{1};
+    grpc::CompletionQueue routeOpCq_;
+    std::unique_ptr<service_layer::SLRoutev4Oper::Stub> routev4Stub_;
+    std::unique_ptr<service_layer::SLRoutev6Oper::Stub> routev6Stub_;
+    // outstanding batches by completion queue tag
+    std::unordered_map<void*, std::unique_ptr<PendingRouteOp>> pendingRouteOps_;
+    std::vector<std::string> failedRoutes_;
 };
 
 
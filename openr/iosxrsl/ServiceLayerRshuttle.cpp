@@ -69,8 +69,11 @@ IosxrslRshuttle::IosxrslRshuttle(
             fbzmq::ZmqEventLoop* zmqEventLoop,
             std::vector<VrfData> vrfSet,
             uint8_t routeProtocolId,
-            std::shared_ptr<grpc::Channel> Channel)
-  : routeProtocolId_(routeProtocolId)
+            std::shared_ptr<grpc::Channel> Channel,
+            size_t batchSize,
+            unsigned int maxInFlight)
+  : routeProtocolId_(routeProtocolId),
+    batchSize_(std::max<size_t>(1, batchSize))
 {
     evl_ = zmqEventLoop;
     CHECK(evl_) << "Invalid ZMQ event loop handle";
@@ -181,6 +184,7 @@ IosxrslRshuttle::IosxrslRshuttle(
 
     iosxrslVrf_ = std::make_unique<IosxrslVrf>(Channel);
     iosxrslRoute_ = std::make_unique<IosxrslRoute>(Channel);
+    iosxrslRoute_->setMaxInFlight(maxInFlight);
 
     evl_->runInEventLoop([this, vrfSet]() mutable {
         for (auto const &vrf_data : vrfSet) {
@@ -446,6 +450,58 @@ IosxrslRshuttle::deleteUnicastRoute(const folly::CIDRNetwork& prefix) {
 }
 
 
+folly::Future<folly::Unit>
+IosxrslRshuttle::addUnicastRoutes(UnicastRoutes routes) {
+  VLOG(3) << "Adding " << routes.size() << " unicast routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runInEventLoop(
+      [this, promise = std::move(promise), routes = std::move(routes)]()
+          mutable {
+        try {
+          doAddUnicastRoutes(routes);
+          promise.setValue();
+        } catch (IosxrslException const& ex) {
+          LOG(ERROR) << "Error adding unicast routes: "
+                     << folly::exceptionStr(ex);
+          promise.setException(ex);
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error adding unicast routes: "
+                     << folly::exceptionStr(ex);
+          promise.setException(ex);
+        }
+      });
+  return future;
+}
+
+folly::Future<folly::Unit>
+IosxrslRshuttle::deleteUnicastRoutes(std::vector<folly::CIDRNetwork> prefixes) {
+  VLOG(3) << "Deleting " << prefixes.size() << " unicast routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runInEventLoop(
+      [this, promise = std::move(promise), prefixes = std::move(prefixes)]()
+          mutable {
+        try {
+          doDeleteUnicastRoutes(prefixes);
+          promise.setValue();
+        } catch (IosxrslException const& ex) {
+          LOG(ERROR) << "Error deleting unicast routes: "
+                     << folly::exceptionStr(ex);
+          promise.setException(ex);
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error deleting unicast routes: "
+                     << folly::exceptionStr(ex);
+          promise.setException(ex);
+        }
+      });
+  return future;
+}
+
 folly::Future<UnicastRoutes>
 IosxrslRshuttle::getUnicastRoutes() {
   VLOG(3) << "Getting all routes";
@@ -679,6 +735,119 @@ IosxrslRshuttle::deleteUnicastRouteV6(
 }
 
 
+void
+IosxrslRshuttle::checkRouteVrf(const folly::CIDRNetwork& prefix) {
+  auto const& vrfName = prefix.first.isV4()
+      ? iosxrslRoute_->routev4_msg.vrfname()
+      : iosxrslRoute_->routev6_msg.vrfname();
+  if (vrfName.empty()) {
+    throw IosxrslException(folly::sformat(
+        "Could not program route: {} Service Layer Error: {}",
+        folly::IPAddress::networkToString(prefix),
+        std::to_string(
+            service_layer::SLErrorStatus_SLErrno_SL_RPC_ROUTE_VRF_NAME_MISSING)));
+  }
+}
+
+void
+IosxrslRshuttle::doAddUnicastRoutes(const UnicastRoutes& routes) {
+  for (auto const& kv : routes) {
+    checkRouteVrf(kv.first);
+  }
+
+  for (auto const& kv : routes) {
+    auto const& prefix = kv.first;
+    CHECK(not kv.second.empty());
+    for (auto const& nextHop : kv.second) {
+      auto nexthop_if = iosxrIfName(std::get<0>(nextHop));
+      auto nexthop_address = std::get<1>(nextHop).str();
+      if (prefix.first.isV4()) {
+        iosxrslRoute_->insertAddBatchV4(prefix.first.str(),
+                                        folly::to<uint8_t>(prefix.second),
+                                        routeProtocolId_,
+                                        nexthop_address,
+                                        nexthop_if);
+      } else {
+        iosxrslRoute_->insertAddBatchV6(prefix.first.str(),
+                                        folly::to<uint8_t>(prefix.second),
+                                        routeProtocolId_,
+                                        nexthop_address,
+                                        nexthop_if);
+      }
+    }
+
+    if (prefix.first.isV4()) {
+      routeDb_[iosxrslRoute_->routev4_msg.vrfname()]
+          .unicastRoutesV4_[prefix] = kv.second;
+      if (static_cast<size_t>(iosxrslRoute_->routev4_msg.routes_size()) >=
+          batchSize_) {
+        iosxrslRoute_->routev4OpAsync(service_layer::SL_OBJOP_UPDATE);
+      }
+    } else {
+      routeDb_[iosxrslRoute_->routev6_msg.vrfname()]
+          .unicastRoutesV6_[prefix] = kv.second;
+      if (static_cast<size_t>(iosxrslRoute_->routev6_msg.routes_size()) >=
+          batchSize_) {
+        iosxrslRoute_->routev6OpAsync(service_layer::SL_OBJOP_UPDATE);
+      }
+    }
+  }
+
+  // Using the Update Operation to replace existing prefixes
+  // or create them if they don't exist.
+  iosxrslRoute_->routev4OpAsync(service_layer::SL_OBJOP_UPDATE);
+  iosxrslRoute_->routev6OpAsync(service_layer::SL_OBJOP_UPDATE);
+  auto failedRoutes = iosxrslRoute_->drainRouteOps();
+  if (not failedRoutes.empty()) {
+    throw IosxrslException(folly::sformat(
+        "Could not add {} of {} routes: {}",
+        failedRoutes.size(),
+        routes.size(),
+        folly::join(", ", failedRoutes)));
+  }
+}
+
+void
+IosxrslRshuttle::doDeleteUnicastRoutes(
+    const std::vector<folly::CIDRNetwork>& prefixes) {
+  for (auto const& prefix : prefixes) {
+    checkRouteVrf(prefix);
+  }
+
+  for (auto const& prefix : prefixes) {
+    if (prefix.first.isV4()) {
+      routeDb_[iosxrslRoute_->routev4_msg.vrfname()]
+          .unicastRoutesV4_.erase(prefix);
+      iosxrslRoute_->insertDeleteBatchV4(prefix.first.str(),
+                                         folly::to<uint8_t>(prefix.second));
+      if (static_cast<size_t>(iosxrslRoute_->routev4_msg.routes_size()) >=
+          batchSize_) {
+        iosxrslRoute_->routev4OpAsync(service_layer::SL_OBJOP_DELETE);
+      }
+    } else {
+      routeDb_[iosxrslRoute_->routev6_msg.vrfname()]
+          .unicastRoutesV6_.erase(prefix);
+      iosxrslRoute_->insertDeleteBatchV6(prefix.first.str(),
+                                         folly::to<uint8_t>(prefix.second));
+      if (static_cast<size_t>(iosxrslRoute_->routev6_msg.routes_size()) >=
+          batchSize_) {
+        iosxrslRoute_->routev6OpAsync(service_layer::SL_OBJOP_DELETE);
+      }
+    }
+  }
+
+  iosxrslRoute_->routev4OpAsync(service_layer::SL_OBJOP_DELETE);
+  iosxrslRoute_->routev6OpAsync(service_layer::SL_OBJOP_DELETE);
+  auto failedRoutes = iosxrslRoute_->drainRouteOps();
+  if (not failedRoutes.empty()) {
+    throw IosxrslException(folly::sformat(
+        "Could not delete {} of {} routes: {}",
+        failedRoutes.size(),
+        prefixes.size(),
+        folly::join(", ", failedRoutes)));
+  }
+}
+
 void
 IosxrslRshuttle::doSyncRoutes(UnicastRoutes newRouteDb) {
 
@@ -686,49 +855,46 @@ IosxrslRshuttle::doSyncRoutes(UnicastRoutes newRouteDb) {
   auto unicastRouteDb_ = doGetUnicastRoutes();
 
   // Go over routes that are not in new routeDb, delete
-  for (auto it = unicastRouteDb_.begin(); it != unicastRouteDb_.end();) {
-    auto const& prefix = it->first;
-    if (newRouteDb.find(prefix) == newRouteDb.end()) {
-      try {
-        doDeleteUnicastRoute(prefix);
-      } catch (IosxrslException const& err) {
-        LOG(ERROR) << folly::sformat(
-            "Could not del Route to: {} Error: {}",
-            folly::IPAddress::networkToString(prefix),
-            folly::exceptionStr(err));
-      } catch (std::exception const& err) {
-        LOG(ERROR) << folly::sformat(
-            "Could not del Route to: {} Error: {}",
-            folly::IPAddress::networkToString(prefix),
-            folly::exceptionStr(err));
-      }
-      it = unicastRouteDb_.erase(it);
-    } else {
-      ++it;
+  std::vector<folly::CIDRNetwork> staleRoutes;
+  for (auto const& kv : unicastRouteDb_) {
+    if (newRouteDb.find(kv.first) == newRouteDb.end()) {
+      staleRoutes.emplace_back(kv.first);
     }
   }
 
+  std::vector<std::string> errors;
+  try {
+    doDeleteUnicastRoutes(staleRoutes);
+  } catch (std::exception const& err) {
+    errors.emplace_back(folly::exceptionStr(err).toStdString());
+  }
+
   // Using the Route batch UPDATE utility in IOSXR SL-API,
   // simply push the newRoutedb into the XR RIB
-
-  for (auto const& kv : newRouteDb) {
-      auto const& prefix = kv.first;
-      try {
-        doAddUnicastRoute(prefix, kv.second);
-      } catch (IosxrslException const& err) {
-        LOG(ERROR) << folly::sformat(
-            "Could not add Route to: {} Error: {}",
-            folly::IPAddress::networkToString(prefix),
-            folly::exceptionStr(err));
-      } catch (std::exception const& err) {
-        LOG(ERROR) << folly::sformat(
-            "Could not add Route to: {} Error: {}",
-            folly::IPAddress::networkToString(prefix),
-            folly::exceptionStr(err));
-      }
-      unicastRouteDb_.emplace(prefix, std::move(kv.second));
+  for (auto it = newRouteDb.begin(); it != newRouteDb.end();) {
+    if (it->second.empty()) {
+      LOG(ERROR) << "Got empty nexthops for prefix "
+                 << folly::IPAddress::networkToString(it->first)
+                 << " ... Skipping";
+      it = newRouteDb.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  try {
+    doAddUnicastRoutes(newRouteDb);
+  } catch (std::exception const& err) {
+    errors.emplace_back(folly::exceptionStr(err).toStdString());
   }
 
+  // Report failed routes once all others are programmed, so that they are
+  // retried with the next sync
+  if (not errors.empty()) {
+    throw IosxrslException(folly::sformat(
+        "Sync of {} routes failed: {}",
+        newRouteDb.size(),
+        folly::join("; ", errors)));
+  }
 }
 
 
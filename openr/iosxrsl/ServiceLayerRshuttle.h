@@ -59,11 +59,15 @@ using RouteDb = std::unordered_map<std::string, RouteDbVrf >;
 
 class IosxrslRshuttle {
 public:
+    // Batched route updates are sent batchSize routes per RPC, with up to
+    // maxInFlight RPCs outstanding
     explicit IosxrslRshuttle(
             fbzmq::ZmqEventLoop* zmqEventLoop,
             std::vector<VrfData> vrfSet,
             uint8_t routeProtocolId,
-            std::shared_ptr<grpc::Channel> Channel);
+            std::shared_ptr<grpc::Channel> Channel,
+            size_t batchSize = 1000,
+            unsigned int maxInFlight = 8);
 
     ~IosxrslRshuttle();
 
@@ -83,6 +87,14 @@ public:
   folly::Future<folly::Unit>
   deleteUnicastRoute(const folly::CIDRNetwork& prefix);
 
+  // Add or delete many routes with pipelined batches. The future fails
+  // listing all routes the RIB failed to program, after the others are done
+  folly::Future<folly::Unit>
+  addUnicastRoutes(UnicastRoutes routes);
+
+  folly::Future<folly::Unit>
+  deleteUnicastRoutes(std::vector<folly::CIDRNetwork> prefixes);
+
 
   // Sync route table in IOS-XR RIB  with given route table
   // Basically when there's mismatch between IOS-XR RIB and route table in
@@ -129,6 +141,13 @@ public:
   void deleteUnicastRouteV6(
       const folly::CIDRNetwork& prefix);
 
+  // Batched flavours, throw listing the failed routes
+  void doAddUnicastRoutes(const UnicastRoutes& routes);
+  void doDeleteUnicastRoutes(const std::vector<folly::CIDRNetwork>& prefixes);
+
+  // Throw if the vrf of prefix's address family isn't set
+  void checkRouteVrf(const folly::CIDRNetwork& prefix);
+
   UnicastRoutes doGetUnicastRoutes();
 
   void doSyncRoutes(UnicastRoutes newRouteDb);
@@ -141,6 +160,9 @@ public:
 
   const uint8_t routeProtocolId_{0};
 
+  // max routes per RPC of batched route updates
+  const size_t batchSize_{1000};
+
   // With Service layer APIs, openR is just another protocol on the
   // IOS-XR system. We maintain a local Route Database for sanity checks 
   // and quicker route queries.
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/kvstore/FloodSeenCache.h>
+
+#include <functional>
+
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+FloodSeenCache::FloodSeenCache(std::chrono::milliseconds ttl, size_t maxSize)
+    : ttl_(ttl), maxSize_(maxSize) {
+  CHECK_GT(maxSize_, 0);
+}
+
+uint64_t
+FloodSeenCache::getFloodId(
+    const std::unordered_map<std::string, thrift::Value>& keyVals) {
+  // sum of key-val hashes, the same whatever the order of keyVals
+  uint64_t floodId{0};
+  for (auto const& kv : keyVals) {
+    auto const& value = kv.second;
+    // peers flood the memoized hash, hash the value if it lacks one for
+    // different values of the same version not to collide
+    int64_t valueHash{0};
+    if (value.hash.hasValue()) {
+      valueHash = *value.hash;
+    } else if (value.value.hasValue()) {
+      valueHash = std::hash<std::string>()(*value.value);
+    }
+    floodId += folly::hash::hash_combine(
+        kv.first,
+        value.originatorId,
+        value.version,
+        value.ttlVersion,
+        valueHash);
+  }
+  return floodId;
+}
+
+bool
+FloodSeenCache::insert(uint64_t floodId, Clock::time_point now) {
+  expire(now);
+  if (not seen_.insert(floodId).second) {
+    return false;
+  }
+  seenOrder_.emplace_back(now, floodId);
+  if (seenOrder_.size() > maxSize_) {
+    seen_.erase(seenOrder_.front().second);
+    seenOrder_.pop_front();
+  }
+  return true;
+}
+
+void
+FloodSeenCache::expire(Clock::time_point now) {
+  while (not seenOrder_.empty() and seenOrder_.front().first + ttl_ <= now) {
+    seen_.erase(seenOrder_.front().second);
+    seenOrder_.pop_front();
+  }
+}
+
+} // namespace openr
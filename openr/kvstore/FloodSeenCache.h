@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+//
+// Flood identifiers of the publications received lately by a KvStore area,
+// to drop the copies of an update delivered by several peers of a dense mesh
+// before merging and re-flooding them.
+//
+// The identifier of a publication covers the key, originator, version, TTL
+// version and value hash of each of its key-vals, regardless of their order.
+// Copies flooded by different peers carry the same identifier. The remaining
+// TTL, which drops along the path, is left out. Identifiers are forgotten
+// after ttl, and the oldest ones once maxSize are held.
+//
+class FloodSeenCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  FloodSeenCache(std::chrono::milliseconds ttl, size_t maxSize);
+
+  // flood identifier of key-vals
+  static uint64_t getFloodId(
+      const std::unordered_map<std::string, thrift::Value>& keyVals);
+
+  // record floodId as seen at now. Returns false if it was already seen
+  // within ttl, i.e. the publication is a duplicate
+  bool insert(uint64_t floodId, Clock::time_point now = Clock::now());
+
+  size_t
+  size() const {
+    return seen_.size();
+  }
+
+ private:
+  // forget the identifiers seen ttl before now
+  void expire(Clock::time_point now);
+
+  const std::chrono::milliseconds ttl_;
+  const size_t maxSize_{0};
+
+  std::unordered_set<uint64_t> seen_;
+
+  // seen_ in the order they were seen, oldest first
+  std::deque<std::pair<Clock::time_point, uint64_t>> seenOrder_;
+};
+
+} // namespace openr
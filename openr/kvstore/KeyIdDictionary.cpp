@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/kvstore/KeyIdDictionary.h>
+
+#include <folly/Random.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+KeyIdEncoder::KeyIdEncoder(size_t maxKeyIds)
+    : maxKeyIds_(maxKeyIds), session_(folly::Random::rand64()) {
+  CHECK_GT(maxKeyIds_, 0);
+}
+
+void
+KeyIdEncoder::resetIfFull() {
+  if (keys_.size() < maxKeyIds_) {
+    return;
+  }
+  // start over rather than growing with every key ever flooded
+  VLOG(1) << "Resetting " << keys_.size() << " key IDs";
+  session_ = folly::Random::rand64();
+  keyIds_.clear();
+  keys_.clear();
+  peers_.clear();
+}
+
+std::vector<int32_t>
+KeyIdEncoder::encode(thrift::KeySetParams& params) {
+  std::vector<int32_t> usedKeyIds;
+  std::map<int32_t, thrift::Value> keyIdVals;
+  for (auto& kv : params.keyVals) {
+    const auto keyId = getKeyId(kv.first);
+    keyIdVals.emplace(keyId, std::move(kv.second));
+    usedKeyIds.emplace_back(keyId);
+  }
+  params.keyVals.clear();
+  params.keyIdVals = std::move(keyIdVals);
+
+  if (params.ttlUpdates.hasValue()) {
+    for (auto& updates : params.ttlUpdates.value()) {
+      std::vector<int32_t> keyIds;
+      keyIds.reserve(updates.keys.size());
+      for (auto const& key : updates.keys) {
+        keyIds.emplace_back(getKeyId(key));
+        usedKeyIds.emplace_back(keyIds.back());
+      }
+      updates.keys.clear();
+      updates.keyIds = std::move(keyIds);
+    }
+  }
+  params.keyIdSession = session_;
+  return usedKeyIds;
+}
+
+std::map<int32_t, std::string>
+KeyIdEncoder::getNewDefinitions(
+    const std::string& peer, std::vector<int32_t> const& keyIds) {
+  std::map<int32_t, std::string> definitions;
+  auto& known = peers_[peer];
+  for (auto const keyId : keyIds) {
+    DCHECK_LT(keyId, keys_.size());
+    if (static_cast<size_t>(keyId) >= known.size()) {
+      known.resize(keys_.size(), false);
+    }
+    if (not known[keyId]) {
+      known[keyId] = true;
+      definitions.emplace(keyId, keys_[keyId]);
+    }
+  }
+  return definitions;
+}
+
+void
+KeyIdEncoder::resetPeer(const std::string& peer) {
+  peers_.erase(peer);
+}
+
+int32_t
+KeyIdEncoder::getKeyId(const std::string& key) {
+  auto res = keyIds_.emplace(key, static_cast<int32_t>(keys_.size()));
+  if (res.second) {
+    keys_.emplace_back(key);
+  }
+  return res.first->second;
+}
+
+bool
+KeyIdDecoder::decode(const std::string& peer, thrift::KeySetParams& params) {
+  if (not params.keyIdSession.hasValue()) {
+    return true;
+  }
+
+  auto& peerKeys = peers_[peer];
+  if (peerKeys.session != params.keyIdSession.value()) {
+    // the peer started over, definitions of the previous session are stale
+    peerKeys.session = params.keyIdSession.value();
+    peerKeys.keys.clear();
+  }
+  if (params.keyIdDefinitions.hasValue()) {
+    for (auto& kv : params.keyIdDefinitions.value()) {
+      peerKeys.keys[kv.first] = std::move(kv.second);
+    }
+    params.keyIdDefinitions = folly::none;
+  }
+
+  bool allKnown = true;
+  if (params.keyIdVals.hasValue()) {
+    for (auto& kv : params.keyIdVals.value()) {
+      auto it = peerKeys.keys.find(kv.first);
+      if (it == peerKeys.keys.end()) {
+        allKnown = false;
+        continue;
+      }
+      params.keyVals.emplace(it->second, std::move(kv.second));
+    }
+    params.keyIdVals = folly::none;
+  }
+
+  if (params.ttlUpdates.hasValue()) {
+    for (auto& updates : params.ttlUpdates.value()) {
+      if (not updates.keyIds.hasValue()) {
+        continue;
+      }
+      auto const& keyIds = updates.keyIds.value();
+      const size_t numKeys = keyIds.size();
+      if (updates.versions.size() != numKeys or
+          updates.ttlVersions.size() != numKeys or
+          updates.ttls.size() != numKeys) {
+        // left malformed, rejected when expanded
+        continue;
+      }
+      // updates of unknown keys are dropped from all the parallel lists
+      thrift::KeyTtlUpdates decoded;
+      decoded.originatorId = std::move(updates.originatorId);
+      for (size_t i = 0; i < numKeys; ++i) {
+        auto it = peerKeys.keys.find(keyIds[i]);
+        if (it == peerKeys.keys.end()) {
+          allKnown = false;
+          continue;
+        }
+        decoded.keys.emplace_back(it->second);
+        decoded.versions.emplace_back(updates.versions[i]);
+        decoded.ttlVersions.emplace_back(updates.ttlVersions[i]);
+        decoded.ttls.emplace_back(updates.ttls[i]);
+      }
+      updates = std::move(decoded);
+    }
+  }
+  params.keyIdSession = folly::none;
+  return allKnown;
+}
+
+void
+KeyIdDecoder::resetPeer(const std::string& peer) {
+  peers_.erase(peer);
+}
+
+} // namespace openr
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+//
+// Key IDs of the requests flooded to KvStore peers accepting them, see
+// Publication.acceptKeyIds. Keys are assigned small IDs, sent instead of the
+// keys once defined to a peer: the first request of a key to a peer carries
+// its definition (KeySetParams.keyIdDefinitions).
+//
+// IDs are shared by all peers so that requests referring to keys the peers
+// know are encoded once. Which IDs each peer knows is tracked per peer and
+// forgotten on reset, i.e. when the peer reconnects, a request to it fails or
+// it asks for it. All IDs are dropped for a new session once maxKeyIds keys
+// are assigned one.
+//
+class KeyIdEncoder {
+ public:
+  explicit KeyIdEncoder(size_t maxKeyIds);
+
+  // drop all IDs for a new session if maxKeyIds keys are assigned one. Not
+  // to be called while encoded params are in use
+  void resetIfFull();
+
+  // replace the keys of params, in keyVals and ttlUpdates, by their IDs.
+  // Returns the IDs used
+  std::vector<int32_t> encode(thrift::KeySetParams& params);
+
+  // definitions of the keyIds unknown to peer, from then on assumed known
+  std::map<int32_t, std::string> getNewDefinitions(
+      const std::string& peer, std::vector<int32_t> const& keyIds);
+
+  // forget the IDs known by peer, they are defined again as used
+  void resetPeer(const std::string& peer);
+
+  int64_t
+  getSession() const {
+    return session_;
+  }
+
+  size_t
+  size() const {
+    return keys_.size();
+  }
+
+ private:
+  // ID of key, assigned one if it has none
+  int32_t getKeyId(const std::string& key);
+
+  const size_t maxKeyIds_{0};
+
+  // identifies the IDs assigned since the last reset, peers drop the
+  // definitions of other sessions
+  int64_t session_{0};
+
+  std::unordered_map<std::string, int32_t> keyIds_;
+
+  // ID -> key
+  std::vector<std::string> keys_;
+
+  // IDs known by each peer, indexed by ID
+  std::unordered_map<std::string /* node-name */, std::vector<bool>> peers_;
+};
+
+//
+// Key IDs defined by the peers flooding us requests encoded by a
+// KeyIdEncoder, per peer.
+//
+class KeyIdDecoder {
+ public:
+  // restore the keys of params encoded by peer. Returns false if some IDs are
+  // unknown, their key-vals are dropped. Params not encoded are left as is
+  bool decode(const std::string& peer, thrift::KeySetParams& params);
+
+  // forget the definitions of peer
+  void resetPeer(const std::string& peer);
+
+ private:
+  struct PeerKeys {
+    int64_t session{0};
+    std::unordered_map<int32_t, std::string> keys;
+  };
+  std::unordered_map<std::string /* node-name */, PeerKeys> peers_;
+};
+
+} // namespace openr
@@ -7,14 +7,20 @@
 
 #include "KvStore.h"
 
-#include <fbzmq/service/logging/LogSample.h>
+#include <algorithm>
+
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/GLog.h>
 #include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/system/ThreadName.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/EventLogBuffer.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/OpenrCtrl_types.h>
 
@@ -22,12 +28,23 @@ using namespace std::chrono;
 
 namespace openr {
 
+namespace {
+
+// upper bounds of the sync interval and flood rate runtime knobs
+const int64_t kMaxDbSyncIntervalS{3600};
+const int64_t kMaxFloodRate{1000000};
+
+} // namespace
+
 KvStoreFilters::KvStoreFilters(
     std::vector<std::string> const& keyPrefix,
     std::set<std::string> const& nodeIds)
     : keyPrefixList_(keyPrefix),
       originatorIds_(nodeIds),
-      keyPrefixObjList_(KeyPrefix(keyPrefixList_)) {}
+      keyPrefixObjList_(KeyPrefix(keyPrefixList_)) {
+  literalKeyPrefixes_ = std::all_of(
+      keyPrefixList_.begin(), keyPrefixList_.end(), KeyPrefix::isLiteral);
+}
 
 bool
 KvStoreFilters::keyMatch(
@@ -72,7 +89,7 @@ KvStore::KvStore(
     // initializers for immutable state
     fbzmq::Context& zmqContext,
     std::string nodeId,
-    messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+    messaging::ReplicateQueue<KvStorePublicationPtr>& kvStoreUpdatesQueue,
     KvStoreLocalPubUrl localPubUrl,
     KvStoreGlobalCmdUrl globalCmdUrl,
     MonitorSubmitUrl monitorSubmitUrl,
@@ -88,10 +105,23 @@ KvStore::KvStore(
     bool enableFloodOptimization,
     bool isFloodRoot,
     bool useFloodOptimization,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    size_t numMergeShards,
+    std::string snapshotFilePath,
+    std::chrono::seconds snapshotInterval,
+    bool enableThriftPeers,
+    bool enableMultiRootFlooding,
+    std::vector<std::string> floodPriorityKeyPrefixes,
+    KvStoreQuota quota,
+    std::string exportPathPrefix,
+    size_t lazyValueThreshold,
+    bool partitionedFullSync,
+    RuntimeKnobs* runtimeKnobs,
+    bool enableAreaEventBases)
     : inprocCmdUrl(folly::sformat("inproc://{}_KVSTORE_local_cmd", nodeId)),
       localPubUrl_(std::move(localPubUrl)),
       monitorSubmitInterval_(monitorSubmitInterval),
+      snapshotFilePath_(std::move(snapshotFilePath)),
       kvParams_(
           nodeId,
           kvStoreUpdatesQueue,
@@ -124,6 +154,49 @@ KvStore::KvStore(
       std::make_shared<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
   kvParams_.zmqMonitorClient = zmqMonitorClient_;
 
+  if (numMergeShards > 1) {
+    mergeExecutor_ =
+        std::make_unique<folly::CPUThreadPoolExecutor>(numMergeShards);
+    kvParams_.mergeExecutor = mergeExecutor_.get();
+    kvParams_.numMergeShards = numMergeShards;
+  }
+  kvParams_.enableThriftPeers = enableThriftPeers;
+  kvParams_.enableMultiRootFlooding = enableMultiRootFlooding;
+  kvParams_.floodPriorityKeyPrefixes = std::move(floodPriorityKeyPrefixes);
+  kvParams_.quota = quota;
+  kvParams_.exportPathPrefix = std::move(exportPathPrefix);
+  kvParams_.lazyValueThreshold = lazyValueThreshold;
+  kvParams_.partitionedFullSync = partitionedFullSync;
+  if (runtimeKnobs) {
+    kvParams_.dbSyncIntervalS = runtimeKnobs->addKnob(
+        "kvstore.db_sync_interval_s",
+        "Interval of full-syncs with peers",
+        dbSyncInterval.count(),
+        1,
+        kMaxDbSyncIntervalS);
+    kvParams_.ttlDecrMs = runtimeKnobs->addKnob(
+        "kvstore.ttl_decrement_ms",
+        "TTL decrement of keys flooded to peers",
+        ttlDecr.count(),
+        1,
+        Constants::kTtlThreshold.count());
+    // rate limiters exist only if flooding is rate limited
+    if (floodRate.has_value()) {
+      kvParams_.floodMsgPerSec = runtimeKnobs->addKnob(
+          "kvstore.flood_msg_per_sec",
+          "Flood rate of each flood class",
+          floodRate->first,
+          1,
+          kMaxFloodRate);
+      kvParams_.floodMsgBurstSize = runtimeKnobs->addKnob(
+          "kvstore.flood_msg_burst_size",
+          "Flood burst size of each flood class",
+          floodRate->second,
+          1,
+          kMaxFloodRate);
+    }
+  }
+
   // Schedule periodic timer for counters submission
   const bool isPeriodic = true;
   monitorTimer_ = fbzmq::ZmqTimeout::make(
@@ -176,11 +249,16 @@ KvStore::KvStore(
 
   // create KvStoreDb instances
   for (auto const& area : areas_) {
+    OpenrEventBase* evb = this;
+    if (enableAreaEventBases) {
+      evb = areaEvbs_.emplace(area, std::make_unique<OpenrEventBase>())
+                .first->second.get();
+    }
     kvStoreDb_.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(area),
         std::forward_as_tuple(
-            this,
+            evb,
             kvParams_,
             area,
             fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT>(
@@ -192,163 +270,426 @@ KvStore::KvStore(
             nodeId,
             peers));
   }
+
+  if (not snapshotFilePath_.empty()) {
+    // restore once the event loop runs, before any peer gets added and
+    // before area event bases start
+    runInEventBaseThread([this]() noexcept { loadSnapshot(); });
+    snapshotExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+    snapshotTimer_ = fbzmq::ZmqTimeout::make(
+        getEvb(), [this]() noexcept { saveSnapshotAsync(); });
+    snapshotTimer_->scheduleTimeout(snapshotInterval, isPeriodic);
+  }
 }
 
-// static, public
-std::unordered_map<std::string, thrift::Value>
-KvStore::mergeKeyValues(
-    std::unordered_map<std::string, thrift::Value>& kvStore,
-    std::unordered_map<std::string, thrift::Value> const& keyVals,
-    std::optional<KvStoreFilters> const& filters) {
-  // the publication to build if we update our KV store
-  std::unordered_map<std::string, thrift::Value> kvUpdates;
+KvStore::~KvStore() {
+  stopAreaEventBases();
+  if (not snapshotFilePath_.empty()) {
+    // last snapshot is written inline, after the periodic one in flight
+    snapshotExecutor_->join();
+    const auto startTime = std::chrono::steady_clock::now();
+    writeSnapshot(takeSnapshot(), startTime);
+  }
+}
 
-  // Counters for logging
-  uint32_t ttlUpdateCnt{0}, valUpdateCnt{0};
+void
+KvStore::run() {
+  // areas start from our event loop, after what got queued on it meanwhile
+  runInEventBaseThread([this]() noexcept {
+    for (auto& kv : areaEvbs_) {
+      auto* evb = kv.second.get();
+      areaThreads_.emplace_back([evb, area = kv.first]() {
+        folly::setThreadName(folly::sformat("KvStore-{}", area));
+        LOG(INFO) << "Starting KvStore thread of area " << area;
+        evb->run();
+        LOG(INFO) << "KvStore thread of area " << area << " got stopped";
+      });
+      evb->waitUntilRunning();
+    }
+  });
+  OpenrEventBase::run();
+}
 
-  for (const auto& kv : keyVals) {
-    auto const& key = kv.first;
-    auto const& value = kv.second;
+void
+KvStore::stop() {
+  // we may be waiting on areas, they stop after us
+  OpenrEventBase::stop();
+  waitUntilStopped();
+  stopAreaEventBases();
+}
 
-    if (filters.has_value() && not filters->keyMatch(kv.first, kv.second)) {
-      VLOG(4) << "key: " << key << " not adding from " << value.originatorId;
-      continue;
-    }
+void
+KvStore::stopAreaEventBases() {
+  for (auto& kv : areaEvbs_) {
+    kv.second->stop();
+  }
+  for (auto& thread : areaThreads_) {
+    thread.join();
+  }
+  areaThreads_.clear();
+}
 
-    // versions must start at 1; setting this to zero here means
-    // we would be beaten by any version supplied by the setter
-    int64_t myVersion{0};
-    int64_t newVersion = value.version;
+OpenrEventBase*
+KvStore::getAreaEventBase(std::string const& area) {
+  auto it = areaEvbs_.find(area);
+  return it != areaEvbs_.end() ? it->second.get() : this;
+}
 
-    // Check if TTL is valid. It must be infinite or positive number
-    // Skip if invalid!
-    if (value.ttl != Constants::kTtlInfinity && value.ttl <= 0) {
+void
+KvStore::runInAreasAndWait(
+    folly::Function<void(std::string const&, KvStoreDb&)> func) {
+  for (auto& kv : kvStoreDb_) {
+    if (areaThreads_.empty()) {
+      func(kv.first, kv.second);
       continue;
     }
+    folly::Baton<> baton;
+    getAreaEventBase(kv.first)->runInEventBaseThread([&]() noexcept {
+      func(kv.first, kv.second);
+      baton.post();
+    });
+    baton.wait();
+  }
+}
 
-    // if key exist, compare values first
-    // if they are the same, no need to propagate changes
-    auto kvStoreIt = kvStore.find(key);
-    if (kvStoreIt != kvStore.end()) {
-      myVersion = kvStoreIt->second.version;
-    } else {
-      VLOG(4) << "(mergeKeyValues) key: '" << key << "' not found, adding";
-    }
+namespace {
 
-    // If we get an old value just skip it
-    if (newVersion < myVersion) {
-      continue;
-    }
+// Values are hashed once when stored. Hashes of peers running another hash
+// version are not comparable with ours and get replaced
+bool
+needsHash(thrift::Value const& value) {
+  return not value.hash.hasValue() or
+      getHashVersion(*value.hash) != Constants::kKvStoreHashVersion;
+}
+
+enum class MergeAction {
+  SKIP,
+  UPDATE_ALL,
+  UPDATE_TTL,
+};
+
+// Decide how value of key merges into myValue, the current value of key or
+// nullptr if key is not in the store. Updates of existing keys are applied to
+// myValue in place, new keys are left to the caller to add.
+// Only touches myValue, keys may be merged in parallel as long as each key is
+// merged by one thread.
+MergeAction
+mergeKeyValue(
+    std::string const& key,
+    thrift::Value const& value,
+    thrift::Value* myValue,
+    std::optional<KvStoreFilters> const& filters) {
+  if (filters.has_value() && not filters->keyMatch(key, value)) {
+    VLOG(4) << "key: " << key << " not adding from " << value.originatorId;
+    return MergeAction::SKIP;
+  }
 
-    bool updateAllNeeded{false};
-    bool updateTtlNeeded{false};
+  // versions must start at 1; setting this to zero here means
+  // we would be beaten by any version supplied by the setter
+  int64_t myVersion{0};
+  int64_t newVersion = value.version;
 
-    //
-    // Check updateAll and updateTtl
-    //
-    if (value.value.hasValue()) {
-      if (newVersion > myVersion) {
-        // Version is newer or
-        // kvStoreIt is NULL(myVersion is set to 0)
-        updateAllNeeded = true;
-      } else if (value.originatorId > kvStoreIt->second.originatorId) {
-        // versions are the same but originatorId is higher
+  // Check if TTL is valid. It must be infinite or positive number
+  // Skip if invalid!
+  if (value.ttl != Constants::kTtlInfinity && value.ttl <= 0) {
+    return MergeAction::SKIP;
+  }
+
+  // if key exist, compare values first
+  // if they are the same, no need to propagate changes
+  if (myValue) {
+    myVersion = myValue->version;
+  } else {
+    VLOG(4) << "(mergeKeyValues) key: '" << key << "' not found, adding";
+  }
+
+  // If we get an old value just skip it
+  if (newVersion < myVersion) {
+    return MergeAction::SKIP;
+  }
+
+  bool updateAllNeeded{false};
+  bool updateTtlNeeded{false};
+
+  //
+  // Check updateAll and updateTtl
+  //
+  if (value.value.hasValue()) {
+    if (newVersion > myVersion) {
+      // Version is newer or
+      // myValue is NULL(myVersion is set to 0)
+      updateAllNeeded = true;
+    } else if (value.originatorId > myValue->originatorId) {
+      // versions are the same but originatorId is higher
+      updateAllNeeded = true;
+    } else if (value.originatorId == myValue->originatorId) {
+      // This can occur after kvstore restarts or simply reconnects after
+      // disconnection. We let one of the two values win if they
+      // differ(higher in this case but can be lower as long as it's
+      // deterministic). Otherwise, local store can have new value while
+      // other stores have old value and they never sync.
+      int rc = (*value.value).compare(*myValue->value);
+      if (rc > 0) {
+        // versions and orginatorIds are same but value is higher
+        VLOG(3) << "Previous incarnation reflected back for key " << key;
         updateAllNeeded = true;
-      } else if (value.originatorId == kvStoreIt->second.originatorId) {
-        // This can occur after kvstore restarts or simply reconnects after
-        // disconnection. We let one of the two values win if they
-        // differ(higher in this case but can be lower as long as it's
-        // deterministic). Otherwise, local store can have new value while
-        // other stores have old value and they never sync.
-        int rc = (*value.value).compare(*kvStoreIt->second.value);
-        if (rc > 0) {
-          // versions and orginatorIds are same but value is higher
-          VLOG(3) << "Previous incarnation reflected back for key " << key;
-          updateAllNeeded = true;
-        } else if (rc == 0) {
-          // versions, orginatorIds, value are all same
-          // retain higher ttlVersion
-          if (value.ttlVersion > kvStoreIt->second.ttlVersion) {
-            updateTtlNeeded = true;
-          }
+      } else if (rc == 0) {
+        // versions, orginatorIds, value are all same
+        // retain higher ttlVersion
+        if (value.ttlVersion > myValue->ttlVersion) {
+          updateTtlNeeded = true;
         }
       }
     }
+  }
+
+  //
+  // Check updateTtl
+  //
+  if (not value.value.hasValue() and myValue and
+      value.version == myValue->version and
+      value.originatorId == myValue->originatorId and
+      value.ttlVersion > myValue->ttlVersion) {
+    updateTtlNeeded = true;
+  }
+
+  if (!updateAllNeeded and !updateTtlNeeded) {
+    VLOG(3) << "(mergeKeyValues) no need to update anything for key: '" << key
+            << "'";
+    return MergeAction::SKIP;
+  }
 
+  VLOG(3) << "Updating key: " << key << "\n  Version: " << myVersion << " -> "
+          << newVersion << "\n  Originator: "
+          << (myValue ? myValue->originatorId : "null") << " -> "
+          << value.originatorId << "\n  TtlVersion: "
+          << (myValue ? myValue->ttlVersion : 0) << " -> " << value.ttlVersion
+          << "\n  Ttl: " << (myValue ? myValue->ttl : 0) << " -> "
+          << value.ttl;
+
+  if (updateAllNeeded) {
+    FB_LOG_EVERY_MS(INFO, 500)
+        << "Updating key: " << key << ", Originator: " << value.originatorId
+        << ", Version: " << newVersion << ", TtlVersion: " << value.ttlVersion
+        << ", Ttl: " << value.ttl;
     //
-    // Check updateTtl
+    // update everything for such key
     //
-    if (not value.value.hasValue() and kvStoreIt != kvStore.end() and
-        value.version == kvStoreIt->second.version and
-        value.originatorId == kvStoreIt->second.originatorId and
-        value.ttlVersion > kvStoreIt->second.ttlVersion) {
-      updateTtlNeeded = true;
+    CHECK(value.value.hasValue());
+    if (myValue) {
+      // update the entry in place, the old value will be destructed
+      // (this will copy, intended)
+      *myValue = value;
+      // update hash if it's not there
+      if (needsHash(*myValue)) {
+        myValue->hash =
+            generateHash(value.version, value.originatorId, value.value);
+      }
     }
+    return MergeAction::UPDATE_ALL;
+  }
 
-    if (!updateAllNeeded and !updateTtlNeeded) {
-      VLOG(3) << "(mergeKeyValues) no need to update anything for key: '" << key
-              << "'";
-      continue;
+  //
+  // update ttl,ttlVersion only
+  //
+  CHECK(myValue);
+
+  // update TTL only, nothing else
+  myValue->ttl = value.ttl;
+  myValue->ttlVersion = value.ttlVersion;
+  return MergeAction::UPDATE_TTL;
+}
+
+// add new key to the store
+std::pair<const std::string, thrift::Value>&
+addKeyValue(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::string const& key,
+    thrift::Value const& value) {
+  // grab the new value (this will copy, intended)
+  auto kvStoreIt = kvStore.emplace(key, value).first;
+  // update hash if it's not there
+  if (needsHash(kvStoreIt->second)) {
+    kvStoreIt->second.hash =
+        generateHash(value.version, value.originatorId, value.value);
+  }
+  return *kvStoreIt;
+}
+
+// add the new keys of a merge to the store in one go, growing it at most once
+void
+addNewKeyValues(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::vector<KvStore::KeyValPtr> const& newKeyVals,
+    std::vector<KvStore::MergeUpdate>& updates) {
+  if (newKeyVals.empty()) {
+    return;
+  }
+  kvStore.reserve(kvStore.size() + newKeyVals.size());
+  for (const auto* kv : newKeyVals) {
+    updates.emplace_back(KvStore::MergeUpdate{
+        kv, &addKeyValue(kvStore, kv->first, kv->second)});
+  }
+}
+
+// rough serialized size of a key-value, bounding full-sync chunks
+size_t
+getKeyValBytes(std::string const& key, thrift::Value const& value) {
+  // fixed size fields and framing
+  constexpr size_t kKeyValOverheadBytes{48};
+  return key.size() + value.originatorId.size() +
+      (value.value.hasValue() ? value.value->size() : 0) +
+      kKeyValOverheadBytes;
+}
+
+// split key-values into chunks of about maxChunkBytes, holding at least one
+// key-value each. Returns a single chunk if they fit in one
+std::vector<std::unordered_map<std::string, thrift::Value>>
+splitKeyVals(
+    std::unordered_map<std::string, thrift::Value>&& keyVals,
+    size_t maxChunkBytes) {
+  std::vector<std::unordered_map<std::string, thrift::Value>> chunks(1);
+  size_t chunkBytes = 0;
+  for (auto& kv : keyVals) {
+    const size_t bytes = getKeyValBytes(kv.first, kv.second);
+    if (chunkBytes > 0 and chunkBytes + bytes > maxChunkBytes) {
+      chunks.emplace_back();
+      chunkBytes = 0;
     }
+    chunkBytes += bytes;
+    chunks.back().emplace(kv.first, std::move(kv.second));
+  }
+  return chunks;
+}
 
-    VLOG(3) << "Updating key: " << key << "\n  Version: " << myVersion << " -> "
-            << newVersion << "\n  Originator: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.originatorId
-                                           : "null")
-            << " -> " << value.originatorId << "\n  TtlVersion: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttlVersion : 0)
-            << " -> " << value.ttlVersion << "\n  Ttl: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttl : 0)
-            << " -> " << value.ttl;
-
-    // grab the new value (this will copy, intended)
-    thrift::Value newValue = value;
-
-    if (updateAllNeeded) {
-      ++valUpdateCnt;
-      FB_LOG_EVERY_MS(INFO, 500)
-          << "Updating key: " << key << ", Originator: " << value.originatorId
-          << ", Version: " << newVersion << ", TtlVersion: " << value.ttlVersion
-          << ", Ttl: " << value.ttl;
-      //
-      // update everything for such key
-      //
-      CHECK(value.value.hasValue());
-      if (kvStoreIt == kvStore.end()) {
-        // create new entry
-        std::tie(kvStoreIt, std::ignore) = kvStore.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(key),
-            std::forward_as_tuple(std::move(newValue)));
-      } else {
-        // update the entry in place, the old value will be destructed
-        kvStoreIt->second = std::move(newValue);
+} // anonymous namespace
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters) {
+  return mergeKeyValues(kvStore, keyVals, filters, nullptr, 1);
+}
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    folly::Executor* executor,
+    size_t numShards) {
+  const auto updates =
+      mergeKeyValueUpdates(kvStore, keyVals, filters, executor, numShards);
+
+  // the publication to build if we update our KV store
+  std::unordered_map<std::string, thrift::Value> kvUpdates;
+  kvUpdates.reserve(updates.size());
+  for (const auto& update : updates) {
+    kvUpdates.emplace(update.keyVal->first, update.keyVal->second);
+  }
+  return kvUpdates;
+}
+
+// static, public
+std::vector<KvStore::MergeUpdate>
+KvStore::mergeKeyValueUpdates(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    folly::Executor* executor,
+    size_t numShards) {
+  std::vector<MergeUpdate> updates;
+
+  if (not executor or numShards <= 1 or
+      keyVals.size() < Constants::kKvStoreShardedMergeMinKeys) {
+    std::vector<KeyValPtr> newKeyVals;
+    for (const auto& kv : keyVals) {
+      auto kvStoreIt = kvStore.find(kv.first);
+      const bool found = kvStoreIt != kvStore.end();
+      const auto action = mergeKeyValue(
+          kv.first, kv.second, found ? &kvStoreIt->second : nullptr, filters);
+      if (action == MergeAction::SKIP) {
+        continue;
       }
-      // update hash if it's not there
-      if (not kvStoreIt->second.hash.hasValue()) {
-        kvStoreIt->second.hash =
-            generateHash(value.version, value.originatorId, value.value);
+      if (not found) {
+        newKeyVals.emplace_back(&kv);
+        continue;
       }
-    } else if (updateTtlNeeded) {
-      ++ttlUpdateCnt;
-      //
-      // update ttl,ttlVersion only
-      //
-      CHECK(kvStoreIt != kvStore.end());
-
-      // update TTL only, nothing else
-      kvStoreIt->second.ttl = value.ttl;
-      kvStoreIt->second.ttlVersion = value.ttlVersion;
+      updates.emplace_back(MergeUpdate{&kv, &*kvStoreIt});
     }
+    addNewKeyValues(kvStore, newKeyVals, updates);
 
-    // announce the update
-    kvUpdates.emplace(key, value);
+    VLOG(4) << "(mergeKeyValues) updating " << updates.size()
+            << " keyvals. NewKeys: " << newKeyVals.size();
+    return updates;
   }
 
-  VLOG(4) << "(mergeKeyValues) updating " << kvUpdates.size()
-          << " keyvals. ValueUpdates: " << valUpdateCnt
-          << ", TtlUpdates: " << ttlUpdateCnt;
-  return kvUpdates;
+  // Partition keys by hash. Each shard is merged by a single task, which only
+  // looks up the store and updates existing values in place. New keys change
+  // the layout of the store and are added once all shards are done
+  std::vector<std::vector<KeyValPtr>> shards(numShards);
+  for (auto& shard : shards) {
+    shard.reserve(keyVals.size() / numShards + 1);
+  }
+  for (const auto& kv : keyVals) {
+    shards[std::hash<std::string>()(kv.first) % numShards].emplace_back(&kv);
+  }
+
+  struct ShardUpdates {
+    std::vector<MergeUpdate> updates;
+    std::vector<KeyValPtr> newKeyVals;
+  };
+  std::vector<ShardUpdates> shardUpdates(numShards);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    futures.emplace_back(folly::via(executor, [&, i]() {
+      auto& shardUpdate = shardUpdates[i];
+      for (const auto* kv : shards[i]) {
+        auto kvStoreIt = kvStore.find(kv->first);
+        const bool found = kvStoreIt != kvStore.end();
+        const auto action = mergeKeyValue(
+            kv->first,
+            kv->second,
+            found ? &kvStoreIt->second : nullptr,
+            filters);
+        if (action == MergeAction::SKIP) {
+          continue;
+        }
+        if (not found) {
+          shardUpdate.newKeyVals.emplace_back(kv);
+          continue;
+        }
+        shardUpdate.updates.emplace_back(MergeUpdate{kv, &*kvStoreIt});
+      }
+    }));
+  }
+  folly::collect(futures).get();
+
+  size_t numUpdates{0};
+  std::vector<KeyValPtr> newKeyVals;
+  for (const auto& shardUpdate : shardUpdates) {
+    numUpdates += shardUpdate.updates.size();
+    newKeyVals.insert(
+        newKeyVals.end(),
+        shardUpdate.newKeyVals.begin(),
+        shardUpdate.newKeyVals.end());
+  }
+  updates.reserve(numUpdates + newKeyVals.size());
+  for (auto& shardUpdate : shardUpdates) {
+    updates.insert(
+        updates.end(),
+        shardUpdate.updates.begin(),
+        shardUpdate.updates.end());
+  }
+  addNewKeyValues(kvStore, newKeyVals, updates);
+
+  VLOG(4) << "(mergeKeyValues) updating " << updates.size() << " keyvals in "
+          << numShards << " shards. NewKeys: " << newKeyVals.size();
+  return updates;
 }
 
 /**
@@ -389,6 +730,101 @@ KvStore::compareValues(const thrift::Value& v1, const thrift::Value& v2) {
   }
 }
 
+int64_t
+KvStore::getKeyBucket(const std::string& key, int32_t level) {
+  const int32_t bits = level * Constants::kKvStoreSyncBucketBits;
+  DCHECK_LT(0, bits);
+  DCHECK_GE(64, bits);
+  return static_cast<int64_t>(folly::hash::fnv64(key) >> (64 - bits));
+}
+
+int64_t
+KvStore::getKeyValDigest(const std::string& key, const thrift::Value& value) {
+  // Use stable hashes only, digests are compared across nodes. ttlVersion is
+  // left out on purpose, ttl updates are not meant to be sent over full-sync
+  // and would make digests of most buckets differ
+  return static_cast<int64_t>(folly::hash::hash_128_to_64(
+      folly::hash::hash_128_to_64(
+          folly::hash::fnv64(key), static_cast<uint64_t>(value.version)),
+      folly::hash::hash_128_to_64(
+          folly::hash::fnv64(value.originatorId),
+          static_cast<uint64_t>(value.hash.value_or(0)))));
+}
+
+std::vector<int64_t>
+KvStore::getDifferingBuckets(
+    std::map<int64_t, int64_t> const& digests1,
+    std::map<int64_t, int64_t> const& digests2) {
+  std::vector<int64_t> buckets;
+  auto it1 = digests1.begin();
+  auto it2 = digests2.begin();
+  while (it1 != digests1.end() or it2 != digests2.end()) {
+    if (it2 == digests2.end() or
+        (it1 != digests1.end() and it1->first < it2->first)) {
+      buckets.emplace_back(it1->first);
+      ++it1;
+    } else if (it1 == digests1.end() or it2->first < it1->first) {
+      buckets.emplace_back(it2->first);
+      ++it2;
+    } else {
+      if (it1->second != it2->second) {
+        buckets.emplace_back(it1->first);
+      }
+      ++it1;
+      ++it2;
+    }
+  }
+  return buckets;
+}
+
+std::vector<thrift::KeyTtlUpdates>
+KvStore::compactTtlUpdates(
+    thrift::KeyVals const& keyVals, thrift::KeyVals& otherKeyVals) {
+  std::vector<thrift::KeyTtlUpdates> ttlUpdates;
+  std::unordered_map<std::string, size_t> originatorIndex;
+  for (auto const& kv : keyVals) {
+    auto const& value = kv.second;
+    if (value.value.hasValue()) {
+      otherKeyVals.emplace(kv);
+      continue;
+    }
+    auto res = originatorIndex.emplace(value.originatorId, ttlUpdates.size());
+    if (res.second) {
+      ttlUpdates.emplace_back();
+      ttlUpdates.back().originatorId = value.originatorId;
+    }
+    auto& updates = ttlUpdates.at(res.first->second);
+    updates.keys.emplace_back(kv.first);
+    updates.versions.emplace_back(value.version);
+    updates.ttlVersions.emplace_back(value.ttlVersion);
+    updates.ttls.emplace_back(value.ttl);
+  }
+  return ttlUpdates;
+}
+
+bool
+KvStore::expandTtlUpdates(
+    std::vector<thrift::KeyTtlUpdates> const& ttlUpdates,
+    thrift::KeyVals& keyVals) {
+  for (auto const& updates : ttlUpdates) {
+    const size_t numKeys = updates.keys.size();
+    if (updates.versions.size() != numKeys or
+        updates.ttlVersions.size() != numKeys or
+        updates.ttls.size() != numKeys) {
+      return false;
+    }
+    for (size_t i = 0; i < numKeys; ++i) {
+      thrift::Value value;
+      value.version = updates.versions[i];
+      value.originatorId = updates.originatorId;
+      value.ttl = updates.ttls[i];
+      value.ttlVersion = updates.ttlVersions[i];
+      keyVals.emplace(updates.keys[i], std::move(value));
+    }
+  }
+  return true;
+}
+
 void
 KvStore::prepareSocket(
     fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>& socket,
@@ -440,54 +876,119 @@ KvStore::processCmdSocketRequest(
     LOG(ERROR) << "Empty request received";
     return;
   }
-  auto maybeReply = processRequestMsg(std::move(req.back()));
+  auto request = std::move(req.back());
   req.pop_back();
 
+  tData_.wlock()->addStatValue(
+      "kvstore.peers.bytes_received", request.size(), fbzmq::SUM);
+  auto maybeThriftReq =
+      request.readThriftObj<thrift::KvStoreRequest>(serializer_);
+  if (maybeThriftReq.hasError()) {
+    LOG(ERROR) << "processRequest: failed reading thrift::processRequestMsg"
+               << maybeThriftReq.error();
+    sendCmdSocketReply(
+        cmdSock, std::move(req), {}, folly::makeUnexpected(fbzmq::Error()));
+    return;
+  }
+
+  std::string area{openr::thrift::KvStore_constants::kDefaultArea()};
+  if (maybeThriftReq->area.hasValue()) {
+    area = maybeThriftReq->area.value();
+  }
+  VLOG(2) << "Request received for area " << area;
+
+  auto* evb = getAreaEventBase(area);
+  if (evb == this) {
+    std::vector<fbzmq::Message> leadingChunks;
+    auto maybeReply =
+        processRequestMsg(maybeThriftReq.value(), area, leadingChunks);
+    sendCmdSocketReply(
+        cmdSock,
+        std::move(req),
+        std::move(leadingChunks),
+        std::move(maybeReply));
+    return;
+  }
+
+  // processed on the event base of the area, the reply is sent from ours as
+  // the socket is ours
+  evb->runInEventBaseThread([this,
+                             &cmdSock,
+                             reqIds = std::move(req),
+                             thriftReq = std::move(maybeThriftReq.value()),
+                             area = std::move(area)]() mutable {
+    std::vector<fbzmq::Message> leadingChunks;
+    auto maybeReply = processRequestMsg(thriftReq, area, leadingChunks);
+    runInEventBaseThread([this,
+                          &cmdSock,
+                          reqIds = std::move(reqIds),
+                          leadingChunks = std::move(leadingChunks),
+                          maybeReply = std::move(maybeReply)]() mutable {
+      sendCmdSocketReply(
+          cmdSock,
+          std::move(reqIds),
+          std::move(leadingChunks),
+          std::move(maybeReply));
+    });
+  });
+}
+
+void
+KvStore::sendCmdSocketReply(
+    fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>& cmdSock,
+    std::vector<fbzmq::Message> reqIds,
+    std::vector<fbzmq::Message> leadingChunks,
+    folly::Expected<fbzmq::Message, fbzmq::Error> maybeReply) noexcept {
+  // leading chunks of a response go to the requester first, along the same
+  // ids and delims
+  for (auto& chunk : leadingChunks) {
+    std::vector<fbzmq::Message> chunkMsgs;
+    for (auto& msg : reqIds) {
+      chunkMsgs.emplace_back(
+          fbzmq::Message::from(msg.read<std::string>().value()).value());
+    }
+    chunkMsgs.emplace_back(std::move(chunk));
+    auto sndRet = cmdSock.sendMultiple(chunkMsgs);
+    if (sndRet.hasError()) {
+      LOG(ERROR) << "Error sending response chunk. " << sndRet.error();
+      return;
+    }
+  }
+
   // All messages of the multipart request except the last are sent back as they
   // are ids or empty delims. Add the response at the end of that list.
   if (maybeReply.hasValue()) {
-    req.emplace_back(std::move(maybeReply.value()));
+    reqIds.emplace_back(std::move(maybeReply.value()));
   } else {
-    req.emplace_back(
+    reqIds.emplace_back(
         fbzmq::Message::from(Constants::kErrorResponse.toString()).value());
   }
 
-  if (not req.back().empty()) {
-    auto sndRet = cmdSock.sendMultiple(req);
+  if (not reqIds.back().empty()) {
+    auto sndRet = cmdSock.sendMultiple(reqIds);
     if (sndRet.hasError()) {
       LOG(ERROR) << "Error sending response. " << sndRet.error();
     }
   }
-  return;
 }
 
 folly::Expected<fbzmq::Message, fbzmq::Error>
-KvStore::processRequestMsg(fbzmq::Message&& request) {
-  tData_.addStatValue(
-      "kvstore.peers.bytes_received", request.size(), fbzmq::SUM);
-  auto maybeThriftReq =
-      request.readThriftObj<thrift::KvStoreRequest>(serializer_);
-
-  if (maybeThriftReq.hasError()) {
-    LOG(ERROR) << "processRequest: failed reading thrift::processRequestMsg"
-               << maybeThriftReq.error();
-    return {folly::makeUnexpected(fbzmq::Error())};
-  }
-
-  auto& thriftRequest = maybeThriftReq.value();
-  std::string area{openr::thrift::KvStore_constants::kDefaultArea()};
-  if (thriftRequest.area.hasValue()) {
-    area = thriftRequest.area.value();
-  }
-
-  VLOG(2) << "Request received for area " << area;
+KvStore::processRequestMsg(
+    thrift::KvStoreRequest& thriftRequest,
+    std::string const& area,
+    std::vector<fbzmq::Message>& leadingChunks) {
   try {
     auto& kvStoreDb = kvStoreDb_.at(area);
-    auto response = kvStoreDb.processRequestMsgHelper(thriftRequest);
+    auto response =
+        kvStoreDb.processRequestMsgHelper(thriftRequest, leadingChunks);
+    auto tData = tData_.wlock();
     if (response.hasValue()) {
-      tData_.addStatValue(
+      tData->addStatValue(
           "kvstore.peers.bytes_sent", response->size(), fbzmq::SUM);
     }
+    for (auto const& chunk : leadingChunks) {
+      tData->addStatValue("kvstore.peers.bytes_sent", chunk.size(), fbzmq::SUM);
+    }
     return response;
   } catch (std::out_of_range const& e) {
     LOG(ERROR) << "std::out_of_range for area " << area;
@@ -502,17 +1003,18 @@ KvStore::getKvStoreKeyVals(
     thrift::KeyGetParams keyGetParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyGetParams = std::move(keyGetParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             keyGetParams = std::move(keyGetParams),
+                             area]() mutable {
     VLOG(3) << "Get key requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
       p.setException(
           thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
     } else {
-      tData_.addStatValue("kvstore.cmd_key_get", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_key_get", 1, fbzmq::COUNT);
 
       auto& kvStoreDb = kvStoreDb_.at(area);
       auto thriftPub = kvStoreDb.getKeyVals(keyGetParams.keys);
@@ -529,46 +1031,52 @@ KvStore::dumpKvStoreKeys(
     thrift::KeyDumpParams keyDumpParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyDumpParams = std::move(keyDumpParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             keyDumpParams = std::move(keyDumpParams),
+                             area]() mutable {
     VLOG(3) << "Dump all keys requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
       p.setException(
           thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
     } else {
-      tData_.addStatValue("kvstore.cmd_key_dump", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_key_dump", 1, fbzmq::COUNT);
 
       auto& kvStoreDb = kvStoreDb_.at(area);
-      std::vector<std::string> keyPrefixList;
-      folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
-      const auto keyPrefixMatch =
-          KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
-      auto thriftPub = kvStoreDb.dumpAllWithFilters(keyPrefixMatch);
-      if (keyDumpParams.keyValHashes.hasValue()) {
-        thriftPub = kvStoreDb.dumpDifference(
-            thriftPub.keyVals, keyDumpParams.keyValHashes.value());
-      }
-      kvStoreDb.updatePublicationTtl(thriftPub);
-      // I'm the initiator, set flood-root-id
-      thriftPub.floodRootId = kvStoreDb.getSptRootId();
-
-      if (keyDumpParams.keyValHashes.hasValue() and
-          keyDumpParams.prefix.empty()) {
-        // This usually comes from neighbor nodes
-        size_t numMissingKeys = 0;
-        if (thriftPub.tobeUpdatedKeys.hasValue()) {
-          numMissingKeys = thriftPub.tobeUpdatedKeys->size();
+      const auto maxKeys = keyDumpParams.maxKeys.value_or(0);
+      if (maxKeys > 0 and not keyDumpParams.keyValHashes.hasValue() and
+          not keyDumpParams.keyBucketDigests.hasValue()) {
+        tData_.wlock()->addStatValue(
+            "kvstore.cmd_key_dump_page", 1, fbzmq::COUNT);
+        std::vector<std::string> keyPrefixList;
+        folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+        const auto keyPrefixMatch =
+            KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
+        std::optional<std::string> cursor;
+        if (keyDumpParams.cursor.hasValue()) {
+          cursor = keyDumpParams.cursor.value();
         }
-        LOG(INFO) << "Processed full-sync request with "
-                  << keyDumpParams.keyValHashes.value().size()
-                  << " keyValHashes item(s). Sending "
-                  << thriftPub.keyVals.size() << " key-vals and "
-                  << numMissingKeys << " missing keys";
+        auto thriftPub =
+            kvStoreDb.dumpPageWithFilters(keyPrefixMatch, cursor, maxKeys);
+        kvStoreDb.updatePublicationTtl(thriftPub);
+        // I'm the initiator, set flood-root-id
+        thriftPub.floodRootId = kvStoreDb.getSptRootId();
+        p.setValue(
+            std::make_unique<thrift::Publication>(std::move(thriftPub)));
+        return;
       }
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
+
+      // same as KEY_DUMP commands, including the full-sync requests of peers
+      // reaching us over thrift
+      auto maybeThriftPub = kvStoreDb.processKeyDump(keyDumpParams);
+      if (maybeThriftPub.hasError()) {
+        p.setException(thrift::OpenrError("Invalid key bucket digests"));
+        return;
+      }
+      p.setValue(std::make_unique<thrift::Publication>(
+          std::move(maybeThriftPub.value())));
     }
   });
   return sf;
@@ -579,24 +1087,26 @@ KvStore::dumpKvStoreHashes(
     thrift::KeyDumpParams keyDumpParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyDumpParams = std::move(keyDumpParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             keyDumpParams = std::move(keyDumpParams),
+                             area]() mutable {
     VLOG(3) << "Dump all hashes requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
       p.setException(
           thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
     } else {
-      tData_.addStatValue("kvstore.cmd_hash_dump", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_hash_dump", 1, fbzmq::COUNT);
 
       auto& kvStoreDb = kvStoreDb_.at(area);
       std::set<std::string> originator{};
       std::vector<std::string> keyPrefixList{};
       folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
       KvStoreFilters kvFilters{keyPrefixList, originator};
-      auto thriftPub = kvStoreDb.dumpHashWithFilters(kvFilters);
+      auto thriftPub =
+          kvStoreDb.dumpWithFiltersCached(kvFilters, true /* hashesOnly */);
       kvStoreDb.updatePublicationTtl(thriftPub);
       p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
     }
@@ -609,10 +1119,11 @@ KvStore::setKvStoreKeyVals(
     thrift::KeySetParams keySetParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keySetParams = std::move(keySetParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             keySetParams = std::move(keySetParams),
+                             area]() mutable {
     VLOG(3) << "Set key requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -620,22 +1131,27 @@ KvStore::setKvStoreKeyVals(
           thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
     } else {
       // Update statistics
-      tData_.addStatValue("kvstore.cmd_key_set", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_key_set", 1, fbzmq::COUNT);
       if (keySetParams.timestamp_ms.hasValue()) {
         auto floodMs = getUnixTimeStampMs() - keySetParams.timestamp_ms.value();
         if (floodMs > 0) {
-          tData_.addStatValue("kvstore.flood_duration_ms", floodMs, fbzmq::AVG);
+          tData_.wlock()->addStatValue(
+              "kvstore.flood_duration_ms", floodMs, fbzmq::AVG);
         }
       }
 
-      // Update hash for key-values
       auto& kvStoreDb = kvStoreDb_.at(area);
+      if (keySetParams.ttlUpdates.hasValue() and
+          not expandTtlUpdates(
+              keySetParams.ttlUpdates.value(), keySetParams.keyVals)) {
+        p.setException(thrift::OpenrError("Malformed TTL updates"));
+        return;
+      }
+
+      // Drop hashes of the setter, values are hashed by the merge only if
+      // they end up stored
       for (auto& kv : keySetParams.keyVals) {
-        auto& value = kv.second;
-        if (value.value.hasValue()) {
-          value.hash =
-              generateHash(value.version, value.originatorId, value.value);
-        }
+        kv.second.hash = folly::none;
       }
 
       // Create publication and merge it with local KvStore
@@ -668,14 +1184,15 @@ folly::SemiFuture<std::unique_ptr<thrift::PeersMap>>
 KvStore::getKvStorePeers(std::string area) {
   folly::Promise<std::unique_ptr<thrift::PeersMap>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this, p = std::move(p), area]() mutable {
     VLOG(2) << "Peer dump requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
       p.setException(
           thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
     } else {
-      tData_.addStatValue("kvstore.cmd_peer_dump", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_peer_dump", 1, fbzmq::COUNT);
       auto& kvStoreDb = kvStoreDb_.at(area);
       auto reply = kvStoreDb.dumpPeers();
       p.setValue(std::make_unique<thrift::PeersMap>(std::move(reply.peers)));
@@ -689,10 +1206,11 @@ KvStore::addUpdateKvStorePeers(
     thrift::PeerAddParams peerAddParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peerAddParams = std::move(peerAddParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             peerAddParams = std::move(peerAddParams),
+                             area]() mutable {
     VLOG(2) << "Peer addition requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -702,7 +1220,7 @@ KvStore::addUpdateKvStorePeers(
       p.setException(thrift::OpenrError(
           "Empty peerNames from peer-add request, ignoring"));
     } else {
-      tData_.addStatValue("kvstore.cmd_peer_add", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_peer_add", 1, fbzmq::COUNT);
       auto& kvStoreDb = kvStoreDb_.at(area);
       kvStoreDb.addPeers(peerAddParams.peers);
       p.setValue();
@@ -716,10 +1234,11 @@ KvStore::deleteKvStorePeers(
     thrift::PeerDelParams peerDelParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peerDelParams = std::move(peerDelParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             peerDelParams = std::move(peerDelParams),
+                             area]() mutable {
     VLOG(2) << "Peer deletion requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -729,7 +1248,7 @@ KvStore::deleteKvStorePeers(
       p.setException(thrift::OpenrError(
           "Empty peerNames from peer-del request, ignoring"));
     } else {
-      tData_.addStatValue("kvstore.cmd_per_del", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue("kvstore.cmd_per_del", 1, fbzmq::COUNT);
       auto& kvStoreDb = kvStoreDb_.at(area);
       kvStoreDb.delPeers(peerDelParams.peerNames);
       p.setValue();
@@ -742,7 +1261,8 @@ folly::SemiFuture<std::unique_ptr<thrift::SptInfos>>
 KvStore::getSpanningTreeInfos(std::string area) {
   folly::Promise<std::unique_ptr<thrift::SptInfos>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this, p = std::move(p), area]() mutable {
     VLOG(3) << "FLOOD_TOPO_GET command requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -757,15 +1277,33 @@ KvStore::getSpanningTreeInfos(std::string area) {
   return sf;
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::KvStoreChurnStats>>
+KvStore::getKvStoreChurnStats(std::string area) {
+  folly::Promise<std::unique_ptr<thrift::KvStoreChurnStats>> p;
+  auto sf = p.getSemiFuture();
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this, p = std::move(p), area]() mutable {
+    if (!kvStoreDb_.count(area)) {
+      p.setException(
+          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+    } else {
+      p.setValue(std::make_unique<thrift::KvStoreChurnStats>(
+          kvStoreDb_.at(area).getChurnStats()));
+    }
+  });
+  return sf;
+}
+
 folly::SemiFuture<folly::Unit>
 KvStore::updateFloodTopologyChild(
     thrift::FloodTopoSetParams floodTopoSetParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        floodTopoSetParams = std::move(floodTopoSetParams),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             floodTopoSetParams = std::move(floodTopoSetParams),
+                             area]() mutable {
     VLOG(2) << "FLOOD_TOPO_SET command requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -785,10 +1323,11 @@ KvStore::processKvStoreDualMessage(
     thrift::DualMessages dualMessages, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        dualMessages = std::move(dualMessages),
-                        area]() mutable {
+  auto* evb = getAreaEventBase(area);
+  evb->runInEventBaseThread([this,
+                             p = std::move(p),
+                             dualMessages = std::move(dualMessages),
+                             area]() mutable {
     VLOG(2) << "DUAL messages received for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -798,7 +1337,8 @@ KvStore::processKvStoreDualMessage(
       LOG(ERROR) << "Empty DUAL msg receved";
       p.setValue();
     } else {
-      tData_.addStatValue("kvstore.received_dual_messages", 1, fbzmq::COUNT);
+      tData_.wlock()->addStatValue(
+          "kvstore.received_dual_messages", 1, fbzmq::COUNT);
 
       auto& kvStoreDb = kvStoreDb_.at(area);
       kvStoreDb.processDualMessages(std::move(dualMessages));
@@ -808,13 +1348,20 @@ KvStore::processKvStoreDualMessage(
   return sf;
 }
 
+void
+KvStore::onMemoryPressure() {
+  LOG(WARNING) << "Shedding KvStore memory under memory pressure";
+  runInAreasAndWait(
+      [](std::string const&, KvStoreDb& kvStoreDb) { kvStoreDb.shedMemory(); });
+}
+
 fbzmq::thrift::CounterMap
 KvStore::getCounters() {
   // Extract/build counters from thread-data
-  auto allCounters = tData_.getCounters();
+  auto allCounters = tData_.wlock()->getCounters();
 
-  for (auto& kvDb : kvStoreDb_) {
-    auto kvDbCounters = kvDb.second.getCounters();
+  runInAreasAndWait([&allCounters](std::string const&, KvStoreDb& kvStoreDb) {
+    auto kvDbCounters = kvStoreDb.getCounters();
     // add up counters for same key from all kvStoreDb instances
     allCounters = std::accumulate(
         kvDbCounters.begin(),
@@ -825,6 +1372,11 @@ KvStore::getCounters() {
           allCounters[kvDbcounter.first] += kvDbcounter.second;
           return allCounters;
         });
+  });
+  // latency percentiles don't add up, they are tracked across areas
+  std::lock_guard<std::mutex> lock(kvParams_.sharedMutex);
+  for (auto const& kv : kvParams_.latencies.getCounters()) {
+    allCounters[kv.first] = kv.second;
   }
   return prepareSubmitCounters(allCounters);
 }
@@ -835,36 +1387,207 @@ KvStore::submitCounters() {
   zmqMonitorClient_->setCounters(getCounters());
 }
 
-KvStoreDb::KvStoreDb(
-    OpenrEventBase* evb,
-    KvStoreParams& kvParams,
-    const std::string& area,
-    fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> peersyncSock,
-    bool isFloodRoot,
-    const std::string& nodeId,
-    std::unordered_map<std::string, thrift::PeerSpec> peers)
-    : DualNode(nodeId, isFloodRoot),
-      kvParams_(kvParams),
-      area_(area),
-      peerSyncSock_(std::move(peersyncSock)),
-      evb_(evb) {
-  if (kvParams_.floodRate.has_value()) {
-    floodLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
-        kvParams_.floodRate.value().first, // messages per sec
-        kvParams_.floodRate.value().second); // burst size
-    pendingPublicationTimer_ =
-        fbzmq::ZmqTimeout::make(evb_->getEvb(), [this]() noexcept {
-          if (!floodLimiter_->consume(1)) {
-            pendingPublicationTimer_->scheduleTimeout(
-                Constants::kFloodPendingPublication, false);
-            return;
-          }
-          floodBufferedUpdates();
-        });
+void
+KvStore::saveSnapshotAsync() noexcept {
+  if (snapshotInProgress_.load()) {
+    LOG(WARNING) << "Previous KvStore snapshot is still being written, "
+                 << "skipping this one";
+    tData_.wlock()->addStatValue("kvstore.snapshot.skipped", 1, fbzmq::COUNT);
+    return;
   }
 
-  LOG(INFO) << "Starting kvstore DB instance for node " << nodeId << " area "
-            << area;
+  // only the dump runs on the event loop, serializing and writing it may
+  // take long for large stores
+  const auto startTime = std::chrono::steady_clock::now();
+  snapshotInProgress_ = true;
+  snapshotExecutor_->add(
+      [this, snapshot = takeSnapshot(), startTime]() noexcept {
+        writeSnapshot(snapshot, startTime);
+        snapshotInProgress_ = false;
+      });
+}
+
+thrift::KvStoreSnapshot
+KvStore::takeSnapshot() {
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.timestampMs = getUnixTimeStampMs();
+  runInAreasAndWait([&](std::string const& area, KvStoreDb& kvStoreDb) {
+    auto thriftPub = kvStoreDb.dumpAllWithFilters(KvStoreFilters({}, {}));
+    kvStoreDb.updatePublicationTtl(thriftPub);
+    snapshot.areaKeyVals.emplace(area, std::move(thriftPub.keyVals));
+  });
+  return snapshot;
+}
+
+bool
+KvStore::writeSnapshot(
+    thrift::KvStoreSnapshot const& snapshot,
+    std::chrono::steady_clock::time_point startTime) noexcept {
+  size_t numKeys = 0;
+  for (auto const& kv : snapshot.areaKeyVals) {
+    numKeys += kv.second.size();
+  }
+
+  try {
+    std::string fileData;
+    serializer_.serialize(snapshot, &fileData);
+    folly::writeFileAtomic(snapshotFilePath_, fileData, 0666);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to write KvStore snapshot to '" << snapshotFilePath_
+               << "'. Error: " << folly::exceptionStr(e);
+    tData_.wlock()->addStatValue("kvstore.snapshot.failures", 1, fbzmq::COUNT);
+    return false;
+  }
+
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  VLOG(1) << "Saved KvStore snapshot of " << numKeys << " keys in "
+          << duration.count() << "ms";
+  auto tData = tData_.wlock();
+  tData->addStatValue("kvstore.snapshot.keys", numKeys, fbzmq::AVG);
+  tData->addStatValue(
+      "kvstore.snapshot.time_ms", duration.count(), fbzmq::AVG);
+  return true;
+}
+
+void
+KvStore::loadSnapshot() noexcept {
+  if (not fileExists(snapshotFilePath_)) {
+    LOG(INFO) << "KvStore snapshot " << snapshotFilePath_ << " doesn't exist. "
+              << "Starting with empty KvStore";
+    return;
+  }
+
+  thrift::KvStoreSnapshot snapshot;
+  try {
+    std::string fileData;
+    if (not folly::readFile(snapshotFilePath_.c_str(), fileData)) {
+      LOG(ERROR) << "Failed to read KvStore snapshot from '"
+                 << snapshotFilePath_ << "'. Error (" << errno
+                 << "): " << folly::errnoStr(errno);
+      return;
+    }
+    serializer_.deserialize(fileData, snapshot);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to decode KvStore snapshot from '"
+               << snapshotFilePath_ << "'. Error: " << folly::exceptionStr(e);
+    return;
+  }
+
+  // wall clock time is all that survives restarts
+  const auto age = std::max<int64_t>(
+      0, getUnixTimeStampMs() - snapshot.timestampMs);
+  for (auto& kv : snapshot.areaKeyVals) {
+    auto kvStoreDbIt = kvStoreDb_.find(kv.first);
+    if (kvStoreDbIt == kvStoreDb_.end()) {
+      LOG(INFO) << "Skipping KvStore snapshot of unknown area " << kv.first;
+      continue;
+    }
+
+    thrift::Publication thriftPub;
+    thriftPub.area = kv.first;
+    for (auto& keyVal : kv.second) {
+      auto& value = keyVal.second;
+      // keys of this node are advertised again by their owners, restoring
+      // them would bring back keys withdrawn meanwhile
+      if (value.originatorId == kvParams_.nodeId) {
+        continue;
+      }
+      if (value.ttl != Constants::kTtlInfinity) {
+        value.ttl -= age;
+        if (value.ttl <= 0) {
+          continue;
+        }
+      }
+      thriftPub.keyVals.emplace(keyVal.first, std::move(value));
+    }
+
+    const auto numKeys = thriftPub.keyVals.size();
+    kvStoreDbIt->second.mergePublication(thriftPub);
+    LOG(INFO) << "Restored " << numKeys << " keys of area " << kv.first
+              << " from KvStore snapshot taken " << age << "ms ago";
+    tData_.wlock()->addStatValue(
+        "kvstore.snapshot.restored_keys", numKeys, fbzmq::SUM);
+  }
+}
+
+KvStoreDb::KvStoreDb(
+    OpenrEventBase* evb,
+    KvStoreParams& kvParams,
+    const std::string& area,
+    fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> peersyncSock,
+    bool isFloodRoot,
+    const std::string& nodeId,
+    std::unordered_map<std::string, thrift::PeerSpec> peers)
+    : DualNode(nodeId, isFloodRoot),
+      kvParams_(kvParams),
+      area_(area),
+      peerSyncSock_(std::move(peersyncSock)),
+      epoch_(static_cast<int64_t>(folly::Random::rand64())),
+      evb_(evb) {
+  // Register stats of the flooding and merging of publications
+  duplicatePublicationsStat_ =
+      stats_.addStat("kvstore.duplicate_publications", {fbzmq::COUNT});
+  floodBytesSentStat_ =
+      stats_.addStat("kvstore.flood.bytes_sent", {fbzmq::SUM});
+  floodBytesSerializedStat_ =
+      stats_.addStat("kvstore.flood.bytes_serialized", {fbzmq::SUM});
+  floodCompactTtlUpdatesStat_ =
+      stats_.addStat("kvstore.flood.compact_ttl_updates", {fbzmq::COUNT});
+  loopedPublicationsStat_ =
+      stats_.addStat("kvstore.looped_publications", {fbzmq::COUNT});
+  receivedKeyValsStat_ =
+      stats_.addStat("kvstore.received_key_vals", {fbzmq::SUM});
+  receivedPublicationsStat_ =
+      stats_.addStat("kvstore.received_publications", {fbzmq::COUNT});
+  receivedRedundantPublicationsStat_ =
+      stats_.addStat("kvstore.received_redundant_publications", {fbzmq::COUNT});
+  sentKeyValsStat_ = stats_.addStat("kvstore.sent_key_vals", {fbzmq::SUM});
+  sentPublicationsStat_ =
+      stats_.addStat("kvstore.sent_publications", {fbzmq::COUNT});
+  updatedKeyValsStat_ =
+      stats_.addStat("kvstore.updated_key_vals", {fbzmq::SUM});
+
+  if (folly::io::hasCodec(folly::io::CodecType::ZSTD)) {
+    codec_ = folly::io::getCodec(folly::io::CodecType::ZSTD);
+  }
+  if (kvParams_.floodRate.has_value()) {
+    // classes of the configured key prefixes, followed by the one of all
+    // other keys
+    std::vector<std::string> keyPrefixes = kvParams_.floodPriorityKeyPrefixes;
+    keyPrefixes.emplace_back("");
+    for (auto& keyPrefix : keyPrefixes) {
+      FloodClass floodClass;
+      floodClass.keyPrefix = std::move(keyPrefix);
+      floodClass.limiter = std::make_unique<folly::BasicTokenBucket<>>(
+          kvParams_.floodRate.value().first, // messages per sec
+          kvParams_.floodRate.value().second); // burst size
+      floodClasses_.emplace_back(std::move(floodClass));
+    }
+    floodRate_ = std::make_pair(
+        kvParams_.floodRate.value().first, kvParams_.floodRate.value().second);
+    pendingPublicationTimer_ =
+        fbzmq::ZmqTimeout::make(evb_->getEvb(), [this]() noexcept {
+          if (floodBufferedUpdates()) {
+            pendingPublicationTimer_->scheduleTimeout(
+                Constants::kFloodPendingPublication, false);
+          }
+        });
+  }
+
+  if (not kvParams_.exportPathPrefix.empty()) {
+    const auto exportPath =
+        folly::sformat("{}.{}", kvParams_.exportPathPrefix, area);
+    try {
+      exporter_ = std::make_unique<KvStoreExporter>(exportPath);
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Failed to mirror KvStore area " << area << " to "
+                 << exportPath << ": " << folly::exceptionStr(e);
+    }
+  }
+
+  LOG(INFO) << "Starting kvstore DB instance for node " << nodeId << " area "
+            << area;
 
   // Attach socket callbacks/schedule events
   attachCallbacks();
@@ -888,10 +1611,11 @@ KvStoreDb::KvStoreDb(
   tData_.addStatExportType("kvstore.cmd_peer_add", fbzmq::COUNT);
   tData_.addStatExportType("kvstore.cmd_peer_dump", fbzmq::COUNT);
   tData_.addStatExportType("kvstore.cmd_per_del", fbzmq::COUNT);
+  tData_.addStatExportType("kvstore.dump_cache.hits", fbzmq::COUNT);
+  tData_.addStatExportType("kvstore.dump_cache.misses", fbzmq::COUNT);
   tData_.addStatExportType("kvstore.expired_key_vals", fbzmq::SUM);
   tData_.addStatExportType("kvstore.flood_duration_ms", fbzmq::AVG);
   tData_.addStatExportType("kvstore.full_sync_duration_ms", fbzmq::AVG);
-  tData_.addStatExportType("kvstore.looped_publications", fbzmq::COUNT);
   tData_.addStatExportType("kvstore.peers.bytes_received", fbzmq::SUM);
   tData_.addStatExportType("kvstore.peers.bytes_received", fbzmq::SUM);
   tData_.addStatExportType("kvstore.peers.bytes_sent", fbzmq::SUM);
@@ -899,13 +1623,6 @@ KvStoreDb::KvStoreDb(
   tData_.addStatExportType("kvstore.rate_limit_keys", fbzmq::AVG);
   tData_.addStatExportType("kvstore.rate_limit_suppress", fbzmq::COUNT);
   tData_.addStatExportType("kvstore.received_dual_messages", fbzmq::COUNT);
-  tData_.addStatExportType("kvstore.received_key_vals", fbzmq::SUM);
-  tData_.addStatExportType("kvstore.received_publications", fbzmq::COUNT);
-  tData_.addStatExportType(
-      "kvstore.received_redundant_publications", fbzmq::COUNT);
-  tData_.addStatExportType("kvstore.sent_key_vals", fbzmq::SUM);
-  tData_.addStatExportType("kvstore.sent_publications", fbzmq::COUNT);
-  tData_.addStatExportType("kvstore.updated_key_vals", fbzmq::SUM);
 }
 
 void
@@ -923,17 +1640,29 @@ KvStoreDb::updateTtlCountdownQueue(const thrift::Publication& publication) {
       queueEntry.ttlVersion = value.ttlVersion;
       queueEntry.originatorId = value.originatorId;
 
-      if ((ttlCountdownQueue_.empty() or
-           (queueEntry.expiryTime <= ttlCountdownQueue_.top().expiryTime)) and
-          ttlCountdownTimer_) {
-        // Reschedule the shorter timeout
-        ttlCountdownTimer_->scheduleTimeout(
-            std::chrono::milliseconds(value.ttl));
-      }
-
-      ttlCountdownQueue_.push(std::move(queueEntry));
+      // replaces the countdown of the previous value of key
+      ttlCountdownQueue_.schedule(std::move(queueEntry));
+    } else {
+      ttlCountdownQueue_.cancel(key);
     }
   }
+  scheduleTtlCountdownTimer();
+}
+
+void
+KvStoreDb::scheduleTtlCountdownTimer() {
+  if (not ttlCountdownTimer_) {
+    return;
+  }
+  const auto nextExpiryTime = ttlCountdownQueue_.getNextExpiryTime();
+  if (not nextExpiryTime.has_value()) {
+    ttlCountdownTimer_->cancelTimeout();
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  ttlCountdownTimer_->scheduleTimeout(std::max(
+      std::chrono::milliseconds(0),
+      std::chrono::ceil<std::chrono::milliseconds>(*nextExpiryTime - now)));
 }
 
 // build publication out of the requested keys (per request)
@@ -954,6 +1683,171 @@ KvStoreDb::getKeyVals(std::vector<std::string> const& keys) {
   return thriftPub;
 }
 
+void
+KvStoreDb::forEachKeyVal(
+    KvStoreFilters const& kvFilters,
+    std::function<void(std::string const&, thrift::Value const&)> const& fn)
+    const {
+  const auto keyPrefixes = kvFilters.getKeyPrefixes();
+  const auto originatorIds = kvFilters.getOrigniatorIdList();
+  if ((keyPrefixes.empty() and originatorIds.empty()) or
+      not kvFilters.hasLiteralKeyPrefixes()) {
+    for (auto const& kv : kvStore_) {
+      if (kvFilters.keyMatch(kv.first, kv.second)) {
+        fn(kv.first, kv.second);
+      }
+    }
+    return;
+  }
+
+  auto const startsWith = [](std::string_view key, std::string_view prefix) {
+    return key.substr(0, prefix.size()) == prefix;
+  };
+
+  // Keys matching key prefixes. Prefixes extending a shorter one are skipped,
+  // once sorted they follow it, so that every key is visited once
+  std::vector<std::string_view> sortedPrefixes(
+      keyPrefixes.begin(), keyPrefixes.end());
+  std::sort(sortedPrefixes.begin(), sortedPrefixes.end());
+  std::vector<std::string_view> prefixes;
+  for (auto const& prefix : sortedPrefixes) {
+    if (prefixes.empty() or not startsWith(prefix, prefixes.back())) {
+      prefixes.emplace_back(prefix);
+    }
+  }
+  for (auto const& prefix : prefixes) {
+    for (auto it = keyIndex_.lower_bound(prefix);
+         it != keyIndex_.end() and startsWith(it->first, prefix);
+         ++it) {
+      fn(it->second.kv->first, it->second.kv->second);
+    }
+  }
+
+  // Keys of the originators, not visited yet through the prefixes
+  for (auto const& originatorId : originatorIds) {
+    auto it = originatorIndex_.find(originatorId);
+    if (it == originatorIndex_.end()) {
+      continue;
+    }
+    for (auto const& kv : it->second) {
+      if (std::none_of(
+              prefixes.begin(),
+              prefixes.end(),
+              [&kv, &startsWith](std::string_view prefix) {
+                return startsWith(kv.first, prefix);
+              })) {
+        fn(kv.second->first, kv.second->second);
+      }
+    }
+  }
+}
+
+void
+KvStoreDb::indexKeyVal(std::pair<const std::string, thrift::Value> const& kv) {
+  if (exporter_) {
+    try {
+      exporter_->set(kv.first, kv.second);
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Disabling KvStore mirror " << exporter_->getPath()
+                 << ": " << folly::exceptionStr(e);
+      exporter_.reset();
+    }
+  }
+
+  auto res = keyIndex_.try_emplace(kv.first);
+  auto& indexed = res.first->second;
+
+  // the key changed, move it to the end of the change sequence
+  if (not res.second) {
+    seqIndex_.erase(indexed.seqNum);
+  }
+  indexed.seqNum = ++seqNum_;
+  seqIndex_.emplace(indexed.seqNum, &kv);
+
+  if (not res.second) {
+    memoryTracker_.remove(kv.first, indexed.originatorId, indexed.bytes);
+  }
+  indexed.bytes = KvStoreMemoryTracker::getBytes(kv.first, kv.second);
+  memoryTracker_.add(kv.first, kv.second.originatorId, indexed.bytes);
+
+  if (not res.second) {
+    if (indexed.originatorId == kv.second.originatorId) {
+      return;
+    }
+    // key moved to another originator
+    auto it = originatorIndex_.find(indexed.originatorId);
+    it->second.erase(kv.first);
+    if (it->second.empty()) {
+      originatorIndex_.erase(it);
+    }
+  }
+  indexed.kv = &kv;
+  indexed.originatorId = kv.second.originatorId;
+  originatorIndex_[indexed.originatorId].emplace(kv.first, &kv);
+}
+
+void
+KvStoreDb::unindexKeyVal(
+    std::pair<const std::string, thrift::Value> const& kv) {
+  if (exporter_) {
+    exporter_->erase(kv.first);
+  }
+
+  auto keyIt = keyIndex_.find(kv.first);
+  if (keyIt == keyIndex_.end()) {
+    return;
+  }
+  auto it = originatorIndex_.find(keyIt->second.originatorId);
+  it->second.erase(kv.first);
+  if (it->second.empty()) {
+    originatorIndex_.erase(it);
+  }
+  memoryTracker_.remove(
+      kv.first, keyIt->second.originatorId, keyIt->second.bytes);
+  seqIndex_.erase(keyIt->second.seqNum);
+  keyIndex_.erase(keyIt);
+  ++numErasedKeys_;
+}
+
+std::unordered_set<std::string>
+KvStoreDb::getOverQuotaKeys(
+    std::unordered_map<std::string, thrift::Value> const& keyVals) const {
+  std::unordered_set<std::string> overQuotaKeys;
+  // usage of originators once the admitted keys so far are merged
+  std::unordered_map<std::string, KvStoreMemoryTracker::Usage> usages;
+  for (auto const& kv : keyVals) {
+    if (not kv.second.value.hasValue()) {
+      // TTL updates don't grow the store
+      continue;
+    }
+    auto const& originatorId = kv.second.originatorId;
+    auto usageIt = usages.find(originatorId);
+    if (usageIt == usages.end()) {
+      usageIt = usages
+                    .emplace(
+                        originatorId,
+                        memoryTracker_.getOriginatorUsage(originatorId))
+                    .first;
+    }
+    auto usage = usageIt->second;
+    usage.numKeys++;
+    usage.numBytes += KvStoreMemoryTracker::getBytes(kv.first, kv.second);
+    auto keyIt = keyIndex_.find(kv.first);
+    if (keyIt != keyIndex_.end() and
+        keyIt->second.originatorId == originatorId) {
+      // replaces a value of the originator
+      usage.numKeys--;
+      usage.numBytes -= keyIt->second.bytes;
+    }
+    if (not memoryTracker_.isWithinQuota(originatorId, usage)) {
+      overQuotaKeys.emplace(kv.first);
+      continue;
+    }
+    usageIt->second = usage;
+  }
+  return overQuotaKeys;
+}
+
 // dump the entries of my KV store whose keys match the given prefix
 // if prefix is the empty string, the full KV store is dumped
 thrift::Publication
@@ -961,33 +1855,176 @@ KvStoreDb::dumpAllWithFilters(KvStoreFilters const& kvFilters) const {
   thrift::Publication thriftPub;
   thriftPub.area = area_;
 
-  for (auto const& kv : kvStore_) {
+  forEachKeyVal(
+      kvFilters,
+      [&thriftPub](std::string const& key, thrift::Value const& val) {
+        thriftPub.keyVals[key] = val;
+      });
+  return thriftPub;
+}
+
+// dump the entries of my KV store whose keys match the given filters and lie
+// in one of the given buckets
+thrift::Publication
+KvStoreDb::dumpAllWithFilters(
+    KvStoreFilters const& kvFilters,
+    int32_t level,
+    std::unordered_set<int64_t> const& buckets) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  if (buckets.empty()) {
+    return thriftPub;
+  }
+
+  forEachKeyVal(
+      kvFilters,
+      [&thriftPub, &buckets, level](
+          std::string const& key, thrift::Value const& val) {
+        if (buckets.count(KvStore::getKeyBucket(key, level))) {
+          thriftPub.keyVals[key] = val;
+        }
+      });
+  return thriftPub;
+}
+
+// dump at most maxKeys entries of my KV store whose keys match the given
+// filters, walking the key index in order from the cursor
+thrift::Publication
+KvStoreDb::dumpPageWithFilters(
+    KvStoreFilters const& kvFilters,
+    std::optional<std::string> const& cursor,
+    size_t maxKeys) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+
+  auto it = cursor.has_value() ? keyIndex_.upper_bound(*cursor)
+                               : keyIndex_.begin();
+  std::string const* lastKey{nullptr};
+  for (; it != keyIndex_.end(); ++it) {
+    auto const& kv = *it->second.kv;
     if (not kvFilters.keyMatch(kv.first, kv.second)) {
       continue;
     }
-    thriftPub.keyVals[kv.first] = kv.second;
+    if (lastKey and thriftPub.keyVals.size() >= maxKeys) {
+      // more keys match, resume after the last key of this page
+      thriftPub.cursor = *lastKey;
+      break;
+    }
+    thriftPub.keyVals.emplace(kv.first, kv.second);
+    lastKey = &kv.first;
   }
   return thriftPub;
 }
 
+// dump the entries of my KV store whose keys match the given filters and
+// changed after seqNum, walking the change sequence
+thrift::Publication
+KvStoreDb::dumpChangesWithFilters(
+    KvStoreFilters const& kvFilters, int64_t seqNum) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  for (auto it = seqIndex_.upper_bound(seqNum); it != seqIndex_.end(); ++it) {
+    auto const& kv = *it->second;
+    if (kvFilters.keyMatch(kv.first, kv.second)) {
+      thriftPub.keyVals.emplace(kv.first, kv.second);
+    }
+  }
+  return thriftPub;
+}
+
+namespace {
+
+// value as dumped in hash dumps, without the value itself
+thrift::Value
+getHashOnlyValue(thrift::Value const& val) {
+  DCHECK(val.hash.hasValue());
+  thrift::Value value;
+  value.version = val.version;
+  value.originatorId = val.originatorId;
+  value.hash = val.hash;
+  value.ttl = val.ttl;
+  value.ttlVersion = val.ttlVersion;
+  return value;
+}
+
+} // namespace
+
 // dump the hashes of my KV store whose keys match the given prefix
 // if prefix is the empty string, the full hash store is dumped
 thrift::Publication
 KvStoreDb::dumpHashWithFilters(KvStoreFilters const& kvFilters) const {
   thrift::Publication thriftPub;
   thriftPub.area = area_;
-  for (auto const& kv : kvStore_) {
+  forEachKeyVal(
+      kvFilters,
+      [&thriftPub](std::string const& key, thrift::Value const& val) {
+        thriftPub.keyVals[key] = getHashOnlyValue(val);
+      });
+  return thriftPub;
+}
+
+// dump the hashes of my KV store whose keys match the given filters and lie
+// in one of the given buckets
+thrift::Publication
+KvStoreDb::dumpHashWithFilters(
+    KvStoreFilters const& kvFilters,
+    int32_t level,
+    std::unordered_set<int64_t> const& buckets) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  if (buckets.empty()) {
+    return thriftPub;
+  }
+  forEachKeyVal(
+      kvFilters,
+      [&thriftPub, &buckets, level](
+          std::string const& key, thrift::Value const& val) {
+        if (not buckets.count(KvStore::getKeyBucket(key, level))) {
+          return;
+        }
+        thriftPub.keyVals[key] = getHashOnlyValue(val);
+      });
+  return thriftPub;
+}
+
+thrift::Publication
+KvStoreDb::dumpWithFiltersCached(
+    KvStoreFilters const& kvFilters, bool hashesOnly) {
+  const auto cacheKey =
+      folly::sformat("{}{}", hashesOnly ? "hash" : "keys", kvFilters.str());
+  auto it = dumpCache_.find(cacheKey);
+  // patching a dump walks the keys changed since, bounded by the sequence
+  // numbers spent meanwhile. Past the store size a new dump is cheaper
+  if (it == dumpCache_.end() or
+      it->second.numErasedKeys != numErasedKeys_ or
+      seqNum_ - it->second.seqNum > static_cast<int64_t>(kvStore_.size())) {
+    tData_.addStatValue("kvstore.dump_cache.misses", 1, fbzmq::COUNT);
+    auto thriftPub = hashesOnly ? dumpHashWithFilters(kvFilters)
+                                : dumpAllWithFilters(kvFilters);
+    dumpCache_.set(
+        cacheKey, CachedDump{thriftPub.keyVals, seqNum_, numErasedKeys_});
+    return thriftPub;
+  }
+
+  tData_.addStatValue("kvstore.dump_cache.hits", 1, fbzmq::COUNT);
+  auto& cachedDump = it->second;
+  for (auto seqIt = seqIndex_.upper_bound(cachedDump.seqNum);
+       seqIt != seqIndex_.end();
+       ++seqIt) {
+    auto const& kv = *seqIt->second;
     if (not kvFilters.keyMatch(kv.first, kv.second)) {
+      // e.g. the key moved to an originator filtered out
+      cachedDump.keyVals.erase(kv.first);
       continue;
     }
-    DCHECK(kv.second.hash.hasValue());
-    auto& value = thriftPub.keyVals[kv.first];
-    value.version = kv.second.version;
-    value.originatorId = kv.second.originatorId;
-    value.hash = kv.second.hash;
-    value.ttl = kv.second.ttl;
-    value.ttlVersion = kv.second.ttlVersion;
+    cachedDump.keyVals[kv.first] =
+        hashesOnly ? getHashOnlyValue(kv.second) : kv.second;
   }
+  cachedDump.seqNum = seqNum_;
+
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  thriftPub.keyVals = cachedDump.keyVals;
   return thriftPub;
 }
 
@@ -1042,6 +2079,65 @@ KvStoreDb::dumpDifference(
   return thriftPub;
 }
 
+std::map<int64_t, int64_t>
+KvStoreDb::getBucketDigests(
+    KvStoreFilters const& kvFilters,
+    int32_t level,
+    std::unordered_set<int64_t> const* parentBuckets) const {
+  std::map<int64_t, int64_t> digests;
+  forEachKeyVal(
+      kvFilters,
+      [&digests, parentBuckets, level](
+          std::string const& key, thrift::Value const& val) {
+        const auto bucket = KvStore::getKeyBucket(key, level);
+        if (parentBuckets and
+            not parentBuckets->count(
+                bucket >> Constants::kKvStoreSyncBucketBits)) {
+          return;
+        }
+        // unsigned addition, digests are allowed to wrap around
+        auto& digest = digests[bucket];
+        digest = static_cast<int64_t>(
+            static_cast<uint64_t>(digest) +
+            static_cast<uint64_t>(KvStore::getKeyValDigest(key, val)));
+      });
+  return digests;
+}
+
+folly::Expected<thrift::Publication, fbzmq::Error>
+KvStoreDb::dumpBucketDigests(
+    KvStoreFilters const& kvFilters,
+    thrift::KeyBucketDigests const& reqDigests) const {
+  const auto level = reqDigests.level;
+  if (level < 1 or (level + 1) * Constants::kKvStoreSyncBucketBits > 64) {
+    LOG(ERROR) << "received bucket digests of invalid level " << level;
+    return folly::makeUnexpected(fbzmq::Error());
+  }
+
+  folly::Optional<std::unordered_set<int64_t>> parentBuckets;
+  if (reqDigests.parentBuckets.hasValue()) {
+    parentBuckets.emplace(
+        reqDigests.parentBuckets->begin(), reqDigests.parentBuckets->end());
+  }
+  const auto myDigests =
+      getBucketDigests(kvFilters, level, parentBuckets.get_pointer());
+  const auto buckets =
+      KvStore::getDifferingBuckets(myDigests, reqDigests.digests);
+  const std::unordered_set<int64_t> bucketSet(buckets.begin(), buckets.end());
+
+  thrift::KeyBucketDigests digests;
+  digests.level = level + 1;
+  if (not bucketSet.empty()) {
+    digests.digests = getBucketDigests(kvFilters, level + 1, &bucketSet);
+  }
+  digests.parentBuckets = buckets;
+
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  thriftPub.keyBucketDigests = std::move(digests);
+  return thriftPub;
+}
+
 // add new peers to subscribe to
 void
 KvStoreDb::addPeers(
@@ -1074,16 +2170,20 @@ KvStoreDb::addPeers(
 
         const auto& peerSpec = it->second.first;
 
-        if (peerSpec.cmdUrl != newPeerSpec.cmdUrl) {
+        if (peerSpec.cmdUrl != newPeerSpec.cmdUrl or
+            peerSpec.peerAddr != newPeerSpec.peerAddr or
+            peerSpec.ctrlPort != newPeerSpec.ctrlPort) {
           // case1: peer-spec updated (e.g parallel cases)
           cmdUrlUpdated = true;
-          LOG(INFO) << "Disconnecting from " << peerSpec.cmdUrl << " with id "
-                    << it->second.second;
-          const auto ret =
-              peerSyncSock_.disconnect(fbzmq::SocketUrl{peerSpec.cmdUrl});
-          if (ret.hasError()) {
-            LOG(FATAL) << "Error Disconnecting to URL '" << peerSpec.cmdUrl
-                       << "' " << ret.error();
+          if (thriftPeers_.erase(it->second.second) == 0) {
+            LOG(INFO) << "Disconnecting from " << peerSpec.cmdUrl
+                      << " with id " << it->second.second;
+            const auto ret =
+                peerSyncSock_.disconnect(fbzmq::SocketUrl{peerSpec.cmdUrl});
+            if (ret.hasError()) {
+              LOG(FATAL) << "Error Disconnecting to URL '" << peerSpec.cmdUrl
+                         << "' " << ret.error();
+            }
           }
           it->second.second = newPeerCmdId;
         } else {
@@ -1091,6 +2191,11 @@ KvStoreDb::addPeers(
           LOG(WARNING) << "new peer " << peerName << ", previously "
                        << "shutdown non-gracefully";
           isNewPeer = true;
+          auto thriftPeerIt = thriftPeers_.find(it->second.second);
+          if (thriftPeerIt != thriftPeers_.end()) {
+            // reconnect to the restarted peer
+            thriftPeerIt->second.client.reset();
+          }
         }
         // Update entry with new data
         it->second.first = newPeerSpec;
@@ -1105,7 +2210,14 @@ KvStoreDb::addPeers(
             peers_.emplace(peerName, std::make_pair(newPeerSpec, newPeerCmdId));
       }
 
-      if (cmdUrlUpdated) {
+      if (cmdUrlUpdated and useThriftPeer(newPeerSpec)) {
+        // connected to on first request
+        CHECK(newPeerCmdId == it->second.second);
+        LOG(INFO) << "Using thrift sync channel to " << newPeerSpec.peerAddr
+                  << ":" << newPeerSpec.ctrlPort << " with id "
+                  << newPeerCmdId;
+        thriftPeers_[newPeerCmdId] = ThriftPeer{peerName, newPeerSpec};
+      } else if (cmdUrlUpdated) {
         CHECK(newPeerCmdId == it->second.second);
         LOG(INFO) << "Connecting sync channel to " << newPeerSpec.cmdUrl
                   << " with id " << newPeerCmdId;
@@ -1131,8 +2243,20 @@ KvStoreDb::addPeers(
         }
       }
 
-      // Enqueue for full-sync requests
+      // Enqueue for full-sync requests, which supersede pending floods. The
+      // full-sync response tells whether the peer accepts compression
       LOG(INFO) << "Enqueuing full-sync request for peer " << peerName;
+      peerFloodQueues_.erase(peerName);
+      compressionPeers_.erase(it->second.second);
+      bucketSyncPeers_.erase(it->second.second);
+      ttlUpdatePeers_.erase(it->second.second);
+      lazyValuePeers_.erase(it->second.second);
+      keyIdPeers_.erase(it->second.second);
+      keyIdEncoder_.resetPeer(peerName);
+      if (syncWatermarks_.count(peerName)) {
+        // we synced with the peer before, only exchange what changed since
+        deltaSyncPeers_.emplace(peerName);
+      }
       peersToSyncWith_.emplace(
           peerName,
           ExponentialBackoff<std::chrono::milliseconds>(
@@ -1159,21 +2283,326 @@ KvStoreDb::addPeers(
 folly::Expected<size_t, fbzmq::Error>
 KvStoreDb::sendMessageToPeer(
     const std::string& peerSocketId, const thrift::KvStoreRequest& request) {
-  auto msg = fbzmq::Message::fromThriftObj(request, serializer_).value();
+  if (thriftPeers_.count(peerSocketId)) {
+    return sendThriftRequestToPeer(peerSocketId, request);
+  }
+  auto const msg =
+      serializeRequest(request, compressionPeers_.count(peerSocketId) > 0);
+  return sendMessageToPeer(peerSocketId, msg);
+}
+
+folly::Expected<size_t, fbzmq::Error>
+KvStoreDb::sendMessageToPeer(
+    const std::string& peerSocketId, const fbzmq::Message& msg) {
   tData_.addStatValue("kvstore.peers.bytes_sent", msg.size(), fbzmq::SUM);
   return peerSyncSock_.sendMultiple(
       fbzmq::Message::from(peerSocketId).value(), fbzmq::Message(), msg);
 }
 
+bool
+KvStoreDb::useThriftPeer(thrift::PeerSpec const& peerSpec) const {
+  return kvParams_.enableThriftPeers and peerSpec.ctrlPort > 0 and
+      not peerSpec.peerAddr.empty();
+}
+
+folly::Expected<size_t, fbzmq::Error>
+KvStoreDb::sendThriftRequestToPeer(
+    const std::string& peerSocketId, const thrift::KvStoreRequest& request) {
+  auto& thriftPeer = thriftPeers_.at(peerSocketId);
+  if (not thriftPeer.client) {
+    try {
+      thriftPeer.client = getOpenrCtrlPlainTextClient(
+          *evb_->getEvb(),
+          folly::IPAddress(thriftPeer.peerSpec.peerAddr),
+          thriftPeer.peerSpec.ctrlPort,
+          Constants::kServiceConnTimeout,
+          Constants::kServiceProcTimeout,
+          folly::AsyncSocket::anyAddress(),
+          kvParams_.maybeIpTos);
+    } catch (std::exception const& e) {
+      tData_.addStatValue(
+          "kvstore.thrift_peers.connection_failures", 1, fbzmq::COUNT);
+      return folly::makeUnexpected(fbzmq::Error(
+          0,
+          folly::sformat(
+              "Failed to connect to {}: {}",
+              thriftPeer.peerSpec.peerAddr,
+              folly::exceptionStr(e))));
+    }
+  }
+
+  // callbacks run on our event base, the peer may be gone by then
+  const auto cmd = request.cmd;
+  auto onError = [this,
+                  guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_),
+                  peerSocketId,
+                  cmd](folly::exception_wrapper const& ew) {
+    if (guard.lock()) {
+      processThriftPeerError(peerSocketId, cmd, ew);
+    }
+  };
+  auto onDone = [onError](folly::Try<folly::Unit>&& t) {
+    if (t.hasException()) {
+      onError(t.exception());
+    }
+  };
+
+  auto* evb = evb_->getEvb();
+  auto& client = *thriftPeer.client;
+  switch (cmd) {
+  case thrift::Command::KEY_SET: {
+    client.semifuture_setKvStoreKeyVals(request.keySetParams.value(), area_)
+        .via(evb)
+        .thenTry(std::move(onDone));
+    break;
+  }
+  case thrift::Command::KEY_DUMP: {
+    client
+        .semifuture_getKvStoreKeyValsFilteredArea(
+            request.keyDumpParams.value(), area_)
+        .via(evb)
+        .thenTry([this,
+                  guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_),
+                  peerSocketId,
+                  onError](folly::Try<thrift::Publication>&& t) {
+          if (t.hasException()) {
+            onError(t.exception());
+            return;
+          }
+          if (not guard.lock()) {
+            return;
+          }
+          auto it = thriftPeers_.find(peerSocketId);
+          if (it != thriftPeers_.end()) {
+            it->second.backoff.reportSuccess();
+            processSyncPublication(peerSocketId, t.value());
+          }
+        });
+    break;
+  }
+  case thrift::Command::DUAL: {
+    client
+        .semifuture_processKvStoreDualMessage(
+            request.dualMessages.value(), area_)
+        .via(evb)
+        .thenTry(std::move(onDone));
+    break;
+  }
+  case thrift::Command::FLOOD_TOPO_SET: {
+    client
+        .semifuture_updateFloodTopologyChild(
+            request.floodTopoSetParams.value(), area_)
+        .via(evb)
+        .thenTry(std::move(onDone));
+    break;
+  }
+  default: {
+    LOG(ERROR) << "Unsupported thrift peer command "
+               << apache::thrift::TEnumTraits<thrift::Command>::findName(cmd);
+    return folly::makeUnexpected(fbzmq::Error(0, "unsupported command"));
+  }
+  }
+  tData_.addStatValue("kvstore.thrift_peers.requests_sent", 1, fbzmq::COUNT);
+  return 0;
+}
+
+void
+KvStoreDb::processThriftPeerError(
+    const std::string& peerSocketId,
+    thrift::Command cmd,
+    folly::exception_wrapper const& ew) {
+  auto it = thriftPeers_.find(peerSocketId);
+  if (it == thriftPeers_.end()) {
+    // peer has been removed or updated meanwhile
+    return;
+  }
+  auto& thriftPeer = it->second;
+  LOG(ERROR) << "Thrift request "
+             << apache::thrift::TEnumTraits<thrift::Command>::findName(cmd)
+             << " to peer " << thriftPeer.peerName << " failed: "
+             << ew.what();
+  tData_.addStatValue(
+      "kvstore.thrift_peers.request_failures", 1, fbzmq::COUNT);
+
+  // reconnect with the next request
+  thriftPeer.client.reset();
+
+  // floods and full-sync exchanges may have been lost, full-sync again. The
+  // peer is skipped by floods until then
+  latestSentPeerSync_.erase(peerSocketId);
+  pendingBucketSyncs_.erase(peerSocketId);
+  pendingSyncs_.erase(peerSocketId);
+  deltaSyncPeers_.erase(thriftPeer.peerName);
+  thriftPeer.backoff.reportError();
+  peersToSyncWith_.insert_or_assign(thriftPeer.peerName, thriftPeer.backoff);
+  if (not fullSyncTimer_->isScheduled()) {
+    fullSyncTimer_->scheduleTimeout(
+        thriftPeer.backoff.getTimeRemainingUntilRetry());
+  }
+}
+
+folly::Optional<std::string>
+KvStoreDb::compressPayload(std::string const& payload) {
+  if (not codec_ or payload.size() < Constants::kKvStoreCompressionMinBytes) {
+    return folly::none;
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+  std::string compressed;
+  try {
+    compressed = codec_->compress(payload);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to compress payload: " << folly::exceptionStr(e);
+    return folly::none;
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  tData_.addStatValue(
+      "kvstore.compression.time_us", duration.count(), fbzmq::SUM);
+  tData_.addStatValue(
+      "kvstore.compression.bytes_in", payload.size(), fbzmq::SUM);
+  tData_.addStatValue(
+      "kvstore.compression.bytes_out", compressed.size(), fbzmq::SUM);
+  tData_.addStatValue(
+      "kvstore.compression.ratio_pct",
+      payload.size() * 100 / std::max<size_t>(compressed.size(), 1),
+      fbzmq::AVG);
+  if (compressed.size() >= payload.size()) {
+    // not worth it
+    return folly::none;
+  }
+  return compressed;
+}
+
+folly::Optional<std::string>
+KvStoreDb::decompressPayload(std::string const& payload) {
+  if (not codec_) {
+    LOG(ERROR) << "Received compressed payload without zstd support";
+    return folly::none;
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+  std::string decompressed;
+  try {
+    decompressed = codec_->uncompress(payload);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to decompress payload: " << folly::exceptionStr(e);
+    return folly::none;
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  tData_.addStatValue(
+      "kvstore.decompression.time_us", duration.count(), fbzmq::SUM);
+  tData_.addStatValue(
+      "kvstore.decompression.bytes_out", decompressed.size(), fbzmq::SUM);
+  return decompressed;
+}
+
+fbzmq::Message
+KvStoreDb::serializeRequest(
+    thrift::KvStoreRequest const& request, bool compress) {
+  auto serialized =
+      apache::thrift::CompactSerializer::serialize<std::string>(request);
+  if (compress) {
+    auto compressed = compressPayload(serialized);
+    if (compressed.hasValue()) {
+      thrift::KvStoreRequest wrapper;
+      wrapper.cmd = request.cmd;
+      wrapper.area = request.area;
+      wrapper.compressedRequest = std::move(compressed.value());
+      return fbzmq::Message::fromThriftObj(wrapper, serializer_).value();
+    }
+  }
+  return fbzmq::Message::from(std::move(serialized)).value();
+}
+
+folly::Expected<fbzmq::Message, fbzmq::Error>
+KvStoreDb::serializeResponse(
+    thrift::Publication& publication, bool acceptCompressed) {
+  if (not acceptCompressed or not codec_) {
+    return fbzmq::Message::fromThriftObj(publication, serializer_);
+  }
+  // let the requester know it can compress its requests too
+  publication.acceptCompressed = true;
+  auto serialized =
+      apache::thrift::CompactSerializer::serialize<std::string>(publication);
+  auto compressed = compressPayload(serialized);
+  if (not compressed.hasValue()) {
+    return fbzmq::Message::from(std::move(serialized));
+  }
+  thrift::Publication wrapper;
+  wrapper.area = publication.area;
+  wrapper.compressedPublication = std::move(compressed.value());
+  return fbzmq::Message::fromThriftObj(wrapper, serializer_);
+}
+
+bool
+KvStoreDb::decompressRequest(thrift::KvStoreRequest& request) {
+  if (not request.compressedRequest.hasValue()) {
+    return true;
+  }
+  auto payload = decompressPayload(request.compressedRequest.value());
+  if (not payload.hasValue()) {
+    return false;
+  }
+  try {
+    request = apache::thrift::CompactSerializer::deserialize<
+        thrift::KvStoreRequest>(payload.value());
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to deserialize compressed request: "
+               << folly::exceptionStr(e);
+    return false;
+  }
+  // requests are compressed once
+  return not request.compressedRequest.hasValue();
+}
+
+void
+KvStoreDb::shedMemory() {
+  // watermarks of removed peers only save a full-sync if they come back
+  for (auto it = syncWatermarks_.begin(); it != syncWatermarks_.end();) {
+    if (peers_.count(it->first)) {
+      ++it;
+    } else {
+      it = syncWatermarks_.erase(it);
+    }
+  }
+  // entries of unordered maps don't move on rehash, indexes stay valid
+  kvStore_.rehash(0);
+  originatorIndex_.rehash(0);
+  dumpCache_.clear();
+  tData_.addStatValue("kvstore.memory_sheds", 1, fbzmq::COUNT);
+}
+
 std::unordered_map<std::string, int64_t>
 KvStoreDb::getCounters() {
   // Extract/build counters from thread-data
   auto counters = tData_.getCounters();
+  for (auto const& kv : stats_.getCounters()) {
+    counters[kv.first] = kv.second;
+  }
 
   // Add some more flat counters
   counters["kvstore.num_keys"] = kvStore_.size();
+  if (exporter_) {
+    counters["kvstore.export.num_keys"] = exporter_->getNumKeys();
+    counters["kvstore.export.num_rebuilds"] = exporter_->getNumRebuilds();
+  }
   counters["kvstore.num_peers"] = peers_.size();
   counters["kvstore.pending_full_sync"] = peersToSyncWith_.size();
+  counters["kvstore.full_sync.max_in_progress"] = fullSycnReqInProgress_;
+  counters["kvstore.full_sync.avg_duration_ms"] = fullSyncDurationMs_;
+  counters["kvstore.flood_queue.num_peers"] = peerFloodQueues_.size();
+  for (auto const& kv : peerFloodQueues_) {
+    counters[folly::sformat("kvstore.flood_queue.{}.depth", kv.first)] =
+        kv.second.numKeys;
+  }
+  for (auto const& kv :
+       churnTracker_.getCounters(Constants::kKvStoreChurnTopK)) {
+    counters[kv.first] = kv.second;
+  }
+  for (auto const& kv :
+       memoryTracker_.getCounters(Constants::kKvStoreChurnTopK)) {
+    counters[kv.first] = kv.second;
+  }
   return counters;
 }
 
@@ -1197,16 +2626,32 @@ KvStoreDb::delPeers(std::vector<std::string> const& peers) {
     LOG(INFO) << "Detaching from: " << peerSpec.cmdUrl
               << ", support-flood-optimization: "
               << peerSpec.supportFloodOptimization;
-    auto syncRes = peerSyncSock_.disconnect(fbzmq::SocketUrl{peerSpec.cmdUrl});
-    if (syncRes.hasError()) {
-      LOG(ERROR) << "Failed to detach. " << syncRes.error();
+    auto const& peerCmdSocketId = it->second.second;
+    if (thriftPeers_.erase(peerCmdSocketId) == 0) {
+      auto syncRes =
+          peerSyncSock_.disconnect(fbzmq::SocketUrl{peerSpec.cmdUrl});
+      if (syncRes.hasError()) {
+        LOG(ERROR) << "Failed to detach. " << syncRes.error();
+      }
     }
 
+    // its range of a partitioned full-sync is pulled from another peer
+    failRangeSync(peerCmdSocketId, false /* resync */);
     peersToSyncWith_.erase(peerName);
-    auto const& peerCmdSocketId = it->second.second;
     if (latestSentPeerSync_.count(peerCmdSocketId)) {
       latestSentPeerSync_.erase(peerCmdSocketId);
     }
+    pendingBucketSyncs_.erase(peerCmdSocketId);
+    pendingSyncs_.erase(peerCmdSocketId);
+    deltaSyncPeers_.erase(peerName);
+    compressionPeers_.erase(peerCmdSocketId);
+    bucketSyncPeers_.erase(peerCmdSocketId);
+    ttlUpdatePeers_.erase(peerCmdSocketId);
+    lazyValuePeers_.erase(peerCmdSocketId);
+    keyIdPeers_.erase(peerCmdSocketId);
+    keyIdEncoder_.resetPeer(peerName);
+    keyIdDecoder_.resetPeer(peerName);
+    peerFloodQueues_.erase(peerName);
     peers_.erase(it);
   }
 
@@ -1225,6 +2670,24 @@ KvStoreDb::requestFullSyncFromPeers() {
   // minimal timeout for next run
   auto timeout = std::chrono::milliseconds(Constants::kMaxBackoff);
 
+  // ranges of partitioned full-syncs not pulled in time are pulled from
+  // other peers
+  if (not rangeSyncs_.empty()) {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::string> expiredRangeSyncs;
+    for (auto const& kv : rangeSyncs_) {
+      auto sentIt = latestSentPeerSync_.find(kv.first);
+      if (sentIt == latestSentPeerSync_.end() or
+          now - sentIt->second >= Constants::kStoreFullSyncResponseTimeout) {
+        expiredRangeSyncs.emplace_back(kv.first);
+      }
+    }
+    for (auto const& peerCmdSocketId : expiredRangeSyncs) {
+      failRangeSync(peerCmdSocketId, true /* resync */);
+    }
+  }
+  requestPartitionedFullSync();
+
   // Make requests
   for (auto it = peersToSyncWith_.begin(); it != peersToSyncWith_.end();) {
     auto& peerName = it->first;
@@ -1243,18 +2706,33 @@ KvStoreDb::requestFullSyncFromPeers() {
 
     // Build request
     thrift::KvStoreRequest dumpRequest;
-    thrift::KeyDumpParams params;
+    thrift::KeyDumpParams params = getFullSyncDumpParams();
 
-    if (kvParams_.filters.has_value()) {
-      std::string keyPrefix =
-          folly::join(",", kvParams_.filters.value().getKeyPrefixes());
-      params.prefix = keyPrefix;
-      params.originatorIds = kvParams_.filters.value().getOrigniatorIdList();
-    }
     std::set<std::string> originator{};
     std::vector<std::string> keyPrefixList{};
     KvStoreFilters kvFilters{keyPrefixList, originator};
-    params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+    // a reconnecting peer only needs to send us what changed since our
+    // last sync with it
+    auto watermarkIt = syncWatermarks_.find(peerName);
+    const bool deltaSync = deltaSyncPeers_.count(peerName) and
+        watermarkIt != syncWatermarks_.end();
+    // peers which didn't tell us yet that they accept bucket digests, e.g.
+    // on the first full-sync, get hashes of all keys
+    const bool bucketSync = not deltaSync and
+        bucketSyncPeers_.count(peerCmdSocketId) and
+        kvStore_.size() >= Constants::kKvStoreBucketSyncMinKeys;
+    if (deltaSync) {
+      params.sinceWatermark = watermarkIt->second.peerWatermark;
+    } else if (bucketSync) {
+      // compare digests of top level buckets first, keys are only exchanged
+      // for buckets on which digests differ
+      thrift::KeyBucketDigests digests;
+      digests.level = 1;
+      digests.digests = getBucketDigests(kvFilters, 1, nullptr);
+      params.keyBucketDigests = std::move(digests);
+    } else {
+      params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+    }
 
     dumpRequest.cmd = thrift::Command::KEY_DUMP;
     dumpRequest.keyDumpParams = params;
@@ -1277,16 +2755,36 @@ KvStoreDb::requestFullSyncFromPeers() {
     } else {
       latestSentPeerSync_.emplace(
           peerCmdSocketId, std::chrono::steady_clock::now());
+      if (bucketSync) {
+        pendingBucketSyncs_.emplace(peerCmdSocketId);
+      } else {
+        pendingBucketSyncs_.erase(peerCmdSocketId);
+      }
+      pendingSyncs_[peerCmdSocketId] =
+          PendingSync{peerName, seqNum_, deltaSync, folly::none};
+      if (deltaSync) {
+        tData_.addStatValue(
+            "kvstore.full_sync.delta_requests", 1, fbzmq::COUNT);
+        deltaSyncPeers_.erase(peerName);
+      }
 
       // Remove the iterator
       it = peersToSyncWith_.erase(it);
     }
 
-    // if pending response is above the limit wait until
-    // kStoreFullSyncResponseTimeout before sending next sync request
+    // if pending response is above the limit wait for twice as long as
+    // full-syncs take on average, or kStoreFullSyncResponseTimeout until
+    // one completes, before sending next sync request
     if (latestSentPeerSync_.size() >= fullSycnReqInProgress_) {
       LOG(INFO) << fullSycnReqInProgress_ << " full-sync in progress";
       timeout = Constants::kStoreFullSyncResponseTimeout;
+      if (fullSyncDurationMs_ > 0) {
+        timeout = std::clamp<std::chrono::milliseconds>(
+            std::chrono::milliseconds(
+                static_cast<int64_t>(2 * fullSyncDurationMs_)),
+            Constants::kStoreFullSyncMinResponseTimeout,
+            Constants::kStoreFullSyncResponseTimeout);
+      }
       break;
     }
   } // for
@@ -1294,7 +2792,11 @@ KvStoreDb::requestFullSyncFromPeers() {
   // schedule fullSyncTimer if there are pending peers to sync with or
   // if maximum allowed pending sync count is reached. Adding a new peer
   // will not initiate full sync request if it's already scheduled
-  if (not peersToSyncWith_.empty() ||
+  if (not rangeSyncs_.empty()) {
+    timeout = std::min<std::chrono::milliseconds>(
+        timeout, Constants::kStoreFullSyncResponseTimeout);
+  }
+  if (not peersToSyncWith_.empty() || not rangeSyncs_.empty() ||
       latestSentPeerSync_.size() >= fullSycnReqInProgress_) {
     LOG_IF(INFO, peersToSyncWith_.size())
         << peersToSyncWith_.size() << " peers still require full-sync.";
@@ -1304,6 +2806,254 @@ KvStoreDb::requestFullSyncFromPeers() {
   }
 }
 
+thrift::KeyDumpParams
+KvStoreDb::getFullSyncDumpParams() const {
+  thrift::KeyDumpParams params;
+  if (kvParams_.filters.has_value()) {
+    std::string keyPrefix =
+        folly::join(",", kvParams_.filters.value().getKeyPrefixes());
+    params.prefix = keyPrefix;
+    params.originatorIds = kvParams_.filters.value().getOrigniatorIdList();
+  }
+  if (codec_) {
+    params.acceptCompressed = true;
+  }
+  params.maxChunkBytes = Constants::kKvStoreSyncChunkBytes;
+  return params;
+}
+
+bool
+KvStoreDb::requestPartitionedFullSync() {
+  // only worth it for bulk syncs, bucket digests keep the others cheap
+  if (not kvParams_.partitionedFullSync or not rangeSyncs_.empty() or
+      not orphanRanges_.empty() or
+      kvStore_.size() >= Constants::kKvStoreBucketSyncMinKeys) {
+    return false;
+  }
+  const size_t numBuckets = size_t{1} << Constants::kKvStoreSyncBucketBits;
+  std::vector<std::string> peers;
+  for (auto const& kv : peersToSyncWith_) {
+    // reconnecting peers delta sync
+    if (kv.second.canTryNow() and not deltaSyncPeers_.count(kv.first) and
+        peers.size() < numBuckets) {
+      peers.emplace_back(kv.first);
+    }
+  }
+  if (peers.size() < 2) {
+    return false;
+  }
+
+  LOG(INFO) << "Partitioned full-sync with " << peers.size() << " peers";
+  tData_.addStatValue(
+      "kvstore.full_sync.partitioned_requests", 1, fbzmq::COUNT);
+  for (size_t i = 0; i < peers.size(); ++i) {
+    SyncRange range;
+    for (size_t bucket = i * numBuckets / peers.size();
+         bucket < (i + 1) * numBuckets / peers.size();
+         ++bucket) {
+      range.buckets.emplace(bucket);
+    }
+    auto& expBackoff = peersToSyncWith_.at(peers[i]);
+    if (sendRangeSync(peers[i], std::move(range))) {
+      peersToSyncWith_.erase(peers[i]);
+      continue;
+    }
+    // full-synced with once it can be tried again
+    expBackoff.reportError();
+    range.failedPeers.emplace(peers[i]);
+    orphanRanges_.emplace_back(std::move(range));
+  }
+  assignOrphanRanges();
+  return true;
+}
+
+bool
+KvStoreDb::sendRangeSync(const std::string& peerName, SyncRange&& range) {
+  auto const& peerCmdSocketId = peers_.at(peerName).second;
+
+  // hashes of our keys of the range
+  std::set<std::string> originator{};
+  std::vector<std::string> keyPrefixList{};
+  KvStoreFilters kvFilters{keyPrefixList, originator};
+  thrift::KvStoreRequest dumpRequest;
+  thrift::KeyDumpParams params = getFullSyncDumpParams();
+  params.keyValHashes =
+      std::move(dumpHashWithFilters(kvFilters, 1, range.buckets).keyVals);
+  params.syncBuckets =
+      std::vector<int64_t>(range.buckets.begin(), range.buckets.end());
+  dumpRequest.cmd = thrift::Command::KEY_DUMP;
+  dumpRequest.keyDumpParams = std::move(params);
+  dumpRequest.area = area_;
+
+  VLOG(1) << "Sending range full-sync request of " << range.buckets.size()
+          << " buckets to peer " << peerName << " using id "
+          << peerCmdSocketId;
+  auto const ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+  if (ret.hasError()) {
+    LOG(ERROR) << "Failed to send range full-sync request to peer "
+               << peerName << " using id " << peerCmdSocketId << ", error: "
+               << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+    return false;
+  }
+  latestSentPeerSync_[peerCmdSocketId] = std::chrono::steady_clock::now();
+  pendingBucketSyncs_.erase(peerCmdSocketId);
+  pendingSyncs_[peerCmdSocketId] =
+      PendingSync{peerName, seqNum_, false, folly::none};
+  rangeSyncs_[peerCmdSocketId] = std::move(range);
+  return true;
+}
+
+void
+KvStoreDb::failRangeSync(const std::string& peerCmdSocketId, bool resync) {
+  auto it = rangeSyncs_.find(peerCmdSocketId);
+  if (it == rangeSyncs_.end()) {
+    return;
+  }
+  auto range = std::move(it->second);
+  rangeSyncs_.erase(it);
+  latestSentPeerSync_.erase(peerCmdSocketId);
+  auto pendingIt = pendingSyncs_.find(peerCmdSocketId);
+  if (pendingIt != pendingSyncs_.end()) {
+    auto const& peerName = pendingIt->second.peerName;
+    LOG(WARNING) << "Range full-sync with peer " << peerName
+                 << " failed, pulling its range from another peer";
+    range.failedPeers.emplace(peerName);
+    if (resync and peers_.count(peerName)) {
+      peersToSyncWith_.emplace(
+          peerName,
+          ExponentialBackoff<std::chrono::milliseconds>(
+              Constants::kInitialBackoff, Constants::kMaxBackoff));
+    }
+    pendingSyncs_.erase(pendingIt);
+  }
+  tData_.addStatValue("kvstore.full_sync.range_failures", 1, fbzmq::COUNT);
+  orphanRanges_.emplace_back(std::move(range));
+  assignOrphanRanges();
+}
+
+void
+KvStoreDb::assignOrphanRanges() {
+  std::vector<SyncRange> orphanRanges;
+  orphanRanges.swap(orphanRanges_);
+  for (auto& range : orphanRanges) {
+    bool sent = false;
+    for (auto const& kv : peers_) {
+      auto const& peerName = kv.first;
+      auto const& peerCmdSocketId = kv.second.second;
+      if (range.failedPeers.count(peerName) or
+          rangeSyncs_.count(peerCmdSocketId) or
+          latestSentPeerSync_.count(peerCmdSocketId) or
+          peersToSyncWith_.count(peerName)) {
+        continue;
+      }
+      if (sendRangeSync(peerName, std::move(range))) {
+        sent = true;
+        break;
+      }
+      range.failedPeers.emplace(peerName);
+    }
+    if (not sent) {
+      // no peer left to pull it from, the peers full-synced with again
+      // cover it
+      LOG(WARNING) << "No peer left to pull range of "
+                   << range.buckets.size() << " buckets from";
+      tData_.addStatValue(
+          "kvstore.full_sync.range_dropped", 1, fbzmq::COUNT);
+    }
+  }
+
+  if (rangeSyncs_.empty() and reconcilePeer_.hasValue()) {
+    // all ranges are pulled, a regular full-sync with one peer catches
+    // keys changed meanwhile, comparing bucket digests if many
+    auto const peerName = std::move(reconcilePeer_.value());
+    reconcilePeer_ = folly::none;
+    if (peers_.count(peerName)) {
+      LOG(INFO) << "Partitioned full-sync done, reconciling with "
+                << peerName;
+      peersToSyncWith_.emplace(
+          peerName,
+          ExponentialBackoff<std::chrono::milliseconds>(
+              Constants::kInitialBackoff, Constants::kMaxBackoff));
+      if (not fullSyncTimer_->isScheduled()) {
+        fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+      }
+    }
+  }
+}
+
+thrift::KvStoreWatermark
+KvStoreDb::getWatermark() const {
+  thrift::KvStoreWatermark watermark;
+  watermark.epoch = epoch_;
+  watermark.seqNum = seqNum_;
+  return watermark;
+}
+
+bool
+KvStoreDb::continueBucketSync(
+    const std::string& peerCmdSocketId,
+    thrift::KeyBucketDigests const& peerDigests) {
+  // peer reports the buckets of the previous level on which digests differ
+  // along with its digests of their children
+  std::unordered_set<int64_t> parentBuckets;
+  if (peerDigests.parentBuckets.hasValue()) {
+    parentBuckets.insert(
+        peerDigests.parentBuckets->begin(), peerDigests.parentBuckets->end());
+  }
+  // like hash dumps, digests cover all our keys
+  std::set<std::string> originator{};
+  std::vector<std::string> keyPrefixList{};
+  KvStoreFilters kvFilters{keyPrefixList, originator};
+  std::vector<int64_t> buckets;
+  if (not parentBuckets.empty()) {
+    buckets = KvStore::getDifferingBuckets(
+        getBucketDigests(kvFilters, peerDigests.level, &parentBuckets),
+        peerDigests.digests);
+  }
+  if (buckets.empty()) {
+    VLOG(1) << "Bucket digests of " << peerCmdSocketId << " match ours";
+    tData_.addStatValue("kvstore.full_sync.buckets_in_sync", 1, fbzmq::COUNT);
+    pendingBucketSyncs_.erase(peerCmdSocketId);
+    return false;
+  }
+
+  thrift::KvStoreRequest dumpRequest;
+  thrift::KeyDumpParams params = getFullSyncDumpParams();
+  const std::unordered_set<int64_t> bucketSet(buckets.begin(), buckets.end());
+  thrift::KeyBucketDigests digests;
+  digests.level = peerDigests.level + 1;
+  digests.parentBuckets = std::move(buckets);
+  if (peerDigests.level >= Constants::kKvStoreSyncLevels) {
+    // last level, exchange the keys of the buckets on which digests differ.
+    // The response is a regular full-sync response
+    params.keyValHashes = std::move(
+        dumpHashWithFilters(kvFilters, peerDigests.level, bucketSet).keyVals);
+    tData_.addStatValue(
+        "kvstore.full_sync.differing_buckets", bucketSet.size(), fbzmq::SUM);
+    pendingBucketSyncs_.erase(peerCmdSocketId);
+  } else {
+    digests.digests =
+        getBucketDigests(kvFilters, peerDigests.level + 1, &bucketSet);
+  }
+  params.keyBucketDigests = std::move(digests);
+
+  dumpRequest.cmd = thrift::Command::KEY_DUMP;
+  dumpRequest.keyDumpParams = std::move(params);
+  dumpRequest.area = area_;
+
+  VLOG(1) << "Sending bucket full-sync request of level "
+          << peerDigests.level + 1 << " to " << peerCmdSocketId;
+  auto const ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+  if (ret.hasError()) {
+    // full-sync stays pending, periodic sync will try again
+    LOG(ERROR) << "Failed to send bucket full-sync request to "
+               << peerCmdSocketId << ", error: " << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+  }
+  return true;
+}
+
 // dump all peers we are subscribed to
 thrift::PeerCmdReply
 KvStoreDb::dumpPeers() {
@@ -1320,38 +3070,147 @@ void
 KvStoreDb::updatePublicationTtl(
     thrift::Publication& thriftPub, bool removeAboutToExpire) {
   auto timeNow = std::chrono::steady_clock::now();
-  for (const auto& qE : ttlCountdownQueue_) {
+  for (auto kv = thriftPub.keyVals.begin(); kv != thriftPub.keyVals.end();) {
     // Find key and ensure we are taking time from right entry from queue
-    auto kv = thriftPub.keyVals.find(qE.key);
-    if (kv == thriftPub.keyVals.end() or kv->second.version != qE.version or
-        kv->second.originatorId != qE.originatorId or
-        kv->second.ttlVersion != qE.ttlVersion) {
+    const auto qE = ttlCountdownQueue_.find(kv->first);
+    if (not qE or kv->second.version != qE->version or
+        kv->second.originatorId != qE->originatorId or
+        kv->second.ttlVersion != qE->ttlVersion) {
+      ++kv;
       continue;
     }
 
     // Compute timeLeft and do sanity check on it
-    auto timeLeft = duration_cast<milliseconds>(qE.expiryTime - timeNow);
-    if (timeLeft <= kvParams_.ttlDecr) {
-      thriftPub.keyVals.erase(kv);
+    auto timeLeft = duration_cast<milliseconds>(qE->expiryTime - timeNow);
+    const std::chrono::milliseconds ttlDecr(kvParams_.ttlDecrMs.get());
+    if (timeLeft <= ttlDecr) {
+      kv = thriftPub.keyVals.erase(kv);
       continue;
     }
 
     // filter key from publication if time left is below ttl threshold
     if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
-      thriftPub.keyVals.erase(kv);
+      kv = thriftPub.keyVals.erase(kv);
       continue;
     }
 
     // Set the time-left and decrement it by one so that ttl decrement
     // deterministically whenever it is exchanged between KvStores. This will
     // avoid looping of updates between stores.
-    kv->second.ttl = timeLeft.count() - kvParams_.ttlDecr.count();
+    kv->second.ttl = timeLeft.count() - ttlDecr.count();
+    ++kv;
   }
 }
 
+// respond to a KEY_DUMP request, possibly a round of a bucket digest
+// full-sync
+folly::Expected<thrift::Publication, fbzmq::Error>
+KvStoreDb::processKeyDump(thrift::KeyDumpParams const& keyDumpParams) {
+  std::vector<std::string> keyPrefixList;
+  folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+  const auto keyPrefixMatch =
+      KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
+  if (keyDumpParams.keyBucketDigests.hasValue() and
+      not keyDumpParams.keyValHashes.hasValue()) {
+    // bucket digest round of a full-sync
+    tData_.addStatValue("kvstore.cmd_key_bucket_dump", 1, fbzmq::COUNT);
+    auto maybeThriftPub = dumpBucketDigests(
+        keyPrefixMatch, keyDumpParams.keyBucketDigests.value());
+    if (maybeThriftPub.hasValue()) {
+      maybeThriftPub->syncWatermark = getWatermark();
+    }
+    return maybeThriftPub;
+  }
+  const bool syncRequest = keyDumpParams.keyValHashes.hasValue() or
+      keyDumpParams.keyBucketDigests.hasValue() or
+      keyDumpParams.sinceWatermark.hasValue();
+  thrift::Publication thriftPub;
+  if (keyDumpParams.sinceWatermark.hasValue() and
+      not keyDumpParams.keyValHashes.hasValue()) {
+    // delta full-sync of a reconnecting peer, falls back to all keys if the
+    // watermark is of a previous instance of ours
+    auto const& sinceWatermark = keyDumpParams.sinceWatermark.value();
+    if (sinceWatermark.epoch == epoch_ and sinceWatermark.seqNum <= seqNum_) {
+      tData_.addStatValue("kvstore.cmd_key_delta_dump", 1, fbzmq::COUNT);
+      thriftPub =
+          dumpChangesWithFilters(keyPrefixMatch, sinceWatermark.seqNum);
+      thriftPub.deltaSync = true;
+    } else {
+      thriftPub = dumpAllWithFilters(keyPrefixMatch);
+    }
+    LOG(INFO) << "Processed "
+              << (thriftPub.deltaSync.hasValue() ? "delta" : "full")
+              << " full-sync request since watermark. Sending "
+              << thriftPub.keyVals.size() << " key-vals";
+  } else if (keyDumpParams.keyBucketDigests.hasValue()) {
+    // last step of a bucket digest full-sync, keyValHashes cover the keys
+    // of the children of parentBuckets
+    auto const& digests = keyDumpParams.keyBucketDigests.value();
+    std::unordered_set<int64_t> buckets;
+    if (digests.parentBuckets.hasValue() and digests.level > 1 and
+        (digests.level - 1) * Constants::kKvStoreSyncBucketBits <= 64) {
+      buckets.insert(
+          digests.parentBuckets->begin(), digests.parentBuckets->end());
+    }
+    thriftPub = dumpDifference(
+        dumpAllWithFilters(keyPrefixMatch, digests.level - 1, buckets).keyVals,
+        keyDumpParams.keyValHashes.value());
+  } else if (
+      keyDumpParams.syncBuckets.hasValue() and
+      keyDumpParams.keyValHashes.hasValue()) {
+    // partitioned full-sync, only keys of the range of the requester
+    tData_.addStatValue("kvstore.cmd_key_range_dump", 1, fbzmq::COUNT);
+    std::unordered_set<int64_t> buckets(
+        keyDumpParams.syncBuckets->begin(), keyDumpParams.syncBuckets->end());
+    thriftPub = dumpDifference(
+        dumpAllWithFilters(keyPrefixMatch, 1, buckets).keyVals,
+        keyDumpParams.keyValHashes.value());
+  } else if (keyDumpParams.keyValHashes.hasValue()) {
+    thriftPub = dumpDifference(
+        dumpAllWithFilters(keyPrefixMatch).keyVals,
+        keyDumpParams.keyValHashes.value());
+  } else {
+    // plain dumps, e.g. of monitoring, are often repeated with the same
+    // filters
+    thriftPub = dumpWithFiltersCached(keyPrefixMatch, false /* hashesOnly */);
+  }
+  updatePublicationTtl(thriftPub);
+  // I'm the initiator, set flood-root-id
+  thriftPub.floodRootId = DualNode::getSptRootId();
+  if (syncRequest) {
+    thriftPub.syncWatermark = getWatermark();
+    thriftPub.acceptTtlUpdates = true;
+    thriftPub.acceptKeyIds = true;
+    thriftPub.acceptBucketDigests = true;
+    if (kvParams_.lazyValueThreshold > 0) {
+      thriftPub.acceptValueAnnouncements = true;
+    }
+  }
+
+  if (keyDumpParams.keyValHashes.hasValue() and
+      keyDumpParams.prefix.empty()) {
+    // This usually comes from neighbor nodes
+    size_t numMissingKeys = 0;
+    if (thriftPub.tobeUpdatedKeys.hasValue()) {
+      numMissingKeys = thriftPub.tobeUpdatedKeys->size();
+    }
+    LOG(INFO) << "Processed full-sync request with "
+              << keyDumpParams.keyValHashes.value().size()
+              << " keyValHashes item(s). Sending " << thriftPub.keyVals.size()
+              << " key-vals and " << numMissingKeys << " missing keys";
+  }
+  return thriftPub;
+}
+
 // process a request
 folly::Expected<fbzmq::Message, fbzmq::Error>
-KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
+KvStoreDb::processRequestMsgHelper(
+    thrift::KvStoreRequest& thriftReq,
+    std::vector<fbzmq::Message>& leadingChunks) {
+  if (not decompressRequest(thriftReq)) {
+    LOG(ERROR) << "received bad compressed request";
+    return folly::makeUnexpected(fbzmq::Error());
+  }
   VLOG(3)
       << "processRequest: command: `"
       << apache::thrift::TEnumTraits<thrift::Command>::findName(thriftReq.cmd)
@@ -1376,18 +3235,74 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
     }
 
     auto& ketSetParamsVal = thriftReq.keySetParams.value();
+    // announcements, pulls and key IDs name the requesting peer last in
+    // nodeIds
+    const bool fromPeer = ketSetParamsVal.nodeIds.hasValue() and
+        not ketSetParamsVal.nodeIds->empty();
+    const bool resetKeyIds =
+        ketSetParamsVal.resetKeyIds.value_or(false) and fromPeer;
+    if (resetKeyIds) {
+      tData_.addStatValue("kvstore.key_ids.peer_resets", 1, fbzmq::COUNT);
+      keyIdEncoder_.resetPeer(ketSetParamsVal.nodeIds->back());
+    }
+    const bool hasKeyIds = ketSetParamsVal.keyIdSession.hasValue();
+    if (hasKeyIds) {
+      if (not fromPeer) {
+        LOG(ERROR) << "Key IDs of unknown peer, ignoring";
+        return folly::makeUnexpected(fbzmq::Error());
+      }
+      auto const& peerName = ketSetParamsVal.nodeIds->back();
+      if (not keyIdDecoder_.decode(peerName, ketSetParamsVal)) {
+        requestKeyIdReset(peerName);
+      }
+    }
+    if (ketSetParamsVal.ttlUpdates.hasValue()) {
+      tData_.addStatValue(
+          "kvstore.received_ttl_updates", 1, fbzmq::COUNT);
+      if (not KvStore::expandTtlUpdates(
+              ketSetParamsVal.ttlUpdates.value(), ketSetParamsVal.keyVals)) {
+        LOG(ERROR) << "Malformed TTL updates, ignoring";
+        return folly::makeUnexpected(fbzmq::Error());
+      }
+    }
+
+    const bool hasAnnouncements =
+        ketSetParamsVal.announcements.hasValue() and fromPeer;
+    const bool hasPullKeys = ketSetParamsVal.pullKeys.hasValue() and fromPeer;
+    if (hasPullKeys) {
+      // the peer lacks values we announced, send them back
+      auto const& peerName = ketSetParamsVal.nodeIds->back();
+      auto peerIt = peers_.find(peerName);
+      if (peerIt != peers_.end()) {
+        tData_.addStatValue(
+            "kvstore.lazy_value.pulled_keys",
+            ketSetParamsVal.pullKeys->size(),
+            fbzmq::SUM);
+        finalizeFullSync(
+            ketSetParamsVal.pullKeys.value(), peerIt->second.second);
+      }
+    }
+    if (hasAnnouncements) {
+      processValueAnnouncements(
+          ketSetParamsVal.nodeIds->back(),
+          std::move(ketSetParamsVal.announcements.value()),
+          ketSetParamsVal.keyVals);
+    }
     if (ketSetParamsVal.keyVals.empty()) {
+      if (hasAnnouncements or hasPullKeys or resetKeyIds or hasKeyIds) {
+        if (ketSetParamsVal.solicitResponse) {
+          return fbzmq::Message::from(Constants::kSuccessResponse.toString());
+        }
+        return fbzmq::Message();
+      }
       LOG(ERROR) << "Malformed set request, ignoring";
       return folly::makeUnexpected(fbzmq::Error());
     }
 
-    // Update hash for key-values
+    // Drop hashes of the setter, values are hashed by the merge only if they
+    // end up stored
     for (auto& kv : ketSetParamsVal.keyVals) {
-      auto& value = kv.second;
-      if (value.value.hasValue()) {
-        value.hash =
-            generateHash(value.version, value.originatorId, value.value);
-      }
+      kv.second.hash = folly::none;
     }
 
     // Create publication and merge it with local KvStore
@@ -1426,32 +3341,40 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
     auto& keyDumpParamsVal = thriftReq.keyDumpParams.value();
     tData_.addStatValue("kvstore.cmd_key_dump", 1, fbzmq::COUNT);
 
-    std::vector<std::string> keyPrefixList;
-    folly::split(",", keyDumpParamsVal.prefix, keyPrefixList, true);
-    const auto keyPrefixMatch =
-        KvStoreFilters(keyPrefixList, keyDumpParamsVal.originatorIds);
-    auto thriftPub = dumpAllWithFilters(keyPrefixMatch);
-    if (keyDumpParamsVal.keyValHashes.hasValue()) {
-      thriftPub = dumpDifference(
-          thriftPub.keyVals, keyDumpParamsVal.keyValHashes.value());
+    auto maybeThriftPub = processKeyDump(keyDumpParamsVal);
+    if (maybeThriftPub.hasError()) {
+      return folly::makeUnexpected(maybeThriftPub.error());
     }
-    updatePublicationTtl(thriftPub);
-    // I'm the initiator, set flood-root-id
-    thriftPub.floodRootId = DualNode::getSptRootId();
-
-    if (keyDumpParamsVal.keyValHashes.hasValue() and
-        keyDumpParamsVal.prefix.empty()) {
-      // This usually comes from neighbor nodes
-      size_t numMissingKeys = 0;
-      if (thriftPub.tobeUpdatedKeys.hasValue()) {
-        numMissingKeys = thriftPub.tobeUpdatedKeys->size();
+    auto& thriftPub = maybeThriftPub.value();
+    const bool acceptCompressed =
+        keyDumpParamsVal.acceptCompressed.value_or(false);
+    if (keyDumpParamsVal.maxChunkBytes.value_or(0) > 0 and
+        thriftPub.tobeUpdatedKeys.hasValue()) {
+      // full-sync response: key-vals beyond the chunk size go in leading
+      // chunks, merged by the requester as they arrive
+      auto chunks = splitKeyVals(
+          std::move(thriftPub.keyVals),
+          keyDumpParamsVal.maxChunkBytes.value());
+      thriftPub.keyVals = std::move(chunks.back());
+      chunks.pop_back();
+      for (auto& keyVals : chunks) {
+        thrift::Publication chunk;
+        chunk.area = thriftPub.area;
+        chunk.floodRootId = thriftPub.floodRootId;
+        chunk.keyVals = std::move(keyVals);
+        chunk.hasMoreChunks = true;
+        auto maybeMsg = serializeResponse(chunk, acceptCompressed);
+        if (maybeMsg.hasError()) {
+          return folly::makeUnexpected(maybeMsg.error());
+        }
+        leadingChunks.emplace_back(std::move(maybeMsg.value()));
+      }
+      if (not leadingChunks.empty()) {
+        tData_.addStatValue(
+            "kvstore.full_sync.chunks_sent", leadingChunks.size(), fbzmq::SUM);
       }
-      LOG(INFO) << "Processed full-sync request with "
-                << keyDumpParamsVal.keyValHashes.value().size()
-                << " keyValHashes item(s). Sending " << thriftPub.keyVals.size()
-                << " key-vals and " << numMissingKeys << " missing keys";
     }
-    return fbzmq::Message::fromThriftObj(thriftPub, serializer_);
+    return serializeResponse(thriftPub, acceptCompressed);
   }
   case thrift::Command::HASH_DUMP: {
     VLOG(3) << "Dump all hashes requested";
@@ -1745,53 +3668,211 @@ KvStoreDb::processSyncResponse() noexcept {
       VLOG(2) << "Got ack for sent publication on " << requestId;
       return;
     }
-  }
+  }
+
+  // Perform error check
+  auto maybeSyncPub =
+      syncPubMsg.readThriftObj<thrift::Publication>(serializer_);
+  if (maybeSyncPub.hasError()) {
+    LOG(ERROR) << "Received bad response on peerSyncSock";
+    return;
+  }
+
+  auto& syncPub = maybeSyncPub.value();
+  if (syncPub.compressedPublication.hasValue()) {
+    auto payload = decompressPayload(syncPub.compressedPublication.value());
+    if (not payload.hasValue()) {
+      LOG(ERROR) << "Received bad compressed response on peerSyncSock";
+      return;
+    }
+    try {
+      syncPub = apache::thrift::CompactSerializer::deserialize<
+          thrift::Publication>(payload.value());
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Received bad compressed response on peerSyncSock: "
+                 << folly::exceptionStr(e);
+      return;
+    }
+  }
+  if (syncPub.acceptCompressed.value_or(false)) {
+    compressionPeers_.emplace(requestId);
+  }
+  if (syncPub.acceptTtlUpdates.value_or(false)) {
+    ttlUpdatePeers_.emplace(requestId);
+  }
+  if (syncPub.acceptValueAnnouncements.value_or(false)) {
+    lazyValuePeers_.emplace(requestId);
+  }
+  if (syncPub.acceptKeyIds.value_or(false)) {
+    keyIdPeers_.emplace(requestId);
+  }
+  if (syncPub.acceptBucketDigests.value_or(false)) {
+    bucketSyncPeers_.emplace(requestId);
+  }
+  processSyncPublication(requestId, syncPub);
+}
+
+// process the full-sync response of a peer
+void
+KvStoreDb::processSyncPublication(
+    const std::string& requestId, thrift::Publication const& syncPub) {
+  // the first response of the peer carries the watermark of its store
+  auto pendingIt = pendingSyncs_.find(requestId);
+  if (pendingIt != pendingSyncs_.end() and
+      not pendingIt->second.peerWatermark.hasValue()) {
+    pendingIt->second.peerWatermark = syncPub.syncWatermark;
+  }
+
+  if (syncPub.keyBucketDigests.hasValue()) {
+    if (continueBucketSync(requestId, syncPub.keyBucketDigests.value())) {
+      // full-sync is not complete yet
+      return;
+    }
+  } else {
+    const int64_t seqNumBeforeMerge = seqNum_;
+    const size_t kvUpdateCnt = mergePublication(syncPub, requestId);
+    const auto& peerName = pendingIt != pendingSyncs_.end()
+        ? pendingIt->second.peerName
+        : requestId;
+    tData_.addStatValue(
+        folly::sformat("kvstore.full_sync.{}.chunks_received", peerName),
+        1,
+        fbzmq::COUNT);
+    tData_.addStatValue(
+        folly::sformat("kvstore.full_sync.{}.keys_received", peerName),
+        syncPub.keyVals.size(),
+        fbzmq::SUM);
+
+    if (syncPub.hasMoreChunks.value_or(false)) {
+      // leading chunk of the response, the last one completes the full-sync
+      tData_.addStatValue(
+          "kvstore.full_sync.chunks_received", 1, fbzmq::COUNT);
+      if (pendingIt != pendingSyncs_.end()) {
+        pendingIt->second.numChunks++;
+        pendingIt->second.numChunkKeyVals += syncPub.keyVals.size();
+      }
+      VLOG(1) << "full-sync response chunk received from " << requestId
+              << " with " << syncPub.keyVals.size() << " key-vals. Incured "
+              << kvUpdateCnt << " key-value updates";
+      return;
+    }
+
+    size_t numMissingKeys = 0;
+    if (syncPub.tobeUpdatedKeys.hasValue()) {
+      numMissingKeys = syncPub.tobeUpdatedKeys->size();
+    }
+
+    LOG(INFO) << "full-sync response received from " << requestId << " with "
+              << syncPub.keyVals.size() << " key-vals and " << numMissingKeys
+              << " missing keys. Incured " << kvUpdateCnt
+              << " key-value updates";
+    if (pendingIt != pendingSyncs_.end() and pendingIt->second.numChunks) {
+      LOG(INFO) << "full-sync response from " << requestId << " preceded by "
+                << pendingIt->second.numChunks << " chunks with "
+                << pendingIt->second.numChunkKeyVals << " key-vals";
+    }
 
-  // Perform error check
-  auto maybeSyncPub =
-      syncPubMsg.readThriftObj<thrift::Publication>(serializer_);
-  if (maybeSyncPub.hasError()) {
-    LOG(ERROR) << "Received bad response on peerSyncSock";
-    return;
+    const bool bucketSync = pendingBucketSyncs_.erase(requestId);
+    const bool deltaSync =
+        pendingIt != pendingSyncs_.end() and pendingIt->second.delta;
+    auto watermarkIt = pendingIt != pendingSyncs_.end()
+        ? syncWatermarks_.find(pendingIt->second.peerName)
+        : syncWatermarks_.end();
+    if (deltaSync and syncPub.deltaSync.value_or(false) and
+        watermarkIt != syncWatermarks_.end()) {
+      // peer sent what changed since our last sync, send back what changed
+      // on our side, leaving out what we just got from it
+      std::vector<std::string> keys;
+      for (auto it = seqIndex_.upper_bound(watermarkIt->second.localSeqNum);
+           it != seqIndex_.end() and it->first <= seqNumBeforeMerge;
+           ++it) {
+        keys.emplace_back(it->second->first);
+      }
+      VLOG(1) << "Delta full-sync with " << requestId << ", sending back "
+              << keys.size() << " changed keys";
+      finalizeFullSync(keys, requestId);
+    } else if (
+        (bucketSync or deltaSync) and not syncPub.tobeUpdatedKeys.hasValue()) {
+      // peer doesn't support bucket digests or delta syncs, or restarted
+      // since our last sync, and responded with all of its keys. Send back
+      // the ones it misses or has older values of
+      LOG(INFO) << "Peer " << requestId << " responded with all of its keys";
+      tData_.addStatValue(
+          "kvstore.full_sync.legacy_responses", 1, fbzmq::COUNT);
+      if (bucketSync) {
+        // don't try again until it tells us otherwise
+        bucketSyncPeers_.erase(requestId);
+      }
+      std::vector<std::string> keys;
+      for (auto const& kv : kvStore_) {
+        auto it = syncPub.keyVals.find(kv.first);
+        if (it == syncPub.keyVals.end() or
+            KvStore::compareValues(kv.second, it->second) == 1) {
+          keys.emplace_back(kv.first);
+        }
+      }
+      finalizeFullSync(keys, requestId);
+    }
   }
 
-  const auto& syncPub = maybeSyncPub.value();
-  const size_t kvUpdateCnt = mergePublication(syncPub, requestId);
-  size_t numMissingKeys = 0;
-  if (syncPub.tobeUpdatedKeys.hasValue()) {
-    numMissingKeys = syncPub.tobeUpdatedKeys->size();
+  // full-sync is complete, next reconnection of the peer can delta sync
+  // from here. Not after syncing a range, the peer only sent keys of it
+  const bool rangeSync = rangeSyncs_.erase(requestId) > 0;
+  if (pendingIt != pendingSyncs_.end()) {
+    if (rangeSync) {
+      reconcilePeer_ = pendingIt->second.peerName;
+    } else if (pendingIt->second.peerWatermark.hasValue()) {
+      syncWatermarks_[pendingIt->second.peerName] = SyncWatermark{
+          pendingIt->second.peerWatermark.value(),
+          pendingIt->second.localSeqNum};
+    }
+    pendingSyncs_.erase(pendingIt);
   }
 
-  LOG(INFO) << "full-sync response received from " << requestId << " with "
-            << syncPub.keyVals.size() << " key-vals and " << numMissingKeys
-            << " missing keys. Incured " << kvUpdateCnt << " key-value updates";
-
   if (latestSentPeerSync_.count(requestId)) {
     auto syncDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - latestSentPeerSync_.at(requestId));
     tData_.addStatValue(
         "kvstore.full_sync_duration_ms", syncDuration.count(), fbzmq::AVG);
+    {
+      std::lock_guard<std::mutex> lock(kvParams_.sharedMutex);
+      kvParams_.latencies.addDuration(KvStorePhase::FULL_SYNC, syncDuration);
+    }
     logSyncEvent(requestId, syncDuration);
     VLOG(1) << "It took " << syncDuration.count() << " ms to sync with "
             << requestId;
     latestSentPeerSync_.erase(requestId);
-    // if peers to sync with is not empty then schedule one immediately
-    // double the max full sync pending once a response is received, to a max
-    // of kMaxFullSyncPendingCountThreshold
-    if (not peersToSyncWith_.empty()) {
+    // double the max full sync pending while full-syncs complete no slower
+    // than on average, to a max of kMaxFullSyncPendingCountThreshold, and
+    // halve it when they slow down
+    const double durationMs = syncDuration.count();
+    if (durationMs <= fullSyncDurationMs_ or fullSyncDurationMs_ == 0) {
       fullSycnReqInProgress_ = std::min(
           2 * fullSycnReqInProgress_,
           Constants::kMaxFullSyncPendingCountThreshold);
+    } else if (durationMs > 2 * fullSyncDurationMs_) {
+      fullSycnReqInProgress_ = std::max(
+          fullSycnReqInProgress_ / 2,
+          Constants::kMinFullSyncPendingCountThreshold);
+    }
+    fullSyncDurationMs_ = fullSyncDurationMs_ == 0
+        ? durationMs
+        : fullSyncDurationMs_ + 0.25 * (durationMs - fullSyncDurationMs_);
+    // if peers to sync with is not empty then schedule one immediately
+    if (not peersToSyncWith_.empty()) {
       fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
     }
   }
+  if (rangeSync) {
+    assignOrphanRanges();
+  }
 }
 
 // send sync request from one neighbor randomly
 void
 KvStoreDb::requestSync() {
   SCOPE_EXIT {
-    auto base = kvParams_.dbSyncInterval.count() * 1000;
+    auto base = kvParams_.dbSyncIntervalS.get() * 1000;
     std::default_random_engine generator;
     // add 20% variance
     std::uniform_int_distribution<int> distribution(-0.2 * base, 0.2 * base);
@@ -1893,6 +3974,25 @@ KvStoreDb::attachCallbacks() {
   requestSyncTimer_ = folly::AsyncTimeout::make(
       *evb_->getEvb(), [this]() noexcept { requestSync(); });
 
+  // Flush the peer flood queues which can be tried again
+  peerFloodQueueTimer_ =
+      folly::AsyncTimeout::make(*evb_->getEvb(), [this]() noexcept {
+        std::vector<std::string> peers;
+        for (auto const& kv : peerFloodQueues_) {
+          if (kv.second.backoff.canTryNow()) {
+            peers.emplace_back(kv.first);
+          }
+        }
+        for (auto const& peer : peers) {
+          flushPeerFloodQueue(peer);
+        }
+        schedulePeerFloodQueueTimer();
+      });
+
+  // Pull values not received in time from their next announcer
+  pendingPullTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { processPendingPulls(); });
+
   // Schedule periodic call to re-sync with one of our peer
   requestSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
 }
@@ -1903,13 +4003,8 @@ KvStoreDb::cleanupTtlCountdownQueue() {
   std::vector<std::string> expiredKeys;
   auto now = std::chrono::steady_clock::now();
 
-  // Iterate through ttlCountdownQueue_ until the top expires in the future
-  while (not ttlCountdownQueue_.empty()) {
-    auto top = ttlCountdownQueue_.top();
-    if (top.expiryTime > now) {
-      // Nothing in queue worth evicting
-      break;
-    }
+  // Keys expired since the last run are sent out in a single publication
+  for (auto const& top : ttlCountdownQueue_.expire(now)) {
     auto it = kvStore_.find(top.key);
     if (it != kvStore_.end() and it->second.version == top.version and
         it->second.originatorId == top.originatorId and
@@ -1928,17 +4023,13 @@ KvStoreDb::cleanupTtlCountdownQueue() {
                  kvParams_.nodeId,
                  area_);
       logKvEvent("KEY_EXPIRE", top.key);
+      unindexKeyVal(*it);
       kvStore_.erase(it);
     }
-    ttlCountdownQueue_.pop();
   }
 
   // Reschedule based on most recent timeout
-  if (not ttlCountdownQueue_.empty()) {
-    ttlCountdownTimer_->scheduleTimeout(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            ttlCountdownQueue_.top().expiryTime - now));
-  }
+  scheduleTtlCountdownTimer();
 
   if (expiredKeys.empty()) {
     // no key expires
@@ -1951,27 +4042,105 @@ KvStoreDb::cleanupTtlCountdownQueue() {
   floodPublication(std::move(expiredKeysPub));
 }
 
+size_t
+KvStoreDb::getFloodClass(const std::string& key) const {
+  for (size_t i = 0; i + 1 < floodClasses_.size(); ++i) {
+    auto const& keyPrefix = floodClasses_[i].keyPrefix;
+    if (key.compare(0, keyPrefix.size(), keyPrefix) == 0) {
+      return i;
+    }
+  }
+  return floodClasses_.size() - 1;
+}
+
+std::vector<thrift::Publication>
+KvStoreDb::splitByFloodClass(thrift::Publication&& publication) const {
+  if (floodClasses_.size() <= 1) {
+    std::vector<thrift::Publication> publications;
+    publications.emplace_back(std::move(publication));
+    return publications;
+  }
+  // keys are moved out, other fields are of each class publication
+  auto keyVals = std::move(publication.keyVals);
+  auto expiredKeys = std::move(publication.expiredKeys);
+  publication.keyVals.clear();
+  publication.expiredKeys.clear();
+  std::vector<thrift::Publication> publications(
+      floodClasses_.size(), publication);
+  for (auto& kv : keyVals) {
+    publications[getFloodClass(kv.first)].keyVals.emplace(
+        kv.first, std::move(kv.second));
+  }
+  for (auto& key : expiredKeys) {
+    publications[getFloodClass(key)].expiredKeys.emplace_back(std::move(key));
+  }
+  return publications;
+}
+
 void
-KvStoreDb::bufferPublication(thrift::Publication&& publication) {
+KvStoreDb::bufferPublication(
+    size_t floodClass, thrift::Publication&& publication) {
   tData_.addStatValue("kvstore.rate_limit_suppress", 1, fbzmq::COUNT);
   tData_.addStatValue(
       "kvstore.rate_limit_keys", publication.keyVals.size(), fbzmq::AVG);
+  tData_.addStatValue(
+      folly::sformat("kvstore.flood_class.{}.rate_limit_keys", floodClass),
+      publication.keyVals.size() + publication.expiredKeys.size(),
+      fbzmq::SUM);
   std::optional<std::string> floodRootId{std::nullopt};
   if (publication.floodRootId.hasValue()) {
     floodRootId = publication.floodRootId.value();
   }
   // update or add keys
+  auto& buffer = floodClasses_.at(floodClass).buffer;
   for (auto const& kv : publication.keyVals) {
-    publicationBuffer_[floodRootId].emplace(kv.first);
+    buffer[floodRootId].emplace(kv.first);
   }
   for (auto const& key : publication.expiredKeys) {
-    publicationBuffer_[floodRootId].emplace(key);
+    buffer[floodRootId].emplace(key);
   }
 }
 
 void
+KvStoreDb::updateFloodRate() {
+  const auto floodRate = std::make_pair(
+      kvParams_.floodMsgPerSec.get(), kvParams_.floodMsgBurstSize.get());
+  if (floodRate == floodRate_) {
+    return;
+  }
+  LOG(INFO) << "Flood rate of area " << area_ << " changed to "
+            << floodRate.first << " msgs/sec, burst size "
+            << floodRate.second;
+  floodRate_ = floodRate;
+  for (auto& floodClass : floodClasses_) {
+    floodClass.limiter->reset(floodRate.first, floodRate.second);
+  }
+}
+
+bool
 KvStoreDb::floodBufferedUpdates() {
-  if (!publicationBuffer_.size()) {
+  updateFloodRate();
+
+  // keys of a class wait for those of higher classes to be flooded
+  bool pending = false;
+  for (size_t i = 0; i < floodClasses_.size(); ++i) {
+    auto& floodClass = floodClasses_[i];
+    if (floodClass.buffer.empty()) {
+      continue;
+    }
+    if (pending or not floodClass.limiter->consume(1)) {
+      pending = true;
+      continue;
+    }
+    floodBufferedUpdates(i);
+  }
+  return pending;
+}
+
+void
+KvStoreDb::floodBufferedUpdates(size_t floodClass) {
+  auto& buffer = floodClasses_.at(floodClass).buffer;
+  if (buffer.empty()) {
     return;
   }
 
@@ -1979,7 +4148,7 @@ KvStoreDb::floodBufferedUpdates() {
   std::vector<thrift::Publication> publications;
 
   // merge publication per root-id
-  for (const auto& kv : publicationBuffer_) {
+  for (const auto& kv : buffer) {
     thrift::Publication publication{};
     // convert from std::optional to folly::Optional
     folly::Optional<std::string> floodRootId{folly::none};
@@ -1998,7 +4167,7 @@ KvStoreDb::floodBufferedUpdates() {
     publications.emplace_back(std::move(publication));
   }
 
-  publicationBuffer_.clear();
+  buffer.clear();
 
   for (auto& pub : publications) {
     // when sending out merged publication, we maintain orginal-root-id
@@ -2029,26 +4198,36 @@ KvStoreDb::finalizeFullSync(
   VLOG(1) << "finalizeFullSync back to: " << senderId
           << " with keys: " << folly::join(",", keys);
 
-  thrift::KvStoreRequest updateRequest;
-  thrift::KeySetParams params;
+  // sent in chunks of bounded size, each merged on its own by the peer
+  auto chunks = splitKeyVals(
+      std::move(updates.keyVals), Constants::kKvStoreSyncChunkBytes);
+  if (chunks.size() > 1) {
+    tData_.addStatValue(
+        "kvstore.full_sync.finalize_chunks_sent", chunks.size(), fbzmq::SUM);
+  }
+  for (auto& keyVals : chunks) {
+    thrift::KvStoreRequest updateRequest;
+    thrift::KeySetParams params;
 
-  params.keyVals = std::move(updates.keyVals);
-  params.solicitResponse = false;
-  // I'm the initiator, set flood-root-id
-  params.floodRootId = DualNode::getSptRootId();
-  params.timestamp_ms = getUnixTimeStampMs();
+    params.keyVals = std::move(keyVals);
+    params.solicitResponse = false;
+    // I'm the initiator, set flood-root-id
+    params.floodRootId = DualNode::getSptRootId();
+    params.timestamp_ms = getUnixTimeStampMs();
 
-  updateRequest.cmd = thrift::Command::KEY_SET;
-  updateRequest.keySetParams = params;
-  updateRequest.area = area_;
+    updateRequest.cmd = thrift::Command::KEY_SET;
+    updateRequest.keySetParams = std::move(params);
+    updateRequest.area = area_;
 
-  VLOG(1) << "sending finalizeFullSync back to " << senderId;
-  auto const ret = sendMessageToPeer(senderId, updateRequest);
-  if (ret.hasError()) {
-    // this could fail when senderId goes offline
-    LOG(ERROR) << "Failed to send finalizeFullSync to " << senderId
-               << " using id " << senderId << ", error: " << ret.error();
-    collectSendFailureStats(ret.error(), senderId);
+    VLOG(1) << "sending finalizeFullSync back to " << senderId;
+    auto const ret = sendMessageToPeer(senderId, updateRequest);
+    if (ret.hasError()) {
+      // this could fail when senderId goes offline
+      LOG(ERROR) << "Failed to send finalizeFullSync to " << senderId
+                 << " using id " << senderId << ", error: " << ret.error();
+      collectSendFailureStats(ret.error(), senderId);
+      return;
+    }
   }
 }
 
@@ -2088,18 +4267,43 @@ KvStoreDb::collectSendFailureStats(
 void
 KvStoreDb::floodPublication(
     thrift::Publication&& publication, bool rateLimit, bool setFloodRoot) {
-  // rate limit if configured
-  if (floodLimiter_ && rateLimit && !floodLimiter_->consume(1)) {
-    bufferPublication(std::move(publication));
-    pendingPublicationTimer_->scheduleTimeout(
-        Constants::kFloodPendingPublication, false);
+  // rate limit if configured, keys of each flood class on their own
+  if (rateLimit and not floodClasses_.empty()) {
+    updateFloodRate();
+    auto publications = splitByFloodClass(std::move(publication));
+    bool higherPending = false;
+    for (size_t i = 0; i < publications.size(); ++i) {
+      auto& pub = publications[i];
+      const bool empty = pub.keyVals.empty() and pub.expiredKeys.empty();
+      auto& floodClass = floodClasses_[i];
+      if (empty) {
+        higherPending |= not floodClass.buffer.empty();
+        continue;
+      }
+      // keys of higher classes waiting pre-empt ours
+      if (higherPending or not floodClass.limiter->consume(1)) {
+        bufferPublication(i, std::move(pub));
+        pendingPublicationTimer_->scheduleTimeout(
+            Constants::kFloodPendingPublication, false);
+        higherPending = true;
+        continue;
+      }
+      if (not floodClass.buffer.empty()) {
+        // merge with buffered publication and flood
+        bufferPublication(i, std::move(pub));
+        floodBufferedUpdates(i);
+        continue;
+      }
+      floodPublication(std::move(pub), false /* rate-limit */, setFloodRoot);
+    }
     return;
   }
-  // merge with buffered publication and flood
-  if (publicationBuffer_.size()) {
-    bufferPublication(std::move(publication));
-    return floodBufferedUpdates();
-  }
+  const auto startTime = std::chrono::steady_clock::now();
+  SCOPE_EXIT {
+    std::lock_guard<std::mutex> lock(kvParams_.sharedMutex);
+    kvParams_.latencies.addDuration(
+        KvStorePhase::FLOOD, std::chrono::steady_clock::now() - startTime);
+  };
   // Update ttl on keys we are trying to advertise. Also remove keys which
   // are about to expire.
   updatePublicationTtl(publication, true);
@@ -2124,11 +4328,21 @@ KvStoreDb::floodPublication(
   //
   // Usually only local subscribers need to know, but we are also sending
   // on global socket so that it can help debugging things via breeze as
-  // well as preserve backward compatibility
-  auto const msg =
-      fbzmq::Message::fromThriftObj(publication, serializer_).value();
-  kvParams_.localPubSock.sendOne(msg);
-  kvParams_.kvStoreUpdatesQueue.push(publication);
+  // well as preserve backward compatibility. Skipped if nobody subscribed
+  {
+    std::lock_guard<std::mutex> lock(kvParams_.sharedMutex);
+    kvParams_.localPubSubscriptions.update(kvParams_.localPubSock);
+    if (kvParams_.localPubSubscriptions.hasSubscribers()) {
+      auto const msg =
+          fbzmq::Message::fromThriftObj(publication, serializer_).value();
+      kvParams_.localPubSock.sendOne(msg);
+    } else {
+      tData_.addStatValue("kvstore.local_pub_skipped", 1, fbzmq::COUNT);
+    }
+  }
+  // copied once, readers share it
+  kvParams_.kvStoreUpdatesQueue.push(
+      std::make_shared<const thrift::Publication>(publication));
 
   //
   // Create request and send only keyValue updates to all neighbors
@@ -2139,25 +4353,84 @@ KvStoreDb::floodPublication(
 
   if (setFloodRoot and not senderId.has_value()) {
     // I'm the initiator, set flood-root-id
+    const auto rootIds = kvParams_.enableMultiRootFlooding
+        ? DualNode::getSptRootIds()
+        : std::vector<std::string>{};
+    if (rootIds.size() > 1) {
+      // spread keys across the SPTs of all ready roots by their hash, so that
+      // all trees and their links share the flooding load
+      std::vector<thrift::Publication> rootPublications(rootIds.size());
+      for (size_t i = 0; i < rootIds.size(); ++i) {
+        rootPublications[i].nodeIds = publication.nodeIds;
+        rootPublications[i].floodRootId = rootIds[i];
+      }
+      for (auto& kv : publication.keyVals) {
+        const auto i = std::hash<std::string>()(kv.first) % rootIds.size();
+        rootPublications[i].keyVals.emplace(kv.first, std::move(kv.second));
+      }
+      for (size_t i = 0; i < rootIds.size(); ++i) {
+        if (rootPublications[i].keyVals.empty()) {
+          continue;
+        }
+        tData_.addStatValue(
+            folly::sformat("kvstore.flood.root_keys.{}", rootIds[i]),
+            rootPublications[i].keyVals.size(),
+            fbzmq::SUM);
+        sendFloodPublication(std::move(rootPublications[i]), senderId);
+      }
+      return;
+    }
     publication.floodRootId = DualNode::getSptRootId();
   }
 
+  sendFloodPublication(std::move(publication), senderId);
+}
+
+void
+KvStoreDb::sendFloodPublication(
+    thrift::Publication&& publication,
+    const std::optional<std::string>& senderId) {
+  // publication is not used beyond this point, move its key-vals into the
+  // request rather than copying them
+  const size_t numKeyVals = publication.keyVals.size();
   thrift::KvStoreRequest floodRequest;
   thrift::KeySetParams params;
 
-  params.keyVals = publication.keyVals;
+  params.keyVals = std::move(publication.keyVals);
   params.solicitResponse = false;
-  params.nodeIds = publication.nodeIds;
+  params.nodeIds = std::move(publication.nodeIds);
   params.floodRootId = publication.floodRootId;
   params.timestamp_ms = getUnixTimeStampMs();
 
   floodRequest.cmd = thrift::Command::KEY_SET;
-  floodRequest.keySetParams = params;
+  floodRequest.keySetParams = std::move(params);
   floodRequest.area = area_;
 
   std::optional<std::string> floodRootId{std::nullopt};
-  if (params.floodRootId.hasValue()) {
-    floodRootId = params.floodRootId.value();
+  if (publication.floodRootId.hasValue()) {
+    floodRootId = publication.floodRootId.value();
+  }
+
+  // built and serialized once on demand per capability set, the same message
+  // is sent to all peers of a set. Peers accepting compression get the
+  // compressed one, peers accepting TTL updates get TTL refreshes batched per
+  // originator (compact request), peers accepting announcements get large
+  // values announced (lazy request) and peers accepting key IDs get keys by ID
+  keyIdEncoder_.resetIfFull();
+  FloodRequests floodRequests;
+  std::map<FloodCapabilities, fbzmq::Message> floodMsgs;
+  auto const& baseRequest =
+      floodRequests[FloodCapabilities{}].request = std::move(floodRequest);
+  bool hasTtlUpdates = false;
+  bool hasLazyValues = false;
+  for (auto const& kv : baseRequest.keySetParams->keyVals) {
+    if (not kv.second.value.hasValue()) {
+      hasTtlUpdates = true;
+    } else if (
+        kvParams_.lazyValueThreshold > 0 and
+        kv.second.value->size() >= kvParams_.lazyValueThreshold) {
+      hasLazyValues = true;
+    }
   }
   const auto& floodPeers = getFloodPeers(floodRootId);
   for (const auto& peer : floodPeers) {
@@ -2165,24 +4438,435 @@ KvStoreDb::floodPublication(
       // Do not flood towards senderId from whom we received this publication
       continue;
     }
+    if (peerFloodQueues_.count(peer)) {
+      // peer is backpressured, coalesce with its pending keys
+      enqueuePeerFloodKeys(
+          peer, floodRootId, baseRequest.keySetParams->keyVals);
+      continue;
+    }
+    auto const& peerCmdSocketId = peers_.at(peer).second;
+    const bool thriftPeer = thriftPeers_.count(peerCmdSocketId) > 0;
+    if (thriftPeer and peersToSyncWith_.count(peer)) {
+      // a request to the peer failed, keys are exchanged with the full-sync
+      continue;
+    }
     VLOG(4) << "Forwarding publication, received from: "
             << (senderId.has_value() ? senderId.value() : "N/A")
             << ", to: " << peer << ", via: " << kvParams_.nodeId;
 
-    tData_.addStatValue("kvstore.sent_publications", 1, fbzmq::COUNT);
-    tData_.addStatValue(
-        "kvstore.sent_key_vals", publication.keyVals.size(), fbzmq::SUM);
+    sentPublicationsStat_.addValue(1);
+    sentKeyValsStat_.addValue(numKeyVals);
 
     // Send flood request
-    auto const& peerCmdSocketId = peers_.at(peer).second;
-    auto const ret = sendMessageToPeer(peerCmdSocketId, floodRequest);
+    folly::Expected<size_t, fbzmq::Error> ret{0};
+    if (thriftPeer) {
+      ret = sendThriftRequestToPeer(peerCmdSocketId, baseRequest);
+    } else {
+      FloodCapabilities caps;
+      caps.compress = compressionPeers_.count(peerCmdSocketId) > 0;
+      caps.compact =
+          hasTtlUpdates and ttlUpdatePeers_.count(peerCmdSocketId) > 0;
+      caps.lazy = hasLazyValues and lazyValuePeers_.count(peerCmdSocketId) > 0;
+      caps.keyIds = keyIdPeers_.count(peerCmdSocketId) > 0;
+      auto const& capsRequest = getFloodRequest(floodRequests, caps);
+      const auto* request = &capsRequest.request;
+      // the first request referring to IDs the peer doesn't know defines
+      // them, it is serialized for the peer alone
+      folly::Optional<thrift::KvStoreRequest> definingRequest;
+      if (caps.keyIds) {
+        auto definitions =
+            keyIdEncoder_.getNewDefinitions(peer, capsRequest.keyIds);
+        if (not definitions.empty()) {
+          tData_.addStatValue(
+              "kvstore.key_ids.sent_definitions",
+              definitions.size(),
+              fbzmq::SUM);
+          definingRequest = *request;
+          definingRequest->keySetParams->keyIdDefinitions =
+              std::move(definitions);
+          request = &*definingRequest;
+        }
+      }
+      folly::Optional<fbzmq::Message> peerMsg;
+      auto msgIt = floodMsgs.find(caps);
+      if (definingRequest.hasValue() or msgIt == floodMsgs.end()) {
+        peerMsg = serializeRequest(*request, caps.compress);
+        floodBytesSerializedStat_.addValue(peerMsg->size());
+        if (not definingRequest.hasValue()) {
+          msgIt = floodMsgs.emplace(caps, std::move(*peerMsg)).first;
+          peerMsg.clear();
+        }
+      }
+      auto const& msg = peerMsg.hasValue() ? *peerMsg : msgIt->second;
+      if (caps.compact) {
+        floodCompactTtlUpdatesStat_.addValue(1);
+      }
+      if (caps.lazy) {
+        tData_.addStatValue(
+            "kvstore.lazy_value.sent_announcements", 1, fbzmq::COUNT);
+      }
+      floodBytesSentStat_.addValue(msg.size());
+      ret = sendMessageToPeer(peerCmdSocketId, msg);
+    }
     if (ret.hasError()) {
       // this could be pretty common on initial connection setup
       LOG(ERROR) << "Failed to flood publication to peer " << peer
                  << " using id " << peerCmdSocketId
                  << ", error: " << ret.error();
       collectSendFailureStats(ret.error(), peerCmdSocketId);
+      // the peer may have missed definitions, define the IDs again
+      keyIdEncoder_.resetPeer(peer);
+      // retry with following updates once the peer can be tried again
+      peerFloodQueues_[peer].backoff.reportError();
+      enqueuePeerFloodKeys(
+          peer, floodRootId, baseRequest.keySetParams->keyVals);
+      schedulePeerFloodQueueTimer();
+    }
+  }
+}
+
+KvStoreDb::FloodRequest&
+KvStoreDb::getFloodRequest(
+    FloodRequests& floodRequests, FloodCapabilities caps) {
+  // compression only applies to the serialized request
+  caps.compress = false;
+  auto it = floodRequests.find(caps);
+  if (it != floodRequests.end()) {
+    return it->second;
+  }
+
+  // derive from the request with a capability less, references to the
+  // requests in the map stay valid while adding to it
+  FloodRequest floodRequest;
+  if (caps.keyIds) {
+    auto baseCaps = caps;
+    baseCaps.keyIds = false;
+    floodRequest.request = getFloodRequest(floodRequests, baseCaps).request;
+    floodRequest.keyIds =
+        keyIdEncoder_.encode(floodRequest.request.keySetParams.value());
+  } else if (caps.lazy) {
+    auto baseCaps = caps;
+    baseCaps.lazy = false;
+    floodRequest.request = getFloodRequest(floodRequests, baseCaps).request;
+    announceLazyValues(floodRequest.request.keySetParams.value());
+  } else {
+    CHECK(caps.compact);
+    auto const& baseRequest =
+        getFloodRequest(floodRequests, FloodCapabilities{}).request;
+    floodRequest.request = baseRequest;
+    auto& compactParams = floodRequest.request.keySetParams.value();
+    compactParams.keyVals.clear();
+    compactParams.ttlUpdates = KvStore::compactTtlUpdates(
+        baseRequest.keySetParams->keyVals, compactParams.keyVals);
+  }
+  return floodRequests.emplace(caps, std::move(floodRequest)).first->second;
+}
+
+void
+KvStoreDb::enqueuePeerFloodKeys(
+    const std::string& peer,
+    const std::optional<std::string>& floodRootId,
+    const thrift::KeyVals& keyVals) {
+  auto& queue = peerFloodQueues_[peer];
+  auto& keys = queue.keys[floodRootId];
+  size_t numCoalescedKeys = 0;
+  for (auto const& kv : keyVals) {
+    if (keys.emplace(kv.first).second) {
+      ++queue.numKeys;
+    } else {
+      ++numCoalescedKeys;
+    }
+  }
+  // coalescing ratio of a peer is coalesced_keys / enqueued_keys
+  tData_.addStatValue(
+      folly::sformat("kvstore.flood_queue.{}.enqueued_keys", peer),
+      keyVals.size(),
+      fbzmq::SUM);
+  tData_.addStatValue(
+      folly::sformat("kvstore.flood_queue.{}.coalesced_keys", peer),
+      numCoalescedKeys,
+      fbzmq::SUM);
+
+  if (queue.numKeys >= Constants::kFloodPeerQueueMaxKeys) {
+    flushPeerFloodQueue(peer);
+  }
+}
+
+void
+KvStoreDb::flushPeerFloodQueue(const std::string& peer) {
+  auto it = peerFloodQueues_.find(peer);
+  if (it == peerFloodQueues_.end()) {
+    return;
+  }
+  auto peerIt = peers_.find(peer);
+  if (peerIt == peers_.end()) {
+    peerFloodQueues_.erase(it);
+    return;
+  }
+  auto const& peerCmdSocketId = peerIt->second.second;
+  auto& queue = it->second;
+
+  for (auto keysIt = queue.keys.begin(); keysIt != queue.keys.end();) {
+    // latest values of the keys, expired keys are not flooded
+    thrift::Publication publication;
+    for (auto const& key : keysIt->second) {
+      auto kvStoreIt = kvStore_.find(key);
+      if (kvStoreIt != kvStore_.end()) {
+        publication.keyVals.emplace(key, kvStoreIt->second);
+      }
+    }
+    updatePublicationTtl(publication, true);
+
+    if (not publication.keyVals.empty()) {
+      const size_t numKeyVals = publication.keyVals.size();
+      thrift::KvStoreRequest floodRequest;
+      thrift::KeySetParams params;
+      params.keyVals = std::move(publication.keyVals);
+      params.solicitResponse = false;
+      params.nodeIds = std::vector<std::string>{kvParams_.nodeId};
+      if (keysIt->first.has_value()) {
+        params.floodRootId = keysIt->first.value();
+      }
+      params.timestamp_ms = getUnixTimeStampMs();
+      floodRequest.cmd = thrift::Command::KEY_SET;
+      floodRequest.keySetParams = std::move(params);
+      floodRequest.area = area_;
+
+      auto const ret = sendMessageToPeer(peerCmdSocketId, floodRequest);
+      if (ret.hasError()) {
+        LOG(ERROR) << "Failed to flush flood queue of peer " << peer
+                   << " using id " << peerCmdSocketId
+                   << ", error: " << ret.error();
+        collectSendFailureStats(ret.error(), peerCmdSocketId);
+        queue.backoff.reportError();
+        return;
+      }
+      sentPublicationsStat_.addValue(1);
+      sentKeyValsStat_.addValue(numKeyVals);
+      tData_.addStatValue(
+          folly::sformat("kvstore.flood_queue.{}.flushed_keys", peer),
+          numKeyVals,
+          fbzmq::SUM);
+    }
+    queue.numKeys -= keysIt->second.size();
+    keysIt = queue.keys.erase(keysIt);
+  }
+
+  // all caught up, floods are sent right away again
+  peerFloodQueues_.erase(it);
+}
+
+void
+KvStoreDb::schedulePeerFloodQueueTimer() {
+  if (peerFloodQueues_.empty()) {
+    peerFloodQueueTimer_->cancelTimeout();
+    return;
+  }
+  auto timeout = Constants::kFloodPeerQueueMaxBackoff;
+  for (auto const& kv : peerFloodQueues_) {
+    timeout = std::min(timeout, kv.second.backoff.getTimeRemainingUntilRetry());
+  }
+  peerFloodQueueTimer_->scheduleTimeout(timeout);
+}
+
+void
+KvStoreDb::announceLazyValues(thrift::KeySetParams& params) const {
+  thrift::KeyVals announcements;
+  for (auto it = params.keyVals.begin(); it != params.keyVals.end();) {
+    auto const& value = it->second.value;
+    if (not value.hasValue() or
+        value->size() < kvParams_.lazyValueThreshold) {
+      ++it;
+      continue;
+    }
+    auto& announced =
+        announcements.emplace(it->first, std::move(it->second)).first->second;
+    if (not announced.hash.hasValue()) {
+      announced.hash = generateHash(
+          announced.version, announced.originatorId, announced.value);
+    }
+    announced.value = folly::none;
+    it = params.keyVals.erase(it);
+  }
+  params.announcements = std::move(announcements);
+}
+
+void
+KvStoreDb::processValueAnnouncements(
+    const std::string& peerName,
+    thrift::KeyVals&& announcements,
+    thrift::KeyVals& keyVals) {
+  tData_.addStatValue(
+      "kvstore.lazy_value.received_announcements",
+      announcements.size(),
+      fbzmq::SUM);
+
+  std::vector<std::string> pullKeys;
+  for (auto& kv : announcements) {
+    auto& announced = kv.second;
+    if (announced.value.hasValue() or not announced.hash.hasValue()) {
+      LOG(ERROR) << "Malformed announcement of key " << kv.first
+                 << " from peer " << peerName << ", ignoring";
+      continue;
+    }
+
+    auto kvStoreIt = kvStore_.find(kv.first);
+    if (kvStoreIt != kvStore_.end()) {
+      auto const& stored = kvStoreIt->second;
+      const int rc = KvStore::compareValues(announced, stored);
+      if (rc == 0 or rc == -1) {
+        // we hold that value or a newer one
+        continue;
+      }
+      if (announced.version == stored.version and
+          announced.originatorId == stored.originatorId and
+          announced.hash == stored.hash) {
+        // refresh of the value we hold, merged as a TTL update
+        announced.hash = folly::none;
+        keyVals.emplace(kv.first, std::move(announced));
+        continue;
+      }
+    }
+
+    auto pullIt = pendingPulls_.find(kv.first);
+    if (pullIt != pendingPulls_.end() and
+        KvStore::compareValues(announced, pullIt->second.value) != 1) {
+      // already pulling it, fall back to this peer if that fails
+      auto& announcers = pullIt->second.announcers;
+      if (std::find(announcers.begin(), announcers.end(), peerName) ==
+          announcers.end()) {
+        announcers.emplace_back(peerName);
+      }
+      continue;
+    }
+    auto& pull = pendingPulls_[kv.first];
+    pull.value = std::move(announced);
+    pull.announcers = {peerName};
+    pull.deadline =
+        std::chrono::steady_clock::now() + Constants::kLazyValuePullTimeout;
+    pullKeys.emplace_back(kv.first);
+  }
+
+  if (pullKeys.empty()) {
+    return;
+  }
+  pullValues(peerName, pullKeys);
+  if (not pendingPullTimer_->isScheduled()) {
+    pendingPullTimer_->scheduleTimeout(Constants::kLazyValuePullTimeout);
+  }
+}
+
+void
+KvStoreDb::pullValues(
+    const std::string& peerName, std::vector<std::string> const& keys) {
+  auto peerIt = peers_.find(peerName);
+  if (peerIt == peers_.end()) {
+    // the timer pulls from the next announcer
+    return;
+  }
+  auto const& peerCmdSocketId = peerIt->second.second;
+  if (thriftPeers_.count(peerCmdSocketId)) {
+    // announcements are only exchanged with ZMQ peers
+    return;
+  }
+
+  thrift::KvStoreRequest pullRequest;
+  thrift::KeySetParams params;
+  params.solicitResponse = false;
+  params.nodeIds = std::vector<std::string>{kvParams_.nodeId};
+  params.pullKeys = keys;
+  params.timestamp_ms = getUnixTimeStampMs();
+  pullRequest.cmd = thrift::Command::KEY_SET;
+  pullRequest.keySetParams = std::move(params);
+  pullRequest.area = area_;
+
+  VLOG(2) << "Pulling " << keys.size() << " values from peer " << peerName;
+  tData_.addStatValue("kvstore.lazy_value.pull_requests", 1, fbzmq::COUNT);
+  auto const ret = sendMessageToPeer(peerCmdSocketId, pullRequest);
+  if (ret.hasError()) {
+    LOG(ERROR) << "Failed to pull values from peer " << peerName
+               << " using id " << peerCmdSocketId
+               << ", error: " << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+  }
+}
+
+void
+KvStoreDb::requestKeyIdReset(const std::string& peerName) {
+  LOG(WARNING) << "Received unknown key IDs from peer " << peerName
+               << ", asking it to define them again";
+  tData_.addStatValue("kvstore.key_ids.unknown", 1, fbzmq::COUNT);
+  auto peerIt = peers_.find(peerName);
+  if (peerIt == peers_.end()) {
+    return;
+  }
+  auto const& peerCmdSocketId = peerIt->second.second;
+
+  thrift::KvStoreRequest resetRequest;
+  thrift::KeySetParams params;
+  params.solicitResponse = false;
+  params.nodeIds = std::vector<std::string>{kvParams_.nodeId};
+  params.resetKeyIds = true;
+  resetRequest.cmd = thrift::Command::KEY_SET;
+  resetRequest.keySetParams = std::move(params);
+  resetRequest.area = area_;
+  auto const ret = sendMessageToPeer(peerCmdSocketId, resetRequest);
+  if (ret.hasError()) {
+    LOG(ERROR) << "Failed to reset key IDs of peer " << peerName
+               << " using id " << peerCmdSocketId
+               << ", error: " << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+  }
+
+  // key-vals of the unknown IDs were dropped, get them with a full-sync
+  if (not peersToSyncWith_.count(peerName)) {
+    peersToSyncWith_.emplace(
+        peerName,
+        ExponentialBackoff<std::chrono::milliseconds>(
+            Constants::kInitialBackoff, Constants::kMaxBackoff));
+  }
+  if (not fullSyncTimer_->isScheduled()) {
+    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
+void
+KvStoreDb::processPendingPulls() {
+  const auto now = std::chrono::steady_clock::now();
+  auto nextDeadline = now + Constants::kLazyValuePullTimeout;
+  std::unordered_map<std::string /* node-name */, std::vector<std::string>>
+      pulls;
+  for (auto it = pendingPulls_.begin(); it != pendingPulls_.end();) {
+    auto& pull = it->second;
+    if (pull.deadline > now) {
+      nextDeadline = std::min(nextDeadline, pull.deadline);
+      ++it;
+      continue;
+    }
+    pull.announcers.pop_front();
+    if (pull.announcers.empty()) {
+      // given up, the next full-sync with a peer holding it repairs the key
+      LOG(WARNING) << "Failed to pull value of key " << it->first
+                   << " from any of its announcers";
+      tData_.addStatValue(
+          "kvstore.lazy_value.failed_pulls", 1, fbzmq::COUNT);
+      it = pendingPulls_.erase(it);
+      continue;
     }
+    tData_.addStatValue(
+        "kvstore.lazy_value.pull_fallbacks", 1, fbzmq::COUNT);
+    pull.deadline = now + Constants::kLazyValuePullTimeout;
+    pulls[pull.announcers.front()].emplace_back(it->first);
+    ++it;
+  }
+
+  for (auto const& kv : pulls) {
+    pullValues(kv.first, kv.second);
+  }
+  if (not pendingPulls_.empty()) {
+    pendingPullTimer_->scheduleTimeout(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextDeadline - now));
   }
 }
 
@@ -2191,9 +4875,8 @@ KvStoreDb::mergePublication(
     const thrift::Publication& rcvdPublication,
     std::optional<std::string> senderId) {
   // Add counters
-  tData_.addStatValue("kvstore.received_publications", 1, fbzmq::COUNT);
-  tData_.addStatValue(
-      "kvstore.received_key_vals", rcvdPublication.keyVals.size(), fbzmq::SUM);
+  receivedPublicationsStat_.addValue(1);
+  receivedKeyValsStat_.addValue(rcvdPublication.keyVals.size());
 
   const bool needFinalizeFullSync = senderId.has_value() and
       rcvdPublication.tobeUpdatedKeys.hasValue() and
@@ -2209,19 +4892,87 @@ KvStoreDb::mergePublication(
   if (nodeIds.hasValue() and
       std::find(nodeIds->begin(), nodeIds->end(), kvParams_.nodeId) !=
           nodeIds->end()) {
-    tData_.addStatValue("kvstore.looped_publications", 1, fbzmq::COUNT);
+    loopedPublicationsStat_.addValue(1);
+    return 0;
+  }
+
+  // Drop copies of an update already received from another peer. Only
+  // floods, sync responses must be merged whatever we saw
+  if (nodeIds.hasValue() and not needFinalizeFullSync and
+      not floodSeenCache_.insert(
+          FloodSeenCache::getFloodId(rcvdPublication.keyVals))) {
+    duplicatePublicationsStat_.addValue(1);
     return 0;
   }
 
+  // reject the updates of originators past their quota
+  const auto* keyVals = &rcvdPublication.keyVals;
+  std::unordered_map<std::string, thrift::Value> admittedKeyVals;
+  if (memoryTracker_.hasQuota()) {
+    const auto overQuotaKeys = getOverQuotaKeys(rcvdPublication.keyVals);
+    if (not overQuotaKeys.empty()) {
+      for (auto const& kv : rcvdPublication.keyVals) {
+        if (not overQuotaKeys.count(kv.first)) {
+          admittedKeyVals.emplace(kv);
+          continue;
+        }
+        tData_.addStatValue(
+            folly::sformat(
+                "kvstore.quota.rejected_keys.{}", kv.second.originatorId),
+            1,
+            fbzmq::SUM);
+      }
+      LOG_EVERY_N(WARNING, 100)
+          << "Rejected " << overQuotaKeys.size() << " key-vals of "
+          << "originators past their quota";
+      tData_.addStatValue(
+          "kvstore.quota.rejected_keys", overQuotaKeys.size(), fbzmq::SUM);
+      keyVals = &admittedKeyVals;
+    }
+  }
+
   // Generate delta with local KvStore
+  const auto mergeStartTime = std::chrono::steady_clock::now();
   thrift::Publication deltaPublication;
-  deltaPublication.keyVals = KvStore::mergeKeyValues(
-      kvStore_, rcvdPublication.keyVals, kvParams_.filters);
+  const auto updates = KvStore::mergeKeyValueUpdates(
+      kvStore_,
+      *keyVals,
+      kvParams_.filters,
+      kvParams_.mergeExecutor,
+      kvParams_.numMergeShards);
+  deltaPublication.keyVals.reserve(updates.size());
+  for (auto const& update : updates) {
+    auto& deltaValue = deltaPublication.keyVals
+                           .emplace(update.keyVal->first, update.keyVal->second)
+                           .first->second;
+    // flood the hash memoized with the stored value, peers needn't rehash it
+    if (deltaValue.value.hasValue()) {
+      deltaValue.hash = update.storeKeyVal->second.hash;
+    }
+    indexKeyVal(*update.storeKeyVal);
+    if (not pendingPulls_.empty()) {
+      // stop pulling values no newer than the one we now hold
+      auto pullIt = pendingPulls_.find(update.keyVal->first);
+      if (pullIt != pendingPulls_.end() and
+          KvStore::compareValues(
+              update.storeKeyVal->second, pullIt->second.value) != -1) {
+        pendingPulls_.erase(pullIt);
+      }
+    }
+    const auto* keyFamily = churnTracker_.addUpdate(
+        update.keyVal->first, update.keyVal->second.originatorId);
+    if (keyFamily) {
+      tData_.addStatValue(
+          folly::sformat("kvstore.churn.key_family.{}", *keyFamily),
+          churnTracker_.getSampleRate(),
+          fbzmq::SUM);
+    }
+  }
   deltaPublication.floodRootId = rcvdPublication.floodRootId;
   deltaPublication.area = area_;
 
   const size_t kvUpdateCnt = deltaPublication.keyVals.size();
-  tData_.addStatValue("kvstore.updated_key_vals", kvUpdateCnt, fbzmq::SUM);
+  updatedKeyValsStat_.addValue(kvUpdateCnt);
 
   // Populate nodeIds and our nodeId_ to the end
   if (rcvdPublication.nodeIds.hasValue()) {
@@ -2230,14 +4981,18 @@ KvStoreDb::mergePublication(
 
   // Update ttl values of keys
   updateTtlCountdownQueue(deltaPublication);
+  {
+    std::lock_guard<std::mutex> lock(kvParams_.sharedMutex);
+    kvParams_.latencies.addDuration(
+        KvStorePhase::MERGE, std::chrono::steady_clock::now() - mergeStartTime);
+  }
 
   if (not deltaPublication.keyVals.empty()) {
     // Flood change to all of our neighbors/subscribers
     floodPublication(std::move(deltaPublication));
   } else {
     // Keep track of received publications which din't update any field
-    tData_.addStatValue(
-        "kvstore.received_redundant_publications", 1, fbzmq::COUNT);
+    receivedRedundantPublicationsStat_.addValue(1);
   }
 
   // response to senderId with tobeUpdatedKeys + Vals
@@ -2253,30 +5008,21 @@ void
 KvStoreDb::logSyncEvent(
     const std::string& peerNodeName,
     const std::chrono::milliseconds syncDuration) {
-  fbzmq::LogSample sample{};
-  sample.addString("event", "KVSTORE_FULL_SYNC");
-  sample.addString("node_name", kvParams_.nodeId);
-  sample.addString("neighbor", peerNodeName);
-  sample.addInt("duration_ms", syncDuration.count());
-
-  fbzmq::thrift::EventLog eventLog;
-  eventLog.category = Constants::kEventLogCategory.toString();
-  eventLog.samples = {sample.toJson()};
-  kvParams_.zmqMonitorClient->addEventLog(std::move(eventLog));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString("event", "KVSTORE_FULL_SYNC");
+    record.addString("node_name", kvParams_.nodeId);
+    record.addString("neighbor", peerNodeName);
+    record.addInt("duration_ms", syncDuration.count());
+  });
 }
 
 void
 KvStoreDb::logKvEvent(const std::string& event, const std::string& key) {
-  fbzmq::LogSample sample{};
-
-  sample.addString("event", event);
-  sample.addString("node_name", kvParams_.nodeId);
-  sample.addString("key", key);
-
-  fbzmq::thrift::EventLog eventLog;
-  eventLog.category = Constants::kEventLogCategory.toString();
-  eventLog.samples = {sample.toJson()};
-  kvParams_.zmqMonitorClient->addEventLog(std::move(eventLog));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString("event", event);
+    record.addString("node_name", kvParams_.nodeId);
+    record.addString("key", key);
+  });
 }
 
 bool
@@ -2291,6 +5037,9 @@ KvStoreDb::sendDualMessages(
   dualRequest.cmd = thrift::Command::DUAL;
   dualRequest.dualMessages = msgs;
   dualRequest.area = area_;
+  tData_.addStatValue("kvstore.dual.sent_batches", 1, fbzmq::COUNT);
+  tData_.addStatValue(
+      "kvstore.dual.messages_per_batch", msgs.messages.size(), fbzmq::AVG);
   const auto ret = sendMessageToPeer(neighborCmdSocketId, dualRequest);
   // NOTE: we rely on zmq (on top of tcp) to reliably deliver message,
   // if we switch to other protocols, we need to make sure its reliability.
@@ -2307,4 +5056,16 @@ KvStoreDb::sendDualMessages(
   return true;
 }
 
+bool
+KvStoreDb::scheduleDualMessagesFlush() noexcept {
+  evb_->getEvb()->runInLoop(
+      [this, guard = std::weak_ptr<folly::Unit>(thriftRequestGuard_)]() {
+        if (guard.expired()) {
+          return;
+        }
+        flushDualMessages();
+      });
+  return true;
+}
+
 } // namespace openr
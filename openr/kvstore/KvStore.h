@@ -7,19 +7,31 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-#include <boost/heap/priority_queue.hpp>
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Optional.h>
+#include <folly/Synchronized.h>
 #include <folly/TokenBucket.h>
+#include <folly/compression/Compression.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -27,35 +39,26 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/OpenrClient.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/RuntimeKnobs.h>
+#include <openr/common/ThreadLocalStats.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
+#include <openr/common/XpubSubscriptions.h>
 #include <openr/dual/Dual.h>
 #include <openr/if/gen-cpp2/Dual_types.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/FloodSeenCache.h>
+#include <openr/kvstore/KeyIdDictionary.h>
+#include <openr/kvstore/KvStoreExport.h>
+#include <openr/kvstore/KvStoreProfiler.h>
+#include <openr/kvstore/TtlCountdownQueue.h>
 #include <openr/messaging/ReplicateQueue.h>
 
 namespace openr {
 
-struct TtlCountdownQueueEntry {
-  std::chrono::steady_clock::time_point expiryTime;
-  std::string key;
-  int64_t version{0};
-  int64_t ttlVersion{0};
-  std::string originatorId;
-  bool
-  operator>(TtlCountdownQueueEntry other) const {
-    return expiryTime > other.expiryTime;
-  }
-};
-
-using TtlCountdownQueue = boost::heap::priority_queue<
-    TtlCountdownQueueEntry,
-    // Always returns smallest first
-    boost::heap::compare<std::greater<TtlCountdownQueueEntry>>,
-    boost::heap::stable<true>>;
-
 // Kvstore flooding rate <messages/sec, burst size>
 using KvStoreFloodRate = std::optional<std::pair<const size_t, const size_t>>;
 
@@ -76,6 +79,13 @@ class KvStoreFilters {
   // return set of origninator IDs
   std::set<std::string> getOrigniatorIdList() const;
 
+  // true if key prefixes are plain strings rather than regexes, in which case
+  // matching keys can be looked up in an ordered index of keys
+  bool
+  hasLiteralKeyPrefixes() const {
+    return literalKeyPrefixes_;
+  }
+
   // print filters
   std::string str() const;
 
@@ -83,6 +93,9 @@ class KvStoreFilters {
   // list of string prefixes, empty list matches all keys
   std::vector<std::string> keyPrefixList_{};
 
+  // whether none of the key prefixes contain regex special characters
+  bool literalKeyPrefixes_{true};
+
   // set of node IDs to match, empty set matches all nodes
   std::set<std::string> originatorIds_{};
 
@@ -90,16 +103,22 @@ class KvStoreFilters {
   KeyPrefix keyPrefixObjList_;
 };
 
+// KvStore update as read from the updates queue. A single immutable
+// publication is shared by all readers
+using KvStorePublicationPtr = std::shared_ptr<const thrift::Publication>;
+
 // structure for common params across all instances of KvStoreDb
 struct KvStoreParams {
   // the name of this node (unique in domain)
   std::string nodeId;
 
   // Queue for publishing KvStore updates to other modules within a process
-  messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<KvStorePublicationPtr>& kvStoreUpdatesQueue;
 
-  // the socket to publish changes to kv-store
-  fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER> localPubSock;
+  // the socket to publish changes to kv-store, and its subscribers.
+  // Publications are only encoded for it while someone subscribed
+  fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER> localPubSock;
+  XpubSubscriptions localPubSubscriptions;
   fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER> globalPubSock;
   // socket for remote & local commands
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> globalCmdSock;
@@ -115,16 +134,51 @@ struct KvStoreParams {
   std::optional<KvStoreFilters> filters;
   // Kvstore flooding rate
   KvStoreFloodRate floodRate = std::nullopt;
+  // key prefixes of flood classes in decreasing priority, other keys are of
+  // the lowest class. Each class is rate limited at floodRate on its own
+  std::vector<std::string> floodPriorityKeyPrefixes;
+  // limits on the keys of each originator, updates past them are rejected
+  KvStoreQuota quota;
   // TTL decrement factor
   std::chrono::milliseconds ttlDecr{Constants::kTtlDecrement};
   bool enableFloodOptimization{false};
   bool isFloodRoot{false};
   bool useFloodOptimization{false};
   std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient{nullptr};
+  // workers merging large publications in parallel, sharded by key hash.
+  // Publications are merged on the KvStore thread if not set
+  folly::Executor* mergeExecutor{nullptr};
+  size_t numMergeShards{1};
+  // talk to peers with an OpenrCtrl thrift port over thrift instead of ZMQ
+  bool enableThriftPeers{false};
+  // originate floods along the SPTs of all ready flood roots, picked by key
+  // hash, rather than along the SPT of the smallest root only
+  bool enableMultiRootFlooding{false};
+  // latencies of merges, floods and full-syncs of all areas
+  KvStoreLatencies latencies{Constants::kKvStoreLatencyWindowSize};
+  // key-values of each area are mirrored to a memory mapped file at
+  // <exportPathPrefix>.<area> for local readers. Disabled if empty
+  std::string exportPathPrefix;
+  // values of at least lazyValueThreshold bytes are only announced to peers
+  // accepting announcements, which pull them once. Disabled if 0
+  size_t lazyValueThreshold{0};
+  // split the key space among the peers synced with at once when bulk
+  // syncing, pulling each range from one peer
+  bool partitionedFullSync{false};
+  // knobs tunable at runtime, read instead of dbSyncInterval, ttlDecr and
+  // floodRate they are initialized to. The flood rate knobs are 0 if
+  // flooding isn't rate limited
+  RuntimeKnobs::Knob dbSyncIntervalS;
+  RuntimeKnobs::Knob ttlDecrMs;
+  RuntimeKnobs::Knob floodMsgPerSec;
+  RuntimeKnobs::Knob floodMsgBurstSize;
+  // guards localPubSock, localPubSubscriptions and latencies, which areas
+  // running on event bases of their own share
+  std::mutex sharedMutex;
 
   KvStoreParams(
       std::string nodeid,
-      messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+      messaging::ReplicateQueue<KvStorePublicationPtr>& kvStoreUpdatesQueue,
       fbzmq::Context& zmqContext,
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> globalCmdSock,
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> inprocCmdSock,
@@ -144,7 +198,11 @@ struct KvStoreParams {
       bool usefloodOptimization)
       : nodeId(nodeid),
         kvStoreUpdatesQueue(kvStoreUpdatesQueue),
-        localPubSock(zmqContext),
+        localPubSock(
+            zmqContext,
+            folly::none,
+            folly::none,
+            fbzmq::NonblockingFlag{true}),
         globalCmdSock(std::move(globalCmdSock)),
         inprocCmdSock(std::move(inprocCmdSock)),
         zmqHwm(zmqhwm),
@@ -155,7 +213,11 @@ struct KvStoreParams {
         ttlDecr(ttldecr),
         enableFloodOptimization(enablefloodOptimization),
         isFloodRoot(isfloodRoot),
-        useFloodOptimization(usefloodOptimization) {}
+        useFloodOptimization(usefloodOptimization),
+        dbSyncIntervalS(dbSyncInterval.count()),
+        ttlDecrMs(ttlDecr.count()),
+        floodMsgPerSec(floodRate.has_value() ? floodRate->first : 0),
+        floodMsgBurstSize(floodRate.has_value() ? floodRate->second : 0) {}
 };
 
 // The class represents a KV Store DB and stores KV pairs in internal map.
@@ -174,12 +236,23 @@ class KvStoreDb : public DualNode {
       const std::string& nodeId,
       std::unordered_map<std::string, thrift::PeerSpec> peers);
 
+  // leadingChunks of a full-sync response split into chunks are to be sent
+  // to the requester before the returned response
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsgHelper(
-      thrift::KvStoreRequest& thriftReq);
+      thrift::KvStoreRequest& thriftReq,
+      std::vector<fbzmq::Message>& leadingChunks);
+
+  // respond to a KEY_DUMP request, received over ZMQ or thrift
+  folly::Expected<thrift::Publication, fbzmq::Error> processKeyDump(
+      thrift::KeyDumpParams const& keyDumpParams);
 
   // Extracts the counters and submit them to monitor
   std::unordered_map<std::string, int64_t> getCounters();
 
+  // drop state only kept to save work, e.g. sync watermarks of removed
+  // peers, and shrink hash tables which got smaller
+  void shedMemory();
+
   // get multiple keys at once
   thrift::Publication getKeyVals(std::vector<std::string> const& keys);
 
@@ -187,16 +260,62 @@ class KvStoreDb : public DualNode {
   // if prefix is the empty sting, the full KV store is dumped
   thrift::Publication dumpAllWithFilters(KvStoreFilters const& kvFilters) const;
 
+  // dump the entries of my KV store whose keys match the given filters and
+  // lie in one of the buckets of the given level
+  thrift::Publication dumpAllWithFilters(
+      KvStoreFilters const& kvFilters,
+      int32_t level,
+      std::unordered_set<int64_t> const& buckets) const;
+
+  // dump at most maxKeys entries of my KV store whose keys match the given
+  // filters, in key order and after cursor if set. The cursor of the
+  // publication is set to its last key if more keys match
+  thrift::Publication dumpPageWithFilters(
+      KvStoreFilters const& kvFilters,
+      std::optional<std::string> const& cursor,
+      size_t maxKeys) const;
+
+  // dump the entries of my KV store whose keys match the given filters and
+  // changed after the given sequence number
+  thrift::Publication dumpChangesWithFilters(
+      KvStoreFilters const& kvFilters, int64_t seqNum) const;
+
   // dump the hashes of my KV store whose keys match the given prefix
   // if prefix is the empty sting, the full hash store is dumped
   thrift::Publication dumpHashWithFilters(
       KvStoreFilters const& kvFilters) const;
 
+  // dump the hashes of my KV store whose keys match the given filters and
+  // lie in one of the buckets of the given level
+  thrift::Publication dumpHashWithFilters(
+      KvStoreFilters const& kvFilters,
+      int32_t level,
+      std::unordered_set<int64_t> const& buckets) const;
+
+  // same as dumpAllWithFilters, or dumpHashWithFilters if hashesOnly, served
+  // from the last dump with the same filters patched with the keys changed
+  // since, unless keys got erased meanwhile
+  thrift::Publication dumpWithFiltersCached(
+      KvStoreFilters const& kvFilters, bool hashesOnly);
+
   // dump the keys on which hashes differ from given keyVals
   thrift::Publication dumpDifference(
       std::unordered_map<std::string, thrift::Value> const& myKeyVal,
       std::unordered_map<std::string, thrift::Value> const& reqKeyVal) const;
 
+  // digests of the buckets of level holding keys which match the given
+  // filters. Only children of parentBuckets are covered, if given
+  std::map<int64_t, int64_t> getBucketDigests(
+      KvStoreFilters const& kvFilters,
+      int32_t level,
+      std::unordered_set<int64_t> const* parentBuckets) const;
+
+  // respond to a bucket digest full-sync request with the digests of the
+  // children of the buckets on which our digests differ
+  folly::Expected<thrift::Publication, fbzmq::Error> dumpBucketDigests(
+      KvStoreFilters const& kvFilters,
+      thrift::KeyBucketDigests const& reqDigests) const;
+
   // Merge received publication with local store and publish out the delta.
   // If senderId is set, will build <key:value> map from kvStore_ and
   // rcvdPublication.tobeUpdatedKeys and send back to senderId to update it
@@ -227,6 +346,12 @@ class KvStoreDb : public DualNode {
   // get current snapshot of SPT(s) information
   thrift::SptInfos processFloodTopoGet() noexcept;
 
+  // heaviest key families, originators and keys updated recently
+  thrift::KvStoreChurnStats
+  getChurnStats() const {
+    return churnTracker_.getStats(Constants::kKvStoreChurnTopK);
+  }
+
  private:
   // disable copying
   KvStoreDb(KvStoreDb const&) = delete;
@@ -244,6 +369,10 @@ class KvStoreDb : public DualNode {
       const std::string& neighbor,
       const thrift::DualMessages& msgs) noexcept override;
 
+  // hold dual messages of all roots back until the end of the event loop
+  // turn and send them as one batch per neighbor
+  bool scheduleDualMessagesFlush() noexcept override;
+
   // send topology-set command to peer, peer will set/unset me as child
   // rootId: action will applied on given rootId
   // peerName: peer name
@@ -273,6 +402,24 @@ class KvStoreDb : public DualNode {
       const std::optional<std::string>& oldNh,
       const std::optional<std::string>& newNh) noexcept override;
 
+  // call fn on the entries of kvStore_ matching the filters. Filters made of
+  // literal key prefixes and/or originator IDs are served from the key
+  // indexes without scanning kvStore_
+  void forEachKeyVal(
+      KvStoreFilters const& kvFilters,
+      std::function<void(std::string const&, thrift::Value const&)> const& fn)
+      const;
+
+  // add or update the key indexes with an entry of kvStore_
+  void indexKeyVal(std::pair<const std::string, thrift::Value> const& kv);
+
+  // remove an entry of kvStore_ from the key indexes, before erasing it
+  void unindexKeyVal(std::pair<const std::string, thrift::Value> const& kv);
+
+  // keys of keyVals whose originator would exceed its quota by merging them
+  std::unordered_set<std::string> getOverQuotaKeys(
+      std::unordered_map<std::string, thrift::Value> const& keyVals) const;
+
   // get flooding peers for a given spt-root-id
   // if rootId is none => flood to all physical peers
   // else only flood to formed SPT-peers for rootId
@@ -296,6 +443,9 @@ class KvStoreDb : public DualNode {
   // periodically count down and purge expired keys from CountdownQueue
   void cleanupTtlCountdownQueue();
 
+  // schedule ttlCountdownTimer_ for the next expiry of ttlCountdownQueue_
+  void scheduleTtlCountdownTimer();
+
   // Function to flood publication to neighbors
   // publication => data element to flood
   // rateLimit => if 'false', publication will not be rate limited
@@ -305,15 +455,94 @@ class KvStoreDb : public DualNode {
       bool rateLimit = true,
       bool setFloodRoot = true);
 
+  // send key-vals of a publication, with our node-id appended to its
+  // node-ids, to flood peers of its flood-root-id except senderId
+  void sendFloodPublication(
+      thrift::Publication&& publication,
+      const std::optional<std::string>& senderId);
+
+  // capabilities of a peer deciding the form of the flood requests it gets,
+  // as told in its full-sync responses. compact and lazy are only set for
+  // publications with TTL updates and large values respectively
+  struct FloodCapabilities {
+    bool compress{false};
+    bool compact{false};
+    bool lazy{false};
+    bool keyIds{false};
+
+    bool
+    operator<(FloodCapabilities const& other) const {
+      return std::tie(compress, compact, lazy, keyIds) <
+          std::tie(other.compress, other.compact, other.lazy, other.keyIds);
+    }
+  };
+
+  // flood request of a publication in the form accepted by peers of some
+  // capabilities, built once for all of them
+  struct FloodRequest {
+    thrift::KvStoreRequest request;
+    // IDs of the keys of request, if keyIds
+    std::vector<int32_t> keyIds;
+  };
+  using FloodRequests = std::map<FloodCapabilities, FloodRequest>;
+
+  // flood request for peers of caps, compression aside. Built from the one
+  // with a capability less, which floodRequests has at least without any
+  // capability, and added to floodRequests
+  FloodRequest& getFloodRequest(
+      FloodRequests& floodRequests, FloodCapabilities caps);
+
   // perform last step as a 3-way full-sync request
   // full-sync initiator sends back key-val to senderId (where we made
   // full-sync request to) who need to update those keys
   void finalizeFullSync(
       const std::vector<std::string>& keys, const std::string& senderId);
 
+  // KEY_DUMP params of full-sync requests, without hashes or digests
+  thrift::KeyDumpParams getFullSyncDumpParams() const;
+
+  // current position in the change sequence of kvStore_
+  thrift::KvStoreWatermark getWatermark() const;
+
+  // range of level 1 buckets of a partitioned full-sync
+  struct SyncRange {
+    std::unordered_set<int64_t> buckets;
+    // peers which failed to sync the range
+    std::unordered_set<std::string /* node-name */> failedPeers;
+  };
+
+  // split the buckets of the key space among the peers ready to full-sync
+  // with, and pull each range from one of them. Only for bulk syncs with
+  // several peers. Returns false if not done
+  bool requestPartitionedFullSync();
+
+  // pull the keys of a range of buckets from a peer. Returns false if the
+  // request couldn't be sent
+  bool sendRangeSync(const std::string& peerName, SyncRange&& range);
+
+  // give up on the range pulled from a peer, to be pulled from another one.
+  // The peer is full-synced with again if resync
+  void failRangeSync(const std::string& peerCmdSocketId, bool resync);
+
+  // pull ranges of failed peers from other peers, and once all ranges are
+  // pulled reconcile with a regular full-sync with the last peer
+  void assignOrphanRanges();
+
+  // continue full-sync with the bucket digests received from the peer.
+  // Requests either the next level of digests or, on the last level, the keys
+  // of the buckets on which digests differ.
+  // Returns false if the peer is in sync with us
+  bool continueBucketSync(
+      const std::string& peerCmdSocketId,
+      thrift::KeyBucketDigests const& peerDigests);
+
   // process received KV_DUMP from one of our neighbor
   void processSyncResponse() noexcept;
 
+  // process the full-sync response publication of a peer
+  void processSyncPublication(
+      const std::string& requestId, thrift::Publication const& syncPub);
+
   // randomly request sync from one connected neighbor
   void requestSync();
 
@@ -328,16 +557,108 @@ class KvStoreDb : public DualNode {
   // Submit events to monitor
   void logKvEvent(const std::string& event, const std::string& key);
 
-  // buffer publications blocked by the rate limiter
-  void bufferPublication(thrift::Publication&& publication);
+  // index in floodClasses_ of the class of key
+  size_t getFloodClass(const std::string& key) const;
+
+  // split a publication into publications of the keys of each flood class,
+  // indexed by class. All of them are of the only class if there's one
+  std::vector<thrift::Publication> splitByFloodClass(
+      thrift::Publication&& publication) const;
+
+  // buffer publications of a flood class blocked by its rate limiter
+  void bufferPublication(size_t floodClass, thrift::Publication&& publication);
+
+  // flood pending update of a flood class blocked by its rate limiter
+  void floodBufferedUpdates(size_t floodClass);
+
+  // flood pending updates of classes whose rate limiter allows it, in
+  // decreasing priority. Returns true if updates are still pending
+  bool floodBufferedUpdates();
+
+  // reset the rate limiters of floodClasses_ if the flood rate was tuned
+  void updateFloodRate();
+
+  // coalesce keys which couldn't be flooded to a peer into its flood queue
+  void enqueuePeerFloodKeys(
+      const std::string& peer,
+      const std::optional<std::string>& floodRootId,
+      const thrift::KeyVals& keyVals);
+
+  // send the latest values of the keys pending in the flood queue of a peer.
+  // The queue is removed once all of its keys are sent
+  void flushPeerFloodQueue(const std::string& peer);
+
+  // schedule the flush of peer flood queues on the earliest backoff expiry
+  void schedulePeerFloodQueueTimer();
+
+  // move key-vals with values of at least lazyValueThreshold bytes from the
+  // keyVals of a flood request to its announcements, without their values
+  void announceLazyValues(thrift::KeySetParams& params) const;
+
+  // process the value announcements of a peer. Refreshes of values we hold
+  // are added to keyVals as TTL updates, newer values are pulled
+  void processValueAnnouncements(
+      const std::string& peerName,
+      thrift::KeyVals&& announcements,
+      thrift::KeyVals& keyVals);
+
+  // ask a peer to send back the values of keys
+  void pullValues(
+      const std::string& peerName, std::vector<std::string> const& keys);
+
+  // pull values not received in time from their next announcer, pulls
+  // without any announcer left are given up on
+  void processPendingPulls();
+
+  // ask a peer which sent us unknown key IDs to define them again, and
+  // full-sync with it for the key-vals dropped
+  void requestKeyIdReset(const std::string& peerName);
 
-  // flood pending update blocked by rate limiter
-  void floodBufferedUpdates(void);
+  // Send message via socket, compressed if the peer accepts it
+  folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
+      const std::string& peerSocketId, const thrift::KvStoreRequest& request);
 
-  // Send message via socket
+  // Send already serialized request via socket. Message buffers are reference
+  // counted, the same message can be sent to many peers without copies
   folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
+      const std::string& peerSocketId, const fbzmq::Message& msg);
+
+  // true if we talk to the peer over thrift rather than ZMQ
+  bool useThriftPeer(thrift::PeerSpec const& peerSpec) const;
+
+  // send request to a thrift peer as the matching OpenrCtrl RPC. Responses
+  // are processed, and failures handled, asynchronously on our event base.
+  // Only fails if the peer can't be connected to
+  folly::Expected<size_t, fbzmq::Error> sendThriftRequestToPeer(
       const std::string& peerSocketId, const thrift::KvStoreRequest& request);
 
+  // handle a failed RPC to a thrift peer. The connection is reset and the
+  // peer is fully synced again, which also covers failed floods
+  void processThriftPeerError(
+      const std::string& peerSocketId,
+      thrift::Command cmd,
+      folly::exception_wrapper const& ew);
+
+  // zstd compress a serialized payload. None if compression isn't available
+  // or the payload is smaller than Constants::kKvStoreCompressionMinBytes
+  folly::Optional<std::string> compressPayload(std::string const& payload);
+
+  // decompress a payload compressed by a peer
+  folly::Optional<std::string> decompressPayload(std::string const& payload);
+
+  // serialize a request, wrapped compressed if compress is set and the
+  // request is large enough
+  fbzmq::Message serializeRequest(
+      thrift::KvStoreRequest const& request, bool compress);
+
+  // serialize a response publication, wrapped compressed if the requester
+  // accepts it and the publication is large enough
+  folly::Expected<fbzmq::Message, fbzmq::Error> serializeResponse(
+      thrift::Publication& publication, bool acceptCompressed);
+
+  // replace a compressed request with the request it wraps
+  bool decompressRequest(thrift::KvStoreRequest& request);
+
   //
   // Private variables
   //
@@ -347,6 +668,9 @@ class KvStoreDb : public DualNode {
   // zmq ROUTER socket for requesting full dumps from peers
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> peerSyncSock_;
 
+  // epoch of the change sequence of kvStore_, random per instance
+  const int64_t epoch_{0};
+
   //
   // Mutable state
   //
@@ -374,6 +698,53 @@ class KvStoreDb : public DualNode {
   // store keys mapped to (version, originatoId, value)
   std::unordered_map<std::string, thrift::Value> kvStore_;
 
+  // indexes of kvStore_ entries by key, ordered to serve key prefix lookups,
+  // and by originatorId. Keys are views of the kvStore_ keys, entries of an
+  // unordered_map never move. keyIndex_ also holds the originatorId each key
+  // is indexed under in originatorIndex_
+  struct IndexedKeyVal {
+    std::pair<const std::string, thrift::Value> const* kv{nullptr};
+    std::string originatorId;
+    // position of the last change of the key in seqIndex_
+    int64_t seqNum{0};
+    // accounted in memoryTracker_
+    size_t bytes{0};
+  };
+  std::map<std::string_view, IndexedKeyVal> keyIndex_;
+  std::unordered_map<
+      std::string,
+      std::map<
+          std::string_view,
+          std::pair<const std::string, thrift::Value> const*>>
+      originatorIndex_;
+
+  // keys and bytes held by originator and key family, maintained along with
+  // keyIndex_
+  KvStoreMemoryTracker memoryTracker_{kvParams_.quota};
+
+  // memory mapped mirror of kvStore_, maintained along with keyIndex_. Null
+  // if disabled or if it failed
+  std::unique_ptr<KvStoreExporter> exporter_;
+
+  // change sequence of kvStore_ entries, each indexed under the sequence
+  // number of its last change. Serves delta full-syncs of reconnecting peers
+  int64_t seqNum_{0};
+  std::map<int64_t, std::pair<const std::string, thrift::Value> const*>
+      seqIndex_;
+
+  // number of keys erased from kvStore_, changes seqIndex_ doesn't tell
+  int64_t numErasedKeys_{0};
+
+  // results of dumpWithFiltersCached by kind and filters, as of seqNum_ and
+  // numErasedKeys_ when they were last brought up to date
+  struct CachedDump {
+    std::unordered_map<std::string, thrift::Value> keyVals;
+    int64_t seqNum{0};
+    int64_t numErasedKeys{0};
+  };
+  folly::EvictingCacheMap<std::string, CachedDump> dumpCache_{
+      Constants::kKvStoreDumpCacheSize};
+
   // TTL count down queue
   TtlCountdownQueue ttlCountdownQueue_;
 
@@ -383,6 +754,33 @@ class KvStoreDb : public DualNode {
   // Data-struct for maintaining stats/counters
   fbzmq::ThreadData tData_;
 
+  // stats of the flooding and merging of publications, without the string
+  // keyed lookups of tData_
+  ThreadLocalStats stats_;
+  ThreadLocalStats::Stat duplicatePublicationsStat_;
+  ThreadLocalStats::Stat floodBytesSentStat_;
+  ThreadLocalStats::Stat floodBytesSerializedStat_;
+  ThreadLocalStats::Stat floodCompactTtlUpdatesStat_;
+  ThreadLocalStats::Stat loopedPublicationsStat_;
+  ThreadLocalStats::Stat receivedKeyValsStat_;
+  ThreadLocalStats::Stat receivedPublicationsStat_;
+  ThreadLocalStats::Stat receivedRedundantPublicationsStat_;
+  ThreadLocalStats::Stat sentKeyValsStat_;
+  ThreadLocalStats::Stat sentPublicationsStat_;
+  ThreadLocalStats::Stat updatedKeyValsStat_;
+
+  // sampled churn of keys, by key family, originator and key
+  KvStoreChurnTracker churnTracker_{
+      Constants::kKvStoreChurnSampleRate,
+      Constants::kKvStoreChurnSketchSize,
+      Constants::kKvStoreChurnMaxKeyFamilies,
+      Constants::kKvStoreChurnDecayInterval};
+
+  // flood identifiers of the publications received lately, copies of them
+  // flooded by other peers are dropped
+  FloodSeenCache floodSeenCache_{
+      Constants::kFloodSeenCacheTtl, Constants::kFloodSeenCacheMaxSize};
+
   // Map of latest peer sync up request send to each peer
   // this is used to measure full-dump sync time between this node and each of
   // its peers
@@ -391,8 +789,93 @@ class KvStoreDb : public DualNode {
       std::chrono::time_point<std::chrono::steady_clock>>
       latestSentPeerSync_;
 
-  // Kvstore rate limiter
-  std::unique_ptr<folly::BasicTokenBucket<>> floodLimiter_{nullptr};
+  // peers with a pending bucket digest full-sync. Peers responding to it with
+  // a plain full dump don't support bucket digests
+  std::unordered_set<std::string /* socket-id */> pendingBucketSyncs_;
+
+  // full-syncs in progress with peers supporting watermarks or which we
+  // delta sync with
+  struct PendingSync {
+    std::string peerName;
+    // our sequence number when requested
+    int64_t localSeqNum{0};
+    // delta full-sync since the watermark of the previous full-sync
+    bool delta{false};
+    // watermark of the first response of the peer
+    folly::Optional<thrift::KvStoreWatermark> peerWatermark;
+    // leading chunks of the response merged so far
+    size_t numChunks{0};
+    size_t numChunkKeyVals{0};
+  };
+  std::unordered_map<std::string /* socket-id */, PendingSync> pendingSyncs_;
+
+  // ranges of level 1 buckets of a partitioned full-sync, each pulled from a
+  // peer, by peer. Ranges of failed peers are orphaned until pulled from
+  // another peer
+  std::unordered_map<std::string /* socket-id */, SyncRange> rangeSyncs_;
+  std::vector<SyncRange> orphanRanges_;
+
+  // last peer which synced a range, reconciled with once all are pulled
+  folly::Optional<std::string /* node-name */> reconcilePeer_;
+
+  // watermarks of the last full-sync with each peer, kept across peer
+  // removals: the peer's store as received, and ours as known by the peer
+  struct SyncWatermark {
+    thrift::KvStoreWatermark peerWatermark;
+    int64_t localSeqNum{0};
+  };
+  std::unordered_map<std::string /* node-name */, SyncWatermark>
+      syncWatermarks_;
+
+  // reconnected peers to delta sync with instead of fully syncing
+  std::unordered_set<std::string /* node-name */> deltaSyncPeers_;
+
+  // zstd codec, null if not available in which case we neither send nor
+  // accept compressed payloads
+  std::unique_ptr<folly::io::Codec> codec_{nullptr};
+
+  // peers which accept compressed requests, as told in their full-sync
+  // responses
+  std::unordered_set<std::string /* socket-id */> compressionPeers_;
+
+  // peers which accept bucket digest full-sync requests, as told in their
+  // full-sync responses. Others get keyValHashes
+  std::unordered_set<std::string /* socket-id */> bucketSyncPeers_;
+
+  // peers which accept compact TTL refreshes, as told in their full-sync
+  // responses
+  std::unordered_set<std::string /* socket-id */> ttlUpdatePeers_;
+
+  // peers we talk to over thrift, connected on first request. Requests are
+  // multiplexed over a single TCP connection per peer
+  struct ThriftPeer {
+    std::string peerName;
+    thrift::PeerSpec peerSpec;
+    std::unique_ptr<thrift::OpenrCtrlCppAsyncClient> client{nullptr};
+    // backoff of full-syncs following failed requests, reset on sync
+    ExponentialBackoff<std::chrono::milliseconds> backoff{
+        Constants::kInitialBackoff, Constants::kMaxBackoff};
+  };
+  std::unordered_map<std::string /* socket-id */, ThriftPeer> thriftPeers_;
+
+  // classes of keys flooded at the rate limit of their own, in decreasing
+  // priority. Keys wait in the buffer of their class while its limiter is
+  // out of tokens or a higher class has keys waiting. Empty if flooding is
+  // not rate limited
+  struct FloodClass {
+    // keys of the class start with it, matches all keys in the last class
+    std::string keyPrefix;
+    std::unique_ptr<folly::BasicTokenBucket<>> limiter{nullptr};
+    // pending keys to flood publication
+    // map<flood-root-id: set<keys>>
+    std::unordered_map<
+        std::optional<std::string>,
+        std::unordered_set<std::string>>
+        buffer;
+  };
+  std::vector<FloodClass> floodClasses_;
+  // <messages/sec, burst size> of the rate limiters of floodClasses_
+  std::pair<int64_t, int64_t> floodRate_{0, 0};
 
   // timer to send pending kvstore publication
   std::unique_ptr<fbzmq::ZmqTimeout> pendingPublicationTimer_{nullptr};
@@ -400,19 +883,68 @@ class KvStoreDb : public DualNode {
   // timer for requesting full-sync
   std::unique_ptr<folly::AsyncTimeout> requestSyncTimer_{nullptr};
 
-  // pending keys to flood publication
-  // map<flood-root-id: set<keys>>
-  std::
-      unordered_map<std::optional<std::string>, std::unordered_set<std::string>>
-          publicationBuffer_{};
-
-  // max parallel syncs allowed. It's initialized with '2' and doubles
-  // up to a max value of kMaxFullSyncPendingCountThresholdfor each full sync
-  // response received
-  int32_t fullSycnReqInProgress_{2};
+  // outbound flood queue of a peer to which a flood failed, e.g. because its
+  // socket reached the high-water mark. Keys are coalesced until the queue
+  // is flushed, only their latest value is then sent. Floods towards a peer
+  // with a queue are added to it instead of being sent right away
+  struct PeerFloodQueue {
+    // map<flood-root-id: set<keys>>
+    std::unordered_map<
+        std::optional<std::string>,
+        std::unordered_set<std::string>>
+        keys;
+    size_t numKeys{0};
+    // flushes are retried with exponential backoff while they fail
+    ExponentialBackoff<std::chrono::milliseconds> backoff{
+        Constants::kFloodPeerQueueInitialBackoff,
+        Constants::kFloodPeerQueueMaxBackoff};
+  };
+  std::unordered_map<std::string /* node-name */, PeerFloodQueue>
+      peerFloodQueues_;
+
+  // timer to flush peer flood queues
+  std::unique_ptr<folly::AsyncTimeout> peerFloodQueueTimer_{nullptr};
+
+  // peers which accept value announcements, as told in their full-sync
+  // responses
+  std::unordered_set<std::string /* socket-id */> lazyValuePeers_;
+
+  // announced values being pulled, from the first of their announcers until
+  // deadline and from the next one on timeout
+  struct PendingPull {
+    // announced value, without its value
+    thrift::Value value;
+    std::deque<std::string /* node-name */> announcers;
+    std::chrono::steady_clock::time_point deadline;
+  };
+  std::unordered_map<std::string /* key */, PendingPull> pendingPulls_;
+
+  // timer to pull values not received in time
+  std::unique_ptr<folly::AsyncTimeout> pendingPullTimer_{nullptr};
+
+  // peers which accept key IDs, as told in their full-sync responses
+  std::unordered_set<std::string /* socket-id */> keyIdPeers_;
+
+  // key IDs of our floods, and of the floods of peers
+  KeyIdEncoder keyIdEncoder_{Constants::kKvStoreMaxKeyIds};
+  KeyIdDecoder keyIdDecoder_;
+
+  // max parallel syncs allowed. It's initialized with '2' and doubles up to
+  // kMaxFullSyncPendingCountThreshold for each full sync completing no slower
+  // than on average, and halves down to kMinFullSyncPendingCountThreshold
+  // for each one taking more than twice as long
+  int32_t fullSycnReqInProgress_{Constants::kMinFullSyncPendingCountThreshold};
+
+  // moving average of full-sync durations, 0 until one completes
+  double fullSyncDurationMs_{0};
 
   // event loop
   OpenrEventBase* evb_{nullptr};
+
+  // thrift peer and event loop callbacks are skipped once the guard is
+  // destroyed, they may complete after us. Keep last
+  std::shared_ptr<folly::Unit> thriftRequestGuard_{
+      std::make_shared<folly::Unit>()};
 };
 
 // The class represent a server on either the thrift server port or the
@@ -430,7 +962,7 @@ class KvStore final : public OpenrEventBase {
       // the name of this node (unique in domain)
       std::string nodeId,
       // Queue for publishing kvstore updates
-      messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+      messaging::ReplicateQueue<KvStorePublicationPtr>& kvStoreUpdatesQueue,
       // the url we use to publish our updates to
       // local subscribers
       KvStoreLocalPubUrl localPubUrl,
@@ -459,7 +991,52 @@ class KvStore final : public OpenrEventBase {
       bool isFloodRoot = false,
       bool useFloodOptimization = false,
       const std::unordered_set<std::string>& areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      // number of threads merging large publications, partitioned by key
+      size_t numMergeShards = 1,
+      // file to snapshot the KvStore to, periodically and on destruction, and
+      // to pre-populate it from on start. Disabled if empty
+      std::string snapshotFilePath = "",
+      std::chrono::seconds snapshotInterval =
+          Constants::kKvStoreSnapshotInterval,
+      // talk to peers with an OpenrCtrl thrift port over thrift
+      bool enableThriftPeers = false,
+      // spread originated floods across the SPTs of all flood roots
+      bool enableMultiRootFlooding = false,
+      // key prefixes of flood classes in decreasing priority, see
+      // KvStoreParams
+      std::vector<std::string> floodPriorityKeyPrefixes = {},
+      // limits on the keys of each originator, none by default
+      KvStoreQuota quota = {},
+      // mirror key-values of areas to memory mapped files, see KvStoreParams
+      std::string exportPathPrefix = "",
+      // announce values of at least that many bytes rather than flooding
+      // them, see KvStoreParams. Disabled if 0
+      size_t lazyValueThreshold = 0,
+      // split full-syncs with several peers by key range, see KvStoreParams
+      bool partitionedFullSync = false,
+      // registry of the sync, TTL and flood knobs tunable at runtime. Fixed
+      // if null
+      RuntimeKnobs* runtimeKnobs = nullptr,
+      // run the KvStoreDb of each area on an event base thread of its own,
+      // so that churn in an area doesn't delay the others
+      bool enableAreaEventBases = false);
+
+  // Destructor will try to snapshot the KvStore to disk
+  ~KvStore() override;
+
+  // area event bases are started along with ours and stopped after it
+  void run() override;
+  void stop() override;
+
+  using KeyValPtr = const std::pair<const std::string, thrift::Value>*;
+
+  // key-value merged into a store: the update as received, and the entry of
+  // the store it got merged into. Entries stay valid until erased
+  struct MergeUpdate {
+    KeyValPtr keyVal{nullptr};
+    std::pair<const std::string, thrift::Value>* storeKeyVal{nullptr};
+  };
 
   // process the key-values publication, and attempt to
   // merge it in existing map (first argument)
@@ -469,6 +1046,25 @@ class KvStore final : public OpenrEventBase {
       std::unordered_map<std::string, thrift::Value> const& update,
       std::optional<KvStoreFilters> const& filters = std::nullopt);
 
+  // same as above, merging the keys in parallel on executor. Keys are
+  // partitioned into numShards shards by their hash, keeping the merge of a
+  // key on a single thread. Small publications are merged inline
+  static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
+      std::unordered_map<std::string, thrift::Value>& kvStore,
+      std::unordered_map<std::string, thrift::Value> const& update,
+      std::optional<KvStoreFilters> const& filters,
+      folly::Executor* executor,
+      size_t numShards);
+
+  // same as above, returning the updated keys as pointers instead of copying
+  // them into a publication. New keys are added to the store at once
+  static std::vector<MergeUpdate> mergeKeyValueUpdates(
+      std::unordered_map<std::string, thrift::Value>& kvStore,
+      std::unordered_map<std::string, thrift::Value> const& update,
+      std::optional<KvStoreFilters> const& filters = std::nullopt,
+      folly::Executor* executor = nullptr,
+      size_t numShards = 1);
+
   // compare two thrift::Values to figure out which value is better to
   // use, it will compare following attributes in order
   // <version>, <orginatorId>, <value>, <ttl-version>
@@ -479,9 +1075,38 @@ class KvStore final : public OpenrEventBase {
   // unknown can happen if value is missing (only hash is provided)
   static int compareValues(const thrift::Value& v1, const thrift::Value& v2);
 
+  // bucket of the key at the given level of full-sync bucket digests, i.e.
+  // the leading level * kKvStoreSyncBucketBits bits of the key's hash
+  static int64_t getKeyBucket(const std::string& key, int32_t level);
+
+  // digest of a key-value, same on all nodes having the same value. Covers
+  // the attributes compared by compareValues
+  static int64_t getKeyValDigest(
+      const std::string& key, const thrift::Value& value);
+
+  // buckets on which the two digests differ, in ascending order. Missing
+  // buckets have no keys
+  static std::vector<int64_t> getDifferingBuckets(
+      std::map<int64_t, int64_t> const& digests1,
+      std::map<int64_t, int64_t> const& digests2);
+
+  // TTL refreshes of keyVals, i.e. values without value, batched per
+  // originator. Other key-values are copied to otherKeyVals
+  static std::vector<thrift::KeyTtlUpdates> compactTtlUpdates(
+      thrift::KeyVals const& keyVals, thrift::KeyVals& otherKeyVals);
+
+  // add TTL refreshes to keyVals as values without value, unless keyVals
+  // already hold the key. Returns false if ttlUpdates are malformed
+  static bool expandTtlUpdates(
+      std::vector<thrift::KeyTtlUpdates> const& ttlUpdates,
+      thrift::KeyVals& keyVals);
+
   // Public APIs
   fbzmq::thrift::CounterMap getCounters();
 
+  // shed memory of all areas
+  void onMemoryPressure() override;
+
   folly::SemiFuture<std::unique_ptr<thrift::AreasConfig>> getAreasConfig();
 
   folly::SemiFuture<std::unique_ptr<thrift::Publication>> getKvStoreKeyVals(
@@ -514,6 +1139,10 @@ class KvStore final : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<thrift::SptInfos>> getSpanningTreeInfos(
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
 
+  folly::SemiFuture<std::unique_ptr<thrift::KvStoreChurnStats>>
+  getKvStoreChurnStats(
+      std::string area = openr::thrift::KvStore_constants::kDefaultArea());
+
   folly::SemiFuture<folly::Unit> updateFloodTopologyChild(
       thrift::FloodTopoSetParams floodTopoSetParams,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -542,13 +1171,56 @@ class KvStore final : public OpenrEventBase {
   void processCmdSocketRequest(
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>& cmdSock) noexcept;
 
-  // This function wraps `processRequestMsgHelper` and updates send/received
-  // bytes counters.
+  // This function wraps `processRequestMsgHelper` of the KvStoreDb of area
+  // and updates sent bytes counters. Runs on the event base of the area
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
-      fbzmq::Message&& msg);
+      thrift::KvStoreRequest& thriftReq,
+      std::string const& area,
+      std::vector<fbzmq::Message>& leadingChunks);
+
+  // send the response of a request back to the requester, along the ids and
+  // delims of the request
+  void sendCmdSocketReply(
+      fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>& cmdSock,
+      std::vector<fbzmq::Message> reqIds,
+      std::vector<fbzmq::Message> leadingChunks,
+      folly::Expected<fbzmq::Message, fbzmq::Error> maybeReply) noexcept;
+
+  // event base the KvStoreDb of area runs on. Ours unless areas run on event
+  // bases of their own, or if the area is unknown
+  OpenrEventBase* getAreaEventBase(std::string const& area);
+
+  // run func with the KvStoreDb of every area, one area after the other, on
+  // the event base of the area, and wait for it. Inline while areas run on
+  // our event base, or their event bases don't run. Called from our thread
+  void runInAreasAndWait(
+      folly::Function<void(std::string const&, KvStoreDb&)> func);
+
+  // stop the event bases of areas and join their threads, if they run
+  void stopAreaEventBases();
 
   void submitCounters();
 
+  // snapshot the key-values of all areas, with their remaining TTLs, and
+  // write it to snapshotFilePath_ on snapshotExecutor_. Skipped if the
+  // previous snapshot is still being written
+  void saveSnapshotAsync() noexcept;
+
+  // key-values of all areas, with their remaining TTLs. Called from our
+  // thread
+  thrift::KvStoreSnapshot takeSnapshot();
+
+  // write snapshot to snapshotFilePath_. Returns true on success. Doesn't
+  // throw exception.
+  bool writeSnapshot(
+      thrift::KvStoreSnapshot const& snapshot,
+      std::chrono::steady_clock::time_point startTime) noexcept;
+
+  // pre-populate the KvStore from the key-values of snapshotFilePath_ not
+  // originated by this node, their TTLs reduced by the age of the snapshot.
+  // Full-syncs with peers then only exchange what changed meanwhile
+  void loadSnapshot() noexcept;
+
   //
   // Private variables
   //
@@ -566,24 +1238,49 @@ class KvStore final : public OpenrEventBase {
 
   std::optional<KvStoreFilters> filters_ = std::nullopt;
 
+  // Location on disk of the KvStore snapshot, none taken if empty
+  const std::string snapshotFilePath_;
+
   //
   // Mutable state
   //
 
+  // Timer for snapshotting the KvStore periodically
+  std::unique_ptr<fbzmq::ZmqTimeout> snapshotTimer_;
+
+  // single thread serializing and writing snapshots, off the event loop
+  std::unique_ptr<folly::CPUThreadPoolExecutor> snapshotExecutor_;
+
+  // a snapshot is being written on snapshotExecutor_
+  std::atomic<bool> snapshotInProgress_{false};
+
   // Timer for submitting to monitor periodically
   std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_;
 
   // client to interact with monitor
   std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
+  // worker pool for merging publications, only set with numMergeShards > 1
+  std::unique_ptr<folly::CPUThreadPoolExecutor> mergeExecutor_;
+
   // kvstore parameters common to all kvstoreDB
   KvStoreParams kvParams_;
 
+  // event bases of areas, if they run on their own. Destroyed after the
+  // KvStoreDbs running on them
+  std::unordered_map<std::string /* area ID */, std::unique_ptr<OpenrEventBase>>
+      areaEvbs_;
+
+  // threads running areaEvbs_, while they run. Only touched from our thread
+  // while it runs
+  std::vector<std::thread> areaThreads_;
+
   // map of area IDs and instance of KvStoreDb
   std::unordered_map<std::string /* area ID */, KvStoreDb> kvStoreDb_{};
 
-  // Data-struct for maintaining stats/counters
-  fbzmq::ThreadData tData_;
+  // Data-struct for maintaining stats/counters, updated by requests of all
+  // areas
+  folly::Synchronized<fbzmq::ThreadData> tData_;
 
   // the serializer/deserializer helper we'll be using
   apache::thrift::CompactSerializer serializer_;
@@ -7,6 +7,8 @@
 
 #include "KvStoreClient.h"
 
+#include <functional>
+
 #include <openr/common/OpenrClient.h>
 #include <openr/common/Util.h>
 
@@ -16,6 +18,26 @@
 
 namespace openr {
 
+namespace {
+
+// wait for the result of a request handed to an in-process KvStore
+template <typename T>
+folly::Expected<T, fbzmq::Error>
+waitForKvStore(
+    folly::SemiFuture<T>&& sf,
+    folly::Optional<std::chrono::milliseconds> timeout) {
+  try {
+    if (timeout.hasValue()) {
+      return std::move(sf).get(timeout.value());
+    }
+    return std::move(sf).get();
+  } catch (const std::exception& ex) {
+    return folly::makeUnexpected(fbzmq::Error(0, ex.what()));
+  }
+}
+
+} // namespace
+
 KvStoreClient::KvStoreClient(
     fbzmq::Context& context,
     OpenrEventBase* eventBase,
@@ -23,7 +45,9 @@ KvStoreClient::KvStoreClient(
     std::string const& kvStoreLocalCmdUrl,
     std::string const& kvStoreLocalPubUrl,
     folly::Optional<std::chrono::milliseconds> checkPersistKeyPeriod,
-    folly::Optional<std::chrono::milliseconds> recvTimeout)
+    folly::Optional<std::chrono::milliseconds> recvTimeout,
+    bool batchUpdates,
+    KvStore* kvStore)
     : useThriftClient_(false),
       nodeId_(nodeId),
       eventBase_(eventBase),
@@ -32,6 +56,8 @@ KvStoreClient::KvStoreClient(
       kvStoreLocalPubUrl_(kvStoreLocalPubUrl),
       checkPersistKeyPeriod_(checkPersistKeyPeriod),
       recvTimeout_(recvTimeout),
+      batchUpdates_(batchUpdates),
+      kvStore_(kvStore),
       kvStoreCmdSock_(nullptr),
       kvStoreSubSock_(
           context, folly::none, folly::none, fbzmq::NonblockingFlag{false}) {
@@ -202,17 +228,28 @@ KvStoreClient::checkPersistKeyInStore() {
       params.keys.push_back(key.first);
     }
 
-    request.cmd = thrift::Command::KEY_GET;
-    request.keyGetParams = params;
-    request.area = area;
+    folly::Expected<thrift::Publication, fbzmq::Error> maybePublication;
+    if (kvStore_) {
+      auto maybePub = waitForKvStore(
+          kvStore_->getKvStoreKeyVals(params, area), recvTimeout_);
+      if (maybePub.hasValue()) {
+        maybePublication = std::move(*maybePub.value());
+      } else {
+        maybePublication = folly::makeUnexpected(maybePub.error());
+      }
+    } else {
+      request.cmd = thrift::Command::KEY_GET;
+      request.keyGetParams = params;
+      request.area = area;
 
-    // Send request
-    prepareKvStoreCmdSock();
-    kvStoreCmdSock_->sendThriftObj(request, serializer_);
+      // Send request
+      prepareKvStoreCmdSock();
+      kvStoreCmdSock_->sendThriftObj(request, serializer_);
 
-    // Receive response
-    auto maybePublication = kvStoreCmdSock_->recvThriftObj<thrift::Publication>(
-        serializer_, recvTimeout_);
+      // Receive response
+      maybePublication = kvStoreCmdSock_->recvThriftObj<thrift::Publication>(
+          serializer_, recvTimeout_);
+    }
 
     if (not maybePublication) {
       kvStoreCmdSock_.reset();
@@ -332,7 +369,7 @@ KvStoreClient::persistKey(
   }
 
   // Best effort to advertise pending keys
-  advertisePendingKeys();
+  schedulePendingKeys();
 
   scheduleTtlUpdates(
       key,
@@ -421,6 +458,29 @@ KvStoreClient::setKey(
   return ret;
 }
 
+folly::Expected<folly::Unit, fbzmq::Error>
+KvStoreClient::setKeys(
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::string const& area /* thrift::KvStore_constants::kDefaultArea() */) {
+  for (auto const& kv : keyVals) {
+    CHECK(kv.second.value) << "No value for key " << kv.first;
+  }
+
+  const auto ret = setKeysHelper(keyVals, area);
+
+  for (auto const& kv : keyVals) {
+    scheduleTtlUpdates(
+        kv.first,
+        kv.second.version,
+        kv.second.ttlVersion,
+        kv.second.ttl,
+        false /* advertiseImmediately */,
+        area);
+  }
+
+  return ret;
+}
+
 void
 KvStoreClient::scheduleTtlUpdates(
     std::string const& key,
@@ -463,6 +523,13 @@ KvStoreClient::scheduleTtlUpdates(
     keyTtlBackoffs.at(key).second.reportError();
   }
 
+  // In batched mode refresh on the next event loop iteration. Keys set until
+  // then are checked in one pass and the ones due are sent together
+  if (batchUpdates_) {
+    ttlTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    return;
+  }
+
   advertiseTtlUpdates();
 }
 
@@ -553,6 +620,20 @@ KvStoreClient::getKey(
   thrift::KeyGetParams params;
   params.keys.push_back(key);
 
+  if (kvStore_) {
+    auto maybePublication = waitForKvStore(
+        kvStore_->getKvStoreKeyVals(std::move(params), area), recvTimeout_);
+    if (not maybePublication) {
+      return folly::makeUnexpected(maybePublication.error());
+    }
+    auto& publication = **maybePublication;
+    auto it = publication.keyVals.find(key);
+    if (it == publication.keyVals.end()) {
+      return folly::makeUnexpected(fbzmq::Error(0, "key not found"));
+    }
+    return std::move(it->second);
+  }
+
   request.cmd = thrift::Command::KEY_GET;
   request.keyGetParams = params;
   request.area = area;
@@ -601,6 +682,47 @@ KvStoreClient::dumpImpl(
   return sock.recvThriftObj<thrift::Publication>(serializer, recvTimeout);
 }
 
+namespace {
+
+// request the pages of a paginated dump one after the other, merging each
+// into merged as it arrives. Stops at the first page without a cursor, which
+// servers not supporting paginated dumps respond with
+folly::SemiFuture<folly::Unit>
+dumpAllPages(
+    thrift::OpenrCtrlCppAsyncClient* client,
+    folly::EventBase* evb,
+    thrift::KeyDumpParams params,
+    std::string const& area,
+    std::unordered_map<std::string, thrift::Value>& merged,
+    KvStoreClient::NodeDumpResult* result = nullptr) {
+  // Keep getKvStoreKeyValsFiltered() for backward compatibility purpose
+  auto sf = area == thrift::KvStore_constants::kDefaultArea()
+      ? client->semifuture_getKvStoreKeyValsFiltered(params)
+      : client->semifuture_getKvStoreKeyValsFilteredArea(params, area);
+  return std::move(sf)
+      .via(evb)
+      .thenValue(
+          [client, evb, params = std::move(params), &area, &merged, result](
+              thrift::Publication&& pub) mutable {
+            VLOG(3) << "KvStore publication received with "
+                    << pub.keyVals.size() << " key-vals";
+            if (result) {
+              result->numPages++;
+              result->numKeyVals += pub.keyVals.size();
+            }
+            KvStore::mergeKeyValues(merged, pub.keyVals);
+            if (not pub.cursor.hasValue()) {
+              return folly::makeSemiFuture();
+            }
+            params.cursor = pub.cursor.value();
+            return dumpAllPages(
+                client, evb, std::move(params), area, merged, result);
+          })
+      .semi();
+}
+
+} // anonymous namespace
+
 /*
  * static method to dump KvStore key-val over multiple instances
  */
@@ -616,12 +738,15 @@ KvStoreClient::dumpAllWithThriftClientFromMultiple(
     const folly::SocketAddress& bindAddr /* folly::AsyncSocket::anyAddress()*/,
     const std::string& area /* thrift::KvStore_constants::kDefaultArea() */) {
   folly::EventBase evb;
-  std::vector<folly::SemiFuture<thrift::Publication>> calls;
+  // clients must outlive the requests for further pages
+  std::vector<std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>> clients;
+  std::vector<folly::SemiFuture<folly::Unit>> calls;
   std::unordered_map<std::string, thrift::Value> merged;
   std::vector<fbzmq::SocketUrl> unreachedUrls;
 
   thrift::KeyDumpParams params;
   params.prefix = keyPrefix;
+  params.maxKeys = Constants::kKvStoreDumpPageSize;
 
   LOG(INFO) << "Prepare requests to all Open/R instances";
 
@@ -650,13 +775,8 @@ KvStoreClient::dumpAllWithThriftClientFromMultiple(
     VLOG(3) << "Successfully connected to Open/R with addr: "
             << sockAddr.getAddressStr();
 
-    // Keep getKvStoreKeyValsFiltered() for backward compatibility purpose
-    if (area == thrift::KvStore_constants::kDefaultArea()) {
-      calls.emplace_back(client->semifuture_getKvStoreKeyValsFiltered(params));
-    } else {
-      calls.emplace_back(
-          client->semifuture_getKvStoreKeyValsFilteredArea(params, area));
-    }
+    calls.emplace_back(dumpAllPages(client.get(), &evb, params, area, merged));
+    clients.emplace_back(std::move(client));
   }
 
   // can't connect to ANY single Open/R instance
@@ -665,11 +785,12 @@ KvStoreClient::dumpAllWithThriftClientFromMultiple(
   }
 
   folly::collectAllSemiFuture(calls).via(&evb).thenValue(
-      [&](std::vector<folly::Try<openr::thrift::Publication>>&& results) {
-        LOG(INFO) << "Merge values received from Open/R instances"
+      [&](std::vector<folly::Try<folly::Unit>>&& results) {
+        LOG(INFO) << "Merged values received from Open/R instances"
                   << ", results size: " << results.size();
 
-        // loop semifuture collection to merge all values
+        // values are merged page by page as they are received, only report
+        // the instances failing to respond
         for (auto& result : results) {
           VLOG(3) << "hasException: " << result.hasException()
                   << ", hasValue: " << result.hasValue();
@@ -679,9 +800,6 @@ KvStoreClient::dumpAllWithThriftClientFromMultiple(
           if (result.hasException()) {
             LOG(WARNING) << "Exception happened: "
                          << folly::exceptionStr(result.exception());
-          } else if (result.hasValue()) {
-            VLOG(3) << "KvStore publication received";
-            KvStore::mergeKeyValues(merged, result.value().keyVals);
           }
         }
         evb.terminateLoopSoon();
@@ -701,6 +819,118 @@ KvStoreClient::dumpAllWithThriftClientFromMultiple(
   return std::make_pair(merged, unreachedUrls);
 }
 
+std::pair<
+    folly::Optional<std::unordered_map<std::string /* key */, thrift::Value>>,
+    std::vector<KvStoreClient::NodeDumpResult>>
+KvStoreClient::dumpAllWithThriftClientFromMultipleBounded(
+    const std::vector<folly::SocketAddress>& sockAddrs,
+    const std::string& keyPrefix,
+    size_t maxOutstanding,
+    size_t maxKeyVals,
+    std::chrono::milliseconds connectTimeout,
+    std::chrono::milliseconds processTimeout,
+    folly::Optional<int> maybeIpTos /* folly::none */,
+    const folly::SocketAddress& bindAddr /* folly::AsyncSocket::anyAddress()*/,
+    const std::string& area /* thrift::KvStore_constants::kDefaultArea() */) {
+  CHECK_LT(0, maxOutstanding);
+  folly::EventBase evb;
+  // clients must outlive the requests for further pages
+  std::vector<std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>> clients(
+      sockAddrs.size());
+  std::vector<NodeDumpResult> results(sockAddrs.size());
+  std::unordered_map<std::string, thrift::Value> merged;
+  size_t nextIndex{0};
+  size_t numOutstanding{0};
+  size_t numSucceeded{0};
+
+  thrift::KeyDumpParams params;
+  params.prefix = keyPrefix;
+  params.maxKeys = Constants::kKvStoreDumpPageSize;
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  // start dumps of the next instances as long as we are under the limits
+  std::function<void()> startDumps;
+  startDumps = [&]() {
+    while (numOutstanding < maxOutstanding and nextIndex < sockAddrs.size()) {
+      const size_t i = nextIndex++;
+      auto& result = results[i];
+      result.sockAddr = sockAddrs[i];
+      if (merged.size() >= maxKeyVals) {
+        result.error = "merged key-vals limit reached";
+        continue;
+      }
+
+      const auto dumpStartTime = std::chrono::steady_clock::now();
+      try {
+        clients[i] = getOpenrCtrlPlainTextClient(
+            evb,
+            folly::IPAddress(sockAddrs[i].getAddressStr()),
+            sockAddrs[i].getPort(),
+            connectTimeout,
+            processTimeout,
+            bindAddr,
+            maybeIpTos);
+      } catch (const std::exception& ex) {
+        result.error = folly::exceptionStr(ex).toStdString();
+      }
+      if (not clients[i]) {
+        if (not result.error) {
+          result.error = "failed to create client";
+        }
+        continue;
+      }
+
+      numOutstanding++;
+      dumpAllPages(clients[i].get(), &evb, params, area, merged, &result)
+          .via(&evb)
+          .thenTry([&, i, dumpStartTime](folly::Try<folly::Unit>&& t) {
+            auto& dumpResult = results[i];
+            dumpResult.latency =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - dumpStartTime);
+            if (t.hasException()) {
+              dumpResult.error =
+                  folly::exceptionStr(t.exception()).toStdString();
+              LOG(WARNING) << "Failed to dump Open/R instance at address of: "
+                           << dumpResult.sockAddr.getAddressStr() << ". "
+                           << *dumpResult.error;
+            } else {
+              numSucceeded++;
+            }
+            numOutstanding--;
+            // drop the connection outside of its own callback
+            evb.runInLoop([&clients, i]() noexcept { clients[i].reset(); });
+            startDumps();
+            if (numOutstanding == 0) {
+              evb.terminateLoopSoon();
+            }
+          });
+    }
+  };
+
+  startDumps();
+  if (numOutstanding) {
+    evb.loopForever();
+  }
+  // release remaining connections before the event base goes away
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  clients.clear();
+
+  const auto elapsedTime =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime)
+          .count();
+  LOG(INFO) << "Took: " << elapsedTime << "ms to retrieve KvStore snapshot "
+            << "from " << numSucceeded << " of " << sockAddrs.size()
+            << " Open/R instances";
+
+  if (numSucceeded == 0) {
+    return std::make_pair(folly::none, std::move(results));
+  }
+  return std::make_pair(std::move(merged), std::move(results));
+}
+
 folly::Expected<std::unordered_map<std::string, thrift::Value>, fbzmq::Error>
 KvStoreClient::dumpAllWithPrefix(
     const std::string& prefix /* = "" */,
@@ -730,6 +960,17 @@ KvStoreClient::dumpAllWithPrefix(
     return pub.keyVals;
   }
 
+  if (kvStore_) {
+    thrift::KeyDumpParams params;
+    params.prefix = prefix;
+    auto maybePub = waitForKvStore(
+        kvStore_->dumpKvStoreKeys(std::move(params), area), recvTimeout_);
+    if (maybePub.hasError()) {
+      return folly::makeUnexpected(maybePub.error());
+    }
+    return std::move(maybePub.value()->keyVals);
+  }
+
   prepareKvStoreCmdSock();
   auto maybePub =
       dumpImpl(*kvStoreCmdSock_, serializer_, prefix, recvTimeout_, area);
@@ -801,6 +1042,15 @@ KvStoreClient::addPeers(
   thrift::PeerAddParams params;
 
   params.peers = std::move(peers);
+  if (kvStore_) {
+    auto ret = waitForKvStore(
+        kvStore_->addUpdateKvStorePeers(std::move(params), area), recvTimeout_);
+    if (ret.hasError()) {
+      return folly::makeUnexpected(ret.error());
+    }
+    return folly::Unit();
+  }
+
   request.cmd = thrift::Command::PEER_ADD;
   request.peerAddParams = params;
   request.area = area;
@@ -855,6 +1105,15 @@ KvStoreClient::getPeers(
 
   CHECK(!useThriftClient_) << "getPeers() NOT supported over Thrift";
 
+  if (kvStore_) {
+    auto maybePeers =
+        waitForKvStore(kvStore_->getKvStorePeers(area), recvTimeout_);
+    if (maybePeers.hasError()) {
+      return folly::makeUnexpected(maybePeers.error());
+    }
+    return std::move(*maybePeers.value());
+  }
+
   // Prepare request
   thrift::KvStoreRequest request;
   request.cmd = thrift::Command::PEER_DUMP;
@@ -905,6 +1164,17 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
   auto& keyTtlBackoffs = keyTtlBackoffs_[area];
   auto& keysToAdvertise = keysToAdvertise_[area];
 
+  // Skip keys if we neither watch nor own any key in this area, as for most
+  // publications seen by clients interested in a few keys
+  if (not kvCallback_ and not keyPrefixFilterCallback_ and
+      keyCallbacks_.empty() and persistedKeyVals.empty() and
+      keyTtlBackoffs.empty()) {
+    if (publication.expiredKeys.size()) {
+      processExpiredKeys(publication);
+    }
+    return;
+  }
+
   for (auto const& kv : publication.keyVals) {
     auto const& key = kv.first;
     auto const& rcvdValue = kv.second;
@@ -1027,7 +1297,7 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
     }
   } // for
 
-  advertisePendingKeys();
+  schedulePendingKeys();
 
   if (publication.expiredKeys.size()) {
     processExpiredKeys(publication);
@@ -1101,6 +1371,15 @@ KvStoreClient::advertisePendingKeys() {
   advertiseKeyValsTimer_->scheduleTimeout(timeout);
 }
 
+void
+KvStoreClient::schedulePendingKeys() {
+  if (not batchUpdates_) {
+    advertisePendingKeys();
+    return;
+  }
+  advertiseKeyValsTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+}
+
 void
 KvStoreClient::advertiseTtlUpdates() {
   // Build set of keys to advertise ttl updates
@@ -1117,9 +1396,18 @@ KvStoreClient::advertiseTtlUpdates() {
     for (auto& kv : keyTtlBackoffs) {
       const auto& key = kv.first;
       auto& backoff = kv.second.second;
-      if (not backoff.canTryNow()) {
+      // In batched mode refresh keys due shortly along with the ones due now,
+      // it keeps keys refreshed in the same request aligned afterwards
+      const auto window = batchUpdates_
+          ? std::min(
+                Constants::kTtlUpdateBatchWindow,
+                backoff.getInitialBackoff() / 4)
+          : std::chrono::milliseconds(0);
+      if (not backoff.canTryNow() and
+          backoff.getTimeRemainingUntilRetry() > window) {
         VLOG(2) << "Skipping key: " << key << ", area: " << area;
-        timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
+        timeout = std::min(
+            timeout, backoff.getTimeRemainingUntilRetry() - window);
         continue;
       }
 
@@ -1218,6 +1506,17 @@ KvStoreClient::setKeysHelper(
   thrift::KeySetParams params;
 
   params.keyVals = std::move(keyVals);
+  if (kvStore_) {
+    // the key-vals are moved all the way into KvStore, never serialized
+    auto ret = waitForKvStore(
+        kvStore_->setKvStoreKeyVals(std::move(params), area), recvTimeout_);
+    if (ret.hasError()) {
+      return folly::makeUnexpected(fbzmq::Error(
+          0, "KvStore error in SET_KEY. Received: " + ret.error().errString));
+    }
+    return folly::Unit();
+  }
+
   request.cmd = thrift::Command::KEY_SET;
   request.keySetParams = params;
   request.area = area;
@@ -1252,6 +1551,15 @@ KvStoreClient::delPeersHelper(
   thrift::PeerDelParams params;
 
   params.peerNames = peerNames;
+  if (kvStore_) {
+    auto ret = waitForKvStore(
+        kvStore_->deleteKvStorePeers(std::move(params), area), recvTimeout_);
+    if (ret.hasError()) {
+      return folly::makeUnexpected(ret.error());
+    }
+    return folly::Unit();
+  }
+
   request.cmd = thrift::Command::PEER_DEL;
   request.peerDelParams = params;
   request.area = area;
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <chrono>
+#include <limits>
 #include <string>
 #include <unordered_map>
 
@@ -50,6 +51,16 @@ class KvStoreClient {
   /**
    * Creates and initializes all necessary sockets for communicating with
    * KvStore.
+   *
+   * With batchUpdates, persisted keys are advertised together on the next
+   * event loop iteration instead of one request per `persistKey` call, and
+   * TTL refreshes of all keys due within `Constants::kTtlUpdateBatchWindow`
+   * go out in one KEY_SET request per area. Meant for clients advertising
+   * many keys, e.g. per prefix keys.
+   *
+   * With kvStore, for clients in the same process as KvStore, requests are
+   * handed to its APIs directly instead of being serialized over the command
+   * socket. Publications are still received on the PUB socket.
    */
   KvStoreClient(
       fbzmq::Context& context,
@@ -59,7 +70,9 @@ class KvStoreClient {
       std::string const& kvStoreLocalPubUrl,
       folly::Optional<std::chrono::milliseconds> checkPersistKeyPeriod =
           60000ms,
-      folly::Optional<std::chrono::milliseconds> recvTimeout = 3000ms);
+      folly::Optional<std::chrono::milliseconds> recvTimeout = 3000ms,
+      bool batchUpdates = false,
+      KvStore* kvStore = nullptr);
 
   /*
    * Second flavor of KvStoreClient to talk to KvStore through Open/R ctrl
@@ -115,6 +128,15 @@ class KvStoreClient {
       thrift::Value const& value,
       std::string const& area = thrift::KvStore_constants::kDefaultArea());
 
+  /**
+   * Advertise several key-values into KvStore at once, in one request and
+   * hence one publication. Like the second flavour of setKey, values are
+   * forwarded as is and their TTLs are updated by the client.
+   */
+  folly::Expected<folly::Unit, fbzmq::Error> setKeys(
+      std::unordered_map<std::string, thrift::Value> const& keyVals,
+      std::string const& area = thrift::KvStore_constants::kDefaultArea());
+
   /**
    * Unset key from KvStore. It really doesn't delete the key from KvStore,
    * instead it just leave it as it is.
@@ -228,6 +250,46 @@ class KvStoreClient {
       const folly::SocketAddress& bindAddr = folly::AsyncSocket::anyAddress(),
       const std::string& area = thrift::KvStore_constants::kDefaultArea());
 
+  /**
+   * Outcome of dumping one Open/R instance in
+   * `dumpAllWithThriftClientFromMultipleBounded`
+   */
+  struct NodeDumpResult {
+    folly::SocketAddress sockAddr;
+    // from connecting until the last page is received or the dump fails
+    std::chrono::milliseconds latency{0};
+    size_t numPages{0};
+    size_t numKeyVals{0};
+    // none if the dump succeeded
+    folly::Optional<std::string> error;
+  };
+
+  /*
+   * Variant of `dumpAllWithThriftClientFromMultiple` for dumping many
+   * instances. At most maxOutstanding instances are dumped at a time, each
+   * connected only when its turn comes, so sockets and pages in flight are
+   * bounded as well. Pages are merged as they arrive. Once the merged
+   * key-vals reach maxKeyVals the remaining instances are not dumped and
+   * are reported failed.
+   *
+   * @return first member is the merged key-vals, null value if no instance
+   * could be dumped. Second member has one result per sockAddrs entry,
+   * in the same order.
+   */
+  static std::pair<
+      folly::Optional<std::unordered_map<std::string /* key */, thrift::Value>>,
+      std::vector<NodeDumpResult>>
+  dumpAllWithThriftClientFromMultipleBounded(
+      const std::vector<folly::SocketAddress>& sockAddrs,
+      const std::string& prefix,
+      size_t maxOutstanding = Constants::kKvStoreMaxOutstandingDumps,
+      size_t maxKeyVals = std::numeric_limits<size_t>::max(),
+      std::chrono::milliseconds connectTimeout = Constants::kServiceConnTimeout,
+      std::chrono::milliseconds processTimeout = Constants::kServiceProcTimeout,
+      folly::Optional<int> maybeIpTos = folly::none,
+      const folly::SocketAddress& bindAddr = folly::AsyncSocket::anyAddress(),
+      const std::string& area = thrift::KvStore_constants::kDefaultArea());
+
   /**
    * APIs to subscribe/unsubscribe to value change of a key in KvStore
    * @param key - key for which callback is registered
@@ -342,6 +404,12 @@ class KvStoreClient {
    */
   void advertisePendingKeys();
 
+  /**
+   * Advertise pending keys right away, or on the next event loop iteration
+   * along with keys persisted until then in batched mode
+   */
+  void schedulePendingKeys();
+
   /**
    * Helper function to schedule TTL update advertisement
    */
@@ -427,6 +495,12 @@ class KvStoreClient {
   // Recv Timeout to be used from from KvStore
   folly::Optional<std::chrono::milliseconds> recvTimeout_;
 
+  // coalesce key advertisements and TTL refreshes, see constructor
+  const bool batchUpdates_{false};
+
+  // in-process KvStore requests are handed to directly, see constructor
+  KvStore* const kvStore_{nullptr};
+
   //
   // Mutable state
   //
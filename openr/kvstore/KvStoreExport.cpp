@@ -0,0 +1,536 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreExport.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <folly/Bits.h>
+#include <folly/Exception.h>
+#include <folly/Format.h>
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace kv_export {
+
+static_assert(
+    std::atomic<uint64_t>::is_always_lock_free and
+        std::atomic<uint32_t>::is_always_lock_free,
+    "sequence locks must be lock free to be shared between processes");
+
+struct Mapping {
+  int fd{-1};
+  char* base{nullptr};
+  size_t size{0};
+  // where the mapped file was created, until renamed into place
+  std::string tmpPath;
+
+  ~Mapping() {
+    if (base) {
+      ::munmap(base, size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  Header*
+  getHeader() const {
+    return reinterpret_cast<Header*>(base);
+  }
+
+  Slot*
+  getSlots() const {
+    return reinterpret_cast<Slot*>(base + getHeader()->tableOffset);
+  }
+
+  char*
+  getSlab() const {
+    return base + getHeader()->slabOffset;
+  }
+};
+
+uint64_t
+hashKey(folly::StringPiece key) {
+  return folly::hash::fnv64_buf(key.data(), key.size());
+}
+
+} // namespace kv_export
+
+using namespace kv_export;
+
+namespace {
+
+const size_t kAlignment{64};
+const size_t kMinCapacity{16};
+const size_t kNumSizeClasses{40};
+const size_t kMaxReadRetries{1000};
+
+uint64_t
+alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint8_t
+getSizeClass(size_t blockSize) {
+  uint8_t sizeClass{0};
+  while ((kMinBlockSize << sizeClass) < blockSize) {
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+size_t
+getBlockSize(const std::string& key, const thrift::Value& value) {
+  return key.size() + value.originatorId.size() +
+      (value.value.hasValue() ? value.value->size() : 0);
+}
+
+// copy key-value of slot out of its block, false if the block is out of the
+// slab, i.e. the slot is being written
+bool
+decodeSlot(
+    const Slot& slot,
+    const char* slab,
+    uint64_t slabSize,
+    std::string& key,
+    thrift::Value& value) {
+  const uint64_t offset = slot.blockOffset;
+  const uint64_t keyLen = slot.keyLen;
+  const uint64_t originatorIdLen = slot.originatorIdLen;
+  const uint64_t valueLen = slot.valueLen;
+  if (offset > slabSize or
+      keyLen + originatorIdLen + valueLen > slabSize - offset) {
+    return false;
+  }
+  const char* data = slab + offset;
+  key.assign(data, keyLen);
+  value = thrift::Value();
+  value.version = slot.version;
+  value.originatorId.assign(data + keyLen, originatorIdLen);
+  if (slot.hasValue) {
+    value.value = std::string(data + keyLen + originatorIdLen, valueLen);
+  }
+  value.ttl = slot.ttl;
+  value.ttlVersion = slot.ttlVersion;
+  if (slot.hasHash) {
+    value.hash = slot.hash;
+  }
+  return true;
+}
+
+// map an existing mirror read-only, throws if it isn't valid
+std::unique_ptr<Mapping>
+openMapping(const std::string& path) {
+  auto mapping = std::make_unique<Mapping>();
+  mapping->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  folly::checkUnixError(mapping->fd, "Failed to open ", path);
+  struct stat st;
+  folly::checkUnixError(::fstat(mapping->fd, &st), "Failed to stat ", path);
+  if (static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    throw std::runtime_error(folly::sformat("{} is too small", path));
+  }
+  auto* base =
+      ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, mapping->fd, 0);
+  if (base == MAP_FAILED) {
+    folly::throwSystemError("Failed to map ", path);
+  }
+  mapping->base = static_cast<char*>(base);
+  mapping->size = st.st_size;
+
+  const auto* header = mapping->getHeader();
+  const auto tableEnd = header->tableOffset +
+      std::min<uint64_t>(header->capacity, mapping->size) * sizeof(Slot);
+  if (header->magic != kMagic or header->formatVersion != kFormatVersion or
+      header->headerSize != sizeof(Header) or
+      not folly::isPowTwo(header->capacity) or
+      header->tableOffset % alignof(Slot) or tableEnd > header->slabOffset or
+      header->slabOffset > mapping->size or
+      header->slabSize > mapping->size - header->slabOffset) {
+    throw std::runtime_error(folly::sformat(
+        "{} is not a KvStore mirror of format {}", path, kFormatVersion));
+  }
+  return mapping;
+}
+
+} // namespace
+
+//
+// KvStoreExporter
+//
+
+KvStoreExporter::KvStoreExporter(
+    std::string path, size_t initialCapacity, size_t initialSlabSize)
+    : path_(std::move(path)),
+      initialSlabSize_(alignUp(std::max(initialSlabSize, kAlignment), 4096)),
+      freeBlocks_(kNumSizeClasses) {
+  install(createMapping(
+      folly::nextPowTwo(std::max(initialCapacity, kMinCapacity)),
+      initialSlabSize_));
+  LOG(INFO) << "Mirroring KvStore to " << path_;
+}
+
+KvStoreExporter::~KvStoreExporter() {
+  mapping_->getHeader()->flags.fetch_or(
+      kFlagClosed, std::memory_order_release);
+}
+
+std::unique_ptr<Mapping>
+KvStoreExporter::createMapping(uint64_t capacity, uint64_t slabSize) const {
+  auto mapping = std::make_unique<Mapping>();
+  mapping->tmpPath = path_ + ".tmp";
+  mapping->fd = ::open(
+      mapping->tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  folly::checkUnixError(mapping->fd, "Failed to create ", mapping->tmpPath);
+
+  const auto tableOffset = alignUp(sizeof(Header), kAlignment);
+  const auto slabOffset =
+      alignUp(tableOffset + capacity * sizeof(Slot), kAlignment);
+  const auto size = slabOffset + slabSize;
+  // a zero filled file is a table of empty slots
+  folly::checkUnixError(
+      ::ftruncate(mapping->fd, size),
+      "Failed to grow ",
+      mapping->tmpPath,
+      " to ",
+      size);
+  auto* base = ::mmap(
+      nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+  if (base == MAP_FAILED) {
+    folly::throwSystemError("Failed to map ", mapping->tmpPath);
+  }
+  mapping->base = static_cast<char*>(base);
+  mapping->size = size;
+
+  auto* header = new (mapping->base) Header();
+  header->magic = kMagic;
+  header->formatVersion = kFormatVersion;
+  header->headerSize = sizeof(Header);
+  header->capacity = capacity;
+  header->tableOffset = tableOffset;
+  header->slabOffset = slabOffset;
+  header->slabSize = slabSize;
+  return mapping;
+}
+
+void
+KvStoreExporter::install(std::unique_ptr<Mapping> mapping) {
+  folly::checkUnixError(
+      ::rename(mapping->tmpPath.c_str(), path_.c_str()),
+      "Failed to rename ",
+      mapping->tmpPath,
+      " to ",
+      path_);
+  mapping->tmpPath.clear();
+  if (mapping_) {
+    mapping_->getHeader()->flags.fetch_or(
+        kFlagClosed, std::memory_order_release);
+  }
+  mapping_ = std::move(mapping);
+}
+
+Slot*
+KvStoreExporter::findSlot(
+    const std::string& key, uint64_t keyHash, Slot** firstFree) const {
+  const auto capacity = mapping_->getHeader()->capacity;
+  auto* slots = mapping_->getSlots();
+  const auto* slab = mapping_->getSlab();
+  *firstFree = nullptr;
+  for (uint64_t i = 0; i < capacity; ++i) {
+    auto* slot = &slots[(keyHash + i) & (capacity - 1)];
+    if (slot->state == EMPTY) {
+      if (not *firstFree) {
+        *firstFree = slot;
+      }
+      return nullptr;
+    }
+    if (slot->state == TOMBSTONE) {
+      if (not *firstFree) {
+        *firstFree = slot;
+      }
+      continue;
+    }
+    if (slot->keyHash == keyHash and slot->keyLen == key.size() and
+        std::memcmp(slab + slot->blockOffset, key.data(), key.size()) == 0) {
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+folly::Optional<uint64_t>
+KvStoreExporter::allocateBlock(uint8_t sizeClass) {
+  CHECK_LT(sizeClass, freeBlocks_.size());
+  auto& freeBlocks = freeBlocks_[sizeClass];
+  if (not freeBlocks.empty()) {
+    const auto offset = freeBlocks.back();
+    freeBlocks.pop_back();
+    return offset;
+  }
+  const uint64_t blockSize = kMinBlockSize << sizeClass;
+  if (blockSize > mapping_->getHeader()->slabSize - slabUsed_) {
+    return folly::none;
+  }
+  const auto offset = slabUsed_;
+  slabUsed_ += blockSize;
+  return offset;
+}
+
+bool
+KvStoreExporter::trySet(const std::string& key, const thrift::Value& value) {
+  auto* header = mapping_->getHeader();
+  const auto sizeClass = getSizeClass(getBlockSize(key, value));
+  const auto keyHash = hashKey(key);
+  Slot* firstFree{nullptr};
+  auto* slot = findSlot(key, keyHash, &firstFree);
+  const bool isNew = slot == nullptr;
+  if (isNew) {
+    // a quarter of the slots is kept empty for probes to end early
+    if (not firstFree or
+        (firstFree->state == EMPTY and
+         (numKeys_ + numTombstones_ + 1) * 4 > header->capacity * 3)) {
+      return false;
+    }
+    slot = firstFree;
+  }
+
+  uint64_t blockOffset{0};
+  if (not isNew and slot->sizeClass == sizeClass) {
+    blockOffset = slot->blockOffset;
+  } else {
+    auto block = allocateBlock(sizeClass);
+    if (not block) {
+      return false;
+    }
+    blockOffset = *block;
+  }
+
+  const auto seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // readers of the previous block see the sequence number change
+  if (not isNew and slot->blockOffset != blockOffset) {
+    freeBlocks_[slot->sizeClass].emplace_back(slot->blockOffset);
+  }
+  if (isNew and slot->state == TOMBSTONE) {
+    --numTombstones_;
+  }
+  auto* data = mapping_->getSlab() + blockOffset;
+  std::memcpy(data, key.data(), key.size());
+  data += key.size();
+  std::memcpy(data, value.originatorId.data(), value.originatorId.size());
+  data += value.originatorId.size();
+  if (value.value.hasValue()) {
+    std::memcpy(data, value.value->data(), value.value->size());
+  }
+  slot->keyHash = keyHash;
+  slot->blockOffset = blockOffset;
+  slot->keyLen = key.size();
+  slot->originatorIdLen = value.originatorId.size();
+  slot->valueLen = value.value.hasValue() ? value.value->size() : 0;
+  slot->state = USED;
+  slot->hasValue = value.value.hasValue();
+  slot->hasHash = value.hash.hasValue();
+  slot->sizeClass = sizeClass;
+  slot->version = value.version;
+  slot->ttl = value.ttl;
+  slot->ttlVersion = value.ttlVersion;
+  slot->hash = value.hash.value_or(0);
+
+  slot->seq.store(seq + 2, std::memory_order_release);
+
+  if (isNew) {
+    ++numKeys_;
+    header->numKeys.store(numKeys_, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void
+KvStoreExporter::set(const std::string& key, const thrift::Value& value) {
+  if (trySet(key, value)) {
+    return;
+  }
+  rebuild(getBlockSize(key, value));
+  CHECK(trySet(key, value));
+}
+
+void
+KvStoreExporter::erase(const std::string& key) {
+  Slot* firstFree{nullptr};
+  auto* slot = findSlot(key, hashKey(key), &firstFree);
+  if (not slot) {
+    return;
+  }
+  const auto seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->state = TOMBSTONE;
+  slot->seq.store(seq + 2, std::memory_order_release);
+
+  freeBlocks_[slot->sizeClass].emplace_back(slot->blockOffset);
+  --numKeys_;
+  ++numTombstones_;
+  mapping_->getHeader()->numKeys.store(numKeys_, std::memory_order_relaxed);
+}
+
+void
+KvStoreExporter::rebuild(size_t blockSize) {
+  const auto* header = mapping_->getHeader();
+  const auto* slots = mapping_->getSlots();
+
+  // room for twice the live keys and blocks, tombstones are dropped
+  uint64_t liveBytes = kMinBlockSize << getSizeClass(blockSize);
+  for (uint64_t i = 0; i < header->capacity; ++i) {
+    if (slots[i].state == USED) {
+      liveBytes += kMinBlockSize << slots[i].sizeClass;
+    }
+  }
+  const auto capacity =
+      folly::nextPowTwo(std::max<uint64_t>(kMinCapacity, (numKeys_ + 1) * 2));
+  const auto slabSize =
+      std::max<uint64_t>(initialSlabSize_, alignUp(liveBytes * 2, 4096));
+  auto next = createMapping(capacity, slabSize);
+
+  // fill the new mapping from the current one
+  auto prev = std::exchange(mapping_, std::move(next));
+  freeBlocks_.assign(kNumSizeClasses, {});
+  slabUsed_ = 0;
+  numKeys_ = 0;
+  numTombstones_ = 0;
+  std::string key;
+  thrift::Value value;
+  for (uint64_t i = 0; i < header->capacity; ++i) {
+    if (slots[i].state != USED) {
+      continue;
+    }
+    CHECK(decodeSlot(
+        slots[i], prev->getSlab(), header->slabSize, key, value));
+    CHECK(trySet(key, value));
+  }
+
+  auto filled = std::exchange(mapping_, std::move(prev));
+  install(std::move(filled));
+  ++numRebuilds_;
+  LOG(INFO) << "Rebuilt KvStore mirror " << path_ << " with " << capacity
+            << " slots and " << slabSize << " bytes of slab";
+}
+
+//
+// KvStoreExportReader
+//
+
+KvStoreExportReader::KvStoreExportReader(std::string path)
+    : path_(std::move(path)), mapping_(openMapping(path_)) {}
+
+KvStoreExportReader::~KvStoreExportReader() = default;
+
+bool
+KvStoreExportReader::isClosed() {
+  reopenIfReplaced();
+  return mapping_->getHeader()->flags.load(std::memory_order_acquire) &
+      kFlagClosed;
+}
+
+void
+KvStoreExportReader::reopenIfReplaced() {
+  if (not(mapping_->getHeader()->flags.load(std::memory_order_acquire) &
+          kFlagClosed)) {
+    return;
+  }
+  try {
+    auto mapping = openMapping(path_);
+    if (not(mapping->getHeader()->flags.load(std::memory_order_acquire) &
+            kFlagClosed)) {
+      mapping_ = std::move(mapping);
+    }
+  } catch (std::exception const& e) {
+    // writer gone, keep reading its last state
+    VLOG(2) << "Failed to reopen " << path_ << ": " << e.what();
+  }
+}
+
+bool
+KvStoreExportReader::readSlot(
+    size_t index, folly::Optional<uint64_t> keyHash, Entry& entry) const {
+  const auto* header = mapping_->getHeader();
+  const auto& slot = mapping_->getSlots()[index];
+  for (size_t i = 0; i < kMaxReadRetries; ++i) {
+    const auto seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    entry.state = slot.state;
+    entry.keyHash = slot.keyHash;
+    bool decoded{true};
+    if (entry.state == USED and
+        (not keyHash.hasValue() or *keyHash == entry.keyHash)) {
+      decoded = decodeSlot(
+          slot, mapping_->getSlab(), header->slabSize, entry.key, entry.value);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (decoded and slot.seq.load(std::memory_order_relaxed) == seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+folly::Optional<thrift::Value>
+KvStoreExportReader::get(const std::string& key) {
+  reopenIfReplaced();
+  const auto capacity = mapping_->getHeader()->capacity;
+  const auto keyHash = hashKey(key);
+  Entry entry;
+  for (uint64_t i = 0; i < capacity; ++i) {
+    if (not readSlot((keyHash + i) & (capacity - 1), keyHash, entry)) {
+      continue;
+    }
+    if (entry.state == EMPTY) {
+      break;
+    }
+    if (entry.state == USED and entry.keyHash == keyHash and
+        entry.key == key) {
+      return std::move(entry.value);
+    }
+  }
+  return folly::none;
+}
+
+void
+KvStoreExportReader::forEach(
+    folly::StringPiece keyPrefix,
+    folly::FunctionRef<void(const std::string&, const thrift::Value&)> fn) {
+  reopenIfReplaced();
+  const auto capacity = mapping_->getHeader()->capacity;
+  Entry entry;
+  for (uint64_t i = 0; i < capacity; ++i) {
+    if (readSlot(i, folly::none, entry) and entry.state == USED and
+        folly::StringPiece(entry.key).startsWith(keyPrefix)) {
+      fn(entry.key, entry.value);
+    }
+  }
+}
+
+size_t
+KvStoreExportReader::getNumKeys() {
+  reopenIfReplaced();
+  return mapping_->getHeader()->numKeys.load(std::memory_order_relaxed);
+}
+
+} // namespace openr
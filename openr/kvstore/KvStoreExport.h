@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+//
+// Read-only mirror of the key-values of a KvStore area in a memory mapped
+// file, for local readers to look keys up and scan key prefixes without
+// going through KvStore.
+//
+// The file holds a header, an open addressing hash table of fixed size slots
+// probed linearly, and a slab the key, originator ID and value of every slot
+// are stored in, in blocks of power of two sizes. The KvStore thread updates
+// a slot under a sequence lock of its own: its sequence number is odd while
+// the slot or its block are written. Readers copy a slot and its block and
+// retry if its sequence number changed meanwhile. Erased slots are left as
+// tombstones for probes to go on past them.
+//
+// The file never changes size. When the table or the slab are full the
+// writer rebuilds the mirror in a new file, renames it into place and marks
+// the previous one closed, readers then reopen the path.
+//
+namespace kv_export {
+
+constexpr uint32_t kMagic{0x4f4b5653}; // "OKVS"
+constexpr uint32_t kFormatVersion{1};
+
+// header flags
+constexpr uint32_t kFlagClosed{1};
+
+// size of the smallest slab block, others are power of two multiples of it
+constexpr size_t kMinBlockSize{64};
+
+struct Header {
+  uint32_t magic;
+  uint32_t formatVersion;
+  uint32_t headerSize;
+  std::atomic<uint32_t> flags;
+  // number of slots, a power of two
+  uint64_t capacity;
+  uint64_t tableOffset;
+  uint64_t slabOffset;
+  uint64_t slabSize;
+  // informational, not synchronized with the slots
+  std::atomic<uint64_t> numKeys;
+};
+
+enum SlotState : uint8_t {
+  EMPTY = 0,
+  USED = 1,
+  TOMBSTONE = 2,
+};
+
+struct Slot {
+  // sequence lock of the slot and its block, odd while writing
+  std::atomic<uint64_t> seq;
+  uint64_t keyHash;
+  // block of key, originator ID and value in the slab
+  uint64_t blockOffset;
+  uint32_t keyLen;
+  uint32_t originatorIdLen;
+  uint32_t valueLen;
+  uint8_t state;
+  uint8_t hasValue;
+  uint8_t hasHash;
+  // block of kMinBlockSize << sizeClass bytes
+  uint8_t sizeClass;
+  int64_t version;
+  int64_t ttl;
+  int64_t ttlVersion;
+  int64_t hash;
+};
+
+// hash of keys, stable across processes
+uint64_t hashKey(folly::StringPiece key);
+
+// mapping of a mirror file
+struct Mapping;
+
+} // namespace kv_export
+
+//
+// Writer of the mirror of an area, owned by its KvStoreDb. Not thread safe
+//
+class KvStoreExporter {
+ public:
+  // creates or replaces the file at path, throws std::system_error on failure
+  explicit KvStoreExporter(
+      std::string path,
+      size_t initialCapacity = 1024,
+      size_t initialSlabSize = 1 << 20);
+  ~KvStoreExporter();
+
+  KvStoreExporter(const KvStoreExporter&) = delete;
+  KvStoreExporter& operator=(const KvStoreExporter&) = delete;
+
+  // add or update key. Throws std::system_error if the mirror has to be
+  // rebuilt and it fails, the exporter must not be used anymore then
+  void set(const std::string& key, const thrift::Value& value);
+
+  // remove key if present
+  void erase(const std::string& key);
+
+  size_t
+  getNumKeys() const {
+    return numKeys_;
+  }
+
+  size_t
+  getNumRebuilds() const {
+    return numRebuilds_;
+  }
+
+  const std::string&
+  getPath() const {
+    return path_;
+  }
+
+ private:
+  // set key without rebuilding, false if the table or the slab are full
+  bool trySet(const std::string& key, const thrift::Value& value);
+
+  // move the mirror to a new file with room for one more key of blockSize
+  void rebuild(size_t blockSize);
+
+  // create a mapping of the given size at a temporary path
+  std::unique_ptr<kv_export::Mapping> createMapping(
+      uint64_t capacity, uint64_t slabSize) const;
+
+  // rename mapping into place and close the current one
+  void install(std::unique_ptr<kv_export::Mapping> mapping);
+
+  // slot of key, or nullptr. firstFree is set to the first slot key may be
+  // added at if it isn't found
+  kv_export::Slot* findSlot(
+      const std::string& key,
+      uint64_t keyHash,
+      kv_export::Slot** firstFree) const;
+
+  // block of sizeClass from the free blocks or the end of the slab, none if
+  // the slab is full
+  folly::Optional<uint64_t> allocateBlock(uint8_t sizeClass);
+
+  const std::string path_;
+  const size_t initialSlabSize_{0};
+  std::unique_ptr<kv_export::Mapping> mapping_;
+
+  // allocation state of the slab, free blocks by size class
+  std::vector<std::vector<uint64_t>> freeBlocks_;
+  uint64_t slabUsed_{0};
+
+  size_t numKeys_{0};
+  size_t numTombstones_{0};
+  size_t numRebuilds_{0};
+};
+
+//
+// Reader of a mirror, reopening it when it was rebuilt. Not thread safe
+//
+class KvStoreExportReader {
+ public:
+  // throws std::runtime_error if the file isn't a valid mirror
+  explicit KvStoreExportReader(std::string path);
+  ~KvStoreExportReader();
+
+  KvStoreExportReader(const KvStoreExportReader&) = delete;
+  KvStoreExportReader& operator=(const KvStoreExportReader&) = delete;
+
+  // value of key, none if absent
+  folly::Optional<thrift::Value> get(const std::string& key);
+
+  // call fn on keys starting with keyPrefix. Every key-value is consistent on
+  // its own, updates made during the scan may or may not be seen
+  void forEach(
+      folly::StringPiece keyPrefix,
+      folly::FunctionRef<void(const std::string&, const thrift::Value&)> fn);
+
+  // approximate number of keys
+  size_t getNumKeys();
+
+  // the writer went away without a replacement
+  bool isClosed();
+
+ private:
+  // copy of a slot and its block
+  struct Entry {
+    uint8_t state{kv_export::EMPTY};
+    uint64_t keyHash{0};
+    std::string key;
+    thrift::Value value;
+  };
+
+  // reopen the path if the current mirror was closed and replaced
+  void reopenIfReplaced();
+
+  // consistent copy of slot at index. Its block is copied if it is used and
+  // keyHash is none or matches. False if the writer kept interfering
+  bool readSlot(
+      size_t index, folly::Optional<uint64_t> keyHash, Entry& entry) const;
+
+  const std::string path_;
+  std::unique_ptr<kv_export::Mapping> mapping_;
+};
+
+} // namespace openr
@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/kvstore/KvStoreProfiler.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <folly/Format.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// indexed by KvStorePhase
+const std::array<const char*, KvStoreLatencies::kNumPhases> kPhaseNames{{
+    "merge",
+    "flood",
+    "full_sync",
+}};
+
+const std::string kOtherKeyFamily{"other"};
+
+std::vector<thrift::KvStoreChurnEntry>
+toThrift(std::vector<SpaceSavingSketch::Entry> const& entries) {
+  std::vector<thrift::KvStoreChurnEntry> res;
+  res.reserve(entries.size());
+  for (auto const& entry : entries) {
+    thrift::KvStoreChurnEntry churnEntry;
+    churnEntry.name = entry.item;
+    churnEntry.count = entry.count;
+    churnEntry.error = entry.error;
+    res.emplace_back(std::move(churnEntry));
+  }
+  return res;
+}
+
+void
+addUsage(KvStoreMemoryTracker::Usage& usage, size_t bytes) {
+  usage.numKeys++;
+  usage.numBytes += bytes;
+}
+
+// returns true once usage holds no keys
+bool
+removeUsage(KvStoreMemoryTracker::Usage& usage, size_t bytes) {
+  DCHECK_LT(0, usage.numKeys);
+  DCHECK_LE(bytes, usage.numBytes);
+  usage.numKeys--;
+  usage.numBytes -= bytes;
+  return usage.numKeys == 0;
+}
+
+// keys and bytes of the k usages holding the most bytes, e.g.
+// "kvstore.memory.<type>.<name>.bytes"
+void
+addTopUsageCounters(
+    std::unordered_map<std::string, KvStoreMemoryTracker::Usage> const& usages,
+    size_t k,
+    const std::string& type,
+    std::unordered_map<std::string, int64_t>& counters) {
+  std::vector<std::pair<const std::string, KvStoreMemoryTracker::Usage> const*>
+      topUsages;
+  topUsages.reserve(usages.size());
+  for (auto const& kv : usages) {
+    topUsages.emplace_back(&kv);
+  }
+  k = std::min(k, topUsages.size());
+  std::partial_sort(
+      topUsages.begin(),
+      topUsages.begin() + k,
+      topUsages.end(),
+      [](auto const* lhs, auto const* rhs) {
+        return lhs->second.numBytes > rhs->second.numBytes;
+      });
+  for (size_t i = 0; i < k; ++i) {
+    auto const& kv = *topUsages[i];
+    counters[folly::sformat("kvstore.memory.{}.{}.keys", type, kv.first)] =
+        kv.second.numKeys;
+    counters[folly::sformat("kvstore.memory.{}.{}.bytes", type, kv.first)] =
+        kv.second.numBytes;
+  }
+}
+
+} // anonymous namespace
+
+constexpr size_t KvStoreLatencies::kNumPhases;
+
+SpaceSavingSketch::SpaceSavingSketch(size_t capacity) : capacity_(capacity) {
+  CHECK_LT(0, capacity_);
+}
+
+void
+SpaceSavingSketch::add(const std::string& item, uint64_t weight) {
+  auto it = entries_.find(item);
+  if (it == entries_.end()) {
+    uint64_t error = 0;
+    if (entries_.size() >= capacity_) {
+      // replace the lightest item
+      auto lightest = byCount_.begin();
+      error = lightest->first;
+      const std::string lightestItem = lightest->second->item;
+      byCount_.erase(lightest);
+      entries_.erase(lightestItem);
+    }
+    it = entries_.emplace(item, Entry{item, error, error}).first;
+  } else {
+    byCount_.erase({it->second.count, &it->second});
+  }
+  it->second.count += weight;
+  byCount_.emplace(it->second.count, &it->second);
+}
+
+void
+SpaceSavingSketch::decay() {
+  byCount_.clear();
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto& entry = it->second;
+    entry.count /= 2;
+    entry.error /= 2;
+    if (entry.count == 0) {
+      it = entries_.erase(it);
+      continue;
+    }
+    byCount_.emplace(entry.count, &entry);
+    ++it;
+  }
+}
+
+std::vector<SpaceSavingSketch::Entry>
+SpaceSavingSketch::getTopK(size_t k) const {
+  std::vector<Entry> res;
+  res.reserve(std::min(k, byCount_.size()));
+  for (auto it = byCount_.rbegin(); it != byCount_.rend() and res.size() < k;
+       ++it) {
+    res.emplace_back(*it->second);
+  }
+  return res;
+}
+
+KvStoreChurnTracker::KvStoreChurnTracker(
+    size_t sampleRate,
+    size_t sketchCapacity,
+    size_t maxKeyFamilies,
+    std::chrono::milliseconds decayInterval)
+    : sampleRate_(sampleRate),
+      maxKeyFamilies_(maxKeyFamilies),
+      decayInterval_(decayInterval),
+      lastDecay_(std::chrono::steady_clock::now()),
+      originators_(sketchCapacity),
+      keys_(sketchCapacity) {
+  CHECK_LT(0, sampleRate_);
+}
+
+const std::string*
+KvStoreChurnTracker::addUpdate(
+    const std::string& key,
+    const std::string& originatorId,
+    std::chrono::steady_clock::time_point now) {
+  if (++numUnsampled_ < sampleRate_) {
+    return nullptr;
+  }
+  numUnsampled_ = 0;
+  maybeDecay(now);
+
+  originators_.add(originatorId, sampleRate_);
+  keys_.add(key, sampleRate_);
+
+  auto family = getKeyFamily(key);
+  auto it = keyFamilies_.find(family);
+  if (it == keyFamilies_.end()) {
+    if (keyFamilies_.size() >= maxKeyFamilies_) {
+      // bound the number of counters, e.g. with many custom keys
+      family = kOtherKeyFamily;
+    }
+    it = keyFamilies_.emplace(std::move(family), 0).first;
+  }
+  it->second += sampleRate_;
+  return &it->first;
+}
+
+std::string
+KvStoreChurnTracker::getKeyFamily(const std::string& key) {
+  const auto pos = key.find(':');
+  if (pos == std::string::npos or pos == 0) {
+    return kOtherKeyFamily;
+  }
+  return key.substr(0, pos);
+}
+
+thrift::KvStoreChurnStats
+KvStoreChurnTracker::getStats(size_t k) const {
+  thrift::KvStoreChurnStats stats;
+  for (auto const& kv : keyFamilies_) {
+    thrift::KvStoreChurnEntry churnEntry;
+    churnEntry.name = kv.first;
+    churnEntry.count = kv.second;
+    stats.keyFamilies.emplace_back(std::move(churnEntry));
+  }
+  std::sort(
+      stats.keyFamilies.begin(),
+      stats.keyFamilies.end(),
+      [](auto const& lhs, auto const& rhs) { return lhs.count > rhs.count; });
+  stats.topOriginators = toThrift(originators_.getTopK(k));
+  stats.topKeys = toThrift(keys_.getTopK(k));
+  stats.sampleRate = sampleRate_;
+  return stats;
+}
+
+std::unordered_map<std::string, int64_t>
+KvStoreChurnTracker::getCounters(size_t k) const {
+  std::unordered_map<std::string, int64_t> counters;
+  for (auto const& entry : originators_.getTopK(k)) {
+    counters[folly::sformat("kvstore.churn.originator.{}", entry.item)] =
+        entry.count;
+  }
+  return counters;
+}
+
+void
+KvStoreChurnTracker::maybeDecay(std::chrono::steady_clock::time_point now) {
+  if (now - lastDecay_ < decayInterval_) {
+    return;
+  }
+  // halve once per elapsed interval
+  while (now - lastDecay_ >= decayInterval_) {
+    lastDecay_ += decayInterval_;
+    originators_.decay();
+    keys_.decay();
+    for (auto it = keyFamilies_.begin(); it != keyFamilies_.end();) {
+      it->second /= 2;
+      it = it->second ? std::next(it) : keyFamilies_.erase(it);
+    }
+    if (keyFamilies_.empty() and originators_.size() == 0) {
+      // nothing left to halve
+      lastDecay_ = now;
+      break;
+    }
+  }
+}
+
+KvStoreMemoryTracker::KvStoreMemoryTracker(KvStoreQuota quota)
+    : quota_(quota) {}
+
+size_t
+KvStoreMemoryTracker::getBytes(
+    const std::string& key, const thrift::Value& value) {
+  return key.size() + value.originatorId.size() +
+      (value.value.hasValue() ? value.value->size() : 0);
+}
+
+void
+KvStoreMemoryTracker::add(
+    const std::string& key, const std::string& originatorId, size_t bytes) {
+  addUsage(total_, bytes);
+  addUsage(originators_[originatorId], bytes);
+  addUsage(keyFamilies_[KvStoreChurnTracker::getKeyFamily(key)], bytes);
+}
+
+void
+KvStoreMemoryTracker::remove(
+    const std::string& key, const std::string& originatorId, size_t bytes) {
+  removeUsage(total_, bytes);
+  // forget originators and key families once they hold no keys
+  auto originatorIt = originators_.find(originatorId);
+  DCHECK(originatorIt != originators_.end());
+  if (removeUsage(originatorIt->second, bytes)) {
+    originators_.erase(originatorIt);
+  }
+  auto keyFamilyIt = keyFamilies_.find(KvStoreChurnTracker::getKeyFamily(key));
+  DCHECK(keyFamilyIt != keyFamilies_.end());
+  if (removeUsage(keyFamilyIt->second, bytes)) {
+    keyFamilies_.erase(keyFamilyIt);
+  }
+}
+
+bool
+KvStoreMemoryTracker::isWithinQuota(
+    const std::string& originatorId, Usage const& usage) const {
+  const auto current = getOriginatorUsage(originatorId);
+  // originators already past their quota, e.g. once it's lowered, can
+  // still shrink
+  if (quota_.maxKeysPerOriginator and usage.numKeys > current.numKeys and
+      usage.numKeys > quota_.maxKeysPerOriginator) {
+    return false;
+  }
+  if (quota_.maxBytesPerOriginator and usage.numBytes > current.numBytes and
+      usage.numBytes > quota_.maxBytesPerOriginator) {
+    return false;
+  }
+  return true;
+}
+
+KvStoreMemoryTracker::Usage
+KvStoreMemoryTracker::getOriginatorUsage(
+    const std::string& originatorId) const {
+  auto it = originators_.find(originatorId);
+  return it != originators_.end() ? it->second : Usage{};
+}
+
+std::unordered_map<std::string, int64_t>
+KvStoreMemoryTracker::getCounters(size_t k) const {
+  std::unordered_map<std::string, int64_t> counters;
+  counters["kvstore.memory.keys"] = total_.numKeys;
+  counters["kvstore.memory.bytes"] = total_.numBytes;
+  counters["kvstore.memory.num_originators"] = originators_.size();
+  addTopUsageCounters(originators_, k, "originator", counters);
+  addTopUsageCounters(keyFamilies_, k, "key_family", counters);
+  return counters;
+}
+
+KvStoreLatencies::KvStoreLatencies(size_t windowSize)
+    : histograms_(kNumPhases, WindowedHistogram(windowSize)) {}
+
+void
+KvStoreLatencies::addDuration(
+    KvStorePhase phase, std::chrono::nanoseconds duration) {
+  const auto index = static_cast<size_t>(phase);
+  DCHECK_LT(index, kNumPhases);
+  histograms_[index].addValue(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+std::unordered_map<std::string, int64_t>
+KvStoreLatencies::getCounters() const {
+  std::unordered_map<std::string, int64_t> counters;
+  for (size_t i = 0; i < kNumPhases; ++i) {
+    histograms_[i].addCounters(
+        folly::sformat("kvstore.phase.{}_us", kPhaseNames[i]), counters);
+  }
+  return counters;
+}
+
+} // namespace openr
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openr/common/WindowedHistogram.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+//
+// Space-saving sketch (Metwally et al.) approximating the heaviest items of
+// a stream with a bounded number of counters. Once capacity items are
+// tracked, a new item replaces the lightest one and inherits its count as
+// error. The count of a tracked item is over-estimated by at most its error,
+// and any item heavier than the total weight divided by capacity is tracked.
+//
+class SpaceSavingSketch {
+ public:
+  struct Entry {
+    std::string item;
+    uint64_t count{0};
+    uint64_t error{0};
+  };
+
+  explicit SpaceSavingSketch(size_t capacity);
+
+  // entries point to each other
+  SpaceSavingSketch(const SpaceSavingSketch&) = delete;
+  SpaceSavingSketch& operator=(const SpaceSavingSketch&) = delete;
+
+  void add(const std::string& item, uint64_t weight = 1);
+
+  // halve all counts and errors, forgetting items whose count drops to 0
+  void decay();
+
+  // up to k heaviest tracked items, heaviest first
+  std::vector<Entry> getTopK(size_t k) const;
+
+  size_t
+  size() const {
+    return entries_.size();
+  }
+
+ private:
+  const size_t capacity_{0};
+
+  std::unordered_map<std::string, Entry> entries_;
+
+  // tracked entries ordered by count, lightest first
+  std::set<std::pair<uint64_t, const Entry*>> byCount_;
+};
+
+//
+// Churn of the keys of a KvStore area. One in sampleRate key updates is
+// sampled and accounted for sampleRate updates of its key, originator and
+// key family (the key up to its first ':', e.g. "adj"). Counts are halved
+// every decayInterval so that they reflect recent churn.
+//
+class KvStoreChurnTracker {
+ public:
+  KvStoreChurnTracker(
+      size_t sampleRate,
+      size_t sketchCapacity,
+      size_t maxKeyFamilies,
+      std::chrono::milliseconds decayInterval);
+
+  // account for an update of key. Returns the key family if the update got
+  // sampled, nullptr otherwise
+  const std::string* addUpdate(
+      const std::string& key,
+      const std::string& originatorId,
+      std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now());
+
+  // key family of a key, "other" if it has none
+  static std::string getKeyFamily(const std::string& key);
+
+  // all key families and the k heaviest originators and keys
+  thrift::KvStoreChurnStats getStats(size_t k) const;
+
+  // estimated updates of the k heaviest originators, e.g.
+  // "kvstore.churn.originator.node1"
+  std::unordered_map<std::string, int64_t> getCounters(size_t k) const;
+
+  size_t
+  getSampleRate() const {
+    return sampleRate_;
+  }
+
+ private:
+  void maybeDecay(std::chrono::steady_clock::time_point now);
+
+  const size_t sampleRate_{1};
+  const size_t maxKeyFamilies_{0};
+  const std::chrono::milliseconds decayInterval_;
+
+  // updates seen since the last sampled one
+  size_t numUnsampled_{0};
+
+  std::chrono::steady_clock::time_point lastDecay_;
+
+  std::unordered_map<std::string, uint64_t> keyFamilies_;
+  SpaceSavingSketch originators_;
+  SpaceSavingSketch keys_;
+};
+
+//
+// Limits on the keys an originator may hold in a KvStore area, 0 for none
+//
+struct KvStoreQuota {
+  size_t maxKeysPerOriginator{0};
+  // bytes of keys and values
+  size_t maxBytesPerOriginator{0};
+};
+
+//
+// Keys and bytes of keys and values held in a KvStore area, by originator
+// and key family, checked against the quota of originators
+//
+class KvStoreMemoryTracker {
+ public:
+  struct Usage {
+    size_t numKeys{0};
+    size_t numBytes{0};
+  };
+
+  explicit KvStoreMemoryTracker(KvStoreQuota quota = {});
+
+  // bytes accounted for a key-value
+  static size_t getBytes(const std::string& key, const thrift::Value& value);
+
+  void add(
+      const std::string& key, const std::string& originatorId, size_t bytes);
+  void remove(
+      const std::string& key, const std::string& originatorId, size_t bytes);
+
+  bool
+  hasQuota() const {
+    return quota_.maxKeysPerOriginator or quota_.maxBytesPerOriginator;
+  }
+
+  // whether the quota allows an originator to hold usage, growing from what
+  // it holds
+  bool isWithinQuota(
+      const std::string& originatorId, Usage const& usage) const;
+
+  // usage of an originator, none if it holds no keys
+  Usage getOriginatorUsage(const std::string& originatorId) const;
+
+  Usage
+  getTotalUsage() const {
+    return total_;
+  }
+
+  // totals and usage of the k originators and key families holding the most
+  // bytes, e.g. "kvstore.memory.originator.node1.bytes"
+  std::unordered_map<std::string, int64_t> getCounters(size_t k) const;
+
+ private:
+  const KvStoreQuota quota_;
+
+  Usage total_;
+  std::unordered_map<std::string, Usage> originators_;
+  std::unordered_map<std::string, Usage> keyFamilies_;
+};
+
+//
+// KvStore processing phases whose latency is tracked
+//
+enum class KvStorePhase : uint8_t {
+  // merge of a publication with the store, up to the flood of its delta
+  MERGE = 0,
+  // flood of a publication to peers
+  FLOOD,
+  // full-sync with a peer, from request to response
+  FULL_SYNC,
+  // must be last
+  NUM_PHASES,
+};
+
+//
+// Latency histograms of KvStore phases over their most recent runs
+//
+class KvStoreLatencies {
+ public:
+  static constexpr size_t kNumPhases =
+      static_cast<size_t>(KvStorePhase::NUM_PHASES);
+
+  // windowSize is the number of most recent durations per phase the
+  // percentiles are computed over
+  explicit KvStoreLatencies(size_t windowSize);
+
+  void addDuration(KvStorePhase phase, std::chrono::nanoseconds duration);
+
+  // p50, p99 and max duration in microseconds of each phase that ran so far,
+  // e.g. "kvstore.phase.merge_us.p99"
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
+ private:
+  // most recent durations of each phase in microseconds, indexed by
+  // KvStorePhase
+  std::vector<WindowedHistogram> histograms_;
+};
+
+} // namespace openr
@@ -32,7 +32,16 @@ KvStoreWrapper::KvStoreWrapper(
     std::chrono::milliseconds ttlDecr,
     bool enableFloodOptimization,
     bool isFloodRoot,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    size_t numMergeShards,
+    std::string snapshotFilePath,
+    bool enableThriftPeers,
+    bool enableMultiRootFlooding,
+    std::vector<std::string> floodPriorityKeyPrefixes,
+    KvStoreQuota quota,
+    size_t lazyValueThreshold,
+    bool partitionedFullSync,
+    bool enableAreaEventBases)
     : nodeId(nodeId),
       localPubUrl(folly::sformat("inproc://{}-kvstore-pub", nodeId)),
       globalCmdUrl(folly::sformat("inproc://{}-kvstore-global-cmd", nodeId)),
@@ -61,7 +70,19 @@ KvStoreWrapper::KvStoreWrapper(
       enableFloodOptimization,
       isFloodRoot,
       useFloodOptimization,
-      areas);
+      areas,
+      numMergeShards,
+      std::move(snapshotFilePath),
+      Constants::kKvStoreSnapshotInterval,
+      enableThriftPeers,
+      enableMultiRootFlooding,
+      std::move(floodPriorityKeyPrefixes),
+      quota,
+      "" /* exportPathPrefix */,
+      lazyValueThreshold,
+      partitionedFullSync,
+      nullptr /* runtimeKnobs */,
+      enableAreaEventBases);
 
   localCmdUrl = kvStore_->inprocCmdUrl;
 }
@@ -261,6 +282,22 @@ KvStoreWrapper::addPeer(
   return true;
 }
 
+bool
+KvStoreWrapper::addPeers(
+    std::unordered_map<std::string, thrift::PeerSpec> peers,
+    std::string area) {
+  thrift::PeerAddParams params;
+  params.peers = std::move(peers);
+
+  try {
+    kvStore_->addUpdateKvStorePeers(params, area).get();
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to add peers: " << folly::exceptionStr(e);
+    return false;
+  }
+  return true;
+}
+
 bool
 KvStoreWrapper::delPeer(std::string peerName, std::string area) {
   // Prepare peerDelParams
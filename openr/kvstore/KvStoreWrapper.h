@@ -41,7 +41,16 @@ class KvStoreWrapper {
       bool enableFloodOptimization = false,
       bool isFloodRoot = false,
       const std::unordered_set<std::string>& areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      size_t numMergeShards = 1,
+      std::string snapshotFilePath = "",
+      bool enableThriftPeers = false,
+      bool enableMultiRootFlooding = false,
+      std::vector<std::string> floodPriorityKeyPrefixes = {},
+      KvStoreQuota quota = {},
+      size_t lazyValueThreshold = 0,
+      bool partitionedFullSync = false,
+      bool enableAreaEventBases = false);
 
   ~KvStoreWrapper() {
     stop();
@@ -60,7 +69,7 @@ class KvStoreWrapper {
   /**
    * Get reader for KvStore updates queue
    */
-  messaging::RQueue<thrift::Publication>
+  messaging::RQueue<KvStorePublicationPtr>
   getReader() {
     return kvStoreUpdatesQueue_.getReader();
   }
@@ -145,6 +154,9 @@ class KvStoreWrapper {
       std::string peerName,
       thrift::PeerSpec spec,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
+  bool addPeers(
+      std::unordered_map<std::string, thrift::PeerSpec> peers,
+      std::string area = openr::thrift::KvStore_constants::kDefaultArea());
   bool delPeer(
       std::string peerName,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -193,7 +205,7 @@ class KvStoreWrapper {
   apache::thrift::CompactSerializer serializer_;
 
   // Queue for streaming KvStore updates
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue_;
+  messaging::ReplicateQueue<KvStorePublicationPtr> kvStoreUpdatesQueue_;
 
   // ZMQ request socket for interacting with KvStore's command socket
   fbzmq::Socket<ZMQ_REQ, fbzmq::ZMQ_CLIENT> reqSock_;
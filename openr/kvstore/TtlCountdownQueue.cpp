@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/kvstore/TtlCountdownQueue.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+constexpr size_t TtlCountdownQueue::kSlotBits;
+constexpr size_t TtlCountdownQueue::kNumSlots;
+constexpr size_t TtlCountdownQueue::kNumLevels;
+
+TtlCountdownQueue::TtlCountdownQueue(
+    std::chrono::milliseconds tick, Clock::time_point startTime)
+    : tick_(tick), startTime_(startTime) {
+  CHECK_LT(0, tick_.count());
+  static_assert(kSlotBits * kNumLevels < 64, "wheel must fit in 64 bits");
+}
+
+void
+TtlCountdownQueue::schedule(TtlCountdownQueueEntry entry) {
+  auto res = entries_.try_emplace(entry.key);
+  auto& node = res.first->second;
+  if (not res.second) {
+    unlink(&node);
+  }
+  node.expiryTick = getTick(entry.expiryTime);
+  node.entry = std::move(entry);
+  link(&node, currentTick_ + 1);
+}
+
+bool
+TtlCountdownQueue::cancel(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  unlink(&it->second);
+  entries_.erase(it);
+  return true;
+}
+
+const TtlCountdownQueueEntry*
+TtlCountdownQueue::find(const std::string& key) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second.entry;
+}
+
+std::vector<TtlCountdownQueueEntry>
+TtlCountdownQueue::expire(Clock::time_point now) {
+  std::vector<TtlCountdownQueueEntry> expired;
+  const uint64_t nowTick = now > startTime_
+      ? static_cast<uint64_t>((now - startTime_) / tick_)
+      : 0;
+  while (currentTick_ < nowTick) {
+    if (levelSizes_[0] == 0) {
+      // nothing to do until entries move down to level 0
+      const uint64_t nextWrap = (currentTick_ | (kNumSlots - 1)) + 1;
+      if (entries_.empty() or nextWrap > nowTick) {
+        currentTick_ = nowTick;
+        break;
+      }
+      currentTick_ = nextWrap - 1;
+    }
+    processTick(currentTick_ + 1, expired);
+  }
+  return expired;
+}
+
+std::optional<TtlCountdownQueue::Clock::time_point>
+TtlCountdownQueue::getNextExpiryTime() const {
+  if (entries_.empty()) {
+    return std::nullopt;
+  }
+  uint64_t nextTick = std::numeric_limits<uint64_t>::max();
+  for (size_t level = 0; level < kNumLevels; ++level) {
+    if (levelSizes_[level] == 0) {
+      continue;
+    }
+    // slots of this level are reached once every kNumSlots of its periods
+    const size_t shift = kSlotBits * level;
+    const uint64_t period = currentTick_ >> shift;
+    for (uint64_t i = 1; i <= kNumSlots; ++i) {
+      if (slots_[level][(period + i) & (kNumSlots - 1)]) {
+        nextTick = std::min(nextTick, (period + i) << shift);
+        break;
+      }
+    }
+  }
+  DCHECK_NE(std::numeric_limits<uint64_t>::max(), nextTick);
+  return startTime_ + nextTick * tick_;
+}
+
+uint64_t
+TtlCountdownQueue::getTick(Clock::time_point time) const {
+  if (time <= startTime_) {
+    return 0;
+  }
+  const auto elapsed = time - startTime_;
+  const auto ticks = static_cast<uint64_t>(elapsed / tick_);
+  return elapsed % tick_ == Clock::duration::zero() ? ticks : ticks + 1;
+}
+
+void
+TtlCountdownQueue::link(Node* node, uint64_t minTick) {
+  const uint64_t tick = std::max(node->expiryTick, minTick);
+  const uint64_t delta = tick - currentTick_;
+
+  // lowest level whose slots are reached before the expiry tick passes
+  size_t level = 0;
+  while (level + 1 < kNumLevels and
+         delta >= (uint64_t{1} << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  // entries beyond the range of the wheel are kept in the farthest slot and
+  // linked again from there
+  const uint64_t maxTick =
+      currentTick_ + (uint64_t{1} << (kSlotBits * kNumLevels)) - 1;
+  const uint64_t slotTick = std::min(tick, maxTick);
+
+  node->level = level;
+  node->slot = (slotTick >> (kSlotBits * level)) & (kNumSlots - 1);
+  auto& head = slots_[level][node->slot];
+  node->prev = nullptr;
+  node->next = head;
+  if (head) {
+    head->prev = node;
+  }
+  head = node;
+  ++levelSizes_[level];
+}
+
+void
+TtlCountdownQueue::unlink(Node* node) {
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    DCHECK_EQ(node, slots_[node->level][node->slot]);
+    slots_[node->level][node->slot] = node->next;
+  }
+  if (node->next) {
+    node->next->prev = node->prev;
+  }
+  node->prev = nullptr;
+  node->next = nullptr;
+  --levelSizes_[node->level];
+}
+
+void
+TtlCountdownQueue::processTick(
+    uint64_t tick, std::vector<TtlCountdownQueueEntry>& expired) {
+  currentTick_ = tick;
+
+  // move entries down from the slots reached with this tick, highest level
+  // first as entries may move down more than one level
+  for (size_t level = kNumLevels - 1; level > 0; --level) {
+    const size_t shift = kSlotBits * level;
+    if (tick & ((uint64_t{1} << shift) - 1)) {
+      continue;
+    }
+    auto& head = slots_[level][(tick >> shift) & (kNumSlots - 1)];
+    auto* node = std::exchange(head, nullptr);
+    while (node) {
+      auto* next = node->next;
+      --levelSizes_[level];
+      link(node, tick);
+      node = next;
+    }
+  }
+
+  auto* node = std::exchange(slots_[0][tick & (kNumSlots - 1)], nullptr);
+  while (node) {
+    auto* next = node->next;
+    --levelSizes_[0];
+    if (node->expiryTick <= tick) {
+      expired.emplace_back(std::move(node->entry));
+      entries_.erase(expired.back().key);
+    } else {
+      link(node, tick + 1);
+    }
+    node = next;
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openr {
+
+struct TtlCountdownQueueEntry {
+  std::chrono::steady_clock::time_point expiryTime;
+  std::string key;
+  int64_t version{0};
+  int64_t ttlVersion{0};
+  std::string originatorId;
+};
+
+//
+// TTL countdown of KvStore keys, as a hierarchical timing wheel with one
+// entry per key. Scheduling a key replaces its previous countdown, both
+// scheduling and cancelling take constant time.
+//
+// Time is split into ticks. The wheel has kNumLevels levels of kNumSlots
+// slots each, a slot of level n covering kNumSlots^n ticks. Entries are kept
+// in the slot of the lowest level covering their expiry tick and move down a
+// level whenever the wheel reaches their slot, until they expire from a slot
+// of level 0. Expiry is exact, entries never expire before their expiryTime.
+//
+class TtlCountdownQueue {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kSlotBits = 8;
+  static constexpr size_t kNumSlots = 1 << kSlotBits;
+  static constexpr size_t kNumLevels = 4;
+
+  explicit TtlCountdownQueue(
+      std::chrono::milliseconds tick = std::chrono::milliseconds(1),
+      Clock::time_point startTime = Clock::now());
+
+  ~TtlCountdownQueue() = default;
+
+  // entries link to each other
+  TtlCountdownQueue(const TtlCountdownQueue&) = delete;
+  TtlCountdownQueue& operator=(const TtlCountdownQueue&) = delete;
+
+  // schedule the countdown of entry.key, replacing the existing one if any
+  void schedule(TtlCountdownQueueEntry entry);
+
+  // cancel the countdown of key. Returns false if there was none
+  bool cancel(const std::string& key);
+
+  // countdown of key, nullptr if there is none
+  const TtlCountdownQueueEntry* find(const std::string& key) const;
+
+  // advance the wheel to now, removing and returning the expired entries
+  std::vector<TtlCountdownQueueEntry> expire(Clock::time_point now);
+
+  // earliest time at which entries might expire or need to move down a level,
+  // i.e. when expire() should be called next. None if there are no entries
+  std::optional<Clock::time_point> getNextExpiryTime() const;
+
+  size_t
+  size() const {
+    return entries_.size();
+  }
+
+  bool
+  empty() const {
+    return entries_.empty();
+  }
+
+ private:
+  struct Node {
+    TtlCountdownQueueEntry entry;
+    // tick at which the entry expires
+    uint64_t expiryTick{0};
+    // position in the wheel, nodes of a slot form a doubly linked list
+    size_t level{0};
+    size_t slot{0};
+    Node* prev{nullptr};
+    Node* next{nullptr};
+  };
+
+  // first tick at or after time
+  uint64_t getTick(Clock::time_point time) const;
+
+  // link node into the slot covering its expiry tick, entries due before
+  // minTick expire with minTick
+  void link(Node* node, uint64_t minTick);
+
+  // unlink node from its slot
+  void unlink(Node* node);
+
+  // process tick, moving entries down from higher levels and expiring the
+  // entries of the level 0 slot
+  void processTick(
+      uint64_t tick, std::vector<TtlCountdownQueueEntry>& expired);
+
+  const std::chrono::milliseconds tick_;
+  const Clock::time_point startTime_;
+
+  // last processed tick
+  uint64_t currentTick_{0};
+
+  // entries keyed by key, unordered_map never moves its elements
+  std::unordered_map<std::string, Node> entries_;
+
+  // heads of the slot lists and number of entries per level
+  std::array<std::array<Node*, kNumSlots>, kNumLevels> slots_{};
+  std::array<size_t, kNumLevels> levelSizes_{};
+};
+
+} // namespace openr
@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <unordered_map>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/kvstore/FloodSeenCache.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+namespace {
+
+thrift::Value
+createValue(int64_t version, const std::string& data, int64_t ttl = 1000) {
+  thrift::Value value;
+  value.version = version;
+  value.originatorId = "node1";
+  value.value = data;
+  value.ttl = ttl;
+  value.ttlVersion = 0;
+  return value;
+}
+
+} // namespace
+
+TEST(FloodSeenCacheTest, FloodId) {
+  std::unordered_map<std::string, thrift::Value> keyVals{
+      {"key1", createValue(1, "a")}, {"key2", createValue(1, "b")}};
+  const auto floodId = FloodSeenCache::getFloodId(keyVals);
+
+  // remaining TTL drops along the flood path
+  auto copy = keyVals;
+  copy.at("key1").ttl = 500;
+  EXPECT_EQ(floodId, FloodSeenCache::getFloodId(copy));
+
+  // anything else makes a different update
+  copy = keyVals;
+  copy.at("key1").version = 2;
+  EXPECT_NE(floodId, FloodSeenCache::getFloodId(copy));
+  copy = keyVals;
+  copy.at("key1").ttlVersion = 1;
+  EXPECT_NE(floodId, FloodSeenCache::getFloodId(copy));
+  copy = keyVals;
+  copy.at("key1").value = "c";
+  EXPECT_NE(floodId, FloodSeenCache::getFloodId(copy));
+  copy = keyVals;
+  copy.at("key1").originatorId = "node2";
+  EXPECT_NE(floodId, FloodSeenCache::getFloodId(copy));
+  copy = keyVals;
+  copy.erase("key2");
+  EXPECT_NE(floodId, FloodSeenCache::getFloodId(copy));
+}
+
+TEST(FloodSeenCacheTest, Expiry) {
+  const auto now = FloodSeenCache::Clock::now();
+  FloodSeenCache cache(1s, 100);
+  EXPECT_TRUE(cache.insert(1, now));
+  EXPECT_TRUE(cache.insert(2, now + 500ms));
+  EXPECT_FALSE(cache.insert(1, now + 999ms));
+  EXPECT_EQ(2, cache.size());
+
+  // forgotten a ttl after they were first seen
+  EXPECT_TRUE(cache.insert(1, now + 1s));
+  EXPECT_FALSE(cache.insert(2, now + 1s));
+  EXPECT_TRUE(cache.insert(2, now + 1500ms));
+}
+
+TEST(FloodSeenCacheTest, MaxSize) {
+  const auto now = FloodSeenCache::Clock::now();
+  FloodSeenCache cache(1s, 2);
+  EXPECT_TRUE(cache.insert(1, now));
+  EXPECT_TRUE(cache.insert(2, now));
+  EXPECT_TRUE(cache.insert(3, now));
+  EXPECT_EQ(2, cache.size());
+
+  // oldest one is forgotten first
+  EXPECT_FALSE(cache.insert(3, now));
+  EXPECT_TRUE(cache.insert(1, now));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/kvstore/KeyIdDictionary.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::Value
+createValue(int64_t version, folly::Optional<std::string> data) {
+  thrift::Value value;
+  value.version = version;
+  value.originatorId = "node1";
+  value.value = std::move(data);
+  value.ttl = 1000;
+  value.ttlVersion = 1;
+  return value;
+}
+
+thrift::KeySetParams
+createParams() {
+  thrift::KeySetParams params;
+  params.keyVals.emplace("key1", createValue(1, std::string("a")));
+  params.keyVals.emplace("key2", createValue(2, std::string("b")));
+
+  thrift::KeyTtlUpdates updates;
+  updates.originatorId = "node1";
+  updates.keys = {"key3", "key1"};
+  updates.versions = {3, 1};
+  updates.ttlVersions = {4, 2};
+  updates.ttls = {1000, 2000};
+  params.ttlUpdates = std::vector<thrift::KeyTtlUpdates>{updates};
+  return params;
+}
+
+// encode params for peer as flooded, with definitions if needed
+thrift::KeySetParams
+encodeFor(KeyIdEncoder& encoder, const std::string& peer) {
+  auto params = createParams();
+  const auto keyIds = encoder.encode(params);
+  auto definitions = encoder.getNewDefinitions(peer, keyIds);
+  if (not definitions.empty()) {
+    params.keyIdDefinitions = std::move(definitions);
+  }
+  return params;
+}
+
+} // namespace
+
+TEST(KeyIdDictionaryTest, EncodeDecode) {
+  KeyIdEncoder encoder(100);
+  KeyIdDecoder decoder;
+
+  // first request defines the keys
+  auto params = encodeFor(encoder, "node2");
+  EXPECT_TRUE(params.keyVals.empty());
+  ASSERT_TRUE(params.keyIdVals.hasValue());
+  EXPECT_EQ(2, params.keyIdVals->size());
+  ASSERT_TRUE(params.keyIdDefinitions.hasValue());
+  EXPECT_EQ(3, params.keyIdDefinitions->size());
+  EXPECT_TRUE(params.ttlUpdates->at(0).keys.empty());
+  EXPECT_EQ(3, encoder.size());
+
+  EXPECT_TRUE(decoder.decode("node2", params));
+  EXPECT_EQ(createParams(), params);
+
+  // following ones only refer to them
+  params = encodeFor(encoder, "node2");
+  EXPECT_FALSE(params.keyIdDefinitions.hasValue());
+  EXPECT_TRUE(decoder.decode("node2", params));
+  EXPECT_EQ(createParams(), params);
+
+  // other peers get their own definitions
+  params = encodeFor(encoder, "node3");
+  EXPECT_TRUE(params.keyIdDefinitions.hasValue());
+
+  // params without key IDs are left as is
+  params = createParams();
+  EXPECT_TRUE(decoder.decode("node2", params));
+  EXPECT_EQ(createParams(), params);
+}
+
+TEST(KeyIdDictionaryTest, UnknownKeyIds) {
+  KeyIdEncoder encoder(100);
+  KeyIdDecoder decoder;
+
+  // definitions are lost, unknown key-vals and updates are dropped
+  encodeFor(encoder, "node2");
+  auto params = encodeFor(encoder, "node2");
+  EXPECT_FALSE(decoder.decode("node2", params));
+  EXPECT_TRUE(params.keyVals.empty());
+  EXPECT_TRUE(params.ttlUpdates->at(0).keys.empty());
+  EXPECT_TRUE(params.ttlUpdates->at(0).versions.empty());
+
+  // defined again once the peer is reset
+  encoder.resetPeer("node2");
+  params = encodeFor(encoder, "node2");
+  EXPECT_TRUE(decoder.decode("node2", params));
+  EXPECT_EQ(createParams(), params);
+}
+
+TEST(KeyIdDictionaryTest, Session) {
+  KeyIdEncoder encoder(2);
+  KeyIdDecoder decoder;
+  const auto session = encoder.getSession();
+
+  auto params = encodeFor(encoder, "node2");
+  EXPECT_TRUE(decoder.decode("node2", params));
+
+  // a new session starts once full, its IDs are defined again
+  encoder.resetIfFull();
+  EXPECT_NE(session, encoder.getSession());
+  EXPECT_EQ(0, encoder.size());
+  params = encodeFor(encoder, "node2");
+  EXPECT_TRUE(params.keyIdDefinitions.hasValue());
+  EXPECT_TRUE(decoder.decode("node2", params));
+  EXPECT_EQ(createParams(), params);
+
+  // definitions of the previous session are dropped
+  KeyIdEncoder otherEncoder(100);
+  encodeFor(otherEncoder, "node2");
+  params = encodeFor(otherEncoder, "node2");
+  EXPECT_FALSE(decoder.decode("node2", params));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
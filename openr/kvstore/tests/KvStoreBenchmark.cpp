@@ -118,7 +118,8 @@ void
 updateKvStore(
     const uint32_t numOfUpdateKeys,
     uint64_t& version,
-    std::unordered_map<std::string, thrift::Value>& kvStore) {
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    bool changeSet = false) {
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> update;
   // Randomly choose the start index of the keys to be updated
@@ -127,9 +128,9 @@ updateKvStore(
       ? kvStore.size() - numOfUpdateKeys
       : offsetIdx;
 
-  for (uint32_t idx = offsetIdx; idx < offsetIdx + numOfUpdateKeys; idx++) {
-    auto kvIt = kvStore.begin();
-    std::advance(kvIt, idx);
+  auto kvIt = kvStore.begin();
+  std::advance(kvIt, offsetIdx);
+  for (uint32_t idx = 0; idx < numOfUpdateKeys; idx++, kvIt++) {
     auto key = kvIt->first;
     auto newValue = genRandomStr(kSizeOfValue);
     thrift::Value thriftValue(
@@ -150,7 +151,11 @@ updateKvStore(
   suspender.dismiss(); // Start measuring benchmark time
 
   // Merge update with kvStore
-  KvStore::mergeKeyValues(kvStore, update);
+  if (changeSet) {
+    KvStore::mergeKeyValueUpdates(kvStore, update);
+  } else {
+    KvStore::mergeKeyValues(kvStore, update);
+  }
 }
 
 /**
@@ -199,8 +204,11 @@ floodingUpdate(
  * 2. Merge update with kvStore
  */
 static void
-BM_KvStoreMergeKeyValues(
-    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+BM_KvStoreMergeKeyValuesImpl(
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    size_t numOfUpdateKeys,
+    bool changeSet) {
   CHECK_LE(numOfUpdateKeys, numOfKeysInStore);
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> kvStore;
@@ -229,10 +237,28 @@ BM_KvStoreMergeKeyValues(
   version++;
   suspender.dismiss(); // Start measuring benchmark time
   for (uint32_t i = 0; i < iters; i++) {
-    updateKvStore(numOfUpdateKeys, version, kvStore);
+    updateKvStore(numOfUpdateKeys, version, kvStore, changeSet);
   }
 }
 
+static void
+BM_KvStoreMergeKeyValues(
+    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+  BM_KvStoreMergeKeyValuesImpl(
+      iters, numOfKeysInStore, numOfUpdateKeys, false /* changeSet */);
+}
+
+/**
+ * Benchmark for mergeKeyValueUpdates(), which returns the updated keys as a
+ * change set rather than copying them into a publication
+ */
+static void
+BM_KvStoreMergeKeyValueUpdates(
+    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+  BM_KvStoreMergeKeyValuesImpl(
+      iters, numOfKeysInStore, numOfUpdateKeys, true /* changeSet */);
+}
+
 /**
  * Benchmark for a full dump:
  * 1. Start kvStore
@@ -313,6 +339,12 @@ BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10, 10000, 10);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_100, 10000, 100);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_1000, 10000, 1000);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10000, 10000, 10000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreMergeKeyValues, 100000_100000, 100000, 100000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreMergeKeyValueUpdates, 10000_10000, 10000, 10000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreMergeKeyValueUpdates, 100000_100000, 100000, 100000);
 
 // The parameter is number of keyVals already in store
 BENCHMARK_PARAM(BM_KvStoreDumpAll, 10);
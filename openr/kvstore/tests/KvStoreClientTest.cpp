@@ -854,6 +854,146 @@ TEST(KvStoreClient, PersistKeyChangeTtlTest) {
   store->stop();
 }
 
+/**
+ * Persist many keys with finite TTL from a batched client. Keys persisted in
+ * one event loop iteration go out in one KEY_SET request, and their TTL
+ * refreshes stay together.
+ */
+TEST(KvStoreClient, BatchedPersistKeyTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+  const size_t kNumKeys{20};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  OpenrEventBase evb;
+  auto client = std::make_shared<KvStoreClient>(
+      context,
+      &evb,
+      nodeId,
+      store->localCmdUrl,
+      store->localPubUrl,
+      60000ms /* checkPersistKeyPeriod */,
+      3000ms /* recvTimeout */,
+      true /* batchUpdates */);
+
+  auto getNumKeySets = [&]() {
+    return store->getCounters().at("kvstore.cmd_key_set.count.0").value;
+  };
+
+  evb.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      client->persistKey(
+          folly::sformat("key-{}", i), "value", std::chrono::seconds(4));
+    }
+  });
+
+  // all keys advertised in one request
+  evb.scheduleTimeout(std::chrono::milliseconds(300), [&]() noexcept {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      auto maybeVal = store->getKey(folly::sformat("key-{}", i));
+      ASSERT_TRUE(maybeVal.hasValue());
+      EXPECT_EQ(1, maybeVal->version);
+    }
+    EXPECT_EQ(1, getNumKeySets());
+  });
+
+  // TTLs refreshed every second, one request for all keys each time
+  evb.scheduleTimeout(std::chrono::milliseconds(2500), [&]() noexcept {
+    auto firstVal = store->getKey("key-0");
+    ASSERT_TRUE(firstVal.hasValue());
+    EXPECT_LE(1, firstVal->ttlVersion);
+    for (size_t i = 1; i < kNumKeys; ++i) {
+      auto maybeVal = store->getKey(folly::sformat("key-{}", i));
+      ASSERT_TRUE(maybeVal.hasValue());
+      EXPECT_EQ(firstVal->ttlVersion, maybeVal->ttlVersion);
+    }
+    EXPECT_EQ(1 + firstVal->ttlVersion, getNumKeySets());
+    evb.stop();
+  });
+
+  evb.run();
+  store->stop();
+}
+
+/**
+ * Client handing requests to an in-process KvStore directly. The command
+ * socket URL doesn't exist, requests would fail if they went through it.
+ */
+TEST(KvStoreClient, DirectApiTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  OpenrEventBase evb;
+  auto client = std::make_shared<KvStoreClient>(
+      context,
+      &evb,
+      nodeId,
+      "inproc://nonexistent_cmd_url",
+      store->localPubUrl,
+      60000ms /* checkPersistKeyPeriod */,
+      3000ms /* recvTimeout */,
+      false /* batchUpdates */,
+      store->getKvStore());
+
+  evb.runInEventBaseThread([&]() noexcept {
+    EXPECT_TRUE(client->setKey("key1", "value1").hasValue());
+    EXPECT_TRUE(client->setKey("key2", "value2").hasValue());
+    // several keys in one request
+    std::unordered_map<std::string, thrift::Value> keyVals{
+        {"batch1", createThriftValue(1, nodeId, std::string("v1"))},
+        {"batch2", createThriftValue(1, nodeId, std::string("v2"))}};
+    EXPECT_TRUE(client->setKeys(keyVals).hasValue());
+
+    auto maybeVal = client->getKey("key1");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_EQ("value1", maybeVal->value.value());
+    EXPECT_FALSE(client->getKey("key3").hasValue());
+
+    auto maybeKeyVals = client->dumpAllWithPrefix("key");
+    ASSERT_TRUE(maybeKeyVals.hasValue());
+    EXPECT_EQ(2, maybeKeyVals->size());
+
+    // errors of KvStore are reported
+    EXPECT_FALSE(client->getKey("key1", "invalid_area").hasValue());
+
+    std::unordered_map<std::string, thrift::PeerSpec> peers{
+        {"peer1", createPeerSpec("inproc://fake_cmd_url_1", false)}};
+    EXPECT_TRUE(client->addPeers(peers).hasValue());
+    auto maybePeers = client->getPeers();
+    ASSERT_TRUE(maybePeers.hasValue());
+    EXPECT_EQ(peers, *maybePeers);
+    EXPECT_TRUE(client->delPeer("peer1").hasValue());
+    EXPECT_EQ(0, client->getPeers()->size());
+
+    evb.stop();
+  });
+
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+  evb.waitUntilStopped();
+  evbThread.join();
+
+  EXPECT_EQ("value2", store->getKey("key2")->value.value());
+  EXPECT_EQ("v1", store->getKey("batch1")->value.value());
+  EXPECT_EQ("v2", store->getKey("batch2")->value.value());
+  store->stop();
+}
+
 /**
  * Start a store and attach two clients to it. Set some Keys and add/del peers.
  * Verify that changes are visible in KvStore via a separate REQ socket to
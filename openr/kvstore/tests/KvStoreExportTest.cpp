@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <thread>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/kvstore/KvStoreExport.h>
+
+using namespace openr;
+
+namespace {
+
+std::string
+getExportPath() {
+  return folly::sformat(
+      "/tmp/openr_kvstore_export_test_{}",
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+thrift::Value
+createValue(int64_t version, const std::string& value) {
+  return createThriftValue(version, "node1", value, 3600000, 0, 1234);
+}
+
+// value of version i, of 10 * (i + 1) bytes, all of letter i
+std::string
+createLetters(int64_t i) {
+  return std::string(10 * (i + 1), static_cast<char>('a' + i % 26));
+}
+
+} // anonymous namespace
+
+TEST(KvStoreExportTest, SetGetErase) {
+  const auto path = getExportPath();
+  KvStoreExporter exporter(path);
+  KvStoreExportReader reader(path);
+  EXPECT_FALSE(reader.get("key1").hasValue());
+
+  exporter.set("key1", createValue(1, "value1"));
+  exporter.set("key2", createValue(1, std::string(1000, 'x')));
+  EXPECT_EQ(2, exporter.getNumKeys());
+  EXPECT_EQ(2, reader.getNumKeys());
+  EXPECT_EQ(createValue(1, "value1"), reader.get("key1").value());
+  EXPECT_EQ(
+      createValue(1, std::string(1000, 'x')), reader.get("key2").value());
+
+  // TTL update without value, in place
+  auto ttlUpdate = createValue(1, "");
+  ttlUpdate.value.clear();
+  ttlUpdate.ttlVersion = 1;
+  exporter.set("key1", ttlUpdate);
+  EXPECT_EQ(ttlUpdate, reader.get("key1").value());
+
+  exporter.erase("key1");
+  exporter.erase("key3");
+  EXPECT_FALSE(reader.get("key1").hasValue());
+  EXPECT_TRUE(reader.get("key2").hasValue());
+  EXPECT_EQ(1, reader.getNumKeys());
+  std::remove(path.c_str());
+}
+
+TEST(KvStoreExportTest, PrefixScan) {
+  const auto path = getExportPath();
+  KvStoreExporter exporter(path);
+  for (int i = 0; i < 10; ++i) {
+    exporter.set(folly::sformat("adj:node{}", i), createValue(i, "adj"));
+    exporter.set(folly::sformat("prefix:node{}", i), createValue(i, "pfx"));
+  }
+
+  KvStoreExportReader reader(path);
+  std::map<std::string, thrift::Value> keyVals;
+  reader.forEach("adj:", [&](const std::string& key, const thrift::Value& v) {
+    keyVals.emplace(key, v);
+  });
+  ASSERT_EQ(10, keyVals.size());
+  EXPECT_EQ(createValue(3, "adj"), keyVals.at("adj:node3"));
+  std::remove(path.c_str());
+}
+
+//
+// Full table and slab are rebuilt in a new file, readers follow it
+//
+TEST(KvStoreExportTest, Rebuild) {
+  const auto path = getExportPath();
+  KvStoreExporter exporter(path, 16 /* capacity */, 4096 /* slab size */);
+  KvStoreExportReader reader(path);
+  for (int i = 0; i < 1000; ++i) {
+    exporter.set(folly::sformat("key{}", i), createValue(i, "value"));
+  }
+  // churn leaves tombstones behind
+  for (int i = 0; i < 1000; i += 2) {
+    exporter.erase(folly::sformat("key{}", i));
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    exporter.set(folly::sformat("key{}", i), createValue(i, "value2"));
+  }
+  EXPECT_LT(0, exporter.getNumRebuilds());
+  EXPECT_EQ(1000, exporter.getNumKeys());
+
+  EXPECT_FALSE(reader.isClosed());
+  EXPECT_EQ(1000, reader.getNumKeys());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(
+        createValue(i, i % 2 ? "value" : "value2"),
+        reader.get(folly::sformat("key{}", i)).value());
+  }
+  std::remove(path.c_str());
+}
+
+TEST(KvStoreExportTest, Close) {
+  const auto path = getExportPath();
+  auto exporter = std::make_unique<KvStoreExporter>(path);
+  exporter->set("key1", createValue(1, "value1"));
+  KvStoreExportReader reader(path);
+  exporter.reset();
+  EXPECT_TRUE(reader.isClosed());
+  // last state still readable
+  EXPECT_TRUE(reader.get("key1").hasValue());
+  std::remove(path.c_str());
+  EXPECT_THROW(KvStoreExportReader{path}, std::system_error);
+}
+
+//
+// Readers see whole values while the writer keeps changing them and
+// rebuilding the mirror
+//
+TEST(KvStoreExportTest, ConcurrentReader) {
+  const auto path = getExportPath();
+  KvStoreExporter exporter(path, 16 /* capacity */, 4096 /* slab size */);
+  exporter.set("key", createValue(0, createLetters(0)));
+
+  std::atomic<bool> done{false};
+  std::thread readerThread([&]() {
+    KvStoreExportReader reader(path);
+    while (not done) {
+      const auto value = reader.get("key");
+      ASSERT_TRUE(value.hasValue());
+      EXPECT_EQ(createLetters(value->version), value->value.value());
+    }
+  });
+
+  for (int i = 1; i < 500; ++i) {
+    exporter.set("key", createValue(i, createLetters(i)));
+    exporter.set(folly::sformat("other{}", i), createValue(i, "value"));
+  }
+  done = true;
+  readerThread.join();
+  EXPECT_LT(0, exporter.getNumRebuilds());
+  std::remove(path.c_str());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
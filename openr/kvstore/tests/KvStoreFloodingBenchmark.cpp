@@ -0,0 +1,499 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/Util.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace {
+
+// interval for periodic syncs, long enough to never kick in
+const std::chrono::seconds kDbSyncInterval(10000);
+const std::chrono::seconds kMonitorSubmitInterval(3600);
+
+// Timeout for receiving a publication from KvStore. This spans the maximum
+// duration it can take to propagate an update through the network
+const std::chrono::seconds kTimeout(100);
+
+// The byte size of a value
+const int kSizeOfValue = 1024;
+
+// Flood rate of rate limited networks, messages per second and burst size
+const size_t kFloodMsgPerSec{1000};
+const size_t kFloodMsgBurstSize{100};
+
+// Number of keys originated on one side of a partition while it lasts
+const size_t kNumPartitionKeys{100};
+
+// Number of spines each leaf of a Clos network connects to
+const size_t kClosUplinks{4};
+
+enum class Topology {
+  RING = 0,
+  GRID = 1,
+  CLOS = 2,
+};
+
+using Link = std::pair<size_t, size_t>;
+
+/**
+ * Links between numNodes nodes laid out in topology:
+ * - RING: each node connects to the next one
+ * - GRID: nodes fill the rows of a square grid, each one connecting to its
+ *   right and bottom neighbors
+ * - CLOS: the first numNodes / 8 nodes are spines, split in kClosUplinks
+ *   planes, and each other node is a leaf connecting to one spine per plane
+ */
+std::vector<Link>
+createLinks(Topology topology, size_t numNodes) {
+  std::vector<Link> links;
+  switch (topology) {
+  case Topology::RING: {
+    for (size_t i = 0; i + 1 < numNodes; ++i) {
+      links.emplace_back(i, i + 1);
+    }
+    if (numNodes > 2) {
+      links.emplace_back(numNodes - 1, 0);
+    }
+    break;
+  }
+  case Topology::GRID: {
+    const size_t width = std::ceil(std::sqrt(numNodes));
+    for (size_t i = 0; i < numNodes; ++i) {
+      if ((i + 1) % width != 0 and i + 1 < numNodes) {
+        links.emplace_back(i, i + 1);
+      }
+      if (i + width < numNodes) {
+        links.emplace_back(i, i + width);
+      }
+    }
+    break;
+  }
+  case Topology::CLOS: {
+    const size_t numSpinesPerPlane =
+        std::max<size_t>(1, numNodes / 8 / kClosUplinks);
+    const size_t numSpines = numSpinesPerPlane * kClosUplinks;
+    CHECK_GT(numNodes, numSpines);
+    for (size_t leaf = numSpines; leaf < numNodes; ++leaf) {
+      for (size_t plane = 0; plane < kClosUplinks; ++plane) {
+        links.emplace_back(
+            plane * numSpinesPerPlane + leaf % numSpinesPerPlane, leaf);
+      }
+    }
+    break;
+  }
+  }
+  return links;
+}
+
+// User and system CPU time of the process
+int64_t
+getCpuUs() {
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+} // namespace
+
+namespace openr {
+
+/**
+ * Network of KvStores peered in a topology. Stores talk over inproc ZMQ
+ * sockets, the whole network runs in this process without real sockets.
+ */
+class KvStoreNetwork {
+ public:
+  KvStoreNetwork(
+      Topology topology,
+      size_t numNodes,
+      bool enableFloodOptimization,
+      bool enableRateLimit)
+      : links_(createLinks(topology, numNodes)) {
+    KvStoreFloodRate kvStoreRate = std::nullopt;
+    if (enableRateLimit) {
+      kvStoreRate = std::make_pair(kFloodMsgPerSec, kFloodMsgBurstSize);
+    }
+    for (size_t i = 0; i < numNodes; ++i) {
+      // the first node is the flood root, a spine in Clos networks
+      stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+          context_,
+          getNodeName(i),
+          kDbSyncInterval,
+          kMonitorSubmitInterval,
+          std::unordered_map<std::string, thrift::PeerSpec>{},
+          std::nullopt /* filters */,
+          kvStoreRate,
+          Constants::kTtlDecrement,
+          enableFloodOptimization,
+          enableFloodOptimization and i == 0 /* isFloodRoot */));
+      stores_.back()->run();
+    }
+    setLinks(links_, true /* up */);
+    if (enableFloodOptimization) {
+      waitForFloodTopo();
+    }
+  }
+
+  ~KvStoreNetwork() {
+    for (auto& store : stores_) {
+      store->stop();
+    }
+  }
+
+  size_t
+  size() const {
+    return stores_.size();
+  }
+
+  KvStoreWrapper&
+  getStore(size_t node) {
+    return *stores_.at(node);
+  }
+
+  std::vector<Link> const&
+  getLinks() const {
+    return links_;
+  }
+
+  /**
+   * Bring links up or down by peering or unpeering both of their ends
+   */
+  void
+  setLinks(std::vector<Link> const& links, bool up) {
+    std::vector<std::unordered_map<std::string, thrift::PeerSpec>> peers(
+        stores_.size());
+    for (auto const& link : links) {
+      if (up) {
+        peers[link.first].emplace(
+            getNodeName(link.second), stores_[link.second]->getPeerSpec());
+        peers[link.second].emplace(
+            getNodeName(link.first), stores_[link.first]->getPeerSpec());
+      } else {
+        stores_[link.first]->delPeer(getNodeName(link.second));
+        stores_[link.second]->delPeer(getNodeName(link.first));
+      }
+    }
+    for (size_t i = 0; i < stores_.size(); ++i) {
+      if (not peers[i].empty()) {
+        stores_[i]->addPeers(std::move(peers[i]));
+      }
+    }
+  }
+
+  /**
+   * Block until node has published all of keys
+   */
+  void
+  waitForKeys(size_t node, std::unordered_set<std::string> keys) {
+    while (not keys.empty()) {
+      auto publication = stores_.at(node)->recvPublication(kTimeout);
+      for (auto const& kv : publication.keyVals) {
+        keys.erase(kv.first);
+      }
+    }
+  }
+
+  // Sum of counter over all stores
+  int64_t
+  sumCounter(std::string const& name) {
+    int64_t sum{0};
+    for (auto& store : stores_) {
+      auto counters = store->getCounters();
+      auto it = counters.find(name);
+      if (it != counters.end()) {
+        sum += it->second.value;
+      }
+    }
+    return sum;
+  }
+
+ private:
+  static std::string
+  getNodeName(size_t node) {
+    return folly::sformat("node-{}", node);
+  }
+
+  // Block until every store has found the flood root
+  void
+  waitForFloodTopo() {
+    for (auto& store : stores_) {
+      while (not store->getFloodTopo().floodRootId.hasValue()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+  }
+
+  fbzmq::Context context_;
+
+  std::vector<Link> links_;
+
+  std::vector<std::unique_ptr<KvStoreWrapper>> stores_;
+};
+
+/**
+ * Messages, bytes and CPU spent by a network since construction
+ */
+class NetworkCost {
+ public:
+  explicit NetworkCost(KvStoreNetwork& network)
+      : network_(network),
+        startMessages_(getSentMessages()),
+        startBytes_(getSentBytes()),
+        startCpuUs_(getCpuUs()) {}
+
+  int64_t
+  getMessages() {
+    return getSentMessages() - startMessages_;
+  }
+
+  int64_t
+  getBytes() {
+    return getSentBytes() - startBytes_;
+  }
+
+  int64_t
+  getCpuUsPerNode() {
+    return (getCpuUs() - startCpuUs_) / network_.size();
+  }
+
+ private:
+  int64_t
+  getSentMessages() {
+    return network_.sumCounter("kvstore.sent_publications.count.0");
+  }
+
+  int64_t
+  getSentBytes() {
+    return network_.sumCounter("kvstore.peers.bytes_sent.sum.0");
+  }
+
+  KvStoreNetwork& network_;
+  const int64_t startMessages_{0};
+  const int64_t startBytes_{0};
+  const int64_t startCpuUs_{0};
+};
+
+thrift::Value
+createValue(std::string const& originatorId) {
+  return createThriftValue(
+      1 /* version */, originatorId, std::string(kSizeOfValue, 'v'));
+}
+
+/**
+ * Benchmark for flooding a key through a network:
+ * 1. Build the network and wait for it to settle
+ * 2. Set a new key on the last node, a leaf in Clos networks
+ * 3. Wait until every node has it
+ */
+void
+BM_KvStoreFlooding(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    Topology topology,
+    size_t numNodes,
+    bool enableFloodOptimization,
+    bool enableRateLimit) {
+  auto suspender = folly::BenchmarkSuspender();
+  KvStoreNetwork network(
+      topology, numNodes, enableFloodOptimization, enableRateLimit);
+  auto& origin = network.getStore(numNodes - 1);
+  NetworkCost cost(network);
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto key = folly::sformat("flood-key-{}", i);
+    origin.setKey(key, createValue(origin.nodeId));
+    for (size_t node = 0; node < numNodes; ++node) {
+      network.waitForKeys(node, {key});
+    }
+  }
+  suspender.rehire();
+
+  counters["messages"] = cost.getMessages() / iters;
+  counters["bytes"] = cost.getBytes() / iters;
+  counters["cpu_us_per_node"] = cost.getCpuUsPerNode() / iters;
+}
+
+/**
+ * Benchmark for the full syncs healing a partition:
+ * 1. Build the network and cut the links between the first half of its
+ *    nodes and the second one
+ * 2. Set keys on the first node and wait until they reach its half
+ * 3. Heal the partition and wait until the keys reach the second half
+ */
+void
+BM_KvStorePartitionHeal(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    Topology topology,
+    size_t numNodes) {
+  auto suspender = folly::BenchmarkSuspender();
+  KvStoreNetwork network(
+      topology,
+      numNodes,
+      false /* enableFloodOptimization */,
+      false /* enableRateLimit */);
+  auto& origin = network.getStore(0);
+
+  const size_t numFirstHalf = numNodes / 2;
+  std::vector<Link> cutLinks;
+  for (auto const& link : network.getLinks()) {
+    if ((link.first < numFirstHalf) != (link.second < numFirstHalf)) {
+      cutLinks.emplace_back(link);
+    }
+  }
+
+  int64_t messages{0};
+  int64_t bytes{0};
+  int64_t cpuUs{0};
+  for (uint32_t i = 0; i < iters; ++i) {
+    network.setLinks(cutLinks, false /* up */);
+    std::unordered_set<std::string> keys;
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (size_t k = 0; k < kNumPartitionKeys; ++k) {
+      auto key = folly::sformat("partition-key-{}-{}", i, k);
+      keys.emplace(key);
+      keyVals.emplace_back(key, createValue(origin.nodeId));
+    }
+    origin.setKeys(keyVals);
+    for (size_t node = 0; node < numFirstHalf; ++node) {
+      network.waitForKeys(node, keys);
+    }
+
+    NetworkCost cost(network);
+    suspender.dismiss(); // Start measuring benchmark time
+    network.setLinks(cutLinks, true /* up */);
+    for (size_t node = numFirstHalf; node < numNodes; ++node) {
+      network.waitForKeys(node, keys);
+    }
+    suspender.rehire();
+
+    messages += cost.getMessages();
+    bytes += cost.getBytes();
+    cpuUs += cost.getCpuUsPerNode();
+  }
+
+  counters["messages"] = messages / iters;
+  counters["bytes"] = bytes / iters;
+  counters["cpu_us_per_node"] = cpuUs / iters;
+}
+
+// The parameters are the topology, the number of nodes, and whether flood
+// optimization and rate limiting are enabled
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, ring_10, Topology::RING, 10, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, ring_100, Topology::RING, 100, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    ring_1000,
+    Topology::RING,
+    1000,
+    false,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, grid_16, Topology::GRID, 16, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, grid_100, Topology::GRID, 100, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    grid_1000,
+    Topology::GRID,
+    1000,
+    false,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, clos_40, Topology::CLOS, 40, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding, counters, clos_160, Topology::CLOS, 160, false, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    clos_1000,
+    Topology::CLOS,
+    1000,
+    false,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    clos_160_flood_opt,
+    Topology::CLOS,
+    160,
+    true,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    clos_1000_flood_opt,
+    Topology::CLOS,
+    1000,
+    true,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    grid_100_flood_opt,
+    Topology::GRID,
+    100,
+    true,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    clos_160_rate_limit,
+    Topology::CLOS,
+    160,
+    false,
+    true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFlooding,
+    counters,
+    clos_160_flood_opt_rate_limit,
+    Topology::CLOS,
+    160,
+    true,
+    true);
+
+// The parameters are the topology and the number of nodes
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStorePartitionHeal, counters, ring_100, Topology::RING, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStorePartitionHeal, counters, grid_100, Topology::GRID, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStorePartitionHeal, counters, clos_160, Topology::CLOS, 160);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStorePartitionHeal, counters, clos_1000, Topology::CLOS, 1000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/kvstore/KvStoreProfiler.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+TEST(SpaceSavingSketchTest, HeavyHitters) {
+  SpaceSavingSketch sketch(4);
+  EXPECT_TRUE(sketch.getTopK(10).empty());
+
+  // two heavy items among many light ones
+  for (int i = 0; i < 100; ++i) {
+    sketch.add("heavy1", 2);
+    sketch.add("heavy2");
+    sketch.add(folly::sformat("light-{}", i));
+  }
+  EXPECT_EQ(4, sketch.size());
+
+  auto topK = sketch.getTopK(2);
+  ASSERT_EQ(2, topK.size());
+  EXPECT_EQ("heavy1", topK[0].item);
+  EXPECT_EQ("heavy2", topK[1].item);
+  // counts are over-estimated by at most their error
+  for (auto const& entry : topK) {
+    const uint64_t count = entry.item == "heavy1" ? 200 : 100;
+    EXPECT_LE(count, entry.count);
+    EXPECT_LE(entry.count - entry.error, count);
+  }
+
+  // the lightest tracked item inherits the count of the one it replaced
+  topK = sketch.getTopK(10);
+  ASSERT_EQ(4, topK.size());
+  EXPECT_LT(0, topK.back().error);
+  EXPECT_EQ(topK.back().error + 1, topK.back().count);
+
+  sketch.decay();
+  topK = sketch.getTopK(1);
+  ASSERT_EQ(1, topK.size());
+  EXPECT_EQ("heavy1", topK[0].item);
+  EXPECT_EQ(100, topK[0].count);
+}
+
+TEST(KvStoreChurnTrackerTest, SampledUpdates) {
+  const auto start = std::chrono::steady_clock::now();
+  KvStoreChurnTracker tracker(4, 16, 1, 60s);
+
+  EXPECT_EQ("adj", KvStoreChurnTracker::getKeyFamily("adj:node1"));
+  EXPECT_EQ("prefix", KvStoreChurnTracker::getKeyFamily("prefix:node1:1"));
+  EXPECT_EQ("other", KvStoreChurnTracker::getKeyFamily("custom"));
+  EXPECT_EQ("other", KvStoreChurnTracker::getKeyFamily(":custom"));
+
+  // one in four updates is sampled, i.e. every update of prefix:node2
+  size_t numSampled = 0;
+  for (int i = 0; i < 400; ++i) {
+    const auto key = i % 4 ? "prefix:node2" : folly::sformat("adj:node{}", i);
+    if (tracker.addUpdate(key, "node2", start)) {
+      ++numSampled;
+    }
+  }
+  EXPECT_EQ(100, numSampled);
+
+  // key families beyond the max are accounted as other
+  for (int i = 0; i < 4; ++i) {
+    tracker.addUpdate("allocprefix:node3", "node3", start);
+  }
+
+  auto stats = tracker.getStats(1);
+  EXPECT_EQ(4, stats.sampleRate);
+  EXPECT_EQ(2, stats.keyFamilies.size());
+  int64_t total = 0;
+  for (auto const& entry : stats.keyFamilies) {
+    total += entry.count;
+  }
+  EXPECT_EQ(404, total);
+  EXPECT_EQ("other", stats.keyFamilies.back().name);
+  EXPECT_EQ(4, stats.keyFamilies.back().count);
+  ASSERT_EQ(1, stats.topOriginators.size());
+  EXPECT_EQ("node2", stats.topOriginators[0].name);
+  EXPECT_EQ(400, stats.topOriginators[0].count);
+  ASSERT_EQ(1, stats.topKeys.size());
+  EXPECT_EQ("prefix:node2", stats.topKeys[0].name);
+
+  auto counters = tracker.getCounters(10);
+  EXPECT_EQ(400, counters.at("kvstore.churn.originator.node2"));
+  EXPECT_EQ(4, counters.at("kvstore.churn.originator.node3"));
+
+  // counts are halved every decay interval
+  for (int i = 0; i < 4; ++i) {
+    tracker.addUpdate("allocprefix:node3", "node3", start + 121s);
+  }
+  counters = tracker.getCounters(10);
+  EXPECT_EQ(100, counters.at("kvstore.churn.originator.node2"));
+  EXPECT_EQ(5, counters.at("kvstore.churn.originator.node3"));
+}
+
+TEST(KvStoreMemoryTrackerTest, UsageAndQuota) {
+  KvStoreQuota quota;
+  quota.maxKeysPerOriginator = 2;
+  quota.maxBytesPerOriginator = 100;
+  KvStoreMemoryTracker tracker(quota);
+  EXPECT_TRUE(tracker.hasQuota());
+  EXPECT_FALSE(KvStoreMemoryTracker().hasQuota());
+
+  tracker.add("adj:node1", "node1", 20);
+  tracker.add("prefix:node1", "node1", 30);
+  tracker.add("prefix:node2", "node2", 10);
+  EXPECT_EQ(3, tracker.getTotalUsage().numKeys);
+  EXPECT_EQ(60, tracker.getTotalUsage().numBytes);
+  EXPECT_EQ(2, tracker.getOriginatorUsage("node1").numKeys);
+  EXPECT_EQ(50, tracker.getOriginatorUsage("node1").numBytes);
+
+  // growing past either limit is rejected, shrinking is not
+  EXPECT_FALSE(tracker.isWithinQuota("node1", {3, 60}));
+  EXPECT_FALSE(tracker.isWithinQuota("node2", {1, 101}));
+  EXPECT_TRUE(tracker.isWithinQuota("node2", {2, 100}));
+  tracker.add("custom", "node2", 200);
+  EXPECT_TRUE(tracker.isWithinQuota("node2", {2, 150}));
+
+  auto counters = tracker.getCounters(1);
+  EXPECT_EQ(4, counters.at("kvstore.memory.keys"));
+  EXPECT_EQ(260, counters.at("kvstore.memory.bytes"));
+  EXPECT_EQ(2, counters.at("kvstore.memory.num_originators"));
+  EXPECT_EQ(210, counters.at("kvstore.memory.originator.node2.bytes"));
+  EXPECT_EQ(0, counters.count("kvstore.memory.originator.node1.bytes"));
+  EXPECT_EQ(200, counters.at("kvstore.memory.key_family.other.bytes"));
+  EXPECT_EQ(1, counters.at("kvstore.memory.key_family.other.keys"));
+
+  // originators and key families holding no keys are forgotten
+  tracker.remove("adj:node1", "node1", 20);
+  tracker.remove("prefix:node1", "node1", 30);
+  counters = tracker.getCounters(10);
+  EXPECT_EQ(0, tracker.getOriginatorUsage("node1").numKeys);
+  EXPECT_EQ(1, counters.at("kvstore.memory.num_originators"));
+  EXPECT_EQ(0, counters.count("kvstore.memory.key_family.adj.keys"));
+  EXPECT_EQ(10, counters.at("kvstore.memory.key_family.prefix.bytes"));
+}
+
+TEST(KvStoreLatenciesTest, Window) {
+  KvStoreLatencies latencies(100);
+  EXPECT_TRUE(latencies.getCounters().empty());
+
+  for (int64_t i = 1; i <= 300; ++i) {
+    latencies.addDuration(KvStorePhase::MERGE, std::chrono::microseconds(i));
+  }
+  latencies.addDuration(KvStorePhase::FULL_SYNC, 5ms);
+
+  // only the last 100 durations are taken into account
+  auto counters = latencies.getCounters();
+  EXPECT_EQ(250, counters.at("kvstore.phase.merge_us.p50"));
+  EXPECT_EQ(299, counters.at("kvstore.phase.merge_us.p99"));
+  EXPECT_EQ(300, counters.at("kvstore.phase.merge_us.max"));
+  EXPECT_EQ(5000, counters.at("kvstore.phase.full_sync_us.p99"));
+  EXPECT_EQ(0, counters.count("kvstore.phase.flood_us.p50"));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -6,6 +6,8 @@
  */
 
 #include <sodium.h>
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <thread>
 #include <tuple>
@@ -15,6 +17,7 @@
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Random.h>
+#include <folly/compression/Compression.h>
 #include <folly/gen/Base.h>
 #include <gtest/gtest.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -471,6 +474,91 @@ TEST(KvStore, mergeKeyValuesTest) {
 //
 // Test compareValues method
 //
+TEST(KvStore, mergeKeyValuesShardedTest) {
+  auto createValue = [](int64_t version,
+                        folly::Optional<std::string> value,
+                        int64_t ttl = 3600,
+                        int64_t ttlVersion = 0) {
+    thrift::Value thriftValue(
+        apache::thrift::FRAGILE,
+        version,
+        "node1", /* node id */
+        value,
+        ttl,
+        ttlVersion,
+        0 /* hash */);
+    thriftValue.hash = folly::none;
+    return thriftValue;
+  };
+
+  std::unordered_map<std::string, thrift::Value> store;
+  for (int i = 0; i < 5000; ++i) {
+    store.emplace(folly::sformat("key-{}", i), createValue(5, "value"));
+  }
+
+  // new, newer, older, ttl only, invalid and filtered keys
+  std::unordered_map<std::string, thrift::Value> update;
+  for (int i = 0; i < 6000; ++i) {
+    const auto key = folly::sformat("key-{}", i);
+    switch (i % 6) {
+    case 0:
+      update.emplace(key, createValue(6, "newValue"));
+      break;
+    case 1:
+      update.emplace(key, createValue(4, "oldValue"));
+      break;
+    case 2:
+      update.emplace(key, createValue(5, folly::none, 1800, 1));
+      break;
+    case 3:
+      update.emplace(key, createValue(6, "newValue", 0));
+      break;
+    case 4:
+      update.emplace(key, createValue(5, "value"));
+      break;
+    default:
+      update.emplace("filtered-" + key, createValue(1, "value"));
+    }
+  }
+  const KvStoreFilters filters({"key-"}, {});
+
+  auto store1 = store;
+  const auto updates1 = KvStore::mergeKeyValues(store1, update, filters);
+
+  folly::CPUThreadPoolExecutor executor(4);
+  auto store2 = store;
+  const auto updates2 =
+      KvStore::mergeKeyValues(store2, update, filters, &executor, 4);
+
+  // sharded merge yields the same store and updates
+  EXPECT_EQ(updates1, updates2);
+  EXPECT_EQ(store1, store2);
+  EXPECT_EQ(6, store2.at("key-0").version);
+  EXPECT_EQ(5, store2.at("key-1").version);
+  EXPECT_EQ(1, store2.at("key-2").ttlVersion);
+  EXPECT_EQ(5, store2.at("key-3").version);
+  EXPECT_EQ(0, store2.count("filtered-key-5"));
+  EXPECT_EQ(1, updates2.count("key-5004"));
+  EXPECT_TRUE(store2.at("key-5004").hash.hasValue());
+  EXPECT_EQ(0, updates2.count("key-4"));
+
+  // change set points at the received updates and the merged store entries
+  for (auto* executorPtr : {static_cast<folly::Executor*>(nullptr),
+                            static_cast<folly::Executor*>(&executor)}) {
+    auto store3 = store;
+    const auto updates3 = KvStore::mergeKeyValueUpdates(
+        store3, update, filters, executorPtr, 4);
+    EXPECT_EQ(store1, store3);
+    ASSERT_EQ(updates1.size(), updates3.size());
+    for (auto const& mergeUpdate : updates3) {
+      auto const& key = mergeUpdate.keyVal->first;
+      EXPECT_EQ(&update.at(key), &mergeUpdate.keyVal->second);
+      EXPECT_EQ(&store3.at(key), &mergeUpdate.storeKeyVal->second);
+      EXPECT_EQ(updates1.at(key), mergeUpdate.keyVal->second);
+    }
+  }
+}
+
 TEST(KvStore, compareValuesTest) {
   thrift::Value refValue(
       apache::thrift::FRAGILE,
@@ -549,6 +637,90 @@ TEST(KvStore, compareValuesTest) {
   }
 }
 
+TEST(KvStore, bucketDigestsTest) {
+  // buckets of a level are split into the buckets of the next level
+  for (int i = 0; i < 100; ++i) {
+    const auto key = folly::sformat("key-{}", i);
+    const auto bucket1 = KvStore::getKeyBucket(key, 1);
+    const auto bucket2 = KvStore::getKeyBucket(key, 2);
+    EXPECT_LE(0, bucket1);
+    EXPECT_GT(1 << Constants::kKvStoreSyncBucketBits, bucket1);
+    EXPECT_EQ(bucket1, bucket2 >> Constants::kKvStoreSyncBucketBits);
+  }
+
+  thrift::Value refValue(
+      apache::thrift::FRAGILE,
+      5, /* version */
+      "node5", /* node id */
+      "dummyValue",
+      3600, /* ttl */
+      123 /* ttl version */,
+      112233 /* hash */);
+  const auto refDigest = KvStore::getKeyValDigest("key", refValue);
+  EXPECT_NE(refDigest, KvStore::getKeyValDigest("key1", refValue));
+
+  auto value = refValue;
+  value.version++;
+  EXPECT_NE(refDigest, KvStore::getKeyValDigest("key", value));
+  value = refValue;
+  value.originatorId = "node6";
+  EXPECT_NE(refDigest, KvStore::getKeyValDigest("key", value));
+  value = refValue;
+  value.hash = 445566;
+  EXPECT_NE(refDigest, KvStore::getKeyValDigest("key", value));
+
+  // ttl updates don't change the digest
+  value = refValue;
+  value.ttl = 1000;
+  value.ttlVersion++;
+  EXPECT_EQ(refDigest, KvStore::getKeyValDigest("key", value));
+
+  // missing buckets are empty
+  const std::map<int64_t, int64_t> digests1 = {{1, 10}, {2, 20}, {4, 40}};
+  const std::map<int64_t, int64_t> digests2 = {{2, 20}, {3, 30}, {4, 41}};
+  EXPECT_EQ(
+      (std::vector<int64_t>{1, 3, 4}),
+      KvStore::getDifferingBuckets(digests1, digests2));
+  EXPECT_EQ(
+      (std::vector<int64_t>{1, 3, 4}),
+      KvStore::getDifferingBuckets(digests2, digests1));
+  EXPECT_TRUE(KvStore::getDifferingBuckets(digests1, digests1).empty());
+  EXPECT_EQ(
+      (std::vector<int64_t>{1, 2, 4}),
+      KvStore::getDifferingBuckets(digests1, {}));
+}
+
+TEST(KvStore, compactTtlUpdatesTest) {
+  thrift::KeyVals keyVals;
+  keyVals.emplace("key1", createThriftValue(1, "node1", folly::none, 100, 2));
+  keyVals.emplace("key2", createThriftValue(3, "node1", folly::none, 200, 4));
+  keyVals.emplace("key3", createThriftValue(5, "node2", folly::none, 300, 6));
+  keyVals.emplace("key4", createThriftValue(7, "node1", "value4", 400, 8));
+
+  // TTL refreshes are batched per originator, values are kept as they are
+  thrift::KeyVals otherKeyVals;
+  const auto ttlUpdates = KvStore::compactTtlUpdates(keyVals, otherKeyVals);
+  ASSERT_EQ(2, ttlUpdates.size());
+  EXPECT_EQ(1, otherKeyVals.size());
+  EXPECT_EQ(keyVals.at("key4"), otherKeyVals.at("key4"));
+  size_t numKeys = 0;
+  for (auto const& updates : ttlUpdates) {
+    numKeys += updates.keys.size();
+    EXPECT_EQ(updates.keys.size(), updates.ttls.size());
+  }
+  EXPECT_EQ(3, numKeys);
+
+  // expanding gets back the original key-vals
+  EXPECT_TRUE(KvStore::expandTtlUpdates(ttlUpdates, otherKeyVals));
+  EXPECT_EQ(keyVals, otherKeyVals);
+
+  // mismatching lists are rejected
+  auto malformed = ttlUpdates;
+  malformed.front().ttls.pop_back();
+  thrift::KeyVals malformedKeyVals;
+  EXPECT_FALSE(KvStore::expandTtlUpdates(malformed, malformedKeyVals));
+}
+
 //
 // Test counter reporting
 //
@@ -1048,6 +1220,260 @@ TEST_F(KvStoreTestFixture, LeafNode) {
   EXPECT_EQ(expectedOrignatorVals, store1->dumpAll(std::move(kvFilters4)));
 }
 
+/**
+ * Dumps with literal key prefix and originator filters are served from the
+ * key indexes, verify they match the same keys as regex filters, including
+ * after keys change originator or expire.
+ */
+TEST_F(KvStoreTestFixture, DumpWithIndexedFilters) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store0", emptyPeers);
+  store->run();
+
+  auto getKeys = [](std::unordered_map<std::string, thrift::Value> const& kvs) {
+    std::vector<std::string> keys;
+    for (auto const& kv : kvs) {
+      keys.emplace_back(kv.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+  };
+  auto dumpKeys = [&](std::vector<std::string> const& keyPrefixes,
+                      std::set<std::string> const& originatorIds) {
+    return getKeys(store->dumpAll(KvStoreFilters(keyPrefixes, originatorIds)));
+  };
+
+  auto setKey = [&](std::string const& key,
+                    int64_t version,
+                    std::string const& originatorId,
+                    int64_t ttl = Constants::kTtlInfinity) {
+    return store->setKey(
+        key,
+        createThriftValue(
+            version, originatorId, std::string("value"), ttl, 0, folly::none));
+  };
+
+  EXPECT_TRUE(setKey("adj:node1", 1, "node1"));
+  EXPECT_TRUE(setKey("adj:node2", 1, "node2"));
+  EXPECT_TRUE(setKey("adj", 1, "node2"));
+  EXPECT_TRUE(setKey("prefix:node1", 1, "node1"));
+  EXPECT_TRUE(setKey("prefix:node2", 1, "node2"));
+  EXPECT_TRUE(setKey("expiring", 1, "node3", 100 /* ttl */));
+
+  const std::vector<std::string> adjKeys{"adj:node1", "adj:node2"};
+  EXPECT_EQ(adjKeys, dumpKeys({"adj:"}, {}));
+  EXPECT_EQ(adjKeys, dumpKeys({"adj:node[12]"}, {}));
+  // overlapping prefixes
+  EXPECT_EQ(adjKeys, dumpKeys({"adj:node1", "adj:"}, {}));
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj", "adj:node1", "adj:node2"}),
+      dumpKeys({"adj"}, {}));
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj:node1", "prefix:node1"}),
+      dumpKeys({}, {"node1"}));
+  // keys are matched by key prefix or by originator
+  EXPECT_EQ(
+      (std::vector<std::string>{
+          "adj", "adj:node1", "adj:node2", "expiring", "prefix:node2"}),
+      dumpKeys({"adj:"}, {"node2", "node3"}));
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj:node1", "prefix:node1"}),
+      dumpKeys({"adj:node1", "prefix:node1"}, {"node1"}));
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj", "adj:node1", "adj:node2", "expiring"}),
+      getKeys(store->dumpHashes("adj,exp")));
+
+  // key changing originator moves between originators
+  EXPECT_TRUE(setKey("adj:node1", 2, "node2"));
+  EXPECT_EQ(
+      (std::vector<std::string>{"prefix:node1"}), dumpKeys({}, {"node1"}));
+  EXPECT_EQ(
+      (std::vector<std::string>{
+          "adj", "adj:node1", "adj:node2", "prefix:node2"}),
+      dumpKeys({}, {"node2"}));
+
+  // expired keys are removed from the indexes
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_TRUE(dumpKeys({"exp"}, {}).empty());
+  EXPECT_TRUE(dumpKeys({}, {"node3"}).empty());
+  EXPECT_EQ(5, store->dumpAll().size());
+}
+
+/**
+ * Repeated key and hash dumps with the same filters are served from the
+ * cached dump, patched with the keys changed since.
+ */
+TEST_F(KvStoreTestFixture, DumpCache) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store0", emptyPeers);
+  store->run();
+
+  auto getCounter = [&](std::string const& name) {
+    return store->getCounters()[name].value;
+  };
+  const auto filters = KvStoreFilters({"adj"}, {});
+
+  EXPECT_TRUE(store->setKey(
+      "adj:node1", createThriftValue(1, "node1", std::string("value1"))));
+  EXPECT_TRUE(store->setKey(
+      "prefix:node1", createThriftValue(1, "node1", std::string("value1"))));
+  EXPECT_EQ(1, store->dumpAll(filters).size());
+  EXPECT_EQ(1, getCounter("kvstore.dump_cache.misses.count.0"));
+  EXPECT_EQ(1, store->dumpAll(filters).size());
+  EXPECT_EQ(1, getCounter("kvstore.dump_cache.hits.count.0"));
+
+  // changed and new keys are patched in
+  EXPECT_TRUE(store->setKey(
+      "adj:node1", createThriftValue(2, "node1", std::string("value2"))));
+  EXPECT_TRUE(store->setKey(
+      "adj:node2", createThriftValue(1, "node2", std::string("value1"))));
+  auto keyVals = store->dumpAll(filters);
+  EXPECT_EQ(2, keyVals.size());
+  EXPECT_EQ(2, keyVals.at("adj:node1").version);
+  EXPECT_EQ("value2", keyVals.at("adj:node1").value.value());
+  EXPECT_EQ(2, getCounter("kvstore.dump_cache.hits.count.0"));
+
+  // hash dumps are cached apart, without values
+  EXPECT_EQ(3, store->dumpHashes().size());
+  EXPECT_EQ(2, getCounter("kvstore.dump_cache.misses.count.0"));
+  EXPECT_TRUE(store->setKey(
+      "prefix:node1", createThriftValue(2, "node1", std::string("value2"))));
+  auto hashes = store->dumpHashes();
+  EXPECT_EQ(3, hashes.size());
+  EXPECT_EQ(2, hashes.at("prefix:node1").version);
+  EXPECT_FALSE(hashes.at("prefix:node1").value.hasValue());
+  EXPECT_EQ(
+      store->getKey("prefix:node1")->hash, hashes.at("prefix:node1").hash);
+  EXPECT_EQ(3, getCounter("kvstore.dump_cache.hits.count.0"));
+}
+
+TEST_F(KvStoreTestFixture, PaginatedDump) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store0", emptyPeers);
+  store->run();
+
+  auto setKey = [&](std::string const& key) {
+    return store->setKey(
+        key, createThriftValue(1, "node1", std::string("value")));
+  };
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(setKey(folly::sformat("key{}", i)));
+  }
+  EXPECT_TRUE(setKey("other"));
+
+  thrift::KeyDumpParams params;
+  params.prefix = "key";
+  params.maxKeys = 4;
+
+  // pages are returned in key order until the last one without cursor
+  std::vector<std::vector<std::string>> pages;
+  while (true) {
+    auto pub = *(store->getKvStore()->dumpKvStoreKeys(params).get());
+    std::vector<std::string> keys;
+    for (auto const& kv : pub.keyVals) {
+      keys.emplace_back(kv.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    pages.emplace_back(std::move(keys));
+    if (not pub.cursor.hasValue()) {
+      break;
+    }
+    EXPECT_EQ(pages.back().back(), pub.cursor.value());
+    params.cursor = pub.cursor.value();
+
+    // keys added behind the cursor are not returned, those ahead are
+    if (pages.size() == 1) {
+      EXPECT_TRUE(setKey("key00"));
+      EXPECT_TRUE(setKey("key99"));
+    }
+  }
+  EXPECT_EQ(
+      (std::vector<std::vector<std::string>>{
+          {"key0", "key1", "key2", "key3"},
+          {"key4", "key5", "key6", "key7"},
+          {"key8", "key9", "key99"}}),
+      pages);
+
+  // page boundary at the last matching key
+  params.cursor = "key8";
+  params.maxKeys = 2;
+  auto pub = *(store->getKvStore()->dumpKvStoreKeys(params).get());
+  EXPECT_EQ(2, pub.keyVals.size());
+  EXPECT_FALSE(pub.cursor.hasValue());
+
+  // no page size dumps all keys at once
+  params.cursor.reset();
+  params.maxKeys.reset();
+  pub = *(store->getKvStore()->dumpKvStoreKeys(params).get());
+  EXPECT_EQ(12, pub.keyVals.size());
+  EXPECT_FALSE(pub.cursor.hasValue());
+}
+
+TEST_F(KvStoreTestFixture, SnapshotWarmRestart) {
+  const auto snapshotFilePath = folly::sformat(
+      "/tmp/openr_kvstore_snapshot_test_{}",
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::remove(snapshotFilePath.c_str());
+
+  auto createStore = [&]() {
+    return std::make_unique<KvStoreWrapper>(
+        context,
+        "store0",
+        kDbSyncInterval,
+        kMonitorSubmitInterval,
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        std::unordered_set<std::string>{
+            thrift::KvStore_constants::kDefaultArea()},
+        1 /* numMergeShards */,
+        snapshotFilePath);
+  };
+  auto setKey = [](KvStoreWrapper& store,
+                   std::string const& key,
+                   std::string const& originatorId,
+                   int64_t ttl) {
+    return store.setKey(
+        key, createThriftValue(1, originatorId, std::string("value"), ttl));
+  };
+
+  {
+    // nothing to restore from at first
+    auto store = createStore();
+    store->run();
+    EXPECT_TRUE(store->dumpAll().empty());
+
+    EXPECT_TRUE(setKey(*store, "key1", "node1", Constants::kTtlInfinity));
+    EXPECT_TRUE(setKey(*store, "key2", "node1", 60000));
+    EXPECT_TRUE(setKey(*store, "key3", "node1", 100));
+    EXPECT_TRUE(setKey(*store, "key4", "store0", Constants::kTtlInfinity));
+    // snapshot is taken on destruction
+  }
+  EXPECT_TRUE(fileExists(snapshotFilePath));
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  {
+    // expired keys and keys of this node aren't restored
+    auto store = createStore();
+    store->run();
+    auto kvs = store->dumpAll();
+    EXPECT_EQ(2, kvs.size());
+    ASSERT_EQ(1, kvs.count("key1"));
+    EXPECT_EQ(Constants::kTtlInfinity, kvs.at("key1").ttl);
+    ASSERT_EQ(1, kvs.count("key2"));
+    EXPECT_GT(60000 - 200, kvs.at("key2").ttl);
+    EXPECT_LT(50000, kvs.at("key2").ttl);
+  }
+
+  std::remove(snapshotFilePath.c_str());
+}
+
 /**
  * Test to verify that during peer sync TTLs are sent with remaining
  * time to expire, and new keys are added with that TTL while TTL for
@@ -1127,6 +1553,293 @@ TEST_F(KvStoreTestFixture, PeerSyncTtlExpiry) {
   EXPECT_GE(kTtlMs, maybeThriftVal.value().ttl);
 }
 
+/**
+ * Full-sync of stores with many keys compares bucket digests and exchanges
+ * only the keys of the buckets on which they differ, once the peer told us
+ * it accepts bucket digests.
+ * 1. Populate both stores with the same keys, except for a key which only
+ *    exists in one of them and a key with a newer version in store1
+ * 2. Add store0 as a peer of store1
+ * 3. Verify both stores end up with the same keys
+ * 4. Verify the periodic full-syncs after the first one compare bucket
+ *    digests and only a few buckets were synced
+ */
+TEST_F(KvStoreTestFixture, BucketDigestFullSync) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+
+  auto createValue = [](int64_t version, std::string const& value) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        version,
+        "node1" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    return thriftVal;
+  };
+
+  const size_t kNumKeys = 2 * Constants::kKvStoreBucketSyncMinKeys;
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keyVals.emplace_back(
+        folly::sformat("key-{}", i), createValue(1, folly::sformat("{}", i)));
+  }
+  EXPECT_TRUE(store0->setKeys(keyVals));
+  EXPECT_TRUE(store1->setKeys(keyVals));
+  EXPECT_TRUE(store1->setKey("key-0", createValue(2, "0")));
+  EXPECT_TRUE(store0->setKey("store0-key", createValue(1, "store0")));
+  EXPECT_TRUE(store1->setKey("store1-key", createValue(1, "store1")));
+
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+
+  // wait for full-sync to complete in both directions
+  for (int i = 0; i < 100; ++i) {
+    if (store0->getKey("store1-key").hasValue() and
+        store1->getKey("store0-key").hasValue() and
+        store0->getKey("key-0")->version == 2) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  const auto dump0 = store0->dumpAll();
+  const auto dump1 = store1->dumpAll();
+  EXPECT_EQ(kNumKeys + 2, dump0.size());
+  EXPECT_EQ(dump0, dump1);
+  EXPECT_EQ(2, dump0.at("key-0").version);
+
+  // the first full-sync sent hashes of all keys, the periodic ones compare
+  // bucket digests
+  auto counters0 = store0->getCounters();
+  for (int i = 0; i < 100; ++i) {
+    if (counters0["kvstore.cmd_key_bucket_dump.count.0"].value > 0) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    counters0 = store0->getCounters();
+  }
+  auto counters1 = store1->getCounters();
+  EXPECT_LE(1, counters0["kvstore.cmd_key_bucket_dump.count.0"].value);
+  // stores were in sync by then, at most one bucket per key differing
+  // meanwhile was synced
+  EXPECT_GE(3, counters1["kvstore.full_sync.differing_buckets.sum.0"].value);
+  EXPECT_EQ(0, counters1["kvstore.full_sync.legacy_responses.count.0"].value);
+}
+
+/**
+ * A reconnecting peer only exchanges the keys that changed since the last
+ * full-sync.
+ * 1. Peer store1 with store0 and wait for the initial full-sync
+ * 2. Remove the peer and change keys on both stores meanwhile
+ * 3. Re-add the peer and verify the changes were exchanged by a delta sync
+ */
+TEST_F(KvStoreTestFixture, DeltaFullSync) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+
+  auto createValue = [](int64_t version, std::string const& value) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        version,
+        "node1" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    return thriftVal;
+  };
+
+  auto waitForKey = [](KvStoreWrapper* store,
+                       std::string const& key,
+                       int64_t version) {
+    for (int i = 0; i < 100; ++i) {
+      auto maybeValue = store->getKey(key);
+      if (maybeValue.hasValue() and maybeValue->version == version) {
+        return true;
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+  };
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(store0->setKey(
+        folly::sformat("key-{}", i), createValue(1, folly::sformat("{}", i))));
+  }
+  EXPECT_TRUE(store1->setKey("store1-key", createValue(1, "store1")));
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+  EXPECT_TRUE(waitForKey(store1, "key-9", 1));
+  EXPECT_TRUE(waitForKey(store0, "store1-key", 1));
+
+  // changes while disconnected
+  EXPECT_TRUE(store1->delPeer(store0->nodeId));
+  EXPECT_TRUE(store0->setKey("key-0", createValue(2, "0")));
+  EXPECT_TRUE(store0->setKey("store0-key", createValue(1, "store0")));
+  EXPECT_TRUE(store1->setKey("store1-key", createValue(2, "store1")));
+
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+  EXPECT_TRUE(waitForKey(store1, "key-0", 2));
+  EXPECT_TRUE(waitForKey(store1, "store0-key", 1));
+  EXPECT_TRUE(waitForKey(store0, "store1-key", 2));
+  EXPECT_EQ(store0->dumpAll(), store1->dumpAll());
+
+  auto counters0 = store0->getCounters();
+  auto counters1 = store1->getCounters();
+  EXPECT_EQ(1, counters1["kvstore.full_sync.delta_requests.count.0"].value);
+  EXPECT_EQ(1, counters0["kvstore.cmd_key_delta_dump.count.0"].value);
+  EXPECT_EQ(0, counters1["kvstore.full_sync.legacy_responses.count.0"].value);
+}
+
+/**
+ * Peers accepting compression exchange large full-sync responses and floods
+ * compressed.
+ * 1. Populate store0 with large values and peer both stores
+ * 2. Verify store1 synced the keys from a compressed response
+ * 3. Flood a large value from store0 and verify store1 decompressed it
+ */
+TEST_F(KvStoreTestFixture, CompressedSync) {
+  if (not folly::io::hasCodec(folly::io::CodecType::ZSTD)) {
+    LOG(INFO) << "zstd is not available, skipping";
+    return;
+  }
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+
+  auto createValue = [](std::string const& value) {
+    return createThriftValue(
+        1 /* version */,
+        "node1" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "node1", value));
+  };
+
+  const size_t kNumKeys = 64;
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keyVals.emplace_back(
+        folly::sformat("key-{}", i),
+        createValue(folly::sformat("{}-{}", std::string(1024, 'v'), i)));
+  }
+  EXPECT_TRUE(store0->setKeys(keyVals));
+  EXPECT_TRUE(store1->setKey("store1-key", createValue("store1")));
+
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+  EXPECT_TRUE(store0->addPeer(store1->nodeId, store1->getPeerSpec()));
+
+  // wait for full-sync to complete in both directions
+  for (int i = 0; i < 100; ++i) {
+    if (store1->dumpAll().size() == kNumKeys + 1 and
+        store0->getKey("store1-key").hasValue()) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_EQ(store0->dumpAll(), store1->dumpAll());
+
+  auto counters0 = store0->getCounters();
+  auto counters1 = store1->getCounters();
+  const auto bytesIn = counters0["kvstore.compression.bytes_in.sum.0"].value;
+  EXPECT_LT(kNumKeys * 1024, bytesIn);
+  EXPECT_GT(bytesIn, counters0["kvstore.compression.bytes_out.sum.0"].value);
+  const auto bytesOut =
+      counters1["kvstore.decompression.bytes_out.sum.0"].value;
+  EXPECT_LT(kNumKeys * 1024, bytesOut);
+
+  // floods between peers accepting compression are compressed
+  EXPECT_TRUE(
+      store0->setKey("large-key", createValue(std::string(8192, 'l'))));
+  for (int i = 0; i < 100; ++i) {
+    if (store1->getKey("large-key").hasValue()) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_TRUE(store1->getKey("large-key").hasValue());
+  counters1 = store1->getCounters();
+  EXPECT_LT(
+      bytesOut + 8192,
+      counters1["kvstore.decompression.bytes_out.sum.0"].value);
+}
+
+/**
+ * Full-sync responses larger than the chunk size are split into chunks,
+ * merged by the requester as they arrive.
+ * 1. Populate store0 with values adding up to several chunks
+ * 2. Peer store1 with store0 and verify it synced all keys
+ * 3. Verify the response was chunked and counted for store0 on store1
+ */
+TEST_F(KvStoreTestFixture, ChunkedFullSync) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+
+  auto createValue = [](std::string const& value) {
+    return createThriftValue(
+        1 /* version */,
+        "node1" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "node1", value));
+  };
+
+  // three values per chunk
+  const size_t kNumKeys = 8;
+  const size_t kValueBytes = Constants::kKvStoreSyncChunkBytes / 4;
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keyVals.emplace_back(
+        folly::sformat("key-{}", i),
+        createValue(std::string(kValueBytes, 'a' + i)));
+  }
+  EXPECT_TRUE(store0->setKeys(keyVals));
+  EXPECT_TRUE(store1->setKey("store1-key", createValue("store1")));
+
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+  for (int i = 0; i < 100; ++i) {
+    if (store1->dumpAll().size() == kNumKeys + 1 and
+        store0->getKey("store1-key").hasValue()) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_EQ(store0->dumpAll(), store1->dumpAll());
+
+  auto counters0 = store0->getCounters();
+  auto counters1 = store1->getCounters();
+  EXPECT_EQ(2, counters0["kvstore.full_sync.chunks_sent.sum.0"].value);
+  EXPECT_EQ(2, counters1["kvstore.full_sync.chunks_received.count.0"].value);
+  EXPECT_EQ(
+      3, counters1["kvstore.full_sync.store0.chunks_received.count.0"].value);
+  EXPECT_EQ(
+      kNumKeys,
+      counters1["kvstore.full_sync.store0.keys_received.sum.0"].value);
+}
+
 /**
  * Test to verify PEER_ADD/PEER_DEL and verify that keys are synchronized
  * to the neighbor.
@@ -1738,6 +2451,83 @@ TEST_F(KvStoreTestFixture, DualTest) {
   validateAllRootsUpCase();
 }
 
+/**
+ * With multi-root flooding, keys originated by n0 are spread across the SPTs
+ * of both roots r0 and r1, and still reach all nodes
+ *  r0    r1
+ *  | \  / |
+ *  |  \/  |
+ *  |  /\  |
+ *  n0    n1
+ */
+TEST_F(KvStoreTestFixture, MultiRootFlooding) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  const std::unordered_set<std::string> areas{
+      openr::thrift::KvStore_constants::kDefaultArea()};
+  auto createStore = [&](std::string const& nodeId, bool isRoot) {
+    stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+        context,
+        nodeId,
+        kDbSyncInterval,
+        kMonitorSubmitInterval,
+        emptyPeers,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        true /* enableFloodOptimization */,
+        isRoot,
+        areas,
+        1 /* numMergeShards */,
+        "" /* snapshotFilePath */,
+        false /* enableThriftPeers */,
+        true /* enableMultiRootFlooding */));
+    stores_.back()->run();
+    return stores_.back().get();
+  };
+  auto r0 = createStore("r0", true /* isRoot */);
+  auto r1 = createStore("r1", true /* isRoot */);
+  auto n0 = createStore("n0", false /* isRoot */);
+  auto n1 = createStore("n1", false /* isRoot */);
+
+  for (auto root : {r0, r1}) {
+    for (auto node : {n0, n1}) {
+      EXPECT_TRUE(root->addPeer(node->nodeId, node->getPeerSpec()));
+      EXPECT_TRUE(node->addPeer(root->nodeId, root->getPeerSpec()));
+    }
+  }
+
+  // let kvstore dual sync
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  const size_t kNumKeys{32};
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keyVals.emplace_back(
+        folly::sformat("key-{}", i),
+        createThriftValue(1, "n0", std::string("value")));
+  }
+  EXPECT_TRUE(n0->setKeys(keyVals));
+
+  // wait for all keys to reach n1
+  for (int i = 0; i < 100; ++i) {
+    if (n1->dumpAll().size() == kNumKeys) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_EQ(kNumKeys, n1->dumpAll().size());
+
+  // keys were flooded along both trees
+  auto counters = n0->getCounters();
+  const auto r0Keys = counters["kvstore.flood.root_keys.r0.sum.0"].value;
+  const auto r1Keys = counters["kvstore.flood.root_keys.r1.sum.0"].value;
+  EXPECT_LT(0, r0Keys);
+  EXPECT_LT(0, r1Keys);
+  EXPECT_EQ(kNumKeys, r0Keys + r1Keys);
+}
+
 /**
  * Perform KvStore synchronization test on full mesh.
  */
@@ -2028,6 +2818,15 @@ TEST_F(KvStoreTestFixture, BasicSync) {
     EXPECT_EQ(
         oldCounters["kvstore.sent_key_vals.sum.0"].value + sentOffset,
         newCounters["kvstore.sent_key_vals.sum.0"].value);
+
+    // flood request is serialized once and sent to all peers
+    const auto bytesSerialized =
+        newCounters["kvstore.flood.bytes_serialized.sum.0"].value -
+        oldCounters["kvstore.flood.bytes_serialized.sum.0"].value;
+    const auto bytesSent = newCounters["kvstore.flood.bytes_sent.sum.0"].value -
+        oldCounters["kvstore.flood.bytes_sent.sum.0"].value;
+    EXPECT_EQ(sentOffset ? 1 : 0, bytesSerialized ? 1 : 0);
+    EXPECT_EQ(bytesSerialized * sentOffset, bytesSent);
   }
 }
 
@@ -2774,6 +3573,280 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   EXPECT_GE(s1Supressed4 - s1Supressed3, 1);
 }
 
+/**
+ * Flood classes rate limited on their own: adjacency keys are flooded right
+ * away while prefix keys wait for the rate limiter.
+ * 1. Rate limit flooding of store1 to 1 message per second, with adj: keys
+ *    of a higher class
+ * 2. Set prefix keys in store1 faster than the rate limit allows
+ * 3. Verify an adj: key set afterwards reaches store0 ahead of them
+ */
+TEST_F(KvStoreTestFixture, FloodPriorityClasses) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "store1",
+      // no periodic full-syncs bypassing the rate limiter
+      std::chrono::seconds(3600),
+      kMonitorSubmitInterval,
+      emptyPeers,
+      std::nullopt /* filters */,
+      KvStoreFloodRate(std::make_pair(1, 1)) /* 1 msg per sec */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      std::unordered_set<std::string>{
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      1 /* numMergeShards */,
+      "" /* snapshotFilePath */,
+      false /* enableThriftPeers */,
+      false /* enableMultiRootFlooding */,
+      std::vector<std::string>{"adj:"}));
+  auto store1 = stores_.back().get();
+  store0->run();
+  store1->run();
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, store0->getPeerSpec()));
+
+  auto createValue = [](std::string const& value) {
+    return createThriftValue(
+        1 /* version */,
+        "store1" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "store1", value));
+  };
+
+  const int kNumPrefixKeys = 5;
+  for (int i = 0; i < kNumPrefixKeys; ++i) {
+    EXPECT_TRUE(store1->setKey(
+        folly::sformat("prefix:{}", i), createValue(folly::sformat("{}", i))));
+  }
+  EXPECT_TRUE(store1->setKey("adj:store1", createValue("adj")));
+
+  for (int i = 0; i < 50; ++i) {
+    if (store0->getKey("adj:store1").hasValue()) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(store0->getKey("adj:store1").hasValue());
+  // prefix keys beyond the burst wait for the rate limiter
+  EXPECT_FALSE(store0->getKey(
+      folly::sformat("prefix:{}", kNumPrefixKeys - 1)).hasValue());
+
+  for (int i = 0; i < 100; ++i) {
+    if (store0->dumpAll().size() == kNumPrefixKeys + 1) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_EQ(store1->dumpAll(), store0->dumpAll());
+
+  auto counters1 = store1->getCounters();
+  EXPECT_EQ(0, counters1["kvstore.flood_class.0.rate_limit_keys.sum.0"].value);
+  EXPECT_LE(
+      kNumPrefixKeys - 1,
+      counters1["kvstore.flood_class.1.rate_limit_keys.sum.0"].value);
+}
+
+/**
+ * Updates of an originator past its quota are rejected, other originators
+ * are not affected, and usage is exported by originator.
+ */
+TEST_F(KvStoreTestFixture, OriginatorQuota) {
+  KvStoreQuota quota;
+  quota.maxKeysPerOriginator = 2;
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "store0",
+      kDbSyncInterval,
+      kMonitorSubmitInterval,
+      std::unordered_map<std::string, thrift::PeerSpec>{},
+      std::nullopt /* filters */,
+      std::nullopt /* rate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      std::unordered_set<std::string>{
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      1 /* numMergeShards */,
+      "" /* snapshotFilePath */,
+      false /* enableThriftPeers */,
+      false /* enableMultiRootFlooding */,
+      std::vector<std::string>{} /* floodPriorityKeyPrefixes */,
+      quota));
+  auto store = stores_.back().get();
+  store->run();
+
+  auto createValue = [](std::string const& originatorId, int64_t version) {
+    return createThriftValue(
+        version,
+        originatorId,
+        "value",
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(version, originatorId, "value"));
+  };
+
+  EXPECT_TRUE(store->setKey("key1", createValue("node1", 1)));
+  EXPECT_TRUE(store->setKey("key2", createValue("node1", 1)));
+  EXPECT_TRUE(store->setKey("key3", createValue("node1", 1)));
+  EXPECT_TRUE(store->setKey("key4", createValue("node2", 1)));
+  // updates of keys held are within quota
+  EXPECT_TRUE(store->setKey("key2", createValue("node1", 2)));
+
+  EXPECT_TRUE(store->getKey("key1").hasValue());
+  EXPECT_EQ(2, store->getKey("key2")->version);
+  EXPECT_FALSE(store->getKey("key3").hasValue());
+  EXPECT_TRUE(store->getKey("key4").hasValue());
+
+  auto counters = store->getCounters();
+  EXPECT_EQ(1, counters["kvstore.quota.rejected_keys.sum.0"].value);
+  EXPECT_EQ(1, counters["kvstore.quota.rejected_keys.node1.sum.0"].value);
+  EXPECT_EQ(2, counters["kvstore.memory.originator.node1.keys"].value);
+  EXPECT_EQ(1, counters["kvstore.memory.originator.node2.keys"].value);
+  EXPECT_EQ(3, counters["kvstore.memory.keys"].value);
+}
+
+/**
+ * Values past the lazy threshold are announced to peers accepting it, which
+ * pull them once, while smaller values are flooded as usual.
+ */
+TEST_F(KvStoreTestFixture, LazyValuePull) {
+  const size_t kLazyValueThreshold{100};
+  for (auto const& nodeId : {"storeA", "storeB"}) {
+    stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+        context,
+        nodeId,
+        kDbSyncInterval,
+        kMonitorSubmitInterval,
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt /* filters */,
+        std::nullopt /* rate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        std::unordered_set<std::string>{
+            openr::thrift::KvStore_constants::kDefaultArea()},
+        1 /* numMergeShards */,
+        "" /* snapshotFilePath */,
+        false /* enableThriftPeers */,
+        false /* enableMultiRootFlooding */,
+        std::vector<std::string>{} /* floodPriorityKeyPrefixes */,
+        KvStoreQuota{},
+        kLazyValueThreshold));
+    stores_.back()->run();
+  }
+  auto storeA = stores_.at(0).get();
+  auto storeB = stores_.at(1).get();
+
+  // full-syncs tell both stores the other accepts announcements
+  EXPECT_TRUE(storeA->addPeer("storeB", storeB->getPeerSpec()));
+  EXPECT_TRUE(storeB->addPeer("storeA", storeA->getPeerSpec()));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  auto createValue = [](std::string const& value) {
+    return createThriftValue(
+        1 /* version */,
+        "storeA",
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "storeA", value));
+  };
+  const std::string largeValue(kLazyValueThreshold, 'a');
+  EXPECT_TRUE(storeA->setKey("large", createValue(largeValue)));
+  EXPECT_TRUE(storeA->setKey("small", createValue("a")));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  auto large = storeB->getKey("large");
+  ASSERT_TRUE(large.hasValue());
+  EXPECT_EQ(largeValue, large->value.value());
+  auto small = storeB->getKey("small");
+  ASSERT_TRUE(small.hasValue());
+  EXPECT_EQ("a", small->value.value());
+
+  auto countersA = storeA->getCounters();
+  auto countersB = storeB->getCounters();
+  EXPECT_LE(
+      1, countersA["kvstore.lazy_value.sent_announcements.count.0"].value);
+  EXPECT_EQ(1, countersA["kvstore.lazy_value.pulled_keys.sum.0"].value);
+  EXPECT_EQ(1, countersB["kvstore.lazy_value.pull_requests.count.0"].value);
+  EXPECT_EQ(0, countersB["kvstore.lazy_value.failed_pulls.count.0"].value);
+}
+
+/**
+ * A store bulk syncing with several peers at once pulls a range of the key
+ * space from each of them, then reconciles with one of them.
+ */
+TEST_F(KvStoreTestFixture, PartitionedFullSync) {
+  for (auto const& nodeId : {"storeA", "storeB", "storeC"}) {
+    stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+        context,
+        nodeId,
+        kDbSyncInterval,
+        kMonitorSubmitInterval,
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt /* filters */,
+        std::nullopt /* rate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        std::unordered_set<std::string>{
+            openr::thrift::KvStore_constants::kDefaultArea()},
+        1 /* numMergeShards */,
+        "" /* snapshotFilePath */,
+        false /* enableThriftPeers */,
+        false /* enableMultiRootFlooding */,
+        std::vector<std::string>{} /* floodPriorityKeyPrefixes */,
+        KvStoreQuota{},
+        0 /* lazyValueThreshold */,
+        true /* partitionedFullSync */));
+    stores_.back()->run();
+  }
+  auto storeA = stores_.at(0).get();
+  auto storeB = stores_.at(1).get();
+  auto storeC = stores_.at(2).get();
+
+  // storeB and storeC hold the same keys
+  const size_t kNumKeys{100};
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    const auto key = folly::sformat("key{}", i);
+    const auto value = createThriftValue(
+        1 /* version */,
+        "storeB",
+        key,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "storeB", key));
+    EXPECT_TRUE(storeB->setKey(key, value));
+    EXPECT_TRUE(storeC->setKey(key, value));
+  }
+
+  EXPECT_TRUE(storeA->addPeers(
+      {{"storeB", storeB->getPeerSpec()}, {"storeC", storeC->getPeerSpec()}}));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  EXPECT_EQ(kNumKeys, storeA->dumpAll().size());
+  auto countersA = storeA->getCounters();
+  auto countersB = storeB->getCounters();
+  auto countersC = storeC->getCounters();
+  EXPECT_EQ(
+      1, countersA["kvstore.full_sync.partitioned_requests.count.0"].value);
+  EXPECT_EQ(0, countersA["kvstore.full_sync.range_failures.count.0"].value);
+  // each peer sent a range, keys are received once plus the reconciliation
+  EXPECT_EQ(1, countersB["kvstore.cmd_key_range_dump.count.0"].value);
+  EXPECT_EQ(1, countersC["kvstore.cmd_key_range_dump.count.0"].value);
+  EXPECT_EQ(kNumKeys, countersA["kvstore.updated_key_vals.sum.0"].value);
+}
+
 /**
  * this is to verify correctness of 3-way full-sync
  * tuple represents (key, value-version, value)
@@ -3053,6 +4126,87 @@ TEST_F(KvStoreTestFixture, KeySyncMultipleArea) {
   evb.loop();
 }
 
+/**
+ * Areas running on event bases of their own sync, answer requests and add up
+ * their counters as areas sharing the KvStore event base do
+ */
+TEST_F(KvStoreTestFixture, AreaEventBases) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  const std::string podArea{"pod-area"};
+  const std::string planeArea{"plane-area"};
+  auto createStore = [&](std::string const& nodeId) {
+    stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+        context,
+        nodeId,
+        kDbSyncInterval,
+        kMonitorSubmitInterval,
+        emptyPeers,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        std::unordered_set<std::string>{podArea, planeArea},
+        1 /* numMergeShards */,
+        "" /* snapshotFilePath */,
+        false /* enableThriftPeers */,
+        false /* enableMultiRootFlooding */,
+        {} /* floodPriorityKeyPrefixes */,
+        {} /* quota */,
+        0 /* lazyValueThreshold */,
+        false /* partitionedFullSync */,
+        true /* enableAreaEventBases */));
+    stores_.back()->run();
+    return stores_.back().get();
+  };
+  auto storeA = createStore("storeA");
+  auto storeB = createStore("storeB");
+
+  for (auto const& area : {podArea, planeArea}) {
+    EXPECT_TRUE(storeA->addPeer("storeB", storeB->getPeerSpec(), area));
+    EXPECT_TRUE(storeB->addPeer("storeA", storeA->getPeerSpec(), area));
+    EXPECT_EQ(1, storeA->getPeers(area).size());
+  }
+
+  // keys set in an area reach the peer in that area only
+  EXPECT_TRUE(storeA->setKey(
+      "pod-key",
+      createThriftValue(1, "storeA", std::string("value")),
+      folly::none,
+      podArea));
+  EXPECT_TRUE(storeB->setKey(
+      "plane-key-0",
+      createThriftValue(1, "storeB", std::string("value")),
+      folly::none,
+      planeArea));
+  EXPECT_TRUE(storeB->setKey(
+      "plane-key-1",
+      createThriftValue(1, "storeB", std::string("value")),
+      folly::none,
+      planeArea));
+  for (int i = 0; i < 100; ++i) {
+    if (storeA->dumpAll(std::nullopt, planeArea).size() == 2 and
+        storeB->dumpAll(std::nullopt, podArea).size() == 1) {
+      break;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  for (auto store : {storeA, storeB}) {
+    const auto podKeyVals = store->dumpAll(std::nullopt, podArea);
+    EXPECT_EQ(1, podKeyVals.size());
+    EXPECT_EQ(1, podKeyVals.count("pod-key"));
+    const auto planeKeyVals = store->dumpAll(std::nullopt, planeArea);
+    EXPECT_EQ(2, planeKeyVals.size());
+    EXPECT_EQ(0, planeKeyVals.count("pod-key"));
+
+    // counters of areas add up
+    auto counters = store->getCounters();
+    EXPECT_EQ(3, counters["kvstore.num_keys"].value);
+    EXPECT_EQ(2, counters["kvstore.num_peers"].value);
+  }
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -87,7 +87,16 @@ class MultipleKvStoreTestFixture : public ::testing::Test {
         nodeId1_,
         std::chrono::seconds(60), // db sync interval
         std::chrono::seconds(600), // counter submit interval,
-        std::unordered_map<std::string, thrift::PeerSpec>{});
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt, // filters
+        std::nullopt, // flood rate
+        Constants::kTtlDecrement,
+        false, // enable flood optimization
+        false, // is flood root
+        {openr::thrift::KvStore_constants::kDefaultArea()},
+        1, // merge shards
+        "", // snapshot file path
+        true); // enable thrift peers
     kvStoreWrapper1_->run();
 
     // spin up an OpenrThriftServerWrapper
@@ -110,7 +119,16 @@ class MultipleKvStoreTestFixture : public ::testing::Test {
         nodeId2_,
         std::chrono::seconds(60), // db sync interval
         std::chrono::seconds(600), // counter submit interval,
-        std::unordered_map<std::string, thrift::PeerSpec>{});
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt, // filters
+        std::nullopt, // flood rate
+        Constants::kTtlDecrement,
+        false, // enable flood optimization
+        false, // is flood root
+        {openr::thrift::KvStore_constants::kDefaultArea()},
+        1, // merge shards
+        "", // snapshot file path
+        true); // enable thrift peers
     kvStoreWrapper2_->run();
 
     // spin up another OpenrThriftServerWrapper
@@ -319,7 +337,35 @@ TEST_F(MultipleKvStoreTestFixture, dumpAllTest) {
     EXPECT_EQ("test_value2", pub[key2].value);
   }
 
-  // Step6: shutdown both thriftSevers and verify
+  // Step6: verify bounded variant dumping one instance at a time, with an
+  // instance refusing connections
+  {
+    auto addrs = sockAddrs;
+    addrs.emplace_back(folly::SocketAddress{localhost_, 1});
+    auto db = KvStoreClient::dumpAllWithThriftClientFromMultipleBounded(
+        addrs, prefix, 1 /* maxOutstanding */);
+    ASSERT_TRUE(db.first.hasValue());
+    EXPECT_EQ(2, db.first->size());
+    ASSERT_EQ(3, db.second.size());
+    for (size_t i = 0; i < 2; ++i) {
+      EXPECT_EQ(addrs[i], db.second[i].sockAddr);
+      EXPECT_FALSE(db.second[i].error.hasValue());
+      EXPECT_EQ(1, db.second[i].numPages);
+      EXPECT_EQ(1, db.second[i].numKeyVals);
+    }
+    EXPECT_TRUE(db.second[2].error.hasValue());
+
+    // stop dumping once merged key-vals reach the limit
+    db = KvStoreClient::dumpAllWithThriftClientFromMultipleBounded(
+        addrs, prefix, 1 /* maxOutstanding */, 1 /* maxKeyVals */);
+    ASSERT_TRUE(db.first.hasValue());
+    EXPECT_EQ(1, db.first->size());
+    EXPECT_FALSE(db.second[0].error.hasValue());
+    EXPECT_TRUE(db.second[1].error.hasValue());
+    EXPECT_TRUE(db.second[2].error.hasValue());
+  }
+
+  // Step7: shutdown both thriftSevers and verify
   // dumpAllWithThriftClientFromMultiple() will get nothing.
   {
     openrThriftServerWrapper1_->stop();
@@ -337,6 +383,60 @@ TEST_F(MultipleKvStoreTestFixture, dumpAllTest) {
   }
 }
 
+TEST_F(MultipleKvStoreTestFixture, ThriftPeersTest) {
+  const std::string key1{"test_key1"};
+  const std::string key2{"test_key2"};
+  const std::string key3{"test_key3"};
+
+  thrift::Value value;
+  value.version = 1;
+  value.ttl = Constants::kTtlInfinity;
+  value.value = "test_value1";
+  value.originatorId = nodeId1_;
+  EXPECT_TRUE(kvStoreWrapper1_->setKey(key1, value));
+  value.value = "test_value2";
+  value.originatorId = nodeId2_;
+  EXPECT_TRUE(kvStoreWrapper2_->setKey(key2, value));
+
+  // peer both stores over their OpenrCtrl thrift servers
+  auto peerSpec1 = kvStoreWrapper1_->getPeerSpec();
+  peerSpec1.peerAddr = localhost_;
+  peerSpec1.ctrlPort = openrThriftServerWrapper1_->getOpenrCtrlThriftPort();
+  auto peerSpec2 = kvStoreWrapper2_->getPeerSpec();
+  peerSpec2.peerAddr = localhost_;
+  peerSpec2.ctrlPort = openrThriftServerWrapper2_->getOpenrCtrlThriftPort();
+  EXPECT_TRUE(kvStoreWrapper1_->addPeer(nodeId2_, peerSpec2));
+  EXPECT_TRUE(kvStoreWrapper2_->addPeer(nodeId1_, peerSpec1));
+
+  auto waitForKey = [](KvStoreWrapper& store, const std::string& key) {
+    for (int i = 0; i < 100 and not store.getKey(key).hasValue(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return store.getKey(key);
+  };
+
+  // full-sync exchanges the keys of both stores
+  auto maybeValue = waitForKey(*kvStoreWrapper1_, key2);
+  ASSERT_TRUE(maybeValue.hasValue());
+  EXPECT_EQ("test_value2", maybeValue->value.value());
+  maybeValue = waitForKey(*kvStoreWrapper2_, key1);
+  ASSERT_TRUE(maybeValue.hasValue());
+  EXPECT_EQ("test_value1", maybeValue->value.value());
+
+  // updates are flooded
+  value.value = "test_value3";
+  value.originatorId = nodeId1_;
+  EXPECT_TRUE(kvStoreWrapper1_->setKey(key3, value));
+  maybeValue = waitForKey(*kvStoreWrapper2_, key3);
+  ASSERT_TRUE(maybeValue.hasValue());
+  EXPECT_EQ("test_value3", maybeValue->value.value());
+
+  // nothing went over ZMQ
+  auto counters = kvStoreWrapper1_->getCounters();
+  EXPECT_LT(0, counters["kvstore.thrift_peers.requests_sent.count.0"].value);
+  EXPECT_EQ(0, counters["kvstore.peers.bytes_sent.sum.0"].value);
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
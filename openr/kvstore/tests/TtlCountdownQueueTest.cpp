@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/kvstore/TtlCountdownQueue.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+namespace {
+
+TtlCountdownQueueEntry
+createEntry(
+    const std::string& key,
+    std::chrono::steady_clock::time_point expiryTime,
+    int64_t version = 1) {
+  TtlCountdownQueueEntry entry;
+  entry.key = key;
+  entry.expiryTime = expiryTime;
+  entry.version = version;
+  entry.originatorId = "node1";
+  return entry;
+}
+
+std::vector<std::string>
+getKeys(const std::vector<TtlCountdownQueueEntry>& entries) {
+  std::vector<std::string> keys;
+  for (const auto& entry : entries) {
+    keys.emplace_back(entry.key);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+} // anonymous namespace
+
+TEST(TtlCountdownQueueTest, ScheduleCancel) {
+  const auto start = std::chrono::steady_clock::now();
+  TtlCountdownQueue queue(1ms, start);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.getNextExpiryTime().has_value());
+
+  queue.schedule(createEntry("key1", start + 10ms));
+  queue.schedule(createEntry("key2", start + 20ms));
+  queue.schedule(createEntry("key3", start + 30ms));
+  EXPECT_EQ(3, queue.size());
+  EXPECT_EQ(start + 10ms, queue.getNextExpiryTime());
+
+  // rescheduling replaces the countdown of the key
+  queue.schedule(createEntry("key1", start + 25ms, 2));
+  EXPECT_EQ(3, queue.size());
+  ASSERT_NE(nullptr, queue.find("key1"));
+  EXPECT_EQ(2, queue.find("key1")->version);
+  EXPECT_EQ(start + 20ms, queue.getNextExpiryTime());
+
+  EXPECT_TRUE(queue.cancel("key2"));
+  EXPECT_FALSE(queue.cancel("key2"));
+  EXPECT_EQ(nullptr, queue.find("key2"));
+  EXPECT_EQ(2, queue.size());
+
+  // nothing expires before its expiry time
+  EXPECT_TRUE(queue.expire(start + 24ms).empty());
+
+  // keys due are expired together
+  queue.schedule(createEntry("key4", start + 26ms));
+  auto expired = queue.expire(start + 27ms);
+  EXPECT_EQ((std::vector<std::string>{"key1", "key4"}), getKeys(expired));
+  for (const auto& entry : expired) {
+    EXPECT_EQ(entry.key == "key1" ? 2 : 1, entry.version);
+  }
+  EXPECT_EQ(1, queue.size());
+  EXPECT_EQ(nullptr, queue.find("key1"));
+
+  expired = queue.expire(start + 1s);
+  EXPECT_EQ((std::vector<std::string>{"key3"}), getKeys(expired));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.getNextExpiryTime().has_value());
+
+  // keys scheduled in the past expire with the next tick
+  queue.schedule(createEntry("key5", start));
+  expired = queue.expire(start + 1001ms);
+  EXPECT_EQ((std::vector<std::string>{"key5"}), getKeys(expired));
+}
+
+TEST(TtlCountdownQueueTest, HigherLevels) {
+  const auto start = std::chrono::steady_clock::now();
+  TtlCountdownQueue queue(1ms, start);
+
+  // expiry times spread over all levels of the wheel
+  std::map<std::string, std::chrono::milliseconds> ttls{
+      {"level0", 100ms},
+      {"level1", 60s},
+      {"level2", 2h},
+      {"level3", 24h * 30},
+      {"beyond", 24h * 100},
+  };
+  for (const auto& kv : ttls) {
+    queue.schedule(createEntry(kv.first, start + kv.second));
+  }
+
+  auto now = start;
+  std::map<std::string, std::chrono::steady_clock::time_point> expiryTimes;
+  while (not queue.empty()) {
+    // next expiry time never skips entries
+    const auto nextExpiryTime = queue.getNextExpiryTime();
+    ASSERT_TRUE(nextExpiryTime.has_value());
+    ASSERT_LT(now, *nextExpiryTime);
+    now = *nextExpiryTime;
+    for (const auto& entry : queue.expire(now)) {
+      expiryTimes.emplace(entry.key, now);
+    }
+  }
+
+  ASSERT_EQ(ttls.size(), expiryTimes.size());
+  for (const auto& kv : ttls) {
+    EXPECT_EQ(start + kv.second, expiryTimes.at(kv.first)) << kv.first;
+  }
+}
+
+TEST(TtlCountdownQueueTest, RandomSchedule) {
+  const auto start = std::chrono::steady_clock::now();
+  TtlCountdownQueue queue(1ms, start);
+  std::map<std::string, std::chrono::steady_clock::time_point> expected;
+
+  auto now = start;
+  for (int i = 0; i < 20000; ++i) {
+    const auto key = folly::sformat("key-{}", folly::Random::rand32(1000));
+    switch (folly::Random::rand32(3)) {
+    case 0: {
+      const auto expiryTime =
+          now + std::chrono::milliseconds(folly::Random::rand32(200000));
+      queue.schedule(createEntry(key, expiryTime));
+      expected[key] = expiryTime;
+      break;
+    }
+    case 1: {
+      EXPECT_EQ(expected.erase(key) == 1, queue.cancel(key));
+      break;
+    }
+    default: {
+      now += std::chrono::microseconds(folly::Random::rand32(100000));
+      for (const auto& entry : queue.expire(now)) {
+        ASSERT_EQ(1, expected.count(entry.key));
+        EXPECT_EQ(expected.at(entry.key), entry.expiryTime);
+        EXPECT_LE(entry.expiryTime, now);
+        expected.erase(entry.key);
+      }
+      // keys past their expiry time by a tick have expired
+      for (const auto& kv : expected) {
+        EXPECT_LT(now, kv.second + 1ms);
+      }
+    }
+    }
+    EXPECT_EQ(expected.size(), queue.size());
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
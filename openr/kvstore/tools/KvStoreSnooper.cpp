@@ -11,17 +11,47 @@
 
 #include <openr/common/OpenrClient.h>
 #include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreExport.h>
 
 DEFINE_string(host, "::1", "Host to connect to");
 DEFINE_int32(port, openr::Constants::kOpenrCtrlPort, "OpenrCtrl server port");
 DEFINE_int32(connect_timeout_ms, 1000, "Connect timeout for client");
 DEFINE_int32(processing_timeout_ms, 5000, "Processing timeout for client");
+DEFINE_string(
+    export_path,
+    "",
+    "Print the keys of a local KvStore mirror (see kvstore_export_path_prefix) "
+    "instead of subscribing over thrift");
+DEFINE_string(key_prefix, "", "Only print keys starting with it");
+
+namespace {
+
+void
+printKeyVal(const std::string& key, const openr::thrift::Value& value) {
+  std::cout << (value.value.hasValue() ? "Updated" : "Refreshed")
+            << " KeyVal: " << key << std::endl;
+  std::cout << "  version: " << value.version << std::endl;
+  std::cout << "  originatorId: " << value.originatorId << std::endl;
+  std::cout << "  ttl: " << value.ttl << std::endl;
+  std::cout << "  ttlVersion: " << value.ttlVersion << std::endl;
+  std::cout << "  hash: " << value.hash.value_or(0) << std::endl
+            << std::endl; // intended
+}
+
+} // namespace
 
 int
 main(int argc, char** argv) {
   // Initialize all params
   folly::init(&argc, &argv);
 
+  // Dump the local mirror, without any RPC
+  if (not FLAGS_export_path.empty()) {
+    openr::KvStoreExportReader reader(FLAGS_export_path);
+    reader.forEach(FLAGS_key_prefix, printKeyVal);
+    return 0;
+  }
+
   // Define and start event base
   folly::EventBase evb;
   std::thread evbThread([&evb]() { evb.loopForever(); });
@@ -62,17 +92,10 @@ main(int argc, char** argv) {
                 auto updatedKeyVals =
                     openr::KvStore::mergeKeyValues(globalKeyVals, pub.keyVals);
                 for (auto& kv : updatedKeyVals) {
-                  std::cout
-                      << (kv.second.value.hasValue() ? "Updated" : "Refreshed")
-                      << " KeyVal: " << kv.first << std::endl;
-                  std::cout << "  version: " << kv.second.version << std::endl;
-                  std::cout << "  originatorId: " << kv.second.originatorId
-                            << std::endl;
-                  std::cout << "  ttl: " << kv.second.ttl << std::endl;
-                  std::cout << "  ttlVersion: " << kv.second.ttlVersion
-                            << std::endl;
-                  std::cout << "  hash: " << kv.second.hash.value() << std::endl
-                            << std::endl; // intended
+                  if (folly::StringPiece(kv.first).startsWith(
+                          FLAGS_key_prefix)) {
+                    printKeyVal(kv.first, kv.second);
+                  }
                 }
               });
 
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "FlapDampener.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+FlapDampener::FlapDampener(FlapDampeningConfig const& config)
+    : config_(config),
+      maxPenalty_(
+          config.reuseThreshold *
+          std::exp2(
+              static_cast<double>(config.maxSuppressTime.count()) /
+              config.halfLife.count())) {
+  CHECK_GT(config_.penaltyPerFlap, 0);
+  CHECK_GT(config_.reuseThreshold, 0);
+  CHECK_LT(config_.reuseThreshold, config_.suppressThreshold);
+  CHECK_GT(config_.halfLife.count(), 0);
+  CHECK_GE(maxPenalty_, config_.suppressThreshold)
+      << "maxSuppressTime too short to ever suppress";
+}
+
+double
+FlapDampener::getPenalty(Clock::time_point now) const {
+  if (penalty_ == 0 or now <= lastUpdateTime_) {
+    return penalty_;
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      now - lastUpdateTime_;
+  return penalty_ * std::exp2(-elapsed.count() / config_.halfLife.count());
+}
+
+bool
+FlapDampener::recordFlap(Clock::time_point now) {
+  penalty_ = std::min(getPenalty(now) + config_.penaltyPerFlap, maxPenalty_);
+  lastUpdateTime_ = std::max(now, lastUpdateTime_);
+  if (penalty_ >= config_.suppressThreshold) {
+    isSuppressed_ = true;
+  }
+  return isSuppressed_;
+}
+
+bool
+FlapDampener::isSuppressed(Clock::time_point now) {
+  if (isSuppressed_ and getPenalty(now) < config_.reuseThreshold) {
+    isSuppressed_ = false;
+  }
+  return isSuppressed_;
+}
+
+std::chrono::milliseconds
+FlapDampener::getTimeUntilReuse(Clock::time_point now) const {
+  const auto penalty = getPenalty(now);
+  if (not isSuppressed_ or penalty < config_.reuseThreshold) {
+    return std::chrono::milliseconds(0);
+  }
+  // penalty * 2^(-t / halfLife) = reuseThreshold, plus a millisecond for
+  // the penalty to be strictly below the threshold
+  const auto timeMs = config_.halfLife.count() *
+      std::log2(penalty / config_.reuseThreshold);
+  return std::chrono::milliseconds(static_cast<int64_t>(timeMs) + 1);
+}
+
+} // namespace openr
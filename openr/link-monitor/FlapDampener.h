@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace openr {
+
+//
+// Parameters of flap dampening, in the spirit of BGP route flap dampening
+// (RFC 2439)
+//
+struct FlapDampeningConfig {
+  // penalty added on every flap
+  double penaltyPerFlap{1000};
+  // suppressed once the penalty reaches suppressThreshold, and until it
+  // decayed below reuseThreshold
+  double suppressThreshold{2000};
+  double reuseThreshold{750};
+  // time for the penalty to decay to half of its value
+  std::chrono::milliseconds halfLife{15000};
+  // longest time to stay suppressed after the last flap, caps the penalty
+  std::chrono::milliseconds maxSuppressTime{60000};
+};
+
+/**
+ * Tracks the flap penalty of a single object, e.g. an interface or an
+ * adjacency. Every flap adds a fixed penalty which then decays exponentially.
+ * The object is suppressed once its penalty crosses the suppress threshold
+ * and is reused when it decayed below the reuse threshold again.
+ */
+class FlapDampener final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FlapDampener(FlapDampeningConfig const& config);
+
+  // Penalize a flap. Returns true if suppressed afterwards
+  bool recordFlap(Clock::time_point now = Clock::now());
+
+  // Is suppressed, clears suppression once the penalty decayed enough
+  bool isSuppressed(Clock::time_point now = Clock::now());
+
+  // Current, decayed, penalty
+  double getPenalty(Clock::time_point now = Clock::now()) const;
+
+  // Time until suppression ends if there are no more flaps, zero if not
+  // suppressed
+  std::chrono::milliseconds getTimeUntilReuse(
+      Clock::time_point now = Clock::now()) const;
+
+ private:
+  FlapDampeningConfig const config_;
+
+  // penalty never grows beyond this, so that suppression doesn't outlast
+  // maxSuppressTime
+  double const maxPenalty_{0};
+
+  // penalty as of lastUpdateTime_
+  double penalty_{0};
+  Clock::time_point lastUpdateTime_;
+
+  bool isSuppressed_{false};
+};
+
+} // namespace openr
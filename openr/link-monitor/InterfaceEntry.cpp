@@ -18,11 +18,16 @@ InterfaceEntry::InterfaceEntry(
     std::chrono::milliseconds const& initBackoff,
     std::chrono::milliseconds const& maxBackoff,
     fbzmq::ZmqThrottle& updateCallback,
-    fbzmq::ZmqTimeout& updateTimeout)
+    fbzmq::ZmqTimeout& updateTimeout,
+    folly::Optional<FlapDampeningConfig> const& dampeningConfig)
     : ifName_(ifName),
       backoff_(initBackoff, maxBackoff),
       updateCallback_(updateCallback),
-      updateTimeout_(updateTimeout) {}
+      updateTimeout_(updateTimeout) {
+  if (dampeningConfig.hasValue()) {
+    dampener_.emplace(*dampeningConfig);
+  }
+}
 
 bool
 InterfaceEntry::updateAttrs(int ifIndex, bool isUp, uint64_t weight) {
@@ -37,6 +42,10 @@ InterfaceEntry::updateAttrs(int ifIndex, bool isUp, uint64_t weight) {
   if (wasUp != isUp and wasUp) {
     // Penalize backoff on transitioning to DOWN state
     backoff_.reportError();
+    if (dampener_ and dampener_->recordFlap()) {
+      VLOG(1) << "Interface " << ifName_ << " is suppressed, flap penalty "
+              << dampener_->getPenalty();
+    }
   }
 
   // Look for active to down transition
@@ -58,6 +67,10 @@ InterfaceEntry::isActive() {
     return false;
   }
 
+  if (dampener_ and dampener_->isSuppressed()) {
+    return false;
+  }
+
   const auto lastErrorTime = backoff_.getLastErrorTime();
   const auto now = std::chrono::steady_clock::now();
   if (now - lastErrorTime > backoff_.getMaxBackoff()) {
@@ -68,7 +81,19 @@ InterfaceEntry::isActive() {
 
 std::chrono::milliseconds
 InterfaceEntry::getBackoffDuration() const {
-  return backoff_.getTimeRemainingUntilRetry();
+  auto backoff = backoff_.getTimeRemainingUntilRetry();
+  if (dampener_) {
+    backoff = std::max(backoff, dampener_->getTimeUntilReuse());
+  }
+  return backoff;
+}
+
+folly::Optional<double>
+InterfaceEntry::getFlapPenalty() const {
+  if (not dampener_) {
+    return folly::none;
+  }
+  return dampener_->getPenalty();
 }
 
 bool
@@ -12,10 +12,12 @@
 #include <fbzmq/async/ZmqThrottle.h>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
 #include <folly/String.h>
 
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
+#include <openr/link-monitor/FlapDampener.h>
 
 namespace openr {
 
@@ -27,6 +29,8 @@ namespace openr {
  * - Any change will always trigger throttled callback
  * - Interface transition from Active to Inactive schedules immediate timeout
  *   for fast reactions to down events.
+ * - With flap dampening, interface is also inactive while its flap penalty
+ *   keeps it suppressed.
  */
 class InterfaceEntry final {
  public:
@@ -35,7 +39,9 @@ class InterfaceEntry final {
       std::chrono::milliseconds const& initBackoff,
       std::chrono::milliseconds const& maxBackoff,
       fbzmq::ZmqThrottle& updateCallback,
-      fbzmq::ZmqTimeout& updateTimeout);
+      fbzmq::ZmqTimeout& updateTimeout,
+      folly::Optional<FlapDampeningConfig> const& dampeningConfig =
+          folly::none);
 
   // Update attributes
   bool updateAttrs(int ifIndex, bool isUp, uint64_t weight);
@@ -47,9 +53,12 @@ class InterfaceEntry final {
   // it's not backed off
   bool isActive();
 
-  // Get backoff time
+  // Get backoff time, including the remaining suppression time if dampened
   std::chrono::milliseconds getBackoffDuration() const;
 
+  // Get flap penalty, none if flap dampening is disabled
+  folly::Optional<double> getFlapPenalty() const;
+
   // Used to check for updates if doing a re-sync
   bool
   operator==(const InterfaceEntry& interfaceEntry) {
@@ -120,6 +129,7 @@ class InterfaceEntry final {
 
   // Backoff variables
   ExponentialBackoff<std::chrono::milliseconds> backoff_;
+  folly::Optional<FlapDampener> dampener_;
 
   // Update callback
   fbzmq::ZmqThrottle& updateCallback_;
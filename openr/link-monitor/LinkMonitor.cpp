@@ -7,10 +7,11 @@
 
 #include "LinkMonitor.h"
 
+#include <cmath>
 #include <functional>
+#include <tuple>
 
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
-#include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
@@ -22,6 +23,7 @@
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/EventLogBuffer.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
@@ -36,11 +38,17 @@ const std::string kConfigKey{"link-monitor-config"};
 
 /**
  * Transformation function to convert measured rtt (in us) to a metric value
- * to be used. Metric can never be zero.
+ * to be used. Metric can never be zero. Metrics beyond the bucket size are
+ * rounded to the closest bucket.
  */
 int32_t
 getRttMetric(int64_t rttUs) {
-  return std::max((int)(rttUs / 100), (int)1);
+  const auto metric = std::max((int)(rttUs / 100), (int)1);
+  const auto bucketSize = openr::Constants::kRttMetricBucketSize;
+  if (metric <= bucketSize) {
+    return metric;
+  }
+  return (metric + bucketSize / 2) / bucketSize * bucketSize;
 }
 
 void
@@ -98,7 +106,8 @@ LinkMonitor::LinkMonitor(
     std::chrono::milliseconds flapInitialBackoff,
     std::chrono::milliseconds flapMaxBackoff,
     std::chrono::milliseconds ttlKeyInKvStore,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    folly::Optional<FlapDampeningConfig> flapDampeningConfig)
     : nodeId_(nodeId),
       platformThriftPort_(platformThriftPort),
       kvStoreLocalCmdUrl_(kvStoreLocalCmdUrl),
@@ -117,6 +126,7 @@ LinkMonitor::LinkMonitor(
       platformPubUrl_(platformPubUrl),
       flapInitialBackoff_(flapInitialBackoff),
       flapMaxBackoff_(flapMaxBackoff),
+      flapDampeningConfig_(std::move(flapDampeningConfig)),
       ttlKeyInKvStore_(ttlKeyInKvStore),
       adjHoldUntilTimePoint_(std::chrono::steady_clock::now() + adjHoldTime),
       // mutable states
@@ -131,10 +141,10 @@ LinkMonitor::LinkMonitor(
   // Create throttled adjacency advertiser
   advertiseAdjacenciesThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
       getEvb(), Constants::kLinkThrottleTimeout, [this]() noexcept {
-        // will advertise to all areas but will not trigger a adj key update
-        // if nothing changed. For peers no action is taken if nothing changed
+        // will advertise peers to all areas, but adjacencies of changed
+        // areas only. For peers no action is taken if nothing changed
         advertiseKvStorePeers();
-        advertiseAdjacencies();
+        advertisePendingAdjacencies();
       });
 
   // Create throttled interfaces and addresses advertiser
@@ -145,6 +155,10 @@ LinkMonitor::LinkMonitor(
   // Create timer. Timer is used for immediate or delayed executions.
   advertiseIfaceAddrTimer_ = fbzmq::ZmqTimeout::make(
       getEvb(), [this]() noexcept { advertiseIfaceAddr(); });
+  dampenedNeighborsTimer_ = fbzmq::ZmqTimeout::make(
+      getEvb(), [this]() noexcept { processDampenedNeighbors(); });
+  rttMetricTimer_ = fbzmq::ZmqTimeout::make(
+      getEvb(), [this]() noexcept { processPendingRttMetrics(); });
 
   LOG(INFO) << "Loading link-monitor config";
   zmqMonitorClient_ =
@@ -225,16 +239,17 @@ LinkMonitor::LinkMonitor(
   });
   adjHoldTimer_->scheduleTimeout(adjHoldTime);
 
-  // Add fiber to process the neighbor events
+  // Add fiber to process the neighbor events. Events queued up meanwhile
+  // are processed as one batch
   addFiberTask([q = std::move(neighborUpdatesQueue), this]() mutable noexcept {
     while (true) {
-      auto maybeEvent = q.get();
+      auto maybeEvents = q.getAllAvailable();
       VLOG(1) << "Received neighbor update";
-      if (maybeEvent.hasError()) {
+      if (maybeEvents.hasError()) {
         LOG(INFO) << "Terminating neighbor update processing fiber";
         break;
       }
-      processNeighborEvent(std::move(maybeEvent).value());
+      processNeighborEvents(std::move(maybeEvents).value());
     }
   });
 
@@ -248,6 +263,30 @@ LinkMonitor::LinkMonitor(
   tData_.addStatExportType("link_monitor.advertise_links", fbzmq::SUM);
 }
 
+void
+LinkMonitor::processLinkEvent(thrift::LinkEntry const& linkEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
+  if (interfaceEntry) {
+    const bool wasUp = interfaceEntry->isUp();
+    interfaceEntry->updateAttrs(linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
+    logLinkEvent(
+        interfaceEntry->getIfName(),
+        wasUp,
+        interfaceEntry->isUp(),
+        interfaceEntry->getBackoffDuration());
+  }
+}
+
+void
+LinkMonitor::processAddrEvent(thrift::AddrEntry const& addrEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
+  if (interfaceEntry) {
+    interfaceEntry->updateAddr(
+        toIPNetwork(addrEvt.ipPrefix, false /* no masking */),
+        addrEvt.isValid);
+  }
+}
+
 void
 LinkMonitor::prepare() noexcept {
   //
@@ -273,6 +312,14 @@ LinkMonitor::prepare() noexcept {
     LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << addrEventType << " "
                << nlAddrSubOpt.error();
   }
+  const auto batchEventType =
+      static_cast<uint16_t>(thrift::PlatformEventType::EVENT_BATCH);
+  auto nlBatchSubOpt =
+      nlEventSub_.setSockOpt(ZMQ_SUBSCRIBE, &batchEventType, sizeof(uint16_t));
+  if (nlBatchSubOpt.hasError()) {
+    LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << batchEventType << " "
+               << nlBatchSubOpt.error();
+  }
   const auto nlSub = nlEventSub_.connect(fbzmq::SocketUrl{platformPubUrl_});
   if (nlSub.hasError()) {
     LOG(FATAL) << "Error connecting to URL '" << platformPubUrl_ << "' "
@@ -307,20 +354,8 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::LINK_EVENT: {
           VLOG(3) << "Received Link Event from Platform....";
           try {
-            const auto linkEvt =
-                fbzmq::util::readThriftObjStr<thrift::LinkEntry>(
-                    eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
-            if (interfaceEntry) {
-              const bool wasUp = interfaceEntry->isUp();
-              interfaceEntry->updateAttrs(
-                  linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
-              logLinkEvent(
-                  interfaceEntry->getIfName(),
-                  wasUp,
-                  interfaceEntry->isUp(),
-                  interfaceEntry->getBackoffDuration());
-            }
+            processLinkEvent(fbzmq::util::readThriftObjStr<thrift::LinkEntry>(
+                eventMsg.value().eventData, serializer_));
           } catch (std::exception const& e) {
             LOG(ERROR) << "Error parsing linkEvt. Reason: "
                        << folly::exceptionStr(e);
@@ -330,17 +365,28 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::ADDRESS_EVENT: {
           VLOG(3) << "Received Address Event from Platform....";
           try {
-            const auto addrEvt =
-                fbzmq::util::readThriftObjStr<thrift::AddrEntry>(
+            processAddrEvent(fbzmq::util::readThriftObjStr<thrift::AddrEntry>(
+                eventMsg.value().eventData, serializer_));
+          } catch (std::exception const& e) {
+            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+                       << folly::exceptionStr(e);
+          }
+        } break;
+
+        case thrift::PlatformEventType::EVENT_BATCH: {
+          VLOG(3) << "Received Event Batch from Platform....";
+          try {
+            const auto batch =
+                fbzmq::util::readThriftObjStr<thrift::PlatformEventBatch>(
                     eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
-            if (interfaceEntry) {
-              interfaceEntry->updateAddr(
-                  toIPNetwork(addrEvt.ipPrefix, false /* no masking */),
-                  addrEvt.isValid);
+            for (auto const& linkEvt : batch.linkEntries) {
+              processLinkEvent(linkEvt);
+            }
+            for (auto const& addrEvt : batch.addrEntries) {
+              processAddrEvent(addrEvt);
             }
           } catch (std::exception const& e) {
-            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+            LOG(ERROR) << "Error parsing event batch. Reason: "
                        << folly::exceptionStr(e);
           }
         } break;
@@ -363,6 +409,9 @@ LinkMonitor::prepare() noexcept {
     if (success) {
       VLOG(2) << "InterfaceDb Sync is successful";
       expBackoff_.reportSuccess();
+      // Publish a full snapshot with the next interface update, in case a
+      // consumer missed some
+      advertiseFullInterfaceDb_ = true;
       interfaceDbSyncTimer_->scheduleTimeout(
           Constants::kPlatformSyncInterval, isPeriodic);
     } else {
@@ -443,14 +492,19 @@ LinkMonitor::neighborUpEvent(
   thrift::PeerSpec peerSpec;
   peerSpec.cmdUrl = repUrl;
   peerSpec.supportFloodOptimization = event.supportFloodOptimization;
+  if (!mockMode_) {
+    peerSpec.peerAddr =
+        folly::sformat("{}%{}", toString(neighborAddrV6), ifName);
+    peerSpec.ctrlPort = event.neighbor.openrCtrlThriftPort;
+  }
   adjacencies_[adjId] =
       AdjacencyValue(peerSpec, std::move(newAdj), false, area);
 
   // Advertise KvStore peers immediately
-  advertiseKvStorePeers(area, {{remoteNodeName, peerSpec}});
+  advertiseKvStorePeersOrDefer(area, {{remoteNodeName, peerSpec}});
 
   // Advertise new adjancies in a throttled fashion
-  advertiseAdjacenciesThrottled_->operator()();
+  scheduleAdvertiseAdjacencies(area);
 }
 
 void
@@ -470,8 +524,8 @@ LinkMonitor::neighborDownEvent(
     adjacencies_.erase(adjValueIt);
   }
   // advertise both peers and adjacencies
-  advertiseKvStorePeers(area);
-  advertiseAdjacencies(area);
+  advertiseKvStorePeersOrDefer(area);
+  advertiseAdjacenciesOrDefer(area);
 }
 
 void
@@ -488,7 +542,7 @@ LinkMonitor::neighborRestartingEvent(
   if (adjValueIt != adjacencies_.end()) {
     adjValueIt->second.isRestarting = true;
   }
-  advertiseKvStorePeers(area);
+  advertiseKvStorePeersOrDefer(area);
 }
 
 std::unordered_map<std::string, thrift::PeerSpec>
@@ -632,9 +686,50 @@ LinkMonitor::advertiseAdjacencies(const std::string& area) {
     adjDb.adjacencies.emplace_back(std::move(adj));
   }
 
+  // deterministic order, the same adjacencies must serialize the same way
+  std::sort(
+      adjDb.adjacencies.begin(),
+      adjDb.adjacencies.end(),
+      [](thrift::Adjacency const& lhs, thrift::Adjacency const& rhs) {
+        return std::tie(lhs.otherNodeName, lhs.ifName) <
+            std::tie(rhs.otherNodeName, rhs.ifName);
+      });
+
+  // Config is most likely to have changed. Update it in `ConfigStore`
+  if (not storedConfig_.hasValue() or storedConfig_.value() != config_) {
+    configStore_->storeThriftObj(kConfigKey, config_); // not awaiting on result
+    storedConfig_ = config_;
+  }
+
+  // Cancel throttle timeout if scheduled and nothing else is pending
+  adjAreasToAdvertise_.erase(area);
+  if (adjAreasToAdvertise_.empty() and
+      advertiseAdjacenciesThrottled_->isActive()) {
+    advertiseAdjacenciesThrottled_->cancel();
+  }
+
+  // Neighbor event leading to this advertisement, if measured
+  thrift::PerfEvents perfEvents;
+  auto neighborPerfIt = neighborPerfEvents_.find(area);
+  if (neighborPerfIt != neighborPerfEvents_.end()) {
+    perfEvents = std::move(neighborPerfIt->second);
+    neighborPerfEvents_.erase(neighborPerfIt);
+  }
+
+  // Skip flooding and re-parsing of an unchanged database everywhere
+  auto advertisedIt = advertisedAdjDbs_.find(area);
+  if (advertisedIt != advertisedAdjDbs_.end() and
+      advertisedIt->second == adjDb) {
+    VLOG(2) << "Adjacency database unchanged in area: " << area
+            << ", skipping advertisement";
+    tData_.addStatValue(
+        "link_monitor.advertise_adjacencies_skipped", 1, fbzmq::SUM);
+    return;
+  }
+  advertisedAdjDbs_[area] = adjDb;
+
   // Add perf information if enabled
   if (enablePerfMeasurement_) {
-    thrift::PerfEvents perfEvents;
     addPerfEvent(perfEvents, nodeId_, "ADJ_DB_UPDATED");
     adjDb.perfEvents = perfEvents;
   } else {
@@ -647,14 +742,6 @@ LinkMonitor::advertiseAdjacencies(const std::string& area) {
   std::string adjDbStr = fbzmq::util::writeThriftObjStr(adjDb, serializer_);
   kvStoreClient_->persistKey(keyName, adjDbStr, ttlKeyInKvStore_, area);
   tData_.addStatValue("link_monitor.advertise_adjacencies", 1, fbzmq::SUM);
-
-  // Config is most likely to have changed. Update it in `ConfigStore`
-  configStore_->storeThriftObj(kConfigKey, config_); // not awaiting on result
-
-  // Cancel throttle timeout if scheduled
-  if (advertiseAdjacenciesThrottled_->isActive()) {
-    advertiseAdjacenciesThrottled_->cancel();
-  }
 }
 void
 LinkMonitor::advertiseAdjacencies() {
@@ -666,6 +753,31 @@ LinkMonitor::advertiseAdjacencies() {
   }
 }
 
+void
+LinkMonitor::advertisePendingAdjacencies() {
+  // advertising an area takes it out of the pending ones
+  const auto areas = adjAreasToAdvertise_;
+  for (const auto& area : areas) {
+    advertiseAdjacencies(area);
+  }
+}
+
+void
+LinkMonitor::scheduleAdvertiseAdjacencies(const std::string& area) {
+  adjAreasToAdvertise_.emplace(area);
+  advertiseAdjacenciesThrottled_->operator()();
+}
+
+void
+LinkMonitor::scheduleAdvertiseAdjacenciesOnInterface(
+    const std::string& ifName) {
+  for (const auto& adjKv : adjacencies_) {
+    if (adjKv.first.second == ifName) {
+      scheduleAdvertiseAdjacencies(adjKv.second.area);
+    }
+  }
+}
+
 void
 LinkMonitor::advertiseIfaceAddr() {
   auto retryTime = getRetryTimeOnUnstableInterfaces();
@@ -691,9 +803,8 @@ void
 LinkMonitor::advertiseInterfaces() {
   tData_.addStatValue("link_monitor.advertise_links", 1, fbzmq::SUM);
 
-  // Create interface database
-  thrift::InterfaceDatabase ifDb;
-  ifDb.thisNodeName = nodeId_;
+  // Collect current interfaces
+  std::map<std::string, thrift::InterfaceInfo> interfaces;
   for (auto& kv : interfaces_) {
     auto& ifName = kv.first;
     auto& interface = kv.second;
@@ -705,9 +816,34 @@ LinkMonitor::advertiseInterfaces() {
     // Get interface info and override active status
     auto interfaceInfo = interface.getInterfaceInfo();
     interfaceInfo.isUp = interface.isActive();
-    ifDb.interfaces.emplace(ifName, std::move(interfaceInfo));
+    interfaces.emplace(ifName, std::move(interfaceInfo));
   }
 
+  // Create interface database, either full or with the changes since the
+  // previous one
+  thrift::InterfaceDatabase ifDb;
+  ifDb.thisNodeName = nodeId_;
+  ifDb.seqNum = ++interfaceDbSeqNum_;
+  if (advertiseFullInterfaceDb_) {
+    tData_.addStatValue("link_monitor.advertise_links.full", 1, fbzmq::SUM);
+    advertiseFullInterfaceDb_ = false;
+    ifDb.interfaces = interfaces;
+  } else {
+    ifDb.isDelta = true;
+    for (auto const& kv : interfaces) {
+      auto it = advertisedInterfaces_.find(kv.first);
+      if (it == advertisedInterfaces_.end() or it->second != kv.second) {
+        ifDb.interfaces.emplace(kv.first, kv.second);
+      }
+    }
+    for (auto const& kv : advertisedInterfaces_) {
+      if (interfaces.count(kv.first) == 0) {
+        ifDb.deletedInterfaces.emplace_back(kv.first);
+      }
+    }
+  }
+  advertisedInterfaces_ = std::move(interfaces);
+
   // publish new interface database to other modules (Fib & Spark)
   interfaceUpdatesQueue_.push(std::move(ifDb));
 }
@@ -720,7 +856,7 @@ LinkMonitor::advertiseRedistAddrs() {
     return;
   }
 
-  std::vector<thrift::PrefixEntry> prefixes;
+  std::map<thrift::IpPrefix, thrift::PrefixEntry> prefixes;
 
   // Add static prefixes
   for (auto const& prefix : staticPrefixes_) {
@@ -735,7 +871,7 @@ LinkMonitor::advertiseRedistAddrs() {
         ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
         : thrift::PrefixForwardingAlgorithm::SP_ECMP;
     prefixEntry.ephemeral = folly::none;
-    prefixes.push_back(prefixEntry);
+    prefixes.emplace(prefix, std::move(prefixEntry));
   }
 
   // Add redistribute addresses
@@ -757,16 +893,56 @@ LinkMonitor::advertiseRedistAddrs() {
       prefix.forwardingAlgorithm = forwardingAlgoKsp2Ed_
           ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
           : thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      prefixes.emplace_back(std::move(prefix));
+      auto ipPrefix = prefix.prefix;
+      prefixes.emplace(std::move(ipPrefix), std::move(prefix));
     }
   }
 
-  // Advertise via prefix manager client
-  thrift::PrefixUpdateRequest request;
-  request.cmd = thrift::PrefixUpdateCommand::SYNC_PREFIXES_BY_TYPE;
-  request.type = openr::thrift::PrefixType::LOOPBACK;
-  request.prefixes = std::move(prefixes);
-  prefixUpdatesQueue_.push(std::move(request));
+  // Replace whatever a previous incarnation left with the first
+  // advertisement, then send the changes to it only
+  if (not advertisedRedistPrefixes_.hasValue()) {
+    thrift::PrefixUpdateRequest request;
+    request.cmd = thrift::PrefixUpdateCommand::SYNC_PREFIXES_BY_TYPE;
+    request.type = openr::thrift::PrefixType::LOOPBACK;
+    for (auto const& kv : prefixes) {
+      request.prefixes.emplace_back(kv.second);
+    }
+    prefixUpdatesQueue_.push(std::move(request));
+    advertisedRedistPrefixes_ = std::move(prefixes);
+    return;
+  }
+
+  thrift::PrefixUpdateRequest addRequest;
+  addRequest.cmd = thrift::PrefixUpdateCommand::ADD_PREFIXES;
+  for (auto const& kv : prefixes) {
+    auto it = advertisedRedistPrefixes_->find(kv.first);
+    if (it == advertisedRedistPrefixes_->end() or it->second != kv.second) {
+      addRequest.prefixes.emplace_back(kv.second);
+    }
+  }
+  thrift::PrefixUpdateRequest withdrawRequest;
+  withdrawRequest.cmd = thrift::PrefixUpdateCommand::WITHDRAW_PREFIXES;
+  for (auto const& kv : *advertisedRedistPrefixes_) {
+    if (prefixes.count(kv.first) == 0) {
+      withdrawRequest.prefixes.emplace_back(kv.second);
+    }
+  }
+  advertisedRedistPrefixes_ = std::move(prefixes);
+
+  if (addRequest.prefixes.empty() and withdrawRequest.prefixes.empty()) {
+    tData_.addStatValue(
+        "link_monitor.advertise_redist_addrs_skipped", 1, fbzmq::SUM);
+    return;
+  }
+  VLOG(1) << "Advertising " << addRequest.prefixes.size()
+          << " and withdrawing " << withdrawRequest.prefixes.size()
+          << " redistributed prefixes";
+  if (not withdrawRequest.prefixes.empty()) {
+    prefixUpdatesQueue_.push(std::move(withdrawRequest));
+  }
+  if (not addRequest.prefixes.empty()) {
+    prefixUpdatesQueue_.push(std::move(addRequest));
+  }
 }
 
 std::chrono::milliseconds
@@ -814,7 +990,8 @@ LinkMonitor::getOrCreateInterfaceEntry(const std::string& ifName) {
           flapInitialBackoff_,
           flapMaxBackoff_,
           *advertiseIfaceAddrThrottled_,
-          *advertiseIfaceAddrTimer_));
+          *advertiseIfaceAddrTimer_,
+          flapDampeningConfig_));
 
   return &(res.first->second);
 }
@@ -871,46 +1048,135 @@ LinkMonitor::syncInterfaces() {
   }
 
   //
-  // Process received data and make updates in InterfaceEntry objects
+  // Process received data and make updates in InterfaceEntry objects. The
+  // snapshot is diffed against interfaces_, only changed links and addresses
+  // are touched
   //
+  std::unordered_set<std::string> syncedIfNames;
   for (const auto& link : links) {
     // Get interface entry
     auto interfaceEntry = getOrCreateInterfaceEntry(link.ifName);
     if (not interfaceEntry) {
       continue;
     }
+    syncedIfNames.emplace(link.ifName);
 
     std::unordered_set<folly::CIDRNetwork> newNetworks;
     for (const auto& network : link.networks) {
       newNetworks.emplace(toIPNetwork(network, false /* no masking */));
     }
-    const auto& oldNetworks = interfaceEntry->getNetworks();
+    syncInterfaceEntry(
+        *interfaceEntry, link.ifIndex, link.isUp, link.weight, newNetworks);
+  }
 
-    // Update link attributes
-    const bool wasUp = interfaceEntry->isUp();
-    interfaceEntry->updateAttrs(link.ifIndex, link.isUp, link.weight);
-    logLinkEvent(
-        interfaceEntry->getIfName(),
-        wasUp,
-        interfaceEntry->isUp(),
-        interfaceEntry->getBackoffDuration());
+  // Links gone from the system without us receiving their events are brought
+  // down along with their addresses
+  for (auto& kv : interfaces_) {
+    if (syncedIfNames.count(kv.first)) {
+      continue;
+    }
+    auto& interfaceEntry = kv.second;
+    if (not interfaceEntry.isUp() and interfaceEntry.getNetworks().empty()) {
+      continue;
+    }
+    LOG(INFO) << "Interface " << kv.first << " is missing from link snapshot";
+    syncInterfaceEntry(
+        interfaceEntry,
+        interfaceEntry.getIfIndex(),
+        false /* isUp */,
+        interfaceEntry.getWeight(),
+        {} /* networks */);
+  }
 
-    // Remove old addresses if they are not in new
-    for (auto const& oldNetwork : oldNetworks) {
-      if (newNetworks.count(oldNetwork) == 0) {
-        interfaceEntry->updateAddr(oldNetwork, false);
-      }
+  return true;
+}
+
+void
+LinkMonitor::syncInterfaceEntry(
+    InterfaceEntry& interfaceEntry,
+    int ifIndex,
+    bool isUp,
+    uint64_t weight,
+    std::unordered_set<folly::CIDRNetwork> const& newNetworks) {
+  // Update link attributes
+  const bool wasUp = interfaceEntry.isUp();
+  interfaceEntry.updateAttrs(ifIndex, isUp, weight);
+  logLinkEvent(
+      interfaceEntry.getIfName(),
+      wasUp,
+      interfaceEntry.isUp(),
+      interfaceEntry.getBackoffDuration());
+
+  // Remove old addresses if they are not in new. Collect them first as
+  // updateAddr modifies the set we'd iterate over
+  std::vector<folly::CIDRNetwork> toDel;
+  const auto& oldNetworks = interfaceEntry.getNetworks();
+  for (auto const& oldNetwork : oldNetworks) {
+    if (newNetworks.count(oldNetwork) == 0) {
+      toDel.emplace_back(oldNetwork);
     }
+  }
+  for (auto const& network : toDel) {
+    interfaceEntry.updateAddr(network, false);
+  }
 
-    // Add new addresses if they are not in old
-    for (auto const& newNetwork : newNetworks) {
-      if (oldNetworks.count(newNetwork) == 0) {
-        interfaceEntry->updateAddr(newNetwork, true);
-      }
+  // Add new addresses if they are not in old
+  for (auto const& newNetwork : newNetworks) {
+    if (oldNetworks.count(newNetwork) == 0) {
+      interfaceEntry.updateAddr(newNetwork, true);
     }
   }
+}
 
-  return true;
+void
+LinkMonitor::advertiseKvStorePeersOrDefer(
+    const std::string& area,
+    std::unordered_map<std::string, thrift::PeerSpec> upPeers) {
+  if (not neighborEventBatch_) {
+    advertiseKvStorePeers(area, upPeers);
+    return;
+  }
+  auto& batchUpPeers = neighborEventBatch_->upPeers[area];
+  for (auto& kv : upPeers) {
+    batchUpPeers[kv.first] = std::move(kv.second);
+  }
+}
+
+void
+LinkMonitor::advertiseAdjacenciesOrDefer(const std::string& area) {
+  if (not neighborEventBatch_) {
+    advertiseAdjacencies(area);
+    return;
+  }
+  neighborEventBatch_->adjAreas.emplace(area);
+}
+
+void
+LinkMonitor::processNeighborEvents(
+    std::vector<thrift::SparkNeighborEvent>&& events) {
+  if (events.size() == 1) {
+    processNeighborEvent(std::move(events.front()));
+    return;
+  }
+
+  VLOG(1) << "Processing batch of " << events.size() << " neighbor events";
+  tData_.addStatValue(
+      "link_monitor.neighbor_event_batch_size", events.size(), fbzmq::AVG);
+
+  neighborEventBatch_.emplace();
+  for (auto& event : events) {
+    processNeighborEvent(std::move(event));
+  }
+  auto batch = std::move(neighborEventBatch_).value();
+  neighborEventBatch_.clear();
+
+  // Single peer update and adjacency publication per area, peers first
+  for (auto const& kv : batch.upPeers) {
+    advertiseKvStorePeers(kv.first, kv.second);
+  }
+  for (auto const& area : batch.adjAreas) {
+    advertiseAdjacencies(area);
+  }
 }
 
 void
@@ -924,9 +1190,27 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
           << (enableV4_ ? toString(neighborAddrV4) : "")
           << " Area:" << event.area;
 
+  // Adjacency changes start perf events of the next adjacency advertisement
+  if (enablePerfMeasurement_ and
+      (event.eventType == thrift::SparkNeighborEventType::NEIGHBOR_UP or
+       event.eventType == thrift::SparkNeighborEventType::NEIGHBOR_DOWN or
+       event.eventType ==
+           thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED)) {
+    auto& perfEvents = neighborPerfEvents_[event.area];
+    if (perfEvents.events.empty()) {
+      addPerfEvent(
+          perfEvents,
+          nodeId_,
+          thrift::_SparkNeighborEventType_VALUES_TO_NAMES.at(event.eventType));
+    }
+  }
+
   switch (event.eventType) {
   case thrift::SparkNeighborEventType::NEIGHBOR_UP: {
     logNeighborEvent(event);
+    if (dampenNeighborUp(event)) {
+      break;
+    }
     neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
     break;
   }
@@ -945,6 +1229,11 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
 
   case thrift::SparkNeighborEventType::NEIGHBOR_DOWN: {
     logNeighborEvent(event);
+    const AdjacencyKey adjId{event.neighbor.nodeName, event.ifName};
+    if (adjacencies_.count(adjId)) {
+      penalizeNeighborFlap(adjId);
+    }
+    dampenedNeighborUps_.erase(adjId);
     neighborDownEvent(event.neighbor.nodeName, event.ifName, event.area);
     break;
   }
@@ -956,15 +1245,9 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
 
     logNeighborEvent(event);
 
-    int32_t newRttMetric = getRttMetric(event.rttUs);
-    VLOG(1) << "Metric value changed for neighbor " << event.neighbor.nodeName
-            << " to " << newRttMetric;
     auto it = adjacencies_.find({event.neighbor.nodeName, event.ifName});
     if (it != adjacencies_.end()) {
-      auto& adj = it->second.adjacency;
-      adj.metric = newRttMetric;
-      adj.rtt = event.rttUs;
-      advertiseAdjacenciesThrottled_->operator()();
+      updateRttMetric(it->second, event.rttUs);
     }
     break;
   }
@@ -974,6 +1257,146 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
   }
 }
 
+void
+LinkMonitor::penalizeNeighborFlap(AdjacencyKey const& adjId) {
+  if (not flapDampeningConfig_) {
+    return;
+  }
+  auto it = adjDampeners_.find(adjId);
+  if (it == adjDampeners_.end()) {
+    it = adjDampeners_.emplace(adjId, FlapDampener(*flapDampeningConfig_))
+             .first;
+  }
+  if (it->second.recordFlap()) {
+    LOG(INFO) << "Adjacency to " << adjId.first << " on " << adjId.second
+              << " is suppressed, flap penalty " << it->second.getPenalty();
+  }
+}
+
+bool
+LinkMonitor::dampenNeighborUp(thrift::SparkNeighborEvent const& event) {
+  const AdjacencyKey adjId{event.neighbor.nodeName, event.ifName};
+  auto it = adjDampeners_.find(adjId);
+  if (it == adjDampeners_.end() or not it->second.isSuppressed()) {
+    return false;
+  }
+
+  const auto reuseTime = it->second.getTimeUntilReuse();
+  LOG(INFO) << "Holding back adjacency to " << adjId.first << " on "
+            << adjId.second << " for " << reuseTime.count()
+            << "ms, flap penalty " << it->second.getPenalty();
+  tData_.addStatValue("link_monitor.neighbor_up_suppressed", 1, fbzmq::SUM);
+  dampenedNeighborUps_[adjId] = event;
+
+  // reschedule timer for the earliest reuse
+  processDampenedNeighbors();
+  return true;
+}
+
+void
+LinkMonitor::processDampenedNeighbors() {
+  folly::Optional<std::chrono::milliseconds> nextReuseTime;
+  for (auto it = dampenedNeighborUps_.begin();
+       it != dampenedNeighborUps_.end();) {
+    auto& dampener = adjDampeners_.at(it->first);
+    if (dampener.isSuppressed()) {
+      const auto reuseTime = dampener.getTimeUntilReuse();
+      nextReuseTime =
+          nextReuseTime ? std::min(*nextReuseTime, reuseTime) : reuseTime;
+      ++it;
+      continue;
+    }
+
+    LOG(INFO) << "Adjacency to " << it->first.first << " on "
+              << it->first.second << " is no longer suppressed";
+    auto event = std::move(it->second);
+    it = dampenedNeighborUps_.erase(it);
+    neighborUpEvent(
+        event.neighbor.transportAddressV4,
+        event.neighbor.transportAddressV6,
+        event);
+  }
+
+  if (nextReuseTime) {
+    dampenedNeighborsTimer_->scheduleTimeout(*nextReuseTime);
+  }
+}
+
+void
+LinkMonitor::updateRttMetric(AdjacencyValue& adjValue, int64_t rttUs) {
+  auto& adj = adjValue.adjacency;
+  const auto newRttMetric = getRttMetric(rttUs);
+  adjValue.pendingRttUs.clear();
+
+  // Same bucket, or too small a change
+  if (newRttMetric == adj.metric) {
+    tData_.addStatValue(
+        "link_monitor.rtt_metric.suppressed_bucket", 1, fbzmq::SUM);
+    return;
+  }
+  if (std::abs(newRttMetric - adj.metric) <
+      adj.metric * Constants::kRttMetricMinChangeRatio) {
+    tData_.addStatValue(
+        "link_monitor.rtt_metric.suppressed_hysteresis", 1, fbzmq::SUM);
+    return;
+  }
+
+  // Hold back until the adjacency's update interval passed
+  const auto now = std::chrono::steady_clock::now();
+  const auto nextUpdateTime =
+      adjValue.metricUpdateTime + Constants::kRttMetricMinUpdateInterval;
+  if (now < nextUpdateTime) {
+    tData_.addStatValue("link_monitor.rtt_metric.rate_limited", 1, fbzmq::SUM);
+    adjValue.pendingRttUs = rttUs;
+    scheduleRttMetricTimer();
+    return;
+  }
+
+  VLOG(1) << "Metric value changed for neighbor " << adj.otherNodeName
+          << " from " << adj.metric << " to " << newRttMetric;
+  tData_.addStatValue("link_monitor.rtt_metric.updated", 1, fbzmq::SUM);
+  adj.metric = newRttMetric;
+  adj.rtt = rttUs;
+  adjValue.metricUpdateTime = now;
+  scheduleAdvertiseAdjacencies(adjValue.area);
+}
+
+void
+LinkMonitor::scheduleRttMetricTimer() {
+  folly::Optional<std::chrono::steady_clock::time_point> nextUpdateTime;
+  for (auto const& kv : adjacencies_) {
+    if (not kv.second.pendingRttUs) {
+      continue;
+    }
+    const auto updateTime =
+        kv.second.metricUpdateTime + Constants::kRttMetricMinUpdateInterval;
+    nextUpdateTime =
+        nextUpdateTime ? std::min(*nextUpdateTime, updateTime) : updateTime;
+  }
+  if (not nextUpdateTime) {
+    rttMetricTimer_->cancelTimeout();
+    return;
+  }
+  rttMetricTimer_->scheduleTimeout(
+      std::chrono::ceil<std::chrono::milliseconds>(std::max(
+          *nextUpdateTime - std::chrono::steady_clock::now(),
+          std::chrono::steady_clock::duration::zero())));
+}
+
+void
+LinkMonitor::processPendingRttMetrics() {
+  const auto now = std::chrono::steady_clock::now();
+  for (auto& kv : adjacencies_) {
+    auto& adjValue = kv.second;
+    const auto nextUpdateTime =
+        adjValue.metricUpdateTime + Constants::kRttMetricMinUpdateInterval;
+    if (adjValue.pendingRttUs and now >= nextUpdateTime) {
+      updateRttMetric(adjValue, *adjValue.pendingRttUs);
+    }
+  }
+  scheduleRttMetricTimer();
+}
+
 // NOTE: add commands which set/unset overload bit or metric values will
 // immediately advertise new adjacencies into the KvStore.
 folly::SemiFuture<folly::Unit>
@@ -1036,7 +1459,7 @@ LinkMonitor::setInterfaceOverload(
           SYSLOG(INFO) << "Unsetting overload bit for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        scheduleAdvertiseAdjacenciesOnInterface(interfaceName);
         p.setValue();
       });
   return sf;
@@ -1087,7 +1510,7 @@ LinkMonitor::setLinkMetric(
           SYSLOG(INFO) << "Removing metric override for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        scheduleAdvertiseAdjacenciesOnInterface(interfaceName);
         p.setValue();
       });
   return sf;
@@ -1147,7 +1570,7 @@ LinkMonitor::setAdjacencyMetric(
       SYSLOG(INFO) << "Removing metric override for adjacency: [" << adjNodeName
                    << ":" << interfaceName << "]";
     }
-    advertiseAdjacenciesThrottled_->operator()();
+    scheduleAdvertiseAdjacenciesOnInterface(interfaceName);
     p.setValue();
   });
   return sf;
@@ -1255,26 +1678,47 @@ LinkMonitor::submitCounters() {
     counters["link_monitor.metric." + adj.otherNodeName] = adj.metric;
   }
 
+  // Flap penalties of interfaces, and of adjacencies aggregated per
+  // interface. Adjacency penalties which decayed away are forgotten
+  if (flapDampeningConfig_) {
+    for (auto& kv : interfaces_) {
+      const auto penalty = kv.second.getFlapPenalty();
+      counters["link_monitor.flap_penalty." + kv.first] =
+          penalty ? static_cast<int64_t>(*penalty) : 0;
+    }
+    std::unordered_map<std::string, int64_t> adjPenalties;
+    for (auto it = adjDampeners_.begin(); it != adjDampeners_.end();) {
+      const auto penalty = static_cast<int64_t>(it->second.getPenalty());
+      if (penalty == 0 and not dampenedNeighborUps_.count(it->first)) {
+        it = adjDampeners_.erase(it);
+        continue;
+      }
+      adjPenalties[it->first.second] += penalty;
+      ++it;
+    }
+    for (auto const& kv : adjPenalties) {
+      counters["link_monitor.adj_flap_penalty." + kv.first] = kv.second;
+    }
+    counters["link_monitor.suppressed_adjacencies"] =
+        dampenedNeighborUps_.size();
+  }
+
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
 void
 LinkMonitor::logNeighborEvent(thrift::SparkNeighborEvent const& event) {
-  fbzmq::LogSample sample{};
-  sample.addString(
-      "event",
-      apache::thrift::TEnumTraits<thrift::SparkNeighborEventType>::findName(
-          event.eventType));
-  sample.addString("node_name", nodeId_);
-  sample.addString("neighbor", event.neighbor.nodeName);
-  sample.addString("interface", event.ifName);
-  sample.addString("remote_interface", event.neighbor.ifName);
-  sample.addInt("rtt_us", event.rttUs);
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString(
+        "event",
+        apache::thrift::TEnumTraits<thrift::SparkNeighborEventType>::findName(
+            event.eventType));
+    record.addString("node_name", nodeId_);
+    record.addString("neighbor", event.neighbor.nodeName);
+    record.addString("interface", event.ifName);
+    record.addString("remote_interface", event.neighbor.ifName);
+    record.addInt("rtt_us", event.rttUs);
+  });
 }
 
 void
@@ -1288,18 +1732,13 @@ LinkMonitor::logLinkEvent(
     return;
   }
 
-  fbzmq::LogSample sample{};
   const std::string event = isUp ? "UP" : "DOWN";
-
-  sample.addString("event", folly::sformat("IFACE_{}", event));
-  sample.addString("node_name", nodeId_);
-  sample.addString("interface", iface);
-  sample.addInt("backoff_ms", backoffTime.count());
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString("event", isUp ? "IFACE_UP" : "IFACE_DOWN");
+    record.addString("node_name", nodeId_);
+    record.addString("interface", iface);
+    record.addInt("backoff_ms", backoffTime.count());
+  });
 
   SYSLOG(INFO) << "Interface " << iface << " is " << event
                << " and has backoff of " << backoffTime.count() << "ms";
@@ -1310,17 +1749,12 @@ LinkMonitor::logPeerEvent(
     const std::string& event,
     const std::string& peerName,
     const thrift::PeerSpec& peerSpec) {
-  fbzmq::LogSample sample{};
-
-  sample.addString("event", event);
-  sample.addString("node_name", nodeId_);
-  sample.addString("peer_name", peerName);
-  sample.addString("cmd_url", peerSpec.cmdUrl);
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogBuffer::get().log([&](EventLogRecord& record) {
+    record.addString("event", event);
+    record.addString("node_name", nodeId_);
+    record.addString("peer_name", peerName);
+    record.addString("cmd_url", peerSpec.cmdUrl);
+  });
 }
 
 } // namespace openr
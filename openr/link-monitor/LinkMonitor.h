@@ -8,9 +8,13 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqThrottle.h>
@@ -40,6 +44,7 @@
 #include <openr/if/gen-cpp2/PrefixManager_types.h>
 #include <openr/if/gen-cpp2/SystemService.h>
 #include <openr/kvstore/KvStoreClient.h>
+#include <openr/link-monitor/FlapDampener.h>
 #include <openr/link-monitor/InterfaceEntry.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/platform/PlatformPublisher.h>
@@ -55,6 +60,10 @@ struct AdjacencyValue {
   thrift::Adjacency adjacency;
   bool isRestarting{false};
   std::string area{};
+  // time the RTT based metric was last changed, and the RTT whose metric is
+  // held back until the next change is allowed
+  std::chrono::steady_clock::time_point metricUpdateTime{};
+  folly::Optional<int64_t> pendingRttUs;
   AdjacencyValue() {}
   AdjacencyValue(
       thrift::PeerSpec spec,
@@ -130,7 +139,9 @@ class LinkMonitor final : public OpenrEventBase {
       // ttl for a key in the keyvalue store
       std::chrono::milliseconds ttlKeyInKvStore,
       const std::unordered_set<std::string>& areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      // dampen flapping interfaces and adjacencies if set
+      folly::Optional<FlapDampeningConfig> flapDampeningConfig = folly::none);
 
   ~LinkMonitor() override = default;
 
@@ -216,6 +227,14 @@ class LinkMonitor final : public OpenrEventBase {
   // return true if sync is successful
   bool syncInterfaces();
 
+  // Bring interfaceEntry in line with the given link attributes and addresses
+  void syncInterfaceEntry(
+      InterfaceEntry& interfaceEntry,
+      int ifIndex,
+      bool isUp,
+      uint64_t weight,
+      std::unordered_set<folly::CIDRNetwork> const& newNetworks);
+
   // derive current peer-spec info from current adjacencies_
   // calculate delta and announce them to KvStore (peer add/remove) if any
   //
@@ -238,6 +257,15 @@ class LinkMonitor final : public OpenrEventBase {
   // Advertise my adjacencies_ to the KvStore to all areas
   void advertiseAdjacencies();
 
+  // Advertise my adjacencies_ to the areas they changed in since the last
+  // advertisement, i.e. the ones in adjAreasToAdvertise_
+  void advertisePendingAdjacencies();
+
+  // Advertise adjacencies of area, or of the areas of adjacencies on ifName,
+  // in a throttled fashion
+  void scheduleAdvertiseAdjacencies(const std::string& area);
+  void scheduleAdvertiseAdjacenciesOnInterface(const std::string& ifName);
+
   // Advertise interfaces and addresses to Spark/Fib and PrefixManager
   // respectively
   void advertiseIfaceAddr();
@@ -249,6 +277,10 @@ class LinkMonitor final : public OpenrEventBase {
   // return 0 if no more unstable interface
   std::chrono::milliseconds getRetryTimeOnUnstableInterfaces();
 
+  // Apply link/address events received from the platform publisher
+  void processLinkEvent(thrift::LinkEntry const& linkEvt);
+  void processAddrEvent(thrift::AddrEntry const& addrEvt);
+
   // Get or create InterfaceEntry object. Returns nullptr if ifName doesn't
   // qualify regex match
   InterfaceEntry* FOLLY_NULLABLE
@@ -261,6 +293,36 @@ class LinkMonitor final : public OpenrEventBase {
 
   void processNeighborEvent(thrift::SparkNeighborEvent&& event);
 
+  // Process events received together, with a single peer update and
+  // adjacency advertisement per area
+  void processNeighborEvents(std::vector<thrift::SparkNeighborEvent>&& events);
+
+  // Advertise right away, or at the end of the batch of neighbor events being
+  // processed
+  void advertiseKvStorePeersOrDefer(
+      const std::string& area,
+      std::unordered_map<std::string, thrift::PeerSpec> upPeers = {});
+  void advertiseAdjacenciesOrDefer(const std::string& area);
+
+  // Penalize a flap of the adjacency
+  void penalizeNeighborFlap(AdjacencyKey const& adjId);
+
+  // Hold back neighbor up event of a suppressed adjacency until it is reused.
+  // Returns true if held back
+  bool dampenNeighborUp(thrift::SparkNeighborEvent const& event);
+
+  // Bring up held back adjacencies which are no longer suppressed
+  void processDampenedNeighbors();
+
+  // Apply RTT change to the adjacency metric, subject to quantization,
+  // hysteresis and rate limiting
+  void updateRttMetric(AdjacencyValue& adjValue, int64_t rttUs);
+
+  // Apply held back RTT changes which are due, and schedule timer for the
+  // next one
+  void processPendingRttMetrics();
+  void scheduleRttMetricTimer();
+
   // Sumbmits the counter/stats to monitor
   void submitCounters();
 
@@ -318,6 +380,8 @@ class LinkMonitor final : public OpenrEventBase {
   // Backoff timers
   const std::chrono::milliseconds flapInitialBackoff_;
   const std::chrono::milliseconds flapMaxBackoff_;
+  // Flap dampening of interfaces and adjacencies, disabled if none
+  const folly::Optional<FlapDampeningConfig> flapDampeningConfig_;
   // ttl for kvstore
   const std::chrono::milliseconds ttlKeyInKvStore_;
   // Timepoint used to hold off advertisement of link adjancecy on restart.
@@ -338,12 +402,27 @@ class LinkMonitor final : public OpenrEventBase {
   // LinkMonitor config attributes (defined in LinkMonitor.thrift)
   thrift::LinkMonitorConfig config_;
 
+  // config_ as last written to ConfigStore
+  folly::Optional<thrift::LinkMonitorConfig> storedConfig_;
+
   // Queue to publish interface updates to other modules
   messaging::ReplicateQueue<thrift::InterfaceDatabase>& interfaceUpdatesQueue_;
 
+  // Interfaces as last published on interfaceUpdatesQueue_. Updates carry the
+  // difference to them only, except for a full snapshot following each sync
+  // with the platform
+  std::map<std::string, thrift::InterfaceInfo> advertisedInterfaces_;
+  int64_t interfaceDbSeqNum_{0};
+  bool advertiseFullInterfaceDb_{true};
+
   // Queue to publish prefix updates to PrefixManager
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest>& prefixUpdatesQueue_;
 
+  // Redistributed prefixes as last published on prefixUpdatesQueue_. The
+  // first update syncs all of them, later ones carry the changes only
+  folly::Optional<std::map<thrift::IpPrefix, thrift::PrefixEntry>>
+      advertisedRedistPrefixes_;
+
   // Used to subscribe to netlink events from PlatformPublisher
   fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT> nlEventSub_;
 
@@ -356,6 +435,33 @@ class LinkMonitor final : public OpenrEventBase {
   // (we use the "min" interface) for tcp connection
   std::unordered_map<AdjacencyKey, AdjacencyValue> adjacencies_;
 
+  // Advertisements deferred until the batch of neighbor events being
+  // processed is done. Set only while processing one
+  struct NeighborEventBatch {
+    // peers to advertise per area, along with the ones detected up
+    std::unordered_map<
+        std::string /* area */,
+        std::unordered_map<std::string /* node name */, thrift::PeerSpec>>
+        upPeers;
+    // areas to advertise adjacencies of
+    std::unordered_set<std::string> adjAreas;
+  };
+  folly::Optional<NeighborEventBatch> neighborEventBatch_;
+
+  // Perf event of the first neighbor event not advertised yet per area, if
+  // perf measurement is enabled. Starts the perf events of the next
+  // adjacency database advertised
+  std::unordered_map<std::string /* area */, thrift::PerfEvents>
+      neighborPerfEvents_;
+
+  // Previously advertised adjacency databases, without perf events. An
+  // unchanged database is not advertised again
+  std::unordered_map<std::string /* area */, thrift::AdjacencyDatabase>
+      advertisedAdjDbs_;
+
+  // Areas of adjacencies changed since they were last advertised
+  std::unordered_set<std::string> adjAreasToAdvertise_;
+
   // Previously announced KvStore peers
   std::unordered_map<
       std::string /* area */,
@@ -374,6 +480,16 @@ class LinkMonitor final : public OpenrEventBase {
   // Timer for processing interfaces which are in backoff states
   std::unique_ptr<fbzmq::ZmqTimeout> advertiseIfaceAddrTimer_;
 
+  // Flap penalties of adjacencies, and up events of suppressed adjacencies
+  // held back until they can be reused
+  std::unordered_map<AdjacencyKey, FlapDampener> adjDampeners_;
+  std::unordered_map<AdjacencyKey, thrift::SparkNeighborEvent>
+      dampenedNeighborUps_;
+  std::unique_ptr<fbzmq::ZmqTimeout> dampenedNeighborsTimer_;
+
+  // Timer for applying RTT metric changes held back by rate limiting
+  std::unique_ptr<fbzmq::ZmqTimeout> rttMetricTimer_;
+
   // Timer for submitting to monitor periodically
   std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_{nullptr};
 
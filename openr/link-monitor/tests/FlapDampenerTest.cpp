@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/FlapDampener.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+namespace {
+
+FlapDampeningConfig
+getConfig() {
+  FlapDampeningConfig config;
+  config.penaltyPerFlap = 1000;
+  config.suppressThreshold = 2000;
+  config.reuseThreshold = 750;
+  config.halfLife = 10s;
+  config.maxSuppressTime = 30s;
+  return config;
+}
+
+} // namespace
+
+TEST(FlapDampenerTest, SuppressAndReuse) {
+  FlapDampener dampener(getConfig());
+  const auto start = FlapDampener::Clock::now();
+
+  EXPECT_FALSE(dampener.isSuppressed(start));
+  EXPECT_EQ(0, dampener.getPenalty(start));
+  EXPECT_EQ(0ms, dampener.getTimeUntilReuse(start));
+
+  // first flap doesn't suppress
+  EXPECT_FALSE(dampener.recordFlap(start));
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty(start));
+
+  // penalty halves every halfLife
+  EXPECT_NEAR(500, dampener.getPenalty(start + 10s), 1e-6);
+  EXPECT_NEAR(250, dampener.getPenalty(start + 20s), 1e-6);
+
+  // second flap one half life later doesn't reach the threshold either
+  EXPECT_FALSE(dampener.recordFlap(start + 10s));
+  EXPECT_NEAR(1500, dampener.getPenalty(start + 10s), 1e-6);
+
+  // third one does
+  EXPECT_TRUE(dampener.recordFlap(start + 10s));
+  EXPECT_TRUE(dampener.isSuppressed(start + 10s));
+
+  // suppressed until penalty decays from 2500 to 750
+  const auto reuseTime = dampener.getTimeUntilReuse(start + 10s);
+  EXPECT_NEAR(17371, reuseTime.count(), 1);
+  EXPECT_TRUE(dampener.isSuppressed(start + 10s + reuseTime - 10ms));
+  EXPECT_FALSE(dampener.isSuppressed(start + 10s + reuseTime));
+  EXPECT_EQ(0ms, dampener.getTimeUntilReuse(start + 10s + reuseTime));
+
+  // penalty stays below suppress threshold while decaying further, no
+  // suppression until it is reached again
+  EXPECT_FALSE(dampener.isSuppressed(start + 60s));
+}
+
+TEST(FlapDampenerTest, MaxSuppressTime) {
+  FlapDampener dampener(getConfig());
+  const auto now = FlapDampener::Clock::now();
+
+  // penalty is capped so that suppression ends within maxSuppressTime
+  for (int i = 0; i < 100; ++i) {
+    dampener.recordFlap(now);
+  }
+  EXPECT_TRUE(dampener.isSuppressed(now));
+  EXPECT_NEAR(750 * 8, dampener.getPenalty(now), 1e-6);
+  EXPECT_NEAR(30001, dampener.getTimeUntilReuse(now).count(), 1);
+  EXPECT_TRUE(dampener.isSuppressed(now + 30s));
+  EXPECT_FALSE(dampener.isSuppressed(now + 30s + 1ms));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -349,7 +349,15 @@ class LinkMonitorTestFixture : public ::testing::Test {
   recvAndReplyIfUpdate() {
     auto ifDb = interfaceUpdatesReader.get();
     ASSERT_TRUE(ifDb.hasValue());
-    sparkIfDb = std::move(ifDb.value().interfaces);
+    if (not ifDb->isDelta) {
+      sparkIfDb.clear();
+    }
+    for (auto const& ifName : ifDb->deletedInterfaces) {
+      sparkIfDb.erase(ifName);
+    }
+    for (auto& kv : ifDb->interfaces) {
+      sparkIfDb[kv.first] = std::move(kv.second);
+    }
     LOG(INFO) << "----------- Interface Updates ----------";
     for (const auto& kv : sparkIfDb) {
       LOG(INFO) << "  Name=" << kv.first << ", Status=" << kv.second.isUp
@@ -584,7 +592,10 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
                       ),
               },
           },
-          thrift::PerfEvents());
+          thrift::PerfEvents(),
+          false, // isDelta
+          {}, // deletedInterfaces
+          0); // seqNum
       intfDb.perfEvents = folly::none;
     }
 
@@ -983,8 +994,8 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
     // still use iface_2_1 because it's the "min" and will not call addPeers
 
     {
-      // note: adj_2_2 is hashed ahead of adj_2_1
-      auto adjDb = createAdjDatabase("node-1", {adj_2_2, adj_2_1}, kNodeLabel);
+      // note: adjacencies are sorted by neighbor and interface
+      auto adjDb = createAdjDatabase("node-1", {adj_2_1, adj_2_2}, kNodeLabel);
       expectedAdjDbs.push(std::move(adjDb));
     }
 
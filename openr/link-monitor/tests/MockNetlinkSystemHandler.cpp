@@ -64,7 +64,8 @@ MockNetlinkSystemHandler::getAllNeighbors(
           kv.first.first,
           toBinaryAddress(kv.first.second),
           kv.second.getLinkAddress()->toString(),
-          true);
+          true,
+          false);
       neighborDb.push_back(neighborEntry);
     }
   }
@@ -31,6 +31,49 @@ RQueue<ValueType>::getCoro() {
 }
 #endif
 
+template <typename ValueType>
+folly::Expected<std::shared_ptr<const ValueType>, QueueError>
+RQueue<ValueType>::getShared() {
+  return queue_->getShared();
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::shared_ptr<const ValueType>, QueueError>>
+RQueue<ValueType>::getSharedCoro() {
+  auto val = co_await queue_->getSharedCoro();
+  co_return val;
+}
+#endif
+
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RQueue<ValueType>::getBatch(size_t maxItems) {
+  return queue_->getBatch(maxItems);
+}
+
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RQueue<ValueType>::getAllAvailable() {
+  return queue_->getBatch(std::numeric_limits<size_t>::max());
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RQueue<ValueType>::getBatchCoro(size_t maxItems) {
+  auto val = co_await queue_->getBatchCoro(maxItems);
+  co_return val;
+}
+
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RQueue<ValueType>::getAllAvailableCoro() {
+  auto val = co_await queue_->getBatchCoro(std::numeric_limits<size_t>::max());
+  co_return val;
+}
+#endif
+
 template <typename ValueType>
 size_t
 RQueue<ValueType>::size() {
@@ -38,7 +81,18 @@ RQueue<ValueType>::size() {
 }
 
 template <typename ValueType>
-RWQueue<ValueType>::RWQueue() {}
+QueueStats
+RQueue<ValueType>::getStats() {
+  return queue_->getStats();
+}
+
+template <typename ValueType>
+RWQueue<ValueType>::RWQueue(QueueOptions<ValueType> options)
+    : options_(std::move(options)) {
+  assert(
+      options_.overflowPolicy != QueueOverflowPolicy::MERGE or
+      options_.mergeFn);
+}
 
 template <typename ValueType>
 RWQueue<ValueType>::~RWQueue() {
@@ -49,30 +103,227 @@ template <typename ValueType>
 template <typename ValueTypeT>
 bool
 RWQueue<ValueType>::push(ValueTypeT&& val) {
-  std::lock_guard<std::mutex> l(lock_);
+  return pushImpl(StoredValue{
+      std::make_shared<ValueType>(std::forward<ValueTypeT>(val)), false});
+}
 
-  // If queue is closed, don't enqueue
-  if (closed_) {
-    return false;
+template <typename ValueType>
+bool
+RWQueue<ValueType>::pushShared(std::shared_ptr<ValueType> val) {
+  return pushImpl(StoredValue{std::move(val), true});
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::pushImpl(StoredValue val) {
+  while (true) {
+    PendingRead* pendingRead{nullptr};
+    folly::fibers::Baton writeBaton;
+    bool waitForRoom{false};
+    std::shared_ptr<ValueType> dropped;
+    {
+      std::lock_guard<std::mutex> l(lock_);
+
+      // If queue is closed, don't enqueue
+      if (closed_) {
+        return false;
+      }
+
+      if (pendingReads_.size()) {
+        // Hand data over to a pending read
+        pendingRead = &pendingReads_.front().get();
+        pendingReads_.pop_front();
+        pendingRead->value = std::move(val);
+        recordLatency(std::chrono::steady_clock::duration::zero());
+      } else if (not isFull()) {
+        // Add data into the queue
+        queue_.emplace_back(
+            QueueEntry{std::move(val), std::chrono::steady_clock::now()});
+        stats_.highWatermark = std::max(stats_.highWatermark, queue_.size());
+      } else if (options_.overflowPolicy == QueueOverflowPolicy::DROP_OLDEST) {
+        // Released outside of the lock
+        dropped = std::move(queue_.front().value.data);
+        queue_.pop_front();
+        queue_.emplace_back(
+            QueueEntry{std::move(val), std::chrono::steady_clock::now()});
+        ++stats_.numDropped;
+      } else if (options_.overflowPolicy == QueueOverflowPolicy::MERGE) {
+        // Merged value keeps the enqueue time of the queued one
+        mergeIntoBack(*val.data);
+        ++stats_.numMerged;
+      } else {
+        // Wait for a read to make room
+        pendingWrites_.emplace_back(writeBaton);
+        ++stats_.numBlocked;
+        waitForRoom = true;
+      }
+    }
+
+    // Unblock the pending read outside of the lock, waking up the reader is
+    // the expensive part. The read can't complete before it is posted
+    if (pendingRead) {
+      pendingRead->baton.post();
+    }
+
+    if (not waitForRoom) {
+      return true;
+    }
+
+    // Retry once woken up by a read or by close. Another push may have taken
+    // the room in the meantime, in which case we wait again
+    writeBaton.wait();
+  }
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::isFull() const {
+  return options_.capacity > 0 and queue_.size() >= options_.capacity;
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::mergeIntoBack(ValueType const& val) {
+  auto& queued = queue_.back().value;
+  if (queued.shared) {
+    // Other queues of a ReplicateQueue must not see the merge, the merged
+    // copy is owned by this queue
+    queued.data = std::make_shared<ValueType>(*queued.data);
+    queued.shared = false;
   }
+  options_.mergeFn(*queued.data, val);
+}
 
-  if (pendingReads_.size()) {
-    // Unblock a pending read
-    auto& pendingRead = pendingReads_.front().get();
-    pendingRead.data.assign(std::forward<ValueTypeT>(val));
-    pendingRead.baton.post();
-    pendingReads_.pop_front();
+template <typename ValueType>
+void
+RWQueue<ValueType>::recordLatency(std::chrono::steady_clock::duration latency) {
+  if (options_.latencyWindowSize == 0) {
+    return;
+  }
+  const auto latencyUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  if (latencySamplesUs_.size() < options_.latencyWindowSize) {
+    latencySamplesUs_.emplace_back(latencyUs);
   } else {
-    // Add data into the queue
-    queue_.emplace_back(std::forward<ValueTypeT>(val));
+    latencySamplesUs_[nextLatencySample_] = latencyUs;
   }
+  nextLatencySample_ = (nextLatencySample_ + 1) % options_.latencyWindowSize;
+}
 
-  return true;
+template <typename ValueType>
+folly::fibers::Baton*
+RWQueue<ValueType>::takePendingWrite() {
+  if (pendingWrites_.empty()) {
+    return nullptr;
+  }
+  auto pendingWrite = &pendingWrites_.front().get();
+  pendingWrites_.pop_front();
+  return pendingWrite;
 }
 
 template <typename ValueType>
 folly::Expected<ValueType, QueueError>
 RWQueue<ValueType>::get() {
+  auto data = getData();
+  if (data.hasError()) {
+    return folly::makeUnexpected(data.error());
+  }
+  return takeValue(std::move(data).value());
+}
+
+template <typename ValueType>
+folly::Expected<std::shared_ptr<const ValueType>, QueueError>
+RWQueue<ValueType>::getShared() {
+  auto data = getData();
+  if (data.hasError()) {
+    return folly::makeUnexpected(data.error());
+  }
+  return std::shared_ptr<const ValueType>(std::move(data).value().data);
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<ValueType, QueueError>>
+RWQueue<ValueType>::getCoro() {
+  auto data = co_await getDataCoro();
+  if (data.hasError()) {
+    co_return folly::makeUnexpected(data.error());
+  }
+  co_return takeValue(std::move(data).value());
+}
+
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::shared_ptr<const ValueType>, QueueError>>
+RWQueue<ValueType>::getSharedCoro() {
+  auto data = co_await getDataCoro();
+  if (data.hasError()) {
+    co_return folly::makeUnexpected(data.error());
+  }
+  co_return std::shared_ptr<const ValueType>(std::move(data).value().data);
+}
+#endif
+
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RWQueue<ValueType>::getBatch(size_t maxItems) {
+  assert(maxItems > 0);
+  auto data = getData();
+  if (data.hasError()) {
+    return folly::makeUnexpected(data.error());
+  }
+  return makeBatch(std::move(data).value(), maxItems);
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RWQueue<ValueType>::getBatchCoro(size_t maxItems) {
+  assert(maxItems > 0);
+  auto data = co_await getDataCoro();
+  if (data.hasError()) {
+    co_return folly::makeUnexpected(data.error());
+  }
+  co_return makeBatch(std::move(data).value(), maxItems);
+}
+#endif
+
+template <typename ValueType>
+std::vector<ValueType>
+RWQueue<ValueType>::makeBatch(StoredValue first, size_t maxItems) {
+  std::vector<StoredValue> batch;
+  std::vector<folly::fibers::Baton*> pendingWrites;
+  batch.emplace_back(std::move(first));
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    const auto numItems = std::min(queue_.size(), maxItems - 1);
+    const auto now = std::chrono::steady_clock::now();
+    batch.reserve(numItems + 1);
+    for (size_t i = 0; i < numItems; ++i) {
+      recordLatency(now - queue_.front().enqueueTime);
+      batch.emplace_back(std::move(queue_.front().value));
+      queue_.pop_front();
+      if (auto pendingWrite = takePendingWrite()) {
+        pendingWrites.emplace_back(pendingWrite);
+      }
+    }
+  }
+
+  // Wake up writers waiting for the room we made
+  for (auto pendingWrite : pendingWrites) {
+    pendingWrite->post();
+  }
+
+  std::vector<ValueType> values;
+  values.reserve(batch.size());
+  for (auto& value : batch) {
+    values.emplace_back(takeValue(std::move(value)));
+  }
+  return values;
+}
+
+template <typename ValueType>
+folly::Expected<typename RWQueue<ValueType>::StoredValue, QueueError>
+RWQueue<ValueType>::getData() {
   PendingRead pendingRead;
 
   // Queue is closed
@@ -80,25 +331,31 @@ RWQueue<ValueType>::get() {
     return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
   }
 
+  // Wake up a writer waiting for the room we made
+  if (pendingRead.pendingWrite) {
+    pendingRead.pendingWrite->post();
+  }
+
   // Post our own baton if read is immediate (for)
   // XXX: This will evenly distribute elements between readers when queue
   // and also ensures fiber-fairness
-  if (pendingRead.data.hasValue()) {
+  if (pendingRead.value.data) {
     pendingRead.baton.post();
   }
 
   // Wait for baton and read the data
   pendingRead.baton.wait();
-  if (pendingRead.data.hasValue()) {
-    return std::move(pendingRead.data).value();
+  if (pendingRead.value.data) {
+    return std::move(pendingRead.value);
   }
   return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
 }
 
 #if FOLLY_HAS_COROUTINES
 template <typename ValueType>
-folly::coro::Task<folly::Expected<ValueType, QueueError>>
-RWQueue<ValueType>::getCoro() {
+folly::coro::Task<
+    folly::Expected<typename RWQueue<ValueType>::StoredValue, QueueError>>
+RWQueue<ValueType>::getDataCoro() {
   PendingRead pendingRead;
 
   // Queue is closed
@@ -106,15 +363,20 @@ RWQueue<ValueType>::getCoro() {
     co_return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
   }
 
+  // Wake up a writer waiting for the room we made
+  if (pendingRead.pendingWrite) {
+    pendingRead.pendingWrite->post();
+  }
+
   // Wait if there is no data
-  if (pendingRead.data.hasValue()) {
+  if (pendingRead.value.data) {
     pendingRead.baton.post();
   }
 
   // Wait for baton and read the data
   co_await pendingRead.baton;
-  if (pendingRead.data.hasValue()) {
-    co_return std::move(pendingRead.data).value();
+  if (pendingRead.value.data) {
+    co_return std::move(pendingRead.value);
   }
   co_return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
 }
@@ -132,8 +394,11 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
 
   // Perform immediate read if data is available
   if (queue_.size()) {
-    pendingRead.data = std::move(queue_.front());
+    const auto now = std::chrono::steady_clock::now();
+    recordLatency(now - queue_.front().enqueueTime);
+    pendingRead.value = std::move(queue_.front().value);
     queue_.pop_front();
+    pendingRead.pendingWrite = takePendingWrite();
     return true;
   }
 
@@ -142,22 +407,45 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
   return true;
 }
 
+template <typename ValueType>
+ValueType
+RWQueue<ValueType>::takeValue(StoredValue value) {
+  // Readers of other queues may be reading a shared value concurrently,
+  // only values owned by this queue can be moved out
+  if (value.shared) {
+    return *value.data; // Intended copy
+  }
+  return std::move(*value.data);
+}
+
 template <typename ValueType>
 void
 RWQueue<ValueType>::close() {
-  std::lock_guard<std::mutex> l(lock_);
-
-  if (not closed_) {
+  std::deque<std::reference_wrapper<PendingRead>> pendingReads;
+  std::deque<QueueEntry> queue;
+  std::deque<std::reference_wrapper<folly::fibers::Baton>> pendingWrites;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (closed_) {
+      return;
+    }
     closed_ = true;
     // Either one of these must be zero
     assert(pendingReads_.size() == 0 || queue_.size() == 0);
-    // Set empy value to all pending reads
-    while (pendingReads_.size()) {
-      auto& pendingRead = pendingReads_.front().get();
-      pendingRead.baton.post();
-      pendingReads_.pop_front();
-    }
-    queue_.clear();
+    pendingReads.swap(pendingReads_);
+    queue.swap(queue_);
+    pendingWrites.swap(pendingWrites_);
+  }
+
+  // Set empy value to all pending reads, and drop pending data, outside of
+  // the lock
+  for (auto& pendingRead : pendingReads) {
+    pendingRead.get().baton.post();
+  }
+
+  // Blocked writes retry and fail as the queue is closed
+  for (auto& pendingWrite : pendingWrites) {
+    pendingWrite.get().post();
   }
 }
 
@@ -182,5 +470,34 @@ RWQueue<ValueType>::numPendingReads() {
   return pendingReads_.size();
 }
 
+template <typename ValueType>
+QueueStats
+RWQueue<ValueType>::getStats() {
+  QueueStats stats;
+  std::vector<int64_t> latencySamplesUs;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    stats = stats_;
+    stats.depth = queue_.size();
+    latencySamplesUs = latencySamplesUs_;
+  }
+
+  // Percentiles are computed outside of the lock
+  if (latencySamplesUs.size()) {
+    auto percentile = [&latencySamplesUs](size_t pct) {
+      const auto index = (latencySamplesUs.size() - 1) * pct / 100;
+      std::nth_element(
+          latencySamplesUs.begin(),
+          latencySamplesUs.begin() + index,
+          latencySamplesUs.end());
+      return latencySamplesUs[index];
+    };
+    stats.latencyP50Us = percentile(50);
+    stats.latencyP99Us = percentile(99);
+    stats.latencyMaxUs = percentile(100);
+  }
+  return stats;
+}
+
 } // namespace messaging
 } // namespace openr
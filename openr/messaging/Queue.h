@@ -7,11 +7,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <chrono>
 #include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include <folly/Expected.h>
 #include <folly/fibers/Baton.h>
@@ -26,6 +31,55 @@ enum class QueueError {
   QUEUE_CLOSED,
 };
 
+/**
+ * What to do with a push into a queue which reached its capacity
+ */
+enum class QueueOverflowPolicy {
+  // Block the producer until a reader makes room
+  BLOCK,
+  // Drop the oldest queued value to make room for the new one
+  DROP_OLDEST,
+  // Merge the new value into the newest queued one
+  MERGE,
+};
+
+template <typename ValueType>
+struct QueueOptions {
+  // Maximum number of queued values, zero for an unbounded queue
+  size_t capacity{0};
+
+  QueueOverflowPolicy overflowPolicy{QueueOverflowPolicy::BLOCK};
+
+  // Required for MERGE. Merges `pushed` into `queued`, the newest value of
+  // the queue, e.g. RouteDatabaseDeltas per prefix
+  std::function<void(ValueType& queued, ValueType const& pushed)> mergeFn;
+
+  // Number of most recent reads the enqueue to dequeue latency percentiles
+  // are computed over, zero to not track latency
+  size_t latencyWindowSize{1024};
+};
+
+/**
+ * Queue statistics, counted since the queue was created
+ */
+struct QueueStats {
+  // Number of values currently queued
+  size_t depth{0};
+  // Highest number of values ever queued
+  size_t highWatermark{0};
+  // Values dropped by DROP_OLDEST
+  size_t numDropped{0};
+  // Values merged by MERGE
+  size_t numMerged{0};
+  // Pushes which had to wait for room with BLOCK
+  size_t numBlocked{0};
+  // Enqueue to dequeue latency over the most recent reads, zero for values
+  // handed over to a waiting reader
+  int64_t latencyP50Us{0};
+  int64_t latencyP99Us{0};
+  int64_t latencyMaxUs{0};
+};
+
 template <typename ValueType>
 class RWQueue;
 
@@ -51,9 +105,44 @@ class RQueue {
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
 #endif
 
+  /**
+   * Same as above, but return the value as stored in the queue, without
+   * copying it. The value may be shared with other readers of a
+   * ReplicateQueue, hence it is immutable.
+   */
+  folly::Expected<std::shared_ptr<const ValueType>, QueueError> getShared();
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<
+      folly::Expected<std::shared_ptr<const ValueType>, QueueError>>
+  getSharedCoro();
+#endif
+
+  /**
+   * Blocking read of up to maxItems values, waits for the first one only.
+   * Values already queued are taken together, so that consumers can
+   * coalesce work per wake up.
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems);
+
+  // Read all the values queued, waits if there are none
+  folly::Expected<std::vector<ValueType>, QueueError> getAllAvailable();
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(size_t maxItems);
+
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getAllAvailableCoro();
+#endif
+
   // Utility function to retrieve size of pending data in underlying queue
   size_t size();
 
+  // Statistics of the underlying queue
+  QueueStats getStats();
+
  protected:
   // We only hold reference of above queue
   std::shared_ptr<RWQueue<ValueType>> queue_{nullptr};
@@ -69,20 +158,34 @@ class RQueue {
  *
  * After closing queue, all subsequent push are ignored and return false. All
  * subsequent reads return QUEUE_CLOSED error
+ *
+ * Queue is unbounded unless a capacity is set in QueueOptions, in which case
+ * the overflow policy decides what happens to a push into a full queue. With
+ * BLOCK the producer is suspended until a read makes room or the queue gets
+ * closed, hence someone must keep reading.
  */
 template <typename ValueType>
 class RWQueue {
  public:
-  RWQueue();
+  explicit RWQueue(
+      QueueOptions<ValueType> options = QueueOptions<ValueType>());
   ~RWQueue();
 
   /**
-   * Non blocking push. Any typed value can be pushed!
+   * Non blocking push, unless the queue is full and its overflow policy is
+   * BLOCK. Any typed value can be pushed!
    * Return true/false!!
    */
   template <typename ValueTypeT>
   bool push(ValueTypeT&& val);
 
+  /**
+   * Push of a value which may be shared with other queues, e.g.
+   * by ReplicateQueue. The value is stored once for all of them and never
+   * modified, readers get a copy of it unless they read it with getShared().
+   */
+  bool pushShared(std::shared_ptr<ValueType> val);
+
   /**
    * Blocking read for native threads/fibers. In-case of fibers, the fiber
    * performing blocking read will be suspended.
@@ -96,6 +199,29 @@ class RWQueue {
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
 #endif
 
+  /**
+   * Read the value as stored in the queue, without copying it
+   */
+  folly::Expected<std::shared_ptr<const ValueType>, QueueError> getShared();
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<
+      folly::Expected<std::shared_ptr<const ValueType>, QueueError>>
+  getSharedCoro();
+#endif
+
+  /**
+   * Read up to maxItems values, waiting for the first one only. Values
+   * already queued are taken with a single lock acquisition
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems);
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(size_t maxItems);
+#endif
+
   /**
    * Close the queue. All new push will be ignored and pending data will be lost
    */
@@ -112,17 +238,85 @@ class RWQueue {
    */
   size_t numPendingReads();
 
+  /**
+   * Return depth, high-watermark and overflow counters of the queue
+   */
+  QueueStats getStats();
+
  private:
+  // Value as stored in the queue. Shared values may be referenced by other
+  // queues, hence are copied when read. Others are owned by this queue and
+  // moved out
+  struct StoredValue {
+    std::shared_ptr<ValueType> data;
+    bool shared{false};
+  };
+
   struct PendingRead {
     folly::fibers::Baton baton;
-    folly::Optional<ValueType> data;
+    StoredValue value;
+    // Blocked write to be woken up as the read made room
+    folly::fibers::Baton* pendingWrite{nullptr};
+  };
+
+  // Queued value along with the time it got pushed
+  struct QueueEntry {
+    StoredValue value;
+    std::chrono::steady_clock::time_point enqueueTime;
   };
 
   /**
-   * Implementation for push
+   * Implementation for push and pushShared
+   */
+  bool pushImpl(StoredValue val);
+
+  /**
+   * Add an enqueue to dequeue latency sample
+   */
+  void recordLatency(std::chrono::steady_clock::duration latency);
+
+  /**
+   * Whether a push has to apply the overflow policy
+   */
+  bool isFull() const;
+
+  /**
+   * Merge a value into the newest queued one, which is copied first if it
+   * was pushed shared with other queues
+   */
+  void mergeIntoBack(ValueType const& val);
+
+  /**
+   * Take the oldest blocked write, if any, to wake it up after a read
+   */
+  folly::fibers::Baton* takePendingWrite();
+
+  /**
+   * Implementation for get
    */
   bool getAnyImpl(PendingRead& pendingRead);
 
+  /**
+   * Blocking read of the stored value, shared by all get methods
+   */
+  folly::Expected<StoredValue, QueueError> getData();
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<folly::Expected<StoredValue, QueueError>> getDataCoro();
+#endif
+
+  /**
+   * Append first and up to maxItems - 1 more queued values to a batch
+   */
+  std::vector<ValueType> makeBatch(StoredValue first, size_t maxItems);
+
+  /**
+   * Value of a read element, moved out unless it is shared
+   */
+  static ValueType takeValue(StoredValue value);
+
+  QueueOptions<ValueType> const options_;
+
   // Lock to protect below private variables
   std::mutex lock_;
 
@@ -132,8 +326,18 @@ class RWQueue {
   // Pending reads - readers are actively waiting for data
   std::deque<std::reference_wrapper<PendingRead>> pendingReads_;
 
-  // Pending data
-  std::deque<ValueType> queue_;
+  // Pending data, possibly shared with other queues
+  std::deque<QueueEntry> queue_;
+
+  // Pending writes - writers waiting for room in a full queue
+  std::deque<std::reference_wrapper<folly::fibers::Baton>> pendingWrites_;
+
+  // Statistics, depth and latency are filled in when read
+  QueueStats stats_;
+
+  // Ring buffer of the most recent latencies in microseconds
+  std::vector<int64_t> latencySamplesUs_;
+  size_t nextLatencySample_{0};
 };
 
 } // namespace messaging
@@ -11,14 +11,20 @@ namespace openr {
 namespace messaging {
 
 template <typename ValueType>
-ReplicateQueue<ValueType>::ReplicateQueue() {}
+ReplicateQueue<ValueType>::ReplicateQueue(QueueOptions<ValueType> options)
+    : options_(std::move(options)) {}
+
+template <typename ValueType>
+ReplicateQueue<ValueType>::ReplicateQueue(
+    std::string name, QueueOptions<ValueType> options)
+    : name_(std::move(name)), options_(std::move(options)) {}
 
 template <typename ValueType>
 ReplicateQueue<ValueType>::~ReplicateQueue() {
   auto lockedReaders = readers_.wlock();
   // Close all queues
   for (auto& reader : *lockedReaders) {
-    reader->close();
+    reader.queue->close();
   }
   lockedReaders->clear();
 }
@@ -36,23 +42,27 @@ ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
       return false;
     }
     for (auto it = lockedReaders->begin(); it != lockedReaders->end();) {
-      if (it->use_count() == 1) {
-        (*it)->close(); // Close before erasing
+      if (it->queue.use_count() == 1) {
+        it->queue->close(); // Close before erasing
         it = lockedReaders->erase(it);
       } else {
-        readers.emplace_back(*it); // NOTE: intentionally copying shared_ptr
+        readers.emplace_back(it->queue); // NOTE: intentionally copying
         ++it;
       }
     }
   }
 
-  // Replicate messages
-  if (readers.size()) {
+  // Replicate messages. A single reader owns the value, otherwise all readers
+  // share a single copy of it, which is copied when read unless read with
+  // getShared()
+  if (readers.size() == 1) {
+    readers.front()->push(std::forward<ValueTypeT>(value));
+  } else if (readers.size()) {
+    auto data = std::make_shared<ValueType>(std::forward<ValueTypeT>(value));
     for (int i = 0; i < readers.size() - 1; i++) {
-      readers.at(i)->push(ValueType(value)); // Intended copy
+      readers.at(i)->pushShared(data);
     }
-    // Perfect forwarding for last reader
-    readers.back()->push(std::forward<ValueTypeT>(value));
+    readers.back()->pushShared(std::move(data));
   }
 
   return true;
@@ -64,13 +74,16 @@ ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
  */
 template <typename ValueType>
 RQueue<ValueType>
-ReplicateQueue<ValueType>::getReader() {
+ReplicateQueue<ValueType>::getReader(std::string const& readerName) {
   auto lockedReaders = readers_.wlock();
   if (closed_) {
     throw std::runtime_error("queue is closed");
   }
-  lockedReaders->emplace_back(std::make_shared<RWQueue<ValueType>>());
-  return RQueue<ValueType>(lockedReaders->back());
+  const auto readerId = numReadersCreated_++;
+  lockedReaders->emplace_back(Reader{
+      readerName.empty() ? "reader" + std::to_string(readerId) : readerName,
+      std::make_shared<RWQueue<ValueType>>(options_)});
+  return RQueue<ValueType>(lockedReaders->back().queue);
 }
 
 template <typename ValueType>
@@ -78,8 +91,8 @@ size_t
 ReplicateQueue<ValueType>::getNumReaders() {
   auto lockedReaders = readers_.wlock();
   for (auto it = lockedReaders->begin(); it != lockedReaders->end();) {
-    if (it->use_count() == 1) {
-      (*it)->close(); // Close before erasing
+    if (it->queue.use_count() == 1) {
+      it->queue->close(); // Close before erasing
       it = lockedReaders->erase(it);
     } else {
       ++it;
@@ -88,13 +101,51 @@ ReplicateQueue<ValueType>::getNumReaders() {
   return lockedReaders->size();
 }
 
+template <typename ValueType>
+std::map<std::string, QueueStats>
+ReplicateQueue<ValueType>::getReaderStats() {
+  std::vector<Reader> readers;
+  {
+    auto lockedReaders = readers_.rlock();
+    readers.assign(lockedReaders->begin(), lockedReaders->end());
+  }
+
+  std::map<std::string, QueueStats> stats;
+  for (auto& reader : readers) {
+    stats.emplace(reader.name, reader.queue->getStats());
+  }
+  return stats;
+}
+
+template <typename ValueType>
+std::unordered_map<std::string, int64_t>
+ReplicateQueue<ValueType>::getCounters() {
+  std::unordered_map<std::string, int64_t> counters;
+  const auto queuePrefix = "messaging." + name_;
+  const auto readerStats = getReaderStats();
+  counters[queuePrefix + ".num_readers"] = readerStats.size();
+  for (auto const& kv : readerStats) {
+    auto const& stats = kv.second;
+    const auto prefix = queuePrefix + "." + kv.first;
+    counters[prefix + ".depth"] = stats.depth;
+    counters[prefix + ".high_watermark"] = stats.highWatermark;
+    counters[prefix + ".dropped"] = stats.numDropped;
+    counters[prefix + ".merged"] = stats.numMerged;
+    counters[prefix + ".blocked"] = stats.numBlocked;
+    counters[prefix + ".latency_us.p50"] = stats.latencyP50Us;
+    counters[prefix + ".latency_us.p99"] = stats.latencyP99Us;
+    counters[prefix + ".latency_us.max"] = stats.latencyMaxUs;
+  }
+  return counters;
+}
+
 template <typename ValueType>
 void
 ReplicateQueue<ValueType>::close() {
   auto lockedReaders = readers_.wlock();
   closed_ = true;
-  for (auto& queue : *lockedReaders) {
-    queue->close();
+  for (auto& reader : *lockedReaders) {
+    reader.queue->close();
   }
   lockedReaders->clear();
 }
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <map>
+#include <string>
+#include <unordered_map>
+
 #include <openr/messaging/Queue.h>
 
 namespace openr {
@@ -14,15 +18,29 @@ namespace messaging {
 
 /**
  * Multiple writers and readers. Each reader gets every written element push by
- * every writer. Writer pays the cost of replicating data to all readers. If no
- * reader exists then all the messages are silently dropped.
+ * every writer. Pushed elements are stored once and shared by the queues of
+ * all readers, each reader gets its own copy when reading it unless there is
+ * a single reader, which owns the stored element. Readers which don't need
+ * ownership can read the shared element itself with getShared(), at no copy.
+ * If no reader exists then all the messages are silently dropped.
+ *
+ * Queue options, e.g. capacity and overflow policy, apply to the queue of
+ * every reader individually. With BLOCK a push waits for the slowest reader.
+ *
+ * Named queues export depth, overflow and latency counters of every reader,
+ * e.g. "messaging.route_updates.fib.depth".
  *
  * Pushed object must be copy constructible.
  */
 template <typename ValueType>
 class ReplicateQueue {
  public:
-  ReplicateQueue();
+  explicit ReplicateQueue(
+      QueueOptions<ValueType> options = QueueOptions<ValueType>());
+
+  explicit ReplicateQueue(
+      std::string name,
+      QueueOptions<ValueType> options = QueueOptions<ValueType>());
 
   ~ReplicateQueue();
 
@@ -47,23 +65,44 @@ class ReplicateQueue {
 
   /**
    * Get new reader stream of this queue. Stream will get closed automatically
-   * when reader is destructed.
+   * when reader is destructed. Reader name identifies it in the counters,
+   * readers without one are numbered.
    */
-  RQueue<ValueType> getReader();
+  RQueue<ValueType> getReader(std::string const& readerName = "");
 
   /**
    * Number of replicated streams/readers
    */
   size_t getNumReaders();
 
+  /**
+   * Statistics of the queue of every reader, by reader name
+   */
+  std::map<std::string, QueueStats> getReaderStats();
+
+  /**
+   * Counters of the queue of every reader, prefixed by the queue name
+   */
+  std::unordered_map<std::string, int64_t> getCounters();
+
   /**
    * Close the underlying queue. All subsequent writes and reads will fails.
    */
   void close();
 
  private:
-  folly::Synchronized<std::list<std::shared_ptr<RWQueue<ValueType>>>> readers_;
+  struct Reader {
+    std::string name;
+    std::shared_ptr<RWQueue<ValueType>> queue;
+  };
+
+  std::string name_;
+
+  QueueOptions<ValueType> options_;
+
+  folly::Synchronized<std::list<Reader>> readers_;
   bool closed_{false}; // Protected by above Synchronized lock
+  size_t numReadersCreated_{0}; // Protected by above Synchronized lock
 };
 
 } // namespace messaging
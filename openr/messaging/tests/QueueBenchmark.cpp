@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/init/Init.h>
+
+#include <openr/messaging/Queue.h>
+#include <openr/messaging/ReplicateQueue.h>
+
+namespace {
+
+// Value passed around, shared_ptr as stored by RWQueue
+using Value = std::shared_ptr<int64_t>;
+
+} // namespace
+
+namespace openr {
+
+// Push iters values from numProducers threads, read all of them from a
+// single consumer thread. Queue types are interchangeable through push/pop
+template <typename PushFn, typename PopFn>
+void
+runProducersConsumer(
+    uint32_t iters, size_t numProducers, PushFn push, PopFn pop) {
+  std::vector<std::thread> producers;
+  for (size_t i = 0; i < numProducers; ++i) {
+    const auto numValues =
+        iters / numProducers + (i < iters % numProducers ? 1 : 0);
+    producers.emplace_back([numValues, &push]() {
+      for (uint32_t j = 0; j < numValues; ++j) {
+        push(std::make_shared<int64_t>(j));
+      }
+    });
+  }
+
+  std::thread consumer([iters, &pop]() {
+    for (uint32_t i = 0; i < iters; ++i) {
+      folly::doNotOptimizeAway(pop());
+    }
+  });
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  consumer.join();
+}
+
+void
+BM_RWQueue(uint32_t iters, size_t numProducers) {
+  messaging::RWQueue<int64_t> q;
+  runProducersConsumer(
+      iters,
+      numProducers,
+      [&q](Value value) { q.pushShared(std::move(value)); },
+      [&q]() { return q.get().value(); });
+}
+
+void
+BM_ReplicateQueue(uint32_t iters, size_t numProducers) {
+  messaging::ReplicateQueue<int64_t> q;
+  auto reader = q.getReader();
+  runProducersConsumer(
+      iters,
+      numProducers,
+      [&q](Value value) { q.push(std::move(*value)); },
+      [&reader]() { return reader.get().value(); });
+}
+
+// Lock-free reference, consumer blocks its thread while waiting and can't be
+// a fiber
+void
+BM_UnboundedQueue(uint32_t iters, size_t numProducers) {
+  folly::UMPSCQueue<Value, true /* MayBlock */> q;
+  runProducersConsumer(
+      iters,
+      numProducers,
+      [&q](Value value) { q.enqueue(std::move(value)); },
+      [&q]() {
+        Value value;
+        q.dequeue(value);
+        return *value;
+      });
+}
+
+// The parameter is the number of producer threads
+BENCHMARK_PARAM(BM_RWQueue, 1);
+BENCHMARK_RELATIVE_PARAM(BM_ReplicateQueue, 1);
+BENCHMARK_RELATIVE_PARAM(BM_UnboundedQueue, 1);
+BENCHMARK_PARAM(BM_RWQueue, 2);
+BENCHMARK_RELATIVE_PARAM(BM_ReplicateQueue, 2);
+BENCHMARK_RELATIVE_PARAM(BM_UnboundedQueue, 2);
+BENCHMARK_PARAM(BM_RWQueue, 4);
+BENCHMARK_RELATIVE_PARAM(BM_ReplicateQueue, 4);
+BENCHMARK_RELATIVE_PARAM(BM_UnboundedQueue, 4);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
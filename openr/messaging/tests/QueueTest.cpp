@@ -68,6 +68,45 @@ TEST(RWQueueTest, OrderedPushGet) {
   EXPECT_EQ(0, q.size());
 }
 
+TEST(RWQueueTest, BatchGet) {
+  RWQueue<int> q;
+
+  for (int i = 0; i < 5; ++i) {
+    q.push(i);
+  }
+
+  // Up to maxItems values
+  auto batch = q.getBatch(2);
+  ASSERT_TRUE(batch.hasValue());
+  EXPECT_EQ(std::vector<int>({0, 1}), batch.value());
+  EXPECT_EQ(3, q.size());
+
+  // Whatever is available
+  batch = q.getBatch(10);
+  ASSERT_TRUE(batch.hasValue());
+  EXPECT_EQ(std::vector<int>({2, 3, 4}), batch.value());
+  EXPECT_EQ(0, q.size());
+
+  // Wait for the first value, then take the ones pushed along with it
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable {
+    auto batch = q.getBatch(10);
+    ASSERT_TRUE(batch.hasValue());
+    EXPECT_EQ(std::vector<int>({5, 6}), batch.value());
+  });
+  evb.loopOnce();
+  EXPECT_EQ(1, q.numPendingReads());
+  q.push(5);
+  q.push(6);
+  evb.loopOnce();
+  EXPECT_EQ(0, q.numPendingReads());
+  EXPECT_EQ(0, q.size());
+
+  q.close();
+  EXPECT_TRUE(q.getBatch(10).hasError());
+}
+
 TEST(RWQueueTest, ClosedPendingReads) {
   RWQueue<int> q;
 
@@ -118,6 +157,108 @@ TEST(RWQueueTest, ClosedReads) {
   EXPECT_EQ(0, q.numPendingReads()); // Request doesn't gets queued in
 }
 
+TEST(RWQueueTest, BoundedDropOldest) {
+  QueueOptions<int> options;
+  options.capacity = 2;
+  options.overflowPolicy = QueueOverflowPolicy::DROP_OLDEST;
+  RWQueue<int> q(options);
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(q.push(i));
+  }
+  EXPECT_EQ(2, q.size());
+
+  auto stats = q.getStats();
+  EXPECT_EQ(2, stats.depth);
+  EXPECT_EQ(2, stats.highWatermark);
+  EXPECT_EQ(3, stats.numDropped);
+  EXPECT_EQ(0, stats.numMerged);
+
+  // Newest values are kept
+  EXPECT_EQ(3, q.get().value());
+  EXPECT_EQ(4, q.get().value());
+  EXPECT_EQ(0, q.getStats().depth);
+  EXPECT_EQ(2, q.getStats().highWatermark);
+}
+
+TEST(RWQueueTest, BoundedMerge) {
+  QueueOptions<std::vector<int>> options;
+  options.capacity = 1;
+  options.overflowPolicy = QueueOverflowPolicy::MERGE;
+  options.mergeFn = [](std::vector<int>& queued,
+                       std::vector<int> const& pushed) {
+    queued.insert(queued.end(), pushed.begin(), pushed.end());
+  };
+  RWQueue<std::vector<int>> q(options);
+
+  q.push(std::vector<int>{1});
+  q.push(std::vector<int>{2});
+  q.push(std::vector<int>{3, 4});
+  EXPECT_EQ(1, q.size());
+  EXPECT_EQ(2, q.getStats().numMerged);
+  EXPECT_EQ(0, q.getStats().numDropped);
+
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), q.get().value());
+}
+
+TEST(RWQueueTest, BoundedBlock) {
+  QueueOptions<int> options;
+  options.capacity = 2;
+  RWQueue<int> q(options);
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable {
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(q.push(i));
+    }
+  });
+
+  evb.loopOnce(); // Writer should get stuck at the third push
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(1, q.getStats().numBlocked);
+
+  // Every read makes room for one more push
+  EXPECT_EQ(0, q.get().value());
+  evb.loopOnce();
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(2, q.getStats().numBlocked);
+
+  auto batch = q.getBatch(2);
+  ASSERT_TRUE(batch.hasValue());
+  EXPECT_EQ(std::vector<int>({1, 2}), batch.value());
+  evb.loopOnce();
+  EXPECT_EQ(1, q.size());
+  EXPECT_EQ(3, q.get().value());
+
+  auto stats = q.getStats();
+  EXPECT_EQ(0, stats.depth);
+  EXPECT_EQ(2, stats.highWatermark);
+  EXPECT_EQ(0, stats.numDropped);
+}
+
+TEST(RWQueueTest, BoundedBlockClosed) {
+  QueueOptions<int> options;
+  options.capacity = 1;
+  RWQueue<int> q(options);
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable {
+    EXPECT_TRUE(q.push(1));
+    EXPECT_FALSE(q.push(2)); // Fails once the queue is closed
+  });
+
+  evb.loopOnce(); // Writer should get stuck at the second push
+  EXPECT_EQ(1, q.size());
+
+  q.close();
+  evb.loopOnce();
+  EXPECT_TRUE(q.isClosed());
+  EXPECT_EQ(0, q.size());
+  EXPECT_FALSE(manager.hasTasks());
+}
+
 TEST(RWQueueTest, MultipleReadersWriters) {
   const size_t kNumReaders{16};
   const size_t kNumWriters{16};
@@ -300,6 +441,10 @@ TEST(RQueueTest, ReadTest) {
   EXPECT_EQ(1, rq.get().value());
   EXPECT_EQ(2, rq.get().value());
 
+  rwq->push(3);
+  rwq->push(4);
+  EXPECT_EQ(std::vector<int>({3, 4}), rq.getAllAvailable().value());
+
 #if FOLLY_HAS_COROUTINES
   auto coroRead = [](RQueue<int>& rq, int expected) -> folly::coro::Task<void> {
     LOG(INFO) << "Performing coro read";
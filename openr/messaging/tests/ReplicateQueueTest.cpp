@@ -5,6 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <folly/fibers/EventBaseLoopController.h>
@@ -66,3 +71,173 @@ TEST(ReplicateQueueTest, Test) {
 
   EXPECT_EQ(kTotalWrites * kNumReaders, totalReads);
 }
+
+namespace {
+
+// Counts the copies made of it
+struct CopyCounter {
+  explicit CopyCounter(std::string data) : data(std::move(data)) {}
+  CopyCounter(const CopyCounter& other) : data(other.data) {
+    ++numCopies;
+  }
+  CopyCounter(CopyCounter&& other) = default;
+
+  std::string data;
+  static size_t numCopies;
+};
+
+size_t CopyCounter::numCopies{0};
+
+} // anonymous namespace
+
+TEST(ReplicateQueueTest, SharedValueTest) {
+  const size_t kNumReaders{4};
+
+  ReplicateQueue<CopyCounter> q;
+  std::vector<RQueue<CopyCounter>> readers;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back(q.getReader());
+  }
+
+  // Pushed value is stored once for all readers
+  q.push(CopyCounter(std::string(1024, 'a')));
+  EXPECT_EQ(0, CopyCounter::numCopies);
+  for (auto& reader : readers) {
+    EXPECT_EQ(1, reader.size());
+  }
+
+  // Every reader gets a copy of it, the others may still be reading it
+  for (auto& reader : readers) {
+    auto value = reader.get();
+    ASSERT_TRUE(value.hasValue());
+    EXPECT_EQ(std::string(1024, 'a'), value->data);
+  }
+  EXPECT_EQ(kNumReaders, CopyCounter::numCopies);
+}
+
+TEST(ReplicateQueueTest, SingleReaderTest) {
+  CopyCounter::numCopies = 0;
+
+  ReplicateQueue<CopyCounter> q;
+  auto reader = q.getReader();
+
+  // Single reader owns the pushed value, it is moved out when read
+  q.push(CopyCounter(std::string(1024, 'a')));
+  auto value = reader.get();
+  ASSERT_TRUE(value.hasValue());
+  EXPECT_EQ(std::string(1024, 'a'), value->data);
+  EXPECT_EQ(0, CopyCounter::numCopies);
+}
+
+TEST(ReplicateQueueTest, GetSharedTest) {
+  const size_t kNumReaders{4};
+  CopyCounter::numCopies = 0;
+
+  ReplicateQueue<CopyCounter> q;
+  std::vector<RQueue<CopyCounter>> readers;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back(q.getReader());
+  }
+  q.push(CopyCounter(std::string(1024, 'a')));
+
+  // Shared reads get the stored value itself
+  std::vector<std::shared_ptr<const CopyCounter>> values;
+  for (size_t i = 0; i < kNumReaders - 1; ++i) {
+    auto value = readers.at(i).getShared();
+    ASSERT_TRUE(value.hasValue());
+    EXPECT_EQ(std::string(1024, 'a'), (*value)->data);
+    if (not values.empty()) {
+      EXPECT_EQ(values.back().get(), value->get());
+    }
+    values.emplace_back(std::move(value).value());
+  }
+  EXPECT_EQ(0, CopyCounter::numCopies);
+
+  // Owning read copies it while shared readers still reference it
+  auto value = readers.back().get();
+  ASSERT_TRUE(value.hasValue());
+  EXPECT_EQ(std::string(1024, 'a'), value->data);
+  EXPECT_EQ(1, CopyCounter::numCopies);
+  EXPECT_EQ(std::string(1024, 'a'), values.front()->data);
+
+  // Closed queue
+  q.close();
+  EXPECT_TRUE(readers.front().getShared().hasError());
+}
+
+TEST(ReplicateQueueTest, BoundedMergeTest) {
+  QueueOptions<std::string> options;
+  options.capacity = 1;
+  options.overflowPolicy = QueueOverflowPolicy::MERGE;
+  options.mergeFn = [](std::string& queued, std::string const& pushed) {
+    queued += pushed;
+  };
+  ReplicateQueue<std::string> q(options);
+  auto reader1 = q.getReader();
+  auto reader2 = q.getReader();
+
+  // Value shared by both readers is merged once into each of them
+  q.push(std::string("a"));
+  q.push(std::string("b"));
+  EXPECT_EQ(1, reader1.size());
+  EXPECT_EQ(1, reader2.size());
+  EXPECT_EQ("ab", reader1.get().value());
+  EXPECT_EQ("ab", reader2.get().value());
+
+  auto stats = q.getReaderStats();
+  ASSERT_EQ(2, stats.size());
+  EXPECT_EQ(1, stats.at("reader0").numMerged);
+  EXPECT_EQ(1, stats.at("reader1").numMerged);
+  EXPECT_EQ(1, stats.at("reader0").highWatermark);
+  EXPECT_EQ(1, stats.at("reader1").highWatermark);
+
+  // Merge into the queue of one reader doesn't modify the value read by the
+  // other one
+  q.push(std::string("c"));
+  auto shared = reader1.getShared();
+  ASSERT_TRUE(shared.hasValue());
+  q.push(std::string("d"));
+  EXPECT_EQ("c", **shared);
+  EXPECT_EQ("d", reader1.get().value());
+  EXPECT_EQ("cd", reader2.get().value());
+}
+
+TEST(ReplicateQueueTest, CountersTest) {
+  ReplicateQueue<int> q("test_updates");
+  auto fastReader = q.getReader("fast");
+  auto slowReader = q.getReader("slow");
+
+  q.push(1);
+  EXPECT_EQ(1, fastReader.get().value());
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  q.push(2);
+  EXPECT_EQ(2, fastReader.get().value());
+
+  // Per reader depth and latency
+  auto counters = q.getCounters();
+  EXPECT_EQ(2, counters.at("messaging.test_updates.num_readers"));
+  EXPECT_EQ(0, counters.at("messaging.test_updates.fast.depth"));
+  EXPECT_EQ(2, counters.at("messaging.test_updates.slow.depth"));
+  EXPECT_EQ(1, counters.at("messaging.test_updates.fast.high_watermark"));
+  EXPECT_EQ(2, counters.at("messaging.test_updates.slow.high_watermark"));
+  EXPECT_EQ(0, counters.at("messaging.test_updates.slow.dropped"));
+  EXPECT_EQ(0, counters.at("messaging.test_updates.slow.latency_us.max"));
+
+  EXPECT_EQ(1, slowReader.get().value());
+  EXPECT_EQ(2, slowReader.get().value());
+  counters = q.getCounters();
+  EXPECT_EQ(0, counters.at("messaging.test_updates.slow.depth"));
+  EXPECT_LE(10000, counters.at("messaging.test_updates.slow.latency_us.max"));
+  EXPECT_GT(
+      counters.at("messaging.test_updates.slow.latency_us.max"),
+      counters.at("messaging.test_updates.fast.latency_us.max"));
+
+  // Readers which are gone are no longer reported
+  {
+    auto reader = q.getReader();
+    EXPECT_EQ(3, q.getCounters().at("messaging.test_updates.num_readers"));
+    EXPECT_EQ(1, q.getCounters().count("messaging.test_updates.reader2.depth"));
+  }
+  EXPECT_EQ(2, q.getNumReaders());
+  EXPECT_EQ(0, q.getCounters().count("messaging.test_updates.reader2.depth"));
+}
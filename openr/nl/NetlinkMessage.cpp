@@ -5,12 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include <arpa/inet.h>
+#include <linux/filter.h>
+
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
 #include <folly/system/ThreadName.h>
 
+#include "openr/if/gen-cpp2/Platform_constants.h"
 #include "openr/nl/NetlinkRoute.h"
 #include "openr/nl/NetlinkSocket.h"
 
@@ -18,13 +24,76 @@ namespace openr::fbnl {
 
 uint32_t gSequenceNumber{0};
 
+namespace {
+
+// max number of route event protocols the socket filter checks
+constexpr uint32_t kMaxFilterProtocols{64};
+
+// Freed message buffers, shared by the threads building and sending
+// requests
+class NetlinkMessagePool {
+ public:
+  void*
+  allocate() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!buffers_.empty()) {
+        auto* buffer = buffers_.back();
+        buffers_.pop_back();
+        return buffer;
+      }
+    }
+    return ::operator new(NetlinkMessage::kPoolBlockSize);
+  }
+
+  void
+  release(void* buffer) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (buffers_.size() < kNlMessagePoolSize) {
+        buffers_.emplace_back(buffer);
+        return;
+      }
+    }
+    ::operator delete(buffer);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<void*> buffers_;
+};
+
+NetlinkMessagePool&
+getMessagePool() {
+  // never destroyed, messages may be freed during static destruction
+  static auto* pool = new NetlinkMessagePool();
+  return *pool;
+}
+
+} // anonymous namespace
+
+void*
+NetlinkMessage::operator new(size_t size) {
+  if (size > kPoolBlockSize) {
+    return ::operator new(size);
+  }
+  return getMessagePool().allocate();
+}
+
+void
+NetlinkMessage::operator delete(void* ptr, size_t size) {
+  if (size > kPoolBlockSize) {
+    ::operator delete(ptr);
+    return;
+  }
+  getMessagePool().release(ptr);
+}
+
 NetlinkMessage::NetlinkMessage()
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
-      promise_(std::make_unique<folly::Promise<int>>()) {}
+    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())) {}
 
 NetlinkMessage::NetlinkMessage(int type)
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
-      promise_(std::make_unique<folly::Promise<int>>()) {
+    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())) {
   // initialize netlink header
   msghdr->nlmsg_len = NLMSG_LENGTH(0);
   msghdr->nlmsg_type = type;
@@ -102,12 +171,24 @@ NetlinkMessage::addAttributes(
 
 folly::Future<int>
 NetlinkMessage::getFuture() {
+  if (!promise_) {
+    promise_ = std::make_unique<folly::Promise<int>>();
+  }
   return promise_->getFuture();
 }
 
+void
+NetlinkMessage::setCompletionCallback(folly::Function<void(int)> callback) {
+  completionCallback_ = std::move(callback);
+}
+
 void
 NetlinkMessage::setReturnStatus(int status) {
-  promise_->setValue(status);
+  if (completionCallback_) {
+    completionCallback_(status);
+  } else if (promise_) {
+    promise_->setValue(status);
+  }
 }
 
 // get Message Type
@@ -122,19 +203,48 @@ NetlinkMessage::setMessageType(NetlinkMessage::MessageType type) {
   messageType_ = type;
 }
 
-NetlinkProtocolSocket::NetlinkProtocolSocket(fbzmq::ZmqEventLoop* evl)
-    : evl_(evl) {
+std::vector<uint8_t>
+getPlatformRouteProtocols() {
+  std::vector<uint8_t> protocols;
+  for (auto const& kv : thrift::Platform_constants::clientIdtoProtocolId()) {
+    protocols.emplace_back(kv.second);
+  }
+  return protocols;
+}
+
+NetlinkProtocolSocket::NetlinkProtocolSocket(
+    fbzmq::ZmqEventLoop* evl,
+    uint32_t messageWindow,
+    std::vector<uint8_t> routeEventProtocols,
+    std::shared_ptr<IoProvider> ioProvider)
+    : evl_(evl),
+      routeEventProtocols_(
+          routeEventProtocols.begin(), routeEventProtocols.end()),
+      messageWindow_(std::max<uint32_t>(messageWindow, 1)),
+      recvBuffer_(kNlRecvBufferSize),
+      eventRecvBuffer_(kNlRecvBufferSize),
+      ioProvider_(std::move(ioProvider)) {
+  if (ioProvider_) {
+    recvBatchBuffers_.assign(
+        kNlRecvBatchSize, std::vector<char>(kNlRecvBufferSize));
+    eventRecvBatchBuffers_.assign(
+        kNlRecvBatchSize, std::vector<char>(kNlRecvBufferSize));
+  }
   nlMessageTimer_ = fbzmq::ZmqTimeout::make(evl_, [this]() noexcept {
-    LOG(INFO) << "Did not receive last ack " << lastSeqNo_;
+    LOG(INFO) << "Did not receive " << unackedSeqNos_.size()
+              << " acks, last seq sent " << lastSeqNo_;
+    // stop waiting for the missing acks, their requests time out
+    unackedSeqNos_.clear();
     sendNetlinkMessage();
   });
 }
 
 void
-NetlinkProtocolSocket::init() {
+NetlinkProtocolSocket::init(bool subscribeEvents) {
   pid_ = static_cast<int>(
       std::hash<std::thread::id>{}(std::this_thread::get_id()));
 
+  // requests and their replies
   nlSock_ = ::socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
   if (nlSock_ < 0) {
     LOG(FATAL) << "Netlink socket create failed.";
@@ -150,12 +260,6 @@ NetlinkProtocolSocket::init() {
   ::memset(&saddr_, 0, sizeof(saddr_));
   saddr_.nl_family = AF_NETLINK;
   saddr_.nl_pid = pid_;
-  /* We can subscribe to different Netlink mutlicast groups for specific types
-   * of events: link, IPv4/IPv6 address and neighbor. */
-  saddr_.nl_groups = RTMGRP_LINK // listen for link events
-      | RTMGRP_IPV4_IFADDR // listen for IPv4 address events
-      | RTMGRP_IPV6_IFADDR // listen for IPv6 address events
-      | RTMGRP_NEIGH; // listen for Neighbor (ARP) events
 
   if (bind(nlSock_, (struct sockaddr*)&saddr_, sizeof(saddr_)) != 0) {
     LOG(FATAL) << "Failed to bind netlink socket: " << folly::errnoStr(errno);
@@ -169,6 +273,70 @@ NetlinkProtocolSocket::init() {
       ++errors_;
     }
   });
+  if (not subscribeEvents) {
+    return;
+  }
+
+  // events, on a socket of their own for acks not to wait behind them
+  eventSock_ = ::socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+  if (eventSock_ < 0) {
+    LOG(FATAL) << "Netlink event socket create failed.";
+  }
+  // past rmem_max if privileged, ENOBUFS triggers a resync anyway
+  size = kNetlinkEventSockRecvBuf;
+  if (setsockopt(
+          eventSock_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0 and
+      setsockopt(eventSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+    LOG(FATAL) << "Netlink event socket set recv buffer failed.";
+  }
+
+  // filter events before subscribing to them
+  if (attachEventFilter()) {
+    eventFilterAttached_ = true;
+  } else {
+    LOG(ERROR) << "Failed to attach netlink socket filter: "
+               << folly::errnoStr(errno) << ". Filtering events in userspace";
+  }
+
+  struct sockaddr_nl eventAddr;
+  ::memset(&eventAddr, 0, sizeof(eventAddr));
+  eventAddr.nl_family = AF_NETLINK;
+  /* We can subscribe to different Netlink mutlicast groups for specific types
+   * of events: link, IPv4/IPv6 address, neighbor and route. */
+  eventAddr.nl_groups = RTMGRP_LINK // listen for link events
+      | RTMGRP_IPV4_IFADDR // listen for IPv4 address events
+      | RTMGRP_IPV6_IFADDR // listen for IPv6 address events
+      | RTMGRP_NEIGH; // listen for Neighbor (ARP) events
+  if (not routeEventProtocols_.empty()) {
+    eventAddr.nl_groups |= RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+  }
+
+  if (bind(eventSock_, (struct sockaddr*)&eventAddr, sizeof(eventAddr)) != 0) {
+    LOG(FATAL) << "Failed to bind netlink event socket: "
+               << folly::errnoStr(errno);
+  };
+
+  // MPLS route group is past the ones bind can subscribe to
+  int mplsGroup = RTNLGRP_MPLS_ROUTE;
+  if (not routeEventProtocols_.empty() and
+      setsockopt(
+          eventSock_,
+          SOL_NETLINK,
+          NETLINK_ADD_MEMBERSHIP,
+          &mplsGroup,
+          sizeof(mplsGroup)) < 0) {
+    LOG(WARNING) << "Failed to subscribe to MPLS route events: "
+                 << folly::errnoStr(errno);
+  }
+
+  evl_->addSocketFd(eventSock_, ZMQ_POLLIN, [this](int) noexcept {
+    try {
+      recvEventMessage();
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "error processing NL event" << folly::exceptionStr(err);
+      ++errors_;
+    }
+  });
 }
 
 void
@@ -189,15 +357,115 @@ NetlinkProtocolSocket::setNeighborEventCB(
   neighborEventCB_ = neighborEventCB;
 }
 
+void
+NetlinkProtocolSocket::setRouteEventCB(
+    std::function<void(fbnl::Route, bool)> routeEventCB) {
+  routeEventCB_ = routeEventCB;
+}
+
+void
+NetlinkProtocolSocket::addRouteEventIgnoredPids(std::vector<uint32_t> pids) {
+  evl_->runImmediatelyOrInEventLoop([this, pids = std::move(pids)]() {
+    routeEventIgnoredPids_.insert(pids.begin(), pids.end());
+  });
+}
+
+void
+NetlinkProtocolSocket::setEventsLostCB(std::function<void()> eventsLostCB) {
+  eventsLostCB_ = eventsLostCB;
+}
+
+void
+NetlinkProtocolSocket::setEventsDrainedCB(
+    std::function<void()> eventsDrainedCB) {
+  eventsDrainedCB_ = eventsDrainedCB;
+}
+
+bool
+NetlinkProtocolSocket::attachEventFilter() {
+  // Multicast events come one per datagram and are judged by their header.
+  // Absolute loads are converted from network byte order, netlink is in
+  // host order
+  const uint32_t pidOffset = offsetof(struct nlmsghdr, nlmsg_pid);
+  const uint32_t typeOffset = offsetof(struct nlmsghdr, nlmsg_type);
+  const uint32_t protocolOffset =
+      NLMSG_LENGTH(0) + offsetof(struct rtmsg, rtm_protocol);
+  const uint32_t numProtocols = routeEventProtocols_.size();
+  if (numProtocols > kMaxFilterProtocols) {
+    // jumps past the protocol checks would overflow
+    errno = E2BIG;
+    return false;
+  }
+
+  std::vector<struct sock_filter> program;
+  // messages other than route ones
+  program.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, typeOffset));
+  program.push_back(
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWROUTE), 1, 0));
+  program.push_back(BPF_JUMP(
+      BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELROUTE), 0, numProtocols + 4));
+  // route changes made through the request socket
+  program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, pidOffset));
+  program.push_back(
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(pid_), numProtocols + 1, 0));
+  // route messages of the route event protocols
+  program.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, protocolOffset));
+  uint8_t remaining = numProtocols;
+  for (auto protocol : routeEventProtocols_) {
+    program.push_back(
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, protocol, remaining, 0));
+    --remaining;
+  }
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffff));
+
+  struct sock_fprog fprog;
+  fprog.len = program.size();
+  fprog.filter = program.data();
+  return setsockopt(
+             eventSock_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) ==
+      0;
+}
+
+void
+NetlinkProtocolSocket::processRouteEvent(const struct nlmsghdr* nlh) {
+  // changes made through the request socket are known already
+  if (nlh->nlmsg_pid == pid_ or routeEventIgnoredPids_.count(nlh->nlmsg_pid) or
+      nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg))) {
+    return;
+  }
+  const struct rtmsg* const routeEntry =
+      reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(nlh));
+  if (not routeEventProtocols_.count(routeEntry->rtm_protocol)) {
+    // the socket filter drops these if attached
+    ++filteredEvents_;
+    return;
+  }
+  ++routeEvents_;
+  if (routeEventCB_) {
+    auto routeMessage = std::make_unique<NetlinkRouteMessage>();
+    fbnl::Route route = routeMessage->parseMessage(nlh);
+    VLOG(1) << "Asynchronous Route Event: " << route.str();
+    routeEventCB_(std::move(route), true);
+  }
+}
+
 void
 NetlinkProtocolSocket::processAck(uint32_t ack) {
-  if (ack == lastSeqNo_) {
+  if (unackedSeqNos_.erase(ack) == 0) {
+    return;
+  }
+  if (unackedSeqNos_.empty()) {
     VLOG(2) << "Last ack received " << ack;
     // cancel active message timer
     if (nlMessageTimer_->isScheduled()) {
       nlMessageTimer_->cancelTimeout();
     }
-    // continue sending next set of messages
+  }
+  // continue sending once a full batch fits in the window, so that acks
+  // are not answered with one message each
+  if (unackedSeqNos_.empty() ||
+      unackedSeqNos_.size() + kMaxIovMsg <= messageWindow_) {
     sendNetlinkMessage();
   }
 }
@@ -205,80 +473,95 @@ NetlinkProtocolSocket::processAck(uint32_t ack) {
 void
 NetlinkProtocolSocket::sendNetlinkMessage() {
   evl_->runImmediatelyOrInEventLoop([this]() {
-    struct sockaddr_nl nladdr = {
-        .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
-    uint32_t count{0};
-    uint32_t iovSize = std::min(msgQueue_.size(), kMaxIovMsg);
-
-    if (!iovSize) {
-      return;
+    // send batches while there is room in the window of unacked messages
+    while (!msgQueue_.empty() && unackedSeqNos_.size() < messageWindow_) {
+      sendNetlinkMessageBatch(std::min<size_t>(
+          {msgQueue_.size(),
+           kMaxIovMsg,
+           messageWindow_ - unackedSeqNos_.size()}));
     }
+  });
+}
 
-    auto iov = std::make_unique<struct iovec[]>(iovSize);
-
-    while (count < iovSize && !msgQueue_.empty()) {
-      auto m = std::move(msgQueue_.front());
-      msgQueue_.pop();
-
-      struct nlmsghdr* nlmsg_hdr = m->getMessagePtr();
-      iov[count].iov_base = reinterpret_cast<void*>(m->getMessagePtr());
-      iov[count].iov_len = m->getDataLength();
-
-      // fill sequence number and PID
-      nlmsg_hdr->nlmsg_seq = ++gSequenceNumber;
-      nlmsg_hdr->nlmsg_pid = pid_;
-
-      // check if one request per message
-      if ((nlmsg_hdr->nlmsg_flags & NLM_F_MULTI) != 0) {
-        LOG(ERROR) << "Error: multipart netlink message not supported";
-      }
-
-      // Add seq number -> netlink request mapping
-      nlSeqNoMap_.insert({gSequenceNumber, std::move(m)});
-      count++;
+void
+NetlinkProtocolSocket::sendNetlinkMessageBatch(uint32_t iovSize) {
+  struct sockaddr_nl nladdr = {
+      .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
+  uint32_t count{0};
+  std::vector<uint32_t> seqNos;
+  seqNos.reserve(iovSize);
+
+  auto iov = std::make_unique<struct iovec[]>(iovSize);
+
+  while (count < iovSize && !msgQueue_.empty()) {
+    auto m = std::move(msgQueue_.front());
+    msgQueue_.pop();
+
+    struct nlmsghdr* nlmsg_hdr = m->getMessagePtr();
+    iov[count].iov_base = reinterpret_cast<void*>(m->getMessagePtr());
+    iov[count].iov_len = m->getDataLength();
+
+    // fill sequence number and PID
+    nlmsg_hdr->nlmsg_seq = ++gSequenceNumber;
+    nlmsg_hdr->nlmsg_pid = pid_;
+
+    // check if one request per message
+    if ((nlmsg_hdr->nlmsg_flags & NLM_F_MULTI) != 0) {
+      LOG(ERROR) << "Error: multipart netlink message not supported";
     }
-    lastSeqNo_ = gSequenceNumber;
-    VLOG(2) << "Last seq sent:" << lastSeqNo_;
-
-    auto outMsg = std::make_unique<struct msghdr>();
-    outMsg->msg_name = &nladdr;
-    outMsg->msg_namelen = sizeof(nladdr);
-    outMsg->msg_iov = &iov[0];
-    outMsg->msg_iovlen = count;
-
-    VLOG(2) << "Sending " << outMsg->msg_iovlen << " netlink messages";
-    auto status = sendmsg(nlSock_, outMsg.get(), 0);
-
-    if (status < 0) {
-      LOG(ERROR) << "Error sending on NL socket "
-                 << folly::errnoStr(std::abs(status))
-                 << " Number of messages:" << outMsg->msg_iovlen;
-      ++errors_;
+
+    // Add seq number -> netlink request mapping
+    nlSeqNoMap_.insert({gSequenceNumber, std::move(m)});
+    seqNos.emplace_back(gSequenceNumber);
+    count++;
+  }
+  lastSeqNo_ = gSequenceNumber;
+  VLOG(2) << "Last seq sent:" << lastSeqNo_;
+
+  auto outMsg = std::make_unique<struct msghdr>();
+  outMsg->msg_name = &nladdr;
+  outMsg->msg_namelen = sizeof(nladdr);
+  outMsg->msg_iov = &iov[0];
+  outMsg->msg_iovlen = count;
+
+  VLOG(2) << "Sending " << outMsg->msg_iovlen << " netlink messages";
+  auto status = sendmsg(nlSock_, outMsg.get(), 0);
+
+  if (status < 0) {
+    const int error = errno;
+    LOG(ERROR) << "Error sending on NL socket " << folly::errnoStr(error)
+               << " Number of messages:" << outMsg->msg_iovlen;
+    ++errors_;
+    // none of the requests will be acked, fail them right away
+    for (const auto seqNo : seqNos) {
+      setReturnStatusValue(seqNo, -error);
     }
+    return;
+  }
+  unackedSeqNos_.insert(seqNos.begin(), seqNos.end());
 
-    // Schedule timer to wait for acks and send next set of messages
-    nlMessageTimer_->scheduleTimeout(
-        std::chrono::milliseconds(kNlMessageAckTimer));
-  });
+  // Schedule timer to wait for acks and send next set of messages
+  nlMessageTimer_->scheduleTimeout(
+      std::chrono::milliseconds(kNlMessageAckTimer));
 }
 
 void
 NetlinkProtocolSocket::setReturnStatusValue(uint32_t seq, int status) {
-  try {
-    auto request = nlSeqNoMap_.at(seq);
-    request->setReturnStatus(status);
-    // Remove mapping
-    nlSeqNoMap_.erase(seq);
-  } catch (const std::out_of_range& e) {
+  auto it = nlSeqNoMap_.find(seq);
+  if (it == nlSeqNoMap_.end()) {
     VLOG(2) << "No future associated with Seq#" << seq;
+    return;
   }
+  it->second->setReturnStatus(status);
+  // Remove mapping
+  nlSeqNoMap_.erase(it);
 }
 
 void
 NetlinkProtocolSocket::processMessage(
-    const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead) {
+    const char* rxMsg, uint32_t bytesRead, bool isEvent) {
   // first netlink message header
-  struct nlmsghdr* nlh = (struct nlmsghdr*)rxMsg.data();
+  struct nlmsghdr* nlh = (struct nlmsghdr*)rxMsg;
   do {
     if (!NLMSG_OK(nlh, bytesRead)) {
       break;
@@ -289,12 +572,17 @@ NetlinkProtocolSocket::processMessage(
     switch (nlh->nlmsg_type) {
     case RTM_NEWROUTE:
     case RTM_DELROUTE: {
-      // next RTM message to be processed
-      auto rtmMessage = std::make_unique<NetlinkRouteMessage>();
-      auto route = rtmMessage->parseMessage(nlh);
-      if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
-        // Synchronous event - do not generate route events
-        routeCache_.emplace_back(route);
+      if (isEvent) {
+        processRouteEvent(nlh);
+        break;
+      }
+      // Synchronous event - stream to the dump request, do not generate
+      // route events
+      auto it = nlSeqNoMap_.find(nlh->nlmsg_seq);
+      if (it != nlSeqNoMap_.end() &&
+          it->second->getMessageType() ==
+              NetlinkMessage::MessageType::GET_ALL_ROUTES) {
+        static_cast<NetlinkRouteMessage&>(*it->second).processDumpReply(nlh);
       }
     } break;
 
@@ -304,7 +592,7 @@ NetlinkProtocolSocket::processMessage(
       auto linkMessage = std::make_unique<NetlinkLinkMessage>();
       fbnl::Link link = linkMessage->parseMessage(nlh);
 
-      if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
+      if (!isEvent) {
         // Synchronous event - do not generate link events
         linkCache_.emplace_back(link);
       } else if (linkEventCB_) {
@@ -323,26 +611,14 @@ NetlinkProtocolSocket::processMessage(
       if (!addr.getPrefix().hasValue()) {
         break;
       }
-      if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
-        // Response to a corresponding request
-        auto request = nlSeqNoMap_.at(nlh->nlmsg_seq);
-        if (request->getMessageType() ==
-            NetlinkMessage::MessageType::GET_ALL_ADDRS) {
-          // Message in response to get addresses, store in address cache
+      if (!isEvent) {
+        // Message in response to get addresses, store in address cache.
+        // Address changes requested through this socket come back as events
+        auto it = nlSeqNoMap_.find(nlh->nlmsg_seq);
+        if (it != nlSeqNoMap_.end() &&
+            it->second->getMessageType() ==
+                NetlinkMessage::MessageType::GET_ALL_ADDRS) {
           addressCache_.emplace_back(addr);
-        } else if (
-            request->getMessageType() ==
-                NetlinkMessage::MessageType::ADD_ADDR ||
-            request->getMessageType() ==
-                NetlinkMessage::MessageType::DEL_ADDR) {
-          /* Response to a add/del request - generate addr event for handler.
-          This occurs when we add/del IPv4 addresses generates address event
-          with the same sequence as the original request */
-          if (addrEventCB_) {
-            // Asynchronous event - generate addr event for handler
-            VLOG(0) << "Asynchronous Addr Event: " << addr.str();
-            addrEventCB_(addr, true);
-          }
         }
       } else if (addrEventCB_) {
         // Asynchronous event - generate addr event for handler
@@ -357,7 +633,7 @@ NetlinkProtocolSocket::processMessage(
       auto neighMessage = std::make_unique<NetlinkNeighborMessage>();
       fbnl::Neighbor neighbor = neighMessage->parseMessage(nlh);
 
-      if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
+      if (!isEvent) {
         // Synchronous event - do not generate neighbor events
         neighborCache_.emplace_back(neighbor);
       } else if (neighborEventCB_) {
@@ -367,6 +643,11 @@ NetlinkProtocolSocket::processMessage(
       }
     } break;
 
+    case kRtmNewNexthop:
+    case kRtmDelNexthop: {
+      // nexthop objects are only programmed, not tracked from the kernel
+    } break;
+
     case NLMSG_ERROR: {
       const struct nlmsgerr* const ack =
           reinterpret_cast<struct nlmsgerr*>(NLMSG_DATA(nlh));
@@ -399,23 +680,123 @@ NetlinkProtocolSocket::processMessage(
   } while ((nlh = NLMSG_NEXT(nlh, bytesRead)));
 }
 
-void
-NetlinkProtocolSocket::recvNetlinkMessage() {
-  // messages buffer
-  std::array<char, kMaxNlPayloadSize> recvMsg = {};
-
-  int32_t bytesRead = ::recv(nlSock_, recvMsg.data(), kMaxNlPayloadSize, 0);
+int32_t
+NetlinkProtocolSocket::recvDatagram(
+    int sock, std::vector<char>& buffer, int flags) {
+  // size of the pending datagram, grow the buffer to receive it whole
+  int32_t bytesRead = ::recv(sock, nullptr, 0, MSG_PEEK | MSG_TRUNC | flags);
+  if (bytesRead > static_cast<int32_t>(buffer.size())) {
+    buffer.resize(bytesRead);
+  }
+  if (bytesRead >= 0) {
+    bytesRead = ::recv(sock, buffer.data(), buffer.size(), flags);
+  }
   VLOG(4) << "Message received with size: " << bytesRead;
 
   if (bytesRead < 0) {
-    if (errno == EINTR || errno == EAGAIN) {
-      return;
+    const int err = errno;
+    if (err != EINTR && err != EAGAIN && err != ENOBUFS) {
+      LOG(INFO) << "Error in netlink socket receive: " << bytesRead
+                << " err: " << folly::errnoStr(err);
+    }
+    return -err;
+  }
+  return bytesRead;
+}
+
+int32_t
+NetlinkProtocolSocket::recvDatagramBatch(
+    int sock, std::vector<std::vector<char>>& buffers, bool isEvent) {
+  const auto numBuffers = buffers.size();
+  std::vector<struct iovec> iovs(numBuffers);
+  std::vector<struct mmsghdr> msgs(numBuffers);
+  for (size_t i = 0; i < numBuffers; ++i) {
+    iovs[i].iov_base = buffers[i].data();
+    iovs[i].iov_len = buffers[i].size();
+    ::memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const int numReceived =
+      ioProvider_->recvmmsg(sock, msgs.data(), numBuffers, MSG_DONTWAIT);
+  if (numReceived < 0) {
+    const int err = errno;
+    if (err != EINTR && err != EAGAIN && err != ENOBUFS) {
+      LOG(INFO) << "Error in netlink socket batch receive: "
+                << folly::errnoStr(err);
+    }
+    return -err;
+  }
+  VLOG(4) << "Received " << numReceived << " messages";
+
+  for (int i = 0; i < numReceived; ++i) {
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      LOG(ERROR) << "Dropping netlink datagram larger than "
+                 << buffers[i].size() << " bytes";
+      ++errors_;
+      continue;
+    }
+    // one bad datagram must not take the rest of the batch with it
+    try {
+      processMessage(buffers[i].data(), msgs[i].msg_len, isEvent);
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "error processing NL message" << folly::exceptionStr(err);
+      ++errors_;
     }
-    LOG(INFO) << "Error in netlink socket receive: " << bytesRead
-              << " err: " << folly::errnoStr(std::abs(errno));
+  }
+  return numReceived;
+}
+
+void
+NetlinkProtocolSocket::recvNetlinkMessage() {
+  if (ioProvider_) {
+    recvDatagramBatch(nlSock_, recvBatchBuffers_, false /* isEvent */);
     return;
   }
-  processMessage(recvMsg, static_cast<uint32_t>(bytesRead));
+  const auto bytesRead = recvDatagram(nlSock_, recvBuffer_);
+  if (bytesRead >= 0) {
+    processMessage(recvBuffer_.data(), static_cast<uint32_t>(bytesRead));
+  }
+}
+
+void
+NetlinkProtocolSocket::recvEventMessage() {
+  // drain the datagrams pending, for their events to be handled at once
+  int32_t ret{0};
+  size_t numDatagrams{0};
+  do {
+    if (ioProvider_) {
+      ret = recvDatagramBatch(eventSock_, eventRecvBatchBuffers_, true);
+    } else {
+      ret = recvDatagram(eventSock_, eventRecvBuffer_, MSG_DONTWAIT);
+      if (ret < 0) {
+        break;
+      }
+      // one bad datagram must not hold back the events of the others
+      try {
+        processMessage(
+            eventRecvBuffer_.data(), static_cast<uint32_t>(ret), true);
+      } catch (std::exception const& err) {
+        LOG(ERROR) << "error processing NL event" << folly::exceptionStr(err);
+        ++errors_;
+      }
+      ret = 1;
+    }
+    numDatagrams += std::max(ret, 0);
+  } while (ret > 0 and numDatagrams < kNlEventDrainSize);
+
+  if (ret == -ENOBUFS) {
+    // the kernel dropped events, the state they carried has to be dumped
+    ++eventOverflows_;
+    LOG(WARNING) << "Netlink event socket overflowed, events were lost";
+    if (eventsLostCB_) {
+      eventsLostCB_();
+    }
+  }
+  if (numDatagrams > 0 and eventsDrainedCB_) {
+    eventsDrainedCB_();
+  }
 }
 
 uint32_t
@@ -431,6 +812,9 @@ NetlinkProtocolSocket::getAckCount() const {
 NetlinkProtocolSocket::~NetlinkProtocolSocket() {
   LOG(INFO) << "Closing netlink socket.";
   close(nlSock_);
+  if (eventSock_ >= 0) {
+    close(eventSock_);
+  }
 }
 
 void
@@ -448,10 +832,8 @@ NetlinkProtocolSocket::addNetlinkMessage(
             break;
           }
         }
-        // call send messages API if no timers are scheduled
-        if (!nlMessageTimer_->isScheduled()) {
-          sendNetlinkMessage();
-        }
+        // send as many messages as the window of unacked messages allows
+        sendNetlinkMessage();
       });
   return;
 }
@@ -505,6 +887,94 @@ NetlinkProtocolSocket::addRoute(const openr::fbnl::Route& route) {
   return getReturnStatus(futures, std::unordered_set<int>{EEXIST});
 }
 
+ResultCode
+NetlinkProtocolSocket::addRoute(
+    const openr::fbnl::Route& route, uint32_t nexthopId) {
+  auto rtmMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+  std::vector<folly::Future<int>> futures;
+  futures.emplace_back(rtmMsg->getFuture());
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = rtmMsg->addRoute(route, nexthopId)) != ResultCode::SUCCESS) {
+    LOG(ERROR) << "Error adding route " << route.str() << " via nexthop id "
+               << nexthopId;
+    return status;
+  };
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  msg.emplace_back(std::move(rtmMsg));
+  addNetlinkMessage(std::move(msg));
+  return getReturnStatus(futures, std::unordered_set<int>{EEXIST});
+}
+
+ResultCode
+NetlinkProtocolSocket::addNexthop(
+    uint32_t id,
+    uint8_t protocolId,
+    const openr::fbnl::NextHop& nextHop,
+    bool replace) {
+  auto nhMsg = std::make_unique<openr::fbnl::NetlinkNexthopMessage>();
+  nhMsg->setMessageType(NetlinkMessage::MessageType::ADD_NEXTHOP);
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = nhMsg->addNexthop(id, protocolId, nextHop, replace)) !=
+      ResultCode::SUCCESS) {
+    LOG(ERROR) << "Error adding nexthop object " << id << ": "
+               << nextHop.str();
+    return status;
+  }
+  return sendAddNexthop(std::move(nhMsg));
+}
+
+ResultCode
+NetlinkProtocolSocket::addNexthopGroup(
+    uint32_t id,
+    uint8_t protocolId,
+    const NexthopGroupMembers& members,
+    bool replace) {
+  auto nhMsg = std::make_unique<openr::fbnl::NetlinkNexthopMessage>();
+  nhMsg->setMessageType(NetlinkMessage::MessageType::ADD_NEXTHOP);
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = nhMsg->addNexthopGroup(id, protocolId, members, replace)) !=
+      ResultCode::SUCCESS) {
+    LOG(ERROR) << "Error adding nexthop group " << id;
+    return status;
+  }
+  return sendAddNexthop(std::move(nhMsg));
+}
+
+ResultCode
+NetlinkProtocolSocket::sendAddNexthop(std::unique_ptr<NetlinkMessage> nhMsg) {
+  std::vector<folly::Future<int>> futures;
+  futures.emplace_back(nhMsg->getFuture());
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  msg.emplace_back(std::move(nhMsg));
+  addNetlinkMessage(std::move(msg));
+  // EEXIST is only returned when creating an id in use, let the caller
+  // retry with another id
+  auto status = getReturnStatus(futures, std::unordered_set<int>{EEXIST});
+  if (status == ResultCode::SUCCESS &&
+      std::abs(futures.front().value()) == EEXIST) {
+    return ResultCode::NEXTHOP_EXISTS;
+  }
+  return status;
+}
+
+ResultCode
+NetlinkProtocolSocket::deleteNexthop(uint32_t id) {
+  auto nhMsg = std::make_unique<openr::fbnl::NetlinkNexthopMessage>();
+  std::vector<folly::Future<int>> futures;
+  futures.emplace_back(nhMsg->getFuture());
+  nhMsg->setMessageType(NetlinkMessage::MessageType::DEL_NEXTHOP);
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = nhMsg->deleteNexthop(id)) != ResultCode::SUCCESS) {
+    LOG(ERROR) << "Error deleting nexthop object " << id;
+    return status;
+  }
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  msg.emplace_back(std::move(nhMsg));
+  addNetlinkMessage(std::move(msg));
+  // Ignore ENOENT error in delete (nexthop object does not exist)
+  return getReturnStatus(futures, std::unordered_set<int>{ENOENT});
+}
+
 ResultCode
 NetlinkProtocolSocket::addRoutes(const std::vector<openr::fbnl::Route> routes) {
   std::vector<std::unique_ptr<NetlinkMessage>> msg;
@@ -615,6 +1085,133 @@ NetlinkProtocolSocket::deleteRoutes(
       kNlRequestTimeout);
 }
 
+NlBatchResult
+NetlinkProtocolSocket::addRouteBatch(
+    const std::vector<openr::fbnl::Route>& routes,
+    const std::vector<uint32_t>& nexthopIds) {
+  CHECK(nexthopIds.empty() || nexthopIds.size() == routes.size());
+  std::vector<std::unique_ptr<NetlinkMessage>> msgs;
+  msgs.reserve(routes.size());
+  for (size_t i = 0; i < routes.size(); ++i) {
+    const auto& route = routes[i];
+    auto rtmMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+    ResultCode status{ResultCode::SUCCESS};
+    if (route.getFamily() == AF_MPLS) {
+      status = rtmMsg->addLabelRoute(route);
+    } else {
+      status = rtmMsg->addRoute(route, nexthopIds.empty() ? 0 : nexthopIds[i]);
+    }
+    if (status == ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(rtmMsg));
+    } else {
+      LOG(ERROR) << "Error adding route " << route.str();
+      msgs.emplace_back(nullptr);
+    }
+  }
+  return sendBatch(std::move(msgs), std::unordered_set<int>{EEXIST});
+}
+
+NlBatchResult
+NetlinkProtocolSocket::deleteRouteBatch(
+    const std::vector<openr::fbnl::Route>& routes) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msgs;
+  msgs.reserve(routes.size());
+  for (const auto& route : routes) {
+    auto rtmMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+    ResultCode status{ResultCode::SUCCESS};
+    if (route.getFamily() == AF_MPLS) {
+      status = rtmMsg->deleteLabelRoute(route);
+    } else {
+      status = rtmMsg->deleteRoute(route);
+    }
+    if (status == ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(rtmMsg));
+    } else {
+      LOG(ERROR) << "Error deleting route " << route.str();
+      msgs.emplace_back(nullptr);
+    }
+  }
+  // Ignore EEXIST, ESRCH, EINVAL errors in delete operation
+  return sendBatch(
+      std::move(msgs), std::unordered_set<int>{EEXIST, ESRCH, EINVAL});
+}
+
+NlBatchResult
+NetlinkProtocolSocket::sendBatch(
+    std::vector<std::unique_ptr<NetlinkMessage>> msgs,
+    const std::unordered_set<int>& ignoredErrors) {
+  NlBatchResult result;
+  result.statuses.resize(msgs.size(), 0);
+
+  // acks of the batch, completed by the callbacks of its requests in the
+  // event loop. Shared with the requests which may outlive this call
+  struct BatchCompletion {
+    std::mutex mutex;
+    std::vector<int> statuses;
+    std::vector<bool> done;
+    size_t numPending{0};
+    folly::Promise<folly::Unit> promise;
+  };
+  auto completion = std::make_shared<BatchCompletion>();
+  completion->statuses.resize(msgs.size(), 0);
+  completion->done.resize(msgs.size(), false);
+  auto future = completion->promise.getFuture();
+
+  std::vector<std::unique_ptr<NetlinkMessage>> requests;
+  requests.reserve(msgs.size());
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    if (!msgs[i]) {
+      result.statuses[i] = -EINVAL;
+      continue;
+    }
+    msgs[i]->setCompletionCallback([completion, i](int status) {
+      std::lock_guard<std::mutex> lock(completion->mutex);
+      completion->statuses[i] = status;
+      completion->done[i] = true;
+      if (--completion->numPending == 0) {
+        completion->promise.setValue();
+      }
+    });
+    requests.emplace_back(std::move(msgs[i]));
+  }
+  completion->numPending = requests.size();
+  if (requests.empty()) {
+    completion->promise.setValue();
+  } else {
+    addNetlinkMessage(std::move(requests));
+  }
+
+  // Wait for Netlink Ack of all requests within the request timeout
+  future.wait(kNlRequestTimeout);
+  {
+    std::lock_guard<std::mutex> lock(completion->mutex);
+    for (size_t i = 0; i < completion->statuses.size(); ++i) {
+      if (result.statuses[i] != 0) {
+        continue;
+      }
+      if (!completion->done[i]) {
+        result.statuses[i] = -ETIMEDOUT;
+        continue;
+      }
+      const int status = completion->statuses[i];
+      if (status != 0 && ignoredErrors.count(std::abs(status)) == 0) {
+        result.statuses[i] = -std::abs(status);
+      }
+    }
+  }
+
+  for (const auto status : result.statuses) {
+    if (status != 0) {
+      ++result.numFailed;
+    }
+  }
+  if (result.numFailed) {
+    LOG(ERROR) << result.numFailed << " of " << result.statuses.size()
+               << " Netlink requests failed";
+  }
+  return result;
+}
+
 ResultCode
 NetlinkProtocolSocket::addIfAddress(const openr::fbnl::IfAddress& ifAddr) {
   auto addrMsg = std::make_unique<openr::fbnl::NetlinkAddrMessage>();
@@ -656,6 +1253,45 @@ NetlinkProtocolSocket::deleteIfAddress(const openr::fbnl::IfAddress& ifAddr) {
   return getReturnStatus(futures, std::unordered_set<int>{EADDRNOTAVAIL});
 }
 
+NlBatchResult
+NetlinkProtocolSocket::addIfAddressBatch(
+    const std::vector<openr::fbnl::IfAddress>& ifAddrs) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msgs;
+  msgs.reserve(ifAddrs.size());
+  for (const auto& ifAddr : ifAddrs) {
+    auto addrMsg = std::make_unique<openr::fbnl::NetlinkAddrMessage>();
+    addrMsg->setMessageType(NetlinkMessage::MessageType::ADD_ADDR);
+    if (addrMsg->addOrDeleteIfAddress(ifAddr, RTM_NEWADDR) ==
+        ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(addrMsg));
+    } else {
+      LOG(ERROR) << "Error adding address " << ifAddr.str();
+      msgs.emplace_back(nullptr);
+    }
+  }
+  return sendBatch(std::move(msgs), std::unordered_set<int>{EEXIST});
+}
+
+NlBatchResult
+NetlinkProtocolSocket::deleteIfAddressBatch(
+    const std::vector<openr::fbnl::IfAddress>& ifAddrs) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msgs;
+  msgs.reserve(ifAddrs.size());
+  for (const auto& ifAddr : ifAddrs) {
+    auto addrMsg = std::make_unique<openr::fbnl::NetlinkAddrMessage>();
+    addrMsg->setMessageType(NetlinkMessage::MessageType::DEL_ADDR);
+    if (addrMsg->addOrDeleteIfAddress(ifAddr, RTM_DELADDR) ==
+        ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(addrMsg));
+    } else {
+      LOG(ERROR) << "Error deleting address " << ifAddr.str();
+      msgs.emplace_back(nullptr);
+    }
+  }
+  // Ignore EADDRNOTAVAIL error in delete
+  return sendBatch(std::move(msgs), std::unordered_set<int>{EADDRNOTAVAIL});
+}
+
 std::vector<fbnl::Link>
 NetlinkProtocolSocket::getAllLinks() {
   // Refresh internal cache
@@ -709,17 +1345,50 @@ NetlinkProtocolSocket::getAllNeighbors() {
 
 std::vector<fbnl::Route>
 NetlinkProtocolSocket::getAllRoutes() {
-  routeCache_.clear();
+  std::vector<fbnl::Route> routes;
+  auto parser = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+  dumpRoutes([&routes, &parser](const NetlinkRouteView& route) {
+    routes.emplace_back(parser->parseMessage(route.getMessage()));
+  });
+  return routes;
+}
+
+ResultCode
+NetlinkProtocolSocket::dumpRoutes(
+    RouteDumpCallback callback, folly::Optional<uint8_t> protocolId) {
+  // callback may receive late replies once the dump timed out, stop
+  // calling it before returning
+  struct DumpState {
+    std::mutex mutex;
+    bool active{true};
+    RouteDumpCallback callback;
+  };
+  auto state = std::make_shared<DumpState>();
+  state->callback = std::move(callback);
+
   auto routeMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(routeMsg->getFuture());
   fbnl::RouteBuilder builder; // to create empty route
   routeMsg->init(RTM_GETROUTE, 0, builder.build());
+  routeMsg->setMessageType(NetlinkMessage::MessageType::GET_ALL_ROUTES);
+  routeMsg->setDumpCallback(
+      [state](const NetlinkRouteView& route) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->active) {
+          state->callback(route);
+        }
+      },
+      protocolId);
   std::vector<std::unique_ptr<NetlinkMessage>> msg;
   msg.emplace_back(std::move(routeMsg));
   addNetlinkMessage(std::move(msg));
-  getReturnStatus(futures, std::unordered_set<int>{}, kNlRequestTimeout);
-  return std::move(routeCache_);
+  const auto status =
+      getReturnStatus(futures, std::unordered_set<int>{}, kNlRequestTimeout);
+
+  std::lock_guard<std::mutex> lock(state->mutex);
+  state->active = false;
+  return status;
 }
 
 } // namespace openr::fbnl
@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <queue>
+#include <unordered_set>
+#include <vector>
 
 #include <limits.h>
 #include <linux/lwtunnel.h>
@@ -19,21 +23,60 @@
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Function.h>
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
 #include <folly/futures/Future.h>
 
 #include <openr/nl/NetlinkTypes.h>
+#include <openr/spark/IoProvider.h>
 
 namespace openr::fbnl {
 class NetlinkSocket;
+class NetlinkRouteView;
 
 constexpr uint16_t kMaxNlPayloadSize{4096};
 constexpr uint32_t kNetlinkSockRecvBuf{1 * 1024 * 1024};
+// receive buffer of the event socket, large enough for bursts of events
+constexpr uint32_t kNetlinkEventSockRecvBuf{16 * 1024 * 1024};
+// initial size of the receive buffer, grown to fit larger datagrams. Lets
+// the kernel pack dump replies into fewer datagrams
+constexpr uint32_t kNlRecvBufferSize{32 * 1024};
+// max number of datagrams received at once through an IoProvider
+constexpr size_t kNlRecvBatchSize{16};
+// max number of event datagrams drained per receive pass, for requests not
+// to wait behind an event storm
+constexpr size_t kNlEventDrainSize{256};
 
 constexpr uint32_t kMaxNlMessageQueue{126001};
 constexpr size_t kMaxIovMsg{500};
+// default number of requests sent but not yet acked
+constexpr uint32_t kNlMessageWindow{2000};
 constexpr std::chrono::milliseconds kNlMessageAckTimer{1000};
 constexpr std::chrono::milliseconds kNlRequestTimeout{30000};
+// max number of freed message buffers kept for reuse
+constexpr size_t kNlMessagePoolSize{1024};
+
+// callback receiving the routes of a dump as views, valid during the call
+using RouteDumpCallback = folly::Function<void(const NetlinkRouteView&)>;
+
+// Members of a nexthop group: nexthop object id and weight
+using NexthopGroupMembers = std::vector<std::pair<uint32_t, uint8_t>>;
+
+// protocol ids of the routes programmed by the platform, the ones whose
+// route events are worth receiving
+std::vector<uint8_t> getPlatformRouteProtocols();
+
+// Result of a batch of netlink requests
+struct NlBatchResult {
+  // status of each request in order: 0 on success, otherwise the negative
+  // errno reported by the kernel, -EINVAL if the request could not be
+  // encoded, or -ETIMEDOUT if it was not acked in time
+  std::vector<int> statuses;
+
+  // number of failed requests
+  size_t numFailed{0};
+};
 
 enum class ResultCode {
   SUCCESS = 0,
@@ -47,7 +90,8 @@ enum class ResultCode {
   NO_NEXTHOP_IP,
   NO_LOOPBACK_INDEX,
   UNKNOWN_LABEL_ACTION,
-  NO_IP
+  NO_IP,
+  NEXTHOP_EXISTS
 };
 
 class NetlinkMessage {
@@ -71,11 +115,24 @@ class NetlinkMessage {
   // update size of message received
   void updateBytesReceived(uint16_t bytes);
 
-  // set status value (in promise)
+  // set status value (in promise, or through the completion callback)
   void setReturnStatus(int status);
 
+  // future of the status value
   folly::Future<int> getFuture();
 
+  // report the status value to callback instead of a future. Cheaper than a
+  // promise when completing a batch of requests at once
+  void setCompletionCallback(folly::Function<void(int)> callback);
+
+  // messages are allocated from a pool of recycled buffers. Message types
+  // must fit in kPoolBlockSize
+  static constexpr size_t kPoolBlockSize{kMaxNlPayloadSize + 512};
+
+  static void* operator new(size_t size);
+
+  static void operator delete(void* ptr, size_t size);
+
   /* Netlink MessageType denotes the type of request sent to the kernel, so that
    * when we receive a response from the kernel (matched by sequence number), we
    * can process them accordingly based on the request. For example, when we get
@@ -92,7 +149,9 @@ class NetlinkMessage {
     GET_ALL_ROUTES,
     GET_ROUTE,
     ADD_ROUTE,
-    DEL_ROUTE
+    DEL_ROUTE,
+    ADD_NEXTHOP,
+    DEL_NEXTHOP
   } messageType_;
 
   // get Message Type
@@ -128,20 +187,37 @@ class NetlinkMessage {
   // in case of rx message, it contains bytes received
   uint32_t size_{kMaxNlPayloadSize};
 
-  // Promise to relay the status code received from kernel
+  // Promise to relay the status code received from kernel, created along
+  // with the first future
   std::unique_ptr<folly::Promise<int>> promise_{nullptr};
+
+  // callback to relay the status code instead of the promise
+  folly::Function<void(int)> completionCallback_;
 };
 
 class NetlinkProtocolSocket {
  public:
-  explicit NetlinkProtocolSocket(fbzmq::ZmqEventLoop* evl);
-
-  // create socket and add to eventloop
-  void init();
-
-  // receive messages from netlink socket
+  // messageWindow bounds the number of requests sent but not yet acked,
+  // requests are queued until acks make room. Route events are received for
+  // routes of routeEventProtocols only, none if empty. If ioProvider is set,
+  // datagrams are received in batches through it, e.g. an IoUringProvider
+  explicit NetlinkProtocolSocket(
+      fbzmq::ZmqEventLoop* evl,
+      uint32_t messageWindow = kNlMessageWindow,
+      std::vector<uint8_t> routeEventProtocols = getPlatformRouteProtocols(),
+      std::shared_ptr<IoProvider> ioProvider = nullptr);
+
+  // create request and event sockets and add them to eventloop. The event
+  // socket is left out unless subscribeEvents is set
+  void init(bool subscribeEvents = true);
+
+  // receive messages from netlink request socket
   void recvNetlinkMessage();
 
+  // receive the messages pending on netlink event socket, then invoke the
+  // events drained callback
+  void recvEventMessage();
+
   // send message to netlink socket
   void sendNetlinkMessage();
 
@@ -157,16 +233,63 @@ class NetlinkProtocolSocket {
   void setNeighborEventCB(
       std::function<void(fbnl::Neighbor, bool)> neighborEventCB);
 
-  // process message
+  // Set netlinkSocket Route event callback, for changes of routes of the
+  // route event protocols not made through this socket
+  void setRouteEventCB(std::function<void(fbnl::Route, bool)> routeEventCB);
+
+  // route changes made through the request sockets of pids, e.g. of a
+  // NetlinkRoutePool, are known already and not reported as events
+  void addRouteEventIgnoredPids(std::vector<uint32_t> pids);
+
+  // pid of the request socket, set by init()
+  uint32_t
+  getPid() const {
+    return pid_;
+  }
+
+  // Set callback invoked when the event socket overflowed and events were
+  // lost. The links, addresses and neighbors they carried must be dumped
+  void setEventsLostCB(std::function<void()> eventsLostCB);
+
+  // Set callback invoked at the end of each receive pass of the event
+  // socket, once the event callbacks were invoked for all the events it
+  // drained. Lets them be handled as a batch
+  void setEventsDrainedCB(std::function<void()> eventsDrainedCB);
+
+  // process the netlink messages of a datagram received on the request
+  // socket, or on the event socket if isEvent
   void processMessage(
-      const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead);
+      const char* rxMsg, uint32_t bytesRead, bool isEvent = false);
 
   // synchronous add route and nexthop paths
   ResultCode addRoute(const openr::fbnl::Route& route);
 
+  // synchronous add route referencing nexthop object or group nexthopId
+  ResultCode addRoute(const openr::fbnl::Route& route, uint32_t nexthopId);
+
   // synchronous delete route
   ResultCode deleteRoute(const openr::fbnl::Route& route);
 
+  // synchronous create nexthop object, or replace it if replace is set.
+  // Returns NEXTHOP_EXISTS if id is in use and replace is not set
+  ResultCode addNexthop(
+      uint32_t id,
+      uint8_t protocolId,
+      const openr::fbnl::NextHop& nextHop,
+      bool replace = false);
+
+  // synchronous create nexthop group, or replace it if replace is set.
+  // Returns NEXTHOP_EXISTS if id is in use and replace is not set
+  ResultCode addNexthopGroup(
+      uint32_t id,
+      uint8_t protocolId,
+      const NexthopGroupMembers& members,
+      bool replace = false);
+
+  // synchronous delete nexthop object or group. Groups must be deleted
+  // before their nexthop objects, routes using them are deleted with them
+  ResultCode deleteNexthop(uint32_t id);
+
   // synchronous add label route
   ResultCode addLabelRoute(const openr::fbnl::Route& route);
 
@@ -179,12 +302,36 @@ class NetlinkProtocolSocket {
   // synchronous delete a list of given IP or label routes
   ResultCode deleteRoutes(const std::vector<openr::fbnl::Route> routes);
 
+  // synchronous add a batch of IP or label routes, pipelined through the
+  // message window. If set, nexthopIds holds the nexthop object id of each
+  // route, 0 for routes carrying their nexthops. Returns the status of each
+  // route, EEXIST is not an error
+  NlBatchResult addRouteBatch(
+      const std::vector<openr::fbnl::Route>& routes,
+      const std::vector<uint32_t>& nexthopIds = {});
+
+  // synchronous delete a batch of IP or label routes. Returns the status
+  // of each route, missing routes are not an error
+  NlBatchResult deleteRouteBatch(
+      const std::vector<openr::fbnl::Route>& routes);
+
   // synchronous add interface address
   ResultCode addIfAddress(const openr::fbnl::IfAddress& ifAddr);
 
   // synchronous delete interface address
   ResultCode deleteIfAddress(const openr::fbnl::IfAddress& ifAddr);
 
+  // synchronous add a batch of interface addresses, pipelined through the
+  // message window. Returns the status of each address, EEXIST is not an
+  // error
+  NlBatchResult addIfAddressBatch(
+      const std::vector<openr::fbnl::IfAddress>& ifAddrs);
+
+  // synchronous delete a batch of interface addresses. Returns the status
+  // of each address, addresses not assigned are not an error
+  NlBatchResult deleteIfAddressBatch(
+      const std::vector<openr::fbnl::IfAddress>& ifAddrs);
+
   // add netlink message to the queue
   void addNetlinkMessage(std::vector<std::unique_ptr<NetlinkMessage>> nlmsg);
 
@@ -200,6 +347,32 @@ class NetlinkProtocolSocket {
   // ack count
   uint32_t getAckCount() const;
 
+  // route events received and passed to the route event callback
+  uint64_t
+  getRouteEventCount() const {
+    return routeEvents_.load(std::memory_order_relaxed);
+  }
+
+  // route events received but of other protocols, left to the socket
+  // filter when it is attached
+  uint64_t
+  getFilteredEventCount() const {
+    return filteredEvents_.load(std::memory_order_relaxed);
+  }
+
+  // whether the socket filter dropping unwanted route events in the kernel
+  // is attached
+  bool
+  isEventFilterAttached() const {
+    return eventFilterAttached_.load(std::memory_order_relaxed);
+  }
+
+  // number of times events were lost to an overflow of the event socket
+  uint64_t
+  getEventOverflowCount() const {
+    return eventOverflows_.load(std::memory_order_relaxed);
+  }
+
   // get all link interfaces from kernel using Netlink
   std::vector<fbnl::Link> getAllLinks();
 
@@ -212,6 +385,14 @@ class NetlinkProtocolSocket {
   // get all routes from kernel using Netlink
   std::vector<fbnl::Route> getAllRoutes();
 
+  // stream the routes of the kernel to callback as they are received,
+  // without collecting them. Routes of other protocols than protocolId, if
+  // set, are skipped before parsing their attributes. callback is invoked
+  // in the event loop, never after this returns
+  ResultCode dumpRoutes(
+      RouteDumpCallback callback,
+      folly::Optional<uint8_t> protocolId = folly::none);
+
  private:
   NetlinkProtocolSocket(NetlinkProtocolSocket const&) = delete;
   NetlinkProtocolSocket& operator=(NetlinkProtocolSocket const&) = delete;
@@ -225,6 +406,12 @@ class NetlinkProtocolSocket {
 
   std::function<void(fbnl::Neighbor, bool)> neighborEventCB_;
 
+  std::function<void(fbnl::Route, bool)> routeEventCB_;
+
+  std::function<void()> eventsLostCB_;
+
+  std::function<void()> eventsDrainedCB_;
+
   // netlink message queue
   std::queue<std::unique_ptr<NetlinkMessage>> msgQueue_;
 
@@ -234,9 +421,43 @@ class NetlinkProtocolSocket {
   // process ack message
   void processAck(uint32_t ack);
 
-  // netlink socket
+  // send nexthop create request and wait for its status
+  ResultCode sendAddNexthop(std::unique_ptr<NetlinkMessage> nhMsg);
+
+  // send up to count queued messages in a single sendmsg
+  void sendNetlinkMessageBatch(uint32_t count);
+
+  // attach a classic BPF filter to the event socket passing link, address
+  // and neighbor events, and route events of routeEventProtocols_ not made
+  // through the request socket. Returns false if the kernel refused it
+  bool attachEventFilter();
+
+  // handle a route message received on the event socket
+  void processRouteEvent(const struct nlmsghdr* nlh);
+
+  // receive a datagram of sock into buffer, grown to fit it. Returns its
+  // size or the negative errno, e.g. -EAGAIN with MSG_DONTWAIT in flags
+  int32_t recvDatagram(int sock, std::vector<char>& buffer, int flags = 0);
+
+  // receive the datagrams pending on sock, as many as buffers at once,
+  // through ioProvider_ and process them. Returns their number or the
+  // negative errno. Datagrams don't outgrow the buffers, the kernel caps
+  // dump replies at kNlRecvBufferSize
+  int32_t recvDatagramBatch(
+      int sock, std::vector<std::vector<char>>& buffers, bool isEvent);
+
+  // send a batch of requests and wait for the status of each, nullptr
+  // requests could not be encoded
+  NlBatchResult sendBatch(
+      std::vector<std::unique_ptr<NetlinkMessage>> msgs,
+      const std::unordered_set<int>& ignoredErrors);
+
+  // netlink socket of requests and their replies
   int nlSock_{-1};
 
+  // netlink socket subscribed to events
+  int eventSock_{-1};
+
   // PID Of the endpoint
   uint32_t pid_{UINT_MAX};
 
@@ -249,23 +470,50 @@ class NetlinkProtocolSocket {
   // NLMSG acks
   uint32_t acks_{0};
 
+  // protocols of the routes to receive events of
+  const std::unordered_set<uint8_t> routeEventProtocols_;
+
+  // pids of other sockets whose route changes are not reported as events
+  std::unordered_set<uint32_t> routeEventIgnoredPids_;
+
+  // route events handled and left out
+  std::atomic<uint64_t> routeEvents_{0};
+  std::atomic<uint64_t> filteredEvents_{0};
+  std::atomic<bool> eventFilterAttached_{false};
+  std::atomic<uint64_t> eventOverflows_{0};
+
   // last sent sequence number
   uint32_t lastSeqNo_;
 
+  // max number of requests sent but not yet acked
+  const uint32_t messageWindow_{kNlMessageWindow};
+
+  // sequence numbers of requests sent but not yet acked
+  std::unordered_set<uint32_t> unackedSeqNos_;
+
   // Sequence number -> NetlinkMesage request Map
-  std::unordered_map<uint32_t, std::shared_ptr<NetlinkMessage>> nlSeqNoMap_;
+  std::unordered_map<uint32_t, std::unique_ptr<NetlinkMessage>> nlSeqNoMap_;
+
+  // receive buffers, sized to the largest datagram received
+  std::vector<char> recvBuffer_;
+  std::vector<char> eventRecvBuffer_;
+
+  // receives batches of datagrams if set, into buffers of kNlRecvBufferSize
+  const std::shared_ptr<IoProvider> ioProvider_;
+  std::vector<std::vector<char>> recvBatchBuffers_;
+  std::vector<std::vector<char>> eventRecvBatchBuffers_;
 
   // Set ack status value to promise in the netlink request message
   void setReturnStatusValue(uint32_t seq, int ackStatus);
 
   /**
-   * We maintain a temporary cache of Link, Address, Neighbor and Routes from
-   * the kernel, which are solely used for the getAll... methods. These caches
-   * are cleared when we invoke a new getAllLinks/Addresses/Neighbors/Routes
+   * We maintain a temporary cache of Link, Address and Neighbor from the
+   * kernel, which are solely used for the getAll... methods. These caches
+   * are cleared when we invoke a new getAllLinks/Addresses/Neighbors. Routes
+   * are streamed to the callback of their dump request instead
    */
   std::vector<fbnl::Link> linkCache_{};
   std::vector<fbnl::IfAddress> addressCache_{};
   std::vector<fbnl::Neighbor> neighborCache_{};
-  std::vector<fbnl::Route> routeCache_{};
 };
 } // namespace openr::fbnl
@@ -10,6 +10,15 @@
 
 namespace openr::fbnl {
 
+// messages are allocated from fixed size pool blocks
+static_assert(sizeof(NetlinkRouteMessage) <= NetlinkMessage::kPoolBlockSize);
+static_assert(
+    sizeof(NetlinkNexthopMessage) <= NetlinkMessage::kPoolBlockSize);
+static_assert(sizeof(NetlinkLinkMessage) <= NetlinkMessage::kPoolBlockSize);
+static_assert(sizeof(NetlinkAddrMessage) <= NetlinkMessage::kPoolBlockSize);
+static_assert(
+    sizeof(NetlinkNeighborMessage) <= NetlinkMessage::kPoolBlockSize);
+
 NetlinkRouteMessage::NetlinkRouteMessage() {
   // get pointer to NLMSG header
   msghdr_ = getMessagePtr();
@@ -570,6 +579,65 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
   return route;
 }
 
+void
+NetlinkRouteMessage::setDumpCallback(
+    RouteDumpCallback callback, folly::Optional<uint8_t> protocolId) {
+  dumpCallback_ = std::move(callback);
+  dumpProtocolId_ = protocolId;
+}
+
+bool
+NetlinkRouteMessage::processDumpReply(const struct nlmsghdr* nlmsg) {
+  if (!dumpCallback_) {
+    return false;
+  }
+  // filter on the fixed header before indexing any attribute
+  const struct rtmsg* const routeEntry =
+      reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(nlmsg));
+  if (dumpProtocolId_.hasValue() &&
+      routeEntry->rtm_protocol != dumpProtocolId_.value()) {
+    return true;
+  }
+  dumpCallback_(NetlinkRouteView(nlmsg));
+  return true;
+}
+
+NetlinkRouteView::NetlinkRouteView(const struct nlmsghdr* nlmsg)
+    : nlmsg_(nlmsg),
+      rtmsg_(reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(nlmsg))) {
+  auto routeAttrLen = RTM_PAYLOAD(nlmsg);
+  for (auto* routeAttr = RTM_RTA(rtmsg_); RTA_OK(routeAttr, routeAttrLen);
+       routeAttr = RTA_NEXT(routeAttr, routeAttrLen)) {
+    if (routeAttr->rta_type < attributes_.size()) {
+      attributes_[routeAttr->rta_type] = routeAttr;
+    }
+  }
+}
+
+folly::ByteRange
+NetlinkRouteView::getAttribute(uint16_t type) const {
+  if (type >= attributes_.size() || !attributes_[type]) {
+    return folly::ByteRange();
+  }
+  const auto* attr = attributes_[type];
+  return folly::ByteRange(
+      reinterpret_cast<const uint8_t*>(RTA_DATA(attr)), RTA_PAYLOAD(attr));
+}
+
+folly::Optional<folly::CIDRNetwork>
+NetlinkRouteView::getDestination() const {
+  const auto dst = getAttribute(RTA_DST);
+  if (getFamily() == AF_INET && dst.size() == 4) {
+    return folly::CIDRNetwork(
+        folly::IPAddressV4::fromBinary(dst), rtmsg_->rtm_dst_len);
+  }
+  if (getFamily() == AF_INET6 && dst.size() == 16) {
+    return folly::CIDRNetwork(
+        folly::IPAddressV6::fromBinary(dst), rtmsg_->rtm_dst_len);
+  }
+  return folly::none;
+}
+
 std::vector<fbnl::NextHop>
 NetlinkRouteMessage::parseNextHops(
     const struct rtattr* routeAttrMP, unsigned char family) const {
@@ -608,7 +676,8 @@ NetlinkRouteMessage::parseNextHops(
 }
 
 ResultCode
-NetlinkRouteMessage::addRoute(const openr::fbnl::Route& route) {
+NetlinkRouteMessage::addRoute(
+    const openr::fbnl::Route& route, uint32_t nexthopId) {
   auto const& pfix = route.getDestination();
   auto ip = std::get<0>(pfix);
   auto plen = std::get<1>(pfix);
@@ -643,6 +712,15 @@ NetlinkRouteMessage::addRoute(const openr::fbnl::Route& route) {
     };
   }
 
+  // nexthops are referenced by nexthop object id
+  if (nexthopId != 0) {
+    return addAttributes(
+        kRtaNhId,
+        reinterpret_cast<const char*>(&nexthopId),
+        sizeof(nexthopId),
+        msghdr_);
+  }
+
   return addNextHops(route);
 }
 
@@ -727,6 +805,124 @@ NetlinkRouteMessage::deleteLabelRoute(const openr::fbnl::Route& route) {
   return status;
 }
 
+NetlinkNexthopMessage::NetlinkNexthopMessage() {
+  // get pointer to NLMSG header
+  msghdr_ = getMessagePtr();
+}
+
+void
+NetlinkNexthopMessage::init(int type, bool replace) {
+  if (type != kRtmNewNexthop && type != kRtmDelNexthop) {
+    LOG(ERROR) << "Incorrect Netlink message type";
+    return;
+  }
+  // initialize netlink header
+  msghdr_->nlmsg_len = NLMSG_LENGTH(sizeof(struct NhMsg));
+  msghdr_->nlmsg_type = type;
+  msghdr_->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+
+  if (type == kRtmNewNexthop) {
+    msghdr_->nlmsg_flags |= NLM_F_CREATE;
+    if (replace) {
+      msghdr_->nlmsg_flags |= NLM_F_REPLACE;
+    }
+  }
+
+  // intialize the nexthop message header, scope and flags must be zero
+  auto nlmsgAlen = NLMSG_ALIGN(sizeof(struct nlmsghdr));
+  nhmsg_ = reinterpret_cast<struct NhMsg*>((char*)msghdr_ + nlmsgAlen);
+  nhmsg_->family = AF_UNSPEC;
+  nhmsg_->scope = 0;
+  nhmsg_->protocol = 0;
+  nhmsg_->resvd = 0;
+  nhmsg_->flags = 0;
+}
+
+ResultCode
+NetlinkNexthopMessage::addNexthop(
+    uint32_t id,
+    uint8_t protocolId,
+    const openr::fbnl::NextHop& nextHop,
+    bool replace) {
+  VLOG(1) << "Adding nexthop object " << id << ": " << nextHop.str();
+  if (nextHop.getLabelAction().hasValue()) {
+    LOG(ERROR) << "Label action not supported for nexthop objects";
+    return ResultCode::UNKNOWN_LABEL_ACTION;
+  }
+  auto const via = nextHop.getGateway();
+  if (!via.hasValue()) {
+    LOG(ERROR) << "Nexthop IP not provided";
+    return ResultCode::NO_NEXTHOP_IP;
+  }
+
+  init(kRtmNewNexthop, replace);
+  nhmsg_->family = via.value().family();
+  nhmsg_->protocol = protocolId;
+
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = addAttributes(
+           kNhaId, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_)) !=
+      ResultCode::SUCCESS) {
+    return status;
+  }
+  if (nextHop.getIfIndex().hasValue()) {
+    const uint32_t oif = nextHop.getIfIndex().value();
+    if ((status = addAttributes(
+             kNhaOif,
+             reinterpret_cast<const char*>(&oif),
+             sizeof(oif),
+             msghdr_)) != ResultCode::SUCCESS) {
+      return status;
+    }
+  }
+  return addAttributes(
+      kNhaGateway,
+      reinterpret_cast<const char*>(via.value().bytes()),
+      via.value().byteCount(),
+      msghdr_);
+}
+
+ResultCode
+NetlinkNexthopMessage::addNexthopGroup(
+    uint32_t id,
+    uint8_t protocolId,
+    const NexthopGroupMembers& members,
+    bool replace) {
+  VLOG(1) << "Adding nexthop group " << id << " of " << members.size()
+          << " nexthops";
+  init(kRtmNewNexthop, replace);
+  nhmsg_->protocol = protocolId;
+
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = addAttributes(
+           kNhaId, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_)) !=
+      ResultCode::SUCCESS) {
+    return status;
+  }
+
+  std::vector<struct NhGroupEntry> entries;
+  for (const auto& member : members) {
+    struct NhGroupEntry entry {};
+    entry.id = member.first;
+    // kernel weight is one more than the encoded one, as for rtnh_hops
+    entry.weight = member.second ? member.second - 1 : 0;
+    entries.emplace_back(entry);
+  }
+  return addAttributes(
+      kNhaGroup,
+      reinterpret_cast<const char*>(entries.data()),
+      entries.size() * sizeof(struct NhGroupEntry),
+      msghdr_);
+}
+
+ResultCode
+NetlinkNexthopMessage::deleteNexthop(uint32_t id) {
+  VLOG(1) << "Deleting nexthop object " << id;
+  init(kRtmDelNexthop, false);
+  return addAttributes(
+      kNhaId, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_);
+}
+
 NetlinkLinkMessage::NetlinkLinkMessage() {
   // get pointer to NLMSG header
   msghdr_ = getMessagePtr();
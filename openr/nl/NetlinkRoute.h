@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <linux/lwtunnel.h>
 #include <linux/mpls.h>
 #include <linux/rtnetlink.h>
@@ -19,6 +21,8 @@
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
 
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/nl/NetlinkMessage.h>
@@ -36,6 +40,79 @@ constexpr uint32_t kLabelShift{12};
 constexpr uint32_t kLabelMask{0xFFFFF000};
 constexpr uint32_t kLabelSizeBits{20};
 
+// Nexthop objects (linux/nexthop.h), defined here to build against kernel
+// headers older than 5.3
+constexpr uint16_t kRtaNhId{30};
+constexpr uint16_t kRtmNewNexthop{104};
+constexpr uint16_t kRtmDelNexthop{105};
+constexpr uint16_t kNhaId{1};
+constexpr uint16_t kNhaGroup{2};
+constexpr uint16_t kNhaOif{5};
+constexpr uint16_t kNhaGateway{6};
+
+// Non-owning view of a received route message. Indexes the attributes of
+// the message without copying or parsing them, the message must outlive
+// the view. Use NetlinkRouteMessage::parseMessage to build the route
+class NetlinkRouteView {
+ public:
+  explicit NetlinkRouteView(const struct nlmsghdr* nlmsg);
+
+  // whether the route is added (RTM_NEWROUTE) rather than deleted
+  bool
+  isValid() const {
+    return nlmsg_->nlmsg_type == RTM_NEWROUTE;
+  }
+
+  uint8_t
+  getFamily() const {
+    return rtmsg_->rtm_family;
+  }
+
+  uint8_t
+  getProtocolId() const {
+    return rtmsg_->rtm_protocol;
+  }
+
+  uint8_t
+  getRouteTable() const {
+    return rtmsg_->rtm_table;
+  }
+
+  uint8_t
+  getType() const {
+    return rtmsg_->rtm_type;
+  }
+
+  uint8_t
+  getScope() const {
+    return rtmsg_->rtm_scope;
+  }
+
+  uint32_t
+  getFlags() const {
+    return rtmsg_->rtm_flags;
+  }
+
+  // payload of attribute type, empty if the message has none
+  folly::ByteRange getAttribute(uint16_t type) const;
+
+  // destination prefix of IP routes, without parsing the nexthops
+  folly::Optional<folly::CIDRNetwork> getDestination() const;
+
+  // underlying message
+  const struct nlmsghdr*
+  getMessage() const {
+    return nlmsg_;
+  }
+
+ private:
+  const struct nlmsghdr* const nlmsg_{nullptr};
+  const struct rtmsg* const rtmsg_{nullptr};
+
+  // last attribute of each type known at build time
+  std::array<const struct rtattr*, RTA_MAX + 1> attributes_{};
+};
+
 class NetlinkRouteMessage final : public NetlinkMessage {
  public:
   NetlinkRouteMessage();
@@ -53,8 +130,9 @@ class NetlinkRouteMessage final : public NetlinkMessage {
     return out;
   }
 
-  // add a unicast route
-  ResultCode addRoute(const openr::fbnl::Route& route);
+  // add a unicast route. If nexthopId is set the route references the
+  // nexthop object or group of that id instead of carrying its nexthops
+  ResultCode addRoute(const openr::fbnl::Route& route, uint32_t nexthopId = 0);
 
   // delete a route
   ResultCode deleteRoute(const openr::fbnl::Route& route);
@@ -71,6 +149,15 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   // process netlink route message
   fbnl::Route parseMessage(const struct nlmsghdr* nlmsg) const;
 
+  // stream the replies to this dump request to callback, skipping routes
+  // of other protocols than protocolId if set
+  void setDumpCallback(
+      RouteDumpCallback callback, folly::Optional<uint8_t> protocolId);
+
+  // pass a reply to this dump request to the dump callback. Returns false
+  // if there is no dump callback
+  bool processDumpReply(const struct nlmsghdr* nlmsg);
+
  private:
   // print ancillary data
   void showRtmMsg(const struct rtmsg* const hdr) const;
@@ -106,6 +193,12 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   // pointer to route message header
   struct rtmsg* rtmsg_{nullptr};
 
+  // receives the replies of a dump request
+  RouteDumpCallback dumpCallback_;
+
+  // only routes of this protocol are passed to dumpCallback_
+  folly::Optional<uint8_t> dumpProtocolId_;
+
   // add set of nexthops
   ResultCode addNextHops(const openr::fbnl::Route& route);
 
@@ -154,6 +247,57 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   } __attribute__((__packed__));
 };
 
+class NetlinkNexthopMessage final : public NetlinkMessage {
+ public:
+  NetlinkNexthopMessage();
+
+  // initiallize nexthop message with default params. An existing object of
+  // the same id is replaced only if replace is set
+  void init(int type, bool replace);
+
+  // create nexthop object. Only IP nexthops with a gateway are supported,
+  // label actions are not part of nexthop objects
+  ResultCode addNexthop(
+      uint32_t id,
+      uint8_t protocolId,
+      const openr::fbnl::NextHop& nextHop,
+      bool replace);
+
+  // create group of nexthop objects
+  ResultCode addNexthopGroup(
+      uint32_t id,
+      uint8_t protocolId,
+      const NexthopGroupMembers& members,
+      bool replace);
+
+  // delete nexthop object or group
+  ResultCode deleteNexthop(uint32_t id);
+
+ private:
+  // nexthop message header (struct nhmsg)
+  struct NhMsg {
+    uint8_t family;
+    uint8_t scope;
+    uint8_t protocol;
+    uint8_t resvd;
+    uint32_t flags;
+  } __attribute__((__packed__));
+
+  // nexthop group entry (struct nexthop_grp)
+  struct NhGroupEntry {
+    uint32_t id;
+    uint8_t weight;
+    uint8_t resvd1;
+    uint16_t resvd2;
+  } __attribute__((__packed__));
+
+  // pointer to nexthop message header
+  struct NhMsg* nhmsg_{nullptr};
+
+  // pointer to the netlink message header
+  struct nlmsghdr* msghdr_{nullptr};
+};
+
 class NetlinkLinkMessage final : public NetlinkMessage {
  public:
   NetlinkLinkMessage();
@@ -0,0 +1,335 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/nl/NetlinkRouteCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <folly/hash/Hash.h>
+
+namespace openr::fbnl {
+
+namespace {
+
+// table of protocolId, created along with the first route
+template <typename Table>
+Table&
+getMutableTable(
+    std::unordered_map<uint8_t, std::shared_ptr<Table>>& tables,
+    uint8_t protocolId) {
+  auto& table = tables[protocolId];
+  if (!table) {
+    table = std::make_shared<Table>();
+  } else if (table.use_count() > 1) {
+    // copy on write, snapshots keep the previous table
+    table = std::make_shared<Table>(*table);
+  }
+  return *table;
+}
+
+template <typename Table>
+std::shared_ptr<const Table>
+getTableSnapshot(
+    const std::unordered_map<uint8_t, std::shared_ptr<Table>>& tables,
+    uint8_t protocolId) {
+  auto it = tables.find(protocolId);
+  if (it == tables.end()) {
+    return std::make_shared<const Table>();
+  }
+  return it->second;
+}
+
+template <typename Table>
+size_t
+getNumRoutes(
+    const std::unordered_map<uint8_t, std::shared_ptr<Table>>& tables) {
+  size_t count{0};
+  for (const auto& kv : tables) {
+    count += kv.second->size();
+  }
+  return count;
+}
+
+// order independent hash of a nexthop set
+size_t
+hashNextHops(const NextHopSet& nextHops) {
+  size_t hash{nextHops.size()};
+  for (const auto& nextHop : nextHops) {
+    hash += folly::hash::twang_mix64(NextHopHash()(nextHop));
+  }
+  return hash;
+}
+
+// build a route with the attributes and nexthops of a cache entry
+RouteBuilder
+getRouteBuilder(uint8_t protocolId, const CachedRoute& route) {
+  RouteBuilder builder;
+  builder.setProtocolId(protocolId)
+      .setType(route.type)
+      .setRouteTable(route.routeTable)
+      .setScope(route.scope)
+      .setValid(route.isValid);
+  if (route.flags.hasValue()) {
+    builder.setFlags(route.flags.value());
+  }
+  if (route.priority.hasValue()) {
+    builder.setPriority(route.priority.value());
+  }
+  if (route.extra) {
+    if (route.extra->tos.hasValue()) {
+      builder.setTos(route.extra->tos.value());
+    }
+    if (route.extra->mtu.hasValue()) {
+      builder.setMtu(route.extra->mtu.value());
+    }
+    if (route.extra->advMss.hasValue()) {
+      builder.setAdvMss(route.extra->advMss.value());
+    }
+    if (route.extra->routeIfName.hasValue()) {
+      builder.setRouteIfName(route.extra->routeIfName.value());
+    }
+  }
+  if (route.nextHops) {
+    for (const auto& nextHop : *route.nextHops) {
+      builder.addNextHop(nextHop);
+    }
+  }
+  return builder;
+}
+
+} // anonymous namespace
+
+PackedPrefix::PackedPrefix(const folly::CIDRNetwork& prefix)
+    : length(prefix.second), isV4(prefix.first.isV4()) {
+  const auto bytes = prefix.first.bytes();
+  std::memcpy(
+      address.data(),
+      bytes,
+      std::min<size_t>(prefix.first.byteCount(), address.size()));
+}
+
+folly::CIDRNetwork
+PackedPrefix::toNetwork() const {
+  const folly::ByteRange bytes(address.data(), isV4 ? 4 : 16);
+  return folly::CIDRNetwork(
+      isV4 ? folly::IPAddress(folly::IPAddressV4::fromBinary(bytes))
+           : folly::IPAddress(folly::IPAddressV6::fromBinary(bytes)),
+      length);
+}
+
+bool
+operator==(const PackedPrefix& lhs, const PackedPrefix& rhs) {
+  return lhs.length == rhs.length && lhs.isV4 == rhs.isV4 &&
+      lhs.address == rhs.address;
+}
+
+size_t
+PackedPrefixHash::operator()(const PackedPrefix& prefix) const {
+  return folly::hash::hash_combine(
+      folly::hash::SpookyHashV2::Hash64(
+          prefix.address.data(), prefix.address.size(), 0),
+      prefix.length,
+      prefix.isV4);
+}
+
+bool
+CachedRoute::isSameRoute(const Route& route) const {
+  static const Extra kNoExtra;
+  const auto& extraAttrs = extra ? *extra : kNoExtra;
+  if (route.getType() != type || route.getRouteTable() != routeTable ||
+      route.getScope() != scope || route.isValid() != isValid ||
+      route.getFlags() != flags || route.getPriority() != priority ||
+      route.getTos() != extraAttrs.tos || route.getMtu() != extraAttrs.mtu ||
+      route.getAdvMss() != extraAttrs.advMss ||
+      route.getRouteIfName() != extraAttrs.routeIfName) {
+    return false;
+  }
+  if (!nextHops) {
+    return route.getNextHops().empty();
+  }
+  return *nextHops == route.getNextHops();
+}
+
+const CachedRoute*
+NetlinkRouteCache::getUnicastRoute(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) const {
+  auto tableIt = unicastRoutes_.find(protocolId);
+  if (tableIt == unicastRoutes_.end()) {
+    return nullptr;
+  }
+  auto it = tableIt->second->find(PackedPrefix(prefix));
+  return it == tableIt->second->end() ? nullptr : &it->second;
+}
+
+void
+NetlinkRouteCache::setUnicastRoute(const Route& route) {
+  auto& table = getMutableTable(unicastRoutes_, route.getProtocolId());
+  table.insert_or_assign(
+      PackedPrefix(route.getDestination()), makeCachedRoute(route));
+}
+
+bool
+NetlinkRouteCache::deleteUnicastRoute(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) {
+  if (!getUnicastRoute(protocolId, prefix)) {
+    return false;
+  }
+  getMutableTable(unicastRoutes_, protocolId).erase(PackedPrefix(prefix));
+  return true;
+}
+
+std::shared_ptr<const NetlinkRouteCache::UnicastRoutes>
+NetlinkRouteCache::getUnicastRoutes(uint8_t protocolId) const {
+  return getTableSnapshot(unicastRoutes_, protocolId);
+}
+
+size_t
+NetlinkRouteCache::getNumUnicastRoutes() const {
+  return getNumRoutes(unicastRoutes_);
+}
+
+const CachedRoute*
+NetlinkRouteCache::getMplsRoute(uint8_t protocolId, int32_t label) const {
+  auto tableIt = mplsRoutes_.find(protocolId);
+  if (tableIt == mplsRoutes_.end()) {
+    return nullptr;
+  }
+  auto it = tableIt->second->find(label);
+  return it == tableIt->second->end() ? nullptr : &it->second;
+}
+
+void
+NetlinkRouteCache::setMplsRoute(const Route& route) {
+  auto& table = getMutableTable(mplsRoutes_, route.getProtocolId());
+  table.insert_or_assign(
+      static_cast<int32_t>(route.getMplsLabel().value()),
+      makeCachedRoute(route));
+}
+
+bool
+NetlinkRouteCache::deleteMplsRoute(uint8_t protocolId, int32_t label) {
+  if (!getMplsRoute(protocolId, label)) {
+    return false;
+  }
+  getMutableTable(mplsRoutes_, protocolId).erase(label);
+  return true;
+}
+
+std::shared_ptr<const NetlinkRouteCache::MplsRoutes>
+NetlinkRouteCache::getMplsRoutes(uint8_t protocolId) const {
+  return getTableSnapshot(mplsRoutes_, protocolId);
+}
+
+size_t
+NetlinkRouteCache::getNumMplsRoutes() const {
+  return getNumRoutes(mplsRoutes_);
+}
+
+size_t
+NetlinkRouteCache::getNumNextHopSets() const {
+  size_t count{0};
+  for (const auto& kv : nextHopSets_) {
+    if (!kv.second.expired()) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+Route
+NetlinkRouteCache::toUnicastRoute(
+    uint8_t protocolId,
+    const folly::CIDRNetwork& prefix,
+    const CachedRoute& route) {
+  return getRouteBuilder(protocolId, route).setDestination(prefix).build();
+}
+
+Route
+NetlinkRouteCache::toMplsRoute(
+    uint8_t protocolId, int32_t label, const CachedRoute& route) {
+  return getRouteBuilder(protocolId, route).setMplsLabel(label).build();
+}
+
+NlUnicastRoutes
+NetlinkRouteCache::toNlUnicastRoutes(
+    uint8_t protocolId, const UnicastRoutes& routes) {
+  NlUnicastRoutes nlRoutes;
+  nlRoutes.reserve(routes.size());
+  for (const auto& kv : routes) {
+    const auto prefix = kv.first.toNetwork();
+    nlRoutes.emplace(prefix, toUnicastRoute(protocolId, prefix, kv.second));
+  }
+  return nlRoutes;
+}
+
+NlMplsRoutes
+NetlinkRouteCache::toNlMplsRoutes(
+    uint8_t protocolId, const MplsRoutes& routes) {
+  NlMplsRoutes nlRoutes;
+  nlRoutes.reserve(routes.size());
+  for (const auto& kv : routes) {
+    nlRoutes.emplace(kv.first, toMplsRoute(protocolId, kv.first, kv.second));
+  }
+  return nlRoutes;
+}
+
+CachedRoute
+NetlinkRouteCache::makeCachedRoute(const Route& route) {
+  CachedRoute cachedRoute;
+  cachedRoute.nextHops = internNextHops(route.getNextHops());
+  if (route.getTos().hasValue() || route.getMtu().hasValue() ||
+      route.getAdvMss().hasValue() || route.getRouteIfName().hasValue()) {
+    auto extra = std::make_shared<CachedRoute::Extra>();
+    extra->tos = route.getTos();
+    extra->mtu = route.getMtu();
+    extra->advMss = route.getAdvMss();
+    extra->routeIfName = route.getRouteIfName();
+    cachedRoute.extra = std::move(extra);
+  }
+  cachedRoute.flags = route.getFlags();
+  cachedRoute.priority = route.getPriority();
+  cachedRoute.type = route.getType();
+  cachedRoute.routeTable = route.getRouteTable();
+  cachedRoute.scope = route.getScope();
+  cachedRoute.isValid = route.isValid();
+  return cachedRoute;
+}
+
+std::shared_ptr<const NextHopSet>
+NetlinkRouteCache::internNextHops(const NextHopSet& nextHops) {
+  if (nextHops.empty()) {
+    return nullptr;
+  }
+
+  const auto hash = hashNextHops(nextHops);
+  auto range = nextHopSets_.equal_range(hash);
+  for (auto it = range.first; it != range.second;) {
+    auto interned = it->second.lock();
+    if (!interned) {
+      it = nextHopSets_.erase(it);
+      continue;
+    }
+    if (*interned == nextHops) {
+      return interned;
+    }
+    ++it;
+  }
+
+  if (nextHopSets_.size() >= nextHopSetsPurgeSize_) {
+    for (auto it = nextHopSets_.begin(); it != nextHopSets_.end();) {
+      it = it->second.expired() ? nextHopSets_.erase(it) : std::next(it);
+    }
+    nextHopSetsPurgeSize_ = std::max<size_t>(1024, 2 * nextHopSets_.size());
+  }
+
+  auto interned = std::make_shared<const NextHopSet>(nextHops);
+  nextHopSets_.emplace(hash, interned);
+  return interned;
+}
+
+} // namespace openr::fbnl
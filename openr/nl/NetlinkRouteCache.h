@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <folly/container/F14Map.h>
+
+#include <openr/common/LabelTable.h>
+#include <openr/nl/NetlinkTypes.h>
+
+namespace openr::fbnl {
+
+// IP prefix packed into 18 bytes, hashed and compared as raw bytes
+struct PackedPrefix {
+  PackedPrefix() = default;
+
+  explicit PackedPrefix(const folly::CIDRNetwork& prefix);
+
+  folly::CIDRNetwork toNetwork() const;
+
+  // address bytes in network order, IPv4 addresses use the first 4
+  std::array<uint8_t, 16> address{};
+  uint8_t length{0};
+  bool isV4{false};
+};
+
+bool operator==(const PackedPrefix& lhs, const PackedPrefix& rhs);
+
+struct PackedPrefixHash {
+  size_t operator()(const PackedPrefix& prefix) const;
+};
+
+// Route of a cache table, without its key and protocol. Immutable parts are
+// shared: the nexthop set with all cached routes having the same nexthops,
+// and the rarely set attributes
+struct CachedRoute {
+  struct Extra {
+    folly::Optional<uint8_t> tos;
+    folly::Optional<uint32_t> mtu;
+    folly::Optional<uint32_t> advMss;
+    folly::Optional<std::string> routeIfName;
+  };
+
+  // whether route has the same attributes and nexthops
+  bool isSameRoute(const Route& route) const;
+
+  std::shared_ptr<const NextHopSet> nextHops;
+  // nullptr if none of its attributes is set
+  std::shared_ptr<const Extra> extra;
+  folly::Optional<uint32_t> flags;
+  folly::Optional<uint32_t> priority;
+  uint8_t type{RTN_UNICAST};
+  uint8_t routeTable{RT_TABLE_MAIN};
+  uint8_t scope{RT_SCOPE_UNIVERSE};
+  bool isValid{false};
+};
+
+//
+// Cache of the unicast and MPLS routes programmed by NetlinkSocket, per
+// protocol. Tables are flat maps of compact entries, label indexed arrays
+// for MPLS routes, nexthop sets are interned. Readers get an immutable
+// snapshot of a table which they share with the cache, the cache copies a
+// table on write only while a snapshot of it is alive.
+//
+// Not thread safe, snapshots can be read from any thread.
+//
+class NetlinkRouteCache {
+ public:
+  using UnicastRoutes =
+      folly::F14FastMap<PackedPrefix, CachedRoute, PackedPrefixHash>;
+  // indexed by label within the segment routing label ranges
+  using MplsRoutes = LabelTable<CachedRoute>;
+
+  NetlinkRouteCache() = default;
+
+  NetlinkRouteCache(const NetlinkRouteCache&) = delete;
+  NetlinkRouteCache& operator=(const NetlinkRouteCache&) = delete;
+
+  // cached route of prefix, nullptr if there is none. The entry is valid
+  // until the next update of the cache
+  const CachedRoute* getUnicastRoute(
+      uint8_t protocolId, const folly::CIDRNetwork& prefix) const;
+
+  // add or replace the route of its destination
+  void setUnicastRoute(const Route& route);
+
+  // remove the route of prefix. Returns false if there was none
+  bool deleteUnicastRoute(uint8_t protocolId, const folly::CIDRNetwork& prefix);
+
+  // snapshot of the routes of protocolId, never nullptr
+  std::shared_ptr<const UnicastRoutes> getUnicastRoutes(
+      uint8_t protocolId) const;
+
+  // number of unicast routes of all protocols
+  size_t getNumUnicastRoutes() const;
+
+  // same for MPLS routes, keyed by label
+  const CachedRoute* getMplsRoute(uint8_t protocolId, int32_t label) const;
+
+  void setMplsRoute(const Route& route);
+
+  bool deleteMplsRoute(uint8_t protocolId, int32_t label);
+
+  std::shared_ptr<const MplsRoutes> getMplsRoutes(uint8_t protocolId) const;
+
+  size_t getNumMplsRoutes() const;
+
+  // number of distinct nexthop sets in use
+  size_t getNumNextHopSets() const;
+
+  // build the routes of cache entries
+  static Route toUnicastRoute(
+      uint8_t protocolId,
+      const folly::CIDRNetwork& prefix,
+      const CachedRoute& route);
+
+  static Route toMplsRoute(
+      uint8_t protocolId, int32_t label, const CachedRoute& route);
+
+  // routes of snapshots, in the representation of NetlinkSocket callers
+  static NlUnicastRoutes toNlUnicastRoutes(
+      uint8_t protocolId, const UnicastRoutes& routes);
+
+  static NlMplsRoutes toNlMplsRoutes(
+      uint8_t protocolId, const MplsRoutes& routes);
+
+ private:
+  CachedRoute makeCachedRoute(const Route& route);
+
+  // shared copy of nextHops, nullptr for an empty set
+  std::shared_ptr<const NextHopSet> internNextHops(const NextHopSet& nextHops);
+
+  std::unordered_map<uint8_t, std::shared_ptr<UnicastRoutes>> unicastRoutes_;
+
+  std::unordered_map<uint8_t, std::shared_ptr<MplsRoutes>> mplsRoutes_;
+
+  // interned nexthop sets by hash, expired ones are purged as the number
+  // of entries doubles
+  std::unordered_multimap<size_t, std::weak_ptr<const NextHopSet>> nextHopSets_;
+
+  size_t nextHopSetsPurgeSize_{1024};
+};
+
+} // namespace openr::fbnl
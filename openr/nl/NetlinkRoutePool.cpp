@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/nl/NetlinkRoutePool.h>
+
+#include <folly/Format.h>
+#include <folly/futures/Future.h>
+#include <folly/system/ThreadName.h>
+#include <glog/logging.h>
+
+namespace openr::fbnl {
+
+NetlinkRoutePool::NetlinkRoutePool(size_t numSockets, uint32_t messageWindow) {
+  CHECK_GT(numSockets, 0);
+  for (size_t i = 0; i < numSockets; ++i) {
+    auto evl = std::make_unique<fbzmq::ZmqEventLoop>();
+    // no route events, the sockets only program routes
+    auto socket = std::make_unique<NetlinkProtocolSocket>(
+        evl.get(), messageWindow, std::vector<uint8_t>{});
+    threads_.emplace_back([evl = evl.get(), socket = socket.get(), i]() {
+      folly::setThreadName(folly::sformat("NetlinkRoutePool{}", i));
+      socket->init(false /* subscribeEvents */);
+      evl->run();
+    });
+    evl->waitUntilRunning();
+    eventLoops_.emplace_back(std::move(evl));
+    sockets_.emplace_back(std::move(socket));
+  }
+  executor_ = std::make_unique<folly::CPUThreadPoolExecutor>(numSockets);
+  LOG(INFO) << "Programming routes through " << numSockets
+            << " netlink sockets";
+}
+
+NetlinkRoutePool::~NetlinkRoutePool() {
+  executor_.reset();
+  for (auto& evl : eventLoops_) {
+    evl->stop();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+NlBatchResult
+NetlinkRoutePool::addRouteBatch(
+    const std::vector<Route>& routes, const std::vector<uint32_t>& nexthopIds) {
+  CHECK(nexthopIds.empty() || nexthopIds.size() == routes.size());
+  return sendSharded(
+      routes,
+      [&routes, &nexthopIds](
+          NetlinkProtocolSocket& socket, std::vector<size_t> const& indices) {
+        std::vector<Route> shardRoutes;
+        std::vector<uint32_t> shardNexthopIds;
+        shardRoutes.reserve(indices.size());
+        for (const auto i : indices) {
+          shardRoutes.emplace_back(routes[i]);
+          if (!nexthopIds.empty()) {
+            shardNexthopIds.emplace_back(nexthopIds[i]);
+          }
+        }
+        return socket.addRouteBatch(shardRoutes, shardNexthopIds);
+      });
+}
+
+NlBatchResult
+NetlinkRoutePool::deleteRouteBatch(const std::vector<Route>& routes) {
+  return sendSharded(
+      routes,
+      [&routes](
+          NetlinkProtocolSocket& socket, std::vector<size_t> const& indices) {
+        std::vector<Route> shardRoutes;
+        shardRoutes.reserve(indices.size());
+        for (const auto i : indices) {
+          shardRoutes.emplace_back(routes[i]);
+        }
+        return socket.deleteRouteBatch(shardRoutes);
+      });
+}
+
+std::vector<uint32_t>
+NetlinkRoutePool::getPids() const {
+  std::vector<uint32_t> pids;
+  for (const auto& socket : sockets_) {
+    pids.emplace_back(socket->getPid());
+  }
+  return pids;
+}
+
+size_t
+NetlinkRoutePool::getShard(const Route& route, size_t numSockets) {
+  if (route.getFamily() == AF_MPLS) {
+    return std::hash<uint32_t>()(route.getMplsLabel().value_or(0)) %
+        numSockets;
+  }
+  return std::hash<folly::CIDRNetwork>()(route.getDestination()) % numSockets;
+}
+
+NlBatchResult
+NetlinkRoutePool::sendSharded(
+    const std::vector<Route>& routes,
+    const std::function<NlBatchResult(
+        NetlinkProtocolSocket& socket, std::vector<size_t> const& indices)>&
+        sendShard) {
+  const size_t numShards = sockets_.size();
+  std::vector<std::vector<size_t>> shards(numShards);
+  for (size_t i = 0; i < routes.size(); ++i) {
+    shards[getShard(routes[i], numShards)].emplace_back(i);
+  }
+
+  std::vector<NlBatchResult> shardResults(numShards);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    if (shards[i].empty()) {
+      continue;
+    }
+    futures.emplace_back(folly::via(executor_.get(), [&, i]() {
+      shardResults[i] = sendShard(*sockets_[i], shards[i]);
+    }));
+  }
+  folly::collect(futures).get();
+
+  // one result for the batch, in the order of routes
+  NlBatchResult result;
+  result.statuses.resize(routes.size(), 0);
+  for (size_t i = 0; i < numShards; ++i) {
+    const auto& shardResult = shardResults[i];
+    for (size_t j = 0; j < shardResult.statuses.size(); ++j) {
+      result.statuses[shards[i][j]] = shardResult.statuses[j];
+    }
+    result.numFailed += shardResult.numFailed;
+  }
+  return result;
+}
+
+} // namespace openr::fbnl
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <openr/nl/NetlinkMessage.h>
+#include <openr/nl/NetlinkTypes.h>
+
+namespace openr::fbnl {
+
+/**
+ * Netlink sockets programming batches of routes in parallel, each with its
+ * own event loop thread and message window. A batch is sharded by prefix
+ * hash, label for MPLS routes, and the shards are sent concurrently from
+ * worker threads. A route always maps to the same socket, and batch calls
+ * return once all shards are acked, so changes to a route are applied in
+ * order as long as batches are not sent concurrently.
+ *
+ * The sockets receive no events. Route changes made through them are seen
+ * as events by other sockets, which must ignore their pids, see
+ * NetlinkProtocolSocket::addRouteEventIgnoredPids().
+ */
+class NetlinkRoutePool {
+ public:
+  NetlinkRoutePool(size_t numSockets, uint32_t messageWindow);
+
+  ~NetlinkRoutePool();
+
+  // add a batch of IP or label routes, see
+  // NetlinkProtocolSocket::addRouteBatch(). Returns the status of each route
+  NlBatchResult addRouteBatch(
+      const std::vector<Route>& routes,
+      const std::vector<uint32_t>& nexthopIds = {});
+
+  // delete a batch of IP or label routes, see
+  // NetlinkProtocolSocket::deleteRouteBatch(). Returns the status of each
+  // route
+  NlBatchResult deleteRouteBatch(const std::vector<Route>& routes);
+
+  // pids of the request sockets
+  std::vector<uint32_t> getPids() const;
+
+  size_t
+  size() const {
+    return sockets_.size();
+  }
+
+  // socket programming route, of numSockets
+  static size_t getShard(const Route& route, size_t numSockets);
+
+ private:
+  NetlinkRoutePool(const NetlinkRoutePool&) = delete;
+  NetlinkRoutePool& operator=(const NetlinkRoutePool&) = delete;
+
+  // send the routes of each shard through its socket with sendShard, and
+  // gather the statuses in the order of routes
+  NlBatchResult sendSharded(
+      const std::vector<Route>& routes,
+      const std::function<NlBatchResult(
+          NetlinkProtocolSocket& socket, std::vector<size_t> const& indices)>&
+          sendShard);
+
+  std::vector<std::unique_ptr<fbzmq::ZmqEventLoop>> eventLoops_;
+  std::vector<std::unique_ptr<NetlinkProtocolSocket>> sockets_;
+  std::vector<std::thread> threads_;
+
+  // sends the shards, sendBatch() blocks until acked
+  std::unique_ptr<folly::CPUThreadPoolExecutor> executor_;
+};
+
+} // namespace openr::fbnl
@@ -6,51 +6,85 @@
  */
 
 #include <openr/nl/NetlinkSocket.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <openr/if/gen-cpp2/Platform_constants.h>
+#include <openr/nl/NetlinkRoute.h>
 
 namespace openr::fbnl {
 
 NetlinkSocket::NetlinkSocket(
     fbzmq::ZmqEventLoop* evl,
     EventsHandler* handler,
-    std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlSock)
-    : evl_(evl), handler_(handler), nlSock_(std::move(nlSock)) {
+    std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlSock,
+    bool useNexthopObjects,
+    std::unique_ptr<NetlinkRoutePool> routePool)
+    : evl_(evl),
+      useNexthopObjects_(useNexthopObjects),
+      handler_(handler),
+      nlSock_(std::move(nlSock)),
+      routePool_(std::move(routePool)) {
   CHECK(evl_ != nullptr) << "Missing event loop.";
 
   CHECK(nlSock_ != nullptr) << "Missing NetlinkProtocolSocket";
 
+  if (routePool_) {
+    // changes made through the pool are cached already
+    nlSock_->addRouteEventIgnoredPids(routePool_->getPids());
+  }
+
   // Instantiate local link and neighbor caches
   getAllReachableNeighbors().get();
 
-  // Pass link and address callbacks to NetlinkProtocolSocket
+  // Pass event callbacks to NetlinkProtocolSocket. Events are queued and
+  // handled as a batch once the receive pass that got them is over.
+  // Route events don't touch the unicast route cache, it tracks the routes
+  // programmed through this socket
   nlSock_->setLinkEventCB([this](
       openr::fbnl::Link link, bool runHandler) noexcept {
-    evl_->runImmediatelyOrInEventLoop([this,
-                                       link = std::move(link),
-
-                                       runHandler = runHandler]() mutable {
-      doHandleLinkEvent(link, runHandler);
-    });
+    evl_->runImmediatelyOrInEventLoop(
+        [this, link = std::move(link), runHandler]() mutable {
+          queueEvent(std::move(link), runHandler);
+        });
   });
 
   nlSock_->setAddrEventCB([this](
       openr::fbnl::IfAddress ifAddr, bool runHandler) noexcept {
-    evl_->runImmediatelyOrInEventLoop([this,
-                                       ifAddr = std::move(ifAddr),
-
-                                       runHandler = runHandler]() mutable {
-      doHandleAddrEvent(ifAddr, runHandler);
-    });
+    evl_->runImmediatelyOrInEventLoop(
+        [this, ifAddr = std::move(ifAddr), runHandler]() mutable {
+          queueEvent(std::move(ifAddr), runHandler);
+        });
   });
 
   nlSock_->setNeighborEventCB([this](
       openr::fbnl::Neighbor neigh, bool runHandler) noexcept {
-    evl_->runImmediatelyOrInEventLoop([this,
-                                       neigh = std::move(neigh),
+    evl_->runImmediatelyOrInEventLoop(
+        [this, neigh = std::move(neigh), runHandler]() mutable {
+          queueEvent(std::move(neigh), runHandler);
+        });
+  });
 
-                                       runHandler = runHandler]() mutable {
-      doHandleNeighborEvent(neigh, runHandler);
-    });
+  nlSock_->setRouteEventCB([this](
+      openr::fbnl::Route route, bool runHandler) noexcept {
+    evl_->runImmediatelyOrInEventLoop(
+        [this, route = std::move(route), runHandler]() mutable {
+          queueEvent(std::move(route), runHandler);
+        });
+  });
+
+  nlSock_->setEventsDrainedCB([this]() noexcept {
+    evl_->runImmediatelyOrInEventLoop([this]() { doHandleEventBatch(); });
+  });
+
+  // events lost to an overflow are recovered from dumps, later overflows
+  // until the resync runs are covered by the same one
+  nlSock_->setEventsLostCB([this]() noexcept {
+    if (not resyncPending_.exchange(true)) {
+      evl_->runImmediatelyOrInEventLoop([this]() { doResyncEvents(); });
+    }
   });
 
   // need to reload routes from kernel to avoid re-adding existing route
@@ -65,7 +99,11 @@ NetlinkSocket::~NetlinkSocket() {
 void
 NetlinkSocket::doHandleRouteEvent(
     Route route, bool runHandler, bool updateUnicastRoute) noexcept {
-  auto routeCopy = Route(route);
+  // the cache takes the route, the handler gets a copy if it runs
+  folly::Optional<Route> routeCopy;
+  if (handler_ && runHandler && eventFlags_[ROUTE_EVENT]) {
+    routeCopy = route;
+  }
   try {
     doUpdateRouteCache(std::move(route), updateUnicastRoute);
   } catch (const folly::InvalidAddressFamilyException& ex) {
@@ -75,17 +113,26 @@ NetlinkSocket::doHandleRouteEvent(
     LOG(ERROR) << "UpdateCacheFailed";
   }
 
-  if (handler_ && runHandler && eventFlags_[ROUTE_EVENT]) {
-    std::string ifName = routeCopy.getRouteIfName().hasValue()
-        ? routeCopy.getRouteIfName().value()
+  if (routeCopy.hasValue()) {
+    std::string ifName = routeCopy->getRouteIfName().hasValue()
+        ? routeCopy->getRouteIfName().value()
         : "";
-    EventVariant event = std::move(routeCopy);
+    EventVariant event = std::move(routeCopy).value();
     handler_->handleEvent(ifName, event);
   }
 }
 
 void
 NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
+  const auto linkName = applyLinkEvent(link);
+  if (handler_ && runHandler && eventFlags_[LINK_EVENT]) {
+    EventVariant event = std::move(link);
+    handler_->handleEvent(linkName, event);
+  }
+}
+
+std::string
+NetlinkSocket::applyLinkEvent(const Link& link) {
   const auto linkName = link.getLinkName();
   auto& linkAttr = links_[linkName];
   linkAttr.isUp = link.isUp();
@@ -96,10 +143,7 @@ NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
   if (!linkAttr.isUp) {
     removeNeighborCacheEntries(linkName);
   }
-  if (handler_ && runHandler && eventFlags_[LINK_EVENT]) {
-    EventVariant event = std::move(link);
-    handler_->handleEvent(linkName, event);
-  }
+  return linkName;
 }
 
 void
@@ -115,40 +159,181 @@ NetlinkSocket::removeNeighborCacheEntries(const std::string& ifName) {
 
 void
 NetlinkSocket::doHandleAddrEvent(IfAddress ifAddr, bool runHandler) noexcept {
+  std::string ifName = applyAddrEvent(ifAddr);
+  if (handler_ && runHandler && eventFlags_[ADDR_EVENT]) {
+    EventVariant event = std::move(ifAddr);
+    handler_->handleEvent(ifName, event);
+  }
+}
+
+std::string
+NetlinkSocket::applyAddrEvent(const IfAddress& ifAddr) {
   std::string ifName = getIfName(ifAddr.getIfIndex()).get();
   if (ifAddr.isValid()) {
     if (links_[ifName].networks.count(ifAddr.getPrefix().value()) == 0) {
       links_[ifName].networks.insert(ifAddr.getPrefix().value());
     }
+    addAddrCacheEntry(ifAddr);
   } else if (!ifAddr.isValid()) {
     auto it = links_.find(ifName);
     if (it != links_.end()) {
       it->second.networks.erase(ifAddr.getPrefix().value());
     }
+    removeAddrCacheEntry(ifAddr.getIfIndex(), ifAddr.getPrefix().value());
   }
-
-  if (handler_ && runHandler && eventFlags_[ADDR_EVENT]) {
-    EventVariant event = std::move(ifAddr);
-    handler_->handleEvent(ifName, event);
-  }
+  return ifName;
 }
 
 void
 NetlinkSocket::doHandleNeighborEvent(
     Neighbor neighbor, bool runHandler) noexcept {
+  NeighborUpdate neighborUpdate;
+  std::string ifName = applyNeighborEvent(neighbor, neighborUpdate);
+
+  if (neighborListener_) {
+    std::lock_guard<std::mutex> g(neighborListenerMutex_);
+    try {
+      neighborListener_(neighborUpdate);
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "neighbor call failed: " << ex.what();
+    }
+  }
+
+  if (handler_ && runHandler && eventFlags_[NEIGH_EVENT]) {
+    EventVariant event = std::move(neighbor);
+    handler_->handleEvent(ifName, event);
+  }
+}
+
+std::string
+NetlinkSocket::applyNeighborEvent(
+    const Neighbor& neighbor, NeighborUpdate& neighborUpdate) {
   std::string ifName = getIfName(neighbor.getIfIndex()).get();
   auto key = std::make_pair(ifName, neighbor.getDestination());
   neighbors_.erase(key);
 
-  NeighborUpdate neighborUpdate;
   if (neighbor.isReachable()) {
     neighbors_.emplace(std::make_pair(key, neighbor));
     neighborUpdate.addNeighbor(neighbor.getDestination().str());
   } else {
     neighborUpdate.delNeighbor(neighbor.getDestination().str());
   }
+  return ifName;
+}
 
-  if (neighborListener_) {
+namespace {
+
+// the link, address or neighbor an event is of, none for route events
+struct EventKeyVisitor {
+  folly::Optional<std::string>
+  operator()(Link const& link) const {
+    return folly::sformat("link:{}", link.getIfIndex());
+  }
+
+  folly::Optional<std::string>
+  operator()(IfAddress const& addr) const {
+    if (not addr.getPrefix().hasValue()) {
+      return folly::none;
+    }
+    return folly::sformat(
+        "addr:{}:{}",
+        addr.getIfIndex(),
+        folly::IPAddress::networkToString(addr.getPrefix().value()));
+  }
+
+  folly::Optional<std::string>
+  operator()(Neighbor const& neigh) const {
+    return folly::sformat(
+        "neigh:{}:{}", neigh.getIfIndex(), neigh.getDestination().str());
+  }
+
+  folly::Optional<std::string>
+  operator()(Route const& /* route */) const {
+    return folly::none;
+  }
+};
+
+} // namespace
+
+void
+NetlinkSocket::queueEvent(EventVariant event, bool runHandler) noexcept {
+  auto key = std::visit(EventKeyVisitor(), event);
+  if (key.hasValue()) {
+    auto it = queuedEventIndex_.find(key.value());
+    if (it != queuedEventIndex_.end()) {
+      // keep the latest state only, at the position it was received at
+      queuedEvents_[it->second].clear();
+      it->second = queuedEvents_.size();
+      ++numEventsCoalesced_;
+    } else {
+      queuedEventIndex_.emplace(std::move(key).value(), queuedEvents_.size());
+    }
+  }
+  queuedEvents_.emplace_back(QueuedEvent{std::move(event), runHandler});
+}
+
+void
+NetlinkSocket::doHandleEventBatch() noexcept {
+  // handlers may call back into us, work on the batch as is
+  auto queuedEvents = std::move(queuedEvents_);
+  queuedEvents_.clear();
+  queuedEventIndex_.clear();
+  if (queuedEvents.empty()) {
+    return;
+  }
+  ++numEventBatches_;
+
+  NeighborUpdate neighborUpdate;
+  bool hasNeighborEvents{false};
+  std::vector<std::pair<std::string, EventVariant>> handlerEvents;
+  for (auto& queuedEvent : queuedEvents) {
+    if (not queuedEvent.hasValue()) {
+      continue; // superseded
+    }
+    const bool runHandler = handler_ && queuedEvent->runHandler;
+    auto& event = queuedEvent->event;
+    if (auto* link = std::get_if<Link>(&event)) {
+      auto ifName = applyLinkEvent(*link);
+      if (runHandler && eventFlags_[LINK_EVENT]) {
+        handlerEvents.emplace_back(std::move(ifName), std::move(event));
+      }
+    } else if (auto* ifAddr = std::get_if<IfAddress>(&event)) {
+      auto ifName = applyAddrEvent(*ifAddr);
+      if (runHandler && eventFlags_[ADDR_EVENT]) {
+        handlerEvents.emplace_back(std::move(ifName), std::move(event));
+      }
+    } else if (auto* neighbor = std::get_if<Neighbor>(&event)) {
+      auto ifName = applyNeighborEvent(*neighbor, neighborUpdate);
+      hasNeighborEvents = true;
+      if (runHandler && eventFlags_[NEIGH_EVENT]) {
+        handlerEvents.emplace_back(std::move(ifName), std::move(event));
+      }
+    } else if (auto* route = std::get_if<Route>(&event)) {
+      const bool runRouteHandler = runHandler && eventFlags_[ROUTE_EVENT];
+      // the cache takes the route unless the handler gets it
+      folly::Optional<Route> routeCopy;
+      if (runRouteHandler) {
+        routeCopy = *route;
+      }
+      try {
+        doUpdateRouteCache(std::move(*route), false);
+      } catch (const folly::InvalidAddressFamilyException& ex) {
+        // Empty address in route. Ignore it.
+        continue;
+      } catch (const std::exception& ex) {
+        LOG(ERROR) << "UpdateCacheFailed";
+      }
+      if (runRouteHandler) {
+        auto ifName = routeCopy->getRouteIfName().hasValue()
+            ? routeCopy->getRouteIfName().value()
+            : "";
+        handlerEvents.emplace_back(
+            std::move(ifName), std::move(routeCopy).value());
+      }
+    }
+  }
+
+  if (hasNeighborEvents && neighborListener_) {
     std::lock_guard<std::mutex> g(neighborListenerMutex_);
     try {
       neighborListener_(neighborUpdate);
@@ -157,10 +342,122 @@ NetlinkSocket::doHandleNeighborEvent(
     }
   }
 
-  if (handler_ && runHandler && eventFlags_[NEIGH_EVENT]) {
-    NeighborBuilder nhBuilder;
-    EventVariant event = std::move(neighbor);
-    handler_->handleEvent(ifName, event);
+  if (not handlerEvents.empty()) {
+    VLOG(2) << "Handling a batch of " << handlerEvents.size()
+            << " netlink events";
+    handler_->handleEventBatch(handlerEvents);
+  }
+}
+
+void
+NetlinkSocket::doResyncEvents() noexcept {
+  // events lost from now on need another resync
+  resyncPending_ = false;
+  // events queued before the loss are older than the dumps
+  queuedEvents_.clear();
+  queuedEventIndex_.clear();
+  ++numResyncs_;
+  LOG(INFO) << "Resyncing links, addresses and neighbors after lost events";
+  try {
+    // links added or changed
+    auto links = nlSock_->getAllLinks();
+    std::unordered_map<int, std::string> ifIndexToName;
+    for (auto& link : links) {
+      ifIndexToName.emplace(link.getIfIndex(), link.getLinkName());
+      auto it = links_.find(link.getLinkName());
+      if (it == links_.end() || it->second.isUp != link.isUp() ||
+          it->second.ifIndex != link.getIfIndex()) {
+        doHandleLinkEvent(std::move(link), true);
+      }
+    }
+
+    // addresses added or removed, of links still cached
+    auto addresses = nlSock_->getAllIfAddresses();
+    resetAddrCache(addresses);
+    std::unordered_map<std::string, std::vector<IfAddress>> linkAddresses;
+    for (auto& address : addresses) {
+      auto it = ifIndexToName.find(address.getIfIndex());
+      if (address.isValid() && it != ifIndexToName.end()) {
+        linkAddresses[it->second].emplace_back(std::move(address));
+      }
+    }
+    for (auto const& kv : links_) {
+      const auto ifIndex = kv.second.ifIndex;
+      std::unordered_set<folly::CIDRNetwork> networks;
+      for (auto& address : linkAddresses[kv.first]) {
+        networks.emplace(address.getPrefix().value());
+        if (kv.second.networks.count(address.getPrefix().value()) == 0) {
+          doHandleAddrEvent(std::move(address), true);
+        }
+      }
+      std::vector<folly::CIDRNetwork> removedNetworks;
+      for (auto const& network : kv.second.networks) {
+        if (networks.count(network) == 0) {
+          removedNetworks.emplace_back(network);
+        }
+      }
+      for (auto const& network : removedNetworks) {
+        doHandleAddrEvent(
+            IfAddressBuilder()
+                .setIfIndex(ifIndex)
+                .setPrefix(network)
+                .setValid(false)
+                .build(),
+            true);
+      }
+    }
+
+    // links removed, reported down
+    std::vector<std::pair<std::string, int>> removedLinks;
+    for (auto const& kv : links_) {
+      if (ifIndexToName.count(kv.second.ifIndex) == 0 ||
+          ifIndexToName.at(kv.second.ifIndex) != kv.first) {
+        removedLinks.emplace_back(kv.first, kv.second.ifIndex);
+      }
+    }
+    for (auto const& removedLink : removedLinks) {
+      doHandleLinkEvent(
+          LinkBuilder()
+              .setLinkName(removedLink.first)
+              .setIfIndex(removedLink.second)
+              .build(),
+          true);
+      links_.erase(removedLink.first);
+    }
+
+    // neighbors whose reachability or link address changed
+    std::unordered_set<std::pair<std::string, folly::IPAddress>> seen;
+    for (auto& neighbor : nlSock_->getAllNeighbors()) {
+      auto it = ifIndexToName.find(neighbor.getIfIndex());
+      if (it == ifIndexToName.end()) {
+        continue;
+      }
+      auto key = std::make_pair(it->second, neighbor.getDestination());
+      auto cached = neighbors_.find(key);
+      seen.emplace(std::move(key));
+      if (neighbor.isReachable()
+              ? cached == neighbors_.end() || !(cached->second == neighbor)
+              : cached != neighbors_.end()) {
+        doHandleNeighborEvent(std::move(neighbor), true);
+      }
+    }
+    std::vector<Neighbor> removedNeighbors;
+    for (auto const& kv : neighbors_) {
+      if (seen.count(kv.first) == 0) {
+        removedNeighbors.emplace_back(
+            NeighborBuilder()
+                .setIfIndex(kv.second.getIfIndex())
+                .setDestination(kv.first.second)
+                .setState(NUD_FAILED, true)
+                .build());
+      }
+    }
+    for (auto& neighbor : removedNeighbors) {
+      doHandleNeighborEvent(std::move(neighbor), true);
+    }
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to resync after lost events: "
+               << folly::exceptionStr(ex);
   }
 }
 
@@ -224,10 +521,8 @@ NetlinkSocket::doUpdateRouteCache(Route route, bool updateUnicastRoute) {
   }
 
   if (updateUnicastRoute) {
-    auto& unicastRoutes = unicastRoutesCache_[protocol];
     if (route.isValid()) {
-      unicastRoutes.erase(prefix);
-      unicastRoutes.emplace(prefix, std::move(route));
+      routeCache_.setUnicastRoute(route);
     }
     // NOTE: We are just updating cache. This called during initialization
   }
@@ -271,6 +566,48 @@ NetlinkSocket::addRoute(Route route) {
   return future;
 }
 
+folly::Future<folly::Unit>
+NetlinkSocket::addUnicastRoutes(std::vector<Route> routes) {
+  VLOG(3) << "NetlinkSocket add " << routes.size() << " unicast routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), rs = std::move(routes)]() mutable {
+        try {
+          doAddUpdateUnicastRoutes(std::move(rs));
+          p.setValue();
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error adding unicast routes. Exception: "
+                     << folly::exceptionStr(ex);
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::delUnicastRoutes(std::vector<Route> routes) {
+  VLOG(3) << "NetlinkSocket deleting " << routes.size() << " unicast routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), rs = std::move(routes)]() mutable {
+        try {
+          doDeleteUnicastRoutes(std::move(rs));
+          p.setValue();
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error deleting unicast routes. Exception: "
+                     << folly::exceptionStr(ex);
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
 folly::Future<folly::Unit>
 NetlinkSocket::addMplsRoute(Route mplsRoute) {
   auto prefix = mplsRoute.getDestination();
@@ -348,19 +685,18 @@ NetlinkSocket::syncMplsRoutes(uint8_t protocolId, NlMplsRoutes newMplsRouteDb) {
                                      protocolId]() mutable {
     try {
       LOG(INFO) << "Syncing " << syncDb.size() << " mpls routes";
-      auto& mplsRoutes = mplsRoutesCache_[protocolId];
-      std::unordered_set<int32_t> toDelete;
+      std::vector<Route> toDelete;
       // collect label routes to delete
-      for (auto const& kv : mplsRoutes) {
+      for (auto const& kv : *routeCache_.getMplsRoutes(protocolId)) {
         if (syncDb.find(kv.first) == syncDb.end()) {
-          toDelete.insert(kv.first);
+          toDelete.emplace_back(
+              NetlinkRouteCache::toMplsRoute(protocolId, kv.first, kv.second));
         }
       }
       // delete
       LOG(INFO) << "Sync: Deleting " << toDelete.size() << " mpls routes";
-      for (auto label : toDelete) {
-        auto mplsRouteEntry = mplsRoutes.at(label);
-        doDeleteMplsRoute(mplsRouteEntry);
+      for (auto& mplsRoute : toDelete) {
+        doDeleteMplsRoute(std::move(mplsRoute));
       }
       // Go over MPLS routes in new routeDb, update/add
       for (auto& kv : syncDb) {
@@ -381,17 +717,22 @@ folly::Future<NlMplsRoutes>
 NetlinkSocket::getCachedMplsRoutes(uint8_t protocolId) const {
   VLOG(3) << "NetlinkSocket get cached MPLS routes by protocol "
           << (int)protocolId;
-  folly::Promise<NlMplsRoutes> promise;
+  return getMplsRoutesSnapshot(protocolId).thenValue(
+      [protocolId](
+          std::shared_ptr<const NetlinkRouteCache::MplsRoutes> routes) {
+        return NetlinkRouteCache::toNlMplsRoutes(protocolId, *routes);
+      });
+}
+
+folly::Future<std::shared_ptr<const NetlinkRouteCache::MplsRoutes>>
+NetlinkSocket::getMplsRoutesSnapshot(uint8_t protocolId) const {
+  folly::Promise<std::shared_ptr<const NetlinkRouteCache::MplsRoutes>>
+      promise;
   auto future = promise.getFuture();
 
   evl_->runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), protocolId]() mutable {
-        auto iter = mplsRoutesCache_.find(protocolId);
-        if (iter != mplsRoutesCache_.end()) {
-          p.setValue(iter->second);
-        } else {
-          p.setValue(NlMplsRoutes{});
-        }
+        p.setValue(routeCache_.getMplsRoutes(protocolId));
       });
   return future;
 }
@@ -404,11 +745,7 @@ NetlinkSocket::getMplsRouteCount() const {
   auto future = promise.getFuture();
 
   evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
-    int64_t count = 0;
-    for (const auto& routes : mplsRoutesCache_) {
-      count += routes.second.size();
-    }
-    p.setValue(count);
+    p.setValue(routeCache_.getNumMplsRoutes());
   });
   return future;
 }
@@ -420,23 +757,11 @@ NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
   const auto& dest = route.getDestination();
 
   // Create new set of nexthops to be programmed. Existing + New ones
-  auto& unicastRoutes = unicastRoutesCache_[route.getProtocolId()];
-  auto iter = unicastRoutes.find(dest);
-  // if user did not speicify priority
-  if (!route.getPriority()) {
-    const auto routePair =
-        openr::thrift::Platform_constants::protocolIdtoPriority().find(
-            route.getProtocolId());
-    if (routePair ==
-        openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
-      route.setPriority(
-          openr::thrift::Platform_constants::kUnknowProtAdminDistance());
-    } else {
-      route.setPriority(routePair->second);
-    }
-  }
+  const auto* cachedRoute =
+      routeCache_.getUnicastRoute(route.getProtocolId(), dest);
+  setDefaultPriority(route);
   // Same route
-  if (iter != unicastRoutes.end() && iter->second == route) {
+  if (cachedRoute && cachedRoute->isSameRoute(route)) {
     return;
   }
 
@@ -446,33 +771,373 @@ NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
     // (like gateway or metric or..) the existing one will not be replaced,
     // instead a new route will be created, which may cause underlying kernel
     // crash when releasing netdevices
-    if (iter != unicastRoutes.end()) {
+    if (cachedRoute) {
       int err{0};
 
-      err = static_cast<int>(nlSock_->deleteRoute(iter->second));
+      const auto oldRoute = NetlinkRouteCache::toUnicastRoute(
+          route.getProtocolId(), dest, *cachedRoute);
+      err = static_cast<int>(nlSock_->deleteRoute(oldRoute));
 
       if (0 != err) {
         throw fbnl::NlException(folly::sformat(
-            "Failed to delete route\n{}\nError: {}", iter->second.str(), err));
+            "Failed to delete route\n{}\nError: {}", oldRoute.str(), err));
       }
     }
   }
 
   // Remove route from cache
-  unicastRoutes.erase(dest);
+  routeCache_.deleteUnicastRoute(route.getProtocolId(), dest);
 
   // Add new route
   int err{0};
-
-  err = static_cast<int>(nlSock_->addRoute(route));
+  folly::Optional<NexthopGroups::iterator> nexthopGroup;
+  if (useNexthopGroup(route)) {
+    nexthopGroup = acquireNexthopGroup(route);
+    err = static_cast<int>(
+        nlSock_->addRoute(route, nexthopGroup.value()->second.id));
+  } else {
+    err = static_cast<int>(nlSock_->addRoute(route));
+  }
 
   if (0 != err) {
+    if (nexthopGroup.hasValue()) {
+      releaseNexthopGroup(nexthopGroup.value());
+    }
     throw fbnl::NlException(
         folly::sformat("Could not add route\n{}\nError: {}", route.str(), err));
   }
 
+  // Release the previous group only now that the route no longer references
+  // it, deleting a group deletes the routes using it
+  releaseRouteNexthopGroup(route.getProtocolId(), dest);
+  if (nexthopGroup.hasValue()) {
+    routeNexthopGroups_[route.getProtocolId()].emplace(
+        dest, nexthopGroup.value());
+  }
+
   // Add route entry in cache on successful addition
-  unicastRoutes.emplace(std::make_pair(dest, std::move(route)));
+  routeCache_.setUnicastRoute(route);
+}
+
+void
+NetlinkSocket::setDefaultPriority(Route& route) {
+  // if user did not speicify priority
+  if (!route.getPriority()) {
+    const auto routePair =
+        openr::thrift::Platform_constants::protocolIdtoPriority().find(
+            route.getProtocolId());
+    if (routePair ==
+        openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
+      route.setPriority(
+          openr::thrift::Platform_constants::kUnknowProtAdminDistance());
+    } else {
+      route.setPriority(routePair->second);
+    }
+  }
+}
+
+void
+NetlinkSocket::doAddUpdateUnicastRoutes(std::vector<Route> routes) {
+  // changed routes, the nexthop group id of each and the previous IPv6
+  // routes to delete first (see doAddUpdateUnicastRoute)
+  std::vector<Route> toAdd;
+  std::vector<uint32_t> nexthopIds;
+  std::vector<folly::Optional<NexthopGroups::iterator>> nexthopGroups;
+  std::vector<Route> toDelete;
+  std::vector<size_t> toDeleteIndex;
+
+  auto releaseNewGroups = [&]() {
+    for (auto& nexthopGroup : nexthopGroups) {
+      if (nexthopGroup.hasValue()) {
+        releaseNexthopGroup(nexthopGroup.value());
+        nexthopGroup.clear();
+      }
+    }
+  };
+
+  try {
+    for (auto& route : routes) {
+      checkUnicastRoute(route);
+      setDefaultPriority(route);
+      const auto* cachedRoute = routeCache_.getUnicastRoute(
+          route.getProtocolId(), route.getDestination());
+      // Same route
+      if (cachedRoute && cachedRoute->isSameRoute(route)) {
+        continue;
+      }
+      if (route.getDestination().first.isV6() && cachedRoute) {
+        toDelete.emplace_back(NetlinkRouteCache::toUnicastRoute(
+            route.getProtocolId(), route.getDestination(), *cachedRoute));
+        toDeleteIndex.emplace_back(toAdd.size());
+      }
+      if (useNexthopGroup(route)) {
+        nexthopGroups.emplace_back(acquireNexthopGroup(route));
+        nexthopIds.emplace_back(nexthopGroups.back().value()->second.id);
+      } else {
+        nexthopGroups.emplace_back(folly::none);
+        nexthopIds.emplace_back(0);
+      }
+      toAdd.emplace_back(std::move(route));
+    }
+  } catch (std::exception const&) {
+    releaseNewGroups();
+    throw;
+  }
+  if (toAdd.empty()) {
+    return;
+  }
+
+  // routes whose previous IPv6 route could not be deleted are not added
+  std::vector<bool> skipAdd(toAdd.size(), false);
+  size_t numFailed{0};
+  if (!toDelete.empty()) {
+    const auto result = deleteUnicastRouteBatch(toDelete);
+    for (size_t i = 0; i < toDelete.size(); ++i) {
+      if (result.statuses[i] != 0) {
+        skipAdd[toDeleteIndex[i]] = true;
+        ++numFailed;
+      }
+    }
+  }
+
+  std::vector<Route> batch;
+  std::vector<uint32_t> batchNexthopIds;
+  std::vector<size_t> batchIndex;
+  for (size_t i = 0; i < toAdd.size(); ++i) {
+    if (!skipAdd[i]) {
+      batch.emplace_back(toAdd[i]);
+      batchNexthopIds.emplace_back(nexthopIds[i]);
+      batchIndex.emplace_back(i);
+    }
+  }
+  const auto result = addUnicastRouteBatch(batch, batchNexthopIds);
+
+  for (size_t j = 0; j < batch.size(); ++j) {
+    const auto i = batchIndex[j];
+    auto& route = toAdd[i];
+    const auto dest = route.getDestination();
+    // Remove route from cache
+    routeCache_.deleteUnicastRoute(route.getProtocolId(), dest);
+    if (result.statuses[j] != 0) {
+      ++numFailed;
+      continue;
+    }
+    // previous group is released once the route no longer references it
+    releaseRouteNexthopGroup(route.getProtocolId(), dest);
+    if (nexthopGroups[i].hasValue()) {
+      routeNexthopGroups_[route.getProtocolId()].emplace(
+          dest, nexthopGroups[i].value());
+      nexthopGroups[i].clear();
+    }
+    // Add route entry in cache on successful addition
+    routeCache_.setUnicastRoute(route);
+  }
+  // release the groups of the routes which failed
+  releaseNewGroups();
+
+  if (numFailed) {
+    throw fbnl::NlException(folly::sformat(
+        "Could not add {} of {} routes", numFailed, toAdd.size()));
+  }
+}
+
+void
+NetlinkSocket::doDeleteUnicastRoutes(std::vector<Route> routes) {
+  std::vector<Route> toDelete;
+  for (auto& route : routes) {
+    checkUnicastRoute(route);
+    if (!routeCache_.getUnicastRoute(
+            route.getProtocolId(), route.getDestination())) {
+      LOG(ERROR) << "Trying to delete non-existing prefix "
+                 << folly::IPAddress::networkToString(route.getDestination());
+      continue;
+    }
+    toDelete.emplace_back(std::move(route));
+  }
+  if (toDelete.empty()) {
+    return;
+  }
+
+  const auto result = deleteUnicastRouteBatch(toDelete);
+  for (size_t i = 0; i < toDelete.size(); ++i) {
+    if (result.statuses[i] != 0) {
+      continue;
+    }
+    // Update local cache with removed prefix
+    const auto& route = toDelete[i];
+    releaseRouteNexthopGroup(route.getProtocolId(), route.getDestination());
+    routeCache_.deleteUnicastRoute(
+        route.getProtocolId(), route.getDestination());
+  }
+
+  if (result.numFailed) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to delete {} of {} routes",
+        result.numFailed,
+        toDelete.size()));
+  }
+}
+
+NlBatchResult
+NetlinkSocket::addUnicastRouteBatch(
+    const std::vector<Route>& routes, const std::vector<uint32_t>& nexthopIds) {
+  if (routePool_) {
+    return routePool_->addRouteBatch(routes, nexthopIds);
+  }
+  return nlSock_->addRouteBatch(routes, nexthopIds);
+}
+
+NlBatchResult
+NetlinkSocket::deleteUnicastRouteBatch(const std::vector<Route>& routes) {
+  if (routePool_) {
+    return routePool_->deleteRouteBatch(routes);
+  }
+  return nlSock_->deleteRouteBatch(routes);
+}
+
+bool
+NetlinkSocket::useNexthopGroup(const Route& route) const {
+  if (not useNexthopObjects_ or route.getType() != RTN_UNICAST or
+      route.getNextHops().empty()) {
+    return false;
+  }
+  for (const auto& nextHop : route.getNextHops()) {
+    if (not nextHop.getGateway().hasValue() or
+        nextHop.getLabelAction().hasValue()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+NetlinkSocket::NexthopGroups::iterator
+NetlinkSocket::acquireNexthopGroup(const Route& route) {
+  std::vector<NextHop> nextHops;
+  NexthopGroupMembers members;
+  try {
+    for (const auto& nextHop : route.getNextHops()) {
+      members.emplace_back(
+          acquireNexthopObject(nextHop, route.getProtocolId()),
+          nextHop.getWeight());
+      nextHops.emplace_back(nextHop);
+    }
+  } catch (std::exception const&) {
+    for (const auto& nextHop : nextHops) {
+      releaseNexthopObject(nextHop);
+    }
+    throw;
+  }
+  std::sort(members.begin(), members.end());
+
+  auto it = nexthopGroups_.find(members);
+  if (it != nexthopGroups_.end()) {
+    // existing group already holds references to its nexthop objects
+    for (const auto& nextHop : nextHops) {
+      releaseNexthopObject(nextHop);
+    }
+  } else {
+    NexthopGroup group;
+    try {
+      group.id = createNexthopObject([&](uint32_t id) {
+        return nlSock_->addNexthopGroup(id, route.getProtocolId(), members);
+      });
+    } catch (std::exception const&) {
+      for (const auto& nextHop : nextHops) {
+        releaseNexthopObject(nextHop);
+      }
+      throw;
+    }
+    group.nextHops = std::move(nextHops);
+    it = nexthopGroups_.emplace(std::move(members), std::move(group)).first;
+  }
+  ++it->second.numRefs;
+  return it;
+}
+
+void
+NetlinkSocket::releaseNexthopGroup(NexthopGroups::iterator it) {
+  DCHECK_LT(0, it->second.numRefs);
+  if (--it->second.numRefs > 0) {
+    return;
+  }
+  // group goes before its nexthop objects
+  deleteNexthopObject(it->second.id);
+  for (const auto& nextHop : it->second.nextHops) {
+    releaseNexthopObject(nextHop);
+  }
+  nexthopGroups_.erase(it);
+}
+
+void
+NetlinkSocket::releaseRouteNexthopGroup(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) {
+  auto& routeGroups = routeNexthopGroups_[protocolId];
+  auto it = routeGroups.find(prefix);
+  if (it == routeGroups.end()) {
+    return;
+  }
+  releaseNexthopGroup(it->second);
+  routeGroups.erase(it);
+}
+
+uint32_t
+NetlinkSocket::acquireNexthopObject(
+    const NextHop& nextHop, uint8_t protocolId) {
+  auto it = nexthopObjects_.find(nextHop);
+  if (it == nexthopObjects_.end()) {
+    NexthopObject object;
+    object.id = createNexthopObject([&](uint32_t id) {
+      return nlSock_->addNexthop(id, protocolId, nextHop);
+    });
+    it = nexthopObjects_.emplace(nextHop, object).first;
+  }
+  ++it->second.numRefs;
+  return it->second.id;
+}
+
+void
+NetlinkSocket::releaseNexthopObject(const NextHop& nextHop) {
+  auto it = nexthopObjects_.find(nextHop);
+  DCHECK(it != nexthopObjects_.end());
+  if (it == nexthopObjects_.end() or --it->second.numRefs > 0) {
+    return;
+  }
+  deleteNexthopObject(it->second.id);
+  nexthopObjects_.erase(it);
+}
+
+uint32_t
+NetlinkSocket::createNexthopObject(
+    const std::function<ResultCode(uint32_t id)>& create) {
+  while (true) {
+    const uint32_t id = nextNexthopId_++;
+    // 0 is not a valid id
+    if (id == 0) {
+      continue;
+    }
+    const auto status = create(id);
+    if (status == ResultCode::NEXTHOP_EXISTS) {
+      // in use by an object we did not create, e.g. by a previous instance
+      VLOG(2) << "Nexthop object id " << id << " in use, skipping";
+      continue;
+    }
+    if (status != ResultCode::SUCCESS) {
+      throw fbnl::NlException(folly::sformat(
+          "Could not create nexthop object {} Error: {}",
+          id,
+          static_cast<int>(status)));
+    }
+    return id;
+  }
+}
+
+void
+NetlinkSocket::deleteNexthopObject(uint32_t id) {
+  const auto status = nlSock_->deleteNexthop(id);
+  if (status != ResultCode::SUCCESS) {
+    LOG(ERROR) << "Failed to delete nexthop object " << id
+               << " Error: " << static_cast<int>(status);
+  }
 }
 
 folly::Future<folly::Unit>
@@ -527,8 +1192,7 @@ NetlinkSocket::doDeleteMplsRoute(Route mplsRoute) {
   if (!label.hasValue()) {
     return;
   }
-  auto& mplsRoutes = mplsRoutesCache_[mplsRoute.getProtocolId()];
-  if (mplsRoutes.count(label.value()) == 0) {
+  if (!routeCache_.getMplsRoute(mplsRoute.getProtocolId(), label.value())) {
     LOG(ERROR) << "Trying to delete non-existing label: " << label.value();
     return;
   }
@@ -540,7 +1204,7 @@ NetlinkSocket::doDeleteMplsRoute(Route mplsRoute) {
         "Failed to delete MPLS {} Error: {}", label.value(), err));
   }
   // Update local cache with removed prefix
-  mplsRoutes.erase(label.value());
+  routeCache_.deleteMplsRoute(mplsRoute.getProtocolId(), label.value());
 }
 
 void
@@ -551,15 +1215,14 @@ NetlinkSocket::doAddUpdateMplsRoute(Route mplsRoute) {
     return;
   }
   // check cache has the same entry
-  auto& mplsRoutes = mplsRoutesCache_[mplsRoute.getProtocolId()];
-  auto mplsRouteEntry = mplsRoutes.find(label.value());
+  const auto* cachedRoute =
+      routeCache_.getMplsRoute(mplsRoute.getProtocolId(), label.value());
   // Same route
-  if (mplsRouteEntry != mplsRoutes.end() &&
-      mplsRouteEntry->second == mplsRoute) {
+  if (cachedRoute && cachedRoute->isSameRoute(mplsRoute)) {
     return;
   }
 
-  mplsRoutes.erase(label.value());
+  routeCache_.deleteMplsRoute(mplsRoute.getProtocolId(), label.value());
   int err{0};
   err = static_cast<int>(nlSock_->addLabelRoute(mplsRoute));
   if (0 != err) {
@@ -567,8 +1230,7 @@ NetlinkSocket::doAddUpdateMplsRoute(Route mplsRoute) {
         "Could not add mpls route\n{}\nError: {}", mplsRoute.str(), err));
   }
   // Add MPLS route entry in cache on successful addition
-  mplsRoutes.emplace(std::make_pair(
-      static_cast<int32_t>(label.value()), std::move(mplsRoute)));
+  routeCache_.setMplsRoute(mplsRoute);
 }
 
 void
@@ -576,8 +1238,7 @@ NetlinkSocket::doDeleteUnicastRoute(Route route) {
   checkUnicastRoute(route);
 
   const auto& prefix = route.getDestination();
-  auto& unicastRoutes = unicastRoutesCache_[route.getProtocolId()];
-  if (unicastRoutes.count(prefix) == 0) {
+  if (!routeCache_.getUnicastRoute(route.getProtocolId(), prefix)) {
     LOG(ERROR) << "Trying to delete non-existing prefix "
                << folly::IPAddress::networkToString(prefix);
     return;
@@ -594,7 +1255,8 @@ NetlinkSocket::doDeleteUnicastRoute(Route route) {
   }
 
   // Update local cache with removed prefix
-  unicastRoutes.erase(route.getDestination());
+  releaseRouteNexthopGroup(route.getProtocolId(), prefix);
+  routeCache_.deleteUnicastRoute(route.getProtocolId(), prefix);
 }
 
 void
@@ -706,31 +1368,27 @@ NetlinkSocket::syncUnicastRoutes(
 
 void
 NetlinkSocket::doSyncUnicastRoutes(uint8_t protocolId, NlUnicastRoutes syncDb) {
-  auto& unicastRoutes = unicastRoutesCache_[protocolId];
-
   // Go over routes that are not in new routeDb, delete
-  std::unordered_set<folly::CIDRNetwork> toDelete;
-  for (auto const& kv : unicastRoutes) {
-    if (syncDb.find(kv.first) == syncDb.end()) {
-      toDelete.insert(kv.first);
+  std::vector<Route> toDelete;
+  for (auto const& kv : *routeCache_.getUnicastRoutes(protocolId)) {
+    const auto prefix = kv.first.toNetwork();
+    if (syncDb.find(prefix) == syncDb.end()) {
+      toDelete.emplace_back(
+          NetlinkRouteCache::toUnicastRoute(protocolId, prefix, kv.second));
     }
   }
-  // Delete routes from kernel
+  // Delete routes from kernel, in batches of pooled messages
   LOG(INFO) << "Sync: number of routes to delete: " << toDelete.size();
-  for (auto it = toDelete.begin(); it != toDelete.end(); ++it) {
-    auto const& prefix = *it;
-    auto iter = unicastRoutes.find(prefix);
-    if (iter == unicastRoutes.end()) {
-      continue;
-    }
-    doDeleteUnicastRoute(iter->second);
-  }
+  doDeleteUnicastRoutes(std::move(toDelete));
 
   // Go over routes in new routeDb, update/add
   LOG(INFO) << "Sync: number of routes to add: " << syncDb.size();
+  std::vector<Route> toAdd;
+  toAdd.reserve(syncDb.size());
   for (auto& kv : syncDb) {
-    doAddUpdateUnicastRoute(kv.second);
+    toAdd.emplace_back(std::move(kv.second));
   }
+  doAddUpdateUnicastRoutes(std::move(toAdd));
 }
 
 folly::Future<folly::Unit>
@@ -806,17 +1464,22 @@ folly::Future<NlUnicastRoutes>
 NetlinkSocket::getCachedUnicastRoutes(uint8_t protocolId) const {
   VLOG(3) << "NetlinkSocket getCachedUnicastRoutes by protocol "
           << (int)protocolId;
-  folly::Promise<NlUnicastRoutes> promise;
+  return getUnicastRoutesSnapshot(protocolId).thenValue(
+      [protocolId](
+          std::shared_ptr<const NetlinkRouteCache::UnicastRoutes> routes) {
+        return NetlinkRouteCache::toNlUnicastRoutes(protocolId, *routes);
+      });
+}
+
+folly::Future<std::shared_ptr<const NetlinkRouteCache::UnicastRoutes>>
+NetlinkSocket::getUnicastRoutesSnapshot(uint8_t protocolId) const {
+  folly::Promise<std::shared_ptr<const NetlinkRouteCache::UnicastRoutes>>
+      promise;
   auto future = promise.getFuture();
 
   evl_->runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), protocolId]() mutable {
-        auto iter = unicastRoutesCache_.find(protocolId);
-        if (iter != unicastRoutesCache_.end()) {
-          p.setValue(iter->second);
-        } else {
-          p.setValue(NlUnicastRoutes{});
-        }
+        p.setValue(routeCache_.getUnicastRoutes(protocolId));
       });
   return future;
 }
@@ -868,15 +1531,26 @@ NetlinkSocket::getRouteCount() const {
   auto future = promise.getFuture();
 
   evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
-    int64_t count = 0;
-    for (const auto& routes : unicastRoutesCache_) {
-      count += routes.second.size();
-    }
-    p.setValue(count);
+    p.setValue(routeCache_.getNumUnicastRoutes());
   });
   return future;
 }
 
+std::map<std::string, int64_t>
+NetlinkSocket::getEventCounters() const {
+  std::map<std::string, int64_t> counters;
+  counters["netlink.route_events"] = nlSock_->getRouteEventCount();
+  counters["netlink.route_events_filtered"] =
+      nlSock_->getFilteredEventCount();
+  counters["netlink.event_filter_attached"] =
+      nlSock_->isEventFilterAttached() ? 1 : 0;
+  counters["netlink.event_overflows"] = nlSock_->getEventOverflowCount();
+  counters["netlink.event_resyncs"] = numResyncs_.load();
+  counters["netlink.event_batches"] = numEventBatches_.load();
+  counters["netlink.events_coalesced"] = numEventsCoalesced_.load();
+  return counters;
+}
+
 folly::Future<int>
 NetlinkSocket::getIfIndex(const std::string& ifName) {
   folly::Promise<int> promise;
@@ -934,6 +1608,7 @@ NetlinkSocket::addIfAddress(IfAddress ifAddress) {
       [this, p = std::move(promise), addr = std::move(ifAddress)]() mutable {
         int err = static_cast<int>(nlSock_->addIfAddress(addr));
         if (err == 0) {
+          addAddrCacheEntry(addr);
           p.setValue();
         } else {
           p.setException(fbnl::NlException("Failed to add If Address"));
@@ -957,6 +1632,8 @@ NetlinkSocket::delIfAddress(IfAddress ifAddress) {
       [this, p = std::move(promise), ifAddr = std::move(ifAddress)]() mutable {
         int err = static_cast<int>(nlSock_->deleteIfAddress(ifAddr));
         if (err == 0) {
+          removeAddrCacheEntry(
+              ifAddr.getIfIndex(), ifAddr.getPrefix().value());
           p.setValue();
         } else {
           p.setException(fbnl::NlException("Failed to delete If Address"));
@@ -1030,7 +1707,7 @@ NetlinkSocket::getIfAddrs(int ifIndex, int family, int scope) {
 void
 NetlinkSocket::doSyncIfAddress(
     int ifIndex, std::vector<IfAddress> addrs, int family, int scope) {
-  std::vector<folly::CIDRNetwork> newPrefixes;
+  std::unordered_set<folly::CIDRNetwork> newPrefixes;
   for (const auto& addr : addrs) {
     if (addr.getIfIndex() != ifIndex) {
       throw fbnl::NlException("Inconsistent ifIndex in addrs");
@@ -1038,40 +1715,100 @@ NetlinkSocket::doSyncIfAddress(
     if (!addr.getPrefix().hasValue()) {
       throw fbnl::NlException("Prefix must be set when sync addresses");
     }
-    newPrefixes.emplace_back(addr.getPrefix().value());
-  }
-
-  std::vector<folly::CIDRNetwork> oldPrefixes;
-  auto oldAddrs = getIfAddrs(ifIndex, family, scope).get();
-  for (const auto& addr : oldAddrs) {
-    oldPrefixes.emplace_back(addr.getPrefix().value());
+    newPrefixes.emplace(addr.getPrefix().value());
   }
 
-  PrefixCmp cmp;
-  sort(newPrefixes.begin(), newPrefixes.end(), cmp);
-  sort(oldPrefixes.begin(), oldPrefixes.end(), cmp);
-
-  // get a list of prefixes need to be deleted
-  std::vector<folly::CIDRNetwork> toDeletePrefixes;
-  std::set_difference(
-      oldPrefixes.begin(),
-      oldPrefixes.end(),
-      newPrefixes.begin(),
-      newPrefixes.end(),
-      std::inserter(toDeletePrefixes, toDeletePrefixes.begin()));
+  // current addresses of the interface from the cache
+  const std::unordered_map<folly::CIDRNetwork, uint8_t> noAddresses;
+  auto cacheIt = ifAddresses_.find(ifIndex);
+  const auto& oldAddresses =
+      cacheIt != ifAddresses_.end() ? cacheIt->second : noAddresses;
 
   // Do add first, because in Linux deleting the only IP will cause if down.
-  // Add new address, existed addresses will be ignored
+  // Existing addresses are skipped
+  std::vector<IfAddress> toAdd;
   for (auto& addr : addrs) {
-    addIfAddress(addr);
+    if (oldAddresses.count(addr.getPrefix().value()) == 0) {
+      toAdd.emplace_back(std::move(addr));
+    }
   }
 
-  // Delete deprecated addresses
+  // Delete deprecated addresses of family and scope
+  std::vector<IfAddress> toDelete;
   fbnl::IfAddressBuilder builder;
-  for (const auto& toDel : toDeletePrefixes) {
-    auto delAddr =
-        builder.setIfIndex(ifIndex).setPrefix(toDel).setScope(scope).build();
-    delIfAddress(delAddr);
+  for (const auto& kv : oldAddresses) {
+    if (newPrefixes.count(kv.first)) {
+      continue;
+    }
+    if (family != AF_UNSPEC && family != kv.first.first.family()) {
+      continue;
+    }
+    if (scope != RT_SCOPE_NOWHERE && scope != kv.second) {
+      continue;
+    }
+    builder.setIfIndex(ifIndex).setPrefix(kv.first).setScope(scope);
+    toDelete.emplace_back(builder.build());
+    builder.reset();
+  }
+
+  // Apply the outcome to the cache right away, the events confirming it may
+  // still be on their way when the next sync comes
+  size_t numFailed{0};
+  if (!toAdd.empty()) {
+    auto result = nlSock_->addIfAddressBatch(toAdd);
+    numFailed += result.numFailed;
+    for (size_t i = 0; i < toAdd.size(); ++i) {
+      if (result.statuses[i] == 0) {
+        addAddrCacheEntry(toAdd[i]);
+      }
+    }
+  }
+  if (!toDelete.empty()) {
+    auto result = nlSock_->deleteIfAddressBatch(toDelete);
+    numFailed += result.numFailed;
+    for (size_t i = 0; i < toDelete.size(); ++i) {
+      if (result.statuses[i] == 0) {
+        removeAddrCacheEntry(ifIndex, toDelete[i].getPrefix().value());
+      }
+    }
+  }
+  if (numFailed) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to sync {} of {} addresses of interface {}",
+        numFailed,
+        toAdd.size() + toDelete.size(),
+        ifIndex));
+  }
+}
+
+void
+NetlinkSocket::resetAddrCache(const std::vector<IfAddress>& addresses) {
+  ifAddresses_.clear();
+  for (const auto& address : addresses) {
+    if (address.isValid()) {
+      addAddrCacheEntry(address);
+    }
+  }
+}
+
+void
+NetlinkSocket::addAddrCacheEntry(const IfAddress& ifAddr) {
+  if (ifAddr.getPrefix().hasValue()) {
+    ifAddresses_[ifAddr.getIfIndex()][ifAddr.getPrefix().value()] =
+        ifAddr.getScope().value_or(RT_SCOPE_UNIVERSE);
+  }
+}
+
+void
+NetlinkSocket::removeAddrCacheEntry(
+    int ifIndex, const folly::CIDRNetwork& prefix) {
+  auto it = ifAddresses_.find(ifIndex);
+  if (it == ifAddresses_.end()) {
+    return;
+  }
+  it->second.erase(prefix);
+  if (it->second.empty()) {
+    ifAddresses_.erase(it);
   }
 }
 
@@ -1082,13 +1819,37 @@ NetlinkSocket::getAllLinks() {
   auto future = promise.getFuture();
   evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
     try {
+      // One dump of all links and one of all addresses. The cache is
+      // rebuilt from them, dropping links and addresses whose delete events
+      // we missed
       auto links = nlSock_->getAllLinks();
+      std::unordered_set<std::string> linkNames;
+      std::unordered_map<int, std::string> ifIndexToName;
       for (auto& link : links) {
+        linkNames.emplace(link.getLinkName());
+        ifIndexToName.emplace(link.getIfIndex(), link.getLinkName());
         doHandleLinkEvent(link, false);
       }
+      for (auto it = links_.begin(); it != links_.end();) {
+        if (linkNames.count(it->first) == 0) {
+          removeNeighborCacheEntries(it->first);
+          it = links_.erase(it);
+        } else {
+          it->second.networks.clear();
+          ++it;
+        }
+      }
+
+      // Resolve address interfaces with the index of this dump rather than
+      // a scan of the cache per address
       auto addresses = nlSock_->getAllIfAddresses();
+      resetAddrCache(addresses);
       for (auto& address : addresses) {
-        doHandleAddrEvent(address, false);
+        auto it = ifIndexToName.find(address.getIfIndex());
+        if (!address.isValid() || it == ifIndexToName.end()) {
+          continue;
+        }
+        links_.at(it->second).networks.emplace(address.getPrefix().value());
       }
       p.setValue(links_);
     } catch (const std::exception& ex) {
@@ -1122,7 +1883,16 @@ NetlinkSocket::getAllReachableNeighbors() {
 
 void
 NetlinkSocket::updateRouteCache() {
-  auto routes = nlSock_->getAllRoutes();
+  // only routes of the main table are cached, skip the others (e.g. local
+  // table) before parsing them
+  std::vector<Route> routes;
+  auto parser = std::make_unique<NetlinkRouteMessage>();
+  nlSock_->dumpRoutes([&routes, &parser](const NetlinkRouteView& route) {
+    if (route.getRouteTable() == RT_TABLE_MAIN &&
+        (route.getFlags() & RTM_F_CLONED) == 0) {
+      routes.emplace_back(parser->parseMessage(route.getMessage()));
+    }
+  });
   for (auto& route : routes) {
     doHandleRouteEvent(route, false, true);
   }
@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <map>
+
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <folly/ConcurrentBitSet.h>
 #include <folly/IPAddress.h>
 #include <folly/String.h>
 #include <folly/futures/Future.h>
 #include <openr/nl/NetlinkMessage.h>
+#include <openr/nl/NetlinkRouteCache.h>
+#include <openr/nl/NetlinkRoutePool.h>
 #include <openr/nl/NetlinkTypes.h>
 
 namespace openr::fbnl {
@@ -41,6 +45,8 @@ struct PrefixCmp {
  * For events subscription:
  *   User can use NetlinkSocket::EventsHandler to implement events handlers then
  *   using sub/unsub APIs to control events subscription
+ *   Events received in one pass over the event socket are handled as a
+ *   batch, see EventsHandler::handleEventBatch
  *
  * A ZmqEventLoop is provided which the implementation uses to register
  * socket fds. Caller is responsible for running the zmq event loop.
@@ -72,6 +78,19 @@ class NetlinkSocket {
       std::visit(EventVisitor(ifName, this), event);
     }
 
+    // Callback invoked by NetlinkSocket with the registered events received
+    // at once, in order and with only the latest one per link, address and
+    // neighbor. Override it to handle them as a batch, they are passed to
+    // handleEvent one by one otherwise
+    virtual void
+    handleEventBatch(
+        const std::vector<std::pair<std::string /* ifName */, EventVariant>>&
+            events) noexcept {
+      for (auto const& event : events) {
+        handleEvent(event.first, event.second);
+      }
+    }
+
     virtual void
     linkEventFunc(
         const std::string& /* ifName */,
@@ -161,10 +180,22 @@ class NetlinkSocket {
     }
   };
 
+  /**
+   * If useNexthopObjects is set, unicast routes whose nexthops all have a
+   * gateway and no label action are programmed as references to kernel
+   * nexthop groups (linux 5.3+). Routes with the same nexthops share the
+   * group, which is created along with the first route and deleted along
+   * with the last one.
+   *
+   * If routePool is set, batches of unicast routes are programmed through
+   * its sockets in parallel instead of through nlSock.
+   */
   explicit NetlinkSocket(
       fbzmq::ZmqEventLoop* evl,
       EventsHandler* handler = nullptr,
-      std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlSock = nullptr);
+      std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlSock = nullptr,
+      bool useNexthopObjects = false,
+      std::unique_ptr<NetlinkRoutePool> routePool = nullptr);
 
   virtual ~NetlinkSocket();
 
@@ -183,6 +214,22 @@ class NetlinkSocket {
    */
   virtual folly::Future<folly::Unit> addRoute(Route route);
 
+  /**
+   * Add/update a batch of unicast routes, pipelined to the kernel instead of
+   * waiting for the ack of each route. Routes are programmed independently,
+   * the cache reflects the ones which succeeded
+   * @throws fbnl::NlException if any route could not be programmed
+   */
+  virtual folly::Future<folly::Unit> addUnicastRoutes(
+      std::vector<Route> routes);
+
+  /**
+   * Delete a batch of unicast routes, see addUnicastRoutes()
+   * @throws fbnl::NlException if any route could not be deleted
+   */
+  virtual folly::Future<folly::Unit> delUnicastRoutes(
+      std::vector<Route> routes);
+
   /**
    * Add MPLS label route, nexthop semantics is same as route nexthop
    */
@@ -243,6 +290,16 @@ class NetlinkSocket {
   virtual folly::Future<NlMplsRoutes> getCachedMplsRoutes(
       uint8_t protocolId) const;
 
+  /**
+   * Get immutable snapshots of the cached unicast or MPLS routes by protocol
+   * ID. Snapshots share the cache entries instead of copying them
+   */
+  virtual folly::Future<std::shared_ptr<const NetlinkRouteCache::UnicastRoutes>>
+  getUnicastRoutesSnapshot(uint8_t protocolId) const;
+
+  virtual folly::Future<std::shared_ptr<const NetlinkRouteCache::MplsRoutes>>
+  getMplsRoutesSnapshot(uint8_t protocolId) const;
+
   /**
    * Get cached multicast routing by protocol ID
    * @throws fbnl::NlException
@@ -269,6 +326,11 @@ class NetlinkSocket {
    */
   virtual folly::Future<int64_t> getMplsRouteCount() const;
 
+  /**
+   * Get counters of the events received from the kernel
+   */
+  std::map<std::string, int64_t> getEventCounters() const;
+
   /**
    * Add Interface address e.g. ip addr add 192.168.1.1/24 dev em1
    * @throws fbnl::NlException
@@ -299,6 +361,10 @@ class NetlinkSocket {
    * according to family and scope. Leaving out family and scope will
    * result in all addresses of the specified address interface tuple to
    * be deleted.
+   *
+   * Current addresses come from the address cache rather than a dump, only
+   * the differences are sent, in one batch of adds and one of deletes.
+   * @throws fbnl::NlException if any of them fails
    */
   virtual folly::Future<folly::Unit> syncIfAddress(
       int ifIndex, std::vector<fbnl::IfAddress> addrs, int family, int scope);
@@ -380,12 +446,48 @@ class NetlinkSocket {
 
   void doHandleNeighborEvent(Neighbor neighbor, bool runHandler) noexcept;
 
+  // update the caches with an event, return the name of its interface
+  std::string applyLinkEvent(const Link& link);
+
+  std::string applyAddrEvent(const IfAddress& ifAddr);
+
+  std::string applyNeighborEvent(
+      const Neighbor& neighbor, NeighborUpdate& neighborUpdate);
+
+  // queue an event received from the event socket for the batch of its
+  // receive pass, superseding the queued one of the same link, address or
+  // neighbor if any
+  void queueEvent(EventVariant event, bool runHandler) noexcept;
+
+  // update the caches with the queued events, then invoke the neighbor
+  // listener and the handler once for all of them
+  void doHandleEventBatch() noexcept;
+
+  // dump links, addresses and neighbors after events were lost, and run
+  // the handlers for the differences with the caches only
+  void doResyncEvents() noexcept;
+
   void doUpdateRouteCache(Route route, bool updateUnicastRoute = false);
 
   void doAddUpdateUnicastRoute(Route route);
 
   void doDeleteUnicastRoute(Route route);
 
+  void doAddUpdateUnicastRoutes(std::vector<Route> routes);
+
+  void doDeleteUnicastRoutes(std::vector<Route> routes);
+
+  // program a batch of unicast routes through the route pool if any,
+  // nlSock_ otherwise
+  NlBatchResult addUnicastRouteBatch(
+      const std::vector<Route>& routes,
+      const std::vector<uint32_t>& nexthopIds);
+
+  NlBatchResult deleteUnicastRouteBatch(const std::vector<Route>& routes);
+
+  // set admin distance of the route protocol if route has no priority
+  static void setDefaultPriority(Route& route);
+
   void doAddUpdateMplsRoute(Route route);
 
   void doDeleteMplsRoute(Route route);
@@ -402,6 +504,49 @@ class NetlinkSocket {
 
   void checkUnicastRoute(const Route& route);
 
+  // Kernel nexthop objects and groups, reference counted
+  struct NexthopObject {
+    uint32_t id{0};
+    size_t numRefs{0};
+  };
+
+  struct NexthopGroup {
+    uint32_t id{0};
+    size_t numRefs{0};
+    // nexthops of the member objects
+    std::vector<NextHop> nextHops;
+  };
+
+  // groups by their members, sorted
+  using NexthopGroups = std::map<NexthopGroupMembers, NexthopGroup>;
+
+  // whether route is to be programmed through a nexthop group
+  bool useNexthopGroup(const Route& route) const;
+
+  // reference the group of the nexthops of route, creating it and its
+  // nexthop objects if needed
+  NexthopGroups::iterator acquireNexthopGroup(const Route& route);
+
+  // release a group, deleting it and its unused nexthop objects along
+  // with the last reference
+  void releaseNexthopGroup(NexthopGroups::iterator it);
+
+  // release the group of the route for prefix if it has one
+  void releaseRouteNexthopGroup(
+      uint8_t protocolId, const folly::CIDRNetwork& prefix);
+
+  uint32_t acquireNexthopObject(const NextHop& nextHop, uint8_t protocolId);
+
+  void releaseNexthopObject(const NextHop& nextHop);
+
+  // create nexthop object or group with create under an unused id.
+  // Returns the id
+  uint32_t createNexthopObject(
+      const std::function<ResultCode(uint32_t id)>& create);
+
+  // delete nexthop object or group, failures are only logged
+  void deleteNexthopObject(uint32_t id);
+
   void doSyncIfAddress(
       int ifIndex, std::vector<fbnl::IfAddress> addrs, int family, int scope);
 
@@ -410,6 +555,13 @@ class NetlinkSocket {
 
   void removeNeighborCacheEntries(const std::string& ifName);
 
+  // replace the address cache with a dump of all addresses
+  void resetAddrCache(const std::vector<IfAddress>& addresses);
+
+  void addAddrCacheEntry(const IfAddress& ifAddr);
+
+  void removeAddrCacheEntry(int ifIndex, const folly::CIDRNetwork& prefix);
+
   void updateLinkCache();
 
   void updateAddrCache();
@@ -422,21 +574,33 @@ class NetlinkSocket {
   fbzmq::ZmqEventLoop* evl_{nullptr};
 
   /**
-   * Local cache. We do not use this to enforce any checks
-   * for incoming requests. Merely an optimization for get cached routes
-   */
-  NlUnicastRoutesDb unicastRoutesCache_;
-
-  /**
-   * MPLS label route cache
+   * Local cache of unicast and MPLS label routes. We do not use this to
+   * enforce any checks for incoming requests. Merely an optimization for get
+   * cached routes
    */
-  NlMplsRoutesDb mplsRoutesCache_;
+  NetlinkRouteCache routeCache_;
 
   // Check against redundant multicast routes
   NlMulticastRoutesDb mcastRoutesCache_;
 
   NlLinkRoutesDb linkRoutesCache_;
 
+  // program unicast routes through nexthop groups
+  const bool useNexthopObjects_{false};
+
+  std::unordered_map<NextHop, NexthopObject, NextHopHash> nexthopObjects_;
+
+  NexthopGroups nexthopGroups_;
+
+  // nexthop group of unicast routes referencing one, per protocol
+  std::unordered_map<
+      uint8_t,
+      std::unordered_map<folly::CIDRNetwork, NexthopGroups::iterator>>
+      routeNexthopGroups_;
+
+  // next nexthop object id to try, ids in use by other objects are skipped
+  uint32_t nextNexthopId_{1};
+
   EventsHandler* handler_{nullptr};
 
   folly::Optional<int> loopbackIfIndex_;
@@ -448,11 +612,36 @@ class NetlinkSocket {
   NlNeighbors neighbors_{};
   NlLinks links_{};
 
+  // scope of the addresses of each interface by ifIndex, fed by address
+  // events and refreshed with link dumps. Address syncs diff against it
+  std::unordered_map<int, std::unordered_map<folly::CIDRNetwork, uint8_t>>
+      ifAddresses_;
+
   // Indicating to run which event type's handler
   folly::ConcurrentBitSet<MAX_EVENT_TYPE> eventFlags_;
 
   std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlSock_{nullptr};
 
+  // sockets programming batches of unicast routes in parallel, if set
+  std::unique_ptr<NetlinkRoutePool> routePool_{nullptr};
+
+  // set while a resync is scheduled, events lost meanwhile are covered by it
+  std::atomic<bool> resyncPending_{false};
+  std::atomic<int64_t> numResyncs_{0};
+
+  // events of the current receive pass of the event socket, superseded
+  // ones are reset. Index of the queued event of each link, address and
+  // neighbor. Route events are not coalesced, they may carry nexthops of
+  // the same prefix one by one
+  struct QueuedEvent {
+    EventVariant event;
+    bool runHandler{false};
+  };
+  std::vector<folly::Optional<QueuedEvent>> queuedEvents_;
+  std::unordered_map<std::string, size_t> queuedEventIndex_;
+  std::atomic<int64_t> numEventBatches_{0};
+  std::atomic<int64_t> numEventsCoalesced_{0};
+
   std::mutex neighborListenerMutex_;
   std::function<void(const NeighborUpdate& neighborUpdate)> neighborListener_{
       nullptr};
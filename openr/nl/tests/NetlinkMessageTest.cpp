@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 
@@ -16,6 +17,7 @@
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
 #include <folly/MacAddress.h>
+#include <folly/Synchronized.h>
 #include <folly/Subprocess.h>
 #include <folly/gen/Base.h>
 #include <folly/system/Shell.h>
@@ -46,6 +48,8 @@ namespace {
 const std::string kVethNameX("vethTestX");
 const std::string kVethNameY("vethTestY");
 const uint8_t kRouteProtoId = 99;
+// protocol of routes programmed by others
+const uint8_t kOtherRouteProtoId = 200;
 const uint32_t kAqRouteProtoIdPriority = 10;
 } // namespace
 
@@ -529,6 +533,55 @@ TEST_F(NlMessageFixture, IpRouteMultipleNextHops) {
   EXPECT_FALSE(checkRouteInKernelRoutes(kernelRoutes, route));
 }
 
+TEST_F(NlMessageFixture, IpRouteNexthopGroup) {
+  // Add two IPv6 routes sharing a group of 2 nexthop objects
+
+  ResultCode status{ResultCode::FAIL};
+  std::vector<openr::fbnl::NextHop> paths;
+  paths.push_back(buildNextHop(
+      folly::none, folly::none, folly::none, ipAddrY1V6, ifIndexZ));
+  paths.push_back(buildNextHop(
+      folly::none, folly::none, folly::none, ipAddrY2V6, ifIndexZ));
+  auto route1 = buildRoute(kRouteProtoId, ipPrefix1, folly::none, paths);
+  auto route2 = buildRoute(kRouteProtoId, ipPrefix2, folly::none, paths);
+
+  const uint32_t nhId1{9001}, nhId2{9002}, groupId{9003};
+  status = nlSock->addNexthop(nhId1, kRouteProtoId, paths.at(0));
+  if (status != ResultCode::SUCCESS) {
+    SKIP() << "Kernel does not support nexthop objects";
+    return;
+  }
+  EXPECT_EQ(
+      ResultCode::SUCCESS,
+      nlSock->addNexthop(nhId2, kRouteProtoId, paths.at(1)));
+  // ids in use are reported unless replaced
+  EXPECT_EQ(
+      ResultCode::NEXTHOP_EXISTS,
+      nlSock->addNexthop(nhId2, kRouteProtoId, paths.at(1)));
+  EXPECT_EQ(
+      ResultCode::SUCCESS,
+      nlSock->addNexthop(nhId2, kRouteProtoId, paths.at(1), true));
+  EXPECT_EQ(
+      ResultCode::SUCCESS,
+      nlSock->addNexthopGroup(
+          groupId, kRouteProtoId, {{nhId1, 0}, {nhId2, 0}}));
+
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->addRoute(route1, groupId));
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->addRoute(route2, groupId));
+  EXPECT_EQ(0, nlSock->getErrorCount());
+
+  // routes are reported with the nexthops of their group
+  auto kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(2, findRoutesInKernelRoutes(kernelRoutes, {route1, route2}));
+
+  // deleting the group deletes the routes using it
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->deleteNexthop(groupId));
+  kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(0, findRoutesInKernelRoutes(kernelRoutes, {route1, route2}));
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->deleteNexthop(nhId1));
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->deleteNexthop(nhId2));
+}
+
 TEST_F(NlMessageFixture, IPv4RouteSingleNextHop) {
   // Add IPv4 route with one next hop and no labels
   // outoing IF is vethTestY
@@ -974,6 +1027,125 @@ TEST_F(NlMessageFixture, MultipleIpRoutesLabelNexthop) {
   EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, routes), 0);
 }
 
+TEST_F(NlMessageFixture, IpRouteBatch) {
+  // Add and delete routes as batches spanning several message windows,
+  // with one route failing to encode
+  uint32_t count{3 * openr::fbnl::kNlMessageWindow};
+  auto routes = buildV6RouteDb(count);
+  // PUSH without labels
+  routes.emplace_back(buildRoute(
+      kRouteProtoId,
+      ipPrefix1,
+      folly::none,
+      std::vector<openr::fbnl::NextHop>{buildNextHop(
+          folly::none,
+          folly::none,
+          thrift::MplsActionCode::PUSH,
+          ipAddrY1V6,
+          ifIndexZ)}));
+
+  auto result = nlSock->addRouteBatch(routes);
+  ASSERT_EQ(count + 1, result.statuses.size());
+  EXPECT_EQ(1, result.numFailed);
+  EXPECT_EQ(-EINVAL, result.statuses.back());
+  for (uint32_t i = 0; i < count; ++i) {
+    EXPECT_EQ(0, result.statuses.at(i));
+  }
+  EXPECT_EQ(0, nlSock->getErrorCount());
+  routes.pop_back();
+
+  auto kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, routes), count);
+
+  result = nlSock->deleteRouteBatch(routes);
+  EXPECT_EQ(count, result.statuses.size());
+  EXPECT_EQ(0, result.numFailed);
+
+  kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, routes), 0);
+}
+
+TEST_F(NlMessageFixture, IpRouteDump) {
+  // Stream the routes of the kernel, filtered by protocol
+  uint32_t count{1000};
+  auto routes = buildV6RouteDb(count);
+  auto result = nlSock->addRouteBatch(routes);
+  EXPECT_EQ(0, result.numFailed);
+
+  std::set<folly::CIDRNetwork> prefixes;
+  size_t numOtherProtocols{0};
+  auto status = nlSock->dumpRoutes(
+      [&](const openr::fbnl::NetlinkRouteView& route) {
+        if (route.getProtocolId() != kRouteProtoId) {
+          ++numOtherProtocols;
+          return;
+        }
+        EXPECT_TRUE(route.isValid());
+        EXPECT_EQ(AF_INET, route.getFamily());
+        EXPECT_FALSE(route.getAttribute(RTA_MULTIPATH).empty());
+        auto prefix = route.getDestination();
+        ASSERT_TRUE(prefix.hasValue());
+        prefixes.emplace(prefix.value());
+      },
+      kRouteProtoId);
+  EXPECT_EQ(ResultCode::SUCCESS, status);
+  EXPECT_EQ(0, numOtherProtocols);
+  EXPECT_EQ(count, prefixes.size());
+  for (const auto& route : routes) {
+    EXPECT_EQ(1, prefixes.count(route.getDestination()));
+  }
+
+  result = nlSock->deleteRouteBatch(routes);
+  EXPECT_EQ(0, result.numFailed);
+  prefixes.clear();
+  status = nlSock->dumpRoutes(
+      [&](const openr::fbnl::NetlinkRouteView& route) {
+        prefixes.emplace(route.getDestination().value());
+      },
+      kRouteProtoId);
+  EXPECT_EQ(ResultCode::SUCCESS, status);
+  EXPECT_EQ(0, prefixes.size());
+}
+
+TEST_F(NlMessageFixture, RouteEvents) {
+  // Route events are received for the platform protocols only, and not for
+  // routes changed through the socket itself
+  folly::Synchronized<std::vector<openr::fbnl::Route>> events;
+  nlSock->setRouteEventCB([&](openr::fbnl::Route route, bool) {
+    events.wlock()->emplace_back(std::move(route));
+  });
+
+  auto routes = buildV6RouteDb(1);
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->addRoute(routes.at(0)));
+  for (int protocol : {kRouteProtoId, kOtherRouteProtoId}) {
+    auto cmd = "ip -6 route add 56{:02x}::/64 dev {} proto {}"_shellify(
+        protocol, kVethNameX.c_str(), protocol);
+    folly::Subprocess proc(std::move(cmd));
+    EXPECT_EQ(0, proc.wait().exitStatus());
+  }
+  for (int i = 0; i < 100 and events.rlock()->empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  EXPECT_TRUE(nlSock->isEventFilterAttached());
+  EXPECT_EQ(1, nlSock->getRouteEventCount());
+  EXPECT_EQ(0, nlSock->getFilteredEventCount());
+  {
+    auto lockedEvents = events.rlock();
+    ASSERT_EQ(1, lockedEvents->size());
+    EXPECT_EQ(kRouteProtoId, lockedEvents->at(0).getProtocolId());
+    EXPECT_TRUE(lockedEvents->at(0).isValid());
+  }
+
+  EXPECT_EQ(ResultCode::SUCCESS, nlSock->deleteRoute(routes.at(0)));
+  for (int protocol : {kRouteProtoId, kOtherRouteProtoId}) {
+    auto cmd = "ip -6 route del 56{:02x}::/64 dev {} proto {}"_shellify(
+        protocol, kVethNameX.c_str(), protocol);
+    folly::Subprocess proc(std::move(cmd));
+    EXPECT_EQ(0, proc.wait().exitStatus());
+  }
+}
+
 TEST_F(NlMessageFixture, LabelRouteV4Nexthop) {
   // Add label route with single path label with PHP nexthop
 
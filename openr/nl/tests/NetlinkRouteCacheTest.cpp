@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/nl/NetlinkRouteCache.h>
+
+using namespace openr::fbnl;
+
+namespace {
+
+const uint8_t kProtocolId = 99;
+
+NextHop
+createNextHop(const std::string& gateway, int ifIndex) {
+  NextHopBuilder builder;
+  return builder.setGateway(folly::IPAddress(gateway))
+      .setIfIndex(ifIndex)
+      .build();
+}
+
+Route
+createRoute(
+    const std::string& prefix,
+    const std::vector<NextHop>& nextHops,
+    uint32_t priority = 10) {
+  RouteBuilder builder;
+  builder.setDestination(folly::IPAddress::createNetwork(prefix))
+      .setProtocolId(kProtocolId)
+      .setPriority(priority)
+      .setValid(true);
+  for (const auto& nextHop : nextHops) {
+    builder.addNextHop(nextHop);
+  }
+  return builder.build();
+}
+
+} // anonymous namespace
+
+TEST(NetlinkRouteCacheTest, PackedPrefix) {
+  for (const auto& network :
+       {"10.1.0.0/16", "0.0.0.0/0", "fc00:cafe::/64", "::/0", "::1/128"}) {
+    const auto prefix = folly::IPAddress::createNetwork(network);
+    EXPECT_EQ(prefix, PackedPrefix(prefix).toNetwork());
+  }
+  // same bytes, different family
+  EXPECT_FALSE(
+      PackedPrefix(folly::IPAddress::createNetwork("0.0.0.0/0")) ==
+      PackedPrefix(folly::IPAddress::createNetwork("::/0")));
+}
+
+TEST(NetlinkRouteCacheTest, UnicastRoutes) {
+  NetlinkRouteCache cache;
+  const auto nh1 = createNextHop("fe80::1", 1);
+  const auto nh2 = createNextHop("fe80::2", 2);
+  const auto route1 = createRoute("fc00:1::/64", {nh1, nh2});
+  const auto route2 = createRoute("fc00:2::/64", {nh2, nh1});
+  const auto route3 = createRoute("10.0.0.0/8", {nh1});
+
+  cache.setUnicastRoute(route1);
+  cache.setUnicastRoute(route2);
+  cache.setUnicastRoute(route3);
+  EXPECT_EQ(3, cache.getNumUnicastRoutes());
+  // routes with the same nexthops in any order share them
+  EXPECT_EQ(2, cache.getNumNextHopSets());
+  EXPECT_EQ(
+      cache.getUnicastRoute(kProtocolId, route1.getDestination())->nextHops,
+      cache.getUnicastRoute(kProtocolId, route2.getDestination())->nextHops);
+
+  const auto* cachedRoute =
+      cache.getUnicastRoute(kProtocolId, route1.getDestination());
+  ASSERT_NE(nullptr, cachedRoute);
+  EXPECT_TRUE(cachedRoute->isSameRoute(route1));
+  EXPECT_FALSE(cachedRoute->isSameRoute(route3));
+  EXPECT_FALSE(cachedRoute->isSameRoute(
+      createRoute("fc00:1::/64", {nh1, nh2}, 20)));
+  EXPECT_EQ(
+      route1,
+      NetlinkRouteCache::toUnicastRoute(
+          kProtocolId, route1.getDestination(), *cachedRoute));
+  EXPECT_EQ(
+      nullptr,
+      cache.getUnicastRoute(kProtocolId + 1, route1.getDestination()));
+
+  // snapshots are not affected by updates
+  auto snapshot = cache.getUnicastRoutes(kProtocolId);
+  EXPECT_TRUE(cache.deleteUnicastRoute(kProtocolId, route2.getDestination()));
+  EXPECT_FALSE(cache.deleteUnicastRoute(kProtocolId, route2.getDestination()));
+  cache.setUnicastRoute(createRoute("fc00:1::/64", {nh2}));
+  EXPECT_EQ(3, snapshot->size());
+  EXPECT_EQ(2, cache.getUnicastRoutes(kProtocolId)->size());
+
+  auto nlRoutes = NetlinkRouteCache::toNlUnicastRoutes(kProtocolId, *snapshot);
+  EXPECT_EQ(3, nlRoutes.size());
+  EXPECT_EQ(route1, nlRoutes.at(route1.getDestination()));
+  EXPECT_EQ(route2, nlRoutes.at(route2.getDestination()));
+  EXPECT_EQ(route3, nlRoutes.at(route3.getDestination()));
+
+  // unused nexthop sets are released with their last route
+  snapshot.reset();
+  EXPECT_EQ(2, cache.getNumNextHopSets());
+  EXPECT_TRUE(cache.deleteUnicastRoute(kProtocolId, route3.getDestination()));
+  EXPECT_EQ(1, cache.getNumNextHopSets());
+  EXPECT_EQ(0, cache.getUnicastRoutes(kProtocolId + 1)->size());
+}
+
+TEST(NetlinkRouteCacheTest, MplsRoutes) {
+  NetlinkRouteCache cache;
+  NextHopBuilder nhBuilder;
+  const auto nh = nhBuilder.setGateway(folly::IPAddress("fe80::1"))
+                      .setIfIndex(1)
+                      .setLabelAction(openr::thrift::MplsActionCode::SWAP)
+                      .setSwapLabel(200)
+                      .build();
+  RouteBuilder builder;
+  const auto route = builder.setMplsLabel(100)
+                         .setProtocolId(kProtocolId)
+                         .addNextHop(nh)
+                         .setValid(true)
+                         .build();
+
+  cache.setMplsRoute(route);
+  EXPECT_EQ(1, cache.getNumMplsRoutes());
+  const auto* cachedRoute = cache.getMplsRoute(kProtocolId, 100);
+  ASSERT_NE(nullptr, cachedRoute);
+  EXPECT_TRUE(cachedRoute->isSameRoute(route));
+  EXPECT_EQ(
+      route, NetlinkRouteCache::toMplsRoute(kProtocolId, 100, *cachedRoute));
+
+  auto snapshot = cache.getMplsRoutes(kProtocolId);
+  EXPECT_TRUE(cache.deleteMplsRoute(kProtocolId, 100));
+  EXPECT_EQ(0, cache.getNumMplsRoutes());
+  EXPECT_EQ(1, snapshot->size());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
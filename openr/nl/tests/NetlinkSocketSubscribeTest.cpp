@@ -1685,9 +1685,12 @@ TEST_F(NetlinkSocketSubscribeFixture, MultipleLinkFlapTest) {
   zmqLoop.waitUntilStopped();
   eventThread.join();
 
-  // Verify our link flap events are received via callback
-  EXPECT_LE(2 * flapCount * linkCount, myHandler->linkAddEventCount);
-  EXPECT_LE(2 * flapCount * linkCount, myHandler->linkDelEventCount);
+  // Verify our link flap events are received via callback, but for the
+  // ones superseded by a later event received at once
+  EXPECT_LE(
+      4 * flapCount * linkCount,
+      myHandler->linkAddEventCount + myHandler->linkDelEventCount +
+          netlinkSocket.getEventCounters().at("netlink.events_coalesced"));
 
   for (int i = 0; i < linkCount; i++) {
     std::string vethNameA{"vethTestA" + std::to_string(i)};
@@ -1698,6 +1701,66 @@ TEST_F(NetlinkSocketSubscribeFixture, MultipleLinkFlapTest) {
   }
 }
 
+// Flap links before the event loop runs, the events pending are received
+// at once and handled as a batch with the latest state of each link only
+TEST_F(NetlinkSocketSubscribeFixture, LinkEventBatchTest) {
+  ZmqEventLoop zmqLoop;
+
+  // A timeout to stop the UT in case we never received expected events
+  // UT will mostly likely fail as our checks at the end will fail
+  zmqLoop.scheduleTimeout(kEventLoopTimeout, [&]() noexcept {
+    VLOG(3) << "Timeout waiting for events... ";
+    zmqLoop.stop();
+  });
+
+  std::shared_ptr<MyNetlinkHandler> myHandler =
+      std::make_shared<MyNetlinkHandler>(
+          [&]() noexcept {
+            VLOG(3) << "Received event from netlink";
+            if (zmqLoop.isRunning() && myHandler->links.count(kVethNameX) &&
+                myHandler->links.count(kVethNameY) &&
+                myHandler->links.at(kVethNameX).isUp &&
+                myHandler->links.at(kVethNameY).isUp) {
+              VLOG(3) << "Expected events received. Stopping zmq event loop";
+              zmqLoop.stop();
+            }
+          },
+          "vethTest" /* Filter on test links only */);
+
+  NetlinkSocket netlinkSocket(
+      &zmqLoop, myHandler.get(), std::move(nlProtocolSocket));
+  myHandler->setNetlinkSocket(&netlinkSocket);
+  netlinkSocket.subscribeAllEvents();
+
+  // events queue up in the event socket meanwhile. Links are running once
+  // both ends of the veth pair are up
+  auto cmd = "ip link set dev {} up"_shellify(kVethNameY.c_str());
+  folly::Subprocess proc(std::move(cmd));
+  EXPECT_EQ(0, proc.wait().exitStatus());
+  for (auto const* state : {"up", "down", "up"}) {
+    auto cmdX = "ip link set dev {} {}"_shellify(kVethNameX.c_str(), state);
+    folly::Subprocess procX(std::move(cmdX));
+    EXPECT_EQ(0, procX.wait().exitStatus());
+  }
+
+  std::thread eventThread([&]() {
+    zmqLoop.run();
+    zmqLoop.waitUntilStopped();
+  });
+  zmqLoop.waitUntilRunning();
+  zmqLoop.waitUntilStopped();
+  eventThread.join();
+
+  // only the latest event of each link is handled
+  EXPECT_TRUE(myHandler->links.at(kVethNameX).isUp);
+  EXPECT_TRUE(myHandler->links.at(kVethNameY).isUp);
+  EXPECT_EQ(2, myHandler->linkAddEventCount);
+  EXPECT_EQ(0, myHandler->linkDelEventCount);
+  const auto counters = netlinkSocket.getEventCounters();
+  EXPECT_LE(2, counters.at("netlink.events_coalesced"));
+  EXPECT_LE(1, counters.at("netlink.event_batches"));
+}
+
 // Add and remove 250 IPv4 and IPv6 addresses (total 500)
 TEST_F(NetlinkSocketSubscribeFixture, AddrScaleTest) {
   ZmqEventLoop zmqLoop;
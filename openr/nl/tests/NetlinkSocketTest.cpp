@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 
@@ -106,7 +107,14 @@ class NetlinkSocketFixture : public testing::Test {
 
     // create netlink route socket
     netlinkSocket = std::make_unique<NetlinkSocket>(
-        &evl, nullptr, std::move(nlProtocolSocket));
+        &evl,
+        nullptr,
+        std::move(nlProtocolSocket),
+        false /* useNexthopObjects */,
+        numRouteSockets > 1
+            ? std::make_unique<NetlinkRoutePool>(
+                  numRouteSockets, kNlMessageWindow)
+            : nullptr);
 
     // Run the zmq event loop in its own thread
     // We will either timeout if expected events are not received
@@ -205,6 +213,9 @@ class NetlinkSocketFixture : public testing::Test {
   std::thread eventThread;
   std::thread nlProtocolSocketThread;
 
+  // unicast routes are programmed through a pool of sockets if more than 1
+  size_t numRouteSockets{1};
+
  private:
   void
   addAddress(const std::string& ifName, const std::string& address) {
@@ -644,6 +655,14 @@ class NetlinkSocketFixture : public testing::Test {
   }
 };
 
+// Programs unicast routes through a pool of sockets
+class NetlinkSocketPoolFixture : public NetlinkSocketFixture {
+ public:
+  NetlinkSocketPoolFixture() {
+    numRouteSockets = 4;
+  }
+};
+
 TEST_F(NetlinkSocketFixture, EmptyRouteTest) {
   auto routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId);
   SCOPE_EXIT {
@@ -858,6 +877,57 @@ TEST_F(NetlinkSocketFixture, SyncRouteTestV4) {
   doSyncRouteTest(true);
 }
 
+TEST_F(NetlinkSocketPoolFixture, SyncRouteTest) {
+  doSyncRouteTest(false);
+}
+
+TEST_F(NetlinkSocketPoolFixture, SyncRouteTestV4) {
+  doSyncRouteTest(true);
+}
+
+// - Sync routes sharded between the sockets of the pool
+// - verify they are all added
+// - Sync an empty routeDb and verify they are all deleted
+TEST_F(NetlinkSocketPoolFixture, SyncManyRoutesTest) {
+  const size_t numRoutes = 100;
+  int ifIndex = netlinkSocket->getIfIndex(kVethNameY).get();
+  std::vector<folly::IPAddress> nexthops{folly::IPAddress("fe80::1")};
+  NlUnicastRoutes routeDb;
+  for (size_t i = 0; i < numRoutes; ++i) {
+    folly::CIDRNetwork prefix{
+        folly::IPAddress(folly::sformat("fc00:cafe:{}::", i + 1)), 64};
+    routeDb.emplace(
+        prefix, buildRoute(ifIndex, kAqRouteProtoId, nexthops, prefix));
+  }
+  std::set<size_t> shards;
+  for (auto const& kv : routeDb) {
+    shards.emplace(NetlinkRoutePool::getShard(kv.second, numRouteSockets));
+  }
+  EXPECT_LT(1, shards.size());
+
+  netlinkSocket->syncUnicastRoutes(kAqRouteProtoId, std::move(routeDb)).get();
+  auto routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(numRoutes, routes.size());
+  size_t count = 0;
+  for (const auto& r : netlinkSocket->getAllRoutes()) {
+    if (r.getProtocolId() == kAqRouteProtoId) {
+      count++;
+    }
+  }
+  EXPECT_EQ(numRoutes, count);
+
+  netlinkSocket->syncUnicastRoutes(kAqRouteProtoId, NlUnicastRoutes{}).get();
+  routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(0, routes.size());
+  count = 0;
+  for (const auto& r : netlinkSocket->getAllRoutes()) {
+    if (r.getProtocolId() == kAqRouteProtoId) {
+      count++;
+    }
+  }
+  EXPECT_EQ(0, count);
+}
+
 // - Add a mulitcast route
 // - verify it is added
 // - try adding it again
@@ -87,7 +87,9 @@ IosxrslFibHandler::setVrfContext(std::string vrfName)
 
 IosxrslFibHandler::IosxrslFibHandler(fbzmq::ZmqEventLoop* zmqEventLoop,
                                      std::vector<VrfData> vrfSet,
-                                     std::shared_ptr<grpc::Channel> Channel)
+                                     std::shared_ptr<grpc::Channel> Channel,
+                                     size_t batchSize,
+                                     unsigned int maxInFlight)
   :startTime_(std::chrono::duration_cast<std::chrono::seconds>(
                      std::chrono::system_clock::now().time_since_epoch())
                      .count())
@@ -95,7 +97,9 @@ IosxrslFibHandler::IosxrslFibHandler(fbzmq::ZmqEventLoop* zmqEventLoop,
    iosxrslRshuttle_ = std::make_unique<IosxrslRshuttle>(zmqEventLoop,
                                         vrfSet,
                                         kAqRouteProtoId,
-                                        Channel);
+                                        Channel,
+                                        batchSize,
+                                        maxInFlight);
 
 }
 
@@ -143,39 +147,38 @@ folly::Future<folly::Unit>
 IosxrslFibHandler::future_addUnicastRoutes(
     int16_t clientId,
     std::unique_ptr<std::vector<thrift::UnicastRoute>> routes) {
-  LOG(INFO) << "Adding routes to FIB. Client: " << getClientName(clientId);
+  LOG(INFO) << "Adding " << routes->size()
+            << " routes to FIB. Client: " << getClientName(clientId);
 
-  std::vector<folly::Future<folly::Unit>> futures;
-  for (auto& route : *routes) {
-    auto routePtr = folly::make_unique<thrift::UnicastRoute>(std::move(route));
-    auto future = future_addUnicastRoute(clientId, std::move(routePtr));
-    futures.emplace_back(std::move(future));
+  // Programmed in pipelined batches, the future fails listing the routes
+  // which could not be programmed
+  UnicastRoutes newRoutes;
+  for (auto const& route : *routes) {
+    DCHECK(route.nexthops.size());
+    auto prefix = std::make_pair(
+        toIPAddress(route.dest.prefixAddress), route.dest.prefixLength);
+    newRoutes[prefix] =
+        from(route.nexthops) | mapped([](const thrift::BinaryAddress& addr) {
+          return std::make_pair(addr.ifName.value(), toIPAddress(addr));
+        }) |
+        as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
   }
-  // Return an aggregate future which is fulfilled when all routes are added
-  folly::Promise<folly::Unit> promise;
-  auto future = promise.getFuture();
-  folly::collectAll(futures).then(
-      [promise = std::move(promise)]() mutable { promise.setValue(); });
-  return future;
+  return iosxrslRshuttle_->addUnicastRoutes(std::move(newRoutes));
 }
 
 folly::Future<folly::Unit>
 IosxrslFibHandler::future_deleteUnicastRoutes(
     int16_t clientId, std::unique_ptr<std::vector<thrift::IpPrefix>> prefixes) {
-  LOG(INFO) << "Deleting routes from FIB. Client: " << getClientName(clientId);
-
-  std::vector<folly::Future<folly::Unit>> futures;
-  for (auto& prefix : *prefixes) {
-    auto prefixPtr = folly::make_unique<thrift::IpPrefix>(std::move(prefix));
-    auto future = future_deleteUnicastRoute(clientId, std::move(prefixPtr));
-    futures.emplace_back(std::move(future));
+  LOG(INFO) << "Deleting " << prefixes->size()
+            << " routes from FIB. Client: " << getClientName(clientId);
+
+  std::vector<folly::CIDRNetwork> delPrefixes;
+  delPrefixes.reserve(prefixes->size());
+  for (auto const& prefix : *prefixes) {
+    delPrefixes.emplace_back(
+        toIPAddress(prefix.prefixAddress), prefix.prefixLength);
   }
-  // Return an aggregate future which is fulfilled when all routes are deleted
-  folly::Promise<folly::Unit> promise;
-  auto future = promise.getFuture();
-  folly::collectAll(futures).then(
-      [promise = std::move(promise)]() mutable { promise.setValue(); });
-  return future;
+  return iosxrslRshuttle_->deleteUnicastRoutes(std::move(delPrefixes));
 }
 
 folly::Future<folly::Unit>
@@ -34,9 +34,13 @@ using IosxrslServer = std::unordered_set<std::pair<std::string, std::string>>;
  */
 class IosxrslFibHandler final : public thrift::FibServiceSvIf {
  public:
+  // Route lists are programmed batchSize routes per RPC with up to
+  // maxInFlight RPCs outstanding
   explicit IosxrslFibHandler(fbzmq::ZmqEventLoop* zmqEventLoop,
                              std::vector<VrfData> vrfSet,
-                             std::shared_ptr<grpc::Channel> Channel);
+                             std::shared_ptr<grpc::Channel> Channel,
+                             size_t batchSize = 1000,
+                             unsigned int maxInFlight = 8);
   ~IosxrslFibHandler() override {}
 
   folly::Future<folly::Unit> future_addUnicastRoute(
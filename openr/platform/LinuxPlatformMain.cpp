@@ -34,6 +34,20 @@ DEFINE_bool(
     enable_netlink_system_handler,
     true,
     "If set, netlink system handler will be started");
+DEFINE_bool(
+    enable_nexthop_objects,
+    false,
+    "If set, netlink fib handler programs unicast routes through kernel "
+    "nexthop groups shared by routes with the same nexthops (linux 5.3+)");
+DEFINE_int32(
+    netlink_message_window,
+    openr::fbnl::kNlMessageWindow,
+    "Max number of netlink requests sent to the kernel but not yet acked");
+DEFINE_int32(
+    netlink_route_sockets,
+    1,
+    "Number of netlink sockets programming unicast routes in parallel, each "
+    "with its own thread. Routes are sharded between them by prefix");
 
 using openr::NetlinkFibHandler;
 using openr::NetlinkSystemHandler;
@@ -56,7 +70,7 @@ main(int argc, char** argv) {
   auto nlProtocolSocketEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
   std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlProtocolSocket;
   nlProtocolSocket = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-      nlProtocolSocketEventLoop.get());
+      nlProtocolSocketEventLoop.get(), FLAGS_netlink_message_window);
   allThreads.emplace_back(
       std::thread([&nlProtocolSocket, &nlProtocolSocketEventLoop]() {
         LOG(INFO) << "Starting NetlinkProtolSocketEvl thread...";
@@ -73,7 +87,14 @@ main(int argc, char** argv) {
 
   auto nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
   auto nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
-      nlEventLoop.get(), nullptr, std::move(nlProtocolSocket));
+      nlEventLoop.get(),
+      nullptr,
+      std::move(nlProtocolSocket),
+      FLAGS_enable_nexthop_objects,
+      FLAGS_netlink_route_sockets > 1
+          ? std::make_unique<openr::fbnl::NetlinkRoutePool>(
+                FLAGS_netlink_route_sockets, FLAGS_netlink_message_window)
+          : nullptr);
 
   // Subscribe selected network events
   nlSocket->subscribeEvent(openr::fbnl::LINK_EVENT);
@@ -11,6 +11,7 @@
 #include <functional>
 #include <iterator>
 #include <thread>
+#include <unordered_set>
 #include <utility>
 
 #include <folly/Format.h>
@@ -119,27 +120,49 @@ NetlinkFibHandler::buildNextHops(const fbnl::NextHopSet& nextHops) {
   return thriftNextHops;
 }
 
+const std::vector<thrift::NextHopThrift>&
+NetlinkFibHandler::buildNextHops(
+    const fbnl::CachedRoute& route, NextHopsCache& nextHopsCache) {
+  // nexthop sets are shared by the cached routes using them
+  auto it = nextHopsCache.find(route.nextHops.get());
+  if (it == nextHopsCache.end()) {
+    it = nextHopsCache
+             .emplace(
+                 route.nextHops.get(),
+                 route.nextHops ? buildNextHops(*route.nextHops)
+                                : std::vector<thrift::NextHopThrift>{})
+             .first;
+  }
+  return it->second;
+}
+
 std::vector<thrift::UnicastRoute>
-NetlinkFibHandler::toThriftUnicastRoutes(const fbnl::NlUnicastRoutes& routeDb) {
+NetlinkFibHandler::toThriftUnicastRoutes(
+    const fbnl::NetlinkRouteCache::UnicastRoutes& routeDb) {
   std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(routeDb.size());
+  NextHopsCache nextHopsCache;
 
   for (auto const& kv : routeDb) {
     thrift::UnicastRoute route;
-    route.dest = toIpPrefix(kv.first);
-    route.nextHops = buildNextHops(kv.second.getNextHops());
+    route.dest = toIpPrefix(kv.first.toNetwork());
+    route.nextHops = buildNextHops(kv.second, nextHopsCache);
     routes.emplace_back(std::move(route));
   }
   return routes;
 }
 
 std::vector<thrift::MplsRoute>
-NetlinkFibHandler::toThriftMplsRoutes(const fbnl::NlMplsRoutes& routeDb) {
+NetlinkFibHandler::toThriftMplsRoutes(
+    const fbnl::NetlinkRouteCache::MplsRoutes& routeDb) {
   std::vector<thrift::MplsRoute> routes;
+  routes.reserve(routeDb.size());
+  NextHopsCache nextHopsCache;
 
   for (auto const& kv : routeDb) {
     thrift::MplsRoute route;
     route.topLabel = kv.first;
-    route.nextHops = buildNextHops(kv.second.getNextHops());
+    route.nextHops = buildNextHops(kv.second, nextHopsCache);
 
     routes.emplace_back(std::move(route));
   }
@@ -187,27 +210,18 @@ NetlinkFibHandler::future_addUnicastRoutes(
 
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
 
-  // Run all route updates in a single eventloop
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     clientId,
-                                     promise = std::move(promise),
-                                     routes = std::move(routes)]() mutable {
-    for (auto& route : *routes) {
-      auto ptr = std::make_unique<thrift::UnicastRoute>(std::move(route));
-      try {
-        // This is going to be synchronous call as we are invoking from
-        // within event loop
-        future_addUnicastRoute(clientId, std::move(ptr)).get();
-      } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
-      }
-    }
-    promise.setValue();
-  });
-
-  return future;
+  // Program all routes as a single pipelined batch
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(routes->size());
+  for (const auto& route : *routes) {
+    nlRoutes.emplace_back(buildRoute(route, protocol.value()));
+  }
+  return netlinkSocket_->addUnicastRoutes(std::move(nlRoutes));
 }
 
 folly::Future<folly::Unit>
@@ -217,24 +231,20 @@ NetlinkFibHandler::future_deleteUnicastRoutes(
 
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     clientId,
-                                     promise = std::move(promise),
-                                     prefixes = std::move(prefixes)]() mutable {
-    for (auto& prefix : *prefixes) {
-      auto ptr = std::make_unique<thrift::IpPrefix>(std::move(prefix));
-      try {
-        future_deleteUnicastRoute(clientId, std::move(ptr)).get();
-      } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
-      }
-    }
-    promise.setValue();
-  });
-
-  return future;
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(prefixes->size());
+  for (const auto& prefix : *prefixes) {
+    fbnl::RouteBuilder rtBuilder;
+    rtBuilder.setDestination(toIPNetwork(prefix))
+        .setProtocolId(protocol.value());
+    nlRoutes.emplace_back(rtBuilder.build());
+  }
+  return netlinkSocket_->delUnicastRoutes(std::move(nlRoutes));
 }
 
 folly::Future<folly::Unit>
@@ -372,6 +382,102 @@ NetlinkFibHandler::future_syncMplsFib(
       protocol.value(), std::move(newMplsRoutes));
 }
 
+folly::Future<std::unique_ptr<std::vector<int64_t>>>
+NetlinkFibHandler::future_getRouteTableDigests(
+    int16_t clientId, int32_t numBuckets) {
+  VLOG(1) << "Get unicast route digests of client: " << getClientName(clientId)
+          << ", buckets: " << numBuckets;
+
+  folly::Promise<std::unique_ptr<std::vector<int64_t>>> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+  if (numBuckets <= 0) {
+    promise.setException(fbnl::NlException(
+        folly::sformat("Invalid number of buckets : {}", numBuckets)));
+    return future;
+  }
+
+  return netlinkSocket_->getUnicastRoutesSnapshot(protocol.value())
+      .thenValue(
+          [this, numBuckets](
+              std::shared_ptr<const fbnl::NetlinkRouteCache::UnicastRoutes>
+                  res) mutable {
+            return std::make_unique<std::vector<int64_t>>(
+                getRouteBucketDigests(toThriftUnicastRoutes(*res), numBuckets));
+          });
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_syncFibBuckets(
+    int16_t clientId,
+    int32_t numBuckets,
+    std::unique_ptr<std::vector<int32_t>> buckets,
+    std::unique_ptr<std::vector<thrift::UnicastRoute>> routes) {
+  LOG(INFO) << "Syncing " << buckets->size() << " of " << numBuckets
+            << " FIB buckets with " << routes->size()
+            << " routes. Client: " << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+  if (numBuckets <= 0) {
+    promise.setException(fbnl::NlException(
+        folly::sformat("Invalid number of buckets : {}", numBuckets)));
+    return future;
+  }
+
+  std::unordered_set<int32_t> syncedBuckets(
+      buckets->begin(), buckets->end());
+  std::unordered_set<folly::CIDRNetwork> newPrefixes;
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(routes->size());
+  for (const auto& route : *routes) {
+    if (!syncedBuckets.count(getRouteBucket(route.dest, numBuckets))) {
+      promise.setException(fbnl::NlException(folly::sformat(
+          "Route {} is not in a synced bucket", toString(route.dest))));
+      return future;
+    }
+    newPrefixes.emplace(toIPNetwork(route.dest));
+    nlRoutes.emplace_back(buildRoute(route, protocol.value()));
+  }
+
+  // Delete stale routes of synced buckets, then add or update the new ones.
+  // Routes of other buckets are left as they are
+  return netlinkSocket_->getUnicastRoutesSnapshot(protocol.value())
+      .thenValue(
+          [this,
+           numBuckets,
+           protocolId = protocol.value(),
+           syncedBuckets = std::move(syncedBuckets),
+           newPrefixes = std::move(newPrefixes)](
+              std::shared_ptr<const fbnl::NetlinkRouteCache::UnicastRoutes>
+                  res) mutable {
+            std::vector<fbnl::Route> staleRoutes;
+            for (const auto& kv : *res) {
+              const auto prefix = kv.first.toNetwork();
+              if (newPrefixes.count(prefix) ||
+                  !syncedBuckets.count(
+                      getRouteBucket(toIpPrefix(prefix), numBuckets))) {
+                continue;
+              }
+              fbnl::RouteBuilder rtBuilder;
+              rtBuilder.setDestination(prefix).setProtocolId(protocolId);
+              staleRoutes.emplace_back(rtBuilder.build());
+            }
+            return netlinkSocket_->delUnicastRoutes(std::move(staleRoutes));
+          })
+      .thenValue([this, nlRoutes = std::move(nlRoutes)](
+                     folly::Unit) mutable {
+        return netlinkSocket_->addUnicastRoutes(std::move(nlRoutes));
+      });
+}
+
 int64_t
 NetlinkFibHandler::aliveSince() {
   return startTime_;
@@ -402,11 +508,13 @@ NetlinkFibHandler::future_getRouteTableByClient(int16_t clientId) {
     return future;
   }
 
-  return netlinkSocket_->getCachedUnicastRoutes(protocol.value())
-      .thenValue([this](fbnl::NlUnicastRoutes res) mutable {
-        return std::make_unique<std::vector<openr::thrift::UnicastRoute>>(
-            toThriftUnicastRoutes(res));
-      })
+  return netlinkSocket_->getUnicastRoutesSnapshot(protocol.value())
+      .thenValue(
+          [this](std::shared_ptr<const fbnl::NetlinkRouteCache::UnicastRoutes>
+                     res) mutable {
+            return std::make_unique<std::vector<openr::thrift::UnicastRoute>>(
+                toThriftUnicastRoutes(*res));
+          })
       .thenError<std::runtime_error>([](std::exception const& ex) {
         LOG(ERROR) << "Failed to get unicast routing table by client: "
                    << ex.what() << ", returning empty table instead";
@@ -427,11 +535,13 @@ NetlinkFibHandler::future_getMplsRouteTableByClient(int16_t clientId) {
     return future;
   }
 
-  return netlinkSocket_->getCachedMplsRoutes(protocol.value())
-      .thenValue([this](fbnl::NlMplsRoutes res) mutable {
-        return std::make_unique<std::vector<openr::thrift::MplsRoute>>(
-            toThriftMplsRoutes(res));
-      })
+  return netlinkSocket_->getMplsRoutesSnapshot(protocol.value())
+      .thenValue(
+          [this](std::shared_ptr<const fbnl::NetlinkRouteCache::MplsRoutes>
+                     res) mutable {
+            return std::make_unique<std::vector<openr::thrift::MplsRoute>>(
+                toThriftMplsRoutes(*res));
+          })
       .thenError<std::runtime_error>([](std::exception const& ex) {
         LOG(ERROR) << "Failed to get Mpls routing table by client: "
                    << ex.what() << ", returning empty table instead";
@@ -518,6 +628,9 @@ NetlinkFibHandler::buildMplsRoute(
 void
 NetlinkFibHandler::getCounters(std::map<std::string, int64_t>& counters) {
   counters["fibagent.num_of_routes"] = netlinkSocket_->getRouteCount().get();
+  for (auto const& kv : netlinkSocket_->getEventCounters()) {
+    counters["fibagent." + kv.first] = kv.second;
+  }
 }
 
 void
@@ -11,6 +11,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <fbzmq/async/ZmqTimeout.h>
@@ -75,6 +76,15 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
       int16_t clientId,
       std::unique_ptr<std::vector<thrift::MplsRoute>> routes) override;
 
+  folly::Future<std::unique_ptr<std::vector<int64_t>>>
+  future_getRouteTableDigests(int16_t clientId, int32_t numBuckets) override;
+
+  folly::Future<folly::Unit> future_syncFibBuckets(
+      int16_t clientId,
+      int32_t numBuckets,
+      std::unique_ptr<std::vector<int32_t>> buckets,
+      std::unique_ptr<std::vector<thrift::UnicastRoute>> routes) override;
+
   void sendNeighborDownInfo(
       std::unique_ptr<std::vector<std::string>> neighborIp) override;
 
@@ -128,14 +138,23 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
       folly::Promise<A>& promise, int16_t clientId);
 
   std::vector<thrift::UnicastRoute> toThriftUnicastRoutes(
-      const fbnl::NlUnicastRoutes& routeDb);
+      const fbnl::NetlinkRouteCache::UnicastRoutes& routeDb);
 
   std::vector<thrift::MplsRoute> toThriftMplsRoutes(
-      const fbnl::NlMplsRoutes& routeDb);
+      const fbnl::NetlinkRouteCache::MplsRoutes& routeDb);
 
   std::vector<thrift::NextHopThrift> buildNextHops(
       const fbnl::NextHopSet& nextHopSet);
 
+  // thrift nexthops of interned nexthop sets
+  using NextHopsCache = std::unordered_map<
+      const fbnl::NextHopSet*,
+      std::vector<thrift::NextHopThrift>>;
+
+  // thrift nexthops of a cached route, converted once per nexthop set
+  const std::vector<thrift::NextHopThrift>& buildNextHops(
+      const fbnl::CachedRoute& route, NextHopsCache& nextHopsCache);
+
   fbnl::Route buildRoute(const thrift::UnicastRoute& route, int protocol) const
       noexcept;
 
@@ -59,18 +59,18 @@ NetlinkSystemHandler::doGetAllLinks() {
   auto linkDb = std::make_unique<std::vector<thrift::Link>>();
   auto links = netlinkSocket_->getAllLinks().get();
 
-  linkDb->clear();
-
-  for (const auto kv : links) {
-    thrift::Link linkEntry;
+  linkDb->reserve(links.size());
+  for (const auto& kv : links) {
+    linkDb->emplace_back();
+    auto& linkEntry = linkDb->back();
     linkEntry.ifName = kv.first;
     linkEntry.ifIndex = kv.second.ifIndex;
     linkEntry.isUp = kv.second.isUp;
-    for (const auto network : kv.second.networks) {
-      linkEntry.networks.push_back(thrift::IpPrefix(
-          FRAGILE, toBinaryAddress(network.first), network.second));
+    linkEntry.networks.reserve(kv.second.networks.size());
+    for (const auto& network : kv.second.networks) {
+      linkEntry.networks.emplace_back(
+          FRAGILE, toBinaryAddress(network.first), network.second);
     }
-    linkDb->push_back(linkEntry);
   }
   return linkDb;
 }
@@ -105,7 +105,8 @@ NetlinkSystemHandler::doGetAllNeighbors() {
         kv.first.first,
         toBinaryAddress(kv.first.second),
         kv.second.getLinkAddress().value().toString(),
-        true);
+        true,
+        false);
     neighborDb->push_back(neighborEntry);
   }
   return neighborDb;
@@ -26,10 +26,13 @@ using apache::thrift::FRAGILE;
 namespace openr {
 
 PlatformPublisher::PlatformPublisher(
-    fbzmq::Context& context, const PlatformPublisherUrl& platformPubUrl)
-    : platformPubUrl_(platformPubUrl) {
+    fbzmq::Context& context,
+    const PlatformPublisherUrl& platformPubUrl,
+    fbzmq::ZmqEventLoop* nlEventLoop,
+    std::chrono::milliseconds coalesceWindow)
+    : platformPubUrl_(platformPubUrl), coalesceWindow_(coalesceWindow) {
   // Initialize ZMQ sockets
-  platformPubSock_ = fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER>(
+  platformPubSock_ = fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER>(
       context, folly::none, folly::none, fbzmq::NonblockingFlag{true});
   VLOG(2) << "Platform Publisher: Binding pub url '" << platformPubUrl_ << "'";
   const auto platformPub =
@@ -38,10 +41,18 @@ PlatformPublisher::PlatformPublisher(
     LOG(FATAL) << "Error binding to URL '" << platformPubUrl_ << "' "
                << platformPub.error();
   }
+
+  if (nlEventLoop and coalesceWindow_.count() > 0) {
+    coalesceTimer_ = fbzmq::ZmqTimeout::make(
+        nlEventLoop, [this]() noexcept { flushPendingEvents(); });
+  }
 }
 
 void
 PlatformPublisher::publishLinkEvent(const thrift::LinkEntry& link) {
+  if (not hasSubscribers(thrift::PlatformEventType::LINK_EVENT)) {
+    return;
+  }
   // advertise change of link, prompting subscriber modules to
   // take immediate action
   thrift::PlatformEvent msg;
@@ -52,6 +63,9 @@ PlatformPublisher::publishLinkEvent(const thrift::LinkEntry& link) {
 
 void
 PlatformPublisher::publishAddrEvent(const thrift::AddrEntry& address) {
+  if (not hasSubscribers(thrift::PlatformEventType::ADDRESS_EVENT)) {
+    return;
+  }
   // advertise change of address, prompting subscriber modules to
   // take immediate action
   thrift::PlatformEvent msg;
@@ -62,6 +76,9 @@ PlatformPublisher::publishAddrEvent(const thrift::AddrEntry& address) {
 
 void
 PlatformPublisher::publishNeighborEvent(const thrift::NeighborEntry& neighbor) {
+  if (not hasSubscribers(thrift::PlatformEventType::NEIGHBOR_EVENT)) {
+    return;
+  }
   // advertise change of neighbor, prompting subscriber modules to
   // take immediate action
   thrift::PlatformEvent msg;
@@ -70,6 +87,54 @@ PlatformPublisher::publishNeighborEvent(const thrift::NeighborEntry& neighbor) {
   publishPlatformEvent(msg);
 }
 
+void
+PlatformPublisher::publishEventBatch(const thrift::PlatformEventBatch& batch) {
+  if (not hasSubscribers(thrift::PlatformEventType::EVENT_BATCH)) {
+    return;
+  }
+  thrift::PlatformEvent msg;
+  msg.eventType = thrift::PlatformEventType::EVENT_BATCH;
+  msg.eventData = fbzmq::util::writeThriftObjStr(batch, serializer_);
+  publishPlatformEvent(msg);
+}
+
+void
+PlatformPublisher::flushPendingEvents() {
+  // a lone event goes out as is
+  if (pendingLinks_.size() + pendingAddrs_.size() == 1) {
+    if (pendingLinks_.size()) {
+      publishLinkEvent(pendingLinks_.begin()->second);
+    } else {
+      publishAddrEvent(pendingAddrs_.begin()->second);
+    }
+  } else if (pendingLinks_.size() or pendingAddrs_.size()) {
+    VLOG(2) << "Publishing " << pendingLinks_.size() << " link and "
+            << pendingAddrs_.size() << " address events in a batch";
+    thrift::PlatformEventBatch batch;
+    batch.linkEntries.reserve(pendingLinks_.size());
+    for (auto& kv : pendingLinks_) {
+      batch.linkEntries.emplace_back(std::move(kv.second));
+    }
+    batch.addrEntries.reserve(pendingAddrs_.size());
+    for (auto& kv : pendingAddrs_) {
+      batch.addrEntries.emplace_back(std::move(kv.second));
+    }
+    publishEventBatch(batch);
+  }
+  pendingLinks_.clear();
+  pendingAddrs_.clear();
+}
+
+bool
+PlatformPublisher::hasSubscribers(thrift::PlatformEventType eventType) {
+  subscriptions_.update(platformPubSock_);
+  // events are sent with their type in the first 2 bytes
+  const auto eventTypeHeader = static_cast<uint16_t>(eventType);
+  return subscriptions_.hasSubscribers(folly::ByteRange(
+      reinterpret_cast<const uint8_t*>(&eventTypeHeader),
+      sizeof(eventTypeHeader)));
+}
+
 void
 PlatformPublisher::publishPlatformEvent(const thrift::PlatformEvent& msg) {
   VLOG(3) << "Publishing PlatformEvent...";
@@ -91,12 +156,20 @@ void
 PlatformPublisher::linkEventFunc(
     const std::string& ifName, const openr::fbnl::Link& linkEntry) noexcept {
   VLOG(4) << "Handling Link Event in NetlinkSystemHandler...";
-  publishLinkEvent(thrift::LinkEntry(
+  thrift::LinkEntry link(
       FRAGILE,
       ifName,
       linkEntry.getIfIndex(),
       linkEntry.isUp(),
-      Constants::kDefaultAdjWeight));
+      Constants::kDefaultAdjWeight);
+  if (not coalesceTimer_) {
+    publishLinkEvent(link);
+    return;
+  }
+  pendingLinks_[link.ifIndex] = std::move(link);
+  if (not coalesceTimer_->isScheduled()) {
+    coalesceTimer_->scheduleTimeout(coalesceWindow_);
+  }
 }
 
 void
@@ -105,13 +178,21 @@ PlatformPublisher::addrEventFunc(
     const openr::fbnl::IfAddress& addrEntry) noexcept {
   VLOG(4) << "Handling Address Event in NetlinkSystemHandler...";
   thrift::IpPrefix prefix{};
-  publishAddrEvent(thrift::AddrEntry(
+  thrift::AddrEntry address(
       FRAGILE,
       ifName,
       addrEntry.getPrefix().hasValue()
           ? toIpPrefix(addrEntry.getPrefix().value())
           : prefix,
-      addrEntry.isValid()));
+      addrEntry.isValid());
+  if (not coalesceTimer_) {
+    publishAddrEvent(address);
+    return;
+  }
+  pendingAddrs_[std::make_pair(ifName, address.ipPrefix)] = std::move(address);
+  if (not coalesceTimer_->isScheduled()) {
+    coalesceTimer_->scheduleTimeout(coalesceWindow_);
+  }
 }
 
 void
@@ -126,7 +207,8 @@ PlatformPublisher::neighborEventFunc(
       neighborEntry.getLinkAddress().hasValue()
           ? neighborEntry.getLinkAddress().value().toString()
           : "",
-      neighborEntry.isReachable()));
+      neighborEntry.isReachable(),
+      neighborEntry.getState() == NUD_FAILED));
 }
 
 void
@@ -10,14 +10,19 @@
 #include <syslog.h>
 #include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
 
+
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Types.h>
+#include <openr/common/XpubSubscriptions.h>
 #include <openr/if/gen-cpp2/Platform_types.h>
 #include <openr/nl/NetlinkSocket.h>
 #include <openr/nl/NetlinkTypes.h>
@@ -29,6 +34,13 @@ namespace openr {
  * message passing mechanism. Event will be sent over Zmq PUB socket which
  * OpenR modules can subscribe through SUB socket. The subscriber modules is
  * LinkMonitor from Open/R side.
+ *
+ * Events of types nobody subscribed to are dropped before being encoded.
+ *
+ * If an event loop and a coalesce window are given, netlink link/address
+ * events (which arrive on that event loop) are coalesced for the window,
+ * keeping only the latest state per ifIndex and per interface prefix, and
+ * published as a single EVENT_BATCH event.
  */
 class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
  public:
@@ -37,7 +49,9 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       // Immutable state initializers
       //
       fbzmq::Context& context,
-      const PlatformPublisherUrl& platformPubUrl);
+      const PlatformPublisherUrl& platformPubUrl,
+      fbzmq::ZmqEventLoop* nlEventLoop = nullptr,
+      std::chrono::milliseconds coalesceWindow = std::chrono::milliseconds(0));
 
   ~PlatformPublisher() = default;
 
@@ -53,6 +67,8 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
 
   void publishNeighborEvent(const thrift::NeighborEntry& neighbor);
 
+  void publishEventBatch(const thrift::PlatformEventBatch& batch);
+
   void stop();
 
  private:
@@ -69,14 +85,34 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       const std::string& ifName,
       const openr::fbnl::Neighbor& neighborEntry) noexcept override;
 
+  // publish coalesced link/address events
+  void flushPendingEvents();
+
+  // whether anyone subscribed to events of eventType, events are not even
+  // encoded otherwise
+  bool hasSubscribers(thrift::PlatformEventType eventType);
+
   // Publish link events to, e.g., LinkMonitor and Squire
   const std::string platformPubUrl_;
 
   // publish our own events (link up/down, addr changes, etc)
-  fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER> platformPubSock_;
+  fbzmq::Socket<ZMQ_XPUB, fbzmq::ZMQ_SERVER> platformPubSock_;
+
+  // event types subscribed to on platformPubSock_
+  XpubSubscriptions subscriptions_;
 
   // used for communicating over thrift/zmq sockets
   apache::thrift::CompactSerializer serializer_;
+
+  // events are coalesced for coalesceWindow_ if set
+  const std::chrono::milliseconds coalesceWindow_{0};
+  std::unique_ptr<fbzmq::ZmqTimeout> coalesceTimer_;
+
+  // latest link entry per ifIndex and address entry per interface prefix
+  // since the last flush
+  std::map<int64_t, thrift::LinkEntry> pendingLinks_;
+  std::map<std::pair<std::string, thrift::IpPrefix>, thrift::AddrEntry>
+      pendingAddrs_;
 };
 
 } // namespace openr
@@ -4,10 +4,14 @@
  * This source code is licensed under the MIT license found in the
  * LICENSE file in the root directory of this source tree.
  */
-#include <map>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/zmq/Zmq.h>
@@ -15,32 +19,42 @@
 #include <folly/Exception.h>
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
-#include <folly/MacAddress.h>
-#include <folly/Random.h>
 #include <folly/Subprocess.h>
-#include <folly/gen/Base.h>
 #include <folly/init/Init.h>
-#include <folly/system/Shell.h>
-#include <folly/test/TestUtils.h>
-#include <openr/fib/tests/PrefixGenerator.h>
+#include <gflags/gflags.h>
+
+#include <openr/common/LatencyHistogram.h>
+#include <openr/common/Util.h>
 #include <openr/nl/NetlinkSocket.h>
 #include <openr/platform/NetlinkFibHandler.h>
+#include <openr/tests/BenchmarkUtils.h>
 
-extern "C" {
-#include <net/if.h>
-}
+DEFINE_bool(
+    scratch_netns,
+    true,
+    "Run benchmarks in a network namespace of their own, so that routes of "
+    "the host are left untouched");
 
 using namespace openr::fbnl;
-using namespace folly::literals::shell_literals;
 
 namespace {
 // Virtual interfaces
 const std::string kVethNameX("vethTestX");
 const std::string kVethNameY("vethTestY");
-// Prefix length of a subnet
-static const uint8_t kBitMaskLen = 128;
-// Number of nexthops
-const uint8_t kNumOfNexthops = 128;
+
+// Routes sent per request to the handler, as Fib would when programming
+// large route updates
+const size_t kBatchSize{1000};
+
+// First label of MPLS routes
+const int32_t kFirstLabel{100};
+
+void
+runCommand(const std::string& command) {
+  folly::Subprocess proc(std::vector<std::string>{"/bin/sh", "-c", command});
+  // Ignore result
+  proc.wait();
+}
 
 } // namespace
 
@@ -54,24 +68,25 @@ class NetlinkFibWrapper {
  public:
   NetlinkFibWrapper() {
     // cleanup old interfaces in any
-    auto cmd = "ip link del {} 2>/dev/null"_shellify(kVethNameX.c_str());
-    folly::Subprocess proc(std::move(cmd));
-    // Ignore result
-    proc.wait();
+    runCommand(folly::sformat("ip link del {} 2>/dev/null", kVethNameX));
 
     // add veth interface pair
-    cmd = "ip link add {} type veth peer name {}"_shellify(
-        kVethNameX.c_str(), kVethNameY.c_str());
-    folly::Subprocess proc1(std::move(cmd));
-    proc1.wait();
+    runCommand(folly::sformat(
+        "ip link add {} type veth peer name {}", kVethNameX, kVethNameY));
 
-    addAddress(kVethNameX, "169.254.0.101");
-    addAddress(kVethNameY, "169.254.0.102");
+    // nexthops of IPv4 routes are within the /16 of the interfaces
+    addAddress(kVethNameX, "169.254.0.101/16");
+    addAddress(kVethNameY, "169.254.0.102/16");
 
     // set interface status to up
     bringUpIntf(kVethNameX);
     bringUpIntf(kVethNameY);
 
+    // allow MPLS routes of all benchmarked labels
+    runCommand("sysctl -qw net.mpls.platform_labels=1048575");
+    runCommand(
+        folly::sformat("sysctl -qw net.mpls.conf.{}.input=1", kVethNameY));
+
     // Create NetlinkProtocolSocket
     std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlProtocolSocket;
     nlProtocolSocket =
@@ -102,10 +117,7 @@ class NetlinkFibWrapper {
 
   ~NetlinkFibWrapper() {
     // cleanup virtual interfaces
-    auto cmd = "ip link del {} 2>/dev/null"_shellify(kVethNameX.c_str());
-    folly::Subprocess proc(std::move(cmd));
-    // Ignore result
-    proc.wait();
+    runCommand(folly::sformat("ip link del {} 2>/dev/null", kVethNameX));
 
     if (evl.isRunning()) {
       evl.stop();
@@ -126,80 +138,450 @@ class NetlinkFibWrapper {
   std::thread eventThread;
   std::thread nlProtocolSocketThread;
   std::shared_ptr<NetlinkFibHandler> fibHandler;
-  PrefixGenerator prefixGenerator;
-
-  struct rtnl_link* link_{nullptr};
-  struct nl_sock* socket_{nullptr};
-  struct nl_cache* linkCache_{nullptr};
-  struct nl_cache* addrCache_{nullptr};
-  struct nl_cache* routeCache_{nullptr};
 
  private:
-  void
+  static void
   addAddress(const std::string& ifName, const std::string& address) {
-    auto cmd =
-        "ip addr add {} dev {}"_shellify(address.c_str(), ifName.c_str());
-    folly::Subprocess proc(std::move(cmd));
-    proc.wait();
+    runCommand(folly::sformat("ip addr add {} dev {}", address, ifName));
   }
 
   static void
   bringUpIntf(const std::string& ifName) {
-    auto cmd = "ip link set dev {} up"_shellify(ifName.c_str());
-    folly::Subprocess proc(std::move(cmd));
-    proc.wait();
+    runCommand(folly::sformat("ip link set dev {} up", ifName));
   }
 };
 
+namespace {
+
+enum class RouteOp {
+  ADD = 0,
+  UPDATE = 1,
+  DELETE = 2,
+  SYNC = 3,
+};
+
+//
+// Measurements of a benchmark, reported by insertUserCounters()
+//
+struct RouteOpStats {
+  // latency from request until the handler got all kernel acks
+  LatencyHistogram ackLatencies;
+  // user and system time of the whole process, including netlink threads
+  uint64_t cpuTimeUs{0};
+  uint64_t numOfRoutes{0};
+};
+
+uint64_t
+getCpuTimeUs() {
+  struct rusage usage;
+  CHECK_EQ(0, getrusage(RUSAGE_SELF, &usage));
+  auto toUs = [](const struct timeval& tv) {
+    return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+  };
+  return toUs(usage.ru_utime) + toUs(usage.ru_stime);
+}
+
+// Run and wait for a request of numOfRoutes routes, recording its latency
+template <typename Request>
+void
+measureRequest(RouteOpStats& stats, size_t numOfRoutes, Request&& request) {
+  const auto startCpuTimeUs = getCpuTimeUs();
+  const auto startTime = std::chrono::steady_clock::now();
+  request().get();
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  stats.ackLatencies.addValue(duration.count());
+  stats.cpuTimeUs += getCpuTimeUs() - startCpuTimeUs;
+  stats.numOfRoutes += numOfRoutes;
+}
+
+void
+insertUserCounters(folly::UserCounters& counters, const RouteOpStats& stats) {
+  counters["ack_p50_ms"] = stats.ackLatencies.getPercentile(0.5);
+  counters["ack_p99_ms"] = stats.ackLatencies.getPercentile(0.99);
+  counters["ack_p999_ms"] = stats.ackLatencies.getPercentile(0.999);
+  counters["cpu_ns_per_route"] =
+      stats.numOfRoutes ? stats.cpuTimeUs * 1000 / stats.numOfRoutes : 0;
+}
+
+// Nexthops out of a pool of 128 per family, on the veth interface. Routes
+// are updated by shifting their nexthops within the pool
+std::vector<thrift::NextHopThrift>
+getNextHops(bool isV4, uint32_t ecmpWidth, uint32_t offset) {
+  std::vector<thrift::NextHopThrift> nextHops;
+  nextHops.reserve(ecmpWidth);
+  for (uint32_t i = 0; i < ecmpWidth; ++i) {
+    const auto index = (offset + i) % 128 + 1;
+    const auto addr = isV4
+        ? folly::IPAddress(folly::sformat("169.254.1.{}", index))
+        : folly::IPAddress(folly::sformat("fe80::{:x}", index));
+    nextHops.emplace_back(createNextHop(toBinaryAddress(addr), kVethNameY, 1));
+  }
+  return nextHops;
+}
+
+// Distinct host prefix of the given index
+thrift::IpPrefix
+getPrefix(bool isV4, uint32_t index) {
+  if (isV4) {
+    return toIpPrefix(std::make_pair(
+        folly::IPAddress(folly::IPAddressV4::fromLongHBO(0x0a000000 + index)),
+        32));
+  }
+  return toIpPrefix(std::make_pair(
+      folly::IPAddress(folly::sformat(
+          "fc00:{:x}:{:x}::1", index >> 16, index & 0xffff)),
+      128));
+}
+
+std::vector<thrift::UnicastRoute>
+createUnicastRoutes(
+    uint32_t numOfRoutes, uint32_t ecmpWidth, bool isV4, uint32_t offset) {
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(numOfRoutes);
+  for (uint32_t i = 0; i < numOfRoutes; ++i) {
+    routes.emplace_back(createUnicastRoute(
+        getPrefix(isV4, i), getNextHops(isV4, ecmpWidth, offset)));
+  }
+  return routes;
+}
+
+std::vector<thrift::MplsRoute>
+createMplsRoutes(uint32_t numOfRoutes, uint32_t ecmpWidth, uint32_t offset) {
+  std::vector<thrift::MplsRoute> routes;
+  routes.reserve(numOfRoutes);
+  for (uint32_t i = 0; i < numOfRoutes; ++i) {
+    auto nextHops = getNextHops(false, ecmpWidth, offset);
+    for (auto& nextHop : nextHops) {
+      nextHop.mplsAction =
+          createMplsAction(thrift::MplsActionCode::SWAP, kFirstLabel + i);
+    }
+    routes.emplace_back(createMplsRoute(kFirstLabel + i, std::move(nextHops)));
+  }
+  return routes;
+}
+
+//
+// Requests of the handler for each kind of routes
+//
+folly::Future<folly::Unit>
+addRoutes(
+    NetlinkFibHandler& handler, std::vector<thrift::UnicastRoute> routes) {
+  return handler.future_addUnicastRoutes(
+      kFibId,
+      std::make_unique<std::vector<thrift::UnicastRoute>>(std::move(routes)));
+}
+
+folly::Future<folly::Unit>
+addRoutes(NetlinkFibHandler& handler, std::vector<thrift::MplsRoute> routes) {
+  return handler.future_addMplsRoutes(
+      kFibId,
+      std::make_unique<std::vector<thrift::MplsRoute>>(std::move(routes)));
+}
+
+folly::Future<folly::Unit>
+deleteRoutes(
+    NetlinkFibHandler& handler,
+    const std::vector<thrift::UnicastRoute>& routes) {
+  auto prefixes = std::make_unique<std::vector<thrift::IpPrefix>>();
+  prefixes->reserve(routes.size());
+  for (auto const& route : routes) {
+    prefixes->emplace_back(route.dest);
+  }
+  return handler.future_deleteUnicastRoutes(kFibId, std::move(prefixes));
+}
+
+folly::Future<folly::Unit>
+deleteRoutes(
+    NetlinkFibHandler& handler, const std::vector<thrift::MplsRoute>& routes) {
+  auto labels = std::make_unique<std::vector<int32_t>>();
+  labels->reserve(routes.size());
+  for (auto const& route : routes) {
+    labels->emplace_back(route.topLabel);
+  }
+  return handler.future_deleteMplsRoutes(kFibId, std::move(labels));
+}
+
+folly::Future<folly::Unit>
+syncRoutes(
+    NetlinkFibHandler& handler, std::vector<thrift::UnicastRoute> routes) {
+  return handler.future_syncFib(
+      kFibId,
+      std::make_unique<std::vector<thrift::UnicastRoute>>(std::move(routes)));
+}
+
+folly::Future<folly::Unit>
+syncRoutes(NetlinkFibHandler& handler, std::vector<thrift::MplsRoute> routes) {
+  return handler.future_syncMplsFib(
+      kFibId,
+      std::make_unique<std::vector<thrift::MplsRoute>>(std::move(routes)));
+}
+
+template <typename Route>
+std::vector<std::vector<Route>>
+getBatches(const std::vector<Route>& routes) {
+  std::vector<std::vector<Route>> batches;
+  for (size_t i = 0; i < routes.size(); i += kBatchSize) {
+    batches.emplace_back(
+        routes.begin() + i,
+        routes.begin() + std::min(i + kBatchSize, routes.size()));
+  }
+  return batches;
+}
+
+// Program routes in batches, without measuring
+template <typename Route>
+void
+programRoutes(NetlinkFibHandler& handler, const std::vector<Route>& routes) {
+  for (auto& batch : getBatches(routes)) {
+    addRoutes(handler, std::move(batch)).get();
+  }
+}
+
 /**
- * Benchmark test to measure the time performance of NetlinkFibHandler
- * 1. Create a NetlinkFibHandler
- * 2. Generate random IpV6s and routes
- * 3. Add routes through netlink
- * 4. Wait until the completion of routes update
+ * Benchmark of a route operation of NetlinkFibHandler against the kernel
+ * - ADD: install routes, which are deleted after each iteration
+ * - UPDATE: replace nexthops of installed routes
+ * - DELETE: delete routes, which are installed before each iteration
+ * - SYNC: syncFib with a table where 1% of installed routes changed
+ * Routes are sent in batches of kBatchSize, except for SYNC. Ack latency is
+ * measured per request.
  */
-static void
-BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
+template <typename Route, typename CreateRoutes>
+void
+runRouteOp(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    RouteOp op,
+    CreateRoutes&& createRoutes) {
   auto suspender = folly::BenchmarkSuspender();
   auto netlinkFibWrapper = std::make_unique<NetlinkFibWrapper>();
+  auto& handler = *netlinkFibWrapper->fibHandler;
+  const std::vector<Route> routes = createRoutes(0);
+  RouteOpStats stats;
 
-  // Randomly generate IPV6 prefixes
-  auto prefixes = netlinkFibWrapper->prefixGenerator.ipv6PrefixGenerator(
-      numOfPrefixes, kBitMaskLen);
-
-  suspender.dismiss(); // Start measuring benchmark time
+  if (op != RouteOp::ADD and op != RouteOp::DELETE) {
+    programRoutes(handler, routes);
+  }
 
   for (uint32_t i = 0; i < iters; i++) {
-    auto routes = std::make_unique<std::vector<thrift::UnicastRoute>>();
-    routes->reserve(prefixes.size());
-
-    // Update routes by randomly regenerating nextHops for kDeltaSize prefixes.
-    for (uint32_t index = 0; index < numOfPrefixes; index++) {
-      routes->emplace_back(createUnicastRoute(
-          prefixes[index],
-          netlinkFibWrapper->prefixGenerator.getRandomNextHopsUnicast(
-              kNumOfNexthops, kVethNameY)));
+    switch (op) {
+    case RouteOp::ADD: {
+      auto batches = getBatches(routes);
+      suspender.dismiss(); // Start measuring benchmark time
+      for (auto& batch : batches) {
+        const auto numOfRoutes = batch.size();
+        measureRequest(stats, numOfRoutes, [&]() {
+          return addRoutes(handler, std::move(batch));
+        });
+      }
+      suspender.rehire(); // Stop measuring time again
+      deleteRoutes(handler, routes).get();
+      break;
+    }
+    case RouteOp::UPDATE: {
+      auto batches = getBatches(createRoutes(i + 1));
+      suspender.dismiss();
+      for (auto& batch : batches) {
+        const auto numOfRoutes = batch.size();
+        measureRequest(stats, numOfRoutes, [&]() {
+          return addRoutes(handler, std::move(batch));
+        });
+      }
+      suspender.rehire();
+      break;
+    }
+    case RouteOp::DELETE: {
+      programRoutes(handler, routes);
+      auto batches = getBatches(routes);
+      suspender.dismiss();
+      for (auto const& batch : batches) {
+        measureRequest(stats, batch.size(), [&]() {
+          return deleteRoutes(handler, batch);
+        });
+      }
+      suspender.rehire();
+      break;
+    }
+    case RouteOp::SYNC: {
+      auto syncedRoutes = createRoutes(0);
+      const auto updatedRoutes = createRoutes(i + 1);
+      for (size_t j = 0; j < syncedRoutes.size(); j += 100) {
+        syncedRoutes[j] = updatedRoutes[j];
+      }
+      suspender.dismiss();
+      measureRequest(stats, syncedRoutes.size(), [&]() {
+        return syncRoutes(handler, std::move(syncedRoutes));
+      });
+      suspender.rehire();
+      break;
+    }
     }
-
-    suspender.rehire(); // Stop measuring time again
-    // Add new routes through netlink
-    netlinkFibWrapper->fibHandler
-        ->future_addUnicastRoutes(kFibId, std::move(routes))
-        .wait();
   }
+
+  insertUserCounters(counters, stats);
+}
+
+void
+runUnicastRouteOp(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    RouteOp op,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth,
+    bool isV4) {
+  runRouteOp<thrift::UnicastRoute>(
+      counters, iters, op, [=](uint32_t offset) {
+        return createUnicastRoutes(numOfRoutes, ecmpWidth, isV4, offset);
+      });
+}
+
+void
+runMplsRouteOp(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    RouteOp op,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth) {
+  runRouteOp<thrift::MplsRoute>(counters, iters, op, [=](uint32_t offset) {
+    return createMplsRoutes(numOfRoutes, ecmpWidth, offset);
+  });
+}
+
+} // namespace
+
+static void
+BM_UnicastAdd(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth,
+    bool isV4) {
+  runUnicastRouteOp(
+      counters, iters, RouteOp::ADD, numOfRoutes, ecmpWidth, isV4);
 }
 
-// The parameter is the number of prefixes
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 10);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 100);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 1000);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 10000);
+static void
+BM_UnicastUpdate(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth,
+    bool isV4) {
+  runUnicastRouteOp(
+      counters, iters, RouteOp::UPDATE, numOfRoutes, ecmpWidth, isV4);
+}
+
+static void
+BM_UnicastDelete(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth,
+    bool isV4) {
+  runUnicastRouteOp(
+      counters, iters, RouteOp::DELETE, numOfRoutes, ecmpWidth, isV4);
+}
+
+static void
+BM_UnicastSync(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth,
+    bool isV4) {
+  runUnicastRouteOp(
+      counters, iters, RouteOp::SYNC, numOfRoutes, ecmpWidth, isV4);
+}
+
+static void
+BM_MplsAdd(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth) {
+  runMplsRouteOp(counters, iters, RouteOp::ADD, numOfRoutes, ecmpWidth);
+}
+
+static void
+BM_MplsUpdate(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth) {
+  runMplsRouteOp(counters, iters, RouteOp::UPDATE, numOfRoutes, ecmpWidth);
+}
+
+static void
+BM_MplsDelete(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth) {
+  runMplsRouteOp(counters, iters, RouteOp::DELETE, numOfRoutes, ecmpWidth);
+}
+
+static void
+BM_MplsSync(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t ecmpWidth) {
+  runMplsRouteOp(counters, iters, RouteOp::SYNC, numOfRoutes, ecmpWidth);
+}
+
+/*
+ * Registers the benchmark for 10k, 100k and 1M routes, each of ECMP width 1,
+ * 8 and 64. Extra arguments are passed after the number of routes and the
+ * ECMP width. Use --bm_regex to run a subset, e.g. "UnicastAdd.*v6_100k".
+ */
+#define BENCHMARK_ROUTE_SCALES(name, prefix, ...)                      \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_10k_ecmp1, 10000, 1, ##__VA_ARGS__)     \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_10k_ecmp8, 10000, 8, ##__VA_ARGS__)     \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_10k_ecmp64, 10000, 64, ##__VA_ARGS__)   \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_100k_ecmp1, 100000, 1, ##__VA_ARGS__)   \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_100k_ecmp8, 100000, 8, ##__VA_ARGS__)   \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_100k_ecmp64, 100000, 64, ##__VA_ARGS__) \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_1m_ecmp1, 1000000, 1, ##__VA_ARGS__)    \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_1m_ecmp8, 1000000, 8, ##__VA_ARGS__)    \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                       \
+      name, counters, prefix##_1m_ecmp64, 1000000, 64, ##__VA_ARGS__)
+
+BENCHMARK_ROUTE_SCALES(BM_UnicastAdd, v4, true)
+BENCHMARK_ROUTE_SCALES(BM_UnicastAdd, v6, false)
+BENCHMARK_ROUTE_SCALES(BM_UnicastUpdate, v4, true)
+BENCHMARK_ROUTE_SCALES(BM_UnicastUpdate, v6, false)
+BENCHMARK_ROUTE_SCALES(BM_UnicastDelete, v4, true)
+BENCHMARK_ROUTE_SCALES(BM_UnicastDelete, v6, false)
+BENCHMARK_ROUTE_SCALES(BM_UnicastSync, v4, true)
+BENCHMARK_ROUTE_SCALES(BM_UnicastSync, v6, false)
+BENCHMARK_ROUTE_SCALES(BM_MplsAdd, mpls)
+BENCHMARK_ROUTE_SCALES(BM_MplsUpdate, mpls)
+BENCHMARK_ROUTE_SCALES(BM_MplsDelete, mpls)
+BENCHMARK_ROUTE_SCALES(BM_MplsSync, mpls)
 
 } // namespace openr
 
 int
 main(int argc, char** argv) {
   folly::init(&argc, &argv);
+
+  // Threads created from now on, including the ones of netlink sockets and
+  // of `ip` commands, live in the scratch namespace
+  if (FLAGS_scratch_netns) {
+    folly::checkUnixError(
+        unshare(CLONE_NEWNET), "Failed to create network namespace");
+    runCommand("ip link set dev lo up");
+  }
+
   folly::runBenchmarks();
   return 0;
 }
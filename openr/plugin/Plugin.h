@@ -13,6 +13,7 @@
 #include <wangle/ssl/SSLContextConfig.h>
 
 #include <openr/common/Types.h>
+#include <openr/fib/RouteUpdate.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/PrefixManager_types.h>
 #include <openr/messaging/Queue.h>
@@ -22,7 +23,7 @@ namespace openr {
 struct PluginArgs {
   std::string myNodeName;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest>& prefixUpdatesQueue;
-  messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
+  messaging::RQueue<RouteUpdate> routeUpdatesQueue;
   bool enableSegmentRouting{false};
   std::shared_ptr<wangle::SSLContextConfig> sslContext;
 };
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/prefix-manager/PrefixAggregator.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// same entries but for their prefix
+bool
+hasSameAttributes(
+    const thrift::PrefixEntry& entry, const thrift::PrefixEntry& other) {
+  if (entry.prefix == other.prefix) {
+    return entry == other;
+  }
+  auto copy = other;
+  copy.prefix = entry.prefix;
+  return entry == copy;
+}
+
+// other half of the parent of prefix
+folly::CIDRNetwork
+getSibling(const folly::CIDRNetwork& prefix) {
+  CHECK_GT(prefix.second, 0);
+  const auto bit = prefix.second - 1;
+  std::vector<uint8_t> bytes(
+      prefix.first.bytes(), prefix.first.bytes() + prefix.first.byteCount());
+  bytes[bit / 8] ^= static_cast<uint8_t>(0x80 >> (bit % 8));
+  return {folly::IPAddress::fromBinary(
+              folly::ByteRange(bytes.data(), bytes.size())),
+          prefix.second};
+}
+
+} // namespace
+
+PrefixAggregator::PrefixAggregator(uint8_t minV4Length, uint8_t minV6Length)
+    : minLengths_{{std::min<uint8_t>(minV4Length, 32),
+                   std::min<uint8_t>(minV6Length, 128)}} {}
+
+size_t
+PrefixAggregator::getNumPrefixes() const {
+  return prefixes_[0].size() + prefixes_[1].size();
+}
+
+folly::CIDRNetwork
+PrefixAggregator::getBlock(const folly::CIDRNetwork& prefix) const {
+  const auto minLength = minLengths_[getFamilyIndex(prefix.first)];
+  if (prefix.second <= minLength) {
+    return prefix;
+  }
+  return {prefix.first.mask(minLength), minLength};
+}
+
+void
+PrefixAggregator::update(
+    const thrift::IpPrefix& prefix, const thrift::PrefixEntry* entry) {
+  const auto network = toIPNetwork(prefix);
+  const auto family = getFamilyIndex(network.first);
+  if (entry) {
+    prefixes_[family][network] = *entry;
+  } else if (not prefixes_[family].erase(network)) {
+    return;
+  }
+  dirtyBlocks_[family].emplace(getBlock(network));
+}
+
+PrefixAggregator::Prefixes
+PrefixAggregator::aggregateBlock(
+    size_t family, const folly::CIDRNetwork& block) const {
+  auto const& prefixes = prefixes_[family];
+
+  // blocks shorter than the minimum length are single prefixes
+  Prefixes entries;
+  if (block.second < minLengths_[family]) {
+    auto it = prefixes.find(block);
+    if (it != prefixes.end()) {
+      entries.emplace(*it);
+    }
+    return entries;
+  }
+  // prefixes in the block are contiguous in address order
+  for (auto it = prefixes.lower_bound({block.first, 0});
+       it != prefixes.end() and
+       it->first.first.inSubnet(block.first, block.second);
+       ++it) {
+    entries.emplace(*it);
+  }
+
+  // leave out prefixes whose closest covering prefix has the same attributes
+  auto removeCovered = [&]() {
+    for (auto it = entries.begin(); it != entries.end();) {
+      bool covered{false};
+      for (int len = it->first.second - 1; len >= block.second; --len) {
+        auto cover = entries.find({it->first.first.mask(len), len});
+        if (cover != entries.end()) {
+          covered = hasSameAttributes(cover->second, it->second);
+          break;
+        }
+      }
+      it = covered ? entries.erase(it) : std::next(it);
+    }
+  };
+  removeCovered();
+
+  // replace siblings with the same attributes by their parent, longest
+  // prefixes first for parents to be merged in turn
+  std::vector<std::vector<folly::CIDRNetwork>> byLength(
+      block.first.bitCount() + 1);
+  for (auto const& kv : entries) {
+    byLength[kv.first.second].emplace_back(kv.first);
+  }
+  bool merged{false};
+  for (int len = byLength.size() - 1; len > block.second; --len) {
+    for (auto const& prefix : byLength[len]) {
+      auto it = entries.find(prefix);
+      if (it == entries.end()) {
+        // merged with its sibling already
+        continue;
+      }
+      const folly::CIDRNetwork parent{prefix.first.mask(len - 1), len - 1};
+      if (entries.count(parent)) {
+        continue;
+      }
+      auto sibling = entries.find(getSibling(prefix));
+      if (sibling == entries.end() or
+          not hasSameAttributes(it->second, sibling->second)) {
+        continue;
+      }
+      auto entry = std::move(it->second);
+      entry.prefix = toIpPrefix(parent);
+      entries.erase(it);
+      entries.erase(sibling);
+      entries.emplace(parent, std::move(entry));
+      byLength[len - 1].emplace_back(parent);
+      merged = true;
+    }
+  }
+  if (merged) {
+    removeCovered();
+  }
+  return entries;
+}
+
+void
+PrefixAggregator::aggregate(
+    std::unordered_set<thrift::IpPrefix>& changedPrefixes) {
+  for (size_t family = 0; family < 2; ++family) {
+    for (auto const& block : dirtyBlocks_[family]) {
+      auto newEntries = aggregateBlock(family, block);
+      auto& oldEntries = blockEntries_[family][block];
+      for (auto const& kv : oldEntries) {
+        if (not newEntries.count(kv.first)) {
+          entries_.erase(kv.second.prefix);
+          changedPrefixes.emplace(kv.second.prefix);
+        }
+      }
+      for (auto const& kv : newEntries) {
+        auto it = oldEntries.find(kv.first);
+        if (it == oldEntries.end() or it->second != kv.second) {
+          if (it != oldEntries.end() and
+              it->second.prefix != kv.second.prefix) {
+            entries_.erase(it->second.prefix);
+            changedPrefixes.emplace(it->second.prefix);
+          }
+          entries_[kv.second.prefix] = kv.second;
+          changedPrefixes.emplace(kv.second.prefix);
+        }
+      }
+      if (newEntries.empty()) {
+        blockEntries_[family].erase(block);
+      } else {
+        oldEntries = std::move(newEntries);
+      }
+    }
+    dirtyBlocks_[family].clear();
+  }
+}
+
+const thrift::PrefixEntry*
+PrefixAggregator::getEntry(const thrift::IpPrefix& prefix) const {
+  auto it = entries_.find(prefix);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+} // namespace openr
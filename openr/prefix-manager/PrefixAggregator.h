@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <folly/IPAddress.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+
+namespace openr {
+
+/**
+ * Aggregation of the prefixes advertised by PrefixManager into fewer
+ * covering prefixes, forwarding exactly the same addresses the same way:
+ *  - sibling prefixes with the same type and forwarding attributes are
+ *    replaced by their parent, repeatedly
+ *  - prefixes covered by a shorter prefix with the same attributes, the
+ *    closest one covering them, are left out
+ *
+ * Aggregates are never shorter than the minimum length of their address
+ * family, prefixes already shorter are advertised as they are. Prefixes are
+ * aggregated within blocks of that minimum length, updates only re-aggregate
+ * the blocks they are in.
+ */
+class PrefixAggregator {
+ public:
+  PrefixAggregator(uint8_t minV4Length, uint8_t minV6Length);
+
+  // add, update or remove (entry null) an advertised prefix. Aggregates are
+  // updated by the next call of aggregate
+  void update(const thrift::IpPrefix& prefix, const thrift::PrefixEntry* entry);
+
+  // re-aggregate the blocks updated since the last call. Prefixes whose
+  // aggregated entry was added, changed or removed are added to
+  // changedPrefixes
+  void aggregate(std::unordered_set<thrift::IpPrefix>& changedPrefixes);
+
+  // aggregated entry of prefix to advertise, null if none
+  const thrift::PrefixEntry* getEntry(const thrift::IpPrefix& prefix) const;
+
+  // number of prefixes to aggregate
+  size_t getNumPrefixes() const;
+
+  // number of aggregated entries to advertise
+  size_t
+  getNumEntries() const {
+    return entries_.size();
+  }
+
+ private:
+  // prefixes of an address family, keyed by masked network. Addresses of
+  // different families are never compared
+  using Prefixes = std::map<folly::CIDRNetwork, thrift::PrefixEntry>;
+
+  static size_t
+  getFamilyIndex(const folly::IPAddress& address) {
+    return address.isV4() ? 0 : 1;
+  }
+
+  // block of prefix, the prefix itself if shorter than the minimum length
+  folly::CIDRNetwork getBlock(const folly::CIDRNetwork& prefix) const;
+
+  // aggregated entries of the prefixes in block
+  Prefixes aggregateBlock(size_t family, const folly::CIDRNetwork& block) const;
+
+  const std::array<uint8_t, 2> minLengths_;
+
+  // prefixes to aggregate and the blocks of them updated, by family
+  std::array<Prefixes, 2> prefixes_;
+  std::array<std::set<folly::CIDRNetwork>, 2> dirtyBlocks_;
+
+  // aggregated entries of every block, by family
+  std::array<std::map<folly::CIDRNetwork, Prefixes>, 2> blockEntries_;
+
+  // aggregated entries of all blocks, by the prefix they advertise
+  std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry> entries_;
+};
+
+} // namespace openr
@@ -7,6 +7,10 @@
 
 #include "PrefixManager.h"
 
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
 #include <folly/futures/Future.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
@@ -45,30 +49,79 @@ PrefixManager::PrefixManager(
     const std::chrono::seconds prefixHoldTime,
     const std::chrono::milliseconds ttlKeyInKvStore,
     fbzmq::Context& zmqContext,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    size_t numPrefixDbShards,
+    KvStore* kvStore,
+    bool enableAggregation,
+    uint8_t aggregationMinV4Length,
+    uint8_t aggregationMinV6Length)
     : nodeId_(nodeId),
       configStore_{configStore},
       prefixDbMarker_{prefixDbMarker},
       perPrefixKeys_{perPrefixKeys},
+      numPrefixDbShards_{std::max<size_t>(1, numPrefixDbShards)},
       enablePerfMeasurement_{enablePerfMeasurement},
       ttlKeyInKvStore_(ttlKeyInKvStore),
-      kvStoreClient_{
-          zmqContext, this, nodeId_, kvStoreLocalCmdUrl, kvStoreLocalPubUrl},
+      kvStoreClient_{zmqContext,
+                     this,
+                     nodeId_,
+                     kvStoreLocalCmdUrl,
+                     kvStoreLocalPubUrl,
+                     60000ms /* checkPersistKeyPeriod */,
+                     3000ms /* recvTimeout */,
+                     true /* batchUpdates */,
+                     kvStore},
+      shardPrefixes_(perPrefixKeys ? 0 : numPrefixDbShards_),
+      dirtyShards_(perPrefixKeys ? 0 : numPrefixDbShards_, true),
       areas_{areas} {
   CHECK(configStore_);
-  // pick up prefixes from disk
-  auto maybePrefixDb =
-      configStore_->loadThriftObj<thrift::PrefixDatabase>(kConfigKey).get();
-  if (maybePrefixDb.hasValue()) {
+  if (enableAggregation) {
+    LOG(INFO) << "Aggregating advertised prefixes up to IPv4 /"
+              << static_cast<int>(aggregationMinV4Length) << " and IPv6 /"
+              << static_cast<int>(aggregationMinV6Length);
+    aggregator_ = std::make_unique<PrefixAggregator>(
+        aggregationMinV4Length, aggregationMinV6Length);
+  }
+  persistPrefixDbThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
+      getEvb(), Constants::kPrefixMgrPersistThrottleTimeout, [this]() noexcept {
+        persistPrefixDb();
+      });
+
+  // pick up prefixes from disk. Per type keys take precedence over the legacy
+  // key, which may be left over if erasing it didn't complete
+  std::vector<std::string> configKeys;
+  for (auto const& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+    configKeys.emplace_back(getConfigKey(kv.first));
+  }
+  configKeys.emplace_back(kConfigKey);
+  bool loaded{false};
+  for (auto const& configKey : configKeys) {
+    auto maybePrefixDb =
+        configStore_->loadThriftObj<thrift::PrefixDatabase>(configKey).get();
+    if (maybePrefixDb.hasError()) {
+      continue;
+    }
+    const bool isLegacy = configKey == kConfigKey;
+    if (isLegacy) {
+      eraseLegacyConfig_ = true;
+      persistPrefixDbThrottled_->operator()();
+      if (loaded) {
+        continue;
+      }
+    }
+    loaded = true;
     LOG(INFO) << "Successfully loaded " << maybePrefixDb->prefixEntries.size()
-              << " prefixes from disk";
-    diskState_ = std::move(maybePrefixDb.value());
-    for (const auto& entry : diskState_.prefixEntries) {
+              << " prefixes from disk key " << configKey;
+    for (const auto& entry : maybePrefixDb->prefixEntries) {
       LOG(INFO) << "  > " << toString(entry.prefix) << ", type "
                 << getPrefixTypeName(entry.type);
-      prefixMap_[entry.type][entry.prefix] = entry;
+      prefixMap_[entry.type][PrefixKey(entry.prefix)] = entry;
+      markDirty(entry.prefix);
       addPerfEvent(
           addingEvents_[entry.type][entry.prefix], nodeId_, "LOADED_FROM_DISK");
+      if (isLegacy) {
+        markPersistDirty(entry.type);
+      }
     }
   }
   // Create throttled update state
@@ -180,32 +233,99 @@ PrefixManager::outputState() {
   updateKvStore();
 }
 
+std::string
+PrefixManager::getConfigKey(thrift::PrefixType type) {
+  return folly::sformat("{}:{}", kConfigKey, getPrefixTypeName(type));
+}
+
+folly::SemiFuture<folly::Unit>
+PrefixManager::flushPrefixDb() {
+  folly::Promise<folly::Unit> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([this, p = std::move(p)]() mutable noexcept {
+    persistPrefixDb();
+    if (numPendingPersists_ == 0) {
+      p.setValue();
+    } else {
+      flushPromises_.emplace_back(std::move(p));
+    }
+  });
+  return sf;
+}
+
+void
+PrefixManager::markPersistDirty(thrift::PrefixType type) {
+  persistDirtyTypes_.emplace(type);
+  persistPrefixDbThrottled_->operator()();
+}
+
 void
 PrefixManager::persistPrefixDb() {
-  // prefixDb persistent entries have changed,
-  // save the newest persistent entries to disk.
-  thrift::PrefixDatabase persistentPrefixDb;
-  persistentPrefixDb.thisNodeName = nodeId_;
-  for (const auto& kv : prefixMap_) {
-    for (const auto& kv2 : kv.second) {
-      if (not kv2.second.ephemeral.value_or(false)) {
-        persistentPrefixDb.prefixEntries.emplace_back(kv2.second);
+  // persistent entries of some types have changed, save the newest
+  // persistent entries of those types to disk. Writes are not awaited,
+  // the config store serves loads with them right away
+  std::vector<folly::SemiFuture<folly::Unit>> writes;
+  size_t numPrefixes{0};
+  for (auto const type : persistDirtyTypes_) {
+    thrift::PrefixDatabase persistentPrefixDb;
+    persistentPrefixDb.thisNodeName = nodeId_;
+    auto const search = prefixMap_.find(type);
+    if (search != prefixMap_.end()) {
+      for (const auto& kv : search->second) {
+        if (not kv.second.ephemeral.value_or(false)) {
+          persistentPrefixDb.prefixEntries.emplace_back(kv.second);
+        }
       }
     }
+    numPrefixes += persistentPrefixDb.prefixEntries.size();
+    if (persistentPrefixDb.prefixEntries.empty()) {
+      writes.emplace_back(configStore_->erase(getConfigKey(type))
+                              .defer([](folly::Try<bool>&&) {}));
+    } else {
+      writes.emplace_back(
+          configStore_->storeThriftObj(getConfigKey(type), persistentPrefixDb));
+    }
+  }
+  if (not persistDirtyTypes_.empty()) {
+    tData_.addStatValue(
+        "prefix_manager.persisted_types",
+        persistDirtyTypes_.size(),
+        fbzmq::SUM);
+    tData_.addStatValue(
+        "prefix_manager.persisted_prefixes", numPrefixes, fbzmq::SUM);
   }
-  if (diskState_ != persistentPrefixDb) {
-    configStore_->storeThriftObj(kConfigKey, persistentPrefixDb).get();
-    diskState_ = std::move(persistentPrefixDb);
+  persistDirtyTypes_.clear();
+
+  if (eraseLegacyConfig_) {
+    eraseLegacyConfig_ = false;
+    writes.emplace_back(
+        configStore_->erase(kConfigKey).defer([](folly::Try<bool>&&) {}));
+  }
+  if (writes.empty()) {
+    return;
   }
+  ++numPendingPersists_;
+  folly::collectAllSemiFuture(std::move(writes))
+      .via(getEvb())
+      .thenValue([this](auto&&) {
+        if (--numPendingPersists_ == 0) {
+          for (auto& p : flushPromises_) {
+            p.setValue();
+          }
+          flushPromises_.clear();
+        }
+      });
 }
 
 std::string
-PrefixManager::advertisePrefix(thrift::PrefixEntry& prefixEntry) {
+PrefixManager::advertisePrefix(const thrift::PrefixEntry& prefixEntry) {
   thrift::PrefixDatabase prefixDb;
   prefixDb.thisNodeName = nodeId_;
   prefixDb.prefixEntries.emplace_back(prefixEntry);
   if (enablePerfMeasurement_) {
-    prefixDb.perfEvents = addingEvents_[prefixEntry.type][prefixEntry.prefix];
+    // aggregates have no events of their own
+    auto events = getPerfEvents(prefixEntry.type, prefixEntry.prefix);
+    prefixDb.perfEvents = events ? *events : thrift::PerfEvents{};
   }
   const auto prefixKey =
       PrefixKey(
@@ -225,67 +345,93 @@ PrefixManager::advertisePrefix(thrift::PrefixEntry& prefixEntry) {
   return prefixKey;
 }
 
-void
-PrefixManager::updateKvStore() {
-  std::vector<std::pair<std::string, std::string>> keyVals;
-  std::unordered_set<std::string> nowAdvertisingKeys;
-  std::unordered_set<thrift::IpPrefix> nowAdvertisingPrefixes;
-  if (perPrefixKeys_) {
-    for (auto& kv : prefixMap_) {
-      for (auto& kv2 : kv.second) {
-        if (not nowAdvertisingPrefixes.count(kv2.first)) {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "UPDATE_KVSTORE_THROTTLED");
-          auto const key = advertisePrefix(kv2.second);
-          nowAdvertisingKeys.emplace(key);
-          nowAdvertisingPrefixes.emplace(kv2.first);
-          keysToClear_.erase(key);
-        } else {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "COVERED_BY_HIGHER_TYPE");
-        }
-      }
+thrift::PrefixEntry*
+PrefixManager::getAdvertisedEntry(
+    thrift::IpPrefix const& prefix, bool addEvents) {
+  thrift::PrefixEntry* advertisedEntry{nullptr};
+  const PrefixKey prefixKey(prefix);
+  // prefixMap_ is ordered by type, the lowest one is advertised
+  for (auto& kv : prefixMap_) {
+    auto it = kv.second.find(prefixKey);
+    if (it == kv.second.end()) {
+      continue;
     }
-  } else {
-    thrift::PrefixDatabase prefixDb;
-    prefixDb.thisNodeName = nodeId_;
-    thrift::PerfEvents* mostRecentEvents = nullptr;
-    for (auto& kv : prefixMap_) {
-      for (auto& kv2 : kv.second) {
-        if (not nowAdvertisingPrefixes.count(kv2.first)) {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "UPDATE_KVSTORE_THROTTLED");
-          if (nullptr == mostRecentEvents or
-              addingEvents_[kv.first][kv2.first].events.back().unixTs >
-                  mostRecentEvents->events.back().unixTs) {
-            mostRecentEvents = &addingEvents_[kv.first][kv2.first];
-          }
-          prefixDb.prefixEntries.emplace_back(kv2.second);
-          nowAdvertisingPrefixes.emplace(kv2.first);
-        } else {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "COVERED_BY_HIGHER_TYPE");
-        }
-      }
+    if (addEvents) {
+      maybeAddEvent(
+          addingEvents_[kv.first][prefix],
+          advertisedEntry ? "COVERED_BY_HIGHER_TYPE"
+                          : "UPDATE_KVSTORE_THROTTLED");
     }
-    if (enablePerfMeasurement_ and nullptr != mostRecentEvents) {
-      prefixDb.perfEvents = *mostRecentEvents;
+    if (not advertisedEntry) {
+      advertisedEntry = &it->second;
+      if (not addEvents) {
+        break;
+      }
     }
-    const auto prefixDbKey = folly::sformat(
+  }
+  return advertisedEntry;
+}
+
+const thrift::PrefixEntry*
+PrefixManager::getOutputEntry(thrift::IpPrefix const& prefix, bool addEvents) {
+  if (aggregator_) {
+    return aggregator_->getEntry(prefix);
+  }
+  return getAdvertisedEntry(prefix, addEvents);
+}
+
+const thrift::PerfEvents*
+PrefixManager::getPerfEvents(
+    thrift::PrefixType type, thrift::IpPrefix const& prefix) const {
+  auto search = addingEvents_.find(type);
+  if (search == addingEvents_.end()) {
+    return nullptr;
+  }
+  auto it = search->second.find(prefix);
+  return it != search->second.end() ? &it->second : nullptr;
+}
+
+void
+PrefixManager::aggregateDirtyPrefixes() {
+  for (auto const& prefix : dirtyPrefixes_) {
+    aggregator_->update(
+        prefix, getAdvertisedEntry(prefix, true /* addEvents */));
+  }
+  std::unordered_set<thrift::IpPrefix> changedPrefixes;
+  aggregator_->aggregate(changedPrefixes);
+  tData_.addStatValue(
+      "prefix_manager.aggregation.changed_prefixes",
+      changedPrefixes.size(),
+      fbzmq::SUM);
+  dirtyPrefixes_ = std::move(changedPrefixes);
+}
+
+void
+PrefixManager::markDirty(thrift::IpPrefix const& prefix) {
+  dirtyPrefixes_.emplace(prefix);
+}
+
+size_t
+PrefixManager::getPrefixDbShard(thrift::IpPrefix const& prefix) const {
+  return std::hash<thrift::IpPrefix>()(prefix) % numPrefixDbShards_;
+}
+
+std::string
+PrefixManager::getPrefixDbShardKey(size_t shard) const {
+  if (numPrefixDbShards_ == 1) {
+    return folly::sformat(
         "{}{}", static_cast<std::string>(prefixDbMarker_), nodeId_);
-    for (const auto& area : areas_) {
-      bool const changed = kvStoreClient_.persistKey(
-          prefixDbKey,
-          fbzmq::util::writeThriftObjStr(std::move(prefixDb), serializer_),
-          ttlKeyInKvStore_,
-          area);
-      LOG_IF(INFO, changed)
-          << "Updating all " << prefixDb.prefixEntries.size()
-          << " prefixes in KvStore " << prefixDbKey << " area: " << area;
-    }
-    nowAdvertisingKeys.emplace(prefixDbKey);
-    keysToClear_.erase(prefixDbKey);
   }
+  return folly::sformat(
+      "{}{}{}shard-{}",
+      static_cast<std::string>(prefixDbMarker_),
+      nodeId_,
+      Constants::kPrefixNameSeparator.toString(),
+      shard);
+}
+
+void
+PrefixManager::withdrawKey(std::string const& key) {
   thrift::PrefixDatabase deletedPrefixDb;
   deletedPrefixDb.thisNodeName = nodeId_;
   deletedPrefixDb.deletePrefix = true;
@@ -293,29 +439,128 @@ PrefixManager::updateKvStore() {
     deletedPrefixDb.perfEvents = thrift::PerfEvents{};
     maybeAddEvent(deletedPrefixDb.perfEvents.value(), "WITHDRAW_THROTTLED");
   }
+  auto maybePerPrefixKey = PrefixKey::fromStr(key);
+  if (maybePerPrefixKey.hasValue()) {
+    // needed for backward compatibility
+    thrift::PrefixEntry entry;
+    entry.prefix = maybePerPrefixKey.value().getIpPrefix();
+    deletedPrefixDb.prefixEntries = {entry};
+  }
+  const auto value =
+      fbzmq::util::writeThriftObjStr(std::move(deletedPrefixDb), serializer_);
+  for (const auto& area : areas_) {
+    LOG(INFO) << "Withdrawing key: " << key << " from KvStore area: " << area;
+    // one last key set with empty DB and deletePrefix set signifies withdraw
+    // then the key should ttl out
+    kvStoreClient_.clearKey(key, value, ttlKeyInKvStore_, area);
+  }
+}
+
+void
+PrefixManager::updateKvStore() {
+  tData_.addStatValue(
+      "prefix_manager.dirty_prefixes", dirtyPrefixes_.size(), fbzmq::SUM);
+  if (aggregator_) {
+    aggregateDirtyPrefixes();
+  }
+  if (perPrefixKeys_) {
+    updateKvStorePrefixKeys();
+  } else {
+    updateKvStorePrefixDbShards();
+  }
+  dirtyPrefixes_.clear();
+
+  // withdraw keys of ours found in KvStore which we don't advertise, e.g.
+  // left over from before a restart
   for (auto const& key : keysToClear_) {
-    auto maybePerPrefixKey = PrefixKey::fromStr(key);
-    if (maybePerPrefixKey.hasValue()) {
-      // needed for backward compatibility
-      thrift::PrefixEntry entry;
-      entry.prefix = maybePerPrefixKey.value().getIpPrefix();
-      deletedPrefixDb.prefixEntries = {entry};
+    if (not advertisedKeys_.count(key)) {
+      withdrawKey(key);
     }
-    for (const auto& area : areas_) {
-      LOG(INFO) << "Withdrawing key: " << key << " from KvStore area: " << area;
-      // one last key set with empty DB and deletePrefix set signifies withdraw
-      // then the key should ttl out
-      kvStoreClient_.clearKey(
-          key,
-          fbzmq::util::writeThriftObjStr(
-              std::move(deletedPrefixDb), serializer_),
-          ttlKeyInKvStore_,
-          area);
+  }
+  keysToClear_.clear();
+}
+
+void
+PrefixManager::updateKvStorePrefixKeys() {
+  for (auto const& prefix : dirtyPrefixes_) {
+    auto entry = getOutputEntry(prefix, true /* addEvents */);
+    if (entry) {
+      advertisedKeys_.emplace(advertisePrefix(*entry));
+      continue;
+    }
+    const auto prefixKey =
+        PrefixKey(
+            nodeId_,
+            folly::IPAddress::createNetwork(toString(prefix)),
+            thrift::KvStore_constants::kDefaultArea())
+            .getPrefixKey();
+    if (advertisedKeys_.erase(prefixKey)) {
+      withdrawKey(prefixKey);
     }
   }
+}
+
+void
+PrefixManager::updateKvStorePrefixDbShards() {
+  // update membership of shards with dirty prefixes
+  for (auto const& prefix : dirtyPrefixes_) {
+    const auto shard = getPrefixDbShard(prefix);
+    dirtyShards_[shard] = true;
+    if (getOutputEntry(prefix, true /* addEvents */)) {
+      shardPrefixes_[shard].emplace(prefix);
+    } else {
+      shardPrefixes_[shard].erase(prefix);
+    }
+  }
+
+  for (size_t shard = 0; shard < numPrefixDbShards_; ++shard) {
+    if (not dirtyShards_[shard]) {
+      continue;
+    }
+    dirtyShards_[shard] = false;
+    const auto prefixDbKey = getPrefixDbShardKey(shard);
+    auto const& prefixes = shardPrefixes_[shard];
+
+    // the legacy single key is advertised even without prefixes
+    if (prefixes.empty() and numPrefixDbShards_ > 1) {
+      if (advertisedKeys_.erase(prefixDbKey)) {
+        withdrawKey(prefixDbKey);
+      }
+      continue;
+    }
 
-  // anything we don't advertise next time, we need to clear
-  keysToClear_ = std::move(nowAdvertisingKeys);
+    thrift::PrefixDatabase prefixDb;
+    prefixDb.thisNodeName = nodeId_;
+    prefixDb.prefixEntries.reserve(prefixes.size());
+    const thrift::PerfEvents* mostRecentEvents = nullptr;
+    for (auto const& prefix : prefixes) {
+      auto entry = getOutputEntry(prefix, false /* addEvents */);
+      CHECK(entry) << "no entry of advertised prefix " << toString(prefix);
+      auto events = getPerfEvents(entry->type, prefix);
+      if (events and not events->events.empty() and
+          (nullptr == mostRecentEvents or
+           events->events.back().unixTs >
+               mostRecentEvents->events.back().unixTs)) {
+        mostRecentEvents = events;
+      }
+      prefixDb.prefixEntries.emplace_back(*entry);
+    }
+    if (enablePerfMeasurement_ and nullptr != mostRecentEvents) {
+      prefixDb.perfEvents = *mostRecentEvents;
+    }
+    const auto numPrefixes = prefixDb.prefixEntries.size();
+    const auto value =
+        fbzmq::util::writeThriftObjStr(std::move(prefixDb), serializer_);
+    for (const auto& area : areas_) {
+      bool const changed = kvStoreClient_.persistKey(
+          prefixDbKey, value, ttlKeyInKvStore_, area);
+      LOG_IF(INFO, changed) << "Updating all " << numPrefixes
+                            << " prefixes in KvStore " << prefixDbKey
+                            << " area: " << area;
+    }
+    advertisedKeys_.emplace(prefixDbKey);
+    tData_.addStatValue("prefix_manager.updated_prefix_dbs", 1, fbzmq::COUNT);
+  }
 }
 
 folly::SemiFuture<bool>
@@ -368,6 +613,37 @@ PrefixManager::syncPrefixesByType(
   return sf;
 }
 
+folly::SemiFuture<thrift::PrefixDeltaAck>
+PrefixManager::applyPrefixDeltaChunk(thrift::PrefixDeltaChunk chunk) {
+  if (numPendingDeltaChunks_.fetch_add(1) >=
+      Constants::kPrefixMgrMaxPendingDeltaChunks) {
+    --numPendingDeltaChunks_;
+    runInEventBaseThread([this]() noexcept {
+      tData_.addStatValue(
+          "prefix_manager.delta_chunks_rejected", 1, fbzmq::COUNT);
+    });
+    return folly::makeSemiFuture<thrift::PrefixDeltaAck>(std::runtime_error(
+        folly::sformat(
+            "Too many pending prefix delta chunks, rejecting chunk {}",
+            chunk.seqNum)));
+  }
+
+  folly::Promise<thrift::PrefixDeltaAck> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([
+    this,
+    p = std::move(p),
+    chunk = std::move(chunk)
+  ]() mutable noexcept {
+    pendingDeltaChunks_.emplace_back(std::move(chunk), std::move(p));
+    // process after chunks queued in the meantime, all in one batch
+    if (pendingDeltaChunks_.size() == 1) {
+      runInEventBaseThread([this]() noexcept { processPendingDeltaChunks(); });
+    }
+  });
+  return sf;
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 PrefixManager::getPrefixes() {
   folly::Promise<std::unique_ptr<std::vector<thrift::PrefixEntry>>> p;
@@ -425,31 +701,127 @@ PrefixManager::submitCounters() {
     num_prefixes += kv.second.size();
   }
   counters["prefix_manager.num_prefixes"] = num_prefixes;
+  if (aggregator_) {
+    counters["prefix_manager.aggregation.num_prefixes"] =
+        aggregator_->getNumPrefixes();
+    counters["prefix_manager.aggregation.num_aggregated"] =
+        aggregator_->getNumEntries();
+  }
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
+void
+PrefixManager::processPendingDeltaChunks() {
+  auto chunks = std::move(pendingDeltaChunks_);
+  pendingDeltaChunks_.clear();
+  if (chunks.empty()) {
+    return;
+  }
+  // chunks of a client may overtake each other on the way here
+  std::stable_sort(
+      chunks.begin(), chunks.end(), [](auto const& a, auto const& b) {
+        return a.first.seqNum < b.first.seqNum;
+      });
+
+  std::vector<thrift::PrefixDeltaAck> acks;
+  acks.reserve(chunks.size());
+  int64_t numChanged{0};
+  for (auto const& kv : chunks) {
+    auto const& chunk = kv.first;
+    thrift::PrefixDeltaAck ack;
+    ack.seqNum = chunk.seqNum;
+    for (auto const& prefixEntry : chunk.prefixesToAdvertise) {
+      ack.numAdvertised += addOrUpdatePrefixEntry(prefixEntry) ? 1 : 0;
+    }
+    for (auto const& prefixEntry : chunk.prefixesToWithdraw) {
+      ack.numWithdrawn += removePrefixEntry(prefixEntry) ? 1 : 0;
+    }
+    numChanged += ack.numAdvertised + ack.numWithdrawn;
+    acks.emplace_back(std::move(ack));
+  }
+  LOG(INFO) << "Applied " << chunks.size() << " prefix delta chunks up to "
+            << chunks.back().first.seqNum << ", changing " << numChanged
+            << " prefixes";
+  if (numChanged) {
+    outputStateThrottled_->operator()();
+  }
+  tData_.addStatValue(
+      "prefix_manager.delta_chunks_per_batch", chunks.size(), fbzmq::AVG);
+  tData_.addStatValue(
+      "prefix_manager.delta_prefixes_changed", numChanged, fbzmq::SUM);
+
+  numPendingDeltaChunks_ -= chunks.size();
+  const int32_t numPending = numPendingDeltaChunks_.load();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    acks[i].numPendingChunks = numPending;
+    acks[i].maxPendingChunks = Constants::kPrefixMgrMaxPendingDeltaChunks;
+    chunks[i].second.setValue(std::move(acks[i]));
+  }
+}
+
 // helpers for modifying our Prefix Db
+bool
+PrefixManager::addOrUpdatePrefixEntry(const thrift::PrefixEntry& prefixEntry) {
+  const PrefixKey prefixKey(prefixEntry.prefix);
+  auto& prefixes = prefixMap_[prefixEntry.type];
+  auto it = prefixes.find(prefixKey);
+  if (it != prefixes.end() and it->second == prefixEntry) {
+    return false;
+  }
+  if (not prefixEntry.ephemeral.value_or(false) or
+      (it != prefixes.end() and not it->second.ephemeral.value_or(false))) {
+    markPersistDirty(prefixEntry.type);
+  }
+  addPerfEvent(
+      addingEvents_[prefixEntry.type][prefixEntry.prefix],
+      nodeId_,
+      it == prefixes.end() ? "ADD_PREFIX" : "UPDATE_PREFIX");
+  prefixes[prefixKey] = prefixEntry;
+  markDirty(prefixEntry.prefix);
+  return true;
+}
+
+bool
+PrefixManager::removePrefixEntry(const thrift::PrefixEntry& prefixEntry) {
+  auto search = prefixMap_.find(prefixEntry.type);
+  if (search == prefixMap_.end()) {
+    return false;
+  }
+  auto it = search->second.find(PrefixKey(prefixEntry.prefix));
+  if (it == search->second.end()) {
+    return false;
+  }
+  if (not it->second.ephemeral.value_or(false)) {
+    markPersistDirty(prefixEntry.type);
+  }
+  search->second.erase(it);
+  markDirty(prefixEntry.prefix);
+  if (search->second.empty()) {
+    prefixMap_.erase(search);
+  }
+  auto eventsSearch = addingEvents_.find(prefixEntry.type);
+  if (eventsSearch != addingEvents_.end()) {
+    eventsSearch->second.erase(prefixEntry.prefix);
+    if (eventsSearch->second.empty()) {
+      addingEvents_.erase(eventsSearch);
+    }
+  }
+  return true;
+}
+
 bool
 PrefixManager::addOrUpdatePrefixes(
     const std::vector<thrift::PrefixEntry>& prefixEntries) {
   bool updated{false};
   for (const auto& prefixEntry : prefixEntries) {
-    auto& prefixes = prefixMap_[prefixEntry.type];
-    auto it = prefixes.find(prefixEntry.prefix);
-    if (it == prefixes.end() or it->second != prefixEntry) {
-      prefixes[prefixEntry.prefix] = prefixEntry;
-      addPerfEvent(
-          addingEvents_[prefixEntry.type][prefixEntry.prefix],
-          nodeId_,
-          it == prefixes.end() ? "ADD_PREFIX" : "UPDATE_PREFIX");
+    if (addOrUpdatePrefixEntry(prefixEntry)) {
       updated = true;
       SYSLOG(INFO) << "Advertising prefix: " << toString(prefixEntry.prefix)
                    << ", client: " << getPrefixTypeName(prefixEntry.type);
     }
   }
   if (updated) {
-    persistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return updated;
@@ -460,7 +832,7 @@ PrefixManager::removePrefixes(
     const std::vector<thrift::PrefixEntry>& prefixes) {
   // verify prefixes exists
   for (const auto& prefix : prefixes) {
-    auto it = prefixMap_[prefix.type].find(prefix.prefix);
+    auto it = prefixMap_[prefix.type].find(PrefixKey(prefix.prefix));
     if (it == prefixMap_[prefix.type].end()) {
       LOG(ERROR) << "Cannot withdraw prefix: " << toString(prefix.prefix)
                  << ", client: " << getPrefixTypeName(prefix.type);
@@ -468,19 +840,11 @@ PrefixManager::removePrefixes(
     }
   }
   for (const auto& prefix : prefixes) {
-    prefixMap_.at(prefix.type).erase(prefix.prefix);
-    addingEvents_.at(prefix.type).erase(prefix.prefix);
+    removePrefixEntry(prefix);
     SYSLOG(INFO) << "Withdrawing prefix: " << toString(prefix.prefix)
                  << ", client: " << getPrefixTypeName(prefix.type);
-    if (prefixMap_[prefix.type].empty()) {
-      prefixMap_.erase(prefix.type);
-    }
-    if (addingEvents_[prefix.type].empty()) {
-      addingEvents_.erase(prefix.type);
-    }
   }
   if (!prefixes.empty()) {
-    persistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return !prefixes.empty();
@@ -493,13 +857,13 @@ PrefixManager::syncPrefixes(
   LOG(INFO) << "Syncing prefixes of type: " << getPrefixTypeName(type);
   // building these lists so we can call add and remove and get detailed logging
   std::vector<thrift::PrefixEntry> toAddOrUpdate, toRemove;
-  std::unordered_set<thrift::IpPrefix> toRemoveSet;
+  std::unordered_set<PrefixKey> toRemoveSet;
   for (auto const& kv : prefixMap_[type]) {
     toRemoveSet.emplace(kv.first);
   }
   for (auto const& entry : prefixEntries) {
     CHECK(type == entry.type);
-    toRemoveSet.erase(entry.prefix);
+    toRemoveSet.erase(PrefixKey(entry.prefix));
     toAddOrUpdate.emplace_back(entry);
   }
   for (auto const& prefix : toRemoveSet) {
@@ -517,10 +881,15 @@ PrefixManager::removePrefixesByType(thrift::PrefixType type) {
   auto const search = prefixMap_.find(type);
   if (search != prefixMap_.end()) {
     changed = true;
+    for (auto const& kv : search->second) {
+      markDirty(kv.second.prefix);
+      if (not kv.second.ephemeral.value_or(false)) {
+        markPersistDirty(type);
+      }
+    }
     prefixMap_.erase(search);
   }
   if (changed) {
-    persistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return changed;
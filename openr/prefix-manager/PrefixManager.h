@@ -7,8 +7,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqThrottle.h>
@@ -25,6 +30,7 @@
 #include <openr/if/gen-cpp2/PrefixManager_types.h>
 #include <openr/kvstore/KvStoreClient.h>
 #include <openr/messaging/Queue.h>
+#include <openr/prefix-manager/PrefixAggregator.h>
 
 namespace openr {
 
@@ -45,7 +51,17 @@ class PrefixManager final : public OpenrEventBase {
       const std::chrono::milliseconds ttlKeyInKvStore,
       fbzmq::Context& zmqContext,
       const std::unordered_set<std::string>& area = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      // number of keys the prefix database is sharded into by prefix hash,
+      // unless per prefix keys are created
+      size_t numPrefixDbShards = 1,
+      // in-process KvStore to hand key updates to without serialization
+      KvStore* kvStore = nullptr,
+      // advertise aggregates of contiguous prefixes with the same attributes
+      // instead of the prefixes, no shorter than the given lengths
+      bool enableAggregation = false,
+      uint8_t aggregationMinV4Length = 16,
+      uint8_t aggregationMinV6Length = 48);
 
   // disable copying
   PrefixManager(PrefixManager const&) = delete;
@@ -74,23 +90,85 @@ class PrefixManager final : public OpenrEventBase {
   folly::SemiFuture<bool> syncPrefixesByType(
       thrift::PrefixType prefixType, std::vector<thrift::PrefixEntry> prefixes);
 
+  /*
+   * Apply a chunk of a stream of prefix changes. Chunks received within an
+   * event loop run are applied in a batch, persisted once and acknowledged
+   * together. Fails if kPrefixMgrMaxPendingDeltaChunks are pending already
+   */
+  folly::SemiFuture<thrift::PrefixDeltaAck> applyPrefixDeltaChunk(
+      thrift::PrefixDeltaChunk chunk);
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   getPrefixes();
 
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   getPrefixesByType(thrift::PrefixType prefixType);
 
+  /*
+   * Changes of non-ephemeral prefixes are persisted to the config store
+   * within kPrefixMgrPersistThrottleTimeout. Persist them right away instead,
+   * completes once they are durable
+   */
+  folly::SemiFuture<folly::Unit> flushPrefixDb();
+
+  // config store key of the non-ephemeral prefixes of type
+  static std::string getConfigKey(thrift::PrefixType type);
+
  private:
   void outputState();
-  // Update persistent store with non-ephemeral prefix entries
+  // Update persistent store with non-ephemeral prefix entries of types
+  // changed since the last update
   void persistPrefixDb();
 
-  // Update kvstore with both ephemeral and non-ephemeral prefixes
+  // mark non-ephemeral prefixes of type to be persisted with the next update
+  void markPersistDirty(thrift::PrefixType type);
+
+  // Update kvstore with both ephemeral and non-ephemeral prefixes. Only keys
+  // of prefixes changed since the last update are advertised or withdrawn
   void updateKvStore();
 
-  // update all IP keys in KvStore
+  // advertise or withdraw per prefix keys of dirty prefixes
   void updateKvStorePrefixKeys();
 
+  // advertise or withdraw prefix database shards with dirty prefixes
+  void updateKvStorePrefixDbShards();
+
+  // entry advertised for prefix, of the lowest type, null if none. Adds perf
+  // events to all entries of prefix if addEvents is set
+  thrift::PrefixEntry* getAdvertisedEntry(
+      thrift::IpPrefix const& prefix, bool addEvents);
+
+  // entry to put in KvStore for prefix, the aggregated entry of prefix if
+  // aggregation is enabled or the advertised entry otherwise
+  const thrift::PrefixEntry* getOutputEntry(
+      thrift::IpPrefix const& prefix, bool addEvents);
+
+  // perf events of the advertised entry of prefix, null if none
+  const thrift::PerfEvents* getPerfEvents(
+      thrift::PrefixType type, thrift::IpPrefix const& prefix) const;
+
+  // feed the advertised entries of dirty prefixes to the aggregator and make
+  // the prefixes of changed aggregated entries the dirty ones instead
+  void aggregateDirtyPrefixes();
+
+  // mark prefix to be re-advertised or withdrawn on the next update
+  void markDirty(thrift::IpPrefix const& prefix);
+
+  // key and shard of the prefix database containing prefix
+  size_t getPrefixDbShard(thrift::IpPrefix const& prefix) const;
+  std::string getPrefixDbShardKey(size_t shard) const;
+
+  // withdraw a key we advertise or advertised before
+  void withdrawKey(std::string const& key);
+
+  // apply all pending prefix delta chunks and acknowledge them
+  void processPendingDeltaChunks();
+
+  // helpers to modify a single prefix entry without persisting the db,
+  // returns true if the db is modified
+  bool addOrUpdatePrefixEntry(const thrift::PrefixEntry& prefixEntry);
+  bool removePrefixEntry(const thrift::PrefixEntry& prefixEntry);
+
   // helpers to modify prefix db, returns true if the db is modified
   bool addOrUpdatePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
   bool removePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
@@ -104,7 +182,7 @@ class PrefixManager final : public OpenrEventBase {
   void submitCounters();
 
   // add prefix entry in kvstore, return per prefix key name
-  std::string advertisePrefix(thrift::PrefixEntry& prefixEntry);
+  std::string advertisePrefix(const thrift::PrefixEntry& prefixEntry);
 
   // add event named updateEvent to perfEvents if it has value and the last
   // element is not already updateEvent
@@ -117,14 +195,28 @@ class PrefixManager final : public OpenrEventBase {
   // client to interact with ConfigStore
   PersistentStore* configStore_{nullptr};
 
-  // keep track of prefixDB on disk
-  thrift::PrefixDatabase diskState_;
+  // types with non-ephemeral prefixes changed since the last update of the
+  // config store
+  std::set<thrift::PrefixType> persistDirtyTypes_;
+
+  // the legacy key with prefixes of all types is replaced by per type keys
+  // with the first update of the config store
+  bool eraseLegacyConfig_{false};
+
+  // updates of the config store not durable yet, and flushPrefixDb calls
+  // waiting for them
+  size_t numPendingPersists_{0};
+  std::vector<folly::Promise<folly::Unit>> flushPromises_;
 
   const PrefixDbMarker prefixDbMarker_;
 
   // create IP keys
   bool perPrefixKeys_{false};
 
+  // number of prefix database keys, unless IP keys are created. A single one
+  // is the legacy key of all prefixes of this node
+  const size_t numPrefixDbShards_{1};
+
   // enable convergence performance measurement for Adjacencies update
   const bool enablePerfMeasurement_{false};
 
@@ -132,6 +224,9 @@ class PrefixManager final : public OpenrEventBase {
   // send them in one go!
   std::unique_ptr<fbzmq::ZmqThrottle> outputStateThrottled_;
 
+  // Throttled version of persistPrefixDb
+  std::unique_ptr<fbzmq::ZmqThrottle> persistPrefixDbThrottled_;
+
   std::unique_ptr<fbzmq::ZmqTimeout> initialOutputStateTimer_;
 
   // TTL for a key in the key value store
@@ -146,7 +241,7 @@ class PrefixManager final : public OpenrEventBase {
   // IMP: Ordered
   std::map<
       thrift::PrefixType,
-      std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
+      std::unordered_map<PrefixKey, thrift::PrefixEntry>>
       prefixMap_;
 
   // the serializer/deserializer helper we'll be using
@@ -165,12 +260,39 @@ class PrefixManager final : public OpenrEventBase {
   // anything we no longer wish to advertise
   std::unordered_set<std::string> keysToClear_;
 
+  // keys we currently advertise
+  std::unordered_set<std::string> advertisedKeys_;
+
+  // prefixes changed since the last update of KvStore, of any type
+  std::unordered_set<thrift::IpPrefix> dirtyPrefixes_;
+
+  // aggregation of the advertised prefixes put in KvStore, if enabled.
+  // Prefixes are kept here, persisted and returned by getPrefixes as they
+  // were advertised
+  std::unique_ptr<PrefixAggregator> aggregator_;
+
+  // prefixes advertised in each prefix database shard
+  std::vector<std::unordered_set<thrift::IpPrefix>> shardPrefixes_;
+
+  // shards to be re-advertised even without dirty prefixes, i.e. all of them
+  // on the first update
+  std::vector<bool> dirtyShards_;
+
   // perfEvents related to a given prefisEntry
   std::unordered_map<
       thrift::PrefixType,
       std::unordered_map<thrift::IpPrefix, thrift::PerfEvents>>
       addingEvents_;
 
+  // prefix delta chunks waiting to be applied along with their acks
+  std::vector<std::pair<thrift::PrefixDeltaChunk,
+                        folly::Promise<thrift::PrefixDeltaAck>>>
+      pendingDeltaChunks_;
+
+  // chunks accepted by applyPrefixDeltaChunk and not applied yet, updated
+  // from caller threads
+  std::atomic<size_t> numPendingDeltaChunks_{0};
+
   // area Id
   const std::unordered_set<std::string> areas_{};
 
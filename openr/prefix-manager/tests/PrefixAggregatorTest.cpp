@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <set>
+#include <string>
+#include <unordered_set>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/prefix-manager/PrefixAggregator.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::PrefixEntry
+createEntry(
+    const std::string& prefix,
+    thrift::PrefixType type = thrift::PrefixType::BGP,
+    thrift::PrefixForwardingType forwardingType =
+        thrift::PrefixForwardingType::IP) {
+  return createPrefixEntry(toIpPrefix(prefix), type, "", forwardingType);
+}
+
+void
+add(PrefixAggregator& aggregator, const thrift::PrefixEntry& entry) {
+  aggregator.update(entry.prefix, &entry);
+}
+
+void
+remove(PrefixAggregator& aggregator, const std::string& prefix) {
+  aggregator.update(toIpPrefix(prefix), nullptr);
+}
+
+std::set<std::string>
+aggregate(PrefixAggregator& aggregator) {
+  std::unordered_set<thrift::IpPrefix> changed;
+  aggregator.aggregate(changed);
+  std::set<std::string> prefixes;
+  for (auto const& prefix : changed) {
+    prefixes.emplace(toString(prefix));
+  }
+  return prefixes;
+}
+
+} // namespace
+
+TEST(PrefixAggregatorTest, MergeSiblings) {
+  PrefixAggregator aggregator(16, 48);
+  for (int i = 0; i < 4; ++i) {
+    add(aggregator, createEntry(folly::sformat("10.0.{}.0/24", i)));
+  }
+  EXPECT_EQ(std::set<std::string>({"10.0.0.0/22"}), aggregate(aggregator));
+  EXPECT_EQ(4, aggregator.getNumPrefixes());
+  EXPECT_EQ(1, aggregator.getNumEntries());
+  auto entry = aggregator.getEntry(toIpPrefix("10.0.0.0/22"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(createEntry("10.0.0.0/22"), *entry);
+  EXPECT_EQ(nullptr, aggregator.getEntry(toIpPrefix("10.0.0.0/24")));
+
+  // removing one splits the aggregate
+  remove(aggregator, "10.0.3.0/24");
+  EXPECT_EQ(
+      std::set<std::string>({"10.0.0.0/22", "10.0.0.0/23", "10.0.2.0/24"}),
+      aggregate(aggregator));
+  EXPECT_EQ(2, aggregator.getNumEntries());
+
+  // nothing to re-aggregate
+  EXPECT_TRUE(aggregate(aggregator).empty());
+}
+
+TEST(PrefixAggregatorTest, DifferentAttributes) {
+  PrefixAggregator aggregator(16, 48);
+  add(aggregator, createEntry("10.0.0.0/24"));
+  add(aggregator, createEntry("10.0.1.0/24", thrift::PrefixType::DEFAULT));
+  add(aggregator,
+      createEntry(
+          "fc00::/64",
+          thrift::PrefixType::BGP,
+          thrift::PrefixForwardingType::SR_MPLS));
+  add(aggregator, createEntry("fc00:0:0:1::/64"));
+  aggregate(aggregator);
+  EXPECT_EQ(4, aggregator.getNumEntries());
+  EXPECT_NE(nullptr, aggregator.getEntry(toIpPrefix("10.0.1.0/24")));
+}
+
+TEST(PrefixAggregatorTest, CoveredPrefixes) {
+  PrefixAggregator aggregator(16, 48);
+  add(aggregator, createEntry("10.0.0.0/22"));
+  add(aggregator, createEntry("10.0.1.0/24"));
+  // different from its closest cover, kept
+  add(aggregator, createEntry("10.0.2.0/24", thrift::PrefixType::DEFAULT));
+  // same as its cover but the closest one differs, kept
+  add(aggregator, createEntry("10.0.2.0/25"));
+  EXPECT_EQ(
+      std::set<std::string>({"10.0.0.0/22", "10.0.2.0/24", "10.0.2.0/25"}),
+      aggregate(aggregator));
+  EXPECT_EQ(3, aggregator.getNumEntries());
+}
+
+TEST(PrefixAggregatorTest, MinimumLength) {
+  PrefixAggregator aggregator(24, 64);
+  // not merged past the minimum length
+  add(aggregator, createEntry("10.0.0.0/24"));
+  add(aggregator, createEntry("10.0.1.0/24"));
+  // shorter prefixes are left as they are, even covering others
+  add(aggregator, createEntry("10.1.0.0/16"));
+  add(aggregator, createEntry("10.1.0.0/24"));
+  add(aggregator, createEntry("fc00::/65"));
+  add(aggregator, createEntry("fc00:0:0:0:8000::/65"));
+  EXPECT_EQ(
+      std::set<std::string>(
+          {"10.0.0.0/24", "10.0.1.0/24", "10.1.0.0/16", "10.1.0.0/24",
+           "fc00::/64"}),
+      aggregate(aggregator));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
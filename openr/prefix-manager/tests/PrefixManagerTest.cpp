@@ -152,6 +152,9 @@ class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
 
     // Erase data from config store
     configStore->erase("prefix-manager-config").get();
+    for (auto const& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+      configStore->erase(PrefixManager::getConfigKey(kv.first)).get();
+    }
 
     // stop config store
     configStore->stop();
@@ -888,6 +891,7 @@ TEST_P(PrefixManagerTestFixture, CheckReload) {
   prefixManager->advertisePrefixes({prefixEntry1}).get();
   prefixManager->advertisePrefixes({prefixEntry2}).get();
   prefixManager->advertisePrefixes({ephemeralPrefixEntry9}).get();
+  prefixManager->flushPrefixDb().get();
 
   // spin up a new PrefixManager add verify that it loads the config
   auto prefixManager2 = std::make_unique<PrefixManager>(
@@ -923,6 +927,102 @@ TEST_P(PrefixManagerTestFixture, CheckReload) {
   prefixManagerThread2->join();
 }
 
+TEST_P(PrefixManagerTestFixture, ShardedPrefixDb) {
+  // spin up a PrefixManager splitting its prefix database across keys
+  auto prefixManager2 = std::make_unique<PrefixManager>(
+      "node-2",
+      prefixUpdatesQueue.getReader(),
+      configStore.get(),
+      KvStoreLocalCmdUrl{kvStoreWrapper->localCmdUrl},
+      KvStoreLocalPubUrl{kvStoreWrapper->localPubUrl},
+      MonitorSubmitUrl{"inproc://monitor_submit"},
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      false /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds(0),
+      Constants::kKvStoreDbTtl,
+      context,
+      {thrift::KvStore_constants::kDefaultArea()},
+      4 /* numPrefixDbShards */);
+
+  auto prefixManagerThread2 = std::make_unique<std::thread>([&]() {
+    LOG(INFO) << "PrefixManager thread starting";
+    prefixManager2->run();
+    LOG(INFO) << "PrefixManager thread finishing";
+  });
+  prefixManager2->waitUntilRunning();
+
+  const std::vector<thrift::PrefixEntry> prefixEntries{prefixEntry1,
+                                                       prefixEntry2,
+                                                       prefixEntry3,
+                                                       prefixEntry4,
+                                                       prefixEntry5,
+                                                       prefixEntry6,
+                                                       prefixEntry7,
+                                                       prefixEntry8};
+  prefixManager2->advertisePrefixes(prefixEntries).get();
+
+  // Wait for throttled update to announce to kvstore
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+  EXPECT_EQ(8, getPrefixDb("prefix:node-2").size());
+  auto keyVals = kvStoreClient->dumpAllWithPrefix("prefix:node-2");
+  ASSERT_TRUE(keyVals.hasValue());
+  EXPECT_LT(1, keyVals->size());
+  EXPECT_GE(4, keyVals->size());
+  for (auto const& kv : keyVals.value()) {
+    EXPECT_EQ(0, kv.first.find("prefix:node-2:shard-"));
+  }
+
+  // withdrawn prefixes leave only deleted shards behind
+  prefixManager2->withdrawPrefixes(prefixEntries).get();
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+  EXPECT_EQ(0, getPrefixDb("prefix:node-2").size());
+
+  // cleanup
+  prefixUpdatesQueue.close();
+  prefixManager2->stop();
+  prefixManagerThread2->join();
+}
+
+TEST_P(PrefixManagerTestFixture, PrefixDeltaChunks) {
+  // send chunks without waiting for acks
+  thrift::PrefixDeltaChunk chunk1;
+  chunk1.seqNum = 1;
+  chunk1.prefixesToAdvertise = {prefixEntry1, prefixEntry2};
+  thrift::PrefixDeltaChunk chunk2;
+  chunk2.seqNum = 2;
+  chunk2.prefixesToAdvertise = {prefixEntry3, prefixEntry4};
+  chunk2.prefixesToWithdraw = {prefixEntry2, prefixEntry5};
+  auto ack1 = prefixManager->applyPrefixDeltaChunk(chunk1);
+  auto ack2 = prefixManager->applyPrefixDeltaChunk(chunk2);
+
+  auto const ackValue1 = std::move(ack1).get();
+  EXPECT_EQ(1, ackValue1.seqNum);
+  EXPECT_EQ(2, ackValue1.numAdvertised);
+  EXPECT_EQ(0, ackValue1.numWithdrawn);
+  auto const ackValue2 = std::move(ack2).get();
+  EXPECT_EQ(2, ackValue2.seqNum);
+  EXPECT_EQ(2, ackValue2.numAdvertised);
+  // prefixEntry5 is unknown
+  EXPECT_EQ(1, ackValue2.numWithdrawn);
+  EXPECT_EQ(0, ackValue2.numPendingChunks);
+  EXPECT_EQ(
+      Constants::kPrefixMgrMaxPendingDeltaChunks, ackValue2.maxPendingChunks);
+
+  EXPECT_EQ(3, prefixManager->getPrefixes().get()->size());
+  EXPECT_FALSE(prefixManager->withdrawPrefixes({prefixEntry2}).get());
+  EXPECT_TRUE(prefixManager->withdrawPrefixes({prefixEntry1}).get());
+
+  // re-applying a chunk changes nothing
+  auto const ackValue3 = prefixManager->applyPrefixDeltaChunk(chunk2).get();
+  EXPECT_EQ(0, ackValue3.numAdvertised);
+  EXPECT_EQ(0, ackValue3.numWithdrawn);
+
+  // Wait for throttled update to announce to kvstore
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+  EXPECT_EQ(2, getPrefixDb("prefix:node-1").size());
+}
+
 TEST_P(PrefixManagerTestFixture, GetPrefixes) {
   prefixManager->advertisePrefixes({prefixEntry1});
   prefixManager->advertisePrefixes({prefixEntry2});
@@ -1046,39 +1146,50 @@ TEST_P(PrefixManagerTestFixture, CheckPersistStoreUpdate) {
   // Verify that any action on persistent entries leads to update of store
   prefixManager->advertisePrefixes({prefixEntry1, prefixEntry2, prefixEntry3})
       .get();
-  // 3 prefixes leads to 1 write
-  ASSERT_EQ(1, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  // 3 prefixes of 2 types lead to a write of each type, committed together
+  // or one after another
+  const auto numWrites = configStore->getNumOfDbWritesToDisk();
+  ASSERT_LE(1, numWrites);
+  ASSERT_GE(2, numWrites);
 
   prefixManager->withdrawPrefixes({prefixEntry1}).get();
-  ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 1, configStore->getNumOfDbWritesToDisk());
 
   prefixManager
       ->syncPrefixesByType(
           thrift::PrefixType::PREFIX_ALLOCATOR, {prefixEntry2, prefixEntry4})
       .get();
-  ASSERT_EQ(3, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 2, configStore->getNumOfDbWritesToDisk());
 
   prefixManager->withdrawPrefixesByType(thrift::PrefixType::PREFIX_ALLOCATOR)
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 3, configStore->getNumOfDbWritesToDisk());
 
   // Verify that any actions on ephemeral entries does not lead to update of
   // store
   prefixManager
       ->advertisePrefixes({ephemeralPrefixEntry9, ephemeralPrefixEntry10})
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 3, configStore->getNumOfDbWritesToDisk());
 
   prefixManager->withdrawPrefixes({ephemeralPrefixEntry9}).get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 3, configStore->getNumOfDbWritesToDisk());
 
   prefixManager
       ->syncPrefixesByType(thrift::PrefixType::BGP, {ephemeralPrefixEntry10})
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 3, configStore->getNumOfDbWritesToDisk());
 
   prefixManager->withdrawPrefixesByType(thrift::PrefixType::BGP).get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  prefixManager->flushPrefixDb().get();
+  ASSERT_EQ(numWrites + 3, configStore->getNumOfDbWritesToDisk());
 }
 
 // Verify that persist store is update properly when both persistent
@@ -1089,6 +1200,7 @@ TEST_P(PrefixManagerTestFixture, CheckEphemeralAndPersistentUpdate) {
   prefixManager
       ->advertisePrefixes({persistentPrefixEntry9, ephemeralPrefixEntry10})
       .get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(1, configStore->getNumOfDbWritesToDisk());
 
   // Change persistance characterstic. Expect disk update
@@ -1097,36 +1209,43 @@ TEST_P(PrefixManagerTestFixture, CheckEphemeralAndPersistentUpdate) {
           thrift::PrefixType::BGP,
           {ephemeralPrefixEntry9, persistentPrefixEntry10})
       .get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
 
   // Only ephemeral entry withdrawn, so no update to disk
   prefixManager->withdrawPrefixes({ephemeralPrefixEntry9}).get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
 
   // Persistent entry withdrawn, expect update to disk
   prefixManager->withdrawPrefixes({persistentPrefixEntry10}).get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(3, configStore->getNumOfDbWritesToDisk());
 
   // Restore the state to mix of ephemeral and persistent of a type
   prefixManager
       ->advertisePrefixes({persistentPrefixEntry9, ephemeralPrefixEntry10})
       .get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
 
   // Verify that withdraw by type, updates disk
   prefixManager->withdrawPrefixesByType(thrift::PrefixType::BGP).get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
 
   // Restore the state to mix of ephemeral and persistent of a type
   prefixManager
       ->advertisePrefixes({persistentPrefixEntry9, ephemeralPrefixEntry10})
       .get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(6, configStore->getNumOfDbWritesToDisk());
 
   // Verify that entry in DB being deleted is persistent so file is update
   prefixManager
       ->syncPrefixesByType(thrift::PrefixType::BGP, {ephemeralPrefixEntry10})
       .get();
+  prefixManager->flushPrefixDb().get();
   ASSERT_EQ(7, configStore->getNumOfDbWritesToDisk());
 }
 
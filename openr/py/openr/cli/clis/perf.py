@@ -18,6 +18,8 @@ from openr.cli.utils.options import breeze_option
 class PerfCli(object):
     def __init__(self):
         self.perf.add_command(ViewFibCli().fib)
+        self.perf.add_command(ViewConvergenceTraceCli().trace)
+        self.perf.add_command(ProfileCli().profile)
 
     @click.group()
     @click.pass_context
@@ -33,3 +35,41 @@ class ViewFibCli(object):
         """ View latest perf log of fib module from this node """
 
         perf.ViewFibCmd(cli_opts).run()
+
+
+class ViewConvergenceTraceCli(object):
+    @click.command()
+    @click.option(
+        "--chrome-trace",
+        default=None,
+        help="Write traces to this file in Trace Event Format of chrome://tracing",
+    )
+    @click.pass_obj
+    def trace(cli_opts, chrome_trace):  # noqa: B902
+        """ View sampled convergence traces of this node """
+
+        perf.ViewConvergenceTraceCmd(cli_opts).run(chrome_trace)
+
+
+class ProfileCli(object):
+    @click.command()
+    @click.option(
+        "--thread",
+        "-t",
+        "threads",
+        multiple=True,
+        help="Module thread to profile, e.g. Decision. All of them if none",
+    )
+    @click.option("--duration", default=10, help="Seconds to profile for")
+    @click.option("--hz", default=99, help="Samples per second of CPU time")
+    @click.option(
+        "--output",
+        default=None,
+        help="Write folded stacks to this file, e.g. for flamegraph.pl",
+    )
+    @click.option("--top", default=20, help="Number of top frames to show")
+    @click.pass_obj
+    def profile(cli_opts, threads, duration, hz, output, top):  # noqa: B902
+        """ Sample the CPU usage of module threads of this node """
+
+        perf.ProfileCmd(cli_opts).run(threads, duration, hz, output, top)
@@ -15,6 +15,7 @@ from openr.cli.utils import utils
 from openr.cli.utils.commands import OpenrCtrlCmd
 from openr.LinkMonitor import ttypes as lm_types
 from openr.Lsdb import ttypes as lsdb_types
+from openr.Network import ttypes as network_types
 from openr.OpenrCtrl import OpenrCtrl
 from openr.OpenrCtrl.ttypes import OpenrError
 from openr.utils import ipnetwork, printing
@@ -117,17 +118,28 @@ class ConfigLinkMonitorCmd(ConfigStoreCmdBase):
 
 class ConfigPrefixManagerCmd(ConfigStoreCmdBase):
     def _run(self, client: OpenrCtrl.Client) -> None:
-        (prefix_mgr_config_blob, exception_str) = self.getConfigWrapper(
-            client, Consts.PREFIX_MGR_KEY
-        )
-
-        if prefix_mgr_config_blob is None:
+        # prefixes are stored per type, older versions store all of them in
+        # a single key
+        config_keys = [
+            "{}:{}".format(Consts.PREFIX_MGR_KEY, name)
+            for name in network_types.PrefixType._VALUES_TO_NAMES.values()
+        ]
+        prefix_mgr_config = None
+        exception_str = None
+        for config_key in config_keys + [Consts.PREFIX_MGR_KEY]:
+            (blob, exception_str) = self.getConfigWrapper(client, config_key)
+            if blob is None:
+                continue
+            prefix_db = deserialize_thrift_object(blob, lsdb_types.PrefixDatabase)
+            if prefix_mgr_config is None:
+                prefix_mgr_config = prefix_db
+            elif config_key != Consts.PREFIX_MGR_KEY:
+                prefix_mgr_config.prefixEntries.extend(prefix_db.prefixEntries)
+
+        if prefix_mgr_config is None:
             print(exception_str)
             return
 
-        prefix_mgr_config = deserialize_thrift_object(
-            prefix_mgr_config_blob, lsdb_types.PrefixDatabase
-        )
         self.print_config(prefix_mgr_config)
 
     def print_config(self, prefix_mgr_config: lsdb_types.PrefixDatabase):
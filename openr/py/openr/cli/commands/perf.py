@@ -8,11 +8,16 @@
 #
 
 
+import json
+import time
 from builtins import range
+from typing import List, Optional
 
 import tabulate
 from openr.cli.utils.commands import OpenrCtrlCmd
+from openr.Lsdb import ttypes as lsdb_types
 from openr.OpenrCtrl import OpenrCtrl
+from openr.OpenrCtrl import ttypes as ctrl_types
 
 
 class ViewFibCmd(OpenrCtrlCmd):
@@ -33,3 +38,134 @@ class ViewFibCmd(OpenrCtrlCmd):
             print("Perf Event Item: {}, total duration: {}ms".format(i, total_duration))
             print(tabulate.tabulate(rows, headers=headers))
             print()
+
+
+class ViewConvergenceTraceCmd(OpenrCtrlCmd):
+    def _run(self, client: OpenrCtrl.Client, chrome_trace: Optional[str]) -> None:
+        resp = client.getConvergenceTrace()
+        if chrome_trace:
+            with open(chrome_trace, "w") as f:
+                json.dump(self.to_chrome_trace(resp), f)
+            print(
+                "Wrote {} traces to {}, load it in chrome://tracing".format(
+                    len(resp.entries), chrome_trace
+                )
+            )
+            return
+
+        print(
+            "Traced {} of every {} convergence events, showing latest {}".format(
+                resp.numRecorded, resp.sampleRate, len(resp.entries)
+            )
+        )
+        headers = ["Stage", "Node", "Event", "Start (us)", "Duration (us)"]
+        for i, entry in enumerate(resp.entries):
+            start_us = entry.spans[0].startUs if entry.spans else 0
+            rows = [
+                [
+                    lsdb_types.PerfStage._VALUES_TO_NAMES.get(span.stage, span.stage),
+                    span.nodeName,
+                    span.eventDescr,
+                    span.startUs - start_us,
+                    span.durationUs,
+                ]
+                for span in entry.spans
+            ]
+            print(
+                "Trace: {}, total duration: {}us".format(i, entry.totalDurationUs)
+            )
+            print(tabulate.tabulate(rows, headers=headers))
+            print()
+
+    @staticmethod
+    def to_chrome_trace(resp) -> dict:
+        """
+        Trace Event Format of chrome://tracing and Perfetto, one process per
+        convergence event and one thread per node
+        """
+
+        events = []
+        for pid, entry in enumerate(resp.entries):
+            tids = {}
+            for span in entry.spans:
+                tid = tids.setdefault(span.nodeName, len(tids))
+                events.append(
+                    {
+                        "name": span.eventDescr,
+                        "cat": lsdb_types.PerfStage._VALUES_TO_NAMES.get(
+                            span.stage, str(span.stage)
+                        ),
+                        "ph": "X",
+                        "ts": span.startUs,
+                        "dur": span.durationUs,
+                        "pid": pid,
+                        "tid": tid,
+                    }
+                )
+            for node_name, tid in tids.items():
+                events.append(
+                    {
+                        "name": "thread_name",
+                        "ph": "M",
+                        "pid": pid,
+                        "tid": tid,
+                        "args": {"name": node_name},
+                    }
+                )
+        return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+class ProfileCmd(OpenrCtrlCmd):
+    def _run(
+        self,
+        client: OpenrCtrl.Client,
+        threads: List[str],
+        duration: int,
+        hz: int,
+        output: Optional[str],
+        top: int,
+    ) -> None:
+        client.startCpuProfile(
+            ctrl_types.CpuProfileParams(
+                threadNames=list(threads), durationSec=duration, samplingHz=hz
+            )
+        )
+        print("Profiling for {}s ...".format(duration))
+        time.sleep(duration)
+        resp = client.stopCpuProfile()
+
+        print(
+            "{} samples over {}ms, {} dropped".format(
+                resp.numSamples, resp.durationMs, resp.numDroppedSamples
+            )
+        )
+        rows = [
+            [name, cpu_us / 1000, 100.0 * cpu_us / max(1, resp.durationMs * 1000)]
+            for name, cpu_us in sorted(resp.threadCpuTimeUs.items())
+        ]
+        print(tabulate.tabulate(rows, headers=["Thread", "CPU (ms)", "CPU (%)"]))
+        print()
+
+        if output:
+            # folded stacks, as taken by flamegraph.pl
+            with open(output, "w") as f:
+                for stack, count in sorted(resp.foldedStacks.items()):
+                    f.write("{} {}\n".format(stack, count))
+            print("Wrote {} stacks to {}".format(len(resp.foldedStacks), output))
+            return
+
+        # innermost frames taking the most samples
+        leaves = {}
+        for stack, count in resp.foldedStacks.items():
+            frames = stack.split(";")
+            leaf = (frames[0], frames[-1] if len(frames) > 1 else "?")
+            leaves[leaf] = leaves.get(leaf, 0) + count
+        rows = [
+            [thread, frame, count, 100.0 * count / max(1, resp.numSamples)]
+            for (thread, frame), count in sorted(
+                leaves.items(), key=lambda kv: kv[1], reverse=True
+            )[:top]
+        ]
+        print(
+            tabulate.tabulate(rows, headers=["Thread", "Frame", "Samples", "%"])
+        )
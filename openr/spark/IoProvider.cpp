@@ -7,11 +7,14 @@
 
 #include "IoProvider.h"
 
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 
 #include <glog/logging.h>
 
 #include <folly/Format.h>
+#include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 
 namespace openr {
@@ -70,30 +73,44 @@ IoProvider::sendmsg(int sockfd, const struct msghdr* msg, int flags) {
   return ::sendmsg(sockfd, msg, flags);
 }
 
-std::tuple<
-    ssize_t /* size */,
-    int /* ifIndex */,
-    folly::SocketAddress /* srcAddr */,
-    int /* hopLimit */,
-    std::chrono::microseconds /* kernel timestamp */>
-IoProvider::recvMessage(
-    int fd, unsigned char* buf, int len, openr::IoProvider* ioProvider) {
-  // the control message buffer
-  // XXX: hardcoded, but this hardly should be a problem
-  union {
-    char ctrlBuf[CMSG_SPACE(1024)];
-    struct cmsghdr align;
-  } u;
-
-  // the message header to receive into
-  struct msghdr msg;
-
-  // the IO vector for data to be received with recvmsg
-  struct iovec entry;
+int
+IoProvider::recvmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::recvmmsg(sockfd, msgvec, vlen, flags, nullptr);
+}
 
-  // for address of the sender
-  sockaddr_storage addrStorage;
+int
+IoProvider::sendmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::sendmmsg(sockfd, msgvec, vlen, flags);
+}
 
+namespace {
+
+// the control message buffer
+// XXX: hardcoded, but this hardly should be a problem
+union RecvCtrlBuf {
+  char ctrlBuf[CMSG_SPACE(1024)];
+  struct cmsghdr align;
+};
+
+// control message buffer for the source address and interface to send from
+union SendCtrlBuf {
+  char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+  struct cmsghdr align;
+};
+
+//
+// Prepare msg to receive a message of up to len bytes into buf
+//
+void
+prepareRecvMsg(
+    struct msghdr& msg,
+    struct iovec& entry,
+    RecvCtrlBuf& u,
+    sockaddr_storage& addrStorage,
+    unsigned char* buf,
+    size_t len) {
   ::memset(&msg, 0, sizeof(msg));
 
   // we only expect to receive one block of data, single entry
@@ -118,28 +135,48 @@ IoProvider::recvMessage(
   // write the data here
   entry.iov_base = buf;
   entry.iov_len = len;
+}
 
-  ssize_t bytesRead = ioProvider->recvmsg(fd, &msg, MSG_DONTWAIT);
-
-  if (bytesRead < 0) {
-    throw std::runtime_error(folly::sformat(
-        "Failed reading message on fd {}: {}", fd, folly::errnoStr(errno)));
-  }
+//
+// Kernel timestamps are on the system clock, as our user space ones
+//
+std::chrono::microseconds
+toMicroseconds(struct timespec const& ts) {
+  // cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
+  return std::chrono::microseconds(
+      static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
 
-  if (msg.msg_flags & MSG_TRUNC) {
-    throw std::runtime_error("Message truncated");
-  }
+//
+// Software timestamp of SO_TIMESTAMPING control data, zero if not reported.
+// Raw hardware timestamps are on the NIC clock, which can't be compared
+// with timestamps of other packets, hence they are ignored
+//
+std::chrono::microseconds
+getSoftwareTimestamp(struct cmsghdr* cmsg) {
+  struct scm_timestamping tss;
+  memcpy(reinterpret_cast<void*>(&tss), CMSG_DATA(cmsg), sizeof(tss));
+  return toMicroseconds(tss.ts[0]);
+}
 
-  // grab the inIndex we received this packet on and the hopLimit
-  // those are available since we requested them via socket options
+//
+// Grab the inIndex we received the message on, the hopLimit and kernel
+// timestamp from the control data. Those are available since we requested
+// them via socket options
+//
+void
+parseControlData(
+    struct msghdr& msg,
+    int& ifIndex,
+    int& hopLimit,
+    std::chrono::microseconds& recvTs) {
   struct cmsghdr* cmsg{nullptr};
-  int ifIndex{-1};
-  int hopLimit{0};
+  ifIndex = -1;
+  hopLimit = 0;
 
   // use user space timestamp if kernel timestamp is not found
-  std::chrono::microseconds recvTs{
-      std::chrono::duration_cast<std::chrono::microseconds>(
-          std::chrono::system_clock::now().time_since_epoch())};
+  recvTs = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
 
   for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
     if (cmsg->cmsg_level == IPPROTO_IPV6) {
@@ -157,17 +194,20 @@ IoProvider::recvMessage(
             sizeof(hopLimit));
       }
     }
-    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+    if (cmsg->cmsg_level != SOL_SOCKET) {
+      continue;
+    }
+    std::chrono::microseconds kernelRecvTs{0};
+    if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
       struct timespec ts {
         0, 0
       };
       memcpy(reinterpret_cast<void*>(&ts), CMSG_DATA(cmsg), sizeof(ts));
-
-      // cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
-      const int64_t usecs =
-          static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
-      const std::chrono::microseconds kernelRecvTs(usecs);
-
+      kernelRecvTs = toMicroseconds(ts);
+    } else if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+      kernelRecvTs = getSoftwareTimestamp(cmsg);
+    }
+    if (kernelRecvTs.count()) {
       // sanity check
       DCHECK(recvTs >= kernelRecvTs) << "Time anomaly";
       VLOG(4) << "Got kernel-timestamp. It took "
@@ -177,36 +217,26 @@ IoProvider::recvMessage(
     }
   } // for
 
-  // build the source socket address from recvmsg data
-  folly::SocketAddress srcAddr{};
-  // this will throw if sender address was not filled in
-  srcAddr.setFromSockaddr(reinterpret_cast<struct sockaddr*>(&addrStorage));
-
   DCHECK(ifIndex != -1) << "ifIndex is not found";
   DCHECK(hopLimit) << "hopLimit is not found";
-
-  return std::make_tuple(bytesRead, ifIndex, srcAddr, hopLimit, recvTs);
 }
 
-ssize_t
-IoProvider::sendMessage(
-    int fd,
+//
+// Prepare msg to send packet via given interface to the address provided
+//
+void
+prepareSendMsg(
+    struct msghdr& msg,
+    struct iovec& entry,
+    SendCtrlBuf& u,
+    sockaddr_storage& addrStorage,
     int ifIndex,
-    folly::IPAddressV6 srcAddr,
-    folly::SocketAddress dstAddr,
-    std::string const& packet,
-    IoProvider* ioProvider) {
-  struct msghdr msg;
+    folly::IPAddressV6 const& srcAddr,
+    folly::SocketAddress const& dstAddr,
+    std::string const& packet) {
   struct cmsghdr* cmsg{nullptr};
 
-  // pack control buffer, aligned by control message hdr
-  union {
-    char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
-    struct cmsghdr align;
-  } u;
-
   // Set the destination address for the message
-  sockaddr_storage addrStorage;
   dstAddr.getAddress(&addrStorage);
 
   ::memset(&msg, 0, sizeof(msg));
@@ -228,15 +258,226 @@ IoProvider::sendMessage(
   ::memcpy(&pktinfo->ipi6_addr, srcAddr.bytes(), srcAddr.byteCount());
 
   // the IO vector for data to be sent
-  struct iovec entry;
   msg.msg_iov = &entry;
   msg.msg_iovlen = 1;
 
   // write the data here (we need to remove the const qualifier)
   entry.iov_base = const_cast<char*>(packet.data());
   entry.iov_len = packet.size();
+}
+
+} // anonymous namespace
+
+std::tuple<
+    ssize_t /* size */,
+    int /* ifIndex */,
+    folly::SocketAddress /* srcAddr */,
+    int /* hopLimit */,
+    std::chrono::microseconds /* kernel timestamp */>
+IoProvider::recvMessage(
+    int fd, unsigned char* buf, int len, openr::IoProvider* ioProvider) {
+  RecvCtrlBuf u;
+
+  // the message header to receive into
+  struct msghdr msg;
+
+  // the IO vector for data to be received with recvmsg
+  struct iovec entry;
+
+  // for address of the sender
+  sockaddr_storage addrStorage;
+
+  prepareRecvMsg(msg, entry, u, addrStorage, buf, len);
+
+  ssize_t bytesRead = ioProvider->recvmsg(fd, &msg, MSG_DONTWAIT);
+
+  if (bytesRead < 0) {
+    throw std::runtime_error(folly::sformat(
+        "Failed reading message on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  if (msg.msg_flags & MSG_TRUNC) {
+    throw std::runtime_error("Message truncated");
+  }
+
+  int ifIndex{-1};
+  int hopLimit{0};
+  std::chrono::microseconds recvTs{0};
+  parseControlData(msg, ifIndex, hopLimit, recvTs);
+
+  // build the source socket address from recvmsg data
+  folly::SocketAddress srcAddr{};
+  // this will throw if sender address was not filled in
+  srcAddr.setFromSockaddr(reinterpret_cast<struct sockaddr*>(&addrStorage));
+
+  return std::make_tuple(bytesRead, ifIndex, srcAddr, hopLimit, recvTs);
+}
+
+std::vector<IoProvider::ReceivedMessage>
+IoProvider::recvMessages(
+    int fd, size_t maxMessages, size_t len, IoProvider* ioProvider) {
+  std::vector<unsigned char> bufs(maxMessages * len);
+  std::vector<RecvCtrlBuf> ctrlBufs(maxMessages);
+  std::vector<sockaddr_storage> addrStorages(maxMessages);
+  std::vector<struct iovec> entries(maxMessages);
+  std::vector<struct mmsghdr> msgs(maxMessages);
+
+  for (size_t i = 0; i < maxMessages; ++i) {
+    ::memset(&msgs[i], 0, sizeof(msgs[i]));
+    prepareRecvMsg(
+        msgs[i].msg_hdr,
+        entries[i],
+        ctrlBufs[i],
+        addrStorages[i],
+        &bufs[i * len],
+        len);
+  }
+
+  const int numRead =
+      ioProvider->recvmmsg(fd, msgs.data(), maxMessages, MSG_DONTWAIT);
+
+  if (numRead < 0) {
+    if (errno == EAGAIN or errno == EWOULDBLOCK) {
+      return {};
+    }
+    throw std::runtime_error(folly::sformat(
+        "Failed reading messages on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  std::vector<ReceivedMessage> messages;
+  messages.reserve(numRead);
+  for (int i = 0; i < numRead; ++i) {
+    auto& msg = msgs[i].msg_hdr;
+    if (msg.msg_flags & MSG_TRUNC) {
+      LOG(ERROR) << "Dropping truncated message on fd " << fd;
+      continue;
+    }
+
+    ReceivedMessage message;
+    message.data.assign(
+        reinterpret_cast<const char*>(&bufs[i * len]), msgs[i].msg_len);
+    parseControlData(
+        msg, message.ifIndex, message.hopLimit, message.recvTs);
+    try {
+      // this will throw if sender address was not filled in
+      message.srcAddr.setFromSockaddr(
+          reinterpret_cast<struct sockaddr*>(&addrStorages[i]));
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Dropping message without sender address on fd " << fd;
+      continue;
+    }
+    messages.emplace_back(std::move(message));
+  }
+  return messages;
+}
+
+std::vector<IoProvider::TxTimestamp>
+IoProvider::recvTxTimestamps(int fd, IoProvider* ioProvider) {
+  std::vector<TxTimestamp> timestamps;
+
+  // with SOF_TIMESTAMPING_OPT_TSONLY no payload is looped back, only the
+  // control data is received
+  for (;;) {
+    RecvCtrlBuf u;
+    struct msghdr msg;
+    struct iovec entry;
+    sockaddr_storage addrStorage;
+    unsigned char buf[1];
+    prepareRecvMsg(msg, entry, u, addrStorage, buf, sizeof(buf));
+
+    if (ioProvider->recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break; // error queue is drained
+    }
+
+    folly::Optional<uint32_t> key;
+    std::chrono::microseconds txTs{0};
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        txTs = getSoftwareTimestamp(cmsg);
+      } else if (
+          (cmsg->cmsg_level == IPPROTO_IPV6 &&
+           cmsg->cmsg_type == IPV6_RECVERR) ||
+          (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR)) {
+        struct sock_extended_err err;
+        memcpy(reinterpret_cast<void*>(&err), CMSG_DATA(cmsg), sizeof(err));
+        if (err.ee_errno == ENOMSG &&
+            err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+          // key of SOF_TIMESTAMPING_OPT_ID
+          key = err.ee_data;
+        }
+      }
+    }
+
+    if (key.hasValue() && txTs.count()) {
+      timestamps.emplace_back(TxTimestamp{*key, txTs});
+    }
+  }
+  return timestamps;
+}
+
+ssize_t
+IoProvider::sendMessage(
+    int fd,
+    int ifIndex,
+    folly::IPAddressV6 srcAddr,
+    folly::SocketAddress dstAddr,
+    std::string const& packet,
+    IoProvider* ioProvider) {
+  struct msghdr msg;
+  struct iovec entry;
+  SendCtrlBuf u;
+  sockaddr_storage addrStorage;
+
+  prepareSendMsg(
+      msg, entry, u, addrStorage, ifIndex, srcAddr, dstAddr, packet);
 
   return ioProvider->sendmsg(fd, &msg, MSG_DONTWAIT);
 }
 
+std::vector<ssize_t>
+IoProvider::sendMessages(
+    int fd,
+    std::vector<OutgoingMessage> const& messages,
+    IoProvider* ioProvider) {
+  const auto numMessages = messages.size();
+  std::vector<struct iovec> entries(numMessages);
+  std::vector<SendCtrlBuf> ctrlBufs(numMessages);
+  std::vector<sockaddr_storage> addrStorages(numMessages);
+  std::vector<struct mmsghdr> msgs(numMessages);
+
+  for (size_t i = 0; i < numMessages; ++i) {
+    auto const& message = messages[i];
+    ::memset(&msgs[i], 0, sizeof(msgs[i]));
+    prepareSendMsg(
+        msgs[i].msg_hdr,
+        entries[i],
+        ctrlBufs[i],
+        addrStorages[i],
+        message.ifIndex,
+        message.srcAddr,
+        message.dstAddr,
+        message.packet);
+  }
+
+  // sendmmsg stops at the first message which fails, and fails as a whole
+  // only if that is the first one. Skip the failed message and resume, so
+  // that e.g. an interface going down doesn't hold messages of others
+  std::vector<ssize_t> bytesSent(numMessages, -1);
+  size_t index = 0;
+  while (index < numMessages) {
+    const int ret = ioProvider->sendmmsg(
+        fd, msgs.data() + index, numMessages - index, MSG_DONTWAIT);
+    if (ret <= 0) {
+      ++index;
+      continue;
+    }
+    for (int i = 0; i < ret; ++i, ++index) {
+      bytesSent[index] = msgs[index].msg_len;
+    }
+  }
+  return bytesSent;
+}
+
 } // namespace openr
@@ -13,6 +13,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
+#include <string>
+#include <vector>
 
 #include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
@@ -59,9 +61,40 @@ class IoProvider {
 
   virtual ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags);
 
+  virtual int recvmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
+  virtual int sendmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
   virtual int setsockopt(
       int sockfd, int level, int optname, const void* optval, socklen_t optlen);
 
+  // Message received by recvMessages along with its control data
+  struct ReceivedMessage {
+    std::string data;
+    int ifIndex{-1};
+    folly::SocketAddress srcAddr;
+    int hopLimit{0};
+    // kernel timestamp, or user space one if kernel didn't supply it
+    std::chrono::microseconds recvTs{0};
+  };
+
+  // Message to be sent by sendMessages via given interface and source address
+  struct OutgoingMessage {
+    int ifIndex{0};
+    folly::IPAddressV6 srcAddr;
+    folly::SocketAddress dstAddr;
+    std::string packet;
+  };
+
+  // Kernel TX timestamp of a sent message, as reported on the error queue of
+  // sockets with SO_TIMESTAMPING. key counts messages sent on the socket
+  struct TxTimestamp {
+    uint32_t key{0};
+    std::chrono::microseconds txTs{0};
+  };
+
   // Utility functions that operate on sockets
 
   /*
@@ -88,6 +121,31 @@ class IoProvider {
       std::string const& packet,
       IoProvider* ioProvider);
 
+  /*
+   * Receive up to maxMessages messages of at most len bytes each on fd with
+   * a single recvmmsg. Returns an empty vector if no message is pending.
+   * Truncated messages are dropped.
+   */
+  static std::vector<ReceivedMessage> recvMessages(
+      int fd, size_t maxMessages, size_t len, IoProvider* ioProvider);
+
+  /*
+   * Read all TX timestamps pending on the error queue of fd. fd must have
+   * SO_TIMESTAMPING enabled with SOF_TIMESTAMPING_TX_SOFTWARE, OPT_ID and
+   * OPT_TSONLY flags. Only software timestamps are reported.
+   */
+  static std::vector<TxTimestamp> recvTxTimestamps(
+      int fd, IoProvider* ioProvider);
+
+  /*
+   * Send all messages on fd with as few sendmmsg calls as possible. Returns
+   * number of bytes sent for each message, -1 for the ones which failed.
+   */
+  static std::vector<ssize_t> sendMessages(
+      int fd,
+      std::vector<OutgoingMessage> const& messages,
+      IoProvider* ioProvider);
+
  private:
   IoProvider(IoProvider const&) = delete;
   IoProvider& operator=(IoProvider const&) = delete;
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IoUringProvider.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#ifdef OPENR_HAS_IO_URING
+#include <liburing.h>
+#endif
+
+namespace openr {
+
+#ifdef OPENR_HAS_IO_URING
+
+struct IoUringProvider::Ring {
+  struct io_uring ring;
+  unsigned int entries{0};
+  // results of the ops of a chain, by position in the chain
+  std::vector<int> results;
+};
+
+std::shared_ptr<IoProvider>
+IoUringProvider::create(unsigned int entries) {
+  auto ring = std::make_unique<Ring>();
+  const int ret = io_uring_queue_init(entries, &ring->ring, 0);
+  if (ret < 0) {
+    LOG(WARNING) << "io_uring is unavailable, falling back to syscalls: "
+                 << folly::errnoStr(-ret);
+    return std::make_shared<IoProvider>();
+  }
+
+  // message ops came after io_uring itself (linux 5.3)
+  auto probe = io_uring_get_probe_ring(&ring->ring);
+  const bool supported = probe and
+      io_uring_opcode_supported(probe, IORING_OP_RECVMSG) and
+      io_uring_opcode_supported(probe, IORING_OP_SENDMSG);
+  if (probe) {
+    io_uring_free_probe(probe);
+  }
+  if (not supported) {
+    LOG(WARNING) << "io_uring lacks message ops, falling back to syscalls";
+    io_uring_queue_exit(&ring->ring);
+    return std::make_shared<IoProvider>();
+  }
+
+  LOG(INFO) << "Sending and receiving messages through io_uring of "
+            << entries << " entries";
+  ring->entries = entries;
+  ring->results.resize(entries);
+  return std::shared_ptr<IoProvider>(new IoUringProvider(std::move(ring)));
+}
+
+IoUringProvider::~IoUringProvider() {
+  io_uring_queue_exit(&ring_->ring);
+}
+
+int
+IoUringProvider::submitChain(
+    int sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    bool isSend) {
+  auto ring = &ring_->ring;
+  vlen = std::min(vlen, ring_->entries);
+
+  // link the ops for a failure, EAGAIN included, to cancel the ones after it
+  unsigned int numPrepared = 0;
+  struct io_uring_sqe* lastSqe = nullptr;
+  for (; numPrepared < vlen; ++numPrepared) {
+    auto sqe = io_uring_get_sqe(ring);
+    if (not sqe) {
+      break;
+    }
+    if (isSend) {
+      io_uring_prep_sendmsg(sqe, sockfd, &msgvec[numPrepared].msg_hdr, flags);
+    } else {
+      io_uring_prep_recvmsg(sqe, sockfd, &msgvec[numPrepared].msg_hdr, flags);
+    }
+    io_uring_sqe_set_data(
+        sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(numPrepared)));
+    sqe->flags |= IOSQE_IO_LINK;
+    lastSqe = sqe;
+  }
+  if (numPrepared == 0) {
+    errno = EBUSY;
+    return -1;
+  }
+  lastSqe->flags &= ~IOSQE_IO_LINK;
+
+  // MSG_DONTWAIT ops complete on submission, waiting doesn't block
+  const int numSubmitted = io_uring_submit_and_wait(ring, numPrepared);
+  if (numSubmitted < 0) {
+    errno = -numSubmitted;
+    return -1;
+  }
+
+  auto& results = ring_->results;
+  std::fill(results.begin(), results.begin() + numPrepared, -ECANCELED);
+  for (int i = 0; i < numSubmitted; ++i) {
+    struct io_uring_cqe* cqe{nullptr};
+    const int ret = io_uring_wait_cqe(ring, &cqe);
+    if (ret < 0) {
+      LOG(ERROR) << "Failed reaping io_uring completion: "
+                 << folly::errnoStr(-ret);
+      break;
+    }
+    const auto index = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+    results.at(index) = cqe->res;
+    io_uring_cqe_seen(ring, cqe);
+  }
+
+  int numDone = 0;
+  for (; numDone < static_cast<int>(numPrepared) and results[numDone] >= 0;
+       ++numDone) {
+    msgvec[numDone].msg_len = results[numDone];
+  }
+  if (numDone == 0) {
+    errno = -results[0];
+    return -1;
+  }
+  return numDone;
+}
+
+#else
+
+struct IoUringProvider::Ring {};
+
+std::shared_ptr<IoProvider>
+IoUringProvider::create(unsigned int /* entries */) {
+  LOG(WARNING) << "Built without io_uring support, using syscalls";
+  return std::make_shared<IoProvider>();
+}
+
+IoUringProvider::~IoUringProvider() = default;
+
+int
+IoUringProvider::submitChain(
+    int sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    bool isSend) {
+  return isSend ? IoProvider::sendmmsg(sockfd, msgvec, vlen, flags)
+                : IoProvider::recvmmsg(sockfd, msgvec, vlen, flags);
+}
+
+#endif
+
+IoUringProvider::IoUringProvider(std::unique_ptr<Ring> ring)
+    : ring_(std::move(ring)) {}
+
+int
+IoUringProvider::recvmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return submitChain(sockfd, msgvec, vlen, flags, false /* isSend */);
+}
+
+int
+IoUringProvider::sendmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return submitChain(sockfd, msgvec, vlen, flags, true /* isSend */);
+}
+
+} // namespace openr
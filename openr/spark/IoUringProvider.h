@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <openr/spark/IoProvider.h>
+
+namespace openr {
+
+/**
+ * IoProvider sending and receiving batches of messages through an io_uring.
+ * A batch goes out as a chain of linked ops in a single io_uring_enter, and
+ * stops at the first failing op the way recvmmsg and sendmmsg do, so callers
+ * of recvMessages and sendMessages need no change.
+ *
+ * The ring is not thread-safe, each thread needs a provider of its own.
+ * io_uring is only used when built with liburing (OPENR_HAS_IO_URING) and
+ * supported by the running kernel, create() hands out the syscall based
+ * IoProvider otherwise.
+ */
+class IoUringProvider final : public IoProvider {
+ public:
+  // ring of entries ops, messages of larger batches are handled in chunks
+  static std::shared_ptr<IoProvider> create(unsigned int entries = 64);
+
+  ~IoUringProvider() override;
+
+  int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
+  int sendmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
+ private:
+  struct Ring;
+
+  explicit IoUringProvider(std::unique_ptr<Ring> ring);
+
+  // submit a chain of recvmsg or sendmsg ops and reap their completions.
+  // Returns number of leading messages which succeeded, or -1 with errno of
+  // the first one if it failed
+  int submitChain(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags,
+      bool isSend);
+
+  std::unique_ptr<Ring> ring_;
+};
+
+} // namespace openr
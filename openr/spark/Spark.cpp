@@ -8,6 +8,7 @@
 #include "Spark.h"
 
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <sodium.h>
@@ -22,6 +23,7 @@
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/IPAddress.h>
 #include <folly/MapUtil.h>
+#include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
@@ -29,6 +31,8 @@
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
 #include <folly/gen/Base.h>
+#include <folly/io/IOBuf.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 
 #include <openr/common/Constants.h>
@@ -37,6 +41,11 @@
 
 #include "IoProvider.h"
 
+// missing from older libc headers, see linux/in6.h
+#ifndef IPV6_MULTICAST_ALL
+#define IPV6_MULTICAST_ALL 29
+#endif
+
 namespace {
 //
 // The min size of IPv6 packet is 1280 bytes. We use this
@@ -67,6 +76,187 @@ const int64_t kAbsThreshold = 500;
 // number of restarting packets to send out per interface before I'm going down
 const int kNumRestartingPktSent = 3;
 
+// max number of packets to receive with one recvmmsg
+const size_t kSparkRecvBatchSize = 64;
+
+// tick of the timer wheel of per-interface and per-neighbor timers
+const std::chrono::milliseconds kSparkTimerWheelTick{4};
+
+// ifIndexes below it are looked up in a flat array, kernel allocates them
+// densely from 1. The rare larger ones fall back to a scan
+const int kMaxDenseIfIndex = 1 << 16;
+
+// max number of sent hello packets awaiting their kernel TX timestamp
+const size_t kMaxPendingTxTimestamps = 1024;
+
+// number of latest hello packets per interface to keep TX timestamps of.
+// Neighbor reflects the last one it received from us
+const size_t kMaxHelloTxTimestamps = 4;
+
+// max delay from building a hello packet until kernel sends it out
+const std::chrono::microseconds kMaxTxTimestampDelay{100000};
+
+// config store key of Spark2 neighbors persisted at shutdown
+const std::string kNeighborCacheKey{"spark-neighbor-cache"};
+
+//
+// Fields of a hello packet telling whether to drop it. domainName and version
+// are only carried by hello msgs, not by heartbeat or handshake msgs
+//
+struct HelloPacketHeader {
+  std::string nodeName;
+  folly::Optional<std::string> domainName;
+  folly::Optional<int32_t> version;
+};
+
+//
+// Read the struct at the reader's position. readField gets called with the
+// id and type of every field, and returns false for the ones to skip
+//
+template <typename ReadField>
+void
+readThriftStruct(
+    apache::thrift::CompactProtocolReader& reader, ReadField&& readField) {
+  std::string name;
+  apache::thrift::protocol::TType type;
+  int16_t id;
+  reader.readStructBegin(name);
+  while (true) {
+    reader.readFieldBegin(name, type, id);
+    if (type == apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    if (not readField(id, type)) {
+      reader.skip(type);
+    }
+    reader.readFieldEnd();
+  }
+  reader.readStructEnd();
+}
+
+//
+// Decode the header of a serialized thrift::SparkHelloPacket, skipping over
+// the bulky fields like neighborInfos without deserializing them. Spark2 msgs
+// take precedence over the legacy payload if spark2 is enabled, the same way
+// processHelloPacket picks them. Throws on malformed packets
+//
+HelloPacketHeader
+readHelloPacketHeader(std::string const& data, bool enableSpark2) {
+  using apache::thrift::protocol::T_I32;
+  using apache::thrift::protocol::T_STRING;
+  using apache::thrift::protocol::T_STRUCT;
+
+  auto buf = folly::IOBuf::wrapBufferAsValue(data.data(), data.size());
+  apache::thrift::CompactProtocolReader reader;
+  reader.setInput(&buf);
+
+  HelloPacketHeader payloadHeader;
+  folly::Optional<HelloPacketHeader> spark2Header;
+  auto readString = [&reader](folly::Optional<std::string>& field) {
+    field = std::string();
+    reader.readString(*field);
+  };
+  auto readI32 = [&reader](folly::Optional<int32_t>& field) {
+    field = 0;
+    reader.readI32(*field);
+  };
+
+  readThriftStruct(reader, [&](int16_t id, auto type) {
+    if (type != T_STRUCT) {
+      return false;
+    }
+    switch (id) {
+    case 1: // SparkPayload
+      readThriftStruct(reader, [&](int16_t payloadId, auto payloadType) {
+        if (payloadId == 7 and payloadType == T_I32) {
+          readI32(payloadHeader.version);
+          return true;
+        }
+        if (payloadId != 1 or payloadType != T_STRUCT) {
+          return false;
+        }
+        // SparkNeighbor originator
+        readThriftStruct(reader, [&](int16_t nbrId, auto nbrType) {
+          if (nbrId == 6 and nbrType == T_STRING) {
+            readString(payloadHeader.domainName);
+            return true;
+          }
+          if (nbrId == 1 and nbrType == T_STRING) {
+            reader.readString(payloadHeader.nodeName);
+            return true;
+          }
+          return false;
+        });
+        return true;
+      });
+      return true;
+    case 3: // SparkHelloMsg
+      spark2Header = HelloPacketHeader();
+      readThriftStruct(reader, [&](int16_t msgId, auto msgType) {
+        if (msgId == 1 and msgType == T_STRING) {
+          readString(spark2Header->domainName);
+          return true;
+        }
+        if (msgId == 2 and msgType == T_STRING) {
+          reader.readString(spark2Header->nodeName);
+          return true;
+        }
+        if (msgId == 6 and msgType == T_I32) {
+          readI32(spark2Header->version);
+          return true;
+        }
+        return false;
+      });
+      return true;
+    case 4: // SparkHeartbeatMsg
+    case 5: // SparkHandshakeMsg
+      spark2Header = HelloPacketHeader();
+      readThriftStruct(reader, [&](int16_t msgId, auto msgType) {
+        if (msgId == 1 and msgType == T_STRING) {
+          reader.readString(spark2Header->nodeName);
+          return true;
+        }
+        return false;
+      });
+      return true;
+    default:
+      return false;
+    }
+  });
+
+  if (enableSpark2 and spark2Header.hasValue()) {
+    return std::move(spark2Header).value();
+  }
+  // legacy payload carries these fields even when not set by the sender
+  if (not payloadHeader.domainName.hasValue()) {
+    payloadHeader.domainName = std::string();
+  }
+  return payloadHeader;
+}
+
+// seqNum of the heartbeat template. Its compact protocol encoding is 9 bytes,
+// all but the last one with the MSB set, which can't show up in the ASCII
+// node name serialized along with it
+const int64_t kHeartbeatTemplateSeqNum = 0x3C5A5A5A5A5A5A5A;
+
+// max size of a varint encoded 64 bit integer
+const size_t kMaxVarintSize = 10;
+
+//
+// Append value to buf the way thrift CompactProtocol encodes an i64, i.e. as
+// a zigzag varint
+//
+void
+appendCompactI64(std::string& buf, int64_t value) {
+  uint64_t n = (static_cast<uint64_t>(value) << 1) ^
+      static_cast<uint64_t>(value >> 63);
+  while (n >= 0x80) {
+    buf.push_back(static_cast<char>((n & 0x7f) | 0x80));
+    n >>= 7;
+  }
+  buf.push_back(static_cast<char>(n));
+}
+
 //
 // Function to get current timestamp in microseconds using steady clock
 // NOTE: we use non-monotonic clock since kernel time-stamps do not support
@@ -217,7 +407,7 @@ Spark::Neighbor::Neighbor(
     thrift::SparkNeighbor const& info,
     uint32_t label,
     uint64_t seqNum,
-    std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
+    std::unique_ptr<TimerWheel::Timer> holdTimer,
     const std::chrono::milliseconds& samplingPeriod,
     std::function<void(const int64_t&)> rttChangeCb,
     std::string areaId)
@@ -246,12 +436,12 @@ Spark::Spark2Neighbor::Spark2Neighbor(
     const std::chrono::milliseconds& samplingPeriod,
     std::function<void(const int64_t&)> rttChangeCb,
     const std::string& adjArea)
-    : domainName(domainName),
+    : seqNum(seqNum),
+      state(SparkNeighState::IDLE),
+      domainName(domainName),
       nodeName(nodeName),
       remoteIfName(remoteIfName),
       label(label),
-      seqNum(seqNum),
-      state(SparkNeighState::IDLE),
       stepDetector(
           samplingPeriod /* sampling period */,
           kFastWndSize /* fast window size */,
@@ -293,7 +483,13 @@ Spark::Spark(
     bool enableFloodOptimization,
     bool enableSpark2,
     bool increaseHelloInterval,
-    folly::Optional<std::unordered_set<std::string>> areas)
+    folly::Optional<std::unordered_set<std::string>> areas,
+    std::vector<SparkFastDetectionConfig> fastDetectionConfigs,
+    uint16_t fastDetectionPort,
+    std::chrono::milliseconds myHelloMaxTime,
+    folly::Optional<size_t> shardId,
+    RuntimeKnobs* runtimeKnobs,
+    PersistentStore* configStore)
     : myDomainName_(myDomainName),
       myNodeName_(myNodeName),
       udpMcastPort_(udpMcastPort),
@@ -302,6 +498,7 @@ Spark::Spark(
       fastInitKeepAliveTime_(fastInitKeepAliveTime),
       myHelloTime_(myHelloTime),
       myHelloFastInitTime_(myHelloFastInitTime),
+      myHelloMaxTime_(myHelloMaxTime),
       myHandshakeTime_(myHandshakeTime),
       myHeartbeatTime_(myHeartbeatTime),
       myNegotiateHoldTime_(myNegotiateHoldTime),
@@ -316,7 +513,9 @@ Spark::Spark(
       enableSpark2_(enableSpark2),
       increaseHelloInterval_(increaseHelloInterval),
       ioProvider_(std::move(ioProvider)),
-      areas_(std::move(areas)) {
+      areas_(std::move(areas)),
+      shardId_(shardId),
+      configStore_(configStore) {
   CHECK(myHoldTime_ >= 3 * myKeepAliveTime)
       << "Keep-alive-time must be less than hold-time.";
   CHECK(myKeepAliveTime > std::chrono::milliseconds(0))
@@ -327,6 +526,32 @@ Spark::Spark(
       << "fast-init-keep-alive-time must not be bigger than keep-alive-time";
   CHECK(ioProvider_) << "Got null IoProvider";
 
+  keepAliveTimeMs_ = RuntimeKnobs::Knob(myKeepAliveTime_.count());
+  helloTimeMs_ = RuntimeKnobs::Knob(myHelloTime_.count());
+  heartbeatTimeMs_ = RuntimeKnobs::Knob(myHeartbeatTime_.count());
+  if (runtimeKnobs) {
+    // neighbors expire us after the hold times we announce, at least three
+    // keep alives or heartbeats must fit in them
+    keepAliveTimeMs_ = runtimeKnobs->addKnob(
+        "spark.keepalive_time_ms",
+        "Interval of hellos sent to neighbors",
+        myKeepAliveTime_.count(),
+        fastInitKeepAliveTime_.count(),
+        myHoldTime_.count() / 3);
+    helloTimeMs_ = runtimeKnobs->addKnob(
+        "spark.hello_time_ms",
+        "Interval of Spark2 hellos",
+        myHelloTime_.count(),
+        myHelloFastInitTime_.count(),
+        std::max(myHelloTime_, myHelloMaxTime_).count());
+    heartbeatTimeMs_ = runtimeKnobs->addKnob(
+        "spark.heartbeat_time_ms",
+        "Interval of Spark2 heartbeats",
+        myHeartbeatTime_.count(),
+        1,
+        myHeartbeatHoldTime_.count() / 3);
+  }
+
   // Initialize list of BucketedTimeSeries
   const std::chrono::seconds sec{1};
   const int32_t numBuckets = Constants::kMaxAllowedPps / 3;
@@ -339,14 +564,16 @@ Spark::Spark(
   // Fiber to process interface updates from LinkMonitor
   addFiberTask([q = std::move(interfaceUpdatesQueue), this]() mutable noexcept {
     while (true) {
-      auto interfaceUpdates = q.get(); // perform read
+      // perform read, interface updates are only read so they are shared
+      // with other readers rather than copied
+      auto interfaceUpdates = q.getShared();
       VLOG(1) << "Received interface updates";
       if (interfaceUpdates.hasError()) {
         LOG(INFO) << "Terminating interface update processing fiber";
         break;
       }
 
-      processInterfaceUpdates(std::move(interfaceUpdates).value());
+      processInterfaceUpdates(*interfaceUpdates.value());
     }
   });
 
@@ -356,16 +583,85 @@ Spark::Spark(
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
 
-  // Initialize some stat keys
-  tData_.addStatExportType(
-      "spark.invalid_keepalive.different_domain", fbzmq::SUM);
-  tData_.addStatExportType(
-      "spark.invalid_keepalive.invalid_version", fbzmq::SUM);
-  tData_.addStatExportType(
-      "spark.invalid_keepalive.missing_v4_addr", fbzmq::SUM);
-  tData_.addStatExportType(
-      "spark.invalid_keepalive.different_subnet", fbzmq::SUM);
-  tData_.addStatExportType("spark.invalid_keepalive.looped_packet", fbzmq::SUM);
+  // Register stats of the packet handlers
+  handshakeBytesSentStat_ =
+      stats_.addStat("spark.handshake.bytes_sent", {fbzmq::SUM});
+  handshakePacketsSentStat_ =
+      stats_.addStat("spark.handshake.packets_sent", {fbzmq::SUM});
+  heartbeatBytesSentStat_ =
+      stats_.addStat("spark.heartbeat.bytes_sent", {fbzmq::SUM});
+  heartbeatPacketsSentStat_ =
+      stats_.addStat("spark.heartbeat.packets_sent", {fbzmq::SUM});
+  helloBytesSentStat_ = stats_.addStat("spark.hello.bytes_sent", {fbzmq::SUM});
+  helloPacketsSentStat_ =
+      stats_.addStat("spark.hello.packets_sent", {fbzmq::SUM});
+  helloPacketDroppedStat_ =
+      stats_.addStat("spark.hello_packet_dropped", {fbzmq::SUM});
+  helloPacketDroppedEarlyDifferentDomainStat_ = stats_.addStat(
+      "spark.hello_packet_dropped_early.different_domain", {fbzmq::SUM});
+  helloPacketDroppedEarlyInvalidVersionStat_ = stats_.addStat(
+      "spark.hello_packet_dropped_early.invalid_version", {fbzmq::SUM});
+  helloPacketDroppedEarlyLoopedPacketStat_ = stats_.addStat(
+      "spark.hello_packet_dropped_early.looped_packet", {fbzmq::SUM});
+  helloPacketDroppedEarlyMalformedStat_ = stats_.addStat(
+      "spark.hello_packet_dropped_early.malformed", {fbzmq::SUM});
+  helloPacketDroppedEarlyUnknownInterfaceStat_ = stats_.addStat(
+      "spark.hello_packet_dropped_early.unknown_interface", {fbzmq::SUM});
+  helloPacketProcessedStat_ =
+      stats_.addStat("spark.hello_packet_processed", {fbzmq::SUM});
+  helloPacketRecvStat_ =
+      stats_.addStat("spark.hello_packet_recv", {fbzmq::SUM});
+  helloPacketRecvBatchesStat_ =
+      stats_.addStat("spark.hello_packet_recv_batches", {fbzmq::SUM});
+  helloPacketRecvSizeStat_ =
+      stats_.addStat("spark.hello_packet_recv_size", {fbzmq::SUM});
+  invalidKeepaliveDifferentDomainStat_ =
+      stats_.addStat("spark.invalid_keepalive.different_domain", {fbzmq::SUM});
+  invalidKeepaliveDifferentSubnetStat_ =
+      stats_.addStat("spark.invalid_keepalive.different_subnet", {fbzmq::SUM});
+  invalidKeepaliveInvalidVersionStat_ =
+      stats_.addStat("spark.invalid_keepalive.invalid_version", {fbzmq::SUM});
+  invalidKeepaliveLoopedPacketStat_ =
+      stats_.addStat("spark.invalid_keepalive.looped_packet", {fbzmq::SUM});
+  invalidKeepaliveMissingV4AddrStat_ =
+      stats_.addStat("spark.invalid_keepalive.missing_v4_addr", {fbzmq::SUM});
+
+  // fast failure detection of Spark2 neighbors, on its own thread
+  if (enableSpark2_ and not fastDetectionConfigs.empty()) {
+    fastDetector_ = std::make_unique<SparkFastDetector>(
+        myNodeName_,
+        fastDetectionPort,
+        std::move(fastDetectionConfigs),
+        maybeIpTos,
+        ioProvider_,
+        [this](std::string const& ifName, std::string const& neighborName) {
+          runInEventBaseThread([this, ifName, neighborName]() {
+            processFastDetectionTimeout(ifName, neighborName);
+          });
+        });
+    fastDetectorThread_ = std::thread([this]() {
+      LOG(INFO) << "Starting Spark fast failure detection thread...";
+      fastDetector_->run();
+      LOG(INFO) << "Spark fast failure detection thread stopped.";
+    });
+    fastDetector_->waitUntilRunning();
+  }
+
+  // Spark2 neighbors we had adjacency with before restart. Erased from
+  // store right away, an ungraceful exit must not leave a stale one behind
+  if (enableSpark2_ and configStore_) {
+    const auto key = getNeighborCacheKey();
+    auto maybeCache =
+        configStore_->loadThriftObj<thrift::SparkNeighborCache>(key).get();
+    if (maybeCache.hasValue()) {
+      for (auto& kv : maybeCache->neighbors) {
+        neighborCache_.emplace(kv.first, std::move(kv.second));
+      }
+      LOG(INFO) << "Loaded cached neighbors on " << neighborCache_.size()
+                << " interfaces from config store";
+      configStore_->erase(key);
+    }
+  }
 }
 
 // static util function to transform state into str
@@ -399,16 +695,37 @@ Spark::stop() {
   // send out restarting packets for all interfaces before I'm going down
   // here we are sending duplicate restarting packets (3 times per interface)
   // in case some packets get lost
+  std::vector<std::string> ifNames;
   for (int i = 0; i < kNumRestartingPktSent; ++i) {
     for (const auto& kv : interfaceDb_) {
-      const auto& ifName = kv.first;
-      sendHelloPacket(
-          ifName, false /* inFastInitState */, true /* restarting */);
+      ifNames.emplace_back(kv.first);
     }
   }
+  sendHelloPackets(ifNames, true /* restarting */);
 
   LOG(INFO)
       << "I have sent all restarting packets to my neighbors, ready to go down";
+
+  // persist ESTABLISHED neighbors, which keep adjacency with us for their
+  // graceful restart time, to re-establish it in one handshake on restart
+  if (enableSpark2_ and configStore_) {
+    folly::Promise<thrift::SparkNeighborCache> promise;
+    auto future = promise.getFuture();
+    runInEventBaseThread([this, promise = std::move(promise)]() mutable {
+      promise.setValue(buildNeighborCache());
+    });
+    auto cache = std::move(future).get();
+    LOG(INFO) << "Storing cached neighbors on " << cache.neighbors.size()
+              << " interfaces to config store";
+    // wait until durable, we are about to exit
+    configStore_->storeThriftObj(getNeighborCacheKey(), cache).get();
+  }
+
+  if (fastDetector_) {
+    fastDetector_->stop();
+    fastDetector_->waitUntilStopped();
+    fastDetectorThread_.join();
+  }
   OpenrEventBase::stop();
 }
 
@@ -515,17 +832,62 @@ Spark::prepare(folly::Optional<int> maybeIpTos) noexcept {
                << folly::errnoStr(errno);
   }
 
-  // enable timestamping for this socket
-  const int enabled = 1;
+  // the sockets of all shards are bound to the same port. Only receive the
+  // packets of the groups joined on our own interfaces, others go to the
+  // shards of their interfaces
+  if (shardId_) {
+    const int mcastAll = 0;
+    if (ioProvider_->setsockopt(
+            fd,
+            IPPROTO_IPV6,
+            IPV6_MULTICAST_ALL,
+            &mcastAll,
+            sizeof(mcastAll)) != 0) {
+      LOG(WARNING) << "Failed restricting the socket to joined groups, "
+                   << "packets of other shards get dropped. Error: "
+                   << folly::errnoStr(errno);
+    }
+  }
+
+  // enable kernel RX and TX timestamping for this socket. TX timestamps are
+  // reported on the error queue, keyed by the count of packets sent
+  const int tsFlags = SOF_TIMESTAMPING_SOFTWARE |
+      SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+      SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
   if (ioProvider_->setsockopt(
-          fd, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
-    LOG(ERROR) << "Failed to enable kernel timestamping. Measured RTTs are "
-               << "likely to have more noise in them. Error: "
-               << folly::errnoStr(errno);
+          fd, SOL_SOCKET, SO_TIMESTAMPING, &tsFlags, sizeof(tsFlags)) == 0) {
+    enableTxTimestamps_ = true;
+  } else {
+    LOG(WARNING) << "Failed to enable kernel TX timestamping, falling back to "
+                 << "RX timestamps. Error: " << folly::errnoStr(errno);
+
+    // enable timestamping for this socket
+    const int enabled = 1;
+    if (ioProvider_->setsockopt(
+            fd, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
+      LOG(ERROR) << "Failed to enable kernel timestamping. Measured RTTs are "
+                 << "likely to have more noise in them. Error: "
+                 << folly::errnoStr(errno);
+    }
   }
 
   LOG(INFO) << "Spark thread attaching socket/events callbacks...";
 
+  // Per-interface and per-neighbor timers share a timer wheel, which gets
+  // advanced by a single event loop timeout
+  timerWheelTimeout_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
+    timerWheel_->expire(TimerWheel::Clock::now());
+  });
+  timerWheel_ = std::make_unique<TimerWheel>(
+      kSparkTimerWheelTick, [this](TimerWheel::Clock::time_point wakeupTime) {
+        // round up, the wheel must not be advanced before wakeupTime
+        timerWheelTimeout_->scheduleTimeout(
+            std::chrono::ceil<std::chrono::milliseconds>(
+                std::max(
+                    wakeupTime - TimerWheel::Clock::now(),
+                    TimerWheel::Clock::duration(0))));
+      });
+
   // Schedule periodic timer for monitor submission
   const bool isPeriodic = true;
   monitorTimer_ = fbzmq::ZmqTimeout::make(
@@ -535,9 +897,9 @@ Spark::prepare(folly::Optional<int> maybeIpTos) noexcept {
   // Listen for incoming messages on multicast FD
   addSocketFd(mcastFd_, ZMQ_POLLIN, [this](int) noexcept {
     try {
-      processHelloPacket();
+      processHelloPackets();
     } catch (std::exception const& err) {
-      LOG(ERROR) << "Spark: error processing hello packet "
+      LOG(ERROR) << "Spark: error receiving hello packets "
                  << folly::exceptionStr(err);
     }
   });
@@ -552,7 +914,7 @@ Spark::sanityCheckHelloPkt(
   // check if own packet has looped
   if (neighborName == myNodeName_) {
     VLOG(2) << "Ignore packet from self (" << myNodeName_ << ")";
-    tData_.addStatValue("spark.invalid_keepalive.looped_packet", 1, fbzmq::SUM);
+    invalidKeepaliveLoopedPacketStat_.addValue(1);
     return PacketValidationResult::SKIP_LOOPED_SELF;
   }
   // domain check
@@ -561,8 +923,7 @@ Spark::sanityCheckHelloPkt(
                << " on interface " << remoteIfName
                << " because it's from different domain " << domainName
                << ". My domain is " << myDomainName_;
-    tData_.addStatValue(
-        "spark.invalid_keepalive.different_domain", 1, fbzmq::SUM);
+    invalidKeepaliveDifferentDomainStat_.addValue(1);
     return PacketValidationResult::FAILURE;
   }
   // version check
@@ -570,8 +931,7 @@ Spark::sanityCheckHelloPkt(
     LOG(ERROR) << "Unsupported version: " << neighborName << " "
                << remoteVersion
                << ", must be >= " << kVersion_.lowestSupportedVersion;
-    tData_.addStatValue(
-        "spark.invalid_keepalive.invalid_version", 1, fbzmq::SUM);
+    invalidKeepaliveInvalidVersionStat_.addValue(1);
     return PacketValidationResult::FAILURE;
   }
   return PacketValidationResult::SUCCESS;
@@ -613,8 +973,8 @@ Spark::validateHelloPacket(
 
   // first time we hear from this guy, add to tracking list
   if (it == ifNeighbors.end()) {
-    auto holdTimer = fbzmq::ZmqTimeout::make(
-        getEvb(), [this, ifName, neighborName]() noexcept {
+    auto holdTimer =
+        timerWheel_->makeTimer([this, ifName, neighborName]() noexcept {
           processNeighborHoldTimeout(ifName, neighborName);
         });
 
@@ -768,74 +1128,95 @@ Spark::shouldProcessHelloPacket(
 }
 
 bool
-Spark::parsePacket(
-    thrift::SparkHelloPacket& pkt,
-    std::string& ifName,
-    std::chrono::microseconds& recvTime) {
-  // the read buffer
-  uint8_t buf[kMinIpv6Mtu];
+Spark::preFilterPacket(std::string const& data) {
+  HelloPacketHeader header;
+  try {
+    header = readHelloPacketHeader(data, enableSpark2_);
+  } catch (std::exception const& err) {
+    VLOG(2) << "Failed decoding hello packet header "
+            << folly::exceptionStr(err);
+    helloPacketDroppedEarlyMalformedStat_.addValue(1);
+    return false;
+  }
 
-  ssize_t bytesRead;
-  int ifIndex;
-  folly::SocketAddress clientAddr;
-  int hopLimit;
+  // same checks as sanityCheckHelloPkt, without logging every packet of a
+  // flood
+  if (header.nodeName == myNodeName_) {
+    helloPacketDroppedEarlyLoopedPacketStat_.addValue(1);
+    return false;
+  }
+  if (header.domainName.hasValue() and *header.domainName != myDomainName_) {
+    VLOG(2) << "Dropping hello packet from node " << header.nodeName
+            << " of different domain " << *header.domainName;
+    helloPacketDroppedEarlyDifferentDomainStat_.addValue(1);
+    return false;
+  }
+  if (header.version.hasValue() and
+      *header.version < kVersion_.lowestSupportedVersion) {
+    VLOG(2) << "Dropping hello packet from node " << header.nodeName
+            << " of unsupported version " << *header.version;
+    helloPacketDroppedEarlyInvalidVersionStat_.addValue(1);
+    return false;
+  }
+  return true;
+}
 
-  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, recvTime) =
-      IoProvider::recvMessage(mcastFd_, buf, kMinIpv6Mtu, ioProvider_.get());
+bool
+Spark::parsePacket(
+    IoProvider::ReceivedMessage const& message,
+    thrift::SparkHelloPacket& pkt,
+    std::string& ifName) {
+  auto const& clientAddr = message.srcAddr;
+  const auto bytesRead = message.data.size();
 
-  if (hopLimit < kSparkHopLimit) {
+  if (message.hopLimit < kSparkHopLimit) {
     LOG(ERROR) << "Rejecting packet from " << clientAddr.getAddressStr()
-               << " due to hop limit being " << hopLimit;
+               << " due to hop limit being " << message.hopLimit;
     return false;
   }
 
-  auto res = findInterfaceFromIfindex(ifIndex);
+  auto res = findInterfaceFromIfindex(message.ifIndex);
   if (!res.hasValue()) {
-    LOG(ERROR) << "Received packet from " << clientAddr.getAddressStr()
-               << " on unknown interface with index " << ifIndex
-               << ". Ignoring the packet.";
+    // when sharded, likely an interface of another shard
+    LOG_IF(ERROR, !shardId_)
+        << "Received packet from " << clientAddr.getAddressStr()
+        << " on unknown interface with index " << message.ifIndex
+        << ". Ignoring the packet.";
+    helloPacketDroppedEarlyUnknownInterfaceStat_.addValue(1);
     return false;
   }
 
   ifName = res.value();
 
-  VLOG(4) << "Received message on " << ifName << " ifindex " << ifIndex
-          << " from " << clientAddr.getAddressStr();
+  VLOG(4) << "Received message on " << ifName << " ifindex "
+          << message.ifIndex << " from " << clientAddr.getAddressStr();
 
   // update counters for packets received, dropped and processed
-  tData_.addStatValue("spark.hello_packet_recv", 1, fbzmq::SUM);
+  helloPacketRecvStat_.addValue(1);
 
   // update counters for total size of packets received
-  tData_.addStatValue("spark.hello_packet_recv_size", bytesRead, fbzmq::SUM);
+  helloPacketRecvSizeStat_.addValue(bytesRead);
+
+  if (!preFilterPacket(message.data)) {
+    return false;
+  }
 
   if (!shouldProcessHelloPacket(ifName, clientAddr.getIPAddress())) {
     LOG(ERROR) << "Spark: dropping hello packet due to rate limiting on iface: "
                << ifName << " from addr: " << clientAddr.getAddressStr();
-    tData_.addStatValue("spark.hello_packet_dropped", 1, fbzmq::SUM);
+    helloPacketDroppedStat_.addValue(1);
     return false;
   }
 
-  tData_.addStatValue("spark.hello_packet_processed", 1, fbzmq::SUM);
+  helloPacketProcessedStat_.addValue(1);
 
-  if (bytesRead >= 0) {
-    VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
+  // NOTE: truncated messages are already dropped by IoProvider
+  VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
 
-    if (static_cast<size_t>(bytesRead) > kMinIpv6Mtu) {
-      LOG(ERROR) << "Message from " << clientAddr.getAddressStr()
-                 << " has been truncated";
-      return false;
-    }
-  } else {
-    LOG(ERROR) << "Failed reading from fd " << mcastFd_ << " error "
-               << folly::errnoStr(errno);
-    return false;
-  }
-
-  // Copy buffer into string object and parse it into helloPacket.
-  std::string readBuf(reinterpret_cast<const char*>(&buf[0]), bytesRead);
+  // parse the received buffer into helloPacket.
   try {
-    pkt =
-        util::readThriftObjStr<thrift::SparkHelloPacket>(readBuf, serializer_);
+    pkt = util::readThriftObjStr<thrift::SparkHelloPacket>(
+        message.data, serializer_);
   } catch (std::exception const& err) {
     LOG(ERROR) << "Failed parsing hello packet " << folly::exceptionStr(err);
     return false;
@@ -856,21 +1237,22 @@ Spark::validateV4AddressSubnet(
     toIPAddress(neighV4Addr);
   } catch (const folly::IPAddressFormatException& ex) {
     LOG(ERROR) << "Neighbor V4 address is not known";
-    tData_.addStatValue(
-        "spark.invalid_keepalive.missing_v4_addr", 1, fbzmq::SUM);
+    invalidKeepaliveMissingV4AddrStat_.addValue(1);
     return PacketValidationResult::FAILURE;
   }
 
-  // validate subnet of v4 address
-  auto const& neighCidrNetwork =
-      folly::sformat("{}/{}", toString(neighV4Addr), myV4PrefixLen);
-
-  if (!myV4Addr.inSubnet(neighCidrNetwork)) {
+  // validate subnet of v4 address, on the address bytes
+  auto const& neighBytes = neighV4Addr.addr;
+  if (neighBytes.size() != myV4Addr.byteCount() or
+      not isPrefixEqual(
+          reinterpret_cast<const uint8_t*>(neighBytes.data()),
+          myV4Addr.bytes(),
+          myV4Addr.byteCount(),
+          myV4PrefixLen)) {
     LOG(ERROR) << "Neighbor V4 address " << toString(neighV4Addr)
                << " is not in the same subnet with local V4 address "
                << myV4Addr.str() << "/" << +myV4PrefixLen;
-    tData_.addStatValue(
-        "spark.invalid_keepalive.different_subnet", 1, fbzmq::SUM);
+    invalidKeepaliveDifferentSubnetStat_.addValue(1);
     return PacketValidationResult::FAILURE;
   }
   return PacketValidationResult::SUCCESS;
@@ -882,7 +1264,7 @@ Spark::processRttChange(
     std::string const& neighborName,
     int64_t const newRtt) {
   // Neighbor must exist if this callback is fired
-  auto& spark2Neighbor = spark2Neighbors_.at(ifName).at(neighborName);
+  auto& spark2Neighbor = spark2Neighbors_.at(ifName, neighborName);
 
   // only report RTT change if the neighbor is adjacent
   if (spark2Neighbor.state != SparkNeighState::ESTABLISHED) {
@@ -915,7 +1297,11 @@ Spark::updateNeighborRtt(
     std::string const& neighborName,
     std::string const& remoteIfName,
     std::string const& ifName) {
-  VLOG(4) << "RTT timestamps in order: " << mySentTime.count() << ", "
+  // replace sentTime of my helloPkt with its kernel TX timestamp if known,
+  // so that time spent in Spark before the packet went out isn't counted
+  const auto mySentTxTime = getHelloTxTime(ifName, mySentTime);
+
+  VLOG(4) << "RTT timestamps in order: " << mySentTxTime.count() << ", "
           << nbrRecvTime.count() << ", " << nbrSentTime.count() << ", "
           << myRecvTime.count();
 
@@ -930,14 +1316,14 @@ Spark::updateNeighborRtt(
     return;
   }
 
-  if (myRecvTime < mySentTime) {
+  if (myRecvTime < mySentTxTime) {
     LOG(ERROR) << "Time anomaly. myRecvTime: [" << myRecvTime.count()
-               << "] < mySentTime: [" << mySentTime.count() << "]";
+               << "] < mySentTime: [" << mySentTxTime.count() << "]";
     return;
   }
 
   // Measure only if neighbor is reflecting our previous hello packet.
-  auto rtt = (myRecvTime - mySentTime) - (nbrSentTime - nbrRecvTime);
+  auto rtt = (myRecvTime - mySentTxTime) - (nbrSentTime - nbrRecvTime);
   VLOG(3) << "Measured new RTT for neighbor " << neighborName
           << " from remote iface " << remoteIfName << " over interface "
           << ifName << " as " << rtt.count() / 1000.0 << "ms.";
@@ -986,25 +1372,22 @@ Spark::updateNeighborRtt(
   }
 
   // for Spark2 stepDetector usage
-  if (spark2Neighbors_.find(ifName) != spark2Neighbors_.end()) {
-    auto& spark2IfNeighbors = spark2Neighbors_.at(ifName);
-    auto spark2NeighborIt = spark2IfNeighbors.find(neighborName);
-    if (spark2NeighborIt != spark2IfNeighbors.end()) {
-      auto& spark2Neighbor = spark2NeighborIt->second;
-
-      // Add it to step detector
-      spark2Neighbor.stepDetector.addValue(
-          std::chrono::duration_cast<std::chrono::milliseconds>(myRecvTime),
-          rtt.count());
-      // Set initial value if empty
-      if (!spark2Neighbor.rtt.count()) {
-        VLOG(2) << "Setting initial value for RTT for spark2Neighbor "
-                << neighborName;
-        spark2Neighbor.rtt = rtt;
-      }
-      // Update rttLatest
-      spark2Neighbor.rttLatest = rtt;
+  auto spark2NeighborPtr = spark2Neighbors_.find(ifName, neighborName);
+  if (spark2NeighborPtr) {
+    auto& spark2Neighbor = *spark2NeighborPtr;
+
+    // Add it to step detector
+    spark2Neighbor.stepDetector.addValue(
+        std::chrono::duration_cast<std::chrono::milliseconds>(myRecvTime),
+        rtt.count());
+    // Set initial value if empty
+    if (!spark2Neighbor.rtt.count()) {
+      VLOG(2) << "Setting initial value for RTT for spark2Neighbor "
+              << neighborName;
+      spark2Neighbor.rtt = rtt;
     }
+    // Update rttLatest
+    spark2Neighbor.rttLatest = rtt;
   }
 }
 
@@ -1019,26 +1402,9 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
   // down event has not arrived yet
   const auto& interfaceEntry = interfaceDb_.at(ifName);
   const auto ifIndex = interfaceEntry.ifIndex;
-  const auto v4Addr = interfaceEntry.v4Network.first;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
 
-  // build handshake msg
-  thrift::SparkHandshakeMsg handshakeMsg;
-  handshakeMsg.nodeName = myNodeName_;
-  handshakeMsg.isAdjEstablished = isAdjEstablished;
-  handshakeMsg.holdTime = myHeartbeatHoldTime_.count();
-  handshakeMsg.gracefulRestartTime = myHoldTime_.count();
-  handshakeMsg.transportAddressV6 = toBinaryAddress(v6Addr);
-  handshakeMsg.transportAddressV4 = toBinaryAddress(v4Addr);
-  // should be obtained from interface DB
-  handshakeMsg.area = openr::thrift::KvStore_constants::kDefaultArea();
-  handshakeMsg.openrCtrlThriftPort = kOpenrCtrlThriftPort_;
-  handshakeMsg.kvStoreCmdPort = kKvStoreCmdPort_;
-
-  thrift::SparkHelloPacket pkt;
-  pkt.handshakeMsg = handshakeMsg;
-
-  auto packet = util::writeThriftObjStr(pkt, serializer_);
+  auto const& packet = getHandshakePacket(ifName, isAdjEstablished);
 
   // send the pkt
   folly::SocketAddress dstAddr(
@@ -1051,6 +1417,9 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
 
   auto bytesSent = IoProvider::sendMessage(
       mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  if (bytesSent >= 0) {
+    recordSentPacket(folly::none);
+  }
 
   if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
     VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
@@ -1059,8 +1428,8 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
   }
 
   // update counters for number of pkts and total size of pkts sent
-  tData_.addStatValue("spark.handshake.bytes_sent", packet.size(), fbzmq::SUM);
-  tData_.addStatValue("spark.handshake.packets_sent", 1, fbzmq::SUM);
+  handshakeBytesSentStat_.addValue(packet.size());
+  handshakePacketsSentStat_.addValue(1);
 }
 
 void
@@ -1088,15 +1457,7 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
   const auto ifIndex = interfaceEntry.ifIndex;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
 
-  // build heartbeat msg
-  thrift::SparkHeartbeatMsg heartbeatMsg;
-  heartbeatMsg.nodeName = myNodeName_;
-  heartbeatMsg.seqNum = mySeqNum_;
-
-  thrift::SparkHelloPacket pkt;
-  pkt.heartbeatMsg = heartbeatMsg;
-
-  auto packet = util::writeThriftObjStr(pkt, serializer_);
+  auto packet = buildHeartbeatPacket(mySeqNum_);
 
   // send the pkt
   folly::SocketAddress dstAddr(
@@ -1109,6 +1470,9 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
 
   auto bytesSent = IoProvider::sendMessage(
       mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  if (bytesSent >= 0) {
+    recordSentPacket(folly::none);
+  }
 
   if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
     VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
@@ -1117,8 +1481,72 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
   }
 
   // update counters for number of pkts and total size of pkts sent
-  tData_.addStatValue("spark.heartbeat.bytes_sent", packet.size(), fbzmq::SUM);
-  tData_.addStatValue("spark.heartbeat.packets_sent", 1, fbzmq::SUM);
+  heartbeatBytesSentStat_.addValue(packet.size());
+  heartbeatPacketsSentStat_.addValue(1);
+}
+
+std::string const&
+Spark::getHandshakePacket(std::string const& ifName, bool isAdjEstablished) {
+  auto& packet = handshakePackets_[ifName][isAdjEstablished ? 1 : 0];
+  if (not packet.empty()) {
+    return packet;
+  }
+
+  const auto& interfaceEntry = interfaceDb_.at(ifName);
+  const auto v4Addr = interfaceEntry.v4Network.first;
+  const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
+
+  // build handshake msg
+  thrift::SparkHandshakeMsg handshakeMsg;
+  handshakeMsg.nodeName = myNodeName_;
+  handshakeMsg.isAdjEstablished = isAdjEstablished;
+  handshakeMsg.holdTime = myHeartbeatHoldTime_.count();
+  handshakeMsg.gracefulRestartTime = myHoldTime_.count();
+  handshakeMsg.transportAddressV6 = toBinaryAddress(v6Addr);
+  handshakeMsg.transportAddressV4 = toBinaryAddress(v4Addr);
+  // should be obtained from interface DB
+  handshakeMsg.area = openr::thrift::KvStore_constants::kDefaultArea();
+  handshakeMsg.openrCtrlThriftPort = kOpenrCtrlThriftPort_;
+  handshakeMsg.kvStoreCmdPort = kKvStoreCmdPort_;
+
+  thrift::SparkHelloPacket pkt;
+  pkt.handshakeMsg = handshakeMsg;
+
+  packet = util::writeThriftObjStr(pkt, serializer_);
+  return packet;
+}
+
+std::string
+Spark::buildHeartbeatPacket(uint64_t seqNum) {
+  if (not heartbeatTemplate_.hasValue()) {
+    // serialize heartbeat msg with a placeholder seqNum and split the packet
+    // around it
+    thrift::SparkHeartbeatMsg heartbeatMsg;
+    heartbeatMsg.nodeName = myNodeName_;
+    heartbeatMsg.seqNum = kHeartbeatTemplateSeqNum;
+
+    thrift::SparkHelloPacket pkt;
+    pkt.heartbeatMsg = heartbeatMsg;
+
+    auto packet = util::writeThriftObjStr(pkt, serializer_);
+    std::string seqNumBytes;
+    appendCompactI64(seqNumBytes, kHeartbeatTemplateSeqNum);
+    const auto pos = packet.find(seqNumBytes);
+    CHECK(pos != std::string::npos) << "seqNum not found in heartbeat packet";
+    CHECK(packet.find(seqNumBytes, pos + 1) == std::string::npos)
+        << "Ambiguous seqNum in heartbeat packet";
+    heartbeatTemplate_ = std::make_pair(
+        packet.substr(0, pos), packet.substr(pos + seqNumBytes.size()));
+  }
+
+  auto const& prefix = heartbeatTemplate_->first;
+  auto const& suffix = heartbeatTemplate_->second;
+  std::string packet;
+  packet.reserve(prefix.size() + kMaxVarintSize + suffix.size());
+  packet.append(prefix);
+  appendCompactI64(packet, static_cast<int64_t>(seqNum));
+  packet.append(suffix);
+  return packet;
 }
 
 void
@@ -1131,6 +1559,45 @@ Spark::logStateTransition(
                << "] -> [" << sparkNeighborStateToStr(newState) << "] "
                << "for neighbor: (" << neighborName << ") on interface: ("
                << ifName << ").";
+
+  // interface is no longer stable, if it ever was
+  resetHelloBackoff(ifName);
+}
+
+bool
+Spark::isInterfaceStable(std::string const& ifName) const {
+  // old Spark neighbors are kept alive by hellos
+  auto oldNeighborsIt = neighbors_.find(ifName);
+  if (oldNeighborsIt != neighbors_.end() and
+      not oldNeighborsIt->second.empty()) {
+    return false;
+  }
+
+  if (spark2Neighbors_.getNumNeighbors(ifName) == 0) {
+    return false;
+  }
+  bool stable{true};
+  spark2Neighbors_.forEachNeighbor(
+      ifName, [&stable](std::string const&, Spark2Neighbor const& neighbor) {
+        stable = stable and neighbor.state == SparkNeighState::ESTABLISHED;
+      });
+  return stable;
+}
+
+void
+Spark::resetHelloBackoff(std::string const& ifName) {
+  auto it = ifNameToHelloBackoff_.find(ifName);
+  if (it == ifNameToHelloBackoff_.end() or
+      it->second.getCurrentBackoff() == std::chrono::milliseconds(0)) {
+    return;
+  }
+
+  VLOG(2) << "Resetting hello interval backoff on interface " << ifName;
+  it->second.reportSuccess();
+  tData_.addStatValue("spark.hello_backoff_reset", 1, fbzmq::SUM);
+
+  // next hello might be far out, announce the change shortly
+  ifNameToHelloTimers_.at(ifName)->scheduleTimeout(myHelloFastInitTime_);
 }
 
 void
@@ -1150,20 +1617,18 @@ Spark::getSparkNeighState(
 
   runInEventBaseThread(
       [this, promise = std::move(promise), &ifName, &neighborName]() mutable {
-        if (spark2Neighbors_.find(ifName) == spark2Neighbors_.end()) {
+        if (not spark2Neighbors_.hasInterface(ifName)) {
           LOG(ERROR) << "No interface: " << ifName
                      << " in spark2Neighbor collection";
           promise.setValue(folly::none);
         } else {
-          auto& ifNeighbors = spark2Neighbors_.at(ifName);
-          auto neighborIt = ifNeighbors.find(neighborName);
-          if (neighborIt == ifNeighbors.end()) {
+          auto neighbor = spark2Neighbors_.find(ifName, neighborName);
+          if (not neighbor) {
             LOG(ERROR) << "No neighborName: " << neighborName
                        << " in spark2Neighbor colelction";
             promise.setValue(folly::none);
           } else {
-            auto& neighbor = neighborIt->second;
-            promise.setValue(neighbor.state);
+            promise.setValue(neighbor->state);
           }
         }
       });
@@ -1175,9 +1640,18 @@ Spark::getCounters() {
   folly::Promise<std::unordered_map<std::string, int64_t>> promise;
   auto future = promise.getFuture();
   runInEventBaseThread([this, promise = std::move(promise)]() mutable {
-    promise.setValue(tData_.getCounters());
+    auto counters = tData_.getCounters();
+    for (auto const& kv : stats_.getCounters()) {
+      counters[kv.first] = kv.second;
+    }
+    promise.setValue(std::move(counters));
   });
-  return std::move(future).get();
+  auto counters = std::move(future).get();
+  if (fastDetector_ and fastDetector_->isRunning()) {
+    auto fastDetectorCounters = fastDetector_->getCounters();
+    counters.insert(fastDetectorCounters.begin(), fastDetectorCounters.end());
+  }
+  return counters;
 }
 
 void
@@ -1192,12 +1666,23 @@ Spark::neighborUpWrapper(
   neighbor.negotiateHoldTimer.reset();
 
   // create heartbeat hold timer when promote to "ESTABLISHED"
-  neighbor.heartbeatHoldTimer = fbzmq::ZmqTimeout::make(
-      getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.heartbeatHoldTimer =
+      timerWheel_->makeTimer([this, ifName, neighborName]() noexcept {
         processHeartbeatTimeout(ifName, neighborName);
       });
   neighbor.heartbeatHoldTimer->scheduleTimeout(neighbor.heartbeatHoldTime);
 
+  // start fast failure detection, if enabled on ifName
+  if (fastDetector_) {
+    auto const& interfaceEntry = interfaceDb_.at(ifName);
+    fastDetector_->addNeighbor(
+        ifName,
+        interfaceEntry.ifIndex,
+        neighborName,
+        interfaceEntry.v6LinkLocalNetwork.first.asV6(),
+        toIPAddress(neighbor.transportAddressV6).asV6());
+  }
+
   // add neighborName to collection
   ifNameToActiveNeighbors_[ifName].emplace(neighborName);
 
@@ -1242,6 +1727,10 @@ Spark::neighborDownWrapper(
     Spark2Neighbor const& neighbor,
     std::string const& ifName,
     std::string const& neighborName) {
+  if (fastDetector_) {
+    fastDetector_->removeNeighbor(ifName, neighborName);
+  }
+
   // notify LinkMonitor about neighbor DOWN state
   notifySparkNeighborEvent(
       thrift::SparkNeighborEventType::NEIGHBOR_DOWN,
@@ -1288,13 +1777,12 @@ void
 Spark::processHeartbeatTimeout(
     std::string const& ifName, std::string const& neighborName) {
   // spark2 neighbor must exist
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-  auto& neighbor = ifNeighbors.at(neighborName);
+  auto& neighbor = spark2Neighbors_.at(ifName, neighborName);
 
   // remove from tracked neighbor at the end
   SCOPE_EXIT {
     allocatedLabels_.erase(neighbor.label);
-    ifNeighbors.erase(neighborName);
+    spark2Neighbors_.erase(ifName, neighborName);
   };
 
   LOG(INFO) << "Heartbeat timer expired for: " << neighborName
@@ -1313,11 +1801,28 @@ Spark::processHeartbeatTimeout(
   neighborDownWrapper(neighbor, ifName, neighborName);
 }
 
+void
+Spark::processFastDetectionTimeout(
+    std::string const& ifName, std::string const& neighborName) {
+  // neighbor might be gone or restarting by the time we get here
+  auto neighbor = spark2Neighbors_.find(ifName, neighborName);
+  if (not neighbor or neighbor->state != SparkNeighState::ESTABLISHED) {
+    return;
+  }
+
+  LOG(INFO) << "Fast failure detection declared " << neighborName
+            << " on interface " << ifName << " down";
+  tData_.addStatValue("spark.fast_detection_neighbor_down", 1, fbzmq::SUM);
+
+  // same as missing heartbeats, only sooner
+  processHeartbeatTimeout(ifName, neighborName);
+}
+
 void
 Spark::processNegotiateTimeout(
     std::string const& ifName, std::string const& neighborName) {
   // spark2 neighbor must exist if the negotiate hold-time expired
-  auto& neighbor = spark2Neighbors_.at(ifName).at(neighborName);
+  auto& neighbor = spark2Neighbors_.at(ifName, neighborName);
 
   LOG(INFO) << "Negotiate timer expired for: " << neighborName
             << " on interface " << ifName;
@@ -1340,13 +1845,12 @@ Spark::processGRTimeout(
     std::string const& ifName, std::string const& neighborName) {
   // spark2 neighbor must exist if the negotiate hold-timer call back gets
   // called.
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-  auto& neighbor = ifNeighbors.at(neighborName);
+  auto& neighbor = spark2Neighbors_.at(ifName, neighborName);
 
   // remove from tracked neighbor at the end
   SCOPE_EXIT {
     allocatedLabels_.erase(neighbor.label);
-    ifNeighbors.erase(neighborName);
+    spark2Neighbors_.erase(ifName, neighborName);
   };
 
   LOG(INFO) << "Graceful restart timer expired for: " << neighborName
@@ -1364,6 +1868,33 @@ Spark::processGRTimeout(
   neighborDownWrapper(neighbor, ifName, neighborName);
 }
 
+void
+Spark::startNegotiate(
+    Spark2Neighbor& neighbor,
+    std::string const& ifName,
+    std::string const& neighborName) {
+  // Starts timer to periodically send hankshake msg
+  neighbor.negotiateTimer = timerWheel_->makeTimer([this, ifName]() noexcept {
+    // periodically send out handshake msg
+    sendHandshakeMsg(ifName, false);
+  });
+  const bool isPeriodic = true; /* flag indicating periodic pkt sent-out*/
+  neighbor.negotiateTimer->scheduleTimeout(myHandshakeTime_, isPeriodic);
+
+  // Starts negotiate hold-timer
+  neighbor.negotiateHoldTimer =
+      timerWheel_->makeTimer([this, ifName, neighborName]() noexcept {
+        // prevent to stucking in NEGOTIATE forever
+        processNegotiateTimeout(ifName, neighborName);
+      });
+  neighbor.negotiateHoldTimer->scheduleTimeout(myNegotiateHoldTime_);
+
+  // Promote to NEGOTIATE state
+  SparkNeighState oldState = neighbor.state;
+  neighbor.state = getNextState(oldState, SparkNeighEvent::HELLO_RCVD_INFO);
+  logStateTransition(neighborName, ifName, oldState, neighbor.state);
+}
+
 void
 Spark::processGRMsg(
     std::string const& neighborName,
@@ -1380,8 +1911,8 @@ Spark::processGRMsg(
       neighbor.area);
 
   // start graceful-restart timer
-  neighbor.gracefulRestartHoldTimer = fbzmq::ZmqTimeout::make(
-      getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.gracefulRestartHoldTimer =
+      timerWheel_->makeTimer([this, ifName, neighborName]() noexcept {
         // change the state back to IDLE
         processGRTimeout(ifName, neighborName);
       });
@@ -1395,6 +1926,11 @@ Spark::processGRMsg(
 
   // neihbor is restarting, shutdown heartbeat hold timer
   neighbor.heartbeatHoldTimer.reset();
+
+  // neighbor is expected to go silent, stop fast failure detection as well
+  if (fastDetector_) {
+    fastDetector_->removeNeighbor(ifName, neighborName);
+  }
 }
 
 void
@@ -1423,39 +1959,40 @@ Spark::processHelloMsg(
   }
 
   // interface name check
-  if (spark2Neighbors_.find(ifName) == spark2Neighbors_.end()) {
+  if (not spark2Neighbors_.hasInterface(ifName)) {
     LOG(ERROR) << "Ignoring packet received from: " << neighborName
                << " on unknown interface: " << ifName;
     return;
   }
 
-  // get (neighborName -> Spark2Neighbor) mapping per ifName
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-
   // check if we have already track this neighbor
-  auto neighborIt = ifNeighbors.find(neighborName);
+  auto neighborPtr = spark2Neighbors_.find(ifName, neighborName);
+
+  // neighbor we had adjacency with before restart, on the same link
+  folly::Optional<thrift::SparkCachedNeighbor> cachedNeighbor;
+
+  if (not neighborPtr) {
+    cachedNeighbor = takeCachedNeighbor(ifName, neighborName, remoteIfName);
 
-  if (neighborIt == ifNeighbors.end()) {
     // Report RTT change
     // capture ifName & originator by copy
     auto rttChangeCb = [this, ifName, neighborName](const int64_t& newRtt) {
       processRttChange(ifName, neighborName, newRtt);
     };
 
-    ifNeighbors.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(neighborName),
-        std::forward_as_tuple(
-            domainName, /* neighborNode domain */
-            neighborName, /* neighborNode name */
-            remoteIfName, /* remote interface on neighborNode */
-            getNewLabelForIface(ifName), /* label for Segment Routing */
-            remoteSeqNum, /* seqNum reported by neighborNode */
-            myKeepAliveTime_,
-            std::move(rttChangeCb),
-            std::string{} /* empty area, handshake msg will fill it */));
-
-    auto& neighbor = ifNeighbors.at(neighborName);
+    neighborPtr = &spark2Neighbors_.emplace(
+        ifName,
+        neighborName,
+        domainName, /* neighborNode domain */
+        neighborName, /* neighborNode name */
+        remoteIfName, /* remote interface on neighborNode */
+        getLabelForNeighbor(ifName, cachedNeighbor), /* SR label */
+        remoteSeqNum, /* seqNum reported by neighborNode */
+        myKeepAliveTime_,
+        std::move(rttChangeCb),
+        std::string{} /* empty area, handshake msg will fill it */);
+
+    auto& neighbor = *neighborPtr;
     checkNeighborState(neighbor, SparkNeighState::IDLE);
 
     // backward compatibility check
@@ -1478,7 +2015,7 @@ Spark::processHelloMsg(
   }
 
   // Up till now, node knows about this neighbor and perform SM check
-  auto& neighbor = ifNeighbors.at(neighborName);
+  auto& neighbor = *neighborPtr;
 
   // Update timestamps for received hello packet for neighbor
   neighbor.neighborTimestamp = nbrSentTimeInUs;
@@ -1519,6 +2056,21 @@ Spark::processHelloMsg(
     neighbor.state =
         getNextState(oldState, SparkNeighEvent::HELLO_RCVD_NO_INFO);
     logStateTransition(neighborName, ifName, oldState, neighbor.state);
+
+    //
+    // We restarted and neighbor still holds adjacency with us under its
+    // graceful restart. Negotiate right away instead of waiting for it to
+    // catch up with our Seq#, so that adjacency is back in one handshake.
+    //
+    if (cachedNeighbor and tsIt != neighborInfos.end() and
+        (not areas_ or areas_->count(cachedNeighbor->area))) {
+      LOG(INFO) << "Neighbor: (" << neighborName << ") on interface "
+                << ifName << " had adjacency with us before restart. "
+                << "Sending handshakeMsg immediately.";
+      tData_.addStatValue("spark.neighbor_cache_hit", 1, fbzmq::SUM);
+      startNegotiate(neighbor, ifName, neighborName);
+      sendHandshakeMsg(ifName, false);
+    }
   } else if (neighbor.state == SparkNeighState::WARM) {
     // Update local seqNum maintained for this neighbor
     neighbor.seqNum = remoteSeqNum;
@@ -1539,28 +2091,8 @@ Spark::processHelloMsg(
                 << neighborName << "). Seen Seq# from neighbor: ("
                 << myRemoteSeqNum << "), my Seq#: (" << mySeqNum_ << ").";
       } else {
-        // Starts timer to periodically send hankshake msg
-        neighbor.negotiateTimer =
-            fbzmq::ZmqTimeout::make(getEvb(), [this, ifName]() noexcept {
-              // periodically send out handshake msg
-              sendHandshakeMsg(ifName, false);
-            });
-        const bool isPeriodic = true; /* flag indicating periodic pkt sent-out*/
-        neighbor.negotiateTimer->scheduleTimeout(myHandshakeTime_, isPeriodic);
-
-        // Starts negotiate hold-timer
-        neighbor.negotiateHoldTimer = fbzmq::ZmqTimeout::make(
-            getEvb(), [this, ifName, neighborName]() noexcept {
-              // prevent to stucking in NEGOTIATE forever
-              processNegotiateTimeout(ifName, neighborName);
-            });
-        neighbor.negotiateHoldTimer->scheduleTimeout(myNegotiateHoldTime_);
-
-        // Neighbor is aware of us. Promote to NEGOTIATE state
-        SparkNeighState oldState = neighbor.state;
-        neighbor.state =
-            getNextState(oldState, SparkNeighEvent::HELLO_RCVD_INFO);
-        logStateTransition(neighborName, ifName, oldState, neighbor.state);
+        // Neighbor is aware of us
+        startNegotiate(neighbor, ifName, neighborName);
       }
     }
   } else if (neighbor.state == SparkNeighState::ESTABLISHED) {
@@ -1591,7 +2123,7 @@ Spark::processHelloMsg(
 
       // remove from tracked neighbor at the end
       allocatedLabels_.erase(neighbor.label);
-      ifNeighbors.erase(neighborName);
+      spark2Neighbors_.erase(ifName, neighborName);
     }
   } else if (neighbor.state == SparkNeighState::RESTART) {
     // Neighbor is undergoing restart. Will reply immediately for hello msg for
@@ -1622,8 +2154,8 @@ Spark::processHelloMsg(
             neighbor.area);
 
         // start heartbeat timer again to make sure neighbor is alive
-        neighbor.heartbeatHoldTimer = fbzmq::ZmqTimeout::make(
-            getEvb(), [this, ifName, neighborName]() noexcept {
+        neighbor.heartbeatHoldTimer =
+            timerWheel_->makeTimer([this, ifName, neighborName]() noexcept {
               processHeartbeatTimeout(ifName, neighborName);
             });
         neighbor.heartbeatHoldTimer->scheduleTimeout(
@@ -1645,20 +2177,19 @@ void
 Spark::processHandshakeMsg(
     thrift::SparkHandshakeMsg const& handshakeMsg, std::string const& ifName) {
   auto const& neighborName = handshakeMsg.nodeName;
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-  auto neighborIt = ifNeighbors.find(neighborName);
+  auto neighborPtr = spark2Neighbors_.find(ifName, neighborName);
 
   // under quick flapping of Openr, msg can come out-of-order.
   // handshakeMsg will ONLY be processed when:
   //  1). neighbor is tracked on ifName;
   //  2). neighbor is under NEGOTIATE stage;
-  if (neighborIt == ifNeighbors.end()) {
+  if (not neighborPtr) {
     VLOG(3) << "Neighbor: (" << neighborName
             << "). is NOT found. Ignore handshakeMsg.";
     return;
   }
 
-  auto& neighbor = neighborIt->second;
+  auto& neighbor = *neighborPtr;
 
   // for quick convergence purpose, reply immediately if neighbor
   // hasn't form adjacency with us yet
@@ -1736,19 +2267,18 @@ void
 Spark::processHeartbeatMsg(
     thrift::SparkHeartbeatMsg const& heartbeatMsg, std::string const& ifName) {
   auto const& neighborName = heartbeatMsg.nodeName;
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-  auto neighborIt = ifNeighbors.find(neighborName);
+  auto neighborPtr = spark2Neighbors_.find(ifName, neighborName);
 
   // under GR case, when node restarts, it will needs several helloMsg to
   // establish neighborship. During this time, heartbeatMsg from peer
   // will NOT be processed.
-  if (neighborIt == ifNeighbors.end()) {
+  if (not neighborPtr) {
     VLOG(3) << "I am NOT aware of neighbor: (" << neighborName
             << "). Ignore it.";
     return;
   }
 
-  auto& neighbor = neighborIt->second;
+  auto& neighbor = *neighborPtr;
 
   // In case receiving heartbeat msg when it is NOT in established state,
   // Just ignore it.
@@ -1764,13 +2294,36 @@ Spark::processHeartbeatMsg(
 }
 
 void
-Spark::processHelloPacket() {
-  // Step 1: receive and parse pkt
+Spark::processHelloPackets() {
+  // TX timestamps on the error queue wake us up as well, read them first
+  if (enableTxTimestamps_) {
+    processTxTimestamps();
+  }
+
+  // Receive a batch of pending packets with a single syscall. Remaining ones
+  // are read on next poll, so that a burst of packets doesn't hold timers
+  auto messages = IoProvider::recvMessages(
+      mcastFd_, kSparkRecvBatchSize, kMinIpv6Mtu, ioProvider_.get());
+  helloPacketRecvBatchesStat_.addValue(1);
+
+  for (auto const& message : messages) {
+    try {
+      processHelloPacket(message);
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Spark: error processing hello packet "
+                 << folly::exceptionStr(err);
+    }
+  }
+}
+
+void
+Spark::processHelloPacket(IoProvider::ReceivedMessage const& message) {
+  // Step 1: parse pkt
   thrift::SparkHelloPacket helloPacket;
   std::string ifName;
-  std::chrono::microseconds myRecvTime;
+  const auto myRecvTime = message.recvTs;
 
-  if (!parsePacket(helloPacket, ifName, myRecvTime)) {
+  if (!parsePacket(message, helloPacket, ifName)) {
     return;
   }
 
@@ -1986,25 +2539,175 @@ Spark::processHelloPacket() {
   }
 }
 
+void
+Spark::recordSentPacket(
+    folly::Optional<std::pair<std::string, std::chrono::microseconds>>
+        helloSent) {
+  if (not enableTxTimestamps_) {
+    return;
+  }
+
+  // kernel assigns keys to every packet sent on the socket, only keep track
+  // of the ones of hello packets
+  const auto key = nextTxTimestampKey_++;
+  if (not helloSent.hasValue()) {
+    return;
+  }
+  pendingTxTimestamps_.emplace(key, std::move(helloSent).value());
+
+  // forget about packets timestamps of which never made it back
+  while (pendingTxTimestamps_.size() > kMaxPendingTxTimestamps) {
+    pendingTxTimestamps_.erase(pendingTxTimestamps_.begin());
+    tData_.addStatValue("spark.tx_timestamp.missed", 1, fbzmq::SUM);
+  }
+}
+
+void
+Spark::processTxTimestamps() {
+  for (auto const& timestamp :
+       IoProvider::recvTxTimestamps(mcastFd_, ioProvider_.get())) {
+    auto it = pendingTxTimestamps_.find(timestamp.key);
+    if (it == pendingTxTimestamps_.end()) {
+      continue; // not a hello packet
+    }
+    auto const& ifName = it->second.first;
+    auto const& sentTs = it->second.second;
+
+    // kernel timestamp must be taken shortly after packet got handed over,
+    // otherwise keys went out of sync with the packets we sent
+    if (timestamp.txTs >= sentTs and
+        timestamp.txTs - sentTs <= kMaxTxTimestampDelay) {
+      VLOG(4) << "Got kernel TX timestamp. It took "
+              << (timestamp.txTs - sentTs).count()
+              << " us for the hello packet on " << ifName
+              << " to get from user space to kernel";
+      auto& txTimestamps = helloTxTimestamps_[ifName];
+      txTimestamps[sentTs] = timestamp.txTs;
+      while (txTimestamps.size() > kMaxHelloTxTimestamps) {
+        txTimestamps.erase(txTimestamps.begin());
+      }
+      tData_.addStatValue("spark.tx_timestamp.received", 1, fbzmq::SUM);
+    } else {
+      LOG(ERROR) << "Time anomaly. TX timestamp: [" << timestamp.txTs.count()
+                 << "] too far from sent timestamp: [" << sentTs.count()
+                 << "] of hello packet on " << ifName;
+      tData_.addStatValue("spark.tx_timestamp.invalid", 1, fbzmq::SUM);
+    }
+    pendingTxTimestamps_.erase(it);
+  }
+}
+
+std::chrono::microseconds
+Spark::getHelloTxTime(
+    std::string const& ifName, std::chrono::microseconds const& sentTs) const {
+  auto ifIt = helloTxTimestamps_.find(ifName);
+  if (ifIt == helloTxTimestamps_.end()) {
+    return sentTs;
+  }
+  return folly::get_default(ifIt->second, sentTs, sentTs);
+}
+
 void
 Spark::sendHelloPacket(
     std::string const& ifName, bool inFastInitState, bool restarting) {
   VLOG(3) << "Send hello packet called for " << ifName;
 
+  SCOPE_FAIL {
+    LOG(ERROR) << "Failed sending Hello packet on " << ifName;
+  };
+
+  std::chrono::microseconds sentTs{0};
+  auto message =
+      buildHelloPacket(ifName, inFastInitState, restarting, sentTs);
+  if (not message.hasValue()) {
+    return;
+  }
+
+  auto bytesSent = IoProvider::sendMessage(
+      mcastFd_,
+      message->ifIndex,
+      message->srcAddr,
+      message->dstAddr,
+      message->packet,
+      ioProvider_.get());
+  updateHelloPacketSent(ifName, *message, bytesSent, sentTs);
+}
+
+void
+Spark::sendHelloPackets(
+    std::vector<std::string> const& ifNames, bool restarting) {
+  std::vector<std::string> sentIfNames;
+  std::vector<std::chrono::microseconds> sentTimestamps;
+  std::vector<IoProvider::OutgoingMessage> messages;
+  sentIfNames.reserve(ifNames.size());
+  sentTimestamps.reserve(ifNames.size());
+  messages.reserve(ifNames.size());
+
+  for (auto const& ifName : ifNames) {
+    try {
+      std::chrono::microseconds sentTs{0};
+      auto message = buildHelloPacket(
+          ifName, false /* inFastInitState */, restarting, sentTs);
+      if (message.hasValue()) {
+        sentIfNames.emplace_back(ifName);
+        sentTimestamps.emplace_back(sentTs);
+        messages.emplace_back(std::move(message).value());
+      }
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Failed sending Hello packet on " << ifName << ": "
+                 << folly::exceptionStr(err);
+    }
+  }
+
+  // send out all packets with as few syscalls as possible
+  auto bytesSent =
+      IoProvider::sendMessages(mcastFd_, messages, ioProvider_.get());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    updateHelloPacketSent(
+        sentIfNames[i], messages[i], bytesSent[i], sentTimestamps[i]);
+  }
+}
+
+void
+Spark::updateHelloPacketSent(
+    std::string const& ifName,
+    IoProvider::OutgoingMessage const& message,
+    ssize_t bytesSent,
+    std::chrono::microseconds sentTs) {
+  auto const& packet = message.packet;
+  if (bytesSent >= 0) {
+    recordSentPacket(std::make_pair(ifName, sentTs));
+  }
+  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
+    VLOG(1) << "Sending multicast to " << message.dstAddr.getAddressStr()
+            << " on " << ifName << " failed due to error "
+            << folly::errnoStr(errno);
+    return;
+  }
+
+  // update counters for number of pkts and total size of pkts sent
+  helloBytesSentStat_.addValue(packet.size());
+  helloPacketsSentStat_.addValue(1);
+
+  VLOG(4) << "Sent " << bytesSent << " bytes in hello packet";
+}
+
+folly::Optional<IoProvider::OutgoingMessage>
+Spark::buildHelloPacket(
+    std::string const& ifName,
+    bool inFastInitState,
+    bool restarting,
+    std::chrono::microseconds& sentTs) {
   if (interfaceDb_.count(ifName) == 0) {
     LOG(ERROR) << "Interface " << ifName << " is no longer being tracked";
-    return;
+    return folly::none;
   }
 
   SCOPE_EXIT {
-    // increment seq# after packet has been sent (even if it didnt go out)
+    // increment seq# after packet has been built (even if it didnt go out)
     ++mySeqNum_;
   };
 
-  SCOPE_FAIL {
-    LOG(ERROR) << "Failed sending Hello packet on " << ifName;
-  };
-
   // in some cases, getting link-local address may fail and throw
   // e.g. when iface has not yet auto-configured it, or iface is removed but
   // down event has not arrived yet
@@ -2014,6 +2717,7 @@ Spark::sendHelloPacket(
   const auto v4Addr = interfaceEntry.v4Network.first;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
   thrift::OpenrVersion openrVer(kVersion_.version);
+  sentTs = getCurrentTimeInUs();
 
   // build the hello packet from payload and empty signature
   thrift::SparkHelloPacket helloPacket;
@@ -2029,18 +2733,19 @@ Spark::sendHelloPacket(
     helloMsg.version = openrVer;
     helloMsg.solicitResponse = inFastInitState;
     helloMsg.restarting = restarting;
-    helloMsg.sentTsInUs = getCurrentTimeInUs().count();
+    helloMsg.sentTsInUs = sentTs.count();
 
     // bake neighborInfo into helloMsg
-    for (const auto& kv : spark2Neighbors_.at(ifName)) {
-      auto const& neighborName = kv.first;
-      auto const& neighbor = kv.second;
-
-      auto& neighborInfo = helloMsg.neighborInfos[neighborName];
-      neighborInfo.seqNum = neighbor.seqNum;
-      neighborInfo.lastNbrMsgSentTsInUs = neighbor.neighborTimestamp.count();
-      neighborInfo.lastMyMsgRcvdTsInUs = neighbor.localTimestamp.count();
-    }
+    spark2Neighbors_.forEachNeighbor(
+        ifName,
+        [&helloMsg](
+            std::string const& neighborName, Spark2Neighbor const& neighbor) {
+          auto& neighborInfo = helloMsg.neighborInfos[neighborName];
+          neighborInfo.seqNum = neighbor.seqNum;
+          neighborInfo.lastNbrMsgSentTsInUs =
+              neighbor.neighborTimestamp.count();
+          neighborInfo.lastMyMsgRcvdTsInUs = neighbor.localTimestamp.count();
+        });
 
     // fill in helloMsg field
     helloPacket.helloMsg = helloMsg;
@@ -2063,7 +2768,7 @@ Spark::sendHelloPacket(
       myself,
       mySeqNum_,
       std::map<std::string, thrift::ReflectedNeighborInfo>{},
-      getCurrentTimeInUs().count(),
+      sentTs.count(),
       inFastInitState,
       enableFloodOptimization_,
       restarting,
@@ -2094,27 +2799,19 @@ Spark::sendHelloPacket(
 
   if (kMinIpv6Mtu < packet.size()) {
     LOG(ERROR) << "Hello packet is too big, cannot sent!";
-    return;
+    return folly::none;
   }
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
-
-  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
-    VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
-            << ifName << " failed due to error " << folly::errnoStr(errno);
-    return;
-  }
-
-  // update counters for number of pkts and total size of pkts sent
-  tData_.addStatValue("spark.hello.bytes_sent", packet.size(), fbzmq::SUM);
-  tData_.addStatValue("spark.hello.packets_sent", 1, fbzmq::SUM);
-
-  VLOG(4) << "Sent " << bytesSent << " bytes in hello packet";
+  IoProvider::OutgoingMessage message;
+  message.ifIndex = ifIndex;
+  message.srcAddr = v6Addr.asV6();
+  message.dstAddr = std::move(dstAddr);
+  message.packet = std::move(packet);
+  return message;
 }
 
 void
-Spark::processInterfaceUpdates(thrift::InterfaceDatabase&& ifDb) {
+Spark::processInterfaceUpdates(thrift::InterfaceDatabase const& ifDb) {
   decltype(interfaceDb_) newInterfaceDb{};
 
   CHECK_EQ(ifDb.thisNodeName, myNodeName_)
@@ -2170,16 +2867,50 @@ Spark::processInterfaceUpdates(thrift::InterfaceDatabase&& ifDb) {
         ifName, Interface(ifIndex, v4Network, v6LinkLocalNetwork));
   }
 
+  std::set<std::string> toAdd;
+  std::set<std::string> toDel;
+  std::set<std::string> toUpdate;
+
+  if (ifDb.isDelta) {
+    // Only interfaces in the update are touched
+    if (ifDb.seqNum != interfaceDbSeqNum_ + 1) {
+      LOG(WARNING) << "Interface update " << ifDb.seqNum << " doesn't follow "
+                   << interfaceDbSeqNum_ << ", applying it regardless";
+      tData_.addStatValue("spark.interface_db.seq_gap", 1, fbzmq::SUM);
+    }
+    interfaceDbSeqNum_ = ifDb.seqNum;
+
+    for (const auto& ifName : ifDb.deletedInterfaces) {
+      if (interfaceDb_.count(ifName)) {
+        toDel.emplace(ifName);
+      }
+    }
+    for (const auto& kv : ifDb.interfaces) {
+      const auto& ifName = kv.first;
+      const bool isValid = newInterfaceDb.count(ifName) != 0;
+      const bool exists = interfaceDb_.count(ifName) != 0;
+      if (isValid and exists) {
+        toUpdate.emplace(ifName);
+      } else if (isValid) {
+        toAdd.emplace(ifName);
+      } else if (exists) {
+        toDel.emplace(ifName);
+      }
+    }
+
+    deleteInterfaceFromDb(toDel);
+    addInterfaceToDb(toAdd, newInterfaceDb);
+    updateInterfaceInDb(toUpdate, newInterfaceDb);
+    return;
+  }
+  interfaceDbSeqNum_ = ifDb.seqNum;
+
   auto newIfaces = folly::gen::from(newInterfaceDb) | folly::gen::get<0>() |
       folly::gen::as<std::set<std::string>>();
 
   auto existingIfaces = folly::gen::from(interfaceDb_) | folly::gen::get<0>() |
       folly::gen::as<std::set<std::string>>();
 
-  std::set<std::string> toAdd;
-  std::set<std::string> toDel;
-  std::set<std::string> toUpdate;
-
   std::set_difference(
       newIfaces.begin(),
       newIfaces.end(),
@@ -2221,16 +2952,17 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
     // one neighbor either supports spark2 or NOT.
     // it will show EITHER in spark2Neighbors OR neighbors_. NOT both.
     if (enableSpark2_) {
-      for (const auto& kv : spark2Neighbors_.at(ifName)) {
-        auto& neighborName = kv.first;
-        auto& neighbor = kv.second;
-        allocatedLabels_.erase(neighbor.label);
-        LOG(INFO) << "Neighbor " << neighborName << " removed due to iface "
-                  << ifName << " down";
-
-        neighborDownWrapper(neighbor, ifName, neighborName);
-      }
-      spark2Neighbors_.erase(ifName);
+      spark2Neighbors_.forEachNeighbor(
+          ifName,
+          [this, &ifName](
+              std::string const& neighborName, Spark2Neighbor& neighbor) {
+            allocatedLabels_.erase(neighbor.label);
+            LOG(INFO) << "Neighbor " << neighborName
+                      << " removed due to iface " << ifName << " down";
+
+            neighborDownWrapper(neighbor, ifName, neighborName);
+          });
+      spark2Neighbors_.eraseInterface(ifName);
       ifNameToHeartbeatTimers_.erase(ifName);
     }
 
@@ -2270,6 +3002,10 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
     // cleanup for this interface
     neighbors_.erase(ifName);
     ifNameToHelloTimers_.erase(ifName);
+    ifNameToHelloBackoff_.erase(ifName);
+    helloTxTimestamps_.erase(ifName);
+    handshakePackets_.erase(ifName);
+    setIfIndexName(interfaceDb_.at(ifName).ifIndex, "");
     interfaceDb_.erase(ifName);
   }
 }
@@ -2300,6 +3036,7 @@ Spark::addInterfaceToDb(
     {
       auto result = interfaceDb_.emplace(ifName, newInterface);
       CHECK(result.second);
+      setIfIndexName(ifIndex, ifName);
     }
 
     {
@@ -2311,44 +3048,59 @@ Spark::addInterfaceToDb(
 
     if (enableSpark2_) {
       // create place-holders for newly added interface
-      auto result = spark2Neighbors_.emplace(
-          ifName, std::unordered_map<std::string, Spark2Neighbor>{});
-      CHECK(result.second);
-
-      // heartbeatTimers will start as soon as intf is in UP state
-      auto heartbeatTimer = fbzmq::ZmqTimeout::make(
-          getEvb(), [this, ifName]() noexcept { sendHeartbeatMsg(ifName); });
+      CHECK(not spark2Neighbors_.hasInterface(ifName));
+      spark2Neighbors_.addInterface(ifName);
+
+      // heartbeatTimers will start as soon as intf is in UP state. They are
+      // rescheduled after every heartbeat, picking up tuned intervals
+      auto heartbeatTimer = timerWheel_->makeTimer([this, ifName]() noexcept {
+        sendHeartbeatMsg(ifName);
+        ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(
+            std::chrono::milliseconds(heartbeatTimeMs_.get()));
+      });
 
-      const bool isPeriodic = true; /* flag indicating periodic pkt sent-out*/
       ifNameToHeartbeatTimers_.emplace(ifName, std::move(heartbeatTimer));
       ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(
-          myHeartbeatTime_, isPeriodic);
+          std::chrono::milliseconds(heartbeatTimeMs_.get()));
     }
 
-    auto rollHelper = [](std::chrono::milliseconds timeDuration) {
-      auto base = timeDuration.count();
-      std::uniform_int_distribution<int> distribution(-0.2 * base, 0.2 * base);
-      std::default_random_engine generator;
-      return [timeDuration, distribution, generator]() mutable {
-        return timeDuration +
-            std::chrono::milliseconds(distribution(generator));
+    // seed generators per interface, hellos of interfaces added together
+    // would otherwise go out in synchronized bursts. Intervals are read on
+    // every roll, picking up tuned ones
+    auto rollHelper = [](RuntimeKnobs::Knob const& timeMs) {
+      std::default_random_engine generator(folly::Random::rand32());
+      return [timeMs, generator]() mutable {
+        const auto base = timeMs.get();
+        std::uniform_int_distribution<int64_t> distribution(
+            -0.2 * base, 0.2 * base);
+        return std::chrono::milliseconds(base + distribution(generator));
       };
     };
 
+    // hellos of stable interfaces back off, only Spark2 neighbors don't
+    // need them to stay up
+    if (enableSpark2_ && increaseHelloInterval_ &&
+        myHelloMaxTime_ > myHelloTime_) {
+      ifNameToHelloBackoff_.emplace(
+          ifName,
+          ExponentialBackoff<std::chrono::milliseconds>(
+              myHelloTime_, myHelloMaxTime_));
+    }
+
     auto roll = (enableSpark2_ && increaseHelloInterval_)
-        ? rollHelper(myHelloTime_)
-        : rollHelper(myKeepAliveTime_);
+        ? rollHelper(helloTimeMs_)
+        : rollHelper(keepAliveTimeMs_);
     auto rollFast = (enableSpark2_ && increaseHelloInterval_)
-        ? rollHelper(myHelloFastInitTime_)
-        : rollHelper(fastInitKeepAliveTime_);
+        ? rollHelper(RuntimeKnobs::Knob(myHelloFastInitTime_.count()))
+        : rollHelper(RuntimeKnobs::Knob(fastInitKeepAliveTime_.count()));
     auto timePoint = std::chrono::steady_clock::now();
 
     // NOTE: We do not send hello packet immediately after adding new interface
     // this is due to the fact that it may not have yet configured a link-local
     // address. The hello packet will be sent later and will have good chances
     // of making it out if small delay is introduced.
-    auto helloTimer = fbzmq::ZmqTimeout::make(
-        getEvb(), [this, ifName, timePoint, roll, rollFast]() mutable noexcept {
+    auto helloTimer = timerWheel_->makeTimer(
+        [this, ifName, timePoint, roll, rollFast]() mutable noexcept {
           VLOG(3) << "Sending hello multicast packet on interface " << ifName;
           bool inFastInitState = false;
           if (enableSpark2_ && increaseHelloInterval_) {
@@ -2375,6 +3127,18 @@ Spark::addInterfaceToDb(
           std::chrono::milliseconds timeoutPeriod =
               inFastInitState ? rollFast() : roll();
 
+          // back off further as long as the interface stays stable, scaling
+          // the variance along
+          auto backoffIt = ifNameToHelloBackoff_.find(ifName);
+          if (not inFastInitState and
+              backoffIt != ifNameToHelloBackoff_.end() and
+              isInterfaceStable(ifName)) {
+            auto& backoff = backoffIt->second;
+            backoff.reportError();
+            timeoutPeriod = timeoutPeriod *
+                backoff.getCurrentBackoff().count() / myHelloTime_.count();
+          }
+
           ifNameToHelloTimers_.at(ifName)->scheduleTimeout(timeoutPeriod);
         });
 
@@ -2423,6 +3187,11 @@ Spark::updateInterfaceInDb(
         throw std::runtime_error(folly::sformat(
             "Failed joining multicast group: {}", folly::errnoStr(errno)));
       }
+      // ifIndexes may be swapped between interfaces of the same update
+      if (findInterfaceFromIfindex(interface.ifIndex) == ifName) {
+        setIfIndexName(interface.ifIndex, "");
+      }
+      setIfIndexName(newInterface.ifIndex, ifName);
     }
     LOG(INFO) << "Updating iface " << ifName << " in spark tracking from "
               << "(ifindex " << interface.ifIndex << ", addrs "
@@ -2433,11 +3202,31 @@ Spark::updateInterfaceInDb(
               << newInterface.v4Network.first << ")";
 
     interface = std::move(newInterface);
+    handshakePackets_.erase(ifName);
+    resetHelloBackoff(ifName);
   }
 }
 
+void
+Spark::setIfIndexName(int ifIndex, std::string const& ifName) {
+  if (ifIndex <= 0 or ifIndex >= kMaxDenseIfIndex) {
+    return;
+  }
+  if (static_cast<size_t>(ifIndex) >= ifIndexToName_.size()) {
+    ifIndexToName_.resize(ifIndex + 1);
+  }
+  ifIndexToName_[ifIndex] = ifName;
+}
+
 folly::Optional<std::string>
 Spark::findInterfaceFromIfindex(int ifIndex) {
+  if (ifIndex > 0 and ifIndex < kMaxDenseIfIndex) {
+    if (static_cast<size_t>(ifIndex) >= ifIndexToName_.size() or
+        ifIndexToName_[ifIndex].empty()) {
+      return folly::none;
+    }
+    return ifIndexToName_[ifIndex];
+  }
   for (const auto& kv : interfaceDb_) {
     if (kv.second.ifIndex == ifIndex) {
       return kv.first;
@@ -2469,12 +3258,93 @@ Spark::getNewLabelForIface(const std::string& ifName) {
   return label;
 }
 
+int32_t
+Spark::getLabelForNeighbor(
+    std::string const& ifName,
+    folly::Optional<thrift::SparkCachedNeighbor> const& cachedNeighbor) {
+  if (cachedNeighbor and
+      cachedNeighbor->label >= Constants::kSrLocalRange.first and
+      cachedNeighbor->label <= Constants::kSrLocalRange.second and
+      allocatedLabels_.insert(cachedNeighbor->label).second) {
+    return cachedNeighbor->label;
+  }
+  return getNewLabelForIface(ifName);
+}
+
+folly::Optional<thrift::SparkCachedNeighbor>
+Spark::takeCachedNeighbor(
+    std::string const& ifName,
+    std::string const& neighborName,
+    std::string const& remoteIfName) {
+  auto ifIt = neighborCache_.find(ifName);
+  if (ifIt == neighborCache_.end()) {
+    return folly::none;
+  }
+  auto& cachedNeighbors = ifIt->second;
+  auto it = std::find_if(
+      cachedNeighbors.begin(),
+      cachedNeighbors.end(),
+      [&neighborName](thrift::SparkCachedNeighbor const& cachedNeighbor) {
+        return cachedNeighbor.nodeName == neighborName;
+      });
+  if (it == cachedNeighbors.end()) {
+    return folly::none;
+  }
+
+  // a neighbor is seen once, either on the same link or not anymore
+  auto cachedNeighbor = std::move(*it);
+  cachedNeighbors.erase(it);
+  if (cachedNeighbors.empty()) {
+    neighborCache_.erase(ifIt);
+  }
+  if (cachedNeighbor.remoteIfName != remoteIfName) {
+    return folly::none;
+  }
+  return cachedNeighbor;
+}
+
+thrift::SparkNeighborCache
+Spark::buildNeighborCache() {
+  thrift::SparkNeighborCache cache;
+  for (auto const& kv : ifNameToActiveNeighbors_) {
+    auto const& ifName = kv.first;
+    for (auto const& neighborName : kv.second) {
+      auto const* neighbor = spark2Neighbors_.find(ifName, neighborName);
+      if (not neighbor or neighbor->state != SparkNeighState::ESTABLISHED) {
+        continue;
+      }
+      thrift::SparkCachedNeighbor cachedNeighbor;
+      cachedNeighbor.nodeName = neighborName;
+      cachedNeighbor.remoteIfName = neighbor->remoteIfName;
+      cachedNeighbor.label = static_cast<int32_t>(neighbor->label);
+      cachedNeighbor.transportAddressV6 = neighbor->transportAddressV6;
+      cachedNeighbor.transportAddressV4 = neighbor->transportAddressV4;
+      cachedNeighbor.openrCtrlThriftPort = neighbor->openrCtrlThriftPort;
+      cachedNeighbor.kvStoreCmdPort = neighbor->kvStoreCmdPort;
+      cachedNeighbor.area = neighbor->area;
+      cache.neighbors[ifName].emplace_back(std::move(cachedNeighbor));
+    }
+  }
+  return cache;
+}
+
+std::string
+Spark::getNeighborCacheKey() const {
+  if (shardId_) {
+    return folly::sformat("{}.shard{}", kNeighborCacheKey, *shardId_);
+  }
+  return kNeighborCacheKey;
+}
+
 void
 Spark::submitCounters() {
   VLOG(3) << "Submitting counters...";
 
   // Extract/build counters from thread-data
   auto counters = tData_.getCounters();
+  for (auto const& kv : stats_.getCounters()) {
+    counters[kv.first] = kv.second;
+  }
 
   // Add some more flat counters
   int64_t adjacentNeighborCount{0}, trackedNeighborCount{0};
@@ -2491,27 +3361,42 @@ Spark::submitCounters() {
       counters["spark.seq_num." + neighbor.info.nodeName] = neighbor.seqNum;
     }
   }
-  for (auto const& ifaceNeighbors : spark2Neighbors_) {
-    trackedNeighborCount += ifaceNeighbors.second.size();
-    for (auto const& kv : ifaceNeighbors.second) {
-      auto const& neighbor = kv.second;
-      adjacentNeighborCount += neighbor.state == SparkNeighState::ESTABLISHED;
-      counters
-          ["spark.rtt_us." + neighbor.nodeName + "." + ifaceNeighbors.first] =
-              neighbor.rtt.count();
-      counters["spark.rtt_latest_us." + neighbor.nodeName] =
-          neighbor.rttLatest.count();
-      counters["spark.seq_num." + neighbor.nodeName] = neighbor.seqNum;
-    }
-  }
-  counters["spark.num_tracked_interfaces"] =
-      neighbors_.size() ? neighbors_.size() : spark2Neighbors_.size();
+  trackedNeighborCount += spark2Neighbors_.getNumNeighbors();
+  spark2Neighbors_.forEachNeighbor([&](std::string const& ifName,
+                                       std::string const& /* nodeName */,
+                                       Spark2Neighbor const& neighbor) {
+    adjacentNeighborCount += neighbor.state == SparkNeighState::ESTABLISHED;
+    counters["spark.rtt_us." + neighbor.nodeName + "." + ifName] =
+        neighbor.rtt.count();
+    counters["spark.rtt_latest_us." + neighbor.nodeName] =
+        neighbor.rttLatest.count();
+    counters["spark.seq_num." + neighbor.nodeName] = neighbor.seqNum;
+  });
+  counters["spark.num_tracked_interfaces"] = neighbors_.size()
+      ? neighbors_.size()
+      : spark2Neighbors_.getNumInterfaces();
   counters["spark.num_tracked_neighbors"] = trackedNeighborCount;
   counters["spark.num_adjacent_neighbors"] = adjacentNeighborCount;
   counters["spark.my_seq_num"] = mySeqNum_;
   counters["spark.pending_timers"] = getEvb()->timer().count();
   counters["spark.zmq_event_queue_size"] = getEvb()->getNotificationQueueSize();
 
+  // counters of shards would overwrite each other
+  if (shardId_) {
+    const std::string prefix{"spark."};
+    const auto shardPrefix = folly::sformat("spark.shard{}.", *shardId_);
+    std::unordered_map<std::string, int64_t> shardCounters;
+    for (auto& kv : counters) {
+      if (kv.first.compare(0, prefix.size(), prefix) == 0) {
+        shardCounters.emplace(
+            shardPrefix + kv.first.substr(prefix.size()), kv.second);
+      } else {
+        shardCounters.emplace(kv.first, kv.second);
+      }
+    }
+    counters = std::move(shardCounters);
+  }
+
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
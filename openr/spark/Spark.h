@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <functional>
+#include <map>
+#include <thread>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqTimeout.h>
@@ -22,15 +25,22 @@
 #include <folly/stats/BucketedTimeSeries.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/RuntimeKnobs.h>
 #include <openr/common/StepDetector.h>
+#include <openr/common/ThreadLocalStats.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
 #include <openr/if/gen-cpp2/Spark_types.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/spark/IoProvider.h>
+#include <openr/spark/SparkFastDetector.h>
+#include <openr/spark/SparkNeighborTable.h>
+#include <openr/spark/TimerWheel.h>
 
 namespace openr {
 
@@ -76,6 +86,10 @@ enum class SparkNeighEvent {
 // It receives commands in form of "add interface" / "remove inteface"
 // and starts hello process on those interfaces.
 //
+// It can run as one of several shards splitting the interfaces, see
+// SparkCoordinator. A shard only receives packets of its own interfaces and
+// submits its counters under "spark.shard<N>."
+//
 
 class Spark final : public OpenrEventBase {
  public:
@@ -106,7 +120,17 @@ class Spark final : public OpenrEventBase {
       bool enableFloodOptimization = false,
       bool enableSpark2 = false,
       bool increaseHelloInterval = false,
-      folly::Optional<std::unordered_set<std::string>> areas = folly::none);
+      folly::Optional<std::unordered_set<std::string>> areas = folly::none,
+      std::vector<SparkFastDetectionConfig> fastDetectionConfigs = {},
+      uint16_t fastDetectionPort = 0,
+      std::chrono::milliseconds myHelloMaxTime = std::chrono::milliseconds(0),
+      folly::Optional<size_t> shardId = folly::none,
+      // registry of the hello and heartbeat intervals tunable at runtime,
+      // shared by shards. Fixed if null
+      RuntimeKnobs* runtimeKnobs = nullptr,
+      // store of the Spark2 neighbors ESTABLISHED at shutdown, to form
+      // adjacency with them quickly on restart. Not persisted if null
+      PersistentStore* configStore = nullptr);
 
   ~Spark() override = default;
 
@@ -185,9 +209,12 @@ class Spark final : public OpenrEventBase {
   bool shouldProcessHelloPacket(
       std::string const& ifName, folly::IPAddress const& addr);
 
+  // receive a batch of hello packets and process them
+  void processHelloPackets();
+
   // process hello packet from a neighbor. we want to see if
   // the neighbor could be added as adjacent peer.
-  void processHelloPacket();
+  void processHelloPacket(IoProvider::ReceivedMessage const& message);
 
   // originate my hello packet on given interface
   void sendHelloPacket(
@@ -195,9 +222,44 @@ class Spark final : public OpenrEventBase {
       bool inFastInitState = false,
       bool restarting = false);
 
+  // originate my hello packets on given interfaces in a batch
+  void sendHelloPackets(
+      std::vector<std::string> const& ifNames, bool restarting = false);
+
+  // build my hello packet for given interface, along with the timestamp
+  // carried in it as its sent time
+  folly::Optional<IoProvider::OutgoingMessage> buildHelloPacket(
+      std::string const& ifName,
+      bool inFastInitState,
+      bool restarting,
+      std::chrono::microseconds& sentTs);
+
+  // check result of sending a hello packet and update counters
+  void updateHelloPacketSent(
+      std::string const& ifName,
+      IoProvider::OutgoingMessage const& message,
+      ssize_t bytesSent,
+      std::chrono::microseconds sentTs);
+
+  // account a packet handed over to kernel, to map its TX timestamp back to
+  // the hello packet (ifName, sent timestamp) if any
+  void recordSentPacket(
+      folly::Optional<std::pair<std::string, std::chrono::microseconds>>
+          helloSent);
+
+  // read kernel TX timestamps of sent packets from the socket error queue
+  void processTxTimestamps();
+
+  // kernel TX timestamp of my hello packet on ifName with the given sent
+  // timestamp, or the sent timestamp itself if not known
+  std::chrono::microseconds getHelloTxTime(
+      std::string const& ifName,
+      std::chrono::microseconds const& sentTs) const;
+
   // Function processes interface updates from LinkMonitor and appropriately
   // enable/disable neighbor discovery
-  void processInterfaceUpdates(thrift::InterfaceDatabase&& interfaceUpdates);
+  void processInterfaceUpdates(
+      thrift::InterfaceDatabase const& interfaceUpdates);
 
   // util function to delete interface in spark
   void deleteInterfaceFromDb(const std::set<std::string>& toDel);
@@ -215,11 +277,33 @@ class Spark final : public OpenrEventBase {
   // find an interface name in the interfaceDb given an ifIndex
   folly::Optional<std::string> findInterfaceFromIfindex(int ifIndex);
 
+  // record ifName as the interface of ifIndex, empty to forget it
+  void setIfIndexName(int ifIndex, std::string const& ifName);
+
   // Utility function to generate a new label for neighbor on given interface.
   // If there is only one neighbor per interface then labels are expected to be
   // same across process-restarts
   int32_t getNewLabelForIface(std::string const& ifName);
 
+  // Reserve the label of the cached neighbor if any and still free, so that
+  // the adjacency keeps its label across restarts. Else generate a new one
+  int32_t getLabelForNeighbor(
+      std::string const& ifName,
+      folly::Optional<thrift::SparkCachedNeighbor> const& cachedNeighbor);
+
+  // Take the cached neighbor on given interface out of the neighbor cache,
+  // if it matches the neighbor seen on remoteIfName
+  folly::Optional<thrift::SparkCachedNeighbor> takeCachedNeighbor(
+      std::string const& ifName,
+      std::string const& neighborName,
+      std::string const& remoteIfName);
+
+  // ESTABLISHED Spark2 neighbors, to be persisted at shutdown
+  thrift::SparkNeighborCache buildNeighborCache();
+
+  // key of the neighbor cache in config store, per shard
+  std::string getNeighborCacheKey() const;
+
   // Sumbmits the counter/stats to monitor
   void submitCounters();
 
@@ -228,11 +312,16 @@ class Spark final : public OpenrEventBase {
       folly::Optional<std::unordered_set<std::string>> areas,
       const std::string& nodeName);
 
-  // function to receive and parse received pkt
+  // function to parse received pkt
   bool parsePacket(
+      IoProvider::ReceivedMessage const& message /* received pkt */,
       thrift::SparkHelloPacket& pkt /* packet( type will be renamed later) */,
-      std::string& ifName /* interface */,
-      std::chrono::microseconds& recvTime /* kernel timestamp when recved */);
+      std::string& ifName /* interface */);
+
+  // decode just the sender, domain and version of received pkt, to drop the
+  // ones we'd reject anyway before deserializing them in full. Returns false
+  // if pkt must be dropped
+  bool preFilterPacket(std::string const& data);
 
   // function to validate v4Address with its subnet
   PacketValidationResult validateV4AddressSubnet(
@@ -273,21 +362,14 @@ class Spark final : public OpenrEventBase {
       res.transportAddressV6 = transportAddressV6;
       res.kvStoreCmdPort = kvStoreCmdPort;
       res.ifName = remoteIfName;
+      res.openrCtrlThriftPort = openrCtrlThriftPort;
       return res;
     }
 
-    // doamin name
-    const std::string domainName;
-
-    // node name
-    const std::string nodeName;
-
-    // interface name
-    const std::string remoteIfName;
-
-    // SR Label to reach Neighbor over this specific adjacency. Generated
-    // using ifIndex to this neighbor. Only local within the node.
-    const uint32_t label{0};
+    //
+    // Hot fields, touched by every hello and heartbeat of the neighbor, are
+    // kept together at the front
+    //
 
     // Last sequence number received from neighbor
     uint64_t seqNum{0};
@@ -295,41 +377,58 @@ class Spark final : public OpenrEventBase {
     // neighbor state
     SparkNeighState state;
 
+    // Timestamps of last hello packet received from this neighbor.
+    // All timestamps are derived from std::chrono::steady_clock.
+    std::chrono::microseconds neighborTimestamp{0};
+    std::chrono::microseconds localTimestamp{0};
+
+    // Currently RTT value being used to neighbor. Must be initialized to zero
+    std::chrono::microseconds rtt{0};
+
+    // Lastest measured RTT on receipt of every hello packet
+    std::chrono::microseconds rttLatest{0};
+
+    // hold time
+    std::chrono::milliseconds heartbeatHoldTime{0};
+    std::chrono::milliseconds gracefulRestartHoldTime{0};
+
     // timer to periodically send out handshake pkt
-    std::unique_ptr<fbzmq::ZmqTimeout> negotiateTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> negotiateTimer{nullptr};
 
     // negotiate stage hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> negotiateHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> negotiateHoldTimer{nullptr};
 
     // heartbeat hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> heartbeatHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> heartbeatHoldTimer{nullptr};
 
     // graceful restart hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> gracefulRestartHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> gracefulRestartHoldTimer{nullptr};
+
+    //
+    // Cold fields, set on negotiation and read on neighbor events
+    //
+
+    // doamin name
+    const std::string domainName;
+
+    // node name
+    const std::string nodeName;
+
+    // interface name
+    const std::string remoteIfName;
+
+    // SR Label to reach Neighbor over this specific adjacency. Generated
+    // using ifIndex to this neighbor. Only local within the node.
+    const uint32_t label{0};
 
     // KvStore related port. Info passed to LinkMonitor for neighborEvent
     int32_t kvStoreCmdPort{0};
     int32_t openrCtrlThriftPort{0};
 
-    // hold time
-    std::chrono::milliseconds heartbeatHoldTime{0};
-    std::chrono::milliseconds gracefulRestartHoldTime{0};
-
     // v4/v6 network address
     thrift::BinaryAddress transportAddressV4;
     thrift::BinaryAddress transportAddressV6;
 
-    // Timestamps of last hello packet received from this neighbor.
-    // All timestamps are derived from std::chrono::steady_clock.
-    std::chrono::microseconds neighborTimestamp{0};
-    std::chrono::microseconds localTimestamp{0};
-
-    // Currently RTT value being used to neighbor. Must be initialized to zero
-    std::chrono::microseconds rtt{0};
-
-    // Lastest measured RTT on receipt of every hello packet
-    std::chrono::microseconds rttLatest{0};
-
     // detect rtt changes
     StepDetector<int64_t, std::chrono::milliseconds> stepDetector;
 
@@ -337,10 +436,14 @@ class Spark final : public OpenrEventBase {
     std::string area{};
   };
 
-  std::unordered_map<
-      std::string /* ifName */,
-      std::unordered_map<std::string /* neighborName */, Spark2Neighbor>>
-      spark2Neighbors_{};
+  // neighbors by interface and name
+  SparkNeighborTable<Spark2Neighbor> spark2Neighbors_{};
+
+  // are all neighbors of ifName ESTABLISHED, i.e. hellos can back off
+  bool isInterfaceStable(std::string const& ifName) const;
+
+  // go back to sending hellos every myHelloTime_ on ifName
+  void resetHelloBackoff(std::string const& ifName);
 
   // util function to log Spark neighbor state transition
   void logStateTransition(
@@ -388,6 +491,20 @@ class Spark final : public OpenrEventBase {
   // utility call to send heartbeat msg
   void sendHeartbeatMsg(std::string const& ifName);
 
+  // serialized handshake msg for ifName, built once per interface config
+  std::string const& getHandshakePacket(
+      std::string const& ifName, bool isAdjEstablished);
+
+  // serialized heartbeat msg, with seqNum patched into a template
+  std::string buildHeartbeatPacket(uint64_t seqNum);
+
+  // start sending handshake msg to neighbor in WARM state and promote it to
+  // NEGOTIATE state
+  void startNegotiate(
+      Spark2Neighbor& neighbor,
+      std::string const& ifName,
+      std::string const& neighborName);
+
   // wrapper function to process GR msg
   void processGRMsg(
       std::string const& neighborName,
@@ -412,6 +529,10 @@ class Spark final : public OpenrEventBase {
   void processHeartbeatTimeout(
       std::string const& ifName, std::string const& neighborName);
 
+  // process neighbor down reported by fast failure detection
+  void processFastDetectionTimeout(
+      std::string const& ifName, std::string const& neighborName);
+
   // process timeout for negotiate stage
   void processNegotiateTimeout(
       std::string const& ifName, std::string const& neighborName);
@@ -458,6 +579,10 @@ class Spark final : public OpenrEventBase {
   // Spark2 hello msg sendout interval under fast-init case
   const std::chrono::milliseconds myHelloFastInitTime_{0};
 
+  // Spark2 hello msg sendout interval backs off up to this on stable
+  // interfaces. Adaptive hellos are disabled if not above myHelloTime_
+  const std::chrono::milliseconds myHelloMaxTime_{0};
+
   // Spark2 handshake msg sendout interval
   const std::chrono::milliseconds myHandshakeTime_{0};
 
@@ -470,6 +595,13 @@ class Spark final : public OpenrEventBase {
   // Spark2 heartbeat msg hold time
   const std::chrono::milliseconds myHeartbeatHoldTime_{0};
 
+  // intervals of keep alive hellos, Spark2 hellos and Spark2 heartbeats
+  // tunable at runtime, read instead of myKeepAliveTime_, myHelloTime_ and
+  // myHeartbeatTime_ they are initialized to
+  RuntimeKnobs::Knob keepAliveTimeMs_;
+  RuntimeKnobs::Knob helloTimeMs_;
+  RuntimeKnobs::Knob heartbeatTimeMs_;
+
   // This flag indicates that we will also exchange v4 transportAddress in
   // Spark HelloMessage
   const bool enableV4_{false};
@@ -486,6 +618,28 @@ class Spark final : public OpenrEventBase {
   // the multicast socket we use
   int mcastFd_{-1};
 
+  // whether kernel reports TX timestamps of packets sent on mcastFd_
+  bool enableTxTimestamps_{false};
+
+  // key kernel assigns to the TX timestamp of next packet sent on mcastFd_
+  uint32_t nextTxTimestampKey_{0};
+
+  // hello packets sent, awaiting their kernel TX timestamp, keyed by the
+  // TX timestamp key
+  std::map<
+      uint32_t /* key */,
+      std::pair<std::string /* ifName */, std::chrono::microseconds /* sent */>>
+      pendingTxTimestamps_;
+
+  // kernel TX timestamps of latest hello packets on each interface, keyed by
+  // the sent timestamp carried in the hello packet and reflected back to us
+  std::unordered_map<
+      std::string /* ifName */,
+      std::map<
+          std::chrono::microseconds /* sent */,
+          std::chrono::microseconds /* tx */>>
+      helloTxTimestamps_;
+
   // state transition matrix for Finite-State-Machine
   static const std::vector<std::vector<folly::Optional<SparkNeighState>>>
       stateMap_;
@@ -509,19 +663,38 @@ class Spark final : public OpenrEventBase {
   // increase Hello interval in Spark2
   const bool increaseHelloInterval_{false};
 
+  // Timer wheel of all per-interface and per-neighbor timers, advanced by
+  // a single event loop timeout. Declared ahead of the timers so that it
+  // outlives them
+  std::unique_ptr<fbzmq::ZmqTimeout> timerWheelTimeout_{nullptr};
+  std::unique_ptr<TimerWheel> timerWheel_{nullptr};
+
   // Map of interface entries keyed by ifName
   std::unordered_map<std::string, Interface> interfaceDb_{};
 
+  // interface names by ifIndex, for receiving packets without looking
+  // through interfaceDb_. Empty for unknown ifIndexes
+  std::vector<std::string> ifIndexToName_{};
+
+  // sequence number of the last interface update applied
+  int64_t interfaceDbSeqNum_{0};
+
   // Hello packet send timers for each interface
   std::unordered_map<
       std::string /* ifName */,
-      std::unique_ptr<fbzmq::ZmqTimeout>>
+      std::unique_ptr<TimerWheel::Timer>>
       ifNameToHelloTimers_;
 
+  // Hello interval backoff of interfaces, with adaptive hellos only
+  std::unordered_map<
+      std::string /* ifName */,
+      ExponentialBackoff<std::chrono::milliseconds>>
+      ifNameToHelloBackoff_;
+
   // heartbeat packet send timers for each interface
   std::unordered_map<
       std::string /* ifName */,
-      std::unique_ptr<fbzmq::ZmqTimeout>>
+      std::unique_ptr<TimerWheel::Timer>>
       ifNameToHeartbeatTimers_;
 
   // number of active neighbors for each interface
@@ -543,7 +716,7 @@ class Spark final : public OpenrEventBase {
         thrift::SparkNeighbor const& info,
         uint32_t label,
         uint64_t seqNum,
-        std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
+        std::unique_ptr<TimerWheel::Timer> holdTimer,
         const std::chrono::milliseconds& samplingPeriod,
         std::function<void(const int64_t&)> rttChangeCb,
         std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -552,7 +725,7 @@ class Spark final : public OpenrEventBase {
     thrift::SparkNeighbor info;
 
     // Hold timer. If expired will declare the neighbor as stopped.
-    const std::unique_ptr<fbzmq::ZmqTimeout> holdTimer{nullptr};
+    const std::unique_ptr<TimerWheel::Timer> holdTimer{nullptr};
 
     // SR Label to reach Neighbor over this specific adjacency. Generated
     // using ifIndex to this neighbor. Only local within the node.
@@ -594,6 +767,15 @@ class Spark final : public OpenrEventBase {
   // to serdeser messages over ZMQ sockets
   apache::thrift::CompactSerializer serializer_;
 
+  // pre-serialized handshake packets, indexed by isAdjEstablished. They only
+  // depend on the interface config and get dropped when it changes
+  std::unordered_map<std::string /* ifName */, std::array<std::string, 2>>
+      handshakePackets_;
+
+  // pre-serialized heartbeat packet, split around its seqNum which is the
+  // only field changing between sends
+  folly::Optional<std::pair<std::string, std::string>> heartbeatTemplate_;
+
   // The IO primitives provider; this is used for mocking
   // the IO during unit-tests. This could be shared with other
   // instances, hence the shared_ptr
@@ -610,10 +792,52 @@ class Spark final : public OpenrEventBase {
   // DS to hold local stats/counters
   fbzmq::ThreadData tData_;
 
+  // stats of the packet handlers, without the string keyed lookups of tData_
+  ThreadLocalStats stats_;
+  ThreadLocalStats::Stat handshakeBytesSentStat_;
+  ThreadLocalStats::Stat handshakePacketsSentStat_;
+  ThreadLocalStats::Stat heartbeatBytesSentStat_;
+  ThreadLocalStats::Stat heartbeatPacketsSentStat_;
+  ThreadLocalStats::Stat helloBytesSentStat_;
+  ThreadLocalStats::Stat helloPacketsSentStat_;
+  ThreadLocalStats::Stat helloPacketDroppedStat_;
+  ThreadLocalStats::Stat helloPacketDroppedEarlyDifferentDomainStat_;
+  ThreadLocalStats::Stat helloPacketDroppedEarlyInvalidVersionStat_;
+  ThreadLocalStats::Stat helloPacketDroppedEarlyLoopedPacketStat_;
+  ThreadLocalStats::Stat helloPacketDroppedEarlyMalformedStat_;
+  ThreadLocalStats::Stat helloPacketDroppedEarlyUnknownInterfaceStat_;
+  ThreadLocalStats::Stat helloPacketProcessedStat_;
+  ThreadLocalStats::Stat helloPacketRecvStat_;
+  ThreadLocalStats::Stat helloPacketRecvBatchesStat_;
+  ThreadLocalStats::Stat helloPacketRecvSizeStat_;
+  ThreadLocalStats::Stat invalidKeepaliveDifferentDomainStat_;
+  ThreadLocalStats::Stat invalidKeepaliveDifferentSubnetStat_;
+  ThreadLocalStats::Stat invalidKeepaliveInvalidVersionStat_;
+  ThreadLocalStats::Stat invalidKeepaliveLoopedPacketStat_;
+  ThreadLocalStats::Stat invalidKeepaliveMissingV4AddrStat_;
+
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
   // areas that this node belongs to.
   folly::Optional<std::unordered_set<std::string>> areas_ = folly::none;
+
+  // fast failure detection of ESTABLISHED neighbors, running on its own
+  // thread. Null if not enabled on any interface
+  std::unique_ptr<SparkFastDetector> fastDetector_;
+  std::thread fastDetectorThread_;
+
+  // shard of the interfaces this instance runs, if sharded
+  const folly::Optional<size_t> shardId_;
+
+  // config store to persist Spark2 neighbors at shutdown, if any
+  PersistentStore* const configStore_{nullptr};
+
+  // Spark2 neighbors ESTABLISHED before restart, keyed by interface. Taken
+  // out as their first hello is received
+  std::unordered_map<
+      std::string /* ifName */,
+      std::vector<thrift::SparkCachedNeighbor>>
+      neighborCache_;
 };
 } // namespace openr
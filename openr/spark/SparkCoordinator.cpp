@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/spark/SparkCoordinator.h>
+
+#include <functional>
+
+#include <folly/Format.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+SparkCoordinator::SparkCoordinator(
+    size_t numShards,
+    messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue)
+    : shardSeqNums_(numShards, 0) {
+  CHECK_GT(numShards, 0) << "Spark needs at least one shard";
+  for (size_t shard = 0; shard < numShards; ++shard) {
+    shardQueues_.emplace_back(
+        std::make_unique<messaging::ReplicateQueue<thrift::InterfaceDatabase>>(
+            folly::sformat("spark_shard{}_interface_updates", shard)));
+  }
+
+  // Fiber to split interface updates from LinkMonitor
+  addFiberTask([q = std::move(interfaceUpdatesQueue), this]() mutable noexcept {
+    while (true) {
+      auto interfaceUpdates = q.getShared();
+      if (interfaceUpdates.hasError()) {
+        LOG(INFO) << "Terminating interface update processing fiber";
+        break;
+      }
+      processInterfaceUpdates(*interfaceUpdates.value());
+    }
+    // shards stop reading along with us
+    for (auto& queue : shardQueues_) {
+      queue->close();
+    }
+  });
+}
+
+messaging::RQueue<thrift::InterfaceDatabase>
+SparkCoordinator::getInterfaceUpdatesReader(size_t shard) {
+  return shardQueues_.at(shard)->getReader("spark");
+}
+
+size_t
+SparkCoordinator::getShard(std::string const& ifName, size_t numShards) {
+  return std::hash<std::string>()(ifName) % numShards;
+}
+
+std::string
+SparkCoordinator::getShardName(size_t shard) {
+  return shard == 0 ? "Spark" : folly::sformat("Spark{}", shard);
+}
+
+void
+SparkCoordinator::stop() {
+  for (auto& queue : shardQueues_) {
+    queue->close();
+  }
+  OpenrEventBase::stop();
+}
+
+void
+SparkCoordinator::processInterfaceUpdates(
+    thrift::InterfaceDatabase const& ifDb) {
+  const auto numShards = shardQueues_.size();
+  std::vector<thrift::InterfaceDatabase> shardDbs(numShards);
+  for (auto& shardDb : shardDbs) {
+    shardDb.thisNodeName = ifDb.thisNodeName;
+    shardDb.isDelta = ifDb.isDelta;
+  }
+  for (auto const& kv : ifDb.interfaces) {
+    shardDbs.at(getShard(kv.first, numShards))
+        .interfaces.emplace(kv.first, kv.second);
+  }
+  for (auto const& ifName : ifDb.deletedInterfaces) {
+    shardDbs.at(getShard(ifName, numShards))
+        .deletedInterfaces.emplace_back(ifName);
+  }
+
+  for (size_t shard = 0; shard < numShards; ++shard) {
+    auto& shardDb = shardDbs[shard];
+    if (shardDb.isDelta and shardDb.interfaces.empty() and
+        shardDb.deletedInterfaces.empty()) {
+      continue;
+    }
+    shardDb.seqNum = ++shardSeqNums_[shard];
+    shardDb.perfEvents = ifDb.perfEvents;
+    VLOG(2) << "Forwarding " << shardDb.interfaces.size() << " interfaces to "
+            << getShardName(shard);
+    shardQueues_[shard]->push(std::move(shardDb));
+  }
+}
+
+} // namespace openr
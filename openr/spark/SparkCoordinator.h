@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <openr/common/OpenrEventBase.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+#include <openr/messaging/ReplicateQueue.h>
+
+namespace openr {
+
+/**
+ * Splits the interfaces across Spark shards, each a Spark instance running
+ * on its own event base with its own socket and neighbors, for no single
+ * thread to carry the hellos and heartbeats of every interface.
+ *
+ * Interfaces are assigned to shards by hash of their name. All events of a
+ * neighbor are then published by the one shard of its interface, in order,
+ * and shards push them to the neighbor updates queue directly.
+ */
+class SparkCoordinator final : public OpenrEventBase {
+ public:
+  SparkCoordinator(
+      size_t numShards,
+      messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue);
+
+  ~SparkCoordinator() override = default;
+
+  // interface updates of a shard, only holding its interfaces, for its Spark
+  // to read. Readers must be created before the coordinator runs
+  messaging::RQueue<thrift::InterfaceDatabase> getInterfaceUpdatesReader(
+      size_t shard);
+
+  size_t
+  getNumShards() const {
+    return shardQueues_.size();
+  }
+
+  // shard running the interface
+  static size_t getShard(std::string const& ifName, size_t numShards);
+
+  // name of the thread of a shard, "Spark" for the first one
+  static std::string getShardName(size_t shard);
+
+  // override eventloop stop()
+  void stop() override;
+
+ private:
+  // SparkCoordinator is non-copyable
+  SparkCoordinator(SparkCoordinator const&) = delete;
+  SparkCoordinator& operator=(SparkCoordinator const&) = delete;
+
+  // forward the interfaces of each shard. Full snapshots go to every shard,
+  // deltas only to the shards of the interfaces they touch
+  void processInterfaceUpdates(thrift::InterfaceDatabase const& ifDb);
+
+  std::vector<
+      std::unique_ptr<messaging::ReplicateQueue<thrift::InterfaceDatabase>>>
+      shardQueues_;
+
+  // sequence number of the last update sent to each shard, deltas of a
+  // shard follow each other
+  std::vector<int64_t> shardSeqNums_;
+};
+
+} // namespace openr
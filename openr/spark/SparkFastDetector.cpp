@@ -0,0 +1,465 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/spark/SparkFastDetector.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/futures/Promise.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+constexpr uint8_t SparkFastDetector::Packet::kFlagDown;
+
+namespace {
+
+// "ORFD", Open/R fast detection
+const uint32_t kPacketMagic = 0x4f524644;
+const uint8_t kPacketVersion = 1;
+const size_t kPacketHeaderSize = 16;
+const size_t kMaxNodeNameLen = 255;
+
+// GTSM, packets must come from a direct neighbor
+const int kFastDetectionHopLimit = 255;
+
+// max number of packets to receive with one recvmmsg
+const size_t kRecvBatchSize = 64;
+
+// tick of the timer wheel, much shorter than any detection time
+const std::chrono::milliseconds kTimerWheelTick{1};
+
+template <typename T>
+void
+appendInt(std::string& buf, T value) {
+  buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T
+readInt(std::string const& buf, size_t offset) {
+  T value;
+  memcpy(&value, buf.data() + offset, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+SparkFastDetector::SparkFastDetector(
+    std::string const& myNodeName,
+    uint16_t udpPort,
+    std::vector<SparkFastDetectionConfig> configs,
+    folly::Optional<int> maybeIpTos,
+    std::shared_ptr<IoProvider> ioProvider,
+    NeighborDownCallback neighborDownCb)
+    : myNodeName_(myNodeName),
+      udpPort_(udpPort),
+      ioProvider_(std::move(ioProvider)),
+      neighborDownCb_(std::move(neighborDownCb)) {
+  CHECK(ioProvider_) << "Got null IoProvider";
+  CHECK(neighborDownCb_);
+  CHECK_LE(myNodeName_.size(), kMaxNodeNameLen) << "Node name is too long";
+
+  for (auto& config : configs) {
+    CHECK_LT(0, config.txInterval.count());
+    CHECK_LT(0, config.multiplier);
+    auto regex = std::make_unique<re2::RE2>(config.ifNameRegex);
+    CHECK(regex->ok()) << "Invalid interface regex " << config.ifNameRegex;
+    configs_.emplace_back(std::move(regex), std::move(config));
+  }
+
+  prepareSocket(maybeIpTos);
+
+  // transmit and detection timers share a timer wheel, advanced by a single
+  // event loop timeout. Packets of all transmit timers due are sent in a batch
+  timerWheelTimeout_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
+    timerWheel_->expire(TimerWheel::Clock::now());
+    flushPackets();
+  });
+  timerWheel_ = std::make_unique<TimerWheel>(
+      kTimerWheelTick, [this](TimerWheel::Clock::time_point wakeupTime) {
+        // round up, the wheel must not be advanced before wakeupTime
+        timerWheelTimeout_->scheduleTimeout(
+            std::chrono::ceil<std::chrono::milliseconds>(std::max(
+                wakeupTime - TimerWheel::Clock::now(),
+                TimerWheel::Clock::duration(0))));
+      });
+
+  addSocketFd(fd_, ZMQ_POLLIN, [this](int) noexcept {
+    try {
+      processPackets();
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Error receiving fast detection packets "
+                 << folly::exceptionStr(err);
+    }
+  });
+}
+
+SparkFastDetector::~SparkFastDetector() {
+  // drop timers before the wheel
+  sessions_.clear();
+}
+
+void
+SparkFastDetector::prepareSocket(folly::Optional<int> maybeIpTos) {
+  fd_ = ioProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd_ < 0) {
+    LOG(FATAL) << "Failed creating fast detection UDP socket. Error: "
+               << folly::errnoStr(errno);
+  }
+  LOG(INFO) << "Created UDP socket for fast failure detection. fd: " << fd_;
+
+  if (ioProvider_->fcntl(fd_, F_SETFL, O_NONBLOCK) != 0) {
+    LOG(FATAL) << "Failed making the socket non-blocking. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  const int enabled = 1;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_V6ONLY, &enabled, sizeof(enabled)) != 0) {
+    LOG(FATAL) << "Failed making the socket v6 only. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // input iface index and hop limit of received packets
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_RECVPKTINFO, &enabled, sizeof(enabled)) !=
+      0) {
+    LOG(FATAL) << "Failed enabling PKTINFO option. Error: "
+               << folly::errnoStr(errno);
+  }
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_RECVHOPLIMIT, &enabled, sizeof(enabled)) !=
+      0) {
+    LOG(FATAL) << "Failed enabling TTL receive on socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // send with max hop limit, so that the neighbor can check for spoofing
+  const int hopLimit = kFastDetectionHopLimit;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &hopLimit, sizeof(hopLimit)) !=
+      0) {
+    LOG(FATAL) << "Failed setting TTL on socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  if (maybeIpTos) {
+    const int ipTos = *maybeIpTos;
+    if (ioProvider_->setsockopt(
+            fd_, IPPROTO_IPV6, IPV6_TCLASS, &ipTos, sizeof(ipTos)) != 0) {
+      LOG(FATAL) << "Failed setting ip-tos value on socket. Error: "
+                 << folly::errnoStr(errno);
+    }
+  }
+
+  auto sockAddr = folly::SocketAddress(folly::IPAddress("::"), udpPort_);
+  sockaddr_storage addrStorage;
+  sockAddr.getAddress(&addrStorage);
+  if (ioProvider_->bind(
+          fd_,
+          reinterpret_cast<sockaddr*>(&addrStorage),
+          sockAddr.getActualSize()) != 0) {
+    LOG(FATAL) << "Failed binding the socket. Error: "
+               << folly::errnoStr(errno);
+  }
+}
+
+folly::Expected<std::vector<SparkFastDetectionConfig>, std::string>
+SparkFastDetector::parseConfigs(std::string const& str) {
+  std::vector<SparkFastDetectionConfig> configs;
+  std::vector<std::string> items;
+  folly::split(",", str, items, true /* ignore empty */);
+  for (auto const& item : items) {
+    // regex may contain ':', split from the end
+    const auto multiplierPos = item.rfind(':');
+    auto intervalPos = std::string::npos;
+    if (multiplierPos != std::string::npos and multiplierPos > 0) {
+      intervalPos = item.rfind(':', multiplierPos - 1);
+    }
+    if (intervalPos == std::string::npos or intervalPos == 0) {
+      return folly::makeUnexpected(
+          "Expected <ifNameRegex>:<txIntervalMs>:<multiplier>, got " + item);
+    }
+
+    auto interval = folly::tryTo<uint16_t>(
+        item.substr(intervalPos + 1, multiplierPos - intervalPos - 1));
+    auto multiplier = folly::tryTo<uint8_t>(item.substr(multiplierPos + 1));
+    if (interval.hasError() or *interval == 0 or multiplier.hasError() or
+        *multiplier == 0) {
+      return folly::makeUnexpected("Invalid interval or multiplier in " + item);
+    }
+
+    SparkFastDetectionConfig config;
+    config.ifNameRegex = item.substr(0, intervalPos);
+    config.txInterval = std::chrono::milliseconds(*interval);
+    config.multiplier = *multiplier;
+    if (not re2::RE2(config.ifNameRegex).ok()) {
+      return folly::makeUnexpected(
+          "Invalid interface regex " + config.ifNameRegex);
+    }
+    configs.emplace_back(std::move(config));
+  }
+  return configs;
+}
+
+std::string
+SparkFastDetector::encodePacket(Packet const& packet) {
+  CHECK_LE(packet.nodeName.size(), kMaxNodeNameLen);
+  std::string buf;
+  buf.reserve(kPacketHeaderSize + packet.nodeName.size());
+  appendInt<uint32_t>(buf, htonl(kPacketMagic));
+  appendInt<uint8_t>(buf, kPacketVersion);
+  appendInt<uint8_t>(buf, packet.flags);
+  appendInt<uint16_t>(
+      buf, htons(static_cast<uint16_t>(packet.txInterval.count())));
+  appendInt<uint8_t>(buf, packet.multiplier);
+  appendInt<uint8_t>(buf, static_cast<uint8_t>(packet.nodeName.size()));
+  appendInt<uint16_t>(buf, 0 /* reserved */);
+  appendInt<uint32_t>(buf, htonl(packet.seqNum));
+  buf.append(packet.nodeName);
+  return buf;
+}
+
+folly::Optional<SparkFastDetector::Packet>
+SparkFastDetector::decodePacket(std::string const& data) {
+  if (data.size() < kPacketHeaderSize or
+      ntohl(readInt<uint32_t>(data, 0)) != kPacketMagic or
+      readInt<uint8_t>(data, 4) != kPacketVersion) {
+    return folly::none;
+  }
+  const size_t nameLen = readInt<uint8_t>(data, 9);
+  if (data.size() != kPacketHeaderSize + nameLen) {
+    return folly::none;
+  }
+
+  Packet packet;
+  packet.flags = readInt<uint8_t>(data, 5);
+  packet.txInterval =
+      std::chrono::milliseconds(ntohs(readInt<uint16_t>(data, 6)));
+  packet.multiplier = readInt<uint8_t>(data, 8);
+  packet.seqNum = ntohl(readInt<uint32_t>(data, 12));
+  packet.nodeName = data.substr(kPacketHeaderSize, nameLen);
+  if (packet.txInterval.count() == 0 or packet.multiplier == 0) {
+    return folly::none;
+  }
+  return packet;
+}
+
+folly::Optional<SparkFastDetectionConfig>
+SparkFastDetector::getConfig(std::string const& ifName) const {
+  for (auto const& kv : configs_) {
+    if (re2::RE2::FullMatch(ifName, *kv.first)) {
+      return kv.second;
+    }
+  }
+  return folly::none;
+}
+
+void
+SparkFastDetector::addNeighbor(
+    std::string const& ifName,
+    int ifIndex,
+    std::string const& neighborName,
+    folly::IPAddressV6 const& srcAddr,
+    folly::IPAddressV6 const& dstAddr) {
+  auto config = getConfig(ifName);
+  if (not config.hasValue()) {
+    return;
+  }
+
+  runInEventBaseThread([this,
+                        ifName,
+                        ifIndex,
+                        neighborName,
+                        srcAddr,
+                        dstAddr,
+                        config = std::move(config).value()]() mutable {
+    SessionKey key{ifName, neighborName};
+    sessions_.erase(key);
+    ifIndexToName_[ifIndex] = ifName;
+
+    auto& session = sessions_[key];
+    session.config = std::move(config);
+    session.txMessage.ifIndex = ifIndex;
+    session.txMessage.srcAddr = srcAddr;
+    session.txMessage.dstAddr = folly::SocketAddress(dstAddr, udpPort_);
+    session.txTimer = timerWheel_->makeTimer([this, &session]() noexcept {
+      queuePacket(session);
+    });
+    session.detectTimer = timerWheel_->makeTimer([this, key]() noexcept {
+      processDetectTimeout(key);
+    });
+
+    // start sending right away, detection starts with the first packet
+    // received from the neighbor
+    queuePacket(session);
+    flushPackets();
+    session.txTimer->scheduleTimeout(
+        session.config.txInterval, true /* isPeriodic */);
+
+    LOG(INFO) << "Started fast failure detection of neighbor " << neighborName
+              << " on " << ifName << " every "
+              << session.config.txInterval.count() << "ms";
+    tData_.addStatValue("spark.fast_detection.session_added", 1, fbzmq::SUM);
+  });
+}
+
+void
+SparkFastDetector::removeNeighbor(
+    std::string const& ifName, std::string const& neighborName) {
+  runInEventBaseThread([this, ifName, neighborName]() {
+    auto it = sessions_.find(SessionKey{ifName, neighborName});
+    if (it == sessions_.end()) {
+      return;
+    }
+
+    // let the neighbor know right away, so that it doesn't declare us down
+    queuePacket(it->second, Packet::kFlagDown);
+    flushPackets();
+    sessions_.erase(it);
+
+    LOG(INFO) << "Stopped fast failure detection of neighbor " << neighborName
+              << " on " << ifName;
+    tData_.addStatValue(
+        "spark.fast_detection.session_removed", 1, fbzmq::SUM);
+  });
+}
+
+std::unordered_map<std::string, int64_t>
+SparkFastDetector::getCounters() {
+  folly::Promise<std::unordered_map<std::string, int64_t>> promise;
+  auto future = promise.getFuture();
+  runInEventBaseThread([this, promise = std::move(promise)]() mutable {
+    auto counters = tData_.getCounters();
+    counters["spark.fast_detection.num_sessions"] = sessions_.size();
+    promise.setValue(std::move(counters));
+  });
+  return std::move(future).get();
+}
+
+void
+SparkFastDetector::queuePacket(Session& session, uint8_t flags) {
+  Packet packet;
+  packet.flags = flags;
+  packet.txInterval = session.config.txInterval;
+  packet.multiplier = session.config.multiplier;
+  packet.seqNum = session.txSeqNum++;
+  packet.nodeName = myNodeName_;
+
+  auto message = session.txMessage;
+  message.packet = encodePacket(packet);
+  pendingPackets_.emplace_back(std::move(message));
+}
+
+void
+SparkFastDetector::flushPackets() {
+  if (pendingPackets_.empty()) {
+    return;
+  }
+
+  auto bytesSent =
+      IoProvider::sendMessages(fd_, pendingPackets_, ioProvider_.get());
+  for (size_t i = 0; i < pendingPackets_.size(); ++i) {
+    if (bytesSent[i] < 0 or
+        static_cast<size_t>(bytesSent[i]) != pendingPackets_[i].packet.size()) {
+      VLOG(1) << "Sending fast detection packet to "
+              << pendingPackets_[i].dstAddr.getAddressStr() << " failed";
+      tData_.addStatValue(
+          "spark.fast_detection.packets_send_failed", 1, fbzmq::SUM);
+    }
+  }
+  tData_.addStatValue(
+      "spark.fast_detection.packets_sent", pendingPackets_.size(), fbzmq::SUM);
+  pendingPackets_.clear();
+}
+
+void
+SparkFastDetector::processPackets() {
+  auto messages = IoProvider::recvMessages(
+      fd_, kRecvBatchSize, kPacketHeaderSize + kMaxNodeNameLen,
+      ioProvider_.get());
+  for (auto const& message : messages) {
+    processPacket(message);
+  }
+  // packets queued by sessions which got removed or restarted
+  flushPackets();
+}
+
+void
+SparkFastDetector::processPacket(IoProvider::ReceivedMessage const& message) {
+  tData_.addStatValue("spark.fast_detection.packets_recv", 1, fbzmq::SUM);
+
+  if (message.hopLimit < kFastDetectionHopLimit) {
+    tData_.addStatValue(
+        "spark.fast_detection.packets_dropped", 1, fbzmq::SUM);
+    return;
+  }
+  auto packet = decodePacket(message.data);
+  if (not packet.hasValue()) {
+    tData_.addStatValue(
+        "spark.fast_detection.packets_dropped", 1, fbzmq::SUM);
+    return;
+  }
+  auto ifIt = ifIndexToName_.find(message.ifIndex);
+  if (ifIt == ifIndexToName_.end()) {
+    tData_.addStatValue(
+        "spark.fast_detection.packets_dropped", 1, fbzmq::SUM);
+    return;
+  }
+  auto it = sessions_.find(SessionKey{ifIt->second, packet->nodeName});
+  if (it == sessions_.end()) {
+    // neighbor not monitored (yet)
+    return;
+  }
+
+  auto& session = it->second;
+  if (packet->flags & Packet::kFlagDown) {
+    // neighbor stopped monitoring us, regular heartbeats take over until
+    // Spark adds it again
+    VLOG(1) << "Neighbor " << packet->nodeName << " on " << ifIt->second
+            << " stopped fast failure detection";
+    session.isUp = false;
+    session.detectTimer->cancelTimeout();
+    return;
+  }
+
+  if (not session.isUp) {
+    LOG(INFO) << "Neighbor " << packet->nodeName << " on " << ifIt->second
+              << " supports fast failure detection, starting detection";
+    session.isUp = true;
+  }
+
+  // detection time as negotiated by BFD
+  const auto detectTime = packet->multiplier *
+      std::max(packet->txInterval, session.config.txInterval);
+  session.detectTimer->scheduleTimeout(detectTime);
+}
+
+void
+SparkFastDetector::processDetectTimeout(SessionKey const& key) {
+  auto it = sessions_.find(key);
+  CHECK(it != sessions_.end());
+
+  LOG(INFO) << "Fast failure detection timer expired for: " << key.second
+            << " on interface " << key.first;
+  tData_.addStatValue("spark.fast_detection.neighbor_down", 1, fbzmq::SUM);
+
+  // neighbor gets added again once Spark re-establishes the adjacency. This
+  // destroys the timer whose callback we're in, don't touch key afterwards
+  const auto ifName = key.first;
+  const auto neighborName = key.second;
+  sessions_.erase(it);
+  neighborDownCb_(ifName, neighborName);
+}
+
+} // namespace openr
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fbzmq/async/ZmqTimeout.h>
+#include <fbzmq/service/stats/ThreadData.h>
+#include <folly/Expected.h>
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <re2/re2.h>
+
+#include <openr/common/OpenrEventBase.h>
+#include <openr/spark/IoProvider.h>
+#include <openr/spark/TimerWheel.h>
+
+namespace openr {
+
+//
+// Fast failure detection parameters of the interfaces matching ifNameRegex.
+// A neighbor is declared down when none of its packets was received for
+// multiplier times the larger of both sides' txInterval
+//
+struct SparkFastDetectionConfig {
+  std::string ifNameRegex;
+  std::chrono::milliseconds txInterval{0};
+  uint8_t multiplier{0};
+};
+
+//
+// BFD-like fast failure detection of Spark2 neighbors, running on its own
+// thread so that detection times of tens of milliseconds don't depend on the
+// load of the Spark thread.
+//
+// Spark hands over every neighbor reaching ESTABLISHED on an interface with
+// fast detection enabled. The detector then exchanges small fixed format
+// packets with it over unicast UDP, every txInterval. Transmit and detection
+// timers live in a timer wheel, and packets due in the same tick are sent out
+// with a single sendmmsg. Detection only starts with the first packet
+// received from the neighbor, so that neighbors without fast detection are
+// left to the regular heartbeats.
+//
+// When a neighbor's detection time expires, it is no longer monitored and
+// the neighbor down callback gets called from the detector thread.
+//
+class SparkFastDetector final : public OpenrEventBase {
+ public:
+  using NeighborDownCallback = std::function<void(
+      std::string const& ifName, std::string const& neighborName)>;
+
+  // fast detection packet, all integers are in network byte order on the
+  // wire:
+  //   magic(4) version(1) flags(1) txIntervalMs(2) multiplier(1)
+  //   nameLen(1) reserved(2) seqNum(4) nodeName(nameLen)
+  struct Packet {
+    // sender stops monitoring us, e.g. adjacency is going down gracefully
+    static constexpr uint8_t kFlagDown = 0x1;
+
+    uint8_t flags{0};
+    std::chrono::milliseconds txInterval{0};
+    uint8_t multiplier{0};
+    uint32_t seqNum{0};
+    std::string nodeName;
+  };
+
+  SparkFastDetector(
+      std::string const& myNodeName,
+      uint16_t udpPort,
+      std::vector<SparkFastDetectionConfig> configs,
+      folly::Optional<int> maybeIpTos,
+      std::shared_ptr<IoProvider> ioProvider,
+      NeighborDownCallback neighborDownCb);
+
+  ~SparkFastDetector() override;
+
+  // parse comma separated <ifNameRegex>:<txIntervalMs>:<multiplier> configs
+  static folly::Expected<std::vector<SparkFastDetectionConfig>, std::string>
+  parseConfigs(std::string const& str);
+
+  static std::string encodePacket(Packet const& packet);
+  static folly::Optional<Packet> decodePacket(std::string const& data);
+
+  // detection parameters of ifName, none if fast detection is not enabled on
+  // it. First matching config wins. Thread safe
+  folly::Optional<SparkFastDetectionConfig> getConfig(
+      std::string const& ifName) const;
+
+  //
+  // Start/stop monitoring neighborName on ifName, reachable at dstAddr from
+  // srcAddr. Neighbors of interfaces without fast detection are ignored.
+  // Thread safe
+  //
+  void addNeighbor(
+      std::string const& ifName,
+      int ifIndex,
+      std::string const& neighborName,
+      folly::IPAddressV6 const& srcAddr,
+      folly::IPAddressV6 const& dstAddr);
+  void removeNeighbor(
+      std::string const& ifName, std::string const& neighborName);
+
+  // get counters, thread safe
+  std::unordered_map<std::string, int64_t> getCounters();
+
+ private:
+  struct Session {
+    SparkFastDetectionConfig config;
+    IoProvider::OutgoingMessage txMessage;
+    uint32_t txSeqNum{0};
+    // detection started, i.e. we heard from the neighbor
+    bool isUp{false};
+    std::unique_ptr<TimerWheel::Timer> txTimer;
+    std::unique_ptr<TimerWheel::Timer> detectTimer;
+  };
+
+  using SessionKey =
+      std::pair<std::string /* ifName */, std::string /* neighborName */>;
+
+  SparkFastDetector(SparkFastDetector const&) = delete;
+  SparkFastDetector& operator=(SparkFastDetector const&) = delete;
+
+  // create and bind the UDP socket
+  void prepareSocket(folly::Optional<int> maybeIpTos);
+
+  // queue packet of session for the next batch
+  void queuePacket(Session& session, uint8_t flags = 0);
+
+  // send all queued packets with as few syscalls as possible
+  void flushPackets();
+
+  // receive a batch of packets and process them
+  void processPackets();
+
+  void processPacket(IoProvider::ReceivedMessage const& message);
+
+  void processDetectTimeout(SessionKey const& key);
+
+  const std::string myNodeName_;
+  const uint16_t udpPort_{0};
+  std::vector<std::pair<std::unique_ptr<re2::RE2>, SparkFastDetectionConfig>>
+      configs_;
+  std::shared_ptr<IoProvider> ioProvider_;
+  const NeighborDownCallback neighborDownCb_;
+
+  int fd_{-1};
+
+  // timer wheel of all transmit and detection timers, and the event loop
+  // timeout driving it. Declared ahead of sessions_ to outlive their timers
+  std::unique_ptr<fbzmq::ZmqTimeout> timerWheelTimeout_;
+  std::unique_ptr<TimerWheel> timerWheel_;
+
+  // packets due, sent out after the timer wheel is advanced
+  std::vector<IoProvider::OutgoingMessage> pendingPackets_;
+
+  // monitored neighbors
+  std::map<SessionKey, Session> sessions_;
+
+  // interfaces of monitored neighbors, packets are received by ifIndex
+  std::unordered_map<int /* ifIndex */, std::string /* ifName */>
+      ifIndexToName_;
+
+  // thread data for counters
+  fbzmq::ThreadData tData_;
+};
+
+} // namespace openr
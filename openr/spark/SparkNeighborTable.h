@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+/**
+ * Neighbors of Spark by interface and neighbor name, kept in a table of
+ * slots. Slots are reused once freed and never move, references to a
+ * neighbor stay valid until it is erased.
+ *
+ * An interface only has a handful of neighbors, mostly one, so the slots of
+ * an interface are kept in a small array scanned by name. Finding a neighbor
+ * costs the hash of the interface name instead of a hash per level of
+ * nested maps and a walk through their nodes.
+ */
+template <typename Neighbor>
+class SparkNeighborTable {
+ public:
+  // track an interface, no-op if tracked
+  void
+  addInterface(std::string const& ifName) {
+    interfaces_.emplace(ifName, std::vector<size_t>{});
+  }
+
+  bool
+  hasInterface(std::string const& ifName) const {
+    return interfaces_.count(ifName) != 0;
+  }
+
+  // stop tracking an interface along with its neighbors
+  void
+  eraseInterface(std::string const& ifName) {
+    auto it = interfaces_.find(ifName);
+    if (it == interfaces_.end()) {
+      return;
+    }
+    for (auto slot : it->second) {
+      freeSlot(slot);
+    }
+    interfaces_.erase(it);
+  }
+
+  // neighbor on interface, nullptr if not tracked
+  Neighbor*
+  find(std::string const& ifName, std::string const& nodeName) {
+    auto it = interfaces_.find(ifName);
+    if (it == interfaces_.end()) {
+      return nullptr;
+    }
+    for (auto slot : it->second) {
+      if (slots_[slot].nodeName == nodeName) {
+        return &slots_[slot].neighbor.value();
+      }
+    }
+    return nullptr;
+  }
+
+  // neighbor on interface, throws std::out_of_range if not tracked
+  Neighbor&
+  at(std::string const& ifName, std::string const& nodeName) {
+    auto neighbor = find(ifName, nodeName);
+    if (not neighbor) {
+      throw std::out_of_range(
+          "No neighbor " + nodeName + " on interface " + ifName);
+    }
+    return *neighbor;
+  }
+
+  // track a neighbor on a tracked interface, it must not be tracked already
+  template <typename... Args>
+  Neighbor&
+  emplace(
+      std::string const& ifName, std::string const& nodeName, Args&&... args) {
+    auto& ifSlots = interfaces_.at(ifName);
+    size_t slot;
+    if (freeSlots_.empty()) {
+      slot = slots_.size();
+      slots_.emplace_back();
+    } else {
+      slot = freeSlots_.back();
+      freeSlots_.pop_back();
+    }
+    auto& entry = slots_[slot];
+    entry.nodeName = nodeName;
+    entry.neighbor.emplace(std::forward<Args>(args)...);
+    ifSlots.emplace_back(slot);
+    ++numNeighbors_;
+    return entry.neighbor.value();
+  }
+
+  // Returns whether the neighbor was tracked
+  bool
+  erase(std::string const& ifName, std::string const& nodeName) {
+    auto it = interfaces_.find(ifName);
+    if (it == interfaces_.end()) {
+      return false;
+    }
+    auto& ifSlots = it->second;
+    for (size_t i = 0; i < ifSlots.size(); ++i) {
+      if (slots_[ifSlots[i]].nodeName == nodeName) {
+        freeSlot(ifSlots[i]);
+        ifSlots[i] = ifSlots.back();
+        ifSlots.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // call f(nodeName, neighbor) for the neighbors of an interface. f must not
+  // add or erase neighbors
+  template <typename F>
+  void
+  forEachNeighbor(std::string const& ifName, F&& f) {
+    auto it = interfaces_.find(ifName);
+    if (it == interfaces_.end()) {
+      return;
+    }
+    for (auto slot : it->second) {
+      f(slots_[slot].nodeName, slots_[slot].neighbor.value());
+    }
+  }
+
+  template <typename F>
+  void
+  forEachNeighbor(std::string const& ifName, F&& f) const {
+    auto it = interfaces_.find(ifName);
+    if (it == interfaces_.end()) {
+      return;
+    }
+    for (auto slot : it->second) {
+      f(slots_[slot].nodeName, slots_[slot].neighbor.value());
+    }
+  }
+
+  // call f(ifName, nodeName, neighbor) for all neighbors
+  template <typename F>
+  void
+  forEachNeighbor(F&& f) const {
+    for (auto const& kv : interfaces_) {
+      for (auto slot : kv.second) {
+        f(kv.first, slots_[slot].nodeName, slots_[slot].neighbor.value());
+      }
+    }
+  }
+
+  size_t
+  getNumNeighbors(std::string const& ifName) const {
+    auto it = interfaces_.find(ifName);
+    return it == interfaces_.end() ? 0 : it->second.size();
+  }
+
+  size_t
+  getNumNeighbors() const {
+    return numNeighbors_;
+  }
+
+  size_t
+  getNumInterfaces() const {
+    return interfaces_.size();
+  }
+
+ private:
+  struct Slot {
+    std::string nodeName;
+    folly::Optional<Neighbor> neighbor;
+  };
+
+  void
+  freeSlot(size_t slot) {
+    // destroys the neighbor and its timers
+    slots_[slot].neighbor.reset();
+    slots_[slot].nodeName.clear();
+    freeSlots_.emplace_back(slot);
+    --numNeighbors_;
+  }
+
+  // slots, a deque so that they never move
+  std::deque<Slot> slots_;
+  std::vector<size_t> freeSlots_;
+  size_t numNeighbors_{0};
+
+  // slots of the neighbors of each interface
+  std::unordered_map<std::string, std::vector<size_t>> interfaces_;
+};
+
+} // namespace openr
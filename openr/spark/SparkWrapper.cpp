@@ -7,6 +7,10 @@
 
 #include "SparkWrapper.h"
 
+#include <time.h>
+
+#include <folly/futures/Promise.h>
+
 using namespace fbzmq;
 
 namespace openr {
@@ -26,7 +30,8 @@ SparkWrapper::SparkWrapper(
     folly::Optional<std::unordered_set<std::string>> areas,
     bool enableSpark2,
     bool increaseHelloInterval,
-    SparkTimeConfig timeConfig)
+    SparkTimeConfig timeConfig,
+    PersistentStore* configStore)
     : myNodeName_(myNodeName) {
   spark_ = std::make_shared<Spark>(
       myDomainName,
@@ -55,7 +60,13 @@ SparkWrapper::SparkWrapper(
       true,
       enableSpark2,
       increaseHelloInterval,
-      areas);
+      areas,
+      {} /* fastDetectionConfigs */,
+      0 /* fastDetectionPort */,
+      timeConfig.myHelloMaxTime,
+      folly::none /* shardId */,
+      nullptr /* runtimeKnobs */,
+      configStore);
 
   // start spark
   run();
@@ -86,9 +97,8 @@ SparkWrapper::stop() {
 bool
 SparkWrapper::updateInterfaceDb(
     const std::vector<SparkInterfaceEntry>& interfaceEntries) {
-  thrift::InterfaceDatabase ifDb(
-      apache::thrift::FRAGILE, myNodeName_, {}, thrift::PerfEvents());
-  ifDb.perfEvents = folly::none;
+  thrift::InterfaceDatabase ifDb;
+  ifDb.thisNodeName = myNodeName_;
 
   for (const auto& interface : interfaceEntries) {
     ifDb.interfaces.emplace(
@@ -153,6 +163,33 @@ SparkWrapper::waitForEvent(
   return folly::none;
 }
 
+std::chrono::nanoseconds
+SparkWrapper::getThreadCpuTime() {
+  folly::Promise<std::chrono::nanoseconds> promise;
+  auto future = promise.getFuture();
+  spark_->runInEventBaseThread([promise = std::move(promise)]() mutable {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    promise.setValue(
+        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+  });
+  return std::move(future).get();
+}
+
+std::chrono::microseconds
+SparkWrapper::getEventLoopLag() {
+  folly::Promise<std::chrono::microseconds> promise;
+  auto future = promise.getFuture();
+  const auto postTime = std::chrono::steady_clock::now();
+  spark_->runInEventBaseThread(
+      [promise = std::move(promise), postTime]() mutable {
+        promise.setValue(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - postTime));
+      });
+  return std::move(future).get();
+}
+
 std::pair<folly::IPAddress, folly::IPAddress>
 SparkWrapper::getTransportAddrs(const thrift::SparkNeighborEvent& event) {
   return {toIPAddress(event.neighbor.transportAddressV4),
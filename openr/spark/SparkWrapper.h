@@ -30,13 +30,15 @@ struct SparkTimeConfig {
       std::chrono::milliseconds negotiateHoldTime =
           std::chrono::milliseconds{0},
       std::chrono::milliseconds heartbeatHoldTime =
-          std::chrono::milliseconds{0})
+          std::chrono::milliseconds{0},
+      std::chrono::milliseconds helloMaxTime = std::chrono::milliseconds{0})
       : myHelloTime(helloTime),
         myHelloFastInitTime(helloFastInitTime),
         myHandshakeTime(handshakeTime),
         myHeartbeatTime(heartbeatTime),
         myNegotiateHoldTime(negotiateHoldTime),
-        myHeartbeatHoldTime(heartbeatHoldTime) {}
+        myHeartbeatHoldTime(heartbeatHoldTime),
+        myHelloMaxTime(helloMaxTime) {}
 
   std::chrono::milliseconds myHelloTime;
   std::chrono::milliseconds myHelloFastInitTime;
@@ -44,6 +46,7 @@ struct SparkTimeConfig {
   std::chrono::milliseconds myHeartbeatTime;
   std::chrono::milliseconds myNegotiateHoldTime;
   std::chrono::milliseconds myHeartbeatHoldTime;
+  std::chrono::milliseconds myHelloMaxTime;
 };
 
 /**
@@ -71,7 +74,8 @@ class SparkWrapper {
       folly::Optional<std::unordered_set<std::string>> areas,
       bool enableSpark2,
       bool increaseHelloInterval,
-      SparkTimeConfig timeConfig);
+      SparkTimeConfig timeConfig,
+      PersistentStore* configStore = nullptr);
 
   ~SparkWrapper();
 
@@ -105,6 +109,12 @@ class SparkWrapper {
     return spark_->getCounters();
   }
 
+  // CPU time consumed by the Spark thread so far
+  std::chrono::nanoseconds getThreadCpuTime();
+
+  // time it takes for the Spark thread to pick up a task posted to it
+  std::chrono::microseconds getEventLoopLag();
+
   static std::pair<folly::IPAddress, folly::IPAddress> getTransportAddrs(
       const thrift::SparkNeighborEvent& event);
 
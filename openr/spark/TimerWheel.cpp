@@ -0,0 +1,257 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/spark/TimerWheel.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+constexpr size_t TimerWheel::kNumSlots;
+
+namespace {
+
+constexpr size_t kBitsPerWord = 64;
+
+} // namespace
+
+TimerWheel::Timer::Timer(TimerWheel* wheel, Callback callback)
+    : wheel_(wheel), callback_(std::move(callback)) {
+  CHECK(wheel_);
+  CHECK(callback_);
+}
+
+TimerWheel::Timer::~Timer() {
+  cancelTimeout();
+}
+
+void
+TimerWheel::Timer::scheduleTimeout(
+    std::chrono::milliseconds timeout, bool isPeriodic) {
+  CHECK_LE(0, timeout.count());
+  period_ = isPeriodic ? timeout : std::chrono::milliseconds(0);
+  wheel_->schedule(this, Clock::now() + timeout);
+}
+
+void
+TimerWheel::Timer::cancelTimeout() {
+  period_ = std::chrono::milliseconds(0);
+  wheel_->unlink(this);
+}
+
+TimerWheel::TimerWheel(
+    std::chrono::milliseconds tick,
+    WakeupCallback wakeupCb,
+    Clock::time_point startTime)
+    : tick_(tick),
+      wakeupCb_(std::move(wakeupCb)),
+      startTime_(startTime),
+      slots_(kNumSlots, nullptr),
+      occupied_(kNumSlots / kBitsPerWord, 0) {
+  CHECK_LT(0, tick_.count());
+  static_assert(kNumSlots % kBitsPerWord == 0, "slots must fill the bitmap");
+}
+
+TimerWheel::~TimerWheel() {
+  // timers are expected to be gone by now, detach the remaining ones
+  for (auto head : slots_) {
+    for (auto timer = head; timer; timer = timer->next_) {
+      timer->state_ = Timer::State::IDLE;
+    }
+  }
+  for (auto timer = firing_; timer; timer = timer->next_) {
+    timer->state_ = Timer::State::IDLE;
+  }
+}
+
+std::unique_ptr<TimerWheel::Timer>
+TimerWheel::makeTimer(Callback callback) {
+  return std::unique_ptr<Timer>(new Timer(this, std::move(callback)));
+}
+
+size_t
+TimerWheel::expire(Clock::time_point now) {
+  CHECK(not expiring_) << "expire() must not be called from a timer callback";
+  expiring_ = true;
+  wakeupTick_.reset();
+
+  // move all timers due by nowTick into the firing list. A whole turn of the
+  // wheel covers all slots, no need to go further
+  const uint64_t nowTick = getTickFloor(now);
+  Timer* firingTail{nullptr};
+  const uint64_t numTicks = std::min<uint64_t>(
+      nowTick > currentTick_ ? nowTick - currentTick_ : 0, kNumSlots);
+  for (uint64_t i = 1; i <= numTicks; ++i) {
+    const size_t slot = (currentTick_ + i) % kNumSlots;
+    for (auto timer = slots_[slot]; timer;) {
+      auto next = timer->next_;
+      if (timer->expiryTick_ <= nowTick) {
+        unlink(timer);
+        timer->state_ = Timer::State::FIRING;
+        timer->prev_ = firingTail;
+        timer->next_ = nullptr;
+        if (firingTail) {
+          firingTail->next_ = timer;
+        } else {
+          firing_ = timer;
+        }
+        firingTail = timer;
+      }
+      timer = next;
+    }
+  }
+  currentTick_ = std::max(currentTick_, nowTick);
+
+  // fire timers one by one, callbacks may re-arm, cancel or destroy any
+  // timer still in the firing list
+  size_t numFired{0};
+  while (firing_) {
+    auto timer = firing_;
+    unlink(timer);
+    if (timer->period_.count()) {
+      schedule(timer, now + timer->period_);
+    }
+    ++numFired;
+    timer->callback_();
+  }
+  expiring_ = false;
+
+  // timers (re)scheduled by callbacks didn't request wakeups
+  auto nextTick = getNextTick();
+  if (nextTick.has_value()) {
+    requestWakeup(*nextTick);
+  }
+  return numFired;
+}
+
+std::optional<TimerWheel::Clock::time_point>
+TimerWheel::getNextExpiryTime() const {
+  auto nextTick = getNextTick();
+  if (not nextTick.has_value()) {
+    return std::nullopt;
+  }
+  return getTime(*nextTick);
+}
+
+uint64_t
+TimerWheel::getTickCeil(Clock::time_point time) const {
+  if (time <= startTime_) {
+    return 0;
+  }
+  return static_cast<uint64_t>(
+      (time - startTime_ + tick_ - Clock::duration(1)) / tick_);
+}
+
+uint64_t
+TimerWheel::getTickFloor(Clock::time_point time) const {
+  if (time <= startTime_) {
+    return 0;
+  }
+  return static_cast<uint64_t>((time - startTime_) / tick_);
+}
+
+TimerWheel::Clock::time_point
+TimerWheel::getTime(uint64_t tick) const {
+  return startTime_ + tick * tick_;
+}
+
+void
+TimerWheel::schedule(Timer* timer, Clock::time_point expiryTime) {
+  unlink(timer);
+
+  // an idle wheel doesn't get advanced, catch up before scheduling so that
+  // the next expire() doesn't have to walk the whole wheel
+  if (size_ == 0 and not expiring_) {
+    currentTick_ = std::max(currentTick_, getTickFloor(Clock::now()));
+  }
+
+  timer->expiryTick_ = std::max(getTickCeil(expiryTime), currentTick_ + 1);
+  const size_t slot = timer->expiryTick_ % kNumSlots;
+  timer->state_ = Timer::State::SCHEDULED;
+  timer->prev_ = nullptr;
+  timer->next_ = slots_[slot];
+  if (timer->next_) {
+    timer->next_->prev_ = timer;
+  }
+  slots_[slot] = timer;
+  occupied_[slot / kBitsPerWord] |= uint64_t(1) << (slot % kBitsPerWord);
+  ++size_;
+
+  if (not expiring_) {
+    requestWakeup(timer->expiryTick_);
+  }
+}
+
+void
+TimerWheel::unlink(Timer* timer) {
+  if (timer->state_ == Timer::State::IDLE) {
+    return;
+  }
+
+  if (timer->next_) {
+    timer->next_->prev_ = timer->prev_;
+  }
+  if (timer->prev_) {
+    timer->prev_->next_ = timer->next_;
+  } else if (timer->state_ == Timer::State::FIRING) {
+    firing_ = timer->next_;
+  } else {
+    const size_t slot = timer->expiryTick_ % kNumSlots;
+    slots_[slot] = timer->next_;
+    if (not timer->next_) {
+      occupied_[slot / kBitsPerWord] &=
+          ~(uint64_t(1) << (slot % kBitsPerWord));
+    }
+  }
+  if (timer->state_ == Timer::State::SCHEDULED) {
+    --size_;
+  }
+
+  timer->state_ = Timer::State::IDLE;
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+}
+
+std::optional<uint64_t>
+TimerWheel::getNextTick() const {
+  if (size_ == 0) {
+    return std::nullopt;
+  }
+
+  // scan the bitmap from the slot after currentTick_, wrapping around once
+  const size_t startSlot = (currentTick_ + 1) % kNumSlots;
+  const size_t numWords = occupied_.size();
+  for (size_t i = 0; i <= numWords; ++i) {
+    const size_t word = (startSlot / kBitsPerWord + i) % numWords;
+    uint64_t bits = occupied_[word];
+    if (i == 0) {
+      // ignore slots before startSlot in its own word
+      bits &= ~uint64_t(0) << (startSlot % kBitsPerWord);
+    }
+    if (bits) {
+      const size_t slot = word * kBitsPerWord + __builtin_ctzll(bits);
+      return currentTick_ + 1 + (slot + kNumSlots - startSlot) % kNumSlots;
+    }
+  }
+  return std::nullopt;
+}
+
+void
+TimerWheel::requestWakeup(uint64_t tick) {
+  if (wakeupTick_.has_value() and *wakeupTick_ <= tick) {
+    return;
+  }
+  wakeupTick_ = tick;
+  if (wakeupCb_) {
+    wakeupCb_(getTime(tick));
+  }
+}
+
+} // namespace openr
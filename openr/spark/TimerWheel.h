@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace openr {
+
+//
+// Hashed timer wheel shared by many timers of a module, driven by a single
+// event loop timeout. Timers are kept in kNumSlots slots of one tick each,
+// a timer expiring at tick t living in slot (t % kNumSlots). Scheduling,
+// re-arming and cancelling a timer take constant time, and all timers due
+// by the time the wheel is advanced fire in one batch.
+//
+// The owner gets asked, through the wakeup callback, to call expire() at a
+// given time. It is expected to (re)schedule its one event loop timeout
+// accordingly, every wakeup request overriding the previous one.
+//
+// Timers fire on the first tick at or after their expiry time, never early.
+// A timer can be re-armed, cancelled or destroyed from any callback,
+// including its own one.
+//
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+  using WakeupCallback = std::function<void(Clock::time_point)>;
+
+  static constexpr size_t kNumSlots = 2048;
+
+  //
+  // Timer of the wheel, mirrors the API of fbzmq::ZmqTimeout. It is
+  // cancelled on destruction, and must not outlive its wheel
+  //
+  class Timer {
+   public:
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    // (re)arm the timer to fire after timeout, and then every timeout if
+    // periodic. Replaces any schedule it had
+    void scheduleTimeout(
+        std::chrono::milliseconds timeout, bool isPeriodic = false);
+
+    void cancelTimeout();
+
+    bool
+    isScheduled() const {
+      return state_ != State::IDLE;
+    }
+
+   private:
+    friend class TimerWheel;
+
+    enum class State {
+      IDLE = 0,
+      // linked in a slot of the wheel
+      SCHEDULED = 1,
+      // expired, linked in the list of timers about to fire
+      FIRING = 2,
+    };
+
+    Timer(TimerWheel* wheel, Callback callback);
+
+    TimerWheel* const wheel_{nullptr};
+    const Callback callback_;
+
+    State state_{State::IDLE};
+    std::chrono::milliseconds period_{0};
+    // tick at which the timer expires
+    uint64_t expiryTick_{0};
+
+    // timers of a slot, or of the firing list, form a doubly linked list
+    Timer* prev_{nullptr};
+    Timer* next_{nullptr};
+  };
+
+  explicit TimerWheel(
+      std::chrono::milliseconds tick,
+      WakeupCallback wakeupCb = nullptr,
+      Clock::time_point startTime = Clock::now());
+
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // create a new, unscheduled timer
+  std::unique_ptr<Timer> makeTimer(Callback callback);
+
+  // advance the wheel to now and fire all timers due by then. Returns the
+  // number of timers fired
+  size_t expire(Clock::time_point now);
+
+  // earliest time at which timers might be due, i.e. when expire() should be
+  // called next. None if no timer is scheduled
+  std::optional<Clock::time_point> getNextExpiryTime() const;
+
+  // number of scheduled timers
+  size_t
+  size() const {
+    return size_;
+  }
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  // first tick at or after time
+  uint64_t getTickCeil(Clock::time_point time) const;
+
+  // last tick at or before time
+  uint64_t getTickFloor(Clock::time_point time) const;
+
+  Clock::time_point getTime(uint64_t tick) const;
+
+  // schedule timer to expire at time
+  void schedule(Timer* timer, Clock::time_point expiryTime);
+
+  // remove timer from its slot or from the firing list
+  void unlink(Timer* timer);
+
+  // first tick after currentTick_ whose slot has timers
+  std::optional<uint64_t> getNextTick() const;
+
+  // ask the owner to call expire() at tick, unless it will do so earlier
+  void requestWakeup(uint64_t tick);
+
+  const std::chrono::milliseconds tick_;
+  const WakeupCallback wakeupCb_;
+  const Clock::time_point startTime_;
+
+  // last processed tick
+  uint64_t currentTick_{0};
+
+  // tick of the last wakeup requested, none if there is no pending request
+  std::optional<uint64_t> wakeupTick_;
+
+  // number of scheduled timers, firing ones excluded
+  size_t size_{0};
+
+  // heads of the slot lists and a bitmap of the non-empty slots
+  std::vector<Timer*> slots_;
+  std::vector<uint64_t> occupied_;
+
+  // expired timers about to fire, while expire() is running
+  Timer* firing_{nullptr};
+  bool expiring_{false};
+};
+
+} // namespace openr
@@ -71,7 +71,13 @@ MockIoProvider::bind(
 }
 
 ssize_t
-MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int /* flags */) {
+MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int flags) {
+  // TX timestamps are not emulated, error queue is always empty
+  if (flags & MSG_ERRQUEUE) {
+    errno = EAGAIN;
+    return -1;
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
 
   SCOPE_FAIL {
@@ -254,6 +260,60 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
   return -1;
 }
 
+int
+MockIoProvider::recvmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::recvmmsg called";
+
+  unsigned int numRead = 0;
+  for (; numRead < vlen; ++numRead) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = mailboxes_.find(sockFd);
+      if (it == mailboxes_.end() or it->second.empty()) {
+        break;
+      }
+      auto& ioMessage = it->second.front();
+      if (not ioMessage.clientNotified and not ioMessage.isActive()) {
+        break; // next message is not due yet
+      }
+    } // release lock, recvmsg acquires it
+
+    auto bytesRead = recvmsg(sockFd, &msgvec[numRead].msg_hdr, flags);
+    if (bytesRead < 0) {
+      break;
+    }
+    msgvec[numRead].msg_len = bytesRead;
+  }
+
+  if (numRead == 0) {
+    errno = EAGAIN;
+    return -1;
+  }
+  return numRead;
+}
+
+int
+MockIoProvider::sendmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::sendmmsg called";
+
+  unsigned int numSent = 0;
+  for (; numSent < vlen; ++numSent) {
+    auto bytesSent = sendmsg(sockFd, &msgvec[numSent].msg_hdr, flags);
+    if (bytesSent < 0) {
+      break;
+    }
+    msgvec[numSent].msg_len = bytesSent;
+  }
+
+  // like the syscall, fail only if no message could be sent
+  if (numSent == 0 and vlen > 0) {
+    return -1;
+  }
+  return numSent;
+}
+
 //
 // Simply accept all setsockopts, and build fd to ifName mapping
 //
@@ -317,29 +377,23 @@ MockIoProvider::processMailboxes() {
   VLOG(5) << "MockIoProvider::processMailboxes called";
 
   const uint8_t buf{1};
-  std::vector<int> writeFds;
-
-  // Find all writeFds to signal
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
 
-    for (auto& kv : mailboxes_) {
-      if (not kv.second.size()) {
-        continue; // no messages to read
-      }
+  // Signal on writeFd of all mailboxes with an active message. Signal is
+  // written under lock, so that recvmmsg never leaves a signal without a
+  // message behind when it drains messages which haven't been notified yet
+  std::lock_guard<std::mutex> lock(mutex_);
 
-      auto writeFd = pipeFds_.at(kv.first /* read-fd */);
-      auto& ioMessage = kv.second.front();
-      if (!ioMessage.clientNotified && ioMessage.isActive()) {
-        ioMessage.clientNotified = true;
-        writeFds.push_back(writeFd);
-      }
+  for (auto& kv : mailboxes_) {
+    if (not kv.second.size()) {
+      continue; // no messages to read
     }
-  } // release lock
 
-  // Signal on writeFd
-  for (auto& writeFd : writeFds) {
-    write(writeFd, &buf, sizeof(buf));
+    auto writeFd = pipeFds_.at(kv.first /* read-fd */);
+    auto& ioMessage = kv.second.front();
+    if (!ioMessage.clientNotified && ioMessage.isActive()) {
+      ioMessage.clientNotified = true;
+      write(writeFd, &buf, sizeof(buf));
+    }
   }
 }
 } // namespace openr
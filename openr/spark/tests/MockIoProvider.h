@@ -98,6 +98,14 @@ class MockIoProvider final : public IoProvider {
 
   ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) override;
 
+  // batched versions deliver and send messages one by one as above. Only
+  // messages which are due, as per their delay, are received
+  int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags)
+      override;
+
+  int sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags)
+      override;
+
   int setsockopt(
       int sockfd,
       int level,
@@ -9,6 +9,7 @@
 #include <thread>
 
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
@@ -1617,6 +1618,107 @@ TEST(MockIoProviderTestSetup, PartialMeshOfNodesTest) {
   mockIoProviderThread.join();
 }
 
+//
+// This test sends a batch of packets with IoProvider::sendMessages and
+// receives them with IoProvider::recvMessages along the follow topology.
+//
+// 3-node topology: 1 -> 2 (2-node unidirectional)
+//                  3 (1-node island)
+//
+TEST(MockIoProviderTestSetup, BatchedMessagesTest) {
+  folly::IPAddressV6 ipAddr1V6("fe80::1");
+  folly::IPAddressV6 ipAddr3V6("fe80::3");
+
+  std::string ifName1("iface1");
+  std::string ifName2("iface2");
+  std::string ifName3("iface3");
+
+  int ifIndex1 = 1;
+  int ifIndex2 = 2;
+  int ifIndex3 = 3;
+
+  auto mockIoProvider = std::make_shared<MockIoProvider>();
+
+  // Start mock IoProvider thread
+  std::thread mockIoProviderThread([&]() {
+    LOG(INFO) << "Starting mockIoProvider thread.";
+    mockIoProvider->start();
+    LOG(INFO) << "mockIoProvider thread got stopped.";
+  });
+  mockIoProvider->waitUntilRunning();
+
+  mockIoProvider->addIfNameIfIndex(
+      {{ifName1, ifIndex1}, {ifName2, ifIndex2}, {ifName3, ifIndex3}});
+
+  // Unidirectional connectivity from 1 to 2, while 3 just an island.
+  ConnectedIfPairs connectedPairs = {
+      {ifName1, {{ifName2, 10}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  int fd1 = createSocketAndJoinGroup(
+      mockIoProvider, ifIndex1, folly::IPAddress(kDiscardMulticastAddr));
+
+  int fd2 = createSocketAndJoinGroup(
+      mockIoProvider, ifIndex2, folly::IPAddress(kDiscardMulticastAddr));
+
+  createSocketAndJoinGroup(
+      mockIoProvider, ifIndex3, folly::IPAddress(kDiscardMulticastAddr));
+
+  // 4 packets from node1 and one from node3 in between, which has nowhere to
+  // go and must not hold the ones after it
+  std::vector<IoProvider::OutgoingMessage> messages;
+  for (int i = 0; i < 5; ++i) {
+    IoProvider::OutgoingMessage message;
+    message.ifIndex = i == 2 ? ifIndex3 : ifIndex1;
+    message.srcAddr = i == 2 ? ipAddr3V6 : ipAddr1V6;
+    message.dstAddr = folly::SocketAddress(
+        folly::IPAddress(kDiscardMulticastAddr), kMockedUdpPort);
+    message.packet = folly::sformat("This is batched message #{}.", i);
+    messages.emplace_back(std::move(message));
+  }
+
+  auto bytesSent =
+      IoProvider::sendMessages(fd1, messages, mockIoProvider.get());
+  ASSERT_EQ(messages.size(), bytesSent.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (i == 2) {
+      EXPECT_EQ(-1, bytesSent[i]);
+    } else {
+      EXPECT_EQ(messages[i].packet.size(), bytesSent[i]);
+    }
+  }
+
+  // Receive all packets by batches as they get delivered.
+  std::vector<IoProvider::ReceivedMessage> received;
+  while (received.size() < 4) {
+    waitForDataToRead(fd2);
+    auto batch = IoProvider::recvMessages(
+        fd2, 16 /* maxMessages */, kMinIpv6PktSize, mockIoProvider.get());
+    for (auto& message : batch) {
+      received.emplace_back(std::move(message));
+    }
+  }
+
+  ASSERT_EQ(4, received.size());
+  const std::vector<size_t> sentIndexes{0, 1, 3, 4};
+  for (size_t i = 0; i < received.size(); ++i) {
+    EXPECT_EQ(messages[sentIndexes[i]].packet, received[i].data);
+    EXPECT_EQ(ifIndex2, received[i].ifIndex);
+    EXPECT_EQ(255, received[i].hopLimit);
+    EXPECT_EQ(folly::IPAddress(ipAddr1V6), received[i].srcAddr.getIPAddress());
+  }
+
+  // Sanity check.
+  auto remaining = IoProvider::recvMessages(
+      fd2, 16 /* maxMessages */, kMinIpv6PktSize, mockIoProvider.get());
+  EXPECT_TRUE(remaining.empty());
+
+  // Cleanup
+  mockIoProvider->stop();
+  mockIoProviderThread.join();
+}
+
 int
 main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
@@ -25,6 +25,7 @@
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/spark/IoProvider.h>
 #include <openr/spark/SparkWrapper.h>
 #include <openr/spark/tests/MockIoProvider.h>
@@ -116,7 +117,8 @@ class Spark2Fixture : public testing::Test {
           kHandshakeTime,
           kHeartbeatTime,
           kNegotiateHoldTime,
-          kHeartbeatHoldTime)) {
+          kHeartbeatHoldTime),
+      PersistentStore* configStore = nullptr) {
     return std::make_unique<SparkWrapper>(
         domainName,
         myNodeName,
@@ -133,7 +135,8 @@ class Spark2Fixture : public testing::Test {
         folly::none, // no area support yet
         enableSpark2,
         increaseHelloInterval,
-        timeConfig);
+        timeConfig,
+        configStore);
   }
 
   fbzmq::Context context;
@@ -160,7 +163,25 @@ class SimpleSpark2Fixture : public Spark2Fixture {
     node1 = createSpark(kDomainName, "node-1", 1);
 
     // start another spark2 instance
-    node2 = createSpark(kDomainName, "node-2", 2);
+    node2 = createSpark(
+        kDomainName,
+        "node-2",
+        2,
+        true /* enableSpark2 */,
+        true /* increaseHelloInterval */,
+        kGRHoldTime,
+        kKeepAliveTime,
+        kKeepAliveTime,
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        SparkTimeConfig(
+            kHelloTime,
+            kKeepAliveTime,
+            kHandshakeTime,
+            kHeartbeatTime,
+            kNegotiateHoldTime,
+            kHeartbeatHoldTime),
+        node2ConfigStore);
 
     // start tracking iface1
     EXPECT_TRUE(node1->updateInterfaceDb({{iface1, ifIndex1, ip1V4, ip1V6}}));
@@ -198,6 +219,9 @@ class SimpleSpark2Fixture : public Spark2Fixture {
 
   std::shared_ptr<SparkWrapper> node1;
   std::shared_ptr<SparkWrapper> node2;
+
+  // config store of node-2, persisting its neighbors if set
+  PersistentStore* node2ConfigStore{nullptr};
 };
 
 TEST_F(SimpleSpark2Fixture, RttTest) {
@@ -334,6 +358,119 @@ TEST_F(SimpleSpark2Fixture, GRTest) {
   }
 }
 
+TEST_F(SimpleSpark2Fixture, NeighborCacheTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture NeighborCacheTest finished";
+  };
+
+  auto configStore = std::make_unique<PersistentStore>(
+      "node-2",
+      "/tmp/openr.spark2_test",
+      context,
+      Constants::kPersistentStoreInitialBackoff,
+      Constants::kPersistentStoreMaxBackoff,
+      true /* dryrun */);
+  std::thread configStoreThread([&]() noexcept { configStore->run(); });
+  configStore->waitUntilRunning();
+  SCOPE_EXIT {
+    // node-2 persists its neighbors on stop
+    node2.reset();
+    configStore->stop();
+    configStore->waitUntilStopped();
+    configStoreThread.join();
+  };
+  node2ConfigStore = configStore.get();
+
+  // create Spark2 instances and establish connections
+  createAndConnectSpark2Nodes();
+
+  // Kill node2, it persists node-1 as ESTABLISHED neighbor
+  LOG(INFO) << "Kill and restart node-2";
+
+  node2.reset();
+  {
+    auto cache = configStore
+                     ->loadThriftObj<thrift::SparkNeighborCache>(
+                         "spark-neighbor-cache")
+                     .get();
+    ASSERT_TRUE(cache.hasValue());
+    ASSERT_EQ(1, cache->neighbors.count(iface2));
+    ASSERT_EQ(1, cache->neighbors.at(iface2).size());
+    EXPECT_EQ("node-1", cache->neighbors.at(iface2).at(0).nodeName);
+    EXPECT_EQ(iface1, cache->neighbors.at(iface2).at(0).remoteIfName);
+  }
+
+  {
+    auto event = node1->waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING);
+    ASSERT_TRUE(event.hasValue());
+    LOG(INFO) << "node-1 reported node-2 as RESTARTING";
+  }
+
+  node2 = createSpark(
+      kDomainName,
+      "node-2",
+      3 /* spark2Id change */,
+      true /* enableSpark2 */,
+      true /* increaseHelloInterval */,
+      kGRHoldTime,
+      kKeepAliveTime,
+      kKeepAliveTime,
+      std::make_pair(
+          Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+      SparkTimeConfig(
+          kHelloTime,
+          kKeepAliveTime,
+          kHandshakeTime,
+          kHeartbeatTime,
+          kNegotiateHoldTime,
+          kHeartbeatHoldTime),
+      configStore.get());
+  EXPECT_TRUE(node2->updateInterfaceDb({{iface2, ifIndex2, ip2V4, ip2V6}}));
+
+  // node-2 negotiates with node-1 on its first hello, under node-1's
+  // graceful restart
+  {
+    auto event =
+        node2->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+    ASSERT_TRUE(event.hasValue());
+    EXPECT_EQ("node-1", event->neighbor.nodeName);
+    EXPECT_EQ(
+        std::make_pair(ip1V4.first, ip1V6.first),
+        SparkWrapper::getTransportAddrs(*event));
+    LOG(INFO) << "node-2 reported adjacency to node-1";
+  }
+  EXPECT_EQ(1, node2->getCounters().at("spark.neighbor_cache_hit.sum.0"));
+
+  {
+    auto event =
+        node1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED);
+    ASSERT_TRUE(event.hasValue());
+    LOG(INFO) << "node-1 reported node-2 as 'RESTARTED'";
+  }
+
+  // should NOT receive any event( e.g.NEIGHBOR_DOWN)
+  {
+    EXPECT_FALSE(
+        node1
+            ->waitForEvent(
+                thrift::SparkNeighborEventType::NEIGHBOR_DOWN, kGRHoldTime * 2)
+            .hasValue());
+    EXPECT_FALSE(
+        node2
+            ->waitForEvent(
+                thrift::SparkNeighborEventType::NEIGHBOR_DOWN, kGRHoldTime * 2)
+            .hasValue());
+  }
+
+  // cache is consumed on load
+  EXPECT_FALSE(configStore
+                   ->loadThriftObj<thrift::SparkNeighborCache>(
+                       "spark-neighbor-cache")
+                   .get()
+                   .hasValue());
+}
+
 TEST_F(SimpleSpark2Fixture, GRTimerExpireTest) {
   SCOPE_EXIT {
     LOG(INFO) << "Spark2Fixture GRTimerExpiredTest finished";
@@ -529,6 +666,84 @@ TEST_F(Spark2Fixture, IgnoreUnidirectionalPeer) {
   }
 }
 
+//
+// Hello interval backs off once both nodes are ESTABLISHED, and gets reset
+// on the next state change
+//
+TEST_F(Spark2Fixture, AdaptiveHelloTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture AdaptiveHelloTest finished";
+  };
+
+  // Define interface names for the test
+  mockIoProvider->addIfNameIfIndex({{iface1, ifIndex1}, {iface2, ifIndex2}});
+
+  // connect interfaces directly
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 10}}},
+      {iface2, {{iface1, 10}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  // hellos back off up to 8 times kHelloTime
+  const SparkTimeConfig timeConfig(
+      kHelloTime,
+      kKeepAliveTime,
+      kHandshakeTime,
+      kHeartbeatTime,
+      kNegotiateHoldTime,
+      kHeartbeatHoldTime,
+      kHelloTime * 8);
+  auto createAdaptiveSpark = [&](std::string const& nodeName, uint32_t id) {
+    return createSpark(
+        kDomainName,
+        nodeName,
+        id,
+        true /* enableSpark2 */,
+        true /* increaseHelloInterval */,
+        kGRHoldTime,
+        kKeepAliveTime,
+        kKeepAliveTime,
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        timeConfig);
+  };
+  auto node1 = createAdaptiveSpark("node-1", 1);
+  auto node2 = createAdaptiveSpark("node-2", 2);
+
+  EXPECT_TRUE(node1->updateInterfaceDb({{iface1, ifIndex1, ip1V4, ip1V6}}));
+  EXPECT_TRUE(node2->updateInterfaceDb({{iface2, ifIndex2, ip2V4, ip2V6}}));
+  EXPECT_TRUE(
+      node1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP)
+          .hasValue());
+  EXPECT_TRUE(
+      node2->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP)
+          .hasValue());
+
+  // reach max backoff: 1x, 2x, 4x, 8x kHelloTime
+  std::this_thread::sleep_for(kHelloTime * 20);
+
+  {
+    const std::string key{"spark.hello.packets_sent.sum.0"};
+    const auto sentBefore = node1->getCounters().at(key);
+    std::this_thread::sleep_for(kHelloTime * 16);
+    const auto sentAfter = node1->getCounters().at(key);
+
+    // 16 hellos at regular interval, 2 with max backoff give or take
+    // variance
+    EXPECT_GE(4, sentAfter - sentBefore);
+    LOG(INFO) << "node-1 sent " << sentAfter - sentBefore
+              << " hellos with backoff";
+  }
+
+  // restarting neighbor resets the backoff
+  node2.reset();
+  EXPECT_TRUE(
+      node1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING)
+          .hasValue());
+  EXPECT_LE(1, node1->getCounters().at("spark.hello_backoff_reset.sum.0"));
+}
+
 TEST_F(Spark2Fixture, BackwardCompatibilityTest) {
   SCOPE_EXIT {
     LOG(INFO) << "Spark2Fixture BackwardCompatibilityTest finished";
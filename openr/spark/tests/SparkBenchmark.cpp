@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/MapUtil.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+#include <openr/spark/SparkWrapper.h>
+#include <openr/spark/tests/MockIoProvider.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace {
+
+const std::string kDomainName("benchmark");
+
+const std::string kSparkCounterCmdUrl("inproc://spark_benchmark_counter_cmd");
+
+// link latency of all emulated links
+const int32_t kLinkLatencyMs{1};
+
+// Spark2 timers. Hold times are generous so that neighbors don't flap when
+// the node under test falls behind at scale
+const std::chrono::milliseconds kGRHoldTime(5000);
+const std::chrono::milliseconds kKeepAliveTime(100);
+const std::chrono::milliseconds kHelloTime(1000);
+const std::chrono::milliseconds kHelloFastInitTime(100);
+const std::chrono::milliseconds kHandshakeTime(100);
+const std::chrono::milliseconds kHeartbeatTime(100);
+const std::chrono::milliseconds kNegotiateHoldTime(10000);
+const std::chrono::milliseconds kHeartbeatHoldTime(5000);
+
+// max time for all adjacencies to come up
+const std::chrono::seconds kBringUpTimeout(120);
+
+// how long steady state traffic is measured for, and how often event loop
+// lag is sampled meanwhile
+const std::chrono::seconds kSteadyStateDuration(3);
+const std::chrono::milliseconds kLagSamplePeriod(10);
+
+} // namespace
+
+namespace openr {
+
+/**
+ * Emulated topology: the node under test has numInterfaces interfaces, each
+ * shared with numNeighbors neighbors. Neighbor j owns one interface facing
+ * each interface of the node under test, so the node under test runs
+ * numInterfaces * numNeighbors adjacencies with only numNeighbors + 1 Spark
+ * instances. All packets go through MockIoProvider.
+ */
+class SparkScaleBenchmark {
+ public:
+  SparkScaleBenchmark(size_t numInterfaces, size_t numNeighbors)
+      : numInterfaces_(numInterfaces), numNeighbors_(numNeighbors) {
+    CHECK_LE(numNeighbors_, 250) << "neighbors get host addresses in a /24";
+
+    mockIoProvider_ = std::make_shared<MockIoProvider>();
+    mockIoProviderThread_ = std::make_unique<std::thread>([this]() {
+      LOG(INFO) << "Starting mockIoProvider thread.";
+      mockIoProvider_->start();
+      LOG(INFO) << "mockIoProvider thread got stopped.";
+    });
+    mockIoProvider_->waitUntilRunning();
+
+    IfNameAndifIndex ifNameAndIfIndex;
+    ConnectedIfPairs connectedPairs;
+    for (size_t i = 0; i < numInterfaces_; ++i) {
+      const auto ifName = getIfName(i);
+      ifNameAndIfIndex.emplace_back(ifName, getIfIndex(i));
+      dutInterfaces_.emplace_back(
+          SparkInterfaceEntry{ifName,
+                              getIfIndex(i),
+                              getV4Network(i, 1),
+                              getV6Network(i, 0xffff)});
+
+      for (size_t j = 0; j < numNeighbors_; ++j) {
+        const auto nbrIfName = getIfName(i, j);
+        ifNameAndIfIndex.emplace_back(nbrIfName, getIfIndex(i, j));
+        connectedPairs[ifName].emplace_back(nbrIfName, kLinkLatencyMs);
+        connectedPairs[nbrIfName].emplace_back(ifName, kLinkLatencyMs);
+      }
+    }
+    mockIoProvider_->addIfNameIfIndex(ifNameAndIfIndex);
+    mockIoProvider_->setConnectedPairs(std::move(connectedPairs));
+
+    dut_ = createSpark("dut", 0);
+    for (size_t j = 0; j < numNeighbors_; ++j) {
+      neighbors_.emplace_back(createSpark(folly::sformat("nbr-{}", j), j + 1));
+    }
+  }
+
+  ~SparkScaleBenchmark() {
+    // stop all sparks before their IoProvider
+    neighbors_.clear();
+    dut_.reset();
+    mockIoProvider_->stop();
+    mockIoProviderThread_->join();
+  }
+
+  size_t
+  getNumAdjacencies() const {
+    return numInterfaces_ * numNeighbors_;
+  }
+
+  // bring up all interfaces and wait for the node under test to report all
+  // of its adjacencies up
+  void
+  bringUp() {
+    for (size_t j = 0; j < numNeighbors_; ++j) {
+      std::vector<SparkInterfaceEntry> interfaces;
+      for (size_t i = 0; i < numInterfaces_; ++i) {
+        interfaces.emplace_back(
+            SparkInterfaceEntry{getIfName(i, j),
+                                getIfIndex(i, j),
+                                getV4Network(i, j + 2),
+                                getV6Network(i, j)});
+      }
+      neighbors_.at(j)->updateInterfaceDb(interfaces);
+    }
+    dut_->updateInterfaceDb(dutInterfaces_);
+
+    const auto deadline = std::chrono::steady_clock::now() + kBringUpTimeout;
+    size_t numUp{0};
+    while (numUp < getNumAdjacencies()) {
+      auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      auto event = dut_->recvNeighborEvent(
+          std::max(timeout, std::chrono::milliseconds(0)));
+      if (event.hasError()) {
+        LOG(FATAL) << "Only " << numUp << " out of " << getNumAdjacencies()
+                   << " adjacencies came up in " << kBringUpTimeout.count()
+                   << "s";
+      }
+      if (event->eventType == thrift::SparkNeighborEventType::NEIGHBOR_UP) {
+        ++numUp;
+      }
+    }
+  }
+
+  SparkWrapper&
+  getDut() {
+    return *dut_;
+  }
+
+ private:
+  std::unique_ptr<SparkWrapper>
+  createSpark(std::string const& nodeName, size_t id) {
+    return std::make_unique<SparkWrapper>(
+        kDomainName,
+        nodeName,
+        kGRHoldTime,
+        kKeepAliveTime,
+        kKeepAliveTime,
+        true /* enableV4 */,
+        true /* enableSubnetValidation */,
+        MonitorSubmitUrl{folly::sformat("{}-{}", kSparkCounterCmdUrl, id)},
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        context_,
+        mockIoProvider_,
+        folly::none,
+        true /* enableSpark2 */,
+        false /* increaseHelloInterval */,
+        SparkTimeConfig(
+            kHelloTime,
+            kHelloFastInitTime,
+            kHandshakeTime,
+            kHeartbeatTime,
+            kNegotiateHoldTime,
+            kHeartbeatHoldTime));
+  }
+
+  // interface i of the node under test
+  static std::string
+  getIfName(size_t i) {
+    return folly::sformat("dut-if-{}", i);
+  }
+
+  // interface of neighbor j facing interface i of the node under test
+  static std::string
+  getIfName(size_t i, size_t j) {
+    return folly::sformat("nbr-{}-if-{}", j, i);
+  }
+
+  int
+  getIfIndex(size_t i) const {
+    return i + 1;
+  }
+
+  int
+  getIfIndex(size_t i, size_t j) const {
+    return numInterfaces_ + 1 + j * numInterfaces_ + i;
+  }
+
+  // subnet of link i, with host address
+  static folly::CIDRNetwork
+  getV4Network(size_t i, size_t host) {
+    return folly::IPAddress::createNetwork(
+        folly::sformat("10.{}.{}.{}/24", (i >> 8) & 0xff, i & 0xff, host),
+        -1,
+        false /* apply mask */);
+  }
+
+  static folly::CIDRNetwork
+  getV6Network(size_t i, size_t host) {
+    return folly::IPAddress::createNetwork(
+        folly::sformat("fe80::{:x}:{:x}/128", i, host));
+  }
+
+  const size_t numInterfaces_{0};
+  const size_t numNeighbors_{0};
+
+  fbzmq::Context context_;
+  std::shared_ptr<MockIoProvider> mockIoProvider_;
+  std::unique_ptr<std::thread> mockIoProviderThread_;
+
+  std::vector<SparkInterfaceEntry> dutInterfaces_;
+  std::unique_ptr<SparkWrapper> dut_;
+  std::vector<std::unique_ptr<SparkWrapper>> neighbors_;
+};
+
+/**
+ * Benchmark for Spark at scale
+ * 1. Create the node under test and its neighbors
+ * 2. Bring up all interfaces and wait for all adjacencies (measured)
+ * 3. Let steady state hello/heartbeat traffic run for a while, measuring CPU
+ *    per packet received by the node under test and its event loop lag
+ */
+static void
+BM_SparkScale(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numInterfaces,
+    size_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+
+  std::chrono::nanoseconds bringUpTime{0};
+  std::chrono::nanoseconds cpuTime{0};
+  int64_t numPacketsRecv{0};
+  int64_t numPacketsDropped{0};
+  std::vector<std::chrono::microseconds> lags;
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    SparkScaleBenchmark benchmark(numInterfaces, numNeighbors);
+    auto& dut = benchmark.getDut();
+
+    auto start = std::chrono::steady_clock::now();
+    suspender.dismiss();
+    benchmark.bringUp();
+    suspender.rehire();
+    bringUpTime += std::chrono::steady_clock::now() - start;
+
+    // steady state
+    auto countersBefore = dut.getCounters();
+    auto cpuTimeBefore = dut.getThreadCpuTime();
+    const auto end = std::chrono::steady_clock::now() + kSteadyStateDuration;
+    while (std::chrono::steady_clock::now() < end) {
+      lags.emplace_back(dut.getEventLoopLag());
+      std::this_thread::sleep_for(kLagSamplePeriod);
+    }
+    cpuTime += dut.getThreadCpuTime() - cpuTimeBefore;
+    auto countersAfter = dut.getCounters();
+
+    auto getDelta = [&](std::string const& key) {
+      return folly::get_default(countersAfter, key, 0) -
+          folly::get_default(countersBefore, key, 0);
+    };
+    numPacketsRecv += getDelta("spark.hello_packet_recv.sum.0");
+    numPacketsDropped += getDelta("spark.hello_packet_dropped.sum.0");
+  }
+
+  iters = std::max<uint32_t>(iters, 1);
+  std::sort(lags.begin(), lags.end());
+  const auto getLagPercentile = [&](size_t percentile) -> int64_t {
+    if (lags.empty()) {
+      return 0;
+    }
+    return lags.at((lags.size() - 1) * percentile / 100).count();
+  };
+
+  // Add customized counters to state.
+  counters["bring_up_ms"] =
+      std::chrono::duration_cast<std::chrono::milliseconds>(bringUpTime)
+          .count() /
+      iters;
+  counters["cpu_ns_per_packet"] =
+      numPacketsRecv ? cpuTime.count() / numPacketsRecv : 0;
+  counters["packets_per_sec"] =
+      numPacketsRecv / (kSteadyStateDuration.count() * iters);
+  counters["packets_dropped"] = numPacketsDropped / iters;
+  counters["loop_lag_p50_us"] = getLagPercentile(50);
+  counters["loop_lag_p99_us"] = getLagPercentile(99);
+  counters["loop_lag_max_us"] = getLagPercentile(100);
+}
+
+// The parameters are the number of interfaces and neighbors per interface
+BENCHMARK_COUNTERS_NAME_PARAM(BM_SparkScale, counters, 1x10, 1, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_SparkScale, counters, 10x10, 10, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_SparkScale, counters, 100x10, 100, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_SparkScale, counters, 1000x2, 1000, 2);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_SparkScale, counters, 500x8, 500, 8);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/spark/SparkCoordinator.h>
+
+using namespace openr;
+
+namespace {
+
+const size_t kNumShards{2};
+
+thrift::InterfaceInfo
+createInterfaceInfo(int64_t ifIndex) {
+  thrift::InterfaceInfo info;
+  info.isUp = true;
+  info.ifIndex = ifIndex;
+  return info;
+}
+
+// first interface name of the shard
+std::string
+getShardIfName(size_t shard) {
+  for (int i = 0;; ++i) {
+    auto ifName = folly::sformat("iface{}", i);
+    if (SparkCoordinator::getShard(ifName, kNumShards) == shard) {
+      return ifName;
+    }
+  }
+}
+
+} // namespace
+
+TEST(SparkCoordinatorTest, ShardNames) {
+  EXPECT_EQ("Spark", SparkCoordinator::getShardName(0));
+  EXPECT_EQ("Spark3", SparkCoordinator::getShardName(3));
+  EXPECT_EQ(0, SparkCoordinator::getShard("iface0", 1));
+}
+
+TEST(SparkCoordinatorTest, SplitUpdates) {
+  messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
+  SparkCoordinator coordinator(kNumShards, interfaceUpdatesQueue.getReader());
+  auto reader0 = coordinator.getInterfaceUpdatesReader(0);
+  auto reader1 = coordinator.getInterfaceUpdatesReader(1);
+  std::thread thread([&]() { coordinator.run(); });
+  coordinator.waitUntilRunning();
+
+  const auto ifName0 = getShardIfName(0);
+  const auto ifName1 = getShardIfName(1);
+
+  // full snapshots reach every shard, with its interfaces only
+  thrift::InterfaceDatabase ifDb;
+  ifDb.thisNodeName = "node1";
+  ifDb.seqNum = 10;
+  ifDb.interfaces.emplace(ifName0, createInterfaceInfo(1));
+  ifDb.interfaces.emplace(ifName1, createInterfaceInfo(2));
+  interfaceUpdatesQueue.push(ifDb);
+
+  auto shardDb = reader0.get().value();
+  EXPECT_FALSE(shardDb.isDelta);
+  EXPECT_EQ("node1", shardDb.thisNodeName);
+  EXPECT_EQ(1, shardDb.seqNum);
+  ASSERT_EQ(1, shardDb.interfaces.size());
+  EXPECT_EQ(1, shardDb.interfaces.count(ifName0));
+  shardDb = reader1.get().value();
+  ASSERT_EQ(1, shardDb.interfaces.size());
+  EXPECT_EQ(1, shardDb.interfaces.count(ifName1));
+
+  // deltas only reach the shards they touch, numbered per shard
+  ifDb.isDelta = true;
+  ifDb.interfaces.clear();
+  ifDb.deletedInterfaces = {ifName1};
+  interfaceUpdatesQueue.push(ifDb);
+  ifDb.deletedInterfaces.clear();
+  ifDb.interfaces.emplace(ifName0, createInterfaceInfo(3));
+  interfaceUpdatesQueue.push(ifDb);
+
+  shardDb = reader1.get().value();
+  EXPECT_TRUE(shardDb.isDelta);
+  EXPECT_EQ(2, shardDb.seqNum);
+  EXPECT_TRUE(shardDb.interfaces.empty());
+  EXPECT_EQ(std::vector<std::string>{ifName1}, shardDb.deletedInterfaces);
+  shardDb = reader0.get().value();
+  EXPECT_EQ(2, shardDb.seqNum);
+  EXPECT_EQ(3, shardDb.interfaces.at(ifName0).ifIndex);
+  EXPECT_EQ(0, reader0.size());
+  EXPECT_EQ(0, reader1.size());
+
+  // closing the input closes the shard queues
+  interfaceUpdatesQueue.close();
+  EXPECT_TRUE(reader0.get().hasError());
+  EXPECT_TRUE(reader1.get().hasError());
+
+  coordinator.stop();
+  coordinator.waitUntilStopped();
+  thread.join();
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
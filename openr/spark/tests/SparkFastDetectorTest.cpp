@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/spark/SparkFastDetector.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+TEST(SparkFastDetectorTest, PacketEncodeDecode) {
+  SparkFastDetector::Packet packet;
+  packet.flags = SparkFastDetector::Packet::kFlagDown;
+  packet.txInterval = 50ms;
+  packet.multiplier = 3;
+  packet.seqNum = 0xdeadbeef;
+  packet.nodeName = "node-1";
+
+  const auto data = SparkFastDetector::encodePacket(packet);
+  EXPECT_EQ(16 + packet.nodeName.size(), data.size());
+
+  auto decoded = SparkFastDetector::decodePacket(data);
+  ASSERT_TRUE(decoded.hasValue());
+  EXPECT_EQ(packet.flags, decoded->flags);
+  EXPECT_EQ(packet.txInterval, decoded->txInterval);
+  EXPECT_EQ(packet.multiplier, decoded->multiplier);
+  EXPECT_EQ(packet.seqNum, decoded->seqNum);
+  EXPECT_EQ(packet.nodeName, decoded->nodeName);
+}
+
+TEST(SparkFastDetectorTest, DecodeMalformedPacket) {
+  SparkFastDetector::Packet packet;
+  packet.txInterval = 10ms;
+  packet.multiplier = 3;
+  packet.nodeName = "node-1";
+  const auto data = SparkFastDetector::encodePacket(packet);
+
+  // truncated, trailing garbage
+  EXPECT_FALSE(SparkFastDetector::decodePacket("").hasValue());
+  EXPECT_FALSE(SparkFastDetector::decodePacket(data.substr(0, 15)).hasValue());
+  EXPECT_FALSE(SparkFastDetector::decodePacket(data.substr(0, data.size() - 1))
+                   .hasValue());
+  EXPECT_FALSE(SparkFastDetector::decodePacket(data + "x").hasValue());
+
+  // bad magic, unknown version
+  auto badData = data;
+  badData[0] ^= 0xff;
+  EXPECT_FALSE(SparkFastDetector::decodePacket(badData).hasValue());
+  badData = data;
+  badData[4] = 2;
+  EXPECT_FALSE(SparkFastDetector::decodePacket(badData).hasValue());
+
+  // zero interval or multiplier
+  packet.multiplier = 0;
+  EXPECT_FALSE(SparkFastDetector::decodePacket(
+                   SparkFastDetector::encodePacket(packet))
+                   .hasValue());
+}
+
+TEST(SparkFastDetectorTest, ParseConfigs) {
+  auto configs = SparkFastDetector::parseConfigs("");
+  ASSERT_TRUE(configs.hasValue());
+  EXPECT_TRUE(configs->empty());
+
+  configs = SparkFastDetector::parseConfigs("po.*:10:3,eth[0-9]{1,2}:100:5");
+  ASSERT_TRUE(configs.hasValue());
+  ASSERT_EQ(2, configs->size());
+  EXPECT_EQ("po.*", configs->at(0).ifNameRegex);
+  EXPECT_EQ(10ms, configs->at(0).txInterval);
+  EXPECT_EQ(3, configs->at(0).multiplier);
+  EXPECT_EQ("eth[0-9]{1,2}", configs->at(1).ifNameRegex);
+  EXPECT_EQ(100ms, configs->at(1).txInterval);
+  EXPECT_EQ(5, configs->at(1).multiplier);
+
+  // regex may contain ':'
+  configs = SparkFastDetector::parseConfigs("a:b:20:3");
+  ASSERT_TRUE(configs.hasValue());
+  ASSERT_EQ(1, configs->size());
+  EXPECT_EQ("a:b", configs->at(0).ifNameRegex);
+
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1:10").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs(":10:3").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1:0:3").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1:10:0").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1:ten:3").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po1:10:300").hasError());
+  EXPECT_TRUE(SparkFastDetector::parseConfigs("po(1:10:3").hasError());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/spark/SparkNeighborTable.h>
+
+using namespace openr;
+
+namespace {
+
+// move-only, like neighbors holding their timers
+struct TestNeighbor {
+  TestNeighbor(int seqNum, int* numAlive)
+      : seqNum(seqNum), alive(numAlive, [](int* n) { --*n; }) {
+    ++*numAlive;
+  }
+
+  int seqNum{0};
+  std::unique_ptr<int, void (*)(int*)> alive;
+};
+
+std::map<std::string, int>
+getSeqNums(SparkNeighborTable<TestNeighbor> const& table) {
+  std::map<std::string, int> seqNums;
+  table.forEachNeighbor([&seqNums](
+                            std::string const& ifName,
+                            std::string const& nodeName,
+                            TestNeighbor const& neighbor) {
+    seqNums.emplace(ifName + "/" + nodeName, neighbor.seqNum);
+  });
+  return seqNums;
+}
+
+} // namespace
+
+TEST(SparkNeighborTableTest, EmplaceFindErase) {
+  int numAlive{0};
+  SparkNeighborTable<TestNeighbor> table;
+  table.addInterface("iface1");
+  table.addInterface("iface2");
+  EXPECT_TRUE(table.hasInterface("iface1"));
+  EXPECT_FALSE(table.hasInterface("iface3"));
+  EXPECT_EQ(nullptr, table.find("iface1", "node1"));
+  EXPECT_EQ(nullptr, table.find("iface3", "node1"));
+
+  auto& neighbor = table.emplace("iface1", "node1", 1, &numAlive);
+  table.emplace("iface1", "node2", 2, &numAlive);
+  table.emplace("iface2", "node1", 3, &numAlive);
+  EXPECT_THROW(
+      table.emplace("iface3", "node1", 4, &numAlive), std::out_of_range);
+  EXPECT_EQ(3, numAlive);
+  EXPECT_EQ(3, table.getNumNeighbors());
+  EXPECT_EQ(2, table.getNumNeighbors("iface1"));
+  EXPECT_EQ(0, table.getNumNeighbors("iface3"));
+
+  EXPECT_EQ(&neighbor, table.find("iface1", "node1"));
+  EXPECT_EQ(2, table.at("iface1", "node2").seqNum);
+  EXPECT_EQ(3, table.at("iface2", "node1").seqNum);
+  EXPECT_THROW(table.at("iface2", "node2"), std::out_of_range);
+
+  EXPECT_TRUE(table.erase("iface1", "node2"));
+  EXPECT_FALSE(table.erase("iface1", "node2"));
+  EXPECT_FALSE(table.erase("iface3", "node1"));
+  EXPECT_EQ(2, numAlive);
+  EXPECT_EQ(
+      (std::map<std::string, int>{{"iface1/node1", 1}, {"iface2/node1", 3}}),
+      getSeqNums(table));
+
+  // freed slot is reused, neighbors in place stay put
+  table.emplace("iface2", "node2", 5, &numAlive);
+  EXPECT_EQ(&neighbor, table.find("iface1", "node1"));
+  EXPECT_EQ(5, table.at("iface2", "node2").seqNum);
+}
+
+TEST(SparkNeighborTableTest, EraseInterface) {
+  int numAlive{0};
+  SparkNeighborTable<TestNeighbor> table;
+  table.addInterface("iface1");
+  table.addInterface("iface2");
+  table.emplace("iface1", "node1", 1, &numAlive);
+  table.emplace("iface1", "node2", 2, &numAlive);
+  table.emplace("iface2", "node1", 3, &numAlive);
+
+  std::map<std::string, int> seqNums;
+  table.forEachNeighbor(
+      "iface1", [&seqNums](std::string const& nodeName, TestNeighbor& n) {
+        seqNums.emplace(nodeName, n.seqNum++);
+      });
+  EXPECT_EQ((std::map<std::string, int>{{"node1", 1}, {"node2", 2}}), seqNums);
+  EXPECT_EQ(3, table.at("iface1", "node2").seqNum);
+
+  table.eraseInterface("iface1");
+  table.eraseInterface("iface3");
+  EXPECT_FALSE(table.hasInterface("iface1"));
+  EXPECT_EQ(1, numAlive);
+  EXPECT_EQ(1, table.getNumNeighbors());
+  EXPECT_EQ(1, table.getNumInterfaces());
+  EXPECT_EQ(nullptr, table.find("iface1", "node1"));
+
+  // interface comes back without its neighbors
+  table.addInterface("iface1");
+  EXPECT_EQ(0, table.getNumNeighbors("iface1"));
+  EXPECT_EQ(
+      (std::map<std::string, int>{{"iface2/node1", 3}}), getSeqNums(table));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
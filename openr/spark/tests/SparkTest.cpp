@@ -1159,6 +1159,17 @@ TEST_F(SparkFixture, DomainTest) {
     }
   }
 
+  // hello packets of other domains are dropped before being deserialized
+  for (int i = 0; i < kNumSparks; i++) {
+    auto counters = sparks[i]->getCounters();
+    EXPECT_LE(
+        1,
+        folly::get_default(
+            counters,
+            "spark.hello_packet_dropped_early.different_domain.sum.0",
+            0));
+  }
+
   // Just for debugging
   VLOG(1) << "Discovered neighbors information.";
   for (auto& kv : ifToNeighbors) {
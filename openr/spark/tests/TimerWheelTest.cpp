@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/spark/TimerWheel.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+namespace {
+
+class TimerWheelFixture : public ::testing::Test {
+ public:
+  void
+  SetUp() override {
+    wheel = std::make_unique<TimerWheel>(
+        10ms,
+        [this](TimerWheel::Clock::time_point time) {
+          wakeupTimes.emplace_back(time);
+        },
+        start);
+  }
+
+  std::unique_ptr<TimerWheel::Timer>
+  makeTimer(const std::string& name) {
+    return wheel->makeTimer([this, name]() { fired.emplace_back(name); });
+  }
+
+  const TimerWheel::Clock::time_point start{TimerWheel::Clock::now()};
+  std::unique_ptr<TimerWheel> wheel;
+  std::vector<TimerWheel::Clock::time_point> wakeupTimes;
+  std::vector<std::string> fired;
+};
+
+} // namespace
+
+TEST_F(TimerWheelFixture, ScheduleExpire) {
+  auto timer1 = makeTimer("timer1");
+  auto timer2 = makeTimer("timer2");
+  EXPECT_TRUE(wheel->empty());
+  EXPECT_FALSE(timer1->isScheduled());
+  EXPECT_FALSE(wheel->getNextExpiryTime().has_value());
+
+  timer1->scheduleTimeout(100ms);
+  timer2->scheduleTimeout(300ms);
+  EXPECT_TRUE(timer1->isScheduled());
+  EXPECT_EQ(2, wheel->size());
+
+  // only the earliest timer asks for a wakeup
+  ASSERT_EQ(1, wakeupTimes.size());
+  EXPECT_LE(start + 100ms, wakeupTimes.at(0));
+  EXPECT_EQ(wakeupTimes.at(0), wheel->getNextExpiryTime());
+
+  // timers never fire early
+  EXPECT_EQ(0, wheel->expire(start + 90ms));
+  EXPECT_TRUE(fired.empty());
+
+  EXPECT_EQ(1, wheel->expire(start + 200ms));
+  EXPECT_EQ(std::vector<std::string>{"timer1"}, fired);
+  EXPECT_FALSE(timer1->isScheduled());
+  EXPECT_EQ(1, wheel->size());
+
+  // expire asks for a wakeup for the remaining timer
+  EXPECT_LE(start + 300ms, wakeupTimes.back());
+  EXPECT_EQ(wakeupTimes.back(), wheel->getNextExpiryTime());
+
+  EXPECT_EQ(1, wheel->expire(start + 400ms));
+  EXPECT_EQ(2, fired.size());
+  EXPECT_TRUE(wheel->empty());
+  EXPECT_FALSE(wheel->getNextExpiryTime().has_value());
+}
+
+TEST_F(TimerWheelFixture, RearmCancel) {
+  auto timer1 = makeTimer("timer1");
+  auto timer2 = makeTimer("timer2");
+  timer1->scheduleTimeout(100ms);
+  timer2->scheduleTimeout(100ms);
+
+  // re-arming replaces the previous schedule
+  timer1->scheduleTimeout(500ms);
+  timer1->scheduleTimeout(300ms);
+  EXPECT_EQ(2, wheel->size());
+
+  timer2->cancelTimeout();
+  EXPECT_FALSE(timer2->isScheduled());
+  EXPECT_EQ(1, wheel->size());
+
+  EXPECT_EQ(0, wheel->expire(start + 200ms));
+  EXPECT_EQ(1, wheel->expire(start + 350ms));
+  EXPECT_EQ(std::vector<std::string>{"timer1"}, fired);
+
+  // destroying a timer cancels it
+  timer1->scheduleTimeout(100ms);
+  timer1.reset();
+  EXPECT_TRUE(wheel->empty());
+  EXPECT_EQ(0, wheel->expire(start + 1s));
+}
+
+TEST_F(TimerWheelFixture, Periodic) {
+  auto timer = makeTimer("timer");
+  timer->scheduleTimeout(100ms, true /* isPeriodic */);
+
+  EXPECT_EQ(1, wheel->expire(start + 110ms));
+  EXPECT_TRUE(timer->isScheduled());
+  EXPECT_EQ(0, wheel->expire(start + 200ms));
+  EXPECT_EQ(1, wheel->expire(start + 220ms));
+  EXPECT_EQ(2, fired.size());
+
+  timer->cancelTimeout();
+  EXPECT_EQ(0, wheel->expire(start + 1s));
+}
+
+TEST_F(TimerWheelFixture, LongTimeouts) {
+  // timeouts spanning several turns of the wheel stay in their slot until
+  // their turn comes
+  const auto turn = TimerWheel::kNumSlots * 10ms;
+  auto timer1 = makeTimer("timer1");
+  auto timer2 = makeTimer("timer2");
+  timer1->scheduleTimeout(100ms);
+  timer2->scheduleTimeout(100ms + 2 * turn);
+
+  EXPECT_EQ(1, wheel->expire(start + 150ms));
+  EXPECT_EQ(0, wheel->expire(start + 150ms + turn));
+  EXPECT_EQ(0, wheel->expire(start + 50ms + 2 * turn));
+  EXPECT_EQ(1, wheel->expire(start + 150ms + 2 * turn));
+  EXPECT_EQ(2, fired.size());
+}
+
+TEST_F(TimerWheelFixture, BatchExpiry) {
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  for (int i = 0; i < 1000; ++i) {
+    timers.emplace_back(makeTimer(std::to_string(i)));
+    timers.back()->scheduleTimeout(std::chrono::milliseconds(i));
+  }
+  EXPECT_EQ(1000, wheel->size());
+
+  // a single expire fires all timers due
+  EXPECT_EQ(500, wheel->expire(start + 500ms));
+  EXPECT_EQ(500, fired.size());
+  EXPECT_EQ(500, wheel->expire(start + 2s));
+  EXPECT_EQ(1000, fired.size());
+  EXPECT_TRUE(wheel->empty());
+}
+
+TEST_F(TimerWheelFixture, ModifyFromCallback) {
+  std::unique_ptr<TimerWheel::Timer> timer2;
+  std::unique_ptr<TimerWheel::Timer> timer3;
+
+  // timer1 destroys timer2 which is due as well, and re-arms timer3
+  auto timer1 = wheel->makeTimer([&]() {
+    fired.emplace_back("timer1");
+    timer2.reset();
+    timer3->scheduleTimeout(500ms);
+  });
+  timer2 = makeTimer("timer2");
+  timer3 = makeTimer("timer3");
+
+  // timer4 destroys itself
+  std::unique_ptr<TimerWheel::Timer> timer4;
+  timer4 = wheel->makeTimer([&]() { timer4.reset(); });
+
+  timer1->scheduleTimeout(100ms);
+  timer2->scheduleTimeout(110ms);
+  timer3->scheduleTimeout(120ms);
+  timer4->scheduleTimeout(130ms);
+
+  EXPECT_EQ(2, wheel->expire(start + 200ms));
+  EXPECT_EQ(std::vector<std::string>{"timer1"}, fired);
+  EXPECT_EQ(nullptr, timer4);
+  EXPECT_TRUE(timer3->isScheduled());
+  EXPECT_EQ(1, wheel->size());
+  EXPECT_EQ(1, wheel->expire(start + 1s));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
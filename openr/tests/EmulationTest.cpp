@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/tests/KvStoreEmulator.h>
+#include <openr/tests/VirtualClock.h>
+
+using namespace openr;
+
+namespace {
+
+const VirtualClock::Duration kLinkLatency{std::chrono::milliseconds(1)};
+
+std::string
+getNodeName(int id) {
+  return folly::sformat("node-{}", id);
+}
+
+} // namespace
+
+//
+// Callbacks run in time order, the ones of the same time in the order they
+// were scheduled, and the time only moves forward
+//
+TEST(VirtualClockTest, OrderingTest) {
+  VirtualClock clock;
+  std::vector<int> order;
+  clock.scheduleAfter(std::chrono::milliseconds(2), [&]() {
+    order.emplace_back(3);
+    // in the past, runs right away
+    clock.scheduleAt(std::chrono::milliseconds(1), [&]() {
+      order.emplace_back(4);
+      EXPECT_EQ(std::chrono::milliseconds(2), clock.now());
+    });
+  });
+  clock.scheduleAfter(std::chrono::milliseconds(1), [&]() {
+    order.emplace_back(1);
+  });
+  clock.scheduleAfter(std::chrono::milliseconds(1), [&]() {
+    order.emplace_back(2);
+  });
+  clock.scheduleAfter(std::chrono::milliseconds(10), [&]() {
+    order.emplace_back(5);
+  });
+  EXPECT_EQ(4, clock.getNumPending());
+
+  EXPECT_EQ(4, clock.runUntil(std::chrono::milliseconds(5)));
+  EXPECT_EQ(std::chrono::milliseconds(5), clock.now());
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), order);
+
+  EXPECT_EQ(1, clock.runUntilIdle());
+  EXPECT_EQ(std::chrono::milliseconds(10), clock.now());
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), order);
+  EXPECT_EQ(0, clock.getNumPending());
+}
+
+//
+// Ring of 1000 nodes each originating a key. Keys flood both ways around the
+// ring and meet at the opposite node, half the ring away
+//
+TEST(KvStoreEmulatorTest, RingTest) {
+  const int kNumNodes = 1000;
+  VirtualClock clock;
+  KvStoreEmulator emulator(clock);
+  for (int i = 0; i < kNumNodes; ++i) {
+    emulator.addNode(getNodeName(i));
+  }
+  for (int i = 0; i < kNumNodes; ++i) {
+    emulator.addLink(
+        getNodeName(i), getNodeName((i + 1) % kNumNodes), kLinkLatency);
+  }
+
+  std::unordered_map<std::string, int> numUpdates;
+  emulator.setUpdateCallback(
+      [&](std::string const& node, thrift::KeyVals const& updates) {
+        numUpdates[node] += updates.size();
+      });
+
+  for (int i = 0; i < kNumNodes; ++i) {
+    const auto node = getNodeName(i);
+    emulator.setKeyVals(
+        node, {{"key:" + node, createThriftValue(1, node, std::string("v"))}});
+  }
+  clock.runUntilIdle();
+
+  EXPECT_TRUE(emulator.isConverged());
+  EXPECT_EQ(kNumNodes, emulator.getKeyVals(getNodeName(0)).size());
+  EXPECT_EQ(std::chrono::milliseconds(kNumNodes / 2),
+            emulator.getLastUpdateTime());
+
+  // every key is sent twice by its originator and once by every other node
+  auto const& stats = emulator.getStats();
+  EXPECT_EQ(kNumNodes * (kNumNodes + 1), stats.numPublications);
+  EXPECT_EQ(kNumNodes * (kNumNodes + 1), stats.numKeyVals);
+  EXPECT_EQ(kNumNodes * kNumNodes, stats.numKeyValsMerged);
+
+  EXPECT_EQ(kNumNodes, numUpdates.size());
+  for (auto const& kv : numUpdates) {
+    EXPECT_EQ(kNumNodes, kv.second);
+  }
+}
+
+//
+// Update of a key in the corner of a converged 32x32 grid. It reaches the
+// opposite corner after diameter hops, and every node floods it on to all of
+// its peers but the one it learnt it from
+//
+TEST(KvStoreEmulatorTest, GridTest) {
+  const int kWidth = 32;
+  VirtualClock clock;
+  KvStoreEmulator emulator(clock);
+  int numLinks = 0;
+  for (int i = 0; i < kWidth * kWidth; ++i) {
+    emulator.addNode(getNodeName(i));
+  }
+  for (int row = 0; row < kWidth; ++row) {
+    for (int col = 0; col < kWidth; ++col) {
+      const auto node = getNodeName(row * kWidth + col);
+      if (col + 1 < kWidth) {
+        emulator.addLink(
+            node, getNodeName(row * kWidth + col + 1), kLinkLatency);
+        ++numLinks;
+      }
+      if (row + 1 < kWidth) {
+        emulator.addLink(
+            node, getNodeName((row + 1) * kWidth + col), kLinkLatency);
+        ++numLinks;
+      }
+    }
+  }
+  const int kNumNodes = emulator.getNumNodes();
+  const auto origin = getNodeName(0);
+
+  emulator.setKeyVals(
+      origin, {{"key", createThriftValue(1, origin, std::string("v1"))}});
+  clock.runUntilIdle();
+  EXPECT_TRUE(emulator.isConverged());
+  EXPECT_EQ(
+      2 * numLinks - kNumNodes + 1, emulator.getStats().numPublications);
+
+  const auto startTime = clock.now();
+  emulator.setKeyVals(
+      origin, {{"key", createThriftValue(2, origin, std::string("v2"))}});
+  clock.runUntilIdle();
+  EXPECT_TRUE(emulator.isConverged());
+  EXPECT_EQ(
+      2, emulator.getKeyVals(getNodeName(kNumNodes - 1)).at("key").version);
+  EXPECT_EQ(
+      std::chrono::milliseconds(2 * (kWidth - 1)),
+      emulator.getLastUpdateTime() - startTime);
+  EXPECT_EQ(
+      2 * (2 * numLinks - kNumNodes + 1),
+      emulator.getStats().numPublications);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
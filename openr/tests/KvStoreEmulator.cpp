@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/tests/KvStoreEmulator.h"
+
+#include <memory>
+
+#include <glog/logging.h>
+
+#include <openr/kvstore/KvStore.h>
+
+namespace openr {
+
+KvStoreEmulator::KvStoreEmulator(
+    VirtualClock& clock, Duration processingDelay)
+    : clock_(clock), processingDelay_(processingDelay) {}
+
+void
+KvStoreEmulator::addNode(std::string const& node) {
+  nodes_.emplace(node, Node());
+}
+
+void
+KvStoreEmulator::addLink(
+    std::string const& node1, std::string const& node2, Duration latency) {
+  nodes_.at(node1).peers.emplace_back(node2, latency);
+  nodes_.at(node2).peers.emplace_back(node1, latency);
+}
+
+void
+KvStoreEmulator::setKeyVals(std::string const& node, thrift::KeyVals keyVals) {
+  CHECK(nodes_.count(node)) << "Unknown node " << node;
+  clock_.scheduleAfter(
+      processingDelay_, [this, node, keyVals = std::move(keyVals)]() {
+        processPublication(node, "" /* sender */, keyVals);
+      });
+}
+
+thrift::KeyVals const&
+KvStoreEmulator::getKeyVals(std::string const& node) const {
+  return nodes_.at(node).keyVals;
+}
+
+bool
+KvStoreEmulator::isConverged() const {
+  if (nodes_.empty()) {
+    return true;
+  }
+  auto const& reference = nodes_.begin()->second.keyVals;
+  for (auto const& kv : nodes_) {
+    if (kv.second.keyVals != reference) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+KvStoreEmulator::processPublication(
+    std::string const& node,
+    std::string const& sender,
+    thrift::KeyVals const& keyVals) {
+  auto& state = nodes_.at(node);
+  auto updates = KvStore::mergeKeyValues(state.keyVals, keyVals);
+  stats_.numKeyValsMerged += updates.size();
+  if (updates.empty()) {
+    return;
+  }
+  lastUpdateTime_ = clock_.now();
+  if (updateCallback_) {
+    updateCallback_(node, updates);
+  }
+
+  // one publication shared by all peers, as KvStore serializes it once
+  auto publication =
+      std::make_shared<const thrift::KeyVals>(std::move(updates));
+  for (auto const& peer : state.peers) {
+    if (peer.first == sender) {
+      continue;
+    }
+    ++stats_.numPublications;
+    stats_.numKeyVals += publication->size();
+    clock_.scheduleAfter(
+        peer.second + processingDelay_,
+        [this, peerName = peer.first, node, publication]() {
+          processPublication(peerName, node, *publication);
+        });
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/tests/VirtualClock.h>
+
+namespace openr {
+
+//
+// Emulation of KvStore flooding over a topology of thousands of nodes in a
+// single thread, driven by a VirtualClock. Nodes merge publications with
+// the merge logic of KvStore and flood the updated key-vals to all of their
+// peers but the sender, as KvStore does. Links deliver publications after
+// their latency plus processingDelay of the receiver. There are no
+// sockets, threads nor timers, which makes runs fast and repeatable for
+// measuring network-wide convergence time and message counts.
+//
+class KvStoreEmulator {
+ public:
+  using Duration = VirtualClock::Duration;
+
+  // called with the key-vals a node updated its store with
+  using UpdateCallback = std::function<void(
+      std::string const& node, thrift::KeyVals const& updates)>;
+
+  struct Stats {
+    // publications sent over links and the key-vals they carried
+    int64_t numPublications{0};
+    int64_t numKeyVals{0};
+    // key-vals updating the store of the receiver, the rest are redundant
+    int64_t numKeyValsMerged{0};
+  };
+
+  explicit KvStoreEmulator(
+      VirtualClock& clock, Duration processingDelay = Duration(0));
+
+  void addNode(std::string const& node);
+
+  // bidirectional link, nodes must exist
+  void addLink(
+      std::string const& node1, std::string const& node2, Duration latency);
+
+  // set key-vals at node, as a client of its KvStore would, and flood them
+  void setKeyVals(std::string const& node, thrift::KeyVals keyVals);
+
+  void
+  setUpdateCallback(UpdateCallback callback) {
+    updateCallback_ = std::move(callback);
+  }
+
+  thrift::KeyVals const& getKeyVals(std::string const& node) const;
+
+  // whether all nodes hold the same key-vals
+  bool isConverged() const;
+
+  // virtual time of the last update of any store, i.e. the convergence time
+  // of the emulation once the clock is idle
+  Duration
+  getLastUpdateTime() const {
+    return lastUpdateTime_;
+  }
+
+  Stats const&
+  getStats() const {
+    return stats_;
+  }
+
+  size_t
+  getNumNodes() const {
+    return nodes_.size();
+  }
+
+ private:
+  struct Node {
+    thrift::KeyVals keyVals;
+    // peer node name and link latency
+    std::vector<std::pair<std::string, Duration>> peers;
+  };
+
+  // merge publication received from sender (empty for local key-vals) and
+  // flood what changed
+  void processPublication(
+      std::string const& node,
+      std::string const& sender,
+      thrift::KeyVals const& keyVals);
+
+  VirtualClock& clock_;
+  const Duration processingDelay_;
+  std::unordered_map<std::string, Node> nodes_;
+  UpdateCallback updateCallback_;
+  Duration lastUpdateTime_{0};
+  Stats stats_;
+};
+
+} // namespace openr
@@ -519,9 +519,8 @@ template <class Serializer>
 bool
 OpenrWrapper<Serializer>::sparkUpdateInterfaceDb(
     const std::vector<SparkInterfaceEntry>& interfaceEntries) {
-  thrift::InterfaceDatabase ifDb(
-      apache::thrift::FRAGILE, nodeId_, {}, thrift::PerfEvents());
-  ifDb.perfEvents = folly::none;
+  thrift::InterfaceDatabase ifDb;
+  ifDb.thisNodeName = nodeId_;
 
   for (const auto& interface : interfaceEntries) {
     ifDb.interfaces.emplace(
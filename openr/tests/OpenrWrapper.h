@@ -170,11 +170,11 @@ class OpenrWrapper {
   const std::string kvStoreGlobalCmdUrl_;
   const std::string kvStoreGlobalPubUrl_;
   const std::string platformPubUrl_;
-  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue_;
+  messaging::ReplicateQueue<RouteUpdate> routeUpdatesQueue_;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue_;
   messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue_;
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue_;
+  messaging::ReplicateQueue<KvStorePublicationPtr> kvStoreUpdatesQueue_;
   std::string kvStoreLocalCmdUrl_;
 
   // client sockets mainly for tests
@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/tests/VirtualClock.h"
+
+#include <algorithm>
+
+namespace openr {
+
+void
+VirtualClock::scheduleAfter(Duration delay, Callback callback) {
+  scheduleAt(now_ + delay, std::move(callback));
+}
+
+void
+VirtualClock::scheduleAt(Duration time, Callback callback) {
+  callbacks_.emplace(
+      std::make_pair(std::max(time, now_), nextSeq_++), std::move(callback));
+}
+
+size_t
+VirtualClock::runUntilIdle() {
+  return runUntil(Duration::max());
+}
+
+size_t
+VirtualClock::runUntil(Duration time) {
+  size_t numRun = 0;
+  while (not callbacks_.empty() and callbacks_.begin()->first.first <= time) {
+    auto it = callbacks_.begin();
+    now_ = it->first.first;
+    // callbacks may schedule more callbacks, remove it before running it
+    auto callback = std::move(it->second);
+    callbacks_.erase(it);
+    callback();
+    ++numRun;
+  }
+  if (time != Duration::max()) {
+    now_ = std::max(now_, time);
+  }
+  return numRun;
+}
+
+} // namespace openr
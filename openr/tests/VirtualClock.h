@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+#include <folly/Function.h>
+
+namespace openr {
+
+//
+// Simulated clock of an emulation, shared by all emulated nodes. Callbacks
+// are scheduled at a virtual time and run cooperatively on the calling
+// thread in time order, callbacks scheduled for the same time in the order
+// they were scheduled. Runs are therefore repeatable and take no wall-clock
+// time waiting for timers.
+//
+class VirtualClock {
+ public:
+  using Duration = std::chrono::microseconds;
+  using Callback = folly::Function<void()>;
+
+  // virtual time since the start of the emulation
+  Duration
+  now() const {
+    return now_;
+  }
+
+  // schedule callback at now() + delay
+  void scheduleAfter(Duration delay, Callback callback);
+
+  // schedule callback at time, callbacks in the past run at now()
+  void scheduleAt(Duration time, Callback callback);
+
+  // run callbacks, advancing the time, until none is left. Returns the
+  // number of callbacks run
+  size_t runUntilIdle();
+
+  // run callbacks scheduled up to time and advance the time to it
+  size_t runUntil(Duration time);
+
+  size_t
+  getNumPending() const {
+    return callbacks_.size();
+  }
+
+ private:
+  Duration now_{0};
+
+  // sequence number of the next callback, orders callbacks of the same time
+  uint64_t nextSeq_{0};
+
+  std::map<std::pair<Duration, uint64_t>, Callback> callbacks_;
+};
+
+} // namespace openr
@@ -7,7 +7,11 @@
 
 #include "Watchdog.h"
 
+#include <folly/String.h>
+
 #include <openr/common/Constants.h>
+#include <openr/common/MemoryArenas.h>
+#include <openr/common/ThreadStats.h>
 #include <openr/common/Util.h>
 
 namespace openr {
@@ -16,12 +20,18 @@ Watchdog::Watchdog(
     std::string const& myNodeName,
     std::chrono::seconds healthCheckInterval,
     std::chrono::seconds healthCheckThreshold,
-    uint32_t criticalMemoryMB)
+    uint32_t criticalMemoryMB,
+    std::chrono::milliseconds stallWarningThreshold,
+    bool enableModuleArenas,
+    uint32_t memoryPressurePct)
     : myNodeName_(myNodeName),
       healthCheckInterval_(healthCheckInterval),
       healthCheckThreshold_(healthCheckThreshold),
+      stallWarningThreshold_(stallWarningThreshold),
       previousStatus_(true),
-      criticalMemoryMB_(criticalMemoryMB) {
+      criticalMemoryMB_(criticalMemoryMB),
+      enableModuleArenas_(enableModuleArenas),
+      memoryPressurePct_(memoryPressurePct) {
   // Schedule periodic timer for checking thread health
   watchdogTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     updateCounters();
@@ -35,9 +45,33 @@ Watchdog::Watchdog(
 void
 Watchdog::addEvb(OpenrEventBase* evb, const std::string& name) {
   CHECK(evb);
-  getEvb()->runInEventBaseThreadAndWait([this, evb, name]() {
+  folly::Optional<unsigned> arena;
+  pid_t tid{0};
+  evb->getEvb()->runInEventBaseThreadAndWait([this, &arena, &tid]() {
+    tid = getThreadId();
+    if (enableModuleArenas_) {
+      arena = bindThreadToNewArena();
+    }
+  });
+  if (arena.hasValue()) {
+    LOG(INFO) << "Thread " << name << " allocates from arena " << *arena;
+  }
+  getEvb()->runInEventBaseThreadAndWait([this, evb, name, arena, tid]() {
     CHECK_EQ(monitorEvbs_.count(evb), 0);
     monitorEvbs_.emplace(evb, name);
+    moduleThreads_[name] = {tid};
+    if (arena.hasValue()) {
+      moduleArenas_.emplace(name, *arena);
+    }
+  });
+}
+
+void
+Watchdog::addThreadPool(
+    const std::string& name, const std::string& threadNamePrefix) {
+  getEvb()->runInEventBaseThreadAndWait([this, name, threadNamePrefix]() {
+    CHECK_EQ(moduleThreads_.count(name), 0);
+    threadPools_.emplace(name, threadNamePrefix);
   });
 }
 
@@ -46,12 +80,35 @@ Watchdog::memoryLimitExceeded() const {
   return memExceedTime_.hasValue();
 }
 
+std::unordered_map<std::string, int64_t>
+Watchdog::getCounters() const {
+  return *counters_.rlock();
+}
+
 void
 Watchdog::monitorMemory() {
   auto memInUse_ = resourceMonitor_.getRSSMemBytes();
   if (not memInUse_.hasValue()) {
     return;
   }
+
+  // shed memory before the limit is reached
+  const double pressureMB = criticalMemoryMB_ * memoryPressurePct_ / 100.0;
+  if (memInUse_.value() / 1e6 > pressureMB) {
+    if (not underMemoryPressure_) {
+      underMemoryPressure_ = true;
+      relieveMemoryPressure();
+    }
+  } else {
+    underMemoryPressure_ = false;
+  }
+
+  auto memoryCounters = getMemoryCounters(memInUse_.value());
+  {
+    auto counters = counters_.wlock();
+    counters->insert(memoryCounters.begin(), memoryCounters.end());
+  }
+
   if (memInUse_.value() / 1e6 > criticalMemoryMB_) {
     LOG(WARNING) << "Memory usage critical:" << memInUse_.value() << " bytes,"
                  << " Memory limit:" << criticalMemoryMB_ << " MB";
@@ -77,6 +134,50 @@ Watchdog::monitorMemory() {
   }
 }
 
+std::unordered_map<std::string, int64_t>
+Watchdog::getMemoryCounters(size_t rssBytes) const {
+  std::unordered_map<std::string, int64_t> counters;
+  counters["memory.rss_bytes"] = rssBytes;
+  counters["memory.pressure_events"] = numMemoryPressureEvents_;
+  if (moduleArenas_.empty() or not refreshArenaStats()) {
+    return counters;
+  }
+
+  // memory of other threads, e.g. thrift or thread pools of modules, is
+  // allocated from the default arenas
+  auto totalBytes = getTotalAllocatedBytes();
+  if (not totalBytes.hasValue()) {
+    return counters;
+  }
+  int64_t otherBytes = *totalBytes;
+  for (auto const& kv : moduleArenas_) {
+    auto bytes = getArenaAllocatedBytes(kv.second);
+    if (not bytes.hasValue()) {
+      continue;
+    }
+    auto name = kv.first;
+    folly::toLowerAscii(name);
+    counters["memory." + name + ".allocated_bytes"] = *bytes;
+    otherBytes -= *bytes;
+  }
+  counters["memory.allocated_bytes"] = *totalBytes;
+  counters["memory.other.allocated_bytes"] = std::max<int64_t>(0, otherBytes);
+  return counters;
+}
+
+void
+Watchdog::relieveMemoryPressure() {
+  LOG(WARNING) << "Memory usage above " << memoryPressurePct_ << "% of "
+               << criticalMemoryMB_ << " MB, asking modules to shed memory";
+  ++numMemoryPressureEvents_;
+  for (auto const& kv : monitorEvbs_) {
+    auto evb = kv.first;
+    evb->runInEventBaseThread([evb]() { evb->onMemoryPressure(); });
+  }
+  // pages freed by modules later on are returned as jemalloc's decay runs
+  purgeArenas();
+}
+
 void
 Watchdog::updateCounters() {
   VLOG(2) << "Checking thread aliveness counters...";
@@ -84,12 +185,33 @@ Watchdog::updateCounters() {
   auto const& now = std::chrono::duration_cast<std::chrono::seconds>(
       std::chrono::system_clock::now().time_since_epoch());
   std::vector<std::string> stuckThreads;
+  std::unordered_map<std::string, int64_t> counters;
   for (auto const& kv : monitorEvbs_) {
     auto const& name = kv.second;
     auto const& lastTs = kv.first->getTimestamp();
     VLOG(4) << "Thread " << name << ", " << (now - lastTs).count()
             << " seconds ever since last thread activity";
 
+    // Warn about stalls long before the thread would be considered dead
+    const auto stallInfo = kv.first->getAndResetStallInfo();
+    if (stallInfo.maxLag >= stallWarningThreshold_) {
+      LOG(WARNING) << "Watchdog: " << name << " event loop stalled for "
+                   << stallInfo.maxLag.count() << "ms. Slowest callback: "
+                   << (stallInfo.slowestCallback.empty()
+                           ? "none"
+                           : stallInfo.slowestCallback)
+                   << " (" << stallInfo.slowestCallbackDuration.count()
+                   << "ms)";
+      ++numStalls_[name];
+    }
+
+    auto prefix = "event_loop." + name;
+    folly::toLowerAscii(prefix);
+    for (auto const& counter : kv.first->getEventLoopCounters()) {
+      counters[prefix + "." + counter.first] = counter.second;
+    }
+    counters[prefix + ".stalls"] = numStalls_[name];
+
     if (now - lastTs > healthCheckThreshold_) {
       // fire a crash right now
       LOG(WARNING) << "Watchdog: " << name << " thread detected to be dead";
@@ -115,6 +237,64 @@ Watchdog::updateCounters() {
   }
 
   previousStatus_ = stuckThreads.size() == 0;
+
+  auto threadCounters = getThreadCounters();
+  counters.insert(threadCounters.begin(), threadCounters.end());
+  counters_.wlock()->swap(counters);
+}
+
+std::unordered_map<std::string, int64_t>
+Watchdog::getThreadCounters() {
+  // pools may have grown or shrunk since the last healthcheck
+  for (auto const& kv : threadPools_) {
+    moduleThreads_[kv.first] = getThreadIdsByName(kv.second);
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - lastThreadStatsTime_);
+  const bool hasLastStats = not lastThreadStats_.empty();
+  lastThreadStatsTime_ = now;
+
+  std::unordered_map<std::string, int64_t> counters;
+  std::unordered_map<std::string, ThreadStats> allStats;
+  for (auto const& kv : moduleThreads_) {
+    ThreadStats stats;
+    for (auto const tid : kv.second) {
+      auto threadStats = getThreadStats(tid);
+      if (threadStats.hasValue()) {
+        stats += *threadStats;
+      }
+    }
+    allStats.emplace(kv.first, stats);
+
+    auto it = lastThreadStats_.find(kv.first);
+    if (not hasLastStats or it == lastThreadStats_.end() or
+        elapsed.count() <= 0) {
+      continue;
+    }
+    // stats of exited pool threads are gone, never report negative rates
+    auto const& last = it->second;
+    const double seconds = elapsed.count() / 1e9;
+    const auto cpuTime =
+        std::max<int64_t>(0, (stats.cpuTime - last.cpuTime).count());
+    const auto runQueueWait =
+        std::max<int64_t>(0, (stats.runQueueWait - last.runQueueWait).count());
+    const auto nvcsw = std::max<int64_t>(
+        0, stats.voluntaryCtxSwitches - last.voluntaryCtxSwitches);
+    const auto nivcsw = std::max<int64_t>(
+        0, stats.involuntaryCtxSwitches - last.involuntaryCtxSwitches);
+
+    auto prefix = "thread." + kv.first;
+    folly::toLowerAscii(prefix);
+    counters[prefix + ".cpu_pct"] = cpuTime * 100 / elapsed.count();
+    counters[prefix + ".runq_wait_pct"] = runQueueWait * 100 / elapsed.count();
+    counters[prefix + ".nvcsw"] = nvcsw / seconds;
+    counters[prefix + ".nivcsw"] = nivcsw / seconds;
+    counters[prefix + ".num_threads"] = kv.second.size();
+  }
+  lastThreadStats_.swap(allStats);
+  return counters;
 }
 
 void
@@ -10,13 +10,16 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <fbzmq/service/resource-monitor/ResourceMonitor.h>
+#include <folly/Synchronized.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/ThreadStats.h>
 
 namespace openr {
 
@@ -26,22 +29,51 @@ class Watchdog final : public OpenrEventBase {
       std::string const& myNodeName,
       std::chrono::seconds healthCheckInterval,
       std::chrono::seconds healthCheckThreshold,
-      uint32_t critialMemoryMB);
+      uint32_t critialMemoryMB,
+      std::chrono::milliseconds stallWarningThreshold =
+          std::chrono::milliseconds(250),
+      bool enableModuleArenas = false,
+      uint32_t memoryPressurePct = 100);
 
   // non-copyable
   Watchdog(Watchdog const&) = delete;
   Watchdog& operator=(Watchdog const&) = delete;
 
+  // monitor evb. With module arenas enabled, its thread is bound to a
+  // jemalloc arena of its own for its memory to be accounted separately
   void addEvb(OpenrEventBase* evb, const std::string& name);
 
+  // account the CPU use of the threads whose name starts with
+  // threadNamePrefix, e.g. the workers of a thrift server, under name
+  void addThreadPool(
+      const std::string& name, const std::string& threadNamePrefix);
+
   bool memoryLimitExceeded() const;
 
+  // Event loop counters of every monitored thread, e.g.
+  // "event_loop.decision.lag_ms.p99", and memory counters, e.g.
+  // "memory.decision.allocated_bytes", and CPU use of every monitored thread
+  // or pool over the last healthcheck interval, e.g. "thread.decision.cpu_pct"
+  // or "thread.decision.nivcsw" (per second), as of the last healthcheck
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
  private:
   void updateCounters();
 
+  // CPU use, run queue wait and context switch rates of each monitored
+  // thread or pool since the previous call
+  std::unordered_map<std::string, int64_t> getThreadCounters();
+
   // monitor memory usage
   void monitorMemory();
 
+  // memory counters of the process and of module arenas
+  std::unordered_map<std::string, int64_t> getMemoryCounters(
+      size_t rssBytes) const;
+
+  // ask all modules to shed memory, and return unused pages to the system
+  void relieveMemoryPressure();
+
   void fireCrash(const std::string& msg);
 
   const std::string myNodeName_;
@@ -58,15 +90,45 @@ class Watchdog final : public OpenrEventBase {
   // thread healthcheck threshold
   const std::chrono::seconds healthCheckThreshold_;
 
+  // event loop lag to warn about, below the healthcheck threshold
+  const std::chrono::milliseconds stallWarningThreshold_;
+
+  // number of stall warnings per thread
+  std::unordered_map<std::string, int64_t> numStalls_;
+
+  // counters exported by getCounters()
+  folly::Synchronized<std::unordered_map<std::string, int64_t>> counters_;
+
   // boolean to indicate previous failure
   bool previousStatus_{true};
 
   // critcal memory threhsold
   uint32_t criticalMemoryMB_{0};
 
+  // jemalloc arena of each monitored thread, if enabled
+  const bool enableModuleArenas_{false};
+  std::unordered_map<std::string /* name */, unsigned> moduleArenas_;
+
+  // percentage of the critical memory above which modules are asked to shed
+  // memory, once until usage drops below it again
+  const uint32_t memoryPressurePct_{100};
+  bool underMemoryPressure_{false};
+  int64_t numMemoryPressureEvents_{0};
+
   // amount of time memory usage sustained above memory limit
   folly::Optional<std::chrono::steady_clock::time_point> memExceedTime_;
 
+  // threads of each monitored module or pool, by name
+  std::unordered_map<std::string, std::vector<pid_t>> moduleThreads_;
+
+  // thread name prefix of each pool, its threads are looked up again at
+  // every healthcheck
+  std::unordered_map<std::string, std::string> threadPools_;
+
+  // scheduling stats of each module as of the last healthcheck
+  std::unordered_map<std::string, ThreadStats> lastThreadStats_;
+  std::chrono::steady_clock::time_point lastThreadStatsTime_;
+
   // resource monitor
   // TODO T62261328: Remove ResourceMonitor (& sigar) dependency
   fbzmq::ResourceMonitor resourceMonitor_{};